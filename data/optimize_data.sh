@@ -4,6 +4,8 @@
 # (C) 2014-2015 Odd0002, under the GPLv3
 #
 # Script to optimize the data, currently PNG, JPEG, B3DZ.
+# It also pre-bakes S3TC compressed textures (DDS files with all mipmaps),
+# which are used instead of compressing the textures at runtime.
 # experimental B3D to B3DZ compression added, not enabled by default
 # Run it before making a release, and after adding new data.
 
@@ -20,6 +22,7 @@ jpegtran=true
 advdef=true
 advzip=true
 optipng=true
+nvcompress=true
 
 #WARNING! SETTING TO TRUE MAY POSSIBLY INCREASE LOAD TIMES ON A SLOW CPU (UNTESTED) OR LEAD TO FILE NOT FOUND ERRORS WHEN RUNNING SUPERTUXKART! 
 compress_b3d=false
@@ -65,6 +68,13 @@ then
 	sleep 2
 fi
 
+#check for nvcompress
+if [ ! $(which nvcompress) ]
+then
+	echo "nvcompress is not installed, therefore no compressed textures will be created.  It is included in the package \"nvidia-texture-tools\"."; nvcompress=false
+	sleep 2
+fi
+
 
 # Defines
 
@@ -119,6 +129,24 @@ for arg; do
 done
 }
 export -f recomprb3dz
+
+
+#create a S3TC compressed texture with all mipmaps next to the texture:
+#DXT5 (BC3) for png files with an alpha channel, otherwise DXT1 (BC1)
+prebaketex () {
+for arg; do
+	format=-bc1
+	case "$arg" in
+	*.png)
+		#colour type (byte 25 of the header) 4 and 6 have an alpha channel
+		colortype=$(od -An -j25 -N1 -tu1 "$arg" | tr -d ' ')
+		if [ "$colortype" = 4 ] || [ "$colortype" = 6 ]; then format=-bc3; fi
+		;;
+	esac
+	nvcompress -silent $format "$arg" "${arg%.*}.dds" > /dev/null
+done
+}
+export -f prebaketex
 #END MULTITHREADING FUNCTIONS
 
 #lossless png image optimization
@@ -175,6 +203,15 @@ else echo "advzip not installed. Ignoring commands using advzip..."; sleep 1
 fi
 
 
+#pre-baked compressed textures, only for the textures of models (the gui
+#textures are not compressed). Must run after the png/jpg optimizations,
+#since textures newer than their dds file are compressed at runtime again.
+if [ "$nvcompress" = true ]; then
+	find ./textures ./tracks ./karts \( -name "*.png" -o -name "*.jpg" \) -print0 | xargs -0 -n 1 -P "$threads" bash -c 'prebaketex "$@"' -- #multithread texture compression
+else echo "nvcompress not installed. Ignoring texture compression..."; sleep 1
+fi
+
+
 # Add optimizations for other types if necessary
 
 # get and store new disk usage info
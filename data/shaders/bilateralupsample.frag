@@ -0,0 +1,39 @@
+uniform sampler2D tex;
+uniform sampler2D dtex;
+
+out vec4 FragColor;
+
+vec4 getPosFromUVDepth(vec3 uvDepth, mat4 InverseProjectionMatrix);
+
+// Bilinear upsampling of tex, where the four texels around the pixel are also
+// weighted by how close their depth is to the depth of the pixel. The depth
+// of a texel is read from the full resolution depth buffer at its center.
+
+float getViewDepth(vec2 uv)
+{
+    return getPosFromUVDepth(vec3(uv, texture(dtex, uv).x), InverseProjectionMatrix).z;
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screen;
+    vec2 size = vec2(textureSize(tex, 0));
+    vec2 texel = uv * size - .5;
+    vec2 base = floor(texel);
+    vec2 f = texel - base;
+    float depth = getViewDepth(uv);
+
+    vec4 color = vec4(0.);
+    float total_weight = 0.;
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 offset = vec2(float(i % 2), float(i / 2));
+        vec2 texel_uv = clamp((base + offset + .5) / size, vec2(0.), vec2(1.));
+        float bilinear = mix(1. - f.x, f.x, offset.x) * mix(1. - f.y, f.y, offset.y);
+        float depth_difference = abs(getViewDepth(texel_uv) - depth) / max(depth, .1);
+        float weight = bilinear / (depth_difference + .01);
+        color += weight * texture(tex, texel_uv);
+        total_weight += weight;
+    }
+    FragColor = color / max(total_weight, 1e-5);
+}
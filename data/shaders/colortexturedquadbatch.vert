@@ -0,0 +1,20 @@
+// Quads of a 2D image batch, positions are already in clip space
+#if __VERSION__ >= 330
+layout(location=0) in vec2 Position;
+layout(location=3) in vec2 Texcoord;
+layout(location=2) in vec4 Color;
+#else
+in vec2 Position;
+in vec2 Texcoord;
+in vec4 Color;
+#endif
+
+out vec2 uv;
+out vec4 col;
+
+void main()
+{
+    col = Color;
+    uv = Texcoord;
+    gl_Position = vec4(Position, 0., 1.);
+}
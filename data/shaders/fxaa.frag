@@ -0,0 +1,54 @@
+uniform sampler2D tex;
+uniform vec2 PIXEL_SIZE;
+
+out vec4 FragColor;
+
+// Single pass anti-aliasing in the spirit of FXAA: the direction of an edge
+// is estimated from the luma of the 4 diagonal neighbours, and the pixel is
+// blurred along it. Pixels without a contrasted edge are left untouched.
+
+#define REDUCE_MIN (1. / 128.)
+#define REDUCE_MUL (1. / 8.)
+#define SPAN_MAX 8.
+#define EDGE_THRESHOLD (1. / 8.)
+#define EDGE_THRESHOLD_MIN (1. / 32.)
+
+float getLuma(vec3 color)
+{
+    // The texture is sRGB so colors are linear, edges are detected on the
+    // perceived luminance
+    return sqrt(dot(color, vec3(0.299, 0.587, 0.114)));
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy * PIXEL_SIZE;
+    vec3 rgbM = texture(tex, uv).rgb;
+    float lumaM = getLuma(rgbM);
+    float lumaNW = getLuma(texture(tex, uv + vec2(-1., 1.) * PIXEL_SIZE).rgb);
+    float lumaNE = getLuma(texture(tex, uv + vec2(1., 1.) * PIXEL_SIZE).rgb);
+    float lumaSW = getLuma(texture(tex, uv + vec2(-1., -1.) * PIXEL_SIZE).rgb);
+    float lumaSE = getLuma(texture(tex, uv + vec2(1., -1.) * PIXEL_SIZE).rgb);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+    {
+        FragColor = vec4(rgbM, 1.);
+        return;
+    }
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)),
+                    (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (.25 * REDUCE_MUL), REDUCE_MIN);
+    float rcpDirMin = 1. / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * PIXEL_SIZE;
+
+    vec3 rgbA = .5 * (texture(tex, uv + dir * (1. / 3. - .5)).rgb +
+                      texture(tex, uv + dir * (2. / 3. - .5)).rgb);
+    vec3 rgbB = .5 * rgbA + .25 * (texture(tex, uv - .5 * dir).rgb +
+                                   texture(tex, uv + .5 * dir).rgb);
+    // If the wider blur crosses another edge only use the narrow one
+    float lumaB = getLuma(rgbB);
+    FragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.);
+}
@@ -0,0 +1,23 @@
+uniform mat4 ModelViewMatrix;
+uniform vec3 Position;
+uniform vec2 Size;
+uniform vec2 Tile;
+
+#if __VERSION__ >= 330
+layout(location = 0) in vec2 Corner;
+layout(location = 3) in vec2 Texcoord;
+#else
+in vec2 Corner;
+in vec2 Texcoord;
+#endif
+
+out vec2 uv;
+
+// The atlas contains 4x2 views and was rendered upside down compared to
+// irrlicht textures
+void main(void)
+{
+    uv = (vec2(Texcoord.x, 1. - Texcoord.y) + Tile) * vec2(0.25, 0.5);
+    vec4 Center = ModelViewMatrix * vec4(Position, 1.);
+    gl_Position = ProjectionMatrix * (Center + vec4(Size * Corner, 0., 0.));
+}
@@ -0,0 +1,15 @@
+uniform sampler2D tex;
+
+in vec3 nor;
+in vec2 uv;
+out vec4 FragColor;
+
+// Imposters are not lit by the deferred lighting, so a rough light coming
+// from above is baked into them.
+void main(void)
+{
+    vec4 col = texture(tex, uv);
+    if (col.a < 0.5) discard;
+    float light = 0.6 + 0.4 * max(normalize(nor).y, 0.);
+    FragColor = vec4(col.rgb * light, 1.);
+}
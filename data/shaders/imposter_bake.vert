@@ -0,0 +1,21 @@
+uniform mat4 ModelViewProjectionMatrix;
+
+#if __VERSION__ >= 330
+layout(location = 0) in vec3 Position;
+layout(location = 1) in vec3 Normal;
+layout(location = 3) in vec2 Texcoord;
+#else
+in vec3 Position;
+in vec3 Normal;
+in vec2 Texcoord;
+#endif
+
+out vec3 nor;
+out vec2 uv;
+
+void main(void)
+{
+    nor = Normal;
+    uv = Texcoord;
+    gl_Position = ModelViewProjectionMatrix * vec4(Position, 1.);
+}
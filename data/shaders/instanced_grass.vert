@@ -13,6 +13,7 @@ layout(location = 9) in vec3 Scale;
 layout(location = 10) in sampler2D Handle;
 layout(location = 11) in sampler2D SecondHandle;
 #endif
+layout(location = 14) in vec2 TexcoordOffset;
 
 #else
 in vec3 Position;
@@ -23,6 +24,7 @@ in vec2 Texcoord;
 in vec3 Origin;
 in vec3 Orientation;
 in vec3 Scale;
+in vec2 TexcoordOffset;
 #endif
 
 out vec3 nor;
@@ -41,7 +43,7 @@ void main()
     mat4 TransposeInverseModelView = transpose(getInverseWorldMatrix(Origin + windDir * Color.r, Orientation, Scale) * InverseViewMatrix);
     gl_Position = ProjectionViewMatrix *  ModelMatrix * vec4(Position, 1.);
     nor = (TransposeInverseModelView * vec4(Normal, 0.)).xyz;
-    uv = Texcoord;
+    uv = Texcoord + TexcoordOffset;
 #ifdef Use_Bindless_Texture
     handle = Handle;
     secondhandle = SecondHandle;
@@ -15,6 +15,7 @@ layout(location = 10) in sampler2D Handle;
 layout(location = 11) in sampler2D SecondHandle;
 layout(location = 13) in sampler2D ThirdHandle;
 #endif
+layout(location = 14) in vec2 TexcoordOffset;
 
 #else
 in vec3 Position;
@@ -28,6 +29,7 @@ in vec3 Bitangent;
 in vec3 Origin;
 in vec3 Orientation;
 in vec3 Scale;
+in vec2 TexcoordOffset;
 #endif
 
 out vec3 nor;
@@ -55,7 +57,7 @@ void main(void)
     // Keep direction
     tangent = (ViewMatrix * ModelMatrix * vec4(Tangent, 0.)).xyz;
     bitangent = (ViewMatrix * ModelMatrix * vec4(Bitangent, 0.)).xyz;
-    uv = Texcoord;
+    uv = Texcoord + TexcoordOffset;
     uv_bis = SecondTexcoord;
     color = Color.zyxw;
 #ifdef Use_Bindless_Texture
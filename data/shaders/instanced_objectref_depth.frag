@@ -0,0 +1,18 @@
+#ifndef Use_Bindless_Texture
+uniform sampler2D tex;
+#endif
+
+#ifdef Use_Bindless_Texture
+flat in sampler2D handle;
+#endif
+in vec2 uv;
+
+void main() {
+#ifdef Use_Bindless_Texture
+    vec4 col = texture(handle, uv);
+#else
+    vec4 col = texture(tex, uv);
+#endif
+    if (col.a < 0.5)
+        discard;
+}
@@ -0,0 +1,26 @@
+uniform mat4 ModelViewMatrix;
+
+#if __VERSION__ >= 330
+layout(location = 0) in vec2 Corner;
+layout(location = 1) in vec3 Position;
+layout(location = 2) in vec2 Size;
+layout(location = 3) in vec2 Texcoord;
+layout(location = 4) in vec4 TexRect;
+#else
+in vec2 Corner;
+in vec3 Position;
+in vec2 Size;
+in vec2 Texcoord;
+in vec4 TexRect;
+#endif
+
+out vec2 uv;
+
+// One instance per label, TexRect is the part of the label atlas covered
+// by the text
+void main(void)
+{
+    uv = TexRect.xy + Texcoord * TexRect.zw;
+    vec4 Center = ModelViewMatrix * vec4(Position, 1.);
+    gl_Position = ProjectionMatrix * (Center + vec4(Size * Corner, 0., 0.));
+}
@@ -0,0 +1,12 @@
+#ifdef Use_Bindless_Texture
+layout(bindless_sampler) uniform sampler2D tex;
+#else
+uniform sampler2D tex;
+#endif
+
+in vec2 uv;
+
+void main() {
+	if (texture(tex, uv).a < 0.5)
+		discard;
+}
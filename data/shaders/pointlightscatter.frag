@@ -1,6 +1,7 @@
 uniform sampler2D dtex;
 uniform float density;
 uniform vec3 fogcol;
+uniform vec2 target_size;
 
 flat in vec3 center;
 flat in float energy;
@@ -19,7 +20,8 @@ void main()
     vec3 light_col = col.xyz;
 
     // Compute pixel position
-    vec2 texc = 2. * gl_FragCoord.xy / screen;
+    // Scattering is rendered at a lower resolution than the screen
+    vec2 texc = gl_FragCoord.xy / target_size;
     float z = texture(dtex, texc).x;
     vec4 pixelpos = getPosFromUVDepth(vec3(texc, z), InverseProjectionMatrix);
     vec3 eyedir = -normalize(pixelpos.xyz);
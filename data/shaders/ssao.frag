@@ -5,6 +5,8 @@ uniform sampler2D dtex;
 uniform float radius;
 uniform float k = 1.5;
 uniform float sigma = 1.;
+uniform vec2 target_size;
+uniform float rotation;
 out float AO;
 
 const float tau = 7.;
@@ -18,14 +20,15 @@ const float invSamples = 1. / SAMPLES;
 vec3 getXcYcZc(int x, int y, float zC)
 {
     // We use perspective symetric projection matrix hence P(0,2) = P(1, 2) = 0
-    float xC= (2 * (float(x)) / screen.x - 1.) * zC / ProjectionMatrix[0][0];
-    float yC= (2 * (float(y)) / screen.y - 1.) * zC / ProjectionMatrix[1][1];
+    float xC= (2 * (float(x)) / target_size.x - 1.) * zC / ProjectionMatrix[0][0];
+    float yC= (2 * (float(y)) / target_size.y - 1.) * zC / ProjectionMatrix[1][1];
     return vec3(xC, yC, zC);
 }
 
 void main(void)
 {
-    vec2 uv = gl_FragCoord.xy / screen;
+    // The occlusion can be rendered at a lower resolution than the screen
+    vec2 uv = gl_FragCoord.xy / target_size;
     float lineardepth = textureLod(dtex, uv, 0.).x;
     int x = int(gl_FragCoord.x), y = int(gl_FragCoord.y);
     vec3 FragPos = getXcYcZc(x, y, lineardepth);
@@ -40,8 +43,8 @@ void main(void)
     float bl = 0.0;
     float m = log2(r) + 6 + log2(invSamples);
 
-    float theta = 2. * 3.14 * tau * .5 * invSamples + phi;
-    vec2 rotations = vec2(cos(theta), sin(theta)) * screen;
+    float theta = 2. * 3.14 * tau * .5 * invSamples + phi + rotation;
+    vec2 rotations = vec2(cos(theta), sin(theta)) * target_size;
     vec2 offset = vec2(cos(invSamples), sin(invSamples));
 
     for(int i = 0; i < SAMPLES; ++i) {
@@ -53,9 +56,9 @@ void main(void)
         m = m + .5;
         ivec2 ioccluder_uv = ivec2(x, y) + ivec2(localoffset);
 
-        if (ioccluder_uv.x < 0 || ioccluder_uv.x > screen.x || ioccluder_uv.y < 0 || ioccluder_uv.y > screen.y) continue;
+        if (ioccluder_uv.x < 0 || ioccluder_uv.x > target_size.x || ioccluder_uv.y < 0 || ioccluder_uv.y > target_size.y) continue;
 
-        float LinearoccluderFragmentDepth = textureLod(dtex, vec2(ioccluder_uv) / screen, max(m, 0.)).x;
+        float LinearoccluderFragmentDepth = textureLod(dtex, vec2(ioccluder_uv) / target_size, max(m, 0.)).x;
         vec3 OccluderPos = getXcYcZc(ioccluder_uv.x, ioccluder_uv.y, LinearoccluderFragmentDepth);
 
         vec3 vi = OccluderPos - FragPos;
@@ -0,0 +1,41 @@
+uniform sampler2D current_ao;
+uniform sampler2D history;
+uniform sampler2D dtex;
+uniform mat4 PreviousProjectionViewMatrix;
+uniform float history_weight;
+
+out float AO;
+
+vec4 getPosFromUVDepth(vec3 uvDepth, mat4 InverseProjectionMatrix);
+
+// Blends the occlusion of this frame with the accumulated occlusion of the
+// previous frames at the same world position. The history is clamped to the
+// occlusion around the pixel in this frame, so that disoccluded pixels do not
+// keep the occlusion of the object which hid them.
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(current_ao, 0));
+    float current = texture(current_ao, uv).x;
+
+    float z = texture(dtex, uv).x;
+    vec4 xpos = getPosFromUVDepth(vec3(uv, z), InverseProjectionMatrix);
+    vec4 previous_pos = PreviousProjectionViewMatrix * (InverseViewMatrix * xpos);
+    vec2 previous_uv = .5 * previous_pos.xy / previous_pos.w + .5;
+
+    float weight = history_weight;
+    if (z >= 1. || previous_pos.w <= 0. || any(lessThan(previous_uv, vec2(0.))) || any(greaterThan(previous_uv, vec2(1.))))
+        weight = 0.;
+
+    float min_ao = current, max_ao = current;
+    for (int i = 0; i < 4; i++)
+    {
+        ivec2 offset = ivec2(i == 0 ? -1 : (i == 1 ? 1 : 0), i == 2 ? -1 : (i == 3 ? 1 : 0));
+        float neighbour = texelFetch(current_ao, ivec2(gl_FragCoord.xy) + offset, 0).x;
+        min_ao = min(min_ao, neighbour);
+        max_ao = max(max_ao, neighbour);
+    }
+    float previous = clamp(texture(history, previous_uv).x, min_ao, max_ao);
+
+    AO = mix(current, previous, weight);
+}
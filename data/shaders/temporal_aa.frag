@@ -0,0 +1,46 @@
+uniform sampler2D current_color;
+uniform sampler2D history;
+uniform sampler2D dtex;
+uniform mat4 PreviousProjectionViewMatrix;
+uniform float history_weight;
+
+out vec4 FragColor;
+
+vec4 getPosFromUVDepth(vec3 uvDepth, mat4 InverseProjectionMatrix);
+
+// The projection is jittered by a subpixel offset every frame, so blending
+// the current frame with the previous frames at the same world position
+// antialiases the edges. The history is clamped to the colors around the
+// pixel in this frame, so that disoccluded or moving objects do not leave
+// trails.
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(current_color, 0));
+    vec3 current = texture(current_color, uv).rgb;
+
+    float z = texture(dtex, uv).x;
+    vec4 xpos = getPosFromUVDepth(vec3(uv, z), InverseProjectionMatrix);
+    vec4 previous_pos = PreviousProjectionViewMatrix * (InverseViewMatrix * xpos);
+    vec2 previous_uv = .5 * previous_pos.xy / previous_pos.w + .5;
+
+    float weight = history_weight;
+    if (previous_pos.w <= 0. || any(lessThan(previous_uv, vec2(0.))) || any(greaterThan(previous_uv, vec2(1.))))
+        weight = 0.;
+
+    ivec2 max_texel = textureSize(current_color, 0) - 1;
+    vec3 min_color = current, max_color = current;
+    for (int i = -1; i <= 1; i++)
+    {
+        for (int j = -1; j <= 1; j++)
+        {
+            ivec2 texel = clamp(ivec2(gl_FragCoord.xy) + ivec2(i, j), ivec2(0), max_texel);
+            vec3 neighbour = texelFetch(current_color, texel, 0).rgb;
+            min_color = min(min_color, neighbour);
+            max_color = max(max_color, neighbour);
+        }
+    }
+    vec3 previous = clamp(texture(history, previous_uv).rgb, min_color, max_color);
+
+    FragColor = vec4(mix(current, previous, weight), 1.);
+}
@@ -5,11 +5,13 @@ out vec4 FragColor;
 
 vec3 getCIEYxy(vec3 rgbColor);
 vec3 getRGBFromCIEXxy(vec3 YxyColor);
+vec3 getBloom(vec2 uv);
 
 void main()
 {
     vec2 uv = gl_FragCoord.xy / screen;
     vec4 col = texture(tex, uv);
+    col.xyz += getBloom(uv);
 
     // Uncharted2 tonemap with Auria's custom coefficients
     vec4 perChannel = (col * (6.9 * col + .5)) / (col * (5.2 * col + 1.7) + 0.06);
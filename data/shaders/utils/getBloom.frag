@@ -0,0 +1,22 @@
+// Combines the blurred bloom and lens flare mips, which were previously
+// blended in separate passes (bloomblend and lensblend).
+uniform sampler2D tex_128;
+uniform sampler2D tex_256;
+uniform sampler2D tex_512;
+uniform sampler2D tex_lens_128;
+uniform sampler2D tex_lens_256;
+uniform sampler2D tex_lens_512;
+
+vec3 getBloom(vec2 uv)
+{
+    vec3 bloom = .125 * texture(tex_128, uv).xyz;
+    bloom += .25 * texture(tex_256, uv).xyz;
+    bloom += .5 * texture(tex_512, uv).xyz;
+
+    // Lens flare, based on the bloom blend (by samuncle)
+    vec3 lens = .125 * texture(tex_lens_128, uv).xyz;
+    lens += .25 * texture(tex_lens_256, uv).xyz;
+    lens += .5 * texture(tex_lens_512, uv).xyz;
+    float final = max(lens.r, max(lens.g, lens.b));
+    return bloom + vec3(final * 0.1, final * 0.2, final);
+}
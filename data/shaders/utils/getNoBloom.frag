@@ -0,0 +1,5 @@
+// Used instead of getBloom.frag if bloom is disabled.
+vec3 getBloom(vec2 uv)
+{
+    return vec3(0.);
+}
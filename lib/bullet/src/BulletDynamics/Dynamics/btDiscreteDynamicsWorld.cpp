@@ -866,7 +866,10 @@ void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 			if (getDispatchInfo().m_useContinuous && body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
 			{
 				BT_PROFILE("CCD motion clamping");
-				if (body->getCollisionShape()->isConvex())
+				// STK: the motion is swept with a sphere, not with the shape
+				// of the body, so compound shapes (e.g. karts) can use CCD too
+				if (body->getCollisionShape()->isConvex() ||
+					body->getCollisionShape()->isCompound())
 				{
 					gNumClampedCcdMotions++;
 #ifdef USE_STATIC_ONLY
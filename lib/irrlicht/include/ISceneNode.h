@@ -49,7 +49,9 @@ namespace scene
 			: RelativeTranslation(position), RelativeRotation(rotation), RelativeScale(scale),
 				Parent(0), SceneManager(mgr), TriangleSelector(0), ID(id),
 				AutomaticCullingState(EAC_BOX), DebugDataVisible(EDS_OFF),
-				IsVisible(true), IsDebugObject(false)
+				IsVisible(true), IsDebugObject(false),
+				RelativeTransformationChanged(true),
+				AbsoluteTransformationVersion(0), ParentTransformationVersion(0)
 		{
 			if (parent)
 				parent->addChild(this);
@@ -289,6 +291,7 @@ namespace scene
 				child->remove(); // remove from old parent
 				Children.push_back(child);
 				child->Parent = this;
+				child->RelativeTransformationChanged = true;
 			}
 		}
 
@@ -306,6 +309,7 @@ namespace scene
 				if ((*it) == child)
 				{
 					(*it)->Parent = 0;
+					(*it)->RelativeTransformationChanged = true;
 					(*it)->drop();
 					Children.erase(it);
 					return true;
@@ -326,6 +330,7 @@ namespace scene
 			for (; it != Children.end(); ++it)
 			{
 				(*it)->Parent = 0;
+				(*it)->RelativeTransformationChanged = true;
 				(*it)->drop();
 			}
 
@@ -468,6 +473,7 @@ namespace scene
 		virtual void setScale(const core::vector3df& scale)
 		{
 			RelativeScale = scale;
+			RelativeTransformationChanged = true;
 		}
 
 
@@ -488,6 +494,7 @@ namespace scene
 		virtual void setRotation(const core::vector3df& rotation)
 		{
 			RelativeRotation = rotation;
+			RelativeTransformationChanged = true;
 		}
 
 
@@ -507,6 +514,7 @@ namespace scene
 		virtual void setPosition(const core::vector3df& newpos)
 		{
 			RelativeTranslation = newpos;
+			RelativeTransformationChanged = true;
 		}
 
 
@@ -648,9 +656,19 @@ namespace scene
 
 		//! Updates the absolute position based on the relative and the parents position
 		/** Note: This does not recursively update the parents absolute positions, so if you have a deeper
-			hierarchy you might want to update the parents first.*/
+			hierarchy you might want to update the parents first.
+			The absolute transformation is only recomputed if the relative
+			transformation or the absolute transformation of the parent
+			changed since the last update, so static nodes are cheap.*/
 		virtual void updateAbsolutePosition()
 		{
+			const u32 parentVersion =
+				Parent ? Parent->AbsoluteTransformationVersion : 0;
+			if (!RelativeTransformationChanged &&
+				parentVersion == ParentTransformationVersion &&
+				!hasDynamicRelativeTransformation())
+				return;
+
 			if (Parent)
 			{
 				AbsoluteTransformation =
@@ -658,6 +676,18 @@ namespace scene
 			}
 			else
 				AbsoluteTransformation = getRelativeTransformation();
+			RelativeTransformationChanged = false;
+			ParentTransformationVersion = parentVersion;
+			++AbsoluteTransformationVersion;
+		}
+
+		//! Returns true if getRelativeTransformation() does not only depend on the relative translation, rotation and scale.
+		/** Such nodes (e.g. nodes using a transformation matrix) recompute
+			their absolute transformation in each updateAbsolutePosition()
+			call. */
+		virtual bool hasDynamicRelativeTransformation() const
+		{
+			return false;
 		}
 
 
@@ -761,6 +791,7 @@ namespace scene
 			RelativeTranslation = toCopyFrom->RelativeTranslation;
 			RelativeRotation = toCopyFrom->RelativeRotation;
 			RelativeScale = toCopyFrom->RelativeScale;
+			RelativeTransformationChanged = true;
 			ID = toCopyFrom->ID;
 			setTriangleSelector(toCopyFrom->TriangleSelector);
 			AutomaticCullingState = toCopyFrom->AutomaticCullingState;
@@ -848,6 +879,15 @@ namespace scene
 
 		//! Is debug object?
 		bool IsDebugObject;
+
+		//! Set when the relative transformation or the parent changed.
+		bool RelativeTransformationChanged;
+
+		//! Incremented each time the absolute transformation is recomputed.
+		u32 AbsoluteTransformationVersion;
+
+		//! AbsoluteTransformationVersion of the parent at the last update.
+		u32 ParentTransformationVersion;
 	};
 
 
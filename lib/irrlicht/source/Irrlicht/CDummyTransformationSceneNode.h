@@ -30,6 +30,9 @@ namespace scene
 		//! Returns the relative transformation of the scene node.
 		virtual core::matrix4 getRelativeTransformation() const;
 
+		//! The matrix can be changed at any time with getRelativeTransformationMatrix
+		virtual bool hasDynamicRelativeTransformation() const { return true; }
+
 		//! does nothing.
 		virtual void render() {}
 
@@ -2244,6 +2244,7 @@ void CSceneManager::deserializeAttributes(io::IAttributes* in, io::SAttributeRea
 	RelativeTranslation.set(0,0,0);
 	RelativeRotation.set(0,0,0);
 	RelativeScale.set(1,1,1);
+	RelativeTransformationChanged = true;
 	IsVisible = true;
 	AutomaticCullingState = scene::EAC_BOX;
 	DebugDataVisible = scene::EDS_OFF;
@@ -154,21 +154,29 @@ irr::core::stringw Achievement::getProgressAsString() const
 void Achievement::increase(const std::string & key, 
                            const std::string &goal_key, int increase)
 {
+    // The progress of a fulfilled achievement is not used anymore
+    if (m_achieved)
+        return;
+
+    const int goal = m_achievement_info->getGoalValue(goal_key);
     std::map<std::string, int>::iterator it;
     it = m_progress_map.find(key);
     if (it != m_progress_map.end())
     {
         it->second += increase;
-        if (it->second > m_achievement_info->getGoalValue(goal_key))
-            it->second = m_achievement_info->getGoalValue(goal_key);
+        if (it->second > goal)
+            it->second = goal;
     }
     else
     {
-        if (increase>m_achievement_info->getGoalValue(goal_key))
-            increase = m_achievement_info->getGoalValue(goal_key);
-        m_progress_map[key] = increase;
+        if (increase>goal)
+            increase = goal;
+        it = m_progress_map.insert(std::make_pair(key, increase)).first;
     }
-    check();
+    // Only the value that was just increased can newly reach its goal, so
+    // the other values only need to be checked if it did.
+    if (it->second >= goal)
+        check();
 }   // increase
 
 // ----------------------------------------------------------------------------
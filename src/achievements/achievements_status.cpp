@@ -81,9 +81,17 @@ void AchievementsStatus::load(const XMLNode * input)
 }   // load
 
 // ----------------------------------------------------------------------------
+/** Adds an achievement, and if it needs to be reset after each race or
+ *  lap, to the corresponding list.
+ *  \param achievement The achievement to add.
+ */
 void AchievementsStatus::add(Achievement *achievement)
 {
     m_achievements[achievement->getID()] = achievement;
+    if (achievement->getInfo()->needsResetAfterRace())
+        m_reset_after_race.push_back(achievement);
+    else if (achievement->getInfo()->needsResetAfterLap())
+        m_reset_after_lap.push_back(achievement);
 }    // add
 
 
@@ -107,8 +115,9 @@ void AchievementsStatus::save(UTFWriter &out)
 // ----------------------------------------------------------------------------
 Achievement * AchievementsStatus::getAchievement(uint32_t id)
 {
-    if ( m_achievements.find(id) != m_achievements.end())
-        return m_achievements[id];
+    std::map<uint32_t, Achievement *>::iterator it = m_achievements.find(id);
+    if (it != m_achievements.end())
+        return it->second;
     return NULL;
 }   // getAchievement
 
@@ -161,18 +170,14 @@ void AchievementsStatus::sync(const std::vector<uint32_t> & achieved_ids)
 void AchievementsStatus::onRaceEnd()
 {
     //reset all values that need to be reset
-    std::map<uint32_t, Achievement *>::iterator iter;
-    for ( iter = m_achievements.begin(); iter != m_achievements.end(); ++iter ) {
-        iter->second->onRaceEnd();
-    }
+    for (unsigned int i = 0; i < m_reset_after_race.size(); i++)
+        m_reset_after_race[i]->onRaceEnd();
 }   // onRaceEnd
 
 // ----------------------------------------------------------------------------
 void AchievementsStatus::onLapEnd()
 {
     //reset all values that need to be reset
-    std::map<uint32_t, Achievement *>::iterator iter;
-    for (iter = m_achievements.begin(); iter != m_achievements.end(); ++iter) {
-        iter->second->onLapEnd();
-    }
+    for (unsigned int i = 0; i < m_reset_after_lap.size(); i++)
+        m_reset_after_lap[i]->onLapEnd();
 }   // onLapEnd
@@ -27,6 +27,7 @@
 
 #include <irrString.h>
 #include <string>
+#include <vector>
 
 class UTFWriter;
 class XMLNode;
@@ -42,6 +43,14 @@ class AchievementsStatus
 {
 private:
     std::map<uint32_t, Achievement *> m_achievements;
+
+    /** The achievements that need to be reset at the end of each race,
+     *  so that not all achievements have to be checked. */
+    std::vector<Achievement*> m_reset_after_race;
+
+    /** The achievements that need to be reset at the end of each lap. */
+    std::vector<Achievement*> m_reset_after_lap;
+
     bool         m_online;
     bool         m_valid;
 
@@ -117,6 +117,8 @@ void AddonsManager::init(const XMLNode *xml,
         Log::info("addons", "Downloading updated addons.xml.");
         Online::HTTPRequest *download_request = new Online::HTTPRequest("addons.xml");
         download_request->setURL(addon_list_url);
+        // Avoid downloading the whole list again if it was not changed.
+        download_request->setConditionalDownload(UserConfigParams::m_addons_etag);
         download_request->executeNow();
         if(download_request->hadDownloadError())
         {
@@ -125,6 +127,10 @@ void AddonsManager::init(const XMLNode *xml,
             delete download_request;
             return;
         }
+        if(download_request->wasNotModified())
+            Log::info("addons", "Cached addons.xml is up to date.");
+        else
+            UserConfigParams::m_addons_etag = download_request->getETag();
         delete download_request;
         UserConfigParams::m_addons_last_updated=StkTime::getTimeSinceEpoch();
     }
@@ -458,13 +464,15 @@ bool AddonsManager::anyAddonsInstalled() const
 }   // anyAddonsInstalled
 
 // ----------------------------------------------------------------------------
-/** Installs or updates (i.e. = install on top of an existing installation) an
- *  addon. It checks for the directories and then unzips the file (which must
- *  already have been downloaded).
- *  \param addon Addon data for the addon to install.
- *  \return true if installation was successful.
+/** Unzips the (already downloaded) zip file of an addon into its data
+ *  directory and removes the zip file. This only accesses the file system,
+ *  so it can be called from a separate thread (e.g. the request manager
+ *  thread after downloading the addon), which avoids freezing the GUI while
+ *  a big addon is extracted.
+ *  \param addon Addon data for the addon to extract.
+ *  \return true if the addon was extracted successfully.
  */
-bool AddonsManager::install(const Addon &addon)
+bool AddonsManager::extract(const Addon &addon)
 {
     file_manager->checkAndCreateDirForAddons(addon.getDataDir());
 
@@ -488,6 +496,22 @@ bool AddonsManager::install(const Addon &addon)
         Log::error("addons", "Problems removing temporary file '%s'.",
                     from.c_str());
     }
+    return true;
+}   // extract
+
+// ----------------------------------------------------------------------------
+/** Installs or updates (i.e. = install on top of an existing installation) an
+ *  addon. It checks for the directories and then unzips the file (which must
+ *  already have been downloaded), unless this was already done by calling
+ *  extract(). Then only the data of this addon is (re)loaded.
+ *  \param addon Addon data for the addon to install.
+ *  \param is_extracted True if extract() was already called for this addon.
+ *  \return true if installation was successful.
+ */
+bool AddonsManager::install(const Addon &addon, bool is_extracted)
+{
+    if (!is_extracted && !extract(addon))
+        return false;
 
     int index = getAddonIndex(addon.getId());
     assert(index>=0 && index < (int)m_addons_list.getData().size());
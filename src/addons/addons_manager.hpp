@@ -63,7 +63,8 @@ public:
     void         checkInstalledAddons();
     const Addon* getAddon(const std::string &id) const;
     int          getAddonIndex(const std::string &id) const;
-    bool         install(const Addon &addon);
+    bool         extract(const Addon &addon);
+    bool         install(const Addon &addon, bool is_extracted=false);
     bool         uninstall(const Addon &addon);
     void         reInit();
     bool         anyAddonsInstalled() const;
@@ -88,8 +88,44 @@ Ipo::IpoData::IpoData(const XMLNode &curve, float fps, bool reverse)
     else
         readIPO(curve, fps, reverse);
 
+    computeSegments();
 }   // IpoData
 
+// ----------------------------------------------------------------------------
+/** Precomputes the data that is constant for each segment between two
+ *  control points, so that get() only has to do a few multiply-adds.
+ */
+void Ipo::IpoData::computeSegments()
+{
+    m_times.resize(m_points.size());
+    m_inv_durations.resize(m_points.size(), 0.0f);
+    for(unsigned int i=0; i<m_points.size(); i++)
+    {
+        m_times[i] = m_points[i].getW();
+        if(i==0) continue;
+        // Two control points at the same time would divide by zero. Such
+        // a segment is never used for interpolation, since findSegment()
+        // always moves to the later point.
+        float duration = m_times[i] - m_times[i-1];
+        m_inv_durations[i-1] = duration > 0 ? 1.0f/duration : 0.0f;
+    }
+
+    if(m_interpolation!=IP_BEZIER)
+        return;
+    // Only single channel IPOs can be bezier curves (3d curves are
+    // approximated by linear segments), so only index 0 is needed.
+    m_bezier_coefficients.resize(m_points.size());
+    for(unsigned int i=0; i+1<m_points.size(); i++)
+    {
+        float p0 = m_points[i][0], p1 = m_handle2[i][0];
+        float p2 = m_handle1[i+1][0], p3 = m_points[i+1][0];
+        float c = 3.0f*(p1-p0);
+        float b = 3.0f*(p2-p1)-c;
+        float a = p3 - p0 - c - b;
+        m_bezier_coefficients[i] = Vec3(a, b, c, p0);
+    }
+}   // computeSegments
+
 // ----------------------------------------------------------------------------
 /** Reads a blender IPO curve, which constists of a frame number and a control
  *  point. This only handles a single axis.
@@ -286,7 +322,7 @@ float Ipo::IpoData::approximateLength(float t0, float t1,
  *  end time directly.
  *  \param time The time to adjust.
  */
-float Ipo::IpoData::adjustTime(float time)
+float Ipo::IpoData::adjustTime(float time) const
 {
     if(time<m_start_time)
     {
@@ -319,29 +355,30 @@ float Ipo::IpoData::adjustTime(float time)
 }   // adjustTime
 
 // ----------------------------------------------------------------------------
-float Ipo::IpoData::get(float time, unsigned int index, unsigned int n)
+/** Interpolates the value of one axis in the segment starting with control
+ *  point n. The time must already be adjusted.
+ *  \param time The time for which to interpolate.
+ *  \param index Which axis to interpolate.
+ *  \param n Index of the first control point of the segment.
+ */
+float Ipo::IpoData::get(float time, unsigned int index, unsigned int n) const
 {
+    if(n+1>=m_points.size())
+        return m_points[n][index];
+
     switch(m_interpolation)
     {
     case IP_CONST  : return m_points[n][index];
     case IP_LINEAR : {
-                        float t = time-m_points[n].getW();
+                        float t = (time-m_times[n])*m_inv_durations[n];
                         return m_points[n][index]
-                             + t*(m_points[n+1][index]-m_points[n][index]) /
-                                 (m_points[n+1].getW()-m_points[n].getW());
+                             + t*(m_points[n+1][index]-m_points[n][index]);
                      }
-    case IP_BEZIER:  {  if(n==m_points.size()-1)
-                        {
-                            // FIXME: only const implemented atm.
-                            return m_points[n][index];
-                        }
-                        float t = (time-m_points[n].getW())
-                                / (m_points[n+1].getW()-m_points[n].getW());
-                        return getCubicBezier(t,
-                                              m_points [n  ][index],
-                                              m_handle2[n  ][index],
-                                              m_handle1[n+1][index],
-                                              m_points [n+1][index]);
+    case IP_BEZIER:  {
+                        assert(index==0);
+                        float t = (time-m_times[n])*m_inv_durations[n];
+                        const Vec3 &c = m_bezier_coefficients[n];
+                        return ((c.getX()*t+c.getY())*t+c.getZ())*t+c.getW();
                     }
     }   // switch
     // Keep the compiler happy:
@@ -445,23 +482,28 @@ void Ipo::reset()
 void Ipo::update(float time, Vec3 *xyz, Vec3 *hpr,Vec3 *scale)
 {
     assert(!isnan(time));
+    // The time adjustment and segment search are done only once for all
+    // values computed by this ipo.
+    time = m_ipo_data->adjustTime(time);
+    const unsigned int n = findSegment(time);
+    const IpoData *data = m_ipo_data;
     switch(m_ipo_data->m_channel)
     {
-    case Ipo::IPO_LOCX   : if(xyz)   xyz  ->setX(get(time, 0)); break;
-    case Ipo::IPO_LOCY   : if(xyz)   xyz  ->setY(get(time, 0)); break;
-    case Ipo::IPO_LOCZ   : if(xyz)   xyz  ->setZ(get(time, 0)); break;
-    case Ipo::IPO_ROTX   : if(hpr)   hpr  ->setX(get(time, 0)); break;
-    case Ipo::IPO_ROTY   : if(hpr)   hpr  ->setY(get(time, 0)); break;
-    case Ipo::IPO_ROTZ   : if(hpr)   hpr  ->setZ(get(time, 0)); break;
-    case Ipo::IPO_SCALEX : if(scale) scale->setX(get(time, 0)); break;
-    case Ipo::IPO_SCALEY : if(scale) scale->setY(get(time, 0)); break;
-    case Ipo::IPO_SCALEZ : if(scale) scale->setZ(get(time, 0)); break;
+    case Ipo::IPO_LOCX   : if(xyz)   xyz  ->setX(data->get(time, 0, n)); break;
+    case Ipo::IPO_LOCY   : if(xyz)   xyz  ->setY(data->get(time, 0, n)); break;
+    case Ipo::IPO_LOCZ   : if(xyz)   xyz  ->setZ(data->get(time, 0, n)); break;
+    case Ipo::IPO_ROTX   : if(hpr)   hpr  ->setX(data->get(time, 0, n)); break;
+    case Ipo::IPO_ROTY   : if(hpr)   hpr  ->setY(data->get(time, 0, n)); break;
+    case Ipo::IPO_ROTZ   : if(hpr)   hpr  ->setZ(data->get(time, 0, n)); break;
+    case Ipo::IPO_SCALEX : if(scale) scale->setX(data->get(time, 0, n)); break;
+    case Ipo::IPO_SCALEY : if(scale) scale->setY(data->get(time, 0, n)); break;
+    case Ipo::IPO_SCALEZ : if(scale) scale->setZ(data->get(time, 0, n)); break;
     case Ipo::IPO_LOCXYZ :
         {
             if(xyz)
             {
                 for(unsigned int j=0; j<3; j++)
-                    (*xyz)[j] = get(time, j);
+                    (*xyz)[j] = data->get(time, j, n);
             }
             break;
         }
@@ -471,6 +513,33 @@ void Ipo::update(float time, Vec3 *xyz, Vec3 *hpr,Vec3 *scale)
 
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Returns the index of the control point at which the segment containing
+ *  the given time starts. The search starts at the segment used in the
+ *  previous call, so for an animation that moves forward in time this is
+ *  O(1) amortised. If the time moved backwards (e.g. a cyclic animation
+ *  starting its next cycle), a binary search is used.
+ *  \param time The (already adjusted) time.
+ */
+unsigned int Ipo::findSegment(float time) const
+{
+    const std::vector<float> &times = m_ipo_data->m_times;
+    if(times.size()<2)
+        return 0;
+
+    if(time < times[m_next_n-1])
+    {
+        std::vector<float>::const_iterator i =
+            std::upper_bound(times.begin()+1, times.begin()+m_next_n, time);
+        m_next_n = (unsigned int)(i-times.begin());
+    }
+    // Search for the first point in the (sorted) array which is greater
+    // than the current time.
+    while(m_next_n<times.size()-1 && time>=times[m_next_n])
+        m_next_n++;
+    return m_next_n-1;
+}   // findSegment
+
 // ----------------------------------------------------------------------------
 /** Returns the interpolated value at the current time (which this objects
  *  keeps track of).
@@ -480,22 +549,8 @@ float Ipo::get(float time, unsigned int index) const
 {
     assert(!isnan(time));
 
-    // Avoid crash in case that only one point is given for this IPO.
-    if(m_next_n==0)
-        return m_ipo_data->m_points[0][index];
-
     time = m_ipo_data->adjustTime(time);
-
-    // Time was reset since the last cached value for n,
-    // reset n to start from the beginning again.
-    if(time < m_ipo_data->m_points[m_next_n-1].getW())
-        m_next_n = 1;
-    // Search for the first point in the (sorted) array which is greater or equal
-    // to the current time.
-    while(m_next_n<m_ipo_data->m_points.size()-1 &&
-         time >=m_ipo_data->m_points[m_next_n].getW())
-        m_next_n++;
-    float rval = m_ipo_data->get(time, index, m_next_n-1);
+    float rval = m_ipo_data->get(time, index, findSegment(time));
     assert(!isnan(rval));
     return rval;
 }   // get
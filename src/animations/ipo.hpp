@@ -67,6 +67,19 @@ private:
         /** Only used for bezier curves: the two handles. */
         std::vector<Vec3>  m_handle1, m_handle2;
 
+        /** The time of each control point. This is a copy of the W
+         *  components of m_points, so that searching the segment for a
+         *  given time only touches one small contiguous array. */
+        std::vector<float> m_times;
+
+        /** 1/duration of each segment, to avoid a division per update. */
+        std::vector<float> m_inv_durations;
+
+        /** Only used for bezier IPOs: the coefficients a, b, c and p0 of
+         *  the cubic polynomial of each segment (stored in x, y, z and w),
+         *  so that a value can be computed with three multiply-adds. */
+        std::vector<Vec3>  m_bezier_coefficients;
+
         /** Time of the first control point. */
         float m_start_time;
 
@@ -85,6 +98,7 @@ private:
                                  const Vec3 &p0, const Vec3 &p1,
                                  const Vec3 &h0, const Vec3 &h2,
                                  unsigned int rec_level = 0);
+          void computeSegments();
     public:
                IpoData(const XMLNode &curve, float fps, bool reverse);
         void   readCurve(const XMLNode &node, bool reverse);
@@ -92,8 +106,8 @@ private:
         float  approximateLength(float t0, float t1,
                                  const Vec3 &p0, const Vec3 &p1,
                                  const Vec3 &h1, const Vec3 &h2);
-        float  adjustTime(float time);
-        float  get(float time, unsigned int index, unsigned int n);
+        float  adjustTime(float time) const;
+        float  get(float time, unsigned int index, unsigned int n) const;
 
     };   // IpoData
     // ------------------------------------------------------------------------
@@ -114,6 +128,7 @@ private:
     mutable unsigned int m_next_n;
 
     Ipo(const Ipo *ipo);
+    unsigned int findSegment(float time) const;
 public:
              Ipo(const XMLNode &curve, float fps=25, bool reverse=false);
     virtual ~Ipo();
@@ -61,6 +61,11 @@ public:
     virtual void       onSoundEnabledBack()             {}
     virtual void       setRolloff(float rolloff)        {}
     virtual const SFXBuffer* getBuffer() const          { return NULL; }
+    virtual float      getAudibility()                  { return -1.0f; }
+    virtual bool       hasSource() const                { return false; }
+    virtual void       setSource(unsigned int source)   {}
+    virtual unsigned int releaseSource()                { return 0; }
+    virtual void       updateDistanceMuting()           {}
 
 };   // DummySFX
 
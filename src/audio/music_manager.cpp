@@ -36,6 +36,7 @@
 #include "audio/sfx_openal.hpp"
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
+#include "modes/profile_world.hpp"
 #include "utils/string_utils.hpp"
 
 MusicManager* music_manager= NULL;
@@ -57,10 +58,14 @@ MusicManager::MusicManager()
     {
 #endif
 
-    ALCdevice* device = alcOpenDevice ( NULL ); //The default sound device
+    // Nothing is heard without graphics (server, bot clients), so no sound
+    // device is opened then
+    ALCdevice* device = ProfileWorld::isNoGraphics()
+                      ? NULL : alcOpenDevice ( NULL ); //The default sound device
     if( device == NULL )
     {
-        Log::warn("MusicManager", "Could not open the default sound device.");
+        if (!ProfileWorld::isNoGraphics())
+            Log::warn("MusicManager", "Could not open the default sound device.");
         m_initialized = false;
     }
     else
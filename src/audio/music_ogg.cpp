@@ -35,8 +35,10 @@
 MusicOggStream::MusicOggStream()
 {
     //m_oggStream= NULL;
-    m_soundBuffers[0] = m_soundBuffers[1]= 0;
+    for (int i = 0; i < m_num_buffers; i++)
+        m_soundBuffers[i] = 0;
     m_soundSource     = -1;
+    m_buffersQueued   = false;
     m_pausedMusic     = true;
     m_playing         = false;
 }   // MusicOggStream
@@ -111,7 +113,7 @@ bool MusicOggStream::load(const std::string& filename)
     if (m_vorbisInfo->channels == 1) nb_channels = AL_FORMAT_MONO16;
     else                             nb_channels = AL_FORMAT_STEREO16;
 
-    alGenBuffers(2, m_soundBuffers);
+    alGenBuffers(m_num_buffers, m_soundBuffers);
     if (check("alGenBuffers") == false) return false;
 
     alGenSources(1, &m_soundSource);
@@ -125,9 +127,39 @@ bool MusicOggStream::load(const std::string& filename)
     alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE      );
 
     m_error=false;
+
+    // Decode the beginning now, so that starting the music later (e.g.
+    // switching to the last lap music) does not need to read the file.
+    fillBuffers();
     return true;
 }   // load
 
+//-----------------------------------------------------------------------------
+/** Decodes data into all buffers and queues them on the source, without
+ *  starting to play.
+ */
+bool MusicOggStream::fillBuffers()
+{
+    if (m_buffersQueued)
+        return true;
+
+    for (int i = 0; i < m_num_buffers; i++)
+    {
+        if (!streamIntoBuffer(m_soundBuffers[i]))
+        {
+            // Very short music, start again at the beginning
+            ov_time_seek(&m_oggStream, 0);
+            if (!streamIntoBuffer(m_soundBuffers[i]))
+                return false;
+        }
+    }
+
+    alSourceQueueBuffers(m_soundSource, m_num_buffers, m_soundBuffers);
+    if (!check("alSourceQueueBuffers")) return false;
+    m_buffersQueued = true;
+    return true;
+}   // fillBuffers
+
 //-----------------------------------------------------------------------------
 bool MusicOggStream::empty()
 {
@@ -158,9 +190,10 @@ bool MusicOggStream::release()
     m_fileName= "";
 
     empty();
+    m_buffersQueued = false;
     alDeleteSources(1, &m_soundSource);
     check("alDeleteSources");
-    alDeleteBuffers(2, m_soundBuffers);
+    alDeleteBuffers(m_num_buffers, m_soundBuffers);
     check("alDeleteBuffers");
 
     // Handle error correctly
@@ -178,15 +211,12 @@ bool MusicOggStream::playMusic()
     if(isPlaying())
         return true;
 
-    if(!streamIntoBuffer(m_soundBuffers[0]))
-        return false;
-
-    if(!streamIntoBuffer(m_soundBuffers[1]))
+    // Normally the buffers were already filled when loading the music.
+    if(!fillBuffers())
         return false;
 
-    alSourceQueueBuffers(m_soundSource, 2, m_soundBuffers);
-
     alSourcePlay(m_soundSource);
+    m_buffersQueued = false;
     m_pausedMusic = false;
     m_playing = true;
     check("playMusic");
@@ -69,6 +69,7 @@ protected:
 
 private:
     bool release();
+    bool fillBuffers();
     bool streamIntoBuffer(ALuint buffer);
 
     std::string     m_fileName;
@@ -79,13 +80,19 @@ private:
 
     bool            m_playing;
 
-    ALuint m_soundBuffers[2];
+    //number of buffers decoded ahead, see m_buffer_size
+    static const int m_num_buffers = 4;
+
+    ALuint m_soundBuffers[m_num_buffers];
     ALuint m_soundSource;
     ALenum nb_channels;
 
     bool m_pausedMusic;
 
-    //one full second of audio at 44100 samples per second
+    //true if all buffers are filled and queued, but not played yet
+    bool m_buffersQueued;
+
+    //a quarter second of 16 bit stereo audio at 44100 samples per second
     static const int m_buffer_size = 11025*4;
 };
 
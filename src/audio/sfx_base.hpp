@@ -22,6 +22,7 @@
 
 #include "audio/sfx_manager.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/slot_map.hpp"
 
 /**
  * \defgroup audio
@@ -41,6 +42,11 @@ class Vec3;
  */
 class SFXBase : public NoCopy
 {
+private:
+    /** Handle of this sfx in the list of all sfx of the SFXManager, so that
+     *  it can be removed from that list in constant time. */
+    SlotHandle m_sfx_handle;
+
 public:
     /** Status of a sound effect. */
     enum SFXStatus
@@ -79,6 +85,23 @@ public:
     virtual const SFXBuffer* getBuffer() const              = 0;
     virtual SFXStatus  getStatus()                          = 0;
 
+    /** Virtual voices: only the most audible sfx are bound to one of the
+     *  limited number of (openal) sources, see SFXManager::updateVoices(). */
+    virtual float      getAudibility()                      = 0;
+    virtual bool       hasSource() const                    = 0;
+    virtual void       setSource(unsigned int source)       = 0;
+    virtual unsigned int releaseSource()                    = 0;
+    /** Mutes or unmutes a positional sfx with a source if the listener
+     *  moved out of or into its range. */
+    virtual void       updateDistanceMuting()               = 0;
+
+    // ------------------------------------------------------------------------
+    /** Sets the handle of this sfx in the list of all sfx. */
+    void setSFXHandle(const SlotHandle &handle) { m_sfx_handle = handle; }
+    // ------------------------------------------------------------------------
+    /** Returns the handle of this sfx in the list of all sfx. */
+    const SlotHandle &getSFXHandle() const { return m_sfx_handle; }
+
 };   // SFXBase
 
 
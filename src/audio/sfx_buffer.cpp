@@ -56,6 +56,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_max_dist    = max_dist;
     m_duration    = -1.0f;
     m_file        = file;
+    m_size        = 0;
+    m_use_count   = 0;
+    m_last_used   = 0;
 
     m_rolloff     = rolloff;
     m_positional  = positional;
@@ -78,6 +81,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_positional  = false;
     m_loaded      = false;
     m_file        = file;
+    m_size        = 0;
+    m_use_count   = 0;
+    m_last_used   = 0;
 
     node->get("rolloff",     &m_rolloff    );
     node->get("positional",  &m_positional );
@@ -138,6 +144,7 @@ void SFXBuffer::unload()
     }
 #endif
     m_loaded = false;
+    m_size   = 0;
 }   // unload
 
 //----------------------------------------------------------------------------
@@ -205,6 +212,7 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
     alBufferData(buffer, (info->channels == 1) ? AL_FORMAT_MONO16
                  : AL_FORMAT_STEREO16,
                  data, len, info->rate);
+    m_size  = (unsigned int)len;
     success = true;
 
     free(data);
@@ -33,6 +33,7 @@ typedef unsigned int ALuint;
 #include "utils/vec3.hpp"
 #include "utils/leak_check.hpp"
 
+#include <assert.h>
 #include <string>
 
 class SFXBase;
@@ -72,6 +73,16 @@ private:
     /** Duration of the sfx. */
     float    m_duration;
 
+    /** Size of the decoded data in bytes (0 if not loaded). */
+    unsigned int m_size;
+
+    /** Number of openal sources this buffer is attached to. */
+    int      m_use_count;
+
+    /** When this buffer was last used (real time), to unload the least
+     *  recently used buffers first. */
+    double   m_last_used;
+
     bool loadVorbisBuffer(const std::string &name, ALuint buffer);
 
 public:
@@ -119,6 +130,24 @@ public:
     // ------------------------------------------------------------------------
     /** Returns how long this buffer will play. */
     float getDuration() const { return m_duration; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the decoded data in bytes. */
+    unsigned int getSize() const { return m_size; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of sources this buffer is attached to. */
+    int   getUseCount() const { return m_use_count; }
+    // ------------------------------------------------------------------------
+    /** Called when the buffer is attached to a source. */
+    void  increaseUseCount() { m_use_count++; }
+    // ------------------------------------------------------------------------
+    /** Called when the buffer is detached from a source. */
+    void  decreaseUseCount() { assert(m_use_count > 0); m_use_count--; }
+    // ------------------------------------------------------------------------
+    /** Returns when this buffer was last used. */
+    double getLastUsed() const { return m_last_used; }
+    // ------------------------------------------------------------------------
+    /** Marks this buffer as being used at the specified time. */
+    void  setLastUsed(double time) { m_last_used = time; }
 
 };   // class SFXBuffer
 
@@ -24,6 +24,8 @@
 #include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/profiler.hpp"
 
 #include <pthread.h>
 #include <stdexcept>
@@ -80,9 +82,17 @@ SFXManager::SFXManager()
     m_listener_position.getData() = Vec3(0, 0, 0);
     m_listener_front              = Vec3(0, 0, 1);
     m_listener_up                 = Vec3(0, 1, 0);
+    m_loaded_bytes                = 0;
 
     loadSfx();
 
+    // Enough space for a usual frame, see queueCommand().
+    m_sfx_commands.getData().resize(256);
+    m_first_command = 0;
+    m_num_commands  = 0;
+    m_num_sources   = 0;
+    m_max_sources   = std::max((int)UserConfigParams::m_max_sound_sources, 1);
+
     pthread_cond_init(&m_cond_request, NULL);
 
     pthread_attr_t  attr;
@@ -109,9 +119,6 @@ SFXManager::SFXManager()
     pthread_attr_destroy(&attr);
 
     setMasterSFXVolume( UserConfigParams::m_sfx_volume );
-    m_sfx_commands.lock();
-    m_sfx_commands.getData().clear();
-    m_sfx_commands.unlock();
 
 }  // SoundManager
 
@@ -150,6 +157,18 @@ SFXManager::~SFXManager()
     m_quick_sounds.getData().clear();
     m_quick_sounds.unlock();
 
+#if HAVE_OGGVORBIS
+    // ---- clear m_free_sources (all sfx have returned their sources now)
+    m_free_sources.lock();
+    if (m_free_sources.getData().size() > 0)
+    {
+        alDeleteSources((ALsizei)m_free_sources.getData().size(),
+                        &m_free_sources.getData()[0]);
+    }
+    m_free_sources.getData().clear();
+    m_free_sources.unlock();
+#endif
+
     // ---- clear m_all_sfx_types
     {
         std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
@@ -174,8 +193,7 @@ SFXManager::~SFXManager()
  */
 void SFXManager::queue(SFXCommands command,  SFXBase *sfx)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, sfx);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx));
 }   // queue
 
 //----------------------------------------------------------------------------
@@ -188,8 +206,7 @@ void SFXManager::queue(SFXCommands command,  SFXBase *sfx)
  */
 void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, sfx, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, f));
 }   // queue(float)
 
 //----------------------------------------------------------------------------
@@ -202,8 +219,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, float f)
  */
 void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p)
 {
-   SFXCommand *sfx_command = new SFXCommand(command, sfx, p);
-   queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, sfx, p));
 }   // queue (Vec3)
 
 //----------------------------------------------------------------------------
@@ -212,8 +228,7 @@ void SFXManager::queue(SFXCommands command, SFXBase *sfx, const Vec3 &p)
  */
 void SFXManager::queue(SFXCommands command, MusicInformation *mi)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, mi);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi));
 }   // queue(MusicInformation)
 //----------------------------------------------------------------------------
 /** Queues a command for the music manager that takes a floating point value
@@ -223,38 +238,90 @@ void SFXManager::queue(SFXCommands command, MusicInformation *mi)
  */
 void SFXManager::queue(SFXCommands command, MusicInformation *mi, float f)
 {
-    SFXCommand *sfx_command = new SFXCommand(command, mi, f);
-    queueCommand(sfx_command);
+    queueCommand(SFXCommand(command, mi, f));
 }   // queue(MusicInformation)
 
+//----------------------------------------------------------------------------
+/** Position and speed of engine sounds etc. are updated every frame. If
+ *  such a command for the same sfx is still waiting in the queue (and no
+ *  other command for this sfx was queued after it), the waiting command
+ *  gets the new value instead of queueing another command.
+ *  \pre The lock of m_sfx_commands must be held.
+ *  \param command The command to queue.
+ *  \return True if the command was merged into a waiting command.
+ */
+bool SFXManager::coalesceCommand(const SFXCommand &command)
+{
+    if (command.m_command != SFX_POSITION && command.m_command != SFX_SPEED)
+        return false;
+
+    std::vector<SFXCommand> &commands = m_sfx_commands.getData();
+    const unsigned int size = (unsigned int)commands.size();
+    for (unsigned int i = m_num_commands; i > 0; i--)
+    {
+        SFXCommand &c = commands[(m_first_command + i - 1) % size];
+        if (c.m_sfx != command.m_sfx)
+            continue;
+        if (c.m_command == command.m_command)
+        {
+            c.m_parameter = command.m_parameter;
+            return true;
+        }
+        // Keep the order of position/speed changes and other commands for
+        // this sfx (e.g. play or delete).
+        if (c.m_command != SFX_POSITION && c.m_command != SFX_SPEED)
+            return false;
+    }
+    return false;
+}   // coalesceCommand
+
 //----------------------------------------------------------------------------
 /** Enqueues a command to the sfx queue threadsafe. Then signal the
  *  sfx manager to wake up.
- *  \param command Pointer to the command to queue up.
+ *  \param command The command to queue up.
  */
-void SFXManager::queueCommand(SFXCommand *command)
+void SFXManager::queueCommand(const SFXCommand &command)
 {
+    PROFILER_PUSH_CPU_MARKER("SFX queue lock", 0xFF, 0x00, 0x00);
     m_sfx_commands.lock();
+    PROFILER_POP_CPU_MARKER();
+    if (coalesceCommand(command))
+    {
+        m_sfx_commands.unlock();
+        return;
+    }
     if(World::getWorld() && 
-        m_sfx_commands.getData().size() > 20*race_manager->getNumberOfKarts()+20 &&
+        m_num_commands > 20*race_manager->getNumberOfKarts()+20 &&
         race_manager->getMinorMode() != RaceManager::MINOR_MODE_CUTSCENE)
     {
-        if(command->m_command==SFX_POSITION || command->m_command==SFX_LOOP ||
-           command->m_command==SFX_SPEED                                       )
+        if(command.m_command==SFX_POSITION || command.m_command==SFX_LOOP ||
+           command.m_command==SFX_SPEED                                       )
         {
-            delete command;
             static int count_messages = 0;
             if(count_messages < 5)
             {
                 Log::warn("SFXManager", "Throttling sfx - queue size %d",
-                         m_sfx_commands.getData().size());
+                         m_num_commands);
                 count_messages++;
             }
             m_sfx_commands.unlock();
             return;
         }   // if throttling
     }
-    m_sfx_commands.getData().push_back(command);
+
+    std::vector<SFXCommand> &commands = m_sfx_commands.getData();
+    if (m_num_commands == commands.size())
+    {
+        // The ring buffer is full, double its size. The commands are
+        // moved so that the oldest command is at index 0 again.
+        std::vector<SFXCommand> bigger(2 * commands.size());
+        for (unsigned int i = 0; i < m_num_commands; i++)
+            bigger[i] = commands[(m_first_command + i) % commands.size()];
+        commands.swap(bigger);
+        m_first_command = 0;
+    }
+    commands[(m_first_command + m_num_commands) % commands.size()] = command;
+    m_num_commands++;
     m_sfx_commands.unlock();
 }   // queueCommand
 
@@ -280,88 +347,87 @@ void* SFXManager::mainLoop(void *obj)
     SFXManager *me = (SFXManager*)obj;
 
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    profiler.setThreadName("SFX");
+    MemoryTracker::setThreadTag(MemoryTracker::TAG_AUDIO);
 
     me->m_sfx_commands.lock();
 
-    // Wait till we have an empty sfx in the queue
-    while (me->m_sfx_commands.getData().empty() ||
-           me->m_sfx_commands.getData().front()->m_command!=SFX_EXIT)
+    while (true)
     {
-        bool empty = me->m_sfx_commands.getData().empty();
-
         // Wait in cond_wait for a request to arrive. The 'while' is necessary
         // since "spurious wakeups from the pthread_cond_wait ... may occur"
         // (pthread_cond_wait man page)!
-        while (empty)
+        while (me->m_num_commands == 0)
         {
             pthread_cond_wait(&me->m_cond_request, me->m_sfx_commands.getMutex());
-            empty = me->m_sfx_commands.getData().empty();
         }
-        SFXCommand *current = me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
-
-        if (current->m_command == SFX_EXIT)
-        {
-            delete current;
+        // Copy the command, so the queue can be modified while the command
+        // is executed.
+        std::vector<SFXCommand> &commands = me->m_sfx_commands.getData();
+        const SFXCommand current = commands[me->m_first_command];
+        me->m_first_command = (me->m_first_command + 1) % commands.size();
+        me->m_num_commands--;
+
+        if (current.m_command == SFX_EXIT)
             break;
-        }
         me->m_sfx_commands.unlock();
-        switch (current->m_command)
+        PROFILER_PUSH_CPU_MARKER("SFX command", 0x7F, 0x7F, 0x00);
+        switch (current.m_command)
         {
-        case SFX_PLAY:     current->m_sfx->reallyPlayNow();       break;
-        case SFX_STOP:     current->m_sfx->reallyStopNow();       break;
-        case SFX_PAUSE:    current->m_sfx->reallyPauseNow();      break;
-        case SFX_RESUME:   current->m_sfx->reallyResumeNow();     break;
-        case SFX_SPEED:    current->m_sfx->reallySetSpeed(
-            current->m_parameter.getX());   break;
-        case SFX_POSITION: current->m_sfx->reallySetPosition(
-            current->m_parameter);   break;
-        case SFX_VOLUME:   current->m_sfx->reallySetVolume(
-            current->m_parameter.getX());   break;
+        case SFX_PLAY:     current.m_sfx->reallyPlayNow();       break;
+        case SFX_STOP:     current.m_sfx->reallyStopNow();       break;
+        case SFX_PAUSE:    current.m_sfx->reallyPauseNow();      break;
+        case SFX_RESUME:   current.m_sfx->reallyResumeNow();     break;
+        case SFX_SPEED:    current.m_sfx->reallySetSpeed(
+            current.m_parameter.getX());   break;
+        case SFX_POSITION: current.m_sfx->reallySetPosition(
+            current.m_parameter);   break;
+        case SFX_VOLUME:   current.m_sfx->reallySetVolume(
+            current.m_parameter.getX());   break;
         case SFX_MASTER_VOLUME:
-            current->m_sfx->reallySetMasterVolumeNow(
-                current->m_parameter.getX());   break;
-        case SFX_LOOP:     current->m_sfx->reallySetLoop(
-            current->m_parameter.getX() != 0);   break;
-        case SFX_DELETE:     me->deleteSFX(current->m_sfx);       break;
+            current.m_sfx->reallySetMasterVolumeNow(
+                current.m_parameter.getX());   break;
+        case SFX_LOOP:     current.m_sfx->reallySetLoop(
+            current.m_parameter.getX() != 0);   break;
+        case SFX_DELETE:     me->deleteSFX(current.m_sfx);       break;
         case SFX_PAUSE_ALL:  me->reallyPauseAllNow();             break;
         case SFX_RESUME_ALL: me->reallyResumeAllNow();            break;
         case SFX_LISTENER:   me->reallyPositionListenerNow();     break;
         case SFX_UPDATE:     me->reallyUpdateNow(current);        break;
+        case SFX_LOAD_BUFFER: me->loadBuffer(current.m_buffer);   break;
         case SFX_MUSIC_START:
         {
-            current->m_music_information->setDefaultVolume();
-            current->m_music_information->startMusic();           break;
+            current.m_music_information->setDefaultVolume();
+            current.m_music_information->startMusic();           break;
         }
         case SFX_MUSIC_STOP:
-            current->m_music_information->stopMusic();            break;
+            current.m_music_information->stopMusic();            break;
         case SFX_MUSIC_PAUSE:
-            current->m_music_information->pauseMusic();           break;
+            current.m_music_information->pauseMusic();           break;
         case SFX_MUSIC_RESUME:
-            current->m_music_information->resumeMusic();
+            current.m_music_information->resumeMusic();
             // This might be necessasary if the volume was changed
             // in the in-game menu
-            current->m_music_information->setDefaultVolume();     break;
+            current.m_music_information->setDefaultVolume();     break;
         case SFX_MUSIC_SWITCH_FAST:
-            current->m_music_information->switchToFastMusic();    break;
+            current.m_music_information->switchToFastMusic();    break;
         case SFX_MUSIC_SET_TMP_VOLUME:
         {
-            MusicInformation *mi = current->m_music_information;
-            mi->setTemporaryVolume(current->m_parameter.getX());  break;
+            MusicInformation *mi = current.m_music_information;
+            mi->setTemporaryVolume(current.m_parameter.getX());  break;
         }
         case SFX_MUSIC_WAITING:
-               current->m_music_information->setMusicWaiting();   break;
+               current.m_music_information->setMusicWaiting();   break;
         case SFX_MUSIC_DEFAULT_VOLUME:
         {
-            current->m_music_information->setDefaultVolume();
+            current.m_music_information->setDefaultVolume();
         }
         default: assert("Not yet supported.");
         }
-        delete current;
-        current = NULL;
+        PROFILER_POP_CPU_MARKER();
         // We access the size without lock, doesn't matter if we
         // should get an incorrect value because of concurrent read/writes
-        if (me->m_sfx_commands.getData().size() == 0)
+        if (me->m_num_commands == 0)
         {
             // Wait some time to let other threads run, then queue an
             // update event to keep music playing.
@@ -370,7 +436,9 @@ void* SFXManager::mainLoop(void *obj)
             t = StkTime::getRealTime() - t;
             me->queue(SFX_UPDATE, (SFXBase*)NULL, float(t));
         }
+        PROFILER_PUSH_CPU_MARKER("SFX wait for lock", 0xFF, 0x00, 0x00);
         me->m_sfx_commands.lock();
+        PROFILER_POP_CPU_MARKER();
 
     }   // while
 
@@ -379,12 +447,8 @@ void* SFXManager::mainLoop(void *obj)
     // need to keep the user waiting for STK to exit.
     me->setCanBeDeleted();
 
-    // Clean up memory to avoid leak detection
-    while(!me->m_sfx_commands.getData().empty())
-    {
-        delete me->m_sfx_commands.getData().front();
-        me->m_sfx_commands.getData().erase(me->m_sfx_commands.getData().begin());
-    }
+    me->m_num_commands = 0;
+    me->m_sfx_commands.unlock();
     return NULL;
 }   // mainLoop
 
@@ -395,16 +459,9 @@ void* SFXManager::mainLoop(void *obj)
  */
 void SFXManager::toggleSound(const bool on)
 {
-    // When activating SFX, load all buffers
+    // Buffers are loaded by the sfx thread when they are needed.
     if (on)
     {
-        std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
-        for (; i != m_all_sfx_types.end(); i++)
-        {
-            SFXBuffer* buffer = (*i).second;
-            buffer->load();
-        }
-
         reallyResumeAllNow();
         m_all_sfx.lock();
         const int sfx_amount = (int)m_all_sfx.getData().size();
@@ -476,26 +533,7 @@ void SFXManager::loadSfx()
     }// nend for
 
     delete root;
-
-    // Now load them in parallel
-    const int max = m_all_sfx_types.size();
-    SFXBuffer **array = new SFXBuffer *[max];
-    i = 0;
-
-    for (std::map<std::string, SFXBuffer*>::iterator it = m_all_sfx_types.begin();
-         it != m_all_sfx_types.end(); it++)
-    {
-        SFXBuffer* const buffer = (*it).second;
-        array[i++] = buffer;
-    }
-
-    #pragma omp parallel for private(i)
-    for (i = 0; i < max; i++)
-    {
-        array[i]->load();
-    }
-
-    delete [] array;
+    // The buffers are only loaded when they are first used, see loadBuffer().
 }   // loadSfx
 
 // -----------------------------------------------------------------------------
@@ -505,7 +543,9 @@ void SFXManager::loadSfx()
  *  enumeration for each effect, for each kart.
  *  \param sfx_name
  *  \param sfxFile must be an absolute pathname
- *  \return        whether loading this sound effect was successful
+ *  \param load    If the buffer should be decoded (in the sfx thread) before
+ *                 it is used the first time.
+ *  \return        The buffer, or NULL if sfx are not initialised.
 
 */
 SFXBuffer* SFXManager::addSingleSfx(const std::string &sfx_name,
@@ -529,12 +569,11 @@ SFXBuffer* SFXManager::addSingleSfx(const std::string &sfx_name,
         return NULL;
     }
 
-    if (UserConfigParams::logMisc())
-        Log::debug("SFXManager", "Loading SFX %s", sfx_file.c_str());
-
-    if (load && buffer->load()) return buffer;
+    // Decode the buffer in the sfx thread before it is used the first time.
+    if (load && sfxAllowed())
+        queueCommand(SFXCommand(SFX_LOAD_BUFFER, buffer));
 
-    return NULL;
+    return buffer;
 } // addSingleSFX
 
 //----------------------------------------------------------------------------
@@ -608,10 +647,15 @@ SFXBase* SFXManager::createSoundSource(SFXBuffer* buffer,
 
     sfx->setMasterVolume(m_master_gain);
 
+    // Sound sources are usually created while loading a race, so decode
+    // the buffer now in the sfx thread instead of when it is first played.
+    if (!buffer->isLoaded() && sfxAllowed())
+        queueCommand(SFXCommand(SFX_LOAD_BUFFER, buffer));
+
     if (add_to_SFX_list) 
     {
         m_all_sfx.lock();
-        m_all_sfx.getData().push_back(sfx);
+        sfx->setSFXHandle(m_all_sfx.getData().insert(sfx));
         m_all_sfx.unlock();
     }
 
@@ -682,7 +726,7 @@ void SFXManager::update()
  *  This function is executed once per frame (triggered by the audio thread).
  *  \param current The sfx command - used to get timestep information.
 */
-void SFXManager::reallyUpdateNow(SFXCommand *current)
+void SFXManager::reallyUpdateNow(const SFXCommand &current)
 {
     if (m_last_update_time < 0.0)
     {
@@ -694,12 +738,12 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
     m_last_update_time = StkTime::getRealTime();
     float dt = float(m_last_update_time - previous_update_time);
 
-    assert(current->m_command==SFX_UPDATE);
+    assert(current.m_command==SFX_UPDATE);
     if (music_manager->getCurrentMusic())
         music_manager->getCurrentMusic()->update(dt);
     m_all_sfx.lock();
-    for (std::vector<SFXBase*>::iterator i =  m_all_sfx.getData().begin();
-                                         i != m_all_sfx.getData().end(); i++)
+    for (SlotMap<SFXBase*>::iterator i =  m_all_sfx.getData().begin();
+                                      i != m_all_sfx.getData().end(); i++)
     {
         if((*i)->getStatus()==SFXBase::SFX_PLAYING)
             (*i)->updatePlayingSFX(dt);
@@ -717,8 +761,211 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
     }   // for i in m_all_sfx
     m_quick_sounds.unlock();
 
+    updateVoices();
 }   // reallyUpdateNow
 
+//----------------------------------------------------------------------------
+/** Decides which sfx are bound to an openal source. Only a limited number
+ *  of sources is used (to avoid running out of sources, and since each
+ *  source costs mixing time), so only the most audible playing sfx get a
+ *  source. All other sfx are virtual: they keep their state and play time,
+ *  and continue at the right position once they get a source again.
+ *  Executed once per frame from the sfx thread.
+ */
+void SFXManager::updateVoices()
+{
+    m_voices.clear();
+    m_all_sfx.lock();
+    for (unsigned int i = 0; i < m_all_sfx.getData().size(); i++)
+    {
+        SFXBase *sfx = m_all_sfx.getData()[i];
+        m_voices.push_back(std::make_pair(sfx->getAudibility(), sfx));
+    }
+    m_all_sfx.unlock();
+    m_quick_sounds.lock();
+    std::map<std::string, SFXBase*>::iterator q;
+    for (q = m_quick_sounds.getData().begin();
+         q != m_quick_sounds.getData().end(); q++)
+    {
+        m_voices.push_back(std::make_pair(q->second->getAudibility(),
+                                          q->second));
+    }
+    m_quick_sounds.unlock();
+
+    // Sfx are only deleted by this thread, so the pointers stay valid.
+    // Sfx that are not playing don't need a source. A small bonus for
+    // sfx that already have a source avoids switching sources between
+    // sfx that are about equally audible.
+    unsigned int num_playing = 0;
+    for (unsigned int i = 0; i < m_voices.size(); i++)
+    {
+        SFXBase *sfx = m_voices[i].second;
+        if (m_voices[i].first < 0)
+        {
+            if (sfx->hasSource())
+                freeSource(sfx->releaseSource());
+            continue;
+        }
+        if (sfx->hasSource())
+            m_voices[i].first *= 1.25f;
+        m_voices[num_playing++] = m_voices[i];
+    }
+    m_voices.resize(num_playing);
+
+    if (num_playing > m_max_sources)
+    {
+        std::nth_element(m_voices.begin(), m_voices.begin() + m_max_sources,
+                         m_voices.end(),
+                         std::greater<std::pair<float, SFXBase*> >());
+        for (unsigned int i = m_max_sources; i < num_playing; i++)
+        {
+            if (m_voices[i].second->hasSource())
+                freeSource(m_voices[i].second->releaseSource());
+        }
+        num_playing = m_max_sources;
+    }
+
+    for (unsigned int i = 0; i < num_playing; i++)
+    {
+        SFXBase *sfx = m_voices[i].second;
+        if (sfx->hasSource())
+        {
+            sfx->updateDistanceMuting();
+            continue;
+        }
+        unsigned int source = getFreeSource();
+        if (!source)
+            break;
+        sfx->setSource(source);
+    }
+}   // updateVoices
+
+//----------------------------------------------------------------------------
+/** Makes sure that the buffer is loaded and marks it as used. If the loaded
+ *  buffers use more memory than allowed, the least recently used buffers
+ *  are unloaded. Executed from the sfx thread.
+ *  \param buffer The buffer to load.
+ *  \return True if the buffer is loaded.
+ */
+bool SFXManager::loadBuffer(SFXBuffer *buffer)
+{
+    buffer->setLastUsed(StkTime::getRealTime());
+    if (buffer->isLoaded())
+        return true;
+
+    if (UserConfigParams::logMisc())
+        Log::debug("SFXManager", "Loading SFX %s",
+                   buffer->getFileName().c_str());
+    if (!buffer->load())
+        return false;
+
+    m_loaded_buffers.push_back(buffer);
+    m_loaded_bytes += buffer->getSize();
+    if (m_loaded_bytes > (unsigned int)UserConfigParams::m_sfx_cache_size
+                         * 1024 * 1024)
+    {
+        unloadUnusedBuffers();
+    }
+    return true;
+}   // loadBuffer
+
+//----------------------------------------------------------------------------
+/** Unloads the least recently used buffers that are not attached to a
+ *  source, until the loaded buffers fit in the memory budget again. They
+ *  will be loaded again when needed.
+ */
+void SFXManager::unloadUnusedBuffers()
+{
+    // A buffer could have been unloaded by the main thread (see
+    // deleteSFXMapping), so remove those and recompute the size.
+    m_loaded_bytes = 0;
+    for (unsigned int i = 0; i < m_loaded_buffers.size();)
+    {
+        if (!m_loaded_buffers[i]->isLoaded())
+        {
+            m_loaded_buffers[i] = m_loaded_buffers.back();
+            m_loaded_buffers.pop_back();
+            continue;
+        }
+        m_loaded_bytes += m_loaded_buffers[i]->getSize();
+        i++;
+    }
+
+    const unsigned int budget =
+        (unsigned int)UserConfigParams::m_sfx_cache_size * 1024 * 1024;
+    while (m_loaded_bytes > budget)
+    {
+        int oldest = -1;
+        for (unsigned int i = 0; i < m_loaded_buffers.size(); i++)
+        {
+            SFXBuffer *buffer = m_loaded_buffers[i];
+            if (buffer->getUseCount() > 0)
+                continue;
+            if (oldest < 0 ||
+                buffer->getLastUsed() < m_loaded_buffers[oldest]->getLastUsed())
+                oldest = i;
+        }
+        // All buffers are in use
+        if (oldest < 0)
+            return;
+
+        SFXBuffer *buffer = m_loaded_buffers[oldest];
+        m_loaded_bytes -= buffer->getSize();
+        buffer->unload();
+        m_loaded_buffers[oldest] = m_loaded_buffers.back();
+        m_loaded_buffers.pop_back();
+    }
+}   // unloadUnusedBuffers
+
+//----------------------------------------------------------------------------
+/** Returns an unused openal source, or 0 if the maximum number of sources is
+ *  in use.
+ */
+unsigned int SFXManager::getFreeSource()
+{
+    unsigned int source = 0;
+    m_free_sources.lock();
+    if (m_free_sources.getData().size() > 0)
+    {
+        source = m_free_sources.getData().back();
+        m_free_sources.getData().pop_back();
+    }
+#if HAVE_OGGVORBIS
+    else if (m_num_sources < m_max_sources)
+    {
+        ALuint new_source = 0;
+        alGenSources(1, &new_source);
+        if (checkError("generating a source") && new_source)
+        {
+            source = new_source;
+            m_num_sources++;
+        }
+        else
+        {
+            // Openal has no more sources, don't try again.
+            Log::warn("SFXManager", "Can only create %d sources.",
+                      m_num_sources);
+            m_max_sources = m_num_sources;
+        }
+    }
+#endif
+    m_free_sources.unlock();
+    return source;
+}   // getFreeSource
+
+//----------------------------------------------------------------------------
+/** Returns a source that is not used by a sfx anymore.
+ *  \param source The openal source.
+ */
+void SFXManager::freeSource(unsigned int source)
+{
+    if (!source)
+        return;
+    m_free_sources.lock();
+    m_free_sources.getData().push_back(source);
+    m_free_sources.unlock();
+}   // freeSource
+
 //----------------------------------------------------------------------------
 /** Delete a sound effect object, and removes it from the internal list of
  *  all SFXs. This call deletes the object, and removes it from the list of
@@ -728,23 +975,16 @@ void SFXManager::reallyUpdateNow(SFXCommand *current)
 void SFXManager::deleteSFX(SFXBase *sfx)
 {
     if(sfx) sfx->reallyStopNow();
-    std::vector<SFXBase*>::iterator i;
-    
-    // The whole block needs to be locked, otherwise the iterator
-    // could become invalid.
-    m_all_sfx.lock();
-    i=std::find(m_all_sfx.getData().begin(), m_all_sfx.getData().end(), sfx);
 
-    if(i==m_all_sfx.getData().end())
+    m_all_sfx.lock();
+    if(!sfx || !m_all_sfx.getData().remove(sfx->getSFXHandle()))
     {
         Log::warn("SFXManager", 
                   "SFXManager::deleteSFX : Warning: sfx '%s' %lx not found in list.",
-                  sfx->getBuffer()->getFileName().c_str(), sfx);
+                  sfx ? sfx->getBuffer()->getFileName().c_str() : "", sfx);
         m_all_sfx.unlock();
         return;
     }
-
-    m_all_sfx.getData().erase(i);
     m_all_sfx.unlock();
 
     delete sfx;
@@ -20,8 +20,8 @@
 #define HEADER_SFX_MANAGER_HPP
 
 #include "utils/can_be_deleted.hpp"
-#include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/slot_map.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
 
@@ -85,6 +85,7 @@ public:
         SFX_MUSIC_SET_TMP_VOLUME,
         SFX_MUSIC_WAITING,
         SFX_MUSIC_DEFAULT_VOLUME,
+        SFX_LOAD_BUFFER,
         SFX_EXIT,
     };   // SFXCommands
 
@@ -110,11 +111,10 @@ public:
 private:
 
     /** Data structure for the queue, which stores a sfx and the command to 
-     *  execute for it. */
-    class SFXCommand : public NoCopy
+     *  execute for it. The commands are stored by value in the queue, so
+     *  queueing a command does not allocate memory. */
+    class SFXCommand
     {
-    private:
-        LEAK_CHECK()
     public:
         /** The sound effect for which the command should be executed. */
         SFXBase *m_sfx;
@@ -122,23 +122,47 @@ private:
         /** Stores music information for music commands. */
         MusicInformation *m_music_information;
 
+        /** The buffer to load for SFX_LOAD_BUFFER. */
+        SFXBuffer *m_buffer;
+
         /** The command to execute. */
         SFXCommands m_command;
         /** Optional parameter for commands that need more input. Single
          *  floating point values are stored in the X component. */
         Vec3        m_parameter;
         // --------------------------------------------------------------------
+        SFXCommand()
+        {
+            m_command           = SFX_EXIT;
+            m_sfx               = NULL;
+            m_music_information = NULL;
+            m_buffer            = NULL;
+        }   // SFXCommand()
+        // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base)
         {
-            m_command   = command;
-            m_sfx       = base;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
+            m_buffer            = NULL;
         }   // SFXCommand()
         // --------------------------------------------------------------------
+        /** Constructor for commands for a sfx buffer. */
+        SFXCommand(SFXCommands command, SFXBuffer *buffer)
+        {
+            m_command           = command;
+            m_sfx               = NULL;
+            m_music_information = NULL;
+            m_buffer            = buffer;
+        }   // SFXCommand(SFXBuffer*)
+        // --------------------------------------------------------------------
         /** Constructor for music information commands. */
         SFXCommand(SFXCommands command, MusicInformation *mi)
         {
             m_command           = command;
+            m_sfx               = NULL;
             m_music_information = mi;
+            m_buffer            = NULL;
         }   // SFXCommnd(MusicInformation*)
         // --------------------------------------------------------------------
         /** Constructor for music information commands that take a floating
@@ -146,22 +170,28 @@ private:
         SFXCommand(SFXCommands command, MusicInformation *mi, float f)
         {
             m_command = command;
+            m_sfx     = NULL;
+            m_buffer  = NULL;
             m_parameter.setX(f);
             m_music_information = mi;
         }   // SFXCommnd(MusicInformation *, float)
         // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base, float parameter)
         {
-            m_command   = command;
-            m_sfx       = base;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
+            m_buffer            = NULL;
             m_parameter.setX(parameter);
         }   // SFXCommand(float)
         // --------------------------------------------------------------------
         SFXCommand(SFXCommands command, SFXBase *base, const Vec3 &parameter)
         {
-            m_command   = command;
-            m_sfx       = base;
-            m_parameter = parameter;
+            m_command           = command;
+            m_sfx               = base;
+            m_music_information = NULL;
+            m_buffer            = NULL;
+            m_parameter         = parameter;
         }   // SFXCommand(Vec3)
     };   // SFXCommand
     // ========================================================================
@@ -182,15 +212,48 @@ private:
     std::map<std::string, SFXBuffer*> m_all_sfx_types;
 
     /** The actual instances (sound sources) */
-    Synchronised<std::vector<SFXBase*> > m_all_sfx;
+    Synchronised<SlotMap<SFXBase*> > m_all_sfx;
+
+    /** The list of sound effects to be played in the next update. This is
+     *  a ring buffer (see m_first_command and m_num_commands), which only
+     *  grows if too many commands are queued before the sfx thread runs. */
+    Synchronised< std::vector<SFXCommand> > m_sfx_commands;
+
+    /** Index of the oldest command in m_sfx_commands. Protected by the lock
+     *  of m_sfx_commands. */
+    unsigned int              m_first_command;
 
-    /** The list of sound effects to be played in the next update. */
-    Synchronised< std::vector<SFXCommand*> > m_sfx_commands;
+    /** Number of commands in m_sfx_commands. Protected by the lock of
+     *  m_sfx_commands. */
+    unsigned int              m_num_commands;
 
     /** To play non-positional sounds without having to create a
      *  new object for each. */
     Synchronised<std::map<std::string, SFXBase*> > m_quick_sounds;
 
+    /** Openal sources that are currently not used by any sfx. The lock is
+     *  necessary since sfx are stopped from the main thread when sound is
+     *  switched off. */
+    Synchronised<std::vector<unsigned int> > m_free_sources;
+
+    /** Number of openal sources created. */
+    unsigned int              m_num_sources;
+
+    /** Maximum number of openal sources to use. This is reduced if openal
+     *  can not create more sources. */
+    unsigned int              m_max_sources;
+
+    /** List of playing sfx and their audibility, used in updateVoices().
+     *  Only a member to avoid allocations each frame. */
+    std::vector<std::pair<float, SFXBase*> > m_voices;
+
+    /** Buffers loaded by the sfx thread, which can be unloaded again if
+     *  they use too much memory. Only accessed by the sfx thread. */
+    std::vector<SFXBuffer*>   m_loaded_buffers;
+
+    /** Total size of all buffers in m_loaded_buffers. */
+    unsigned int              m_loaded_bytes;
+
     /** If the sfx manager has been initialised. */
     bool                      m_initialized;
 
@@ -211,8 +274,11 @@ private:
 
     static void* mainLoop(void *obj);
     void deleteSFX(SFXBase *sfx);
-    void queueCommand(SFXCommand *command);
+    void queueCommand(const SFXCommand &command);
+    bool coalesceCommand(const SFXCommand &command);
     void reallyPositionListenerNow();
+    void updateVoices();
+    void unloadUnusedBuffers();
 
 public:
     static void create();
@@ -256,7 +322,10 @@ public:
     void                     resumeAll();
     void                     reallyResumeAllNow();
     void                     update();
-    void                     reallyUpdateNow(SFXCommand *current);
+    void                     reallyUpdateNow(const SFXCommand &current);
+    bool                     loadBuffer(SFXBuffer *buffer);
+    unsigned int             getFreeSource();
+    void                     freeSource(unsigned int source);
     bool                     soundExist(const std::string &name);
     void                     setMasterSFXVolume(float gain);
     float                    getMasterSFXVolume() const { return m_master_gain; }
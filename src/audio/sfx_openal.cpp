@@ -33,6 +33,7 @@
 #  include <AL/al.h>
 #endif
 
+#include <algorithm>
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
@@ -52,6 +53,10 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
     m_master_gain  = 1.0f;
     m_owns_buffer  = owns_buffer;
     m_play_time    = 0.0f;
+    m_out_of_range = false;
+    m_position     = Vec3(0, 0, 0);
+    m_speed        = 1.0f;
+    m_rolloff      = buffer->getRolloff();
 
     // Don't initialise anything else if the sfx manager was not correctly
     // initialised. First of all the initialisation will not work, and it
@@ -63,14 +68,12 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
 }   // SFXOpenAL
 
 //-----------------------------------------------------------------------------
-/** Deletes the sfx source, and if it owns the buffer, also deletes the sound
- *  buffer. */
+/** Returns the source of this sfx (if any) to the sfx manager, and if it
+ *  owns the buffer, also deletes the sound buffer. */
 SFXOpenAL::~SFXOpenAL()
 {
-    if (m_status!=SFX_UNKNOWN && m_status!=SFX_NOT_INITIALISED)
-    {
-        alDeleteSources(1, &m_sound_source);
-    }
+    if (m_sound_source)
+        SFXManager::get()->freeSource(releaseSource());
 
     if (m_owns_buffer && m_sound_buffer)
     {
@@ -80,51 +83,163 @@ SFXOpenAL::~SFXOpenAL()
 }   // ~SFXOpenAL
 
 //-----------------------------------------------------------------------------
-/** Initialises the sfx. 
+/** Initialises the sfx. No openal source is allocated here, this is only
+ *  done once the sfx is played (and is audible enough).
  */
 bool SFXOpenAL::init()
 {
     m_status = SFX_UNKNOWN;
-
-    alGenSources(1, &m_sound_source );
-    if (!SFXManager::checkError("generating a source"))
+    if (!m_sound_buffer)
         return false;
+    m_status = SFX_STOPPED;
+    return true;
+}   // init
 
-    assert( alIsBuffer(m_sound_buffer->getBufferID()) );
-    assert( alIsSource(m_sound_source) );
+//-----------------------------------------------------------------------------
+/** Binds this sfx to an openal source, and sets up the source with the
+ *  current settings of this sfx. If the sfx is already playing (i.e. it was
+ *  a virtual voice before), it continues at the position it should be at.
+ *  Executed from the sfx manager thread.
+ *  \param source The openal source to use.
+ */
+void SFXOpenAL::setSource(unsigned int source)
+{
+    assert(m_sound_source == 0);
+    m_sound_source = source;
 
+    SFXManager::get()->loadBuffer(m_sound_buffer);
+    m_sound_buffer->increaseUseCount();
     alSourcei (m_sound_source, AL_BUFFER, m_sound_buffer->getBufferID());
-
-    if (!SFXManager::checkError("attaching the buffer to the source"))
-        return false;
-
-    alSource3f(m_sound_source, AL_POSITION,       0.0, 0.0, 0.0);
+    alSource3f(m_sound_source, AL_POSITION, m_position.getX(),
+               m_position.getY(), -m_position.getZ());
     alSource3f(m_sound_source, AL_VELOCITY,       0.0, 0.0, 0.0);
     alSource3f(m_sound_source, AL_DIRECTION,      0.0, 0.0, 0.0);
-
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_sound_buffer->getRolloff());
+    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR, m_rolloff);
     alSourcef (m_sound_source, AL_MAX_DISTANCE,   m_sound_buffer->getMaxDist());
+    alSourcef (m_sound_source, AL_PITCH,          m_speed);
+    alSourcei (m_sound_source, AL_SOURCE_RELATIVE,
+               m_positional ? AL_FALSE : AL_TRUE);
+    alSourcei (m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
+    applyGain();
 
-    if (m_gain < 0.0f)
+    if (m_status == SFX_PLAYING || m_status == SFX_PAUSED)
     {
-        alSourcef (m_sound_source, AL_GAIN, m_default_gain * m_master_gain);
-    }
-    else
-    {
-        alSourcef (m_sound_source, AL_GAIN, m_gain * m_master_gain);
+        float offset = m_play_time;
+        const float duration = m_sound_buffer->getDuration();
+        if (m_loop && duration > 0)
+            offset = fmodf(offset, duration);
+        if (offset > 0 && offset < duration)
+            alSourcef(m_sound_source, AL_SEC_OFFSET, offset);
+        if (m_status == SFX_PLAYING)
+            alSourcePlay(m_sound_source);
     }
+    SFXManager::checkError("binding a source");
+}   // setSource
+
+//-----------------------------------------------------------------------------
+/** Stops the source of this sfx and detaches it, so that it can be used by
+ *  another sfx. The sfx itself keeps its state (e.g. a looped sfx continues
+ *  to 'play' without a source). Executed from the sfx manager thread.
+ *  \return The source that was used.
+ */
+unsigned int SFXOpenAL::releaseSource()
+{
+    ALuint source = m_sound_source;
+    if (!source)
+        return 0;
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0);
+    SFXManager::checkError("releasing a source");
+    m_sound_buffer->decreaseUseCount();
+    m_sound_source = 0;
+    return source;
+}   // releaseSource
 
-    if (m_positional) alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_FALSE);
-    else              alSourcei (m_sound_source, AL_SOURCE_RELATIVE, AL_TRUE);
+//-----------------------------------------------------------------------------
+/** Tries to get a source from the sfx manager if this sfx does not have one.
+ *  If no source is available the sfx stays virtual, and might get a source
+ *  in a later frame (see SFXManager::updateVoices()).
+ */
+void SFXOpenAL::bindFreeSource()
+{
+    if (m_sound_source)
+        return;
+    unsigned int source = SFXManager::get()->getFreeSource();
+    if (source)
+        setSource(source);
+}   // bindFreeSource
 
-    alSourcei(m_sound_source, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
+//-----------------------------------------------------------------------------
+/** Returns how well this sfx can be heard, which is used to decide which
+ *  sfx get an openal source. It is negative for sfx that are not playing.
+ *  The estimate uses the gain and openal's (clamped) inverse distance model.
+ *  Non-positional sfx (e.g. GUI sounds) are always preferred.
+ */
+float SFXOpenAL::getAudibility()
+{
+    if (m_status != SFX_PLAYING && m_status != SFX_PAUSED)
+        return -1.0f;
+    if (!m_loop && m_play_time > m_sound_buffer->getDuration())
+        return -1.0f;
 
-    if(!SFXManager::checkError("setting up the source"))
-        return false;
+    const float gain = (m_gain < 0.0f ? m_default_gain : m_gain)
+                     * m_master_gain;
+    if (!m_positional)
+        return 1.0f + gain;
 
-    m_status = SFX_STOPPED;
-    return true;
-}   // init
+    const float distance =
+        SFXManager::get()->getListenerPos().distance(m_position);
+    if (distance > m_sound_buffer->getMaxDist())
+        return 0.0f;
+    const float d = std::max(distance - 1.0f, 0.0f);
+    return gain / (1.0f + m_rolloff * d);
+}   // getAudibility
+
+//-----------------------------------------------------------------------------
+/** Sets the gain of the source, which mutes sfx that are too far away from
+ *  the listener.
+ */
+void SFXOpenAL::applyGain()
+{
+    if (!m_sound_source)
+        return;
+    m_out_of_range = isOutOfRange();
+    if (m_out_of_range)
+    {
+        alSourcef(m_sound_source, AL_GAIN, 0);
+    }
+    else
+    {
+        alSourcef(m_sound_source, AL_GAIN,
+                  (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
+    }
+}   // applyGain
+
+// ----------------------------------------------------------------------------
+/** Returns true if this is a positional sfx and the listener is further away
+ *  than the maximum distance of the buffer. OpenAL does not mute sources
+ *  beyond their maximum distance, so this is done manually.
+ */
+bool SFXOpenAL::isOutOfRange() const
+{
+    return m_positional &&
+           SFXManager::get()->getListenerPos().distance(m_position)
+                                             > m_sound_buffer->getMaxDist();
+}   // isOutOfRange
+
+// ----------------------------------------------------------------------------
+/** Mutes or unmutes this sfx if the listener moved out of or into its range.
+ *  This is called for all sfx with a source once per frame from the sfx
+ *  manager thread, so static sound emitters don't need to set their position
+ *  each frame to update the muting. Only calls openal if the state changed.
+ */
+void SFXOpenAL::updateDistanceMuting()
+{
+    if (!m_sound_source || !m_positional)
+        return;
+    if (isOutOfRange() != m_out_of_range)
+        applyGain();
+}   // updateDistanceMuting
 
 // ------------------------------------------------------------------------
 /** Updates the status of a playing sfx. If the sound has been played long
@@ -173,6 +288,9 @@ void SFXOpenAL::reallySetSpeed(float factor)
     {
         factor = 0.5f;
     }
+    m_speed = factor;
+    if (!m_sound_source)
+        return;
     alSourcef(m_sound_source,AL_PITCH,factor);
     SFXManager::checkError("setting speed");
 }   // reallySetSpeed
@@ -205,7 +323,7 @@ void SFXOpenAL::reallySetVolume(float volume)
             return;
     }
 
-    alSourcef(m_sound_source, AL_GAIN, m_gain * m_master_gain);
+    applyGain();
 }   // reallySetVolume
 
 //-----------------------------------------------------------------------------
@@ -230,8 +348,7 @@ void SFXOpenAL::reallySetMasterVolumeNow(float volume)
     
     if(m_status==SFX_UNKNOWN || m_status == SFX_NOT_INITIALISED) return;
 
-    alSourcef(m_sound_source, AL_GAIN, 
-               (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
+    applyGain();
     SFXManager::checkError("setting volume");
 }   // reallySetMasterVolumeNow
 
@@ -259,6 +376,8 @@ void SFXOpenAL::reallySetLoop(bool status)
             return;
     }
 
+    if (!m_sound_source)
+        return;
     alSourcei(m_sound_source, AL_LOOPING, status ? AL_TRUE : AL_FALSE);
     SFXManager::checkError("looping");
 }   // reallySetLoop
@@ -281,10 +400,10 @@ void SFXOpenAL::reallyStopNow()
     {
         m_status = SFX_STOPPED;
         m_loop = false;
-        alSourcei(m_sound_source, AL_LOOPING, AL_FALSE);
-        alSourceStop(m_sound_source);
-        SFXManager::checkError("stoping");
     }
+    // Make the source available for other sfx.
+    if (m_sound_source)
+        SFXManager::get()->freeSource(releaseSource());
 }   // reallyStopNow
 
 //-----------------------------------------------------------------------------
@@ -305,6 +424,8 @@ void SFXOpenAL::reallyPauseNow()
     // from pauseAll, and we have to make sure to only pause playing sfx.
     if (m_status != SFX_PLAYING || !SFXManager::get()->sfxAllowed()) return;
     m_status = SFX_PAUSED;
+    if (!m_sound_source)
+        return;
     alSourcePause(m_sound_source);
     SFXManager::checkError("pausing");
 }   // reallyPauseNow
@@ -332,9 +453,14 @@ void SFXOpenAL::reallyResumeNow()
 
     if(m_status==SFX_PAUSED)
     {
-        alSourcePlay(m_sound_source);
-        SFXManager::checkError("resuming");
         m_status = SFX_PLAYING;
+        if (m_sound_source)
+        {
+            alSourcePlay(m_sound_source);
+            SFXManager::checkError("resuming");
+        }
+        else
+            bindFreeSource();
     }
 }   // reallyResumeNow
 
@@ -372,9 +498,16 @@ void SFXOpenAL::reallyPlayNow()
         // creation of OpenAL source failed, giving up
         if (m_status==SFX_UNKNOWN) return;
     }
+    // The duration is only known once the buffer is loaded.
+    SFXManager::get()->loadBuffer(m_sound_buffer);
 
-    alSourcePlay(m_sound_source);
-    SFXManager::checkError("playing");
+    if (m_sound_source)
+    {
+        alSourcePlay(m_sound_source);
+        SFXManager::checkError("playing");
+    }
+    else
+        bindFreeSource();
 }   // reallyPlayNow
 
 //-----------------------------------------------------------------------------
@@ -413,19 +546,13 @@ void SFXOpenAL::reallySetPosition(const Vec3 &position)
         return;
     }
 
+    m_position = position;
+    if (!m_sound_source)
+        return;
+
     alSource3f(m_sound_source, AL_POSITION, position.getX(),
                position.getY(), -position.getZ());
-
-    if (SFXManager::get()->getListenerPos().distance(position)
-        > m_sound_buffer->getMaxDist())
-    {
-        alSourcef(m_sound_source, AL_GAIN, 0);
-    }
-    else
-    {
-        alSourcef(m_sound_source, AL_GAIN, 
-                  (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
-    }
+    applyGain();
 
     SFXManager::checkError("positioning");
 }   // reallySetPosition
@@ -449,11 +576,8 @@ void SFXOpenAL::onSoundEnabledBack()
         if (m_status==SFX_NOT_INITIALISED) init();
         if (m_status!=SFX_UNKNOWN)
         {
-            alSourcef(m_sound_source, AL_GAIN, 0);
             play();
             pause();
-            alSourcef(m_sound_source, AL_GAIN,
-                     (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain);
         }
     }
 }   // onSoundEnabledBack
@@ -462,7 +586,9 @@ void SFXOpenAL::onSoundEnabledBack()
 
 void SFXOpenAL::setRolloff(float rolloff)
 {
-    alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
-}
+    m_rolloff = rolloff;
+    if (m_sound_source)
+        alSourcef (m_sound_source, AL_ROLLOFF_FACTOR,  rolloff);
+}   // setRolloff
 
 #endif //if HAVE_OGGVORBIS
@@ -29,6 +29,7 @@
 #endif
 #include "audio/sfx_base.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/vec3.hpp"
 
 /**
   * \brief OpenAL implementation of the abstract SFXBase interface
@@ -42,9 +43,20 @@ private:
     /** Buffers hold sound data. */
     SFXBuffer*   m_sound_buffer;
 
-    /** Sources are points emitting sound. */
+    /** Sources are points emitting sound. This is 0 if the sfx is
+     *  currently not bound to a source (a virtual voice), in which case
+     *  all settings are only stored in this object. */
     ALuint       m_sound_source;
 
+    /** The last position set for this sfx. */
+    Vec3         m_position;
+
+    /** The pitch of this sfx. */
+    float        m_speed;
+
+    /** The rolloff factor of this sfx. */
+    float        m_rolloff;
+
     /** The status of this SFX. */
     SFXStatus    m_status;
 
@@ -75,6 +87,14 @@ private:
     /** How long the sfx has been playing. */
     float m_play_time;
 
+    /** True if the source is muted because the listener is further away
+     *  than the maximum distance of the buffer. */
+    bool m_out_of_range;
+
+    void              applyGain();
+    bool              isOutOfRange() const;
+    void              bindFreeSource();
+
 public:
               SFXOpenAL(SFXBuffer* buffer, bool positional, float volume,
                         bool owns_buffer = false);
@@ -103,6 +123,13 @@ public:
     virtual void      reallySetMasterVolumeNow(float volue);
     virtual void      onSoundEnabledBack();
     virtual void      setRolloff(float rolloff);
+    virtual float     getAudibility();
+    virtual void      setSource(unsigned int source);
+    virtual unsigned int releaseSource();
+    virtual void      updateDistanceMuting();
+    // ------------------------------------------------------------------------
+    /** Returns if this sfx is currently bound to an openal source. */
+    virtual bool      hasSource() const { return m_sound_source != 0; }
     // ------------------------------------------------------------------------
     /** Returns if this sfx is looped or not. */
     virtual bool      isLooped() { return m_loop; }
@@ -21,6 +21,7 @@
 #include <sstream>
 
 #include "challenges/unlock_manager.hpp"
+#include "io/content_index.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
@@ -53,7 +54,9 @@ ChallengeData::ChallengeData(const std::string& filename)
 
     // we are using auto_ptr to make sure the XML node is released when leaving
     // the scope
-    std::auto_ptr<XMLNode> root(new XMLNode( filename ));
+    std::auto_ptr<XMLNode> root(ContentIndex::takeXMLTree(filename));
+    if(!root.get())
+        root.reset(new XMLNode( filename ));
 
     if(root.get() == NULL || root->getName()!="challenge")
     {
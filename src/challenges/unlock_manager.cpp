@@ -26,6 +26,7 @@
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
 #include "config/user_config.hpp"
+#include "io/content_index.hpp"
 #include "io/file_manager.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "race/race_manager.hpp"
@@ -56,12 +57,13 @@ UnlockManager::UnlockManager()
     // ----------------------------------------
     std::set<std::string> result;
     std::string challenge_dir = file_manager->getAsset(FileManager::CHALLENGE, "");
-    file_manager->listFiles(result, challenge_dir);
+    if(!ContentIndex::listFiles(&result, challenge_dir))
+        file_manager->listFiles(result, challenge_dir);
     for(std::set<std::string>::iterator i  = result.begin();
                                         i != result.end()  ; i++)
     {
         if (StringUtils::hasSuffix(*i, ".challenge"))
-            addChallenge(file_manager->getAsset("challenges/"+*i));
+            addChallenge(challenge_dir + *i);
     }   // for i
 
     // Read challenges from .../data/tracks/*
@@ -99,7 +101,8 @@ void UnlockManager::readAllChallengesInDirs(const std::vector<std::string>* all_
         dir != all_dirs->end(); dir++)
     {
         std::set<std::string> all_files;
-        file_manager->listFiles(all_files, *dir);
+        if(!ContentIndex::listFiles(&all_files, *dir))
+            file_manager->listFiles(all_files, *dir);
 
         for(std::set<std::string>::iterator file = all_files.begin();
             file != all_files.end(); file++)
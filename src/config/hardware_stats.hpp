@@ -26,6 +26,9 @@
 #include "utils/no_copy.hpp"
 #include "utils/string_utils.hpp"
 
+#include <string>
+#include <vector>
+
 namespace HardwareStats
 {
     /** A class to manage json data. */
@@ -70,6 +73,21 @@ namespace HardwareStats
             m_data += "\""+key+"\":\""+StringUtils::toString(s)+"\"";
         }   // add
         // --------------------------------------------------------------------
+        /** Adds an array of finished json objects. */
+        void addArray(const std::string &key,
+                      const std::vector<std::string> &values)
+        {
+            if(m_data.size()>1)   // more than '{'
+                m_data += ",";
+            m_data += "\""+key+"\":[";
+            for(unsigned int i=0; i<values.size(); i++)
+            {
+                if(i>0) m_data += ",";
+                m_data += values[i];
+            }
+            m_data += "]";
+        }   // addArray
+        // --------------------------------------------------------------------
         void finish()
         {
             m_data += "}";
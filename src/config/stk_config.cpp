@@ -150,6 +150,9 @@ void STKConfig::load(const std::string &filename)
     CHECK_NEG(m_replay_delta_pos2,         "replay delta-position"      );
     CHECK_NEG(m_replay_dt,                 "replay delta-t"             );
     CHECK_NEG(m_smooth_angle_limit,        "physics smooth-angle-limit" );
+    CHECK_NEG(m_physics_fps,               "physics fps"                );
+    CHECK_NEG(m_physics_substep_distance,  "physics substep-distance"   );
+    CHECK_NEG(m_physics_max_substeps,      "physics max-substeps"       );
 
     // Square distance to make distance checks cheaper (no sqrt)
     m_replay_delta_pos2 *= m_replay_delta_pos2;
@@ -171,6 +174,7 @@ void STKConfig::init_defaults()
         m_delay_finish_time      = m_skid_fadeout_time         =
         m_near_ground            = m_item_switch_time          =
         m_smooth_angle_limit     = m_parachute_ubound_fraction =
+        m_physics_substep_distance =
         m_penalty_time           = m_explosion_impulse_objects =
         m_parachute_max_speed    = UNDEFINED;
     m_bubblegum_counter          = -100;
@@ -178,6 +182,8 @@ void STKConfig::init_defaults()
     m_shield_restrict_weapos     = false;
     m_max_karts                  = -100;
     m_max_skidmarks              = -100;
+    m_physics_fps                = -100;
+    m_physics_max_substeps       = -100;
     m_min_kart_version           = -100;
     m_max_kart_version           = -100;
     m_min_track_version          = -100;
@@ -189,7 +195,16 @@ void STKConfig::init_defaults()
     m_replay_dt                  = -100;
     m_title_music                = NULL;
     m_enable_networking          = true;
+    m_network_state_frequency    = 10.0f;
+    m_network_aoi_near_distance  = 50.0f;
+    m_network_aoi_far_distance   = 150.0f;
+    m_network_aoi_mid_interval   = 3;
+    m_network_aoi_far_interval   = 10;
+    m_network_ball_state_frequency = 30.0f;
+    m_network_spectator_delay    = 3.0f;
+    m_network_spectator_interval = 2;
     m_smooth_normals             = false;
+    m_physics_ccd                = true;
     m_same_powerup_mode          = POWERUP_MODE_ONLY_IF_SAME;
     m_ai_acceleration            = 1.0f;
     m_disable_steer_while_unskid = false;
@@ -257,6 +272,10 @@ void STKConfig::getAllData(const XMLNode * root)
     {
         physics_node->get("smooth-normals",     &m_smooth_normals    );
         physics_node->get("smooth-angle-limit", &m_smooth_angle_limit);
+        physics_node->get("fps",                &m_physics_fps       );
+        physics_node->get("ccd",                &m_physics_ccd       );
+        physics_node->get("substep-distance",   &m_physics_substep_distance);
+        physics_node->get("max-substeps",       &m_physics_max_substeps);
     }
 
     if (const XMLNode *startup_node= root->getNode("startup"))
@@ -366,7 +385,19 @@ void STKConfig::getAllData(const XMLNode * root)
     }
 
     if(const XMLNode *networking_node= root->getNode("networking"))
+    {
         networking_node->get("enable", &m_enable_networking);
+        networking_node->get("state-frequency", &m_network_state_frequency);
+        networking_node->get("near-distance",   &m_network_aoi_near_distance);
+        networking_node->get("far-distance",    &m_network_aoi_far_distance);
+        networking_node->get("mid-interval",    &m_network_aoi_mid_interval);
+        networking_node->get("far-interval",    &m_network_aoi_far_interval);
+        networking_node->get("ball-state-frequency",
+                             &m_network_ball_state_frequency);
+        networking_node->get("spectator-delay", &m_network_spectator_delay);
+        networking_node->get("spectator-interval",
+                             &m_network_spectator_interval);
+    }
 
     if(const XMLNode *replay_node = root->getNode("replay"))
     {
@@ -102,6 +102,19 @@ public:
      *  triangle are more than this value, the physics will use the normal
      *  of the triangle in smoothing normal. */
     float m_smooth_angle_limit;
+
+    /** Number of physics and game logic updates per second. */
+    int   m_physics_fps;
+
+    /** If continuous collision detection is used for karts and flyables. */
+    bool  m_physics_ccd;
+
+    /** An update is split into more physics sub-steps so that no object
+     *  moves more than this distance in one sub-step. */
+    float m_physics_substep_distance;
+
+    /** Maximum number of physics sub-steps per update. */
+    int   m_physics_max_substeps;
     int   m_max_skidmarks;           /**<Maximum number of skid marks/kart.  */
     float m_skid_fadeout_time;       /**<Time till skidmarks fade away.      */
     float m_near_ground;             /**<Determines when a kart is not near
@@ -115,6 +128,21 @@ public:
     int   m_max_display_news;        /**<How often a news message is displayed
                                          before it is ignored. */
     bool  m_enable_networking;
+    float m_network_state_frequency; /**<How often per second the kart
+                                         states are sent to the peers.     */
+    float m_network_aoi_near_distance;/**<Karts closer than this to a peer's
+                                         kart are sent in every snapshot.  */
+    float m_network_aoi_far_distance; /**<Karts further away than this are
+                                         only sent every far-interval.     */
+    int   m_network_aoi_mid_interval; /**<Snapshot interval for karts between
+                                         near and far distance.            */
+    int   m_network_aoi_far_interval; /**<Snapshot interval for far karts.  */
+    float m_network_ball_state_frequency;/**<How often per second the state
+                                         of the soccer balls is sent.      */
+    float m_network_spectator_delay;  /**<Delay in seconds of the snapshot
+                                          stream sent to spectators.       */
+    int   m_network_spectator_interval;/**<Only every n-th snapshot is sent
+                                          to spectators.                   */
 
     /** Disable steering if skidding is stopped. This can help in making
      *  skidding more controllable (since otherwise when trying to steer while
@@ -146,15 +174,17 @@ public:
     /** Maximum time of a replay. */
     int m_replay_max_time;
 
-    /** Minimum time between consecutive saved tranform events.  */
+    /** Time between consecutive sampled transforms. Only the sampled
+     *  transforms that can't be interpolated are saved. */
     float m_replay_dt;
 
     /** Maximum difference between interpolated and actual position. If the
      *  difference is larger than this, a new event is generated. */
     float m_replay_delta_pos2;
 
-    /** A heading difference of more than that will trigger a new event to
-     *  be generated. */
+    /** A rotation difference (in radians) between interpolated and actual
+     *  rotation of more than that will trigger a new event to be
+     *  generated. */
     float m_replay_delta_angle;
 
 private:
@@ -68,8 +68,8 @@ protected:
     std::string m_comment;
 public:
     virtual     ~UserConfigParam();
-    virtual void write(std::ofstream & stream) const = 0;
-    virtual void writeInner(std::ofstream & stream, int level = 0) const;
+    virtual void write(std::ostream& stream) const = 0;
+    virtual void writeInner(std::ostream& stream, int level = 0) const;
     virtual void findYourDataInAChildOf(const XMLNode* node) = 0;
     virtual void findYourDataInAnAttributeOf(const XMLNode* node) = 0;
     virtual irr::core::stringc toString() const = 0;
@@ -85,8 +85,8 @@ public:
     GroupUserConfigParam(const char* param_name,
                        GroupUserConfigParam* group,
                        const char* comment = NULL);
-    void write(std::ofstream& stream) const;
-    void writeInner(std::ofstream& stream, int level = 0) const;
+    void write(std::ostream& stream) const;
+    void writeInner(std::ostream& stream, int level = 0) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -119,7 +119,7 @@ public:
                          int nb_elts,
                          ...);
 
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -150,7 +150,7 @@ public:
                        GroupUserConfigParam* group,
                        const char* comment = NULL);
 
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -177,7 +177,7 @@ public:
     TimeUserConfigParam(StkTime::TimeType default_value, const char* param_name,
                         GroupUserConfigParam* group, const char* comment=NULL);
 
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -204,7 +204,7 @@ public:
                           GroupUserConfigParam* group,
                           const char* comment = NULL);
 
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -235,7 +235,7 @@ public:
     BoolUserConfigParam(bool default_value, const char* param_name,
                         GroupUserConfigParam* group,
                         const char* comment = NULL);
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -261,7 +261,7 @@ public:
                          GroupUserConfigParam* group,
                          const char* comment = NULL);
 
-    void write(std::ofstream& stream) const;
+    void write(std::ostream& stream) const;
     void findYourDataInAChildOf(const XMLNode* node);
     void findYourDataInAnAttributeOf(const XMLNode* node);
 
@@ -279,6 +279,10 @@ enum AnimType {ANIMS_NONE         = 0,
                ANIMS_PLAYERS_ONLY = 1,
                ANIMS_ALL          = 2 };
 
+enum AntiAliasingType {AA_MLAA     = 0,
+                       AA_FXAA     = 1,
+                       AA_TEMPORAL = 2 };
+
 /** Using X-macros for setting-possible values is not very pretty, but it's a
  *  no-maintenance case :
  *  when you want to add a new parameter, just add one signle line below and
@@ -312,6 +316,16 @@ namespace UserConfigParams
             PARAM_DEFAULT(  BoolUserConfigParam(true, "music_on",
             &m_audio_group,
             "Whether musics are enabled or not (true or false)") );
+    PARAM_PREFIX IntUserConfigParam          m_max_sound_sources
+            PARAM_DEFAULT(  IntUserConfigParam(32, "max_sound_sources",
+            &m_audio_group, "Maximum number of sound effects that can be "
+                            "heard at the same time. Less audible sound "
+                            "effects are muted, but keep on playing.") );
+    PARAM_PREFIX IntUserConfigParam          m_sfx_cache_size
+            PARAM_DEFAULT(  IntUserConfigParam(16, "sfx_cache_size",
+            &m_audio_group, "Memory (in MB) used for decoded sound effects. "
+                            "Least recently played sound effects are "
+                            "unloaded if more memory is needed.") );
     PARAM_PREFIX FloatUserConfigParam       m_sfx_volume
             PARAM_DEFAULT(  FloatUserConfigParam(1.0, "sfx_volume",
             &m_audio_group, "Volume for sound effects, see openal AL_GAIN "
@@ -447,6 +461,16 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_texture_compression
         PARAM_DEFAULT(BoolUserConfigParam(true, "enable_texture_compression",
         &m_video_group, "Enable Texture Compression"));
+    PARAM_PREFIX BoolUserConfigParam        m_depth_prepass
+        PARAM_DEFAULT(BoolUserConfigParam(true, "enable_depth_prepass",
+        &m_video_group, "Draw the depth of alpha tested materials (e.g. "
+                        "foliage) before the solid pass to reduce overdraw."));
+    PARAM_PREFIX IntUserConfigParam         m_texture_memory_budget
+        PARAM_DEFAULT(IntUserConfigParam(0, "texture_memory_budget",
+        &m_video_group, "Texture memory in MB above which track textures are "
+                        "loaded at a lower resolution, and textures not used "
+                        "recently are reduced after a race. 0 = half of the "
+                        "video memory if it can be detected, -1 = no limit"));
     /** This is a bit flag: bit 0: enabled (1) or disabled(0). 
      *  Bit 1: setting done by default(0), or by user choice (2). This allows
      *  to e.g. disable h.d. textures on hd3000 as default, but still allow the
@@ -482,6 +506,39 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_esm
         PARAM_DEFAULT(BoolUserConfigParam(false, "enable_esm",
         &m_video_group, "Enable Exponential Shadow Map (better but slower)"));
+    PARAM_PREFIX BoolUserConfigParam        m_gpu_culling
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_gpu_culling",
+        &m_video_group, "Cull instanced meshes on the GPU against the view frustum and the depth of the previous frame (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_gpu_skinning
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_gpu_skinning",
+        &m_video_group, "Animate skinned meshes in a compute shader instead of on the CPU (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_tiled_lighting
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_tiled_lighting",
+        &m_video_group, "Shade point lights per screen tile in a compute shader, without limit on the number of lights (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_occlusion_culling
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_occlusion_culling",
+        &m_video_group, "Skip scene nodes hidden behind the depth of a previous frame before drawing them (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_compute_particles
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_compute_particles",
+        &m_video_group, "Simulate and sort particles in compute shaders, with one buffer shared by all emitters (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_shadow_cache
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_shadow_cache",
+        &m_video_group, "Keep the shadows of the track in the far shadow cascades between frames (experimental)"));
+    PARAM_PREFIX BoolUserConfigParam        m_dynamic_resolution
+        PARAM_DEFAULT(BoolUserConfigParam(false, "enable_dynamic_resolution",
+        &m_video_group, "Lower the resolution of the 3d scene when the GPU time of a frame is above the target"));
+    PARAM_PREFIX FloatUserConfigParam       m_dynamic_resolution_target
+        PARAM_DEFAULT(FloatUserConfigParam(16.0f, "dynamic_resolution_target",
+        &m_video_group, "GPU time per frame in ms dynamic resolution aims for"));
+    PARAM_PREFIX FloatUserConfigParam       m_dynamic_resolution_min_scale
+        PARAM_DEFAULT(FloatUserConfigParam(0.5f, "dynamic_resolution_min_scale",
+        &m_video_group, "Lowest factor the width and height of the 3d scene are scaled by with dynamic resolution"));
+    PARAM_PREFIX IntUserConfigParam         m_benchmarked_gfx_level
+        PARAM_DEFAULT(IntUserConfigParam(-1, "benchmarked_gfx_level",
+        &m_video_group, "Graphics preset chosen by the GPU benchmark at the first start, -1 to run the benchmark again at the next start"));
+    PARAM_PREFIX BoolUserConfigParam        m_shader_cache
+        PARAM_DEFAULT(BoolUserConfigParam(true, "enable_shader_cache",
+        &m_video_group, "Save linked shader programs to disk to speed up the next start"));
     PARAM_PREFIX BoolUserConfigParam        m_old_driver_popup
         PARAM_DEFAULT(BoolUserConfigParam(true, "old_driver_popup",
         &m_video_group, "Determines if popup message about too old drivers should be displayed."));
@@ -490,6 +547,13 @@ namespace UserConfigParams
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
 
+    /** File to which the results of the micro benchmarks are written
+     *  (--micro-benchmark), empty if the benchmarks are not run. */
+    PARAM_PREFIX std::string m_micro_benchmark PARAM_DEFAULT( "" );
+
+    /** Size of the synthetic data used by the micro benchmarks. */
+    PARAM_PREFIX int m_micro_benchmark_size PARAM_DEFAULT( 1000 );
+
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_gamepad_debug PARAM_DEFAULT( false );
 
@@ -536,6 +600,10 @@ namespace UserConfigParams
 
     PARAM_PREFIX bool m_race_now          PARAM_DEFAULT( false );
 
+    /** True if this is a bot client (--bot-client), which joins a server
+     *  without graphics and lets an AI drive its kart. */
+    PARAM_PREFIX bool m_bot_client        PARAM_DEFAULT( false );
+
     /** True to test funky ambient/diffuse/specularity in RGB &
      *  all anisotropic */
     PARAM_PREFIX bool m_rendering_debug   PARAM_DEFAULT( false );
@@ -548,12 +616,70 @@ namespace UserConfigParams
 
     // not saved to file
 
+    // ---- Threads
+
+    PARAM_PREFIX IntUserConfigParam         m_job_threads
+            PARAM_DEFAULT(  IntUserConfigParam(-1, "job_threads",
+                                       "Number of worker threads shared by all parallel "
+                                       "work (AI, physics, culling, ...), -1 to use one "
+                                       "less than the number of cores, 0 to run "
+                                       "everything in the main thread.") );
+
+    // ---- Physics
+
+    PARAM_PREFIX IntUserConfigParam         m_physics_threads
+            PARAM_DEFAULT(  IntUserConfigParam(1, "physics_threads",
+                                       "Number of threads used to solve groups of physics "
+                                       "objects that don't touch each other, e.g. on "
+                                       "servers. 1 disables threading.") );
+
+    // ---- AI
+
+    PARAM_PREFIX IntUserConfigParam         m_ai_threads
+            PARAM_DEFAULT(  IntUserConfigParam(1, "ai_threads",
+                                       "Number of threads used to compute the decisions "
+                                       "of the AI karts, e.g. in profile mode or on "
+                                       "servers. 1 disables threading.") );
+
+    PARAM_PREFIX FloatUserConfigParam       m_ai_time_budget
+            PARAM_DEFAULT(  FloatUserConfigParam(0.0f, "ai_time_budget",
+                                       "Time in ms all AI karts together should use "
+                                       "per frame. If exceeded, the AI looks less far "
+                                       "ahead. 0 means no limit.") );
+
+    PARAM_PREFIX FloatUserConfigParam       m_ai_lod_distance
+            PARAM_DEFAULT(  FloatUserConfigParam(0.0f, "ai_lod_distance",
+                                       "AI karts further away than this (in m, along "
+                                       "the track and from each camera) from all human "
+                                       "players use a simplified AI, which decides less "
+                                       "often. 0 disables this.") );
+
+    PARAM_PREFIX FloatUserConfigParam       m_ai_lod_update_time
+            PARAM_DEFAULT(  FloatUserConfigParam(0.1f, "ai_lod_update_time",
+                                       "Time in s between two decisions of an AI kart "
+                                       "using the simplified AI.") );
+
     // ---- Networking
 
     PARAM_PREFIX IntUserConfigParam         m_server_max_players
             PARAM_DEFAULT(  IntUserConfigParam(16, "server_max_players",
                                        "Maximum number of players on the server.") );
 
+    PARAM_PREFIX IntUserConfigParam         m_server_max_rooms
+            PARAM_DEFAULT(  IntUserConfigParam(1, "server_max_rooms",
+                                       "Maximum number of lobbies hosted by one server, "
+                                       "each with up to server_max_players players.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_server_max_spectators
+            PARAM_DEFAULT(  IntUserConfigParam(0, "server_max_spectators",
+                                       "Maximum number of spectators (e.g. relays for "
+                                       "streams) on the server, 0 to disable.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_server_metrics_port
+            PARAM_DEFAULT(  IntUserConfigParam(0, "server_metrics_port",
+                                       "Local TCP port on which a dedicated server "
+                                       "offers its metrics over HTTP, 0 to disable.") );
+
     PARAM_PREFIX StringListUserConfigParam         m_stun_servers
             PARAM_DEFAULT(  StringListUserConfigParam("Stun_servers", "The stun servers"
                             " that will be used to know the public address.",
@@ -652,24 +778,70 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam         m_mlaa
             PARAM_DEFAULT( BoolUserConfigParam(false,
                            "mlaa", &m_graphics_quality,
-                           "Whether MLAA anti-aliasing should be enabled") );
+                           "Whether post-processing anti-aliasing should be "
+                           "enabled") );
+    PARAM_PREFIX IntUserConfigParam          m_antialiasing_type
+            PARAM_DEFAULT( IntUserConfigParam(AA_MLAA,
+                           "antialiasing_type", &m_graphics_quality,
+                           "Anti-aliasing used if 'mlaa' is enabled (0 = MLAA, "
+                           "three passes; 1 = FXAA, one pass; 2 = temporal, "
+                           "reuses the previous frame)") );
     PARAM_PREFIX BoolUserConfigParam          m_ssao
             PARAM_DEFAULT(BoolUserConfigParam(false,
                            "ssao", &m_graphics_quality,
                            "Enable Screen Space Ambient Occlusion") );
+    PARAM_PREFIX BoolUserConfigParam          m_low_res_effects
+            PARAM_DEFAULT(BoolUserConfigParam(false,
+                           "low_resolution_effects", &m_graphics_quality,
+                           "Render SSAO at half and light scattering at quarter resolution, "
+                           "accumulating SSAO over several frames") );
     PARAM_PREFIX IntUserConfigParam          m_shadows_resolution
             PARAM_DEFAULT( IntUserConfigParam(0,
                            "shadows_resoltion", &m_graphics_quality,
                            "Shadow resolution (0 = disabled") );
+    PARAM_PREFIX IntUserConfigParam          m_shadow_cascades
+            PARAM_DEFAULT( IntUserConfigParam(4,
+                           "shadow_cascades", &m_graphics_quality,
+                           "Number of shadow cascades (1-4), fewer cascades "
+                           "cover the same distance with less detail") );
+    PARAM_PREFIX StringUserConfigParam       m_shadow_cascade_resolution
+            PARAM_DEFAULT( StringUserConfigParam("1 1 1 1",
+                           "shadow_cascade_resolution", &m_graphics_quality,
+                           "Fraction (0.25-1) of the shadow resolution used "
+                           "by each cascade") );
+    PARAM_PREFIX StringUserConfigParam       m_shadow_cascade_update
+            PARAM_DEFAULT( StringUserConfigParam("1 1 1 1",
+                           "shadow_cascade_update", &m_graphics_quality,
+                           "Number of frames between two renderings of each "
+                           "shadow cascade") );
     PARAM_PREFIX BoolUserConfigParam          m_degraded_IBL
         PARAM_DEFAULT(BoolUserConfigParam(false,
         "Degraded_IBL", &m_graphics_quality,
         "Disable specular IBL"));
+    PARAM_PREFIX FloatUserConfigParam         m_imposter_ratio
+        PARAM_DEFAULT(FloatUserConfigParam(0.6f,
+        "imposter_ratio", &m_graphics_quality,
+        "Fraction of the last LOD distance of a scenery object after which "
+        "it is drawn as an imposter (0 = disabled)"));
 
     // ---- Misc
     PARAM_PREFIX BoolUserConfigParam        m_cache_overworld
             PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-overworld") );
 
+    PARAM_PREFIX IntUserConfigParam         m_track_cache_memory
+            PARAM_DEFAULT(  IntUserConfigParam(256, "track_cache_memory",
+                                       "Memory in MB used to keep the models "
+                                       "and textures of the last tracks "
+                                       "loaded after a race, so that they "
+                                       "are not loaded from disk again. "
+                                       "0 disables this.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_loading_threads
+            PARAM_DEFAULT(  IntUserConfigParam(3, "loading_threads",
+                                       "Number of threads used to decode the "
+                                       "textures of a track while it is "
+                                       "loaded, 0 disables threading.") );
+
     // TODO : is this used with new code? does it still work?
     PARAM_PREFIX BoolUserConfigParam        m_crashed
             PARAM_DEFAULT(  BoolUserConfigParam(false, "crashed") );
@@ -837,6 +1009,11 @@ namespace UserConfigParams
                                                 &m_addon_group,
                                         "Time addon-list was updated last.") );
 
+    PARAM_PREFIX StringUserConfigParam      m_addons_etag
+            PARAM_DEFAULT(  StringUserConfigParam("", "addon_etag",
+                                                  &m_addon_group,
+                                        "ETag of the downloaded addon-list.") );
+
     PARAM_PREFIX StringUserConfigParam      m_language
             PARAM_DEFAULT( StringUserConfigParam("system", "language",
                         "Which language to use (language code or 'system')") );
@@ -22,6 +22,8 @@
 
 #include "../../lib/irrlicht/source/Irrlicht/COpenGLTexture.h"
 
+#include <algorithm>
+
 static void drawTexColoredQuad(const video::ITexture *texture, const video::SColor *col, float width, float height,
     float center_pos_x, float center_pos_y, float tex_center_pos_x, float tex_center_pos_y,
     float tex_width, float tex_height)
@@ -259,6 +261,105 @@ void draw2DImage(const video::ITexture* texture, const core::rect<s32>& destRect
     glGetError();
 }
 
+/** Draws quads using the same texture with alpha blending in as few draw
+ *  calls as possible, e.g. all characters of a string.
+ *  \param texture The texture of all quads.
+ *  \param quads The quads, drawn in this order.
+ *  \param clipRect If not NULL, the quads are clipped against it.
+ */
+void draw2DImageBatch(const video::ITexture* texture,
+    const std::vector<Batched2DQuad> &quads, const core::rect<s32>* clipRect)
+{
+    if (quads.empty())
+        return;
+
+    if (!CVS->isGLSL())
+    {
+        for (unsigned i = 0; i < quads.size(); i++)
+        {
+            draw2DImage(texture, quads[i].m_dest, quads[i].m_source, clipRect,
+                        quads[i].m_colors, true);
+        }
+        return;
+    }
+
+    if (clipRect)
+    {
+        if (!clipRect->isValid())
+            return;
+
+        glEnable(GL_SCISSOR_TEST);
+        const core::dimension2d<u32>& renderTargetSize = irr_driver->getActualScreenSize();
+        glScissor(clipRect->UpperLeftCorner.X, renderTargetSize.Height - clipRect->LowerRightCorner.Y,
+            clipRect->getWidth(), clipRect->getHeight());
+    }
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    typedef UIShader::ColoredTextureRectBatchShader BatchShader;
+    const core::dimension2d<u32> frame_size = irr_driver->getActualScreenSize();
+    const float inv_screen_w = 2.0f / frame_size.Width;
+    const float inv_screen_h = 2.0f / frame_size.Height;
+    const float inv_tex_w = 1.0f / texture->getSize().Width;
+    const float inv_tex_h = 1.0f / texture->getSize().Height;
+    const bool flip = texture->isRenderTarget();
+
+    // Reused between calls to avoid allocating memory for every string
+    static std::vector<BatchShader::Vertex> vertices;
+    vertices.resize(quads.size() * 4);
+    for (unsigned i = 0; i < quads.size(); i++)
+    {
+        const Batched2DQuad &quad = quads[i];
+        const float x0 = quad.m_dest.UpperLeftCorner.X  * inv_screen_w - 1.0f;
+        const float x1 = quad.m_dest.LowerRightCorner.X * inv_screen_w - 1.0f;
+        const float y0 = 1.0f - quad.m_dest.UpperLeftCorner.Y  * inv_screen_h;
+        const float y1 = 1.0f - quad.m_dest.LowerRightCorner.Y * inv_screen_h;
+        const float u0 = quad.m_source.UpperLeftCorner.X  * inv_tex_w;
+        const float u1 = quad.m_source.LowerRightCorner.X * inv_tex_w;
+        float v0 = quad.m_source.UpperLeftCorner.Y  * inv_tex_h;
+        float v1 = quad.m_source.LowerRightCorner.Y * inv_tex_h;
+        if (flip)
+            std::swap(v0, v1);
+
+        const float corners[4][4] = { { x0, y0, u0, v0 }, { x0, y1, u0, v1 },
+                                      { x1, y1, u1, v1 }, { x1, y0, u1, v0 } };
+        for (unsigned j = 0; j < 4; j++)
+        {
+            BatchShader::Vertex &v = vertices[4 * i + j];
+            v.m_position[0] = corners[j][0];
+            v.m_position[1] = corners[j][1];
+            v.m_texcoord[0] = corners[j][2];
+            v.m_texcoord[1] = corners[j][3];
+            v.m_color[0] = quad.m_colors[j].getRed();
+            v.m_color[1] = quad.m_colors[j].getGreen();
+            v.m_color[2] = quad.m_colors[j].getBlue();
+            v.m_color[3] = quad.m_colors[j].getAlpha();
+        }
+    }
+
+    glUseProgram(BatchShader::getInstance()->Program);
+    glBindVertexArray(BatchShader::getInstance()->vao);
+    BatchShader::getInstance()->SetTextureUnits(static_cast<const irr::video::COpenGLTexture*>(texture)->getOpenGLTextureName());
+    BatchShader::getInstance()->setUniforms();
+    glBindBuffer(GL_ARRAY_BUFFER, BatchShader::getInstance()->vbo);
+    for (size_t first = 0; first < quads.size(); first += BatchShader::MAX_QUADS)
+    {
+        size_t count = std::min<size_t>(quads.size() - first, BatchShader::MAX_QUADS);
+        // Orphan the buffer, so that the driver doesn't wait until the
+        // previous batch was drawn
+        glBufferData(GL_ARRAY_BUFFER, BatchShader::MAX_QUADS * 4 * sizeof(BatchShader::Vertex), 0, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(BatchShader::Vertex), &vertices[first * 4]);
+        glDrawElements(GL_TRIANGLES, (int)count * 6, GL_UNSIGNED_SHORT, 0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (clipRect)
+        glDisable(GL_SCISSOR_TEST);
+    glUseProgram(0);
+
+    glGetError();
+}
+
 void draw2DVertexPrimitiveList(video::ITexture *tex, const void* vertices,
     u32 vertexCount, const void* indexList, u32 primitiveCount,
     video::E_VERTEX_TYPE vType, scene::E_PRIMITIVE_TYPE pType, video::E_INDEX_TYPE iType)
@@ -27,6 +27,17 @@
 #include <ITexture.h>
 #include <irrTypes.h>
 
+#include <vector>
+
+/** A quad of draw2DImageBatch. The colors are given in the same order as
+ *  for draw2DImage: upper left, lower left, lower right, upper right. */
+struct Batched2DQuad
+{
+    irr::core::rect<irr::s32> m_dest;
+    irr::core::rect<irr::s32> m_source;
+    irr::video::SColor        m_colors[4];
+};
+
 void draw2DImageFromRTT(GLuint texture, size_t texture_w, size_t texture_h,
     const irr::core::rect<irr::s32>& destRect,
     const irr::core::rect<irr::s32>& sourceRect, const irr::core::rect<irr::s32>* clipRect,
@@ -40,6 +51,9 @@ void draw2DImage(const irr::video::ITexture* texture, const irr::core::rect<irr:
     const irr::core::rect<irr::s32>& sourceRect, const irr::core::rect<irr::s32>* clipRect,
     const irr::video::SColor* const colors, bool useAlphaChannelOfTexture);
 
+void draw2DImageBatch(const irr::video::ITexture* texture,
+    const std::vector<Batched2DQuad> &quads, const irr::core::rect<irr::s32>* clipRect);
+
 void draw2DVertexPrimitiveList(irr::video::ITexture *t, const void* vertices,
     irr::u32 vertexCount, const void* indexList, irr::u32 primitiveCount,
     irr::video::E_VERTEX_TYPE vType = irr::video::EVT_STANDARD, irr::scene::E_PRIMITIVE_TYPE pType = irr::scene::EPT_TRIANGLES, irr::video::E_INDEX_TYPE iType = irr::video::EIT_16BIT);
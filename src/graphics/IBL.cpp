@@ -19,8 +19,11 @@
 #include "gl_headers.hpp"
 #include "shaders.hpp"
 #include <cmath>
+#include <fstream>
 #include <set>
 #include "central_settings.hpp"
+#include "io/file_manager.hpp"
+#include "utils/job_system.hpp"
 
 static void getXYZ(GLenum face, float i, float j, float &x, float &y, float &z)
 {
@@ -64,201 +67,179 @@ static void getXYZ(GLenum face, float i, float j, float &x, float &y, float &z)
 }
 
 
-static void getYml(GLenum face, size_t edge_size,
-    float *Y00,
-    float *Y1minus1, float *Y10, float *Y11,
-    float *Y2minus2, float *Y2minus1, float *Y20, float *Y21, float *Y22)
-{
-#pragma omp parallel for
-    for (int i = 0; i < int(edge_size); i++)
-    {
-        for (unsigned j = 0; j < edge_size; j++)
-        {
-            float x, y, z;
-            float fi = float(i), fj = float(j);
-            fi /= edge_size, fj /= edge_size;
-            fi = 2 * fi - 1, fj = 2 * fj - 1;
-            getXYZ(face, fi, fj, x, y, z);
-
-            // constant part of Ylm
-            float c00 = 0.282095f;
-            float c1minus1 = 0.488603f;
-            float c10 = 0.488603f;
-            float c11 = 0.488603f;
-            float c2minus2 = 1.092548f;
-            float c2minus1 = 1.092548f;
-            float c21 = 1.092548f;
-            float c20 = 0.315392f;
-            float c22 = 0.546274f;
-
-            size_t idx = i * edge_size + j;
-
-            Y00[idx] = c00;
-            Y1minus1[idx] = c1minus1 * y;
-            Y10[idx] = c10 * z;
-            Y11[idx] = c11 * x;
-            Y2minus2[idx] = c2minus2 * x * y;
-            Y2minus1[idx] = c2minus1 * y * z;
-            Y21[idx] = c21 * x * z;
-            Y20[idx] = c20 * (3 * z * z - 1);
-            Y22[idx] = c22 * (x * x - y * y);
-        }
-    }
-}
-
-
-static void projectSH(Color *CubemapFace[6], size_t edge_size,
-    float *Y00[],
-    float *Y1minus1[], float *Y10[], float *Y11[],
-    float *Y2minus2[], float *Y2minus1[], float * Y20[], float *Y21[], float *Y22[],
-    float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff
-    )
+/** Projects the cubemap on the 9 first SH basis functions. The basis is
+ *  evaluated for each texel while projecting, which avoids storing it for
+ *  the whole cubemap.
+ */
+void SphericalHarmonics(Color *CubemapFace[6], size_t edge_size, float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff)
 {
-    for (unsigned i = 0; i < 9; i++)
-    {
-        blueSHCoeff[i] = 0;
-        greenSHCoeff[i] = 0;
-        redSHCoeff[i] = 0;
-    }
+    // constant part of Ylm
+    const float c00 = 0.282095f;
+    const float c1minus1 = 0.488603f;
+    const float c10 = 0.488603f;
+    const float c11 = 0.488603f;
+    const float c2minus2 = 1.092548f;
+    const float c2minus1 = 1.092548f;
+    const float c21 = 1.092548f;
+    const float c20 = 0.315392f;
+    const float c22 = 0.546274f;
 
     float wh = float(edge_size * edge_size);
-    float b0 = 0., b1 = 0., b2 = 0., b3 = 0., b4 = 0., b5 = 0., b6 = 0., b7 = 0., b8 = 0.;
-    float r0 = 0., r1 = 0., r2 = 0., r3 = 0., r4 = 0., r5 = 0., r6 = 0., r7 = 0., r8 = 0.;
-    float g0 = 0., g1 = 0., g2 = 0., g3 = 0., g4 = 0., g5 = 0., g6 = 0., g7 = 0., g8 = 0.;
+    for (unsigned i = 0; i < 9; i++)
+        blueSHCoeff[i] = greenSHCoeff[i] = redSHCoeff[i] = 0.f;
+    pthread_mutex_t mutex;
+    pthread_mutex_init(&mutex, NULL);
     for (unsigned face = 0; face < 6; face++)
     {
-#pragma omp parallel for reduction(+ : b0, b1, b2, b3, b4, b5, b6, b7, b8, r0, r1, r2, r3, r4, r5, r6, r7, r8, g0, g1, g2, g3, g4, g5, g6, g7, g8)
-        for (int i = 0; i < int(edge_size); i++)
+        // Each chunk of rows is summed up separately, then added to the
+        // result
+        JobSystem::get()->parallelFor(0, int(edge_size), 16,
+                                      [&](int begin, int end)
         {
-            for (unsigned j = 0; j < edge_size; j++)
+            float b[9] = { 0.f }, g[9] = { 0.f }, r[9] = { 0.f };
+            for (int i = begin; i < end; i++)
             {
-                int idx = i * edge_size + j;
-                float fi = float(i), fj = float(j);
-                fi /= edge_size, fj /= edge_size;
-                fi = 2 * fi - 1, fj = 2 * fj - 1;
-
-
-                float d = sqrt(fi * fi + fj * fj + 1);
-
-                // Constant obtained by projecting unprojected ref values
-                float solidangle = 2.75f / (wh * pow(d, 1.5f));
-                // pow(., 2.2) to convert from srgb
-                float b = CubemapFace[face][edge_size * i + j].Blue;
-                float g = CubemapFace[face][edge_size * i + j].Green;
-                float r = CubemapFace[face][edge_size * i + j].Red;
-
-                b0 += b * Y00[face][idx] * solidangle;
-                b1 += b * Y1minus1[face][idx] * solidangle;
-                b2 += b * Y10[face][idx] * solidangle;
-                b3 += b * Y11[face][idx] * solidangle;
-                b4 += b * Y2minus2[face][idx] * solidangle;
-                b5 += b * Y2minus1[face][idx] * solidangle;
-                b6 += b * Y20[face][idx] * solidangle;
-                b7 += b * Y21[face][idx] * solidangle;
-                b8 += b * Y22[face][idx] * solidangle;
-
-                g0 += g * Y00[face][idx] * solidangle;
-                g1 += g * Y1minus1[face][idx] * solidangle;
-                g2 += g * Y10[face][idx] * solidangle;
-                g3 += g * Y11[face][idx] * solidangle;
-                g4 += g * Y2minus2[face][idx] * solidangle;
-                g5 += g * Y2minus1[face][idx] * solidangle;
-                g6 += g * Y20[face][idx] * solidangle;
-                g7 += g * Y21[face][idx] * solidangle;
-                g8 += g * Y22[face][idx] * solidangle;
-
-
-                r0 += r * Y00[face][idx] * solidangle;
-                r1 += r * Y1minus1[face][idx] * solidangle;
-                r2 += r * Y10[face][idx] * solidangle;
-                r3 += r * Y11[face][idx] * solidangle;
-                r4 += r * Y2minus2[face][idx] * solidangle;
-                r5 += r * Y2minus1[face][idx] * solidangle;
-                r6 += r * Y20[face][idx] * solidangle;
-                r7 += r * Y21[face][idx] * solidangle;
-                r8 += r * Y22[face][idx] * solidangle;
+                for (unsigned j = 0; j < edge_size; j++)
+                {
+                    float fi = float(i), fj = float(j);
+                    fi /= edge_size, fj /= edge_size;
+                    fi = 2 * fi - 1, fj = 2 * fj - 1;
+
+                    float x, y, z;
+                    getXYZ(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, fi, fj, x, y, z);
+                    float Y[9];
+                    Y[0] = c00;
+                    Y[1] = c1minus1 * y;
+                    Y[2] = c10 * z;
+                    Y[3] = c11 * x;
+                    Y[4] = c2minus2 * x * y;
+                    Y[5] = c2minus1 * y * z;
+                    Y[6] = c20 * (3 * z * z - 1);
+                    Y[7] = c21 * x * z;
+                    Y[8] = c22 * (x * x - y * y);
+
+                    float d = sqrt(fi * fi + fj * fj + 1);
+
+                    // Constant obtained by projecting unprojected ref values
+                    float solidangle = 2.75f / (wh * pow(d, 1.5f));
+                    // pow(., 2.2) to convert from srgb
+                    float blue = CubemapFace[face][edge_size * i + j].Blue * solidangle;
+                    float green = CubemapFace[face][edge_size * i + j].Green * solidangle;
+                    float red = CubemapFace[face][edge_size * i + j].Red * solidangle;
+
+                    for (unsigned k = 0; k < 9; k++)
+                    {
+                        b[k] += blue * Y[k];
+                        g[k] += green * Y[k];
+                        r[k] += red * Y[k];
+                    }
+                }
             }
-        }
+            pthread_mutex_lock(&mutex);
+            for (unsigned k = 0; k < 9; k++)
+            {
+                blueSHCoeff[k] += b[k];
+                greenSHCoeff[k] += g[k];
+                redSHCoeff[k] += r[k];
+            }
+            pthread_mutex_unlock(&mutex);
+        });
     }
-
-    blueSHCoeff[0] = b0;
-    blueSHCoeff[1] = b1;
-    blueSHCoeff[2] = b2;
-    blueSHCoeff[3] = b3;
-    blueSHCoeff[4] = b4;
-    blueSHCoeff[5] = b5;
-    blueSHCoeff[6] = b6;
-    blueSHCoeff[7] = b7;
-    blueSHCoeff[8] = b8;
-
-    redSHCoeff[0] = r0;
-    redSHCoeff[1] = r1;
-    redSHCoeff[2] = r2;
-    redSHCoeff[3] = r3;
-    redSHCoeff[4] = r4;
-    redSHCoeff[5] = r5;
-    redSHCoeff[6] = r6;
-    redSHCoeff[7] = r7;
-    redSHCoeff[8] = r8;
-
-    greenSHCoeff[0] = g0;
-    greenSHCoeff[1] = g1;
-    greenSHCoeff[2] = g2;
-    greenSHCoeff[3] = g3;
-    greenSHCoeff[4] = g4;
-    greenSHCoeff[5] = g5;
-    greenSHCoeff[6] = g6;
-    greenSHCoeff[7] = g7;
-    greenSHCoeff[8] = g8;
+    pthread_mutex_destroy(&mutex);
 }
 
-void SphericalHarmonics(Color *CubemapFace[6], size_t edge_size, float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff)
+// ----------------------------------------------------------------------------
+/** Returns the file the data computed from a set of textures is cached in.
+ *  The name is a hash of the content of the texture files (or of the
+ *  textures themselves if they were not loaded from a file), so that a
+ *  modified skybox does not reuse the results of the old one. Hashing the
+ *  files avoids reading the textures back from the GPU.
+ *  \param textures The textures the data is computed from.
+ *  \param ext Extension of the file, identifying the kind of data.
+ */
+std::string getIBLCacheFile(const std::vector<video::ITexture *> &textures, const char *ext)
 {
-    float *Y00[6];
-    float *Y1minus1[6];
-    float *Y10[6];
-    float *Y11[6];
-    float *Y2minus2[6];
-    float *Y2minus1[6];
-    float *Y20[6];
-    float *Y21[6];
-    float *Y22[6];
-
-    for (unsigned face = 0; face < 6; face++)
+    // 64 bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<unsigned char> buffer(64 * 1024);
+    for (unsigned i = 0; i < textures.size(); i++)
     {
-        Y00[face] = new float[edge_size * edge_size];
-        Y1minus1[face] = new float[edge_size * edge_size];
-        Y10[face] = new float[edge_size * edge_size];
-        Y11[face] = new float[edge_size * edge_size];
-        Y2minus2[face] = new float[edge_size * edge_size];
-        Y2minus1[face] = new float[edge_size * edge_size];
-        Y20[face] = new float[edge_size * edge_size];
-        Y21[face] = new float[edge_size * edge_size];
-        Y22[face] = new float[edge_size * edge_size];
-
-        getYml(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, edge_size, Y00[face], Y1minus1[face], Y10[face], Y11[face], Y2minus2[face], Y2minus1[face], Y20[face], Y21[face], Y22[face]);
-    }
+        const core::dimension2du &size = textures[i]->getSize();
+        unsigned header[3] = { size.Width, size.Height, (unsigned)textures[i]->getColorFormat() };
+        const unsigned char *data = (const unsigned char *)header;
+        for (unsigned j = 0; j < sizeof(header); j++)
+        {
+            hash ^= data[j];
+            hash *= 1099511628211ULL;
+        }
 
-    projectSH(CubemapFace, edge_size,
-        Y00,
-        Y1minus1, Y10, Y11,
-        Y2minus2, Y2minus1, Y20, Y21, Y22,
-        blueSHCoeff, greenSHCoeff, redSHCoeff
-        );
+        io::IReadFile *file =
+            file_manager->createReadFile(textures[i]->getName().getPath().c_str());
+        if (file)
+        {
+            s32 n;
+            while ((n = file->read(buffer.data(), (u32)buffer.size())) > 0)
+            {
+                for (s32 j = 0; j < n; j++)
+                {
+                    hash ^= buffer[j];
+                    hash *= 1099511628211ULL;
+                }
+            }
+            file->drop();
+            continue;
+        }
 
-    for (unsigned face = 0; face < 6; face++)
-    {
-        delete[] Y00[face];
-        delete[] Y1minus1[face];
-        delete[] Y10[face];
-        delete[] Y11[face];
-        delete[] Y2minus2[face];
-        delete[] Y2minus1[face];
-        delete[] Y20[face];
-        delete[] Y21[face];
-        delete[] Y22[face];
+        data = (const unsigned char *)textures[i]->lock();
+        if (data)
+        {
+            size_t length = textures[i]->getPitch() * size.Height;
+            for (size_t j = 0; j < length; j++)
+            {
+                hash ^= data[j];
+                hash *= 1099511628211ULL;
+            }
+        }
+        textures[i]->unlock();
     }
-}
+
+    std::string dir = file_manager->getCachedTexturesDir() + "ibl/";
+    file_manager->checkAndCreateDirectoryP(dir);
+    char name[32];
+    sprintf(name, "%08x%08x.", (unsigned)(hash >> 32), (unsigned)hash);
+    return dir + name + ext;
+}   // getIBLCacheFile
+
+// ----------------------------------------------------------------------------
+/** Loads SH coefficients saved by saveSHCoefficients().
+ *  \return True if the coefficients were loaded.
+ */
+bool loadSHCoefficients(const std::string &file, float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff)
+{
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    float coeffs[27];
+    ifs.read((char*)coeffs, sizeof(coeffs));
+    if (ifs.fail())
+        return false;
+    memcpy(blueSHCoeff, coeffs, 9 * sizeof(float));
+    memcpy(greenSHCoeff, coeffs + 9, 9 * sizeof(float));
+    memcpy(redSHCoeff, coeffs + 18, 9 * sizeof(float));
+    return true;
+}   // loadSHCoefficients
+
+// ----------------------------------------------------------------------------
+/** Saves SH coefficients as 27 floats, blue, green and red ones. */
+void saveSHCoefficients(const std::string &file, const float *blueSHCoeff, const float *greenSHCoeff, const float *redSHCoeff)
+{
+    std::ofstream ofs(file.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return;
+    ofs.write((const char*)blueSHCoeff, 9 * sizeof(float));
+    ofs.write((const char*)greenSHCoeff, 9 * sizeof(float));
+    ofs.write((const char*)redSHCoeff, 9 * sizeof(float));
+}   // saveSHCoefficients
 
 // From http://http.developer.nvidia.com/GPUGems3/gpugems3_ch20.html
 /** Returns the index-th pair from Hammersley set of pseudo random set.
@@ -300,13 +281,69 @@ core::matrix4 getPermutationMatrix(size_t indexX, float valX, size_t indexY, flo
     return resultMat;
 }
 
-GLuint generateSpecularCubemap(GLuint probe)
+static const size_t cubemap_size = 256;
+static const unsigned cubemap_levels = 9;
+
+/** Loads a prefiltered cubemap saved by saveSpecularCubemap() in the bound
+ *  cubemap texture. The file contains the half float RGBA data of all levels
+ *  of all faces, level by level.
+ *  \return True if the cubemap was loaded.
+ */
+static bool loadSpecularCubemap(const std::string &file)
+{
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    std::vector<char> data;
+    for (unsigned level = 0; level < cubemap_levels; level++)
+    {
+        size_t size = cubemap_size >> level;
+        data.resize(size * size * 4 * 2);
+        for (unsigned face = 0; face < 6; face++)
+        {
+            ifs.read(data.data(), data.size());
+            if (ifs.fail())
+                return false;
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA16F, size, size, 0, GL_RGBA, GL_HALF_FLOAT, data.data());
+        }
+    }
+    return true;
+}   // loadSpecularCubemap
+
+/** Saves all levels of the bound cubemap texture, see
+ *  loadSpecularCubemap(). */
+static void saveSpecularCubemap(const std::string &file)
+{
+    std::ofstream ofs(file.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return;
+    std::vector<char> data;
+    for (unsigned level = 0; level < cubemap_levels; level++)
+    {
+        size_t size = cubemap_size >> level;
+        data.resize(size * size * 4 * 2);
+        for (unsigned face = 0; face < 6; face++)
+        {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA, GL_HALF_FLOAT, data.data());
+            ofs.write(data.data(), data.size());
+        }
+    }
+}   // saveSpecularCubemap
+
+/** Generates the prefiltered specular cubemap of a probe.
+ *  \param probe The cubemap to filter.
+ *  \param cache_file File the result is loaded from if it exists, and saved
+ *         to otherwise. Can be empty to disable caching.
+ */
+GLuint generateSpecularCubemap(GLuint probe, const std::string &cache_file)
 {
     GLuint cubemap_texture;
 
     glGenTextures(1, &cubemap_texture);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_texture);
-    size_t cubemap_size = 256;
+    if (CVS->isDefferedEnabled() && !cache_file.empty() && loadSpecularCubemap(cache_file))
+        return cubemap_texture;
+
     for (int i = 0; i < 6; i++)
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA16F, cubemap_size, cubemap_size, 0, GL_BGRA, GL_FLOAT, 0);
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
@@ -384,5 +421,11 @@ GLuint generateSpecularCubemap(GLuint probe)
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDeleteFramebuffers(1, &fbo);
+
+    if (!cache_file.empty())
+    {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_texture);
+        saveSpecularCubemap(cache_file);
+    }
     return cubemap_texture;
 }
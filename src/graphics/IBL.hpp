@@ -20,6 +20,10 @@
 
 #include "gl_headers.hpp"
 
+#include <ITexture.h>
+#include <string>
+#include <vector>
+
 struct Color
 {
     float Red;
@@ -34,5 +38,9 @@ using the cubemap provided by CubemapFace.
 */
 void SphericalHarmonics(Color *CubemapFace[6], size_t edge_size, float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff);
 
-GLuint generateSpecularCubemap(GLuint probe);
+std::string getIBLCacheFile(const std::vector<irr::video::ITexture *> &textures, const char *ext);
+bool loadSHCoefficients(const std::string &file, float *blueSHCoeff, float *greenSHCoeff, float *redSHCoeff);
+void saveSHCoefficients(const std::string &file, const float *blueSHCoeff, const float *greenSHCoeff, const float *redSHCoeff);
+
+GLuint generateSpecularCubemap(GLuint probe, const std::string &cache_file);
 #endif
@@ -56,6 +56,8 @@ Camera::Camera(int camera_index, AbstractKart* kart) : m_kart(NULL)
     m_original_kart = kart;
     m_camera        = irr_driver->addCameraSceneNode();
     m_previous_pv_matrix = core::matrix4();
+    m_has_update_transform = false;
+    m_interpolated  = false;
 
 #ifdef DEBUG
     if (kart != NULL)
@@ -331,6 +333,8 @@ void Camera::reset()
 {
     m_kart = m_original_kart;
     setMode(CM_NORMAL);
+    m_has_update_transform = false;
+    m_interpolated         = false;
 
     if (m_kart != NULL)
         setInitialTransform();
@@ -527,6 +531,15 @@ void Camera::update(float dt)
 {
     if (m_kart == NULL) return; // cameras not attached to kart must be positioned manually
 
+    // The camera is smoothed based on its previous position, which must not
+    // depend on the frame rate
+    if (m_interpolated)
+    {
+        m_camera->setPosition(m_update_position);
+        m_camera->setTarget(m_update_target);
+        m_interpolated = false;
+    }
+
     float above_kart, cam_angle, side_way, distance;
     bool  smoothing;
 
@@ -689,8 +702,32 @@ void Camera::update(float dt)
         getCameraSettings(&above_kart, &cam_angle, &side_way, &distance, &smoothing);
         positionCamera(dt, above_kart, cam_angle, side_way, distance, smoothing);
     }
+
+    m_previous_position = m_has_update_transform ? m_update_position
+                                                 : m_camera->getPosition();
+    m_previous_target   = m_has_update_transform ? m_update_target
+                                                 : m_camera->getTarget();
+    m_update_position   = m_camera->getPosition();
+    m_update_target     = m_camera->getTarget();
+    m_has_update_transform = true;
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Moves the camera in between the last two world updates, see
+ *  Moveable::interpolateGraphics.
+ *  \param alpha Time since the last update as fraction of a time step.
+ */
+void Camera::interpolate(float alpha)
+{
+    if (m_kart == NULL || !m_has_update_transform) return;
+
+    m_camera->setPosition(m_previous_position +
+                          (m_update_position - m_previous_position)*alpha);
+    m_camera->setTarget(m_previous_target +
+                        (m_update_target - m_previous_target)*alpha);
+    m_interpolated = true;
+}   // interpolate
+
 // ----------------------------------------------------------------------------
 /** Actually sets the camera based on the given parameter.
  *  \param above_kart How far above the camera should aim at.
@@ -68,6 +68,18 @@ private:
     /** The project-view matrix of the previous frame, used for the blur shader. */
     core::matrix4 m_previous_pv_matrix;
 
+    /** Position and target of the camera after the last two world updates,
+     *  used to interpolate between them (see interpolate()). */
+    core::vector3df m_previous_position, m_previous_target;
+    core::vector3df m_update_position,   m_update_target;
+
+    /** True if m_update_position/target are set. */
+    bool m_has_update_transform;
+
+    /** True if the scene node was moved by interpolate() since the last
+     *  update, which must start from the non-interpolated values. */
+    bool m_interpolated;
+
     /** Camera's mode. */
     Mode            m_mode;
 
@@ -275,6 +287,7 @@ public:
     void setInitialTransform();
     void activate(bool alsoActivateInIrrlicht=true);
     void update            (float dt);
+    void interpolate       (float alpha);
     void setKart(AbstractKart *new_kart);
 
     // ------------------------------------------------------------------------
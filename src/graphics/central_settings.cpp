@@ -41,10 +41,12 @@ void CentralVideoSettings::init()
     hasSSBO = false;
     hasImageLoadStore = false;
     hasMultiDrawIndirect = false;
+    hasProgramBinary = false;
     hasTextureCompression = false;
     hasUBO = false;
     hasGS = false;
     m_GI_has_artifact = false;
+    m_video_memory = 0;
 
     m_need_rh_workaround = false;
     m_need_srgb_workaround = false;
@@ -150,6 +152,17 @@ void CentralVideoSettings::init()
             hasGS = true;
             Log::info("GLDriver", "ARB Geometry Shader 4 Present");
         }
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_PROGRAM_BINARY) &&
+            hasGLExtension("GL_ARB_get_program_binary")) {
+            // Some drivers expose the extension without any binary format
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            if (formats > 0)
+            {
+                hasProgramBinary = true;
+                Log::info("GLDriver", "ARB Get Program Binary Present");
+            }
+        }
 
         // Only unset the high def textures if they are set as default. If the
         // user has enabled them (bit 1 set), then leave them enabled.
@@ -164,6 +177,21 @@ void CentralVideoSettings::init()
             m_GI_has_artifact = true;
         }
 
+        // Amount of video memory in KB, used for the texture memory budget
+        if (hasGLExtension("GL_NVX_gpu_memory_info"))
+        {
+            glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &m_video_memory);
+        }
+        else if (hasGLExtension("GL_ATI_meminfo"))
+        {
+            // Returns the free memory in the first value
+            GLint info[4] = { 0, 0, 0, 0 };
+            glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, info);
+            m_video_memory = info[0];
+        }
+        if (m_video_memory > 0)
+            Log::info("GLDriver", "Video memory: %d MB", m_video_memory / 1024);
+
         // Specific disablement
         if (strstr((const char *)glGetString(GL_VENDOR), "NVIDIA") != NULL)
         {
@@ -195,6 +223,11 @@ bool CentralVideoSettings::isGLSL() const
     return m_glsl;
 }
 
+unsigned CentralVideoSettings::getVideoMemory() const
+{
+    return m_video_memory > 0 ? (unsigned)m_video_memory / 1024 : 0;
+}
+
 bool CentralVideoSettings::needRHWorkaround() const
 {
     return m_need_rh_workaround;
@@ -280,6 +313,11 @@ bool CentralVideoSettings::isARBMultiDrawIndirectUsable() const
     return hasMultiDrawIndirect;
 }
 
+bool CentralVideoSettings::isARBGetProgramBinaryUsable() const
+{
+    return hasProgramBinary;
+}
+
 bool CentralVideoSettings::supportsShadows() const
 {
     return isARBGeometryShader4Usable() && isARBUniformBufferObjectUsable();
@@ -338,6 +376,66 @@ bool CentralVideoSettings::isESMEnabled() const
     return UserConfigParams::m_esm;
 }
 
+// Instances of the solid passes are culled in a compute shader, which also
+// writes the instance count of the indirect draw commands.
+bool CentralVideoSettings::isGPUCullingEnabled() const
+{
+    return supportsIndirectInstancingRendering() && isARBComputeShaderUsable() && isARBShaderStorageBufferObjectUsable() &&
+        isARBImageLoadStoreUsable() && isARBTextureStorageUsable() && UserConfigParams::m_gpu_culling;
+}
+
+// Scene nodes are tested on the CPU against a copy of the depth pyramid of a
+// previous frame, which is built with a compute shader.
+bool CentralVideoSettings::isOcclusionCullingEnabled() const
+{
+    return isARBComputeShaderUsable() && isARBImageLoadStoreUsable() && isARBTextureStorageUsable() &&
+        UserConfigParams::m_occlusion_culling;
+}
+
+// Point lights are culled per screen tile and accumulated in a compute shader
+// instead of drawing one volume per light.
+bool CentralVideoSettings::isTiledLightingEnabled() const
+{
+    return isARBComputeShaderUsable() && isARBShaderStorageBufferObjectUsable() && isARBImageLoadStoreUsable() &&
+        UserConfigParams::m_tiled_lighting;
+}
+
+// Skinned meshes keep their bind pose on the CPU, and a compute shader writes
+// the animated positions and normals into the vertex buffer.
+bool CentralVideoSettings::isGPUSkinningEnabled() const
+{
+    return isARBComputeShaderUsable() && isARBShaderStorageBufferObjectUsable() && UserConfigParams::m_gpu_skinning;
+}
+
+// Particles of all emitters are kept in one pool, simulated and depth sorted
+// in compute shaders and drawn with their range as base instance.
+bool CentralVideoSettings::isComputeParticlesEnabled() const
+{
+    return isARBComputeShaderUsable() && isARBShaderStorageBufferObjectUsable() && isARBBaseInstanceUsable() &&
+        UserConfigParams::m_compute_particles;
+}
+
+// The scene resolution is lowered when the GPU timers show that a frame takes
+// longer than the target time.
+bool CentralVideoSettings::isDynamicResolutionEnabled() const
+{
+    return isDefferedEnabled() && UserConfigParams::m_dynamic_resolution;
+}
+
+// The static casters of the far shadow cascades are only rendered again when
+// the area of the cascade moved. Cascades computed on the GPU are not cached.
+bool CentralVideoSettings::isShadowCacheEnabled() const
+{
+    return isShadowEnabled() && !isSDSMEnabled() && UserConfigParams::m_shadow_cache;
+}
+
+// Linked programs are saved to disk and loaded back instead of compiling the
+// shaders on the next start.
+bool CentralVideoSettings::isShaderCacheEnabled() const
+{
+    return isARBGetProgramBinaryUsable() && UserConfigParams::m_shader_cache;
+}
+
 bool CentralVideoSettings::isDefferedEnabled() const
 {
     return UserConfigParams::m_dynamic_lights && !GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_ADVANCED_PIPELINE);
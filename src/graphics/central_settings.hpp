@@ -40,14 +40,19 @@ private:
     bool hasSSBO;
     bool hasImageLoadStore;
     bool hasMultiDrawIndirect;
+    bool hasProgramBinary;
 
     bool m_need_rh_workaround;
     bool m_need_srgb_workaround;
     bool m_GI_has_artifact;
+
+    /** Dedicated (or free texture) video memory in KB, 0 if unknown. */
+    int m_video_memory;
 public:
     void init();
     bool isGLSL() const;
     unsigned getGLSLVersion() const;
+    unsigned getVideoMemory() const;
 
     // Needs special handle ?
     bool needRHWorkaround() const;
@@ -69,6 +74,7 @@ public:
     bool isARBShaderStorageBufferObjectUsable() const;
     bool isARBImageLoadStoreUsable() const;
     bool isARBMultiDrawIndirectUsable() const;
+    bool isARBGetProgramBinaryUsable() const;
 
 
     // Are all required extensions available for feature support
@@ -85,6 +91,14 @@ public:
     bool isSDSMEnabled() const;
     bool isAZDOEnabled() const;
     bool isESMEnabled() const;
+    bool isGPUCullingEnabled() const;
+    bool isOcclusionCullingEnabled() const;
+    bool isTiledLightingEnabled() const;
+    bool isGPUSkinningEnabled() const;
+    bool isComputeParticlesEnabled() const;
+    bool isDynamicResolutionEnabled() const;
+    bool isShadowCacheEnabled() const;
+    bool isShaderCacheEnabled() const;
     bool isDefferedEnabled() const;
 };
 
@@ -0,0 +1,113 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+DynamicResolution::DynamicResolution()
+{
+    reset();
+}   // DynamicResolution
+
+// ----------------------------------------------------------------------------
+/** Goes back to the full resolution, e.g. when a new race starts. */
+void DynamicResolution::reset()
+{
+    m_scale               = 1.0f;
+    m_average_time        = 0.0f;
+    m_frames_since_change = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Called once per frame with the last measured GPU time.
+ *  \param gpu_time GPU time of a frame in ms, or 0 if nothing was measured.
+ *  \param target_time GPU time per frame in ms to aim for.
+ *  \param min_scale Lowest scale that can be used.
+ *  \return True if the scale changed, i.e. the render targets must be
+ *          recreated.
+ */
+bool DynamicResolution::update(float gpu_time, float target_time,
+                               float min_scale)
+{
+    if (gpu_time <= 0.0f || target_time <= 0.0f)
+        return false;
+
+    if (m_frames_since_change == 0)
+        m_average_time = gpu_time;
+    else
+        m_average_time = 0.9f * m_average_time + 0.1f * gpu_time;
+    m_frames_since_change++;
+    if (m_frames_since_change < COOLDOWN_FRAMES)
+        return false;
+
+    // The GPU time is mostly proportional to the number of pixels
+    const float step = SCALE_STEP / 100.0f;
+    const float wanted = m_scale * sqrtf(target_time / m_average_time);
+    float scale = m_scale;
+    if (m_average_time > 1.05f * target_time)
+        scale = floorf(wanted / step) * step;
+    else if (m_average_time < 0.8f * target_time)
+        scale = std::min(m_scale + step, floorf(wanted / step) * step);
+
+    if (min_scale > 1.0f) min_scale = 1.0f;
+    if (scale < min_scale) scale = min_scale;
+    if (scale > 1.0f) scale = 1.0f;
+    if (fabsf(scale - m_scale) < 0.001f)
+        return false;
+
+    m_scale = scale;
+    m_frames_since_change = 0;
+    return true;
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Checks that the scale drops when the GPU is too slow, never goes below
+ *  the minimum, and comes back to full resolution once the load is gone. */
+void DynamicResolution::unitTesting()
+{
+    DynamicResolution dr;
+    assert(!dr.update(0.0f, 16.0f, 0.5f));
+    assert(dr.getScale() == 1.0f);
+
+    // No change during the cool down
+    for (unsigned int i = 0; i < COOLDOWN_FRAMES - 1; i++)
+        assert(!dr.update(24.0f, 16.0f, 0.5f));
+    assert(dr.update(24.0f, 16.0f, 0.5f));
+    assert(dr.getScale() < 1.0f && dr.getScale() >= 0.5f);
+
+    // Much too slow: clamped to the minimum
+    for (unsigned int i = 0; i < 10 * COOLDOWN_FRAMES; i++)
+        dr.update(100.0f, 16.0f, 0.5f);
+    assert(fabsf(dr.getScale() - 0.5f) < 0.001f);
+
+    // Within the target: stays
+    for (unsigned int i = 0; i < 10 * COOLDOWN_FRAMES; i++)
+        assert(!dr.update(15.0f, 16.0f, 0.5f));
+
+    // Fast enough again: back to full resolution one step at a time
+    unsigned int changes = 0;
+    for (unsigned int i = 0; i < 100 * COOLDOWN_FRAMES; i++)
+    {
+        if (dr.update(4.0f, 16.0f, 0.5f))
+            changes++;
+    }
+    assert(dr.getScale() == 1.0f);
+    assert(changes == 50 / SCALE_STEP);
+}   // unitTesting
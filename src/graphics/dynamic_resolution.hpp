@@ -0,0 +1,65 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_DYNAMIC_RESOLUTION_HPP
+#define HEADER_DYNAMIC_RESOLUTION_HPP
+
+#include "utils/no_copy.hpp"
+
+/**
+  * \brief Chooses the resolution the 3d scene is rendered at from the GPU
+  *  time of the previous frames, so that heavy scenes lower the resolution
+  *  instead of the frame rate. The scene is upsampled to the screen when the
+  *  post-processed image is drawn.
+  *  Changing the scale means recreating all render targets, so the scale
+  *  only changes in steps of SCALE_STEP, and at most once every
+  *  COOLDOWN_FRAMES frames. It drops as far as needed at once, but only
+  *  rises one step at a time to avoid oscillating.
+  * \ingroup graphics
+  */
+class DynamicResolution : public NoCopy
+{
+private:
+    /** Current scale of the scene resolution, between the minimum scale
+     *  and 1. */
+    float m_scale;
+
+    /** Moving average of the GPU time per frame in ms. */
+    float m_average_time;
+
+    /** Number of frames measured since the scale last changed. */
+    unsigned int m_frames_since_change;
+
+public:
+    /** Number of frames the GPU time is averaged over after a change
+     *  before the scale can change again. */
+    static const unsigned int COOLDOWN_FRAMES = 30;
+
+    /** Granularity of the scale, in 1/100. */
+    static const unsigned int SCALE_STEP = 5;
+
+         DynamicResolution();
+    bool update(float gpu_time, float target_time, float min_scale);
+    void reset();
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns the factor the width and height of the scene are scaled by. */
+    float getScale() const { return m_scale; }
+};   // DynamicResolution
+
+#endif
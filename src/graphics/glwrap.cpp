@@ -21,6 +21,7 @@
 #include "config/user_config.hpp"
 #include "config/hardware_stats.hpp"
 #include "graphics/stkmesh.hpp"
+#include "modes/profile_world.hpp"
 #include "utils/profiler.hpp"
 #include "utils/cpp2011.hpp"
 
@@ -144,11 +145,24 @@ void initGL()
 #endif
 }
 
-ScopedGPUTimer::ScopedGPUTimer(GPUTimer &t) : timer(t)
+/** GPU timers are measured for the profiler, and for dynamic resolution
+ *  and benchmarks which need them even when the profiler is frozen.
+ */
+static bool areGPUTimersEnabled()
+{
+    if (CVS->isDynamicResolutionEnabled() || ProfileWorld::isBenchmark())
+        return true;
+    return UserConfigParams::m_profiler_enabled && !profiler.isFrozen();
+}
+
+/** Measures the GPU time of all commands until the end of the scope.
+ *  \param always Measure even if GPU timers are not enabled, e.g. for the
+ *         GPU benchmark at startup.
+ */
+ScopedGPUTimer::ScopedGPUTimer(GPUTimer &t, bool always) : timer(t)
 {
-    if (!UserConfigParams::m_profiler_enabled) return;
-    if (profiler.isFrozen()) return;
-    if (!timer.canSubmitQuery) return;
+    enabled = (always || areGPUTimersEnabled()) && timer.canSubmitQuery;
+    if (!enabled) return;
 #ifdef GL_TIME_ELAPSED
     if (!timer.initialised)
     {
@@ -160,9 +174,7 @@ ScopedGPUTimer::ScopedGPUTimer(GPUTimer &t) : timer(t)
 }
 ScopedGPUTimer::~ScopedGPUTimer()
 {
-    if (!UserConfigParams::m_profiler_enabled) return;
-    if (profiler.isFrozen()) return;
-    if (!timer.canSubmitQuery) return;
+    if (!enabled) return;
 #ifdef GL_TIME_ELAPSED
     glEndQuery(GL_TIME_ELAPSED);
     timer.canSubmitQuery = false;
@@ -187,6 +199,21 @@ unsigned GPUTimer::elapsedTimeus()
     return result / 1000;
 }
 
+/** Returns the time of the last query in microseconds, waiting for the GPU
+ *  to finish it. Only meant for measurements outside of the render loop,
+ *  since it stalls the pipeline.
+ */
+unsigned GPUTimer::waitForElapsedTimeus()
+{
+    if (!initialised)
+        return 0;
+    GLuint result;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &result);
+    lastResult = result / 1000;
+    canSubmitQuery = true;
+    return lastResult;
+}
+
 FrameBuffer::FrameBuffer() {}
 
 FrameBuffer::FrameBuffer(const std::vector<GLuint> &RTTs, size_t w, size_t h,
@@ -270,6 +297,24 @@ void FrameBuffer::Blit(const FrameBuffer &Src, FrameBuffer &Dst, GLbitfield mask
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 }
 
+/** Copies a layer of a layered FBO to a layer of another one of the same
+ *  size. Uses the layer FBOs, so BindLayer must be called again afterwards.
+ */
+void FrameBuffer::BlitLayer(const FrameBuffer &Src, unsigned src_layer, const FrameBuffer &Dst, unsigned dst_layer, GLbitfield mask)
+{
+    assert(Src.fbolayer && Dst.fbolayer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, Src.fbolayer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, Src.RenderTargets[0], 0, src_layer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, Src.DepthTexture, 0, src_layer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, Dst.fbolayer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, Dst.RenderTargets[0], 0, dst_layer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, Dst.DepthTexture, 0, dst_layer);
+    glBlitFramebuffer(0, 0, (int)Src.width, (int)Src.height, 0, 0,
+                      (int)Dst.width, (int)Dst.height, mask, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
 void FrameBuffer::BlitToDefault(size_t x0, size_t y0, size_t x1, size_t y1)
 {
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
@@ -40,8 +40,9 @@ class ScopedGPUTimer
 {
 protected:
     GPUTimer &timer;
+    bool enabled;
 public:
-    ScopedGPUTimer(GPUTimer &);
+    ScopedGPUTimer(GPUTimer &, bool always = false);
     ~ScopedGPUTimer();
 };
 
@@ -55,6 +56,7 @@ class GPUTimer
 public:
     GPUTimer();
     unsigned elapsedTimeus();
+    unsigned waitForElapsedTimeus();
 };
 
 class FrameBuffer
@@ -76,6 +78,7 @@ public:
     size_t getWidth() const { return width; }
     size_t getHeight() const { return height; }
     static void Blit(const FrameBuffer &Src, FrameBuffer &Dst, GLbitfield mask = GL_COLOR_BUFFER_BIT, GLenum filter = GL_NEAREST);
+    static void BlitLayer(const FrameBuffer &Src, unsigned src_layer, const FrameBuffer &Dst, unsigned dst_layer, GLbitfield mask);
     void BlitToDefault(size_t, size_t, size_t, size_t);
 
     LEAK_CHECK();
@@ -0,0 +1,154 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/gpu_benchmark.hpp"
+
+#include "config/user_config.hpp"
+#include "graphics/central_settings.hpp"
+#include "graphics/glwrap.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/post_processing.hpp"
+#include "states_screens/options_screen_video.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+namespace GPUBenchmark
+{
+    /** Number of blurs that are timed, each blur is two full screen
+     *  passes. */
+    static const unsigned int NUM_BLURS = 16;
+
+    /** Estimated GPU cost of a frame with each graphics preset, in full
+     *  screen passes at the screen resolution. With the higher presets
+     *  the screen space effects (lights, SSAO, bloom, GI, ...) dominate the
+     *  cost of a frame, so the fill rate is a good measure for them. */
+    static const float PRESET_COST[] = { 3.0f, 4.0f, 8.0f, 14.0f, 32.0f };
+
+    /** Fraction of the frame time target that is available for the full
+     *  screen passes, the rest is left for the geometry and the shadows. */
+    static const float SCREEN_PASS_BUDGET = 0.5f;
+
+    // ------------------------------------------------------------------------
+    /** Renders a few full screen blur passes at the screen resolution, and
+     *  returns the GPU time of one pass in ms. This waits for the GPU, so it
+     *  must not be used during a race.
+     */
+    float measurePassTime()
+    {
+        const core::dimension2du &size = irr_driver->getActualScreenSize();
+        GLuint tex[2];
+        glGenTextures(2, tex);
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, tex[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.Width, size.Height,
+                         0, GL_RGBA, GL_FLOAT, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        FrameBuffer *fbo = new FrameBuffer(std::vector<GLuint>(1, tex[0]),
+                                           size.Width, size.Height);
+        FrameBuffer *aux = new FrameBuffer(std::vector<GLuint>(1, tex[1]),
+                                           size.Width, size.Height);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        fbo->Bind();
+        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // The first blur compiles the shaders and wakes up the GPU, so it
+        // is not measured
+        PostProcessing *post_processing = irr_driver->getPostProcessing();
+        post_processing->renderGaussian6Blur(*fbo, *aux, 2.0f, 2.0f);
+        glFinish();
+
+        GPUTimer timer;
+        {
+            ScopedGPUTimer measure(timer, /*always*/true);
+            for (unsigned int i = 0; i < NUM_BLURS; i++)
+                post_processing->renderGaussian6Blur(*fbo, *aux, 2.0f, 2.0f);
+        }
+        unsigned int time_us = timer.waitForElapsedTimeus();
+
+        delete fbo;
+        delete aux;
+        glDeleteTextures(2, tex);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, size.Width, size.Height);
+        return time_us / (1000.0f * 2 * NUM_BLURS);
+    }   // measurePassTime
+
+    // ------------------------------------------------------------------------
+    /** Returns the highest graphics preset whose estimated GPU time fits
+     *  into the frame time target.
+     *  \param pass_time GPU time of one full screen pass in ms.
+     *  \param target_time Frame time target in ms.
+     */
+    int chooseGfxLevel(float pass_time, float target_time)
+    {
+        assert(sizeof(PRESET_COST) / sizeof(PRESET_COST[0]) ==
+               (unsigned int)OptionsScreenVideo::getGfxLevelAmount());
+        const float budget = target_time * SCREEN_PASS_BUDGET;
+        int level = 0;
+        for (int i = 1; i < OptionsScreenVideo::getGfxLevelAmount(); i++)
+        {
+            if (PRESET_COST[i] * pass_time <= budget)
+                level = i;
+        }
+        return level;
+    }   // chooseGfxLevel
+
+    // ------------------------------------------------------------------------
+    /** Runs the benchmark and applies the chosen preset if this was not done
+     *  before. If even the lowest preset does not fit into the frame time
+     *  target, dynamic resolution is enabled, with a minimum scale that
+     *  would make the lowest preset fit.
+     */
+    void runIfNeeded()
+    {
+        if (UserConfigParams::m_benchmarked_gfx_level >= 0 || !CVS->isGLSL())
+            return;
+
+        const float target  = UserConfigParams::m_dynamic_resolution_target;
+        const float pass_time = measurePassTime();
+        // A time of 0 means that the query failed, keep the current
+        // settings and try again at the next start
+        if (pass_time <= 0.0f)
+            return;
+
+        const int level = chooseGfxLevel(pass_time, target);
+        OptionsScreenVideo::applyGfxPreset(level);
+        UserConfigParams::m_benchmarked_gfx_level = level;
+
+        const float cost = PRESET_COST[level] * pass_time;
+        const float budget = target * SCREEN_PASS_BUDGET;
+        if (cost > budget)
+        {
+            // The cost of the passes scales with the number of pixels
+            float scale = sqrtf(budget / cost);
+            UserConfigParams::m_dynamic_resolution = true;
+            UserConfigParams::m_dynamic_resolution_min_scale =
+                std::max(scale, 0.5f);
+        }
+        Log::info("GPUBenchmark", "Full screen pass takes %.3f ms, using "
+                  "graphics level %d.", pass_time, level + 1);
+        user_config->saveConfig();
+    }   // runIfNeeded
+
+}   // namespace GPUBenchmark
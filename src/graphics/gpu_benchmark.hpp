@@ -0,0 +1,39 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_GPU_BENCHMARK_HPP
+#define HEADER_GPU_BENCHMARK_HPP
+
+/**
+  * \brief Chooses the graphics preset at the first start from the measured
+  *  speed of the GPU. GraphicsRestrictions only disables features that are
+  *  known to be broken with a driver, this measures how fast the GPU really
+  *  is: a few full screen blur passes are rendered at the screen resolution
+  *  and timed with a GPUTimer. The cost of a frame with each preset is
+  *  estimated from the time of one pass, and the highest preset that fits
+  *  into the frame time target is used. The choice is stored in the user
+  *  config, so the benchmark runs only once.
+  * \ingroup graphics
+  */
+namespace GPUBenchmark
+{
+    float measurePassTime();
+    int   chooseGfxLevel(float pass_time, float target_time);
+    void  runIfNeeded();
+};   // GPUBenchmark
+
+#endif
@@ -16,7 +16,9 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "graphics/irr_driver.hpp"
+#include "graphics/central_settings.hpp"
 #include "graphics/glwrap.hpp"
+#include "graphics/particle_pool.hpp"
 #include "gpuparticles.hpp"
 #include "io/file_manager.hpp"
 #include "config/user_config.hpp"
@@ -66,6 +68,9 @@ ParticleSystemProxy::ParticleSystemProxy(bool createDefaultEmitter,
     heightmaptexture = 0;
     has_height_map = false;
     flip = false;
+    m_use_pool = false;
+    m_pool_offset = 0;
+    m_pool_id = 0;
     track_x = 0;
     track_z = 0;
     track_x_len = 0;
@@ -92,31 +97,22 @@ void ParticleSystemProxy::setFlip()
     flip = true;
 }
 
-void ParticleSystemProxy::setHeightmap(const std::vector<std::vector<float> > &hm,
+/** Uploads the height map (see Track::getHeightMap) as a single channel
+ *  texture buffer. The heights are already stored in the layout the shader
+ *  expects, so they are uploaded without conversion. */
+void ParticleSystemProxy::setHeightmap(const std::vector<float> &hm,
     float f1, float f2, float f3, float f4)
 {
     track_x = f1, track_z = f2, track_x_len = f3, track_z_len = f4;
 
-    unsigned width  = (unsigned)hm.size();
-    unsigned height = (unsigned)hm[0].size();
-    float *hm_array = new float[width * height];
-    for (unsigned i = 0; i < width; i++)
-    {
-        for (unsigned j = 0; j < height; j++)
-        {
-            hm_array[i * height + j] = hm[i][j];
-        }
-    }
     has_height_map = true;
     glGenBuffers(1, &heighmapbuffer);
     glBindBuffer(GL_TEXTURE_BUFFER, heighmapbuffer);
-    glBufferData(GL_TEXTURE_BUFFER, width * height * sizeof(float), hm_array, GL_STREAM_COPY);
+    glBufferData(GL_TEXTURE_BUFFER, hm.size() * sizeof(float), hm.data(), GL_STATIC_DRAW);
     glGenTextures(1, &heightmaptexture);
     glBindTexture(GL_TEXTURE_BUFFER, heightmaptexture);
     glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, heighmapbuffer);
     glBindBuffer(GL_TEXTURE_BUFFER, 0);
-
-    delete[] hm_array;
 }
 
 static
@@ -311,6 +307,14 @@ void ParticleSystemProxy::setEmitter(scene::IParticleEmitter* emitter)
 
 void ParticleSystemProxy::cleanGL()
 {
+    if (m_use_pool)
+    {
+        // The range is lost if the pool was destroyed in the meantime
+        if (m_pool_id != 0 && m_pool_id == ParticlePool::getCurrentId())
+            ParticlePool::getInstance()->release(m_pool_offset, m_count);
+        m_pool_id = 0;
+        return;
+    }
     if (flip)
         glDeleteBuffers(1, &quaternionsbuffer);
     glDeleteBuffers(2, tfb_buffers);
@@ -429,6 +433,88 @@ void ParticleSystemProxy::simulate()
     std::swap(current_simulation_vao, non_current_simulation_vao);
 }
 
+/** Simulates the particles of this emitter in place in the particle pool,
+ *  if compute particles are enabled. Must be called before render(), the
+ *  caller is responsible for the memory barrier.
+ */
+void ParticleSystemProxy::dispatchSimulation()
+{
+    if (!getEmitter() || !isGPUParticleType(getEmitter()->getType()))
+        return;
+    updateGLData();
+    if (!m_use_pool || m_count == 0)
+        return;
+
+    int timediff = int(GUIEngine::getLatestDt() * 1000.f);
+    int active_count = getEmitter()->getMaxLifeTime() * getEmitter()->getMaxParticlesPerSecond() / 1000;
+    core::matrix4 matrix = getAbsoluteTransformation();
+
+    ParticlePool::getInstance()->bindBuffers();
+    glUseProgram(ParticleShader::ComputeSimulationShader::getInstance()->Program);
+    if (has_height_map)
+    {
+        glActiveTexture(GL_TEXTURE0 + ParticleShader::ComputeSimulationShader::getInstance()->TU_heightmap);
+        glBindTexture(GL_TEXTURE_BUFFER, heightmaptexture);
+    }
+    ParticleShader::ComputeSimulationShader::getInstance()->setUniforms(matrix, timediff, active_count, size_increase_factor,
+        (int)m_pool_offset, (int)m_count, has_height_map ? 1 : 0, track_x, track_x_len, track_z, track_z_len);
+    glDispatchCompute((m_count + 255) / 256, 1, 1);
+}
+
+/** Sorts the particles of this emitter back to front into the sorted buffer
+ *  of the particle pool. Only blended particles which are not additive
+ *  depend on the drawing order, the others are drawn as simulated. Must be
+ *  called after dispatchSimulation() and a memory barrier.
+ */
+void ParticleSystemProxy::dispatchSorting()
+{
+    if (!m_use_pool || m_first_execution || m_count == 0 || flip || m_alpha_additive)
+        return;
+
+    const int block = 512;
+    const int first = (int)m_pool_offset, count = (int)m_count;
+    const unsigned block_groups = (m_count + block - 1) / block;
+    int size = block;
+    while (size < count)
+        size *= 2;
+
+    ParticlePool::getInstance()->bindBuffers();
+    glUseProgram(ParticleShader::ParticleSortShader::getInstance()->Program);
+    ParticleShader::ParticleSortShader::getInstance()->setUniforms(first, count, 0, 0, 0);
+    glDispatchCompute(block_groups, 1, 1);
+    for (int k = 2 * block; k <= size; k *= 2)
+    {
+        for (int j = k / 2; j >= block; j /= 2)
+        {
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            ParticleShader::ParticleSortShader::getInstance()->setUniforms(first, count, 1, k, j);
+            glDispatchCompute(size / (2 * 256), 1, 1);
+        }
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        ParticleShader::ParticleSortShader::getInstance()->setUniforms(first, count, 2, k, 0);
+        glDispatchCompute(block_groups, 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    ParticleShader::ParticleSortShader::getInstance()->setUniforms(first, count, 3, 0, 0);
+    glDispatchCompute((m_count + 255) / 256, 1, 1);
+}
+
+void ParticleSystemProxy::drawInstances(bool sorted)
+{
+    if (m_use_pool)
+    {
+        if (m_count == 0)
+            return;
+        glBindVertexArray(ParticlePool::getInstance()->getVAO(sorted));
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, m_count, m_pool_offset);
+    }
+    else
+    {
+        glBindVertexArray(current_rendering_vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_count);
+    }
+}
+
 void ParticleSystemProxy::drawFlip()
 {
     glBlendFunc(GL_ONE, GL_ONE);
@@ -437,8 +523,7 @@ void ParticleSystemProxy::drawFlip()
     ParticleShader::FlipParticleRender::getInstance()->SetTextureUnits(texture, irr_driver->getDepthStencilTexture());
     ParticleShader::FlipParticleRender::getInstance()->setUniforms();
 
-    glBindVertexArray(current_rendering_vao);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_count);
+    drawInstances(false);
 }
 
 void ParticleSystemProxy::drawNotFlip()
@@ -455,8 +540,7 @@ void ParticleSystemProxy::drawNotFlip()
 
     ParticleShader::SimpleParticleRender::getInstance()->setUniforms(ColorFrom, ColorTo);
 
-    glBindVertexArray(current_rendering_vao);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_count);
+    drawInstances(!m_alpha_additive);
 }
 
 void ParticleSystemProxy::draw()
@@ -467,6 +551,21 @@ void ParticleSystemProxy::draw()
         drawNotFlip();
 }
 
+static float *generateQuaternions(unsigned count)
+{
+    float *quaternions = new float[4 * count];
+    for (unsigned i = 0; i < count; i++)
+    {
+        core::vector3df rotationdir(0., 1., 0.);
+
+        quaternions[4 * i] = rotationdir.X;
+        quaternions[4 * i + 1] = rotationdir.Y;
+        quaternions[4 * i + 2] = rotationdir.Z;
+        quaternions[4 * i + 3] = 3.14f * 3.f * (2.f * os::Randomizer::frand() - 1.f); // 3 half rotation during lifetime at max
+    }
+    return quaternions;
+}
+
 void ParticleSystemProxy::generateVAOs()
 {
     glBindVertexArray(0);
@@ -494,16 +593,7 @@ void ParticleSystemProxy::generateVAOs()
     glBindVertexArray(0);
     if (flip)
     {
-        float *quaternions = new float[4 * m_count];
-        for (unsigned i = 0; i < m_count; i++)
-        {
-            core::vector3df rotationdir(0., 1., 0.);
-
-            quaternions[4 * i] = rotationdir.X;
-            quaternions[4 * i + 1] = rotationdir.Y;
-            quaternions[4 * i + 2] = rotationdir.Z;
-            quaternions[4 * i + 3] = 3.14f * 3.f * (2.f * os::Randomizer::frand() - 1.f); // 3 half rotation during lifetime at max
-        }
+        float *quaternions = generateQuaternions(m_count);
         glGenBuffers(1, &quaternionsbuffer);
         glBindBuffer(GL_ARRAY_BUFFER, quaternionsbuffer);
         glBufferData(GL_ARRAY_BUFFER, 4 * m_count * sizeof(float), quaternions, GL_STREAM_COPY);
@@ -522,15 +612,59 @@ void ParticleSystemProxy::generateVAOs()
     glBindVertexArray(0);
 }
 
+/** Allocates the range of this emitter in the particle pool and uploads the
+ *  initial particles to it.
+ */
+void ParticleSystemProxy::generatePoolRange()
+{
+    m_pool_id = 0;
+    if (m_count == 0)
+        return;
+    ParticlePool *pool = ParticlePool::getInstance();
+    m_pool_offset = pool->allocate(m_count);
+    m_pool_id = pool->getId();
+    pool->upload(ParticlePool::PB_INITIAL_VALUES, m_pool_offset, m_count, ParticleParams);
+    pool->upload(ParticlePool::PB_PARTICLES, m_pool_offset, m_count, InitialValues);
+    if (flip)
+    {
+        float *quaternions = generateQuaternions(m_count);
+        pool->upload(ParticlePool::PB_QUATERNIONS, m_pool_offset, m_count, quaternions);
+        delete[] quaternions;
+    }
+}
+
+/** Creates the GL data of the particles on first use, and again if compute
+ *  particles were switched on or off or the pool was destroyed since.
+ */
+void ParticleSystemProxy::updateGLData()
+{
+    bool use_pool = CVS->isComputeParticlesEnabled();
+    if (!m_first_execution && (m_use_pool != use_pool ||
+        (m_use_pool && m_count > 0 && m_pool_id != ParticlePool::getCurrentId())))
+    {
+        cleanGL();
+        m_first_execution = true;
+    }
+    if (m_first_execution)
+    {
+        m_use_pool = use_pool;
+        if (m_use_pool)
+            generatePoolRange();
+        else
+            generateVAOs();
+    }
+    m_first_execution = false;
+}
+
 void ParticleSystemProxy::render() {
     if (!getEmitter() || !isGPUParticleType(getEmitter()->getType()))
     {
         CParticleSystemSceneNode::render();
         return;
     }
-    if (m_first_execution)
-        generateVAOs();
-    m_first_execution = false;
-    simulate();
+    updateGLData();
+    // Particles in the pool were simulated by dispatchSimulation()
+    if (!m_use_pool)
+        simulate();
     draw();
 }
@@ -21,11 +21,14 @@
 #include "../lib/irrlicht/source/Irrlicht/CParticleSystemSceneNode.h"
 #include <ISceneManager.h>
 #include <IParticleSystemSceneNode.h>
+#include <vector>
 
 namespace irr { namespace video{ class ITexture; } }
+using namespace irr;
 
 class ParticleSystemProxy : public scene::CParticleSystemSceneNode
 {
+    friend class ParticlePool;
 protected:
     GLuint tfb_buffers[2], initial_values_buffer, heighmapbuffer, heightmaptexture, quaternionsbuffer;
     GLuint current_simulation_vao, non_current_simulation_vao;
@@ -37,6 +40,14 @@ protected:
     bool m_first_execution;
     bool m_randomize_initial_y;
 
+    /** True if the particles are stored in the particle pool and simulated
+     *  in a compute shader instead of with transform feedback. */
+    bool m_use_pool;
+    /** First particle of the range of this emitter in the particle pool. */
+    unsigned m_pool_offset;
+    /** Id of the pool the range was allocated in, 0 if there is none. */
+    unsigned m_pool_id;
+
     GLuint texture;
 
     /** Current count of particles. */
@@ -49,7 +60,10 @@ protected:
     static void CommonSimulationVAO(GLuint position_vbo, GLuint initialValues_vbo);
 
     void generateVAOs();
+    void generatePoolRange();
+    void updateGLData();
     void cleanGL();
+    void drawInstances(bool sorted);
 
     void drawFlip();
     void drawNotFlip();
@@ -91,13 +105,15 @@ public:
 
     virtual void setEmitter(scene::IParticleEmitter* emitter);
     virtual void render();
+    void dispatchSimulation();
+    void dispatchSorting();
     void setAlphaAdditive(bool val) { m_alpha_additive = val; }
     void setIncreaseFactor(float val) { size_increase_factor = val; }
     void setColorFrom(float r, float g, float b) { m_color_from[0] = r; m_color_from[1] = g; m_color_from[2] = b; }
     void setColorTo(float r, float g, float b) { m_color_to[0] = r; m_color_to[1] = g; m_color_to[2] = b; }
     const float* getColorFrom() const { return m_color_from; }
     const float* getColorTo() const { return m_color_to; }
-    void setHeightmap(const std::vector<std::vector<float> >&, float, float, float, float);
+    void setHeightmap(const std::vector<float>&, float, float, float, float);
     void setFlip();
 };
 
@@ -55,6 +55,7 @@ namespace GraphicsRestrictions
             "BindlessTexture",
             "TextureCompressionS3TC",
             "AMDVertexShaderLayer",
+            "ProgramBinary",
             "DriverRecentEnough",
             "HighDefinitionTextures",
             "AdvancedPipeline",
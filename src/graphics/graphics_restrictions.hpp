@@ -49,6 +49,7 @@ namespace GraphicsRestrictions
         GR_BINDLESS_TEXTURE,
         GR_EXT_TEXTURE_COMPRESSION_S3TC,
         GR_AMD_VERTEX_SHADER_LAYER,
+        GR_PROGRAM_BINARY,
         GR_DRIVER_RECENT_ENOUGH,
         GR_HIGHDEFINITION_TEXTURES,
         GR_ADVANCED_PIPELINE,
@@ -0,0 +1,263 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "graphics/imposter.hpp"
+
+#include "graphics/glwrap.hpp"
+#include "graphics/graphics_restrictions.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/shaders.hpp"
+#include "graphics/stkmesh.hpp"
+
+#include <ICameraSceneNode.h>
+#include <IMesh.h>
+#include <IMeshBuffer.h>
+#include <ISceneManager.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+/** Size of one view in the imposter texture. */
+static const unsigned IMPOSTER_TILE_SIZE = 128;
+/** Number of views, stored as 4x2 tiles (see imposter.vert). */
+static const unsigned IMPOSTER_VIEW_COUNT = 8;
+static const unsigned IMPOSTER_TILES_X    = 4;
+
+/** The texture of each mesh, so that all instances of an object share one
+ *  texture. It is cleared when the track is unloaded. */
+static std::map<scene::IMesh*, GLuint> g_imposter_textures;
+
+// ----------------------------------------------------------------------------
+/** Returns the radius of the sphere around the bounding box, the views are
+ *  rendered with an orthographic camera enclosing that sphere. */
+static float getImposterRadius(const core::aabbox3df &box)
+{
+    return box.getExtent().getLength() * 0.5f;
+}   // getImposterRadius
+
+// ----------------------------------------------------------------------------
+/** Renders all views of a mesh into a new texture.
+ *  \param mesh The mesh to render, in object space.
+ *  \return The texture, or 0 if the mesh is empty.
+ */
+static GLuint bakeImposterTexture(scene::IMesh *mesh)
+{
+    const core::aabbox3df &box = mesh->getBoundingBox();
+    const core::vector3df center = box.getCenter();
+    const float radius = getImposterRadius(box);
+    if (radius <= 0.0f)
+        return 0;
+
+    const unsigned width  = IMPOSTER_TILES_X * IMPOSTER_TILE_SIZE;
+    const unsigned height = IMPOSTER_VIEW_COUNT / IMPOSTER_TILES_X
+                          * IMPOSTER_TILE_SIZE;
+    // The views are written in linear space, which needs an sRGB texture
+    // to keep the precision of dark colours, like the normal textures
+    const bool srgb = !GraphicsRestrictions::isDisabled(
+                      GraphicsRestrictions::GR_FRAMEBUFFER_SRGB_WORKING);
+
+    GLuint texture, depth;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width,
+                 height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glGenTextures(1, &depth);
+    glBindTexture(GL_TEXTURE_2D, depth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0,
+                 GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 0);
+
+    {
+        FrameBuffer fbo(std::vector<GLuint>(1, texture), depth, width,
+                        height);
+        fbo.Bind();
+        glClearColor(0., 0., 0., 0.);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (srgb)
+            glEnable(GL_FRAMEBUFFER_SRGB);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+        glUseProgram(MeshShader::ImposterBakeShader::getInstance()->Program);
+
+        // View i looks at the object from angle i * step around the Y axis
+        core::matrix4 views[IMPOSTER_VIEW_COUNT];
+        core::matrix4 projection;
+        projection.buildProjectionMatrixOrthoLH(2.0f * radius, 2.0f * radius,
+                                                radius, 3.0f * radius);
+        const float step = 2.0f * core::PI / IMPOSTER_VIEW_COUNT;
+        for (unsigned i = 0; i < IMPOSTER_VIEW_COUNT; i++)
+        {
+            const core::vector3df eye = center +
+                core::vector3df(sinf(i * step), 0.0f, cosf(i * step))
+                * (2.0f * radius);
+            views[i].buildCameraLookAtMatrixLH(eye, center,
+                                               core::vector3df(0, 1, 0));
+            views[i] = projection * views[i];
+        }
+
+        video::ITexture *white =
+            getUnicolorTexture(video::SColor(255, 255, 255, 255));
+        for (unsigned i = 0; i < mesh->getMeshBufferCount(); i++)
+        {
+            scene::IMeshBuffer *mb = mesh->getMeshBuffer(i);
+            if (mb->getVertexCount() == 0 || mb->getIndexCount() == 0 ||
+                mb->getPrimitiveType() != scene::EPT_TRIANGLES)
+                continue;
+            GLMesh gl_mesh = allocateMeshBuffer(mb, "");
+            fillLocalBuffer(gl_mesh, mb);
+            gl_mesh.vao = createVAO(gl_mesh.vertex_buffer,
+                                    gl_mesh.index_buffer, gl_mesh.VAOType);
+
+            video::ITexture *tex = gl_mesh.textures[0] ? gl_mesh.textures[0]
+                                                       : white;
+            compressTexture(tex, true);
+            MeshShader::ImposterBakeShader::getInstance()
+                ->SetTextureUnits(getTextureGLuint(tex));
+            for (unsigned j = 0; j < IMPOSTER_VIEW_COUNT; j++)
+            {
+                glViewport((j % IMPOSTER_TILES_X) * IMPOSTER_TILE_SIZE,
+                           (j / IMPOSTER_TILES_X) * IMPOSTER_TILE_SIZE,
+                           IMPOSTER_TILE_SIZE, IMPOSTER_TILE_SIZE);
+                MeshShader::ImposterBakeShader::getInstance()
+                    ->setUniforms(views[j]);
+                glDrawElements(gl_mesh.PrimitiveType,
+                               (GLsizei)gl_mesh.IndexCount,
+                               gl_mesh.IndexType, 0);
+            }
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &gl_mesh.vao);
+            glDeleteBuffers(1, &gl_mesh.vertex_buffer);
+            glDeleteBuffers(1, &gl_mesh.index_buffer);
+        }
+        white->drop();
+
+        if (srgb)
+            glDisable(GL_FRAMEBUFFER_SRGB);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    glDeleteTextures(1, &depth);
+
+    // Small mipmaps would mix the tiles
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return texture;
+}   // bakeImposterTexture
+
+// ----------------------------------------------------------------------------
+ImposterNode::ImposterNode(scene::ISceneNode *parent,
+                           scene::ISceneManager *mgr,
+                           const core::aabbox3df &box, GLuint texture)
+            : IBillboardSceneNode(parent, mgr, -1, core::vector3df(0, 0, 0)),
+              STKBillboard(parent, mgr, -1, core::vector3df(0, 0, 0),
+                           core::dimension2df(2.0f * getImposterRadius(box),
+                                              2.0f * getImposterRadius(box)))
+{
+    m_texture = texture;
+    m_box     = box;
+    m_center  = box.getCenter();
+}   // ImposterNode
+
+// ----------------------------------------------------------------------------
+/** Creates an imposter for a mesh. The texture is rendered the first time
+ *  an imposter is created for a mesh, and shared by all later ones.
+ *  \param mesh The static mesh the imposter replaces.
+ *  \param parent Parent of the new node.
+ *  \return The new node, or NULL if the mesh can not be rendered.
+ */
+ImposterNode *ImposterNode::create(scene::IMesh *mesh,
+                                   scene::ISceneNode *parent)
+{
+    GLuint texture;
+    std::map<scene::IMesh*, GLuint>::iterator it =
+        g_imposter_textures.find(mesh);
+    if (it != g_imposter_textures.end())
+    {
+        texture = it->second;
+    }
+    else
+    {
+        texture = bakeImposterTexture(mesh);
+        g_imposter_textures[mesh] = texture;
+    }
+    if (texture == 0)
+        return NULL;
+
+    ImposterNode *node = new ImposterNode(parent,
+                                          irr_driver->getSceneManager(),
+                                          mesh->getBoundingBox(), texture);
+    node->drop();
+    return node;
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Deletes the textures of all imposters, called when a track is unloaded.
+ */
+void ImposterNode::clearCache()
+{
+    std::map<scene::IMesh*, GLuint>::iterator it;
+    for (it = g_imposter_textures.begin(); it != g_imposter_textures.end();
+         it++)
+    {
+        if (it->second)
+            glDeleteTextures(1, &it->second);
+    }
+    g_imposter_textures.clear();
+}   // clearCache
+
+// ----------------------------------------------------------------------------
+void ImposterNode::render()
+{
+    if (irr_driver->getPhase() != TRANSPARENT_PASS)
+        return;
+
+    const core::matrix4 &trans = getAbsoluteTransformation();
+    core::vector3df pos = m_center;
+    trans.transformVect(pos);
+
+    // Select the view from the direction of the camera in object space
+    core::vector3df eye =
+        SceneManager->getActiveCamera()->getAbsolutePosition();
+    core::matrix4 inverse;
+    trans.getInverse(inverse);
+    inverse.transformVect(eye);
+    eye -= m_center;
+    const float step = 2.0f * core::PI / IMPOSTER_VIEW_COUNT;
+    int view = (int)floorf(atan2f(eye.X, eye.Z) / step + 0.5f);
+    view = (view + IMPOSTER_VIEW_COUNT) % IMPOSTER_VIEW_COUNT;
+
+    const core::vector3df scale = trans.getScale();
+    const float s = std::max(scale.X, std::max(scale.Y, scale.Z));
+
+    // Imposters are opaque, they are only drawn in the transparent pass
+    // because they are billboards
+    glDisable(GL_BLEND);
+    glBindVertexArray(getVAO());
+    glUseProgram(MeshShader::ImposterShader::getInstance()->Program);
+    MeshShader::ImposterShader::getInstance()->SetTextureUnits(m_texture);
+    MeshShader::ImposterShader::getInstance()->setUniforms(
+        irr_driver->getViewMatrix(), irr_driver->getProjMatrix(), pos,
+        core::dimension2df(Size.Width * s, Size.Height * s),
+        core::vector2df((float)(view % IMPOSTER_TILES_X),
+                        (float)(view / IMPOSTER_TILES_X)));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+}   // render
@@ -0,0 +1,68 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_IMPOSTER_HPP
+#define HEADER_IMPOSTER_HPP
+
+#include "graphics/gl_headers.hpp"
+#include "graphics/stkbillboard.hpp"
+#include "utils/cpp2011.hpp"
+
+namespace irr
+{
+    namespace scene { class IMesh; }
+}
+using namespace irr;
+
+/**
+ * \brief A billboard which replaces a static scenery object far away.
+ *  The object is rendered from several directions around its vertical
+ *  axis into one texture when the track is loaded, and the view closest to
+ *  the direction the camera looks from is drawn. Imposters are the last
+ *  level of an LODNode (see ModelDefinitionLoader::instanciateAsLOD).
+ * \ingroup graphics
+ */
+class ImposterNode : public STKBillboard
+{
+private:
+    /** The texture with all views of the mesh, owned by the cache. */
+    GLuint              m_texture;
+
+    /** Centre of the bounding box of the mesh, in object space. */
+    core::vector3df     m_center;
+
+    /** Bounding box of the mesh, used for culling. */
+    core::aabbox3df     m_box;
+
+    ImposterNode(scene::ISceneNode *parent, scene::ISceneManager *mgr,
+                 const core::aabbox3df &box, GLuint texture);
+
+public:
+    static ImposterNode *create(scene::IMesh *mesh,
+                                scene::ISceneNode *parent);
+    static void clearCache();
+
+    virtual void render() OVERRIDE;
+    // ------------------------------------------------------------------------
+    virtual const core::aabbox3d<f32>& getBoundingBox() const OVERRIDE
+    {
+        return m_box;
+    }   // getBoundingBox
+};   // ImposterNode
+
+#endif
@@ -21,12 +21,15 @@
 #include "graphics/callbacks.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/dynamic_resolution.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/2dutils.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/light.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/occlusion_buffer.hpp"
 #include "graphics/particle_kind_manager.hpp"
+#include "graphics/particle_pool.hpp"
 #include "graphics/per_camera_node.hpp"
 #include "graphics/post_processing.hpp"
 #include "graphics/referee.hpp"
@@ -37,6 +40,8 @@
 #include "graphics/stkscenemanager.hpp"
 #include "graphics/sun.hpp"
 #include "graphics/rtts.hpp"
+#include "graphics/shadow_cache.hpp"
+#include "graphics/shadow_cascades.hpp"
 #include "graphics/texturemanager.hpp"
 #include "graphics/water.hpp"
 #include "graphics/wind.hpp"
@@ -58,8 +63,10 @@
 #include "physics/physics.hpp"
 #include "states_screens/dialogs/confirm_resolution_dialog.hpp"
 #include "states_screens/state_manager.hpp"
+#include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/load_profiler.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
 #include "utils/vs.hpp"
@@ -126,6 +133,18 @@ IrrDriver::IrrDriver()
     m_shadow_camnodes[1] = NULL;
     m_shadow_camnodes[2] = NULL;
     m_shadow_camnodes[3] = NULL;
+    m_depth_pyramid_valid = false;
+    m_ssao_history_valid = false;
+    m_ssao_frame = 0;
+    m_taa_frame = 0;
+    m_scene_update_id = 0;
+    m_last_scene_update_id = 0;
+    m_occlusion_buffer = NULL;
+    m_dynamic_resolution = NULL;
+    m_shadow_cache = NULL;
+    m_shadow_cascades = NULL;
+    m_rsm_map_available = false;
+    m_rh_valid = false;
     memset(object_count, 0, sizeof(object_count));
 }   // IrrDriver
 
@@ -489,7 +508,6 @@ void IrrDriver::initDevice()
     m_scene_manager = m_device->getSceneManager();
     m_gui_env       = m_device->getGUIEnvironment();
     m_video_driver  = m_device->getVideoDriver();
-    m_sync = 0;
 
     m_actual_screen_size = m_video_driver->getCurrentRenderTargetSize();
 
@@ -795,11 +813,13 @@ void IrrDriver::applyResolutionSettings()
     // (we're sure to update main.cpp at some point and forget this one...)
     m_shaders->killShaders();
     VAOManager::getInstance()->kill();
+    ParticlePool::kill();
     SolidPassCmd::getInstance()->kill();
     ShadowPassCmd::getInstance()->kill();
     RSMPassCmd::getInstance()->kill();
     GlowPassCmd::getInstance()->kill();
     resetTextureTable();
+    clearTextureMemoryTable();
     // initDevice will drop the current device.
     initDevice();
 
@@ -874,7 +894,8 @@ void IrrDriver::printRenderStats()
 {
     io::IAttributes * attr = m_scene_manager->getParameters();
     Log::verbose("irr_driver",
-           "[%ls], FPS:%3d Tri:%.03fm Cull %d/%d nodes (%d,%d,%d)\n",
+           "[%ls], FPS:%3d Tri:%.03fm Cull %d/%d nodes (%d,%d,%d) "
+           "Textures: %d (%d MB)\n",
            m_video_driver->getName(),
            m_video_driver->getFPS (),
            (f32) m_video_driver->getPrimitiveCountDrawn( 0 ) * ( 1.f / 1000000.f ),
@@ -882,7 +903,9 @@ void IrrDriver::printRenderStats()
            attr->getAttributeAsInt ( "calls" ),
            attr->getAttributeAsInt ( "drawn_solid" ),
            attr->getAttributeAsInt ( "drawn_transparent" ),
-           attr->getAttributeAsInt ( "drawn_transparent_effect" )
+           attr->getAttributeAsInt ( "drawn_transparent_effect" ),
+           getUploadedTextureCount(),
+           (int)(getTextureMemoryUsed() / (1024 * 1024))
            );
 
 }   // printRenderStats
@@ -893,7 +916,11 @@ void IrrDriver::printRenderStats()
  */
 scene::IAnimatedMesh *IrrDriver::getAnimatedMesh(const std::string &filename)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_MESHES);
     scene::IAnimatedMesh *m  = NULL;
+    // A mesh is only read if it is not in the mesh cache
+    const unsigned int mesh_count =
+        m_scene_manager->getMeshCache()->getMeshCount();
 
     if (StringUtils::getExtension(filename) == "b3dz")
     {
@@ -925,6 +952,8 @@ scene::IAnimatedMesh *IrrDriver::getAnimatedMesh(const std::string &filename)
 
     if(!m) return NULL;
 
+    if (m_scene_manager->getMeshCache()->getMeshCount() > mesh_count)
+        LoadProfiler::addFileBytes(LoadProfiler::STAGE_MESHES, filename);
     setAllMaterialFlags(m);
 
     return m;
@@ -1275,6 +1304,7 @@ void IrrDriver::removeMeshFromCache(scene::IMesh *mesh)
  */
 void IrrDriver::removeTexture(video::ITexture *t)
 {
+    removeTextureFromTable(t);
     m_video_driver->removeTexture(t);
 }   // removeTexture
 
@@ -1517,8 +1547,12 @@ video::ITexture *IrrDriver::getTexture(const std::string &filename,
                                        bool is_prediv,
                                        bool complain_if_not_found)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_TEXTURES);
+    const unsigned int texture_count = m_video_driver->getTextureCount();
     video::ITexture* out;
-    if(!is_premul && !is_prediv)
+    // Without graphics only dummy textures are created, so there is no
+    // need to load and convert the image
+    if(ProfileWorld::isNoGraphics() || (!is_premul && !is_prediv))
     {
         if (!complain_if_not_found) m_device->getLogger()->setLogLevel(ELL_NONE);
         out = m_video_driver->getTexture(filename.c_str());
@@ -1594,6 +1628,8 @@ video::ITexture *IrrDriver::getTexture(const std::string &filename,
     }
 
     m_texturesFileName[out] = filename;
+    if (m_video_driver->getTextureCount() > texture_count)
+        LoadProfiler::addFileBytes(LoadProfiler::STAGE_TEXTURES, filename);
 
     return out;
 }   // getTexture
@@ -1716,15 +1752,100 @@ void IrrDriver::setRTT(RTT* rtt)
 {
     memset(m_shadow_camnodes, 0, 4 * sizeof(void*));
     m_rtts = rtt;
+    if (m_shadow_cascades)
+        m_shadow_cascades->invalidate();
+    m_rh_valid = false;
 }
 // ----------------------------------------------------------------------------
 void IrrDriver::onLoadWorld()
 {
     if (CVS->isGLSL())
     {
-        const core::recti &viewport = Camera::getCamera(0)->getViewport();
-        size_t width = viewport.LowerRightCorner.X - viewport.UpperLeftCorner.X, height = viewport.LowerRightCorner.Y - viewport.UpperLeftCorner.Y;
-        m_rtts = new RTT(width, height);
+        m_dynamic_resolution = new DynamicResolution();
+        m_shadow_cache = new ShadowCache();
+        m_shadow_cascades = new ShadowCascades(
+                            World::getWorld()->getTrack()->getShadowSplits());
+        m_occlusion_buffer = new OcclusionBuffer();
+        createSceneRTT();
+    }
+}
+// ----------------------------------------------------------------------------
+/** (Re)creates the RTTs of the scene at the size of the viewport of the
+ *  first camera, scaled by the dynamic resolution. Everything depending on
+ *  the previous RTTs is invalidated.
+ */
+void IrrDriver::createSceneRTT()
+{
+    delete m_rtts;
+    const core::recti &viewport = Camera::getCamera(0)->getViewport();
+    size_t width = viewport.LowerRightCorner.X - viewport.UpperLeftCorner.X, height = viewport.LowerRightCorner.Y - viewport.UpperLeftCorner.Y;
+    float scale = getSceneResolutionScale();
+    m_rtts = new RTT((size_t)(width * scale), (size_t)(height * scale));
+    invalidateDepthPyramid();
+    m_ssao_history_valid = false;
+    if (m_post_processing)
+        m_post_processing->invalidateTemporalAAHistory();
+    // The RSM and the radiance hints are part of the RTTs
+    m_rsm_map_available = false;
+    m_rh_valid = false;
+    if (m_shadow_cache)
+        m_shadow_cache->invalidate();
+    if (m_shadow_cascades)
+        m_shadow_cascades->invalidate();
+}
+// ----------------------------------------------------------------------------
+/** Returns the factor the width and height of the 3d scene are scaled by
+ *  before it is upsampled to the screen.
+ */
+float IrrDriver::getSceneResolutionScale() const
+{
+    return m_dynamic_resolution ? m_dynamic_resolution->getScale() : 1.0f;
+}
+// ----------------------------------------------------------------------------
+/** Returns true if the scene is anti-aliased with the temporal anti-aliasing,
+ *  in which case the projection is jittered every frame. Its history can only
+ *  be used with a single camera, and it is done by the post-processing,
+ *  which is skipped by the sRGB workaround.
+ */
+bool IrrDriver::isTemporalAAEnabled() const
+{
+    return CVS->isGLSL() && CVS->isARBUniformBufferObjectUsable() &&
+           UserConfigParams::m_mlaa &&
+           UserConfigParams::m_antialiasing_type == AA_TEMPORAL &&
+           Camera::getNumCameras() == 1;
+}
+// ----------------------------------------------------------------------------
+/** Called once per frame: feeds the GPU time of the last measured frame to
+ *  the dynamic resolution and recreates the scene RTTs if the resolution
+ *  changed. The GUI is not affected by the scale, so its time is ignored.
+ */
+void IrrDriver::updateDynamicResolution()
+{
+    if (!m_rtts || !m_dynamic_resolution)
+        return;
+    if (!CVS->isDynamicResolutionEnabled())
+    {
+        if (m_dynamic_resolution->getScale() < 1.0f)
+        {
+            m_dynamic_resolution->reset();
+            createSceneRTT();
+        }
+        return;
+    }
+
+    unsigned gpu_time = 0;
+    for (unsigned i = 0; i < Q_LAST; i++)
+    {
+        if (i != Q_GUI)
+            gpu_time += m_perf_query[i].elapsedTimeus();
+    }
+    if (m_dynamic_resolution->update(gpu_time / 1000.0f,
+                                     UserConfigParams::m_dynamic_resolution_target,
+                                     UserConfigParams::m_dynamic_resolution_min_scale))
+    {
+        Log::debug("irr_driver", "Scene resolution scale changed to %f.",
+                   m_dynamic_resolution->getScale());
+        createSceneRTT();
     }
 }
 // ----------------------------------------------------------------------------
@@ -1732,6 +1853,14 @@ void IrrDriver::onUnloadWorld()
 {
     delete m_rtts;
     m_rtts = NULL;
+    delete m_occlusion_buffer;
+    m_occlusion_buffer = NULL;
+    delete m_dynamic_resolution;
+    m_dynamic_resolution = NULL;
+    delete m_shadow_cache;
+    m_shadow_cache = NULL;
+    delete m_shadow_cascades;
+    m_shadow_cascades = NULL;
 
     suppressSkyBox();
 }
@@ -2074,19 +2203,8 @@ void IrrDriver::doScreenShot()
  */
 void IrrDriver::update(float dt)
 {
-    // User aborted (e.g. closed window)
-    // =================================
-    if (!m_device->run())
-    {
-        // Don't bother cleaning up GUI, has no use and may result in crashes
-        //GUIEngine::cleanUp();
-        //GUIEngine::deallocate();
-        main_loop->abort();
-        return;
-    }
-
-    // If we quit via the menu the m_device->run() does not return true.
-    // To avoid any other calls, we return here.
+    // The main loop handles the device events before the world update. If
+    // the window was closed or we quit via the menu, avoid any other calls.
     if(main_loop->isAborted())
         return;
 
@@ -40,6 +40,7 @@
 #include "graphics/wind.hpp"
 #include "io/file_manager.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/frame_arena.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/ptr_vector.hpp"
 #include "utils/vec3.hpp"
@@ -55,6 +56,10 @@ using namespace irr;
 
 class RTT;
 class FrameBuffer;
+class OcclusionBuffer;
+class DynamicResolution;
+class ShadowCache;
+class ShadowCascades;
 class ShadowImportanceProvider;
 class AbstractKart;
 class Camera;
@@ -110,6 +115,9 @@ enum TypeFBO
     FBO_BLOOM_128,
     FBO_TMP_128,
     FBO_LENS_128,
+
+    FBO_SSAO_HISTORY,
+    FBO_TAA_HISTORY,
     FBO_COUNT
 };
 
@@ -171,6 +179,10 @@ enum TypeRTT
     RTT_TMP_128,
     RTT_LENS_128,
 
+    RTT_DEPTH_PYRAMID,
+    RTT_SSAO_HISTORY,
+    RTT_TAA_HISTORY,
+
     RTT_COUNT
 };
 
@@ -182,7 +194,6 @@ enum TypeRTT
 class IrrDriver : public IEventReceiver, public NoCopy
 {
 private:
-    GLsync m_sync;
     /** The irrlicht device. */
     IrrlichtDevice             *m_device;
     /** Irrlicht scene manager. */
@@ -201,12 +212,28 @@ private:
     Wind                 *m_wind;
     /** RTTs. */
     RTT                *m_rtts;
+    /** CPU copy of the depth pyramid used to cull occluded scene nodes. */
+    OcclusionBuffer    *m_occlusion_buffer;
+    /** Chooses the resolution of the scene RTTs from the GPU time. */
+    DynamicResolution  *m_dynamic_resolution;
+    /** Keeps the static casters of the far shadow cascades. */
+    ShadowCache        *m_shadow_cache;
+    /** Number, splits, resolution and update rate of the shadow cascades. */
+    ShadowCascades     *m_shadow_cascades;
     std::vector<core::matrix4> sun_ortho_matrix;
     core::vector3df    rh_extend;
     core::matrix4      rh_matrix;
     core::matrix4      rsm_matrix;
     bool               m_rsm_matrix_initialized;
     bool               m_rsm_map_available;
+    /** True if the radiance hints were built from the current RSM. They
+     *  only depend on the RSM, the position of the RH volume (which moves
+     *  in steps of 8 units) and the sun colour, so they are only rebuilt if
+     *  one of these changed. */
+    bool               m_rh_valid;
+    /** The RH matrix and sun colour the radiance hints were built with. */
+    core::matrix4      m_rh_built_matrix;
+    video::SColorf     m_rh_built_sun_color;
     core::vector2df    m_current_screen_size;
     core::dimension2du m_actual_screen_size;
 
@@ -220,6 +247,30 @@ private:
     /** Matrixes used in several places stored here to avoid recomputation. */
     core::matrix4 m_ViewMatrix, m_InvViewMatrix, m_ProjMatrix, m_InvProjMatrix, m_ProjViewMatrix, m_InvProjViewMatrix;
 
+    /** The view projection matrix the depth pyramid was rendered with. */
+    core::matrix4 m_depth_pyramid_matrix;
+    /** True if the depth pyramid contains the depth of the previous frame
+     *  of the current camera and can be used for occlusion culling. */
+    bool m_depth_pyramid_valid;
+
+    /** True if RTT_SSAO_HISTORY contains the occlusion of the previous frame
+     *  of the current camera. */
+    bool m_ssao_history_valid;
+    /** Counts the frames rendered with accumulated SSAO, to rotate the
+     *  sampling pattern. */
+    unsigned m_ssao_frame;
+    /** Index of the subpixel offset the projection is jittered by for the
+     *  temporal anti-aliasing. */
+    unsigned m_taa_frame;
+
+    /** Identifies the frame while all cameras of the race are rendered, so
+     *  that work that does not depend on the camera (e.g. skinning and
+     *  uploading animated meshes) is only done for the first camera. It is
+     *  0 outside of the camera loop, which means nodes are always updated. */
+    unsigned m_scene_update_id;
+    /** The last value used for m_scene_update_id. */
+    unsigned m_last_scene_update_id;
+
     std::vector<video::ITexture *> SkyboxTextures;
     std::vector<video::ITexture *> SphericalHarmonicsTextures;
     bool m_skybox_ready;
@@ -267,6 +318,8 @@ public:
         scene::ISceneNode * node;
         float r, g, b;
     };
+    /** The glowing nodes of one frame. */
+    typedef std::vector<GlowData, FrameAllocator<GlowData> > GlowList;
 
 private:
     std::vector<VideoMode> m_modes;
@@ -340,7 +393,7 @@ private:
     void computeSunVisibility();
     void renderShadows();
     void renderRSM();
-    void renderGlow(std::vector<GlowData>& glows);
+    void renderGlow(GlowList& glows);
     void renderSSAO();
     void renderLights(unsigned pointlightCount, bool hasShadow);
     void renderAmbientScatter();
@@ -443,6 +496,10 @@ public:
     void                  showPointer();
     void                  hidePointer();
     void                  setLastLightBucketDistance(unsigned d) { m_last_light_bucket_distance = d; }
+    // ------------------------------------------------------------------------
+    /** Returns the id of the frame rendered for all cameras, or 0 if scene
+     *  nodes must be updated each time they are drawn. */
+    unsigned              getSceneUpdateId() const { return m_scene_update_id; }
     bool                  isPointerShown() const { return m_pointer_shown; }
     core::position2di     getMouseLocation();
 
@@ -516,6 +573,16 @@ public:
     // ------------------------------------------------------------------------
     RTT* getRTT() { return m_rtts; }
     // ------------------------------------------------------------------------
+    OcclusionBuffer* getOcclusionBuffer() { return m_occlusion_buffer; }
+    // ------------------------------------------------------------------------
+    float getSceneResolutionScale() const;
+    // ------------------------------------------------------------------------
+    bool isTemporalAAEnabled() const;
+    // ------------------------------------------------------------------------
+    ShadowCache* getShadowCache() { return m_shadow_cache; }
+    // ------------------------------------------------------------------------
+    ShadowCascades* getShadowCascades() { return m_shadow_cascades; }
+    // ------------------------------------------------------------------------
     /** Returns a list of all video modes supports by the graphics card. */
     const std::vector<VideoMode>& getVideoModes() const { return m_modes; }
     // ------------------------------------------------------------------------
@@ -728,9 +795,15 @@ public:
     void onLoadWorld();
     void onUnloadWorld();
 
-    void renderScene(scene::ICameraSceneNode * const camnode, unsigned pointlightcount, std::vector<GlowData>& glows, float dt, bool hasShadows, bool forceRTT);
+    void renderScene(scene::ICameraSceneNode * const camnode, unsigned pointlightcount, GlowList& glows, float dt, bool hasShadows, bool forceRTT);
     unsigned UpdateLightsInfo(scene::ICameraSceneNode * const camnode, float dt);
     void UpdateSplitAndLightcoordRangeFromComputeShaders(size_t width, size_t height);
+    void cullInstancesOnGPU(size_t first_command, size_t command_count, GLuint instance_buffer,
+                            size_t instance_size, GLuint command_buffer, GLuint bounds_buffer);
+    void buildDepthPyramid();
+    void invalidateDepthPyramid();
+    void createSceneRTT();
+    void updateDynamicResolution();
     void computeMatrixesAndCameras(scene::ICameraSceneNode * const camnode, size_t width, size_t height);
     void uploadLightingData();
 
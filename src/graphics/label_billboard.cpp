@@ -0,0 +1,402 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/label_billboard.hpp"
+
+#include "graphics/glwrap.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/shaders.hpp"
+#include "graphics/texturemanager.hpp"
+
+#include <ISceneManager.h>
+
+#include <algorithm>
+
+/** Size of the atlas and of one cell, the atlas has 2x32 cells. */
+static const unsigned LABEL_ATLAS_WIDTH  = 1024;
+static const unsigned LABEL_ATLAS_HEIGHT = 2048;
+static const unsigned LABEL_CELL_WIDTH   = 512;
+static const unsigned LABEL_CELL_HEIGHT  = 64;
+static const unsigned LABEL_CELLS_X      = LABEL_ATLAS_WIDTH / LABEL_CELL_WIDTH;
+static const unsigned LABEL_CELL_COUNT   = LABEL_CELLS_X
+                                         * (LABEL_ATLAS_HEIGHT / LABEL_CELL_HEIGHT);
+/** Size of one pixel of the font in world units, as for STKTextBillboard. */
+static const float    LABEL_WORLD_SCALE  = 0.018f;
+
+/** The atlas, created with the first label and deleted with the last. */
+static GLuint g_label_atlas = 0;
+/** True for each cell which is used by a label. */
+static std::vector<bool> g_label_cells;
+/** Number of used cells. */
+static unsigned g_label_count = 0;
+
+/** The instance data of one label. */
+struct LabelInstance
+{
+    float m_position[3];
+    float m_size[2];
+    float m_tex_rect[4];
+};   // LabelInstance
+
+/** The labels to draw in the current transparent pass. */
+static std::vector<LabelInstance> g_label_batch;
+static GLuint g_label_vao = 0, g_label_instance_vbo = 0;
+/** Number of instances the instance buffer can store. */
+static size_t g_label_instance_capacity = 0;
+
+// ----------------------------------------------------------------------------
+/** Creates the VAO and instance buffer used to draw all labels. */
+static void createLabelVAO()
+{
+    glGenVertexArrays(1, &g_label_vao);
+    glBindVertexArray(g_label_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, SharedObject::billboardvbo);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                          (GLvoid*)(2 * sizeof(float)));
+
+    glGenBuffers(1, &g_label_instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, g_label_instance_vbo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(LabelInstance), 0);
+    glVertexAttribDivisorARB(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(LabelInstance),
+                          (GLvoid*)(3 * sizeof(float)));
+    glVertexAttribDivisorARB(2, 1);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(LabelInstance),
+                          (GLvoid*)(5 * sizeof(float)));
+    glVertexAttribDivisorARB(4, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}   // createLabelVAO
+
+// ----------------------------------------------------------------------------
+LabelBillboard::LabelBillboard(scene::ISceneNode *parent,
+                               scene::ISceneManager *mgr,
+                               const core::vector3df &position,
+                               unsigned int cell,
+                               const video::SColor &color_top,
+                               const video::SColor &color_bottom)
+              : IBillboardSceneNode(parent, mgr, -1, position),
+                STKBillboard(parent, mgr, -1, position,
+                             core::dimension2df(1.0f, 1.0f))
+{
+    m_cell         = cell;
+    m_color_top    = color_top;
+    m_color_bottom = color_bottom;
+    for (unsigned int i = 0; i < 4; i++)
+        m_tex_rect[i] = 0.0f;
+}   // LabelBillboard
+
+// ----------------------------------------------------------------------------
+/** Creates a label, which is owned by its parent.
+ *  \param text The text of the label.
+ *  \param font The font to render the text with.
+ *  \param color_top, color_bottom Colours of the top and bottom of the
+ *         characters.
+ *  \param parent Parent of the label.
+ *  \param position Position relative to the parent.
+ *  \return The new label, or NULL if the atlas is full.
+ */
+LabelBillboard *LabelBillboard::create(const core::stringw &text,
+                                       gui::ScalableFont *font,
+                                       const video::SColor &color_top,
+                                       const video::SColor &color_bottom,
+                                       scene::ISceneNode *parent,
+                                       const core::vector3df &position)
+{
+    if (g_label_count == LABEL_CELL_COUNT)
+        return NULL;
+
+    if (!g_label_atlas)
+    {
+        g_label_cells.assign(LABEL_CELL_COUNT, false);
+        glGenTextures(1, &g_label_atlas);
+        glBindTexture(GL_TEXTURE_2D, g_label_atlas);
+        // The texture is written without GL_FRAMEBUFFER_SRGB, so the colours
+        // of the font are interpreted as sRGB like all other textures
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, LABEL_ATLAS_WIDTH,
+                     LABEL_ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        // Small mipmaps would mix the cells
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+    }
+    if (!g_label_vao)
+        createLabelVAO();
+
+    unsigned int cell = (unsigned int)(std::find(g_label_cells.begin(),
+                                                 g_label_cells.end(), false)
+                                       - g_label_cells.begin());
+    g_label_cells[cell] = true;
+    g_label_count++;
+
+    LabelBillboard *label = new LabelBillboard(parent,
+                                               irr_driver->getSceneManager(),
+                                               position, cell, color_top,
+                                               color_bottom);
+    label->setText(text, font);
+    label->drop();
+    return label;
+}   // create
+
+// ----------------------------------------------------------------------------
+LabelBillboard::~LabelBillboard()
+{
+    g_label_cells[m_cell] = false;
+    g_label_count--;
+    if (g_label_count == 0)
+    {
+        glDeleteTextures(1, &g_label_atlas);
+        g_label_atlas = 0;
+    }
+}   // ~LabelBillboard
+
+// ----------------------------------------------------------------------------
+/** Changes the text of the label. The atlas is only updated if the text is
+ *  different from the current one.
+ */
+void LabelBillboard::setText(const core::stringw &text,
+                             gui::ScalableFont *font)
+{
+    if (text == m_text)
+        return;
+    m_text = text;
+    drawText(font);
+}   // setText
+
+// ----------------------------------------------------------------------------
+void LabelBillboard::collectChar(video::ITexture *texture,
+                                 const core::rect<s32> &dest_rect,
+                                 const core::rect<s32> &source_rect,
+                                 const video::SColor* const colors)
+{
+    Char c;
+    c.m_texture = texture;
+    c.m_dest    = dest_rect;
+    c.m_source  = source_rect;
+    m_chars.push_back(c);
+}   // collectChar
+
+// ----------------------------------------------------------------------------
+/** Renders the text into the cell of this label. A text which does not fit
+ *  into a cell is scaled down; the size of the label in the world only
+ *  depends on the size of the text.
+ */
+void LabelBillboard::drawText(gui::ScalableFont *font)
+{
+    m_chars.clear();
+    const core::dimension2du size = font->getDimension(m_text.c_str());
+    font->doDraw(m_text, core::rect<s32>(0, 0, size.Width, size.Height),
+                 video::SColor(255, 255, 255, 255), false, false, NULL, this);
+
+    core::rect<s32> extent(0, 0, 0, 0);
+    for (unsigned int i = 0; i < m_chars.size(); i++)
+    {
+        if (i == 0)
+            extent = m_chars[i].m_dest;
+        else
+            extent.addInternalPoint(m_chars[i].m_dest.LowerRightCorner);
+        extent.addInternalPoint(m_chars[i].m_dest.UpperLeftCorner);
+    }
+    const float width  = (float)std::max(extent.getWidth(),  1);
+    const float height = (float)std::max(extent.getHeight(), 1);
+    const float scale  = std::min(1.0f,
+                                  std::min(LABEL_CELL_WIDTH  / width,
+                                           LABEL_CELL_HEIGHT / height));
+    setSize(core::dimension2df(width  * LABEL_WORLD_SCALE,
+                               height * LABEL_WORLD_SCALE));
+
+    const unsigned int cell_x = (m_cell % LABEL_CELLS_X) * LABEL_CELL_WIDTH;
+    const unsigned int cell_y = (m_cell / LABEL_CELLS_X) * LABEL_CELL_HEIGHT;
+    // The cell is rendered upside down compared to irrlicht textures, so
+    // the top of the text is at the top of the cell
+    m_tex_rect[0] = float(cell_x) / LABEL_ATLAS_WIDTH;
+    m_tex_rect[1] = float(cell_y + LABEL_CELL_HEIGHT) / LABEL_ATLAS_HEIGHT;
+    m_tex_rect[2] =  width  * scale / LABEL_ATLAS_WIDTH;
+    m_tex_rect[3] = -height * scale / LABEL_ATLAS_HEIGHT;
+
+    GLint old_viewport[4];
+    glGetIntegerv(GL_VIEWPORT, old_viewport);
+    {
+        FrameBuffer fbo(std::vector<GLuint>(1, g_label_atlas),
+                        LABEL_ATLAS_WIDTH, LABEL_ATLAS_HEIGHT);
+        fbo.Bind();
+        glViewport(cell_x, cell_y, LABEL_CELL_WIDTH, LABEL_CELL_HEIGHT);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(cell_x, cell_y, LABEL_CELL_WIDTH, LABEL_CELL_HEIGHT);
+        glClearColor(0., 0., 0., 0.);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+        typedef UIShader::ColoredTextureRectBatchShader BatchShader;
+        glUseProgram(BatchShader::getInstance()->Program);
+        glBindVertexArray(BatchShader::getInstance()->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, BatchShader::getInstance()->vbo);
+        BatchShader::getInstance()->setUniforms();
+
+        // All characters using the same texture are drawn at once
+        std::vector<BatchShader::Vertex> vertices;
+        std::vector<bool> done(m_chars.size(), false);
+        for (unsigned int i = 0; i < m_chars.size(); i++)
+        {
+            if (done[i])
+                continue;
+            video::ITexture *texture = m_chars[i].m_texture;
+            const float inv_tex_w = 1.0f / texture->getSize().Width;
+            const float inv_tex_h = 1.0f / texture->getSize().Height;
+            vertices.clear();
+            for (unsigned int j = i; j < m_chars.size() &&
+                 vertices.size() < BatchShader::MAX_QUADS * 4; j++)
+            {
+                if (done[j] || m_chars[j].m_texture != texture)
+                    continue;
+                done[j] = true;
+                const core::rect<s32> &dest = m_chars[j].m_dest;
+                const core::rect<s32> &src  = m_chars[j].m_source;
+                const float x0 = (dest.UpperLeftCorner.X  - extent.UpperLeftCorner.X)
+                               * scale * 2.0f / LABEL_CELL_WIDTH - 1.0f;
+                const float x1 = (dest.LowerRightCorner.X - extent.UpperLeftCorner.X)
+                               * scale * 2.0f / LABEL_CELL_WIDTH - 1.0f;
+                const float y0 = 1.0f - (dest.UpperLeftCorner.Y  - extent.UpperLeftCorner.Y)
+                               * scale * 2.0f / LABEL_CELL_HEIGHT;
+                const float y1 = 1.0f - (dest.LowerRightCorner.Y - extent.UpperLeftCorner.Y)
+                               * scale * 2.0f / LABEL_CELL_HEIGHT;
+                const float u0 = src.UpperLeftCorner.X  * inv_tex_w;
+                const float u1 = src.LowerRightCorner.X * inv_tex_w;
+                const float v0 = src.UpperLeftCorner.Y  * inv_tex_h;
+                const float v1 = src.LowerRightCorner.Y * inv_tex_h;
+                const float corners[4][4] = { { x0, y0, u0, v0 }, { x0, y1, u0, v1 },
+                                              { x1, y1, u1, v1 }, { x1, y0, u1, v0 } };
+                for (unsigned int k = 0; k < 4; k++)
+                {
+                    BatchShader::Vertex v;
+                    v.m_position[0] = corners[k][0];
+                    v.m_position[1] = corners[k][1];
+                    v.m_texcoord[0] = corners[k][2];
+                    v.m_texcoord[1] = corners[k][3];
+                    const video::SColor &c = (k == 0 || k == 3) ? m_color_top
+                                                                : m_color_bottom;
+                    v.m_color[0] = c.getRed();
+                    v.m_color[1] = c.getGreen();
+                    v.m_color[2] = c.getBlue();
+                    v.m_color[3] = c.getAlpha();
+                    vertices.push_back(v);
+                }
+            }
+            BatchShader::getInstance()->SetTextureUnits(getTextureGLuint(texture));
+            glBufferSubData(GL_ARRAY_BUFFER, 0,
+                            vertices.size() * sizeof(BatchShader::Vertex),
+                            vertices.data());
+            glDrawElements(GL_TRIANGLES, (int)vertices.size() / 4 * 6,
+                           GL_UNSIGNED_SHORT, 0);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glUseProgram(0);
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    glViewport(old_viewport[0], old_viewport[1], old_viewport[2],
+               old_viewport[3]);
+
+    glBindTexture(GL_TEXTURE_2D, g_label_atlas);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    m_chars.clear();
+}   // drawText
+
+// ----------------------------------------------------------------------------
+/** Like STKTextBillboard, labels don't use the rotation of the parent. */
+void LabelBillboard::updateAbsolutePosition()
+{
+    AbsoluteTransformation = getRelativeTransformation();
+    if (Parent)
+    {
+        AbsoluteTransformation.setTranslation(
+            AbsoluteTransformation.getTranslation()
+            + Parent->getAbsolutePosition());
+    }
+    // Make sure that children are updated, too
+    ++AbsoluteTransformationVersion;
+}   // updateAbsolutePosition
+
+// ----------------------------------------------------------------------------
+/** Only adds the label to the batch, which is drawn by renderBatch. */
+void LabelBillboard::render()
+{
+    if (irr_driver->getPhase() != TRANSPARENT_PASS || m_text.empty())
+        return;
+    LabelInstance instance;
+    const core::vector3df pos = getAbsolutePosition();
+    instance.m_position[0] = pos.X;
+    instance.m_position[1] = pos.Y;
+    instance.m_position[2] = pos.Z;
+    instance.m_size[0]     = Size.Width;
+    instance.m_size[1]     = Size.Height;
+    for (unsigned int i = 0; i < 4; i++)
+        instance.m_tex_rect[i] = m_tex_rect[i];
+    g_label_batch.push_back(instance);
+}   // render
+
+// ----------------------------------------------------------------------------
+/** Draws all labels added by render() since the last call, called in the
+ *  transparent pass after the other billboards.
+ */
+void LabelBillboard::renderBatch()
+{
+    if (g_label_batch.empty())
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_label_instance_vbo);
+    if (g_label_batch.size() > g_label_instance_capacity)
+    {
+        g_label_instance_capacity = g_label_batch.size();
+        glBufferData(GL_ARRAY_BUFFER,
+                     g_label_instance_capacity * sizeof(LabelInstance),
+                     g_label_batch.data(), GL_STREAM_DRAW);
+    }
+    else
+    {
+        // Orphan the buffer, so that the driver doesn't wait until the
+        // previous pass was drawn
+        glBufferData(GL_ARRAY_BUFFER,
+                     g_label_instance_capacity * sizeof(LabelInstance),
+                     0, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0,
+                        g_label_batch.size() * sizeof(LabelInstance),
+                        g_label_batch.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The shader outputs premultiplied alpha
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(g_label_vao);
+    glUseProgram(MeshShader::LabelShader::getInstance()->Program);
+    MeshShader::LabelShader::getInstance()->SetTextureUnits(g_label_atlas);
+    MeshShader::LabelShader::getInstance()->setUniforms(
+        irr_driver->getViewMatrix(), irr_driver->getProjMatrix());
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                          (GLsizei)g_label_batch.size());
+    glBindVertexArray(0);
+    g_label_batch.clear();
+}   // renderBatch
@@ -0,0 +1,90 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LABEL_BILLBOARD_HPP
+#define HEADER_LABEL_BILLBOARD_HPP
+
+#include "graphics/stkbillboard.hpp"
+#include "guiengine/scalable_font.hpp"
+#include "utils/cpp2011.hpp"
+
+#include <irrString.h>
+#include <vector>
+
+using namespace irr;
+
+/**
+ * \brief A text label above an object, e.g. the name of a kart.
+ *  The text is rendered once into a cell of a texture shared by all labels
+ *  (and again only if the text changes). All visible labels are then drawn
+ *  with a single instanced draw call after the other billboards, instead
+ *  of one mesh per label like STKTextBillboard. If the atlas is full,
+ *  create() returns NULL and STKTextBillboard should be used instead.
+ * \ingroup graphics
+ */
+class LabelBillboard : public STKBillboard, private gui::FontCharCollector
+{
+private:
+    /** One character of the text while it is rendered into the atlas. */
+    struct Char
+    {
+        video::ITexture  *m_texture;
+        core::rect<s32>   m_dest;
+        core::rect<s32>   m_source;
+    };   // Char
+
+    /** The characters collected by ScalableFont::doDraw. */
+    std::vector<Char>   m_chars;
+
+    /** Index of the cell of the atlas used by this label. */
+    unsigned int        m_cell;
+
+    /** The current text, to only render a new text. */
+    core::stringw       m_text;
+
+    /** Colour of the top and bottom of the characters. */
+    video::SColor       m_color_top, m_color_bottom;
+
+    /** Part of the atlas covered by the text: left and top texture
+     *  coordinates, followed by the width and (negative) height. */
+    float               m_tex_rect[4];
+
+    LabelBillboard(scene::ISceneNode *parent, scene::ISceneManager *mgr,
+                   const core::vector3df &position, unsigned int cell,
+                   const video::SColor &color_top,
+                   const video::SColor &color_bottom);
+    void drawText(gui::ScalableFont *font);
+    virtual void collectChar(video::ITexture *texture,
+                             const core::rect<s32> &dest_rect,
+                             const core::rect<s32> &source_rect,
+                             const video::SColor* const colors) OVERRIDE;
+
+public:
+    static LabelBillboard *create(const core::stringw &text,
+                                  gui::ScalableFont *font,
+                                  const video::SColor &color_top,
+                                  const video::SColor &color_bottom,
+                                  scene::ISceneNode *parent,
+                                  const core::vector3df &position);
+    static void renderBatch();
+    virtual ~LabelBillboard();
+    void setText(const core::stringw &text, gui::ScalableFont *font);
+    virtual void render() OVERRIDE;
+    virtual void updateAbsolutePosition() OVERRIDE;
+};   // LabelBillboard
+
+#endif
@@ -29,6 +29,10 @@
 #include <IMeshSceneNode.h>
 #include <IAnimatedMeshSceneNode.h>
 
+#include <math.h>
+
+const float LODNode::HYSTERESIS = 0.1f;
+
 /**
   * @param group_name Only useful for getGroupName()
   */
@@ -51,6 +55,9 @@ LODNode::LODNode(std::string group_name, scene::ISceneNode* parent,
 
     m_forced_lod = -1;
     m_last_tick = 0;
+    m_has_culling_box = false;
+    for (unsigned int i = 0; i < MAX_CAMERAS; i++)
+        m_current_level[i] = UNKNOWN_LEVEL;
 }
 
 LODNode::~LODNode()
@@ -62,8 +69,31 @@ void LODNode::render()
     //ISceneNode::render();
 }
 
-/** Returns the level to use, or -1 if the object is too far
- *  away.
+/** Returns the factor by which distances to objects seen by a camera must
+ *  be scaled so that an object has the same size on screen as in a full
+ *  screen view with a 75 degree field of view, which the LOD distances are
+ *  designed for. A smaller viewport (e.g. in split screen) or a narrower
+ *  field of view makes objects appear further away.
+ *  \param camera The camera, or NULL.
+ */
+float LODNode::getDistanceScale(Camera *camera)
+{
+    if (camera == NULL)
+        return 1.0f;
+    const float reference_height = (float)irr_driver->getActualScreenSize().Height;
+    const float height = (float)camera->getViewport().getHeight();
+    const float fov = camera->getCameraSceneNode()->getFOV();
+    if (height <= 0.0f || fov <= 0.0f)
+        return 1.0f;
+    return (reference_height / height) * tanf(0.5f * fov) /
+           tanf(0.5f * DEGREE_TO_RAD * 75.0f);
+}   // getDistanceScale
+
+// ---------------------------------------------------------------------------
+/** Returns the level to use, or -1 if the object is too far away. The level
+ *  depends on the size of the object on screen, and the previous level is
+ *  kept until the distance is significantly beyond the transition distance,
+ *  so that objects do not flicker between two levels.
  */
 int LODNode::getLevel()
 {
@@ -84,16 +114,44 @@ int LODNode::getLevel()
     // in objects being culled when they shouldn't
     const Vec3 &pos = (kart != NULL ? kart->getFrontXYZ() : camera->getCameraSceneNode()->getAbsolutePosition());
 
-    const int dist =
-        (int)((m_nodes[0]->getAbsolutePosition()).getDistanceFromSQ(pos.toIrrVector() ));
+    const float scale = getDistanceScale(camera);
+    const float dist = scale * scale *
+        (m_nodes[0]->getAbsolutePosition()).getDistanceFromSQ(pos.toIrrVector());
 
+    int level = -1;
     for (unsigned int n=0; n<m_detail.size(); n++)
     {
         if (dist < m_detail[n])
-            return n;
+        {
+            level = n;
+            break;
+        }
     }
 
-    return -1;
+    const unsigned int index = (unsigned int)camera->getIndex();
+    if (index >= MAX_CAMERAS)
+        return level;
+    int &current = m_current_level[index];
+    const int last = (int)m_detail.size() - 1;
+    // Coarser levels (including hiding the object, -1) are only used once
+    // the distance is beyond the transition distance plus the hysteresis,
+    // finer levels once it is below it minus the hysteresis.
+    if (current >= 0 && (level > current || level == -1))
+    {
+        const float d = (1.0f + HYSTERESIS) * (1.0f + HYSTERESIS);
+        if (dist < m_detail[current] * d)
+            level = current;
+    }
+    else if (level >= 0 && current != UNKNOWN_LEVEL &&
+             (level < current || current == -1) && current <= last)
+    {
+        const int boundary = current == -1 ? last : current - 1;
+        const float d = (1.0f - HYSTERESIS) * (1.0f - HYSTERESIS);
+        if (dist > m_detail[boundary] * d)
+            level = current;
+    }
+    current = level;
+    return level;
 }  // getLevel
 
 // ---------------------------------------------------------------------------
@@ -118,7 +176,8 @@ void LODNode::OnAnimate(u32 timeMs)
         if(level>=0)
             m_nodes[level]->OnAnimate(timeMs);
 
-        Box = m_nodes[m_detail.size()-1]->getBoundingBox();
+        if (!m_has_culling_box)
+            Box = m_nodes[m_detail.size()-1]->getBoundingBox();
 
         // If this node has children other than the LOD nodes, animate it
         core::list<ISceneNode*>::Iterator it;
@@ -31,6 +31,8 @@ namespace irr
 }
 using namespace irr;
 
+class Camera;
+
 #include <set>
 
 namespace irr
@@ -58,6 +60,9 @@ private:
 
     std::string m_group_name;
 
+    /** True if Box was set with setCullingBox, see there. */
+    bool m_has_culling_box;
+
     /** The normal level of detail can be overwritten. If
      *  m_forced_lod is >=0, only this level is be used. */
     int m_forced_lod;
@@ -73,6 +78,22 @@ private:
 
     u32 m_last_tick;
 
+    /** Maximum number of cameras the current level is remembered for. */
+    static const unsigned int MAX_CAMERAS = 4;
+
+    /** Value of m_current_level before a level was selected. */
+    static const int UNKNOWN_LEVEL = -2;
+
+    /** The level last used for each camera, used to avoid switching back
+     *  and forth between two levels at the transition distance. */
+    int m_current_level[MAX_CAMERAS];
+
+    /** Relative change of distance beyond a transition distance needed to
+     *  switch to another level. */
+    static const float HYSTERESIS;
+
+    static float getDistanceScale(Camera *camera);
+
 public:
 
     LODNode(std::string group_name, scene::ISceneNode* parent, scene::ISceneManager* mgr, s32 id=-1);
@@ -115,6 +136,20 @@ public:
 
     std::vector<scene::ISceneNode*>& getAllNodes() { return m_nodes; }
 
+    // ------------------------------------------------------------------------
+    /** Sets a bounding box which contains this node and all its children
+     *  (e.g. a kart and its wheels). The renderer then culls this box once,
+     *  and children with automatic culling disabled use this result instead
+     *  of being culled on their own. */
+    void setCullingBox(const core::aabbox3df &box)
+    {
+        Box = box;
+        m_has_culling_box = true;
+    }   // setCullingBox
+    // ------------------------------------------------------------------------
+    /** Returns true if a culling box was set, see setCullingBox. */
+    bool hasCullingBox() const { return m_has_culling_box; }
+
     //! OnAnimate() is called just before rendering the whole scene.
     /** This method will be called once per frame, independent
         of whether the scene node is visible or not. */
@@ -59,41 +59,88 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_name_index.clear();
+    m_path_index.clear();
 }   // ~MaterialManager
 
 //-----------------------------------------------------------------------------
+/** Adds the material with the given index in m_materials to the indices
+ *  by name and full path. Must be called whenever a material is added.
+ *  \param i Index of the material, which must be the last one.
+ */
+void MaterialManager::addToIndex(int i)
+{
+    m_name_index[StringId::intern(m_materials[i]->getTexFname())].push_back(i);
+    m_path_index[StringId(m_materials[i]->getTexFullPath())].push_back(i);
+}   // addToIndex
+
+//-----------------------------------------------------------------------------
+/** Removes the last material from the indices by name and full path.
+ *  \param i Index of the material, which must be the last one.
+ */
+void MaterialManager::removeFromIndex(int i)
+{
+    MaterialIndex *all_index[2] = { &m_name_index, &m_path_index };
+    const std::string *all_keys[2] = { &m_materials[i]->getTexFname(),
+                                       &m_materials[i]->getTexFullPath() };
+    for (unsigned int n = 0; n < 2; n++)
+    {
+        MaterialIndex::iterator it = all_index[n]->find(StringId(*all_keys[n]));
+        assert(it != all_index[n]->end() && it->second.back() == i);
+        it->second.pop_back();
+        if (it->second.empty())
+            all_index[n]->erase(it);
+    }
+}   // removeFromIndex
 
+//-----------------------------------------------------------------------------
+/** Returns the last added material with the given texture name, or NULL if
+ *  there is none. Searching for the last one makes sure that temporary
+ *  (track) textures are found first.
+ *  \param name The name of the texture.
+ *  \param full_path True if name is the full path of the texture, false if
+ *         it is the basename.
+ */
+Material *MaterialManager::findMaterial(const std::string &name,
+                                        bool full_path) const
+{
+    const MaterialIndex &index = full_path ? m_path_index : m_name_index;
+    MaterialIndex::const_iterator it = index.find(StringId(name));
+    if (it == index.end())
+        return NULL;
+    // Different names can have the same id, so the names must be compared
+    for (int i = (int)it->second.size() - 1; i >= 0; i--)
+    {
+        Material *m = m_materials[it->second[i]];
+        if ((full_path ? m->getTexFullPath() : m->getTexFname()) == name)
+            return m;
+    }
+    return NULL;
+}   // findMaterial
+
+//-----------------------------------------------------------------------------
+/** Returns the material for a texture. This is called for each mesh buffer
+ *  while loading, so it only does hash lookups (see findMaterial). If the
+ *  texture name contains a path, the material with this full path is used,
+ *  otherwise the material with this basename.
+ *  \param t The texture.
+ *  \param mb The mesh buffer using the texture (unused).
+ *  \return The material, or the default material if none was found.
+ */
 Material* MaterialManager::getMaterialFor(video::ITexture* t,
                                           scene::IMeshBuffer *mb)
 {
     if (t == NULL)
         return m_default_material;
 
-    core::stringc img_path = core::stringc(t->getName());
-    const std::string image = StringUtils::getBasename(img_path.c_str());
-    if (!img_path.empty() && (img_path.findFirst('/') != -1 || img_path.findFirst('\\') != -1))
-    {
-        // Search backward so that temporary (track) textures are found first
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFullPath() == img_path.c_str())
-            {
-                return m_materials[i];
-            }
-        }
-    }
+    const core::stringc img_path = core::stringc(t->getName());
+    Material *m;
+    if (img_path.findFirst('/') != -1 || img_path.findFirst('\\') != -1)
+        m = findMaterial(img_path.c_str(), /*full_path*/true);
     else
-    {
-        for (int i = (int)m_materials.size() - 1; i >= 0; i--)
-        {
-            if (m_materials[i]->getTexFname() == image)
-            {
-                return m_materials[i];
-            }
-        }   // for i
-    }
-    return m_default_material;
-}
+        m = findMaterial(img_path.c_str(), /*full_path*/false);
+    return m ? m : m_default_material;
+}   // getMaterialFor
 
 //-----------------------------------------------------------------------------
 /** Searches for the material in the given texture, and calls a function
@@ -164,15 +211,9 @@ void MaterialManager::adjustForFog(video::ITexture* t,
                                    bool use_fog) const
 {
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            m_materials[i]->adjustForFog(parent, &(mb->getMaterial()), use_fog);
-            return;
-        }
-    }   // for i
+    Material *m = findMaterial(image, /*full_path*/false);
+    if (m)
+        m->adjustForFog(parent, &(mb->getMaterial()), use_fog);
 }   // adjustForFog
 
 //-----------------------------------------------------------------------------
@@ -199,6 +240,7 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb)
 int MaterialManager::addEntity(Material *m)
 {
     m_materials.push_back(m);
+    addToIndex((int)m_materials.size()-1);
     return (int)m_materials.size()-1;
 }
 
@@ -270,6 +312,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         try
         {
             m_materials.push_back(new Material(node, deprecated));
+            addToIndex((int)m_materials.size()-1);
         }
         catch(std::exception& e)
         {
@@ -286,6 +329,7 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
+        removeFromIndex(i);
         delete m_materials[i];
         m_materials.pop_back();
     }   // for i6
@@ -329,15 +373,13 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     else
         basename = fname;
         
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return m_materials[i];
-    }
+    Material *m = findMaterial(basename, /*full_path*/false);
+    if(m) return m;
 
     // Add the new material
-    Material* m = new Material(fname, is_full_path, complain_if_not_found);
+    m = new Material(fname, is_full_path, complain_if_not_found);
     m_materials.push_back(m);
+    addToIndex((int)m_materials.size()-1);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -360,10 +402,5 @@ bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
 
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return findMaterial(basename, /*full_path*/false) != NULL;
 }
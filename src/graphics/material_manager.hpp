@@ -29,7 +29,10 @@ namespace irr
 }
 using namespace irr;
 
+#include "utils/string_id.hpp"
+
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Material;
@@ -48,6 +51,20 @@ private:
 
     std::vector<Material*> m_materials;
 
+    typedef std::unordered_map<StringId, std::vector<int> > MaterialIndex;
+
+    /** For each texture name the indices of all materials in m_materials
+     *  with this name (in increasing order), so that a material can be
+     *  found without comparing the name of each material. */
+    MaterialIndex m_name_index;
+
+    /** The same as m_name_index for the full path of each texture. */
+    MaterialIndex m_path_index;
+
+    void      addToIndex(int i);
+    void      removeFromIndex(int i);
+    Material *findMaterial(const std::string &name, bool full_path) const;
+
     Material* m_default_material;
 
 public:
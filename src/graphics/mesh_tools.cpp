@@ -23,9 +23,12 @@
 #include <IMeshBuffer.h>
 #include "utils/log.hpp"
 #include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "tracks/track.hpp"
 
+#include <fstream>
+
 void MeshTools::minMax3D(scene::IMesh* mesh, Vec3 *min, Vec3 *max) {
 
     Vec3 extend;
@@ -332,7 +335,151 @@ bool MeshTools::isNormalMap(scene::IMeshBuffer* mb)
         mb->getVertexType() != video::EVT_TANGENTS);
 }
 
-// Copied from irrlicht
+// ----------------------------------------------------------------------------
+/** Identifies the version of the mesh cache files, must be increased when
+ *  the format or the tangent computation changes. */
+static const int MESH_CACHE_VERSION = 1;
+
+/** Returns a bit set of the parameters of createMeshWithTangents that
+ *  change the result, so that a cache file is only used with the same
+ *  parameters. */
+static int getTangentFlags(bool recalculateNormals, bool smooth,
+                           bool angleWeighted, bool calculateTangents)
+{
+    return (recalculateNormals ? 1 : 0) | (smooth        ? 2 : 0) |
+           (angleWeighted      ? 4 : 0) | (calculateTangents ? 8 : 0);
+}   // getTangentFlags
+
+// ----------------------------------------------------------------------------
+/** Tries to load the tangent mesh buffers of a mesh from the cache. The
+ *  cached data can be used directly as vertex and index arrays, so neither
+ *  the vertex welding nor the tangent computation is needed. The cache is
+ *  only used if it was created from a mesh with the same buffers.
+ *  
+ote The format of the cache file is:<br>
+ *        <version><sizeof vertex><flags><buffer count> and then for each
+ *        buffer <buffer index><original index count><vertex count>
+ *        <index count><vertices><indices>. All values but vertices and
+ *        indices are integers.
+ *  \param cached_file Name of the cache file.
+ *  \param mesh The original mesh.
+ *  \param predicate Selects the buffers that are converted.
+ *  \param flags The tangent parameters, see getTangentFlags.
+ *  \param buffers On success the converted buffers, NULL for buffers that
+ *         are not converted.
+ *  
+eturn True if the cache could be used.
+ */
+static bool loadTangentMeshCache(const std::string &cached_file,
+                                 scene::IMesh *mesh,
+                                 bool(*predicate)(scene::IMeshBuffer*),
+                                 int flags,
+                                 std::vector<scene::SMeshBufferTangents*> *buffers)
+{
+    std::ifstream ifs(cached_file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    int header[4] = { -1, -1, -1, -1 };
+    ifs.read((char*)header, sizeof(header));
+    if (ifs.fail() || header[0] != MESH_CACHE_VERSION ||
+        header[1] != (int)sizeof(video::S3DVertexTangents) ||
+        header[2] != flags ||
+        header[3] != (int)mesh->getMeshBufferCount())
+        return false;
+
+    buffers->resize(mesh->getMeshBufferCount(), NULL);
+    bool ok = true;
+    for (u32 b = 0; ok && b < mesh->getMeshBufferCount(); b++)
+    {
+        scene::IMeshBuffer *original = mesh->getMeshBuffer(b);
+        if (!predicate(original))
+            continue;
+
+        int info[4] = { -1, -1, -1, -1 };
+        ifs.read((char*)info, sizeof(info));
+        if (ifs.fail() || info[0] != (int)b ||
+            info[1] != (int)original->getIndexCount() ||
+            info[2] < 0 || info[3] < 0)
+        {
+            ok = false;
+            break;
+        }
+
+        scene::SMeshBufferTangents* buffer = new scene::SMeshBufferTangents();
+        buffer->Material = original->getMaterial();
+        buffer->Vertices.set_used(info[2]);
+        buffer->Indices.set_used(info[3]);
+        ifs.read((char*)buffer->Vertices.pointer(),
+                 info[2] * sizeof(video::S3DVertexTangents));
+        ifs.read((char*)buffer->Indices.pointer(), info[3] * sizeof(u16));
+        (*buffers)[b] = buffer;
+        ok = !ifs.fail();
+    }
+
+    if (!ok)
+    {
+        for (unsigned int i = 0; i < buffers->size(); i++)
+        {
+            if ((*buffers)[i])
+                (*buffers)[i]->drop();
+        }
+        buffers->clear();
+        Log::warn("MeshTools", "Mesh cache '%s' is invalid.",
+                  cached_file.c_str());
+    }
+    return ok;
+}   // loadTangentMeshCache
+
+// ----------------------------------------------------------------------------
+/** Saves the converted buffers of a mesh in the cache.
+ *  \param cached_file Name of the cache file.
+ *  \param mesh The original mesh.
+ *  \param clone The mesh with the converted buffers, the buffer indices are
+ *         the same as in the original mesh.
+ *  \param predicate Selects the buffers that were converted.
+ *  \param flags The tangent parameters, see getTangentFlags.
+ *  \see loadTangentMeshCache
+ */
+static void saveTangentMeshCache(const std::string &cached_file,
+                                 scene::IMesh *mesh, scene::IMesh *clone,
+                                 bool(*predicate)(scene::IMeshBuffer*),
+                                 int flags)
+{
+    std::ofstream ofs(cached_file.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return;
+
+    int header[4] = { MESH_CACHE_VERSION,
+                      (int)sizeof(video::S3DVertexTangents), flags,
+                      (int)mesh->getMeshBufferCount() };
+    ofs.write((char*)header, sizeof(header));
+    for (u32 b = 0; b < mesh->getMeshBufferCount(); b++)
+    {
+        scene::IMeshBuffer *original = mesh->getMeshBuffer(b);
+        if (!predicate(original))
+            continue;
+        scene::IMeshBuffer *buffer = clone->getMeshBuffer(b);
+        int info[4] = { (int)b, (int)original->getIndexCount(),
+                        (int)buffer->getVertexCount(),
+                        (int)buffer->getIndexCount() };
+        ofs.write((char*)info, sizeof(info));
+        ofs.write((char*)buffer->getVertices(),
+                  buffer->getVertexCount() * sizeof(video::S3DVertexTangents));
+        ofs.write((char*)buffer->getIndices(),
+                  buffer->getIndexCount() * sizeof(u16));
+    }
+    ofs.close();
+    if (ofs.fail())
+        file_manager->removeFile(cached_file);
+}   // saveTangentMeshCache
+
+// ----------------------------------------------------------------------------
+/** Creates a copy of a mesh in which all buffers selected by the predicate
+ *  use vertices with tangents. If the mesh was loaded from a file, the
+ *  converted buffers are cached in a binary file, so the next time the
+ *  mesh is loaded the (slow) conversion is not needed anymore.
+ *  Copied from irrlicht. */
 scene::IMesh* MeshTools::createMeshWithTangents(scene::IMesh* mesh, bool(*predicate)(scene::IMeshBuffer*),
     bool recalculateNormals, bool smooth, bool angleWeighted, bool calculateTangents)
 {
@@ -360,6 +507,24 @@ scene::IMesh* MeshTools::createMeshWithTangents(scene::IMesh* mesh, bool(*predic
         return mesh;
     }
 
+    scene::IMeshCache* meshCache = irr_driver->getSceneManager()->getMeshCache();
+    io::SNamedPath path = meshCache->getMeshName(mesh);
+    const std::string filename = path.getPath().c_str();
+    const int flags = getTangentFlags(recalculateNormals, smooth,
+                                      angleWeighted, calculateTangents);
+    std::string cached_file;
+    std::vector<scene::SMeshBufferTangents*> cached_buffers;
+    if (!filename.empty() && file_manager->fileExists(filename))
+    {
+        cached_file = file_manager->getMeshCacheLocation(filename) + ".stkm";
+        if (!file_manager->fileIsNewer(filename, cached_file))
+        {
+            loadTangentMeshCache(cached_file, mesh, predicate, flags,
+                                 &cached_buffers);
+        }
+    }
+    const bool from_cache = !cached_buffers.empty();
+
     for (u32 b = 0; b<meshBufferCount; ++b)
     {
         scene::IMeshBuffer* original = mesh->getMeshBuffer(b);
@@ -372,6 +537,14 @@ scene::IMesh* MeshTools::createMeshWithTangents(scene::IMesh* mesh, bool(*predic
             continue;
         }
 
+        if (from_cache)
+        {
+            cached_buffers[b]->recalculateBoundingBox();
+            clone->addMeshBuffer(cached_buffers[b]);
+            cached_buffers[b]->drop();
+            continue;
+        }
+
         scene::SMeshBufferTangents* buffer = new scene::SMeshBufferTangents();
 
         buffer->Material = original->getMaterial();
@@ -436,9 +609,14 @@ scene::IMesh* MeshTools::createMeshWithTangents(scene::IMesh* mesh, bool(*predic
     }
 
     clone->recalculateBoundingBox();
-    if (calculateTangents)
-        recalculateTangents(clone, recalculateNormals, smooth, angleWeighted);
-    
+    if (!from_cache)
+    {
+        if (calculateTangents)
+            recalculateTangents(clone, recalculateNormals, smooth, angleWeighted);
+        if (!cached_file.empty())
+            saveTangentMeshCache(cached_file, mesh, clone, predicate, flags);
+    }
+
     int mbcount = clone->getMeshBufferCount();
     for (int i = 0; i < mbcount; i++)
     {
@@ -452,8 +630,6 @@ scene::IMesh* MeshTools::createMeshWithTangents(scene::IMesh* mesh, bool(*predic
         }
     }
 
-    scene::IMeshCache* meshCache = irr_driver->getSceneManager()->getMeshCache();
-    io::SNamedPath path = meshCache->getMeshName(mesh);
     irr_driver->removeMeshFromCache(mesh);
 
     scene::SAnimatedMesh* amesh = new scene::SAnimatedMesh(clone);
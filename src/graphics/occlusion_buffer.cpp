@@ -0,0 +1,241 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+OcclusionBuffer::OcclusionBuffer()
+{
+    m_width = m_height = 0;
+    m_depth_width = m_depth_height = 0;
+    m_shift = 0;
+    m_valid = false;
+    m_age = 0;
+    m_pbo = 0;
+    m_fence = 0;
+    m_pending_width = m_pending_height = m_pending_shift = 0;
+    m_pending_depth_width = m_pending_depth_height = 0;
+}   // OcclusionBuffer
+
+// ----------------------------------------------------------------------------
+OcclusionBuffer::~OcclusionBuffer()
+{
+    if (m_fence)
+        glDeleteSync(m_fence);
+    if (m_pbo)
+        glDeleteBuffers(1, &m_pbo);
+}   // ~OcclusionBuffer
+
+// ----------------------------------------------------------------------------
+/** Starts downloading a low resolution level of the depth pyramid. Nothing
+ *  is done if the previous download has not been received yet.
+ *  \param pyramid The depth pyramid texture.
+ *  \param levels Number of levels of the pyramid.
+ *  \param depth_width, depth_height Size of the depth buffer the pyramid was
+ *         built from; level l has a size of (depth_width >> (l+1)) x
+ *         (depth_height >> (l+1)).
+ *  \param matrix The view projection matrix of the depth buffer.
+ */
+void OcclusionBuffer::requestDownload(GLuint pyramid, unsigned int levels,
+                                      unsigned int depth_width,
+                                      unsigned int depth_height,
+                                      const core::matrix4 &matrix)
+{
+    if (m_fence || levels == 0)
+        return;
+
+    unsigned int level = 0;
+    while (level + 1 < levels && (depth_width >> (level + 1)) > MAX_WIDTH)
+        level++;
+    m_pending_shift        = level + 1;
+    m_pending_width        = std::max(depth_width  >> m_pending_shift, 1u);
+    m_pending_height       = std::max(depth_height >> m_pending_shift, 1u);
+    m_pending_depth_width  = depth_width;
+    m_pending_depth_height = depth_height;
+    m_pending_matrix       = matrix;
+
+    if (!m_pbo)
+        glGenBuffers(1, &m_pbo);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER,
+                 m_pending_width * m_pending_height * sizeof(float), 0,
+                 GL_STREAM_READ);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glGetTexImage(GL_TEXTURE_2D, level, GL_RED, GL_FLOAT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}   // requestDownload
+
+// ----------------------------------------------------------------------------
+/** Called once per frame before culling: copies a finished download into
+ *  the CPU buffer without waiting for the GPU. Depth that has not been
+ *  updated for a few frames is discarded.
+ */
+void OcclusionBuffer::update()
+{
+    m_age++;
+    if (m_fence)
+    {
+        GLenum status = glClientWaitSync(m_fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+        {
+            glDeleteSync(m_fence);
+            m_fence = 0;
+            size_t size = m_pending_width * m_pending_height;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+            const float *data = (const float*)
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size * sizeof(float),
+                                 GL_MAP_READ_BIT);
+            if (data)
+            {
+                std::vector<float> depth(data, data + size);
+                setDepth(depth, m_pending_width, m_pending_height,
+                         m_pending_shift, m_pending_depth_width,
+                         m_pending_depth_height, m_pending_matrix);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        else if (status == GL_WAIT_FAILED)
+        {
+            glDeleteSync(m_fence);
+            m_fence = 0;
+        }
+    }
+    if (m_age > 3)
+        m_valid = false;
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Sets the depth used for occlusion tests.
+ *  \param depth Maximum depth of each texel, bottom row first.
+ *  \param width, height Size of the depth data.
+ *  \param shift Each texel covers 2^shift x 2^shift pixels of the depth
+ *         buffer.
+ *  \param depth_width, depth_height Size of the depth buffer.
+ *  \param matrix View projection matrix the depth was rendered with.
+ */
+void OcclusionBuffer::setDepth(const std::vector<float> &depth,
+                               unsigned int width, unsigned int height,
+                               unsigned int shift, unsigned int depth_width,
+                               unsigned int depth_height,
+                               const core::matrix4 &matrix)
+{
+    assert(depth.size() == width * height);
+    m_depth        = depth;
+    m_width        = width;
+    m_height       = height;
+    m_shift        = shift;
+    m_depth_width  = depth_width;
+    m_depth_height = depth_height;
+    m_matrix       = matrix;
+    m_valid        = true;
+    m_age          = 0;
+}   // setDepth
+
+// ----------------------------------------------------------------------------
+/** Tests if an oriented box is hidden behind the stored depth. The test is
+ *  conservative: boxes crossing the near plane or the screen border, or which
+ *  are too large on screen, are never considered occluded.
+ *  \param center Center of the box in world space.
+ *  \param axis The three half axes of the box in world space.
+ */
+bool OcclusionBuffer::isOccluded(const core::vector3df &center,
+                                 const core::vector3df axis[3]) const
+{
+    if (!m_valid)
+        return false;
+
+    float xmin = 1.0f, ymin = 1.0f, xmax = 0.0f, ymax = 0.0f, zmin = 1.0f;
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        core::vector3df corner = center;
+        corner += (i & 1) ? axis[0] : -axis[0];
+        corner += (i & 2) ? axis[1] : -axis[1];
+        corner += (i & 4) ? axis[2] : -axis[2];
+        float clip[4];
+        m_matrix.transformVect(clip, corner);
+        if (clip[3] <= 1e-4f)
+            return false;
+        const float x = clip[0] / clip[3] * 0.5f + 0.5f;
+        const float y = clip[1] / clip[3] * 0.5f + 0.5f;
+        const float z = clip[2] / clip[3] * 0.5f + 0.5f;
+        xmin = std::min(xmin, x);
+        xmax = std::max(xmax, x);
+        ymin = std::min(ymin, y);
+        ymax = std::max(ymax, y);
+        zmin = std::min(zmin, z);
+    }
+    if (xmin < 0.0f || ymin < 0.0f || xmax > 1.0f || ymax > 1.0f)
+        return false;
+
+    // The last texel of a row or column also covers the remaining pixels
+    const int x0 = std::min((int)(xmin * m_depth_width ) >> m_shift, (int)m_width  - 1);
+    const int x1 = std::min((int)(xmax * m_depth_width ) >> m_shift, (int)m_width  - 1);
+    const int y0 = std::min((int)(ymin * m_depth_height) >> m_shift, (int)m_height - 1);
+    const int y1 = std::min((int)(ymax * m_depth_height) >> m_shift, (int)m_height - 1);
+    if ((unsigned int)((x1 - x0 + 1) * (y1 - y0 + 1)) > MAX_TEXELS)
+        return false;
+
+    for (int y = y0; y <= y1; y++)
+    {
+        const float *row = &m_depth[y * m_width];
+        for (int x = x0; x <= x1; x++)
+        {
+            if (row[x] >= zmin)
+                return false;
+        }
+    }
+    return true;
+}   // isOccluded
+
+// ----------------------------------------------------------------------------
+/** Tests the occlusion test with a synthetic depth buffer. */
+void OcclusionBuffer::unitTesting()
+{
+    OcclusionBuffer ob;
+    core::vector3df axis[3] = { core::vector3df(0.1f, 0, 0),
+                                core::vector3df(0, 0.1f, 0),
+                                core::vector3df(0, 0, 0.05f) };
+    // No depth yet: nothing is occluded
+    assert(!ob.isOccluded(core::vector3df(0, 0, 0.8f), axis));
+
+    // With an identity matrix, x/y/z are normalised device coordinates.
+    // A wall at depth 0.75 (z=0.5) on the left half of the screen.
+    std::vector<float> depth(8 * 8, 1.0f);
+    for (unsigned int y = 0; y < 8; y++)
+        for (unsigned int x = 0; x < 4; x++)
+            depth[y * 8 + x] = 0.75f;
+    ob.setDepth(depth, 8, 8, 1, 16, 16, core::matrix4());
+
+    // Behind the wall
+    assert( ob.isOccluded(core::vector3df(-0.5f, 0, 0.8f), axis));
+    // In front of the wall
+    assert(!ob.isOccluded(core::vector3df(-0.5f, 0, 0.2f), axis));
+    // Behind, but next to the wall
+    assert(!ob.isOccluded(core::vector3df(0.5f, 0, 0.8f), axis));
+    // Partly behind the wall
+    assert(!ob.isOccluded(core::vector3df(0.0f, 0, 0.8f), axis));
+    // Crossing the screen border
+    assert(!ob.isOccluded(core::vector3df(-0.95f, 0, 0.8f), axis));
+
+    ob.invalidate();
+    assert(!ob.isOccluded(core::vector3df(-0.5f, 0, 0.8f), axis));
+}   // unitTesting
@@ -0,0 +1,107 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_OCCLUSION_BUFFER_HPP
+#define HEADER_OCCLUSION_BUFFER_HPP
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+
+#include "matrix4.h"
+#include "vector3d.h"
+
+#include <vector>
+
+using namespace irr;
+
+/**
+  * \brief A low resolution copy of the depth pyramid on the CPU, used to
+  *  reject occluded scene nodes before they are added to the draw lists.
+  *  The copy is downloaded asynchronously, so it usually contains the depth
+  *  of the frame before the previous one. Boxes are projected with the
+  *  matrix the depth was rendered with, so a slightly old depth buffer only
+  *  means that nodes becoming visible might appear a frame late.
+  * \ingroup graphics
+  */
+class OcclusionBuffer : public NoCopy
+{
+private:
+    /** Maximum depth of each texel, row 0 is the bottom of the screen. */
+    std::vector<float> m_depth;
+
+    /** Size of the CPU copy. */
+    unsigned int m_width, m_height;
+
+    /** Size of the depth buffer the pyramid was built from. */
+    unsigned int m_depth_width, m_depth_height;
+
+    /** A texel of the copy covers 2^m_shift pixels of the depth buffer in
+     *  each direction. */
+    unsigned int m_shift;
+
+    /** The view projection matrix the depth was rendered with. */
+    core::matrix4 m_matrix;
+
+    /** True if m_depth can be used. */
+    bool m_valid;
+
+    /** Number of frames since m_depth was updated. */
+    unsigned int m_age;
+
+    /** Pixel buffer the pyramid level is downloaded to. */
+    GLuint m_pbo;
+
+    /** Fence of the pending download, or 0. */
+    GLsync m_fence;
+
+    /** Parameters of the pending download. */
+    unsigned int  m_pending_width, m_pending_height, m_pending_shift;
+    unsigned int  m_pending_depth_width, m_pending_depth_height;
+    core::matrix4 m_pending_matrix;
+
+public:
+    /** Maximum number of texels a box can cover to be tested: larger boxes
+     *  are very unlikely to be occluded, and this bounds the cost of the
+     *  test. */
+    static const unsigned int MAX_TEXELS = 256;
+
+    /** Largest width of the pyramid level copied to the CPU. */
+    static const unsigned int MAX_WIDTH = 160;
+
+         OcclusionBuffer();
+        ~OcclusionBuffer();
+    void requestDownload(GLuint pyramid, unsigned int levels,
+                         unsigned int depth_width, unsigned int depth_height,
+                         const core::matrix4 &matrix);
+    void update();
+    void setDepth(const std::vector<float> &depth, unsigned int width,
+                  unsigned int height, unsigned int shift,
+                  unsigned int depth_width, unsigned int depth_height,
+                  const core::matrix4 &matrix);
+    bool isOccluded(const core::vector3df &center,
+                    const core::vector3df axis[3]) const;
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Discards the current depth, e.g. after the camera changed. */
+    void invalidate() { m_valid = false; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the buffer contains usable depth information. */
+    bool isValid() const { return m_valid; }
+};   // OcclusionBuffer
+
+#endif
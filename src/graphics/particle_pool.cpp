@@ -0,0 +1,242 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/particle_pool.hpp"
+
+#include "graphics/gpuparticles.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+unsigned int ParticlePool::m_pool_count = 0;
+unsigned int ParticlePool::m_current_id = 0;
+
+ParticlePool::ParticlePool()
+{
+    for (unsigned int i = 0; i < PB_COUNT; i++)
+        m_buffers[i] = 0;
+    m_vao[0] = m_vao[1] = 0;
+    m_capacity = 0;
+    m_id = ++m_pool_count;
+    m_current_id = m_id;
+}   // ParticlePool
+
+// ----------------------------------------------------------------------------
+ParticlePool::~ParticlePool()
+{
+    if (m_vao[0])
+        glDeleteVertexArrays(2, m_vao);
+    for (unsigned int i = 0; i < PB_COUNT; i++)
+    {
+        if (m_buffers[i])
+            glDeleteBuffers(1, &m_buffers[i]);
+    }
+    if (m_current_id == m_id)
+        m_current_id = 0;
+}   // ~ParticlePool
+
+// ----------------------------------------------------------------------------
+size_t ParticlePool::getElementSize(PoolBuffer buffer)
+{
+    switch (buffer)
+    {
+    case PB_SORT_KEYS:
+        return 2 * sizeof(float);
+    case PB_QUATERNIONS:
+        return 4 * sizeof(float);
+    default:
+        return sizeof(ParticleSystemProxy::ParticleData);
+    }
+}   // getElementSize
+
+// ----------------------------------------------------------------------------
+/** Takes the first free range large enough for the given number of particles.
+ *  \param count Number of particles.
+ *  \param offset Returns the first particle of the range.
+ *  \return False if no free range is large enough.
+ */
+bool ParticlePool::takeRange(unsigned int count, unsigned int *offset)
+{
+    std::map<unsigned int, unsigned int>::iterator it;
+    for (it = m_free_ranges.begin(); it != m_free_ranges.end(); it++)
+    {
+        if (it->second < count)
+            continue;
+        *offset = it->first;
+        unsigned int remaining = it->second - count;
+        m_free_ranges.erase(it);
+        if (remaining > 0)
+            m_free_ranges[*offset + count] = remaining;
+        return true;
+    }
+    return false;
+}   // takeRange
+
+// ----------------------------------------------------------------------------
+/** Adds a free range, merging it with the adjacent free ranges. */
+void ParticlePool::addRange(unsigned int offset, unsigned int count)
+{
+    std::map<unsigned int, unsigned int>::iterator next =
+        m_free_ranges.upper_bound(offset);
+    assert(next == m_free_ranges.end() || offset + count <= next->first);
+    if (next != m_free_ranges.end() && offset + count == next->first)
+    {
+        count += next->second;
+        m_free_ranges.erase(next);
+        next = m_free_ranges.upper_bound(offset);
+    }
+    if (next != m_free_ranges.begin())
+    {
+        std::map<unsigned int, unsigned int>::iterator previous = next;
+        previous--;
+        assert(previous->first + previous->second <= offset);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += count;
+            return;
+        }
+    }
+    m_free_ranges[offset] = count;
+}   // addRange
+
+// ----------------------------------------------------------------------------
+/** Enlarges the buffers to hold at least the given number of particles.
+ *  Sort keys and sorted particles are rebuilt every frame, so only the
+ *  other buffers are copied.
+ */
+void ParticlePool::grow(unsigned int min_capacity)
+{
+    unsigned int capacity = std::max(2 * m_capacity, min_capacity);
+    if (capacity < INITIAL_CAPACITY)
+        capacity = INITIAL_CAPACITY;
+    glBindVertexArray(0);
+    for (unsigned int i = 0; i < PB_COUNT; i++)
+    {
+        size_t size = getElementSize((PoolBuffer)i);
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * size, 0, GL_DYNAMIC_COPY);
+        if (m_buffers[i])
+        {
+            if (i != PB_SORT_KEYS && i != PB_SORTED)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[i]);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                    0, 0, m_capacity * size);
+            }
+            glDeleteBuffers(1, &m_buffers[i]);
+        }
+        m_buffers[i] = buffer;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (m_vao[0])
+        glDeleteVertexArrays(2, m_vao);
+    glGenVertexArrays(2, m_vao);
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        glBindVertexArray(m_vao[i]);
+        ParticleSystemProxy::CommonRenderingVAO(m_buffers[i == 0 ? PB_PARTICLES
+                                                                 : PB_SORTED]);
+        ParticleSystemProxy::AppendQuaternionRenderingVAO(m_buffers[PB_QUATERNIONS]);
+    }
+    glBindVertexArray(0);
+
+    addRange(m_capacity, capacity - m_capacity);
+    m_capacity = capacity;
+    Log::debug("ParticlePool", "Pool resized to %u particles.", m_capacity);
+}   // grow
+
+// ----------------------------------------------------------------------------
+/** Allocates a range of particles, growing the pool if needed.
+ *  \param count Number of particles, must not be 0.
+ *  \return The first particle of the range.
+ */
+unsigned int ParticlePool::allocate(unsigned int count)
+{
+    assert(count > 0);
+    unsigned int offset;
+    if (!takeRange(count, &offset))
+    {
+        grow(m_capacity + count);
+        bool found = takeRange(count, &offset);
+        assert(found);
+    }
+    return offset;
+}   // allocate
+
+// ----------------------------------------------------------------------------
+/** Gives a range returned by allocate() back to the pool. */
+void ParticlePool::release(unsigned int offset, unsigned int count)
+{
+    addRange(offset, count);
+}   // release
+
+// ----------------------------------------------------------------------------
+/** Copies data to a range of one of the buffers.
+ *  \param buffer The buffer to write to.
+ *  \param offset First particle to write.
+ *  \param count Number of particles to write.
+ *  \param data One element per particle.
+ */
+void ParticlePool::upload(PoolBuffer buffer, unsigned int offset,
+                          unsigned int count, const void *data)
+{
+    size_t size = getElementSize(buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffers[buffer]);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset * size, count * size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}   // upload
+
+// ----------------------------------------------------------------------------
+/** Binds the buffers used by the simulation and sorting shaders. */
+void ParticlePool::bindBuffers() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, m_buffers[PB_PARTICLES]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, m_buffers[PB_INITIAL_VALUES]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, m_buffers[PB_SORT_KEYS]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, m_buffers[PB_SORTED]);
+}   // bindBuffers
+
+// ----------------------------------------------------------------------------
+/** Tests allocating and merging ranges, without creating any GL object. */
+void ParticlePool::unitTesting()
+{
+    ParticlePool pool;
+    pool.addRange(0, 100);
+    unsigned int a, b, c, d;
+    assert(pool.takeRange(30, &a) && a == 0);
+    assert(pool.takeRange(30, &b) && b == 30);
+    assert(pool.takeRange(30, &c) && c == 60);
+    assert(!pool.takeRange(20, &d));
+
+    // A freed range in the middle is reused
+    pool.addRange(b, 30);
+    assert(pool.takeRange(20, &d) && d == 30);
+    assert(!pool.takeRange(20, &b));
+
+    // Freeing everything merges all ranges again
+    pool.addRange(d, 20);
+    pool.addRange(a, 30);
+    pool.addRange(c, 30);
+    assert(pool.m_free_ranges.size() == 1);
+    assert(pool.takeRange(100, &a) && a == 0);
+    assert(pool.m_free_ranges.empty());
+}   // unitTesting
@@ -0,0 +1,105 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_PARTICLE_POOL_HPP
+#define HEADER_PARTICLE_POOL_HPP
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/singleton.hpp"
+
+#include <map>
+
+/**
+  * \brief The buffers holding the particles of all emitters which are
+  *  simulated in compute shaders. Each emitter owns a range of the pool, so
+  *  emitters need no buffers or vertex arrays of their own and are drawn
+  *  with the first particle of their range as base instance. The pool grows
+  *  when a range does not fit, the existing particles are then copied.
+  * \ingroup graphics
+  */
+class ParticlePool : public Singleton<ParticlePool>, public NoCopy
+{
+public:
+    /** The buffers of the pool. All of them contain one element per
+     *  particle. PB_PARTICLES is bound as shader storage buffer 10,
+     *  PB_INITIAL_VALUES as 11, PB_SORT_KEYS as 12 and PB_SORTED as 13. */
+    enum PoolBuffer
+    {
+        PB_PARTICLES,
+        PB_INITIAL_VALUES,
+        PB_SORT_KEYS,
+        PB_SORTED,
+        PB_QUATERNIONS,
+        PB_COUNT
+    };
+
+private:
+    GLuint m_buffers[PB_COUNT];
+
+    /** Vertex arrays to draw from PB_PARTICLES and from PB_SORTED. */
+    GLuint m_vao[2];
+
+    /** Number of particles the buffers can hold. */
+    unsigned int m_capacity;
+
+    /** Free ranges of the pool: number of particles indexed by the first
+     *  particle of the range. Adjacent ranges are always merged. */
+    std::map<unsigned int, unsigned int> m_free_ranges;
+
+    /** Identifies this pool, so that emitters can tell if their range was
+     *  destroyed with a previous pool. */
+    unsigned int m_id;
+
+    /** Number of pools created so far. */
+    static unsigned int m_pool_count;
+
+    /** Id of the existing pool, or 0. */
+    static unsigned int m_current_id;
+
+    /** Capacity of the pool when the first range is allocated. */
+    static const unsigned int INITIAL_CAPACITY = 16384;
+
+    bool takeRange(unsigned int count, unsigned int *offset);
+    void addRange(unsigned int offset, unsigned int count);
+    void grow(unsigned int min_capacity);
+    static size_t getElementSize(PoolBuffer buffer);
+
+public:
+         ParticlePool();
+        ~ParticlePool();
+    unsigned int allocate(unsigned int count);
+    void release(unsigned int offset, unsigned int count);
+    void upload(PoolBuffer buffer, unsigned int offset, unsigned int count,
+                const void *data);
+    void bindBuffers() const;
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns the vertex array to draw particles, either as simulated or
+     *  in sorted order. */
+    GLuint getVAO(bool sorted) const { return m_vao[sorted ? 1 : 0]; }
+    // ------------------------------------------------------------------------
+    /** Returns the id of this pool. */
+    unsigned int getId() const { return m_id; }
+    // ------------------------------------------------------------------------
+    /** Returns the id of the existing pool, or 0 if there is none. Does not
+     *  create a pool. */
+    static unsigned int getCurrentId() { return m_current_id; }
+};   // ParticlePool
+
+#endif
@@ -68,6 +68,9 @@ public:
     //! Returns the relative transformation of the scene node.
     virtual core::matrix4 getRelativeTransformation() const { return RelativeTransformationMatrix; }
 
+    //! The matrix can be changed at any time with getRelativeTransformationMatrix
+    virtual bool hasDynamicRelativeTransformation() const { return true; }
+
     void setCamera(scene::ICameraSceneNode* camera);
 
     virtual void OnRegisterSceneNode();
@@ -38,6 +38,8 @@
 
 #include <SViewFrustum.h>
 
+#include <map>
+
 using namespace video;
 using namespace scene;
 
@@ -56,6 +58,8 @@ PostProcessing::PostProcessing(IVideoDriver* video_driver)
         m_material.TextureLayer[i].TextureWrapV = ETC_CLAMP_TO_EDGE;
         }
 
+    m_taa_history_valid = false;
+
     // Load the MLAA area map
     io::IReadFile *areamap = irr_driver->getDevice()->getFileSystem()->
                          createMemoryReadFile((void *) AreaMap33, sizeof(AreaMap33),
@@ -282,12 +286,20 @@ void PostProcessing::renderSunlight(const core::vector3df &direction, const vide
     DrawFullScreenEffect<FullScreenShader::SunLightShader>(direction, col);
 }
 
+/** Returns the weights of a separable gaussian kernel. Blurs only use a few
+ *  different sigmas, so the weights are computed once and cached instead of
+ *  being recomputed for every pass.
+ */
 static
-std::vector<float> getGaussianWeight(float sigma, size_t count)
+const std::vector<float> &getGaussianWeight(float sigma, size_t count)
 {
+    static std::map<std::pair<float, size_t>, std::vector<float> > cache;
+    std::vector<float> &weights = cache[std::make_pair(sigma, count)];
+    if (!weights.empty())
+        return weights;
+
     float g0, g1, g2, total;
 
-    std::vector<float> weights;
     g0 = 1.f / (sqrtf(2.f * 3.14f) * sigma);
     g1 = exp(-.5f / (sigma * sigma));
     g2 = g1 * g1;
@@ -308,18 +320,37 @@ void PostProcessing::renderGaussian3Blur(FrameBuffer &in_fbo, FrameBuffer &auxil
 {
     assert(in_fbo.getWidth() == auxiliary.getWidth() && in_fbo.getHeight() == auxiliary.getHeight());
     float inv_width = 1.0f / in_fbo.getWidth(), inv_height = 1.0f / in_fbo.getHeight();
+    if (!CVS->supportsComputeShadersFiltering())
     {
         auxiliary.Bind();
 
         FullScreenShader::Gaussian3VBlurShader::getInstance()->SetTextureUnits(in_fbo.getRTT()[0]);
         DrawFullScreenEffect<FullScreenShader::Gaussian3VBlurShader>(core::vector2df(inv_width, inv_height));
-    }
-    {
+
         in_fbo.Bind();
 
         FullScreenShader::Gaussian3HBlurShader::getInstance()->SetTextureUnits(auxiliary.getRTT()[0]);
         DrawFullScreenEffect<FullScreenShader::Gaussian3HBlurShader>(core::vector2df(inv_width, inv_height));
     }
+    else
+    {
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        glUseProgram(FullScreenShader::ComputeGaussian3VBlurShader::getInstance()->Program);
+        FullScreenShader::ComputeGaussian3VBlurShader::getInstance()->SetTextureUnits(in_fbo.getRTT()[0]);
+        glBindSampler(FullScreenShader::ComputeGaussian3VBlurShader::getInstance()->TU_dest, 0);
+        glBindImageTexture(FullScreenShader::ComputeGaussian3VBlurShader::getInstance()->TU_dest, auxiliary.getRTT()[0], 0, false, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        FullScreenShader::ComputeGaussian3VBlurShader::getInstance()->setUniforms();
+        glDispatchCompute((int)in_fbo.getWidth() / 8 + 1, (int)in_fbo.getHeight() / 8 + 1, 1);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glUseProgram(FullScreenShader::ComputeGaussian3HBlurShader::getInstance()->Program);
+        FullScreenShader::ComputeGaussian3HBlurShader::getInstance()->SetTextureUnits(auxiliary.getRTT()[0]);
+        glBindSampler(FullScreenShader::ComputeGaussian3HBlurShader::getInstance()->TU_dest, 0);
+        glBindImageTexture(FullScreenShader::ComputeGaussian3HBlurShader::getInstance()->TU_dest, in_fbo.getRTT()[0], 0, false, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        FullScreenShader::ComputeGaussian3HBlurShader::getInstance()->setUniforms();
+        glDispatchCompute((int)in_fbo.getWidth() / 8 + 1, (int)in_fbo.getHeight() / 8 + 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
 }
 
 void PostProcessing::renderGaussian6BlurLayer(FrameBuffer &in_fbo, size_t layer, float sigmaH, float sigmaV)
@@ -406,18 +437,36 @@ void PostProcessing::renderHorizontalBlur(FrameBuffer &in_fbo, FrameBuffer &auxi
 {
     assert(in_fbo.getWidth() == auxiliary.getWidth() && in_fbo.getHeight() == auxiliary.getHeight());
     float inv_width = 1.0f / in_fbo.getWidth(), inv_height = 1.0f / in_fbo.getHeight();
+    if (!CVS->supportsComputeShadersFiltering())
     {
         auxiliary.Bind();
 
         FullScreenShader::Gaussian6HBlurShader::getInstance()->SetTextureUnits(in_fbo.getRTT()[0]);
         DrawFullScreenEffect<FullScreenShader::Gaussian6HBlurShader>(core::vector2df(inv_width, inv_height), 2.0f);
-    }
-    {
+
         in_fbo.Bind();
 
         FullScreenShader::Gaussian6HBlurShader::getInstance()->SetTextureUnits(auxiliary.getRTT()[0]);
         DrawFullScreenEffect<FullScreenShader::Gaussian6HBlurShader>(core::vector2df(inv_width, inv_height), 2.0f);
     }
+    else
+    {
+        const std::vector<float> &weights = getGaussianWeight(2.0f, 7);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        glUseProgram(FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->Program);
+        glBindSampler(FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->TU_dest, 0);
+        FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->setUniforms(core::vector2df(inv_width, inv_height), weights);
+
+        FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->SetTextureUnits(in_fbo.getRTT()[0]);
+        glBindImageTexture(FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->TU_dest, auxiliary.getRTT()[0], 0, false, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((int)in_fbo.getWidth() / 8 + 1, (int)in_fbo.getHeight() / 8 + 1, 1);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->SetTextureUnits(auxiliary.getRTT()[0]);
+        glBindImageTexture(FullScreenShader::ComputeGaussian6HBlurShader::getInstance()->TU_dest, in_fbo.getRTT()[0], 0, false, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((int)in_fbo.getWidth() / 8 + 1, (int)in_fbo.getHeight() / 8 + 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
 }
 
 
@@ -474,6 +523,16 @@ void PostProcessing::renderPassThrough(GLuint tex, unsigned width, unsigned heig
     DrawFullScreenEffect<FullScreenShader::PassThroughShader>(width, height);
 }
 
+/** Upsamples a low resolution texture to the bound framebuffer. Low
+ *  resolution texels whose depth differs from the depth of the pixel are
+ *  ignored, so that the effect does not bleed over the edges of objects.
+ */
+void PostProcessing::renderBilateralUpsample(GLuint tex)
+{
+    FullScreenShader::BilateralUpsampleShader::getInstance()->SetTextureUnits(tex, irr_driver->getDepthStencilTexture());
+    DrawFullScreenEffect<FullScreenShader::BilateralUpsampleShader>();
+}
+
 void PostProcessing::renderTextureLayer(unsigned tex, unsigned layer)
 {
     glUseProgram(FullScreenShader::LayerPassThroughShader::getInstance()->Program);
@@ -499,7 +558,13 @@ void PostProcessing::renderGlow(unsigned tex)
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
-void PostProcessing::renderSSAO()
+/** Computes the ambient occlusion into a framebuffer.
+ *  \param out_fbo The framebuffer for the result, either at full or at half
+ *         resolution.
+ *  \param rotation Rotation of the sampling pattern in radians, changed every
+ *         frame when the occlusion is accumulated over several frames.
+ */
+void PostProcessing::renderSSAO(FrameBuffer &out_fbo, float rotation)
 {
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
@@ -508,12 +573,28 @@ void PostProcessing::renderSSAO()
     irr_driver->getFBO(FBO_LINEAR_DEPTH).Bind();
     FullScreenShader::LinearizeDepthShader::getInstance()->SetTextureUnits(irr_driver->getDepthStencilTexture());
     DrawFullScreenEffect<FullScreenShader::LinearizeDepthShader>(irr_driver->getSceneManager()->getActiveCamera()->getNearValue(), irr_driver->getSceneManager()->getActiveCamera()->getFarValue());
-    irr_driver->getFBO(FBO_SSAO).Bind();
+    out_fbo.Bind();
 
     FullScreenShader::SSAOShader::getInstance()->SetTextureUnits(irr_driver->getRenderTargetTexture(RTT_LINEAR_DEPTH));
     glGenerateMipmap(GL_TEXTURE_2D);
 
-    DrawFullScreenEffect<FullScreenShader::SSAOShader>(irr_driver->getSSAORadius(), irr_driver->getSSAOK(), irr_driver->getSSAOSigma());
+    DrawFullScreenEffect<FullScreenShader::SSAOShader>(irr_driver->getSSAORadius(), irr_driver->getSSAOK(), irr_driver->getSSAOSigma(),
+        core::vector2df((float)out_fbo.getWidth(), (float)out_fbo.getHeight()), rotation);
+}
+
+/** Blends the occlusion of the current frame with the occlusion of the
+ *  previous frames, reprojected with the projection-view matrix of the
+ *  previous frame, into the bound framebuffer.
+ *  \param current_ao The occlusion of the current frame.
+ *  \param history The accumulated occlusion of the previous frames.
+ *  \param previous_pv_matrix The projection-view matrix of the previous frame.
+ *  \param use_history False if history does not belong to the previous frame
+ *         of this camera, the current occlusion is then copied.
+ */
+void PostProcessing::renderSSAOAccumulation(GLuint current_ao, GLuint history, const core::matrix4 &previous_pv_matrix, bool use_history)
+{
+    FullScreenShader::SSAOAccumulationShader::getInstance()->SetTextureUnits(current_ao, history, irr_driver->getDepthStencilTexture());
+    DrawFullScreenEffect<FullScreenShader::SSAOAccumulationShader>(previous_pv_matrix, use_history ? .8f : 0.f);
 }
 
 void PostProcessing::renderMotionBlur(unsigned , FrameBuffer &in_fbo, FrameBuffer &out_fbo)
@@ -564,9 +645,24 @@ static void renderGodRay(GLuint tex, const core::vector2df &sunpos)
     DrawFullScreenEffect<FullScreenShader::GodRayShader>(sunpos);
 }
 
-static void toneMap(FrameBuffer &fbo, GLuint rtt, float vignette_weight)
+/** Tone maps rtt into fbo. If bloom is enabled the blurred bloom and lens
+ *  flare mips are added in the same pass. */
+static void toneMap(FrameBuffer &fbo, GLuint rtt, float vignette_weight,
+                    bool bloom)
 {
     fbo.Bind();
+    if (bloom)
+    {
+        FullScreenShader::ToneMapBloomShader::getInstance()->SetTextureUnits(
+            rtt, irr_driver->getRenderTargetTexture(RTT_BLOOM_128),
+            irr_driver->getRenderTargetTexture(RTT_BLOOM_256),
+            irr_driver->getRenderTargetTexture(RTT_BLOOM_512),
+            irr_driver->getRenderTargetTexture(RTT_LENS_128),
+            irr_driver->getRenderTargetTexture(RTT_LENS_256),
+            irr_driver->getRenderTargetTexture(RTT_LENS_512));
+        DrawFullScreenEffect<FullScreenShader::ToneMapBloomShader>(vignette_weight);
+        return;
+    }
     FullScreenShader::ToneMapShader::getInstance()->SetTextureUnits(rtt);
     DrawFullScreenEffect<FullScreenShader::ToneMapShader>(vignette_weight);
 }
@@ -580,7 +676,7 @@ static void renderDoF(FrameBuffer &fbo, GLuint rtt)
 
 void PostProcessing::applyMLAA()
 {
-    const core::vector2df &PIXEL_SIZE = core::vector2df(1.0f / UserConfigParams::m_width, 1.0f / UserConfigParams::m_height);
+    const core::vector2df &PIXEL_SIZE = core::vector2df(1.0f / irr_driver->getFBO(FBO_MLAA_TMP).getWidth(), 1.0f / irr_driver->getFBO(FBO_MLAA_TMP).getHeight());
 
     irr_driver->getFBO(FBO_MLAA_TMP).Bind();
     glEnable(GL_STENCIL_TEST);
@@ -619,6 +715,45 @@ void PostProcessing::applyMLAA()
     glDisable(GL_STENCIL_TEST);
 }
 
+// ----------------------------------------------------------------------------
+/** Single pass anti-aliasing, much cheaper than MLAA. Reads the colors from
+ *  FBO_MLAA_TMP and writes the result to FBO_MLAA_COLORS.
+ */
+void PostProcessing::applyFXAA()
+{
+    FrameBuffer &out_fbo = irr_driver->getFBO(FBO_MLAA_COLORS);
+    const core::vector2df pixel_size(1.0f / out_fbo.getWidth(),
+                                     1.0f / out_fbo.getHeight());
+    out_fbo.Bind();
+    FullScreenShader::FXAAShader::getInstance()->SetTextureUnits(
+        irr_driver->getRenderTargetTexture(RTT_MLAA_TMP));
+    DrawFullScreenEffect<FullScreenShader::FXAAShader>(pixel_size);
+}   // applyFXAA
+
+// ----------------------------------------------------------------------------
+/** Temporal anti-aliasing: blends the colors of this frame (read from
+ *  FBO_MLAA_TMP) with the previous frames, reprojected with the depth buffer,
+ *  and writes the result to FBO_MLAA_COLORS. The projection is jittered by
+ *  IrrDriver while temporal anti-aliasing is enabled.
+ *  \param previous_pv_matrix The projection-view matrix of the previous frame.
+ */
+void PostProcessing::applyTemporalAA(const core::matrix4 &previous_pv_matrix)
+{
+    // The history is shared by all cameras
+    const bool use_history = m_taa_history_valid && Camera::getNumCameras() == 1;
+    irr_driver->getFBO(FBO_MLAA_COLORS).Bind();
+    FullScreenShader::TemporalAAShader::getInstance()->SetTextureUnits(
+        irr_driver->getRenderTargetTexture(RTT_MLAA_TMP),
+        irr_driver->getRenderTargetTexture(RTT_TAA_HISTORY),
+        irr_driver->getDepthStencilTexture());
+    DrawFullScreenEffect<FullScreenShader::TemporalAAShader>(
+        previous_pv_matrix, use_history ? .9f : 0.f);
+    FrameBuffer::Blit(irr_driver->getFBO(FBO_MLAA_COLORS),
+                      irr_driver->getFBO(FBO_TAA_HISTORY),
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    m_taa_history_valid = Camera::getNumCameras() == 1;
+}   // applyTemporalAA
+
 // ----------------------------------------------------------------------------
 /** Render the post-processed scene */
 FrameBuffer *PostProcessing::render(scene::ICameraSceneNode * const camnode, bool isRace)
@@ -672,7 +807,6 @@ FrameBuffer *PostProcessing::render(scene::ICameraSceneNode * const camnode, boo
 
             // Fade to quarter
             irr_driver->getFBO(FBO_QUARTER1).Bind();
-            glViewport(0, 0, irr_driver->getActualScreenSize().Width / 4, irr_driver->getActualScreenSize().Height / 4);
             renderGodFade(out_fbo->getRTT()[0], col);
 
             // Blur
@@ -714,10 +848,11 @@ FrameBuffer *PostProcessing::render(scene::ICameraSceneNode * const camnode, boo
 
     // Simulate camera defects from there
 
+    const bool has_bloom = isRace && UserConfigParams::m_bloom;
     {
         PROFILER_PUSH_CPU_MARKER("- Bloom", 0xFF, 0x00, 0x00);
         ScopedGPUTimer Timer(irr_driver->getGPUTimer(Q_BLOOM));
-        if (isRace && UserConfigParams::m_bloom)
+        if (has_bloom)
         {
             glClear(GL_STENCIL_BUFFER_BIT);
             glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
@@ -745,76 +880,86 @@ FrameBuffer *PostProcessing::render(scene::ICameraSceneNode * const camnode, boo
             renderHorizontalBlur(irr_driver->getFBO(FBO_LENS_512), irr_driver->getFBO(FBO_TMP_512));
             renderHorizontalBlur(irr_driver->getFBO(FBO_LENS_256), irr_driver->getFBO(FBO_TMP_256));
             renderHorizontalBlur(irr_driver->getFBO(FBO_LENS_128), irr_driver->getFBO(FBO_TMP_128));
-            
-
-            // Additively blend on top of tmp1
-            in_fbo->Bind();
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE);
-            glBlendEquation(GL_FUNC_ADD);
-            
-            FullScreenShader::BloomBlendShader::getInstance()->SetTextureUnits(
-                irr_driver->getRenderTargetTexture(RTT_BLOOM_128), irr_driver->getRenderTargetTexture(RTT_BLOOM_256), irr_driver->getRenderTargetTexture(RTT_BLOOM_512));
-            DrawFullScreenEffect<FullScreenShader::BloomBlendShader>();
-
-            FullScreenShader::LensBlendShader::getInstance()->SetTextureUnits(
-                irr_driver->getRenderTargetTexture(RTT_LENS_128), irr_driver->getRenderTargetTexture(RTT_LENS_256), irr_driver->getRenderTargetTexture(RTT_LENS_512));
-            DrawFullScreenEffect<FullScreenShader::LensBlendShader>();
-
 
-            glDisable(GL_BLEND);
+            // The blurred mips are added by the tone mapping
             glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
         } // end if bloom
         PROFILER_POP_CPU_MARKER();
     }
 
+    MotionBlurProvider * const cb = (MotionBlurProvider *)irr_driver->
+        getCallback(ES_MOTIONBLUR);
+    const bool has_motion_blur = isRace && UserConfigParams::m_motionblur &&
+        World::getWorld() != NULL &&
+        cb->getBoostTime(Camera::getActiveCamera()->getIndex()) > 0.;
+
+    // Workaround a bug with srgb fbo on sandy bridge windows
+    const bool use_srgb = CVS->isARBUniformBufferObjectUsable();
+
+    // MLAA works in place in FBO_MLAA_COLORS, the single pass methods read
+    // from FBO_MLAA_TMP and write to FBO_MLAA_COLORS.
+    const bool single_pass_aa = UserConfigParams::m_mlaa &&
+                                UserConfigParams::m_antialiasing_type != AA_MLAA;
+    FrameBuffer *aa_fbo = NULL;
+    if (use_srgb)
+        aa_fbo = &irr_driver->getFBO(single_pass_aa ? FBO_MLAA_TMP
+                                                    : FBO_MLAA_COLORS);
+
     //computeLogLuminance(in_rtt);
     {
         PROFILER_PUSH_CPU_MARKER("- Tonemap", 0xFF, 0x00, 0x00);
         ScopedGPUTimer Timer(irr_driver->getGPUTimer(Q_TONEMAP));
-		// only enable vignette during race
-		if(isRace)
-		{
-			toneMap(*out_fbo, in_fbo->getRTT()[0], 1.0);
-		}
-		else
-		{
-			toneMap(*out_fbo, in_fbo->getRTT()[0], 0.0);
-		}
+        // Without motion blur the tone mapping is the last pass before
+        // anti-aliasing, so it can write into the anti-aliasing input
+        // directly instead of copying the result there afterwards.
+        const bool tonemap_to_aa = use_srgb && !has_motion_blur;
+        if (tonemap_to_aa)
+        {
+            glEnable(GL_FRAMEBUFFER_SRGB);
+            out_fbo = aa_fbo;
+        }
+        // only enable vignette during race
+        toneMap(*out_fbo, in_fbo->getRTT()[0], isRace ? 1.0f : 0.0f,
+                has_bloom);
         std::swap(in_fbo, out_fbo);
         PROFILER_POP_CPU_MARKER();
     }
 
+    if (has_motion_blur)
     {
         PROFILER_PUSH_CPU_MARKER("- Motion blur", 0xFF, 0x00, 0x00);
         ScopedGPUTimer Timer(irr_driver->getGPUTimer(Q_MOTIONBLUR));
-        MotionBlurProvider * const cb = (MotionBlurProvider *)irr_driver->
-            getCallback(ES_MOTIONBLUR);
-
-        if (isRace && UserConfigParams::m_motionblur && World::getWorld() != NULL && cb->getBoostTime(Camera::getActiveCamera()->getIndex()) > 0.) // motion blur
-        {
-            renderMotionBlur(0, *in_fbo, *out_fbo);
-            std::swap(in_fbo, out_fbo);
-        }
+        renderMotionBlur(0, *in_fbo, *out_fbo);
+        std::swap(in_fbo, out_fbo);
         PROFILER_POP_CPU_MARKER();
     }
 
-    // Workaround a bug with srgb fbo on sandy bridge windows
-    if (!CVS->isARBUniformBufferObjectUsable())
+    if (!use_srgb)
         return in_fbo;
 
-    glEnable(GL_FRAMEBUFFER_SRGB);
-    irr_driver->getFBO(FBO_MLAA_COLORS).Bind();
-    renderPassThrough(in_fbo->getRTT()[0], irr_driver->getFBO(FBO_MLAA_COLORS).getWidth(), irr_driver->getFBO(FBO_MLAA_COLORS).getHeight());
+    if (in_fbo != aa_fbo)
+    {
+        glEnable(GL_FRAMEBUFFER_SRGB);
+        aa_fbo->Bind();
+        renderPassThrough(in_fbo->getRTT()[0], aa_fbo->getWidth(), aa_fbo->getHeight());
+    }
     out_fbo = &irr_driver->getFBO(FBO_MLAA_COLORS);
 
-    if (UserConfigParams::m_mlaa) // MLAA. Must be the last pp filter.
+    if (UserConfigParams::m_mlaa) // Anti-aliasing. Must be the last pp filter.
     {
-        PROFILER_PUSH_CPU_MARKER("- MLAA", 0xFF, 0x00, 0x00);
+        PROFILER_PUSH_CPU_MARKER("- Anti-aliasing", 0xFF, 0x00, 0x00);
         ScopedGPUTimer Timer(irr_driver->getGPUTimer(Q_MLAA));
-        applyMLAA();
+        if (UserConfigParams::m_antialiasing_type == AA_FXAA)
+            applyFXAA();
+        else if (UserConfigParams::m_antialiasing_type == AA_TEMPORAL)
+            applyTemporalAA(Camera::getActiveCamera()->getPreviousPVMatrix());
+        else
+            applyMLAA();
         PROFILER_POP_CPU_MARKER();
     }
+    if (!UserConfigParams::m_mlaa ||
+        UserConfigParams::m_antialiasing_type != AA_TEMPORAL)
+        m_taa_history_valid = false;
     glDisable(GL_FRAMEBUFFER_SRGB);
 
     return out_fbo;
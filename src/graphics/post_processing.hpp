@@ -62,6 +62,10 @@ private:
 
     video::ITexture *m_areamap;
 
+    /** True if RTT_TAA_HISTORY contains the anti-aliased previous frame of
+     *  the current camera. */
+    bool m_taa_history_valid;
+
     void setMotionBlurCenterY(const u32 num, const float y);
 
 public:
@@ -76,7 +80,8 @@ public:
     /** Generate diffuse and specular map */
     void         renderSunlight(const core::vector3df &direction, const video::SColorf &col);
 
-    void renderSSAO();
+    void renderSSAO(FrameBuffer &out_fbo, float rotation);
+    void renderSSAOAccumulation(unsigned current_ao, unsigned history, const core::matrix4 &previous_pv_matrix, bool use_history);
     void renderEnvMap(const float *bSHCoeff, const float *gSHCoeff, const float *rSHCoeff, unsigned skycubemap);
     void renderRHDebug(unsigned SHR, unsigned SHG, unsigned SHB, const core::matrix4 &rh_matrix, const core::vector3df &rh_extend);
     void renderGI(const core::matrix4 &RHMatrix, const core::vector3df &rh_extend, unsigned shr, unsigned shg, unsigned shb);
@@ -92,8 +97,14 @@ public:
 
     /** Render tex. Used for blit/texture resize */
     void renderPassThrough(unsigned tex, unsigned width, unsigned height);
+    void renderBilateralUpsample(unsigned tex);
     void renderTextureLayer(unsigned tex, unsigned layer);
     void applyMLAA();
+    void applyFXAA();
+    void applyTemporalAA(const core::matrix4 &previous_pv_matrix);
+    /** Called when the history of the temporal anti-aliasing can not be
+     *  used anymore, e.g. the RTTs were recreated. */
+    void invalidateTemporalAAHistory() { m_taa_history_valid = false; }
 
     void renderMotionBlur(unsigned cam, FrameBuffer &in_fbo, FrameBuffer &out_fbo);
     void renderGlow(unsigned tex);
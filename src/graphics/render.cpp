@@ -24,12 +24,14 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/lod_node.hpp"
+#include "graphics/particle_pool.hpp"
 #include "graphics/post_processing.hpp"
 #include "graphics/referee.hpp"
 #include "graphics/rtts.hpp"
 #include "graphics/screenquad.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/stkmeshscenenode.hpp"
+#include "graphics/video_capture.hpp"
 #include "items/item_manager.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
@@ -91,7 +93,7 @@ void IrrDriver::renderGLSL(float dt)
 
     // Get a list of all glowing things. The driver's list contains the static ones,
     // here we add items, as they may disappear each frame.
-    std::vector<GlowData> glows = m_glowing;
+    GlowList glows(m_glowing.begin(), m_glowing.end());
 
     ItemManager * const items = ItemManager::get();
     const u32 itemcount = items->getNumberOfItems();
@@ -131,6 +133,9 @@ void IrrDriver::renderGLSL(float dt)
         glows.push_back(dat);
     }
 
+    if (CVS->isDefferedEnabled())
+        updateDynamicResolution();
+
     // Start the RTT for post-processing.
     // We do this before beginScene() because we want to capture the glClear()
     // because of tracks that do not have skyboxes (generally add-on tracks)
@@ -153,6 +158,12 @@ void IrrDriver::renderGLSL(float dt)
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     }
 
+    // All cameras share the node updates done for the first camera
+    m_last_scene_update_id++;
+    if (m_last_scene_update_id == 0)
+        m_last_scene_update_id = 1;
+    m_scene_update_id = m_last_scene_update_id;
+
     for(unsigned int cam = 0; cam < Camera::getNumCameras(); cam++)
     {
         Camera * const camera = Camera::getCamera(cam);
@@ -184,7 +195,11 @@ void IrrDriver::renderGLSL(float dt)
         unsigned plc = UpdateLightsInfo(camnode, dt);
         PROFILER_POP_CPU_MARKER();
         PROFILER_PUSH_CPU_MARKER("UBO upload", 0x0, 0xFF, 0x0);
-        computeMatrixesAndCameras(camnode, viewport.LowerRightCorner.X - viewport.UpperLeftCorner.X, viewport.LowerRightCorner.Y - viewport.UpperLeftCorner.Y);
+        // The scene is rendered at a lower resolution with dynamic
+        // resolution and upsampled when drawn to the screen
+        float scale = getSceneResolutionScale();
+        computeMatrixesAndCameras(camnode, (size_t)((viewport.LowerRightCorner.X - viewport.UpperLeftCorner.X) * scale),
+                                  (size_t)((viewport.LowerRightCorner.Y - viewport.UpperLeftCorner.Y) * scale));
         uploadLightingData();
         PROFILER_POP_CPU_MARKER();
         renderScene(camnode, plc, glows, dt, track->hasShadows(), false);
@@ -281,6 +296,7 @@ void IrrDriver::renderGLSL(float dt)
 
         PROFILER_POP_CPU_MARKER();
     }   // for i<world->getNumKarts()
+    m_scene_update_id = 0;
 
     // Use full screen size
     float tmp[2];
@@ -330,6 +346,8 @@ void IrrDriver::renderGLSL(float dt)
     drawDebugMeshes();
 #endif
 
+    if (VideoCapture::get())
+        VideoCapture::get()->captureFrame();
 
     PROFILER_PUSH_CPU_MARKER("EndSccene", 0x45, 0x75, 0x45);
     m_video_driver->endScene();
@@ -338,7 +356,7 @@ void IrrDriver::renderGLSL(float dt)
     getPostProcessing()->update(dt);
 }
 
-void IrrDriver::renderScene(scene::ICameraSceneNode * const camnode, unsigned pointlightcount, std::vector<GlowData>& glows, float dt, bool hasShadow, bool forceRTT)
+void IrrDriver::renderScene(scene::ICameraSceneNode * const camnode, unsigned pointlightcount, GlowList& glows, float dt, bool hasShadow, bool forceRTT)
 {
     glBindBufferBase(GL_UNIFORM_BUFFER, 0, SharedObject::ViewProjectionMatrixesUBO);
     glBindBufferBase(GL_UNIFORM_BUFFER, 1, SharedObject::LightingDataUBO);
@@ -380,9 +398,11 @@ void IrrDriver::renderScene(scene::ICameraSceneNode * const camnode, unsigned po
         glClearColor(0., 0., 0., 0.);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         renderSolidFirstPass();
+        buildDepthPyramid();
     }
     else
     {
+        invalidateDepthPyramid();
         // We need a cleared depth buffer for some effect (eg particles depth blending)
         if (GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_FRAMEBUFFER_SRGB_WORKING))
             glDisable(GL_FRAMEBUFFER_SRGB);
@@ -417,6 +437,8 @@ void IrrDriver::renderScene(scene::ICameraSceneNode * const camnode, unsigned po
         ScopedGPUTimer Timer(getGPUTimer(Q_SSAO));
         if (UserConfigParams::m_ssao)
             renderSSAO();
+        else
+            m_ssao_history_valid = false;
         PROFILER_POP_CPU_MARKER();
     }
 
@@ -506,7 +528,8 @@ void IrrDriver::renderScene(scene::ICameraSceneNode * const camnode, unsigned po
         PROFILER_POP_CPU_MARKER();
     }
 
-    m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // The instances of this frame are not used after the transparent pass
+    VAOManager::getInstance()->fenceInstanceRegion();
 
     // Render particles
     {
@@ -618,6 +641,17 @@ void IrrDriver::renderParticles()
     glDisable(GL_CULL_FACE);
     glEnable(GL_BLEND);
     glBlendEquation(GL_FUNC_ADD);
+    if (CVS->isComputeParticlesEnabled())
+    {
+        // Simulate and sort all emitters first, so that drawing only waits
+        // once for the compute shaders
+        for (unsigned i = 0; i < ParticlesList::getInstance()->size(); ++i)
+            ParticlesList::getInstance()->at(i)->dispatchSimulation();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        for (unsigned i = 0; i < ParticlesList::getInstance()->size(); ++i)
+            ParticlesList::getInstance()->at(i)->dispatchSorting();
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
     for (unsigned i = 0; i < ParticlesList::getInstance()->size(); ++i)
         ParticlesList::getInstance()->at(i)->render();
 //    m_scene_manager->drawAll(scene::ESNRP_TRANSPARENT_EFFECT);
@@ -655,7 +689,7 @@ void IrrDriver::renderShadowsDebug()
 
 // ----------------------------------------------------------------------------
 
-void IrrDriver::renderGlow(std::vector<GlowData>& glows)
+void IrrDriver::renderGlow(GlowList& glows)
 {
     m_scene_manager->setCurrentRendertime(scene::ESNRP_SOLID);
     m_rtts->getFBO(FBO_TMP1_WITH_DS).Bind();
@@ -0,0 +1,117 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/camera.hpp"
+#include "graphics/central_settings.hpp"
+#include "graphics/glwrap.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/occlusion_buffer.hpp"
+#include "graphics/rtts.hpp"
+#include "graphics/shaders.hpp"
+
+#include <algorithm>
+
+/** Culls the instances of a range of indirect draw commands on the GPU and
+*  compacts the remaining ones, writing the new instance count of each
+*  command. Instances are culled against the view frustum of the current
+*  frame and, if available, against the depth pyramid of the previous frame.
+*  Must be called after the command and instance buffers were filled and the
+*  matrixes UBO was updated for the current camera.
+*  \param first_command Index of the first command to cull.
+*  \param command_count Number of commands to cull.
+*  \param instance_buffer Buffer containing the instances of the commands.
+*  \param instance_size Size of one instance in bytes.
+*  \param command_buffer Buffer containing the commands.
+*  \param bounds_buffer Buffer containing the bounding sphere of the mesh of
+*         each command.
+*/
+void IrrDriver::cullInstancesOnGPU(size_t first_command, size_t command_count, GLuint instance_buffer,
+                                   size_t instance_size, GLuint command_buffer, GLuint bounds_buffer)
+{
+    if (!command_count)
+        return;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, command_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, instance_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, bounds_buffer);
+
+    // The depth pyramid is only valid for the camera it was rendered with
+    bool use_occlusion = m_depth_pyramid_valid && Camera::getNumCameras() == 1;
+    glUseProgram(FullScreenShader::InstanceCullingShader::getInstance()->Program);
+    FullScreenShader::InstanceCullingShader::getInstance()->SetTextureUnits(m_rtts->getRenderTarget(RTT_DEPTH_PYRAMID));
+    FullScreenShader::InstanceCullingShader::getInstance()->setUniforms((int)first_command, (int)(instance_size / 4),
+        m_depth_pyramid_matrix, core::vector2df((float)m_rtts->getWidth(), (float)m_rtts->getHeight()),
+        (int)m_rtts->getDepthPyramidLevels(), use_occlusion ? 1 : 0);
+    glDispatchCompute((int)command_count, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/** Builds the depth pyramid used for occlusion culling from the depth buffer
+*  of the solid pass. Level 0 contains the maximum depth of each 2x2 pixel
+*  block, each following level the maximum of 2x2 texels of the previous one.
+*  If occlusion culling of scene nodes is enabled, a low resolution level is
+*  then downloaded to the occlusion buffer.
+*/
+void IrrDriver::buildDepthPyramid()
+{
+    if ((!CVS->isGPUCullingEnabled() && !CVS->isOcclusionCullingEnabled()) || Camera::getNumCameras() > 1)
+    {
+        m_depth_pyramid_valid = false;
+        if (m_occlusion_buffer)
+            m_occlusion_buffer->invalidate();
+        return;
+    }
+
+    GLuint pyramid = m_rtts->getRenderTarget(RTT_DEPTH_PYRAMID);
+    unsigned levels = m_rtts->getDepthPyramidLevels();
+    size_t width = m_rtts->getWidth(), height = m_rtts->getHeight();
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glUseProgram(FullScreenShader::DepthPyramidShader::getInstance()->Program);
+    glBindSampler(FullScreenShader::DepthPyramidShader::getInstance()->TU_dest, 0);
+    for (unsigned level = 0; level < levels; level++)
+    {
+        if (level == 0)
+            FullScreenShader::DepthPyramidShader::getInstance()->SetTextureUnits(getDepthStencilTexture());
+        else
+            FullScreenShader::DepthPyramidShader::getInstance()->SetTextureUnits(pyramid);
+        glBindImageTexture(FullScreenShader::DepthPyramidShader::getInstance()->TU_dest, pyramid, level, false, 0, GL_WRITE_ONLY, GL_R32F);
+        FullScreenShader::DepthPyramidShader::getInstance()->setUniforms(level == 0 ? 0 : (int)level - 1);
+
+        size_t level_width = std::max<size_t>(width >> (level + 1), 1);
+        size_t level_height = std::max<size_t>(height >> (level + 1), 1);
+        glDispatchCompute((int)level_width / 8 + 1, (int)level_height / 8 + 1, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    m_depth_pyramid_matrix = m_ProjViewMatrix;
+    m_depth_pyramid_valid = true;
+
+    if (CVS->isOcclusionCullingEnabled() && m_occlusion_buffer)
+        m_occlusion_buffer->requestDownload(pyramid, levels, (unsigned)width, (unsigned)height, m_ProjViewMatrix);
+}
+
+/** Marks the depth pyramid and the occlusion buffer as unusable, e.g. when the
+*  depth buffer was not rendered in this frame.
+*/
+void IrrDriver::invalidateDepthPyramid()
+{
+    m_depth_pyramid_valid = false;
+    if (m_occlusion_buffer)
+        m_occlusion_buffer->invalidate();
+}
@@ -20,9 +20,12 @@
 #include "config/user_config.hpp"
 #include "graphics/callbacks.hpp"
 #include "graphics/glwrap.hpp"
+#include "graphics/label_billboard.hpp"
 #include "graphics/post_processing.hpp"
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
+#include "graphics/shadow_cache.hpp"
+#include "graphics/shadow_cascades.hpp"
 #include "modes/world.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
@@ -113,16 +116,20 @@ struct AlphaRef
     typedef MeshShader::ObjectRefPass2Shader SecondPassShader;
     typedef MeshShader::RefShadowShader ShadowPassShader;
     typedef MeshShader::RSMShader RSMShader;
+    typedef MeshShader::ObjectRefDepthShader DepthPassShader;
+    typedef MeshShader::InstancedObjectRefDepthShader InstancedDepthPassShader;
     typedef ListMatAlphaRef List;
     static const enum video::E_VERTEX_TYPE VertexType = video::EVT_STANDARD;
     static const enum Material::ShaderType MaterialType = Material::SHADERTYPE_ALPHA_TEST;
     static const enum InstanceType Instance = InstanceTypeDualTex;
+    static const STK::Tuple<size_t> DepthPassTextures;
     static const STK::Tuple<size_t, size_t> FirstPassTextures;
     static const STK::Tuple<size_t, size_t> SecondPassTextures;
     static const STK::Tuple<size_t> ShadowTextures;
     static const STK::Tuple<size_t> RSMTextures;
 };
 
+const STK::Tuple<size_t> AlphaRef::DepthPassTextures = STK::Tuple<size_t>(0);
 const STK::Tuple<size_t, size_t> AlphaRef::FirstPassTextures = STK::Tuple<size_t, size_t>(0, 1);
 const STK::Tuple<size_t, size_t> AlphaRef::SecondPassTextures = STK::Tuple<size_t, size_t>(0, 1);
 const STK::Tuple<size_t> AlphaRef::ShadowTextures = STK::Tuple<size_t>(0);
@@ -191,16 +198,20 @@ struct GrassMat
     typedef MeshShader::GrassPass2Shader SecondPassShader;
     typedef MeshShader::GrassShadowShader ShadowPassShader;
     typedef MeshShader::RSMShader RSMShader;
+    typedef MeshShader::GrassDepthShader DepthPassShader;
+    typedef MeshShader::InstancedGrassDepthShader InstancedDepthPassShader;
     typedef ListMatGrass List;
     static const enum video::E_VERTEX_TYPE VertexType = video::EVT_STANDARD;
     static const enum Material::ShaderType MaterialType = Material::SHADERTYPE_VEGETATION;
     static const enum InstanceType Instance = InstanceTypeDualTex;
+    static const STK::Tuple<size_t> DepthPassTextures;
     static const STK::Tuple<size_t, size_t> FirstPassTextures;
     static const STK::Tuple<size_t, size_t> SecondPassTextures;
     static const STK::Tuple<size_t> ShadowTextures;
     static const STK::Tuple<size_t> RSMTextures;
 };
 
+const STK::Tuple<size_t> GrassMat::DepthPassTextures = STK::Tuple<size_t>(0);
 const STK::Tuple<size_t, size_t> GrassMat::FirstPassTextures = STK::Tuple<size_t, size_t>(0, 1);
 const STK::Tuple<size_t, size_t> GrassMat::SecondPassTextures = STK::Tuple<size_t, size_t>(0, 1);
 const STK::Tuple<size_t> GrassMat::ShadowTextures = STK::Tuple<size_t>(0);
@@ -391,6 +402,61 @@ struct TexExpander
 };
 
 
+template<int N>
+struct TexComparator_impl
+{
+    template<typename...TupleArgs>
+    static bool Compare(const GLMesh &a, const GLMesh &b, const STK::Tuple<TupleArgs...> &TexSwizzle)
+    {
+        size_t idx = STK::tuple_get<sizeof...(TupleArgs) - N>(TexSwizzle);
+        return a.textures[idx] == b.textures[idx] && TexComparator_impl<N - 1>::Compare(a, b, TexSwizzle);
+    }
+};
+
+template<>
+struct TexComparator_impl<0>
+{
+    template<typename...TupleArgs>
+    static bool Compare(const GLMesh &a, const GLMesh &b, const STK::Tuple<TupleArgs...> &TexSwizzle)
+    {
+        return true;
+    }
+};
+
+/** Returns true if two meshes use the same textures for the given swizzle,
+ *  meaning they can be drawn without rebinding textures in between. */
+template<typename...TupleArgs>
+static bool hasSameTextures(const GLMesh &a, const GLMesh &b, const STK::Tuple<TupleArgs...> &TexSwizzle)
+{
+    return TexComparator_impl<sizeof...(TupleArgs)>::Compare(a, b, TexSwizzle);
+}
+
+/** Returns the number of consecutive meshes starting at first which share
+ *  their textures with it. These can be drawn with a single multi draw call
+ *  even without bindless textures; materials whose pass does not sample any
+ *  texture are drawn in a single call. */
+template<typename...TupleArgs>
+static unsigned getTextureRun(const std::vector<GLMesh *> &meshes, unsigned first, const STK::Tuple<TupleArgs...> &TexSwizzle)
+{
+    unsigned count = 1;
+    if (!CVS->isARBMultiDrawIndirectUsable())
+        return count;
+    while (first + count < meshes.size() && hasSameTextures(*meshes[first], *meshes[first + count], TexSwizzle))
+        count++;
+    return count;
+}
+
+/** Draws count consecutive commands of the bound indirect buffer. */
+static void drawIndirectRun(size_t first_command, unsigned count)
+{
+    if (count > 1)
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+            (const void*)(first_command * sizeof(DrawElementsIndirectCommand)),
+            count, sizeof(DrawElementsIndirectCommand));
+    else
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void*)(first_command * sizeof(DrawElementsIndirectCommand)));
+}
+
 template<typename T, int N>
 struct HandleExpander_impl
 {
@@ -426,6 +492,8 @@ template<typename T, int ...List>
 void renderMeshes1stPass()
 {
     auto &meshes = T::List::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
     glUseProgram(T::FirstPassShader::getInstance()->Program);
     if (CVS->isARBBaseInstanceUsable())
         glBindVertexArray(VAOManager::getInstance()->getVAO(T::VertexType));
@@ -456,35 +524,96 @@ template<typename T, typename...Args>
 void renderInstancedMeshes1stPass(Args...args)
 {
     std::vector<GLMesh *> &meshes = T::InstancedList::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
     glUseProgram(T::InstancedFirstPassShader::getInstance()->Program);
     glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
-    for (unsigned i = 0; i < meshes.size(); i++)
+    T::InstancedFirstPassShader::getInstance()->setUniforms(args...);
+    for (unsigned i = 0; i < meshes.size();)
     {
-        std::vector<GLuint> Textures;
         GLMesh *mesh = meshes[i];
 #ifdef DEBUG
         if (mesh->VAOType != T::VertexType)
         {
             Log::error("RenderGeometry", "Wrong instanced vertex format (hint : %s)", 
                 mesh->textures[0]->getName().getPath().c_str());
+            i++;
             continue;
         }
 #endif
+        unsigned count = getTextureRun(meshes, i, T::FirstPassTextures);
         TexExpander<typename T::InstancedFirstPassShader>::template ExpandTex(*mesh, T::FirstPassTextures);
+        drawIndirectRun(SolidPassCmd::getInstance()->Offset[T::MaterialType] + i, count);
+        i += count;
+    }
+}
 
+template<typename T, typename...Args>
+void multidraw1stPass(Args...args)
+{
+    if (SolidPassCmd::getInstance()->Size[T::MaterialType])
+    {
+        glUseProgram(T::InstancedFirstPassShader::getInstance()->Program);
+        glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
         T::InstancedFirstPassShader::getInstance()->setUniforms(args...);
-        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void*)((SolidPassCmd::getInstance()->Offset[T::MaterialType] + i) * sizeof(DrawElementsIndirectCommand)));
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+            (const void*)(SolidPassCmd::getInstance()->Offset[T::MaterialType] * sizeof(DrawElementsIndirectCommand)),
+            (int)SolidPassCmd::getInstance()->Size[T::MaterialType],
+            sizeof(DrawElementsIndirectCommand));
+    }
+}
+
+template<typename T, int ...List>
+void renderMeshesDepthPrePass()
+{
+    auto &meshes = T::List::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
+    glUseProgram(T::DepthPassShader::getInstance()->Program);
+    if (CVS->isARBBaseInstanceUsable())
+        glBindVertexArray(VAOManager::getInstance()->getVAO(T::VertexType));
+    for (unsigned i = 0; i < meshes.size(); i++)
+    {
+        GLMesh &mesh = *(STK::tuple_get<0>(meshes.at(i)));
+        if (!CVS->isARBBaseInstanceUsable())
+            glBindVertexArray(mesh.vao);
+        if (mesh.VAOType != T::VertexType)
+            continue;
+
+        if (CVS->isAZDOEnabled())
+            HandleExpander<typename T::DepthPassShader>::template Expand(mesh.TextureHandles, T::DepthPassTextures);
+        else
+            TexExpander<typename T::DepthPassShader>::template ExpandTex(mesh, T::DepthPassTextures);
+        custom_unroll_args<List...>::template exec(T::DepthPassShader::getInstance(), meshes.at(i));
     }
 }
 
 template<typename T, typename...Args>
-void multidraw1stPass(Args...args)
+void renderInstancedMeshesDepthPrePass(Args...args)
 {
-    glUseProgram(T::InstancedFirstPassShader::getInstance()->Program);
+    std::vector<GLMesh *> &meshes = T::InstancedList::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
+    glUseProgram(T::InstancedDepthPassShader::getInstance()->Program);
     glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
+    T::InstancedDepthPassShader::getInstance()->setUniforms(args...);
+    for (unsigned i = 0; i < meshes.size();)
+    {
+        unsigned count = getTextureRun(meshes, i, T::DepthPassTextures);
+        TexExpander<typename T::InstancedDepthPassShader>::template ExpandTex(*meshes[i], T::DepthPassTextures);
+        drawIndirectRun(SolidPassCmd::getInstance()->Offset[T::MaterialType] + i, count);
+        i += count;
+    }
+}
+
+template<typename T, typename...Args>
+void multidrawDepthPrePass(Args...args)
+{
     if (SolidPassCmd::getInstance()->Size[T::MaterialType])
     {
-        T::InstancedFirstPassShader::getInstance()->setUniforms(args...);
+        glUseProgram(T::InstancedDepthPassShader::getInstance()->Program);
+        glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
+        T::InstancedDepthPassShader::getInstance()->setUniforms(args...);
         glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
             (const void*)(SolidPassCmd::getInstance()->Offset[T::MaterialType] * sizeof(DrawElementsIndirectCommand)),
             (int)SolidPassCmd::getInstance()->Size[T::MaterialType],
@@ -494,6 +623,49 @@ void multidraw1stPass(Args...args)
 
 static core::vector3df windDir;
 
+/** Returns true if the depth pre-pass is used in this frame, i.e. if it is
+ *  enabled and alpha tested or grass meshes are drawn. */
+static bool useDepthPrePass()
+{
+    if (!UserConfigParams::m_depth_prepass)
+        return false;
+    if (!AlphaRef::List::getInstance()->SolidPass.empty() ||
+        !GrassMat::List::getInstance()->SolidPass.empty())
+        return true;
+    if (CVS->isAZDOEnabled())
+        return SolidPassCmd::getInstance()->Size[AlphaRef::MaterialType] > 0 ||
+               SolidPassCmd::getInstance()->Size[GrassMat::MaterialType] > 0;
+    if (CVS->supportsIndirectInstancingRendering())
+        return !AlphaRef::InstancedList::getInstance()->SolidPass.empty() ||
+               !GrassMat::InstancedList::getInstance()->SolidPass.empty();
+    return false;
+}   // useDepthPrePass
+
+/** Draws the depth of the alpha tested and grass meshes (which have the most
+ *  overdraw, and for which the discard in the shader prevents early depth
+ *  tests while the depth is written). The normal pass then draws these
+ *  meshes without writing the depth, so only the visible fragments are
+ *  shaded, and all other meshes hidden behind foliage are rejected early. */
+static void renderDepthPrePass()
+{
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    renderMeshesDepthPrePass<AlphaRef, 3, 2, 1>();
+    renderMeshesDepthPrePass<GrassMat, 3, 2, 1>();
+    if (CVS->isAZDOEnabled())
+    {
+        multidrawDepthPrePass<AlphaRef>();
+        multidrawDepthPrePass<GrassMat>(windDir);
+    }
+    else if (CVS->supportsIndirectInstancingRendering())
+    {
+        renderInstancedMeshesDepthPrePass<AlphaRef>();
+        renderInstancedMeshesDepthPrePass<GrassMat>(windDir);
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}   // renderDepthPrePass
+
 void IrrDriver::renderSolidFirstPass()
 {
     windDir = getWindDir();
@@ -501,6 +673,13 @@ void IrrDriver::renderSolidFirstPass()
     if (CVS->supportsIndirectInstancingRendering())
         glBindBuffer(GL_DRAW_INDIRECT_BUFFER, SolidPassCmd::getInstance()->drawindirectcmd);
 
+    const bool depth_prepass = useDepthPrePass();
+    if (depth_prepass)
+    {
+        ScopedGPUTimer Timer(getGPUTimer(Q_DEPTH_PREPASS));
+        renderDepthPrePass();
+    }
+
     {
         ScopedGPUTimer Timer(getGPUTimer(Q_SOLID_PASS1));
         irr_driver->setPhase(SOLID_NORMAL_AND_DEPTH_PASS);
@@ -508,11 +687,11 @@ void IrrDriver::renderSolidFirstPass()
         for (unsigned i = 0; i < ImmediateDrawList::getInstance()->size(); i++)
             ImmediateDrawList::getInstance()->at(i)->render();
 
+        // The opaque materials are drawn first in each path, so that they
+        // benefit from the depth of the (pre-pass) foliage
         renderMeshes1stPass<DefaultMaterial, 2, 1>();
         renderMeshes1stPass<SplattingMat, 2, 1>();
         renderMeshes1stPass<UnlitMat, 3, 2, 1>();
-        renderMeshes1stPass<AlphaRef, 3, 2, 1>();
-        renderMeshes1stPass<GrassMat, 3, 2, 1>();
         renderMeshes1stPass<NormalMat, 2, 1>();
         renderMeshes1stPass<SphereMap, 2, 1>();
         renderMeshes1stPass<DetailMat, 2, 1>();
@@ -520,24 +699,38 @@ void IrrDriver::renderSolidFirstPass()
         if (CVS->isAZDOEnabled())
         {
             multidraw1stPass<DefaultMaterial>();
-            multidraw1stPass<AlphaRef>();
             multidraw1stPass<SphereMap>();
             multidraw1stPass<UnlitMat>();
-            multidraw1stPass<GrassMat>(windDir);
-
             multidraw1stPass<NormalMat>();
             multidraw1stPass<DetailMat>();
         }
         else if (CVS->supportsIndirectInstancingRendering())
         {
             renderInstancedMeshes1stPass<DefaultMaterial>();
-            renderInstancedMeshes1stPass<AlphaRef>();
             renderInstancedMeshes1stPass<UnlitMat>();
             renderInstancedMeshes1stPass<SphereMap>();
-            renderInstancedMeshes1stPass<GrassMat>(windDir);
             renderInstancedMeshes1stPass<DetailMat>();
             renderInstancedMeshes1stPass<NormalMat>();
         }
+
+        // The depth of the alpha tested meshes is already in the depth
+        // buffer if the pre-pass was done
+        if (depth_prepass)
+            glDepthMask(GL_FALSE);
+        renderMeshes1stPass<AlphaRef, 3, 2, 1>();
+        renderMeshes1stPass<GrassMat, 3, 2, 1>();
+        if (CVS->isAZDOEnabled())
+        {
+            multidraw1stPass<AlphaRef>();
+            multidraw1stPass<GrassMat>(windDir);
+        }
+        else if (CVS->supportsIndirectInstancingRendering())
+        {
+            renderInstancedMeshes1stPass<AlphaRef>();
+            renderInstancedMeshes1stPass<GrassMat>(windDir);
+        }
+        if (depth_prepass)
+            glDepthMask(GL_TRUE);
     }
 }
 
@@ -546,6 +739,8 @@ void renderMeshes2ndPass( const std::vector<uint64_t> &Prefilled_Handle,
     const std::vector<GLuint> &Prefilled_Tex)
 {
     auto &meshes = T::List::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
     glUseProgram(T::SecondPassShader::getInstance()->Program);
     if (CVS->isARBBaseInstanceUsable())
         glBindVertexArray(VAOManager::getInstance()->getVAO(T::VertexType));
@@ -575,14 +770,18 @@ template<typename T, typename...Args>
 void renderInstancedMeshes2ndPass(const std::vector<GLuint> &Prefilled_tex, Args...args)
 {
     std::vector<GLMesh *> &meshes = T::InstancedList::getInstance()->SolidPass;
+    if (meshes.empty())
+        return;
     glUseProgram(T::InstancedSecondPassShader::getInstance()->Program);
     glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
-    for (unsigned i = 0; i < meshes.size(); i++)
+    T::InstancedSecondPassShader::getInstance()->setUniforms(args...);
+    for (unsigned i = 0; i < meshes.size();)
     {
         GLMesh *mesh = meshes[i];
+        unsigned count = getTextureRun(meshes, i, T::SecondPassTextures);
         TexExpander<typename T::InstancedSecondPassShader>::template ExpandTex(*mesh, T::SecondPassTextures, Prefilled_tex[0], Prefilled_tex[1], Prefilled_tex[2]);
-        T::InstancedSecondPassShader::getInstance()->setUniforms(args...);
-        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void*)((SolidPassCmd::getInstance()->Offset[T::MaterialType] + i) * sizeof(DrawElementsIndirectCommand)));
+        drawIndirectRun(SolidPassCmd::getInstance()->Offset[T::MaterialType] + i, count);
+        i += count;
     }
 }
 
@@ -590,11 +789,11 @@ void renderInstancedMeshes2ndPass(const std::vector<GLuint> &Prefilled_tex, Args
 template<typename T, typename...Args>
 void multidraw2ndPass(const std::vector<uint64_t> &Handles, Args... args)
 {
-    glUseProgram(T::InstancedSecondPassShader::getInstance()->Program);
-    glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
     uint64_t nulltex[10] = {};
     if (SolidPassCmd::getInstance()->Size[T::MaterialType])
     {
+        glUseProgram(T::InstancedSecondPassShader::getInstance()->Program);
+        glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, T::Instance));
         HandleExpander<typename T::InstancedSecondPassShader>::template Expand(nulltex, T::SecondPassTextures, Handles[0], Handles[1], Handles[2]);
         T::InstancedSecondPassShader::getInstance()->setUniforms(args...);
         glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
@@ -664,11 +863,11 @@ void IrrDriver::renderSolidSecondPass()
 
             // template does not work with template due to extra depth texture
             {
-                glUseProgram(GrassMat::InstancedSecondPassShader::getInstance()->Program);
-                glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(GrassMat::VertexType, GrassMat::Instance));
                 uint64_t nulltex[10] = {};
                 if (SolidPassCmd::getInstance()->Size[GrassMat::MaterialType])
                 {
+                    glUseProgram(GrassMat::InstancedSecondPassShader::getInstance()->Program);
+                    glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(GrassMat::VertexType, GrassMat::Instance));
                     HandleExpander<GrassMat::InstancedSecondPassShader>::Expand(nulltex, GrassMat::SecondPassTextures, DiffuseHandle, SpecularHandle, SSAOHandle, DepthHandle);
                     GrassMat::InstancedSecondPassShader::getInstance()->setUniforms(windDir, irr_driver->getSunDirection());
                     glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
@@ -690,8 +889,11 @@ void IrrDriver::renderSolidSecondPass()
             // template does not work with template due to extra depth texture
             {
                 std::vector<GLMesh *> &meshes = GrassMat::InstancedList::getInstance()->SolidPass;
-                glUseProgram(GrassMat::InstancedSecondPassShader::getInstance()->Program);
-                glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(GrassMat::VertexType, GrassMat::Instance));
+                if (!meshes.empty())
+                {
+                    glUseProgram(GrassMat::InstancedSecondPassShader::getInstance()->Program);
+                    glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(GrassMat::VertexType, GrassMat::Instance));
+                }
                 for (unsigned i = 0; i < meshes.size(); i++)
                 {
                     GLMesh *mesh = meshes[i];
@@ -756,6 +958,8 @@ void IrrDriver::renderNormalsVisualisation()
 template<typename Shader, enum video::E_VERTEX_TYPE VertexType, int...List, typename... TupleType>
 void renderTransparenPass(const std::vector<TexUnit> &TexUnits, std::vector<STK::Tuple<TupleType...> > *meshes)
 {
+    if (meshes->empty())
+        return;
     glUseProgram(Shader::getInstance()->Program);
     if (CVS->isARBBaseInstanceUsable())
         glBindVertexArray(VAOManager::getInstance()->getVAO(VertexType));
@@ -819,6 +1023,7 @@ void IrrDriver::renderTransparent()
 
     for (unsigned i = 0; i < BillBoardList::getInstance()->size(); i++)
         BillBoardList::getInstance()->at(i)->render();
+    LabelBillboard::renderBatch();
 
     if (!CVS->isDefferedEnabled())
         return;
@@ -941,9 +1146,11 @@ struct shadow_custom_unroll_args<N, List...>
 };
 
 template<typename T, int...List>
-void renderShadow(unsigned cascade)
+void renderShadow(unsigned cascade, unsigned list)
 {
-    auto &t = T::List::getInstance()->Shadows[cascade];
+    auto &t = T::List::getInstance()->Shadows[list];
+    if (t.empty())
+        return;
     glUseProgram(T::ShadowPassShader::getInstance()->Program);
     if (CVS->isARBBaseInstanceUsable())
         glBindVertexArray(VAOManager::getInstance()->getVAO(T::VertexType));
@@ -961,37 +1168,77 @@ void renderShadow(unsigned cascade)
 }
 
 template<typename T, typename...Args>
-void renderInstancedShadow(unsigned cascade, Args ...args)
+void renderInstancedShadow(unsigned cascade, unsigned list, Args ...args)
 {
+    std::vector<GLMesh *> &t = T::InstancedList::getInstance()->Shadows[list];
+    if (t.empty())
+        return;
     glUseProgram(T::InstancedShadowPassShader::getInstance()->Program);
     glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeShadow));
-    std::vector<GLMesh *> &t = T::InstancedList::getInstance()->Shadows[cascade];
-    for (unsigned i = 0; i < t.size(); i++)
+    T::InstancedShadowPassShader::getInstance()->setUniforms(cascade, args...);
+    for (unsigned i = 0; i < t.size();)
     {
         GLMesh *mesh = t[i];
+        unsigned count = getTextureRun(t, i, T::ShadowTextures);
 
         TexExpander<typename T::InstancedShadowPassShader>::template ExpandTex(*mesh, T::ShadowTextures);
-        T::InstancedShadowPassShader::getInstance()->setUniforms(cascade, args...);
-        size_t tmp = ShadowPassCmd::getInstance()->Offset[cascade][T::MaterialType] + i;
-        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void*)((tmp) * sizeof(DrawElementsIndirectCommand)));
+        drawIndirectRun(ShadowPassCmd::getInstance()->Offset[list][T::MaterialType] + i, count);
+        i += count;
     }
-
 }
 
 template<typename T, typename...Args>
-static void multidrawShadow(unsigned i, Args ...args)
+static void multidrawShadow(unsigned cascade, unsigned list, Args ...args)
 {
-    glUseProgram(T::InstancedShadowPassShader::getInstance()->Program);
-    glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeShadow));
-    if (ShadowPassCmd::getInstance()->Size[i][T::MaterialType])
+    if (ShadowPassCmd::getInstance()->Size[list][T::MaterialType])
     {
-        T::InstancedShadowPassShader::getInstance()->setUniforms(i, args...);
+        glUseProgram(T::InstancedShadowPassShader::getInstance()->Program);
+        glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeShadow));
+        T::InstancedShadowPassShader::getInstance()->setUniforms(cascade, args...);
         glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 
-            (const void*)(ShadowPassCmd::getInstance()->Offset[i][T::MaterialType] * sizeof(DrawElementsIndirectCommand)),
-            (int)ShadowPassCmd::getInstance()->Size[i][T::MaterialType], sizeof(DrawElementsIndirectCommand));
+            (const void*)(ShadowPassCmd::getInstance()->Offset[list][T::MaterialType] * sizeof(DrawElementsIndirectCommand)),
+            (int)ShadowPassCmd::getInstance()->Size[list][T::MaterialType], sizeof(DrawElementsIndirectCommand));
     }
 }
 
+/** Draws a shadow list into the layer of the given cascade of the currently
+ *  bound FBO. The list is the cascade itself, or the static casters of a
+ *  cached cascade (see ShadowCache).
+ */
+static void renderShadowList(unsigned cascade, unsigned list)
+{
+    renderShadow<DefaultMaterial, 1>(cascade, list);
+    renderShadow<SphereMap, 1>(cascade, list);
+    renderShadow<DetailMat, 1>(cascade, list);
+    renderShadow<SplattingMat, 1>(cascade, list);
+    renderShadow<NormalMat, 1>(cascade, list);
+    renderShadow<AlphaRef, 1>(cascade, list);
+    renderShadow<UnlitMat, 1>(cascade, list);
+    renderShadow<GrassMat, 3, 1>(cascade, list);
+
+    if (CVS->supportsIndirectInstancingRendering())
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ShadowPassCmd::getInstance()->drawindirectcmd);
+
+    if (CVS->isAZDOEnabled())
+    {
+        multidrawShadow<DefaultMaterial>(cascade, list);
+        multidrawShadow<DetailMat>(cascade, list);
+        multidrawShadow<NormalMat>(cascade, list);
+        multidrawShadow<AlphaRef>(cascade, list);
+        multidrawShadow<UnlitMat>(cascade, list);
+        multidrawShadow<GrassMat>(cascade, list, windDir);
+    }
+    else if (CVS->supportsIndirectInstancingRendering())
+    {
+        renderInstancedShadow<DefaultMaterial>(cascade, list);
+        renderInstancedShadow<DetailMat>(cascade, list);
+        renderInstancedShadow<AlphaRef>(cascade, list);
+        renderInstancedShadow<UnlitMat>(cascade, list);
+        renderInstancedShadow<GrassMat>(cascade, list, windDir);
+        renderInstancedShadow<NormalMat>(cascade, list);
+    }
+}   // renderShadowList
+
 void IrrDriver::renderShadows()
 {
     glDepthFunc(GL_LEQUAL);
@@ -1008,44 +1255,73 @@ void IrrDriver::renderShadows()
     glCullFace(GL_BACK);
     glEnable(GL_CULL_FACE);
 
-    glClearColor(1., 1., 1., 1.);
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-    glClearColor(0., 0., 0., 0.);
+    // Cascades which are not rendered in this frame keep their layer, so
+    // then each rendered layer is cleared separately
+    const bool clear_all = !m_shadow_cascades || m_shadow_cascades->updatesAll();
+    if (clear_all)
+    {
+        glClearColor(1., 1., 1., 1.);
+        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+        glClearColor(0., 0., 0., 0.);
+    }
 
     for (unsigned cascade = 0; cascade < 4; cascade++)
     {
+        if (m_shadow_cascades && !m_shadow_cascades->needsUpdate(cascade))
+            continue;
         ScopedGPUTimer Timer(getGPUTimer(Q_SHADOWS_CASCADE0 + cascade));
 
-        renderShadow<DefaultMaterial, 1>(cascade);
-        renderShadow<SphereMap, 1>(cascade);
-        renderShadow<DetailMat, 1>(cascade);
-        renderShadow<SplattingMat, 1>(cascade);
-        renderShadow<NormalMat, 1>(cascade);
-        renderShadow<AlphaRef, 1>(cascade);
-        renderShadow<UnlitMat, 1>(cascade);
-        renderShadow<GrassMat, 3, 1>(cascade);
-
-        if (CVS->supportsIndirectInstancingRendering())
-            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ShadowPassCmd::getInstance()->drawindirectcmd);
-
-        if (CVS->isAZDOEnabled())
+        // A cascade with a lower resolution only uses a corner of its layer
+        const unsigned size = m_shadow_cascades
+            ? m_shadow_cascades->getSize(cascade, UserConfigParams::m_shadows_resolution)
+            : (unsigned)UserConfigParams::m_shadows_resolution;
+        const bool scissor = size < (unsigned)UserConfigParams::m_shadows_resolution;
+        if (scissor)
         {
-            multidrawShadow<DefaultMaterial>(cascade);
-            multidrawShadow<DetailMat>(cascade);
-            multidrawShadow<NormalMat>(cascade);
-            multidrawShadow<AlphaRef>(cascade);
-            multidrawShadow<UnlitMat>(cascade);
-            multidrawShadow<GrassMat>(cascade, windDir);
+            glScissor(0, 0, size, size);
+            glEnable(GL_SCISSOR_TEST);
         }
-        else if (CVS->supportsIndirectInstancingRendering())
+        if (!clear_all)
         {
-            renderInstancedShadow<DefaultMaterial>(cascade);
-            renderInstancedShadow<DetailMat>(cascade);
-            renderInstancedShadow<AlphaRef>(cascade);
-            renderInstancedShadow<UnlitMat>(cascade);
-            renderInstancedShadow<GrassMat>(cascade, windDir);
-            renderInstancedShadow<NormalMat>(cascade);
+            m_rtts->getShadowFBO().BindLayer(cascade);
+            glClearColor(1., 1., 1., 1.);
+            glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+            glClearColor(0., 0., 0., 0.);
+            m_rtts->getShadowFBO().Bind();
+            if (!CVS->isESMEnabled())
+                glDrawBuffer(GL_NONE);
         }
+
+        // The static casters of a cached cascade are only drawn when its box
+        // changed, the cached layer is then copied below the dynamic casters
+        if (m_shadow_cache && m_shadow_cache->isCached(cascade))
+        {
+            FrameBuffer *cache = m_rtts->getShadowCacheFBO();
+            unsigned layer = ShadowCache::getLayer(cascade);
+            if (m_shadow_cache->needsRefresh(cascade))
+            {
+                cache->BindLayer(layer);
+                if (!CVS->isESMEnabled())
+                    glDrawBuffer(GL_NONE);
+                glClearColor(1., 1., 1., 1.);
+                glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+                glClearColor(0., 0., 0., 0.);
+                renderShadowList(cascade, ShadowCache::getStaticList(cascade));
+                m_shadow_cache->setRendered(cascade);
+            }
+            GLbitfield mask = GL_DEPTH_BUFFER_BIT;
+            if (CVS->isESMEnabled())
+                mask |= GL_COLOR_BUFFER_BIT;
+            FrameBuffer::BlitLayer(*cache, layer, m_rtts->getShadowFBO(), cascade, mask);
+            m_rtts->getShadowFBO().Bind();
+            if (!CVS->isESMEnabled())
+                glDrawBuffer(GL_NONE);
+        }
+        renderShadowList(cascade, cascade);
+        if (scissor)
+            glDisable(GL_SCISSOR_TEST);
+        if (m_shadow_cascades)
+            m_shadow_cascades->setRendered(cascade);
     }
 
     glDisable(GL_POLYGON_OFFSET_FILL);
@@ -1058,6 +1334,9 @@ void IrrDriver::renderShadows()
         {
             for (unsigned i = 0; i < 2; i++)
             {
+                // Kept layers were already blurred
+                if (m_shadow_cascades && !m_shadow_cascades->needsUpdate(i))
+                    continue;
                 m_post_processing->renderGaussian6BlurLayer(m_rtts->getShadowFBO(), i,
                     2.f * m_shadow_scales[0].first / m_shadow_scales[i].first,
                     2.f * m_shadow_scales[0].second / m_shadow_scales[i].second);
@@ -1096,10 +1375,12 @@ struct rsm_custom_unroll_args<N, List...>
 template<typename T, int... Selector>
 void drawRSM(const core::matrix4 & rsm_matrix)
 {
+    auto &t = T::List::getInstance()->RSM;
+    if (t.empty())
+        return;
     glUseProgram(T::RSMShader::getInstance()->Program);
     if (CVS->isARBBaseInstanceUsable())
         glBindVertexArray(VAOManager::getInstance()->getVAO(T::VertexType));
-    auto t = T::List::getInstance()->RSM;
     for (unsigned i = 0; i < t.size(); i++)
     {
         std::vector<GLuint> Textures;
@@ -1117,27 +1398,30 @@ void drawRSM(const core::matrix4 & rsm_matrix)
 template<typename T, typename...Args>
 void renderRSMShadow(Args ...args)
 {
+    std::vector<GLMesh *> &t = T::InstancedList::getInstance()->RSM;
+    if (t.empty())
+        return;
     glUseProgram(T::InstancedRSMShader::getInstance()->Program);
     glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeRSM));
-    auto t = T::InstancedList::getInstance()->RSM;
-    for (unsigned i = 0; i < t.size(); i++)
+    T::InstancedRSMShader::getInstance()->setUniforms(args...);
+    for (unsigned i = 0; i < t.size();)
     {
-        std::vector<GLuint> Textures;
         GLMesh *mesh = t[i];
+        unsigned count = getTextureRun(t, i, T::RSMTextures);
 
         TexExpander<typename T::InstancedRSMShader>::template ExpandTex(*mesh, T::RSMTextures);
-        T::InstancedRSMShader::getInstance()->setUniforms(args...);
-        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void*)((RSMPassCmd::getInstance()->Offset[T::MaterialType] + i)* sizeof(DrawElementsIndirectCommand)));
+        drawIndirectRun(RSMPassCmd::getInstance()->Offset[T::MaterialType] + i, count);
+        i += count;
     }
 }
 
 template<typename T, typename... Args>
 void multidrawRSM(Args...args)
 {
-    glUseProgram(T::InstancedRSMShader::getInstance()->Program);
-    glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeRSM));
     if (RSMPassCmd::getInstance()->Size[T::MaterialType])
     {
+        glUseProgram(T::InstancedRSMShader::getInstance()->Program);
+        glBindVertexArray(VAOManager::getInstance()->getInstanceVAO(T::VertexType, InstanceTypeRSM));
         T::InstancedRSMShader::getInstance()->setUniforms(args...);
         glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
             (const void*)(RSMPassCmd::getInstance()->Offset[T::MaterialType] * sizeof(DrawElementsIndirectCommand)),
@@ -1180,4 +1464,5 @@ void IrrDriver::renderRSM()
         renderRSMShadow<DetailMat>(rsm_matrix);
     }
     m_rsm_map_available = true;
+    m_rh_valid = false;
 }
@@ -18,21 +18,33 @@
 
 #include "graphics/irr_driver.hpp"
 #include "central_settings.hpp"
+#include "graphics/camera.hpp"
 #include "config/user_config.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/light.hpp"
 #include "graphics/post_processing.hpp"
 #include "graphics/rtts.hpp"
+#include "graphics/shadow_cascades.hpp"
 #include "graphics/shaders.hpp"
 #include "modes/world.hpp"
 #include "tracks/track.hpp"
+#include "utils/frame_arena.hpp"
 #include "utils/profiler.hpp"
 #include "callbacks.hpp"
 
 #define MAX2(a, b) ((a) > (b) ? (a) : (b))
 #define MIN2(a, b) ((a) > (b) ? (b) : (a))
 
-static LightShader::PointLightInfo PointLightsInfo[MAXLIGHT];
+/** Visible point lights of the current frame, closest lights first. */
+static std::vector<LightShader::PointLightInfo> PointLightsInfo;
+
+/** Uploads the closest MAXLIGHT lights to the vertex buffer shared by the
+ *  light volume and light scattering shaders. */
+static void uploadPointLightVolumes(unsigned count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, LightShader::PointLightShader::getInstance()->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, MIN2(count, MAXLIGHT) * sizeof(LightShader::PointLightInfo), PointLightsInfo.data());
+}
 
 static void renderPointLights(unsigned count)
 {
@@ -44,8 +56,6 @@ static void renderPointLights(unsigned count)
 
     glUseProgram(LightShader::PointLightShader::getInstance()->Program);
     glBindVertexArray(LightShader::PointLightShader::getInstance()->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, LightShader::PointLightShader::getInstance()->vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(LightShader::PointLightInfo), PointLightsInfo);
 
     LightShader::PointLightShader::getInstance()->SetTextureUnits(irr_driver->getRenderTargetTexture(RTT_NORMAL_AND_DEPTH), irr_driver->getDepthStencilTexture());
     LightShader::PointLightShader::getInstance()->setUniforms();
@@ -53,12 +63,34 @@ static void renderPointLights(unsigned count)
     glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
 }
 
+/** Accumulates all point lights into the diffuse and specular buffers with a
+ *  compute shader that culls the lights per 16x16 pixel tile. Unlike light
+ *  volumes every pixel is only written once, however many lights overlap.
+ */
+static void renderTiledPointLights(unsigned count, size_t width, size_t height)
+{
+    if (!count)
+        return;
+    LightShader::TiledLightingShader *shader = LightShader::TiledLightingShader::getInstance();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, shader->ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(LightShader::PointLightInfo), PointLightsInfo.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, shader->ssbo);
+
+    glUseProgram(shader->Program);
+    shader->SetTextureUnits(irr_driver->getRenderTargetTexture(RTT_NORMAL_AND_DEPTH), irr_driver->getDepthStencilTexture());
+    glBindImageTexture(shader->TU_diffuse, irr_driver->getRenderTargetTexture(RTT_DIFFUSE), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
+    glBindImageTexture(shader->TU_specular, irr_driver->getRenderTargetTexture(RTT_SPECULAR), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R11F_G11F_B10F);
+    shader->setUniforms((int)count);
+    glDispatchCompute((int)width / 16 + 1, (int)height / 16 + 1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
 unsigned IrrDriver::UpdateLightsInfo(scene::ICameraSceneNode * const camnode, float dt)
 {
     const u32 lightcount = (u32)m_lights.size();
     const core::vector3df &campos = camnode->getAbsolutePosition();
 
-    std::vector<LightNode *> BucketedLN[15];
+    std::vector<LightNode *, FrameAllocator<LightNode *> > BucketedLN[15];
     for (unsigned int i = 0; i < lightcount; i++)
     {
         if (!m_lights[i]->isVisible())
@@ -76,52 +108,52 @@ unsigned IrrDriver::UpdateLightsInfo(scene::ICameraSceneNode * const camnode, fl
         BucketedLN[idx].push_back(m_lights[i]);
     }
 
-    unsigned lightnum = 0;
+    // Light volumes are limited to the closest MAXLIGHT lights, tiled
+    // lighting can handle any number of lights
+    const size_t max_lights = CVS->isTiledLightingEnabled() ? lightcount : MAXLIGHT;
+    PointLightsInfo.clear();
+    bool dropped = false;
 
     for (unsigned i = 0; i < 15; i++)
     {
         for (unsigned j = 0; j < BucketedLN[i].size(); j++)
         {
-            if (++lightnum >= MAXLIGHT)
+            LightNode* light_node = BucketedLN[i].at(j);
+            if (PointLightsInfo.size() >= max_lights)
             {
-                LightNode* light_node = BucketedLN[i].at(j);
+                if (!dropped)
+                    irr_driver->setLastLightBucketDistance(i * 10);
+                dropped = true;
                 light_node->setEnergyMultiplier(0.0f);
+                continue;
             }
-            else
-            {
-                LightNode* light_node = BucketedLN[i].at(j);
 
-                float em = light_node->getEnergyMultiplier();
-                if (em < 1.0f)
-                {
-                    light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
-                }
+            float em = light_node->getEnergyMultiplier();
+            if (em < 1.0f)
+            {
+                light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
+            }
 
-                const core::vector3df &pos = light_node->getAbsolutePosition();
-                PointLightsInfo[lightnum].posX = pos.X;
-                PointLightsInfo[lightnum].posY = pos.Y;
-                PointLightsInfo[lightnum].posZ = pos.Z;
+            LightShader::PointLightInfo info;
+            const core::vector3df &pos = light_node->getAbsolutePosition();
+            info.posX = pos.X;
+            info.posY = pos.Y;
+            info.posZ = pos.Z;
 
-                PointLightsInfo[lightnum].energy = light_node->getEffectiveEnergy();
+            info.energy = light_node->getEffectiveEnergy();
 
-                const core::vector3df &col = light_node->getColor();
-                PointLightsInfo[lightnum].red = col.X;
-                PointLightsInfo[lightnum].green = col.Y;
-                PointLightsInfo[lightnum].blue = col.Z;
+            const core::vector3df &col = light_node->getColor();
+            info.red = col.X;
+            info.green = col.Y;
+            info.blue = col.Z;
 
-                // Light radius
-                PointLightsInfo[lightnum].radius = light_node->getRadius();
-            }
-        }
-        if (lightnum > MAXLIGHT)
-        {
-            irr_driver->setLastLightBucketDistance(i * 10);
-            break;
+            // Light radius
+            info.radius = light_node->getRadius();
+            PointLightsInfo.push_back(info);
         }
     }
 
-    lightnum++;
-    return lightnum;
+    return (unsigned)PointLightsInfo.size();
 }
 
 /** Upload lighting info to the dedicated uniform buffer
@@ -150,8 +182,16 @@ extern float shadowSplit[5];
 void IrrDriver::renderLights(unsigned pointlightcount, bool hasShadow)
 {
     //RH
-    if (CVS->isGlobalIlluminationEnabled() && hasShadow)
+    const video::SColorf sun_color = irr_driver->getSunColor();
+    if (CVS->isGlobalIlluminationEnabled() && hasShadow &&
+        (!m_rh_valid || rh_matrix != m_rh_built_matrix ||
+         sun_color.r != m_rh_built_sun_color.r ||
+         sun_color.g != m_rh_built_sun_color.g ||
+         sun_color.b != m_rh_built_sun_color.b))
     {
+        m_rh_valid = true;
+        m_rh_built_matrix = rh_matrix;
+        m_rh_built_sun_color = sun_color;
         ScopedGPUTimer timer(irr_driver->getGPUTimer(Q_RH));
         glDisable(GL_BLEND);
         m_rtts->getRH().Bind();
@@ -163,7 +203,7 @@ void IrrDriver::renderLights(unsigned pointlightcount, bool hasShadow)
                 m_rtts->getRSM().getRTT()[0], m_rtts->getRSM().getRTT()[1], m_rtts->getRSM().getDepthTexture());
             for (unsigned i = 0; i < 32; i++)
             {
-                FullScreenShader::NVWorkaroundRadianceHintsConstructionShader::getInstance()->setUniforms(rsm_matrix, rh_matrix, rh_extend, i, irr_driver->getSunColor());
+                FullScreenShader::NVWorkaroundRadianceHintsConstructionShader::getInstance()->setUniforms(rsm_matrix, rh_matrix, rh_extend, i, sun_color);
                 glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
             }
         }
@@ -175,13 +215,11 @@ void IrrDriver::renderLights(unsigned pointlightcount, bool hasShadow)
                     m_rtts->getRSM().getRTT()[1],
                     m_rtts->getRSM().getDepthTexture()
             );
-            FullScreenShader::RadianceHintsConstructionShader::getInstance()->setUniforms(rsm_matrix, rh_matrix, rh_extend, irr_driver->getSunColor());
+            FullScreenShader::RadianceHintsConstructionShader::getInstance()->setUniforms(rsm_matrix, rh_matrix, rh_extend, sun_color);
             glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, 32);
         }
     }
 
-    for (unsigned i = 0; i < sun_ortho_matrix.size(); i++)
-        sun_ortho_matrix[i] *= getInvViewMatrix();
     m_rtts->getFBO(FBO_COMBINED_DIFFUSE_SPECULAR).Bind();
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -210,18 +248,25 @@ void IrrDriver::renderLights(unsigned pointlightcount, bool hasShadow)
             glBlendFunc(GL_ONE, GL_ONE);
             glBlendEquation(GL_FUNC_ADD);
 
+            float splits[4];
+            for (unsigned i = 0; i < 4; i++)
+            {
+                splits[i] = m_shadow_cascades
+                          ? m_shadow_cascades->getShaderSplit(i)
+                          : shadowSplit[i + 1];
+            }
             if (CVS->isESMEnabled())
             {
                 FullScreenShader::ShadowedSunLightShaderESM::getInstance()->SetTextureUnits(irr_driver->getRenderTargetTexture(RTT_NORMAL_AND_DEPTH), irr_driver->getDepthStencilTexture(), m_rtts->getShadowFBO().getRTT()[0]);
-                DrawFullScreenEffect<FullScreenShader::ShadowedSunLightShaderESM>(shadowSplit[1], shadowSplit[2], shadowSplit[3], shadowSplit[4]);
+                DrawFullScreenEffect<FullScreenShader::ShadowedSunLightShaderESM>(splits[0], splits[1], splits[2], splits[3]);
             }
             else
             {
                 FullScreenShader::ShadowedSunLightShaderPCF::getInstance()->SetTextureUnits(irr_driver->getRenderTargetTexture(RTT_NORMAL_AND_DEPTH), irr_driver->getDepthStencilTexture(), m_rtts->getShadowFBO().getDepthTexture());
-                DrawFullScreenEffect<FullScreenShader::ShadowedSunLightShaderPCF>(shadowSplit[1],
-                                                                                  shadowSplit[2],
-                                                                                  shadowSplit[3],
-                                                                                  shadowSplit[4],
+                DrawFullScreenEffect<FullScreenShader::ShadowedSunLightShaderPCF>(splits[0],
+                                                                                  splits[1],
+                                                                                  splits[2],
+                                                                                  splits[3],
                                                                                   float(UserConfigParams::m_shadows_resolution));
             }
         }
@@ -230,20 +275,49 @@ void IrrDriver::renderLights(unsigned pointlightcount, bool hasShadow)
     }
     {
         ScopedGPUTimer timer(irr_driver->getGPUTimer(Q_POINTLIGHTS));
-        renderPointLights(MIN2(pointlightcount, MAXLIGHT));
+        // Also used by the light scattering pass
+        uploadPointLightVolumes(pointlightcount);
+        if (CVS->isTiledLightingEnabled())
+            renderTiledPointLights(pointlightcount, m_rtts->getWidth(), m_rtts->getHeight());
+        else
+            renderPointLights(MIN2(pointlightcount, MAXLIGHT));
     }
 }
 
 void IrrDriver::renderSSAO()
 {
-    m_rtts->getFBO(FBO_SSAO).Bind();
+    if (!UserConfigParams::m_low_res_effects)
+    {
+        m_rtts->getFBO(FBO_SSAO).Bind();
+        glClearColor(1., 1., 1., 1.);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_post_processing->renderSSAO(m_rtts->getFBO(FBO_SSAO), 0.f);
+        // Blur it to reduce noise.
+        FrameBuffer::Blit(m_rtts->getFBO(FBO_SSAO), m_rtts->getFBO(FBO_HALF1_R), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        m_post_processing->renderGaussian17TapBlur(irr_driver->getFBO(FBO_HALF1_R), irr_driver->getFBO(FBO_HALF2_R));
+        m_ssao_history_valid = false;
+        return;
+    }
+
+    // The result is used at half resolution anyway, so compute it at half
+    // resolution. The sampling pattern is rotated every frame and the
+    // results of the previous frames are accumulated, which reduces the
+    // noise much more than the blur alone. The history is shared by all
+    // cameras, so it is only used with one camera.
+    m_rtts->getFBO(FBO_HALF2_R).Bind();
     glClearColor(1., 1., 1., 1.);
     glClear(GL_COLOR_BUFFER_BIT);
-    m_post_processing->renderSSAO();
-    // Blur it to reduce noise.
-    FrameBuffer::Blit(m_rtts->getFBO(FBO_SSAO), m_rtts->getFBO(FBO_HALF1_R), GL_COLOR_BUFFER_BIT, GL_LINEAR);
-    m_post_processing->renderGaussian17TapBlur(irr_driver->getFBO(FBO_HALF1_R), irr_driver->getFBO(FBO_HALF2_R));
+    m_ssao_frame = (m_ssao_frame + 1) % 8;
+    m_post_processing->renderSSAO(m_rtts->getFBO(FBO_HALF2_R), 2.4f * m_ssao_frame);
+
+    const bool use_history = m_ssao_history_valid && Camera::getNumCameras() == 1;
+    m_rtts->getFBO(FBO_HALF1_R).Bind();
+    m_post_processing->renderSSAOAccumulation(m_rtts->getRenderTarget(RTT_HALF2_R), m_rtts->getRenderTarget(RTT_SSAO_HISTORY),
+        Camera::getActiveCamera()->getPreviousPVMatrix(), use_history);
+    FrameBuffer::Blit(m_rtts->getFBO(FBO_HALF1_R), m_rtts->getFBO(FBO_SSAO_HISTORY), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    m_ssao_history_valid = Camera::getNumCameras() == 1;
 
+    m_post_processing->renderGaussian17TapBlur(irr_driver->getFBO(FBO_HALF1_R), irr_driver->getFBO(FBO_HALF2_R));
 }
 
 void IrrDriver::renderAmbientScatter()
@@ -270,7 +344,13 @@ void IrrDriver::renderAmbientScatter()
 
 void IrrDriver::renderLightsScatter(unsigned pointlightcount)
 {
-    getFBO(FBO_HALF1).Bind();
+    // Scattering is smooth, except at the edges of objects which the
+    // bilateral upsampling preserves, so it can be rendered at quarter
+    // resolution
+    const bool low_res = UserConfigParams::m_low_res_effects;
+    FrameBuffer &scatter_fbo = getFBO(low_res ? FBO_QUARTER1 : FBO_HALF1);
+    FrameBuffer &auxiliary_fbo = getFBO(low_res ? FBO_QUARTER2 : FBO_HALF2);
+    scatter_fbo.Bind();
     glClearColor(0., 0., 0., 0.);
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -296,16 +376,22 @@ void IrrDriver::renderLightsScatter(unsigned pointlightcount)
     glBindVertexArray(LightShader::PointLightScatterShader::getInstance()->vao);
 
     LightShader::PointLightScatterShader::getInstance()->SetTextureUnits(irr_driver->getDepthStencilTexture());
-    LightShader::PointLightScatterShader::getInstance()->setUniforms(1.f / (40.f * start), col2);
+    LightShader::PointLightScatterShader::getInstance()->setUniforms(1.f / (40.f * start), col2,
+        core::vector2df((float)scatter_fbo.getWidth(), (float)scatter_fbo.getHeight()));
 
     glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, MIN2(pointlightcount, MAXLIGHT));
 
     glDisable(GL_BLEND);
-    m_post_processing->renderGaussian6Blur(getFBO(FBO_HALF1), getFBO(FBO_HALF2), 5., 5.);
+    // Same blur radius on screen at both resolutions
+    const float sigma = low_res ? 2.5f : 5.f;
+    m_post_processing->renderGaussian6Blur(scatter_fbo, auxiliary_fbo, sigma, sigma);
     glEnable(GL_BLEND);
 
     glDisable(GL_DEPTH_TEST);
     glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     getFBO(FBO_COLORS).Bind();
-    m_post_processing->renderPassThrough(getRenderTargetTexture(RTT_HALF1), getFBO(FBO_COLORS).getWidth(), getFBO(FBO_COLORS).getHeight());
+    if (low_res)
+        m_post_processing->renderBilateralUpsample(scatter_fbo.getRTT()[0]);
+    else
+        m_post_processing->renderPassThrough(getRenderTargetTexture(RTT_HALF1), getFBO(FBO_COLORS).getWidth(), getFBO(FBO_COLORS).getHeight());
 }
@@ -20,8 +20,11 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/shaders.hpp"
 #include "modes/world.hpp"
+#include "utils/log.hpp"
 #include "utils/profiler.hpp"
 
+#include <fstream>
+
 #define MAX2(a, b) ((a) > (b) ? (a) : (b))
 #define MIN2(a, b) ((a) > (b) ? (b) : (a))
 
@@ -223,6 +226,133 @@ void swapPixels(char *old_img, char *new_img, unsigned stride, unsigned old_i, u
 }
 
 
+/** Returns the image of a cubemap face. The image is decoded from the file
+ *  the texture was loaded from, only if that fails (e.g. for a generated
+ *  texture) it is read back from the GPU.
+ *  \param texture The texture of the face.
+ */
+static video::IImage *createFaceImage(video::ITexture *texture)
+{
+    video::IVideoDriver *driver = irr_driver->getVideoDriver();
+    video::IImage *image =
+        driver->createImageFromFile(texture->getName().getPath());
+    if (image)
+        return image;
+
+    Log::debug("Skybox", "Reading back texture '%s'.",
+               texture->getName().getPath().c_str());
+    image = driver->createImage(texture->getColorFormat(), texture->getSize());
+    memcpy(image->lock(), texture->lock(),
+           texture->getPitch() * texture->getSize().Height);
+    texture->unlock();
+    image->unlock();
+    return image;
+}   // createFaceImage
+
+// ----------------------------------------------------------------------------
+/** Loads all levels of a cubemap saved by saveCubemap() in the bound cubemap
+ *  texture. The file contains the size, the number of levels, the internal
+ *  format, and then the size and data of each face of each level, level by
+ *  level. Compressed data is stored as is, so the driver does not compress
+ *  the faces again.
+ *  \param size Expected size of the cubemap.
+ *  \param compressed True if the cubemap is expected to be compressed.
+ *  \return True if the cubemap was loaded.
+ */
+static bool loadCubemap(const std::string &file, unsigned size,
+                        bool compressed)
+{
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    unsigned header[4];
+    ifs.read((char*)header, sizeof(header));
+    if (ifs.fail() || header[0] != size || header[1] == 0 ||
+        header[1] > 32 || (header[3] != 0) != compressed)
+        return false;
+    std::vector<char> data;
+    for (unsigned level = 0; level < header[1]; level++)
+    {
+        const unsigned level_size = MAX2(size >> level, 1u);
+        for (unsigned face = 0; face < 6; face++)
+        {
+            unsigned length;
+            ifs.read((char*)&length, sizeof(length));
+            // At least one 4x4 block of 16 bytes for compressed levels
+            if (ifs.fail() || length > MAX2(4 * level_size * level_size, 64u))
+                return false;
+            data.resize(length);
+            ifs.read(data.data(), length);
+            if (ifs.fail())
+                return false;
+            if (compressed)
+                glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                                       level, header[2], level_size,
+                                       level_size, 0, length, data.data());
+            else
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level,
+                             header[2], level_size, level_size, 0, GL_BGRA,
+                             GL_UNSIGNED_BYTE, data.data());
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, header[1] - 1);
+    return true;
+}   // loadCubemap
+
+// ----------------------------------------------------------------------------
+/** Saves all levels of the bound cubemap texture, see loadCubemap(). This
+ *  reads the cubemap back from the GPU, but only the first time a skybox
+ *  is used.
+ */
+static void saveCubemap(const std::string &file, unsigned size,
+                        bool compressed)
+{
+    unsigned levels = 1;
+    while ((size >> levels) > 0)
+        levels++;
+    GLint format, is_compressed;
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0,
+                             GL_TEXTURE_INTERNAL_FORMAT, &format);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0,
+                             GL_TEXTURE_COMPRESSED, &is_compressed);
+    // The driver is allowed to not compress a texture
+    if ((is_compressed != 0) != compressed)
+        return;
+    std::ofstream ofs(file.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return;
+    unsigned header[4] = { size, levels, (unsigned)format, compressed };
+    ofs.write((const char*)header, sizeof(header));
+    std::vector<char> data;
+    for (unsigned level = 0; level < levels; level++)
+    {
+        const unsigned level_size = MAX2(size >> level, 1u);
+        for (unsigned face = 0; face < 6; face++)
+        {
+            GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+            GLint length = 4 * level_size * level_size;
+            if (compressed)
+            {
+                glGetTexLevelParameteriv(target, level,
+                                         GL_TEXTURE_COMPRESSED_IMAGE_SIZE,
+                                         &length);
+                data.resize(length);
+                glGetCompressedTexImage(target, level, data.data());
+            }
+            else
+            {
+                data.resize(length);
+                glGetTexImage(target, level, GL_BGRA, GL_UNSIGNED_BYTE,
+                              data.data());
+            }
+            unsigned l = length;
+            ofs.write((const char*)&l, sizeof(l));
+            ofs.write(data.data(), length);
+        }
+    }
+}   // saveCubemap
+
+// ----------------------------------------------------------------------------
 /** Generate an opengl cubemap texture from 6 2d textures.
 Out of legacy the sequence of textures maps to :
 - 1st texture maps to GL_TEXTURE_CUBE_MAP_POSITIVE_Y
@@ -231,9 +361,14 @@ Out of legacy the sequence of textures maps to :
 - 4th texture maps to GL_TEXTURE_CUBE_MAP_NEGATIVE_X
 - 5th texture maps to GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
 - 6th texture maps to GL_TEXTURE_CUBE_MAP_POSITIVE_Z
+*  The faces are decoded from their files (see createFaceImage), and the
+*  result is cached, so that the cubemap is usually only read from disk.
 *  \param textures sequence of 6 textures.
+*  \param cache_file File the cubemap is loaded from if it exists, and saved
+*         to otherwise. Can be empty to disable caching.
 */
-GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &textures)
+GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &textures,
+                                   const std::string &cache_file)
 {
     assert(textures.size() == 6);
 
@@ -247,6 +382,11 @@ GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &texture
         size = MAX2(size, textures[i]->getSize().Height);
     }
 
+    const bool compressed = CVS->isTextureCompressionEnabled();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, result);
+    if (!cache_file.empty() && loadCubemap(cache_file, size, compressed))
+        return result;
+
     const unsigned texture_permutation[] = { 2, 3, 0, 1, 5, 4 };
     char *rgba[6];
     for (unsigned i = 0; i < 6; i++)
@@ -255,14 +395,7 @@ GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &texture
     {
         unsigned idx = texture_permutation[i];
 
-        video::IImage* image = irr_driver->getVideoDriver()->createImageFromData(
-            textures[idx]->getColorFormat(),
-            textures[idx]->getSize(),
-            textures[idx]->lock(),
-            false
-            );
-        textures[idx]->unlock();
-
+        video::IImage* image = createFaceImage(textures[idx]);
         image->copyToScaling(rgba[i], size, size);
         image->drop();
 
@@ -280,8 +413,7 @@ GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &texture
             delete[] tmp;
         }
 
-        glBindTexture(GL_TEXTURE_CUBE_MAP, result);
-        if (CVS->isTextureCompressionEnabled())
+        if (compressed)
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_COMPRESSED_SRGB_ALPHA, size, size, 0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)rgba[i]);
         else
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB_ALPHA, size, size, 0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)rgba[i]);
@@ -289,6 +421,8 @@ GLuint generateCubeMapFromTextures(const std::vector<video::ITexture *> &texture
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     for (unsigned i = 0; i < 6; i++)
         delete[] rgba[i];
+    if (!cache_file.empty())
+        saveCubemap(cache_file, size, compressed);
     return result;
 }
 
@@ -299,8 +433,10 @@ void IrrDriver::prepareSkybox()
     generateDiffuseCoefficients();
     if (!SkyboxTextures.empty())
     {
-        SkyboxCubeMap = generateCubeMapFromTextures(SkyboxTextures);
-        SkyboxSpecularProbe = generateSpecularCubemap(SkyboxCubeMap);
+        SkyboxCubeMap = generateCubeMapFromTextures(SkyboxTextures,
+            getIBLCacheFile(SkyboxTextures, "cubemap"));
+        SkyboxSpecularProbe = generateSpecularCubemap(SkyboxCubeMap,
+            getIBLCacheFile(SkyboxTextures, "specular"));
     }
 }
 
@@ -311,8 +447,12 @@ void IrrDriver::generateDiffuseCoefficients()
     unsigned sh_w = 0, sh_h = 0;
     unsigned char *sh_rgba[6];
 
+    std::string cache_file;
     if (SphericalHarmonicsTextures.size() == 6)
     {
+        cache_file = getIBLCacheFile(SphericalHarmonicsTextures, "sh");
+        if (loadSHCoefficients(cache_file, blueSHCoeff, greenSHCoeff, redSHCoeff))
+            return;
 
         for (unsigned i = 0; i < 6; i++)
         {
@@ -326,16 +466,10 @@ void IrrDriver::generateDiffuseCoefficients()
         {
             unsigned idx = texture_permutation[i];
 
-            video::IImage* image = getVideoDriver()->createImageFromData(
-                SphericalHarmonicsTextures[idx]->getColorFormat(),
-                SphericalHarmonicsTextures[idx]->getSize(),
-                SphericalHarmonicsTextures[idx]->lock(),
-                false
-                );
-            SphericalHarmonicsTextures[idx]->unlock();
-
+            video::IImage* image =
+                createFaceImage(SphericalHarmonicsTextures[idx]);
             image->copyToScaling(sh_rgba[i], sh_w, sh_h);
-            delete image;
+            image->drop();
         }
 
     }
@@ -374,6 +508,8 @@ void IrrDriver::generateDiffuseCoefficients()
     }
 
     SphericalHarmonics(FloatTexCube, sh_w, blueSHCoeff, greenSHCoeff, redSHCoeff);
+    if (!cache_file.empty())
+        saveSHCoefficients(cache_file, blueSHCoeff, greenSHCoeff, redSHCoeff);
 
     for (unsigned i = 0; i < 6; i++)
     {
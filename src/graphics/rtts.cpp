@@ -21,6 +21,7 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/post_processing.hpp"
+#include "graphics/shadow_cache.hpp"
 #include "utils/log.hpp"
 #include <ISceneManager.h>
 
@@ -53,6 +54,7 @@ RTT::RTT(size_t width, size_t height)
     m_width = width;
     m_height = height;
     m_shadow_FBO = NULL;
+    m_shadow_cache_FBO = NULL;
     m_RH_FBO = NULL;
     m_RSM = NULL;
     m_RH_FBO = NULL;
@@ -74,155 +76,111 @@ RTT::RTT(size_t width, size_t height)
 
     DepthStencilTexture = generateRTT(res, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
 
-    // All RTTs are currently RGBA16F mostly with stencil. The four tmp RTTs are the same size
-    // as the screen, for use in post-processing.
-
-    RenderTargetTextures[RTT_TMP1] = generateRTT(res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP2] = generateRTT(res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP3] = generateRTT(res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP4] = generateRTT(res, GL_R16F, GL_RED, GL_FLOAT);
-    RenderTargetTextures[RTT_LINEAR_DEPTH] = generateRTT(res, GL_R32F, GL_RED, GL_FLOAT, linear_depth_mip_levels);
-    RenderTargetTextures[RTT_NORMAL_AND_DEPTH] = generateRTT(res, GL_RGBA16F, GL_RGBA, GL_FLOAT);
-    RenderTargetTextures[RTT_COLOR] = generateRTT(res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_MLAA_COLORS] = generateRTT(res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
-    RenderTargetTextures[RTT_MLAA_TMP] = generateRTT(res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
-    RenderTargetTextures[RTT_MLAA_BLEND] = generateRTT(res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
-    RenderTargetTextures[RTT_SSAO] = generateRTT(res, GL_R16F, GL_RED, GL_FLOAT);
-    RenderTargetTextures[RTT_DISPLACE] = generateRTT(res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_DIFFUSE] = generateRTT(res, GL_R11F_G11F_B10F, GL_BGR, GL_FLOAT);
-    RenderTargetTextures[RTT_SPECULAR] = generateRTT(res, GL_R11F_G11F_B10F, GL_BGR, GL_FLOAT);
-
-    RenderTargetTextures[RTT_HALF1] = generateRTT(half, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_QUARTER1] = generateRTT(quarter, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_EIGHTH1] = generateRTT(eighth, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_HALF1_R] = generateRTT(half, GL_R16F, GL_RED, GL_FLOAT);
-
-    RenderTargetTextures[RTT_HALF2] = generateRTT(half, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_QUARTER2] = generateRTT(quarter, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_EIGHTH2] = generateRTT(eighth, GL_RGBA16F, GL_BGRA, GL_FLOAT);
-    RenderTargetTextures[RTT_HALF2_R] = generateRTT(half, GL_R16F, GL_RED, GL_FLOAT);
-
-    RenderTargetTextures[RTT_BLOOM_1024] = generateRTT(shadowsize0, GL_RGBA16F, GL_BGR, GL_FLOAT);
-    RenderTargetTextures[RTT_SCALAR_1024] = generateRTT(shadowsize0, GL_R32F, GL_RED, GL_FLOAT);
-    RenderTargetTextures[RTT_BLOOM_512] = generateRTT(shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP_512] = generateRTT(shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
-	RenderTargetTextures[RTT_LENS_512] = generateRTT(shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
-	
-    RenderTargetTextures[RTT_BLOOM_256] = generateRTT(shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP_256] = generateRTT(shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
-	RenderTargetTextures[RTT_LENS_256] = generateRTT(shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
-	
-    RenderTargetTextures[RTT_BLOOM_128] = generateRTT(shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
-    RenderTargetTextures[RTT_TMP_128] = generateRTT(shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
-	RenderTargetTextures[RTT_LENS_128] = generateRTT(shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    // The render targets and frame buffers are only described here, and
+    // created by getRenderTarget and getFBO when they are used the first
+    // time. This way the targets of disabled effects (e.g. SSAO, MLAA, bloom,
+    // lightshafts) never use any memory, which matters at high resolutions
+    // and for the many small RTTs of the model view widgets.
+    for (unsigned i = 0; i < RTT_COUNT; i++)
+    {
+        RenderTargetTextures[i] = 0;
+        m_rtt_description[i].m_internal_format = 0;
+    }
+    for (unsigned i = 0; i < FBO_COUNT; i++)
+        FrameBuffers[i] = NULL;
+
+    // Most RTTs are RGBA16F mostly with stencil. The four tmp RTTs are the
+    // same size as the screen, for use in post-processing. Targets which
+    // never store an alpha value use the packed R11F_G11F_B10F format.
+
+    addRTT(RTT_TMP1, res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_TMP2, res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_TMP3, res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_TMP4, res, GL_R16F, GL_RED, GL_FLOAT);
+    addRTT(RTT_LINEAR_DEPTH, res, GL_R32F, GL_RED, GL_FLOAT, linear_depth_mip_levels);
+    // Maximum depth of each 2x2 block of pixels for occlusion culling,
+    // further reduced in each mip level
+    m_depth_pyramid_levels = 0;
+    if (CVS->isGPUCullingEnabled() || CVS->isOcclusionCullingEnabled())
+    {
+        const dimension2du pyramid(max_(half.Width, 1u), max_(half.Height, 1u));
+        m_depth_pyramid_levels = int(floorf(log2f(float(max_(pyramid.Width, pyramid.Height))))) + 1;
+        addRTT(RTT_DEPTH_PYRAMID, pyramid, GL_R32F, GL_RED, GL_FLOAT, m_depth_pyramid_levels);
+    }
+    addRTT(RTT_NORMAL_AND_DEPTH, res, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    addRTT(RTT_COLOR, res, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_MLAA_COLORS, res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
+    addRTT(RTT_MLAA_TMP, res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
+    addRTT(RTT_MLAA_BLEND, res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
+    addRTT(RTT_SSAO, res, GL_R16F, GL_RED, GL_FLOAT);
+    // The displace pass only writes rgb (with alpha 1)
+    addRTT(RTT_DISPLACE, res, GL_R11F_G11F_B10F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_DIFFUSE, res, GL_R11F_G11F_B10F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_SPECULAR, res, GL_R11F_G11F_B10F, GL_BGR, GL_FLOAT);
+
+    addRTT(RTT_HALF1, half, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_QUARTER1, quarter, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_EIGHTH1, eighth, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_HALF1_R, half, GL_R16F, GL_RED, GL_FLOAT);
+
+    addRTT(RTT_HALF2, half, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_QUARTER2, quarter, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_EIGHTH2, eighth, GL_RGBA16F, GL_BGRA, GL_FLOAT);
+    addRTT(RTT_HALF2_R, half, GL_R16F, GL_RED, GL_FLOAT);
+    addRTT(RTT_SSAO_HISTORY, half, GL_R16F, GL_RED, GL_FLOAT);
+    addRTT(RTT_TAA_HISTORY, res, GL_SRGB8_ALPHA8, GL_BGR, GL_UNSIGNED_BYTE);
+
+    addRTT(RTT_BLOOM_1024, shadowsize0, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_SCALAR_1024, shadowsize0, GL_R32F, GL_RED, GL_FLOAT);
+    addRTT(RTT_BLOOM_512, shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_TMP_512, shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_LENS_512, shadowsize1, GL_RGBA16F, GL_BGR, GL_FLOAT);
+
+    addRTT(RTT_BLOOM_256, shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_TMP_256, shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_LENS_256, shadowsize2, GL_RGBA16F, GL_BGR, GL_FLOAT);
+
+    addRTT(RTT_BLOOM_128, shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_TMP_128, shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
+    addRTT(RTT_LENS_128, shadowsize3, GL_RGBA16F, GL_BGR, GL_FLOAT);
+
+    addFBO(FBO_SSAO, RTT_SSAO, false);
+    addFBO(FBO_NORMAL_AND_DEPTHS, RTT_NORMAL_AND_DEPTH, true);
+    addFBO(FBO_COMBINED_DIFFUSE_SPECULAR, RTT_DIFFUSE, true, RTT_SPECULAR);
+    addFBO(FBO_COLORS, RTT_COLOR, true);
+    addFBO(FBO_DIFFUSE, RTT_DIFFUSE, false);
+    addFBO(FBO_SPECULAR, RTT_SPECULAR, false);
+    addFBO(FBO_MLAA_COLORS, RTT_MLAA_COLORS, false);
+    addFBO(FBO_MLAA_BLEND, RTT_MLAA_BLEND, false);
+    addFBO(FBO_MLAA_TMP, RTT_MLAA_TMP, false);
+    addFBO(FBO_TMP1_WITH_DS, RTT_TMP1, true);
+    addFBO(FBO_TMP2_WITH_DS, RTT_TMP2, true);
+    addFBO(FBO_TMP4, RTT_TMP4, false);
+    addFBO(FBO_LINEAR_DEPTH, RTT_LINEAR_DEPTH, false);
+    addFBO(FBO_HALF1, RTT_HALF1, false);
+    addFBO(FBO_HALF1_R, RTT_HALF1_R, false);
+    addFBO(FBO_HALF2, RTT_HALF2, false);
+    addFBO(FBO_HALF2_R, RTT_HALF2_R, false);
+    addFBO(FBO_QUARTER1, RTT_QUARTER1, false);
+    addFBO(FBO_QUARTER2, RTT_QUARTER2, false);
+    addFBO(FBO_EIGHTH1, RTT_EIGHTH1, false);
+    addFBO(FBO_EIGHTH2, RTT_EIGHTH2, false);
+    addFBO(FBO_DISPLACE, RTT_DISPLACE, true);
+    addFBO(FBO_BLOOM_1024, RTT_BLOOM_1024, false);
+    addFBO(FBO_SCALAR_1024, RTT_SCALAR_1024, false);
+    addFBO(FBO_BLOOM_512, RTT_BLOOM_512, false);
+    addFBO(FBO_TMP_512, RTT_TMP_512, false);
+    addFBO(FBO_LENS_512, RTT_LENS_512, false);
+    addFBO(FBO_BLOOM_256, RTT_BLOOM_256, false);
+    addFBO(FBO_TMP_256, RTT_TMP_256, false);
+    addFBO(FBO_LENS_256, RTT_LENS_256, false);
+    addFBO(FBO_BLOOM_128, RTT_BLOOM_128, false);
+    addFBO(FBO_TMP_128, RTT_TMP_128, false);
+    addFBO(FBO_LENS_128, RTT_LENS_128, false);
+    addFBO(FBO_SSAO_HISTORY, RTT_SSAO_HISTORY, false);
+    addFBO(FBO_TAA_HISTORY, RTT_TAA_HISTORY, false);
 
     std::vector<GLuint> somevector;
-    somevector.push_back(RenderTargetTextures[RTT_SSAO]);
-
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_NORMAL_AND_DEPTH]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_DIFFUSE]);
-    somevector.push_back(RenderTargetTextures[RTT_SPECULAR]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_COLOR]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_DIFFUSE]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_SPECULAR]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_MLAA_COLORS]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_MLAA_BLEND]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_MLAA_TMP]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP1]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP2]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP4]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_LINEAR_DEPTH]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_HALF1]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, half.Width, half.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_HALF1_R]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, half.Width, half.Height));
-
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_HALF2]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, half.Width, half.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_HALF2_R]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, half.Width, half.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_QUARTER1]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, quarter.Width, quarter.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_QUARTER2]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, quarter.Width, quarter.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_EIGHTH1]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, eighth.Width, eighth.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_EIGHTH2]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, eighth.Width, eighth.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_DISPLACE]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, DepthStencilTexture, res.Width, res.Height));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_BLOOM_1024]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 1024, 1024));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_SCALAR_1024]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 1024, 1024));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_BLOOM_512]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 512, 512));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP_512]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 512, 512));
-	somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_LENS_512]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 512, 512));
-
-
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_BLOOM_256]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 256, 256));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP_256]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 256, 256));
-	somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_LENS_256]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 256, 256));
-
-
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_BLOOM_128]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 128, 128));
-    somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_TMP_128]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 128, 128));
-	somevector.clear();
-    somevector.push_back(RenderTargetTextures[RTT_LENS_128]);
-    FrameBuffers.push_back(new FrameBuffer(somevector, 128, 128));
-
     if (CVS->isShadowEnabled())
     {
         shadowColorTex = generateRTT3D(GL_TEXTURE_2D_ARRAY, UserConfigParams::m_shadows_resolution, UserConfigParams::m_shadows_resolution, 4, GL_R32F, GL_RED, GL_FLOAT, 10);
@@ -231,6 +189,17 @@ RTT::RTT(size_t width, size_t height)
         somevector.clear();
         somevector.push_back(shadowColorTex);
         m_shadow_FBO = new FrameBuffer(somevector, shadowDepthTex, UserConfigParams::m_shadows_resolution, UserConfigParams::m_shadows_resolution, true);
+
+        if (CVS->isShadowCacheEnabled())
+        {
+            const size_t layers = 4 - ShadowCache::FIRST_CACHED_CASCADE;
+            shadowCacheColorTex = generateRTT3D(GL_TEXTURE_2D_ARRAY, UserConfigParams::m_shadows_resolution, UserConfigParams::m_shadows_resolution, layers, GL_R32F, GL_RED, GL_FLOAT);
+            shadowCacheDepthTex = generateRTT3D(GL_TEXTURE_2D_ARRAY, UserConfigParams::m_shadows_resolution, UserConfigParams::m_shadows_resolution, layers, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+
+            somevector.clear();
+            somevector.push_back(shadowCacheColorTex);
+            m_shadow_cache_FBO = new FrameBuffer(somevector, shadowCacheDepthTex, UserConfigParams::m_shadows_resolution, UserConfigParams::m_shadows_resolution, true);
+        }
     }
 
     if (CVS->isGlobalIlluminationEnabled())
@@ -269,7 +238,13 @@ RTT::RTT(size_t width, size_t height)
 
 RTT::~RTT()
 {
-    glDeleteTextures(RTT_COUNT, RenderTargetTextures);
+    for (unsigned i = 0; i < FBO_COUNT; i++)
+        delete FrameBuffers[i];
+    for (unsigned i = 0; i < RTT_COUNT; i++)
+    {
+        if (RenderTargetTextures[i])
+            glDeleteTextures(1, &RenderTargetTextures[i]);
+    }
     glDeleteTextures(1, &DepthStencilTexture);
     if (CVS->isShadowEnabled())
     {
@@ -277,6 +252,12 @@ RTT::~RTT()
         glDeleteTextures(1, &shadowColorTex);
         glDeleteTextures(1, &shadowDepthTex);
     }
+    if (m_shadow_cache_FBO)
+    {
+        delete m_shadow_cache_FBO;
+        glDeleteTextures(1, &shadowCacheColorTex);
+        glDeleteTextures(1, &shadowCacheDepthTex);
+    }
     if (CVS->isGlobalIlluminationEnabled())
     {
         delete m_RH_FBO;
@@ -290,13 +271,86 @@ RTT::~RTT()
     }
 }
 
+// ----------------------------------------------------------------------------
+/** Describes a render target, which is created once it is used. */
+void RTT::addRTT(TypeRTT rtt, const core::dimension2du &size,
+                 GLint internal_format, GLint format, GLint type,
+                 unsigned mip_levels)
+{
+    RTTDescription &d = m_rtt_description[rtt];
+    d.m_size            = size;
+    d.m_internal_format = internal_format;
+    d.m_format          = format;
+    d.m_type            = type;
+    d.m_mip_levels      = mip_levels;
+}   // addRTT
+
+// ----------------------------------------------------------------------------
+/** Describes a frame buffer, which is created once it is used. The size of
+ *  the frame buffer is the size of its first render target.
+ *  \param rtt The first render target.
+ *  \param depth_stencil If the depth stencil texture is attached.
+ *  \param rtt2 Optional second render target, or RTT_COUNT.
+ */
+void RTT::addFBO(TypeFBO fbo, TypeRTT rtt, bool depth_stencil, TypeRTT rtt2)
+{
+    FBODescription &d = m_fbo_description[fbo];
+    d.m_rtts.clear();
+    d.m_rtts.push_back(rtt);
+    if (rtt2 != RTT_COUNT)
+        d.m_rtts.push_back(rtt2);
+    d.m_depth_stencil = depth_stencil;
+}   // addFBO
+
+// ----------------------------------------------------------------------------
+/** Creates a render target the first time it is used. This can happen in
+ *  the middle of rendering, so the texture binding is not changed. Render
+ *  targets of disabled features (e.g. the depth pyramid) stay 0.
+ */
+void RTT::createRTT(TypeRTT rtt)
+{
+    const RTTDescription &d = m_rtt_description[rtt];
+    if (d.m_internal_format == 0)
+        return;
+    GLint old_texture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &old_texture);
+    RenderTargetTextures[rtt] = generateRTT(d.m_size, d.m_internal_format,
+                                            d.m_format, d.m_type,
+                                            d.m_mip_levels);
+    glBindTexture(GL_TEXTURE_2D, old_texture);
+}   // createRTT
+
+// ----------------------------------------------------------------------------
+/** Creates a frame buffer and its render targets the first time it is used,
+ *  without changing the bound frame buffer.
+ */
+void RTT::createFBO(TypeFBO fbo)
+{
+    const FBODescription &d = m_fbo_description[fbo];
+    assert(!d.m_rtts.empty());
+    std::vector<GLuint> rtts;
+    for (unsigned i = 0; i < d.m_rtts.size(); i++)
+        rtts.push_back(getRenderTarget(d.m_rtts[i]));
+    const core::dimension2du &size = m_rtt_description[d.m_rtts[0]].m_size;
+
+    GLint old_fbo;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &old_fbo);
+    if (d.m_depth_stencil)
+        FrameBuffers[fbo] = new FrameBuffer(rtts, DepthStencilTexture,
+                                            size.Width, size.Height);
+    else
+        FrameBuffers[fbo] = new FrameBuffer(rtts, size.Width, size.Height);
+    glBindFramebuffer(GL_FRAMEBUFFER, old_fbo);
+}   // createFBO
+
+// ----------------------------------------------------------------------------
 FrameBuffer* RTT::render(scene::ICameraSceneNode* camera, float dt)
 {
     irr_driver->setRTT(this);
 
     irr_driver->getSceneManager()->setActiveCamera(camera);
 
-    std::vector<IrrDriver::GlowData> glows;
+    IrrDriver::GlowList glows;
     // TODO: put this outside of the rendering loop
     irr_driver->generateDiffuseCoefficients();
     irr_driver->computeMatrixesAndCameras(camera, m_width, m_height);
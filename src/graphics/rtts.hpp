@@ -19,9 +19,10 @@
 #define HEADER_RTTS_HPP
 
 #include "graphics/irr_driver.hpp"
-#include "utils/ptr_vector.hpp"
 #include "utils/leak_check.hpp"
 
+#include <vector>
+
 class FrameBuffer;
 
 namespace irr {
@@ -43,27 +44,74 @@ public:
     ~RTT();
 
     FrameBuffer &getShadowFBO() { return *m_shadow_FBO; }
+    /** Returns the cached static shadows of the far cascades, or NULL if the
+     *  shadow cache is disabled. */
+    FrameBuffer *getShadowCacheFBO() { return m_shadow_cache_FBO; }
     FrameBuffer &getRH() { return *m_RH_FBO; }
     FrameBuffer &getRSM() { return *m_RSM; }
 
     unsigned getDepthStencilTexture() const { return DepthStencilTexture; }
-    unsigned getRenderTarget(enum TypeRTT target) const { return RenderTargetTextures[target]; }
-    FrameBuffer& getFBO(enum TypeFBO fbo) { return FrameBuffers[fbo]; }
+    /** Returns a render target, which is created if necessary. */
+    unsigned getRenderTarget(enum TypeRTT target)
+    {
+        if (!RenderTargetTextures[target])
+            createRTT(target);
+        return RenderTargetTextures[target];
+    }
+    /** Returns a frame buffer, which is created if necessary. */
+    FrameBuffer& getFBO(enum TypeFBO fbo)
+    {
+        if (!FrameBuffers[fbo])
+            createFBO(fbo);
+        return *FrameBuffers[fbo];
+    }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    unsigned getDepthPyramidLevels() const { return m_depth_pyramid_levels; }
 
     FrameBuffer* render(irr::scene::ICameraSceneNode* camera, float dt);
 
 private:
+    /** Size and format of a render target. */
+    struct RTTDescription
+    {
+        irr::core::dimension2du m_size;
+        GLint    m_internal_format, m_format, m_type;
+        unsigned m_mip_levels;
+    };
+    /** The render targets of a frame buffer, and if the depth stencil
+     *  texture is attached. */
+    struct FBODescription
+    {
+        std::vector<TypeRTT> m_rtts;
+        bool                 m_depth_stencil;
+    };
+    RTTDescription m_rtt_description[RTT_COUNT];
+    FBODescription m_fbo_description[FBO_COUNT];
+
+    /** The render targets and frame buffers, which are 0 or NULL until they
+     *  are used the first time. */
     unsigned RenderTargetTextures[RTT_COUNT];
-    PtrVector<FrameBuffer> FrameBuffers;
+    FrameBuffer *FrameBuffers[FBO_COUNT];
     unsigned DepthStencilTexture;
 
     int m_width;
     int m_height;
+    unsigned m_depth_pyramid_levels;
 
     unsigned shadowColorTex, shadowNormalTex, shadowDepthTex;
+    unsigned shadowCacheColorTex, shadowCacheDepthTex;
     unsigned RSM_Color, RSM_Normal, RSM_Depth;
     unsigned RH_Red, RH_Green, RH_Blue;
-    FrameBuffer* m_shadow_FBO, *m_RSM, *m_RH_FBO;
+    FrameBuffer* m_shadow_FBO, *m_shadow_cache_FBO, *m_RSM, *m_RH_FBO;
+
+    void addRTT(TypeRTT rtt, const irr::core::dimension2du &size,
+                GLint internal_format, GLint format, GLint type,
+                unsigned mip_levels = 1);
+    void addFBO(TypeFBO fbo, TypeRTT rtt, bool depth_stencil,
+                TypeRTT rtt2 = RTT_COUNT);
+    void createRTT(TypeRTT rtt);
+    void createFBO(TypeFBO fbo);
 
     LEAK_CHECK();
 };
@@ -98,9 +98,12 @@
 #include "graphics/gpuparticles.hpp"
 #include "graphics/shaders.hpp"
 #include "io/file_manager.hpp"
+#include "utils/load_profiler.hpp"
 #include "utils/log.hpp"
+#include "utils/string_utils.hpp"
 #include "graphics/glwrap.hpp"
 #include <assert.h>
+#include <fstream>
 #include <IGPUProgrammingServices.h>
 
 using namespace video;
@@ -142,10 +145,9 @@ static std::string LoadHeader()
     return result;
 }
 
-// Mostly from shader tutorial
-GLuint LoadShader(const char * file, unsigned type)
+/** Returns the complete source of a shader file, as sent to the driver. */
+static std::string getShaderCode(const char *file)
 {
-    GLuint Id = glCreateShader(type);
     char versionString[20];
     sprintf(versionString, "#version %d\n", CVS->getGLSLVersion());
     std::string Code = versionString;
@@ -172,6 +174,15 @@ GLuint LoadShader(const char * file, unsigned type)
             Code += "\n" + Line;
         Stream.close();
     }
+    return Code;
+}
+
+// Mostly from shader tutorial
+GLuint LoadShader(const char * file, unsigned type)
+{
+    GLuint Id = glCreateShader(type);
+    std::string Code = getShaderCode(file);
+    LoadProfiler::addBytes(LoadProfiler::STAGE_SHADERS, Code.size());
     GLint Result = GL_FALSE;
     int InfoLogLength;
     Log::info("GLWrap", "Compiling shader : %s", file);
@@ -199,6 +210,110 @@ GLuint LoadShader(const char * file, unsigned type)
     return Id;
 }
 
+// ----------------------------------------------------------------------------
+/** Returns the name of the file the binary of a program is cached in, based
+ *  on a hash of the driver, the attribute bindings and the complete source
+ *  of all shaders; any change of these results in a new entry. Returns an
+ *  empty string if programs must not be cached.
+ *  \param Tp The AttributeType of the program.
+ *  \param files The shader type and file of each shader of the program.
+ */
+std::string getProgramCacheKey(int Tp, const ShaderFileList &files)
+{
+    if (!CVS->isShaderCacheEnabled())
+        return "";
+
+    static std::string driver;
+    if (driver.empty())
+    {
+        driver = std::string((const char*)glGetString(GL_VENDOR)) + "\n" +
+                 (const char*)glGetString(GL_RENDERER) + "\n" +
+                 (const char*)glGetString(GL_VERSION) + "\n";
+    }
+
+    // 64 bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    std::string data = driver + StringUtils::toString(Tp);
+    for (unsigned i = 0; i < files.size(); i++)
+        data += "\n" + StringUtils::toString(files[i].first) + "\n" + getShaderCode(files[i].second);
+    for (unsigned i = 0; i < data.size(); i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    static std::string dir;
+    if (dir.empty())
+    {
+        dir = file_manager->getUserConfigFile("shaders/");
+        file_manager->checkAndCreateDirectoryP(dir);
+    }
+    char name[24];
+    sprintf(name, "%08x%08x.bin", (unsigned)(hash >> 32), (unsigned)hash);
+    return dir + name;
+}   // getProgramCacheKey
+
+// ----------------------------------------------------------------------------
+/** Loads a program binary saved by saveProgramBinary(). The driver can
+ *  reject a binary (e.g. after an update it did not report in its version
+ *  string), in which case the program has to be compiled again.
+ *  \return True if the program was successfully loaded and linked.
+ */
+bool loadProgramBinary(GLuint ProgramID, const std::string &key)
+{
+    std::ifstream ifs(key.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    GLenum format;
+    GLint size = -1;
+    ifs.read((char*)&format, sizeof(GLenum));
+    ifs.read((char*)&size, sizeof(GLint));
+    if (ifs.fail() || size <= 0)
+        return false;
+
+    std::vector<char> data(size);
+    ifs.read(data.data(), size);
+    if (ifs.fail())
+        return false;
+    LoadProfiler::addBytes(LoadProfiler::STAGE_SHADERS, size);
+
+    glProgramBinary(ProgramID, format, data.data(), size);
+    GLint Result = GL_FALSE;
+    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+    glGetError();
+    if (Result == GL_FALSE)
+    {
+        Log::info("GLWrap", "Cached program %s is outdated.", key.c_str());
+        return false;
+    }
+    return true;
+}   // loadProgramBinary
+
+// ----------------------------------------------------------------------------
+/** Saves the binary of a linked program for the next runs. The file format
+ *  is <binary format><size><data>, the first two values being integers.
+ */
+void saveProgramBinary(GLuint ProgramID, const std::string &key)
+{
+    GLint size = 0;
+    glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return;
+
+    std::vector<char> data(size);
+    GLenum format;
+    glGetProgramBinary(ProgramID, size, NULL, &format, data.data());
+    std::ofstream ofs(key.c_str(), std::ios::out | std::ios::binary);
+    if (ofs.is_open())
+    {
+        ofs.write((char*)&format, sizeof(GLenum));
+        ofs.write((char*)&size, sizeof(GLint));
+        ofs.write(data.data(), size);
+        ofs.close();
+    }
+}   // saveProgramBinary
+
 void setAttribute(AttributeType Tp, GLuint ProgramID)
 {
     switch (Tp)
@@ -214,6 +329,7 @@ void setAttribute(AttributeType Tp, GLuint ProgramID)
         glBindAttribLocation(ProgramID, 7, "Origin");
         glBindAttribLocation(ProgramID, 8, "Orientation");
         glBindAttribLocation(ProgramID, 9, "Scale");
+        glBindAttribLocation(ProgramID, 14, "TexcoordOffset");
         break;
     case PARTICLES_SIM:
         glBindAttribLocation(ProgramID, 0, "particle_position");
@@ -237,6 +353,7 @@ void setAttribute(AttributeType Tp, GLuint ProgramID)
 
 GLuint LoadTFBProgram(const char * vertex_file_path, const char **varyings, unsigned varyingscount)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_SHADERS);
     GLuint Program = glCreateProgram();
     loadAndAttach(Program, GL_VERTEX_SHADER, vertex_file_path);
     if (CVS->getGLSLVersion() < 330)
@@ -930,6 +1047,24 @@ namespace MeshShader
         AssignSamplerNames(Program, 0, "tex", 1, "glosstex");
     }
 
+    ObjectRefDepthShader::ObjectRefDepthShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/object_pass.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/objectref_depth.frag").c_str());
+        AssignUniforms("ModelMatrix", "InverseModelMatrix", "TextureMatrix");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
+    GrassDepthShader::GrassDepthShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/grass_pass.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/objectref_depth.frag").c_str());
+        AssignUniforms("ModelMatrix", "InverseModelMatrix", "windDir");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
     NormalMapShader::NormalMapShader()
     {
         Program = LoadProgram(OBJECT,
@@ -975,6 +1110,26 @@ namespace MeshShader
         AssignSamplerNames(Program, 0, "tex", 1, "glosstex");
     }
 
+    InstancedObjectRefDepthShader::InstancedObjectRefDepthShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/utils/getworldmatrix.vert").c_str(),
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/instanced_object_pass.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/instanced_objectref_depth.frag").c_str());
+        AssignUniforms();
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
+    InstancedGrassDepthShader::InstancedGrassDepthShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/utils/getworldmatrix.vert").c_str(),
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/instanced_grass.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/instanced_objectref_depth.frag").c_str());
+        AssignUniforms("windDir");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
     InstancedNormalMapShader::InstancedNormalMapShader()
     {
         Program = LoadProgram(OBJECT,
@@ -1160,6 +1315,36 @@ namespace MeshShader
         AssignSamplerNames(Program, 0, "tex");
     }
 
+    LabelShader::LabelShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/label.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/billboard.frag").c_str());
+
+        AssignUniforms("ModelViewMatrix", "ProjectionMatrix");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
+    ImposterShader::ImposterShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/imposter.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/imposter.frag").c_str());
+
+        AssignUniforms("ModelViewMatrix", "ProjectionMatrix", "Position", "Size", "Tile");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
+    ImposterBakeShader::ImposterBakeShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/imposter_bake.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/imposter_bake.frag").c_str());
+
+        AssignUniforms("ModelViewProjectionMatrix");
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
     ColorizeShader::ColorizeShader()
     {
         Program = LoadProgram(OBJECT,
@@ -1461,7 +1646,7 @@ namespace LightShader
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getPosFromUVDepth.frag").c_str(),
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/pointlightscatter.frag").c_str());
 
-        AssignUniforms("density", "fogcol");
+        AssignUniforms("density", "fogcol", "target_size");
         AssignSamplerNames(Program, 0, "dtex");
 
         glGenVertexArrays(1, &vao);
@@ -1488,6 +1673,25 @@ namespace LightShader
         glVertexAttribDivisorARB(attrib_Color, 1);
         glVertexAttribDivisorARB(attrib_Radius, 1);
     }
+
+    TiledLightingShader::TiledLightingShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/utils/decodeNormal.frag").c_str(),
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/utils/SpecularBRDF.frag").c_str(),
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/utils/DiffuseBRDF.frag").c_str(),
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/utils/getPosFromUVDepth.frag").c_str(),
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/tiledlighting.comp").c_str());
+        TU_diffuse = 2;
+        TU_specular = 3;
+        AssignUniforms("light_count");
+        AssignSamplerNames(Program, 0, "ntex", 1, "dtex");
+        AssignTextureUnit(Program, TexUnit(TU_diffuse, "diffuse"), TexUnit(TU_specular, "specular"));
+
+        GLuint block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "PointLights");
+        glShaderStorageBlockBinding(Program, block_idx, 6);
+        glGenBuffers(1, &ssbo);
+    }
 }
 
 
@@ -1519,6 +1723,35 @@ namespace ParticleShader
         AssignUniforms("sourcematrix", "dt", "level", "size_increase_factor", "track_x", "track_x_len", "track_z", "track_z_len");
     }
 
+    ComputeSimulationShader::ComputeSimulationShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/particlesim.comp").c_str());
+        TU_heightmap = 2;
+        AssignTextureUnit(Program, TexUnit(TU_heightmap, "heightmap"));
+        AssignUniforms("sourcematrix", "dt", "level", "size_increase_factor", "first_particle", "particle_count",
+            "has_heightmap", "track_x", "track_x_len", "track_z", "track_z_len");
+
+        GLuint block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "Particles");
+        glShaderStorageBlockBinding(Program, block_idx, 10);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "InitialValues");
+        glShaderStorageBlockBinding(Program, block_idx, 11);
+    }
+
+    ParticleSortShader::ParticleSortShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/particlesort.comp").c_str());
+        AssignUniforms("first_particle", "particle_count", "stage", "block_size", "step");
+
+        GLuint block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "Particles");
+        glShaderStorageBlockBinding(Program, block_idx, 10);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "SortKeys");
+        glShaderStorageBlockBinding(Program, block_idx, 12);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "SortedParticles");
+        glShaderStorageBlockBinding(Program, block_idx, 13);
+    }
+
     SimpleParticleRender::SimpleParticleRender()
     {
         Program = LoadProgram(PARTICLES_RENDERING,
@@ -1572,36 +1805,32 @@ namespace FullScreenShader
         AssignSamplerNames(Program, 0, "tex");
     }
 
-    BloomBlendShader::BloomBlendShader()
-    {
-        Program = LoadProgram(OBJECT,
-            GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
-            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/bloomblend.frag").c_str());
-        AssignUniforms();
-
-        AssignSamplerNames(Program, 0, "tex_128", 1, "tex_256", 2, "tex_512");
-    }
-	
-	LensBlendShader::LensBlendShader()
+    ToneMapShader::ToneMapShader()
     {
         Program = LoadProgram(OBJECT,
             GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
-            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/lensblend.frag").c_str());
-        AssignUniforms();
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getRGBfromCIEXxy.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getCIEXYZ.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getNoBloom.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/tonemap.frag").c_str());
+        AssignUniforms("vignette_weight");
 
-        AssignSamplerNames(Program, 0, "tex_128", 1, "tex_256", 2, "tex_512");
+        AssignSamplerNames(Program, 0, "tex");
     }
 
-    ToneMapShader::ToneMapShader()
+    ToneMapBloomShader::ToneMapBloomShader()
     {
         Program = LoadProgram(OBJECT,
             GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getRGBfromCIEXxy.frag").c_str(),
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getCIEXYZ.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getBloom.frag").c_str(),
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/tonemap.frag").c_str());
         AssignUniforms("vignette_weight");
 
-        AssignSamplerNames(Program, 0, "text");
+        AssignSamplerNames(Program, 0, "tex", 1, "tex_128", 2, "tex_256",
+                           3, "tex_512", 4, "tex_lens_128", 5, "tex_lens_256",
+                           6, "tex_lens_512");
     }
 
     DepthOfFieldShader::DepthOfFieldShader()
@@ -1832,6 +2061,26 @@ namespace FullScreenShader
         AssignTextureUnit(Program, TexUnit(TU_dest, "dest"));
     }
 
+    ComputeGaussian3HBlurShader::ComputeGaussian3HBlurShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/gaussian3h.comp").c_str());
+        TU_dest = 1;
+        AssignUniforms();
+        AssignSamplerNames(Program, 0, "source");
+        AssignTextureUnit(Program, TexUnit(TU_dest, "dest"));
+    }
+
+    ComputeGaussian3VBlurShader::ComputeGaussian3VBlurShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/gaussian3v.comp").c_str());
+        TU_dest = 1;
+        AssignUniforms();
+        AssignSamplerNames(Program, 0, "source");
+        AssignTextureUnit(Program, TexUnit(TU_dest, "dest"));
+    }
+
     ComputeGaussian6VBlurShader::ComputeGaussian6VBlurShader()
     {
         Program = LoadProgram(OBJECT,
@@ -1937,6 +2186,45 @@ namespace FullScreenShader
         glShaderStorageBlockBinding(Program, block_idx, 1);
     }
 
+    DepthPyramidShader::DepthPyramidShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/depthpyramid.comp").c_str());
+        TU_dest = 1;
+        AssignUniforms("source_lod");
+        AssignSamplerNames(Program, 0, "source");
+        AssignTextureUnit(Program, TexUnit(TU_dest, "dest"));
+    }
+
+    InstanceCullingShader::InstanceCullingShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/instanceculling.comp").c_str());
+        AssignUniforms("first_command", "instance_stride", "PreviousProjectionViewMatrix", "depth_size", "pyramid_levels", "use_occlusion");
+        AssignSamplerNames(Program, 0, "pyramid");
+
+        GLuint block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "Commands");
+        glShaderStorageBlockBinding(Program, block_idx, 3);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "Instances");
+        glShaderStorageBlockBinding(Program, block_idx, 4);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "MeshBounds");
+        glShaderStorageBlockBinding(Program, block_idx, 5);
+    }
+
+    SkinningShader::SkinningShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_COMPUTE_SHADER, file_manager->getAsset("shaders/skinning.comp").c_str());
+        AssignUniforms("vertex_count", "vertex_offset", "vertex_stride");
+
+        GLuint block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "SkinningData");
+        glShaderStorageBlockBinding(Program, block_idx, 7);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "JointMatrices");
+        glShaderStorageBlockBinding(Program, block_idx, 8);
+        block_idx = glGetProgramResourceIndex(Program, GL_SHADER_STORAGE_BLOCK, "Vertices");
+        glShaderStorageBlockBinding(Program, block_idx, 9);
+    }
+
     GlowShader::GlowShader()
     {
         Program = LoadProgram(OBJECT,
@@ -1957,7 +2245,29 @@ namespace FullScreenShader
             GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/ssao.frag").c_str());
 
         AssignSamplerNames(Program, 0, "dtex");
-        AssignUniforms("radius", "k", "sigma");
+        AssignUniforms("radius", "k", "sigma", "target_size", "rotation");
+    }
+
+    SSAOAccumulationShader::SSAOAccumulationShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getPosFromUVDepth.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/ssaoaccumulation.frag").c_str());
+
+        AssignSamplerNames(Program, 0, "current_ao", 1, "history", 2, "dtex");
+        AssignUniforms("PreviousProjectionViewMatrix", "history_weight");
+    }
+
+    BilateralUpsampleShader::BilateralUpsampleShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getPosFromUVDepth.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/bilateralupsample.frag").c_str());
+
+        AssignUniforms();
+        AssignSamplerNames(Program, 0, "tex", 1, "dtex");
     }
 
     FogShader::FogShader()
@@ -2030,6 +2340,27 @@ namespace FullScreenShader
 
         AssignSamplerNames(Program, 0, "blendMap", 1, "colorMap");
     }
+
+    FXAAShader::FXAAShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/fxaa.frag").c_str());
+        AssignUniforms("PIXEL_SIZE");
+
+        AssignSamplerNames(Program, 0, "tex");
+    }
+
+    TemporalAAShader::TemporalAAShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/screenquad.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/utils/getPosFromUVDepth.frag").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/temporal_aa.frag").c_str());
+        AssignUniforms("PreviousProjectionViewMatrix", "history_weight");
+
+        AssignSamplerNames(Program, 0, "current_color", 1, "history", 2, "dtex");
+    }
 }
 
 namespace UIShader
@@ -2095,6 +2426,48 @@ namespace UIShader
         glBindVertexArray(0);
     }
 
+    ColoredTextureRectBatchShader::ColoredTextureRectBatchShader()
+    {
+        Program = LoadProgram(OBJECT,
+            GL_VERTEX_SHADER, file_manager->getAsset("shaders/colortexturedquadbatch.vert").c_str(),
+            GL_FRAGMENT_SHADER, file_manager->getAsset("shaders/colortexturedquad.frag").c_str());
+        AssignUniforms();
+
+        AssignSamplerNames(Program, 0, "tex");
+
+        // The quads never share vertices, so the indices are the same for
+        // every batch
+        std::vector<uint16_t> indices;
+        indices.reserve(MAX_QUADS * 6);
+        for (unsigned i = 0; i < MAX_QUADS; i++)
+        {
+            indices.push_back(uint16_t(4 * i));
+            indices.push_back(uint16_t(4 * i + 1));
+            indices.push_back(uint16_t(4 * i + 2));
+            indices.push_back(uint16_t(4 * i));
+            indices.push_back(uint16_t(4 * i + 2));
+            indices.push_back(uint16_t(4 * i + 3));
+        }
+
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, MAX_QUADS * 4 * sizeof(Vertex), 0, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)(2 * sizeof(float)));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLvoid *)(4 * sizeof(float)));
+        glGenBuffers(1, &ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
     ColoredRectShader::ColoredRectShader()
     {
         Program = LoadProgram(OBJECT,
@@ -76,6 +76,20 @@ public:
     GrassPass1Shader();
 };
 
+/** Depth only shaders for the alpha tested materials, used in the depth
+ *  pre-pass. */
+class ObjectRefDepthShader : public ShaderHelperSingleton<ObjectRefDepthShader, core::matrix4, core::matrix4, core::matrix4>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    ObjectRefDepthShader();
+};
+
+class GrassDepthShader : public ShaderHelperSingleton<GrassDepthShader, core::matrix4, core::matrix4, core::vector3df>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    GrassDepthShader();
+};
+
 class NormalMapShader : public ShaderHelperSingleton<NormalMapShader, core::matrix4, core::matrix4>, public TextureRead<Trilinear_Anisotropic_Filtered, Trilinear_Anisotropic_Filtered>
 {
 public:
@@ -100,6 +114,18 @@ public:
     InstancedGrassPass1Shader();
 };
 
+class InstancedObjectRefDepthShader : public ShaderHelperSingleton<InstancedObjectRefDepthShader>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    InstancedObjectRefDepthShader();
+};
+
+class InstancedGrassDepthShader : public ShaderHelperSingleton<InstancedGrassDepthShader, core::vector3df>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    InstancedGrassDepthShader();
+};
+
 class InstancedNormalMapShader : public ShaderHelperSingleton<InstancedNormalMapShader>, public TextureRead<Trilinear_Anisotropic_Filtered, Trilinear_Anisotropic_Filtered>
 {
 public:
@@ -202,6 +228,24 @@ public:
     BillboardShader();
 };
 
+class LabelShader : public ShaderHelperSingleton<LabelShader, core::matrix4, core::matrix4>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    LabelShader();
+};
+
+class ImposterShader : public ShaderHelperSingleton<ImposterShader, core::matrix4, core::matrix4, core::vector3df, core::dimension2df, core::vector2df>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    ImposterShader();
+};
+
+class ImposterBakeShader : public ShaderHelperSingleton<ImposterBakeShader, core::matrix4>, public TextureRead<Trilinear_Anisotropic_Filtered>
+{
+public:
+    ImposterBakeShader();
+};
+
 
 class ColorizeShader : public ShaderHelperSingleton<ColorizeShader, core::matrix4, video::SColorf>
 {
@@ -330,13 +374,21 @@ namespace LightShader
         PointLightShader();
     };
 
-    class PointLightScatterShader : public ShaderHelperSingleton<PointLightScatterShader, float, core::vector3df>, public TextureRead<Nearest_Filtered>
+    class PointLightScatterShader : public ShaderHelperSingleton<PointLightScatterShader, float, core::vector3df, core::vector2df>, public TextureRead<Nearest_Filtered>
     {
     public:
         GLuint vbo;
         GLuint vao;
         PointLightScatterShader();
     };
+
+    class TiledLightingShader : public ShaderHelperSingleton<TiledLightingShader, int>, public TextureRead<Nearest_Filtered, Nearest_Filtered>
+    {
+    public:
+        GLuint TU_diffuse, TU_specular;
+        GLuint ssbo;
+        TiledLightingShader();
+    };
 }
 
 namespace ParticleShader
@@ -358,6 +410,20 @@ public:
     HeightmapSimulationShader();
 };
 
+class ComputeSimulationShader : public ShaderHelperSingleton<ComputeSimulationShader, core::matrix4, int, int, float, int, int, int, float, float, float, float>
+{
+public:
+    GLuint TU_heightmap;
+
+    ComputeSimulationShader();
+};
+
+class ParticleSortShader : public ShaderHelperSingleton<ParticleSortShader, int, int, int, int, int>
+{
+public:
+    ParticleSortShader();
+};
+
 class SimpleParticleRender : public ShaderHelperSingleton<SimpleParticleRender, video::SColorf, video::SColorf>, public TextureRead<Trilinear_Anisotropic_Filtered, Nearest_Filtered>
 {
 public:
@@ -389,24 +455,22 @@ public:
     BloomShader();
 };
 
-class BloomBlendShader : public ShaderHelperSingleton<BloomBlendShader>, public TextureRead<Bilinear_Filtered, Bilinear_Filtered, Bilinear_Filtered>
+class ToneMapShader : public ShaderHelperSingleton<ToneMapShader, float>, public TextureRead<Nearest_Filtered>
 {
 public:
-    BloomBlendShader();
-};
 
-class LensBlendShader : public ShaderHelperSingleton<LensBlendShader>, public TextureRead<Bilinear_Filtered, Bilinear_Filtered, Bilinear_Filtered>
-{
-public:
-    LensBlendShader();
+    ToneMapShader();
 };
 
-
-class ToneMapShader : public ShaderHelperSingleton<ToneMapShader, float>, public TextureRead<Nearest_Filtered>
+/** Tone mapping which also adds the bloom and lens flare mips, so that they
+ *  don't need separate full screen blending passes. A separate program
+ *  instead of a uniform switch keeps the shader free of branches. */
+class ToneMapBloomShader : public ShaderHelperSingleton<ToneMapBloomShader, float>,
+    public TextureRead<Nearest_Filtered, Bilinear_Filtered, Bilinear_Filtered, Bilinear_Filtered,
+                       Bilinear_Filtered, Bilinear_Filtered, Bilinear_Filtered>
 {
 public:
-
-    ToneMapShader();
+    ToneMapBloomShader();
 };
 
 class DepthOfFieldShader : public ShaderHelperSingleton<DepthOfFieldShader>, public TextureRead<Bilinear_Filtered, Nearest_Filtered>
@@ -532,6 +596,20 @@ public:
     ComputeGaussian17TapVShader();
 };
 
+class ComputeGaussian3HBlurShader : public ShaderHelperSingleton<ComputeGaussian3HBlurShader>, public TextureRead<Nearest_Filtered>
+{
+public:
+    GLuint TU_dest;
+    ComputeGaussian3HBlurShader();
+};
+
+class ComputeGaussian3VBlurShader : public ShaderHelperSingleton<ComputeGaussian3VBlurShader>, public TextureRead<Nearest_Filtered>
+{
+public:
+    GLuint TU_dest;
+    ComputeGaussian3VBlurShader();
+};
+
 class ComputeGaussian6VBlurShader : public ShaderHelperSingleton<ComputeGaussian6VBlurShader, core::vector2df, std::vector<float> >, public TextureRead<Bilinear_Clamped_Filtered>
 {
 public:
@@ -597,6 +675,25 @@ public:
     DepthHistogramShader();
 };
 
+class DepthPyramidShader : public ShaderHelperSingleton<DepthPyramidShader, int>, public TextureRead<Nearest_Filtered>
+{
+public:
+    GLuint TU_dest;
+    DepthPyramidShader();
+};
+
+class InstanceCullingShader : public ShaderHelperSingleton<InstanceCullingShader, int, int, core::matrix4, core::vector2df, int, int>, public TextureRead<Nearest_Filtered>
+{
+public:
+    InstanceCullingShader();
+};
+
+class SkinningShader : public ShaderHelperSingleton<SkinningShader, int, int, int>
+{
+public:
+    SkinningShader();
+};
+
 class GlowShader : public ShaderHelperSingleton<GlowShader>, public TextureRead<Bilinear_Filtered>
 {
 public:
@@ -605,12 +702,24 @@ public:
     GlowShader();
 };
 
-class SSAOShader : public ShaderHelperSingleton<SSAOShader, float, float, float>, public TextureRead<Semi_trilinear>
+class SSAOShader : public ShaderHelperSingleton<SSAOShader, float, float, float, core::vector2df, float>, public TextureRead<Semi_trilinear>
 {
 public:
     SSAOShader();
 };
 
+class SSAOAccumulationShader : public ShaderHelperSingleton<SSAOAccumulationShader, core::matrix4, float>, public TextureRead<Bilinear_Filtered, Bilinear_Filtered, Nearest_Filtered>
+{
+public:
+    SSAOAccumulationShader();
+};
+
+class BilateralUpsampleShader : public ShaderHelperSingleton<BilateralUpsampleShader>, public TextureRead<Nearest_Filtered, Nearest_Filtered>
+{
+public:
+    BilateralUpsampleShader();
+};
+
 class FogShader : public ShaderHelperSingleton<FogShader, float, core::vector3df>, public TextureRead<Nearest_Filtered>
 {
 public:
@@ -653,6 +762,18 @@ public:
     MLAAGatherSHader();
 };
 
+class FXAAShader : public ShaderHelperSingleton<FXAAShader, core::vector2df>, public TextureRead<Bilinear_Clamped_Filtered>
+{
+public:
+    FXAAShader();
+};
+
+class TemporalAAShader : public ShaderHelperSingleton<TemporalAAShader, core::matrix4, float>, public TextureRead<Nearest_Filtered, Bilinear_Clamped_Filtered, Nearest_Filtered>
+{
+public:
+    TemporalAAShader();
+};
+
 }
 
 namespace UIShader
@@ -685,6 +806,29 @@ public:
     ColoredTextureRectShader();
 };
 
+/** Draws many textured and coloured quads with the same texture in a single
+ *  call, see draw2DImageBatch. */
+class ColoredTextureRectBatchShader : public ShaderHelperSingleton<ColoredTextureRectBatchShader>, public TextureRead<Bilinear_Filtered>
+{
+public:
+    struct Vertex
+    {
+        float m_position[2];
+        float m_texcoord[2];
+        uint8_t m_color[4];
+    };
+
+    /** Maximum number of quads drawn with one call, limited by the 16 bit
+     *  indices. */
+    static const unsigned MAX_QUADS = 4096;
+
+    GLuint vbo;
+    GLuint ibo;
+    GLuint vao;
+
+    ColoredTextureRectBatchShader();
+};
+
 class ColoredRectShader : public ShaderHelperSingleton<ColoredRectShader, core::vector2df, core::vector2df, video::SColor>
 {
 public:
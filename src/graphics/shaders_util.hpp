@@ -18,7 +18,10 @@
 #ifndef SHADERS_UTIL_HPP
 #define SHADERS_UTIL_HPP
 
+#include "utils/load_profiler.hpp"
 #include "utils/singleton.hpp"
+#include <string>
+#include <utility>
 #include <vector>
 #include <matrix4.h>
 #include <SColor.h>
@@ -32,6 +35,24 @@ unsigned getGLSLVersion();
 GLuint LoadShader(const char * file, unsigned type);
 GLuint LoadTFBProgram(const char * vertex_file_path, const char **varyings, unsigned varyingscount);
 
+typedef std::vector<std::pair<GLint, const char *> > ShaderFileList;
+std::string getProgramCacheKey(int Tp, const ShaderFileList &files);
+bool loadProgramBinary(GLuint ProgramID, const std::string &key);
+void saveProgramBinary(GLuint ProgramID, const std::string &key);
+
+template<typename ... Types>
+void getShaderFiles(ShaderFileList &files)
+{
+    return;
+}
+
+template<typename ... Types>
+void getShaderFiles(ShaderFileList &files, GLint ShaderType, const char *filepath, Types ... args)
+{
+    files.push_back(std::make_pair(ShaderType, filepath));
+    getShaderFiles(files, args...);
+}
+
 template<typename ... Types>
 void loadAndAttach(GLint ProgramID)
 {
@@ -72,10 +93,21 @@ void setAttribute(AttributeType Tp, GLuint ProgramID);
 template<typename ... Types>
 GLint LoadProgram(AttributeType Tp, Types ... args)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_SHADERS);
     GLint ProgramID = glCreateProgram();
+
+    // Use the binary saved by a previous run if the sources did not change
+    ShaderFileList files;
+    getShaderFiles(files, args...);
+    std::string cache_key = getProgramCacheKey(Tp, files);
+    if (!cache_key.empty() && loadProgramBinary(ProgramID, cache_key))
+        return ProgramID;
+
     loadAndAttach(ProgramID, args...);
     if (getGLSLVersion() < 330)
         setAttribute(Tp, ProgramID);
+    if (!cache_key.empty())
+        glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(ProgramID);
 
     GLint Result = GL_FALSE;
@@ -90,6 +122,8 @@ GLint LoadProgram(AttributeType Tp, Types ... args)
         Log::error("GLWrapp", ErrorMessage);
         delete[] ErrorMessage;
     }
+    else if (!cache_key.empty())
+        saveProgramBinary(ProgramID, cache_key);
 
     GLenum glErr = glGetError();
     if (glErr != GL_NO_ERROR)
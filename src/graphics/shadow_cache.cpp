@@ -0,0 +1,158 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/shadow_cache.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace
+{
+    /** The area of a cascade is enlarged by this fraction of its size on
+     *  each side when the cache is updated. */
+    const float CACHE_MARGIN = 0.15f;
+
+    /** The cache is updated if the needed area becomes smaller than this
+     *  fraction of the cached area, to not waste shadow map resolution. */
+    const float MIN_COVERAGE = 0.6f;
+}
+
+ShadowCache::ShadowCache()
+{
+    m_enabled = false;
+    invalidate();
+}   // ShadowCache
+
+// ----------------------------------------------------------------------------
+/** Discards the content of the cache, e.g. after the shadow textures were
+ *  recreated. */
+void ShadowCache::invalidate()
+{
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        m_valid[i]   = false;
+        m_refresh[i] = false;
+    }
+}   // invalidate
+
+// ----------------------------------------------------------------------------
+/** Enables or disables the cache for the current frame. The content is
+ *  discarded when it is disabled, since the cascades change meanwhile. */
+void ShadowCache::setEnabled(bool enabled)
+{
+    if (!enabled)
+        invalidate();
+    m_enabled = enabled;
+}   // setEnabled
+
+// ----------------------------------------------------------------------------
+/** Called for each cascade when its matrix is computed. Returns the area the
+ *  cascade must cover: the cached area if it can be reused, otherwise a new
+ *  area enlarged by a margin, in which case the cascade is marked to be
+ *  rendered into the cache.
+ *  \param cascade Index of the cascade.
+ *  \param sun_view View matrix of the sun.
+ *  \param needed The area in light space containing the view frustum of
+ *         the cascade.
+ */
+core::aabbox3df ShadowCache::updateCascade(unsigned int cascade,
+                                           const core::matrix4 &sun_view,
+                                           const core::aabbox3df &needed)
+{
+    if (!isCached(cascade))
+        return needed;
+
+    const core::vector3df extent = needed.getExtent();
+    if (m_valid[cascade] && m_sun_view[cascade].equals(sun_view, 0.0001f) &&
+        needed.isFullInside(m_box[cascade]))
+    {
+        const core::vector3df cached = m_box[cascade].getExtent();
+        if (extent.X >= MIN_COVERAGE * cached.X &&
+            extent.Y >= MIN_COVERAGE * cached.Y)
+        {
+            m_refresh[cascade] = false;
+            return m_box[cascade];
+        }
+    }
+
+    // Only the size in the light plane matters for the resolution, the depth
+    // range is enlarged by the same amount to allow some variation too
+    const float margin = CACHE_MARGIN * std::max(extent.X, extent.Y);
+    m_box[cascade] = core::aabbox3df(needed.MinEdge - core::vector3df(margin),
+                                     needed.MaxEdge + core::vector3df(margin));
+    m_sun_view[cascade] = sun_view;
+    m_valid[cascade]    = false;
+    m_refresh[cascade]  = true;
+    return m_box[cascade];
+}   // updateCascade
+
+// ----------------------------------------------------------------------------
+/** Checks when the cached area of a cascade is reused. */
+void ShadowCache::unitTesting()
+{
+    ShadowCache cache;
+    core::matrix4 view;
+    core::aabbox3df box(core::vector3df(-10, -10, 0),
+                        core::vector3df(10, 10, 20));
+
+    // Disabled: the needed box is used as it is
+    assert(cache.updateCascade(3, view, box) == box);
+    assert(!cache.needsRefresh(3));
+
+    cache.setEnabled(true);
+    // Near cascades are never cached
+    assert(cache.updateCascade(0, view, box) == box);
+    assert(!cache.isCached(0));
+
+    core::aabbox3df cached = cache.updateCascade(3, view, box);
+    assert(box.isFullInside(cached) && !(cached == box));
+    assert(cache.needsRefresh(3));
+
+    // Not rendered yet: still refreshed in the next frame
+    assert(cache.updateCascade(3, view, box) == cached);
+    assert(cache.needsRefresh(3));
+    cache.setRendered(3);
+
+    // Small moves keep the cache
+    core::aabbox3df moved(box.MinEdge + core::vector3df(2, 0, 0),
+                          box.MaxEdge + core::vector3df(2, 0, 0));
+    assert(cache.updateCascade(3, view, moved) == cached);
+    assert(!cache.needsRefresh(3));
+
+    // Leaving the cached area updates it
+    core::aabbox3df far_away(box.MinEdge + core::vector3df(5, 0, 0),
+                             box.MaxEdge + core::vector3df(5, 0, 0));
+    core::aabbox3df updated = cache.updateCascade(3, view, far_away);
+    assert(cache.needsRefresh(3) && far_away.isFullInside(updated));
+    cache.setRendered(3);
+
+    // So does a rotation of the sun
+    core::matrix4 rotated;
+    rotated.setRotationDegrees(core::vector3df(0, 10, 0));
+    cache.updateCascade(3, rotated, far_away);
+    assert(cache.needsRefresh(3));
+    cache.setRendered(3);
+
+    // And a much smaller area
+    core::aabbox3df small(core::vector3df(0, 0, 5), core::vector3df(2, 2, 7));
+    cache.updateCascade(3, rotated, small);
+    assert(cache.needsRefresh(3));
+
+    cache.setEnabled(false);
+    assert(!cache.needsRefresh(3));
+    assert(getStaticList(2) == 4 && getStaticList(3) == SHADOW_LIST_COUNT - 1);
+}   // unitTesting
@@ -0,0 +1,112 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SHADOW_CACHE_HPP
+#define HEADER_SHADOW_CACHE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include "aabbox3d.h"
+#include "matrix4.h"
+
+using namespace irr;
+
+/**
+  * \brief Keeps the depth of the static shadow casters (the track) of the
+  *  far cascades between frames. The area covered by a cached cascade is
+  *  enlarged by a margin, and kept as long as it still contains the area
+  *  the cascade needs. Only then the static casters are rendered again; in
+  *  all other frames the cached depth is copied to the shadow map and only
+  *  the dynamic casters (karts, items, ...) are drawn on top of it.
+  *  Static casters of a cached cascade go to their own draw lists, which
+  *  follow the lists of the four cascades.
+  * \ingroup graphics
+  */
+class ShadowCache : public NoCopy
+{
+public:
+    /** Index of the first cascade which is cached. */
+    static const unsigned int FIRST_CACHED_CASCADE = 2;
+
+    /** Number of draw lists of the shadow pass: one per cascade, followed
+     *  by one per cached cascade for its static casters. */
+    static const unsigned int SHADOW_LIST_COUNT = 4 + 4 - FIRST_CACHED_CASCADE;
+
+private:
+    /** Area covered by each cascade, in light space. */
+    core::aabbox3df m_box[4];
+
+    /** View matrix of the sun the cache of each cascade was rendered with. */
+    core::matrix4 m_sun_view[4];
+
+    /** True if the cache of a cascade contains the static casters of
+     *  m_box. */
+    bool m_valid[4];
+
+    /** True if the static casters of a cascade must be rendered into the
+     *  cache in this frame. */
+    bool m_refresh[4];
+
+    /** False if the cache can't be used in this frame, e.g. in split
+     *  screen. */
+    bool m_enabled;
+
+public:
+         ShadowCache();
+    void setEnabled(bool enabled);
+    void invalidate();
+    core::aabbox3df updateCascade(unsigned int cascade,
+                                  const core::matrix4 &sun_view,
+                                  const core::aabbox3df &needed);
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Returns true if the static casters of this cascade are cached. */
+    bool isCached(unsigned int cascade) const
+    {
+        return m_enabled && cascade >= FIRST_CACHED_CASCADE;
+    }   // isCached
+    // ------------------------------------------------------------------------
+    /** Returns true if the static casters of this cascade must be rendered
+     *  into the cache in this frame. */
+    bool needsRefresh(unsigned int cascade) const
+    {
+        return isCached(cascade) && m_refresh[cascade];
+    }   // needsRefresh
+    // ------------------------------------------------------------------------
+    /** Called once the static casters of a cascade were rendered into the
+     *  cache. */
+    void setRendered(unsigned int cascade)
+    {
+        m_refresh[cascade] = false;
+        m_valid[cascade]   = true;
+    }   // setRendered
+    // ------------------------------------------------------------------------
+    /** Returns the draw list of the static casters of a cached cascade. */
+    static unsigned int getStaticList(unsigned int cascade)
+    {
+        return 4 + cascade - FIRST_CACHED_CASCADE;
+    }   // getStaticList
+    // ------------------------------------------------------------------------
+    /** Returns the layer of the cache textures used by a cached cascade. */
+    static unsigned int getLayer(unsigned int cascade)
+    {
+        return cascade - FIRST_CACHED_CASCADE;
+    }   // getLayer
+};   // ShadowCache
+
+#endif
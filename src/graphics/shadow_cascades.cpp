@@ -0,0 +1,155 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/shadow_cascades.hpp"
+
+#include "config/user_config.hpp"
+#include "graphics/central_settings.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <algorithm>
+#include <irrMath.h>
+
+namespace
+{
+    /** The split distances used if the track does not define any. */
+    const float DEFAULT_SPLITS[ShadowCascades::MAX_CASCADES + 1] =
+        { 1.0f, 5.0f, 20.0f, 50.0f, 150.0f };
+
+    /** Reads up to MAX_CASCADES numbers from a string of numbers separated
+     *  by spaces. Missing or invalid numbers keep their value.
+     */
+    template<typename T>
+    void parseValues(const std::string &s, T *values)
+    {
+        std::vector<std::string> v = StringUtils::split(s, ' ');
+        for (unsigned int i = 0;
+             i < v.size() && i < ShadowCascades::MAX_CASCADES; i++)
+        {
+            T value;
+            if (StringUtils::parseString<T>(v[i], &value))
+                values[i] = value;
+        }
+    }   // parseValues
+}
+
+// ----------------------------------------------------------------------------
+/** Creates the cascades from the user config.
+ *  \param splits The split distances of the track, which are used if they
+ *         contain the start of each cascade and the end of the last one in
+ *         increasing order. Otherwise the default splits are used.
+ */
+ShadowCascades::ShadowCascades(const std::vector<float> &splits)
+{
+    bool valid_splits = splits.size() == MAX_CASCADES + 1 && splits[0] > 0;
+    for (unsigned int i = 1; valid_splits && i < splits.size(); i++)
+        valid_splits = splits[i] > splits[i - 1];
+    if (!splits.empty() && !valid_splits)
+        Log::warn("ShadowCascades", "Invalid shadow splits of the track, "
+                  "the default splits are used.");
+    for (unsigned int i = 0; i <= MAX_CASCADES; i++)
+        m_splits[i] = valid_splits ? splits[i] : DEFAULT_SPLITS[i];
+
+    m_num_cascades = MAX_CASCADES;
+    for (unsigned int i = 0; i < MAX_CASCADES; i++)
+    {
+        m_resolution[i]      = 1.0f;
+        m_update_interval[i] = 1;
+    }
+    // The cascades computed on the GPU can't be changed on the CPU
+    if (!CVS->isSDSMEnabled())
+    {
+        m_num_cascades = irr::core::clamp((int)UserConfigParams::m_shadow_cascades,
+                                     1, (int)MAX_CASCADES);
+        parseValues<float>(UserConfigParams::m_shadow_cascade_resolution,
+                           m_resolution);
+        parseValues<unsigned int>(UserConfigParams::m_shadow_cascade_update,
+                                  m_update_interval);
+        for (unsigned int i = 0; i < MAX_CASCADES; i++)
+        {
+            m_resolution[i]      = irr::core::clamp(m_resolution[i], 0.25f, 1.0f);
+            m_update_interval[i] = std::max(m_update_interval[i], 1u);
+        }
+    }
+
+    m_frame = 0;
+    invalidate();
+    for (unsigned int i = 0; i < MAX_CASCADES; i++)
+        m_update[i] = isUsed(i);
+}   // ShadowCascades
+
+// ----------------------------------------------------------------------------
+/** Discards the content of all cascades, e.g. after the shadow textures
+ *  were recreated. */
+void ShadowCascades::invalidate()
+{
+    for (unsigned int i = 0; i < MAX_CASCADES; i++)
+        m_valid[i] = false;
+}   // invalidate
+
+// ----------------------------------------------------------------------------
+/** Decides which cascades are rendered in the next frame.
+ *  \param can_keep False if all cascades must be rendered, e.g. in split
+ *         screen, where each camera needs its own cascades.
+ */
+void ShadowCascades::nextFrame(bool can_keep)
+{
+    m_frame++;
+    for (unsigned int i = 0; i < MAX_CASCADES; i++)
+    {
+        m_update[i] = isUsed(i) &&
+                      (!can_keep || !m_valid[i] ||
+                       (m_frame + i) % m_update_interval[i] == 0);
+    }
+}   // nextFrame
+
+// ----------------------------------------------------------------------------
+/** Returns true if all used cascades are rendered in this frame, so the
+ *  whole shadow map can be cleared at once. */
+bool ShadowCascades::updatesAll() const
+{
+    for (unsigned int i = 0; i < m_num_cascades; i++)
+    {
+        if (!m_update[i])
+            return false;
+    }
+    return true;
+}   // updatesAll
+
+// ----------------------------------------------------------------------------
+/** Returns the width and height in pixels of the corner of its layer a
+ *  cascade uses.
+ *  \param cascade Index of the cascade.
+ *  \param shadow_resolution Resolution of the shadow map.
+ */
+unsigned int ShadowCascades::getSize(unsigned int cascade,
+                                     unsigned int shadow_resolution) const
+{
+    return std::max(1u, (unsigned int)(shadow_resolution *
+                                       m_resolution[cascade] + 0.5f));
+}   // getSize
+
+// ----------------------------------------------------------------------------
+/** Returns the distance up to which the sun light shader uses a cascade.
+ *  Unused cascades end at the far split, so they are never used.
+ *  \param i Index of the cascade.
+ */
+float ShadowCascades::getShaderSplit(unsigned int i) const
+{
+    return isUsed(i) ? getFar(i) : m_splits[MAX_CASCADES];
+}   // getShaderSplit
@@ -0,0 +1,103 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SHADOW_CASCADES_HPP
+#define HEADER_SHADOW_CASCADES_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+/**
+  * \brief The configuration of the shadow cascades: their number, the split
+  *  distances (which a track can change), the resolution of each cascade
+  *  and how often it is rendered. A cascade with a lower resolution only
+  *  uses a corner of its layer of the shadow map, i.e. its matrix is scaled
+  *  and the pixels outside of the corner are discarded by a scissor. A
+  *  cascade with an update interval of n is only rendered every n-th frame,
+  *  in the other frames its layer and matrix are kept. The intervals of the
+  *  cascades are offset so that they are not all rendered in the same
+  *  frame. With fewer than four cascades the last cascade reaches to the
+  *  far split, so the shadows cover the same distance.
+  * \ingroup graphics
+  */
+class ShadowCascades : public NoCopy
+{
+public:
+    static const unsigned int MAX_CASCADES = 4;
+
+private:
+    /** Distance from the camera at which each cascade starts, followed by
+     *  the distance at which the last cascade ends. */
+    float        m_splits[MAX_CASCADES + 1];
+
+    /** Number of cascades used. */
+    unsigned int m_num_cascades;
+
+    /** Fraction of the shadow map resolution used by each cascade. */
+    float        m_resolution[MAX_CASCADES];
+
+    /** Number of frames between two renderings of each cascade. */
+    unsigned int m_update_interval[MAX_CASCADES];
+
+    /** True if a cascade is rendered in this frame. */
+    bool         m_update[MAX_CASCADES];
+
+    /** True if the layer and matrix of a cascade are up to date, i.e. the
+     *  cascade can be kept in the next frames. */
+    bool         m_valid[MAX_CASCADES];
+
+    /** Counts the frames to decide which cascades are updated. */
+    unsigned int m_frame;
+
+public:
+         ShadowCascades(const std::vector<float> &splits);
+    void nextFrame(bool can_keep);
+    void invalidate();
+    unsigned int getSize(unsigned int cascade,
+                         unsigned int shadow_resolution) const;
+    float getShaderSplit(unsigned int i) const;
+    bool  updatesAll() const;
+
+    // ------------------------------------------------------------------------
+    /** Returns true if a cascade is used at all. */
+    bool isUsed(unsigned int cascade) const
+    {
+        return cascade < m_num_cascades;
+    }   // isUsed
+    // ------------------------------------------------------------------------
+    /** Returns true if a cascade must be rendered in this frame. */
+    bool needsUpdate(unsigned int cascade) const
+    {
+        return m_update[cascade];
+    }   // needsUpdate
+    // ------------------------------------------------------------------------
+    /** Called once a cascade was rendered. */
+    void setRendered(unsigned int cascade) { m_valid[cascade] = true; }
+    // ------------------------------------------------------------------------
+    /** Returns the distance at which a cascade starts. */
+    float getNear(unsigned int cascade) const { return m_splits[cascade]; }
+    // ------------------------------------------------------------------------
+    /** Returns the distance at which a cascade ends. */
+    float getFar(unsigned int cascade) const
+    {
+        return cascade + 1 >= m_num_cascades ? m_splits[MAX_CASCADES]
+                                             : m_splits[cascade + 1];
+    }   // getFar
+};   // ShadowCascades
+
+#endif
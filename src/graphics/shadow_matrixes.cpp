@@ -21,8 +21,13 @@
 #include <SViewFrustum.h>
 #include "../../lib/irrlicht/source/Irrlicht/CSceneManager.h"
 #include "../../lib/irrlicht/source/Irrlicht/os.h"
+#include "config/user_config.hpp"
+#include "graphics/camera.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/rtts.hpp"
+#include "graphics/shadow_cache.hpp"
+#include "graphics/shadow_cascades.hpp"
 #include "graphics/shaders.hpp"
 #include "modes/world.hpp"
 #include "physics/triangle_mesh.hpp"
@@ -46,14 +51,13 @@ getFrustrumVertex(const scene::SViewFrustum &frustrum)
     return vectors;
 }
 
-/** Given a matrix transform and a set of points returns an orthogonal projection matrix that maps coordinates of
-transformed points between -1 and 1.
+/** Given a matrix transform and a set of points returns the bounding box of
+the transformed points.
 *  \param transform a transform matrix.
 *  \param pointsInside a vector of point in 3d space.
-*  \param size returns the size (width, height) of shadowmap coverage
 */
-static core::matrix4
-getTighestFitOrthoProj(const core::matrix4 &transform, const std::vector<vector3df> &pointsInside, std::pair<float, float> &size)
+static core::aabbox3df
+getTransformedBox(const core::matrix4 &transform, const std::vector<vector3df> &pointsInside)
 {
     float xmin = std::numeric_limits<float>::infinity();
     float xmax = -std::numeric_limits<float>::infinity();
@@ -73,11 +77,21 @@ getTighestFitOrthoProj(const core::matrix4 &transform, const std::vector<vector3
         zmin = MIN2(zmin, TransformedVector.Z);
         zmax = MAX2(zmax, TransformedVector.Z);
     }
+    return core::aabbox3df(xmin, ymin, zmin, xmax, ymax, zmax);
+}
 
-    float left = xmin;
-    float right = xmax;
-    float up = ymin;
-    float down = ymax;
+/** Returns an orthogonal projection matrix that maps coordinates inside of a
+box between -1 and 1.
+*  \param box the box in light space.
+*  \param size returns the size (width, height) of shadowmap coverage
+*/
+static core::matrix4
+getOrthoProj(const core::aabbox3df &box, std::pair<float, float> &size)
+{
+    float left = box.MinEdge.X;
+    float right = box.MaxEdge.X;
+    float up = box.MinEdge.Y;
+    float down = box.MaxEdge.Y;
 
     size.first = right - left;
     size.second = down - up;
@@ -88,7 +102,7 @@ getTighestFitOrthoProj(const core::matrix4 &transform, const std::vector<vector3
         return tmp_matrix;
     tmp_matrix.buildProjectionMatrixOrthoLH(left, right,
         down, up,
-        zmin - 100, zmax);
+        box.MinEdge.Z - 100, box.MaxEdge.Z);
     return tmp_matrix;
 }
 
@@ -149,7 +163,11 @@ void IrrDriver::UpdateSplitAndLightcoordRangeFromComputeShaders(size_t width, si
 
     glUseProgram(FullScreenShader::LightspaceBoundingBoxShader::getInstance()->Program);
     FullScreenShader::LightspaceBoundingBoxShader::getInstance()->SetTextureUnits(getDepthStencilTexture());
-    FullScreenShader::LightspaceBoundingBoxShader::getInstance()->setUniforms(m_suncam->getViewMatrix(), shadowSplit[1], shadowSplit[2], shadowSplit[3], shadowSplit[4]);
+    float splits[4];
+    for (unsigned i = 0; i < 4; i++)
+        splits[i] = m_shadow_cascades ? m_shadow_cascades->getShaderSplit(i)
+                                      : shadowSplit[i + 1];
+    FullScreenShader::LightspaceBoundingBoxShader::getInstance()->setUniforms(m_suncam->getViewMatrix(), splits[0], splits[1], splits[2], splits[3]);
     glDispatchCompute((int)width / 64, (int)height / 64, 1);
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
@@ -181,27 +199,49 @@ void IrrDriver::computeMatrixesAndCameras(scene::ICameraSceneNode * const camnod
     static_cast<scene::CSceneManager *>(m_scene_manager)->OnAnimate(os::Timer::getTime());
     camnode->render();
     irr_driver->setProjMatrix(irr_driver->getVideoDriver()->getTransform(video::ETS_PROJECTION));
+    if (isTemporalAAEnabled())
+    {
+        // Jitter the projection by a subpixel offset from the (2, 3) Halton
+        // sequence, the temporal anti-aliasing accumulates the offsets.
+        static const float halton[8][2] =
+        {
+            { 0.500f, 0.333f }, { 0.250f, 0.667f }, { 0.750f, 0.111f },
+            { 0.125f, 0.444f }, { 0.625f, 0.778f }, { 0.375f, 0.222f },
+            { 0.875f, 0.556f }, { 0.063f, 0.889f },
+        };
+        m_taa_frame = (m_taa_frame + 1) % 8;
+        core::matrix4 proj = irr_driver->getProjMatrix();
+        proj[8] += (2.0f * halton[m_taa_frame][0] - 1.0f) / width;
+        proj[9] += (2.0f * halton[m_taa_frame][1] - 1.0f) / height;
+        irr_driver->setProjMatrix(proj);
+    }
     irr_driver->setViewMatrix(irr_driver->getVideoDriver()->getTransform(video::ETS_VIEW));
     irr_driver->genProjViewMatrix();
 
     m_current_screen_size = core::vector2df(float(width), float(height));
 
+    // The shadow cache only contains the cascades of a single camera, and
+    // the cascades computed on the GPU can't be compared on the CPU
+    if (m_shadow_cache)
+    {
+        m_shadow_cache->setEnabled(CVS->isShadowCacheEnabled() &&
+                                   Camera::getNumCameras() == 1 &&
+                                   m_rtts && m_rtts->getShadowCacheFBO());
+    }
+    // Cascades can only be kept between frames with a single camera
+    if (m_shadow_cascades)
+        m_shadow_cascades->nextFrame(Camera::getNumCameras() == 1);
+
     const float oldfar = camnode->getFarValue();
     const float oldnear = camnode->getNearValue();
-    float FarValues[] =
-    {
-        shadowSplit[1],
-        shadowSplit[2],
-        shadowSplit[3],
-        shadowSplit[4],
-    };
-    float NearValues[] =
+    float FarValues[4], NearValues[4];
+    for (unsigned i = 0; i < 4; i++)
     {
-        shadowSplit[0],
-        shadowSplit[1],
-        shadowSplit[2],
-        shadowSplit[3]
-    };
+        FarValues[i]  = m_shadow_cascades ? m_shadow_cascades->getFar(i)
+                                          : shadowSplit[i + 1];
+        NearValues[i] = m_shadow_cascades ? m_shadow_cascades->getNear(i)
+                                          : shadowSplit[i];
+    }
 
     float tmp[16 * 9 + 2];
     memcpy(tmp, irr_driver->getViewMatrix().pointer(), 16 * sizeof(float));
@@ -213,11 +253,16 @@ void IrrDriver::computeMatrixesAndCameras(scene::ICameraSceneNode * const camnod
     m_suncam->render();
     for (unsigned i = 0; i < 4; i++)
     {
+        // Cascades which are kept use the camera of the frame they were
+        // rendered in
+        if (m_shadow_camnodes[i] && m_shadow_cascades &&
+            !m_shadow_cascades->needsUpdate(i))
+            continue;
         if (m_shadow_camnodes[i])
             delete m_shadow_camnodes[i];
         m_shadow_camnodes[i] = (scene::ICameraSceneNode *) m_suncam->clone();
     }
-    sun_ortho_matrix.clear();
+    sun_ortho_matrix.resize(4);
     const core::matrix4 &SunCamViewMatrix = m_suncam->getViewMatrix();
 
     if (World::getWorld() && World::getWorld()->getTrack())
@@ -235,6 +280,8 @@ void IrrDriver::computeMatrixesAndCameras(scene::ICameraSceneNode * const camnod
         // Shadow Matrixes and cameras
         for (unsigned i = 0; i < 4; i++)
         {
+            if (m_shadow_cascades && !m_shadow_cascades->needsUpdate(i))
+                continue;
             core::matrix4 tmp_matrix;
 
             camnode->setFarValue(FarValues[i]);
@@ -270,13 +317,33 @@ void IrrDriver::computeMatrixesAndCameras(scene::ICameraSceneNode * const camnod
             memcpy(m_shadows_cam[i], tmp, 24 * sizeof(float));
 
             std::vector<vector3df> vectors = getFrustrumVertex(*frustrum);
-            tmp_matrix = getTighestFitOrthoProj(SunCamViewMatrix, vectors, m_shadow_scales[i]);
+            core::aabbox3df box = getTransformedBox(SunCamViewMatrix, vectors);
+            // Far cascades may cover a larger area kept from previous frames
+            if (m_shadow_cache)
+                box = m_shadow_cache->updateCascade(i, SunCamViewMatrix, box);
+            tmp_matrix = getOrthoProj(box, m_shadow_scales[i]);
 
 
             m_shadow_camnodes[i]->setProjectionMatrix(tmp_matrix, true);
             m_shadow_camnodes[i]->render();
 
-            sun_ortho_matrix.push_back(getVideoDriver()->getTransform(video::ETS_PROJECTION) * getVideoDriver()->getTransform(video::ETS_VIEW));
+            core::matrix4 view_proj = getVideoDriver()->getTransform(video::ETS_PROJECTION) * getVideoDriver()->getTransform(video::ETS_VIEW);
+            // A cascade with a lower resolution is drawn into, and read
+            // from, a corner of its layer
+            const int resolution = UserConfigParams::m_shadows_resolution;
+            if (m_shadow_cascades && resolution > 0)
+            {
+                const float f =
+                    m_shadow_cascades->getSize(i, resolution) / float(resolution);
+                if (f < 1.0f)
+                {
+                    core::matrix4 corner;
+                    corner.setScale(core::vector3df(f, f, 1.0f));
+                    corner.setTranslation(core::vector3df(f - 1.0f, f - 1.0f, 0.0f));
+                    view_proj = corner * view_proj;
+                }
+            }
+            sun_ortho_matrix[i] = view_proj;
         }
 
         // Rsm Matrix and camera
@@ -95,11 +95,16 @@ void SkidMarks::update(float dt, bool force_skid_marks,
     if(m_kart.isWheeless())
         return;
 
-    float f = dt/stk_config->m_skid_fadeout_time*m_start_alpha;
-    for(unsigned int i=0; i<m_left.size(); i++)
+    // Only the skid mark that is currently being created is uploaded to the
+    // GPU each frame, the vertex buffers of all finished skid marks are
+    // static. So changing the vertex colours of finished skid marks would
+    // only cost time without any visible effect, and only the current skid
+    // mark is faded.
+    if(m_skid_marking)
     {
-        m_left[i]->fade(f);
-        m_right[i]->fade(f);
+        float f = dt/stk_config->m_skid_fadeout_time*m_start_alpha;
+        m_left[m_current]->fade(f);
+        m_right[m_current]->fade(f);
     }
 
     // Get raycast information
@@ -30,6 +30,7 @@
 #include "karts/kart_properties.hpp"
 #include "karts/max_speed.hpp"
 #include "modes/world.hpp"
+#include "physics/physics.hpp"
 #include "tracks/quad.hpp"
 #include "utils/constants.hpp"
 
@@ -414,10 +415,29 @@ void SlipStream::update(float dt)
 
     // Note that this loop can not be simply replaced with a shorter loop
     // using only the karts with a better position - since a kart might
-    // be a lap behind
-    for(unsigned int i=0; i<num_karts; i++)
+    // be a lap behind. Instead only karts close enough to pass the quick
+    // test below are taken from the physics broadphase (the debug colours
+    // need all karts).
+    const float max_length = m_kart->getKartProperties()->getSlipstreamLength()
+                           * m_kart->getPlayerDifficulty()->getSlipstreamLength()
+                           + 0.5f*m_kart->getKartLength()
+                           + 0.5f*world->getMaxKartLength();
+    std::vector<AbstractKart*> &karts = m_candidate_karts;
+    if(UserConfigParams::m_slipstream_debug)
+    {
+        karts.clear();
+        for(unsigned int i=0; i<num_karts; i++)
+            karts.push_back(world->getKart(i));
+    }
+    else
+    {
+        // Karts more than 6 above or below are ignored as well
+        world->getPhysics()->getKartsInSphere(m_kart->getXYZ(),
+            sqrtf(max_length*max_length + 36.0f), &karts);
+    }
+    for(unsigned int i=0; i<karts.size(); i++)
     {
-        m_target_kart= world->getKart(i);
+        m_target_kart= karts[i];
         // Don't test for slipstream with itself, a kart that is being
         // rescued or exploding, or an eliminated kart
         if(m_target_kart==m_kart               ||
@@ -475,7 +495,7 @@ void SlipStream::update(float dt)
             m_kart->getController()->isPlayerController())
             m_target_kart->getSlipstream()
                          ->setDebugColor(video::SColor(255, 0, 0, 255));
-    }   // for i < num_karts
+    }   // for i < karts.size()
 
     if(!is_sstreaming)
     {
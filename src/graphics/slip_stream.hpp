@@ -30,6 +30,8 @@ using namespace irr;
 #include "graphics/moving_texture.hpp"
 #include "utils/no_copy.hpp"
 
+#include <vector>
+
 class AbstractKart;
 class Quad;
 class Material;
@@ -81,6 +83,10 @@ private:
      ** overtake the right kart. */
     AbstractKart* m_target_kart;
 
+    /** The karts close enough to be tested for slipstreaming. Kept as a
+     *  member so that the list is not allocated in each frame. */
+    std::vector<AbstractKart*> m_candidate_karts;
+
     void         createMesh(Material* material);
     void         setDebugColor(const video::SColor &color);
 public:
@@ -59,6 +59,8 @@ void STKTextBillboard::updateAbsolutePosition()
     }
     else
         AbsoluteTransformation = getRelativeTransformation();
+    // Make sure that children are updated, too
+    ++AbsoluteTransformationVersion;
 }
 
 scene::IMesh* STKTextBillboard::getTextMesh(core::stringw text, gui::ScalableFont* font)
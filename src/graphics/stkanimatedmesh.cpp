@@ -23,12 +23,14 @@
 #include <ISkinnedMesh.h>
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/shaders.hpp"
 #include "config/user_config.hpp"
 #include "modes/world.hpp"
 #include "tracks/track.hpp"
 #include "graphics/camera.hpp"
 #include "utils/profiler.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/simd_math.hpp"
 
 using namespace irr;
 
@@ -41,6 +43,9 @@ const core::vector3df& scale) :
 {
     isGLInitialized = false;
     isMaterialInitialized = false;
+    m_gpu_skinning = false;
+    m_joint_matrices = 0;
+    m_skinned_frame = -1.0f;
 #ifdef DEBUG
     m_debug_name = debug_name;
 #endif
@@ -66,6 +71,17 @@ void STKAnimatedMesh::cleanGLMeshes()
             glDeleteBuffers(1, &(mesh.index_buffer));
     }
     GLmeshes.clear();
+    for (u32 i = 0; i < m_skinning_data.size(); ++i)
+    {
+        if (m_skinning_data[i])
+            glDeleteBuffers(1, &(m_skinning_data[i]));
+    }
+    m_skinning_data.clear();
+    if (m_joint_matrices)
+        glDeleteBuffers(1, &m_joint_matrices);
+    m_joint_matrices = 0;
+    m_gpu_skinning = false;
+    m_skinned_frame = -1.0f;
     for (unsigned i = 0; i < Material::SHADERTYPE_COUNT; i++)
         MeshSolidMaterial[i].clearWithoutDeleting();
     for (unsigned i = 0; i < TM_COUNT; i++)
@@ -85,7 +101,11 @@ void STKAnimatedMesh::updateNoGL()
     scene::IMesh* m = getMeshForCurrentFrame();
 
     if (m)
+    {
         Box = m->getBoundingBox();
+        if (m_gpu_skinning)
+            updateSkinnedBoundingBox();
+    }
     else
     {
         Log::error("animated mesh", "Animated Mesh returned no mesh to render.");
@@ -186,9 +206,16 @@ void STKAnimatedMesh::updateGL()
                 glBindVertexArray(0);
             }
         }
+        initGPUSkinning();
         isGLInitialized = true;
     }
 
+    if (m_gpu_skinning)
+    {
+        skinOnGPU();
+        return;
+    }
+
     for (u32 i = 0; i<m->getMeshBufferCount(); ++i)
     {
         scene::IMeshBuffer* mb = m->getMeshBuffer(i);
@@ -224,6 +251,179 @@ void STKAnimatedMesh::updateGL()
 
 }
 
+/** Prepares skinning in a compute shader if it is enabled and the mesh is
+ *  skinned. The mesh buffers are reset to the bind pose, which is uploaded
+ *  together with the (at most) four joints with the highest weights of
+ *  each vertex. Irrlicht then only computes the joint matrices.
+ */
+void STKAnimatedMesh::initGPUSkinning()
+{
+    m_gpu_skinning = false;
+    if (!CVS->isGPUSkinningEnabled() || Mesh->getMeshType() != scene::EAMT_SKINNED)
+        return;
+    scene::ISkinnedMesh *skinned_mesh = static_cast<scene::ISkinnedMesh*>(Mesh);
+    const core::array<scene::ISkinnedMesh::SJoint*> &joints = skinned_mesh->getAllJoints();
+    if (joints.empty())
+        return;
+    skinned_mesh->setHardwareSkinning(true);
+
+    // Same layout as SkinnedVertex in skinning.comp
+    struct SkinnedVertex
+    {
+        float m_position[4];
+        float m_normal[4];
+        int   m_joints[4];
+        float m_weights[4];
+    };
+    std::vector<std::vector<SkinnedVertex> > vertices(Mesh->getMeshBufferCount());
+    std::vector<std::vector<float> > total_weights(Mesh->getMeshBufferCount());
+    for (u32 i = 0; i < Mesh->getMeshBufferCount(); ++i)
+    {
+        scene::IMeshBuffer* mb = Mesh->getMeshBuffer(i);
+        if (!mb)
+            continue;
+        vertices[i].resize(mb->getVertexCount());
+        total_weights[i].resize(mb->getVertexCount(), 0.0f);
+        for (u32 j = 0; j < mb->getVertexCount(); ++j)
+        {
+            SkinnedVertex &v = vertices[i][j];
+            memset(&v, 0, sizeof(SkinnedVertex));
+            v.m_position[0] = mb->getPosition(j).X;
+            v.m_position[1] = mb->getPosition(j).Y;
+            v.m_position[2] = mb->getPosition(j).Z;
+            v.m_position[3] = 1.0f;
+            v.m_normal[0] = mb->getNormal(j).X;
+            v.m_normal[1] = mb->getNormal(j).Y;
+            v.m_normal[2] = mb->getNormal(j).Z;
+        }
+    }
+
+    for (u32 k = 0; k < joints.size(); ++k)
+    {
+        for (u32 w = 0; w < joints[k]->Weights.size(); ++w)
+        {
+            const scene::ISkinnedMesh::SWeight &weight = joints[k]->Weights[w];
+            if (weight.buffer_id >= vertices.size() ||
+                weight.vertex_id >= vertices[weight.buffer_id].size())
+                continue;
+            SkinnedVertex &v = vertices[weight.buffer_id][weight.vertex_id];
+            total_weights[weight.buffer_id][weight.vertex_id] += weight.strength;
+            // Replace the smallest of the four weights
+            unsigned smallest = 0;
+            for (unsigned l = 1; l < 4; l++)
+            {
+                if (v.m_weights[l] < v.m_weights[smallest])
+                    smallest = l;
+            }
+            if (weight.strength > v.m_weights[smallest])
+            {
+                v.m_weights[smallest] = weight.strength;
+                v.m_joints[smallest] = k;
+            }
+        }
+    }
+
+    m_skinning_data.resize(Mesh->getMeshBufferCount(), 0);
+    for (u32 i = 0; i < vertices.size(); ++i)
+    {
+        bool skinned = false;
+        for (u32 j = 0; j < vertices[i].size(); ++j)
+        {
+            SkinnedVertex &v = vertices[i][j];
+            const float kept = v.m_weights[0] + v.m_weights[1] + v.m_weights[2] + v.m_weights[3];
+            if (kept <= 0.0f)
+                continue;
+            skinned = true;
+            // Dropped weights are distributed on the remaining ones
+            const float scale = total_weights[i][j] / kept;
+            for (unsigned l = 0; l < 4; l++)
+                v.m_weights[l] *= scale;
+        }
+        if (!skinned)
+            continue;
+        glGenBuffers(1, &m_skinning_data[i]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_skinning_data[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, vertices[i].size() * sizeof(SkinnedVertex), vertices[i].data(), GL_STATIC_DRAW);
+    }
+    glGenBuffers(1, &m_joint_matrices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_skinned_frame = -1.0f;
+    m_gpu_skinning = true;
+}   // initGPUSkinning
+
+/** Uploads the joint matrices of the current frame and skins all mesh
+ *  buffers into their vertex buffers. Nothing is done if the animation did
+ *  not change since the last call.
+ */
+void STKAnimatedMesh::skinOnGPU()
+{
+    if (JointMode != scene::EJUOR_CONTROL && getFrameNr() == m_skinned_frame)
+        return;
+    m_skinned_frame = getFrameNr();
+
+    scene::ISkinnedMesh *skinned_mesh = static_cast<scene::ISkinnedMesh*>(Mesh);
+    const core::array<scene::ISkinnedMesh::SJoint*> &joints = skinned_mesh->getAllJoints();
+    std::vector<core::matrix4> matrices(joints.size());
+    const core::matrix4 identity;
+    for (u32 k = 0; k < joints.size(); ++k)
+    {
+        const core::matrix4 &animated = joints[k]->GlobalAnimatedMatrix;
+        const core::matrix4 &inversed = joints[k]->GlobalInversedMatrix;
+        SIMDMath::multiplyMatrix(animated.pointer(), inversed.pointer(),
+                                 matrices[k].pointer());
+        // Skinning is linear, so the animation strength can be applied to
+        // the matrix instead of the skinned vertex
+        if (AnimationStrength != 1.0f)
+        {
+            for (unsigned l = 0; l < 16; l++)
+                matrices[k][l] = identity[l] + (matrices[k][l] - identity[l]) * AnimationStrength;
+        }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_joint_matrices);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, matrices.size() * sizeof(core::matrix4), matrices.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, m_joint_matrices);
+
+    glUseProgram(FullScreenShader::SkinningShader::getInstance()->Program);
+    for (u32 i = 0; i < m_skinning_data.size(); ++i)
+    {
+        scene::IMeshBuffer* mb = Mesh->getMeshBuffer(i);
+        const video::SMaterial& material = ReadOnlyMaterials ? mb->getMaterial() : Materials[i];
+        if (!m_skinning_data[i] || !isObject(material.MaterialType))
+            continue;
+        const GLMesh &mesh = GLmeshes[i];
+        GLuint vbo = CVS->isARBBaseInstanceUsable() ? VAOManager::getInstance()->getVBO(mb->getVertexType()) : mesh.vertex_buffer;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_skinning_data[i]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, vbo);
+        FullScreenShader::SkinningShader::getInstance()->setUniforms((int)mb->getVertexCount(),
+            (int)(mesh.vaoBaseVertex * mesh.Stride / sizeof(float)), (int)(mesh.Stride / sizeof(float)));
+        glDispatchCompute((int)mb->getVertexCount() / 64 + 1, 1, 1);
+    }
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}   // skinOnGPU
+
+/** With GPU skinning the mesh only knows its bind pose box. Each skinned
+ *  vertex is a weighted mean of its bind pose transformed by some joints, so
+ *  it is inside the union of the bind pose box transformed by every joint.
+ */
+void STKAnimatedMesh::updateSkinnedBoundingBox()
+{
+    scene::ISkinnedMesh *skinned_mesh = static_cast<scene::ISkinnedMesh*>(Mesh);
+    const core::array<scene::ISkinnedMesh::SJoint*> &joints = skinned_mesh->getAllJoints();
+    const core::aabbox3df bind_pose = Box;
+    for (u32 k = 0; k < joints.size(); ++k)
+    {
+        if (joints[k]->Weights.empty())
+            continue;
+        const core::matrix4 &animated = joints[k]->GlobalAnimatedMatrix;
+        const core::matrix4 &inversed = joints[k]->GlobalInversedMatrix;
+        float m[16];
+        SIMDMath::multiplyMatrix(animated.pointer(), inversed.pointer(), m);
+        core::aabbox3df box = bind_pose;
+        SIMDMath::transformBox(m, &box.MinEdge.X, &box.MaxEdge.X);
+        Box.addInternalBox(box);
+    }
+}   // updateSkinnedBoundingBox
+
 void STKAnimatedMesh::render()
 {
     ++PassCount;
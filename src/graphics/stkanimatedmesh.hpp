@@ -31,7 +31,19 @@ protected:
     bool isGLInitialized;
     std::vector<GLMesh> GLmeshes;
     core::matrix4 ModelViewProjectionMatrix;
+    /** True if the vertices are skinned in a compute shader. */
+    bool m_gpu_skinning;
+    /** Bind pose and joint weights of each mesh buffer for GPU skinning,
+     *  0 for buffers without skinned vertices. */
+    std::vector<GLuint> m_skinning_data;
+    /** Buffer with the skinning matrix of each joint. */
+    GLuint m_joint_matrices;
+    /** The frame the vertex buffers were last skinned for. */
+    float m_skinned_frame;
     void cleanGLMeshes();
+    void initGPUSkinning();
+    void skinOnGPU();
+    void updateSkinnedBoundingBox();
 public:
     virtual void updateNoGL();
     virtual void updateGL();
@@ -45,6 +57,7 @@ public:
   virtual void render();
   virtual void setMesh(irr::scene::IAnimatedMesh* mesh);
   virtual bool glow() const { return false; }
+  virtual bool isSkinnedOnCPU() const { return !m_gpu_skinning; }
 };
 
 #endif // STKANIMATEDMESH_HPP
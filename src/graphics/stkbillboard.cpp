@@ -46,6 +46,12 @@ STKBillboard::STKBillboard(irr::scene::ISceneNode* parent, irr::scene::ISceneMan
         createbillboardvao();
 }
 
+/** Returns the VAO of the quad all billboards are drawn with. */
+GLuint STKBillboard::getVAO()
+{
+    return billboardvao;
+}
+
 void STKBillboard::OnRegisterSceneNode()
 {
     if (IsVisible)
@@ -21,10 +21,14 @@
 #include "../lib/irrlicht/source/Irrlicht/CBillboardSceneNode.h"
 #include <IBillboardSceneNode.h>
 #include <irrTypes.h>
+#include "graphics/gl_headers.hpp"
 #include "utils/cpp2011.hpp"
 
 class STKBillboard : public irr::scene::CBillboardSceneNode
 {
+protected:
+    static GLuint getVAO();
+
 public:
     STKBillboard(irr::scene::ISceneNode* parent, irr::scene::ISceneManager* mgr, irr::s32 id,
         const irr::core::vector3df& position, const irr::core::dimension2d<irr::f32>& size,
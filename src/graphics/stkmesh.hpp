@@ -20,6 +20,7 @@
 #define STKMESH_H
 
 #include "graphics/irr_driver.hpp"
+#include "graphics/shadow_cache.hpp"
 #include "utils/tuple.hpp"
 
 #include <IMeshSceneNode.h>
@@ -73,26 +74,46 @@ class STKMeshCommon
 {
 protected:
     std::string m_debug_name;
+    /** True if the node never moves, so that its shadow can be cached. */
+    bool m_static_shadow_caster;
+    /** The scene update id (see IrrDriver::getSceneUpdateId) of the last
+     *  update of this node. */
+    unsigned m_update_id;
 
 public:
     PtrVector<GLMesh, REF> MeshSolidMaterial[Material::SHADERTYPE_COUNT];
     PtrVector<GLMesh, REF> TransparentMesh[TM_COUNT];
+    STKMeshCommon() : m_static_shadow_caster(false), m_update_id(0) {}
     virtual void updateNoGL() = 0;
     virtual void updateGL() = 0;
     virtual bool glow() const = 0;
     virtual bool isImmediateDraw() const { return false; }
+    /** Returns true if updateGL() overwrites the vertices of the node in
+     *  the shared vertex buffer. */
+    virtual bool isSkinnedOnCPU() const { return false; }
+    void setStaticShadowCaster(bool v) { m_static_shadow_caster = v; }
+    bool isStaticShadowCaster() const { return m_static_shadow_caster; }
+    /** Returns true if the node still needs to be updated for the given
+     *  scene update id, and marks it as updated. */
+    bool needsUpdate(unsigned update_id)
+    {
+        if (update_id != 0 && update_id == m_update_id)
+            return false;
+        m_update_id = update_id;
+        return true;
+    }
 };
 
 template<typename T, typename... Args>
 class MeshList : public Singleton<T>
 {
 public:
-    std::vector<STK::Tuple<Args...> > SolidPass, Shadows[4], RSM;
+    std::vector<STK::Tuple<Args...> > SolidPass, Shadows[ShadowCache::SHADOW_LIST_COUNT], RSM;
     void clear()
     {
         SolidPass.clear();
         RSM.clear();
-        for (unsigned i = 0; i < 4; i++)
+        for (unsigned i = 0; i < ShadowCache::SHADOW_LIST_COUNT; i++)
             Shadows[i].clear();
     }
 };
@@ -101,12 +122,12 @@ template<typename T>
 class InstancedMeshList : public Singleton<T>
 {
 public:
-    std::vector<GLMesh *> SolidPass, Shadows[4], RSM;
+    std::vector<GLMesh *> SolidPass, Shadows[ShadowCache::SHADOW_LIST_COUNT], RSM;
     void clear()
     {
         SolidPass.clear();
         RSM.clear();
-        for (unsigned i = 0; i < 4; i++)
+        for (unsigned i = 0; i < ShadowCache::SHADOW_LIST_COUNT; i++)
             Shadows[i].clear();
     }
 };
@@ -15,18 +15,23 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
+#include "graphics/camera.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/stkscenemanager.hpp"
 #include "graphics/stkmesh.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/occlusion_buffer.hpp"
+#include "graphics/shadow_cascades.hpp"
 #include "stkanimatedmesh.hpp"
 #include "stkmeshscenenode.hpp"
 #include "utils/ptr_vector.hpp"
+#include "utils/simd_math.hpp"
 #include <ICameraSceneNode.h>
 #include <SViewFrustum.h>
 #include "callbacks.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/job_system.hpp"
 #include "modes/world.hpp"
 #include "tracks/track.hpp"
 #include "lod_node.hpp"
@@ -38,7 +43,83 @@
 
 #include <unordered_map>
 #include <SViewFrustum.h>
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <math.h>
+
+/** Decomposition of the absolute transformation of a node as needed for the
+ *  instance buffers. Computing orientation and scale is expensive and would
+ *  otherwise be done for each mesh of a node in each pass, every frame, even
+ *  though most track geometry never moves. */
+struct InstanceTransform
+{
+    core::matrix4   m_transform;
+    core::vector3df m_origin;
+    core::vector3df m_orientation;
+    core::vector3df m_scale;
+};
+
+/** Cached transformations of all nodes drawn recently. An entry is only
+ *  recomputed when the transformation of the node changes. Only modified
+ *  from the main thread before the instance buffers are filled, so the
+ *  (parallel) fill functions can read it without locking. */
+static std::unordered_map<scene::ISceneNode *, InstanceTransform> InstanceTransforms;
+
+static void updateInstanceTransform(scene::ISceneNode *node)
+{
+    const core::matrix4 &mat = node->getAbsoluteTransformation();
+    auto It = InstanceTransforms.find(node);
+    if (It != InstanceTransforms.end() && It->second.m_transform == mat)
+        return;
+    InstanceTransform &t = It != InstanceTransforms.end() ? It->second
+                                                          : InstanceTransforms[node];
+    t.m_transform = mat;
+    t.m_origin = mat.getTranslation();
+    t.m_orientation = mat.getRotationDegrees();
+    t.m_scale = mat.getScale();
+}
+
+static const InstanceTransform &getInstanceTransform(scene::ISceneNode *node)
+{
+    auto It = InstanceTransforms.find(node);
+    assert(It != InstanceTransforms.end() &&
+           It->second.m_transform == node->getAbsoluteTransformation());
+    return It->second;
+}
+
+template<typename T>
+static void fillInstanceTransform(scene::ISceneNode *node, T &Instance)
+{
+    const InstanceTransform &t = getInstanceTransform(node);
+    Instance.Origin.X = t.m_origin.X;
+    Instance.Origin.Y = t.m_origin.Y;
+    Instance.Origin.Z = t.m_origin.Z;
+    Instance.Orientation.X = t.m_orientation.X;
+    Instance.Orientation.Y = t.m_orientation.Y;
+    Instance.Orientation.Z = t.m_orientation.Z;
+    Instance.Scale.X = t.m_scale.X;
+    Instance.Scale.Y = t.m_scale.Y;
+    Instance.Scale.Z = t.m_scale.Z;
+}
+
+/** Returns true if a texture matrix only translates the texture, which is
+ *  what animated textures do. Such meshes can still be instanced, the
+ *  translation is stored in the instance data. */
+static bool isTextureTranslation(const core::matrix4 &m)
+{
+    core::matrix4 rest = m;
+    rest[8] = 0;
+    rest[9] = 0;
+    return rest.isIdentity();
+}
+
+template<typename T>
+static void fillTexcoordOffset(const GLMesh *mesh, T &Instance)
+{
+    Instance.TexcoordOffset.X = mesh->TextureMatrix[8];
+    Instance.TexcoordOffset.Y = mesh->TextureMatrix[9];
+}
 
 template<typename T>
 struct InstanceFiller
@@ -49,87 +130,41 @@ struct InstanceFiller
 template<>
 void InstanceFiller<InstanceDataSingleTex>::add(GLMesh *mesh, scene::ISceneNode *node, InstanceDataSingleTex &Instance)
 {
-    const core::matrix4 &mat = node->getAbsoluteTransformation();
-    const core::vector3df &Origin = mat.getTranslation();
-    const core::vector3df &Orientation = mat.getRotationDegrees();
-    const core::vector3df &Scale = mat.getScale();
-    Instance.Origin.X = Origin.X;
-    Instance.Origin.Y = Origin.Y;
-    Instance.Origin.Z = Origin.Z;
-    Instance.Orientation.X = Orientation.X;
-    Instance.Orientation.Y = Orientation.Y;
-    Instance.Orientation.Z = Orientation.Z;
-    Instance.Scale.X = Scale.X;
-    Instance.Scale.Y = Scale.Y;
-    Instance.Scale.Z = Scale.Z;
+    fillInstanceTransform(node, Instance);
     Instance.Texture = mesh->TextureHandles[0];
 }
 
 template<>
 void InstanceFiller<InstanceDataDualTex>::add(GLMesh *mesh, scene::ISceneNode *node, InstanceDataDualTex &Instance)
 {
-    const core::matrix4 &mat = node->getAbsoluteTransformation();
-    const core::vector3df &Origin = mat.getTranslation();
-    const core::vector3df &Orientation = mat.getRotationDegrees();
-    const core::vector3df &Scale = mat.getScale();
-    Instance.Origin.X = Origin.X;
-    Instance.Origin.Y = Origin.Y;
-    Instance.Origin.Z = Origin.Z;
-    Instance.Orientation.X = Orientation.X;
-    Instance.Orientation.Y = Orientation.Y;
-    Instance.Orientation.Z = Orientation.Z;
-    Instance.Scale.X = Scale.X;
-    Instance.Scale.Y = Scale.Y;
-    Instance.Scale.Z = Scale.Z;
+    fillInstanceTransform(node, Instance);
     Instance.Texture = mesh->TextureHandles[0];
     Instance.SecondTexture = mesh->TextureHandles[1];
+    fillTexcoordOffset(mesh, Instance);
 }
 
 template<>
 void InstanceFiller<InstanceDataThreeTex>::add(GLMesh *mesh, scene::ISceneNode *node, InstanceDataThreeTex &Instance)
 {
-    const core::matrix4 &mat = node->getAbsoluteTransformation();
-    const core::vector3df &Origin = mat.getTranslation();
-    const core::vector3df &Orientation = mat.getRotationDegrees();
-    const core::vector3df &Scale = mat.getScale();
-    Instance.Origin.X = Origin.X;
-    Instance.Origin.Y = Origin.Y;
-    Instance.Origin.Z = Origin.Z;
-    Instance.Orientation.X = Orientation.X;
-    Instance.Orientation.Y = Orientation.Y;
-    Instance.Orientation.Z = Orientation.Z;
-    Instance.Scale.X = Scale.X;
-    Instance.Scale.Y = Scale.Y;
-    Instance.Scale.Z = Scale.Z;
+    fillInstanceTransform(node, Instance);
     Instance.Texture = mesh->TextureHandles[0];
     Instance.SecondTexture = mesh->TextureHandles[1];
     Instance.ThirdTexture = mesh->TextureHandles[2];
+    fillTexcoordOffset(mesh, Instance);
 }
 
 template<>
 void InstanceFiller<GlowInstanceData>::add(GLMesh *mesh, scene::ISceneNode *node, GlowInstanceData &Instance)
 {
     STKMeshSceneNode *nd = dynamic_cast<STKMeshSceneNode*>(node);
-    const core::matrix4 &mat = node->getAbsoluteTransformation();
-    const core::vector3df &Origin = mat.getTranslation();
-    const core::vector3df &Orientation = mat.getRotationDegrees();
-    const core::vector3df &Scale = mat.getScale();
+    fillInstanceTransform(node, Instance);
     Instance.Color = nd->getGlowColor().color;
-    Instance.Origin.X = Origin.X;
-    Instance.Origin.Y = Origin.Y;
-    Instance.Origin.Z = Origin.Z;
-    Instance.Orientation.X = Orientation.X;
-    Instance.Orientation.Y = Orientation.Y;
-    Instance.Orientation.Z = Orientation.Z;
-    Instance.Scale.X = Scale.X;
-    Instance.Scale.Y = Scale.Y;
-    Instance.Scale.Z = Scale.Z;
 }
 
 template<typename T>
 static void
-FillInstances_impl(std::vector<std::pair<GLMesh *, scene::ISceneNode *> > InstanceList, T * InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer,
-    size_t &InstanceBufferOffset, size_t &CommandBufferOffset, size_t &PolyCount)
+FillInstances_impl(const std::vector<std::pair<GLMesh *, scene::ISceneNode *> > &InstanceList, T * InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer,
+    size_t &InstanceBufferOffset, size_t &CommandBufferOffset, size_t &PolyCount, float *BoundsBuffer = NULL)
 {
     // Should never be empty
     GLMesh *mesh = InstanceList.front().first;
@@ -137,10 +172,21 @@ FillInstances_impl(std::vector<std::pair<GLMesh *, scene::ISceneNode *> > Instan
 
     for (unsigned i = 0; i < InstanceList.size(); i++)
     {
-        auto &Tp = InstanceList[i];
+        const auto &Tp = InstanceList[i];
         scene::ISceneNode *node = Tp.second;
         InstanceFiller<T>::add(mesh, node, InstanceBuffer[InstanceBufferOffset++]);
-        assert(InstanceBufferOffset * sizeof(T) < 10000 * sizeof(InstanceDataDualTex));
+        assert(InstanceBufferOffset * sizeof(T) <= VAOManager::getInstanceRegionCount() * INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+    }
+
+    if (BoundsBuffer)
+    {
+        // Bounding sphere of the mesh for culling on the GPU
+        const core::aabbox3df &box = mesh->mb->getBoundingBox();
+        float *Bounds = &BoundsBuffer[4 * CommandBufferOffset];
+        Bounds[0] = box.getCenter().X;
+        Bounds[1] = box.getCenter().Y;
+        Bounds[2] = box.getCenter().Z;
+        Bounds[3] = box.getExtent().getLength() * 0.5f;
     }
 
     DrawElementsIndirectCommand &CurrentCommand = CommandBuffer[CommandBufferOffset++];
@@ -156,33 +202,83 @@ FillInstances_impl(std::vector<std::pair<GLMesh *, scene::ISceneNode *> > Instan
 template<typename T>
 static
 void FillInstances(const std::unordered_map<scene::IMeshBuffer *, std::vector<std::pair<GLMesh *, scene::ISceneNode*> > > &GatheredGLMesh, std::vector<GLMesh *> &InstancedList,
-    T *InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer, size_t &InstanceBufferOffset, size_t &CommandBufferOffset, size_t &Polycount)
+    T *InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer, size_t &InstanceBufferOffset, size_t &CommandBufferOffset, size_t &Polycount,
+    float *BoundsBuffer = NULL, const core::vector3df *ViewPos = NULL)
 {
+    typedef std::vector<std::pair<GLMesh *, scene::ISceneNode*> > InstanceList;
+    // Batches are drawn in the order of their commands. If a view position
+    // is given, the batches are sorted front to back (by their closest
+    // instance), so that early depth tests reject more fragments.
+    std::vector<std::pair<float, const InstanceList *> > Sorted;
+    Sorted.reserve(GatheredGLMesh.size());
     auto It = GatheredGLMesh.begin(), E = GatheredGLMesh.end();
     for (; It != E; ++It)
     {
-        FillInstances_impl<T>(It->second, InstanceBuffer, CommandBuffer, InstanceBufferOffset, CommandBufferOffset, Polycount);
+        // Retained entry of a mesh buffer not drawn this frame
+        if (It->second.empty())
+            continue;
+        float Distance = 0.0f;
+        if (ViewPos)
+        {
+            Distance = std::numeric_limits<float>::max();
+            for (unsigned i = 0; i < It->second.size(); i++)
+            {
+                float d = It->second[i].second->getAbsolutePosition()
+                        .getDistanceFromSQ(*ViewPos);
+                Distance = std::min(Distance, d);
+            }
+        }
+        Sorted.push_back(std::make_pair(Distance, &It->second));
+    }
+    if (ViewPos)
+    {
+        std::sort(Sorted.begin(), Sorted.end(),
+                  [](const std::pair<float, const InstanceList *> &a,
+                     const std::pair<float, const InstanceList *> &b)
+                  { return a.first < b.first; });
+    }
+
+    for (unsigned i = 0; i < Sorted.size(); i++)
+    {
+        const InstanceList &Instances = *Sorted[i].second;
+        FillInstances_impl<T>(Instances, InstanceBuffer, CommandBuffer, InstanceBufferOffset, CommandBufferOffset, Polycount, BoundsBuffer);
         if (!CVS->isAZDOEnabled())
-            InstancedList.push_back(It->second.front().first);
+            InstancedList.push_back(Instances.front().first);
     }
 }
 
-static std::unordered_map <scene::IMeshBuffer *, std::vector<std::pair<GLMesh *, scene::ISceneNode*> > > MeshForSolidPass[Material::SHADERTYPE_COUNT], MeshForShadowPass[Material::SHADERTYPE_COUNT][4], MeshForRSM[Material::SHADERTYPE_COUNT];
+static std::unordered_map <scene::IMeshBuffer *, std::vector<std::pair<GLMesh *, scene::ISceneNode*> > > MeshForSolidPass[Material::SHADERTYPE_COUNT], MeshForShadowPass[Material::SHADERTYPE_COUNT][ShadowCache::SHADOW_LIST_COUNT], MeshForRSM[Material::SHADERTYPE_COUNT];
 static std::unordered_map <scene::IMeshBuffer *, std::vector<std::pair<GLMesh *, scene::ISceneNode*> > > MeshForGlowPass;
 static std::vector <STKMeshCommon *> DeferredUpdate;
+/** The scene update id for which the bounding boxes were last fixed. */
+static unsigned BoundingBoxesFixedId = 0;
 
-static core::vector3df windDir;
+typedef std::unordered_map <scene::IMeshBuffer *, std::vector<std::pair<GLMesh *, scene::ISceneNode*> > > GatherTable;
 
-// From irrlicht code
-static
-bool isBoxInFrontOfPlane(const core::plane3df &plane, const core::vector3df edges[8])
+/** Prepares a gather table for the next frame. Instead of rebuilding the
+ *  table from scratch, the entries (and the memory of their lists) of all
+ *  mesh buffers drawn in the last frame are kept, and only the entries which
+ *  were not used in the last frame are removed. */
+static void resetGatherTable(GatherTable &Table)
 {
-    for (u32 j = 0; j<8; ++j)
-        if (plane.classifyPointRelation(edges[j]) != core::ISREL3D_FRONT)
-            return false;
-    return true;
+    for (auto It = Table.begin(); It != Table.end();)
+    {
+        if (It->second.empty())
+            It = Table.erase(It);
+        else
+        {
+            It->second.clear();
+            ++It;
+        }
+    }
 }
 
+static core::vector3df windDir;
+/** The shadow cache of the current frame, or NULL. */
+static const ShadowCache *CurrentShadowCache;
+/** Cascades which are kept in this frame get no draw lists. */
+static const ShadowCascades *CurrentShadowCascades;
+
 std::vector<float> BoundingBoxes;
 
 static void addEdge(const core::vector3df &P0, const core::vector3df &P1)
@@ -195,38 +291,8 @@ static void addEdge(const core::vector3df &P0, const core::vector3df &P1)
     BoundingBoxes.push_back(P1.Z);
 }
 
-static
-bool isCulledPrecise(const scene::ICameraSceneNode *cam, const scene::ISceneNode *node)
-{
-    if (!node->getAutomaticCulling())
-        return false;
-
-    const core::matrix4 &trans = node->getAbsoluteTransformation();
-    const scene::SViewFrustum &frust = *cam->getViewFrustum();
-
-    core::vector3df edges[8];
-    node->getBoundingBox().getEdges(edges);
-    for (unsigned i = 0; i < 8; i++)
-        trans.transformVect(edges[i]);
-
-    for (s32 i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; ++i)
-        if (isBoxInFrontOfPlane(frust.planes[i], edges))
-            return true;
-    return false;
-}
-
-static void
-handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *ImmediateDraw,
-    const scene::ICameraSceneNode *cam, scene::ICameraSceneNode *shadowcam[4], const scene::ICameraSceneNode *rsmcam,
-    bool &culledforcam, bool culledforshadowcam[4], bool &culledforrsm, bool drawRSM)
+static void addBoundingBoxEdges(scene::ISceneNode *Node)
 {
-    STKMeshCommon *node = dynamic_cast<STKMeshCommon*>(Node);
-    if (!node)
-        return;
-    node->updateNoGL();
-    DeferredUpdate.push_back(node);
-
-
     const core::matrix4 &trans = Node->getAbsoluteTransformation();
 
     core::vector3df edges[8];
@@ -245,32 +311,216 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
     0---------4/
     */
 
-    if (irr_driver->getBoundingBoxesViz())
-    {
-        addEdge(edges[0], edges[1]);
-        addEdge(edges[1], edges[5]);
-        addEdge(edges[5], edges[4]);
-        addEdge(edges[4], edges[0]);
-        addEdge(edges[2], edges[3]);
-        addEdge(edges[3], edges[7]);
-        addEdge(edges[7], edges[6]);
-        addEdge(edges[6], edges[2]);
-        addEdge(edges[0], edges[2]);
-        addEdge(edges[1], edges[3]);
-        addEdge(edges[5], edges[7]);
-        addEdge(edges[4], edges[6]);
-    }
+    addEdge(edges[0], edges[1]);
+    addEdge(edges[1], edges[5]);
+    addEdge(edges[5], edges[4]);
+    addEdge(edges[4], edges[0]);
+    addEdge(edges[2], edges[3]);
+    addEdge(edges[3], edges[7]);
+    addEdge(edges[7], edges[6]);
+    addEdge(edges[6], edges[2]);
+    addEdge(edges[0], edges[2]);
+    addEdge(edges[1], edges[3]);
+    addEdge(edges[5], edges[7]);
+    addEdge(edges[4], edges[6]);
+}
 
-    if (node->isImmediateDraw())
+/** Bit of the culling mask for each of the frustums nodes are culled
+ *  against. */
+enum CullingFrustum
+{
+    CULL_CAM     = 1 << 0,
+    CULL_RSM     = 1 << 1,
+    CULL_SHADOW0 = 1 << 2,   // cascade i uses CULL_SHADOW0 << i
+    CULL_ALL     = 0x3F,
+};
+static const unsigned CULLING_FRUSTUM_COUNT = 6;
+static const unsigned CULLING_PLANE_COUNT =
+    CULLING_FRUSTUM_COUNT * scene::SViewFrustum::VF_PLANE_COUNT;
+
+/** The planes of all frustums of the current frame, one array per plane
+ *  component so that the culling loop can be vectorised. */
+static float FrustumPlaneX[CULLING_PLANE_COUNT], FrustumPlaneY[CULLING_PLANE_COUNT],
+             FrustumPlaneZ[CULLING_PLANE_COUNT], FrustumPlaneD[CULLING_PLANE_COUNT];
+
+/** All nodes collected by parseSceneManager which need to be culled, in
+ *  scene graph order. The bounding box of each node is stored as oriented
+ *  box in world space (center and three half axes) in a structure of
+ *  arrays, so that all frustums can be tested in one pass that the
+ *  compiler can vectorise, and that can be split across threads. */
+struct CullingNodes
+{
+    /** CULL_GROUP nodes are not drawn, they only provide the culling
+     *  result for their children (see LODNode::setCullingBox). */
+    enum NodeType { CULL_MESH, CULL_PARTICLES, CULL_BILLBOARD, CULL_GROUP };
+    struct Entry
     {
-        ImmediateDraw->push_back(Node);
-        return;
+        scene::ISceneNode   *m_node;
+        STKMeshCommon       *m_mesh;
+        ParticleSystemProxy *m_particles;
+        STKBillboard        *m_billboard;
+        /** Index of the closest culled ancestor, or -1. */
+        int                  m_parent;
+        NodeType             m_type;
+    };
+    std::vector<Entry>   m_entries;
+    std::vector<float>   m_center[3];
+    std::vector<float>   m_axis[3][3];
+    /** CULL_ALL for nodes with automatic culling, 0 otherwise. */
+    std::vector<uint8_t> m_cullable;
+    /** Result: CullingFrustum bits of all frustums the node is outside of. */
+    std::vector<uint8_t> m_culled;
+
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        m_entries.clear();
+        m_cullable.clear();
+        m_culled.clear();
+        for (unsigned i = 0; i < 3; i++)
+        {
+            m_center[i].clear();
+            for (unsigned j = 0; j < 3; j++)
+                m_axis[i][j].clear();
+        }
+    }   // clear
+    // ------------------------------------------------------------------------
+    int add(scene::ISceneNode *node, NodeType type, int parent,
+            STKMeshCommon *mesh = NULL, ParticleSystemProxy *particles = NULL,
+            STKBillboard *billboard = NULL)
+    {
+        Entry e = { node, mesh, particles, billboard, parent, type };
+        m_entries.push_back(e);
+        m_culled.push_back(0);
+        if (!node->getAutomaticCulling())
+        {
+            // Only the result of the parent is used, so the box is not
+            // needed
+            m_cullable.push_back(0);
+            for (unsigned k = 0; k < 3; k++)
+            {
+                m_center[k].push_back(0.0f);
+                for (unsigned j = 0; j < 3; j++)
+                    m_axis[k][j].push_back(0.0f);
+            }
+            return (int)m_entries.size() - 1;
+        }
+        m_cullable.push_back(CULL_ALL);
+
+        const core::matrix4 &trans = node->getAbsoluteTransformation();
+        const core::aabbox3df &box = node->getBoundingBox();
+        core::vector3df center = box.getCenter();
+        trans.transformVect(center);
+        const core::vector3df half = box.getExtent() * 0.5f;
+        const float extent[3] = { half.X, half.Y, half.Z };
+        m_center[0].push_back(center.X);
+        m_center[1].push_back(center.Y);
+        m_center[2].push_back(center.Z);
+        // Column k of the matrix is the image of local axis k
+        for (unsigned k = 0; k < 3; k++)
+        {
+            for (unsigned j = 0; j < 3; j++)
+                m_axis[k][j].push_back(trans[4 * k + j] * extent[k]);
+        }
+        return (int)m_entries.size() - 1;
+    }   // add
+    // ------------------------------------------------------------------------
+    /** Tests the nodes [begin, end) against all frustum planes. A box is
+     *  outside of a frustum if it is completely in front of one of its
+     *  planes, i.e. if even its corner closest to the plane is in front of
+     *  it. This gives the same result as classifying all 8 corners, but
+     *  needs no corner transformation and no branches. Meshes inside of
+     *  the camera frustum are then tested against the occlusion buffer if
+     *  one is given; they are still drawn into the shadow maps and the RSM,
+     *  since hidden geometry can cast visible shadows. */
+    void cull(int begin, int end, const OcclusionBuffer *occlusion)
+    {
+        const float *cx = m_center[0].data(), *cy = m_center[1].data(),
+                    *cz = m_center[2].data();
+        const float *a0x = m_axis[0][0].data(), *a0y = m_axis[0][1].data(),
+                    *a0z = m_axis[0][2].data();
+        const float *a1x = m_axis[1][0].data(), *a1y = m_axis[1][1].data(),
+                    *a1z = m_axis[1][2].data();
+        const float *a2x = m_axis[2][0].data(), *a2y = m_axis[2][1].data(),
+                    *a2z = m_axis[2][2].data();
+        uint8_t *culled = m_culled.data();
+
+        for (unsigned p = 0; p < CULLING_PLANE_COUNT; p++)
+        {
+            const float nx = FrustumPlaneX[p], ny = FrustumPlaneY[p],
+                        nz = FrustumPlaneZ[p], d = FrustumPlaneD[p];
+            const uint8_t bit =
+                (uint8_t)(1 << (p / scene::SViewFrustum::VF_PLANE_COUNT));
+            int i = begin;
+#ifdef STK_SIMD
+            // Four nodes at a time, with the operations in the same order as
+            // below so that the results are identical
+            using namespace SIMDMath;
+            const Float4 vnx = splat(nx), vny = splat(ny), vnz = splat(nz),
+                         vd = splat(d), eps = splat(core::ROUNDING_ERROR_f32);
+            for (; i + 4 <= end; i += 4)
+            {
+                const Float4 dist = vnx * load(cx + i) + vny * load(cy + i)
+                    + vnz * load(cz + i) + vd
+                    - abs(vnx * load(a0x + i) + vny * load(a0y + i) + vnz * load(a0z + i))
+                    - abs(vnx * load(a1x + i) + vny * load(a1y + i) + vnz * load(a1z + i))
+                    - abs(vnx * load(a2x + i) + vny * load(a2y + i) + vnz * load(a2z + i));
+                const int outside = greaterMask(dist, eps);
+                for (unsigned k = 0; k < 4; k++)
+                    culled[i + k] |= (outside >> k) & 1 ? bit : 0;
+            }
+#endif
+            for (; i < end; i++)
+            {
+                const float dist = nx * cx[i] + ny * cy[i] + nz * cz[i] + d
+                    - fabsf(nx * a0x[i] + ny * a0y[i] + nz * a0z[i])
+                    - fabsf(nx * a1x[i] + ny * a1y[i] + nz * a1z[i])
+                    - fabsf(nx * a2x[i] + ny * a2y[i] + nz * a2z[i]);
+                culled[i] |= dist > core::ROUNDING_ERROR_f32 ? bit : 0;
+            }
+        }
+        for (int i = begin; i < end; i++)
+            culled[i] &= m_cullable[i];
+
+        if (!occlusion)
+            return;
+        for (int i = begin; i < end; i++)
+        {
+            if ((culled[i] & CULL_CAM) || !m_cullable[i] ||
+                m_entries[i].m_type != CULL_MESH)
+                continue;
+            const core::vector3df center(cx[i], cy[i], cz[i]);
+            const core::vector3df axis[3] =
+            {
+                core::vector3df(a0x[i], a0y[i], a0z[i]),
+                core::vector3df(a1x[i], a1y[i], a1z[i]),
+                core::vector3df(a2x[i], a2y[i], a2z[i]),
+            };
+            if (occlusion->isOccluded(center, axis))
+                culled[i] |= CULL_CAM;
+        }
+    }   // cull
+};   // CullingNodes
+
+static CullingNodes CullingList;
+
+static void setFrustumPlanes(unsigned frustum, const scene::ICameraSceneNode *cam)
+{
+    const scene::SViewFrustum &frust = *cam->getViewFrustum();
+    for (unsigned i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        const unsigned p = frustum * scene::SViewFrustum::VF_PLANE_COUNT + i;
+        FrustumPlaneX[p] = frust.planes[i].Normal.X;
+        FrustumPlaneY[p] = frust.planes[i].Normal.Y;
+        FrustumPlaneZ[p] = frust.planes[i].Normal.Z;
+        FrustumPlaneD[p] = frust.planes[i].D;
     }
+}
 
-    culledforcam = culledforcam || isCulledPrecise(cam, Node);
-    culledforrsm = culledforrsm || isCulledPrecise(rsmcam, Node);
-    for (unsigned i = 0; i < 4; i++)
-        culledforshadowcam[i] = culledforshadowcam[i] || isCulledPrecise(shadowcam[i], Node);
+static void
+handleSTKCommon(scene::ISceneNode *Node, STKMeshCommon *node, bool culledforcam,
+    const bool culledforshadowcam[4], bool culledforrsm, bool drawRSM)
+{
 
     // Transparent
 
@@ -318,7 +568,7 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
                     if (node->glow())
                         MeshForGlowPass[mesh->mb].emplace_back(mesh, Node);
 
-                    if (Mat != Material::SHADERTYPE_SPLATTING && mesh->TextureMatrix.isIdentity())
+                    if (Mat != Material::SHADERTYPE_SPLATTING && isTextureTranslation(mesh->TextureMatrix))
                         MeshForSolidPass[Mat][mesh->mb].emplace_back(mesh, Node);
                     else
                     {
@@ -386,6 +636,18 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
     {
         if (culledforshadowcam[cascade])
             continue;
+        if (CurrentShadowCascades &&
+            !CurrentShadowCascades->needsUpdate(cascade))
+            continue;
+        // Static casters of cached cascades are only drawn into the cache
+        unsigned list = cascade;
+        if (node->isStaticShadowCaster() && CurrentShadowCache &&
+            CurrentShadowCache->isCached(cascade))
+        {
+            if (!CurrentShadowCache->needsRefresh(cascade))
+                continue;
+            list = ShadowCache::getStaticList(cascade);
+        }
         for (unsigned Mat = 0; Mat < Material::SHADERTYPE_COUNT; ++Mat)
         {
             if (CVS->supportsIndirectInstancingRendering())
@@ -393,12 +655,12 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
                 for (GLMesh *mesh : node->MeshSolidMaterial[Mat])
                 {
                     if (Mat != Material::SHADERTYPE_SPLATTING)
-                        MeshForShadowPass[Mat][cascade][mesh->mb].emplace_back(mesh, Node);
+                        MeshForShadowPass[Mat][list][mesh->mb].emplace_back(mesh, Node);
                     else
                     {
                         core::matrix4 ModelMatrix = Node->getAbsoluteTransformation(), InvModelMatrix;
                         ModelMatrix.getInverse(InvModelMatrix);
-                        ListMatSplatting::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix);
+                        ListMatSplatting::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix);
                     }
                 }
             }
@@ -412,28 +674,28 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
                     switch (Mat)
                     {
                     case Material::SHADERTYPE_SOLID:
-                        ListMatDefault::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatDefault::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_ALPHA_TEST:
-                        ListMatAlphaRef::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatAlphaRef::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_NORMAL_MAP:
-                        ListMatNormalMap::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatNormalMap::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_DETAIL_MAP:
-                        ListMatDetails::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatDetails::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_SOLID_UNLIT:
-                        ListMatUnlit::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatUnlit::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_SPHERE_MAP:
-                        ListMatSphereMap::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
+                        ListMatSphereMap::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, mesh->TextureMatrix);
                         break;
                     case Material::SHADERTYPE_SPLATTING:
-                        ListMatSplatting::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix);
+                        ListMatSplatting::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix);
                         break;
                     case Material::SHADERTYPE_VEGETATION:
-                        ListMatGrass::getInstance()->Shadows[cascade].emplace_back(mesh, ModelMatrix, InvModelMatrix, windDir);
+                        ListMatGrass::getInstance()->Shadows[list].emplace_back(mesh, ModelMatrix, InvModelMatrix, windDir);
                     }
                 }
             }
@@ -503,54 +765,207 @@ handleSTKCommon(scene::ISceneNode *Node, std::vector<scene::ISceneNode *> *Immed
 
 static void
 parseSceneManager(core::list<scene::ISceneNode*> &List, std::vector<scene::ISceneNode *> *ImmediateDraw,
-    const scene::ICameraSceneNode* cam, scene::ICameraSceneNode *shadow_cam[4], const scene::ICameraSceneNode *rsmcam,
-    bool culledforcam, bool culledforshadowcam[4], bool culledforrsm, bool drawRSM)
+    int parent)
 {
     core::list<scene::ISceneNode*>::Iterator I = List.begin(), E = List.end();
     for (; I != E; ++I)
     {
-        if (LODNode *node = dynamic_cast<LODNode *>(*I))
-            node->updateVisibility();
+        LODNode *lod_node = dynamic_cast<LODNode *>(*I);
+        if (lod_node)
+            lod_node->updateVisibility();
         (*I)->updateAbsolutePosition();
         if (!(*I)->isVisible())
             continue;
 
         if (ParticleSystemProxy *node = dynamic_cast<ParticleSystemProxy *>(*I))
         {
-            if (!isCulledPrecise(cam, *I))
-                ParticlesList::getInstance()->push_back(node);
+            CullingList.add(*I, CullingNodes::CULL_PARTICLES, -1, NULL, node);
             continue;
         }
 
         if (STKBillboard *node = dynamic_cast<STKBillboard *>(*I))
         {
-            if (!isCulledPrecise(cam, *I))
-                BillBoardList::getInstance()->push_back(node);
+            CullingList.add(*I, CullingNodes::CULL_BILLBOARD, -1, NULL, NULL, node);
             continue;
         }
 
-        bool newculledforcam = culledforcam;
-        bool newculledforrsm = culledforrsm;
-        bool newculledforshadowcam[4] = { culledforshadowcam[0], culledforshadowcam[1], culledforshadowcam[2], culledforshadowcam[3] };
+        int index = parent;
+        if (STKMeshCommon *node = dynamic_cast<STKMeshCommon*>(*I))
+        {
+            // With several cameras the node was already updated (and
+            // uploaded) for the first camera
+            if (node->needsUpdate(irr_driver->getSceneUpdateId()))
+            {
+                node->updateNoGL();
+                DeferredUpdate.push_back(node);
+            }
+            if (irr_driver->getBoundingBoxesViz())
+                addBoundingBoxEdges(*I);
+            if (node->isImmediateDraw())
+                ImmediateDraw->push_back(*I);
+            else
+                index = CullingList.add(*I, CullingNodes::CULL_MESH, parent, node);
+        }
+        else if (lod_node && lod_node->hasCullingBox())
+            index = CullingList.add(*I, CullingNodes::CULL_GROUP, parent);
 
-        handleSTKCommon(*I, ImmediateDraw, cam, shadow_cam, rsmcam, newculledforcam, newculledforshadowcam, newculledforrsm, drawRSM);
+        parseSceneManager(const_cast<core::list<scene::ISceneNode*>& >((*I)->getChildren()), ImmediateDraw, index);
+    }
+}
 
-        parseSceneManager(const_cast<core::list<scene::ISceneNode*>& >((*I)->getChildren()), ImmediateDraw, cam, shadow_cam, rsmcam, newculledforcam, newculledforshadowcam, newculledforrsm, drawRSM);
+/** Culls all nodes collected by parseSceneManager against all frustums and
+ *  fills the draw lists, in scene graph order so that the content of the
+ *  lists does not depend on the number of threads used.
+ *  \param occlusion If not NULL, meshes hidden in this buffer are culled for
+ *         the camera. */
+static void
+cullAndDispatch(const scene::ICameraSceneNode* cam, scene::ICameraSceneNode *shadow_cam[4],
+    const scene::ICameraSceneNode *rsmcam, bool drawRSM, const OcclusionBuffer *occlusion)
+{
+    setFrustumPlanes(0, cam);
+    setFrustumPlanes(1, rsmcam);
+    for (unsigned i = 0; i < 4; i++)
+        setFrustumPlanes(2 + i, shadow_cam[i]);
+
+    // Small batches are not worth waking up the worker threads
+    const int count = (int)CullingList.m_entries.size();
+    const int batch = 256;
+    if (count > 4 * batch)
+    {
+        JobSystem::get()->parallelFor(0, count, batch,
+            [occlusion](int begin, int end)
+            {
+                CullingList.cull(begin, end, occlusion);
+            });
+    }
+    else
+        CullingList.cull(0, count, occlusion);
+
+    // Drop the transformations of nodes which were removed from the scene
+    const bool instanced = CVS->supportsIndirectInstancingRendering();
+    if (InstanceTransforms.size() > 2 * (size_t)count + 1024)
+        InstanceTransforms.clear();
+
+    for (int i = 0; i < count; i++)
+    {
+        const CullingNodes::Entry &e = CullingList.m_entries[i];
+        uint8_t &culled = CullingList.m_culled[i];
+        switch (e.m_type)
+        {
+        case CullingNodes::CULL_PARTICLES:
+            if (!(culled & CULL_CAM))
+                ParticlesList::getInstance()->push_back(e.m_particles);
+            break;
+        case CullingNodes::CULL_BILLBOARD:
+            if (!(culled & CULL_CAM))
+                BillBoardList::getInstance()->push_back(e.m_billboard);
+            break;
+        case CullingNodes::CULL_GROUP:
+            if (e.m_parent >= 0)
+                culled |= CullingList.m_culled[e.m_parent];
+            break;
+        case CullingNodes::CULL_MESH:
+        {
+            // Parents are stored before their children, so their mask is final
+            if (e.m_parent >= 0)
+                culled |= CullingList.m_culled[e.m_parent];
+            bool culledforshadowcam[4];
+            for (unsigned j = 0; j < 4; j++)
+                culledforshadowcam[j] = (culled & (CULL_SHADOW0 << j)) != 0;
+            if (instanced && culled != CULL_ALL)
+                updateInstanceTransform(e.m_node);
+            handleSTKCommon(e.m_node, e.m_mesh, (culled & CULL_CAM) != 0,
+                culledforshadowcam, (culled & CULL_RSM) != 0, drawRSM);
+            break;
+        }
+        }
+    }
+}
+
+/** The draw commands generated from one gather table. The offsets in the
+ *  instance and command buffers of all jobs are computed before any of them
+ *  is run, so that the jobs are independent and can be spread over all
+ *  threads in any order. */
+struct CommandJob
+{
+    const GatherTable           *m_table;
+    std::vector<GLMesh *>       *m_instanced_list;
+    void                        *m_instance_buffer;
+    DrawElementsIndirectCommand *m_command_buffer;
+    float                       *m_bounds_buffer;
+    /** If not NULL, the batches are sorted front to back from here. */
+    const core::vector3df       *m_view_pos;
+    size_t                       m_instance_offset;
+    size_t                       m_command_offset;
+    size_t                       m_instance_count;
+    size_t                       m_poly_count;
+    void                       (*m_fill)(CommandJob &job);
+};
+
+template<typename T>
+static void fillCommandJob(CommandJob &job)
+{
+    size_t InstanceBufferOffset = job.m_instance_offset, CommandBufferOffset = job.m_command_offset;
+    FillInstances<T>(*job.m_table, *job.m_instanced_list, (T *)job.m_instance_buffer, job.m_command_buffer,
+        InstanceBufferOffset, CommandBufferOffset, job.m_poly_count, job.m_bounds_buffer, job.m_view_pos);
+    assert(InstanceBufferOffset == job.m_instance_offset + job.m_instance_count);
+}
+
+/** Adds a job filling the commands of a gather table, and advances the
+ *  offsets past the instances and commands it will write.
+ *  \return The number of commands of the job. */
+template<typename T>
+static size_t addCommandJob(std::vector<CommandJob> &Jobs, const GatherTable &Table, std::vector<GLMesh *> &InstancedList,
+    T *InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer, size_t &InstanceBufferOffset, size_t &CommandBufferOffset,
+    float *BoundsBuffer = NULL, const core::vector3df *ViewPos = NULL)
+{
+    CommandJob Job = { &Table, &InstancedList, InstanceBuffer, CommandBuffer, BoundsBuffer, ViewPos,
+        InstanceBufferOffset, CommandBufferOffset, 0, 0, fillCommandJob<T> };
+    size_t CommandCount = 0;
+    for (auto It = Table.begin(), E = Table.end(); It != E; ++It)
+    {
+        if (It->second.empty())
+            continue;
+        Job.m_instance_count += It->second.size();
+        CommandCount++;
     }
+    if (!CommandCount)
+        return 0;
+    InstanceBufferOffset += Job.m_instance_count;
+    CommandBufferOffset += CommandCount;
+    Jobs.push_back(Job);
+    return CommandCount;
 }
 
 template<Material::ShaderType Mat, typename T> static void
-GenDrawCalls(unsigned cascade, std::vector<GLMesh *> &InstancedList,
-    T *InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer, size_t &InstanceBufferOffset, size_t &CommandBufferOffset, size_t &PolyCount)
+GenDrawCalls(std::vector<CommandJob> &Jobs, unsigned cascade, std::vector<GLMesh *> &InstancedList,
+    T *InstanceBuffer, DrawElementsIndirectCommand *CommandBuffer, size_t &InstanceBufferOffset, size_t &CommandBufferOffset)
 {
-    if (CVS->supportsIndirectInstancingRendering())
-        ShadowPassCmd::getInstance()->Offset[cascade][Mat] = CommandBufferOffset; // Store command buffer offset
-    FillInstances<T>(MeshForShadowPass[Mat][cascade], InstancedList, InstanceBuffer, CommandBuffer, InstanceBufferOffset, CommandBufferOffset, PolyCount);
-    if (CVS->isAZDOEnabled())
-        ShadowPassCmd::getInstance()->Size[cascade][Mat] = CommandBufferOffset - ShadowPassCmd::getInstance()->Offset[cascade][Mat];
+    ShadowPassCmd::getInstance()->Offset[cascade][Mat] = CommandBufferOffset; // Store command buffer offset
+    ShadowPassCmd::getInstance()->Size[cascade][Mat] =
+        addCommandJob<T>(Jobs, MeshForShadowPass[Mat][cascade], InstancedList, InstanceBuffer, CommandBuffer, InstanceBufferOffset, CommandBufferOffset);
 }
 
-int enableOpenMP;
+/** Larger jobs are started first, so that the threads finish at about the
+ *  same time. */
+static bool isLargerJob(const CommandJob *a, const CommandJob *b)
+{
+    return a->m_instance_count > b->m_instance_count;
+}
+
+static void *mapBuffer(GLenum target, GLuint buffer, size_t size)
+{
+    glBindBuffer(target, buffer);
+    return glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+static void unmapBuffer(GLenum target, GLuint buffer)
+{
+    glBindBuffer(target, buffer);
+    glUnmapBuffer(target);
+}
+
+static bool enableParallelFill;
 
 static void FixBoundingBoxes(scene::ISceneNode* node)
 {
@@ -586,53 +1001,61 @@ void IrrDriver::PrepareDrawCalls(scene::ICameraSceneNode *camnode)
 
     for (unsigned Mat = 0; Mat < Material::SHADERTYPE_COUNT; ++Mat)
     {
-        MeshForSolidPass[Mat].clear();
-        MeshForRSM[Mat].clear();
-        for (unsigned i = 0; i < 4; i++)
-            MeshForShadowPass[Mat][i].clear();
+        resetGatherTable(MeshForSolidPass[Mat]);
+        resetGatherTable(MeshForRSM[Mat]);
+        for (unsigned i = 0; i < ShadowCache::SHADOW_LIST_COUNT; i++)
+            resetGatherTable(MeshForShadowPass[Mat][i]);
     }
-    MeshForGlowPass.clear();
+    resetGatherTable(MeshForGlowPass);
     DeferredUpdate.clear();
     core::list<scene::ISceneNode*> List = m_scene_manager->getRootSceneNode()->getChildren();
 
 PROFILER_PUSH_CPU_MARKER("- culling", 0xFF, 0xFF, 0x0);
-    for (scene::ISceneNode *child : List)
-        FixBoundingBoxes(child);
+    // The bounding boxes don't depend on the camera, so with several
+    // cameras they are only fixed once per frame
+    const unsigned update_id = getSceneUpdateId();
+    if (update_id == 0 || update_id != BoundingBoxesFixedId)
+    {
+        for (scene::ISceneNode *child : List)
+            FixBoundingBoxes(child);
+        BoundingBoxesFixedId = update_id;
+    }
+
+    // The occlusion buffer contains the depth of a single camera
+    OcclusionBuffer *occlusion = NULL;
+    if (m_occlusion_buffer && CVS->isOcclusionCullingEnabled() && Camera::getNumCameras() == 1)
+    {
+        m_occlusion_buffer->update();
+        if (m_occlusion_buffer->isValid())
+            occlusion = m_occlusion_buffer;
+    }
 
-    bool cam = false, rsmcam = false;
-    bool shadowcam[4] = { false, false, false, false };
-    parseSceneManager(List, ImmediateDrawList::getInstance(), camnode, m_shadow_camnodes, m_suncam, cam, shadowcam, rsmcam, !m_rsm_map_available);
+    CurrentShadowCache = m_shadow_cache;
+    CurrentShadowCascades = m_shadow_cascades;
+
+    CullingList.clear();
+    parseSceneManager(List, ImmediateDrawList::getInstance(), -1);
+    cullAndDispatch(camnode, m_shadow_camnodes, m_suncam, !m_rsm_map_available, occlusion);
 PROFILER_POP_CPU_MARKER();
 
-    // Add a 1 s timeout
-    if (!m_sync)
-        m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Only the instances and commands are written to a new region of the
+    // buffers each frame, vertices skinned on the CPU are overwritten in
+    // place, so they still have to wait for the previous frame.
+    VAOManager *vao = VAOManager::getInstance();
     PROFILER_PUSH_CPU_MARKER("- Sync Stall", 0xFF, 0x0, 0x0);
-    GLenum reason = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
-
-    while (reason != GL_ALREADY_SIGNALED)
+    vao->startInstanceRegion();
+    if (CVS->supportsAsyncInstanceUpload())
     {
-        if (reason == GL_WAIT_FAILED) break;
-        StkTime::sleep(1);
-        reason = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        for (unsigned i = 0; i < DeferredUpdate.size(); i++)
+        {
+            if (DeferredUpdate[i]->isSkinnedOnCPU())
+            {
+                vao->waitForPreviousRegion();
+                break;
+            }
+        }
     }
-    glDeleteSync(m_sync);
     PROFILER_POP_CPU_MARKER();
-    /*    switch (reason)
-    {
-    case GL_ALREADY_SIGNALED:
-    printf("Already Signaled\n");
-    break;
-    case GL_TIMEOUT_EXPIRED:
-    printf("Timeout Expired\n");
-    break;
-    case GL_CONDITION_SATISFIED:
-    printf("Condition Satisfied\n");
-    break;
-    case GL_WAIT_FAILED:
-    printf("Wait Failed\n");
-    break;
-    }*/
     PROFILER_PUSH_CPU_MARKER("- Animations/Buffer upload", 0x0, 0x0, 0x0);
     for (unsigned i = 0; i < DeferredUpdate.size(); i++)
         DeferredUpdate[i]->updateGL();
@@ -644,28 +1067,43 @@ PROFILER_POP_CPU_MARKER();
     InstanceDataDualTex *InstanceBufferDualTex;
     InstanceDataThreeTex *InstanceBufferThreeTex;
     InstanceDataSingleTex *ShadowInstanceBuffer;
-    InstanceDataSingleTex *RSMInstanceBuffer;
+    InstanceDataSingleTex *RSMInstanceBuffer = NULL;
     GlowInstanceData *GlowInstanceBuffer;
     DrawElementsIndirectCommand *CmdBuffer;
     DrawElementsIndirectCommand *ShadowCmdBuffer;
-    DrawElementsIndirectCommand *RSMCmdBuffer;
+    DrawElementsIndirectCommand *RSMCmdBuffer = NULL;
     DrawElementsIndirectCommand *GlowCmdBuffer;
 
     if (CVS->supportsAsyncInstanceUpload())
     {
-        InstanceBufferDualTex = (InstanceDataDualTex*)VAOManager::getInstance()->getInstanceBufferPtr(InstanceTypeDualTex);
-        InstanceBufferThreeTex = (InstanceDataThreeTex*)VAOManager::getInstance()->getInstanceBufferPtr(InstanceTypeThreeTex);
-        ShadowInstanceBuffer = (InstanceDataSingleTex*)VAOManager::getInstance()->getInstanceBufferPtr(InstanceTypeShadow);
-        RSMInstanceBuffer = (InstanceDataSingleTex*)VAOManager::getInstance()->getInstanceBufferPtr(InstanceTypeRSM);
-        GlowInstanceBuffer = (GlowInstanceData*)VAOManager::getInstance()->getInstanceBufferPtr(InstanceTypeGlow);
+        InstanceBufferDualTex = (InstanceDataDualTex*)vao->getInstanceBufferPtr(InstanceTypeDualTex);
+        InstanceBufferThreeTex = (InstanceDataThreeTex*)vao->getInstanceBufferPtr(InstanceTypeThreeTex);
+        ShadowInstanceBuffer = (InstanceDataSingleTex*)vao->getInstanceBufferPtr(InstanceTypeShadow);
+        RSMInstanceBuffer = (InstanceDataSingleTex*)vao->getInstanceBufferPtr(InstanceTypeRSM);
+        GlowInstanceBuffer = (GlowInstanceData*)vao->getInstanceBufferPtr(InstanceTypeGlow);
         CmdBuffer = SolidPassCmd::getInstance()->Ptr;
         ShadowCmdBuffer = ShadowPassCmd::getInstance()->Ptr;
         GlowCmdBuffer = GlowPassCmd::getInstance()->Ptr;
         RSMCmdBuffer = RSMPassCmd::getInstance()->Ptr;
-        enableOpenMP = 1;
+        enableParallelFill = true;
     }
     else
-        enableOpenMP = 0;
+    {
+        // Mapping is done by this thread, the jobs then run without any GL call
+        InstanceBufferDualTex = (InstanceDataDualTex*)mapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeDualTex), INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+        InstanceBufferThreeTex = (InstanceDataThreeTex*)mapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeThreeTex), INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+        CmdBuffer = (DrawElementsIndirectCommand*)mapBuffer(GL_DRAW_INDIRECT_BUFFER, SolidPassCmd::getInstance()->drawindirectcmd, INSTANCE_REGION_SIZE * sizeof(DrawElementsIndirectCommand));
+        GlowInstanceBuffer = (GlowInstanceData*)mapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeGlow), INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+        GlowCmdBuffer = (DrawElementsIndirectCommand*)mapBuffer(GL_DRAW_INDIRECT_BUFFER, GlowPassCmd::getInstance()->drawindirectcmd, INSTANCE_REGION_SIZE * sizeof(DrawElementsIndirectCommand));
+        ShadowInstanceBuffer = (InstanceDataSingleTex*)mapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeShadow), INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+        ShadowCmdBuffer = (DrawElementsIndirectCommand*)mapBuffer(GL_DRAW_INDIRECT_BUFFER, ShadowPassCmd::getInstance()->drawindirectcmd, INSTANCE_REGION_SIZE * sizeof(DrawElementsIndirectCommand));
+        if (!m_rsm_map_available)
+        {
+            RSMInstanceBuffer = (InstanceDataSingleTex*)mapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeRSM), INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex));
+            RSMCmdBuffer = (DrawElementsIndirectCommand*)mapBuffer(GL_DRAW_INDIRECT_BUFFER, RSMPassCmd::getInstance()->drawindirectcmd, INSTANCE_REGION_SIZE * sizeof(DrawElementsIndirectCommand));
+        }
+        enableParallelFill = false;
+    }
 
     ListInstancedMatDefault::getInstance()->clear();
     ListInstancedMatAlphaRef::getInstance()->clear();
@@ -677,175 +1115,136 @@ PROFILER_POP_CPU_MARKER();
 
     size_t SolidPoly = 0, ShadowPoly = 0, MiscPoly = 0;
 
-    PROFILER_PUSH_CPU_MARKER("- Draw Command upload", 0xFF, 0x0, 0xFF);
-
-#pragma omp parallel sections if(enableOpenMP)
+    // Bounding spheres of the meshes of the solid pass commands
+    static std::vector<float> SolidPassBounds;
+    float *SolidBounds = NULL;
+    if (CVS->isGPUCullingEnabled())
     {
-#pragma omp section
-        {
-            size_t offset = 0, current_cmd = 0;
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glBindBuffer(GL_ARRAY_BUFFER, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeDualTex));
-                InstanceBufferDualTex = (InstanceDataDualTex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataDualTex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, SolidPassCmd::getInstance()->drawindirectcmd);
-                CmdBuffer = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, 10000 * sizeof(DrawElementsIndirectCommand), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-            }
-
-
-            // Default Material
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_SOLID], ListInstancedMatDefault::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_SOLID] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID];
-            // Alpha Ref
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_ALPHA_TEST] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_ALPHA_TEST], ListInstancedMatAlphaRef::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_ALPHA_TEST] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_ALPHA_TEST];
-            // Unlit
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_SOLID_UNLIT], ListInstancedMatUnlit::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID_UNLIT];
-            // Spheremap
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SPHERE_MAP] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_SPHERE_MAP], ListInstancedMatSphereMap::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_SPHERE_MAP] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_SPHERE_MAP];
-            // Grass
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_VEGETATION] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_VEGETATION], ListInstancedMatGrass::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_VEGETATION] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_VEGETATION];
-
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glUnmapBuffer(GL_ARRAY_BUFFER);
-                glBindBuffer(GL_ARRAY_BUFFER, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeThreeTex));
-                InstanceBufferThreeTex = (InstanceDataThreeTex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataSingleTex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-
-            }
+        SolidPassBounds.resize(4 * INSTANCE_REGION_SIZE * INSTANCE_REGION_COUNT);
+        SolidBounds = SolidPassBounds.data();
+    }
 
-            // Detail
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_DETAIL_MAP] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_DETAIL_MAP], ListInstancedMatDetails::getInstance()->SolidPass, InstanceBufferThreeTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_DETAIL_MAP] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_DETAIL_MAP];
-            // Normal Map
-            SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_NORMAL_MAP] = current_cmd;
-            FillInstances(MeshForSolidPass[Material::SHADERTYPE_NORMAL_MAP], ListInstancedMatNormalMap::getInstance()->SolidPass, InstanceBufferThreeTex, CmdBuffer, offset, current_cmd, SolidPoly);
-            SolidPassCmd::getInstance()->Size[Material::SHADERTYPE_NORMAL_MAP] = current_cmd - SolidPassCmd::getInstance()->Offset[Material::SHADERTYPE_NORMAL_MAP];
+    PROFILER_PUSH_CPU_MARKER("- Draw Command upload", 0xFF, 0x0, 0xFF);
 
+    // One job per pass, material and shadow cascade
+    static std::vector<CommandJob> Jobs;
+    Jobs.clear();
+    // Jobs are run before this function returns
+    const core::vector3df ViewPos = camnode->getAbsolutePosition();
+    {
+        SolidPassCmd *Cmd = SolidPassCmd::getInstance();
+        size_t offset = vao->getInstanceRegionBase(), current_cmd = offset;
+        // Default Material
+        Cmd->Offset[Material::SHADERTYPE_SOLID] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_SOLID] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_SOLID], ListInstancedMatDefault::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Alpha Ref
+        Cmd->Offset[Material::SHADERTYPE_ALPHA_TEST] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_ALPHA_TEST] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_ALPHA_TEST], ListInstancedMatAlphaRef::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Unlit
+        Cmd->Offset[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_SOLID_UNLIT] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_SOLID_UNLIT], ListInstancedMatUnlit::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Spheremap
+        Cmd->Offset[Material::SHADERTYPE_SPHERE_MAP] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_SPHERE_MAP] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_SPHERE_MAP], ListInstancedMatSphereMap::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Grass
+        Cmd->Offset[Material::SHADERTYPE_VEGETATION] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_VEGETATION] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_VEGETATION], ListInstancedMatGrass::getInstance()->SolidPass, InstanceBufferDualTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Detail
+        Cmd->Offset[Material::SHADERTYPE_DETAIL_MAP] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_DETAIL_MAP] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_DETAIL_MAP], ListInstancedMatDetails::getInstance()->SolidPass, InstanceBufferThreeTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+        // Normal Map
+        Cmd->Offset[Material::SHADERTYPE_NORMAL_MAP] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_NORMAL_MAP] = addCommandJob(Jobs, MeshForSolidPass[Material::SHADERTYPE_NORMAL_MAP], ListInstancedMatNormalMap::getInstance()->SolidPass, InstanceBufferThreeTex, CmdBuffer, offset, current_cmd, SolidBounds, &ViewPos);
+    }
+    const size_t SolidJobsEnd = Jobs.size();
+    {
+        // Glow
+        size_t offset = vao->getInstanceRegionBase(), current_cmd = offset;
+        GlowPassCmd::getInstance()->Offset = current_cmd; // Store command buffer offset
+        GlowPassCmd::getInstance()->Size = addCommandJob(Jobs, MeshForGlowPass, *ListInstancedGlow::getInstance(), GlowInstanceBuffer, GlowCmdBuffer, offset, current_cmd);
+    }
+    const size_t ShadowJobsBegin = Jobs.size();
+    {
+        irr_driver->setPhase(SHADOW_PASS);
 
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glUnmapBuffer(GL_ARRAY_BUFFER);
-                glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
-            }
-        }
-#pragma omp section
+        size_t offset = vao->getInstanceRegionBase(), current_cmd = offset;
+        for (unsigned i = 0; i < ShadowCache::SHADOW_LIST_COUNT; i++)
         {
-            size_t offset = 0, current_cmd = 0;
-
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glBindBuffer(GL_ARRAY_BUFFER, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeGlow));
-                GlowInstanceBuffer = (GlowInstanceData*)glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataDualTex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GlowPassCmd::getInstance()->drawindirectcmd);
-                GlowCmdBuffer = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, 10000 * sizeof(DrawElementsIndirectCommand), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-            }
-
-            // Glow
-            if (CVS->supportsIndirectInstancingRendering())
-                GlowPassCmd::getInstance()->Offset = offset; // Store command buffer offset
-
-            auto It = MeshForGlowPass.begin(), E = MeshForGlowPass.end();
-            for (; It != E; ++It)
-            {
-                size_t Polycnt = 0;
-                FillInstances_impl<GlowInstanceData>(It->second, GlowInstanceBuffer, GlowCmdBuffer, offset, current_cmd, Polycnt);
-                if (!CVS->isAZDOEnabled())
-                    ListInstancedGlow::getInstance()->push_back(It->second.front().first);
-            }
+            // Mat default
+            GenDrawCalls<Material::SHADERTYPE_SOLID>(Jobs, i, ListInstancedMatDefault::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat AlphaRef
+            GenDrawCalls<Material::SHADERTYPE_ALPHA_TEST>(Jobs, i, ListInstancedMatAlphaRef::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat Unlit
+            GenDrawCalls<Material::SHADERTYPE_SOLID_UNLIT>(Jobs, i, ListInstancedMatUnlit::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat NormalMap
+            GenDrawCalls<Material::SHADERTYPE_NORMAL_MAP>(Jobs, i, ListInstancedMatNormalMap::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat Spheremap
+            GenDrawCalls<Material::SHADERTYPE_SPHERE_MAP>(Jobs, i, ListInstancedMatSphereMap::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat Detail
+            GenDrawCalls<Material::SHADERTYPE_DETAIL_MAP>(Jobs, i, ListInstancedMatDetails::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+            // Mat Grass
+            GenDrawCalls<Material::SHADERTYPE_VEGETATION>(Jobs, i, ListInstancedMatGrass::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd);
+        }
+    }
+    const size_t ShadowJobsEnd = Jobs.size();
+    if (!m_rsm_map_available)
+    {
+        RSMPassCmd *Cmd = RSMPassCmd::getInstance();
+        size_t offset = vao->getInstanceRegionBase(), current_cmd = offset;
+        // Default Material
+        Cmd->Offset[Material::SHADERTYPE_SOLID] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_SOLID] = addCommandJob(Jobs, MeshForRSM[Material::SHADERTYPE_SOLID], ListInstancedMatDefault::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd);
+        // Alpha Ref
+        Cmd->Offset[Material::SHADERTYPE_ALPHA_TEST] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_ALPHA_TEST] = addCommandJob(Jobs, MeshForRSM[Material::SHADERTYPE_ALPHA_TEST], ListInstancedMatAlphaRef::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd);
+        // Unlit
+        Cmd->Offset[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_SOLID_UNLIT] = addCommandJob(Jobs, MeshForRSM[Material::SHADERTYPE_SOLID_UNLIT], ListInstancedMatUnlit::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd);
+        // Detail
+        Cmd->Offset[Material::SHADERTYPE_DETAIL_MAP] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_DETAIL_MAP] = addCommandJob(Jobs, MeshForRSM[Material::SHADERTYPE_DETAIL_MAP], ListInstancedMatDetails::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd);
+        // Normal Map
+        Cmd->Offset[Material::SHADERTYPE_NORMAL_MAP] = current_cmd;
+        Cmd->Size[Material::SHADERTYPE_NORMAL_MAP] = addCommandJob(Jobs, MeshForRSM[Material::SHADERTYPE_NORMAL_MAP], ListInstancedMatNormalMap::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd);
+    }
 
-            if (CVS->isAZDOEnabled())
-                GlowPassCmd::getInstance()->Size = current_cmd - GlowPassCmd::getInstance()->Offset;
+    static std::vector<CommandJob *> JobOrder;
+    JobOrder.clear();
+    for (unsigned i = 0; i < Jobs.size(); i++)
+        JobOrder.push_back(&Jobs[i]);
+    std::sort(JobOrder.begin(), JobOrder.end(), isLargerJob);
 
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glUnmapBuffer(GL_ARRAY_BUFFER);
-                glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
-            }
-        }
-#pragma omp section
-        {
-            irr_driver->setPhase(SHADOW_PASS);
+    const int JobCount = (int)JobOrder.size();
+    // The jobs only run in parallel if the buffers are persistently mapped
+    JobSystem::get()->parallelFor(0, JobCount, 1, [](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+            JobOrder[i]->m_fill(*JobOrder[i]);
+    }, enableParallelFill ? 0 : 1);
 
-            size_t offset = 0, current_cmd = 0;
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glBindBuffer(GL_ARRAY_BUFFER, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeShadow));
-                ShadowInstanceBuffer = (InstanceDataSingleTex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataDualTex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ShadowPassCmd::getInstance()->drawindirectcmd);
-                ShadowCmdBuffer = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, 10000 * sizeof(DrawElementsIndirectCommand), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-            }
+    for (size_t i = 0; i < Jobs.size(); i++)
+    {
+        if (i < SolidJobsEnd)
+            SolidPoly += Jobs[i].m_poly_count;
+        else if (i >= ShadowJobsBegin && i < ShadowJobsEnd)
+            ShadowPoly += Jobs[i].m_poly_count;
+        else
+            MiscPoly += Jobs[i].m_poly_count;
+    }
 
-            for (unsigned i = 0; i < 4; i++)
-            {
-                // Mat default
-                GenDrawCalls<Material::SHADERTYPE_SOLID>(i, ListInstancedMatDefault::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat AlphaRef
-                GenDrawCalls<Material::SHADERTYPE_ALPHA_TEST>(i, ListInstancedMatAlphaRef::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat Unlit
-                GenDrawCalls<Material::SHADERTYPE_SOLID_UNLIT>(i, ListInstancedMatUnlit::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat NormalMap
-                GenDrawCalls<Material::SHADERTYPE_NORMAL_MAP>(i, ListInstancedMatNormalMap::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat Spheremap
-                GenDrawCalls<Material::SHADERTYPE_SPHERE_MAP>(i, ListInstancedMatSphereMap::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat Detail
-                GenDrawCalls<Material::SHADERTYPE_DETAIL_MAP>(i, ListInstancedMatDetails::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-                // Mat Grass
-                GenDrawCalls<Material::SHADERTYPE_VEGETATION>(i, ListInstancedMatGrass::getInstance()->Shadows[i], ShadowInstanceBuffer, ShadowCmdBuffer, offset, current_cmd, ShadowPoly);
-            }
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glUnmapBuffer(GL_ARRAY_BUFFER);
-                glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
-            }
-        }
-#pragma omp section
+    if (!CVS->supportsAsyncInstanceUpload())
+    {
+        unmapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeDualTex));
+        unmapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeThreeTex));
+        unmapBuffer(GL_DRAW_INDIRECT_BUFFER, SolidPassCmd::getInstance()->drawindirectcmd);
+        unmapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeGlow));
+        unmapBuffer(GL_DRAW_INDIRECT_BUFFER, GlowPassCmd::getInstance()->drawindirectcmd);
+        unmapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeShadow));
+        unmapBuffer(GL_DRAW_INDIRECT_BUFFER, ShadowPassCmd::getInstance()->drawindirectcmd);
         if (!m_rsm_map_available)
         {
-            size_t offset = 0, current_cmd = 0;
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glBindBuffer(GL_ARRAY_BUFFER, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeRSM));
-                RSMInstanceBuffer = (InstanceDataSingleTex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataDualTex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, RSMPassCmd::getInstance()->drawindirectcmd);
-                RSMCmdBuffer = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, 10000 * sizeof(DrawElementsIndirectCommand), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-            }
-
-            // Default Material
-            RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID] = current_cmd;
-            FillInstances(MeshForRSM[Material::SHADERTYPE_SOLID], ListInstancedMatDefault::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd, MiscPoly);
-            RSMPassCmd::getInstance()->Size[Material::SHADERTYPE_SOLID] = current_cmd - RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID];
-            // Alpha Ref
-            RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_ALPHA_TEST] = current_cmd;
-            FillInstances(MeshForRSM[Material::SHADERTYPE_ALPHA_TEST], ListInstancedMatAlphaRef::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd, MiscPoly);
-            RSMPassCmd::getInstance()->Size[Material::SHADERTYPE_ALPHA_TEST] = current_cmd - RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_ALPHA_TEST];
-            // Unlit
-            RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd;
-            FillInstances(MeshForRSM[Material::SHADERTYPE_SOLID_UNLIT], ListInstancedMatUnlit::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd, MiscPoly);
-            RSMPassCmd::getInstance()->Size[Material::SHADERTYPE_SOLID_UNLIT] = current_cmd - RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_SOLID_UNLIT];
-            // Detail
-            RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_DETAIL_MAP] = current_cmd;
-            FillInstances(MeshForRSM[Material::SHADERTYPE_DETAIL_MAP], ListInstancedMatDetails::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd, MiscPoly);
-            RSMPassCmd::getInstance()->Size[Material::SHADERTYPE_DETAIL_MAP] = current_cmd - RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_DETAIL_MAP];
-            // Normal Map
-            RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_NORMAL_MAP] = current_cmd;
-            FillInstances(MeshForRSM[Material::SHADERTYPE_NORMAL_MAP], ListInstancedMatNormalMap::getInstance()->RSM, RSMInstanceBuffer, RSMCmdBuffer, offset, current_cmd, MiscPoly);
-            RSMPassCmd::getInstance()->Size[Material::SHADERTYPE_NORMAL_MAP] = current_cmd - RSMPassCmd::getInstance()->Offset[Material::SHADERTYPE_NORMAL_MAP];
-
-            if (!CVS->supportsAsyncInstanceUpload())
-            {
-                glUnmapBuffer(GL_ARRAY_BUFFER);
-                glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
-            }
+            unmapBuffer(GL_ARRAY_BUFFER, vao->getInstanceBuffer(InstanceTypeRSM));
+            unmapBuffer(GL_DRAW_INDIRECT_BUFFER, RSMPassCmd::getInstance()->drawindirectcmd);
         }
     }
     PROFILER_POP_CPU_MARKER();
@@ -854,4 +1253,29 @@ PROFILER_POP_CPU_MARKER();
 
     if (CVS->supportsAsyncInstanceUpload())
         glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    if (SolidBounds)
+    {
+        PROFILER_PUSH_CPU_MARKER("- GPU culling", 0x0, 0xFF, 0xFF);
+        // The bounds are indexed like the commands, so the buffer has the
+        // same regions and only the one of this frame is uploaded
+        static GLuint SolidBoundsSSBO = 0;
+        const bool NewBoundsSSBO = !SolidBoundsSSBO;
+        if (NewBoundsSSBO)
+            glGenBuffers(1, &SolidBoundsSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, SolidBoundsSSBO);
+        if (NewBoundsSSBO)
+            glBufferData(GL_SHADER_STORAGE_BUFFER, SolidPassBounds.size() * sizeof(float), 0, GL_STREAM_DRAW);
+        const SolidPassCmd *Cmd = SolidPassCmd::getInstance();
+        const size_t FirstCommand = Cmd->Offset[Material::SHADERTYPE_SOLID];
+        const size_t ThreeTexBegin = Cmd->Offset[Material::SHADERTYPE_DETAIL_MAP];
+        const size_t CommandEnd = Cmd->Offset[Material::SHADERTYPE_NORMAL_MAP] + Cmd->Size[Material::SHADERTYPE_NORMAL_MAP];
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 4 * FirstCommand * sizeof(float), 4 * (CommandEnd - FirstCommand) * sizeof(float), SolidBounds + 4 * FirstCommand);
+
+        cullInstancesOnGPU(FirstCommand, ThreeTexBegin - FirstCommand, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeDualTex),
+            sizeof(InstanceDataDualTex), Cmd->drawindirectcmd, SolidBoundsSSBO);
+        cullInstancesOnGPU(ThreeTexBegin, CommandEnd - ThreeTexBegin, VAOManager::getInstance()->getInstanceBuffer(InstanceTypeThreeTex),
+            sizeof(InstanceDataThreeTex), Cmd->drawindirectcmd, SolidBoundsSSBO);
+        PROFILER_POP_CPU_MARKER();
+    }
 }
@@ -28,6 +28,7 @@
 #include "stkmesh.hpp"
 #include "gpuparticles.hpp"
 #include "stkbillboard.hpp"
+#include "vaomanager.hpp"
 
 template<typename T>
 class CommandBuffer : public Singleton<T>
@@ -37,16 +38,18 @@ public:
     DrawElementsIndirectCommand *Ptr;
     CommandBuffer()
     {
+        // One region of commands per frame, see VAOManager::startInstanceRegion
+        const size_t size = VAOManager::getInstanceRegionCount() * INSTANCE_REGION_SIZE * sizeof(DrawElementsIndirectCommand);
         glGenBuffers(1, &drawindirectcmd);
         glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawindirectcmd);
         if (CVS->supportsAsyncInstanceUpload())
         {
-            glBufferStorage(GL_DRAW_INDIRECT_BUFFER, 10000 * sizeof(DrawElementsIndirectCommand), 0, GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT);
-            Ptr = (DrawElementsIndirectCommand *)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, 10000 * sizeof(DrawElementsIndirectCommand), GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT);
+            glBufferStorage(GL_DRAW_INDIRECT_BUFFER, size, 0, GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT);
+            Ptr = (DrawElementsIndirectCommand *)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, size, GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT);
         }
         else
         {
-            glBufferData(GL_DRAW_INDIRECT_BUFFER, 10000 * sizeof(DrawElementsIndirectCommand), 0, GL_STREAM_DRAW);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, size, 0, GL_STREAM_DRAW);
         }
     }
 };
@@ -70,7 +73,7 @@ public:
 class ShadowPassCmd : public CommandBuffer<ShadowPassCmd>
 {
 public:
-    size_t Offset[4][Material::SHADERTYPE_COUNT], Size[4][Material::SHADERTYPE_COUNT];
+    size_t Offset[ShadowCache::SHADOW_LIST_COUNT][Material::SHADERTYPE_COUNT], Size[ShadowCache::SHADOW_LIST_COUNT][Material::SHADERTYPE_COUNT];
 };
 
 class RSMPassCmd : public CommandBuffer<RSMPassCmd>
@@ -0,0 +1,374 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/texture_prefetcher.hpp"
+
+#include "graphics/irr_driver.hpp"
+#include "guiengine/engine.hpp"
+#include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
+#include "utils/load_profiler.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+TexturePrefetcher *TexturePrefetcher::m_preloaded = NULL;
+std::string        TexturePrefetcher::m_preloaded_dir;
+
+// ----------------------------------------------------------------------------
+/** Reads the names of the textures used by a b3d file. They are stored in
+ *  the TEXS chunk, which is one of the top level chunks (usually the first
+ *  one), so only a small part of the file needs to be read.
+ *  \param filename Full path of the b3d file.
+ *  \param names The (base) names of the textures are added to this set.
+ */
+static void readB3DTextureNames(const std::string &filename,
+                                std::set<std::string> *names)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return;
+
+    char tag[4];
+    int size;
+    // Skip the header of the BB3D chunk and the version number
+    if (fread(tag, 4, 1, file) != 1 || strncmp(tag, "BB3D", 4) != 0 ||
+        fseek(file, 8, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return;
+    }
+
+    while (fread(tag, 4, 1, file) == 1 && fread(&size, 4, 1, file) == 1 &&
+           size >= 0)
+    {
+        if (strncmp(tag, "TEXS", 4) != 0)
+        {
+            if (fseek(file, size, SEEK_CUR) != 0)
+                break;
+            continue;
+        }
+        std::vector<char> data(size + 1, 0);
+        if (size > 0 && fread(&data[0], size, 1, file) != 1)
+            break;
+        // Each entry is a 0 terminated name followed by flags, blend,
+        // position, scale and rotation (7 values of 4 bytes each)
+        unsigned int pos = 0;
+        while (pos < (unsigned int)size)
+        {
+            std::string name(&data[pos]);
+            pos += (unsigned int)name.size() + 1 + 7 * 4;
+            std::replace(name.begin(), name.end(), '\\', '/');
+            if (!name.empty())
+                names->insert(StringUtils::getBasename(name));
+        }
+        break;
+    }
+    fclose(file);
+}   // readB3DTextureNames
+
+// ----------------------------------------------------------------------------
+/** Starts to decode all textures used by the b3d models in a directory
+ *  which are stored in that directory and which are not loaded yet.
+ *  \param dir The directory, must end with '/'.
+ *  \param num_threads Number of worker threads to use. With 0 threads all
+ *         textures are decoded in run() by the main thread.
+ */
+TexturePrefetcher::TexturePrefetcher(const std::string &dir, int num_threads)
+{
+    m_next_entry   = 0;
+    m_num_uploaded = 0;
+    m_abort        = false;
+    pthread_mutex_init(&m_mutex, NULL);
+
+    // The textures are created with ETCF_ALWAYS_32_BIT (see
+    // uploadDecodedTextures), for which irrlicht converts all images to
+    // A8R8G8B8 unless one of these flags is set.
+    video::IVideoDriver *driver  = irr_driver->getVideoDriver();
+    m_convert_to_32_bit =
+        !driver->getTextureCreationFlag(video::ETCF_ALWAYS_16_BIT) &&
+        !driver->getTextureCreationFlag(video::ETCF_OPTIMIZED_FOR_SPEED);
+
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir);
+    std::set<std::string> textures;
+    for (std::set<std::string>::iterator i = files.begin();
+         i != files.end(); i++)
+    {
+        if (StringUtils::getExtension(*i) == "b3d")
+            readB3DTextureNames(dir + *i, &textures);
+    }
+
+    io::IFileSystem *file_system = irr_driver->getDevice()->getFileSystem();
+    for (std::set<std::string>::iterator i = textures.begin();
+         i != textures.end(); i++)
+    {
+        // Textures that are stored somewhere else are found by irrlicht
+        // through the search path, they are not prefetched.
+        if (files.find(*i) == files.end())
+            continue;
+        Entry entry;
+        entry.m_path     = file_system->getAbsolutePath((dir + *i).c_str());
+        entry.m_image    = NULL;
+        entry.m_decoded  = false;
+        entry.m_uploaded = false;
+        if (!driver->findTexture(entry.m_path))
+            m_entries.push_back(entry);
+    }
+
+    // The entries must not be changed after this, since the workers
+    // access them.
+    for (int i = 0; i < num_threads && i < (int)m_entries.size(); i++)
+    {
+        pthread_t thread;
+        int error = pthread_create(&thread, NULL,
+                                   &TexturePrefetcher::threadMain, this);
+        if (error)
+        {
+            Log::warn("TexturePrefetcher", "Could not create thread, "
+                      "error=%d.", error);
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}   // TexturePrefetcher
+
+// ----------------------------------------------------------------------------
+/** Stops the workers and frees the images that were not uploaded. */
+TexturePrefetcher::~TexturePrefetcher()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_mutex_unlock(&m_mutex);
+    for (unsigned int i = 0; i < m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+
+    for (unsigned int i = 0; i < m_entries.size(); i++)
+    {
+        if (m_entries[i].m_image)
+            m_entries[i].m_image->drop();
+    }
+    pthread_mutex_destroy(&m_mutex);
+}   // ~TexturePrefetcher
+
+// ----------------------------------------------------------------------------
+/** The main function of the worker threads: decodes entries till all entries
+ *  are taken. */
+void *TexturePrefetcher::threadMain(void *obj)
+{
+    TexturePrefetcher *me = (TexturePrefetcher*)obj;
+    while (true)
+    {
+        pthread_mutex_lock(&me->m_mutex);
+        if (me->m_abort || me->m_next_entry >= me->m_entries.size())
+        {
+            pthread_mutex_unlock(&me->m_mutex);
+            break;
+        }
+        unsigned int index = me->m_next_entry++;
+        pthread_mutex_unlock(&me->m_mutex);
+        me->decode(index);
+    }
+    return NULL;
+}   // threadMain
+
+// ----------------------------------------------------------------------------
+/** Reads and decodes one texture. The file is mapped into memory, so that
+ *  irrlicht's file system (which is not thread safe) is not used, and the
+ *  image loader reads directly from the mapped pages.
+ *  \param index Index of the entry to decode.
+ */
+void TexturePrefetcher::decode(unsigned int index)
+{
+    Entry &entry = m_entries[index];
+    video::IImage *image = NULL;
+    MappedReadFile *file = new MappedReadFile(entry.m_path.c_str());
+    if (file->isValid())
+    {
+        LoadProfiler::addBytes(LoadProfiler::STAGE_TEXTURES, file->getSize());
+        image = irr_driver->getVideoDriver()->createImageFromFile(file);
+        if (image && m_convert_to_32_bit)
+            image = convertTo32Bit(image);
+    }
+    file->drop();
+
+    pthread_mutex_lock(&m_mutex);
+    entry.m_image   = image;
+    entry.m_decoded = true;
+    pthread_mutex_unlock(&m_mutex);
+}   // decode
+
+// ----------------------------------------------------------------------------
+/** Converts an image to A8R8G8B8, the format irrlicht uses for the texture.
+ *  Most textures are JPEG files, which are decoded to R8G8B8, so this case
+ *  is done with a simple loop instead of irrlicht's generic blitter.
+ *  \param image The image to convert, which is dropped if it is converted.
+ *  \return The converted image.
+ */
+video::IImage *TexturePrefetcher::convertTo32Bit(video::IImage *image) const
+{
+    if (image->getColorFormat() == video::ECF_A8R8G8B8)
+        return image;
+
+    const core::dimension2du &size = image->getDimension();
+    video::IImage *converted = irr_driver->getVideoDriver()
+                         ->createImage(video::ECF_A8R8G8B8, size);
+    if (!converted)
+        return image;
+
+    if (image->getColorFormat() == video::ECF_R8G8B8)
+    {
+        const unsigned char *src = (const unsigned char*)image->lock();
+        unsigned char *dst = (unsigned char*)converted->lock();
+        for (unsigned int y = 0; y < size.Height; y++)
+        {
+            const unsigned char *s = src + y * image->getPitch();
+            u32 *d = (u32*)(dst + y * converted->getPitch());
+            for (unsigned int x = 0; x < size.Width; x++, s += 3)
+                d[x] = 0xff000000 | (s[0] << 16) | (s[1] << 8) | s[2];
+        }
+        converted->unlock();
+        image->unlock();
+    }
+    else
+        image->copyTo(converted);
+
+    image->drop();
+    return converted;
+}   // convertTo32Bit
+
+// ----------------------------------------------------------------------------
+/** Creates the textures of all decoded images. Must be called by the main
+ *  thread, since it creates OpenGL textures.
+ *  \return True if all textures were handled.
+ */
+bool TexturePrefetcher::uploadDecodedTextures()
+{
+    video::IVideoDriver *driver = irr_driver->getVideoDriver();
+    for (unsigned int i = 0; i < m_entries.size(); i++)
+    {
+        Entry &entry = m_entries[i];
+        if (entry.m_uploaded)
+            continue;
+        pthread_mutex_lock(&m_mutex);
+        bool decoded = entry.m_decoded;
+        pthread_mutex_unlock(&m_mutex);
+        if (!decoded)
+            continue;
+
+        // Use the same flags the b3d loader uses for its textures
+        if (entry.m_image && !driver->findTexture(entry.m_path))
+        {
+            const bool flag_32_bit =
+                driver->getTextureCreationFlag(video::ETCF_ALWAYS_32_BIT);
+            driver->setTextureCreationFlag(video::ETCF_ALWAYS_32_BIT, true);
+            driver->addTexture(entry.m_path, entry.m_image);
+            driver->setTextureCreationFlag(video::ETCF_ALWAYS_32_BIT,
+                                           flag_32_bit);
+        }
+        if (entry.m_image)
+        {
+            entry.m_image->drop();
+            entry.m_image = NULL;
+        }
+        entry.m_uploaded = true;
+        m_num_uploaded++;
+    }
+    return m_num_uploaded == m_entries.size();
+}   // uploadDecodedTextures
+
+// ----------------------------------------------------------------------------
+/** Waits till all textures are decoded and uploads them. The main thread
+ *  decodes textures as well when there is nothing to upload, and the
+ *  loading screen shows the progress.
+ *  \param progress_start Progress shown on the loading screen before the
+ *         first texture is loaded.
+ *  \param progress_end Progress shown after the last texture was loaded.
+ */
+void TexturePrefetcher::run(float progress_start, float progress_end)
+{
+    PROFILER_PUSH_CPU_MARKER("Prefetch textures", 0x80, 0x40, 0x00);
+    while (!uploadDecodedTextures())
+    {
+        pthread_mutex_lock(&m_mutex);
+        unsigned int index = m_next_entry;
+        if (index < m_entries.size())
+            m_next_entry++;
+        pthread_mutex_unlock(&m_mutex);
+
+        if (index < m_entries.size())
+            decode(index);
+        else
+            StkTime::sleep(1);
+        GUIEngine::setLoadingProgress(progress_start
+                                      + (progress_end - progress_start)
+                                      * m_num_uploaded / m_entries.size());
+    }
+    PROFILER_POP_CPU_MARKER();
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Starts to decode the textures of a directory in the background, e.g.
+ *  the textures of the next track of a GP while the results are shown. The
+ *  track then takes the prefetcher with takePreloaded(), and only has to
+ *  upload the textures. A previous preload is cancelled.
+ *  \param dir The directory, must end with '/'.
+ *  \param num_threads Number of worker threads to use.
+ */
+void TexturePrefetcher::preload(const std::string &dir, int num_threads)
+{
+    cancelPreload();
+    // Without workers nothing would be done before the track is loaded
+    if (num_threads <= 0)
+        return;
+    m_preloaded     = new TexturePrefetcher(dir, num_threads);
+    m_preloaded_dir = dir;
+}   // preload
+
+// ----------------------------------------------------------------------------
+/** Returns the preloaded prefetcher for a directory, which the caller must
+ *  delete. A preload of a different directory is cancelled.
+ *  \param dir The directory.
+ *  \return The prefetcher, or NULL if this directory was not preloaded.
+ */
+TexturePrefetcher *TexturePrefetcher::takePreloaded(const std::string &dir)
+{
+    if (m_preloaded_dir != dir)
+    {
+        cancelPreload();
+        return NULL;
+    }
+    TexturePrefetcher *prefetcher = m_preloaded;
+    m_preloaded = NULL;
+    m_preloaded_dir.clear();
+    return prefetcher;
+}   // takePreloaded
+
+// ----------------------------------------------------------------------------
+/** Stops a preload and frees the images decoded so far. */
+void TexturePrefetcher::cancelPreload()
+{
+    delete m_preloaded;
+    m_preloaded = NULL;
+    m_preloaded_dir.clear();
+}   // cancelPreload
@@ -0,0 +1,116 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TEXTURE_PREFETCHER_HPP
+#define HEADER_TEXTURE_PREFETCHER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <irrString.h>
+#include <path.h>
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace irr
+{
+    namespace video { class IImage; }
+}
+using namespace irr;
+
+/**
+  * \brief Decodes the textures used by the models of a track on worker
+  *  threads before the models are loaded.
+  *  Decoding PNG and JPEG files takes most of the time of loading a
+  *  texture, but creating the OpenGL texture must be done by the main
+  *  thread. So the workers only create the images, and the main thread
+  *  adds them to irrlicht's texture cache in run(). When a model then
+  *  requests one of its textures, it is taken from the cache. Only the
+  *  textures listed in the b3d files of the directory are prefetched, so
+  *  no texture is loaded that would not be loaded anyway. The workers also
+  *  convert the images to the format of the textures (irrlicht creates all
+  *  of them with 32 bit), which would otherwise be done by the main thread.
+  * \ingroup graphics
+  */
+class TexturePrefetcher : public NoCopy
+{
+private:
+    struct Entry
+    {
+        /** Absolute path of the texture, which irrlicht uses as name. */
+        io::path      m_path;
+
+        /** The decoded image, NULL if decoding failed or the image was
+         *  already uploaded. */
+        video::IImage *m_image;
+
+        /** If a worker has finished this entry. */
+        bool           m_decoded;
+
+        /** If this entry was handled by the main thread. */
+        bool           m_uploaded;
+    };   // Entry
+
+    /** All textures to prefetch, the workers decode them in order. */
+    std::vector<Entry> m_entries;
+
+    /** Index of the next entry to be decoded. */
+    unsigned int m_next_entry;
+
+    /** Number of entries uploaded by the main thread. */
+    unsigned int m_num_uploaded;
+
+    /** Set to stop the workers early. */
+    bool m_abort;
+
+    /** If the workers should convert the images to the 32 bit format the
+     *  textures are created with, so that the main thread only has to copy
+     *  them. */
+    bool m_convert_to_32_bit;
+
+    /** Protects all values above that are accessed by the workers. */
+    pthread_mutex_t m_mutex;
+
+    /** The worker threads. */
+    std::vector<pthread_t> m_threads;
+
+    /** A prefetcher that was started before its track is loaded, see
+     *  preload(). */
+    static TexturePrefetcher *m_preloaded;
+
+    /** The directory of m_preloaded. */
+    static std::string        m_preloaded_dir;
+
+    static void *threadMain(void *obj);
+    void decode(unsigned int index);
+    video::IImage *convertTo32Bit(video::IImage *image) const;
+    bool uploadDecodedTextures();
+
+public:
+         TexturePrefetcher(const std::string &dir, int num_threads);
+        ~TexturePrefetcher();
+    void run(float progress_start, float progress_end);
+    static void preload(const std::string &dir, int num_threads);
+    static TexturePrefetcher *takePreloaded(const std::string &dir);
+    static void cancelPreload();
+    // ------------------------------------------------------------------------
+    /** Returns the number of textures that are prefetched. */
+    unsigned int getNumTextures() const { return (unsigned int)m_entries.size(); }
+};   // TexturePrefetcher
+
+#endif
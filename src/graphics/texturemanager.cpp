@@ -17,8 +17,15 @@
 
 #include "central_settings.hpp"
 #include "texturemanager.hpp"
+#include "config/user_config.hpp"
+#include "io/mapped_file.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <string.h>
 #include "../../lib/irrlicht/source/Irrlicht/COpenGLTexture.h"
 #include "irr_driver.hpp"
 
@@ -34,41 +41,257 @@ GLuint getDepthTexture(irr::video::ITexture *tex)
     return static_cast<irr::video::COpenGLFBOTexture*>(tex)->DepthBufferTexture;
 }
 
-static std::set<irr::video::ITexture *> AlreadyTransformedTexture;
+/** Information about a texture uploaded by compressTexture(). */
+struct TextureMemoryInfo
+{
+    /** Estimated GPU memory used by the texture, in bytes. */
+    size_t   m_bytes;
+    /** Value of texture_use_id the last time the texture was used. */
+    unsigned m_last_use;
+    /** True if the texture was reduced by evictColdTextures(). */
+    bool     m_reduced;
+    bool     m_srgb;
+    bool     m_premul_alpha;
+};   // TextureMemoryInfo
+
+/** All textures uploaded by compressTexture(). They stay uploaded across
+ *  races until they are removed from irrlicht's texture cache. */
+static std::map<irr::video::ITexture *, TextureMemoryInfo> uploaded_textures;
 static std::map<int, video::ITexture*> unicolor_cache;
+/** Estimated amount of memory used by all textures in uploaded_textures,
+ *  in bytes. */
+static size_t texture_memory_used = 0;
+/** Incremented after each race, used to find the least recently used
+ *  textures. */
+static unsigned texture_use_id = 0;
 
 void resetTextureTable()
 {
-    AlreadyTransformedTexture.clear();
     unicolor_cache.clear();
 }
 
-void compressTexture(irr::video::ITexture *tex, bool srgb, bool premul_alpha)
+//-----------------------------------------------------------------------------
+/** Forgets all uploaded textures, called when the device is recreated. */
+void clearTextureMemoryTable()
 {
-    if (AlreadyTransformedTexture.find(tex) != AlreadyTransformedTexture.end())
+    uploaded_textures.clear();
+    texture_memory_used = 0;
+}   // clearTextureMemoryTable
+
+//-----------------------------------------------------------------------------
+/** Called when a texture is removed from irrlicht's texture cache. */
+void removeTextureFromTable(irr::video::ITexture *tex)
+{
+    std::map<irr::video::ITexture *, TextureMemoryInfo>::iterator it =
+        uploaded_textures.find(tex);
+    if (it == uploaded_textures.end())
         return;
-    AlreadyTransformedTexture.insert(tex);
+    texture_memory_used -= it->second.m_bytes;
+    uploaded_textures.erase(it);
+}   // removeTextureFromTable
 
-    glBindTexture(GL_TEXTURE_2D, getTextureGLuint(tex));
+//-----------------------------------------------------------------------------
+/** Returns the estimated GPU memory used by all textures uploaded by
+ *  compressTexture(), in bytes. */
+size_t getTextureMemoryUsed()
+{
+    return texture_memory_used;
+}   // getTextureMemoryUsed
 
-    std::string cached_file;
-    if (CVS->isTextureCompressionEnabled())
+//-----------------------------------------------------------------------------
+/** Returns the number of textures uploaded by compressTexture(). */
+unsigned getUploadedTextureCount()
+{
+    return (unsigned)uploaded_textures.size();
+}   // getUploadedTextureCount
+
+//-----------------------------------------------------------------------------
+static void addTextureToTable(irr::video::ITexture *tex, size_t bytes,
+                              bool srgb, bool premul_alpha, bool reduced)
+{
+    TextureMemoryInfo info;
+    info.m_bytes        = bytes;
+    info.m_last_use     = texture_use_id;
+    info.m_reduced      = reduced;
+    info.m_srgb         = srgb;
+    info.m_premul_alpha = premul_alpha;
+    uploaded_textures[tex] = info;
+    texture_memory_used += bytes;
+}   // addTextureToTable
+
+//-----------------------------------------------------------------------------
+/** Returns the texture memory budget in bytes, or 0 if there is no limit. */
+static size_t getTextureMemoryBudget()
+{
+    int budget = UserConfigParams::m_texture_memory_budget;
+    if (budget < 0)
+        return 0;
+    if (budget == 0)
+        budget = CVS->getVideoMemory() / 2;
+    return (size_t)budget * 1024 * 1024;
+}
+
+//-----------------------------------------------------------------------------
+/** Returns the memory used by a texture including its mipmaps. */
+static size_t getTextureMemorySize(size_t w, size_t h, bool compressed, bool alpha)
+{
+    size_t bytes_per_pixel_x2 = compressed ? (alpha ? 2 : 1) : 8;
+    return w * h * bytes_per_pixel_x2 / 2 * 4 / 3;
+}
+
+//-----------------------------------------------------------------------------
+/** Halves the size of an image with a box filter. The data is replaced in
+ *  place, odd rows or columns are dropped.
+ *  \param channels Number of bytes per pixel, as read by glTexImage2D.
+ */
+static void halveImage(unsigned char *data, size_t &w, size_t &h, unsigned channels)
+{
+    size_t new_w = w / 2, new_h = h / 2;
+    for (size_t y = 0; y < new_h; y++)
     {
-        // Try to retrieve the compressed texture in cache
-        std::string tex_name = irr_driver->getTextureName(tex);
-        if (!tex_name.empty()) {
-            cached_file = file_manager->getTextureCacheLocation(tex_name) + ".gltz";
-            if (!file_manager->fileIsNewer(tex_name, cached_file)) {
-                if (loadCompressedTexture(cached_file))
-                    return;
+        const unsigned char *row0 = data + (2 * y) * w * channels;
+        const unsigned char *row1 = row0 + w * channels;
+        for (size_t x = 0; x < new_w; x++)
+        {
+            for (unsigned c = 0; c < channels; c++)
+            {
+                size_t i = 2 * x * channels + c;
+                unsigned sum = row0[i] + row0[i + channels] +
+                               row1[i] + row1[i + channels];
+                data[(y * new_w + x) * channels + c] = (unsigned char)((sum + 2) / 4);
             }
         }
     }
+    w = new_w;
+    h = new_h;
+}
 
-    size_t w = tex->getSize().Width, h = tex->getSize().Height;
+//-----------------------------------------------------------------------------
+/** Uploads the pre-baked S3TC version of a texture. It is created by
+ *  data/optimize_data.sh as a DDS file next to the texture and contains all
+ *  mipmap levels, so the driver does not need to compress the texture.
+ *  The biggest levels are skipped if they are bigger than the irrlicht
+ *  texture (i.e. if the texture was resized) or than the memory budget.
+ *  \param tex_name File name of the texture.
+ *  \param srgb If the texture is in sRGB colour space.
+ *  \param alpha If the texture has an alpha channel.
+ *  \param w, h Size of the texture, set to the size that was uploaded.
+ *  \param max_size Maximum memory the texture should use.
+ *  \return True if the texture was uploaded.
+ */
+static bool loadPrebakedTexture(const std::string &tex_name, bool srgb,
+                                bool alpha, size_t &w, size_t &h,
+                                size_t max_size)
+{
+    const std::string dds_name =
+        StringUtils::removeExtension(tex_name) + ".dds";
+    if (!file_manager->fileExists(dds_name) ||
+        file_manager->fileIsNewer(tex_name, dds_name))
+        return false;
+
+    // The levels are uploaded directly from the mapped file
+    MappedFile file(dds_name);
+    // Magic number and DDS_HEADER
+    uint32_t header[32];
+    if (!file.isValid() || file.getSize() < sizeof(header))
+        return false;
+    memcpy(header, file.getData(), sizeof(header));
+    if (header[0] != 0x20534444 /* "DDS " */ || header[1] != 124)
+        return false;
+
+    const uint32_t four_cc = header[21];
+    size_t block_size;
+    GLenum internal_format;
+    if (four_cc == 0x31545844 /* "DXT1" */ && !alpha)
+    {
+        block_size = 8;
+        internal_format = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                               : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+    else if (four_cc == 0x35545844 /* "DXT5" */ && alpha)
+    {
+        block_size = 16;
+        internal_format = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                               : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    else
+    {
+        Log::warn("TextureManager", "Pre-baked texture '%s' has an "
+                  "unsupported format, ignored.", dds_name.c_str());
+        return false;
+    }
+    // DDSD_MIPMAPCOUNT
+    const unsigned levels = (header[2] & 0x20000) && header[7] > 0
+                          ? header[7] : 1;
+
+    const char *data = file.getData() + sizeof(header);
+    const size_t data_size = file.getSize() - sizeof(header);
+
+    size_t level_w = header[4], level_h = header[3], offset = 0;
+    unsigned first = 0;
+    // Skip the levels that are too big
+    while (first + 1 < levels &&
+           (level_w > w || level_h > h ||
+            (level_w >= 256 && level_h >= 256 &&
+             getTextureMemorySize(level_w, level_h, true, alpha) > max_size)))
+    {
+        offset += ((level_w + 3) / 4) * ((level_h + 3) / 4) * block_size;
+        level_w = std::max<size_t>(level_w / 2, 1);
+        level_h = std::max<size_t>(level_h / 2, 1);
+        first++;
+    }
+
+    // Check that the file contains all remaining levels before uploading
+    size_t end = offset, level_end_w = level_w, level_end_h = level_h;
+    for (unsigned i = first; i < levels; i++)
+    {
+        end += ((level_end_w + 3) / 4) * ((level_end_h + 3) / 4) * block_size;
+        level_end_w = std::max<size_t>(level_end_w / 2, 1);
+        level_end_h = std::max<size_t>(level_end_h / 2, 1);
+    }
+    if (end > data_size)
+        return false;
+
+    w = level_w;
+    h = level_h;
+    for (unsigned i = first; i < levels; i++)
+    {
+        const size_t size = ((level_w + 3) / 4) * ((level_h + 3) / 4) *
+                            block_size;
+        glCompressedTexImage2D(GL_TEXTURE_2D, i - first, internal_format,
+                               level_w, level_h, 0, size, data + offset);
+        offset += size;
+        level_w = std::max<size_t>(level_w / 2, 1);
+        level_h = std::max<size_t>(level_h / 2, 1);
+    }
+    if (levels - first > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - first - 1);
+    else
+        glGenerateMipmap(GL_TEXTURE_2D);
+    return true;
+}   // loadPrebakedTexture
+
+//-----------------------------------------------------------------------------
+/** Uploads the image of an irrlicht texture into the currently bound
+ *  texture, reducing it until it uses at most max_size bytes (but never
+ *  below 128 pixels).
+ *  \param w, h Size of the texture, set to the size that was uploaded.
+ *  \return The memory used by the texture.
+ */
+static size_t uploadTextureImage(irr::video::ITexture *tex, bool srgb,
+                                 bool premul_alpha, size_t max_size,
+                                 size_t &w, size_t &h)
+{
     unsigned char *data = new unsigned char[w * h * 4];
     memcpy(data, tex->lock(), w * h * 4);
     tex->unlock();
+
+    while (w >= 256 && h >= 256 &&
+           getTextureMemorySize(w, h, CVS->isTextureCompressionEnabled(), tex->hasAlpha()) > max_size)
+    {
+        halveImage(data, w, h, tex->hasAlpha() ? 4 : 3);
+    }
+
     unsigned internalFormat, Format;
     if (tex->hasAlpha())
         Format = GL_BGRA;
@@ -103,8 +326,130 @@ void compressTexture(irr::video::ITexture *tex, bool srgb, bool premul_alpha)
             internalFormat = (tex->hasAlpha()) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
     }
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, Format, GL_UNSIGNED_BYTE, (GLvoid *)data);
+    // A pre-baked texture might have set a maximum level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
     glGenerateMipmap(GL_TEXTURE_2D);
     delete[] data;
+    return getTextureMemorySize(w, h, CVS->isTextureCompressionEnabled(), tex->hasAlpha());
+}   // uploadTextureImage
+
+//-----------------------------------------------------------------------------
+/** Reduces the least recently used textures until the texture memory fits
+ *  in the budget again. Called at the end of each race, textures used in
+ *  that race are not reduced. The textures are kept (at 1/16 of their
+ *  memory) since other code might still use them, they are uploaded at full
+ *  resolution again by compressTexture() the next time they are used.
+ */
+void evictColdTextures()
+{
+    const size_t budget = getTextureMemoryBudget();
+    if (budget > 0 && texture_memory_used > budget)
+    {
+        std::vector<std::pair<unsigned, irr::video::ITexture*> > cold;
+        std::map<irr::video::ITexture *, TextureMemoryInfo>::iterator it;
+        for (it = uploaded_textures.begin(); it != uploaded_textures.end(); it++)
+        {
+            if (!it->second.m_reduced && it->second.m_last_use < texture_use_id)
+                cold.push_back(std::make_pair(it->second.m_last_use, it->first));
+        }
+        std::sort(cold.begin(), cold.end());
+
+        unsigned count = 0;
+        for (unsigned i = 0; i < cold.size() && texture_memory_used > budget; i++)
+        {
+            irr::video::ITexture *tex = cold[i].second;
+            TextureMemoryInfo &info = uploaded_textures[tex];
+            size_t w = tex->getSize().Width, h = tex->getSize().Height;
+            glBindTexture(GL_TEXTURE_2D, getTextureGLuint(tex));
+            const size_t bytes = uploadTextureImage(tex, info.m_srgb,
+                info.m_premul_alpha, info.m_bytes / 16, w, h);
+            texture_memory_used -= info.m_bytes;
+            texture_memory_used += bytes;
+            info.m_bytes   = bytes;
+            info.m_reduced = true;
+            count++;
+        }
+        Log::info("TextureManager", "Reduced %d unused textures, %d MB of "
+                  "textures are uploaded.", count,
+                  (int)(texture_memory_used / (1024 * 1024)));
+    }
+    texture_use_id++;
+}   // evictColdTextures
+
+//-----------------------------------------------------------------------------
+void compressTexture(irr::video::ITexture *tex, bool srgb, bool premul_alpha)
+{
+    std::map<irr::video::ITexture *, TextureMemoryInfo>::iterator it =
+        uploaded_textures.find(tex);
+    if (it != uploaded_textures.end())
+    {
+        it->second.m_last_use = texture_use_id;
+        if (!it->second.m_reduced)
+            return;
+        // Upload it at full resolution again
+        removeTextureFromTable(tex);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, getTextureGLuint(tex));
+
+    size_t w = tex->getSize().Width, h = tex->getSize().Height;
+    const size_t budget = getTextureMemoryBudget();
+    const bool over_budget = budget > 0 &&
+        texture_memory_used + getTextureMemorySize(w, h, CVS->isTextureCompressionEnabled(), tex->hasAlpha()) > budget;
+
+    std::string tex_name = irr_driver->getTextureName(tex);
+    // Pre-baked textures contain all mipmaps, so they can be used (at a lower
+    // resolution) even if the texture is over the budget. They are not
+    // premultiplied, so they can not be used for premultiplied textures.
+    if (CVS->isTextureCompressionEnabled() && !premul_alpha && !tex_name.empty())
+    {
+        size_t max_size = (size_t)-1;
+        if (over_budget)
+            max_size = budget > texture_memory_used ? budget - texture_memory_used : 0;
+        if (loadPrebakedTexture(tex_name, srgb, tex->hasAlpha(), w, h, max_size))
+        {
+            addTextureToTable(tex, getTextureMemorySize(w, h, true, tex->hasAlpha()),
+                              srgb, premul_alpha, false);
+            return;
+        }
+    }
+
+    std::string cached_file;
+    // The cache contains the full resolution texture, it is skipped if the
+    // texture has to be reduced
+    if (CVS->isTextureCompressionEnabled() && !over_budget)
+    {
+        // Try to retrieve the compressed texture in cache
+        if (!tex_name.empty()) {
+            cached_file = file_manager->getTextureCacheLocation(tex_name) + ".gltz";
+            if (!file_manager->fileIsNewer(tex_name, cached_file)) {
+                if (loadCompressedTexture(cached_file))
+                {
+                    addTextureToTable(tex, getTextureMemorySize(w, h, true, tex->hasAlpha()),
+                                      srgb, premul_alpha, false);
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t max_size = (size_t)-1;
+    if (over_budget)
+    {
+        // Drop the highest mipmap levels until the texture fits in the
+        // budget, but never below 128 pixels
+        max_size = budget > texture_memory_used ? budget - texture_memory_used : 0;
+        // A reduced texture must not replace the full one in the cache
+        cached_file.clear();
+    }
+    const size_t bytes = uploadTextureImage(tex, srgb, premul_alpha, max_size, w, h);
+    addTextureToTable(tex, bytes, srgb, premul_alpha, false);
+    if (over_budget)
+    {
+        Log::debug("TextureManager", "Texture memory budget exceeded, '%s' "
+                   "loaded at %dx%d.", irr_driver->getTextureName(tex).c_str(),
+                   (int)w, (int)h);
+    }
 
     if (CVS->isTextureCompressionEnabled() && !cached_file.empty())
     {
@@ -122,34 +467,23 @@ void compressTexture(irr::video::ITexture *tex, bool srgb, bool premul_alpha)
 */
 bool loadCompressedTexture(const std::string& compressed_tex)
 {
-    std::ifstream ifs(compressed_tex.c_str(), std::ios::in | std::ios::binary);
-    if (!ifs.is_open())
+    // The data is passed to GL directly from the mapped file
+    MappedFile file(compressed_tex);
+    if (!file.isValid() || file.getSize() < 4 * sizeof(int))
         return false;
 
-    int internal_format;
-    int w, h;
-    int size = -1;
-    ifs.read((char*)&internal_format, sizeof(int));
-    ifs.read((char*)&w, sizeof(int));
-    ifs.read((char*)&h, sizeof(int));
-    ifs.read((char*)&size, sizeof(int));
+    int header[4];
+    memcpy(header, file.getData(), sizeof(header));
+    const int internal_format = header[0];
+    const int w = header[1], h = header[2], size = header[3];
 
-    if (ifs.fail() || size == -1)
+    if (size <= 0 || (size_t)size > file.getSize() - sizeof(header))
         return false;
 
-    char *data = new char[size];
-    ifs.read(data, size);
-    if (!ifs.fail())
-    {
-        glCompressedTexImage2D(GL_TEXTURE_2D, 0, internal_format,
-            w, h, 0, size, (GLvoid*)data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        delete[] data;
-        ifs.close();
-        return true;
-    }
-    delete[] data;
-    return false;
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, internal_format,
+        w, h, 0, size, (GLvoid*)(file.getData() + sizeof(header)));
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return true;
 }
 
 //-----------------------------------------------------------------------------
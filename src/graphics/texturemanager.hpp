@@ -26,6 +26,11 @@
 GLuint getTextureGLuint(irr::video::ITexture *tex);
 GLuint getDepthTexture(irr::video::ITexture *tex);
 void resetTextureTable();
+void clearTextureMemoryTable();
+void removeTextureFromTable(irr::video::ITexture *tex);
+void evictColdTextures();
+size_t getTextureMemoryUsed();
+unsigned getUploadedTextureCount();
 void compressTexture(irr::video::ITexture *tex, bool srgb, bool premul_alpha = false);
 bool loadCompressedTexture(const std::string& compressed_tex);
 void saveCompressedTexture(const std::string& compressed_tex);
@@ -20,6 +20,7 @@
 #include "stkmesh.hpp"
 #include "glwrap.hpp"
 #include "central_settings.hpp"
+#include "utils/time.hpp"
 
 VAOManager::VAOManager()
 {
@@ -34,22 +35,90 @@ VAOManager::VAOManager()
         RealIBOSize[i] = 0;
     }
 
+    for (unsigned i = 0; i < INSTANCE_REGION_COUNT; i++)
+        region_fence[i] = 0;
+    current_region = 0;
+
+    // All instance buffers have the size needed for the biggest instances
+    const size_t instance_buffer_size = getInstanceRegionCount() * INSTANCE_REGION_SIZE * sizeof(InstanceDataThreeTex);
     for (unsigned i = 0; i < InstanceTypeCount; i++)
     {
         glGenBuffers(1, &instance_vbo[i]);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[i]);
         if (CVS->supportsAsyncInstanceUpload())
         {
-            glBufferStorage(GL_ARRAY_BUFFER, 10000 * sizeof(InstanceDataDualTex), 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-            Ptr[i] = glMapBufferRange(GL_ARRAY_BUFFER, 0, 10000 * sizeof(InstanceDataDualTex), GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+            glBufferStorage(GL_ARRAY_BUFFER, instance_buffer_size, 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+            Ptr[i] = glMapBufferRange(GL_ARRAY_BUFFER, 0, instance_buffer_size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
         }
         else
         {
-            glBufferData(GL_ARRAY_BUFFER, 10000 * sizeof(InstanceDataDualTex), 0, GL_STREAM_DRAW);
+            glBufferData(GL_ARRAY_BUFFER, instance_buffer_size, 0, GL_STREAM_DRAW);
         }
     }
 }
 
+/** Returns the number of regions the instance and command buffers are split
+ *  in. Without persistent mapping the buffers are orphaned when they are
+ *  mapped, so one region is enough. */
+unsigned VAOManager::getInstanceRegionCount()
+{
+    return CVS->supportsAsyncInstanceUpload() ? INSTANCE_REGION_COUNT : 1;
+}
+
+/** Waits (at most about 1 second) until the GPU has passed a fence. */
+static void waitForFence(GLsync fence)
+{
+    GLenum reason = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    unsigned waited = 0;
+    while (reason != GL_ALREADY_SIGNALED && reason != GL_CONDITION_SATISFIED)
+    {
+        if (reason == GL_WAIT_FAILED || waited++ > 1000)
+            break;
+        StkTime::sleep(1);
+        reason = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    }
+}
+
+/** Switches to the next region of the instance and command buffers, and
+ *  waits until the GPU is done with the draws that last used it. With three
+ *  regions this is the frame before the previous one, which has normally
+ *  finished long ago, so the CPU hardly ever stalls.
+ *  \return The index of the region to fill.
+ */
+unsigned VAOManager::startInstanceRegion()
+{
+    current_region = (current_region + 1) % getInstanceRegionCount();
+    GLsync &fence = region_fence[current_region];
+    if (fence)
+    {
+        waitForFence(fence);
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    return current_region;
+}
+
+/** Waits until the GPU is done with the previous frame. This is needed
+ *  before data that is not triple buffered (e.g. the vertices of meshes
+ *  skinned on the CPU) is overwritten in a persistently mapped buffer.
+ */
+void VAOManager::waitForPreviousRegion()
+{
+    const unsigned count = getInstanceRegionCount();
+    const GLsync fence = region_fence[(current_region + count - 1) % count];
+    if (fence)
+        waitForFence(fence);
+}
+
+/** Inserts the fence of the current region after the last draw call that
+ *  uses its instances. */
+void VAOManager::fenceInstanceRegion()
+{
+    if (region_fence[current_region])
+        glDeleteSync(region_fence[current_region]);
+    region_fence[current_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
 void VAOManager::cleanInstanceVAOs()
 {
     std::map<std::pair<video::E_VERTEX_TYPE, InstanceType>, GLuint>::iterator It = InstanceVAO.begin(), E = InstanceVAO.end();
@@ -63,6 +132,9 @@ VAOManager::~VAOManager()
     cleanInstanceVAOs();
     for (unsigned i = 0; i < VTXTYPE_COUNT; i++)
     {
+        std::unordered_map<scene::IMeshBuffer*, BufferRange>::iterator It;
+        for (It = mappedRange[i].begin(); It != mappedRange[i].end(); It++)
+            It->first->drop();
         if (vbo[i])
             glDeleteBuffers(1, &vbo[i]);
         if (ibo[i])
@@ -74,46 +146,160 @@ VAOManager::~VAOManager()
     {
         glDeleteBuffers(1, &instance_vbo[i]);
     }
+    for (unsigned i = 0; i < INSTANCE_REGION_COUNT; i++)
+    {
+        if (region_fence[i])
+            glDeleteSync(region_fence[i]);
+    }
 
 }
 
-static void
-resizeBufferIfNecessary(size_t &lastIndex, size_t newLastIndex, size_t bufferSize, size_t stride, GLenum type, GLuint &id, void *&Pointer)
+/** Initial size of the buffers (in vertices, and indices). The buffers are
+ *  reserved with this size when they are used first, so that loading a track
+ *  does not make them grow many times. */
+static const size_t INITIAL_VERTEX_COUNT = 65536;
+static const size_t INITIAL_INDEX_COUNT  = 3 * 65536;
+
+/** Makes sure that a buffer can store \p used elements. If not, a new
+ *  buffer of at least twice the size is created and the old data copied.
+ *  \return True if a new buffer was created.
+ */
+static bool
+resizeBufferIfNecessary(size_t used, size_t &bufferSize, size_t initialSize, size_t stride, GLenum type, GLuint &id, void *&Pointer)
 {
-    if (newLastIndex * stride >= bufferSize)
+    if (id && used <= bufferSize)
+        return false;
+
+    size_t oldSize = bufferSize;
+    if (bufferSize < initialSize)
+        bufferSize = initialSize;
+    while (used > bufferSize)
+        bufferSize *= 2;
+
+    GLuint newVBO;
+    glGenBuffers(1, &newVBO);
+    glBindBuffer(type, newVBO);
+    if (CVS->supportsAsyncInstanceUpload())
     {
-        while (newLastIndex >= bufferSize)
-            bufferSize = 2 * bufferSize + 1;
-        GLuint newVBO;
-        glGenBuffers(1, &newVBO);
-        glBindBuffer(type, newVBO);
-        if (CVS->supportsAsyncInstanceUpload())
-        {
-            glBufferStorage(type, bufferSize *stride, 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-            Pointer = glMapBufferRange(type, 0, bufferSize * stride, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-        }
-        else
-            glBufferData(type, bufferSize * stride, 0, GL_DYNAMIC_DRAW);
+        glBufferStorage(type, bufferSize *stride, 0, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+        Pointer = glMapBufferRange(type, 0, bufferSize * stride, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+    }
+    else
+        glBufferData(type, bufferSize * stride, 0, GL_DYNAMIC_DRAW);
+
+    if (id)
+    {
+        // Copy old data
+        GLuint oldVBO = id;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize * stride);
+        glDeleteBuffers(1, &oldVBO);
+    }
+    id = newVBO;
+    return true;
+}
 
-        if (id)
+/** Returns the first element of a free range with at least \p count
+ *  elements and removes it from the free list, or returns the end of the
+ *  used part of the buffer (and moves the end) if there is none.
+ */
+static size_t allocateRange(std::map<size_t, size_t> &freeList, size_t &last, size_t count)
+{
+    std::map<size_t, size_t>::iterator It;
+    for (It = freeList.begin(); It != freeList.end(); It++)
+    {
+        if (It->second < count)
+            continue;
+        size_t first = It->first;
+        size_t remaining = It->second - count;
+        freeList.erase(It);
+        if (remaining > 0)
+            freeList[first + count] = remaining;
+        return first;
+    }
+    size_t first = last;
+    last += count;
+    return first;
+}
+
+/** Returns a range to the free list and merges it with adjacent free
+ *  ranges. A range at the end of the used part just moves the end. */
+static void freeRange(std::map<size_t, size_t> &freeList, size_t &last, size_t first, size_t count)
+{
+    if (count == 0)
+        return;
+    std::map<size_t, size_t>::iterator Next = freeList.lower_bound(first);
+    if (Next != freeList.begin())
+    {
+        std::map<size_t, size_t>::iterator Prev = Next;
+        Prev--;
+        if (Prev->first + Prev->second == first)
         {
-            // Copy old data
-            GLuint oldVBO = id;
-            glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
-            glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
-            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, lastIndex * stride);
-            glDeleteBuffers(1, &oldVBO);
+            first = Prev->first;
+            count += Prev->second;
+            freeList.erase(Prev);
         }
-        id = newVBO;
     }
-    lastIndex = newLastIndex;
+    if (Next != freeList.end() && first + count == Next->first)
+    {
+        count += Next->second;
+        freeList.erase(Next);
+    }
+    if (first + count == last)
+        last = first;
+    else
+        freeList[first] = count;
+}
+
+/** Returns true if a range of \p count elements can be allocated without
+ *  growing the buffer. */
+static bool hasSpace(const std::map<size_t, size_t> &freeList, size_t last, size_t bufferSize, size_t count)
+{
+    if (last + count <= bufferSize)
+        return true;
+    std::map<size_t, size_t>::const_iterator It;
+    for (It = freeList.begin(); It != freeList.end(); It++)
+    {
+        if (It->second >= count)
+            return true;
+    }
+    return false;
 }
 
-void VAOManager::regenerateBuffer(enum VTXTYPE tp, size_t newlastvertex, size_t newlastindex)
+/** Makes sure the buffers of a vertex type store all vertices and indices
+ *  up to last_vertex and last_index.
+ *  \return True if a buffer was recreated, i.e. the VAOs need to be
+ *          updated.
+ */
+bool VAOManager::regenerateBuffer(enum VTXTYPE tp)
 {
     glBindVertexArray(0);
-    resizeBufferIfNecessary(last_vertex[tp], newlastvertex, RealVBOSize[tp], getVertexPitch(tp), GL_ARRAY_BUFFER, vbo[tp], VBOPtr[tp]);
-    resizeBufferIfNecessary(last_index[tp], newlastindex, RealIBOSize[tp], sizeof(u16), GL_ELEMENT_ARRAY_BUFFER, ibo[tp], IBOPtr[tp]);
+    bool resized = resizeBufferIfNecessary(last_vertex[tp], RealVBOSize[tp], INITIAL_VERTEX_COUNT, getVertexPitch(tp), GL_ARRAY_BUFFER, vbo[tp], VBOPtr[tp]);
+    resized |= resizeBufferIfNecessary(last_index[tp], RealIBOSize[tp], INITIAL_INDEX_COUNT, sizeof(u16), GL_ELEMENT_ARRAY_BUFFER, ibo[tp], IBOPtr[tp]);
+    return resized;
+}
+
+/** Frees the ranges of all mesh buffers that are not used by anything else
+ *  anymore (e.g. meshes of a kart shown in a menu), so that they can be
+ *  reused before the buffers are made bigger.
+ */
+void VAOManager::releaseUnusedRanges(VTXTYPE tp)
+{
+    std::unordered_map<scene::IMeshBuffer*, BufferRange>::iterator It = mappedRange[tp].begin();
+    while (It != mappedRange[tp].end())
+    {
+        if (It->first->getReferenceCount() > 1)
+        {
+            It++;
+            continue;
+        }
+        const BufferRange &range = It->second;
+        freeRange(free_vertices[tp], last_vertex[tp], range.first_vertex, range.vertex_count);
+        freeRange(free_indices[tp], last_index[tp], range.first_index, range.index_count);
+        It->first->drop();
+        It = mappedRange[tp].erase(It);
+    }
 }
 
 void VAOManager::regenerateVAO(enum VTXTYPE tp)
@@ -168,6 +354,9 @@ void VAOInstanceUtil<InstanceDataDualTex>::SetVertexAttrib()
     glEnableVertexAttribArray(11);
     glVertexAttribIPointer(11, 2, GL_UNSIGNED_INT, sizeof(InstanceDataDualTex), (GLvoid*)(9 * sizeof(float) + 2 * sizeof(unsigned)));
     glVertexAttribDivisorARB(11, 1);
+    glEnableVertexAttribArray(14);
+    glVertexAttribPointer(14, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceDataDualTex), (GLvoid*)(9 * sizeof(float) + 4 * sizeof(unsigned)));
+    glVertexAttribDivisorARB(14, 1);
 }
 
 template<>
@@ -183,6 +372,9 @@ void VAOInstanceUtil<InstanceDataThreeTex>::SetVertexAttrib()
     glEnableVertexAttribArray(13);
     glVertexAttribIPointer(13, 2, GL_UNSIGNED_INT, sizeof(InstanceDataThreeTex), (GLvoid*)(9 * sizeof(float) + 4 * sizeof(unsigned)));
     glVertexAttribDivisorARB(13, 1);
+    glEnableVertexAttribArray(14);
+    glVertexAttribPointer(14, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceDataThreeTex), (GLvoid*)(9 * sizeof(float) + 6 * sizeof(unsigned)));
+    glVertexAttribDivisorARB(14, 1);
 }
 
 template<>
@@ -282,53 +474,66 @@ irr::video::E_VERTEX_TYPE VAOManager::getVertexType(enum VTXTYPE tp)
     }
 }
 
-void VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
+/** Copies a mesh buffer into the buffers of its vertex type.
+ *  \return True if a buffer was recreated.
+ */
+bool VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
 {
-    size_t old_vtx_cnt = last_vertex[tp];
-    size_t old_idx_cnt = last_index[tp];
+    size_t vtx_cnt = mb->getVertexCount();
+    size_t idx_cnt = mb->getIndexCount();
+    if (!hasSpace(free_vertices[tp], last_vertex[tp], RealVBOSize[tp], vtx_cnt) ||
+        !hasSpace(free_indices[tp], last_index[tp], RealIBOSize[tp], idx_cnt))
+        releaseUnusedRanges(tp);
+
+    BufferRange range;
+    range.first_vertex = allocateRange(free_vertices[tp], last_vertex[tp], vtx_cnt);
+    range.vertex_count = vtx_cnt;
+    range.first_index = allocateRange(free_indices[tp], last_index[tp], idx_cnt);
+    range.index_count = idx_cnt;
+    bool resized = regenerateBuffer(tp);
 
-    regenerateBuffer(tp, old_vtx_cnt + mb->getVertexCount(), old_idx_cnt + mb->getIndexCount());
     if (CVS->supportsAsyncInstanceUpload())
     {
-        void *tmp = (char*)VBOPtr[tp] + old_vtx_cnt * getVertexPitch(tp);
-        memcpy(tmp, mb->getVertices(), mb->getVertexCount() * getVertexPitch(tp));
+        void *tmp = (char*)VBOPtr[tp] + range.first_vertex * getVertexPitch(tp);
+        memcpy(tmp, mb->getVertices(), vtx_cnt * getVertexPitch(tp));
     }
     else
     {
         glBindBuffer(GL_ARRAY_BUFFER, vbo[tp]);
-        glBufferSubData(GL_ARRAY_BUFFER, old_vtx_cnt * getVertexPitch(tp), mb->getVertexCount() * getVertexPitch(tp), mb->getVertices());
+        glBufferSubData(GL_ARRAY_BUFFER, range.first_vertex * getVertexPitch(tp), vtx_cnt * getVertexPitch(tp), mb->getVertices());
     }
     if (CVS->supportsAsyncInstanceUpload())
     {
-        void *tmp = (char*)IBOPtr[tp] + old_idx_cnt * sizeof(u16);
-        memcpy(tmp, mb->getIndices(), mb->getIndexCount() * sizeof(u16));
+        void *tmp = (char*)IBOPtr[tp] + range.first_index * sizeof(u16);
+        memcpy(tmp, mb->getIndices(), idx_cnt * sizeof(u16));
     }
     else
     {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo[tp]);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, old_idx_cnt * sizeof(u16), mb->getIndexCount() * sizeof(u16), mb->getIndices());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.first_index * sizeof(u16), idx_cnt * sizeof(u16), mb->getIndices());
     }
 
-    mappedBaseVertex[tp][mb] = old_vtx_cnt;
-    mappedBaseIndex[tp][mb] = old_idx_cnt * sizeof(u16);
+    mb->grab();
+    mappedRange[tp][mb] = range;
+    return resized;
 }
 
 std::pair<unsigned, unsigned> VAOManager::getBase(scene::IMeshBuffer *mb)
 {
     VTXTYPE tp = getVTXTYPE(mb->getVertexType());
-    if (mappedBaseVertex[tp].find(mb) == mappedBaseVertex[tp].end())
+    std::unordered_map<scene::IMeshBuffer*, BufferRange>::iterator It;
+    It = mappedRange[tp].find(mb);
+    if (It == mappedRange[tp].end())
     {
-        assert(mappedBaseIndex[tp].find(mb) == mappedBaseIndex[tp].end());
-        append(mb, tp);
-        regenerateVAO(tp);
-        regenerateInstancedVAO();
+        // The VAOs only need to be rebuilt if the buffers changed
+        if (append(mb, tp))
+        {
+            regenerateVAO(tp);
+            regenerateInstancedVAO();
+        }
+        It = mappedRange[tp].find(mb);
     }
-
-    std::unordered_map<scene::IMeshBuffer*, unsigned>::iterator It;
-    It = mappedBaseVertex[tp].find(mb);
-    assert(It != mappedBaseVertex[tp].end());
-    unsigned vtx = It->second;
-    It = mappedBaseIndex[tp].find(mb);
-    assert(It != mappedBaseIndex[tp].end());
-    return std::pair<unsigned, unsigned>(vtx, It->second);
+    assert(It != mappedRange[tp].end());
+    return std::pair<unsigned, unsigned>((unsigned)It->second.first_vertex,
+                                         (unsigned)(It->second.first_index * sizeof(u16)));
 }
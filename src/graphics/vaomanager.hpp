@@ -36,6 +36,13 @@ enum InstanceType
     InstanceTypeCount,
 };
 
+/** Number of instances (and draw commands) one pass can use in one frame. */
+static const unsigned INSTANCE_REGION_SIZE = 10000;
+/** With persistently mapped buffers the instance and command buffers are
+ *  split in this many regions, one per frame, so that the CPU can fill a
+ *  region while the GPU still reads the ones of the previous frames. */
+static const unsigned INSTANCE_REGION_COUNT = 3;
+
 #ifdef WIN32
 #pragma pack(push, 1)
 #endif
@@ -88,6 +95,12 @@ struct InstanceDataDualTex
     } Scale;
     uint64_t Texture;
     uint64_t SecondTexture;
+    /** Translation of the texture coordinates, for animated textures. */
+    struct
+    {
+        float X;
+        float Y;
+    } TexcoordOffset;
 #ifdef WIN32
 };
 #else
@@ -117,6 +130,12 @@ struct InstanceDataThreeTex
     uint64_t Texture;
     uint64_t SecondTexture;
     uint64_t ThirdTexture;
+    /** Translation of the texture coordinates, for animated textures. */
+    struct
+    {
+        float X;
+        float Y;
+    } TexcoordOffset;
 #ifdef WIN32
 };
 #else
@@ -156,23 +175,43 @@ struct GlowInstanceData
 class VAOManager : public Singleton<VAOManager>
 {
     enum VTXTYPE { VTXTYPE_STANDARD, VTXTYPE_TCOORD, VTXTYPE_TANGENT, VTXTYPE_COUNT };
+
+    /** The part of the vertex and index buffer used by one mesh buffer,
+     *  in vertices and indices. */
+    struct BufferRange
+    {
+        size_t first_vertex, vertex_count;
+        size_t first_index, index_count;
+    };
+    /** Unused parts of a buffer, mapping the first element to the number
+     *  of elements. Adjacent free ranges are always merged. */
+    typedef std::map<size_t, size_t> FreeList;
+
     GLuint vbo[VTXTYPE_COUNT], ibo[VTXTYPE_COUNT], vao[VTXTYPE_COUNT];
     GLuint instance_vbo[InstanceTypeCount];
     void *Ptr[InstanceTypeCount];
     void *VBOPtr[VTXTYPE_COUNT], *IBOPtr[VTXTYPE_COUNT];
     size_t RealVBOSize[VTXTYPE_COUNT], RealIBOSize[VTXTYPE_COUNT];
     size_t last_vertex[VTXTYPE_COUNT], last_index[VTXTYPE_COUNT];
-    std::unordered_map<irr::scene::IMeshBuffer*, unsigned> mappedBaseVertex[VTXTYPE_COUNT], mappedBaseIndex[VTXTYPE_COUNT];
+    FreeList free_vertices[VTXTYPE_COUNT], free_indices[VTXTYPE_COUNT];
+    /** The mesh buffers stored in the buffers. Each one is grabbed, so that
+     *  its range can be reused once nothing else uses the mesh buffer. */
+    std::unordered_map<irr::scene::IMeshBuffer*, BufferRange> mappedRange[VTXTYPE_COUNT];
     std::map<std::pair<irr::video::E_VERTEX_TYPE, InstanceType>, GLuint> InstanceVAO;
+    /** Signaled once the GPU is done with the instances of each region. */
+    GLsync region_fence[INSTANCE_REGION_COUNT];
+    /** The region the instances of the current frame are written to. */
+    unsigned current_region;
 
     void cleanInstanceVAOs();
-    void regenerateBuffer(enum VTXTYPE, size_t, size_t);
+    bool regenerateBuffer(enum VTXTYPE);
     void regenerateVAO(enum VTXTYPE);
     void regenerateInstancedVAO();
     size_t getVertexPitch(enum VTXTYPE) const;
     VTXTYPE getVTXTYPE(irr::video::E_VERTEX_TYPE type);
     irr::video::E_VERTEX_TYPE getVertexType(enum VTXTYPE tp);
-    void append(irr::scene::IMeshBuffer *, VTXTYPE tp);
+    bool append(irr::scene::IMeshBuffer *, VTXTYPE tp);
+    void releaseUnusedRanges(VTXTYPE tp);
 public:
     VAOManager();
     std::pair<unsigned, unsigned> getBase(irr::scene::IMeshBuffer *);
@@ -182,6 +221,12 @@ public:
     void *getVBOPtr(irr::video::E_VERTEX_TYPE type) { return VBOPtr[getVTXTYPE(type)]; }
     unsigned getVAO(irr::video::E_VERTEX_TYPE type) { return vao[getVTXTYPE(type)]; }
     unsigned getInstanceVAO(irr::video::E_VERTEX_TYPE vt, enum InstanceType it) { return InstanceVAO[std::pair<irr::video::E_VERTEX_TYPE, InstanceType>(vt, it)]; }
+    static unsigned getInstanceRegionCount();
+    unsigned startInstanceRegion();
+    void waitForPreviousRegion();
+    void fenceInstanceRegion();
+    /** Returns the index of the first instance of the current region. */
+    size_t getInstanceRegionBase() const { return current_region * INSTANCE_REGION_SIZE; }
     ~VAOManager();
 };
 
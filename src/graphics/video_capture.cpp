@@ -0,0 +1,371 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "graphics/video_capture.hpp"
+
+#include "graphics/central_settings.hpp"
+#include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
+#include "race/race_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <time.h>
+
+VideoCapture *VideoCapture::m_video_capture = NULL;
+
+//-----------------------------------------------------------------------------
+/** Creates the video capture.
+ *  \param fps Video frames per second.
+ *  \param offline If the world is updated with a fixed time step of one
+ *         video frame per rendered frame.
+ */
+VideoCapture::VideoCapture(int fps, bool offline)
+{
+    m_fps             = std::max(fps, 1);
+    m_offline         = offline;
+    m_width           = m_height = 0;
+    m_next_read_back  = 0;
+    m_next_frame_time = 0;
+    m_num_frames      = 0;
+    m_num_dropped     = 0;
+    m_capturing       = false;
+    m_stop_writing    = false;
+    m_file            = NULL;
+    for (unsigned int i = 0; i < NUM_PBOS; i++)
+    {
+        m_read_backs[i].m_pbo   = 0;
+        m_read_backs[i].m_fence = 0;
+    }
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond_request, NULL);
+    pthread_cond_init(&m_cond_written, NULL);
+}   // VideoCapture
+
+//-----------------------------------------------------------------------------
+VideoCapture::~VideoCapture()
+{
+    endRace();
+    for (unsigned int i = 0; i < m_free_frames.size(); i++)
+        delete m_free_frames[i];
+    pthread_cond_destroy(&m_cond_written);
+    pthread_cond_destroy(&m_cond_request);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~VideoCapture
+
+//-----------------------------------------------------------------------------
+/** Called when a race is (re)started. Finishes the video of the previous
+ *  race and starts a new video, whose name contains the current time and
+ *  the track name.
+ */
+void VideoCapture::startRace()
+{
+    endRace();
+    if (!CVS->isGLSL())
+    {
+        Log::warn("VideoCapture", "Video capture needs the shader based "
+                                  "renderer.");
+        return;
+    }
+
+    // YUV 4:2:0 needs an even size
+    const core::dimension2du &size = irr_driver->getActualScreenSize();
+    m_width  = size.Width  & ~1u;
+    m_height = size.Height & ~1u;
+
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+    std::string name = std::string("video-") + date + "-"
+                     + race_manager->getTrackName() + ".y4m";
+    name = m_directory.empty() ? file_manager->getScreenshotDir() + name
+                               : m_directory + "/" + name;
+    m_file = fopen(name.c_str(), "wb");
+    if (!m_file)
+    {
+        Log::error("VideoCapture", "Can't open '%s'.", name.c_str());
+        return;
+    }
+    fprintf(m_file, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n",
+            m_width, m_height, m_fps);
+
+    m_stop_writing = false;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int error = pthread_create(&m_thread, &attr, &VideoCapture::writeLoop,
+                               this);
+    pthread_attr_destroy(&attr);
+    if (error)
+    {
+        Log::error("VideoCapture", "Could not create thread, error=%d.",
+                   errno);
+        fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+
+    const size_t frame_size = m_width * m_height * 4;
+    for (unsigned int i = 0; i < NUM_PBOS; i++)
+    {
+        glGenBuffers(1, &m_read_backs[i].m_pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_read_backs[i].m_pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, 0, GL_STREAM_READ);
+        m_read_backs[i].m_fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_next_read_back  = 0;
+    m_next_frame_time = StkTime::getRealTime();
+    m_num_frames      = 0;
+    m_num_dropped     = 0;
+    m_capturing       = true;
+    Log::info("VideoCapture", "Writing %ux%u video at %d fps%s to '%s'.",
+              m_width, m_height, m_fps, m_offline ? " (offline)" : "",
+              name.c_str());
+}   // startRace
+
+//-----------------------------------------------------------------------------
+/** Called at the end of a race: waits for all pending read backs, writes
+ *  all queued frames and closes the video.
+ */
+void VideoCapture::endRace()
+{
+    if (!m_capturing)
+        return;
+    for (unsigned int i = 0; i < NUM_PBOS; i++)
+    {
+        ReadBack *rb = &m_read_backs[(m_next_read_back + i) % NUM_PBOS];
+        finishReadBack(rb, /*wait*/true);
+        glDeleteBuffers(1, &rb->m_pbo);
+        rb->m_pbo = 0;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_stop_writing = true;
+    pthread_cond_signal(&m_cond_request);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+    fclose(m_file);
+    m_file      = NULL;
+    m_capturing = false;
+
+    Log::info("VideoCapture", "Wrote %u frames.", m_num_frames);
+    if (m_num_dropped > 0)
+        Log::warn("VideoCapture", "%u frames were dropped.", m_num_dropped);
+}   // endRace
+
+//-----------------------------------------------------------------------------
+/** Copies the frame of a finished read back into a frame buffer and queues
+ *  it for the writing thread.
+ *  \param rb The read back.
+ *  \param wait If true, waits for the GPU to finish the copy and for space
+ *         in the queue. Otherwise the read back is only finished if the
+ *         copy is done, and the frame is dropped if the queue is full.
+ */
+void VideoCapture::finishReadBack(ReadBack *rb, bool wait)
+{
+    if (!rb->m_fence)
+        return;
+    GLenum status = glClientWaitSync(rb->m_fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     wait ? 1000000000 : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return;
+    glDeleteSync(rb->m_fence);
+    rb->m_fence = 0;
+    if (status == GL_WAIT_FAILED)
+    {
+        m_num_dropped++;
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    while (wait && m_queue.size() >= MAX_QUEUED_FRAMES)
+        pthread_cond_wait(&m_cond_written, &m_mutex);
+    if (m_queue.size() >= MAX_QUEUED_FRAMES)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        m_num_dropped++;
+        return;
+    }
+    std::vector<unsigned char> *frame;
+    if (m_free_frames.empty())
+        frame = new std::vector<unsigned char>();
+    else
+    {
+        frame = m_free_frames.back();
+        m_free_frames.pop_back();
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    const size_t frame_size = m_width * m_height * 4;
+    frame->resize(frame_size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->m_pbo);
+    const unsigned char *data = (const unsigned char*)
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size, GL_MAP_READ_BIT);
+    if (data)
+        std::copy(data, data + frame_size, frame->begin());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_lock(&m_mutex);
+    if (data)
+    {
+        m_queue.push_back(frame);
+        pthread_cond_signal(&m_cond_request);
+        m_num_frames++;
+    }
+    else
+    {
+        m_free_frames.push_back(frame);
+        m_num_dropped++;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}   // finishReadBack
+
+//-----------------------------------------------------------------------------
+/** Called once per rendered frame directly before the buffers are swapped.
+ *  Queues all finished read backs, and starts reading this frame if a new
+ *  video frame is due.
+ */
+void VideoCapture::captureFrame()
+{
+    if (!m_capturing)
+        return;
+    PROFILER_PUSH_CPU_MARKER("Video capture", 0xFF, 0x80, 0x00);
+
+    for (unsigned int i = 0; i < NUM_PBOS; i++)
+        finishReadBack(&m_read_backs[(m_next_read_back + i) % NUM_PBOS],
+                       /*wait*/false);
+
+    bool capture = true;
+    if (!m_offline)
+    {
+        const double now = StkTime::getRealTime();
+        capture = now >= m_next_frame_time;
+        if (capture)
+        {
+            // If rendering is too slow, frames are skipped
+            m_next_frame_time += 1.0 / m_fps;
+            while (m_next_frame_time <= now)
+            {
+                m_next_frame_time += 1.0 / m_fps;
+                m_num_dropped++;
+            }
+        }
+    }
+
+    if (capture)
+    {
+        ReadBack *rb = &m_read_backs[m_next_read_back];
+        // Offline each frame must be written, so wait for the oldest copy
+        finishReadBack(rb, /*wait*/m_offline);
+        if (rb->m_fence)
+            m_num_dropped++;
+        else
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->m_pbo);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glReadBuffer(GL_BACK);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                         0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            rb->m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_next_read_back = (m_next_read_back + 1) % NUM_PBOS;
+        }
+    }
+    PROFILER_POP_CPU_MARKER();
+}   // captureFrame
+
+//-----------------------------------------------------------------------------
+/** Converts a frame to YUV 4:2:0 (full range BT.601) and writes it.
+ *  \param rgba The frame as RGBA, bottom row first.
+ */
+void VideoCapture::writeFrame(const std::vector<unsigned char> &rgba)
+{
+    const unsigned int w = m_width, h = m_height;
+    m_yuv.resize(w*h + 2 * (w/2) * (h/2));
+    unsigned char *y_plane = &m_yuv[0];
+    unsigned char *u_plane = y_plane + w*h;
+    unsigned char *v_plane = u_plane + (w/2)*(h/2);
+    for (unsigned int y = 0; y < h; y += 2)
+    {
+        // The video starts with the top row
+        const unsigned char *row0 = &rgba[(h - 1 - y) * w * 4];
+        const unsigned char *row1 = row0 - w * 4;
+        unsigned char *out0 = y_plane + y * w;
+        unsigned char *out1 = out0 + w;
+        for (unsigned int x = 0; x < w; x += 2)
+        {
+            int r = 0, g = 0, b = 0;
+            const unsigned char *p[4] = { row0 + x*4, row0 + x*4 + 4,
+                                          row1 + x*4, row1 + x*4 + 4 };
+            unsigned char *o[4] = { out0 + x, out0 + x + 1,
+                                    out1 + x, out1 + x + 1 };
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                // Fixed point with 8 fractional bits
+                *o[i] = (77*p[i][0] + 150*p[i][1] + 29*p[i][2] + 128) >> 8;
+                r += p[i][0]; g += p[i][1]; b += p[i][2];
+            }
+            const unsigned int c = (y/2) * (w/2) + x/2;
+            u_plane[c] = (unsigned char)((-43*r -  85*g + 128*b + 512) / 1024
+                                         + 128);
+            v_plane[c] = (unsigned char)(( 128*r - 107*g -  21*b + 512) / 1024
+                                         + 128);
+        }
+    }
+    fwrite("FRAME\n", 1, 6, m_file);
+    fwrite(&m_yuv[0], 1, m_yuv.size(), m_file);
+}   // writeFrame
+
+//-----------------------------------------------------------------------------
+/** The loop of the writing thread: converts and writes all queued frames
+ *  until it is stopped and the queue is empty.
+ */
+void* VideoCapture::writeLoop(void *obj)
+{
+    VideoCapture *me = (VideoCapture*)obj;
+    profiler.setThreadName("VideoCapture");
+
+    pthread_mutex_lock(&me->m_mutex);
+    while (true)
+    {
+        if (me->m_queue.empty())
+        {
+            if (me->m_stop_writing)
+                break;
+            pthread_cond_wait(&me->m_cond_request, &me->m_mutex);
+            continue;
+        }
+        std::vector<unsigned char> *frame = me->m_queue.front();
+        me->m_queue.pop_front();
+        pthread_mutex_unlock(&me->m_mutex);
+
+        me->writeFrame(*frame);
+
+        pthread_mutex_lock(&me->m_mutex);
+        me->m_free_frames.push_back(frame);
+        pthread_cond_signal(&me->m_cond_written);
+    }
+    pthread_mutex_unlock(&me->m_mutex);
+    return NULL;
+}   // writeLoop
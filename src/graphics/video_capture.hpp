@@ -0,0 +1,164 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_VIDEO_CAPTURE_HPP
+#define HEADER_VIDEO_CAPTURE_HPP
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <deque>
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+  * \brief Records each race as a video, enabled with --capture-video=fps.
+  *  The final frame buffer is read with asynchronous read backs into a few
+  *  pixel buffer objects, which are only mapped once the GPU has finished
+  *  the copy (tested with a fence), so reading a frame does not stall the
+  *  pipeline. The frames are converted to YUV 4:2:0 and written by a
+  *  separate thread to an uncompressed YUV4MPEG2 (.y4m) file, which can be
+  *  played or transcoded directly with common tools (e.g. ffmpeg).
+  *  In real time mode a frame is captured whenever the real time reaches
+  *  the next video frame, and frames are dropped if the GPU or the disk
+  *  can't keep up. In offline mode (--capture-offline) the world is updated
+  *  by exactly one video frame per rendered frame and the frame rate is
+  *  not limited, so e.g. replays are rendered as fast as possible without
+  *  ever dropping a frame.
+  * \ingroup graphics
+  */
+class VideoCapture : public NoCopy
+{
+private:
+    /** Number of pixel buffer objects used for the read backs. */
+    static const unsigned int NUM_PBOS = 3;
+
+    /** Maximum number of frames waiting for the writing thread. */
+    static const unsigned int MAX_QUEUED_FRAMES = 8;
+
+    /** A pixel buffer object and the fence of its pending read back. */
+    struct ReadBack
+    {
+        GLuint m_pbo;
+        GLsync m_fence;
+    };   // ReadBack
+
+    /** Video frames per second. */
+    int                   m_fps;
+
+    /** True if the world time advances by one video frame per rendered
+     *  frame instead of in real time. */
+    bool                  m_offline;
+
+    /** Directory in which the videos are written, the screenshot directory
+     *  if empty. */
+    std::string           m_directory;
+
+    /** Size of the captured frames (always even). */
+    unsigned int          m_width, m_height;
+
+    /** The read backs, used in a round robin fashion starting with
+     *  m_next_read_back. */
+    ReadBack              m_read_backs[NUM_PBOS];
+    unsigned int          m_next_read_back;
+
+    /** Real time (in seconds) at which the next frame is captured in real
+     *  time mode. */
+    double                m_next_frame_time;
+
+    /** Statistics of the current video. */
+    unsigned int          m_num_frames;
+    unsigned int          m_num_dropped;
+
+    /** True if a video is being recorded. */
+    bool                  m_capturing;
+
+    /** Frames (as RGBA, bottom row first) waiting for the writing thread,
+     *  and unused frame buffers, both protected by m_mutex. */
+    std::deque<std::vector<unsigned char>*> m_queue;
+    std::vector<std::vector<unsigned char>*> m_free_frames;
+
+    /** Set to stop the writing thread, protected by m_mutex. */
+    bool                  m_stop_writing;
+
+    pthread_mutex_t       m_mutex;
+
+    /** Signals the writing thread that a frame is queued. */
+    pthread_cond_t        m_cond_request;
+
+    /** Signals the main thread that a frame was written. */
+    pthread_cond_t        m_cond_written;
+
+    /** The thread writing the video file. */
+    pthread_t             m_thread;
+
+    /** The video file, only used by the writing thread while capturing. */
+    FILE                 *m_file;
+
+    /** Temporary buffer for one converted frame, only used by the writing
+     *  thread. */
+    std::vector<unsigned char> m_yuv;
+
+    static VideoCapture  *m_video_capture;
+
+         VideoCapture(int fps, bool offline);
+        ~VideoCapture();
+    void finishReadBack(ReadBack *rb, bool wait);
+    void writeFrame(const std::vector<unsigned char> &rgba);
+    static void *writeLoop(void *obj);
+
+public:
+    void startRace();
+    void endRace();
+    void captureFrame();
+    // ------------------------------------------------------------------------
+    /** Sets the directory in which the videos are written. */
+    void setDirectory(const std::string &dir) { m_directory = dir; }
+    // ------------------------------------------------------------------------
+    /** Returns the world time step of a frame in offline mode, or 0 if the
+     *  world runs in real time. */
+    float getFixedDt() const
+    {
+        return m_offline && m_capturing ? 1.0f / m_fps : 0.0f;
+    }   // getFixedDt
+    // ------------------------------------------------------------------------
+    /** Creates the instance of the video capture.
+     *  \param fps Video frames per second.
+     *  \param offline If the world is updated with a fixed time step. */
+    static void create(int fps, bool offline)
+    {
+        assert(!m_video_capture);
+        m_video_capture = new VideoCapture(fps, offline);
+    }   // create
+    // ------------------------------------------------------------------------
+    /** Returns the instance of the video capture, which is NULL if capturing
+     *  is not enabled. */
+    static VideoCapture *get() { return m_video_capture; }
+    // ------------------------------------------------------------------------
+    /** Finishes the current video and destroys the video capture. */
+    static void destroy()
+    {
+        delete m_video_capture;
+        m_video_capture = NULL;
+    }   // destroy
+};   // VideoCapture
+
+#endif
@@ -670,9 +670,12 @@ namespace GUIEngine
 #include "guiengine/dialog_queue.hpp"
 #include "modes/demo_world.hpp"
 #include "modes/cutscene_world.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/world.hpp"
 #include "states_screens/race_gui_base.hpp"
+#include "utils/time.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <assert.h>
 #include <irrlicht.h>
@@ -1289,6 +1292,13 @@ namespace GUIEngine
     // -----------------------------------------------------------------------
     std::vector<irr::video::ITexture*> g_loading_icons;
 
+    /** Progress shown on the loading screen, negative if no progress bar is
+     *  shown. */
+    float  g_loading_progress = -1.0f;
+
+    /** Time the loading screen was last rendered by setLoadingProgress. */
+    double g_loading_progress_time = 0.0;
+
     void renderLoading(bool clearIcons)
     {
         if (clearIcons) g_loading_icons.clear();
@@ -1333,6 +1343,20 @@ namespace GUIEngine
                            SColor(255,255,255,255),
                            true/* center h */, false /* center v */ );
 
+        if (g_loading_progress >= 0.0f)
+        {
+            const int bar_y = screen_h/2 + texture_h/2
+                            + Private::title_font_height + 10;
+            const int bar_w = screen_w/3;
+            const int bar_h = screen_h/60 + 2;
+            core::rect<s32> bar(screen_w/2 - bar_w/2, bar_y,
+                                screen_w/2 + bar_w/2, bar_y + bar_h);
+            GL32_draw2DRectangle(SColor(255, 40, 40, 40), bar);
+            bar.LowerRightCorner.X = bar.UpperLeftCorner.X
+                  + (int)(bar_w * std::min(g_loading_progress, 1.0f));
+            GL32_draw2DRectangle(SColor(255, 255, 255, 255), bar);
+        }
+
         const int icon_count = (int)g_loading_icons.size();
         const int icon_size = (int)(screen_w / 16.0f);
         const int ICON_MARGIN = 6;
@@ -1377,6 +1401,29 @@ namespace GUIEngine
         }
     } // addLoadingIcon
 
+    // -----------------------------------------------------------------------
+    /** Sets the progress shown on the loading screen and renders the screen
+     *  (at most 20 times per second). This is called during loading, while
+     *  a scene was started (see RaceManager::startNextRace).
+     *  \param progress Progress between 0 and 1, or negative to hide the
+     *         progress bar.
+     */
+    void setLoadingProgress(float progress)
+    {
+        g_loading_progress = progress;
+        if (progress < 0.0f || ProfileWorld::isNoGraphics())
+            return;
+        const double now = StkTime::getRealTime();
+        if (progress < 1.0f && now - g_loading_progress_time < 0.05)
+            return;
+        g_loading_progress_time = now;
+
+        renderLoading(false);
+        g_device->getVideoDriver()->endScene();
+        g_device->getVideoDriver()
+                ->beginScene(true, true, video::SColor(255,100,101,140));
+    } // setLoadingProgress
+
     // -----------------------------------------------------------------------
 
     Widget* getWidget(const char* name)
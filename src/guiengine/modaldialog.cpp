@@ -66,10 +66,7 @@ void ModalDialog::loadFromFile(const char* xmlFile)
     doInit();
     std::string path = file_manager->getAssetChecked(FileManager::GUI,xmlFile,
                                                      true);
-    IXMLReader* xml = file_manager->createXMLReader(path);
-
-    Screen::parseScreenFileDiv(xml, m_widgets, m_irrlicht_window);
-    delete xml;
+    Screen::loadWidgets(path, m_widgets, m_irrlicht_window);
 
     loadedFromFile();
 
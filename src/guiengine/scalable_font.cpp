@@ -39,6 +39,12 @@ ScalableFont::ScalableFont(IGUIEnvironment *env, const std::string &filename)
     m_shadow                 = false;
     m_mono_space_digits      = false;
     m_rtl                    = translations->isRTLLanguage();
+    // Makes sure that the layout cache is initialised on first use
+    m_layout_scale             = -1.0f;
+    m_layout_fallback_scale    = 1.0f;
+    m_layout_kerning           = 0;
+    m_layout_fallback_kerning  = 0;
+    m_layout_mono_space_digits = false;
 
     if (Environment)
     {
@@ -420,6 +426,7 @@ const ScalableFont::SFontArea &ScalableFont::getAreaFromCharacter(const wchar_t
 void ScalableFont::setInvisibleCharacters( const wchar_t *s )
 {
     Invisible = s;
+    m_layout_cache.clear();
 }
 
 
@@ -509,136 +516,50 @@ void ScalableFont::doDraw(const core::stringw& text,
         m_shadow = true; // set back
     }
 
+    const TextLayout &layout = getLayout(text);
+    const core::dimension2d<s32> &text_dimension = layout.m_dimension;
     core::position2d<s32> offset = position.UpperLeftCorner;
-    core::dimension2d<s32> text_dimension;
 
-    if (m_rtl || hcenter || vcenter || clip)
-    {
-        text_dimension = getDimension(text.c_str());
-
-        if (hcenter)    offset.X += (position.getWidth() - text_dimension.Width) / 2;
-        else if (m_rtl) offset.X += (position.getWidth() - text_dimension.Width);
-
-        if (vcenter)    offset.Y += (position.getHeight() - text_dimension.Height) / 2;
-        if (clip)
-        {
-            core::rect<s32> clippedRect(offset, text_dimension);
-            clippedRect.clipAgainst(*clip);
-            if (!clippedRect.isValid()) return;
-        }
-    }
-
-    // ---- collect character locations
-    const unsigned int text_size = text.size();
-    core::array<s32>               indices(text_size);
-    core::array<core::position2di> offsets(text_size);
-    std::vector<bool>              fallback(text_size);
+    if (hcenter)    offset.X += (position.getWidth() - text_dimension.Width) / 2;
+    else if (m_rtl) offset.X += (position.getWidth() - text_dimension.Width);
 
-    for (u32 i = 0; i<text_size; i++)
+    if (vcenter)    offset.Y += (position.getHeight() - text_dimension.Height) / 2;
+    if (clip)
     {
-        wchar_t c = text[i];
-
-        if (c == L'\r' ||          // Windows breaks
-            c == L'\n'    )        // Unix breaks
-        {
-            if(c==L'\r' && text[i+1]==L'\n') c = text[++i];
-            offset.Y += (int)(MaxHeight*m_scale);
-            offset.X  = position.UpperLeftCorner.X;
-            if (hcenter)
-                offset.X += (position.getWidth() - text_dimension.Width) >> 1;
-            continue;
-        }   // if lineBreak
+        core::rect<s32> clippedRect(offset, text_dimension);
+        clippedRect.clipAgainst(*clip);
+        if (!clippedRect.isValid()) return;
+    }
 
-        bool use_fallback_font = false;
-        const SFontArea &area  = getAreaFromCharacter(c, &use_fallback_font);
-        fallback[i]            = use_fallback_font;
-        offset.X              += area.underhang;
-        offsets.push_back(offset);
-        // Invisible character. add something to the array anyway so that
-        // indices from the various arrays remain in sync
-        indices.push_back( Invisible.findFirst(c) < 0  ? area.spriteno
-                                                       : -1            );
-        offset.X += getCharWidth(area, fallback[i]);
-    }   // for i<text_size
+    // The following lines start at the left side (or centered)
+    s32 line_start = position.UpperLeftCorner.X;
+    if (hcenter)
+        line_start += (position.getWidth() - text_dimension.Width) >> 1;
 
     // ---- do the actual rendering
-    const int indiceAmount                    = indices.size();
-    core::array< SGUISprite >& sprites        = SpriteBank->getSprites();
-    core::array< core::rect<s32> >& positions = SpriteBank->getPositions();
-    core::array< SGUISprite >* fallback_sprites;
-    core::array< core::rect<s32> >* fallback_positions;
-    if(m_fallback_font!=NULL)
-    {
-        fallback_sprites   = &m_fallback_font->SpriteBank->getSprites();
-        fallback_positions = &m_fallback_font->SpriteBank->getPositions();
-    }
-    else
-    {
-        fallback_sprites   = NULL;
-        fallback_positions = NULL;
-    }
+    // Consecutive characters using the same texture are drawn with one call.
+    // The vector is reused to avoid allocating memory for each string.
+    static std::vector<Batched2DQuad> quads;
+    quads.clear();
+    video::ITexture* batch_texture = NULL;
 
-    const int spriteAmount      = sprites.size();
-    for (int n=0; n<indiceAmount; n++)
+    for (unsigned int n = 0; n < layout.m_glyphs.size(); n++)
     {
-        const int spriteID = indices[n];
-        if (!fallback[n] && (spriteID < 0 || spriteID >= spriteAmount)) continue;
-        if (indices[n] == -1) continue;
-
-        //assert(sprites[spriteID].Frames.size() > 0);
+        const GlyphLayout &glyph = layout.m_glyphs[n];
+        const core::rect<s32> dest = glyph.m_dest +
+            core::position2di(glyph.m_first_line ? offset.X : line_start,
+                              offset.Y);
+        const core::rect<s32> &source = glyph.m_source;
 
-        const int texID = (fallback[n] ?
-                           (*fallback_sprites)[spriteID].Frames[0].textureNumber :
-                           sprites[spriteID].Frames[0].textureNumber);
-
-        core::rect<s32> source = (fallback[n] ?
-                                  (*fallback_positions)[(*fallback_sprites)[spriteID].Frames[0].rectNumber] :
-                                  positions[sprites[spriteID].Frames[0].rectNumber]);
-
-        const TextureInfo& info = (fallback[n] ?
-                                   (*(m_fallback_font->m_texture_files.find(texID))).second :
-                                   (*(m_texture_files.find(texID))).second
-                                   );
-        float char_scale = info.m_scale;
-
-        core::dimension2d<s32> size = source.getSize();
-
-        float scale = (fallback[n] ? m_scale*m_fallback_font_scale : m_scale);
-        size.Width  = (int)(size.Width  * scale * char_scale);
-        size.Height = (int)(size.Height * scale * char_scale);
-
-        // align vertically if character is smaller
-        int y_shift = (size.Height < MaxHeight*m_scale ? (int)((MaxHeight*m_scale - size.Height)/2.0f) : 0);
-
-        core::rect<s32> dest(offsets[n] + core::position2di(0, y_shift), size);
-
-        video::ITexture* texture = (fallback[n] ?
-                                    m_fallback_font->SpriteBank->getTexture(texID) :
-                                    SpriteBank->getTexture(texID) );
-
-        /*
-        if (fallback[n])
-        {
-            Log::info("ScalableFont", "Using fallback font %s; source area is %d, %d; size %d, %d; dest = %d, %d",
-                core::stringc(texture->getName()).c_str(), source.UpperLeftCorner.X, source.UpperLeftCorner.Y,
-                source.getWidth(), source.getHeight(), offsets[n].X, offsets[n].Y);
-        }
-        */
+        ScalableFont *font = glyph.m_fallback ? m_fallback_font : this;
+        video::ITexture* texture =
+            font->SpriteBank->getTexture(glyph.m_texture_id);
 
         if (texture == NULL)
         {
             // perform lazy loading
-
-            if (fallback[n])
-            {
-                m_fallback_font->lazyLoadTexture(texID);
-                texture = m_fallback_font->SpriteBank->getTexture(texID);
-            }
-            else
-            {
-                lazyLoadTexture(texID);
-                texture = SpriteBank->getTexture(texID);
-            }
+            font->lazyLoadTexture(glyph.m_texture_id);
+            texture = font->SpriteBank->getTexture(glyph.m_texture_id);
 
             if (texture == NULL)
             {
@@ -647,67 +568,57 @@ void ScalableFont::doDraw(const core::stringw& text,
             }
         }
 
-        if (m_black_border && charCollector == NULL)
+        video::SColor colors[] = { color, color, color, color };
+        if (glyph.m_fallback)
+        {
+            // TODO: don't hardcode colors?
+            video::SColor orange(color.getAlpha(), 255, 100, 0);
+            video::SColor yellow(color.getAlpha(), 255, 220, 15);
+            colors[0] = colors[2] = orange;
+            colors[1] = colors[3] = yellow;
+        }
+
+        if (charCollector != NULL)
+        {
+            charCollector->collectChar(texture, dest, source, colors);
+            continue;
+        }
+
+        if (texture != batch_texture)
+        {
+            draw2DImageBatch(batch_texture, quads, clip);
+            quads.clear();
+            batch_texture = texture;
+        }
+
+        Batched2DQuad quad;
+        quad.m_source = source;
+        if (m_black_border)
         {
             // draw black border
             video::SColor black(color.getAlpha(),0,0,0);
+            for (unsigned int i = 0; i < 4; i++)
+                quad.m_colors[i] = black;
 
             for (int x_delta=-2; x_delta<=2; x_delta++)
             {
                 for (int y_delta=-2; y_delta<=2; y_delta++)
                 {
                     if (x_delta == 0 || y_delta == 0) continue;
-                    draw2DImage(texture,
-                                dest + core::position2d<s32>(x_delta, y_delta),
-                                source,
-                                clip,
-                                black, true);
+                    quad.m_dest = dest + core::position2d<s32>(x_delta, y_delta);
+                    quads.push_back(quad);
                 }
             }
         }
 
-        if (fallback[n])
-        {
-            // TODO: don't hardcode colors?
-            video::SColor orange(color.getAlpha(), 255, 100, 0);
-            video::SColor yellow(color.getAlpha(), 255, 220, 15);
-            video::SColor title_colors[] = {orange, yellow, orange, yellow};
+        quad.m_dest = dest;
+        for (unsigned int i = 0; i < 4; i++)
+            quad.m_colors[i] = colors[i];
+        quads.push_back(quad);
 
-            if (charCollector != NULL)
-            {
-                charCollector->collectChar(texture,
-                    dest,
-                    source,
-                    title_colors);
-            }
-            else
-            {
-                draw2DImage(texture,
-                    dest,
-                    source,
-                    clip,
-                    title_colors, true);
-            }
-        }
-        else
-        {
-            if (charCollector != NULL)
-            {
-                video::SColor colors[] = { color, color, color, color };
-                charCollector->collectChar(texture,
-                    dest,
-                    source,
-                    colors);
-            }
-            else
-            {
-                draw2DImage(texture,
-                    dest,
-                    source,
-                    clip,
-                    color, true);
-            }
 #ifdef FONT_DEBUG
+        if (!glyph.m_fallback)
+        {
             video::IVideoDriver* driver = GUIEngine::getDriver();
             driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
                                core::position2d<s32>(dest.UpperLeftCorner.X,  dest.LowerRightCorner.Y),
@@ -721,11 +632,106 @@ void ScalableFont::doDraw(const core::stringw& text,
             driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
                                core::position2d<s32>(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y),
                                video::SColor(255, 255,0,0));
-#endif
         }
+#endif
     }
+    draw2DImageBatch(batch_texture, quads, clip);
 }
 
+/** Returns the position of all visible characters of a string, relative to
+ *  the start of their line. The result is cached, since the same strings are
+ *  usually drawn every frame.
+ *  \param text The string to lay out.
+ */
+const ScalableFont::TextLayout& ScalableFont::getLayout(const core::stringw& text)
+{
+    if (m_layout_scale             != m_scale                  ||
+        m_layout_fallback_scale    != m_fallback_font_scale    ||
+        m_layout_kerning           != GlobalKerningWidth       ||
+        m_layout_fallback_kerning  != m_fallback_kerning_width ||
+        m_layout_mono_space_digits != m_mono_space_digits      ||
+        m_layout_cache.size() >= MAX_CACHED_LAYOUTS)
+    {
+        m_layout_cache.clear();
+        m_layout_scale             = m_scale;
+        m_layout_fallback_scale    = m_fallback_font_scale;
+        m_layout_kerning           = GlobalKerningWidth;
+        m_layout_fallback_kerning  = m_fallback_kerning_width;
+        m_layout_mono_space_digits = m_mono_space_digits;
+    }
+
+    std::map<core::stringw, TextLayout>::const_iterator cached =
+        m_layout_cache.find(text);
+    if (cached != m_layout_cache.end())
+        return cached->second;
+
+    TextLayout &layout = m_layout_cache[text];
+    core::dimension2d<u32> dim = getDimension(text.c_str());
+    layout.m_dimension = core::dimension2d<s32>(dim.Width, dim.Height);
+
+    core::array< SGUISprite >& sprites        = SpriteBank->getSprites();
+    core::array< core::rect<s32> >& positions = SpriteBank->getPositions();
+    const int spriteAmount                    = sprites.size();
+
+    core::position2d<s32> offset(0, 0);
+    bool first_line = true;
+    const unsigned int text_size = text.size();
+    for (u32 i = 0; i<text_size; i++)
+    {
+        wchar_t c = text[i];
+
+        if (c == L'\r' ||          // Windows breaks
+            c == L'\n'    )        // Unix breaks
+        {
+            if(c==L'\r' && text[i+1]==L'\n') c = text[++i];
+            offset.Y += (int)(MaxHeight*m_scale);
+            offset.X  = 0;
+            first_line = false;
+            continue;
+        }   // if lineBreak
+
+        bool fallback = false;
+        const SFontArea &area  = getAreaFromCharacter(c, &fallback);
+        offset.X              += area.underhang;
+        const core::position2di char_offset = offset;
+        offset.X              += getCharWidth(area, fallback);
+
+        // Invisible character
+        if (Invisible.findFirst(c) >= 0)
+            continue;
+        const int spriteID = area.spriteno;
+        if (!fallback && (spriteID < 0 || spriteID >= spriteAmount)) continue;
+
+        const ScalableFont *font = fallback ? m_fallback_font : this;
+        const SGUISprite &sprite = font->SpriteBank->getSprites()[spriteID];
+        const int texID = sprite.Frames[0].textureNumber;
+
+        GlyphLayout glyph;
+        glyph.m_source     = (fallback ?
+                              m_fallback_font->SpriteBank->getPositions()[sprite.Frames[0].rectNumber] :
+                              positions[sprite.Frames[0].rectNumber]);
+        glyph.m_texture_id = texID;
+        glyph.m_fallback   = fallback;
+        glyph.m_first_line = first_line;
+
+        const TextureInfo& info = (*(font->m_texture_files.find(texID))).second;
+        float char_scale = info.m_scale;
+
+        core::dimension2d<s32> size = glyph.m_source.getSize();
+
+        float scale = (fallback ? m_scale*m_fallback_font_scale : m_scale);
+        size.Width  = (int)(size.Width  * scale * char_scale);
+        size.Height = (int)(size.Height * scale * char_scale);
+
+        // align vertically if character is smaller
+        int y_shift = (size.Height < MaxHeight*m_scale ? (int)((MaxHeight*m_scale - size.Height)/2.0f) : 0);
+
+        glyph.m_dest = core::rect<s32>(char_offset + core::position2di(0, y_shift), size);
+        layout.m_glyphs.push_back(glyph);
+    }   // for i<text_size
+
+    return layout;
+}   // getLayout
 
 void ScalableFont::lazyLoadTexture(int texID)
 {
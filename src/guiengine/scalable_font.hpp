@@ -18,6 +18,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace irr
 {
@@ -170,6 +171,38 @@ private:
         u32             spriteno;
     };
 
+    /** A visible character of a laid out string. */
+    struct GlyphLayout
+    {
+        /** Position relative to the start of its line and to the top of
+         *  the text. */
+        core::rect<s32> m_dest;
+        core::rect<s32> m_source;
+        s32             m_texture_id;
+        bool            m_fallback;
+        bool            m_first_line;
+    };
+
+    /** The characters of a string and its size. */
+    struct TextLayout
+    {
+        std::vector<GlyphLayout> m_glyphs;
+        core::dimension2d<s32>   m_dimension;
+    };
+
+    /** Maximum number of cached layouts, the cache is cleared when it is
+     *  full (e.g. with times which change every frame). */
+    static const unsigned int MAX_CACHED_LAYOUTS = 256;
+
+    /** Layouts of the recently drawn strings. */
+    std::map<core::stringw, TextLayout> m_layout_cache;
+
+    /** The parameters the cached layouts were computed with. */
+    float m_layout_scale, m_layout_fallback_scale;
+    s32   m_layout_kerning, m_layout_fallback_kerning;
+    bool  m_layout_mono_space_digits;
+
+    const TextLayout &getLayout(const core::stringw &text);
     int getCharWidth(const SFontArea& area, const bool fallback) const;
     s32 getAreaIDFromCharacter(const wchar_t c, bool* fallback_font) const;
     const SFontArea &getAreaFromCharacter(const wchar_t c, bool* fallback_font) const;
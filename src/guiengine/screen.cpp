@@ -54,6 +54,7 @@ Screen::Screen(const char* file, bool pause_race)
 
     m_filename       = file;
     m_throttle_FPS   = true;
+    m_idle_throttle_FPS = true;
     m_render_3d      = false;
     m_loaded         = false;
     m_pause_race     = pause_race;
@@ -69,6 +70,7 @@ Screen::Screen(bool pause_race)
 
     m_loaded       = false;
     m_render_3d    = false;
+    m_idle_throttle_FPS = true;
     m_pause_race   = pause_race;
 }   // Screen
 
@@ -128,16 +130,13 @@ void Screen::loadFromFile()
     assert(m_magic_number == 0xCAFEC001);
 
     std::string path = file_manager->getAssetChecked(FileManager::GUI, m_filename, true);
-    IXMLReader* xml = file_manager->createXMLReader( path );
 
-    parseScreenFileDiv(xml, m_widgets);
+    loadWidgets(path, m_widgets);
     m_loaded = true;
     calculateLayout();
 
     // invoke callback so that the class deriving from Screen is aware of this event
     loadedFromFile();
-
-    delete xml;
 }   // loadFromFile
 
 // -----------------------------------------------------------------------------
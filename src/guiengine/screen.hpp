@@ -43,6 +43,8 @@ using namespace irr;
 
 #include "utils/leak_check.hpp"
 
+#include <vector>
+
 /**
  * \ingroup guiengine
  */
@@ -116,24 +118,55 @@ namespace GUIEngine
         /** to catch errors as early as possible, for debugging purposes only */
         unsigned int m_magic_number;
 
+        /** A widget as described in a GUI file. The templates of each file
+         *  are only read once, all later loads of the same file (e.g. each
+         *  time a dialog is opened, or after a resolution change) create the
+         *  widgets from the cached templates. */
+        struct WidgetTemplate
+        {
+            /** Index of the XML tag this widget was created from. */
+            int m_tag;
+            std::map<Property, std::string> m_properties;
+            /** The 'text' attribute, translated when the widget is created
+             *  (so that the cache does not depend on the language). */
+            irr::core::stringw m_text;
+            irr::core::stringw m_raw_text;
+            bool m_has_text;
+            bool m_has_raw_text;
+            std::vector<WidgetTemplate> m_children;
+        };   // WidgetTemplate
+
+        static void readWidgetTemplates(irr::io::IXMLReader* xml,
+                                        std::vector<WidgetTemplate>& append_to);
+        static Widget* createWidget(int tag);
+        static void createWidgets(const std::vector<WidgetTemplate>& templates,
+                                  PtrVector<Widget>& append_to,
+                                  irr::gui::IGUIElement* parent);
+
     protected:
         bool m_throttle_FPS;
 
+        /** False if this screen animates something without any widget
+         *  that needs to be updated (e.g. the news ticker in the main menu),
+         *  so that the frame rate must not be reduced further when the
+         *  player is idle. */
+        bool m_idle_throttle_FPS;
+
     public:
 
         LEAK_CHECK()
 
         /**
          * \ingroup guiengine
-         * \brief Loads a GUI screen from its XML file.
+         * \brief Loads the widgets of a GUI file.
          *
          * Builds a hierarchy of Widget objects whose contents are a direct
          * transcription of the XML file, with little analysis or layout
-         * performed on them.
+         * performed on them. Each file is only parsed once.
          */
-        static void parseScreenFileDiv(irr::io::IXMLReader* xml,
-                                       PtrVector<Widget>& append_to,
-                                       irr::gui::IGUIElement* parent = NULL);
+        static void loadWidgets(const std::string& path,
+                                PtrVector<Widget>& append_to,
+                                irr::gui::IGUIElement* parent = NULL);
 
 
         Screen(bool pause_race=true);
@@ -151,6 +184,10 @@ namespace GUIEngine
 
         bool throttleFPS() const { return m_throttle_FPS; }
 
+        /** \return whether the frame rate can be reduced further when there
+         *  was no input for a while. */
+        bool idleThrottleFPS() const { return m_idle_throttle_FPS; }
+
         void addWidgets();
 
         void calculateLayout();
@@ -19,9 +19,11 @@
 #include "guiengine/screen.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/widgets.hpp"
+#include "io/file_manager.hpp"
 #include "utils/translation.hpp"
 #include <iostream>
 #include <irrXML.h>
+#include <map>
 #include <sstream>
 
 using namespace irr;
@@ -33,8 +35,53 @@ using namespace io;
 using namespace gui;
 using namespace GUIEngine;
 
-void Screen::parseScreenFileDiv(irr::io::IXMLReader* xml, PtrVector<Widget>& append_to,
-                                irr::gui::IGUIElement* parent)
+namespace
+{
+    /** All tags that can be used in a GUI file. The tags up to TAG_TABS
+     *  are containers, i.e. the following elements up to the end tag are
+     *  their children. */
+    enum WidgetTag
+    {
+        TAG_DIV, TAG_PLACEHOLDER, TAG_BOX, TAG_BOTTOMBAR, TAG_TOPBAR,
+        TAG_ROUNDEDBOX, TAG_RIBBON, TAG_BUTTONBAR, TAG_TABS,
+        TAG_SPINNER, TAG_BUTTON, TAG_GAUGE, TAG_PROGRESSBAR, TAG_ICON_BUTTON,
+        TAG_ICON, TAG_CHECKBOX, TAG_LABEL, TAG_BRIGHT, TAG_BUBBLE,
+        TAG_HEADER, TAG_SPACER, TAG_RIBBON_GRID, TAG_SCROLLABLE_RIBBON,
+        TAG_SCROLLABLE_TOOLBAR, TAG_MODEL, TAG_LIST, TAG_TEXTBOX,
+        TAG_RATINGBAR, TAG_COUNT
+    };
+
+    const wchar_t* g_tag_names[TAG_COUNT] =
+    {
+        L"div", L"placeholder", L"box", L"bottombar", L"topbar",
+        L"roundedbox", L"ribbon", L"buttonbar", L"tabs",
+        L"spinner", L"button", L"gauge", L"progressbar", L"icon-button",
+        L"icon", L"checkbox", L"label", L"bright", L"bubble",
+        L"header", L"spacer", L"ribbon_grid", L"scrollable_ribbon",
+        L"scrollable_toolbar", L"model", L"list", L"textbox",
+        L"ratingbar"
+    };
+
+    // ------------------------------------------------------------------------
+    /** Returns the index of a tag, or -1 if the tag is unknown. */
+    int findTag(const wchar_t* name)
+    {
+        for (int i = 0; i < TAG_COUNT; i++)
+        {
+            if (wcscmp(g_tag_names[i], name) == 0)
+                return i;
+        }
+        return -1;
+    }   // findTag
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Reads the widget descriptions of a GUI file.
+ *  \param xml The reader of the file.
+ *  \param append_to Where to store the widgets of the current container.
+ */
+void Screen::readWidgetTemplates(irr::io::IXMLReader* xml,
+                                 std::vector<WidgetTemplate>& append_to)
 {
     // parse XML file
     while (xml && xml->read())
@@ -49,144 +96,23 @@ void Screen::parseScreenFileDiv(irr::io::IXMLReader* xml, PtrVector<Widget>& app
 
             case irr::io::EXN_ELEMENT:
             {
-                /* find which type of widget is specified by the current tag, and instanciate it */
-                if (wcscmp(L"div", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"stkgui", xml->getNodeName()) == 0)
+                if (wcscmp(L"stkgui", xml->getNodeName()) == 0)
                 {
                     // outer node that's there only to comply with XML standard (and expat)
                     continue;
                 }
-                else if (wcscmp(L"placeholder", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV, true);
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"box", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_show_bounding_box = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"bottombar", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_bottom_bar = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"topbar", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_top_bar = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"roundedbox", xml->getNodeName()) == 0)
-                {
-                    Widget* w = new Widget(WTYPE_DIV);
-                    w->m_show_bounding_box = true;
-                    w->m_is_bounding_box_round = true;
-                    append_to.push_back(w);
-                }
-                else if (wcscmp(L"ribbon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget());
-                }
-                else if (wcscmp(L"buttonbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget(RIBBON_TOOLBAR));
-                }
-                else if (wcscmp(L"tabs", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RibbonWidget(RIBBON_TABS));
-                }
-                else if (wcscmp(L"spinner", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new SpinnerWidget());
-                }
-                else if (wcscmp(L"button", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ButtonWidget());
-                }
-                else if (wcscmp(L"gauge", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new SpinnerWidget(true));
-                }
-                else if (wcscmp(L"progressbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ProgressBarWidget());
-                }
-                else if (wcscmp(L"icon-button", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new IconButtonWidget());
-                }
-                else if (wcscmp(L"icon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO,
-                                                             false, false));
-                }
-                else if (wcscmp(L"checkbox", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new CheckBoxWidget());
-                }
-                else if (wcscmp(L"label", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget());
-                }
-                else if (wcscmp(L"bright", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget(false, true));
-                }
-                else if (wcscmp(L"bubble", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new BubbleWidget());
-                }
-                else if (wcscmp(L"header", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new LabelWidget(true));
-                }
-                else if (wcscmp(L"spacer", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new Widget(WTYPE_SPACER));
-                }
-                else if (wcscmp(L"ribbon_grid", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(false /* combo */, true /* multi-row */));
-                }
-                else if (wcscmp(L"scrollable_ribbon", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(true /* combo */, false /* multi-row */));
-                }
-                else if (wcscmp(L"scrollable_toolbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new DynamicRibbonWidget(false /* combo */, false /* multi-row */));
-                }
-                else if (wcscmp(L"model", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ModelViewWidget());
-                }
-                else if (wcscmp(L"list", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new ListWidget());
-                }
-                else if (wcscmp(L"textbox", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new TextBoxWidget());
-                }
-                else if (wcscmp(L"ratingbar", xml->getNodeName()) == 0)
-                {
-                    append_to.push_back(new RatingBarWidget());
-                }
-                else
+
+                const int tag = findTag(xml->getNodeName());
+                if (tag < 0)
                 {
-                    Log::warn("Screen::parseScreenFileDiv", "unknown tag found in STK GUI file '%s'", xml->getNodeName());
+                    Log::warn("Screen::readWidgetTemplates", "unknown tag found in STK GUI file '%s'",
+                              core::stringc(xml->getNodeName()).c_str());
                     continue;
                 }
 
-                /* retrieve the created widget */
-                Widget& widget = append_to[append_to.size()-1];
+                append_to.push_back(WidgetTemplate());
+                WidgetTemplate& widget = append_to.back();
+                widget.m_tag = tag;
 
                 /* read widget properties using macro magic */
 
@@ -225,53 +151,29 @@ if(prop_name != NULL) widget.m_properties[prop_flag] = core::stringc(prop_name).
 #undef READ_PROPERTY
 
                 const wchar_t* text = xml->getAttributeValue( L"text" );
-
+                widget.m_has_text = text != NULL;
                 if (text != NULL)
-                {
-                    widget.m_text = _(text);
-                }
+                    widget.m_text = text;
 
                 const wchar_t* raw_text = xml->getAttributeValue(L"raw_text");
-
+                widget.m_has_raw_text = raw_text != NULL;
                 if (raw_text != NULL)
-                {
-                    widget.m_text = raw_text;
-                }
-
-                if (parent != NULL)
-                {
-                    widget.setParent(parent);
-                }
+                    widget.m_raw_text = raw_text;
 
                 /* a new div starts here, continue parsing with this new div as new parent */
-                if (widget.getType() == WTYPE_DIV || widget.getType() == WTYPE_RIBBON)
+                if (tag <= TAG_TABS)
                 {
-                    parseScreenFileDiv( xml, append_to[append_to.size()-1].m_children, parent );
+                    readWidgetTemplates(xml, append_to.back().m_children);
                 }
             }// end case EXN_ELEMENT
 
                 break;
             case irr::io::EXN_ELEMENT_END:
             {
-                // we're done parsing this 'div', return one step back in the recursive call
-                if (wcscmp(L"div", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"box", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"placeholder", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"roundedbox", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"bottombar", xml->getNodeName()) == 0)
-                    return;
-                if (wcscmp(L"topbar", xml->getNodeName()) == 0)
-                    return;
-
-                // We're done parsing this 'ribbon', return one step back in
-                // the recursive call.
-                if (wcscmp(L"ribbon", xml->getNodeName()) == 0 ||
-                    wcscmp(L"buttonbar", xml->getNodeName()) == 0 ||
-                    wcscmp(L"tabs", xml->getNodeName()) == 0)
+                // we're done parsing this 'div' or 'ribbon', return one
+                // step back in the recursive call
+                const int tag = findTag(xml->getNodeName());
+                if (tag >= 0 && tag <= TAG_TABS)
                     return;
             }
                 break;
@@ -279,5 +181,120 @@ if(prop_name != NULL) widget.m_properties[prop_flag] = core::stringc(prop_name).
             default: break;
         }//end switch
     } // end while
-} // end function
+}   // readWidgetTemplates
 
+// ----------------------------------------------------------------------------
+/** Creates the widget for a tag.
+ *  \param tag Index of the tag in the GUI file.
+ */
+Widget* Screen::createWidget(int tag)
+{
+    Widget* w = NULL;
+    switch (tag)
+    {
+    case TAG_DIV:         w = new Widget(WTYPE_DIV);       break;
+    case TAG_PLACEHOLDER: w = new Widget(WTYPE_DIV, true); break;
+    case TAG_BOX:
+        w = new Widget(WTYPE_DIV);
+        w->m_show_bounding_box = true;
+        break;
+    case TAG_BOTTOMBAR:
+        w = new Widget(WTYPE_DIV);
+        w->m_bottom_bar = true;
+        break;
+    case TAG_TOPBAR:
+        w = new Widget(WTYPE_DIV);
+        w->m_top_bar = true;
+        break;
+    case TAG_ROUNDEDBOX:
+        w = new Widget(WTYPE_DIV);
+        w->m_show_bounding_box = true;
+        w->m_is_bounding_box_round = true;
+        break;
+    case TAG_RIBBON:      w = new RibbonWidget();                   break;
+    case TAG_BUTTONBAR:   w = new RibbonWidget(RIBBON_TOOLBAR);     break;
+    case TAG_TABS:        w = new RibbonWidget(RIBBON_TABS);        break;
+    case TAG_SPINNER:     w = new SpinnerWidget();                  break;
+    case TAG_BUTTON:      w = new ButtonWidget();                   break;
+    case TAG_GAUGE:       w = new SpinnerWidget(true);              break;
+    case TAG_PROGRESSBAR: w = new ProgressBarWidget();              break;
+    case TAG_ICON_BUTTON: w = new IconButtonWidget();               break;
+    case TAG_ICON:
+        w = new IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO,
+                                 false, false);
+        break;
+    case TAG_CHECKBOX:    w = new CheckBoxWidget();                 break;
+    case TAG_LABEL:       w = new LabelWidget();                    break;
+    case TAG_BRIGHT:      w = new LabelWidget(false, true);         break;
+    case TAG_BUBBLE:      w = new BubbleWidget();                   break;
+    case TAG_HEADER:      w = new LabelWidget(true);                break;
+    case TAG_SPACER:      w = new Widget(WTYPE_SPACER);             break;
+    case TAG_RIBBON_GRID:
+        w = new DynamicRibbonWidget(false /* combo */, true /* multi-row */);
+        break;
+    case TAG_SCROLLABLE_RIBBON:
+        w = new DynamicRibbonWidget(true /* combo */, false /* multi-row */);
+        break;
+    case TAG_SCROLLABLE_TOOLBAR:
+        w = new DynamicRibbonWidget(false /* combo */, false /* multi-row */);
+        break;
+    case TAG_MODEL:       w = new ModelViewWidget();                break;
+    case TAG_LIST:        w = new ListWidget();                     break;
+    case TAG_TEXTBOX:     w = new TextBoxWidget();                  break;
+    case TAG_RATINGBAR:   w = new RatingBarWidget();                break;
+    default: assert(false);
+    }
+    return w;
+}   // createWidget
+
+// ----------------------------------------------------------------------------
+/** Creates the widgets described by a list of templates.
+ *  \param templates The widget descriptions.
+ *  \param append_to Where to add the new widgets.
+ *  \param parent The irrlicht parent of the widgets (can be NULL).
+ */
+void Screen::createWidgets(const std::vector<WidgetTemplate>& templates,
+                           PtrVector<Widget>& append_to,
+                           irr::gui::IGUIElement* parent)
+{
+    for (unsigned int i = 0; i < templates.size(); i++)
+    {
+        const WidgetTemplate& t = templates[i];
+        Widget* widget = createWidget(t.m_tag);
+        if (!widget)
+            continue;
+        append_to.push_back(widget);
+
+        widget->m_properties = t.m_properties;
+        if (t.m_has_text)
+            widget->m_text = _(t.m_text.c_str());
+        if (t.m_has_raw_text)
+            widget->m_text = t.m_raw_text;
+
+        if (parent != NULL)
+            widget->setParent(parent);
+
+        if (widget->getType() == WTYPE_DIV || widget->getType() == WTYPE_RIBBON)
+            createWidgets(t.m_children, widget->m_children, parent);
+    }
+}   // createWidgets
+
+// ----------------------------------------------------------------------------
+void Screen::loadWidgets(const std::string& path, PtrVector<Widget>& append_to,
+                         irr::gui::IGUIElement* parent)
+{
+    // The parsed files, GUI files do not change while STK is running.
+    static std::map<std::string, std::vector<WidgetTemplate> > cache;
+
+    std::map<std::string, std::vector<WidgetTemplate> >::iterator i =
+        cache.find(path);
+    if (i == cache.end())
+    {
+        i = cache.insert(std::make_pair(path,
+                                        std::vector<WidgetTemplate>())).first;
+        IXMLReader* xml = file_manager->createXMLReader(path);
+        readWidgetTemplates(xml, i->second);
+        delete xml;
+    }
+    createWidgets(i->second, append_to, parent);
+}   // loadWidgets
@@ -609,98 +609,68 @@ X##_yflip.LowerRightCorner.Y = w->m_skin_dest_y + \
     core::recti& GET_AREA(dest_area_bottom_right);
 #undef GET_AREA
 
-    SColor* colorptr = NULL;
+    SColor thecolor(255, 255, 255, 255);
 
     // create a color object
     if ( (w->m_skin_r != -1 && w->m_skin_g != -1 && w->m_skin_b != -1) ||
          ID_DEBUG || deactivated)
     {
-        SColor thecolor(255, w->m_skin_r, w->m_skin_g, w->m_skin_b);
-        colorptr = new SColor[4]();
-        colorptr[0] = thecolor;
-        colorptr[1] = thecolor;
-        colorptr[2] = thecolor;
-        colorptr[3] = thecolor;
+        thecolor = SColor(255, w->m_skin_r, w->m_skin_g, w->m_skin_b);
     }
 
     // set it to transluscent
     if (ID_DEBUG || deactivated)
     {
-        colorptr[0].setAlpha(100);
-        colorptr[1].setAlpha(100);
-        colorptr[2].setAlpha(100);
-        colorptr[3].setAlpha(100);
+        thecolor.setAlpha(100);
     }
 
+    // All pieces come from the same texture, so they are drawn with a
+    // single call. The vector is reused to avoid allocating memory for
+    // every box.
+    static std::vector<Batched2DQuad> pieces;
+    pieces.clear();
+    Batched2DQuad piece;
+    for (unsigned int i = 0; i < 4; i++)
+        piece.m_colors[i] = thecolor;
+
+#define ADD_PIECE( X ) { piece.m_dest   = dest_area_##X; \
+                         piece.m_source = m_source_area_##X; \
+                         pieces.push_back(piece); }
+
     if ((areas & BoxRenderParams::LEFT) != 0)
-    {
-        draw2DImage(source, dest_area_left,
-                                            m_source_area_left, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(left)
 
     if ((areas & BoxRenderParams::BODY) != 0)
-    {
-        draw2DImage(source, dest_area_center,
-                                            m_source_area_center, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(center)
 
     if ((areas & BoxRenderParams::RIGHT) != 0)
-    {
-        draw2DImage(source, dest_area_right,
-                                            m_source_area_right, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(right)
 
     if ((areas & BoxRenderParams::TOP) != 0)
-    {
-        draw2DImage(source, dest_area_top,
-                                            m_source_area_top, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(top)
+
     if ((areas & BoxRenderParams::BOTTOM) != 0)
-    {
-        draw2DImage(source, dest_area_bottom,
-                                            m_source_area_bottom, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(bottom)
 
     if ( ((areas & BoxRenderParams::LEFT) != 0) &&
          ((areas & BoxRenderParams::TOP ) != 0)     )
-    {
-        draw2DImage(source, dest_area_top_left,
-                                            m_source_area_top_left, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(top_left)
+
     if ( ((areas & BoxRenderParams::RIGHT) != 0) &&
          ((areas & BoxRenderParams::TOP  ) != 0)    )
-    {
-        draw2DImage(source, dest_area_top_right,
-                                            m_source_area_top_right, clipRect,
-                                            colorptr, true /* alpha */);
-    }
+        ADD_PIECE(top_right)
+
     if ( ((areas & BoxRenderParams::LEFT  ) != 0) &&
          ((areas & BoxRenderParams::BOTTOM) != 0)    )
-    {
-        draw2DImage(source, dest_area_bottom_left,
-                                            m_source_area_bottom_left,
-                                            clipRect, colorptr,
-                                            /*alpha*/true );
-    }
+        ADD_PIECE(bottom_left)
+
     if ( ((areas & BoxRenderParams::RIGHT ) != 0) &&
          ((areas & BoxRenderParams::BOTTOM) != 0)    )
-    {
-        draw2DImage(source, dest_area_bottom_right,
-                                            m_source_area_bottom_right,
-                                            clipRect, colorptr,
-                                            /*alpha*/true );
-    }
+        ADD_PIECE(bottom_right)
 
-    if (colorptr != NULL)
-    {
-        delete[] colorptr;
-    }
+#undef ADD_PIECE
+
+    draw2DImageBatch(source, pieces, clipRect);
 
 }   // drawBoxFromStretchableTexture
 
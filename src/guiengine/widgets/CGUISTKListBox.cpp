@@ -473,8 +473,19 @@ void CGUISTKListBox::draw()
 
     bool hl = (HighlightWhenNotFocused || Environment->hasFocus(this) || Environment->hasFocus(ScrollBar));
 
-    for (s32 i=0; i<(s32)Items.size(); ++i)
+    // Only the visible items are drawn, so start with the first item that
+    // is not scrolled out at the top, and stop after the last visible one.
+    // This keeps drawing cheap even for lists with thousands of items.
+    s32 first = ItemHeight > 0 ? ScrollBar->getPos() / ItemHeight : 0;
+    first = core::clamp(first, 0, (s32)Items.size());
+    frameRect.UpperLeftCorner.Y += first * ItemHeight;
+    frameRect.LowerRightCorner.Y += first * ItemHeight;
+
+    for (s32 i=first; i<(s32)Items.size(); ++i)
     {
+        if (frameRect.UpperLeftCorner.Y > AbsoluteRect.LowerRightCorner.Y)
+            break;
+
         if (frameRect.LowerRightCorner.Y >= AbsoluteRect.UpperLeftCorner.Y &&
             frameRect.UpperLeftCorner.Y <= AbsoluteRect.LowerRightCorner.Y)
         {
@@ -17,6 +17,7 @@
 
 #include "config/user_config.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/glwrap.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/widgets/model_view_widget.hpp"
 #include "graphics/irr_driver.hpp"
@@ -33,6 +34,9 @@ using namespace GUIEngine;
 using namespace irr::core;
 using namespace irr::gui;
 
+RTT* ModelViewWidget::m_shared_rtt     = NULL;
+int  ModelViewWidget::m_num_rtt_users  = 0;
+
 ModelViewWidget::ModelViewWidget() :
 IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO, false, false)
 {
@@ -41,8 +45,10 @@ IconButtonWidget(IconButtonWidget::SCALE_MODE_KEEP_TEXTURE_ASPECT_RATIO, false,
     m_camera = NULL;
     m_light = NULL;
     m_type = WTYPE_MODEL_VIEW;
-    m_rtt_provider = NULL;
+    m_preview_texture = 0;
     m_rotation_mode = ROTATE_OFF;
+    angle = 0;
+    m_rendered_angle = 0;
     
     // so that the base class doesn't complain there is no icon defined
     m_properties[PROP_ICON]="gui/main_help.png";
@@ -54,8 +60,7 @@ ModelViewWidget::~ModelViewWidget()
 {
     GUIEngine::needsUpdate.remove(this);
     
-    delete m_rtt_provider;
-    m_rtt_provider = NULL;
+    clearRttProvider();
 }
 // -----------------------------------------------------------------------------
 void ModelViewWidget::add()
@@ -159,28 +164,66 @@ void ModelViewWidget::update(float delta)
     if (!CVS->isGLSL())
         return;
     
-    if (m_rtt_provider == NULL)
-    {
-        std::string name = "model view ";
-        name += m_properties[PROP_ID].c_str();
-        
-        m_rtt_provider = new RTT(512, 512);
-    }
-    
     if (m_rtt_main_node == NULL)
     {
         setupRTTScene(m_models, m_model_location, m_model_scale, m_model_frames);
     }
-    
+    else if (m_frame_buffer != NULL && angle == m_rendered_angle)
+    {
+        // Nothing has changed since the last frame, keep the old preview
+        return;
+    }
+
+    if (m_preview_texture == 0)
+    {
+        if (m_shared_rtt == NULL)
+            m_shared_rtt = new RTT(512, 512);
+        m_num_rtt_users++;
+        glGenTextures(1, &m_preview_texture);
+    }
+
     m_rtt_main_node->setRotation(core::vector3df(0.0f, angle, 0.0f));
     
     m_rtt_main_node->setVisible(true);
 
-    m_frame_buffer = m_rtt_provider->render(m_camera, GUIEngine::getLatestDt());
+    FrameBuffer* rendered = m_shared_rtt->render(m_camera,
+                                                 GUIEngine::getLatestDt());
+    copyPreview(rendered);
+    m_rendered_angle = angle;
 
     m_rtt_main_node->setVisible(false);
 }
 
+// -----------------------------------------------------------------------------
+/** Copies the image rendered in the shared RTT into the preview texture of
+ *  this widget. The texture is created with the format of the rendered
+ *  image when it is copied for the first time.
+ *  \param rendered The frame buffer with the rendered image.
+ */
+void ModelViewWidget::copyPreview(const FrameBuffer *rendered)
+{
+    if (m_frame_buffer == NULL)
+    {
+        GLint format;
+        glBindTexture(GL_TEXTURE_2D, rendered->getRTT()[0]);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,
+                                 GL_TEXTURE_INTERNAL_FORMAT, &format);
+
+        glBindTexture(GL_TEXTURE_2D, m_preview_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, (GLsizei)rendered->getWidth(),
+                     (GLsizei)rendered->getHeight(), 0, GL_RGBA, GL_FLOAT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::vector<GLuint> textures;
+        textures.push_back(m_preview_texture);
+        m_frame_buffer = new FrameBuffer(textures, rendered->getWidth(),
+                                         rendered->getHeight());
+    }
+    FrameBuffer::Blit(*rendered, *m_frame_buffer);
+}   // copyPreview
+
 void ModelViewWidget::setupRTTScene(PtrVector<scene::IMesh, REF>& mesh,
                                     AlignedArray<Vec3>& mesh_location,
                                     AlignedArray<Vec3>& mesh_scale,
@@ -303,13 +346,25 @@ bool ModelViewWidget::isRotating()
 
 void ModelViewWidget::elementRemoved()
 {
-    delete m_rtt_provider;
-    m_rtt_provider = NULL;
+    clearRttProvider();
     IconButtonWidget::elementRemoved();
 }
 
+/** Frees the preview texture of this widget, and the shared RTT if no other
+ *  widget uses it anymore. The preview is rendered again in the next update.
+ */
 void ModelViewWidget::clearRttProvider()
 {
-    delete m_rtt_provider;
-    m_rtt_provider = NULL;
+    delete m_frame_buffer;
+    m_frame_buffer = NULL;
+    if (m_preview_texture == 0)
+        return;
+    glDeleteTextures(1, &m_preview_texture);
+    m_preview_texture = 0;
+    m_num_rtt_users--;
+    if (m_num_rtt_users == 0)
+    {
+        delete m_shared_rtt;
+        m_shared_rtt = NULL;
+    }
 }
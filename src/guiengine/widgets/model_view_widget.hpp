@@ -52,9 +52,23 @@ namespace GUIEngine
         
         video::ITexture* m_texture;
         
-        RTT* m_rtt_provider;
-        
+        /** The render target used by all model views. Only the final image
+         *  is copied into the preview texture of each widget, so the many
+         *  buffers of an RTT exist only once. */
+        static RTT* m_shared_rtt;
+
+        /** Number of widgets with a preview texture, the shared RTT is
+         *  deleted when the last one is released. */
+        static int m_num_rtt_users;
+
+        /** The texture the preview of this widget is copied into. */
+        GLuint m_preview_texture;
+
         float angle;
+
+        /** The angle the current preview was rendered with, used to avoid
+         *  rendering the same image again. */
+        float m_rendered_angle;
         
         bool m_rtt_unsupported;
         
@@ -64,8 +78,11 @@ namespace GUIEngine
 
         scene::ISceneNode          *m_light;
 
+        /** The frame buffer of m_preview_texture. */
         FrameBuffer                *m_frame_buffer;
 
+        void copyPreview(const FrameBuffer *rendered);
+
     public:
         
         LEAK_CHECK()
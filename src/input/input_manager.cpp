@@ -75,6 +75,7 @@ InputManager::InputManager() : m_mode(BOOTSTRAP),
     m_timer_in_use = false;
     m_master_player_only = false;
     m_timer = 0;
+    m_last_input_time = StkTime::getRealTime();
 
 }
 // -----------------------------------------------------------------------------
@@ -569,6 +570,9 @@ void InputManager::dispatchInput(Input::InputType type, int deviceID,
                                  Input::AxisDirection axisDirection, int value,
                                  bool shift_mask)
 {
+    if (value != 0)
+        m_last_input_time = StkTime::getRealTime();
+
     // Act different in input sensing mode.
     if (m_mode == INPUT_SENSE_KEYBOARD ||
         m_mode == INPUT_SENSE_GAMEPAD)
@@ -832,6 +836,14 @@ bool InputManager::masterPlayerOnly() const
  */
 EventPropagation InputManager::input(const SEvent& event)
 {
+    // Gamepad events are sent all the time, they are only counted as input
+    // in dispatchInput when a button or axis is actually used.
+    if (event.EventType == EET_KEY_INPUT_EVENT ||
+        event.EventType == EET_MOUSE_INPUT_EVENT)
+    {
+        m_last_input_time = StkTime::getRealTime();
+    }
+
     if (event.EventType == EET_JOYSTICK_INPUT_EVENT)
     {
         // Axes - FIXME, instead of checking all of them, ask the bindings
@@ -27,6 +27,7 @@
 #include "guiengine/event_handler.hpp"
 #include "input/input.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/time.hpp"
 
 class DeviceManager;
 
@@ -59,6 +60,9 @@ private:
 
     InputDriverMode  m_mode;
 
+    /** Real time of the last key press, mouse event or gamepad action. */
+    double           m_last_input_time;
+
     /** When at true, only the master player can play with menus */
     bool m_master_player_only;
 
@@ -98,6 +102,12 @@ public:
 
     void   update(float dt);
 
+    /** Returns the time in seconds since the last input of any player. */
+    double getTimeSinceLastInput() const
+    {
+        return StkTime::getRealTime() - m_last_input_time;
+    }   // getTimeSinceLastInput
+
     /** Returns the ID of the player that plays with the keyboard,
      *  or -1 if none. */
     int    getPlayerKeyboardID() const;
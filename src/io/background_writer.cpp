@@ -0,0 +1,235 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/background_writer.hpp"
+
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+
+#include <errno.h>
+#include <stdio.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#endif
+
+BackgroundWriter *BackgroundWriter::m_background_writer = NULL;
+
+// ----------------------------------------------------------------------------
+BackgroundWriter::BackgroundWriter()
+{
+    m_stop           = false;
+    m_thread_running = false;
+    pthread_cond_init(&m_cond_request, NULL);
+
+    pthread_attr_t  attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int error = pthread_create(&m_thread, &attr,
+                               &BackgroundWriter::writeLoop, this);
+    pthread_attr_destroy(&attr);
+    if (error)
+    {
+        Log::error("BackgroundWriter",
+                   "Could not create thread, error=%d, files will be "
+                   "written synchronously.", errno);
+        return;
+    }
+    m_thread_running = true;
+}   // BackgroundWriter
+
+// ----------------------------------------------------------------------------
+/** Writes all pending files and then stops the thread. */
+BackgroundWriter::~BackgroundWriter()
+{
+    if (m_thread_running)
+    {
+        m_pending.lock();
+        m_stop = true;
+        pthread_cond_signal(&m_cond_request);
+        m_pending.unlock();
+        pthread_join(m_thread, NULL);
+    }
+    pthread_cond_destroy(&m_cond_request);
+}   // ~BackgroundWriter
+
+// ----------------------------------------------------------------------------
+/** Hands the content of a file to the writing thread. If the file is still
+ *  waiting to be written, the old content is replaced. Nothing is done if
+ *  the content is the same as the content written last time.
+ *  \param filename Full path of the file to write.
+ *  \param content The new content of the file.
+ */
+void BackgroundWriter::write(const std::string &filename,
+                             const std::string &content)
+{
+    std::map<std::string, std::string>::iterator last =
+        m_last_content.find(filename);
+    if (last != m_last_content.end() && last->second == content)
+        return;
+    m_last_content[filename] = content;
+
+    if (!m_thread_running)
+    {
+        writeFile(filename, content);
+        return;
+    }
+    m_pending.lock();
+    // The new content replaces any data that was not written yet,
+    // including data to append
+    PendingWrite &pending = m_pending.getData()[filename];
+    pending.m_replace = true;
+    pending.m_data    = content;
+    pthread_cond_signal(&m_cond_request);
+    m_pending.unlock();
+}   // write
+
+// ----------------------------------------------------------------------------
+/** Hands data to the writing thread that is appended to a file. The file
+ *  is created if it does not exist. Data appended to a file that is still
+ *  waiting to be written is added to its pending content, so the order of
+ *  write() and append() calls is preserved.
+ *  \param filename Full path of the file.
+ *  \param data The data to append.
+ */
+void BackgroundWriter::append(const std::string &filename,
+                              const std::string &data)
+{
+    // The content of the file is not known anymore
+    m_last_content.erase(filename);
+
+    if (!m_thread_running)
+    {
+        appendFile(filename, data);
+        return;
+    }
+    m_pending.lock();
+    std::map<std::string, PendingWrite>::iterator i =
+        m_pending.getData().find(filename);
+    if (i == m_pending.getData().end())
+    {
+        PendingWrite &pending = m_pending.getData()[filename];
+        pending.m_replace = false;
+        pending.m_data    = data;
+    }
+    else
+        i->second.m_data += data;
+    pthread_cond_signal(&m_cond_request);
+    m_pending.unlock();
+}   // append
+
+// ----------------------------------------------------------------------------
+/** Writes the content to a temporary file, which then replaces the file.
+ *  \param filename Full path of the file to write.
+ *  \param content The content of the file.
+ *  \return True if the file was written.
+ */
+bool BackgroundWriter::writeFile(const std::string &filename,
+                                 const std::string &content)
+{
+    const std::string tmp_name = filename + ".tmp";
+    FILE *file = fopen(tmp_name.c_str(), "wb");
+    if (!file)
+    {
+        Log::error("BackgroundWriter", "Can't open '%s' for writing.",
+                   tmp_name.c_str());
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), file)
+              == content.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        Log::error("BackgroundWriter", "Failed to write '%s'.",
+                   tmp_name.c_str());
+        remove(tmp_name.c_str());
+        return false;
+    }
+#ifdef WIN32
+    ok = MoveFileExA(tmp_name.c_str(), filename.c_str(),
+                     MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = rename(tmp_name.c_str(), filename.c_str()) == 0;
+#endif
+    if (!ok)
+    {
+        Log::error("BackgroundWriter", "Failed to replace '%s'.",
+                   filename.c_str());
+        remove(tmp_name.c_str());
+    }
+    return ok;
+}   // writeFile
+
+// ----------------------------------------------------------------------------
+/** Appends data to a file, which is created if it does not exist.
+ *  \param filename Full path of the file.
+ *  \param data The data to append.
+ *  \return True if the data was written.
+ */
+bool BackgroundWriter::appendFile(const std::string &filename,
+                                  const std::string &data)
+{
+    FILE *file = fopen(filename.c_str(), "ab");
+    if (!file)
+    {
+        Log::error("BackgroundWriter", "Can't open '%s' for appending.",
+                   filename.c_str());
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        Log::error("BackgroundWriter", "Failed to append to '%s'.",
+                   filename.c_str());
+    return ok;
+}   // appendFile
+
+// ----------------------------------------------------------------------------
+/** The thread that writes the files.
+ *  \param obj Pointer to the background writer.
+ */
+void *BackgroundWriter::writeLoop(void *obj)
+{
+    BackgroundWriter *me = (BackgroundWriter*)obj;
+    profiler.setThreadName("BackgroundWriter");
+
+    std::map<std::string, PendingWrite> files;
+    me->m_pending.lock();
+    while (true)
+    {
+        while (me->m_pending.getData().empty() && !me->m_stop)
+            pthread_cond_wait(&me->m_cond_request, me->m_pending.getMutex());
+        if (me->m_pending.getData().empty())
+            break;   // m_stop is set and all files are written
+        files.swap(me->m_pending.getData());
+        me->m_pending.unlock();
+
+        std::map<std::string, PendingWrite>::const_iterator i;
+        for (i = files.begin(); i != files.end(); i++)
+        {
+            if (i->second.m_replace)
+                writeFile(i->first, i->second.m_data);
+            else
+                appendFile(i->first, i->second.m_data);
+        }
+        files.clear();
+
+        me->m_pending.lock();
+    }
+    me->m_pending.unlock();
+    return NULL;
+}   // writeLoop
@@ -0,0 +1,103 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_BACKGROUND_WRITER_HPP
+#define HEADER_BACKGROUND_WRITER_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/synchronised.hpp"
+
+#include <map>
+#include <pthread.h>
+#include <string>
+
+/**
+ * \brief Writes files (user config, players, highscores) in a separate
+ *  thread, so that slow storage does not cause a hitch in the main loop.
+ *  The content of a file is created by the main thread and handed to
+ *  write(). If the same file is written again before the thread got to it,
+ *  only the newest content is written. A file whose content did not change
+ *  since it was last written is not written again. Each file is written to
+ *  a temporary file first, which is then renamed, so a crash while writing
+ *  never leaves a truncated file behind. Data can also be appended to a
+ *  file (e.g. one changed record of the highscores), see append().
+ * \ingroup io
+ */
+class BackgroundWriter : public NoCopy
+{
+private:
+    /** Data that still needs to be written to a file. */
+    struct PendingWrite
+    {
+        /** True if m_data replaces the file, otherwise it is appended. */
+        bool        m_replace;
+        std::string m_data;
+    };   // PendingWrite
+
+    /** Files that still need to be written, mapping file name to the data
+     *  to write. */
+    Synchronised<std::map<std::string, PendingWrite> > m_pending;
+
+    /** The content last handed to the thread for each file, only used by
+     *  the main thread to skip writing unchanged files. */
+    std::map<std::string, std::string> m_last_content;
+
+    /** Signals the thread that there is data to write, and protected by the
+     *  mutex of m_pending. */
+    pthread_cond_t m_cond_request;
+
+    /** Set (protected by the mutex of m_pending) to stop the thread once
+     *  all files are written. */
+    bool           m_stop;
+
+    /** True if the writing thread is running. */
+    bool           m_thread_running;
+
+    /** The thread writing the files. */
+    pthread_t      m_thread;
+
+    static BackgroundWriter *m_background_writer;
+
+         BackgroundWriter();
+        ~BackgroundWriter();
+    static void *writeLoop(void *obj);
+    static bool  writeFile(const std::string &filename,
+                           const std::string &content);
+    static bool  appendFile(const std::string &filename,
+                            const std::string &data);
+
+public:
+    void write(const std::string &filename, const std::string &content);
+    void append(const std::string &filename, const std::string &data);
+
+    // ------------------------------------------------------------------------
+    static BackgroundWriter *get()
+    {
+        if (!m_background_writer)
+            m_background_writer = new BackgroundWriter();
+        return m_background_writer;
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Writes all pending files and stops the thread. */
+    static void destroy()
+    {
+        delete m_background_writer;
+        m_background_writer = NULL;
+    }   // destroy
+};   // BackgroundWriter
+
+#endif
@@ -0,0 +1,280 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/content_index.hpp"
+
+#include "config/user_config.hpp"
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "tracks/track_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <stdio.h>
+
+pthread_t                  ContentIndex::m_thread;
+std::atomic<ContentIndex*> ContentIndex::m_content_index(NULL);
+
+// ----------------------------------------------------------------------------
+/** Creates the content index. All search directories of karts and tracks
+ *  must be known at this stage.
+ */
+void ContentIndex::create()
+{
+    assert(!m_content_index);
+    m_thread        = pthread_self();
+    m_content_index = new ContentIndex();
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Destroys the content index once all content is loaded. Files which were
+ *  not taken by any manager are discarded.
+ */
+void ContentIndex::destroy()
+{
+    ContentIndex *index = m_content_index;
+    m_content_index = NULL;
+    delete index;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Lists all content directories and starts parsing the files.
+ */
+ContentIndex::ContentIndex()
+{
+    const double start = StkTime::getRealTime();
+
+    indexDir(file_manager->getAsset(FileManager::CHALLENGE, ""), ".challenge");
+    indexDir(file_manager->getAsset(FileManager::GRANDPRIX, ""), ".grandprix");
+    indexDir(file_manager->getGPDir(), ".grandprix");
+    indexDir(UserConfigParams::m_additional_gp_directory, ".grandprix");
+
+    // The karts are loaded after the tracks, so their files are parsed
+    // while the tracks are loaded.
+    indexContentDirs(TrackManager::getTrackSearchDirs(), "track.xml",
+                     /*parse_config*/false);
+    indexContentDirs(KartPropertiesManager::getKartSearchDirs(), "kart.xml",
+                     /*parse_config*/true);
+    parseFile(file_manager->getAsset("achievements.xml"));
+
+    // The jobs are only started once all directories are listed, since
+    // listing a directory changes the working directory of the process,
+    // which would break reading files with a relative path.
+    for (std::map<std::string, ParsedFile*>::iterator i = m_files.begin();
+         i != m_files.end(); i++)
+    {
+        ParsedFile *file = i->second;
+        const std::string &filename = i->first;
+        JobSystem::get()->run([file, filename]()
+                              {
+                                  file->m_root = readXMLTree(filename);
+                              },
+                              &file->m_counter);
+    }
+
+    Log::info("ContentIndex", "Indexed %d directories and %d files in %f "
+              "seconds.", (int)m_dirs.size(), (int)m_files.size(),
+              StkTime::getRealTime()-start);
+}   // ContentIndex
+
+// ----------------------------------------------------------------------------
+/** Waits for all parsing jobs and frees the trees that were not taken.
+ */
+ContentIndex::~ContentIndex()
+{
+    for (std::map<std::string, ParsedFile*>::iterator i = m_files.begin();
+         i != m_files.end(); i++)
+    {
+        JobSystem::get()->wait(&i->second->m_counter);
+        delete i->second->m_root.load();
+        delete i->second;
+    }
+}   // ~ContentIndex
+
+// ----------------------------------------------------------------------------
+/** Returns the key of a path in the index, so that e.g. 'a//b/' and 'a/b'
+ *  (which the managers use for the same directory) are found.
+ */
+std::string ContentIndex::getKey(const std::string &path)
+{
+    std::string key = path;
+    while (key.find("//") != std::string::npos)
+        key = StringUtils::replace(key, "//", "/");
+    if (key.size() > 1 && key[key.size() - 1] == '/')
+        key.erase(key.size() - 1);
+    return key;
+}   // getKey
+
+// ----------------------------------------------------------------------------
+/** Lists a directory and starts parsing all files with the given suffix.
+ *  \param dir The directory, it is ignored if it is empty.
+ *  \param suffix Suffix of the files to parse, or NULL to only list the
+ *         directory.
+ *  \return The names of all files in the directory.
+ */
+const std::set<std::string> &ContentIndex::indexDir(const std::string &dir,
+                                                    const char *suffix)
+{
+    static const std::set<std::string> empty;
+    if (dir.empty())
+        return empty;
+
+    std::set<std::string> &files = m_dirs[getKey(dir)];
+    file_manager->listFiles(files, dir);
+    if (suffix)
+    {
+        for (std::set<std::string>::const_iterator i = files.begin();
+             i != files.end(); i++)
+        {
+            if (StringUtils::hasSuffix(*i, suffix))
+                parseFile(getKey(dir) + "/" + *i);
+        }
+    }
+    return files;
+}   // indexDir
+
+// ----------------------------------------------------------------------------
+/** Indexes all karts or tracks. Each search directory is either a kart
+ *  (or track) itself, or contains one in each of its subdirectories, in the
+ *  same way the kart and track managers are looking for them. The
+ *  challenges in each kart and track directory are parsed.
+ *  \param search_dirs The search directories.
+ *  \param config_file Name of the file a kart or track directory contains.
+ *  \param parse_config True if config_file is parsed, too.
+ */
+void ContentIndex::indexContentDirs(const std::vector<std::string> &search_dirs,
+                                    const std::string &config_file,
+                                    bool parse_config)
+{
+    for (unsigned int i = 0; i < search_dirs.size(); i++)
+    {
+        const std::string dir = getKey(search_dirs[i]);
+        if (file_manager->fileExists(dir + "/" + config_file))
+        {
+            indexDir(dir, ".challenge");
+            if (parse_config)
+                parseFile(dir + "/" + config_file);
+            continue;
+        }
+
+        const std::set<std::string> &subdirs = indexDir(dir, NULL);
+        for (std::set<std::string>::const_iterator s = subdirs.begin();
+             s != subdirs.end(); s++)
+        {
+            if (*s == "." || *s == "..") continue;
+            const std::string subdir = dir + "/" + *s;
+            if (!file_manager->fileExists(subdir + "/" + config_file))
+                continue;
+            indexDir(subdir, ".challenge");
+            if (parse_config)
+                parseFile(subdir + "/" + config_file);
+        }
+    }   // for i < search_dirs.size()
+}   // indexContentDirs
+
+// ----------------------------------------------------------------------------
+/** Adds a file to the files that are parsed.
+ *  \param filename Full path of the file.
+ */
+void ContentIndex::parseFile(const std::string &filename)
+{
+    const std::string key = getKey(filename);
+    if (filename.empty() || m_files.find(key) != m_files.end())
+        return;
+    m_files[key] = new ParsedFile();
+}   // parseFile
+
+// ----------------------------------------------------------------------------
+/** Reads and parses a file, which is called from a job. It does not use
+ *  irrlicht's file system, which is only used by the main thread. If the
+ *  main thread lists a directory meanwhile (see the constructor), a file
+ *  with a relative path might not be found, which only means that it is
+ *  read again by the manager.
+ *  \return The tree, or NULL if the file can not be read or does not use
+ *          8 bit characters, in which case the manager reads the file as
+ *          usual (and reports any errors).
+ */
+XMLNode *ContentIndex::readXMLTree(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return NULL;
+    std::string content;
+    char buffer[16384];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        content.append(buffer, n);
+    fclose(file);
+    return XMLNode::createFromBuffer(&content, filename);
+}   // readXMLTree
+
+// ----------------------------------------------------------------------------
+/** Returns the content index if it exists and this is the main thread,
+ *  otherwise NULL. The index is only created and destroyed by the main
+ *  thread, so it can be used without locking.
+ */
+ContentIndex *ContentIndex::getForThisThread()
+{
+    ContentIndex *index = m_content_index;
+    if (!index || !pthread_equal(m_thread, pthread_self()))
+        return NULL;
+    return index;
+}   // getForThisThread
+
+// ----------------------------------------------------------------------------
+/** Returns the listing of a directory from the index.
+ *  \param result Returns the names of all files in the directory.
+ *  \param dir The directory.
+ *  \return False if the directory is not in the index, in which case the
+ *          caller must list it itself.
+ */
+bool ContentIndex::listFiles(std::set<std::string> *result,
+                             const std::string &dir)
+{
+    ContentIndex *index = getForThisThread();
+    if (!index)
+        return false;
+    std::map<std::string, std::set<std::string> >::const_iterator i =
+        index->m_dirs.find(getKey(dir));
+    if (i == index->m_dirs.end())
+        return false;
+    *result = i->second;
+    return true;
+}   // listFiles
+
+// ----------------------------------------------------------------------------
+/** Returns the parsed tree of a file, waiting for its job if necessary (and
+ *  running other jobs meanwhile). The caller takes over the tree, so each
+ *  file can only be taken once.
+ *  \param filename Full path of the file.
+ *  \return The tree, or NULL if the file is not in the index or could not
+ *          be parsed.
+ */
+XMLNode *ContentIndex::takeXMLTree(const std::string &filename)
+{
+    ContentIndex *index = getForThisThread();
+    if (!index)
+        return NULL;
+    std::map<std::string, ParsedFile*>::iterator i =
+        index->m_files.find(getKey(filename));
+    if (i == index->m_files.end())
+        return NULL;
+    JobSystem::get()->wait(&i->second->m_counter);
+    return i->second->m_root.exchange(NULL);
+}   // takeXMLTree
@@ -0,0 +1,91 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CONTENT_INDEX_HPP
+#define HEADER_CONTENT_INDEX_HPP
+
+#include "utils/job_system.hpp"
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <map>
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <vector>
+
+class XMLNode;
+
+/**
+ * \brief Enumerates all content that is loaded at startup (karts, tracks,
+ *  challenges, grand prix and achievements) in one pass over the
+ *  directories, and parses the independent XML files in parallel on the
+ *  job system while the main thread continues loading. The managers then
+ *  take the already parsed trees (see takeXMLTree) and the directory
+ *  listings (see listFiles) from the index, and only fall back to reading
+ *  the files themselves if a file is not in the index. The track.xml files
+ *  are not parsed here, since the track manager already takes the menu
+ *  data of unchanged tracks from its track index. The content index only
+ *  exists while starting STK (afterwards e.g. installed addons would not
+ *  be in it), and it is only used by the main thread.
+ * \ingroup io
+ */
+class ContentIndex : public NoCopy
+{
+private:
+    /** A file that is parsed by a job. */
+    struct ParsedFile
+    {
+        /** Counts the parsing job of this file. */
+        JobCounter             m_counter;
+        /** The parsed tree, or NULL if the file could not be parsed or
+         *  was already taken. */
+        std::atomic<XMLNode*>  m_root;
+        ParsedFile() : m_root(NULL) {}
+    };   // ParsedFile
+
+    /** The listing of each indexed directory. */
+    std::map<std::string, std::set<std::string> > m_dirs;
+
+    /** The files that are parsed, indexed by their full path. */
+    std::map<std::string, ParsedFile*>            m_files;
+
+    /** The thread which created the index, i.e. the main thread. */
+    static pthread_t                   m_thread;
+
+    static std::atomic<ContentIndex*>  m_content_index;
+
+         ContentIndex();
+        ~ContentIndex();
+    const std::set<std::string> &indexDir(const std::string &dir,
+                                          const char *suffix);
+    void indexContentDirs(const std::vector<std::string> &search_dirs,
+                          const std::string &config_file, bool parse_config);
+    void parseFile(const std::string &filename);
+    static XMLNode *readXMLTree(const std::string &filename);
+    static std::string getKey(const std::string &path);
+    static ContentIndex *getForThisThread();
+
+public:
+    static void     create();
+    static void     destroy();
+    static bool     listFiles(std::set<std::string> *result,
+                              const std::string &dir);
+    static XMLNode *takeXMLTree(const std::string &filename);
+};   // ContentIndex
+
+#endif
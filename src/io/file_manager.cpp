@@ -23,11 +23,15 @@
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "io/content_index.hpp"
+#include "io/mapped_file.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
+#include "utils/load_profiler.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 
 #include <irrlicht.h>
 
@@ -282,6 +286,7 @@ void FileManager::discoverPaths()
 void FileManager::init()
 {
     discoverPaths();
+    buildFileIndex();
     // Note that we can't push the texture search path in the constructor
     // since this also adds a file archive to the file system - and
     // m_file_system is deleted (in irr_driver)
@@ -362,11 +367,103 @@ FileManager::~FileManager()
     m_file_system = NULL;
 }   // ~FileManager
 
+//-----------------------------------------------------------------------------
+/** Returns the key of a path in the file index. On file systems which are
+ *  not case sensitive the key is in lower case.
+ */
+static std::string getFileIndexKey(const std::string &path)
+{
+#if defined(WIN32) || defined(__APPLE__)
+    return StringUtils::toLowerCase(path);
+#else
+    return path;
+#endif
+}   // getFileIndexKey
+
+//-----------------------------------------------------------------------------
+/** Creates the index of all files in the root directories. The data files
+ *  do not change while STK is running, so afterwards testing if a file
+ *  exists (which happens thousands of times when loading a track, once for
+ *  each directory in the search paths) does not need any disk access.
+ */
+void FileManager::buildFileIndex()
+{
+    const double start = StkTime::getRealTime();
+    m_file_index.clear();
+    m_indexed_dirs.clear();
+    for(unsigned int i=0; i<m_root_dirs.size(); i++)
+    {
+        if(!isDirectory(m_root_dirs[i])) continue;
+        m_indexed_dirs.push_back(m_root_dirs[i]);
+        addDirectoryToIndex(m_root_dirs[i]);
+    }
+    Log::info("FileManager", "Indexed %d files in %f seconds.",
+              (int)m_file_index.size(), StkTime::getRealTime()-start);
+}   // buildFileIndex
+
+//-----------------------------------------------------------------------------
+/** Adds all files and directories in the given directory (recursively) to
+ *  the file index.
+ *  \param dir The directory, must end with a '/'.
+ */
+void FileManager::addDirectoryToIndex(const std::string &dir)
+{
+    io::path previous_cwd = m_file_system->getWorkingDirectory();
+    if(!m_file_system->changeWorkingDirectoryTo(dir.c_str()))
+        return;
+    io::IFileList* files = m_file_system->createFileList();
+    m_file_system->changeWorkingDirectoryTo(previous_cwd);
+
+    std::vector<std::string> sub_dirs;
+    for(unsigned int n=0; n<files->getFileCount(); n++)
+    {
+        const std::string name = files->getFileName(n).c_str();
+        if(name=="." || name=="..") continue;
+        if(files->isDirectory(n))
+        {
+            m_file_index.insert(getFileIndexKey(dir+name+"/"));
+            sub_dirs.push_back(dir+name+"/");
+        }
+        else
+            m_file_index.insert(getFileIndexKey(dir+name));
+    }
+    files->drop();
+
+    for(unsigned int i=0; i<sub_dirs.size(); i++)
+        addDirectoryToIndex(sub_dirs[i]);
+}   // addDirectoryToIndex
+
+//-----------------------------------------------------------------------------
+/** Checks if a file is in the file index. Returns 1 if the file exists, 0
+ *  if it does not exist, and -1 if the index can not be used, i.e. if the
+ *  file is not in an indexed directory or if the path is not normalised.
+ *  \param path The path to look up.
+ */
+int FileManager::lookupFileIndex(const std::string &path) const
+{
+    for(unsigned int i=0; i<m_indexed_dirs.size(); i++)
+    {
+        if(!StringUtils::startsWith(path, m_indexed_dirs[i])) continue;
+
+        // Paths like 'a//b', 'a/../b' or 'a\\b' might still exist
+        if(path.find("//")!=std::string::npos ||
+           path.find("/.") !=std::string::npos ||
+           path.find('\\')!=std::string::npos)
+            return -1;
+        const std::string key = getFileIndexKey(path);
+        return m_file_index.count(key) || m_file_index.count(key+"/") ? 1 : 0;
+    }
+    return -1;
+}   // lookupFileIndex
+
 // ----------------------------------------------------------------------------
 /** Returns true if the specified file exists.
  */
 bool FileManager::fileExists(const std::string& path) const
 {
+    const int indexed = lookupFileIndex(path);
+    if(indexed>=0)
+        return indexed==1;
 #ifdef DEBUG
     bool exists = m_file_system->existFile(path.c_str());
     if(exists) return true;
@@ -399,14 +496,58 @@ void FileManager::addRootDirs(const std::string &roots)
 //-----------------------------------------------------------------------------
 io::IXMLReader *FileManager::createXMLReader(const std::string &filename)
 {
-    return m_file_system->createXMLReader(filename.c_str());
+    io::IReadFile *file = createReadFile(filename);
+    if (!file)
+        return NULL;
+    io::IXMLReader *reader = m_file_system->createXMLReader(file);
+    file->drop();
+    return reader;
 }   // getXMLReader
+
+//-----------------------------------------------------------------------------
+/** Opens a file for reading. Large files are mapped into memory, which
+ *  avoids copying them through the buffers of the C library, and the
+ *  mapped pages are shared with the page cache. Small files (for which
+ *  mapping costs more than reading) and files in archives are opened with
+ *  irrlicht's file system.
+ *  \param filename Name of the file.
+ *  \return The file, or NULL if it could not be opened. The caller must
+ *          drop() it.
+ */
+io::IReadFile *FileManager::createReadFile(const std::string &filename)
+{
+    // Files smaller than this are read instead of mapped
+    const off_t min_mapped_size = 64 * 1024;
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) == 0 &&
+        file_stat.st_size >= min_mapped_size)
+    {
+        MappedReadFile *file = new MappedReadFile(filename);
+        if (file->isValid())
+        {
+            if (LoadProfiler::isActive())
+                LoadProfiler::addBytes(LoadProfiler::getStage(),
+                                       file->getSize());
+            return file;
+        }
+        file->drop();
+    }
+    io::IReadFile *file = m_file_system->createAndOpenFile(filename.c_str());
+    if (file && LoadProfiler::isActive())
+        LoadProfiler::addBytes(LoadProfiler::getStage(), file->getSize());
+    return file;
+}   // createReadFile
 //-----------------------------------------------------------------------------
 /** Reads in a XML file and converts it into a XMLNode tree.
  *  \param filename Name of the XML file to read.
  */
 XMLNode *FileManager::createXMLTree(const std::string &filename)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_XML);
+    // At startup most data files are already parsed by the content index
+    XMLNode *parsed = ContentIndex::takeXMLTree(filename);
+    if (parsed)
+        return parsed;
     try
     {
         XMLNode* node = new XMLNode(filename);
@@ -428,16 +569,32 @@ XMLNode *FileManager::createXMLTree(const std::string &filename)
  */
 XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
 {
+    std::string copy = content;
+    return createXMLTreeFromBuffer(&copy);
+}   // createXMLTreeFromString
+
+//-----------------------------------------------------------------------------
+/** Creates an XMLNode tree from XML data in memory. 8 bit data is parsed in
+ *  place without a copy (see XMLNode::createFromBuffer), in which case the
+ *  content is moved into the tree and the string is empty afterwards.
+ *  \param content The XML data.
+ */
+XMLNode *FileManager::createXMLTreeFromBuffer(std::string *content)
+{
+    XMLNode *node = XMLNode::createFromBuffer(content);
+    if (node)
+        return node;
+
     try
     {
-        char *b = new char[content.size()];
+        char *b = new char[content->size()];
         assert(b);
-        memcpy(b, content.c_str(), content.size());
+        memcpy(b, content->c_str(), content->size());
         io::IReadFile * ireadfile =
-            m_file_system->createMemoryReadFile(b, (int)content.size(),
+            m_file_system->createMemoryReadFile(b, (int)content->size(),
                                                 "tempfile", true);
         io::IXMLReader * reader = m_file_system->createXMLReader(ireadfile);
-        XMLNode* node = new XMLNode(reader);
+        node = new XMLNode(reader);
         reader->drop();
         return node;
     }
@@ -445,11 +602,11 @@ XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
     {
         if (UserConfigParams::logMisc())
         {
-            Log::error("[FileManager]", "createXMLTreeFromString: %s", e.what());
+            Log::error("[FileManager]", "createXMLTreeFromBuffer: %s", e.what());
         }
         return NULL;
     }
-}   // createXMLTreeFromString
+}   // createXMLTreeFromBuffer
 
 //-----------------------------------------------------------------------------
 /** In order to add and later remove paths we have to specify the absolute
@@ -571,7 +728,10 @@ bool FileManager::findFile(std::string& full_path,
         i != search_path.rend(); ++i)
     {
         full_path = *i + file_name;
-        if(m_file_system->existFile(full_path.c_str())) return true;
+        const int indexed = lookupFileIndex(full_path);
+        if(indexed==1) return true;
+        if(indexed==-1 && m_file_system->existFile(full_path.c_str()))
+            return true;
     }
     full_path="";
     return false;
@@ -1099,6 +1259,75 @@ std::string FileManager::getTextureCacheLocation(const std::string& filename)
     return cached_file;
 }   // getTextureCacheLocation
 
+//-----------------------------------------------------------------------------
+/** Returns the location of the cached binary version of a mesh file (see
+ *  MeshTools::createMeshWithTangents). The directory structure is created
+ *  if it does not exist.
+ *  \param filename Full path of the mesh file.
+ */
+std::string FileManager::getMeshCacheLocation(const std::string& filename)
+{
+    std::string parent_dir = StringUtils::getPath(filename);
+    if (StringUtils::hasSuffix(parent_dir, "/"))
+        parent_dir = parent_dir.substr(0, parent_dir.size() - 1);
+    parent_dir = StringUtils::getBasename(parent_dir);
+
+    std::string cached_file = getCachedTexturesDir() + "meshes/"
+                            + parent_dir + "/";
+    checkAndCreateDirectoryP(cached_file);
+    return cached_file + StringUtils::getBasename(filename);
+}   // getMeshCacheLocation
+
+//-----------------------------------------------------------------------------
+/** Returns the location of a cached mini map image (see
+ *  QuadGraph::makeMiniMap). The directory is created if it does not exist.
+ *  \param name File name of the mini map image.
+ */
+std::string FileManager::getMiniMapCacheLocation(const std::string& name)
+{
+    std::string cached_dir = getCachedTexturesDir() + "minimaps/";
+    checkAndCreateDirectoryP(cached_dir);
+    return cached_dir + name;
+}   // getMiniMapCacheLocation
+
+//-----------------------------------------------------------------------------
+/** Returns the location of a cached driveline graph (see
+ *  QuadGraph::saveGraphCache). The directory is created if it does not
+ *  exist.
+ *  \param name File name of the cached graph.
+ */
+std::string FileManager::getGraphCacheLocation(const std::string& name)
+{
+    std::string cached_dir = getCachedTexturesDir() + "graphs/";
+    checkAndCreateDirectoryP(cached_dir);
+    return cached_dir + name;
+}   // getGraphCacheLocation
+
+//-----------------------------------------------------------------------------
+/** Returns the location of a cached height map (see Track::getHeightMap).
+ *  The directory is created if it does not exist.
+ *  \param name File name of the cached height map.
+ */
+std::string FileManager::getHeightMapCacheLocation(const std::string& name)
+{
+    std::string cached_dir = getCachedTexturesDir() + "heightmaps/";
+    checkAndCreateDirectoryP(cached_dir);
+    return cached_dir + name;
+}   // getHeightMapCacheLocation
+
+//-----------------------------------------------------------------------------
+/** Returns the location of a compiled translation catalogue (see
+ *  tinygettext::Dictionary::save_compiled). The directory is created if it
+ *  does not exist.
+ *  \param name File name of the compiled catalogue.
+ */
+std::string FileManager::getTranslationCacheLocation(const std::string& name)
+{
+    std::string cached_dir = getCachedTexturesDir() + "translations/";
+    checkAndCreateDirectoryP(cached_dir);
+    return cached_dir + name;
+}   // getTranslationCacheLocation
+
 //-----------------------------------------------------------------------------
 /** Returns the directory for addon files. */
 const std::string &FileManager::getAddonsDir() const
@@ -1332,3 +1561,15 @@ bool FileManager::fileIsNewer(const std::string& f1, const std::string& f2) cons
     return stat1.st_mtime > stat2.st_mtime;
 }   // fileIsNewer
 
+// ----------------------------------------------------------------------------
+/** Returns the modification time of a file, or 0 if the file does not exist.
+ *  \param filename Name of the file.
+ */
+int64_t FileManager::getModificationTime(const std::string &filename) const
+{
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) != 0)
+        return 0;
+    return (int64_t)file_stat.st_mtime;
+}   // getModificationTime
+
@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_set>
 
 #include <irrString.h>
 #include <IFileSystem.h>
@@ -78,6 +79,14 @@ private:
     /** Directory where user-defined grand prix are stored. */
     std::string       m_gp_dir;
 
+    /** All files and directories (directories with a trailing '/') below
+     *  the root directories, so that testing if a data file exists does
+     *  not need to access the disk. */
+    std::unordered_set<std::string> m_file_index;
+
+    /** The directories contained in m_file_index. */
+    std::vector<std::string> m_indexed_dirs;
+
     std::vector<std::string>
                       m_texture_search_path,
                       m_model_search_path,
@@ -97,6 +106,9 @@ private:
     void              checkAndCreateCachedTexturesDir();
     void              checkAndCreateGPDir();
     void              discoverPaths();
+    void              buildFileIndex();
+    void              addDirectoryToIndex(const std::string &dir);
+    int               lookupFileIndex(const std::string &path) const;
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
     std::string       checkAndCreateLinuxDir(const char *env_name,
                                              const char *dir_name,
@@ -110,13 +122,20 @@ public:
     void              init();
     static void       addRootDirs(const std::string &roots);
     io::IXMLReader   *createXMLReader(const std::string &filename);
+    io::IReadFile    *createReadFile(const std::string &filename);
     XMLNode          *createXMLTree(const std::string &filename);
     XMLNode          *createXMLTreeFromString(const std::string & content);
+    XMLNode          *createXMLTreeFromBuffer(std::string *content);
 
     std::string       getScreenshotDir() const;
     std::string       getCachedTexturesDir() const;
     std::string       getGPDir() const;
     std::string       getTextureCacheLocation(const std::string& filename);
+    std::string       getMeshCacheLocation(const std::string& filename);
+    std::string       getMiniMapCacheLocation(const std::string& name);
+    std::string       getGraphCacheLocation(const std::string& name);
+    std::string       getHeightMapCacheLocation(const std::string& name);
+    std::string       getTranslationCacheLocation(const std::string& name);
     bool              checkAndCreateDirectoryP(const std::string &path);
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
@@ -147,6 +166,7 @@ public:
     void       redirectOutput();
 
     bool       fileIsNewer(const std::string& f1, const std::string& f2) const;
+    int64_t    getModificationTime(const std::string &filename) const;
 
     // ------------------------------------------------------------------------
     /** Returns the irrlicht file system. */
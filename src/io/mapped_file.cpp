@@ -0,0 +1,138 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/mapped_file.hpp"
+
+#include <string.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------
+/** Maps a file into memory. If this fails (e.g. the file does not exist or
+ *  is empty), isValid() returns false.
+ *  \param filename Name of the file.
+ *  \param copy_on_write If the mapped data should be writable. Changes are
+ *         not written to the file.
+ */
+MappedFile::MappedFile(const std::string &filename, bool copy_on_write)
+{
+    m_data = NULL;
+    m_size = 0;
+#ifdef WIN32
+    m_mapping = NULL;
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping)
+        {
+            m_data = (char*)MapViewOfFile(m_mapping,
+                                          copy_on_write ? FILE_MAP_COPY
+                                                        : FILE_MAP_READ,
+                                          0, 0, 0);
+            if (m_data)
+                m_size = (size_t)size.QuadPart;
+        }
+    }
+    // The mapping keeps the file open
+    CloseHandle(file);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size,
+                          copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ,
+                          MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = (char*)data;
+            m_size = st.st_size;
+        }
+    }
+    // The mapping stays valid after the file is closed
+    close(fd);
+#endif
+}   // MappedFile
+
+// ----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+#ifdef WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+#else
+    if (m_data)
+        munmap(m_data, m_size);
+#endif
+}   // ~MappedFile
+
+// ============================================================================
+MappedReadFile::MappedReadFile(const std::string &filename)
+              : m_file(filename)
+{
+    m_filename = filename.c_str();
+    m_pos      = 0;
+}   // MappedReadFile
+
+// ----------------------------------------------------------------------------
+/** Copies data from the current position to a buffer.
+ *  \param buffer The buffer to copy to.
+ *  \param size_to_read Number of bytes to copy.
+ *  \return Number of bytes copied, which is less than size_to_read at the
+ *          end of the file.
+ */
+s32 MappedReadFile::read(void *buffer, u32 size_to_read)
+{
+    long amount = getSize() - m_pos;
+    if (amount > (long)size_to_read)
+        amount = size_to_read;
+    if (amount <= 0)
+        return 0;
+    memcpy(buffer, m_file.getData() + m_pos, amount);
+    m_pos += amount;
+    return (s32)amount;
+}   // read
+
+// ----------------------------------------------------------------------------
+/** Changes the read position.
+ *  \return False if the new position would be outside of the file.
+ */
+bool MappedReadFile::seek(long final_pos, bool relative_movement)
+{
+    const long pos = relative_movement ? m_pos + final_pos : final_pos;
+    if (pos < 0 || pos > getSize())
+        return false;
+    m_pos = pos;
+    return true;
+}   // seek
@@ -0,0 +1,108 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MAPPED_FILE_HPP
+#define HEADER_MAPPED_FILE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <IReadFile.h>
+
+#include <stddef.h>
+#include <string>
+
+using namespace irr;
+
+/**
+ * \brief A file that is mapped into memory, so that its content can be
+ *  accessed without copying it into a buffer first.
+ *  The mapping is read only by default. A copy-on-write mapping can be
+ *  requested for data that is modified in place (e.g. a serialised BVH):
+ *  then only the pages that are written to are copied, and the changes are
+ *  never written back to the file.
+ * \ingroup io
+ */
+class MappedFile : public NoCopy
+{
+private:
+    /** The mapped data, NULL if the file could not be mapped. */
+    char  *m_data;
+
+    /** Size of the file. */
+    size_t m_size;
+
+#ifdef WIN32
+    /** Handle of the file mapping object. */
+    void  *m_mapping;
+#endif
+
+public:
+             MappedFile(const std::string &filename, bool copy_on_write=false);
+            ~MappedFile();
+    // ------------------------------------------------------------------------
+    /** Returns true if the file was mapped. Empty files can not be mapped. */
+    bool        isValid() const { return m_data != NULL; }
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file. */
+    const char *getData() const { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file, which can only be modified if the
+     *  file was mapped copy-on-write. */
+    char       *getData()       { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the file. */
+    size_t      getSize() const { return m_size; }
+};   // MappedFile
+
+// ============================================================================
+/**
+ * \brief An irrlicht read file reading from a memory mapped file. Besides
+ *  the usual read functions it gives access to the mapped data, so that
+ *  loaders can parse a file in place.
+ * \ingroup io
+ */
+class MappedReadFile : public io::IReadFile
+{
+private:
+    MappedFile m_file;
+
+    /** The name of the file. */
+    io::path   m_filename;
+
+    /** The current read position. */
+    long       m_pos;
+
+public:
+    MappedReadFile(const std::string &filename);
+    virtual s32  read(void *buffer, u32 size_to_read);
+    virtual bool seek(long final_pos, bool relative_movement = false);
+    // ------------------------------------------------------------------------
+    virtual long getSize() const { return (long)m_file.getSize(); }
+    // ------------------------------------------------------------------------
+    virtual long getPos() const { return m_pos; }
+    // ------------------------------------------------------------------------
+    virtual const io::path &getFileName() const { return m_filename; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the file was mapped. */
+    bool isValid() const { return m_file.isValid(); }
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file, valid as long as this object
+     *  exists. */
+    const char *getData() const { return m_file.getData(); }
+};   // MappedReadFile
+
+#endif
@@ -18,6 +18,8 @@
 
 #include "io/utf_writer.hpp"
 
+#include "io/background_writer.hpp"
+
 #include <wchar.h>
 #include <string>
 #include <stdexcept>
@@ -25,10 +27,18 @@ using namespace irr;
 
 // ----------------------------------------------------------------------------
 
-UTFWriter::UTFWriter(const char* dest)
-         : m_base(dest, std::ios::out | std::ios::binary)
+/** Opens a file for writing.
+ *  \param dest Name of the file.
+ *  \param background If set, the data is only written when the file is
+ *         closed, and then by the BackgroundWriter thread, so that the
+ *         caller does not have to wait for the disk.
+ */
+UTFWriter::UTFWriter(const char* dest, bool background)
+         : m_filename(dest), m_background(background)
 {
-    if (!m_base.is_open())
+    if (!m_background)
+        m_base.open(dest, std::ios::out | std::ios::binary);
+    if (!m_background && !m_base.is_open())
     {
         throw std::runtime_error("Failed to open file for writing : " +
                                   std::string(dest));
@@ -38,14 +48,23 @@ UTFWriter::UTFWriter(const char* dest)
     // UTF-16 BOM is 0xFEFF; UTF-32 BOM is 0x0000FEFF. So this works in either case
     wchar_t BOM = 0xFEFF;
 
-    m_base.write((char *) &BOM, sizeof(wchar_t));
+    writeData((char *) &BOM, sizeof(wchar_t));
 }   // UTFWriter
 
+// ----------------------------------------------------------------------------
+void UTFWriter::writeData(const char *data, size_t size)
+{
+    if (m_background)
+        m_buffer.append(data, size);
+    else
+        m_base.write(data, size);
+}   // writeData
+
 // ----------------------------------------------------------------------------
 
 UTFWriter& UTFWriter::operator<< (const irr::core::stringw& txt)
 {
-    m_base.write((char *) txt.c_str(), txt.size() * sizeof(wchar_t));
+    writeData((char *) txt.c_str(), txt.size() * sizeof(wchar_t));
     return *this;
 }   // operator<< (stringw)
 
@@ -53,13 +72,20 @@ UTFWriter& UTFWriter::operator<< (const irr::core::stringw& txt)
 
 UTFWriter& UTFWriter::operator<< (const wchar_t*txt)
 {
-    m_base.write((char *) txt, wcslen(txt) * sizeof(wchar_t));
+    writeData((char *) txt, wcslen(txt) * sizeof(wchar_t));
     return *this;
 }   // operator<< (wchar_t)
 
 // ----------------------------------------------------------------------------
 void UTFWriter::close()
 {
+    if (m_background)
+    {
+        BackgroundWriter::get()->write(m_filename, m_buffer);
+        m_buffer.clear();
+        m_background = false;
+        return;
+    }
     m_base.close();
 }   // close
 
@@ -24,6 +24,7 @@
 #include <irrString.h>
 
 #include <fstream>
+#include <string>
 
 /**
  * \brief utility class used to write wide (UTF-16 or UTF-32, depending of size of wchar_t) XML files
@@ -34,9 +35,21 @@
 class UTFWriter
 {
     std::ofstream m_base;
+
+    /** Name of the file to write. */
+    std::string   m_filename;
+
+    /** If set, the data is collected in m_buffer and handed to the
+     *  BackgroundWriter when the file is closed. */
+    bool          m_background;
+
+    /** The data of a file written in the background. */
+    std::string   m_buffer;
+
+    void writeData(const char *data, size_t size);
 public:
 
-    UTFWriter(const char* dest);
+    UTFWriter(const char* dest, bool background=false);
     void close();
 
     UTFWriter& operator<< (const irr::core::stringw& txt);
@@ -63,7 +76,7 @@ public:
         return operator<<(StringUtils::toString<T>(t));
     }   // operator<< (template)
     // ------------------------------------------------------------------------
-    bool is_open() { return m_base.is_open(); }
+    bool is_open() { return m_background || m_base.is_open(); }
 };
 
 #endif
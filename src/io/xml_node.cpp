@@ -22,23 +22,129 @@
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <IReadFile.h>
+
+#include <pthread.h>
+#include <set>
 #include <stdexcept>
+#include <string.h>
+
+namespace
+{
+    /** All names of elements and attributes. Names are only added, never
+     *  removed, so pointers to them stay valid. */
+    std::set<std::string> g_interned_names;
+    /** XML files can be parsed in several threads at the same time. */
+    pthread_mutex_t       g_interned_names_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    // ------------------------------------------------------------------------
+    /** Returns the single copy of a name. */
+    const std::string *internName(const char *name, size_t length)
+    {
+        pthread_mutex_lock(&g_interned_names_mutex);
+        const std::string *s =
+            &*g_interned_names.insert(std::string(name, length)).first;
+        pthread_mutex_unlock(&g_interned_names_mutex);
+        return s;
+    }   // internName
+
+    // ------------------------------------------------------------------------
+    bool isSpace(char c)
+    {
+        return c==' ' || c=='\t' || c=='\n' || c=='\r';
+    }   // isSpace
+
+    // ------------------------------------------------------------------------
+    /** Skips to the character after the next occurrence of end, or to the
+     *  end of the buffer if end is not found. */
+    char *skipPast(char *p, const char *end)
+    {
+        char *found = strstr(p, end);
+        return found ? found+strlen(end) : p+strlen(p);
+    }   // skipPast
+
+    // ------------------------------------------------------------------------
+    /** Replaces the predefined XML entities in place, in the same way the
+     *  irrlicht XML reader does. Other entities (e.g. &#x...;) are kept,
+     *  they are decoded by XMLNode::getAndDecode. */
+    void replaceEntities(char *s)
+    {
+        static const char *entities[] = { "&amp;", "&lt;", "&gt;",
+                                          "&quot;", "&apos;"        };
+        static const char  chars[]    = { '&', '<', '>', '"', '\'' };
+        char *out = s;
+        while(*s)
+        {
+            bool replaced = false;
+            if(*s=='&')
+            {
+                for(unsigned int i=0; i<5; i++)
+                {
+                    const size_t len = strlen(entities[i]);
+                    if(strncmp(s, entities[i], len)==0)
+                    {
+                        *out++   = chars[i];
+                        s       += len;
+                        replaced = true;
+                        break;
+                    }
+                }
+            }
+            if(!replaced)
+                *out++ = *s++;
+        }
+        *out = 0;
+    }   // replaceEntities
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+/** Creates an empty node, used for the children of a parsed buffer. */
+XMLNode::XMLNode()
+{
+    m_name   = NULL;
+    m_buffer = NULL;
+}   // XMLNode
 
+// ----------------------------------------------------------------------------
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
     m_file_name = "[unknown]";
+    m_name      = internName("", 0);
+    m_buffer    = NULL;
 
     while(xml->getNodeType()!=io::EXN_ELEMENT && xml->read());
     readXML(xml);
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
-/** Reads a XML file and convert it into a XMLNode tree.
+/** Reads a XML file and convert it into a XMLNode tree. Files using 8 bit
+ *  characters (i.e. all data files) are read into one buffer and parsed in
+ *  place, files using wide characters (e.g. the config files written by
+ *  UTFWriter) are read using the irrlicht XML reader.
  *  \param filename Name of the XML file to read.
  */
 XMLNode::XMLNode(const std::string &filename)
 {
     m_file_name = filename;
+    m_name      = internName("", 0);
+    m_buffer    = NULL;
+
+    io::IReadFile *file = file_manager->createReadFile(filename);
+    if(file == NULL)
+    {
+        throw std::runtime_error("Cannot find file "+filename);
+    }
+    const long size = file->getSize();
+    char *buffer = new char[size+1];
+    const int n = file->read(buffer, size);
+    buffer[n > 0 ? n : 0] = 0;
+    file->drop();
+    if(parseBuffer(buffer))
+    {
+        m_buffer = buffer;
+        return;
+    }
+    delete [] buffer;
 
     io::IXMLReader *xml = file_manager->createXMLReader(filename);
     
@@ -74,6 +180,31 @@ XMLNode::XMLNode(const std::string &filename)
     xml->drop();
 }   // XMLNode
 
+// ----------------------------------------------------------------------------
+/** Parses XML data in memory (e.g. a reply of the addons server) in place,
+ *  without copying or widening it. The node takes over the content of the
+ *  string, which is empty afterwards.
+ *  \param content The XML data.
+ *  \param filename Name of the file the data was read from, which is used
+ *         in error messages.
+ *  \return The root node, or NULL if the data uses wide characters (in
+ *          which case the string is not changed).
+ */
+XMLNode *XMLNode::createFromBuffer(std::string *content,
+                                   const std::string &filename)
+{
+    XMLNode *node = new XMLNode();
+    node->m_file_name = filename;
+    node->m_name      = internName("", 0);
+    node->m_string_buffer.swap(*content);
+    // std::string is always 0 terminated
+    if(node->parseBuffer(&node->m_string_buffer[0]))
+        return node;
+    content->swap(node->m_string_buffer);
+    delete node;
+    return NULL;
+}   // createFromBuffer
+
 // ----------------------------------------------------------------------------
 /** Destructor. */
 XMLNode::~XMLNode()
@@ -83,6 +214,7 @@ XMLNode::~XMLNode()
         delete m_nodes[i];
     }
     m_nodes.clear();
+    delete [] m_buffer;
 }   // ~XMLNode
 
 // ----------------------------------------------------------------------------
@@ -91,13 +223,19 @@ XMLNode::~XMLNode()
  */
 void XMLNode::readXML(io::IXMLReader *xml)
 {
-    m_name = std::string(core::stringc(xml->getNodeName()).c_str());
+    core::stringc name = xml->getNodeName();
+    m_name = internName(name.c_str(), name.size());
 
     for(unsigned int i=0; i<xml->getAttributeCount(); i++)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
+        core::stringc attribute_name = xml->getAttributeName(i);
+        Attribute attribute;
+        attribute.m_name       = internName(attribute_name.c_str(),
+                                            attribute_name.size());
+        attribute.m_value      = NULL;
+        attribute.m_wide_index = (int)m_wide_values.size();
+        m_wide_values.push_back(xml->getAttributeValue(i));
+        m_attributes.push_back(attribute);
     }   // for i
 
     // If no children, we are done
@@ -128,6 +266,139 @@ void XMLNode::readXML(io::IXMLReader *xml)
     }   // while
 }   // readXML
 
+// ----------------------------------------------------------------------------
+/** Parses the content of a file using 8 bit characters in place: names are
+ *  interned, and attribute values are 0 terminated in the buffer, so no
+ *  strings need to be allocated. Values are only converted to the requested
+ *  type in get(). Like the irrlicht reader (which treats such files as
+ *  ASCII) no UTF-8 decoding is done. Returns false if the file uses wide
+ *  characters, in which case nothing is changed.
+ *  \param buffer The 0 terminated content of the file.
+ */
+bool XMLNode::parseBuffer(char *buffer)
+{
+    const unsigned char *u = (const unsigned char*)buffer;
+    if(!u[0]) return true;
+    // UTF-16 and UTF-32 files start with a byte order mark
+    if((u[0]==0xFF && u[1]==0xFE) || (u[0]==0xFE && u[1]==0xFF) ||
+       (u[0]==0x00 && u[1]==0x00 && u[2]==0xFE && u[3]==0xFF))
+        return false;
+
+    char *p = buffer;
+    // Skip a UTF-8 byte order mark
+    if(u[0]==0xEF && u[1]==0xBB && u[2]==0xBF)
+        p += 3;
+
+    bool is_first_element = true;
+    while(*p)
+    {
+        if(*p!='<')                   { p++; continue;             }
+        if(strncmp(p, "<!--", 4)==0)  { p = skipPast(p, "-->");    }
+        else if(p[1]=='?')            { p = skipPast(p, "?>");     }
+        else if(p[1]=='!' || p[1]=='/') { p = skipPast(p, ">");    }
+        else if(!is_first_element)
+        {
+            Log::warn("[XMLNode]",
+                      "More than one root element in '%s' - ignored.",
+                      m_file_name.c_str());
+            break;
+        }
+        else
+        {
+            p = parseElement(p+1);
+            is_first_element = false;
+        }
+    }   // while *p
+    return true;
+}   // parseBuffer
+
+// ----------------------------------------------------------------------------
+/** Parses one element and all its children from a buffer.
+ *  \param p Points to the name of the element (after the '<').
+ *  \return Pointer to the first character after the element.
+ */
+char *XMLNode::parseElement(char *p)
+{
+    char *start = p;
+    while(*p && !isSpace(*p) && *p!='/' && *p!='>') p++;
+    m_name = internName(start, p-start);
+
+    // Read all attributes
+    while(*p)
+    {
+        while(isSpace(*p)) p++;
+        if(*p=='/')
+        {
+            // Empty element, no children
+            return skipPast(p, ">");
+        }
+        if(*p=='>')
+        {
+            p++;
+            break;
+        }
+        if(!*p) return p;
+
+        start = p;
+        while(*p && !isSpace(*p) && *p!='=' && *p!='/' && *p!='>') p++;
+        const std::string *name = internName(start, p-start);
+        while(isSpace(*p)) p++;
+        if(*p!='=') continue;   // attribute without value, ignore
+        p++;
+        while(isSpace(*p)) p++;
+        const char quote = *p;
+        if(quote!='"' && quote!='\'') continue;
+        char *value = ++p;
+        while(*p && *p!=quote) p++;
+        if(*p) *p++ = 0;
+        replaceEntities(value);
+
+        Attribute attribute;
+        attribute.m_name       = name;
+        attribute.m_value      = value;
+        attribute.m_wide_index = -1;
+        m_attributes.push_back(attribute);
+    }   // while *p
+
+    // Read all children elements
+    while(*p)
+    {
+        if(*p!='<')                        { p++; continue;            }
+        if(strncmp(p, "<!--", 4)==0)       { p = skipPast(p, "-->");   }
+        else if(strncmp(p, "<![CDATA[", 9)==0) { p = skipPast(p, "]]>"); }
+        else if(p[1]=='?')                 { p = skipPast(p, "?>");    }
+        else if(p[1]=='!')                 { p = skipPast(p, ">");     }
+        else if(p[1]=='/')
+        {
+            // End of this element found.
+            return skipPast(p, ">");
+        }
+        else
+        {
+            XMLNode *n = new XMLNode();
+            n->m_file_name = m_file_name;
+            m_nodes.push_back(n);
+            p = n->parseElement(p+1);
+        }
+    }   // while *p
+    return p;
+}   // parseElement
+
+// ----------------------------------------------------------------------------
+/** Returns the attribute with the given name, or NULL if it does not exist.
+ *  If an attribute is defined more than once, the last definition is used.
+ *  \param name Name of the attribute.
+ */
+const XMLNode::Attribute *XMLNode::findAttribute(const std::string &name) const
+{
+    for(int i=(int)m_attributes.size()-1; i>=0; i--)
+    {
+        if(*m_attributes[i].m_name == name)
+            return &m_attributes[i];
+    }
+    return NULL;
+}   // findAttribute
+
 // ----------------------------------------------------------------------------
 /** Returns the i.th node.
  *  \param i Number of node to return.
@@ -174,31 +445,31 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const Attribute *a = findAttribute(attribute);
+    if(!a) return 0;
+    if(a->m_value)
+        *value = a->m_value;
+    else
+        *value = core::stringc(m_wide_values[a->m_wide_index]).c_str();
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
+    const Attribute *a = findAttribute(attribute);
+    if(!a) return 0;
+    // Widen each character, which is what the irrlicht reader does
+    if(a->m_value)
+        *value = core::stringw(a->m_value);
+    else
+        *value = m_wide_values[a->m_wide_index];
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::getAndDecode(const std::string &attribute, core::stringw *value) const
 {
-    if (m_attributes.empty()) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if (o == m_attributes.end()) return 0;
-    std::string raw_value = core::stringc(o->second).c_str();
+    std::string raw_value;
+    if (!get(attribute, &raw_value)) return 0;
     *value = StringUtils::xmlDecode(raw_value);
     return 1;
 }   // get
@@ -317,7 +588,7 @@ int XMLNode::get(const std::string &attribute, int32_t *value) const
     if (!StringUtils::parseString<int>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -333,7 +604,7 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
     if (!StringUtils::parseString<int64_t>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -350,7 +621,7 @@ int XMLNode::get(const std::string &attribute, uint16_t *value) const
     if (!StringUtils::parseString<uint16_t>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -366,7 +637,7 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
     if (!StringUtils::parseString<unsigned int>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -382,7 +653,7 @@ int XMLNode::get(const std::string &attribute, float *value) const
     if (!StringUtils::parseString<float>(s, value))
     {
         Log::warn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                    s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -441,7 +712,7 @@ int XMLNode::get(const std::string &attribute,
         if (!StringUtils::parseString<float>(v[i], &curr))
         {
             Log::warn("[XMLNode]", "WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s",
-                        v[i].c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                        v[i].c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
             return 0;
         }
 
@@ -472,7 +743,7 @@ int XMLNode::get(const std::string &attribute, std::vector<int> *value) const
         if (!StringUtils::parseString<int>(v[i], &val))
         {
             Log::warn("[XMLNode]", "WARNING: Expected int but found '%s' for attribute '%s' of node '%s'",
-                        v[i].c_str(), attribute.c_str(), m_name.c_str());
+                        v[i].c_str(), attribute.c_str(), m_name->c_str());
             return 0;
         }
 
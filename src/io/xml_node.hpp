@@ -46,17 +46,46 @@ class Vec3;
 class XMLNode : public NoCopy
 {
 private:
-    /** Name of this element. */
-    std::string                          m_name;
+    /** An attribute of an element. The names of all attributes (and
+     *  elements) are interned, so each name is only stored once. */
+    struct Attribute
+    {
+        /** The interned name of the attribute. */
+        const std::string *m_name;
+        /** The value, pointing into the buffer of the file. NULL if the
+         *  value is stored in m_wide_values. */
+        const char        *m_value;
+        /** Index of the value in m_wide_values if m_value is NULL. */
+        int                m_wide_index;
+    };   // Attribute
+
+    /** Name of this element (interned). */
+    const std::string                   *m_name;
     /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
+    std::vector<Attribute>               m_attributes;
+    /** Values of attributes read with an IXMLReader (i.e. from files
+     *  using wide characters), which can not point into a buffer. */
+    std::vector<core::stringw>           m_wide_values;
     /** List of all sub nodes. */
     std::vector<XMLNode *>               m_nodes;
 
+    /** Content of the file, which is parsed in place: all attribute values
+     *  point into this buffer. Only allocated in the root node. */
+    char                                *m_buffer;
+
+    /** Used instead of m_buffer by a root node parsed from a string (see
+     *  createFromBuffer), so that the string does not need to be copied. */
+    std::string                          m_string_buffer;
+
     void readXML(io::IXMLReader *xml);
+    bool parseBuffer(char *buffer);
+    char *parseElement(char *p);
+    const Attribute *findAttribute(const std::string &name) const;
 
     std::string                          m_file_name;
 
+    XMLNode();
+
 public:
          LEAK_CHECK();
          XMLNode(io::IXMLReader *xml);
@@ -66,7 +95,10 @@ public:
 
         ~XMLNode();
 
-    const std::string &getName() const {return m_name; }
+    static XMLNode *createFromBuffer(std::string *content,
+                                     const std::string &filename="[memory]");
+
+    const std::string &getName() const {return *m_name; }
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
     const XMLNode     *getNode(unsigned int i) const;
@@ -125,7 +125,8 @@ bool Bowling::updateAndDelete(float dt)
     const AbstractKart *kart=0;
     Vec3        direction;
     float       minDistance;
-    getClosestKart(&kart, &minDistance, &direction);
+    getClosestKart(&kart, &minDistance, &direction, /*inFrontOf*/NULL,
+                   /*backwards*/false, sqrtf(m_st_max_distance_squared));
     if(kart && minDistance<m_st_max_distance_squared)   // move bowling towards kart
     {
         // limit angle, so that the bowling ball does not turn
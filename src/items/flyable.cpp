@@ -21,6 +21,7 @@
 
 #include "items/flyable.hpp"
 
+#include <algorithm>
 #include <math.h>
 
 #include <IMeshManipulator.h>
@@ -38,7 +39,6 @@
 #include "physics/physics.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
-#include "utils/string_utils.hpp"
 #include "utils/vs.hpp"
 
 // static variables:
@@ -73,9 +73,8 @@ Flyable::Flyable(AbstractKart *kart, PowerupManager::PowerupType type,
     m_do_terrain_info              = true;
     m_max_lifespan = -1;
 
-    // Add the graphical model
-    setNode(irr_driver->addMesh(m_st_model[type], StringUtils::insertValues("flyable_%i", (int)type)));
-    irr_driver->applyObjectPassShader(getNode());
+    // Add the graphical model, reusing the node of an old flyable if possible
+    setNode(projectile_manager->getFlyableNode(type, m_st_model[type]));
 #ifdef DEBUG
     std::string debug_name("flyable: ");
     debug_name += type;
@@ -197,6 +196,13 @@ Flyable::~Flyable()
 {
     if(m_shape) delete m_shape;
     World::getWorld()->getPhysics()->removeBody(getBody());
+    // Give the scene node back to the projectile manager, so that it is not
+    // removed by the Moveable destructor.
+    if(m_node)
+    {
+        projectile_manager->releaseFlyableNode(m_type, m_node);
+        m_node = NULL;
+    }
 }   // ~Flyable
 
 //-----------------------------------------------------------------------------
@@ -204,12 +210,17 @@ Flyable::~Flyable()
  *  All 3 parameters first are of type 'out'. 'inFrontOf' can be set if you
  *  wish to know the closest kart in front of some karts (will ignore those
  *  behind). Useful e.g. for throwing projectiles in front only.
+ *  If the search is limited to a distance (which it always is if inFrontOf
+ *  is set), the candidates are taken from the physics broadphase, so that
+ *  only karts close by are tested.
+ *  \param max_distance If positive, karts further away are ignored.
  */
 
 void Flyable::getClosestKart(const AbstractKart **minKart,
                              float *minDistSquared, Vec3 *minDelta,
                              const AbstractKart* inFrontOf,
-                             const bool backwards) const
+                             const bool backwards,
+                             float max_distance) const
 {
     btTransform trans_projectile = (inFrontOf != NULL ? inFrontOf->getTrans()
                                                       : getTrans());
@@ -217,10 +228,26 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
     *minDistSquared = 999999.9f;
     *minKart = NULL;
 
+    // Karts more than 50 away from inFrontOf are not aimed at
+    if(inFrontOf != NULL && (max_distance < 0 || max_distance > 50))
+        max_distance = 50;
+
     World *world = World::getWorld();
-    for(unsigned int i=0 ; i<world->getNumKarts(); i++ )
+    std::vector<AbstractKart*> karts;
+    if(max_distance >= 0)
+    {
+        world->getPhysics()->getKartsInSphere(trans_projectile.getOrigin(),
+                                              max_distance, &karts);
+    }
+    else
     {
-        AbstractKart *kart = world->getKart(i);
+        for(unsigned int i=0 ; i<world->getNumKarts(); i++ )
+            karts.push_back(world->getKart(i));
+    }
+
+    for(unsigned int i=0 ; i<karts.size(); i++ )
+    {
+        AbstractKart *kart = karts[i];
         // If a kart has star effect shown, the kart is immune, so
         // it is not considered a target anymore.
         if(kart->isEliminated() || kart == m_owner ||
@@ -262,7 +289,7 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
             *minKart  = kart;
             *minDelta = delta;
         }
-    }  // for i<getNumKarts
+    }  // for i<karts.size()
 
 }   // getClosestKart
 
@@ -457,14 +484,19 @@ void Flyable::explode(AbstractKart *kart_hit, PhysicalObject *object,
     // Apply explosion effect
     // ----------------------
     World *world = World::getWorld();
-    for ( unsigned int i = 0 ; i < world->getNumKarts() ; i++ )
+    // Only karts within the largest explosion radius can be affected, so
+    // they are found with one query of the physics broadphase instead of
+    // testing all karts (ExplosionAnimation tests the exact radius).
+    std::vector<AbstractKart*> karts;
+    const float radius = world->getMaxExplosionRadius();
+    if(secondary_hits)
+        world->getPhysics()->getKartsInSphere(getXYZ(), radius, &karts);
+    if(kart_hit && std::find(karts.begin(), karts.end(), kart_hit)==karts.end())
+        karts.push_back(kart_hit);
+
+    for ( unsigned int i = 0 ; i < karts.size() ; i++ )
     {
-        AbstractKart *kart = world->getKart(i);
-
-        // If no secondary hits should be done, only hit the
-        // direct hit kart.
-        if(!secondary_hits && kart!=kart_hit)
-            continue;
+        AbstractKart *kart = karts[i];
 
         // Handle the actual explosion. The kart that fired a flyable will
         // only be affected if it's a direct hit. This allows karts to use
@@ -480,7 +512,8 @@ void Flyable::explode(AbstractKart *kart_hit, PhysicalObject *object,
             }
         }
     }
-    world->getTrack()->handleExplosion(getXYZ(), object, secondary_hits);
+    world->getTrack()->handleExplosion(getXYZ(), radius, object,
+                                       secondary_hits);
 }   // explode
 
 // ----------------------------------------------------------------------------
@@ -135,7 +135,8 @@ protected:
                                      float *minDistSquared,
                                      Vec3 *minDelta,
                                      const AbstractKart* inFrontOf=NULL,
-                                     const bool backwards=false) const;
+                                     const bool backwards=false,
+                                     float max_distance=-1.0f) const;
 
     void getLinearKartItemIntersection(const Vec3 &origin,
                                        const AbstractKart *target_kart,
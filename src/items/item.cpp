@@ -35,15 +35,12 @@
 Item::Item(ItemType type, const Vec3& xyz, const Vec3& normal,
            scene::IMesh* mesh, scene::IMesh* lowres_mesh)
 {
-    assert(type != ITEM_TRIGGER); // use other constructor for that
-
     m_distance_2        = 0.8f;
     initItem(type, xyz);
     // Sets heading to 0, and sets pitch and roll depending on the normal. */
     m_original_hpr      = Vec3(0, normal);
     m_original_mesh     = mesh;
     m_original_lowmesh  = lowres_mesh;
-    m_listener          = NULL;
 
     LODNode* lodnode    = new LODNode("item",
                                       irr_driver->getSceneManager()->getRootSceneNode(),
@@ -80,24 +77,6 @@ Item::Item(ItemType type, const Vec3& xyz, const Vec3& normal,
     m_node->grab();
 }   // Item(type, xyz, normal, mesh, lowres_mesh)
 
-//-----------------------------------------------------------------------------
-
-/** \brief Constructor to create a trigger item.
-  * Trigger items are invisible and can be used to trigger a behavior when
-  * approaching a point.
-  */
-Item::Item(const Vec3& xyz, float distance, TriggerItemListener* trigger)
-{
-    m_distance_2        = distance*distance;
-    initItem(ITEM_TRIGGER, xyz);
-    // Sets heading to 0, and sets pitch and roll depending on the normal. */
-    m_original_hpr      = Vec3(0, 0, 0);
-    m_original_mesh     = NULL;
-    m_original_lowmesh  = NULL;
-    m_node              = NULL;
-    m_listener          = trigger;
-}   // Item(xyz, distance, trigger)
-
 //-----------------------------------------------------------------------------
 /** Initialises the item. Note that m_distance_2 must be defined before calling
  *  this function, since it pre-computes some values based on this.
@@ -114,7 +93,7 @@ void Item::initItem(ItemType type, const Vec3 &xyz)
     m_deactive_time     = 0;
     m_time_till_return  = 0.0f;  // not strictly necessary, see isCollected()
     m_emitter           = NULL;
-    m_rotate            = (type!=ITEM_BUBBLEGUM) && (type!=ITEM_TRIGGER);
+    m_rotate            = (type!=ITEM_BUBBLEGUM);
     switch(m_type)
     {
     case ITEM_BUBBLEGUM:
@@ -167,7 +146,7 @@ void Item::initItem(ItemType type, const Vec3 &xyz)
 void Item::setType(ItemType type)
 {
     m_type   = type;
-    m_rotate = (type!=ITEM_BUBBLEGUM) && (type!=ITEM_TRIGGER);
+    m_rotate = (type!=ITEM_BUBBLEGUM);
 }   // setType
 
 //-----------------------------------------------------------------------------
@@ -177,8 +156,8 @@ void Item::setType(ItemType type)
  */
 void Item::switchTo(ItemType type, scene::IMesh *mesh, scene::IMesh *lowmesh)
 {
-    // triggers and easter eggs should not be switched
-    if (m_type == ITEM_TRIGGER || m_type == ITEM_EASTER_EGG) return;
+    // easter eggs should not be switched
+    if (m_type == ITEM_EASTER_EGG) return;
 
     m_original_type = m_type;
     setType(type);
@@ -202,9 +181,6 @@ void Item::switchTo(ItemType type, scene::IMesh *mesh, scene::IMesh *lowmesh)
  */
 void Item::switchBack()
 {
-    // triggers should not be switched
-    if (m_type == ITEM_TRIGGER) return;
-
     // If the item is not switched, do nothing. This can happen if a bubble
     // gum is dropped while items are switched - when switching back, this
     // bubble gum has no original type.
@@ -372,11 +348,6 @@ void Item::collected(const AbstractKart *kart, float t)
         }
     }
 
-    if (m_listener != NULL)
-    {
-        m_listener->onTriggerItemApproached(this);
-    }
-
     if (dynamic_cast<ThreeStrikesBattle*>(World::getWorld()) != NULL)
     {
         m_time_till_return *= 3;
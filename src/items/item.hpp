@@ -43,17 +43,6 @@ class Item;
 
 // -----------------------------------------------------------------------------
 
-/**
- * \ingroup items
- * \brief Listener class to go with Items of type ITEM_TRIGGER
- */
-class TriggerItemListener
-{
-public:
-    virtual ~TriggerItemListener() {}
-    virtual void onTriggerItemApproached(Item* who) = 0;
-};
-
 /**
   * \ingroup items
   */
@@ -77,11 +66,7 @@ public:
 
         /** For easter egg mode only. */
         ITEM_EASTER_EGG,
-        /** An invisible item that can be used to trigger some behavior when
-          * approaching a point
-          */
-        ITEM_TRIGGER,
-        ITEM_LAST = ITEM_TRIGGER,
+        ITEM_LAST = ITEM_EASTER_EGG,
         ITEM_COUNT,
         ITEM_NONE
     };
@@ -143,9 +128,6 @@ private:
      *  deleted, and <0 that the item will never be deleted. */
     int           m_disappear_counter;
 
-    /** callback used if type == ITEM_TRIGGER */
-    TriggerItemListener* m_listener;
-
     /** square distance at which item is collected */
     float         m_distance_2;
 
@@ -168,8 +150,6 @@ private:
 public:
                   Item(ItemType type, const Vec3& xyz, const Vec3& normal,
                        scene::IMesh* mesh, scene::IMesh* lowres_mesh);
-                  Item(const Vec3& xyz, float distance,
-                       TriggerItemListener* trigger);
     virtual       ~Item ();
     void          update  (float delta);
     virtual void  collected(const AbstractKart *kart, float t=2.0f);
@@ -269,6 +249,9 @@ public:
     /** Returns the XYZ position of the item. */
     const Vec3&   getXYZ() const { return m_xyz; }
     // ------------------------------------------------------------------------
+    /** Returns the square of the distance at which the item is collected. */
+    float         getDistance2() const { return m_distance_2; }
+    // ------------------------------------------------------------------------
     /** Returns the index of the graph node this item is on. */
     int           getGraphNode() const { return m_graph_node; }
     // ------------------------------------------------------------------------
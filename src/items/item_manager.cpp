@@ -18,6 +18,8 @@
 
 #include "items/item_manager.hpp"
 
+#include <algorithm>
+#include <math.h>
 #include <stdexcept>
 #include <string>
 #include <sstream>
@@ -79,7 +81,6 @@ void ItemManager::loadDefaultItemMeshes()
     item_names[Item::ITEM_BUBBLEGUM  ] = "bubblegum";
     item_names[Item::ITEM_NITRO_BIG  ] = "nitro-big";
     item_names[Item::ITEM_NITRO_SMALL] = "nitro-small";
-    item_names[Item::ITEM_TRIGGER    ] = "trigger";
     item_names[Item::ITEM_BUBBLEGUM_NOLOK] = "bubblegum-nolok";
     item_names[Item::ITEM_EASTER_EGG ] = "easter-egg";
 
@@ -139,12 +140,15 @@ void ItemManager::removeTextures()
 }   // removeTextures
 
 
+const float ItemManager::GRID_CELL_SIZE = 8.0f;
+
 // ============================================================================
 /** Creates a new instance of the item manager. This is done at startup
  *  of each race. */
 ItemManager::ItemManager()
 {
     m_switch_time = -1.0f;
+    m_item_grid.resize(GRID_BUCKETS);
     // The actual loading is done in loadDefaultItems
 
     // Prepare the switch to array, which stores which item should be
@@ -197,6 +201,47 @@ ItemManager::~ItemManager()
     m_all_items.clear();
 }   // ~ItemManager
 
+//-----------------------------------------------------------------------------
+/** Returns the bucket of the spatial hash a cell is mapped to.
+ *  \param x, z Coordinates of the cell.
+ */
+unsigned int ItemManager::getGridBucket(int x, int z) const
+{
+    return ((unsigned int)x*73856093u ^ (unsigned int)z*19349663u)
+          & (GRID_BUCKETS-1);
+}   // getGridBucket
+
+//-----------------------------------------------------------------------------
+/** Determines the buckets of the spatial hash an item must be stored in,
+ *  i.e. the buckets of all cells that overlap the area in which the item
+ *  can be collected.
+ *  \param item The item.
+ *  \param buckets Returns the sorted list of buckets (without duplicates).
+ *  
+eturn False if the item is too large to be stored in the hash.
+ */
+bool ItemManager::getGridBuckets(const Item *item,
+                                 std::vector<unsigned int> *buckets) const
+{
+    const Vec3 &xyz = item->getXYZ();
+    const float r   = sqrtf(item->getDistance2());
+    const int x0 = (int)floorf((xyz.getX()-r)/GRID_CELL_SIZE);
+    const int x1 = (int)floorf((xyz.getX()+r)/GRID_CELL_SIZE);
+    const int z0 = (int)floorf((xyz.getZ()-r)/GRID_CELL_SIZE);
+    const int z1 = (int)floorf((xyz.getZ()+r)/GRID_CELL_SIZE);
+    if(x1-x0 >= GRID_MAX_CELLS || z1-z0 >= GRID_MAX_CELLS)
+        return false;
+
+    buckets->clear();
+    for(int x=x0; x<=x1; x++)
+        for(int z=z0; z<=z1; z++)
+            buckets->push_back(getGridBucket(x, z));
+    std::sort(buckets->begin(), buckets->end());
+    buckets->erase(std::unique(buckets->begin(), buckets->end()),
+                   buckets->end());
+    return true;
+}   // getGridBuckets
+
 //-----------------------------------------------------------------------------
 /** Inserts the new item into the items management data structures, if possible
  *  reusing an existing, unused entry (e.g. due to a removed bubble gum). Then
@@ -231,6 +276,16 @@ void ItemManager::insertItem(Item *item)
         else  // otherwise store it in the 'outside' index
             (*m_items_in_quads)[m_items_in_quads->size()-1].push_back(item);
     }   // if m_items_in_quads
+
+    // And into the spatial hash used to detect item hits
+    std::vector<unsigned int> buckets;
+    if(getGridBuckets(item, &buckets))
+    {
+        for(unsigned int i=0; i<buckets.size(); i++)
+            m_item_grid[buckets[i]].push_back(item);
+    }
+    else
+        m_large_items.push_back(item);
 }   // insertItem
 
 //-----------------------------------------------------------------------------
@@ -264,20 +319,6 @@ Item* ItemManager::newItem(Item::ItemType type, const Vec3& xyz,
     return item;
 }   // newItem
 
-//-----------------------------------------------------------------------------
-/** Creates a new trigger item.
- *  \param xyz  Position of the item.
- */
-Item* ItemManager::newItem(const Vec3& xyz, float distance,
-                           TriggerItemListener* listener)
-{
-    Item* item;
-    item = new Item(xyz, distance, listener);
-    insertItem(item);
-
-    return item;
-}   // newItem
-
 //-----------------------------------------------------------------------------
 /** Set an item as collected.
  *  This function is called on the server when an item is collected, or on
@@ -300,33 +341,43 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
+    // Only items in the bucket of the spatial hash that contains the kart
+    // can be hit, plus the few items too large to be stored in the hash.
+    const Vec3 &xyz = kart->getXYZ();
+    unsigned int bucket =
+        getGridBucket((int)floorf(xyz.getX()/GRID_CELL_SIZE),
+                      (int)floorf(xyz.getZ()/GRID_CELL_SIZE));
+    checkItemHit(kart, m_item_grid[bucket]);
+    checkItemHit(kart, m_large_items);
+}   // checkItemHit
 
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+//-----------------------------------------------------------------------------
+/** Checks if the given kart collects any of the items in a list. Items are
+ *  accessed by index, since collecting an item can add new items (e.g. a
+ *  bubble gum) to the list.
+ *  \param kart Pointer to the kart.
+ *  \param items The items to test.
+ */
+void ItemManager::checkItemHit(AbstractKart* kart, const AllItemTypes &items)
+{
+    for(unsigned int i=0; i<items.size(); i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        Item *item = items[i];
+        if(item->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if(item->hitKart(kart->getXYZ(), kart))
         {
             // if we're not playing online, pick the item.
             if (!NetworkWorld::getInstance()->isRunning())
-                collectedItem(*i, kart);
+                collectedItem(item, kart);
             else if (NetworkManager::getInstance()->isServer())
             {
-                collectedItem(*i, kart);
-                NetworkWorld::getInstance()->collectedItem(*i, kart);
+                collectedItem(item, kart);
+                NetworkWorld::getInstance()->collectedItem(item, kart);
             }
         }   // if hit
-    }   // for m_all_items
+    }   // for i
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -430,6 +481,21 @@ void ItemManager::deleteItem(Item *item)
         items.erase(it);
     }   // if m_items_in_quads
 
+    // Then remove it from the spatial hash
+    std::vector<unsigned int> buckets;
+    if(!getGridBuckets(item, &buckets))
+    {
+        m_large_items.erase(std::find(m_large_items.begin(),
+                                      m_large_items.end(), item));
+    }
+    for(unsigned int i=0; i<buckets.size(); i++)
+    {
+        AllItemTypes &items = m_item_grid[buckets[i]];
+        AllItemTypes::iterator it = std::find(items.begin(), items.end(),item);
+        assert(it!=items.end());
+        items.erase(it);
+    }
+
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
@@ -82,6 +82,29 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Size of a cell of the spatial hash used to find the items a kart
+     *  might hit. */
+    static const float GRID_CELL_SIZE;
+
+    /** Number of buckets of the spatial hash (a power of two). */
+    static const unsigned int GRID_BUCKETS = 256;
+
+    /** Items covering more than this number of cells in each direction
+     *  are not stored in the spatial hash. */
+    static const int GRID_MAX_CELLS = 4;
+
+    /** A spatial hash of the items: the ground plane is divided into cells
+     *  of GRID_CELL_SIZE, and each cell is mapped to a bucket. An item is
+     *  stored in the buckets of all cells its collection distance overlaps,
+     *  so only the items in the bucket of a kart can be hit by it. Since
+     *  items do not move, the hash only changes when items are added or
+     *  removed; switching items does not affect it. */
+    std::vector< AllItemTypes > m_item_grid;
+
+    /** Items which are too large to be stored in m_item_grid. They are
+     *  tested against all karts. */
+    AllItemTypes m_large_items;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -91,6 +114,10 @@ private:
 
     void  insertItem(Item *item);
     void  deleteItem(Item *item);
+    bool  getGridBuckets(const Item *item,
+                         std::vector<unsigned int> *buckets) const;
+    unsigned int getGridBucket(int x, int z) const;
+    void  checkItemHit(AbstractKart* kart, const AllItemTypes &items);
 
     // Make those private so only create/destroy functions can call them.
                    ItemManager();
@@ -101,8 +128,6 @@ public:
     Item*          newItem         (Item::ItemType type, const Vec3& xyz,
                                     const Vec3 &normal,
                                     AbstractKart* parent=NULL);
-    Item*          newItem         (const Vec3& xyz, float distance,
-                                    TriggerItemListener* listener);
     void           update          (float delta);
     void           checkItemHit    (AbstractKart* kart);
     void           reset           ();
@@ -20,6 +20,7 @@
 
 #include "graphics/explosion.hpp"
 #include "graphics/hit_effect.hpp"
+#include "graphics/irr_driver.hpp"
 #include "items/bowling.hpp"
 #include "items/cake.hpp"
 #include "items/plunger.hpp"
@@ -27,6 +28,9 @@
 #include "items/powerup.hpp"
 #include "items/rubber_ball.hpp"
 #include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
+#include "physics/physics.hpp"
+#include "utils/string_utils.hpp"
 
 ProjectileManager *projectile_manager=0;
 
@@ -59,6 +63,14 @@ void ProjectileManager::cleanup()
     }
 
     m_active_hit_effects.clear();
+
+    // The flyables were deleted above and have returned their nodes
+    for(unsigned int type=0; type<PowerupManager::POWERUP_MAX; type++)
+    {
+        for(unsigned int i=0; i<m_free_nodes[type].size(); i++)
+            irr_driver->removeNode(m_free_nodes[type][i]);
+        m_free_nodes[type].clear();
+    }
 }   // cleanup
 
 // -----------------------------------------------------------------------------
@@ -143,13 +155,46 @@ Flyable *ProjectileManager::newProjectile(AbstractKart *kart,
 bool ProjectileManager::projectileIsClose(const AbstractKart * const kart,
                                          float radius)
 {
-    float r2 = radius*radius;
+    if(m_active_projectiles.empty()) return false;
+    return World::getWorld()->getPhysics()->hasFlyableInSphere(kart->getXYZ(),
+                                                               radius);
+}   // projectileIsClose
 
-    for(Projectiles::iterator i  = m_active_projectiles.begin();
-                              i != m_active_projectiles.end();   i++)
+// -----------------------------------------------------------------------------
+/** Returns a scene node for a new flyable. The node of a previously removed
+ *  flyable of the same type is reused if possible, otherwise a new node is
+ *  created.
+ *  \param type Type of the flyable.
+ *  \param mesh The mesh of this type of flyable.
+ */
+scene::ISceneNode *ProjectileManager::getFlyableNode(
+                                          PowerupManager::PowerupType type,
+                                          scene::IMesh *mesh)
+{
+    if(!m_free_nodes[type].empty())
     {
-        float dist2 = (*i)->getXYZ().distance2(kart->getXYZ());
-        if(dist2<r2) return true;
+        scene::ISceneNode *node = m_free_nodes[type].back();
+        m_free_nodes[type].pop_back();
+        node->setScale(core::vector3df(1.0f, 1.0f, 1.0f));
+        node->setVisible(true);
+        return node;
     }
-    return false;
-}   // projectileIsClose
+    scene::ISceneNode *node =
+        irr_driver->addMesh(mesh, StringUtils::insertValues("flyable_%i",
+                                                            (int)type));
+    irr_driver->applyObjectPassShader(node);
+    return node;
+}   // getFlyableNode
+
+// -----------------------------------------------------------------------------
+/** Hides the scene node of a removed flyable and keeps it, so that it can
+ *  be reused by the next flyable of the same type.
+ *  \param type Type of the flyable.
+ *  \param node The scene node of the flyable.
+ */
+void ProjectileManager::releaseFlyableNode(PowerupManager::PowerupType type,
+                                           scene::ISceneNode *node)
+{
+    node->setVisible(false);
+    m_free_nodes[type].push_back(node);
+}   // releaseFlyableNode
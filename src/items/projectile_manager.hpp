@@ -23,7 +23,7 @@
 
 namespace irr
 {
-    namespace scene { class IMesh; }
+    namespace scene { class IMesh; class ISceneNode; }
 }
 
 #include "items/powerup_manager.hpp"
@@ -52,6 +52,13 @@ private:
      *  being shown or have a sfx playing. */
     HitEffects       m_active_hit_effects;
 
+    /** Hidden scene nodes of flyables that were removed, for each type.
+     *  They are reused for new flyables of the same type, since creating
+     *  a scene node (and its shaders) in the middle of a race can cause
+     *  a noticeable hitch. */
+    std::vector<irr::scene::ISceneNode*>
+                     m_free_nodes[PowerupManager::POWERUP_MAX];
+
     void             updateServer(float dt);
 public:
                      ProjectileManager() {}
@@ -65,6 +72,11 @@ public:
     void             removeTextures   ();
     bool             projectileIsClose(const AbstractKart * const kart,
                                        float radius);
+    irr::scene::ISceneNode*
+                     getFlyableNode   (PowerupManager::PowerupType type,
+                                       irr::scene::IMesh *mesh);
+    void             releaseFlyableNode(PowerupManager::PowerupType type,
+                                        irr::scene::ISceneNode *node);
     // ------------------------------------------------------------------------
     /** Adds a special hit effect to be shown.
      *  \param hit_effect The hit effect to be added. */
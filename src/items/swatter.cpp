@@ -38,6 +38,7 @@
 #include "karts/explosion_animation.hpp"
 #include "karts/kart_properties.hpp"
 #include "modes/world.hpp"
+#include "physics/physics.hpp"
 #include "karts/abstract_kart.hpp"
 
 #define SWAT_POS_OFFSET        core::vector3df(0.0, 0.2f, -0.4f)
@@ -279,9 +280,12 @@ void Swatter::squashThingsAround()
     m_swat_sound->play();
 
     // Squash karts around
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    std::vector<AbstractKart*> karts;
+    world->getPhysics()->getKartsInSphere(swatter_pos, sqrtf(min_dist2),
+                                          &karts);
+    for(unsigned int i=0; i<karts.size(); i++)
     {
-        AbstractKart *kart = world->getKart(i);
+        AbstractKart *kart = karts[i];
         // TODO: isSwatterReady()
         if(kart->isEliminated() || kart==m_kart)
             continue;
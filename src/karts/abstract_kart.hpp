@@ -319,6 +319,10 @@ public:
     /** Returns the initial position of this kart. */
     virtual int getInitialPosition() const = 0;
     // ------------------------------------------------------------------------
+    /** Changes the start position of this kart, which is used when the
+     *  world is reused for the next race of a grand prix. */
+    virtual void setStartPosition(int position, const btTransform &t) = 0;
+    // ------------------------------------------------------------------------
     /** True if the wheels are touching the ground. */
     virtual bool isOnGround() const = 0;
     // ------------------------------------------------------------------------
@@ -63,6 +63,12 @@ public:
     virtual      ~Controller         () {};
     virtual void  reset              () = 0;
     virtual void  update             (float dt) = 0;
+    // ---------------------------------------------------------------------------
+    /** Optionally called for all karts before any kart is updated: a
+     *  controller can do the part of its work that only reads the state of
+     *  the world and only changes the controller itself here, which allows
+     *  all karts to do this in parallel. update() is called afterwards. */
+    virtual void  think              (float dt) {}
     virtual void  handleZipper       (bool play_sound) = 0;
     virtual void  collectedItem      (const Item &item, int add_info=-1,
                                       float previous_energy=0) = 0;
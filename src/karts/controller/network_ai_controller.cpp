@@ -0,0 +1,99 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/controller/network_ai_controller.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "karts/controller/kart_control.hpp"
+#include "modes/world.hpp"
+#include "network/network_world.hpp"
+
+#include <algorithm>
+
+/** Constructor.
+ *  \param kart The local kart of the bot client.
+ *  \param ai The AI controller driving the kart, which is deleted together
+ *         with this controller.
+ *  \param player The active player of the kart.
+ */
+NetworkAIController::NetworkAIController(AbstractKart *kart, Controller *ai,
+                                         StateManager::ActivePlayer *player)
+                   : Controller(kart, player)
+{
+    m_ai = ai;
+    setControllerName("NetworkAIController");
+    for (unsigned int i = 0; i < PA_PAUSE_RACE; i++)
+        m_sent_value[i] = 0;
+}   // NetworkAIController
+
+// ----------------------------------------------------------------------------
+NetworkAIController::~NetworkAIController()
+{
+    delete m_ai;
+}   // ~NetworkAIController
+
+// ----------------------------------------------------------------------------
+void NetworkAIController::reset()
+{
+    m_ai->reset();
+    for (unsigned int i = 0; i < PA_PAUSE_RACE; i++)
+        m_sent_value[i] = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Sends an action to the server if its value changed.
+ *  \param action The action.
+ *  \param value The value of the action, between 0 and Input::MAX_VALUE.
+ */
+void NetworkAIController::sendAction(PlayerAction action, int value)
+{
+    if (m_sent_value[action] == value)
+        return;
+    m_sent_value[action] = value;
+    NetworkWorld::getInstance()->controllerAction(this, action, value);
+}   // sendAction
+
+// ----------------------------------------------------------------------------
+/** Lets the AI drive, then sends the changed controls to the server.
+ *  \param dt Time step size.
+ */
+void NetworkAIController::update(float dt)
+{
+    m_ai->update(dt);
+    if (!World::getWorld()->isNetworkWorld() ||
+        !NetworkWorld::getInstance()->isRunning())
+        return;
+
+    // Steering values below the maximum are treated as analog by the
+    // NetworkPlayerController, so the full value is never used. A left
+    // steer is a negative steer value.
+    const int MAX_STEER = Input::MAX_VALUE - 2;
+    int steer = (int)(m_controls->m_steer * MAX_STEER);
+    steer = std::max(-MAX_STEER, std::min(steer, MAX_STEER));
+    sendAction(PA_STEER_LEFT,  steer < 0 ? -steer : 0);
+    sendAction(PA_STEER_RIGHT, steer > 0 ?  steer : 0);
+
+    int accel = (int)(m_controls->m_accel * Input::MAX_VALUE);
+    sendAction(PA_ACCEL,   std::min(accel, Input::MAX_VALUE - 1));
+    sendAction(PA_BRAKE,   m_controls->m_brake     ? Input::MAX_VALUE : 0);
+    sendAction(PA_NITRO,   m_controls->m_nitro     ? Input::MAX_VALUE : 0);
+    sendAction(PA_DRIFT,   m_controls->m_skid != KartControl::SC_NONE
+                                                   ? Input::MAX_VALUE : 0);
+    sendAction(PA_RESCUE,  m_controls->m_rescue    ? Input::MAX_VALUE : 0);
+    sendAction(PA_FIRE,    m_controls->m_fire      ? Input::MAX_VALUE : 0);
+    sendAction(PA_LOOK_BACK, m_controls->m_look_back ? Input::MAX_VALUE : 0);
+}   // update
@@ -0,0 +1,88 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_NETWORK_AI_CONTROLLER_HPP
+#define HEADER_NETWORK_AI_CONTROLLER_HPP
+
+#include "karts/controller/controller.hpp"
+
+/**
+  * \brief Drives the local kart of a bot client (--bot-client) with an AI,
+  *  and sends the controls to the server like a player would.
+  *  The AI sets the controls of the kart directly. After each update the
+  *  controls are compared with the ones that were last sent, and each
+  *  change is sent as the player action that the NetworkPlayerController
+  *  on the server turns back into the same control.
+  * \ingroup controller
+  */
+class NetworkAIController : public Controller
+{
+private:
+    /** The AI that actually drives the kart. */
+    Controller *m_ai;
+
+    /** The value that was last sent for each action. */
+    int         m_sent_value[PA_PAUSE_RACE];
+
+    void sendAction(PlayerAction action, int value);
+
+public:
+                 NetworkAIController(AbstractKart *kart, Controller *ai,
+                                     StateManager::ActivePlayer *player);
+    virtual     ~NetworkAIController();
+    virtual void reset();
+    virtual void update(float dt);
+    // ------------------------------------------------------------------------
+    virtual void think(float dt) { m_ai->think(dt); }
+    // ------------------------------------------------------------------------
+    virtual void handleZipper(bool play_sound)
+    {
+        m_ai->handleZipper(play_sound);
+    }   // handleZipper
+    // ------------------------------------------------------------------------
+    virtual void collectedItem(const Item &item, int add_info=-1,
+                               float previous_energy=0)
+    {
+        m_ai->collectedItem(item, add_info, previous_energy);
+    }   // collectedItem
+    // ------------------------------------------------------------------------
+    virtual void crashed(const AbstractKart *k) { m_ai->crashed(k);        }
+    // ------------------------------------------------------------------------
+    virtual void crashed(const Material *m)     { m_ai->crashed(m);        }
+    // ------------------------------------------------------------------------
+    virtual void setPosition(int p)             { m_ai->setPosition(p);    }
+    // ------------------------------------------------------------------------
+    virtual bool isPlayerController() const     { return false;            }
+    // ------------------------------------------------------------------------
+    virtual bool isNetworkController() const    { return false;            }
+    // ------------------------------------------------------------------------
+    virtual bool disableSlipstreamBonus() const
+    {
+        return m_ai->disableSlipstreamBonus();
+    }   // disableSlipstreamBonus
+    // ------------------------------------------------------------------------
+    /** Input devices are not used by a bot. */
+    virtual void action(PlayerAction action, int value) {}
+    // ------------------------------------------------------------------------
+    virtual void newLap(int lap)                { m_ai->newLap(lap);       }
+    // ------------------------------------------------------------------------
+    virtual void skidBonusTriggered()           { m_ai->skidBonusTriggered(); }
+    // ------------------------------------------------------------------------
+    virtual void finishedRace(float time)       { m_ai->finishedRace(time); }
+};   // NetworkAIController
+
+#endif
@@ -39,6 +39,8 @@
 #ifdef AI_DEBUG
 #  include "graphics/irr_driver.hpp"
 #endif
+#include "config/user_config.hpp"
+#include "graphics/camera.hpp"
 #include "graphics/show_curve.hpp"
 #include "graphics/slip_stream.hpp"
 #include "items/attachment.hpp"
@@ -60,6 +62,7 @@
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/vs.hpp"
 
 #ifdef AI_DEBUG
@@ -175,6 +178,17 @@ SkiddingAI::~SkiddingAI()
  */
 void SkiddingAI::reset()
 {
+    m_aim_node_cache.clear();
+    for(unsigned int i=0; i<AI_TIMER_COUNT; i++)
+    {
+        m_timer_total[i] = 0.0;
+        m_timer_calls[i] = 0;
+    }
+    m_frame_time                 = 0.0;
+    m_extra_crash_steps          = 5;
+    m_low_detail                 = false;
+    m_low_detail_time            = 0.0f;
+    m_low_detail_nitro           = false;
     m_time_since_last_shot       = 0.0f;
     m_start_kart_crash_direction = 0;
     m_start_delay                = -1.0f;
@@ -187,6 +201,7 @@ void SkiddingAI::reset()
     m_curve_center               = Vec3(0,0,0);
     m_current_track_direction    = GraphNode::DIR_STRAIGHT;
     m_item_to_collect            = NULL;
+    m_thought                    = false;
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
@@ -235,6 +250,11 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
  */
 void SkiddingAI::update(float dt)
 {
+    // The results of think() are only valid for this update
+    const bool thought = m_thought;
+    m_thought = false;
+    updateTimeBudget();
+
     // This is used to enable firing an item backwards.
     m_controls->m_look_back = false;
     m_controls->m_nitro     = false;
@@ -319,15 +339,35 @@ void SkiddingAI::update(float dt)
         return;
     }
 
+    // think() already determined the level of detail for this update
+    if(!thought)
+        m_low_detail = isFarFromHumans();
+    if(m_low_detail)
+    {
+        updateLowDetail(dt);
+        AIBaseController::update(dt);
+        return;
+    }
+    // Start with a decision once the kart is far away again
+    m_low_detail_time = UserConfigParams::m_ai_lod_update_time;
+
     // Get information that is needed by more than 1 of the handling funcs
-    computeNearestKarts();
+    if(!thought)
+        computeNearestKarts();
 
     m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
                         m_ai_properties->getSpeedCap(m_distance_to_player),
                         /*fade_in_time*/0.0f);
     //Detect if we are going to crash with the track and/or kart
-    checkCrashes(m_kart->getXYZ());
-    determineTrackDirection();
+    if(!thought)
+    {
+        PROFILER_PUSH_CPU_MARKER("AI checkCrashes", 0x80, 0x80, 0x00);
+        double start_time = getTimeMilliseconds();
+        checkCrashes(m_kart->getXYZ());
+        stopTimer(AI_TIMER_CRASHES, start_time);
+        PROFILER_POP_CPU_MARKER();
+        determineTrackDirection();
+    }
 
     // Special behaviour if we have a bomb attach: try to hit the kart ahead
     // of us.
@@ -356,15 +396,35 @@ void SkiddingAI::update(float dt)
             setSteering(steer_angle, dt);
             commands_set = true;
         }
+        PROFILER_PUSH_CPU_MARKER("AI handleRescue", 0x80, 0x00, 0x80);
+        double start_time = getTimeMilliseconds();
         handleRescue(dt);
+        stopTimer(AI_TIMER_RESCUE, start_time);
+        PROFILER_POP_CPU_MARKER();
     }
     if(!commands_set)
     {
         /*Response handling functions*/
         handleAcceleration(dt);
-        handleSteering(dt);
+
+        PROFILER_PUSH_CPU_MARKER("AI handleSteering", 0x00, 0x80, 0x80);
+        double start_time = getTimeMilliseconds();
+        handleSteering(dt, thought);
+        stopTimer(AI_TIMER_STEERING, start_time);
+        PROFILER_POP_CPU_MARKER();
+
+        PROFILER_PUSH_CPU_MARKER("AI handleItems", 0x80, 0x40, 0x00);
+        start_time = getTimeMilliseconds();
         handleItems(dt);
+        stopTimer(AI_TIMER_ITEMS, start_time);
+        PROFILER_POP_CPU_MARKER();
+
+        PROFILER_PUSH_CPU_MARKER("AI handleRescue", 0x80, 0x00, 0x80);
+        start_time = getTimeMilliseconds();
         handleRescue(dt);
+        stopTimer(AI_TIMER_RESCUE, start_time);
+        PROFILER_POP_CPU_MARKER();
+
         handleBraking();
         // If a bomb is attached, nitro might already be set.
         if(!m_controls->m_nitro)
@@ -393,6 +453,212 @@ void SkiddingAI::update(float dt)
     AIBaseController::update(dt);
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Called when a new lap is started. The AI might choose a new path, so the
+ *  cached aim points are discarded.
+ *  \param lap The new lap.
+ */
+void SkiddingAI::newLap(int lap)
+{
+    AIBaseController::newLap(lap);
+    m_aim_node_cache.clear();
+}   // newLap
+
+//-----------------------------------------------------------------------------
+/** Does the expensive part of the decisions of the AI, which only reads the
+ *  state of the world and only modifies data of this AI: finding the
+ *  nearest karts, checking for crashes, determining the track direction and
+ *  the point to aim for. This is called for all AI karts in parallel before
+ *  any kart is updated (which means the AI sees the world as it was at the
+ *  start of this update), and the results are used in the next call to
+ *  update(). Nothing is done in cases in which update() does not need these
+ *  results.
+ *  Note that the AI debug visualisations are not thread safe.
+ *  \param dt Time step size.
+ */
+void SkiddingAI::think(float dt)
+{
+    m_thought = false;
+    if(m_kart->getKartAnimation() || m_world->isStartPhase())
+        return;
+
+    // The simplified AI is cheap enough to be done in update()
+    m_low_detail = isFarFromHumans();
+    if(m_low_detail)
+    {
+        m_thought = true;
+        return;
+    }
+
+    computeNearestKarts();
+    // The profiler is not thread safe, so only the time is measured here
+    double start_time = getTimeMilliseconds();
+    checkCrashes(m_kart->getXYZ());
+    stopTimer(AI_TIMER_CRASHES, start_time);
+    determineTrackDirection();
+    findAimPoint(&m_thought_aim_point, &m_thought_last_node);
+    m_thought = true;
+}   // think
+
+//-----------------------------------------------------------------------------
+/** Returns true if this kart is far away from all human players (along the
+ *  track and in a straight line) and from all cameras, so that nobody
+ *  would notice the simplified AI (see UserConfigParams::m_ai_lod_distance).
+ *  If there are no human players (e.g. in profile mode), the full AI is
+ *  always used.
+ */
+bool SkiddingAI::isFarFromHumans() const
+{
+    const float lod_distance = UserConfigParams::m_ai_lod_distance;
+    if(lod_distance <= 0)
+        return false;
+
+    const float my_distance =
+        m_world->getOverallDistance(m_kart->getWorldKartId());
+    const Vec3 &xyz = m_kart->getXYZ();
+    bool has_human = false;
+    for(unsigned int i=0; i<m_world->getNumKarts(); i++)
+    {
+        const AbstractKart *kart = m_world->getKart(i);
+        const Controller *controller = kart->getController();
+        if(kart->isEliminated() ||
+           !(controller->isPlayerController() ||
+             controller->isNetworkController()   ))
+            continue;
+        has_human = true;
+        if(fabsf(m_world->getOverallDistance(i) - my_distance) < lod_distance ||
+           (kart->getXYZ() - xyz).length2() < lod_distance*lod_distance)
+            return false;
+    }
+
+    for(unsigned int i=0; i<Camera::getNumCameras(); i++)
+    {
+        const Vec3 camera_xyz = Camera::getCamera(i)->getCameraSceneNode()
+                                                    ->getAbsolutePosition();
+        if((camera_xyz - xyz).length2() < lod_distance*lod_distance)
+            return false;
+    }
+    return has_human;
+}   // isFarFromHumans
+
+//-----------------------------------------------------------------------------
+/** The simplified AI used for karts far away from all human players. It
+ *  steers every frame towards the center of a graph node a few nodes ahead
+ *  on the path of this AI, without any crash or item avoidance. All other
+ *  decisions (acceleration, braking, items, nitro, rescue) are only made
+ *  every UserConfigParams::m_ai_lod_update_time seconds, and are kept in
+ *  between.
+ *  \param dt Time step size.
+ */
+void SkiddingAI::updateLowDetail(float dt)
+{
+    // Fire is only triggered by a decision, but nitro is kept till the
+    // next decision.
+    m_controls->m_fire  = false;
+    m_controls->m_nitro = m_low_detail_nitro;
+
+    m_low_detail_time += dt;
+    if(m_low_detail_time >= UserConfigParams::m_ai_lod_update_time)
+    {
+        const float decision_dt = m_low_detail_time;
+        m_low_detail_time = 0.0f;
+
+        computeNearestKarts();
+        m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
+                            m_ai_properties->getSpeedCap(m_distance_to_player),
+                            /*fade_in_time*/0.0f);
+        m_crashes.clear();
+        determineTrackDirection();
+        handleAcceleration(decision_dt);
+        handleItems(decision_dt);
+        handleRescue(decision_dt);
+        handleBraking();
+        m_controls->m_nitro = false;
+        handleNitroAndZipper();
+        m_low_detail_nitro = m_controls->m_nitro;
+    }
+
+    // Follow the path along the quad graph
+    const int LOOK_AHEAD = 3;
+    int node = m_track_node;
+    for(int i=0; i<LOOK_AHEAD && m_next_node_index[node]>=0; i++)
+        node = m_next_node_index[node];
+    setSteering(steerToPoint(QuadGraph::get()->getQuadOfNode(node)
+                                              .getCenter()), dt);
+}   // updateLowDetail
+
+//-----------------------------------------------------------------------------
+/** Adds the time since start_time to one of the timers of this AI.
+ *  \param timer The timer to update.
+ *  \param start_time The value of getTimeMilliseconds() when the measured
+ *         function was called.
+ */
+void SkiddingAI::stopTimer(AITimer timer, double start_time)
+{
+    const double t = getTimeMilliseconds() - start_time;
+    m_timer_total[timer] += t;
+    m_timer_calls[timer]++;
+    m_frame_time         += t;
+}   // stopTimer
+
+//-----------------------------------------------------------------------------
+/** Called once per frame to compare the time this AI used in the last frame
+ *  with its share of the AI time budget (UserConfigParams::m_ai_time_budget,
+ *  which is shared by all karts). If the AI is too slow, checkCrashes looks
+ *  less far ahead, and the lookahead is increased again once the AI is well
+ *  within its budget.
+ */
+void SkiddingAI::updateTimeBudget()
+{
+    const float budget = UserConfigParams::m_ai_time_budget;
+    if(budget > 0)
+    {
+        const double share = budget / m_world->getNumKarts();
+        if(m_frame_time > share && m_extra_crash_steps > 0)
+            m_extra_crash_steps--;
+        else if(m_frame_time < 0.5*share && m_extra_crash_steps < 5)
+            m_extra_crash_steps++;
+    }
+    else
+        m_extra_crash_steps = 5;
+    m_frame_time = 0.0;
+}   // updateTimeBudget
+
+//-----------------------------------------------------------------------------
+/** Returns the name of a timer, e.g. for the profile output.
+ *  \param timer The timer.
+ */
+const char *SkiddingAI::getTimerName(AITimer timer)
+{
+    switch(timer)
+    {
+    case AI_TIMER_STEERING: return "handleSteering";
+    case AI_TIMER_ITEMS:    return "handleItems";
+    case AI_TIMER_CRASHES:  return "checkCrashes";
+    case AI_TIMER_RESCUE:   return "handleRescue";
+    default:                return "unknown";
+    }
+}   // getTimerName
+
+//-----------------------------------------------------------------------------
+/** Determines the point to aim for using the selected point selection
+ *  algorithm.
+ *  \param aim_point On return the point to aim for.
+ *  \param last_node On return the graph node of the aim point.
+ */
+void SkiddingAI::findAimPoint(Vec3 *aim_point, int *last_node)
+{
+    switch(m_point_selection_algorithm)
+    {
+    case PSA_FIXED : findNonCrashingPointFixed(aim_point, last_node);
+                     break;
+    case PSA_NEW:    findNonCrashingPointNew(aim_point, last_node);
+                     break;
+    case PSA_DEFAULT:findNonCrashingPoint(aim_point, last_node);
+                     break;
+    }
+}   // findAimPoint
+
 //-----------------------------------------------------------------------------
 /** This function decides if the AI should brake.
  *  The decision can be based on race mode (e.g. in follow the leader the AI
@@ -474,8 +740,10 @@ void SkiddingAI::handleBraking()
  *  avoid item, and potentially adjust the aim-at point, before computing the
  *  steer direction to arrive at the currently aim-at point.
  *  \param dt Time step size.
+ *  \param use_thought_aim_point True if the aim point was already
+ *         determined by think().
  */
-void SkiddingAI::handleSteering(float dt)
+void SkiddingAI::handleSteering(float dt, bool use_thought_aim_point)
 {
     const int next = m_next_node_index[m_track_node];
 
@@ -543,15 +811,13 @@ void SkiddingAI::handleSteering(float dt)
         Vec3 aim_point;
         int last_node = QuadGraph::UNKNOWN_SECTOR;
 
-        switch(m_point_selection_algorithm)
+        if(use_thought_aim_point)
         {
-        case PSA_FIXED : findNonCrashingPointFixed(&aim_point, &last_node);
-                         break;
-        case PSA_NEW:    findNonCrashingPointNew(&aim_point, &last_node);
-                         break;
-        case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
-                         break;
+            aim_point = m_thought_aim_point;
+            last_node = m_thought_last_node;
         }
+        else
+            findAimPoint(&aim_point, &last_node);
 #ifdef AI_DEBUG
         m_debug_sphere[m_point_selection_algorithm]->setPosition(aim_point.toIrrVector());
 #endif
@@ -1079,7 +1345,6 @@ void SkiddingAI::evaluateItems(const Item *item, float kart_aim_angle,
                   return;
         case Item::ITEM_BONUS_BOX:
             break;
-        case Item::ITEM_TRIGGER: return; break;
 
         default: assert(false); break;
     }    // switch
@@ -1696,8 +1961,8 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
     if( steps < 2 ) steps = 2;
 
     // The AI drives significantly better with more steps, so for now
-    // add 5 additional steps.
-    steps+=5;
+    // add 5 additional steps (less if the AI is over its time budget).
+    steps+=m_extra_crash_steps;
 
     //Right now there are 2 kind of 'crashes': with other karts and another
     //with the track. The sight line is used to find if the karts crash with
@@ -1722,8 +1987,6 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
         m_crashes.m_kart = slip->getSlipstreamTarget()->getWorldKartId();
     }
 
-    const size_t NUM_KARTS = m_world->getNumKarts();
-
     //Protection against having vel_normal with nan values
     const Vec3 &VEL = m_kart->getVelocity();
     Vec3 vel_normal(VEL.getX(), 0.0, VEL.getZ());
@@ -1743,6 +2006,26 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
             steps, m_kart_length, m_kart->getVelocityLC().getZ());
         steps=1000;
     }
+
+    // Only karts that are not eliminated and not faster than this kart can
+    // be crashed into, which does not depend on the step, so collect them
+    // once instead of testing all karts in each step.
+    // Only the world ids are stored, the positions and velocities are then
+    // read from the kart states of the world.
+    std::vector<int> crash_karts;
+    if(m_crashes.m_kart == -1)
+    {
+        for(unsigned int j = 0; j < m_world->getNumKarts(); ++j)
+        {
+            const AbstractKart* kart = m_world->getKart(j);
+            if(kart==m_kart||kart->isEliminated()) continue;
+            // Ignore karts ahead that are faster than this kart.
+            if(m_kart->getVelocityLC().getZ() < kart->getVelocityLC().getZ())
+                continue;
+            crash_karts.push_back(j);
+        }
+    }
+
     for(int i = 1; steps > i; ++i)
     {
         Vec3 step_coord = pos + vel_normal* m_kart_length * float(i);
@@ -1752,21 +2035,15 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
          */
         if( m_crashes.m_kart == -1 )
         {
-            for( unsigned int j = 0; j < NUM_KARTS; ++j )
+            for(unsigned int j = 0; j < crash_karts.size(); ++j)
             {
-                const AbstractKart* kart = m_world->getKart(j);
-                // Ignore eliminated karts
-                if(kart==m_kart||kart->isEliminated()) continue;
-                const AbstractKart *other_kart = m_world->getKart(j);
-                // Ignore karts ahead that are faster than this kart.
-                if(m_kart->getVelocityLC().getZ() < other_kart->getVelocityLC().getZ())
-                    continue;
-                Vec3 other_kart_xyz = other_kart->getXYZ()
-                                    + other_kart->getVelocity()*(i*dt);
+                const int other_kart = crash_karts[j];
+                Vec3 other_kart_xyz = m_world->getKartXYZ(other_kart)
+                       + m_world->getKartVelocity(other_kart)*(i*dt);
                 float kart_distance = (step_coord - other_kart_xyz).length_2d();
 
                 if( kart_distance < m_kart_length)
-                    m_crashes.m_kart = j;
+                    m_crashes.m_kart = other_kart;
             }
         }
 
@@ -2003,6 +2280,8 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
  *  which takes some time - so it is actually mostly on track.
  *  Since this algoritm (so far) ends up with by far the best AI behaviour,
  *  it is for now the default).
+ *  The results are cached for cells of each graph node, see
+ *  m_aim_node_cache.
  *  \param aim_position On exit contains the point the AI should aim at.
  *  \param last_node On exit contais the graph node the AI is aiming at.
 */
@@ -2015,6 +2294,55 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
+    AimNodeCacheEntry &entry = m_aim_node_cache[getAimNodeCacheIndex()];
+    if(entry.m_aim_node<0)
+    {
+        entry.m_aim_node  = findNonCrashingNode(&entry.m_last_node);
+    }
+    *last_node    = entry.m_last_node;
+    *aim_position = QuadGraph::get()->getQuadOfNode(entry.m_aim_node)
+                                     .getCenter();
+}   // findNonCrashingPoint
+
+//-----------------------------------------------------------------------------
+/** Returns the index of the entry in m_aim_node_cache for the current
+ *  position of the kart, allocating the cache if necessary.
+ */
+int SkiddingAI::getAimNodeCacheIndex()
+{
+    if(m_aim_node_cache.empty())
+    {
+        AimNodeCacheEntry unknown;
+        unknown.m_aim_node  = -1;
+        unknown.m_last_node = -1;
+        m_aim_node_cache.resize(QuadGraph::get()->getNumNodes()
+                               *AIM_CACHE_LATERAL*AIM_CACHE_LONGITUDINAL,
+                                unknown);
+    }
+
+    const GraphNode &node = QuadGraph::get()->getNode(m_track_node);
+    Vec3 track_coord;
+    QuadGraph::get()->spatialToTrack(&track_coord, m_kart->getXYZ(),
+                                     m_track_node);
+    int lateral = (int)((track_coord.getX()/node.getPathWidth() + 0.5f)
+                        * AIM_CACHE_LATERAL);
+    lateral = core::clamp(lateral, 0, AIM_CACHE_LATERAL-1);
+    float along = track_coord.getZ() - node.getDistanceFromStart();
+    int longitudinal = node.getNodeLength()>0
+                     ? (int)(along/node.getNodeLength()*AIM_CACHE_LONGITUDINAL)
+                     : 0;
+    longitudinal = core::clamp(longitudinal, 0, AIM_CACHE_LONGITUDINAL-1);
+    return (m_track_node*AIM_CACHE_LATERAL + lateral)*AIM_CACHE_LONGITUDINAL
+          + longitudinal;
+}   // getAimNodeCacheIndex
+
+//-----------------------------------------------------------------------------
+/** Determines the node to aim at for findNonCrashingPoint.
+ *  \param last_node On exit contais the graph node the AI is aiming at.
+ *  \return The node whose center the AI should aim at.
+ */
+int SkiddingAI::findNonCrashingNode(int *last_node)
+{
     *last_node = m_next_node_index[m_track_node];
     float angle = QuadGraph::get()->getAngleToNext(m_track_node,
                                               m_successor_index[m_track_node]);
@@ -2040,9 +2368,7 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
         float diff = normalizeAngle(angle1-angle);
         if(fabsf(diff)>1.5f)
         {
-            *aim_position = QuadGraph::get()->getQuadOfNode(target_sector)
-                                                 .getCenter();
-            return;
+            return target_sector;
         }
 
         //direction is a vector from our kart to the sectors we are testing
@@ -2078,16 +2404,14 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
             if ( distance + m_kart_width * 0.5f
                  > QuadGraph::get()->getNode(*last_node).getPathWidth() )
             {
-                *aim_position = QuadGraph::get()->getQuadOfNode(*last_node)
-                                                 .getCenter();
-                return;
+                return *last_node;
             }
         }
         angle = angle1;
         *last_node = target_sector;
     }   // for i<100
-    *aim_position = QuadGraph::get()->getQuadOfNode(*last_node).getCenter();
-}   // findNonCrashingPoint
+    return *last_node;
+}   // findNonCrashingNode
 
 //-----------------------------------------------------------------------------
 /** Determines the direction of the track ahead of the kart: 0 indicates
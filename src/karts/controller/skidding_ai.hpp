@@ -92,6 +92,11 @@ the AI does the following steps:
 */
 class SkiddingAI : public AIBaseController
 {
+public:
+    /** The functions of the AI whose time is measured. */
+    enum AITimer {AI_TIMER_STEERING, AI_TIMER_ITEMS, AI_TIMER_CRASHES,
+                  AI_TIMER_RESCUE, AI_TIMER_COUNT};
+
 private:
 
     class CrashTypes
@@ -199,6 +204,59 @@ private:
     enum {PSA_DEFAULT, PSA_FIXED, PSA_NEW}
           m_point_selection_algorithm;
 
+    /** Number of cells each graph node is divided into across and along
+     *  the track for m_aim_node_cache. */
+    enum {AIM_CACHE_LATERAL = 8, AIM_CACHE_LONGITUDINAL = 4};
+
+    /** An entry of m_aim_node_cache. */
+    struct AimNodeCacheEntry
+    {
+        /** The node whose center to aim at, or -1 if not computed yet. */
+        int m_aim_node;
+        /** The result for last_node of findNonCrashingPoint. */
+        int m_last_node;
+    };   // AimNodeCacheEntry
+
+    /** Caches the results of findNonCrashingPoint: they only depend on the
+     *  path of this AI and the position of the kart on the current graph
+     *  node, so a node is divided into cells across and along the track,
+     *  and the result is computed once for each cell. The cache is cleared
+     *  when the path changes. */
+    std::vector<AimNodeCacheEntry> m_aim_node_cache;
+
+    /** True if think() was called for the current update, in which case
+     *  update() uses its results instead of computing them again. */
+    bool m_thought;
+
+    /** The point to aim for (and its graph node) as determined by think(). */
+    Vec3 m_thought_aim_point;
+    int  m_thought_last_node;
+
+    /** Total time in ms spent in each of the measured functions. */
+    double       m_timer_total[AI_TIMER_COUNT];
+
+    /** Number of calls of each of the measured functions. */
+    unsigned int m_timer_calls[AI_TIMER_COUNT];
+
+    /** Time in ms the measured functions used in the current frame. */
+    double       m_frame_time;
+
+    /** Number of steps checkCrashes looks further ahead than necessary.
+     *  This is reduced if the AI exceeds its share of the per frame AI
+     *  time budget. */
+    int          m_extra_crash_steps;
+
+    /** True if this AI is far away from all human players and cameras, in
+     *  which case it uses the simplified AI, see updateLowDetail(). */
+    bool         m_low_detail;
+
+    /** Time since the last decision of the simplified AI. */
+    float        m_low_detail_time;
+
+    /** The nitro decision of the simplified AI, which is kept until its
+     *  next decision. */
+    bool         m_low_detail_nitro;
+
 #ifdef DEBUG
     /** For skidding debugging: shows the estimated turn shape. */
     ShowCurve **m_curve;
@@ -220,7 +278,7 @@ private:
      */
     void  handleRaceStart();
     void  handleAcceleration(const float dt);
-    void  handleSteering(float dt);
+    void  handleSteering(float dt, bool use_thought_aim_point);
     void  handleItems(const float dt);
     void  handleRescue(const float dt);
     void  handleBraking();
@@ -242,6 +300,9 @@ private:
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
+    int   findNonCrashingNode(int *last_node);
+    int   getAimNodeCacheIndex();
+    void  findAimPoint(Vec3 *aim_point, int *last_node);
 
     void  determineTrackDirection();
     void  determineTurnRadius(const Vec3 &start,
@@ -252,6 +313,10 @@ private:
     virtual bool doSkid(float steer_fraction);
     virtual void setSteering(float angle, float dt);
     void handleCurve();
+    void stopTimer(AITimer timer, double start_time);
+    void updateTimeBudget();
+    bool isFarFromHumans() const;
+    void updateLowDetail(float dt);
 
 protected:
     virtual unsigned int getNextSector(unsigned int index);
@@ -260,8 +325,20 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (float delta) ;
+    virtual void think       (float delta) ;
     virtual void reset       ();
+    virtual void newLap      (int lap);
     virtual const irr::core::stringw& getNamePostfix() const;
+    static const char *getTimerName(AITimer timer);
+    // ------------------------------------------------------------------------
+    /** Returns the total time in ms spent in one of the measured functions. */
+    double getTimerTotal(AITimer timer) const { return m_timer_total[timer]; }
+    // ------------------------------------------------------------------------
+    /** Returns how often one of the measured functions was called. */
+    unsigned int getTimerCalls(AITimer timer) const
+    {
+        return m_timer_calls[timer];
+    }   // getTimerCalls
 };
 
 #endif
@@ -28,6 +28,7 @@
 #include "graphics/camera.hpp"
 #include "graphics/explosion.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/label_billboard.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/particle_emitter.hpp"
 #include "graphics/particle_kind.hpp"
@@ -119,6 +120,7 @@ Kart::Kart (const std::string& ident, unsigned int world_kart_id,
     m_wheel_box            = NULL;
     m_collision_particles  = NULL;
     m_slipstream           = NULL;
+    m_on_screen_text       = NULL;
     m_skidmarks            = NULL;
     m_controller           = NULL;
     m_saved_controller     = NULL;
@@ -220,6 +222,11 @@ void Kart::init(RaceManager::KartType type)
     {
         animations = false;
     }
+    // Ghost karts are only moved along the recorded path. Their static
+    // models are cheap to render, since the meshes of all ghosts using
+    // the same kart can be drawn instanced.
+    if (type == RaceManager::KT_GHOST)
+        animations = false;
     loadData(type, animations);
 
     m_kart_gfx = new KartGFX(this);
@@ -2450,8 +2457,7 @@ void Kart::loadData(RaceManager::KartType type, bool is_animated_model)
                                 getNode(),
                                 true);
 
-        // FIXME: in multiplayer mode, this will result in several instances
-        //        of the heightmap being calculated and kept in memory
+        // The height map is built only once and shared by all local players
         m_sky_particles_emitter->addHeightMapAffector(track);
     }
 
@@ -2731,6 +2737,20 @@ void Kart::setOnScreenText(const wchar_t *text)
     if (CVS->isGLSL())
     {
         gui::ScalableFont* font = GUIEngine::getFont() ? GUIEngine::getFont() : GUIEngine::getTitleFont();
+        // All labels share one texture and are drawn together, a new text
+        // only replaces the previous one
+        if (m_on_screen_text)
+        {
+            m_on_screen_text->setText(text, font);
+            return;
+        }
+        m_on_screen_text = LabelBillboard::create(text, font,
+            video::SColor(255, 255, 225, 0),
+            video::SColor(255, 255, 89, 0),
+            getNode(), core::vector3df(0.0f, 1.5f, 0.0f));
+        if (m_on_screen_text)
+            return;
+        // The label atlas is full
         new STKTextBillboard(text, font,
             video::SColor(255, 255, 225, 0),
             video::SColor(255, 255, 89, 0),
@@ -36,6 +36,7 @@
 #include "utils/no_copy.hpp"
 
 class btKart;
+class btKartRaycaster;
 
 class Attachment;
 class Controller;
@@ -43,6 +44,7 @@ class Item;
 class AbstractKartAnimation;
 class HitEffect;
 class KartGFX;
+class LabelBillboard;
 class MaxSpeed;
 class ParticleEmitter;
 class ParticleKind;
@@ -157,7 +159,7 @@ private:
     // Bullet physics parameters
     // -------------------------
     btCompoundShape          m_kart_chassis;
-    btVehicleRaycaster      *m_vehicle_raycaster;
+    btKartRaycaster         *m_vehicle_raycaster;
     btKart                  *m_vehicle;
 
      /** The amount of energy collected by hitting coins. Note that it
@@ -185,6 +187,10 @@ private:
     /** Handles all slipstreaming. */
     SlipStream      *m_slipstream;
 
+    /** The text shown above the kart (see setOnScreenText), or NULL. It is
+     *  a child of the kart node, which owns it. */
+    LabelBillboard  *m_on_screen_text;
+
     /** Rotation compared to the start position, same for all wheels */
     float           m_wheel_rotation;
 
@@ -319,6 +325,13 @@ public:
     /** Returns the initial position of this kart. */
     virtual int    getInitialPosition  () const { return m_initial_position; }
     // ------------------------------------------------------------------------
+    /** Changes the start position, which is used in the next reset(). */
+    virtual void   setStartPosition(int position, const btTransform &t)
+    {
+        m_initial_position = position;
+        m_reset_transform  = t;
+    }   // setStartPosition
+    // ------------------------------------------------------------------------
     /** Returns the finished time for a kart. */
     virtual float  getFinishTime       () const { return m_finish_time;      }
     // ------------------------------------------------------------------------
@@ -18,11 +18,14 @@
 
 #include "karts/kart_model.hpp"
 
+#include <ICameraSceneNode.h>
 #include <IMeshSceneNode.h>
 #include <ISceneManager.h>
+#include <algorithm>
 
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
+#include "graphics/camera.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/lod_node.hpp"
@@ -30,6 +33,7 @@
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
 #include "karts/abstract_kart.hpp"
+#include "karts/controller/controller.hpp"
 #include "karts/ghost_kart.hpp"
 #include "karts/kart_properties.hpp"
 #include "physics/btKart.hpp"
@@ -379,12 +383,29 @@ scene::ISceneNode* KartModel::attachModel(bool animated_models, bool always_anim
         m_animated_node->grab();
         node = lod_node;
 
-        // Become the owner of the wheels
+        // Become the owner of the wheels. The kart is culled once with a
+        // box that contains the kart and the wheels, the wheels (and the
+        // animated model, whose bounding box does not follow the animation)
+        // then just use this result instead of being culled each on its own.
+        core::aabbox3df box = lod_node->getAllNodes().back()->getBoundingBox();
         for(unsigned int i=0; i<4; i++)
         {
             if (!m_wheel_model[i] || !m_wheel_node[i]) continue;
             m_wheel_node[i]->setParent(lod_node);
+            m_wheel_node[i]->setAutomaticCulling(scene::EAC_OFF);
+            // The wheels can rotate and move with the suspension
+            const float r = m_wheel_graphics_radius[i]
+                          + std::max(m_max_suspension[i], 0.0f);
+            const core::vector3df center =
+                m_wheel_graphics_position[i].toIrrVector();
+            box.addInternalBox(core::aabbox3df(center - core::vector3df(r),
+                                               center + core::vector3df(r)));
         }
+        // Leave some room for the animations
+        const core::vector3df margin = box.getExtent() * 0.1f;
+        box.MinEdge -= margin;
+        box.MaxEdge += margin;
+        lod_node->setCullingBox(box);
 
         // Become the owner of the speed weighted objects
         for(size_t i=0; i<m_speed_weighted_objects.size(); i++)
@@ -485,6 +506,10 @@ bool KartModel::loadModels(const KartProperties &kart_properties)
     }
     m_mesh->grab();
     irr_driver->grabAllTextures(m_mesh);
+    // Karts only play a few short clips, so sampling all joints once at
+    // each frame is cheap, and all copies of this model share the result
+    if(m_mesh->getMeshType() == scene::EAMT_SKINNED)
+        static_cast<scene::ISkinnedMesh*>(m_mesh)->bakeAnimation();
 
     Vec3 kart_min, kart_max;
     MeshTools::minMax3D(m_mesh->getMesh(m_animation_frame[AF_STRAIGHT]),
@@ -778,13 +803,18 @@ void KartModel::update(float dt, float rotation_dt, float steer,  float speed)
 {
    core::vector3df wheel_steer(0, steer*30.0f, 0);
 
+    // Ghost karts have no physics, so their suspension is not used. This
+    // is tested once here and not for each wheel.
+    const btKart *vehicle = m_kart && !dynamic_cast<GhostKart*>(m_kart)
+                          ? m_kart->getVehicle() : NULL;
+
     for(unsigned int i=0; i<4; i++)
     {
         if(!m_kart || !m_wheel_node[i]) continue;
         float rel_suspension = 0;
-        if (!dynamic_cast<GhostKart*>(m_kart))
+        if (vehicle)
         {
-            const btWheelInfo &wi = m_kart->getVehicle()->getWheelInfo(i);
+            const btWheelInfo &wi = vehicle->getWheelInfo(i);
 #ifdef DEBUG
             if (UserConfigParams::m_physics_debug && m_kart)
             {
@@ -891,8 +921,33 @@ void KartModel::update(float dt, float rotation_dt, float steer,  float speed)
                                         -m_animation_frame[AF_LEFT]   )*steer);
     else                frame = (float)m_animation_frame[AF_STRAIGHT];
 
+    // Far away AI karts use the nearest whole frame, for which the baked
+    // joint matrices are used directly (see CSkinnedMesh::bakeAnimation)
+    if(m_kart && m_kart->getController() &&
+       !m_kart->getController()->isPlayerController() &&
+       isFarFromCameras())
+        frame = floorf(frame + 0.5f);
+
     m_animated_node->setCurrentFrame(frame);
 }   // update
+
+//-----------------------------------------------------------------------------
+/** Returns true if the kart is far away from all cameras, so that small
+ *  details of its animation are not visible.
+ */
+bool KartModel::isFarFromCameras() const
+{
+    const float max_distance2 = 50.0f*50.0f;
+    const core::vector3df &xyz = m_animated_node->getAbsolutePosition();
+    for(unsigned int i=0; i<Camera::getNumCameras(); i++)
+    {
+        const core::vector3df &camera =
+            Camera::getCamera(i)->getCameraSceneNode()->getAbsolutePosition();
+        if(xyz.getDistanceFromSQ(camera) < max_distance2)
+            return false;
+    }
+    return true;
+}   // isFarFromCameras
 //-----------------------------------------------------------------------------
 void KartModel::attachHat()
 {
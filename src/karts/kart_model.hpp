@@ -221,6 +221,8 @@ private:
 
     void OnAnimationEnd(scene::IAnimatedMeshSceneNode *node);
 
+    bool  isFarFromCameras() const;
+
     /** Pointer to the kart object belonging to this kart model. */
     AbstractKart* m_kart;
 
@@ -241,6 +243,10 @@ public:
     /** Returns the animated mesh of this kart model. */
     scene::IAnimatedMesh*
                   getModel() const { return m_mesh; }
+    // ------------------------------------------------------------------------
+    /** Returns the file name of the kart model (relative to the kart
+     *  directory). */
+    const std::string& getModelFile() const { return m_model_filename; }
 
     // ------------------------------------------------------------------------
     /** Returns the mesh of the wheel for this kart. */
@@ -24,6 +24,7 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "io/content_index.hpp"
 #include "io/file_manager.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "karts/kart_model.hpp"
@@ -111,6 +112,7 @@ KartProperties::KartProperties(const std::string &filename)
     m_shape                      = 32;  // close enough to a circle.
     m_engine_sfx_type            = "engine_small";
     m_kart_model                 = NULL;
+    m_models_loaded              = false;
     m_has_rand_wheels            = false;
     m_nitro_min_consumption      = 0.53f;
     // The default constructor for stk_config uses filename=""
@@ -176,7 +178,9 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     // Get the default values from STKConfig. This will also allocate any
     // pointers used in KartProperties
 
-    const XMLNode* root = new XMLNode(filename);
+    const XMLNode* root = ContentIndex::takeXMLTree(filename);
+    if(!root)
+        root = new XMLNode(filename);
     std::string kart_type;
 
     if (root->get("type", &kart_type))
@@ -232,6 +236,40 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         m_groups.push_back(DEFAULT_GROUP_NAME);
 
 
+    m_icon_file = m_root+m_icon_file;
+
+    // Make permanent is important, since otherwise icons can get deleted
+    // (e.g. when freeing temp. materials from a track, the last icon
+    //  would get deleted, too.
+    m_icon_material = material_manager->getMaterial(m_icon_file,
+                                                    /*is_full_path*/true,
+                                                    /*make_permanent*/true,
+                                                    /*complain_if_not_found*/true,
+                                                    /*strip_path*/false);
+
+    // The models are only loaded when they are needed (see loadModels), but
+    // a kart without a model would not be usable at all.
+    const std::string model_file = m_root+m_kart_model->getModelFile();
+    if (m_version >= 1 && !file_manager->fileExists(model_file))
+    {
+        delete m_kart_model;
+        m_kart_model = NULL;
+        throw std::runtime_error("Cannot find kart model '"+model_file+"'");
+    }
+}   // load
+
+//-----------------------------------------------------------------------------
+/** Loads the materials, textures and models of this kart. This is done when
+ *  the kart is needed the first time (e.g. when it is shown in the kart
+ *  selection screen, or used in a race), so that the (possibly many) karts
+ *  that are never used do not slow down startup or use memory.
+ */
+void KartProperties::loadModels()
+{
+    if (m_models_loaded)
+        return;
+    m_models_loaded = true;
+
     // Load material
     std::string materials_file = m_root+"materials.xml";
     file_manager->pushModelSearchPath  (m_root);
@@ -243,16 +281,6 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     // addShared makes sure that these textures/material infos stay in memory
     material_manager->addSharedMaterial(materials_file);
 
-    m_icon_file = m_root+m_icon_file;
-
-    // Make permanent is important, since otherwise icons can get deleted
-    // (e.g. when freeing temp. materials from a track, the last icon
-    //  would get deleted, too.
-    m_icon_material = material_manager->getMaterial(m_icon_file,
-                                                    /*is_full_path*/true,
-                                                    /*make_permanent*/true,
-                                                    /*complain_if_not_found*/true,
-                                                    /*strip_path*/false);
     if(m_minimap_icon_file!="")
         m_minimap_icon = irr_driver->getTexture(m_root+m_minimap_icon_file);
     else
@@ -270,10 +298,8 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         const bool success = m_kart_model->loadModels(*this);
         if (!success)
         {
-            delete m_kart_model;
-            file_manager->popTextureSearchPath();
-            file_manager->popModelSearchPath();
-            throw std::runtime_error("Cannot load kart models");
+            Log::fatal("[KartProperties]", "Cannot load the models of "
+                       "kart '%s'.", m_ident.c_str());
         }
     }
 
@@ -306,8 +332,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     irr_driver->unsetTextureErrorMessage();
     file_manager->popTextureSearchPath();
     file_manager->popModelSearchPath();
-
-}   // load
+}   // loadModels
 
 //-----------------------------------------------------------------------------
 /** Actually reads in the data from the xml file.
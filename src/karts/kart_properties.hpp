@@ -84,6 +84,11 @@ private:
      *  the kart_properties object is const. */
     mutable KartModel       *m_kart_model;
 
+    /** True once the models, materials and textures of this kart are
+     *  loaded. This is only done when the kart is first displayed or used
+     *  in a race, see loadModels(). */
+    bool                     m_models_loaded;
+
     /** List of all groups the kart belongs to. */
     std::vector<std::string> m_groups;
 
@@ -401,6 +406,7 @@ private:
 
     void  load              (const std::string &filename,
                              const std::string &node);
+    void  loadModels        ();
 
 
 public:
@@ -434,15 +440,34 @@ public:
     /** Returns the texture to use in the minimap, or NULL if not defined. */
     video::ITexture *getMinimapIcon  () const {return m_minimap_icon;         }
 
+    // ------------------------------------------------------------------------
+    /** Loads the models of this kart if this was not done yet. The kart
+     *  properties are otherwise const, so this is the only place that
+     *  modifies them after the kart.xml file was read. */
+    void ensureModelsLoaded() const
+    {
+        if (!m_models_loaded)
+            const_cast<KartProperties*>(this)->loadModels();
+    }   // ensureModelsLoaded
+    // ------------------------------------------------------------------------
+    /** Returns true if the models of this kart are loaded. */
+    bool areModelsLoaded() const { return m_models_loaded; }
     // ------------------------------------------------------------------------
     /** Returns a pointer to the KartModel object. */
     KartModel*    getKartModelCopy   () const
-                                            {return m_kart_model->makeCopy(); }
+    {
+        ensureModelsLoaded();
+        return m_kart_model->makeCopy();
+    }   // getKartModelCopy
 
     // ------------------------------------------------------------------------
     /** Returns a pointer to the main KartModel object. This copy
      *  should not be modified, not attachModel be called on it. */
-    const KartModel& getMasterKartModel() const {return *m_kart_model;        }
+    const KartModel& getMasterKartModel() const
+    {
+        ensureModelsLoaded();
+        return *m_kart_model;
+    }   // getMasterKartModel
 
     // ------------------------------------------------------------------------
     /** Sets the name of a mesh to be used for this kart.
@@ -24,6 +24,7 @@
 #include "config/player_profile.hpp"
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
+#include "io/content_index.hpp"
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
@@ -157,7 +158,8 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
         // If not, check each subdir of this directory.
         // --------------------------------------------
         std::set<std::string> result;
-        file_manager->listFiles(result, *dir);
+        if(!ContentIndex::listFiles(&result, *dir))
+            file_manager->listFiles(result, *dir);
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
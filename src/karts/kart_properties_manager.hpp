@@ -68,6 +68,9 @@ public:
                              KartPropertiesManager();
                             ~KartPropertiesManager();
     static void              addKartSearchDir       (const std::string &s);
+    /** Returns all directories in which karts are searched. */
+    static const std::vector<std::string> &getKartSearchDirs()
+                                               { return m_kart_search_path; }
     const KartProperties*    getKartById            (int i) const;
     const KartProperties*    getKart(const std::string &ident) const;
     const int                getKartId(const std::string &ident) const;
@@ -20,6 +20,7 @@
 #include <math.h>
 #include "karts/moveable.hpp"
 
+#include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
@@ -35,6 +36,9 @@ Moveable::Moveable()
     m_mesh            = NULL;
     m_node            = NULL;
     m_heading         = 0;
+    m_previous_transform.setIdentity();
+    m_graphics_offset_xyz = Vec3(0, 0, 0);
+    m_graphics_rotation   = btQuaternion(0, 0, 0, 1);
 }   // Moveable
 
 //-----------------------------------------------------------------------------
@@ -66,16 +70,43 @@ void Moveable::setNode(scene::ISceneNode *n)
 void Moveable::updateGraphics(float dt, const Vec3& offset_xyz,
                               const btQuaternion& rotation)
 {
-    Vec3 xyz=getXYZ()+offset_xyz;
+    m_graphics_offset_xyz = offset_xyz;
+    m_graphics_rotation   = rotation;
+    setNodeTransform(getXYZ()+offset_xyz, getRotation()*rotation);
+}   // updateGraphics
+
+//-----------------------------------------------------------------------------
+/** Positions the graphical model in between the previous and the current
+ *  world update. The world is updated with a fixed time step, so without
+ *  this the model would not move smoothly if the frame rate is different.
+ *  \param alpha Time since the last update as fraction of a time step.
+ */
+void Moveable::interpolateGraphics(float alpha)
+{
+    if (!m_node)
+        return;
+    Vec3 xyz = m_previous_transform.getOrigin().lerp(getXYZ(), alpha);
+    btQuaternion r = m_previous_transform.getRotation()
+                         .slerp(getRotation(), alpha);
+    setNodeTransform(xyz + m_graphics_offset_xyz, r*m_graphics_rotation);
+}   // interpolateGraphics
+
+//-----------------------------------------------------------------------------
+/** Sets the position and rotation of the scene node.
+ *  \param xyz Position of the node.
+ *  \param rotation Rotation of the node.
+ */
+void Moveable::setNodeTransform(const Vec3 &xyz, const btQuaternion &rotation)
+{
     m_node->setPosition(xyz.toIrrVector());
-    btQuaternion r_all = getRotation()*rotation;
+    btQuaternion r_all = rotation;
     if(btFuzzyZero(r_all.getX()) && btFuzzyZero(r_all.getY()-0.70710677f) &&
        btFuzzyZero(r_all.getZ()) && btFuzzyZero(r_all.getW()-0.70710677f)   )
         r_all.setX(0.000001f);
     Vec3 hpr;
     hpr.setHPR(r_all);
     m_node->setRotation(hpr.toIrrHPR());
-}   // updateGraphics
+}   // setNodeTransform
 
 //-----------------------------------------------------------------------------
 /** The reset position must be set before calling reset
@@ -88,6 +119,7 @@ void Moveable::reset()
         m_body->setAngularVelocity(btVector3(0, 0, 0));
         m_body->setCenterOfMassTransform(m_transform);
     }
+    m_previous_transform = m_transform;
     m_node->setVisible(true);  // In case that the objects was eliminated
 
     Vec3 up       = getTrans().getBasis().getColumn(1);
@@ -125,6 +157,18 @@ void Moveable::stopFlying()
  *  \param float dt Time step size.
  */
 void Moveable::update(float dt)
+{
+    updatePosition();
+    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Updates the transform, velocity and orientation of this moveable from the
+ *  physics body. This is done as part of update(), but can be called before
+ *  to get the positions of all objects first (e.g. before the AI makes its
+ *  decisions in parallel).
+ */
+void Moveable::updatePosition()
 {
     if(m_body->getInvMass()!=0)
         m_motion_state->getWorldTransform(m_transform);
@@ -138,9 +182,7 @@ void Moveable::update(float dt)
     Vec3 up       = getTrans().getBasis().getColumn(1);
     m_pitch       = atan2(up.getZ(), fabsf(up.getY()));
     m_roll        = atan2(up.getX(), up.getY());
-
-    updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
-}   // update
+}   // updatePosition
 
 //-----------------------------------------------------------------------------
 /** Creates the bullet rigid body for this moveable.
@@ -155,6 +197,7 @@ void Moveable::createBody(float mass, btTransform& trans,
     btVector3 inertia;
     shape->calculateLocalInertia(mass, inertia);
     m_transform = trans;
+    m_previous_transform = trans;
     m_motion_state = new KartMotionState(trans);
 
     btRigidBody::btRigidBodyConstructionInfo info(mass, m_motion_state,
@@ -171,6 +214,21 @@ void Moveable::createBody(float mass, btTransform& trans,
                                   btCollisionObject::CF_KINEMATIC_OBJECT );
         m_body->setActivationState(DISABLE_DEACTIVATION);
     }
+    else if (stk_config->m_physics_ccd)
+    {
+        // Bullet only sweeps a body if it moves more than the threshold in
+        // one step, so slow objects don't pay for CCD. The swept sphere
+        // must be inside the shape, otherwise resting contacts would stop
+        // the motion.
+        btTransform identity;
+        identity.setIdentity();
+        btVector3 min, max;
+        shape->getAabb(identity, min, max);
+        const btVector3 half_extent = (max - min) * 0.5f;
+        const float radius = half_extent[half_extent.minAxis()];
+        m_body->setCcdMotionThreshold(radius);
+        m_body->setCcdSweptSphereRadius(0.8f * radius);
+    }
 
     // The value of user_pointer must be set from the actual class, otherwise this
     // is only a pointer to moveable, not to (say) kart, and virtual
@@ -187,6 +245,8 @@ void Moveable::createBody(float mass, btTransform& trans,
 void Moveable::setTrans(const btTransform &t)
 {
     m_transform=t;
+    // Don't interpolate from the old position
+    m_previous_transform = t;
     if(m_motion_state)
         m_motion_state->setWorldTransform(t);
 }   // setTrans
@@ -49,6 +49,14 @@ private:
     float                  m_pitch;
     /** The roll between -180 and 180 degrees. */
     float                  m_roll;
+    /** The transform at the end of the previous world update. */
+    btTransform            m_previous_transform;
+    /** The graphical offsets of the last updateGraphics call, which are
+     *  also used when interpolating. */
+    Vec3                   m_graphics_offset_xyz;
+    btQuaternion           m_graphics_rotation;
+
+    void setNodeTransform(const Vec3 &xyz, const btQuaternion &rotation);
 
 protected:
     UserPointer            m_user_pointer;
@@ -102,8 +110,10 @@ public:
     // ------------------------------------------------------------------------
     virtual void  updateGraphics(float dt, const Vec3& off_xyz,
                                  const btQuaternion& off_rotation);
+    void          interpolateGraphics(float alpha);
     virtual void  reset();
     virtual void  update(float dt) ;
+    void          updatePosition();
     btRigidBody  *getBody() const {return m_body; }
     void          createBody(float mass, btTransform& trans,
                              btCollisionShape *shape,
@@ -111,6 +121,10 @@ public:
     const btTransform
                  &getTrans() const {return m_transform;}
     void          setTrans(const btTransform& t);
+    // ------------------------------------------------------------------------
+    /** Called at the start of each world update to remember where this
+     *  moveable was, see interpolateGraphics(). */
+    void          storePreviousTrans() { m_previous_transform = m_transform; }
 }
 ;   // class Moveable
 
@@ -153,11 +153,17 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/dynamic_resolution.hpp"
+#include "graphics/gpu_benchmark.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/occlusion_buffer.hpp"
 #include "graphics/particle_kind_manager.hpp"
+#include "graphics/particle_pool.hpp"
 #include "graphics/referee.hpp"
+#include "graphics/shadow_cache.hpp"
+#include "graphics/video_capture.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
@@ -165,6 +171,8 @@
 #include "input/input_manager.hpp"
 #include "input/keyboard_device.hpp"
 #include "input/wiimote_manager.hpp"
+#include "io/background_writer.hpp"
+#include "io/content_index.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment_manager.hpp"
 #include "items/item_manager.hpp"
@@ -175,8 +183,13 @@
 #include "modes/demo_world.hpp"
 #include "modes/profile_world.hpp"
 #include "network/client_network_manager.hpp"
+#include "network/kart_state_snapshot.hpp"
+#include "network/network_bit_stream.hpp"
+#include "network/network_clock.hpp"
 #include "network/network_manager.hpp"
+#include "network/network_simulator.hpp"
 #include "network/protocol_manager.hpp"
+#include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/server_lobby_room_protocol.hpp"
 #include "network/client_network_manager.hpp"
 #include "network/server_network_manager.hpp"
@@ -189,6 +202,7 @@
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
+#include "race/telemetry.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
 #include "states_screens/main_menu_screen.hpp"
@@ -201,8 +215,13 @@
 #include "utils/command_line.hpp"
 #include "utils/constants.hpp"
 #include "utils/crash_reporting.hpp"
+#include "utils/frame_arena.hpp"
+#include "utils/job_system.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/load_profiler.hpp"
 #include "utils/log.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/micro_benchmark.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -526,6 +545,22 @@ void cmdLineHelp()
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
     "       --no-graphics      Do not display the actual race.\n"
+    "       --bot-client       Join a server (quick join) without graphics\n"
+    "                          and sound, and let an AI drive. Needs\n"
+    "                          --login and --password.\n"
+    "       --benchmark=TRACK  Profile a fixed AI race on TRACK and print "
+                              "percentiles of the frame times.\n"
+    "       --profile-json=FILE Write the results of a profile run as json "
+                              "to FILE.\n"
+    "       --micro-benchmark=FILE Run the micro benchmarks of core engine\n"
+    "                          functions and write the results as json to "
+                              "FILE.\n"
+    "       --micro-benchmark-size=n Size of the synthetic data used by the\n"
+    "                          micro benchmarks (default 1000).\n"
+    "       --profile-loading  Print how long each stage of loading a track "
+                              "takes.\n"
+    "       --profile-loading=FILE Additionally append the loading times as "
+                              "json to FILE.\n"
     "       --with-profile     Enables the profile mode.\n"
     "       --demo-mode=t      Enables demo mode after t seconds idle time in "
                                "main menu.\n"
@@ -534,6 +569,18 @@ void cmdLineHelp()
     "       --demo-laps=n      Number of laps in a demo.\n"
     "       --demo-karts=n     Number of karts to use in a demo.\n"
     "       --ghost            Replay ghost data together with one player kart.\n"
+    "       --verify-history=FILE Replay the history FILE and check the "
+                              "recorded finish times.\n"
+    "       --telemetry=n      Record the position, speed, controls and events\n"
+    "                          of all karts n times per second.\n"
+    "       --telemetry-dir=d  Directory for the telemetry files (default is\n"
+    "                          the config directory).\n"
+    "       --capture-video=n  Record each race as a video with n frames per\n"
+    "                          second.\n"
+    "       --capture-offline  Render the captured races with a fixed time step\n"
+    "                          as fast as possible (e.g. for replays).\n"
+    "       --capture-dir=d    Directory for the videos (default is the\n"
+    "                          screenshot directory).\n"
     // "       --history          Replay history file 'history.dat'.\n"
     // "       --history=n        Replay history file 'history.dat' using:\n"
     // "                            n=1: recorded positions\n"
@@ -543,12 +590,24 @@ void cmdLineHelp()
     "       --password=s       Automatically log in (set the password).\n"
     "       --port=n           Port number to use.\n"
     "       --max-players=n    Maximum number of clients (server only).\n"
+    "       --max-rooms=n      Maximum number of lobbies (server only).\n"
+    "       --metrics-port=n   Offer metrics over HTTP on this local port\n"
+    "                          (server without graphics only).\n"
+    "       --net-latency=n    Delay received packets by n ms.\n"
+    "       --net-jitter=n     Change the delay randomly by up to n ms.\n"
+    "       --net-loss=n       Lose n percent of the received packets.\n"
+    "       --net-reorder=n    Reorder n percent of the received packets.\n"
+    "       --net-bandwidth=n  Limit the bandwidth from each peer to n kbit/s.\n"
+    "       --net-seed=n       Seed for the random values of the --net-\n"
+    "                          options, to reproduce a test.\n"
     "       --no-console       Does not write messages in the console but to\n"
     "                          stdout.log.\n"
     "       --console          Write messages in the console and files\n"
     "  -h,  --help             Show this help.\n"
     "       --log=N            Set the verbosity to a value between\n"
     "                          0 (Debug) and 5 (Only Fatal messages)\n"
+    "       --log-rate=N       Print at most N debug, verbose and info\n"
+    "                          messages per second for each component.\n"
     "\n"
     "You can visit SuperTuxKart's homepage at "
     "http://supertuxkart.sourceforge.net\n\n",
@@ -586,6 +645,8 @@ int handleCmdLineOutputModifier()
     int n;
     if(CommandLine::has("--log", &n))
         Log::setLogLevel(n);
+    if(CommandLine::has("--log-rate", &n))
+        Log::setRateLimit(n);
 
     if(CommandLine::has("--log=nocolor"))
     {
@@ -641,7 +702,11 @@ int handleCmdLinePreliminary()
     if(CommandLine::has("--kartdir", &s))
         KartPropertiesManager::addKartSearchDir(s);
 
-    if(CommandLine::has("--no-graphics") || CommandLine::has("-l"))
+    if(CommandLine::has("--bot-client"))
+        UserConfigParams::m_bot_client = true;
+
+    if(CommandLine::has("--no-graphics") || CommandLine::has("-l") ||
+       UserConfigParams::m_bot_client)
     {
         ProfileWorld::disableGraphics();
         UserConfigParams::m_log_errors_to_console=true;
@@ -737,6 +802,10 @@ int handleCmdLine()
 
     if (CommandLine::has("--unit-testing"))
         UserConfigParams::m_unit_testing = true;
+    if (CommandLine::has("--micro-benchmark", &s))
+        UserConfigParams::m_micro_benchmark = s;
+    if (CommandLine::has("--micro-benchmark-size", &n))
+        UserConfigParams::m_micro_benchmark_size = n;
     if (CommandLine::has("--gamepad-debug"))
         UserConfigParams::m_gamepad_debug=true;
     if (CommandLine::has("--keyboard-debug"))
@@ -781,6 +850,43 @@ int handleCmdLine()
 
     if(CommandLine::has("--max-players", &n))
         UserConfigParams::m_server_max_players=n;
+    if(CommandLine::has("--max-rooms", &n))
+        UserConfigParams::m_server_max_rooms=n;
+    if(CommandLine::has("--metrics-port", &n))
+        UserConfigParams::m_server_metrics_port=n;
+
+    // Simulated network conditions
+    NetworkSimulator::Settings net_settings;
+    bool simulate_network = false;
+    if(CommandLine::has("--net-latency", &n))
+    {
+        net_settings.m_latency = (float)std::max(n, 0);
+        simulate_network = true;
+    }
+    if(CommandLine::has("--net-jitter", &n))
+    {
+        net_settings.m_jitter = (float)std::max(n, 0);
+        simulate_network = true;
+    }
+    if(CommandLine::has("--net-loss", &n))
+    {
+        net_settings.m_loss = core::clamp(n, 0, 100) / 100.0f;
+        simulate_network = true;
+    }
+    if(CommandLine::has("--net-reorder", &n))
+    {
+        net_settings.m_reorder = core::clamp(n, 0, 100) / 100.0f;
+        simulate_network = true;
+    }
+    if(CommandLine::has("--net-bandwidth", &n))
+    {
+        net_settings.m_bandwidth = std::max(n, 0);
+        simulate_network = true;
+    }
+    if(CommandLine::has("--net-seed", &n))
+        net_settings.m_seed = n;
+    if(simulate_network)
+        NetworkSimulator::create(net_settings);
 
     if(CommandLine::has("--login", &s) )
     {
@@ -974,6 +1080,34 @@ int handleCmdLine()
         race_manager->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
 
+    if(CommandLine::has("--benchmark", &s))
+    {
+        Log::verbose("main", "Benchmarking track '%s'.", s.c_str());
+        race_manager->setTrack(s);
+        UserConfigParams::m_no_start_screen = true;
+        ProfileWorld::enableBenchmark();
+        if(!ProfileWorld::isProfileMode())
+        {
+            ProfileWorld::setProfileModeTime(60.0f);
+            race_manager->setNumLaps(999999); // profile end depends on time
+        }
+        // The profile race uses a fixed time step, so with a fixed seed
+        // every run shows the same race from the same camera path.
+        srand(1);
+    }   // --benchmark
+
+    if(CommandLine::has("--profile-loading", &s))
+        LoadProfiler::enable(s);
+    else if(CommandLine::has("--profile-loading"))
+        LoadProfiler::enable("");
+
+    if(CommandLine::has("--profile-json", &s))
+    {
+        Log::verbose("main", "Profile results will be written to '%s'.",
+                     s.c_str());
+        ProfileWorld::setJsonFile(s);
+    }   // --profile-json
+
     if(CommandLine::has("--with-profile") )
     {
         // Set default profile mode of 1 lap if we haven't already set one
@@ -1003,6 +1137,36 @@ int handleCmdLine()
         UserConfigParams::m_no_start_screen = true;
     }   // --history
 
+    if(CommandLine::has("--verify-history", &s))
+    {
+        history->doVerify(s);
+        UserConfigParams::m_no_start_screen = true;
+    }   // --verify-history
+
+    if(CommandLine::has("--telemetry", &n))
+    {
+        if(n <= 0)
+        {
+            Log::error("main", "Invalid telemetry rate: %i.", n);
+            return 0;
+        }
+        Telemetry::create(n);
+        if(CommandLine::has("--telemetry-dir", &s))
+            Telemetry::get()->setDirectory(s);
+    }   // --telemetry
+
+    if(CommandLine::has("--capture-video", &n))
+    {
+        if(n <= 0)
+        {
+            Log::error("main", "Invalid video frame rate: %i.", n);
+            return 0;
+        }
+        VideoCapture::create(n, CommandLine::has("--capture-offline"));
+        if(CommandLine::has("--capture-dir", &s))
+            VideoCapture::get()->setDirectory(s);
+    }   // --capture-video
+
     // Demo mode
     if(CommandLine::has("--demo-mode", &s))
     {
@@ -1099,6 +1263,7 @@ void initUserConfig()
 void initRest()
 {
     stk_config->load(file_manager->getAsset("stk_config.xml"));
+    JobSystem::create();
 
     irr_driver = new IrrDriver();
     StkTime::init();   // grabs the timer object from the irrlicht device
@@ -1153,6 +1318,9 @@ void initRest()
                  file_manager->getAddonsFile("karts/"));
     track_manager->addTrackSearchDir(
                  file_manager->getAddonsFile("tracks/"));
+    // Lists all content and parses the kart, challenge, grand prix and
+    // achievement files on the job system while the tracks are loaded.
+    ContentIndex::create();
 
     track_manager->loadTrackList();
     music_manager->addMusicToTracks();
@@ -1267,6 +1435,9 @@ int main(int argc, char *argv[] )
         // not have) other managers initialised:
         initUserConfig();
 
+        // Write all log messages from a separate thread from now on.
+        Log::startWriterThread();
+
         handleCmdLinePreliminary();
 
         initRest();
@@ -1301,6 +1472,7 @@ int main(int argc, char *argv[] )
         // and karts.
         unlock_manager = new UnlockManager();
         AchievementsManager::create();
+        ContentIndex::destroy();
 
         // Reading the rest of the player data needs the unlock manager to
         // initialise the game slots of all players and the AchievementsManager
@@ -1356,6 +1528,16 @@ int main(int argc, char *argv[] )
         {
             ProtocolManager::getInstance()->requestStart(new ServerLobbyRoomProtocol());
         }
+        else if (UserConfigParams::m_bot_client)
+        {
+            if (!PlayerManager::isCurrentLoggedIn())
+            {
+                Log::error("main", "A bot client must be logged in, use "
+                           "--login and --password.");
+                exit(0);
+            }
+            ProtocolManager::getInstance()->requestStart(new ConnectToServer());
+        }
 
         addons_manager->checkInstalledAddons();
 
@@ -1385,6 +1567,13 @@ int main(int argc, char *argv[] )
             exit(0);
         }
 
+        if(UserConfigParams::m_micro_benchmark.size()>0)
+        {
+            MicroBenchmark::run(UserConfigParams::m_micro_benchmark,
+                                UserConfigParams::m_micro_benchmark_size);
+            exit(0);
+        }
+
         if (!ProfileWorld::isNoGraphics() &&
             GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_DRIVER_RECENT_ENOUGH))
         {
@@ -1411,6 +1600,11 @@ int main(int argc, char *argv[] )
             Log::warn("OpenGL", "OpenGL version is too old!");
         }
 
+        // Choose the graphics preset from the speed of the GPU at the
+        // first start
+        if (!ProfileWorld::isNoGraphics())
+            GPUBenchmark::runIfNeeded();
+
         // Note that on the very first run of STK internet status is set to
         // "not asked", so the report will only be sent in the next run.
         if(UserConfigParams::m_internet_status==Online::RequestManager::IPERM_ALLOWED)
@@ -1477,9 +1671,10 @@ int main(int argc, char *argv[] )
             race_manager->setupPlayerKartInfo();
             race_manager->startNew(false);
             main_loop->run();
-            // well, actually run() will never return, since
-            // it exits after replaying history (see history::GetNextDT()).
-            // So the next line is just to make this obvious here!
+            // run() only returns after verifying a history, otherwise
+            // the history is replayed again and again.
+            if(history->isVerifying())
+                exit(history->hasVerificationFailed() ? 1 : 0);
             exit(-3);
         }
 
@@ -1528,6 +1723,8 @@ int main(int argc, char *argv[] )
 
     cleanSuperTuxKart();
 
+    MemoryTracker::report();
+
 #ifdef DEBUG
     MemoryLeaks::checkForLeaks();
 #endif
@@ -1589,11 +1786,15 @@ static void cleanSuperTuxKart()
     if(material_manager)        delete material_manager;
     if(history)                 delete history;
     ReplayRecorder::destroy();
+    Telemetry::destroy();
+    VideoCapture::destroy();
     delete ParticleKindManager::get();
     PlayerManager::destroy();
     if(unlock_manager)          delete unlock_manager;
     Online::ProfileManager::destroy();
     GUIEngine::DialogQueue::deallocate();
+    FrameArena::destroy();
+    JobSystem::destroy();
 
     // Now finish shutting down objects which a separate thread. The
     // RequestManager has been signaled to shut down as early as possible,
@@ -1634,6 +1835,7 @@ static void cleanSuperTuxKart()
     // moved further up?
     Online::ServersManager::deallocate();
     NetworkManager::kill();
+    NetworkSimulator::destroy();
 
     cleanUserConfig();
 
@@ -1656,6 +1858,8 @@ static void cleanUserConfig()
         user_config->saveConfig();
         delete user_config;
     }
+    // Wait till the config files are written
+    BackgroundWriter::destroy();
 
     if(irr_driver)              delete irr_driver;
 }   // cleanUserConfig
@@ -1663,7 +1867,14 @@ static void cleanUserConfig()
 //=============================================================================
 void runUnitTests()
 {
+    DynamicResolution::unitTesting();
+    ShadowCache::unitTesting();
     GraphicsRestrictions::unitTesting();
+    KartStateSnapshot::unitTesting();
+    NetworkBitWriter::unitTesting();
+    NetworkClock::unitTesting();
+    OcclusionBuffer::unitTesting();
+    ParticlePool::unitTesting();
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
     // before and after
     int saved_easter_mode = UserConfigParams::m_easter_ear_mode;
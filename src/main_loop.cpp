@@ -19,22 +19,31 @@
 
 #include "main_loop.hpp"
 
+#include <algorithm>
 #include <assert.h>
 
 #include "audio/sfx_manager.hpp"
+#include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/video_capture.hpp"
 #include "guiengine/engine.hpp"
 #include "input/input_manager.hpp"
 #include "input/wiimote_manager.hpp"
 #include "modes/profile_world.hpp"
 #include "modes/world.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "network/server_metrics.hpp"
+#include "network/server_tick_scheduler.hpp"
 #include "online/request_manager.hpp"
+#include "race/history.hpp"
 #include "race/race_manager.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/frame_arena.hpp"
+#include "utils/memory_tracker.hpp"
 #include "utils/profiler.hpp"
 
 MainLoop* main_loop = 0;
@@ -45,6 +54,9 @@ m_frame_count(0)
 {
     m_curr_time = 0;
     m_prev_time = 0;
+    m_world_time_remainder = 0.0f;
+    m_next_frame_time = 0;
+    m_sleep_overshoot = 1.0f;
     m_throttle_fps = true;
 }  // MainLoop
 
@@ -53,43 +65,92 @@ MainLoop::~MainLoop()
 {
 }   // ~MainLoop
 
+//-----------------------------------------------------------------------------
+/** Returns the maximum frame rate for the current state of the game. Menus
+ *  use a reduced frame rate (even more so if nothing has happened for a
+ *  while), and the frame rate is also reduced if the window is not focused
+ *  or minimised. During a race the frame rate is never reduced below 20 fps,
+ *  since dt is limited to 3 physics steps, so the race would slow down.
+ */
+int MainLoop::getMaxFPS()
+{
+    IrrlichtDevice* device = irr_driver->getDevice();
+    const bool in_menu = StateManager::get()->throttleFPS();
+
+    int max_fps = UserConfigParams::m_max_fps;
+    if (in_menu)
+        max_fps = StateManager::get()->isMenuIdle() ? 10 : 30;
+
+    if (device->isWindowMinimized())
+        max_fps = std::min(max_fps, in_menu ? 10 : 20);
+    else if (!device->isWindowActive())
+        max_fps = std::min(max_fps, in_menu ? 10 : 30);
+    return max_fps;
+}   // getMaxFPS
+
 //-----------------------------------------------------------------------------
 /** Returns the current dt, which guarantees a limited frame rate. If dt is
  *  too low (the frame rate too high), the process will sleep to reach the
- *  maxium frame rate.
+ *  maxium frame rate. To get an even frame rate despite the coarse
+ *  granularity of sleep, it sleeps a bit less than necessary (based on how
+ *  much previous sleeps overshot) and waits actively for the rest.
  */
 float MainLoop::getLimitedDt()
 {
     IrrlichtDevice* device = irr_driver->getDevice();
     m_prev_time = m_curr_time;
 
-    float dt;  // needed outside of the while loop
-    while( 1 )
+    m_curr_time = device->getTimer()->getRealTime();
+
+    // Throttle fps if more than maximum, which can reduce
+    // the noise the fan on a graphics card makes.
+    // Offline video capture renders as fast as possible
+    const bool offline_capture = VideoCapture::get() &&
+                                 VideoCapture::get()->getFixedDt() > 0;
+    if (m_throttle_fps && !ProfileWorld::isProfileMode() &&
+        !history->isVerifying() && !offline_capture)
     {
-        m_curr_time = device->getTimer()->getRealTime();
-        dt = (float)(m_curr_time - m_prev_time);
-
-        // don't allow the game to run slower than a certain amount.
-        // when the computer can't keep it up, slow down the shown time instead
-        static const float max_elapsed_time = 3.0f*1.0f/60.0f*1000.0f; /* time 3 internal substeps take */
-        if(dt > max_elapsed_time) dt=max_elapsed_time;
-
-        // Throttle fps if more than maximum, which can reduce
-        // the noise the fan on a graphics card makes.
-        // When in menus, reduce FPS much, it's not necessary to push to the maximum for plain menus
-        const int max_fps = (StateManager::get()->throttleFPS() ? 30 : UserConfigParams::m_max_fps);
-        const int current_fps = (int)(1000.0f/dt);
-        if (m_throttle_fps && current_fps > max_fps && !ProfileWorld::isProfileMode())
-        {
-            int wait_time = 1000/max_fps - 1000/current_fps;
-            if(wait_time < 1) wait_time = 1;
+        const double frame_time = 1000.0 / getMaxFPS();
+        m_next_frame_time += frame_time;
+        // If the frame took too long, start again from now instead of
+        // trying to catch up with shorter frames.
+        if (m_next_frame_time < m_curr_time)
+            m_next_frame_time = m_curr_time;
+        else if (m_next_frame_time > m_curr_time + frame_time)
+            m_next_frame_time = m_prev_time + frame_time;
 
+        if (m_next_frame_time > m_curr_time)
+        {
             PROFILER_PUSH_CPU_MARKER("Throttle framerate", 0, 0, 0);
-            StkTime::sleep(wait_time);
+            // Never wait actively for more than 2 ms, even if the sleep
+            // granularity is worse, since that would only burn CPU time.
+            const int sleep_time = (int)(m_next_frame_time - m_curr_time
+                                   - std::min(m_sleep_overshoot, 2.0f));
+            if (sleep_time > 0)
+            {
+                StkTime::sleep(sleep_time);
+                Uint32 now = device->getTimer()->getRealTime();
+                float overshoot = (float)(now - m_curr_time) - sleep_time;
+                m_sleep_overshoot = 0.9f * m_sleep_overshoot
+                                  + 0.1f * std::max(overshoot, 0.0f);
+                m_curr_time = now;
+            }
+            while (m_curr_time < m_next_frame_time)
+            {
+                StkTime::sleep(0);
+                m_curr_time = device->getTimer()->getRealTime();
+            }
             PROFILER_POP_CPU_MARKER();
         }
-        else break;
     }
+
+    float dt = (float)(m_curr_time - m_prev_time);
+
+    // don't allow the game to run slower than a certain amount.
+    // when the computer can't keep it up, slow down the shown time instead
+    static const float max_elapsed_time = 3.0f*1.0f/60.0f*1000.0f; /* time 3 internal substeps take */
+    if(dt > max_elapsed_time) dt=max_elapsed_time;
+
     dt *= 0.001f;
     return dt;
 }   // getLimitedDt
@@ -102,17 +163,99 @@ void MainLoop::updateRace(float dt)
 {
     if(ProfileWorld::isProfileMode()) dt=1.0f/60.0f;
 
-    if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
-        NetworkWorld::getInstance<NetworkWorld>()->update(dt);
-    else
-        World::getWorld()->updateWorld(dt);
+    // Verify a history as fast as possible: one world update per frame
+    if(history->isVerifying()) dt = 1.0f / stk_config->m_physics_fps;
+
+    // Each rendered frame is one video frame when capturing offline
+    if (VideoCapture::get() && VideoCapture::get()->getFixedDt() > 0)
+        dt = VideoCapture::get()->getFixedDt();
+
+    // The world is always updated with the same time step, so the results
+    // don't depend on the frame rate. Graphics are interpolated between the
+    // last two updates. Since dt is limited, there are only a few updates
+    // if the computer can't keep up.
+    const float step = 1.0f / stk_config->m_physics_fps;
+    m_world_time_remainder += dt;
+    while (m_world_time_remainder >= step && World::getWorld() && !m_abort)
+    {
+        m_world_time_remainder -= step;
+        if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
+            NetworkWorld::getInstance<NetworkWorld>()->update(step);
+        else
+            World::getWorld()->updateWorld(step);
+    }
+
+    // The world might have been deleted during the update
+    if (World::getWorld() && !ProfileWorld::isNoGraphics())
+        World::getWorld()->interpolateGraphics(m_world_time_remainder / step);
 }   // updateRace
 
+//-----------------------------------------------------------------------------
+/** The main loop of a dedicated server without graphics. Instead of a
+ *  frame rate that is limited, each tick simulates exactly one world time
+ *  step, and the ticks are started at a fixed rate by the
+ *  ServerTickScheduler, which also logs how long the ticks take.
+ */
+void MainLoop::runServer()
+{
+    ServerTickScheduler scheduler(stk_config->m_physics_fps);
+    const float step = scheduler.getStep();
+    if (UserConfigParams::m_server_metrics_port > 0)
+        ServerMetrics::init(UserConfigParams::m_server_metrics_port);
+    while (!m_abort)
+    {
+        scheduler.waitForNextTick();
+        PROFILER_PUSH_CPU_MARKER("Server tick", 0xFF, 0x00, 0xF7);
+
+        if (World::getWorld())
+        {
+            PROFILER_PUSH_CPU_MARKER("Update race", 0, 255, 255);
+            if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
+                NetworkWorld::getInstance<NetworkWorld>()->update(step);
+            else
+                World::getWorld()->updateWorld(step);
+            PROFILER_POP_CPU_MARKER();
+        }
+
+        if (!m_abort)
+        {
+            PROFILER_PUSH_CPU_MARKER("Protocol manager update", 0x7F, 0x00, 0x7F);
+            ProtocolManager::getInstance()->update();
+            PROFILER_POP_CPU_MARKER();
+
+            PROFILER_PUSH_CPU_MARKER("Database polling update", 0x00, 0x7F, 0x7F);
+            Online::RequestManager::get()->update(step);
+            PROFILER_POP_CPU_MARKER();
+
+            ServerMetrics::update();
+        }
+
+        PROFILER_POP_CPU_MARKER();
+        PROFILER_SYNC_FRAME();
+
+        FrameArena::get()->reset();
+        MemoryTracker::endFrame();
+        MemoryTracker::setPhase(World::getWorld() ? MemoryTracker::PHASE_RACE
+                                                  : MemoryTracker::PHASE_MENU);
+        scheduler.endTick();
+    }   // while !m_abort
+    scheduler.report();
+    ServerMetrics::destroy();
+}   // runServer
+
 //-----------------------------------------------------------------------------
 /** Run the actual main loop.
  */
 void MainLoop::run()
 {
+    NetworkManager *network_manager = NetworkManager::getInstance();
+    if (ProfileWorld::isNoGraphics() && !ProfileWorld::isProfileMode() &&
+        network_manager && network_manager->isServer())
+    {
+        runServer();
+        return;
+    }
+
     IrrlichtDevice* device = irr_driver->getDevice();
 
     m_curr_time = device->getTimer()->getRealTime();
@@ -123,7 +266,17 @@ void MainLoop::run()
         m_prev_time = m_curr_time;
         float dt   = getLimitedDt();
 
-        if (World::getWorld())  // race is active if world exists
+        // Handle all input events (and poll the gamepads) only now, after
+        // throttling the frame rate and directly before the world is
+        // updated. This way the physics uses the most recent input, not
+        // the input from before the previous frame was rendered.
+        if (!ProfileWorld::isNoGraphics() && !irr_driver->getDevice()->run())
+        {
+            // User aborted (e.g. closed window)
+            abort();
+        }
+
+        if (World::getWorld() && !m_abort)  // race is active if world exists
         {
             PROFILER_PUSH_CPU_MARKER("Update race", 0, 255, 255);
             updateRace(dt);
@@ -144,7 +297,10 @@ void MainLoop::run()
                 wiimote_manager->update();
             #endif
             
-            GUIEngine::update(dt);
+            {
+                MemoryTracker::ScopedTag memory_tag(MemoryTracker::TAG_GUI);
+                GUIEngine::update(dt);
+            }
             PROFILER_POP_CPU_MARKER();
 
             PROFILER_PUSH_CPU_MARKER("IrrDriver update", 0x00, 0x00, 0x7F);
@@ -179,6 +335,19 @@ void MainLoop::run()
 
         PROFILER_POP_CPU_MARKER();
         PROFILER_SYNC_FRAME();
+
+        // All per frame data is freed now
+        FrameArena::get()->reset();
+        MemoryTracker::endFrame();
+        MemoryTracker::setPhase(World::getWorld() ? MemoryTracker::PHASE_RACE
+                                                  : MemoryTracker::PHASE_MENU);
+
+        if (!m_abort && ProfileWorld::isBenchmark())
+        {
+            ProfileWorld *world = dynamic_cast<ProfileWorld*>(World::getWorld());
+            if (world)
+                world->recordFrame();
+        }
     }  // while !m_abort
 
 }   // run
@@ -34,8 +34,20 @@ private:
     int      m_frame_count;
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+    /** Time that has passed but was not simulated yet, always less than one
+     *  world time step. */
+    float    m_world_time_remainder;
+    /** Time (in ms) at which the next frame should start if the frame rate
+     *  is limited. Kept as double so that e.g. 60 fps alternates between
+     *  16 and 17 ms frames instead of always using 16 ms. */
+    double   m_next_frame_time;
+    /** Moving average of how much longer (in ms) a sleep takes than
+     *  requested, the remaining time is spent waiting actively. */
+    float    m_sleep_overshoot;
+    int      getMaxFPS();
     float    getLimitedDt();
     void     updateRace(float dt);
+    void     runServer();
 public:
          MainLoop();
         ~MainLoop();
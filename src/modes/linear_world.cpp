@@ -35,6 +35,7 @@
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 //-----------------------------------------------------------------------------
@@ -86,6 +87,7 @@ void LinearWorld::reset()
     WorldWithRank::reset();
     m_last_lap_sfx_played = false;
     m_last_lap_sfx_playing = false;
+    m_race_order.clear();
 
     const unsigned int kart_amount = (unsigned int) m_karts.size();
     for(unsigned int i=0; i<kart_amount; i++)
@@ -645,9 +647,38 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Used to sort the karts in updateRacePosition(). Returns true if kart a
+ *  is ranked before kart b: karts still racing are before eliminated and
+ *  finished karts (which keep their position anyway), and are sorted by
+ *  their overall distance, or by their initial position if the distance
+ *  is the same (very unlikely).
+ *  \param a, b World ids of the two karts.
+ */
+bool LinearWorld::isRankedAhead(unsigned int a, unsigned int b) const
+{
+    const bool a_racing = !m_karts[a]->isEliminated() &&
+                          !m_karts[a]->hasFinishedRace();
+    const bool b_racing = !m_karts[b]->isEliminated() &&
+                          !m_karts[b]->hasFinishedRace();
+    if(a_racing != b_racing)
+        return a_racing;
+    if(!a_racing)
+        return a < b;
+    const float distance_a = m_kart_info[a].m_overall_distance;
+    const float distance_b = m_kart_info[b].m_overall_distance;
+    if(distance_a != distance_b)
+        return distance_a > distance_b;
+    return m_karts[a]->getInitialPosition() < m_karts[b]->getInitialPosition();
+}   // isRankedAhead
+
+//-----------------------------------------------------------------------------
+/** Find the position (rank) of every kart. All karts that have finished
+ *  the race are ahead of the karts still racing, which are sorted by their
+ *  overall distance (or their initial position if the distance is the
+ *  same). This gives the same ranks as counting for each kart how many
+ *  other karts are ahead of it. Since ranks rarely change, the order of
+ *  the previous call is sorted with an insertion sort, which is O(n) in
+ *  this case (and O(n^2) only in the worst case).
  */
 void LinearWorld::updateRacePosition()
 {
@@ -655,6 +686,39 @@ void LinearWorld::updateRacePosition()
     beginSetKartPositions();
     const unsigned int kart_amount = (unsigned int) m_karts.size();
 
+    if(m_race_order.size() != kart_amount)
+    {
+        m_race_order.resize(kart_amount);
+        for (unsigned int i=0; i<kart_amount; i++)
+            m_race_order[i] = i;
+    }
+    for (unsigned int i=1; i<kart_amount; i++)
+    {
+        const unsigned int id = m_race_order[i];
+        unsigned int j = i;
+        while(j>0 && isRankedAhead(id, m_race_order[j-1]))
+        {
+            m_race_order[j] = m_race_order[j-1];
+            j--;
+        }
+        m_race_order[j] = id;
+    }
+
+    int num_finished = 0;
+    for (unsigned int i=0; i<kart_amount; i++)
+    {
+        if(!m_karts[i]->isEliminated() && m_karts[i]->hasFinishedRace())
+            num_finished++;
+    }
+    std::vector<int> new_position(kart_amount, 0);
+    for (unsigned int i=0; i<kart_amount; i++)
+    {
+        const unsigned int id = m_race_order[i];
+        if(m_karts[id]->isEliminated() || m_karts[id]->hasFinishedRace())
+            break;
+        new_position[id] = num_finished + i + 1;
+    }
+
 #ifdef DEBUG
     bool rank_changed = false;
 #endif
@@ -679,33 +743,11 @@ void LinearWorld::updateRacePosition()
         }
         KartInfo& kart_info = m_kart_info[i];
 
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
-
-        } //next kart
+        // A kart is ahead of this kart if it has:
+        // - finished the race (but this kart hasn't)
+        // - or is ahead
+        // - or has the same distance (very unlikely) but started earlier
+        const int p = new_position[i];
 
 #ifndef DEBUG
         setKartPosition(i, p);
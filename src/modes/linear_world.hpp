@@ -55,6 +55,11 @@ private:
      *  get valid finish times estimates. */
     float       m_distance_increase;
 
+    /** The world ids of all karts in the order of the last call to
+     *  updateRacePosition(). The order changes rarely, so sorting this
+     *  with an insertion sort each frame is nearly linear. */
+    std::vector<unsigned int> m_race_order;
+
     // ------------------------------------------------------------------------
     /** Some additional info that needs to be kept for each kart
      * in this kind of race.
@@ -112,6 +117,7 @@ protected:
     AlignedArray<KartInfo> m_kart_info;
 
     virtual void  checkForWrongDirection(unsigned int i, float dt);
+    bool          isRankedAhead(unsigned int a, unsigned int b) const;
     void          updateRacePosition();
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
@@ -19,14 +19,22 @@
 #include "modes/profile_world.hpp"
 
 #include "main_loop.hpp"
+#include "config/hardware_stats.hpp"
 #include "graphics/camera.hpp"
+#include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "karts/controller/skidding_ai.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
 
 #include <ISceneManager.h>
 
+#include <algorithm>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 
@@ -34,6 +42,8 @@ ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+std::string ProfileWorld::m_json_file;
+bool  ProfileWorld::m_benchmark   = false;
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -56,6 +66,7 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    m_last_frame_time  = 0.0;
 }   // ProfileWorld
 
 //-----------------------------------------------------------------------------
@@ -259,6 +270,12 @@ void ProfileWorld::enterRaceOverState()
     Log::verbose("profile", "min %f  max %f  av %f\n",
                   min_t, max_t, av_t/m_karts.size());
 
+    writeAITimes();
+    if(m_benchmark)
+        printBenchmarkResults();
+    if(!m_json_file.empty())
+        writeJsonResults(runtime);
+
     // Determine maximum length of group name
     unsigned int max_len=4;   // for 'name' heading
     for(std::set<std::string>::iterator it = all_groups.begin();
@@ -347,3 +364,202 @@ void ProfileWorld::enterRaceOverState()
     delete this;
     main_loop->abort();
 }   // enterRaceOverState
+
+//-----------------------------------------------------------------------------
+/** Writes the time used by the main functions of each AI kart to a CSV file
+ *  in the config directory, which helps to find out which tracks make the
+ *  AI expensive.
+ */
+void ProfileWorld::writeAITimes()
+{
+    const std::string filename = file_manager->getUserConfigFile("ai_profile.csv");
+    std::ofstream out(filename.c_str());
+    if(!out.is_open())
+    {
+        Log::warn("profile", "Can't write AI times to '%s'.", filename.c_str());
+        return;
+    }
+    out << "track,kart,controller";
+    for(unsigned int t=0; t<SkiddingAI::AI_TIMER_COUNT; t++)
+    {
+        const char *name = SkiddingAI::getTimerName((SkiddingAI::AITimer)t);
+        out << "," << name << "_ms," << name << "_calls";
+    }
+    out << "\n";
+
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        const SkiddingAI *ai =
+            dynamic_cast<const SkiddingAI*>(m_karts[i]->getController());
+        if(!ai) continue;
+        out << m_track->getIdent() << "," << m_karts[i]->getIdent() << ","
+            << ai->getControllerName();
+        for(unsigned int t=0; t<SkiddingAI::AI_TIMER_COUNT; t++)
+        {
+            SkiddingAI::AITimer timer = (SkiddingAI::AITimer)t;
+            out << "," << ai->getTimerTotal(timer)
+                << "," << ai->getTimerCalls(timer);
+        }
+        out << "\n";
+    }
+    Log::verbose("profile", "AI times written to '%s'.", filename.c_str());
+}   // writeAITimes
+
+//-----------------------------------------------------------------------------
+/** Writes the results of the race and the performance counters as json to
+ *  the file specified with --profile-json, so that the results of many
+ *  (e.g. batch) runs can easily be compared.
+ *  \param runtime Real time the race took in seconds.
+ */
+void ProfileWorld::writeJsonResults(float runtime)
+{
+    HardwareStats::Json json;
+    json.add("track", m_track->getIdent());
+    json.add("mode", m_profile_mode==PROFILE_LAPS ? "laps" : "time");
+    json.add("laps", race_manager->getNumLaps());
+    json.add("num_karts", getNumKarts());
+    json.add("frames", m_frame_count);
+    json.add("race_time", getTime());
+    json.add("runtime", runtime);
+    json.add("fps", (float)m_frame_count/runtime);
+    json.add("speedup", getTime()/runtime);
+
+    std::vector<std::string> karts;
+    const float distance = (float)(m_profile_mode==PROFILE_LAPS
+                                   ? race_manager->getNumLaps() : 1)
+                         * m_track->getTrackLength();
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        KartWithStats *kart = dynamic_cast<KartWithStats*>(m_karts[i]);
+        HardwareStats::Json kart_json;
+        kart_json.add("ident", kart->getIdent());
+        kart_json.add("controller", kart->getController()->getControllerName());
+        kart_json.add("start_position", 1+i);
+        kart_json.add("end_position", kart->getPosition());
+        kart_json.add("finish_time", kart->getFinishTime());
+        kart_json.add("average_lap_time",
+                      kart->getFinishTime()/race_manager->getNumLaps());
+        kart_json.add("average_speed", distance/kart->getFinishTime());
+        kart_json.add("top_speed", kart->getTopSpeed());
+        kart_json.add("skid_time", kart->getSkiddingTime());
+        kart_json.add("rescue_count", kart->getRescueCount());
+        kart_json.add("brake_count", kart->getBrakeCount());
+        kart_json.add("explosion_count", kart->getExplosionCount());
+        kart_json.add("off_track_count", kart->getOffTrackCount());
+        const SkiddingAI *ai =
+            dynamic_cast<const SkiddingAI*>(kart->getController());
+        for(unsigned int t=0; ai && t<SkiddingAI::AI_TIMER_COUNT; t++)
+        {
+            SkiddingAI::AITimer timer = (SkiddingAI::AITimer)t;
+            kart_json.add(std::string(SkiddingAI::getTimerName(timer))+"_ms",
+                          ai->getTimerTotal(timer));
+        }
+        kart_json.finish();
+        karts.push_back(kart_json.toString());
+    }
+    json.addArray("karts", karts);
+
+    if(m_benchmark)
+    {
+        std::vector<std::string> samples;
+        std::map<std::string, std::vector<float> >::iterator i;
+        for(i=m_benchmark_samples.begin(); i!=m_benchmark_samples.end(); i++)
+        {
+            std::vector<float> &values = i->second;
+            std::sort(values.begin(), values.end());
+            HardwareStats::Json sample_json;
+            sample_json.add("name", i->first);
+            sample_json.add("p50", getPercentile(values, 0.50f));
+            sample_json.add("p90", getPercentile(values, 0.90f));
+            sample_json.add("p99", getPercentile(values, 0.99f));
+            sample_json.add("max", values.back());
+            sample_json.finish();
+            samples.push_back(sample_json.toString());
+        }
+        json.addArray("benchmark", samples);
+    }
+    json.finish();
+
+    std::ofstream out(m_json_file.c_str());
+    if(!out.is_open())
+    {
+        Log::warn("profile", "Can't write results to '%s'.",
+                  m_json_file.c_str());
+        return;
+    }
+    out << json.toString() << "\n";
+}   // writeJsonResults
+
+//-----------------------------------------------------------------------------
+/** Called once per frame (after the profiler was synchronised) in benchmark
+ *  mode. Records the frame time, the time of the top level CPU markers of
+ *  the profiler, the GPU timers, and the number of draw calls and triangles.
+ *  Since the profile race is simulated with a fixed time step and a fixed
+ *  random seed, each run of a benchmark shows exactly the same frames.
+ */
+void ProfileWorld::recordFrame()
+{
+    const double now = getTimeMilliseconds();
+    if(m_last_frame_time > 0)
+        m_benchmark_samples["frame ms"].push_back(float(now-m_last_frame_time));
+    m_last_frame_time = now;
+
+    std::map<std::string, double> cpu_times;
+    profiler.getLastFrameCpuTimes(&cpu_times, 1);
+    for(std::map<std::string, double>::iterator i = cpu_times.begin();
+        i != cpu_times.end(); i++)
+    {
+        m_benchmark_samples["cpu "+i->first].push_back((float)i->second);
+    }
+
+    if(m_no_graphics)
+        return;
+
+    unsigned int gpu_time = 0;
+    for(unsigned int i=0; i<Q_LAST; i++)
+    {
+        unsigned int t = irr_driver->getGPUTimer(i).elapsedTimeus();
+        m_benchmark_samples[std::string("gpu ")+Profiler::getGPUPhaseName(i)]
+            .push_back(t*0.001f);
+        gpu_time += t;
+    }
+    m_benchmark_samples["gpu total ms"].push_back(gpu_time*0.001f);
+
+    video::IVideoDriver *driver = irr_driver->getVideoDriver();
+    io::IAttributes     *attr   = irr_driver->getSceneManager()->getParameters();
+    m_benchmark_samples["draw calls"]
+        .push_back((float)attr->getAttributeAsInt("calls"));
+    m_benchmark_samples["triangles"]
+        .push_back((float)driver->getPrimitiveCountDrawn(0));
+}   // recordFrame
+
+//-----------------------------------------------------------------------------
+/** Returns a percentile of a sorted list of values.
+ *  \param sorted The values, sorted in increasing order.
+ *  \param p The percentile, between 0 and 1.
+ */
+float ProfileWorld::getPercentile(const std::vector<float> &sorted, float p)
+{
+    if(sorted.empty())
+        return 0.0f;
+    unsigned int index = (unsigned int)(p*(sorted.size()-1) + 0.5f);
+    return sorted[index];
+}   // getPercentile
+
+//-----------------------------------------------------------------------------
+/** Prints the percentiles of all values recorded in benchmark mode. */
+void ProfileWorld::printBenchmarkResults()
+{
+    Log::verbose("benchmark", "%-32s %10s %10s %10s %10s", "name", "p50",
+                 "p90", "p99", "max");
+    std::map<std::string, std::vector<float> >::iterator i;
+    for(i=m_benchmark_samples.begin(); i!=m_benchmark_samples.end(); i++)
+    {
+        std::vector<float> &values = i->second;
+        std::sort(values.begin(), values.end());
+        Log::verbose("benchmark", "%-32s %10.3f %10.3f %10.3f %10.3f",
+                     i->first.c_str(), getPercentile(values, 0.50f),
+                     getPercentile(values, 0.90f),
+                     getPercentile(values, 0.99f), values.back());
+    }
+}   // printBenchmarkResults
@@ -21,6 +21,10 @@
 
 #include "modes/standard_race.hpp"
 
+#include <map>
+#include <string>
+#include <vector>
+
 class Kart;
 
 /**
@@ -43,6 +47,20 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** If not empty, the results are written as json to this file. */
+    static std::string m_json_file;
+
+    /** True if a benchmark is run, in which case statistics for each
+     *  frame are recorded. */
+    static bool  m_benchmark;
+
+    /** The value of getTimeMilliseconds() at the end of the last frame. */
+    double       m_last_frame_time;
+
+    /** In benchmark mode: for each measured quantity the values of all
+     *  frames. */
+    std::map<std::string, std::vector<float> > m_benchmark_samples;
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -67,6 +85,11 @@ private:
     /** Number of calls to draw. */
     long long    m_num_calls;
 
+    void         writeAITimes();
+    void         writeJsonResults(float runtime);
+    void         printBenchmarkResults();
+    static float getPercentile(const std::vector<float> &sorted, float p);
+
 protected:
     /** In laps based profiling: number of laps to run. Also
      *  used by DemoWorld. */
@@ -85,10 +108,14 @@ public:
     virtual  void        update(float dt);
     virtual  bool        isRaceOver();
     virtual  void        enterRaceOverState();
+    void                 recordFrame();
 
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
     // ------------------------------------------------------------------------
+    /** Sets a file the results are written to as json. */
+    static   void setJsonFile(const std::string &file) { m_json_file = file; }
+    // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
     // ------------------------------------------------------------------------
@@ -97,6 +124,12 @@ public:
     // ------------------------------------------------------------------------
     /** Returns true if no graphics should be displayed. */
     static   bool isNoGraphics()  {return m_no_graphics; }
+    // ------------------------------------------------------------------------
+    /** Enables recording statistics of each frame. */
+    static   void enableBenchmark() { m_benchmark = true; }
+    // ------------------------------------------------------------------------
+    /** Returns true if a benchmark is run. */
+    static   bool isBenchmark() { return m_benchmark; }
 };
 
 #endif
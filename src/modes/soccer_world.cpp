@@ -27,6 +27,8 @@
 #include "karts/kart_properties.hpp"
 #include "karts/rescue_animation.hpp"
 #include "karts/controller/player_controller.hpp"
+#include "network/network_manager.hpp"
+#include "network/network_world.hpp"
 #include "physics/physics.hpp"
 #include "states_screens/race_gui_base.hpp"
 #include "tracks/track.hpp"
@@ -101,24 +103,12 @@ void SoccerWorld::reset()
     m_can_score_points = true;
     memset(m_team_goals, 0, sizeof(m_team_goals));
 
-    // Reset original positions for the soccer balls
-    TrackObjectManager* tom = getTrack()->getTrackObjectManager();
-    assert(tom);
     m_redScorers.clear();
     m_redScoreTimes.clear();
     m_blueScorers.clear();
     m_blueScoreTimes.clear();
     m_lastKartToHitBall = -1;
-    PtrVector<TrackObject>& objects = tom->getObjects();
-    for(unsigned int i=0; i<objects.size(); i++)
-    {
-        TrackObject* obj = objects.get(i);
-        if(!obj->isSoccerBall())
-            continue;
-
-        obj->reset();
-        obj->getPhysicalObject()->reset();
-    }
+    resetBalls();
 
     if (m_goal_sound != NULL &&
         m_goal_sound->getStatus() == SFXBase::SFX_PLAYING)
@@ -166,35 +156,84 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
     if (isRaceOver())
         return;
 
+    // In networked games only the server detects goals, the clients get
+    // them with the ball state (see BallUpdateProtocol)
+    if (NetworkWorld::getInstance()->isRunning() &&
+        !NetworkManager::getInstance()->isServer())
+        return;
+
     if (m_can_score_points)
+        countGoal(first_goal);
+
+    resetBalls();
+
+    //Resetting the ball triggers the goal check line one more time.
+    //This ensures that only one goal is counted, and the second is ignored.
+    m_can_score_points = !m_can_score_points;
+
+    //for(int i=0 ; i < getNumKarts() ; i++
+
+    /*if(World::getWorld()->getTrack()->isAutoRescueEnabled() &&
+        !getKartAnimation() && fabs(getRoll())>60*DEGREE_TO_RAD &&
+                              fabs(getSpeed())<3.0f                )
     {
-        m_team_goals[first_goal ? 0 : 1]++;
+        new RescueAnimation(this, true);
+    }*/
+
+    // TODO: rescue the karts
+}   // onCheckGoalTriggered
 
-        World *world = World::getWorld();
-        world->setPhase(WorldStatus::GOAL_PHASE);
-        m_goal_sound->play();
-        if(m_lastKartToHitBall != -1)
+//-----------------------------------------------------------------------------
+/** Called on a client of a networked game when the server reported a goal.
+ *  \param first_goal If the goal was scored in the first goal.
+ *  \param scorer The kart that hit the ball last according to the server,
+ *         or -1.
+ */
+void SoccerWorld::onServerGoal(bool first_goal, int scorer)
+{
+    if (isRaceOver())
+        return;
+    m_lastKartToHitBall = scorer;
+    countGoal(first_goal);
+    resetBalls();
+}   // onServerGoal
+
+//-----------------------------------------------------------------------------
+/** Counts a goal: increases the score and stores the scorer.
+ *  \param first_goal If the goal was scored in the first goal.
+ */
+void SoccerWorld::countGoal(bool first_goal)
+{
+    m_team_goals[first_goal ? 0 : 1]++;
+
+    World *world = World::getWorld();
+    world->setPhase(WorldStatus::GOAL_PHASE);
+    m_goal_sound->play();
+    if(m_lastKartToHitBall != -1)
+    {
+        if(first_goal)
         {
-            if(first_goal)
-            {
-                m_redScorers.push_back(m_lastKartToHitBall);
-                if(race_manager->hasTimeTarget())
-                    m_redScoreTimes.push_back(race_manager->getTimeTarget() - world->getTime());
-                else
-                    m_redScoreTimes.push_back(world->getTime());
-            }
+            m_redScorers.push_back(m_lastKartToHitBall);
+            if(race_manager->hasTimeTarget())
+                m_redScoreTimes.push_back(race_manager->getTimeTarget() - world->getTime());
             else
-            {
-                m_blueScorers.push_back(m_lastKartToHitBall);
-                if(race_manager->hasTimeTarget())
-                    m_blueScoreTimes.push_back(race_manager->getTimeTarget() - world->getTime());
-                else
-                    m_blueScoreTimes.push_back(world->getTime());
-            }
+                m_redScoreTimes.push_back(world->getTime());
+        }
+        else
+        {
+            m_blueScorers.push_back(m_lastKartToHitBall);
+            if(race_manager->hasTimeTarget())
+                m_blueScoreTimes.push_back(race_manager->getTimeTarget() - world->getTime());
+            else
+                m_blueScoreTimes.push_back(world->getTime());
         }
     }
+}   // countGoal
 
-    // Reset original positions for the soccer balls
+//-----------------------------------------------------------------------------
+/** Resets the soccer balls to their original positions. */
+void SoccerWorld::resetBalls()
+{
     TrackObjectManager* tom = getTrack()->getTrackObjectManager();
     assert(tom);
 
@@ -208,22 +247,7 @@ void SoccerWorld::onCheckGoalTriggered(bool first_goal)
         obj->reset();
         obj->getPhysicalObject()->reset();
     }
-
-    //Resetting the ball triggers the goal check line one more time.
-    //This ensures that only one goal is counted, and the second is ignored.
-    m_can_score_points = !m_can_score_points;
-
-    //for(int i=0 ; i < getNumKarts() ; i++
-
-    /*if(World::getWorld()->getTrack()->isAutoRescueEnabled() &&
-        !getKartAnimation() && fabs(getRoll())>60*DEGREE_TO_RAD &&
-                              fabs(getSpeed())<3.0f                )
-    {
-        new RescueAnimation(this, true);
-    }*/
-
-    // TODO: rescue the karts
-}   // onCheckGoalTriggered
+}   // resetBalls
 
 //-----------------------------------------------------------------------------
 /** Sets the last kart that hit the ball, to be able to
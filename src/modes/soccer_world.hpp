@@ -57,6 +57,9 @@ private:
     std::vector<float> m_redScoreTimes;
     std::vector<int> m_blueScorers;
     std::vector<float> m_blueScoreTimes;
+
+    void countGoal(bool first_goal);
+    void resetBalls();
 public:
 
     SoccerWorld();
@@ -84,8 +87,11 @@ public:
     virtual void update(float dt);
 
     void onCheckGoalTriggered(bool first_goal);
+    void onServerGoal(bool first_goal, int scorer);
     int getTeamLeader(unsigned int i);
     void setLastKartTohitBall(unsigned int kartId);
+    /** Returns the last kart that hit the ball, or -1. */
+    int getLastKartToHitBall() const { return m_lastKartToHitBall; }
     std::vector<int> getScorers(unsigned int team)
     {
         if(team == 0)
@@ -27,6 +27,7 @@
 #include "config/user_config.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/video_capture.hpp"
 #include "io/file_manager.hpp"
 #include "input/device_manager.hpp"
 #include "input/keyboard_device.hpp"
@@ -35,7 +36,9 @@
 #include "karts/controller/end_controller.hpp"
 #include "karts/controller/skidding_ai.hpp"
 #include "karts/controller/network_player_controller.hpp"
+#include "karts/controller/network_ai_controller.hpp"
 #include "karts/kart.hpp"
+#include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/overworld.hpp"
 #include "modes/profile_world.hpp"
@@ -45,6 +48,7 @@
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
+#include "race/telemetry.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
 #include "scriptengine/script_engine.hpp"
@@ -57,6 +61,7 @@
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/job_system.hpp"
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
@@ -141,6 +146,8 @@ void World::init()
     m_faster_music_active = false;
     m_fastest_kart        = 0;
     m_eliminated_karts    = 0;
+    m_max_kart_length     = 0.0f;
+    m_max_explosion_radius = 0.0f;
     m_eliminated_players  = 0;
     m_num_players         = 0;
 
@@ -162,6 +169,9 @@ void World::init()
             << "' not found.\n";
         throw std::runtime_error(msg.str());
     }
+    // The track might have been created from the track index, which only
+    // contains the data for the menus.
+    m_track->ensureInfoLoaded();
 
     // Create the physics
     m_physics = new Physics();
@@ -172,6 +182,8 @@ void World::init()
     // Load the track models - this must be done before the karts so that the
     // karts can be positioned properly on (and not in) the tracks.
     m_track->loadTrackModel(race_manager->getReverseTrack());
+    // Compile the scripts now, so that it does not cause a hitch in the race
+    m_script_engine->compileTrackScripts();
 
     for(unsigned int i=0; i<num_karts; i++)
     {
@@ -187,10 +199,19 @@ void World::init()
                                    race_manager->getKartType(i),
                                    player_difficulty);
         m_karts.push_back(newkart);
+        m_max_kart_length = std::max(m_max_kart_length,
+                                     newkart->getKartLength());
+        m_max_explosion_radius = std::max(m_max_explosion_radius,
+                   newkart->getKartProperties()->getExplosionRadius());
         m_track->adjustForFog(newkart->getNode());
 
     }  // for i
 
+    m_kart_xyz.resize(num_karts);
+    m_kart_velocity.resize(num_karts);
+    m_kart_heading.resize(num_karts);
+    m_kart_speed.resize(num_karts);
+
     // Now that all models are loaded, apply the overrides
     irr_driver->applyObjectPassShader();
 
@@ -268,6 +289,8 @@ void World::reset()
     // Make sure to overwrite the data from the previous race.
     if(!history->replayHistory()) history->initRecording();
     if(ReplayRecorder::get()) ReplayRecorder::get()->init();
+    if(Telemetry::get()) Telemetry::get()->startRace();
+    if(VideoCapture::get()) VideoCapture::get()->startRace();
 
     // Reset all data structures that depend on number of karts.
     irr_driver->reset();
@@ -307,9 +330,14 @@ AbstractKart *World::createKart(const std::string &kart_ident, int index,
     switch(kart_type)
     {
     case RaceManager::KT_PLAYER:
-        controller = new PlayerController(new_kart,
+        if (UserConfigParams::m_bot_client)
+            controller = new NetworkAIController(new_kart,
+                         loadAIController(new_kart),
+                         StateManager::get()->getActivePlayer(local_player_id));
+        else
+            controller = new PlayerController(new_kart,
                          StateManager::get()->getActivePlayer(local_player_id),
-                                          local_player_id);
+                                              local_player_id);
         m_num_players ++;
         break;
     case RaceManager::KT_NETWORK_PLAYER:
@@ -360,6 +388,9 @@ World::~World()
 {
     irr_driver->onUnloadWorld();
 
+    if(Telemetry::get()) Telemetry::get()->endRace();
+    if(VideoCapture::get()) VideoCapture::get()->endRace();
+
     if(ReplayPlay::get())
     {
         // Destroy the old replay object, which also stored the ghost
@@ -555,6 +586,7 @@ void World::terminateRace()
     }
 
     results->push();
+    race_manager->preloadNextTrack();
     WorldStatus::terminateRace();
 }   // terminateRace
 
@@ -696,6 +728,8 @@ void World::resetAllKarts()
     {
         (*i)->kartIsInRestNow();
     }
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+        updateKartState(i);
 
     // Initialise the cameras, now that the correct kart positions are set
     for(unsigned int i=0; i<Camera::getNumCameras(); i++)
@@ -704,6 +738,21 @@ void World::resetAllKarts()
     }
 }   // resetAllKarts
 
+// ----------------------------------------------------------------------------
+/** Copies the often used state of a kart into the kart state arrays. This
+ *  must be called whenever the position of a kart was updated from the
+ *  physics.
+ *  \param kart_id World id of the kart.
+ */
+void World::updateKartState(int kart_id)
+{
+    const AbstractKart *kart = m_karts[kart_id];
+    m_kart_xyz[kart_id]      = kart->getXYZ();
+    m_kart_velocity[kart_id] = kart->getVelocity();
+    m_kart_heading[kart_id]  = kart->getHeading();
+    m_kart_speed[kart_id]    = kart->getSpeed();
+}   // updateKartState
+
 // ----------------------------------------------------------------------------
 /** Places a kart that is rescued. It calls getRescuePositionIndex to find
  *  to which rescue position the kart should be moved, then getRescueTransform
@@ -808,6 +857,9 @@ void World::updateWorld(float dt)
         getPhase() == IN_GAME_MENU_PHASE      )
         return;
 
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+        m_karts[i]->storePreviousTrans();
+
     try
     {
         update(dt);
@@ -889,6 +941,27 @@ void World::updateWorld(float dt)
     }
 }   // updateWorld
 
+// ----------------------------------------------------------------------------
+/** Positions the karts and cameras in between the last two world updates.
+ *  The world is updated with a fixed time step and not once per frame, see
+ *  MainLoop::updateRace.
+ *  \param alpha Time since the last update as fraction of a time step.
+ */
+void World::interpolateGraphics(float alpha)
+{
+    // Nothing moves while the world is not updated
+    if (getPhase() == FINISH_PHASE || getPhase() == IN_GAME_MENU_PHASE)
+        alpha = 1.0f;
+
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (!m_karts[i]->isEliminated())
+            m_karts[i]->interpolateGraphics(alpha);
+    }
+    for (unsigned int i = 0; i < Camera::getNumCameras(); i++)
+        Camera::getCamera(i)->interpolate(alpha);
+}   // interpolateGraphics
+
 #define MEASURE_FPS 0
 
 //-----------------------------------------------------------------------------
@@ -925,6 +998,7 @@ void World::update(float dt)
     PROFILER_PUSH_CPU_MARKER("World::update (sub-updates)", 0x20, 0x7F, 0x00);
     history->update(dt);
     if(ReplayRecorder::get()) ReplayRecorder::get()->update(dt);
+    if(Telemetry::get()) Telemetry::get()->update(dt);
     if(ReplayPlay::get()) ReplayPlay::get()->update(dt);
     if(history->replayHistory()) dt=history->getNextDelta();
     WorldStatus::update(dt);
@@ -937,10 +1011,38 @@ void World::update(float dt)
 
     PROFILER_PUSH_CPU_MARKER("World::update (AI)", 0x40, 0x7F, 0x00);
     const int kart_amount = (int)m_karts.size();
+    const int ai_threads = UserConfigParams::m_ai_threads;
+    if (ai_threads > 1 && !history->replayHistory())
+    {
+        // Let all controllers think in parallel, based on the positions of
+        // all karts after the physics update. The decisions are then
+        // applied when the karts are updated one after another.
+        for (int i = 0; i < kart_amount; ++i)
+        {
+            if (!m_karts[i]->isEliminated())
+            {
+                m_karts[i]->updatePosition();
+                updateKartState(i);
+            }
+        }
+        JobSystem::get()->parallelFor(0, kart_amount, 1,
+            [this, dt](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    if (!m_karts[i]->isEliminated())
+                        m_karts[i]->getController()->think(dt);
+                }
+            }, ai_threads);
+    }
     for (int i = 0 ; i < kart_amount; ++i)
     {
         // Update all karts that are not eliminated
-        if(!m_karts[i]->isEliminated()) m_karts[i]->update(dt) ;
+        if(!m_karts[i]->isEliminated())
+        {
+            m_karts[i]->update(dt);
+            updateKartState(i);
+        }
     }
     PROFILER_POP_CPU_MARKER();
 
@@ -1090,7 +1192,7 @@ void World::updateHighscores(int* best_highscore_rank, int* best_finish_time,
                 *highscore_who = k->getIdent();
             }
 
-            highscore_manager->saveHighscores();
+            highscore_manager->saveHighscores(highscores);
         }
     } // next position
     delete []index;
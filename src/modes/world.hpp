@@ -33,7 +33,9 @@
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/aligned_array.hpp"
 #include "utils/random_generator.hpp"
+#include "utils/vec3.hpp"
 
 #include "LinearMath/btTransform.h"
 
@@ -99,6 +101,20 @@ protected:
     Physics*      m_physics;
     bool          m_force_disable_fog;
     AbstractKart* m_fastest_kart;
+    /** Length of the longest kart in the race. */
+    float         m_max_kart_length;
+    /** Largest explosion radius of all karts in the race. */
+    float         m_max_explosion_radius;
+
+    /** A copy of the state of all karts that is read very often (e.g. by
+     *  each AI for each other kart in each frame), stored in contiguous
+     *  arrays indexed by the world kart id, so that loops over all karts
+     *  do not need to access the (big) kart objects. It is refreshed for
+     *  each kart when its position has been updated from the physics. */
+    AlignedArray<Vec3> m_kart_xyz;
+    AlignedArray<Vec3> m_kart_velocity;
+    std::vector<float> m_kart_heading;
+    std::vector<float> m_kart_speed;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
     /** Number of eliminated players. */
@@ -119,6 +135,7 @@ protected:
                              std::string* highscore_who,
                              StateManager::ActivePlayer** best_player);
     void  resetAllKarts     ();
+    void  updateKartState   (int kart_id);
     void  eliminateKart     (int kart_number, bool notifyOfElimination=true);
     Controller*
           loadAIController  (AbstractKart *kart);
@@ -290,6 +307,7 @@ public:
     void            scheduleExitRace() { m_schedule_exit_race = true; }
     void            scheduleTutorial();
     void            updateWorld(float dt);
+    void            interpolateGraphics(float alpha);
     void            handleExplosion(const Vec3 &xyz, AbstractKart *kart_hit,
                                     PhysicalObject *object);
     AbstractKart*   getPlayerKart(unsigned int player) const;
@@ -309,6 +327,32 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the position of a kart, from the copy of the kart states. */
+    const Vec3     &getKartXYZ(int kart_id) const
+                                           { return m_kart_xyz[kart_id];     }
+    // ------------------------------------------------------------------------
+    /** Returns the velocity of a kart, from the copy of the kart states. */
+    const Vec3     &getKartVelocity(int kart_id) const
+                                           { return m_kart_velocity[kart_id];}
+    // ------------------------------------------------------------------------
+    /** Returns the heading of a kart, from the copy of the kart states. */
+    float           getKartHeading(int kart_id) const
+                                           { return m_kart_heading[kart_id]; }
+    // ------------------------------------------------------------------------
+    /** Returns the speed of a kart, from the copy of the kart states. */
+    float           getKartSpeed(int kart_id) const
+                                           { return m_kart_speed[kart_id];   }
+    // ------------------------------------------------------------------------
+    /** Returns the length of the longest kart in the race. */
+    float           getMaxKartLength() const { return m_max_kart_length; }
+    // ------------------------------------------------------------------------
+    /** Returns the largest explosion radius of all karts, i.e. an explosion
+     *  further away than this can not affect any kart. */
+    float           getMaxExplosionRadius() const
+    {
+        return m_max_explosion_radius;
+    }   // getMaxExplosionRadius
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
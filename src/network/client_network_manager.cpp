@@ -135,7 +135,7 @@ void ClientNetworkManager::run()
         return;
     }
     m_localhost = new STKHost();
-    m_localhost->setupClient(1, 2, 0, 0);
+    m_localhost->setupClient(1, STKHost::CHANNEL_COUNT, 0, 0);
     m_localhost->startListening();
 
     Log::info("ClientNetworkManager", "Host initialized.");
@@ -171,7 +171,7 @@ void ClientNetworkManager::reset()
 
     m_connected = false;
     m_localhost = new STKHost();
-    m_localhost->setupClient(1, 2, 0, 0);
+    m_localhost->setupClient(1, STKHost::CHANNEL_COUNT, 0, 0);
     m_localhost->startListening();
 
 }
@@ -183,6 +183,16 @@ void ClientNetworkManager::sendPacket(const NetworkString& data, bool reliable)
     m_peers[0]->sendPacket(data, reliable);
 }
 
+void ClientNetworkManager::sendPacket(ENetPacket* packet, uint8_t channel)
+{
+    if (m_peers.size() > 1)
+        Log::warn("ClientNetworkManager", "Ambiguous send of data.\n");
+    STKHost::lockENet();
+    m_peers[0]->sendPacket(packet, channel);
+    STKHost::releasePacket(packet);
+    STKHost::unlockENet();
+}
+
 STKPeer* ClientNetworkManager::getPeer()
 {
     return m_peers[0];
@@ -52,6 +52,12 @@ class ClientNetworkManager : public NetworkManager
          *  \param reliable : If set to true, ENet will ensure that the packet is received.
          */
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
+        /*! \brief Sends a packet created with STKHost::createPacket to the
+         *  server.
+         *  \param packet : The packet to send.
+         *  \param channel : The channel to send the packet on.
+         */
+        virtual void sendPacket(ENetPacket* packet, uint8_t channel);
         
         /*! \brief Get the peer (the server)
          *  \return The peer with whom we're connected (if it exists). NULL elseway.
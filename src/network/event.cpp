@@ -21,10 +21,17 @@
 
 #include "utils/log.hpp"
 
+#include <assert.h>
 #include <string.h>
 
+pthread_mutex_t Event::m_packet_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 Event::Event(ENetEvent* event)
 {
+    m_packet = NULL;
+    m_offset = 0;
+    m_size   = 0;
+    peer     = NULL;
     switch (event->type)
     {
     case ENET_EVENT_TYPE_CONNECT:
@@ -40,18 +47,17 @@ Event::Event(ENetEvent* event)
         return;
         break;
     }
-    if (type == EVENT_TYPE_MESSAGE)
+    if (type == EVENT_TYPE_MESSAGE && event->packet)
     {
-        m_data = NetworkString(std::string((char*)(event->packet->data), event->packet->dataLength-1));
-    }
-
-    m_packet = NULL;
-    if (event->packet)
+        // Keep the packet instead of copying its data, the last byte is
+        // the terminating 0 appended by the sender.
         m_packet = event->packet;
-
-    if (m_packet)
-        enet_packet_destroy(m_packet); // we got all we need, just remove the data.
-    m_packet = NULL;
+        m_packet->referenceCount = 1;
+        m_size = m_packet->dataLength > 0 ? (int)m_packet->dataLength - 1
+                                          : 0;
+    }
+    else if (event->packet)
+        enet_packet_destroy(event->packet);
 
     std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
     peer = new STKPeer*;
@@ -76,10 +82,18 @@ Event::Event(ENetEvent* event)
 
 Event::Event(const Event& event)
 {
-    m_packet = NULL;
-    m_data = event.m_data;
+    m_packet = event.m_packet;
+    m_offset = event.m_offset;
+    m_size   = event.m_size;
+    if (m_packet)
+        retainPacket(m_packet);
     // copy the peer
-    peer = event.peer;
+    peer = NULL;
+    if (event.peer)
+    {
+        peer = new STKPeer*;
+        *peer = *event.peer;
+    }
     type = event.type;
 }
 
@@ -87,11 +101,37 @@ Event::~Event()
 {
     delete peer;
     peer = NULL;
+    if (m_packet)
+        releasePacket(m_packet);
     m_packet = NULL;
 }
 
-void Event::removeFront(int size)
+void Event::retainPacket(ENetPacket* packet)
+{
+    pthread_mutex_lock(&m_packet_mutex);
+    packet->referenceCount++;
+    pthread_mutex_unlock(&m_packet_mutex);
+}
+
+void Event::releasePacket(ENetPacket* packet)
 {
-    m_data.removeFront(size);
+    pthread_mutex_lock(&m_packet_mutex);
+    bool last = --packet->referenceCount == 0;
+    pthread_mutex_unlock(&m_packet_mutex);
+    if (last)
+        enet_packet_destroy(packet);
 }
 
+NetworkString Event::data() const
+{
+    if (!m_packet)
+        return NetworkString();
+    return NetworkString(getPayload(), m_size);
+}
+
+void Event::removeFront(int size)
+{
+    assert(size <= m_size);
+    m_offset += size;
+    m_size   -= size;
+}
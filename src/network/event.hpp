@@ -28,6 +28,8 @@
 #include "network/network_string.hpp"
 #include "utils/types.hpp"
 
+#include <pthread.h>
+
 /*!
  * \enum EVENT_TYPE
  * \brief Represents a network event type.
@@ -66,6 +68,8 @@ class Event
         ~Event();
 
         /*! \brief Remove bytes at the beginning of data.
+         *  This does not modify the packet, it only moves the start of the
+         *  payload, so it is cheap and does not affect copies of the event.
          *  \param size : The number of bytes to remove.
          */
         void removeFront(int size);
@@ -74,14 +78,34 @@ class Event
          *  \return A copy of the message data. This is empty for events like
          *  connection or disconnections.
          */
-        NetworkString data() const { return m_data; }
+        NetworkString data() const;
+
+        /*! \brief Get a pointer to the message data without copying it.
+         *  The data is owned by the ENet packet, which stays valid as long
+         *  as this event or any copy of it exists.
+         */
+        const uint8_t* getPayload() const
+        {
+            return m_packet ? m_packet->data + m_offset : NULL;
+        }
+        /*! \brief Get the size of the data returned by getPayload(). */
+        int getPayloadSize() const { return m_size; }
 
         EVENT_TYPE type;    //!< Type of the event.
         STKPeer** peer;     //!< Pointer to the peer that triggered that event.
 
     private:
-        NetworkString m_data; //!< Copy of the data passed by the event.
-        ENetPacket* m_packet; //!< A pointer on the ENetPacket to be deleted.
+        static void retainPacket(ENetPacket* packet);
+        static void releasePacket(ENetPacket* packet);
+
+        /*! The ENetPacket which is shared by all copies of this event.
+         *  Its referenceCount counts the events using it, the packet is
+         *  destroyed when the last event is deleted. */
+        ENetPacket* m_packet;
+        int m_offset;         //!< Start of the payload in the packet.
+        int m_size;           //!< Size of the payload.
+        /*! Protects the reference count of the packets. */
+        static pthread_mutex_t m_packet_mutex;
 };
 
 #endif // EVENT_HPP
@@ -0,0 +1,72 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_interpolator.hpp"
+
+/** Adds a received state. States older than the newest one are ignored
+ *  (unreliable packets can arrive out of order).
+ *  \param time World time on the server of this state.
+ *  \param xyz Position of the kart.
+ *  \param rotation Rotation of the kart.
+ */
+void KartInterpolator::add(float time, const Vec3 &xyz,
+                           const btQuaternion &rotation)
+{
+    if (!m_samples.empty() && m_samples.back().m_time >= time)
+        return;
+    Sample s;
+    s.m_time     = time;
+    s.m_xyz      = xyz;
+    s.m_rotation = rotation;
+    m_samples.push_back(s);
+    // Avoid unbounded growth if getState is not called
+    if (m_samples.size() > 64)
+        m_samples.pop_front();
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Computes the state at a given time. Samples that are not needed anymore
+ *  are discarded. If the time is after the newest sample, the newest
+ *  sample is used (no extrapolation).
+ *  \param time The time to compute the state for.
+ *  \param xyz On return the interpolated position.
+ *  \param rotation On return the interpolated rotation.
+ *  \return False if no sample is available.
+ */
+bool KartInterpolator::getState(float time, Vec3 *xyz, btQuaternion *rotation)
+{
+    if (m_samples.empty())
+        return false;
+
+    // Keep the last sample before 'time' as start of the interpolation
+    while (m_samples.size() > 1 && m_samples[1].m_time <= time)
+        m_samples.pop_front();
+
+    const Sample &a = m_samples.front();
+    if (m_samples.size() == 1 || time <= a.m_time)
+    {
+        *xyz      = a.m_xyz;
+        *rotation = a.m_rotation;
+        return true;
+    }
+    const Sample &b = m_samples[1];
+    float f   = (time - a.m_time) / (b.m_time - a.m_time);
+    *xyz      = a.m_xyz + (b.m_xyz - a.m_xyz)*f;
+    *rotation = a.m_rotation.slerp(b.m_rotation, f);
+    return true;
+}   // getState
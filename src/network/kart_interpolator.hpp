@@ -0,0 +1,62 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_interpolator.hpp
+ *  \brief Smooth display of remote karts from buffered snapshots.
+ */
+
+#ifndef KART_INTERPOLATOR_HPP
+#define KART_INTERPOLATOR_HPP
+
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <deque>
+
+/** \class KartInterpolator
+ *  \brief Buffers the states received for a remote kart and interpolates
+ *  between them.
+ *  Remote karts are displayed slightly in the past (the interpolation
+ *  delay), so that there are usually two received states around the
+ *  displayed time which can be interpolated, instead of teleporting the
+ *  kart each time a new state arrives.
+ *  \ingroup network
+ */
+class KartInterpolator
+{
+private:
+    struct Sample
+    {
+        float        m_time;
+        Vec3         m_xyz;
+        btQuaternion m_rotation;
+    };   // Sample
+
+    /** The received states, sorted by time. */
+    std::deque<Sample> m_samples;
+
+public:
+    void add(float time, const Vec3 &xyz, const btQuaternion &rotation);
+    bool getState(float time, Vec3 *xyz, btQuaternion *rotation);
+    // ------------------------------------------------------------------------
+    /** Removes all samples. */
+    void reset() { m_samples.clear(); }
+};   // KartInterpolator
+
+#endif // KART_INTERPOLATOR_HPP
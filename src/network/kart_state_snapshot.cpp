@@ -0,0 +1,332 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_state_snapshot.hpp"
+
+#include "network/network_string.hpp"
+#include "utils/log.hpp"
+
+#include <assert.h>
+#include <math.h>
+
+namespace
+{
+    /** Largest absolute value any of the three smallest components of a
+     *  normalised quaternion can have, i.e. 1/sqrt(2). */
+    const float ROTATION_RANGE = 0.707107f;
+    const int   ROTATION_BITS  = 10;
+    const int   ROTATION_MAX   = (1 << ROTATION_BITS) - 1;
+}
+
+// ----------------------------------------------------------------------------
+KartStateSnapshot::KartStateSnapshot(uint16_t id, unsigned int num_karts)
+{
+    m_id = id;
+    QuantizedKartState zero;
+    zero.m_xyz[0] = zero.m_xyz[1] = zero.m_xyz[2] = 0;
+    zero.m_rotation = 0;
+    m_states.resize(num_karts, zero);
+}   // KartStateSnapshot
+
+// ----------------------------------------------------------------------------
+/** Quantises a position to 16 bit per axis relative to the given bounding
+ *  box. Positions outside of the box are clamped.
+ *  \param xyz The position to quantise.
+ *  \param min, max The bounding box (usually of the track).
+ *  \param out Array of 3 values to store the result in.
+ */
+void KartStateSnapshot::quantizePosition(const Vec3 &xyz, const Vec3 &min,
+                                         const Vec3 &max, uint16_t *out)
+{
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        float extent = max[i] - min[i];
+        float f = extent > 0 ? (xyz[i] - min[i]) / extent : 0.0f;
+        if (f < 0.0f) f = 0.0f;
+        if (f > 1.0f) f = 1.0f;
+        out[i] = (uint16_t)(f*65535.0f + 0.5f);
+    }
+}   // quantizePosition
+
+// ----------------------------------------------------------------------------
+/** Converts a quantised position back into world coordinates.
+ *  \param in The three quantised values.
+ *  \param min, max The bounding box used when quantising.
+ */
+Vec3 KartStateSnapshot::dequantizePosition(const uint16_t *in, const Vec3 &min,
+                                           const Vec3 &max)
+{
+    Vec3 xyz;
+    for (unsigned int i = 0; i < 3; i++)
+        xyz[i] = min[i] + (max[i] - min[i]) * (in[i] / 65535.0f);
+    return xyz;
+}   // dequantizePosition
+
+// ----------------------------------------------------------------------------
+/** Compresses a rotation into 32 bits using 'smallest three' compression.
+ *  Since q and -q describe the same rotation, the quaternion is negated
+ *  if necessary so that the dropped largest component is positive, which
+ *  means it can be reconstructed from the other three.
+ *  \param q The rotation to compress.
+ */
+uint32_t KartStateSnapshot::compressRotation(const btQuaternion &q)
+{
+    btQuaternion n = q;
+    if (n.length2() > 0)
+        n.normalize();
+    float c[4] = { n.x(), n.y(), n.z(), n.w() };
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    }
+    float sign = c[largest] < 0 ? -1.0f : 1.0f;
+
+    uint32_t result = largest << (3*ROTATION_BITS);
+    int shift = 2*ROTATION_BITS;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        float f = (sign*c[i] / ROTATION_RANGE)*0.5f + 0.5f;
+        if (f < 0.0f) f = 0.0f;
+        if (f > 1.0f) f = 1.0f;
+        result |= ((uint32_t)(f*ROTATION_MAX + 0.5f)) << shift;
+        shift -= ROTATION_BITS;
+    }
+    return result;
+}   // compressRotation
+
+// ----------------------------------------------------------------------------
+/** Decompresses a rotation compressed with compressRotation().
+ *  \param data The compressed rotation.
+ */
+btQuaternion KartStateSnapshot::decompressRotation(uint32_t data)
+{
+    unsigned int largest = data >> (3*ROTATION_BITS);
+    float c[4];
+    float sum = 0;
+    int shift = 2*ROTATION_BITS;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        int v = (data >> shift) & ROTATION_MAX;
+        c[i] = ((float)v / ROTATION_MAX * 2.0f - 1.0f) * ROTATION_RANGE;
+        sum += c[i]*c[i];
+        shift -= ROTATION_BITS;
+    }
+    c[largest] = sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f;
+    btQuaternion q(c[0], c[1], c[2], c[3]);
+    q.normalize();
+    return q;
+}   // decompressRotation
+
+// ----------------------------------------------------------------------------
+/** Encodes this snapshot, optionally as delta against a baseline snapshot.
+ *  \param baseline The snapshot the receiver is known to have, or NULL if
+ *         a full snapshot must be sent.
+ *  \param ns The network string to append the data to.
+ */
+void KartStateSnapshot::encode(const KartStateSnapshot *baseline,
+                               NetworkString *ns) const
+{
+    if (baseline && baseline->getNumberOfKarts() != getNumberOfKarts())
+        baseline = NULL;
+
+    NetworkString entries;
+    uint8_t count = 0;
+    for (unsigned int i = 0; i < m_states.size(); i++)
+    {
+        const QuantizedKartState &s = m_states[i];
+        if (baseline && baseline->getState(i) == s)
+            continue;
+
+        uint8_t mask = 0;
+        NetworkString fields;
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            if (!baseline)
+            {
+                mask |= FIELD_FULL << (2*j);
+                fields.addUInt16(s.m_xyz[j]);
+                continue;
+            }
+            int delta = (int)s.m_xyz[j] - (int)baseline->getState(i).m_xyz[j];
+            if (delta == 0)
+                continue;
+            if (delta >= -128 && delta <= 127)
+            {
+                mask |= FIELD_DELTA8 << (2*j);
+                fields.addUInt8((uint8_t)(int8_t)delta);
+            }
+            else
+            {
+                mask |= FIELD_FULL << (2*j);
+                fields.addUInt16(s.m_xyz[j]);
+            }
+        }
+        if (!baseline || baseline->getState(i).m_rotation != s.m_rotation)
+        {
+            mask |= ROTATION_BIT;
+            fields.addUInt32(s.m_rotation);
+        }
+        entries.addUInt8(i).addUInt8(mask);
+        entries += fields;
+        count++;
+    }
+
+    ns->addUInt16(m_id)
+       .addUInt16(baseline ? baseline->getId() : NO_BASELINE)
+       .addUInt8(count);
+    (*ns) += entries;
+}   // encode
+
+// ----------------------------------------------------------------------------
+uint16_t KartStateSnapshot::peekId(const NetworkString &ns, int pos)
+{
+    return ns.getUInt16(pos);
+}   // peekId
+
+// ----------------------------------------------------------------------------
+uint16_t KartStateSnapshot::peekBaselineId(const NetworkString &ns, int pos)
+{
+    return ns.getUInt16(pos+2);
+}   // peekBaselineId
+
+// ----------------------------------------------------------------------------
+/** Decodes a snapshot. Karts not contained in the message are copied from
+ *  the baseline.
+ *  \param ns The network string containing the snapshot.
+ *  \param pos Position of the snapshot in ns.
+ *  \param baseline The snapshot this one was encoded against (must have
+ *         the id stored in the message), or NULL for a full snapshot.
+ *  \param bytes_read Returns the number of bytes used.
+ *  \param changed_karts If not NULL, the ids of all karts contained in the
+ *         message are appended.
+ *  \return False if the data is malformed or the baseline does not match.
+ */
+bool KartStateSnapshot::decode(const NetworkString &ns, int pos,
+                               const KartStateSnapshot *baseline,
+                               int *bytes_read,
+                               std::vector<unsigned int> *changed_karts)
+{
+    int start = pos;
+    if (ns.size() < pos + 5)
+        return false;
+    m_id = ns.getUInt16(pos);
+    uint16_t baseline_id = ns.getUInt16(pos+2);
+    unsigned int count = ns.getUInt8(pos+4);
+    pos += 5;
+
+    if (baseline_id != NO_BASELINE)
+    {
+        if (!baseline || baseline->getId() != baseline_id ||
+            baseline->getNumberOfKarts() != getNumberOfKarts())
+        {
+            Log::warn("KartStateSnapshot",
+                      "Missing baseline %d for snapshot %d.",
+                      baseline_id, m_id);
+            return false;
+        }
+        m_states = baseline->m_states;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (ns.size() < pos + 2)
+            return false;
+        unsigned int kart_id = ns.getUInt8(pos);
+        uint8_t mask = ns.getUInt8(pos+1);
+        pos += 2;
+        if (kart_id >= m_states.size())
+            return false;
+        QuantizedKartState &s = m_states[kart_id];
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            switch ((mask >> (2*j)) & 3)
+            {
+            case FIELD_SAME:
+                break;
+            case FIELD_DELTA8:
+                if (ns.size() < pos + 1) return false;
+                s.m_xyz[j] = (uint16_t)(s.m_xyz[j]
+                                        + (int8_t)ns.getUInt8(pos));
+                pos += 1;
+                break;
+            case FIELD_FULL:
+                if (ns.size() < pos + 2) return false;
+                s.m_xyz[j] = ns.getUInt16(pos);
+                pos += 2;
+                break;
+            default:
+                return false;
+            }
+        }
+        if (mask & ROTATION_BIT)
+        {
+            if (ns.size() < pos + 4) return false;
+            s.m_rotation = ns.getUInt32(pos);
+            pos += 4;
+        }
+        if (changed_karts)
+            changed_karts->push_back(kart_id);
+    }
+    *bytes_read = pos - start;
+    return true;
+}   // decode
+
+// ----------------------------------------------------------------------------
+/** Very rudimentary unit testing of the compression functions. */
+void KartStateSnapshot::unitTesting()
+{
+    Vec3 min(-100, -10, -200), max(100, 50, 0);
+    uint16_t q[3];
+    quantizePosition(Vec3(12.3f, 4.5f, -67.8f), min, max, q);
+    Vec3 p = dequantizePosition(q, min, max);
+    assert((p - Vec3(12.3f, 4.5f, -67.8f)).length() < 0.01f);
+
+    btQuaternion rot(btVector3(0.3f, 1, -0.2f).normalize(), 2.1f);
+    btQuaternion r = decompressRotation(compressRotation(rot));
+    assert(fabsf(fabsf(r.dot(rot)) - 1.0f) < 0.001f);
+    r = decompressRotation(compressRotation(-rot));
+    assert(fabsf(fabsf(r.dot(rot)) - 1.0f) < 0.001f);
+
+    KartStateSnapshot a(1, 3), b(2, 3);
+    QuantizedKartState s;
+    s.m_xyz[0] = 100; s.m_xyz[1] = 200; s.m_xyz[2] = 3000;
+    s.m_rotation = compressRotation(rot);
+    a.setState(0, s); a.setState(1, s); a.setState(2, s);
+    b = a;
+    b.m_id = 2;
+    s.m_xyz[0] = 90; s.m_xyz[2] = 60000;
+    b.setState(1, s);
+
+    NetworkString full, delta;
+    a.encode(NULL, &full);
+    b.encode(&a, &delta);
+    assert(delta.size() < full.size());
+
+    KartStateSnapshot ra(0, 3), rb(0, 3);
+    int n;
+    assert(ra.decode(full, 0, NULL, &n) && n == full.size());
+    assert(rb.decode(delta, 0, &ra, &n) && n == delta.size());
+    assert(rb.getId() == 2);
+    for (unsigned int i = 0; i < 3; i++)
+        assert(rb.getState(i) == b.getState(i));
+    assert(!rb.decode(delta, 0, NULL, &n));
+}   // unitTesting
@@ -0,0 +1,137 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_state_snapshot.hpp
+ *  \brief Quantised, delta-compressed snapshots of all kart states.
+ */
+
+#ifndef KART_STATE_SNAPSHOT_HPP
+#define KART_STATE_SNAPSHOT_HPP
+
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+class NetworkString;
+
+/** \brief The quantised state of a single kart.
+ *  The position is stored as three 16 bit values relative to the bounding
+ *  box of the track, the rotation uses 'smallest three' compression: the
+ *  largest component of the (normalised) quaternion is dropped and its
+ *  index stored in the top 2 bits, the remaining three components are
+ *  stored with 10 bits each.
+ *  \ingroup network
+ */
+struct QuantizedKartState
+{
+    uint16_t m_xyz[3];
+    uint32_t m_rotation;
+
+    bool operator==(const QuantizedKartState &other) const
+    {
+        return m_xyz[0]   == other.m_xyz[0] && m_xyz[1] == other.m_xyz[1] &&
+               m_xyz[2]   == other.m_xyz[2] &&
+               m_rotation == other.m_rotation;
+    }   // operator==
+};   // QuantizedKartState
+
+// ============================================================================
+/** \brief A snapshot of the quantised states of all karts at one point in
+ *  time, which can be delta-encoded against an older snapshot.
+ *  The wire format of an encoded snapshot is:
+ *   - uint16 id of this snapshot
+ *   - uint16 id of the baseline snapshot (NO_BASELINE for a full snapshot)
+ *   - uint8  number N of kart entries that follow
+ *   - N times: uint8 kart index, uint8 field mask, followed by the fields
+ *     indicated in the mask.
+ *  Each coordinate uses two bits of the mask: FIELD_SAME (not sent),
+ *  FIELD_DELTA8 (signed 8 bit difference to the baseline) or FIELD_FULL
+ *  (16 bit value). Bit 6 indicates that the 32 bit rotation follows.
+ *  Karts which have not changed compared to the baseline are not sent at
+ *  all.
+ *  \ingroup network
+ */
+class KartStateSnapshot
+{
+public:
+    /** Id used to indicate that a snapshot is not delta-encoded. */
+    static const uint16_t NO_BASELINE = 0xffff;
+
+private:
+    enum { FIELD_SAME = 0, FIELD_DELTA8 = 1, FIELD_FULL = 2 };
+    enum { ROTATION_BIT = 0x40 };
+
+    /** Id of this snapshot. */
+    uint16_t m_id;
+
+    /** The quantised state of each kart, indexed by world kart id. */
+    std::vector<QuantizedKartState> m_states;
+
+public:
+             KartStateSnapshot(uint16_t id=NO_BASELINE,
+                               unsigned int num_karts=0);
+    void     encode(const KartStateSnapshot *baseline,
+                    NetworkString *ns) const;
+    bool     decode(const NetworkString &ns, int pos,
+                    const KartStateSnapshot *baseline,
+                    int *bytes_read,
+                    std::vector<unsigned int> *changed_karts = NULL);
+    static void     quantizePosition(const Vec3 &xyz, const Vec3 &min,
+                                     const Vec3 &max, uint16_t *out);
+    static Vec3     dequantizePosition(const uint16_t *in, const Vec3 &min,
+                                       const Vec3 &max);
+    static uint32_t compressRotation(const btQuaternion &q);
+    static btQuaternion decompressRotation(uint32_t data);
+    static void     unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Reads the id of an encoded snapshot without decoding it. */
+    static uint16_t peekId(const NetworkString &ns, int pos);
+    // ------------------------------------------------------------------------
+    /** Reads the baseline id of an encoded snapshot without decoding it. */
+    static uint16_t peekBaselineId(const NetworkString &ns, int pos);
+    // ------------------------------------------------------------------------
+    /** Returns the id of this snapshot. */
+    uint16_t getId() const { return m_id; }
+    // ------------------------------------------------------------------------
+    /** Sets the id of this snapshot. */
+    void setId(uint16_t id) { m_id = id; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts in this snapshot. */
+    unsigned int getNumberOfKarts() const
+    {
+        return (unsigned int)m_states.size();
+    }   // getNumberOfKarts
+    // ------------------------------------------------------------------------
+    /** Returns the quantised state of the specified kart. */
+    const QuantizedKartState &getState(unsigned int kart_id) const
+    {
+        return m_states[kart_id];
+    }   // getState
+    // ------------------------------------------------------------------------
+    /** Sets the quantised state of the specified kart. */
+    void setState(unsigned int kart_id, const QuantizedKartState &state)
+    {
+        m_states[kart_id] = state;
+    }   // setState
+};   // KartStateSnapshot
+
+#endif // KART_STATE_SNAPSHOT_HPP
@@ -0,0 +1,321 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/network_bit_stream.hpp"
+
+#include "network/network_string.hpp"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && \
+                        __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#    define STK_LITTLE_ENDIAN_HOST
+#endif
+
+namespace
+{
+    union FloatBits
+    {
+        float    f;
+        uint32_t i;
+    };
+}
+
+// ----------------------------------------------------------------------------
+NetworkBitWriter::NetworkBitWriter(NetworkString *ns)
+{
+    m_string       = ns;
+    m_scratch      = 0;
+    m_scratch_bits = 0;
+}   // NetworkBitWriter
+
+// ----------------------------------------------------------------------------
+NetworkBitWriter::~NetworkBitWriter()
+{
+    flush();
+}   // ~NetworkBitWriter
+
+// ----------------------------------------------------------------------------
+/** Writes the lowest n bits of value.
+ *  \param value The value to write.
+ *  \param n Number of bits, between 1 and 32.
+ */
+NetworkBitWriter& NetworkBitWriter::writeBits(uint32_t value, int n)
+{
+    assert(n > 0 && n <= 32);
+    uint64_t v = value;
+    if (n < 32)
+        v &= (((uint64_t)1) << n) - 1;
+    m_scratch |= v << m_scratch_bits;
+    m_scratch_bits += n;
+    while (m_scratch_bits >= 8)
+    {
+        m_string->addUInt8((uint8_t)(m_scratch & 0xff));
+        m_scratch >>= 8;
+        m_scratch_bits -= 8;
+    }
+    return *this;
+}   // writeBits
+
+// ----------------------------------------------------------------------------
+/** Writes an unsigned integer using groups of 7 bits, each followed by a
+ *  continuation bit. Values below 128 only need 8 bits.
+ */
+NetworkBitWriter& NetworkBitWriter::writeVarUInt(uint32_t value)
+{
+    do
+    {
+        uint32_t group = value & 0x7f;
+        value >>= 7;
+        writeBits(group | (value ? 0x80 : 0), 8);
+    } while (value);
+    return *this;
+}   // writeVarUInt
+
+// ----------------------------------------------------------------------------
+/** Writes a signed integer using zig-zag and variable length encoding. */
+NetworkBitWriter& NetworkBitWriter::writeVarInt(int32_t value)
+{
+    return writeVarUInt(zigZagEncode(value));
+}   // writeVarInt
+
+// ----------------------------------------------------------------------------
+/** Writes a full precision float. */
+NetworkBitWriter& NetworkBitWriter::writeFloat(float value)
+{
+    FloatBits fb;
+    fb.f = value;
+    return writeBits(fb.i, 32);
+}   // writeFloat
+
+// ----------------------------------------------------------------------------
+/** Writes a float as 16 bit half float (IEEE 754 binary16). */
+NetworkBitWriter& NetworkBitWriter::writeHalfFloat(float value)
+{
+    return writeBits(floatToHalf(value), 16);
+}   // writeHalfFloat
+
+// ----------------------------------------------------------------------------
+/** Appends all pending bits to the network string, padding with 0 bits to
+ *  the next byte boundary. */
+void NetworkBitWriter::flush()
+{
+    if (m_scratch_bits > 0)
+        writeBits(0, 8 - m_scratch_bits);
+}   // flush
+
+// ----------------------------------------------------------------------------
+/** Converts a float to a half float. Values too large are converted to
+ *  infinity, too small values to (signed) zero, precision is truncated.
+ */
+uint16_t NetworkBitWriter::floatToHalf(float value)
+{
+    FloatBits fb;
+    fb.f = value;
+    uint32_t sign     = (fb.i >> 16) & 0x8000;
+    int32_t  exponent = (int32_t)((fb.i >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = fb.i & 0x007fffff;
+
+    if (((fb.i >> 23) & 0xff) == 0xff)   // NaN or infinity
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)                  // overflow
+        return (uint16_t)(sign | 0x7c00);
+    if (exponent <= 0)                   // denormal or zero
+    {
+        if (exponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x00800000;
+        return (uint16_t)(sign | (mantissa >> (14 - exponent)));
+    }
+    return (uint16_t)(sign | (exponent << 10) | (mantissa >> 13));
+}   // floatToHalf
+
+// ----------------------------------------------------------------------------
+/** Converts a half float back to a float. */
+float NetworkBitWriter::halfToFloat(uint16_t value)
+{
+    uint32_t sign     = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x03ff;
+    FloatBits fb;
+    if (exponent == 0x1f)                // NaN or infinity
+        fb.i = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+            fb.i = sign;
+        else
+        {
+            // Denormal: value is mantissa * 2^-24
+            fb.f = mantissa / 16777216.0f;
+            fb.i |= sign;
+        }
+    }
+    else
+        fb.i = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    return fb.f;
+}   // halfToFloat
+
+// ============================================================================
+/** Creates a reader for the data in a network string.
+ *  \param ns The network string, which must not be modified while this
+ *         reader exists.
+ *  \param byte_pos Byte offset at which the bit-packed data starts.
+ */
+NetworkBitReader::NetworkBitReader(const NetworkString &ns, int byte_pos)
+{
+    m_size    = ns.size() - byte_pos;
+    m_data    = m_size > 0 ? ns.getBytes() + byte_pos : NULL;
+    m_bit_pos = 0;
+    m_error   = false;
+    if (m_size < 0)
+    {
+        m_size  = 0;
+        m_error = true;
+    }
+}   // NetworkBitReader
+
+// ----------------------------------------------------------------------------
+/** Creates a reader for raw data, e.g. the payload of an event.
+ *  \param data Pointer to the data, which must stay valid while this
+ *         reader is used.
+ *  \param size Size of the data in bytes.
+ */
+NetworkBitReader::NetworkBitReader(const uint8_t *data, int size)
+{
+    m_data    = data;
+    m_size    = size > 0 ? size : 0;
+    m_bit_pos = 0;
+    m_error   = size < 0;
+}   // NetworkBitReader
+
+// ----------------------------------------------------------------------------
+/** Reads n bits.
+ *  \param n Number of bits, between 1 and 32.
+ */
+uint32_t NetworkBitReader::readBits(int n)
+{
+    assert(n > 0 && n <= 32);
+    if (m_bit_pos + n > m_size*8)
+    {
+        m_error   = true;
+        m_bit_pos = m_size*8;
+        return 0;
+    }
+    int byte  = m_bit_pos >> 3;
+    int shift = m_bit_pos & 7;
+    uint64_t word = 0;
+#ifdef STK_LITTLE_ENDIAN_HOST
+    if (byte + 8 <= m_size)
+    {
+        // Fast path: load 8 contiguous bytes at once
+        memcpy(&word, m_data + byte, 8);
+    }
+    else
+#endif
+    {
+        int bytes_needed = (shift + n + 7) >> 3;
+        for (int i = 0; i < bytes_needed; i++)
+            word |= ((uint64_t)m_data[byte + i]) << (8*i);
+    }
+    m_bit_pos += n;
+    word >>= shift;
+    if (n < 32)
+        word &= (((uint64_t)1) << n) - 1;
+    return (uint32_t)word;
+}   // readBits
+
+// ----------------------------------------------------------------------------
+/** Reads an unsigned integer written with writeVarUInt. */
+uint32_t NetworkBitReader::readVarUInt()
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint32_t group = readBits(8);
+        value |= (group & 0x7f) << shift;
+        if (!(group & 0x80) || m_error)
+            return value;
+    }
+    // More than 5 groups can not have been written by writeVarUInt
+    m_error = true;
+    return value;
+}   // readVarUInt
+
+// ----------------------------------------------------------------------------
+float NetworkBitReader::readFloat()
+{
+    FloatBits fb;
+    fb.i = readBits(32);
+    return fb.f;
+}   // readFloat
+
+// ----------------------------------------------------------------------------
+float NetworkBitReader::readHalfFloat()
+{
+    return NetworkBitWriter::halfToFloat((uint16_t)readBits(16));
+}   // readHalfFloat
+
+// ----------------------------------------------------------------------------
+/** Skips the padding bits up to the next byte boundary, i.e. the position
+ *  at which the writer was flushed. */
+void NetworkBitReader::align()
+{
+    m_bit_pos = (m_bit_pos + 7) & ~7;
+}   // align
+
+// ============================================================================
+/** Very rudimentary unit testing of the bit stream functions. */
+void NetworkBitWriter::unitTesting()
+{
+    NetworkString ns;
+    ns.addUInt8(0xab);   // check that the byte offset is handled
+    {
+        NetworkBitWriter w(&ns);
+        w.writeBool(true).writeBits(5, 3).writeBits(0xdeadbeef, 32);
+        w.writeVarUInt(0).writeVarUInt(127).writeVarUInt(300000);
+        w.writeVarInt(-1).writeVarInt(-70000).writeVarInt(12);
+        w.writeFloat(3.25f).writeHalfFloat(-2.5f).writeHalfFloat(1000.0f);
+        w.writeBits(1, 1);
+    }
+    NetworkBitReader r(ns, 1);
+    assert(r.readBool());
+    assert(r.readBits(3) == 5);
+    assert(r.readBits(32) == 0xdeadbeef);
+    assert(r.readVarUInt() == 0);
+    assert(r.readVarUInt() == 127);
+    assert(r.readVarUInt() == 300000);
+    assert(r.readVarInt() == -1);
+    assert(r.readVarInt() == -70000);
+    assert(r.readVarInt() == 12);
+    assert(r.readFloat() == 3.25f);
+    assert(r.readHalfFloat() == -2.5f);
+    assert(r.readHalfFloat() == 1000.0f);
+    assert(r.readBits(1) == 1);
+    assert(!r.hasError());
+    r.align();
+    assert(r.getBytesRead() == ns.size() - 1);
+    r.readBits(8);
+    assert(r.hasError());
+
+    assert(zigZagDecode(zigZagEncode(-2147483647-1)) == -2147483647-1);
+    assert(fabsf(halfToFloat(floatToHalf(0.1f)) - 0.1f) < 0.0001f);
+    assert(halfToFloat(floatToHalf(1e-6f)) > 0);
+}   // unitTesting
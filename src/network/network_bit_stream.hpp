@@ -0,0 +1,131 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file network_bit_stream.hpp
+ *  \brief Bit-level writer and reader for NetworkStrings.
+ */
+
+#ifndef NETWORK_BIT_STREAM_HPP
+#define NETWORK_BIT_STREAM_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+class NetworkString;
+
+/** \class NetworkBitWriter
+ *  \brief Appends bit-packed data to a NetworkString.
+ *  Bits are stored LSB first, i.e. the first bit written ends up in bit 0
+ *  of the first byte. This allows small values (enums, booleans, ids) to
+ *  use only as many bits as they need. The data is only appended to the
+ *  network string once flush() is called (which also pads the stream to
+ *  the next byte boundary), or when the writer is destroyed.
+ *  \ingroup network
+ */
+class NetworkBitWriter : public NoCopy
+{
+private:
+    /** The string the data is appended to. */
+    NetworkString *m_string;
+
+    /** Bits that have not been appended to the string yet. */
+    uint64_t m_scratch;
+
+    /** Number of valid bits in m_scratch. */
+    int m_scratch_bits;
+
+public:
+          NetworkBitWriter(NetworkString *ns);
+         ~NetworkBitWriter();
+    NetworkBitWriter& writeBits(uint32_t value, int n);
+    NetworkBitWriter& writeVarUInt(uint32_t value);
+    NetworkBitWriter& writeVarInt(int32_t value);
+    NetworkBitWriter& writeFloat(float value);
+    NetworkBitWriter& writeHalfFloat(float value);
+    void              flush();
+    static uint16_t   floatToHalf(float value);
+    static float      halfToFloat(uint16_t value);
+    static void       unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** Writes a single bit. */
+    NetworkBitWriter& writeBool(bool b) { return writeBits(b ? 1 : 0, 1); }
+    // ------------------------------------------------------------------------
+    /** Maps signed to unsigned values so that numbers of small magnitude
+     *  result in small values: 0, -1, 1, -2, ... become 0, 1, 2, 3, ... */
+    static uint32_t zigZagEncode(int32_t v)
+    {
+        return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    }   // zigZagEncode
+    // ------------------------------------------------------------------------
+    /** Inverse of zigZagEncode. */
+    static int32_t zigZagDecode(uint32_t v)
+    {
+        return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }   // zigZagDecode
+};   // NetworkBitWriter
+
+// ============================================================================
+/** \class NetworkBitReader
+ *  \brief Reads bit-packed data written by a NetworkBitWriter.
+ *  Reading past the end of the data does not crash, it returns 0 and sets
+ *  an error flag which can be tested with hasError() once all data is read.
+ *  \ingroup network
+ */
+class NetworkBitReader : public NoCopy
+{
+private:
+    /** Pointer to the start of the bit-packed data. */
+    const uint8_t *m_data;
+
+    /** Size of the data in bytes. */
+    int m_size;
+
+    /** Current read position in bits. */
+    int m_bit_pos;
+
+    /** Set if an attempt was made to read beyond the end of the data. */
+    bool m_error;
+
+public:
+             NetworkBitReader(const NetworkString &ns, int byte_pos = 0);
+             NetworkBitReader(const uint8_t *data, int size);
+    uint32_t readBits(int n);
+    uint32_t readVarUInt();
+    float    readFloat();
+    float    readHalfFloat();
+    void     align();
+
+    // ------------------------------------------------------------------------
+    /** Reads a single bit. */
+    bool readBool() { return readBits(1) != 0; }
+    // ------------------------------------------------------------------------
+    /** Reads a zig-zag encoded signed variable length integer. */
+    int32_t readVarInt()
+    {
+        return NetworkBitWriter::zigZagDecode(readVarUInt());
+    }   // readVarInt
+    // ------------------------------------------------------------------------
+    /** True if more data was requested than available. */
+    bool hasError() const { return m_error; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes consumed so far (rounded up). */
+    int getBytesRead() const { return (m_bit_pos + 7) / 8; }
+};   // NetworkBitReader
+
+#endif // NETWORK_BIT_STREAM_HPP
@@ -0,0 +1,210 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/network_clock.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+namespace
+{
+    /** Number of samples kept for filtering and drift estimation. */
+    const unsigned int MAX_SAMPLES    = 16;
+    /** Number of samples with the lowest round trip time that are used. */
+    const unsigned int BEST_SAMPLES   = 4;
+    /** Offset changes larger than this are applied immediately, smaller
+     *  ones are smoothed to avoid visible jumps. */
+    const double       STEP_THRESHOLD = 0.25;
+    /** Maximum drift that is accepted (500 ppm, as in NTP). */
+    const double       MAX_DRIFT      = 0.0005;
+}
+
+// ----------------------------------------------------------------------------
+NetworkClock::NetworkClock()
+{
+    reset();
+}   // NetworkClock
+
+// ----------------------------------------------------------------------------
+/** Forgets all measurements. */
+void NetworkClock::reset()
+{
+    m_samples.clear();
+    m_offset         = 0;
+    m_drift          = 0;
+    m_reference_time = 0;
+    m_round_trip     = 0;
+    m_jitter         = 0;
+    m_last_transit   = 0;
+    m_has_transit    = false;
+    m_playout_delay  = 0;
+    m_synchronised   = false;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Adds a round trip measurement.
+ *  \param t0 Local time the request was sent.
+ *  \param t1 Remote time the request was received.
+ *  \param t2 Remote time the answer was sent.
+ *  \param t3 Local time the answer was received.
+ */
+void NetworkClock::addSample(double t0, double t1, double t2, double t3)
+{
+    Sample s;
+    s.m_local_time = t3;
+    s.m_offset     = ((t1 - t0) + (t2 - t3)) * 0.5;
+    s.m_round_trip = (t3 - t0) - (t2 - t1);
+    if (s.m_round_trip < 0)
+        s.m_round_trip = 0;
+
+    m_samples.push_back(s);
+    if (m_samples.size() > MAX_SAMPLES)
+        m_samples.pop_front();
+
+    if (!m_synchronised)
+        m_round_trip = s.m_round_trip;
+    else
+        m_round_trip += (s.m_round_trip - m_round_trip) * 0.125;
+
+    // Average the offsets of the samples with the lowest round trip times
+    std::deque<Sample> best = m_samples;
+    for (unsigned int i = 0; i < best.size(); i++)
+    {
+        for (unsigned int j = i + 1; j < best.size(); j++)
+        {
+            if (best[j].m_round_trip < best[i].m_round_trip)
+                std::swap(best[i], best[j]);
+        }
+    }
+    unsigned int n = best.size() < BEST_SAMPLES ? (unsigned int)best.size()
+                                                : BEST_SAMPLES;
+    double offset = 0;
+    for (unsigned int i = 0; i < n; i++)
+        offset += best[i].m_offset;
+    offset /= n;
+
+    // Least squares fit of the offsets over time for the drift
+    if (m_samples.size() >= 4)
+    {
+        double mean_t = 0, mean_o = 0;
+        for (unsigned int i = 0; i < m_samples.size(); i++)
+        {
+            mean_t += m_samples[i].m_local_time;
+            mean_o += m_samples[i].m_offset;
+        }
+        mean_t /= m_samples.size();
+        mean_o /= m_samples.size();
+        double num = 0, den = 0;
+        for (unsigned int i = 0; i < m_samples.size(); i++)
+        {
+            double dt = m_samples[i].m_local_time - mean_t;
+            num += dt * (m_samples[i].m_offset - mean_o);
+            den += dt * dt;
+        }
+        // Only trust the fit if the samples span a reasonable time
+        if (den > 0 && m_samples.back().m_local_time
+                       - m_samples.front().m_local_time > 1.0)
+        {
+            double drift = num / den;
+            if (drift >  MAX_DRIFT) drift =  MAX_DRIFT;
+            if (drift < -MAX_DRIFT) drift = -MAX_DRIFT;
+            m_drift += (drift - m_drift) * 0.25;
+        }
+    }
+
+    double current = toRemoteTime(t3) - t3;
+    if (!m_synchronised || fabs(offset - current) > STEP_THRESHOLD)
+        m_offset = offset;
+    else
+        m_offset = current + (offset - current) * 0.1;
+    m_reference_time = t3;
+    m_synchronised   = true;
+}   // addSample
+
+// ----------------------------------------------------------------------------
+/** Updates the jitter estimate with a received packet (RFC 3550 style).
+ *  \param remote_send_time Remote time at which the packet was sent.
+ *  \param local_time Local time at which the packet was received.
+ */
+void NetworkClock::addArrival(double remote_send_time, double local_time)
+{
+    double transit = local_time - remote_send_time;
+    if (m_has_transit)
+    {
+        double d = fabs(transit - m_last_transit);
+        m_jitter += (d - m_jitter) / 16.0;
+    }
+    m_last_transit = transit;
+    m_has_transit  = true;
+}   // addArrival
+
+// ----------------------------------------------------------------------------
+/** Converts a local time to the estimated remote time. */
+double NetworkClock::toRemoteTime(double local_time) const
+{
+    return local_time + m_offset + m_drift * (local_time - m_reference_time);
+}   // toRemoteTime
+
+// ----------------------------------------------------------------------------
+/** Adapts the playout delay to the current jitter. The delay is increased
+ *  quickly if the jitter gets worse, but only decreased slowly, so that
+ *  short bursts of good packets do not cause stutter afterwards.
+ *  \param send_interval Time between two packets sent by the remote host.
+ *  \param dt Time step since the last call.
+ *  \return The new playout delay.
+ */
+double NetworkClock::updatePlayoutDelay(double send_interval, double dt)
+{
+    double target = send_interval * 1.5 + 3.0 * m_jitter;
+    if (target > m_playout_delay || m_playout_delay == 0)
+        m_playout_delay = target;
+    else
+    {
+        double f = dt * 0.5;
+        if (f > 1.0) f = 1.0;
+        m_playout_delay += (target - m_playout_delay) * f;
+    }
+    return m_playout_delay;
+}   // updatePlayoutDelay
+
+// ----------------------------------------------------------------------------
+/** Very rudimentary unit testing of the estimator: a remote clock that is
+ *  100 seconds ahead and runs 0.01% faster, with asymmetric delays. */
+void NetworkClock::unitTesting()
+{
+    NetworkClock clock;
+    assert(!clock.isSynchronised());
+    for (int i = 0; i < 40; i++)
+    {
+        double t0 = i * 0.1;
+        double delay = (i % 3 == 0) ? 0.08 : 0.02;
+        double t1 = (t0 + 0.02) * 1.0001 + 100.0;
+        double t2 = t1 + 0.001;
+        double t3 = t0 + 0.02 + 0.001 + delay;
+        clock.addSample(t0, t1, t2, t3);
+        clock.addArrival(t2, t3);
+    }
+    assert(clock.isSynchronised());
+    double local   = 4.0;
+    double remote  = local * 1.0001 + 100.0;
+    assert(fabs(clock.toRemoteTime(local) - remote) < 0.02);
+    assert(clock.getRoundTripTime() > 0.03 && clock.getRoundTripTime() < 0.1);
+    assert(clock.getJitter() > 0);
+    assert(clock.updatePlayoutDelay(0.05, 0.016) >= 0.075);
+}   // unitTesting
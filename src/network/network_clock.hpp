@@ -0,0 +1,112 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file network_clock.hpp
+ *  \brief Estimates the clock of a remote host.
+ */
+
+#ifndef NETWORK_CLOCK_HPP
+#define NETWORK_CLOCK_HPP
+
+#include <deque>
+
+/** \class NetworkClock
+ *  \brief Keeps a smoothed estimate of the clock of a remote host (the
+ *  server), and of the jitter of the packets received from it.
+ *  Offset and round trip time are measured like in NTP: a request is sent
+ *  at local time t0, received by the remote host at remote time t1,
+ *  answered at remote time t2 and the answer is received at local time t3.
+ *  Then the offset is ((t1-t0)+(t2-t3))/2 and the round trip time is
+ *  (t3-t0)-(t2-t1). Only the samples with the smallest round trip times
+ *  of the last few samples are used, since they are least affected by
+ *  queueing delays. The drift between the clocks is estimated by a linear
+ *  fit of the offsets over time.
+ *  The jitter (the variation of the one-way transit time of packets) is
+ *  used to compute an adaptive playout delay: the time by which
+ *  received states should be delayed so that they are usually available
+ *  when they are needed for interpolation.
+ *  \ingroup network
+ */
+class NetworkClock
+{
+private:
+    struct Sample
+    {
+        double m_local_time;
+        double m_offset;
+        double m_round_trip;
+    };   // Sample
+
+    /** The last samples, oldest first. */
+    std::deque<Sample> m_samples;
+
+    /** The current (smoothed) offset of the remote clock at
+     *  m_reference_time. */
+    double m_offset;
+
+    /** Estimated drift of the remote clock, in seconds per second. */
+    double m_drift;
+
+    /** Local time at which m_offset was computed. */
+    double m_reference_time;
+
+    /** Smoothed round trip time. */
+    double m_round_trip;
+
+    /** Smoothed jitter of the one-way transit time. */
+    double m_jitter;
+
+    /** Transit time of the previous packet, used for the jitter. */
+    double m_last_transit;
+
+    /** True once at least one packet was used for the jitter. */
+    bool m_has_transit;
+
+    /** The current playout delay. */
+    double m_playout_delay;
+
+    /** True once the first offset sample was received. */
+    bool m_synchronised;
+
+public:
+             NetworkClock();
+    void     reset();
+    void     addSample(double t0, double t1, double t2, double t3);
+    void     addArrival(double remote_send_time, double local_time);
+    double   toRemoteTime(double local_time) const;
+    double   updatePlayoutDelay(double send_interval, double dt);
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    /** True once the remote clock is known. */
+    bool isSynchronised() const { return m_synchronised; }
+    // ------------------------------------------------------------------------
+    /** Returns the smoothed round trip time in seconds. */
+    double getRoundTripTime() const { return m_round_trip; }
+    // ------------------------------------------------------------------------
+    /** Returns the smoothed jitter in seconds. */
+    double getJitter() const { return m_jitter; }
+    // ------------------------------------------------------------------------
+    /** Returns the estimated drift in seconds per second. */
+    double getDrift() const { return m_drift; }
+    // ------------------------------------------------------------------------
+    /** Returns the current playout delay in seconds. */
+    double getPlayoutDelay() const { return m_playout_delay; }
+};   // NetworkClock
+
+#endif // NETWORK_CLOCK_HPP
@@ -92,7 +92,8 @@ bool NetworkManager::connect(TransportAddress peer)
     if (peerExists(peer))
         return isConnectedTo(peer);
 
-    return STKPeer::connectToHost(m_localhost, peer, 2, 0);
+    return STKPeer::connectToHost(m_localhost, peer,
+                                  STKHost::CHANNEL_COUNT, 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -121,11 +122,11 @@ void NetworkManager::notifyEvent(Event* event)
     if (event->type == EVENT_TYPE_MESSAGE)
     {
         uint32_t addr = peer->getAddress();
-        Log::verbose("NetworkManager", "Message, Sender : %i.%i.%i.%i, message = \"%s\"",
+        Log::verbose("NetworkManager", "Message, Sender : %i.%i.%i.%i, size = %d",
                   ((addr>>24)&0xff),
                   ((addr>>16)&0xff),
                   ((addr>>8)&0xff),
-                  (addr & 0xff), event->data().std_string().c_str());
+                  (addr & 0xff), event->getPayloadSize());
 
     }
 
@@ -145,14 +146,54 @@ void NetworkManager::sendPacket(STKPeer* peer, const NetworkString& data, bool r
 
 void NetworkManager::sendPacketExcept(STKPeer* peer, const NetworkString& data, bool reliable)
 {
+    sendPacketExcept(peer, STKHost::createPacket(data, reliable),
+                     STKHost::CHANNEL_LOBBY);
+}
+
+//-----------------------------------------------------------------------------
+
+void NetworkManager::sendPacket(STKPeer* peer, ENetPacket* packet,
+                                uint8_t channel)
+{
+    STKHost::lockENet();
+    if (peer)
+        peer->sendPacket(packet, channel);
+    STKHost::releasePacket(packet);
+    STKHost::unlockENet();
+}
+
+//-----------------------------------------------------------------------------
+/** Sends one packet to all peers except one. All peers share the same
+ *  packet, ENet only frees it once it was sent to all of them.
+ */
+void NetworkManager::sendPacketExcept(STKPeer* peer, ENetPacket* packet,
+                                      uint8_t channel)
+{
+    STKHost::lockENet();
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
         STKPeer* p = m_peers[i];
         if (!p->isSamePeer(peer))
         {
-            p->sendPacket(data, reliable);
+            p->sendPacket(packet, channel);
         }
     }
+    STKHost::releasePacket(packet);
+    STKHost::unlockENet();
+}
+
+//-----------------------------------------------------------------------------
+/** Sends one packet to a group of peers, e.g. all spectators. As with
+ *  sendPacketExcept the packet is shared by all of them.
+ */
+void NetworkManager::sendPacket(const std::vector<STKPeer*>& peers,
+                                ENetPacket* packet, uint8_t channel)
+{
+    STKHost::lockENet();
+    for (unsigned int i = 0; i < peers.size(); i++)
+        peers[i]->sendPacket(packet, channel);
+    STKHost::releasePacket(packet);
+    STKHost::unlockENet();
 }
 
 //-----------------------------------------------------------------------------
@@ -83,6 +83,14 @@ class NetworkManager : public AbstractSingleton<NetworkManager>
         virtual void sendPacketExcept(STKPeer* peer,
                                 const NetworkString& data,
                                 bool reliable = true);
+        // The same, with a packet created by STKHost::createPacket, which
+        // is shared by all recipients. They take ownership of the packet.
+        virtual void sendPacket(ENetPacket* packet, uint8_t channel) = 0;
+        void sendPacket(STKPeer* peer, ENetPacket* packet, uint8_t channel);
+        void sendPacketExcept(STKPeer* peer, ENetPacket* packet,
+                              uint8_t channel);
+        void sendPacket(const std::vector<STKPeer*>& peers,
+                        ENetPacket* packet, uint8_t channel);
 
         // Game related functions
         virtual GameSetup* setupNewGame(); //!< Creates a new game setup and returns it
@@ -104,7 +112,7 @@ class NetworkManager : public AbstractSingleton<NetworkManager>
         std::vector<STKPeer*> getPeers()    { return m_peers;             }
         unsigned int getPeerCount()         { return (int)m_peers.size(); }
         TransportAddress getPublicAddress() { return m_public_address;    }
-        GameSetup* getGameSetup()           { return m_game_setup;        }
+        virtual GameSetup* getGameSetup()   { return m_game_setup;        }
 
     protected:
         NetworkManager();
@@ -0,0 +1,146 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/network_simulator.hpp"
+
+#include "network/event.hpp"
+#include "network/network_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+
+NetworkSimulator *NetworkSimulator::m_network_simulator = NULL;
+const float  NetworkSimulator::REORDER_DELAY   = 50.0f;
+const double NetworkSimulator::MAX_QUEUE_DELAY = 1.0;
+
+// ----------------------------------------------------------------------------
+NetworkSimulator::NetworkSimulator(const Settings &settings)
+{
+    m_settings    = settings;
+    m_random      = settings.m_seed;
+    m_num_dropped = 0;
+    Log::info("NetworkSimulator", "Simulating latency %.0f ms, jitter %.0f "
+              "ms, loss %.1f%%, reordering %.1f%%, bandwidth %d kbit/s.",
+              m_settings.m_latency, m_settings.m_jitter,
+              m_settings.m_loss*100.0f, m_settings.m_reorder*100.0f,
+              m_settings.m_bandwidth);
+}   // NetworkSimulator
+
+// ----------------------------------------------------------------------------
+NetworkSimulator::~NetworkSimulator()
+{
+    std::multimap<double, Event*>::iterator i;
+    for (i = m_events.begin(); i != m_events.end(); i++)
+        delete i->second;
+    Log::info("NetworkSimulator", "%d packets were dropped.", m_num_dropped);
+}   // ~NetworkSimulator
+
+// ----------------------------------------------------------------------------
+/** Returns a pseudo random number between 0 and 1. The same generator as in
+ *  most C libraries is used, so that the results only depend on the seed.
+ */
+float NetworkSimulator::random()
+{
+    m_random = m_random*1103515245 + 12345;
+    return ((m_random >> 16) & 0x7fff) / 32768.0f;
+}   // random
+
+// ----------------------------------------------------------------------------
+/** Delays or drops a received event.
+ *  \param evt The event, which is copied if it is delivered.
+ *  \param event The ENet event it was created from.
+ */
+void NetworkSimulator::addEvent(const Event &evt, const ENetEvent &event)
+{
+    const double now = StkTime::getRealTime();
+    PeerLink &link   = m_links[event.peer];
+    const ENetPacket *packet = evt.type == EVENT_TYPE_MESSAGE ? event.packet
+                                                              : NULL;
+    // Connections and disconnections are never lost
+    const bool reliable = !packet ||
+                          (packet->flags & ENET_PACKET_FLAG_RELIABLE) != 0;
+
+    double time = now;
+    if (packet && m_settings.m_bandwidth > 0)
+    {
+        const double start = std::max(now, link.m_link_free);
+        if (!reliable && start - now > MAX_QUEUE_DELAY)
+        {
+            m_num_dropped++;
+            return;
+        }
+        const double bits = (packet->dataLength + PACKET_OVERHEAD) * 8.0;
+        link.m_link_free  = start + bits / (m_settings.m_bandwidth*1000.0);
+        time = link.m_link_free;
+    }
+
+    if (packet && random() < m_settings.m_loss)
+    {
+        if (!reliable)
+        {
+            m_num_dropped++;
+            return;
+        }
+        // ENet resends a lost reliable packet after about a round trip
+        time += (event.peer->roundTripTime
+                 + 4 * event.peer->roundTripTimeVariance) / 1000.0;
+    }
+
+    float delay = m_settings.m_latency
+                + m_settings.m_jitter * (2.0f * random() - 1.0f);
+    if (!reliable && random() < m_settings.m_reorder)
+        delay += REORDER_DELAY;
+    time += std::max(delay, 0.0f) / 1000.0;
+
+    if (packet && reliable)
+    {
+        // ENet delivers the reliable packets of a channel in order
+        const unsigned int channel =
+            std::min<unsigned int>(event.channelID,
+                                   STKHost::CHANNEL_COUNT - 1);
+        time = std::max(time, link.m_last_reliable[channel]);
+        link.m_last_reliable[channel] = time;
+    }
+    else if (!packet)
+    {
+        // Connections and disconnections are ordered with all channels
+        for (unsigned int i = 0; i < STKHost::CHANNEL_COUNT; i++)
+            time = std::max(time, link.m_last_reliable[i]);
+        for (unsigned int i = 0; i < STKHost::CHANNEL_COUNT; i++)
+            link.m_last_reliable[i] = time;
+        // The ENet peer can be reused for the next connection
+        if (evt.type == EVENT_TYPE_DISCONNECTED)
+            m_links.erase(event.peer);
+    }
+    m_events.insert(std::make_pair(time, new Event(evt)));
+}   // addEvent
+
+// ----------------------------------------------------------------------------
+/** Gives all events whose delivery time has come to the network manager.
+ */
+void NetworkSimulator::deliverEvents()
+{
+    const double now = StkTime::getRealTime();
+    while (!m_events.empty() && m_events.begin()->first <= now)
+    {
+        Event *evt = m_events.begin()->second;
+        m_events.erase(m_events.begin());
+        NetworkManager::getInstance()->notifyEvent(evt);
+        delete evt;
+    }
+}   // deliverEvents
@@ -0,0 +1,142 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_NETWORK_SIMULATOR_HPP
+#define HEADER_NETWORK_SIMULATOR_HPP
+
+#include "network/stk_host.hpp"
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <map>
+
+class Event;
+
+/**
+  * \brief Simulates a bad network link for testing, enabled with the
+  *  --net-* command line options.
+  *  The events received by the STKHost are delayed before they are given
+  *  to the network manager: each packet gets a latency with a random
+  *  jitter, unreliable packets can be lost or reordered, and the incoming
+  *  bandwidth of each peer can be limited. A lost reliable packet is
+  *  delayed by about a round trip instead, since ENet would resend it, and
+  *  reliable packets of a channel stay in order like with ENet. Only
+  *  received packets are affected, so both sides must use the simulator to
+  *  simulate both directions. All random values are taken from a generator
+  *  with a fixed seed, so that a test can be reproduced.
+  *  The simulator is only used by the network thread, so it needs no
+  *  locking.
+  * \ingroup network
+  */
+class NetworkSimulator : public NoCopy
+{
+public:
+    /** The simulated link conditions. */
+    struct Settings
+    {
+        /** One way latency in ms. */
+        float        m_latency;
+        /** Maximum random change of the latency in ms. */
+        float        m_jitter;
+        /** Fraction of packets that are lost. */
+        float        m_loss;
+        /** Fraction of unreliable packets that are delayed by REORDER_DELAY
+         *  so that later packets overtake them. */
+        float        m_reorder;
+        /** Incoming bandwidth of each peer in kbit/s, 0 for unlimited. */
+        int          m_bandwidth;
+        /** Seed of the random generator. */
+        unsigned int m_seed;
+        Settings() : m_latency(0), m_jitter(0), m_loss(0), m_reorder(0),
+                     m_bandwidth(0), m_seed(1) {}
+    };   // Settings
+
+private:
+    /** Extra delay in ms of reordered packets. */
+    static const float REORDER_DELAY;
+
+    /** Unreliable packets are dropped if they would wait this many seconds
+     *  for the bandwidth, like in the full queue of a router. */
+    static const double MAX_QUEUE_DELAY;
+
+    /** Bytes added to each packet for the ENet, UDP and IP headers. */
+    static const unsigned int PACKET_OVERHEAD = 40;
+
+    /** The state of the link to one peer. */
+    struct PeerLink
+    {
+        /** Time at which the previous packet is completely received, used
+         *  to limit the bandwidth. */
+        double m_link_free;
+        /** Delivery time of the last reliable packet of each channel. */
+        double m_last_reliable[STKHost::CHANNEL_COUNT];
+        PeerLink() : m_link_free(0)
+        {
+            for (unsigned int i = 0; i < STKHost::CHANNEL_COUNT; i++)
+                m_last_reliable[i] = 0;
+        }
+    };   // PeerLink
+
+    Settings                      m_settings;
+
+    /** State of the random generator. */
+    unsigned int                  m_random;
+
+    /** The links to all peers. */
+    std::map<const ENetPeer*, PeerLink> m_links;
+
+    /** The delayed events sorted by delivery time. Events with the same
+     *  time stay in the order they were added. */
+    std::multimap<double, Event*> m_events;
+
+    /** Number of packets that were dropped. */
+    unsigned int                  m_num_dropped;
+
+    static NetworkSimulator      *m_network_simulator;
+
+         NetworkSimulator(const Settings &settings);
+        ~NetworkSimulator();
+    float random();
+
+public:
+    void addEvent(const Event &evt, const ENetEvent &event);
+    void deliverEvents();
+    // ------------------------------------------------------------------------
+    /** Returns if there are events that are not delivered yet. */
+    bool hasEvents() const { return !m_events.empty(); }
+    // ------------------------------------------------------------------------
+    /** Creates the network simulator. */
+    static void create(const Settings &settings)
+    {
+        assert(!m_network_simulator);
+        m_network_simulator = new NetworkSimulator(settings);
+    }   // create
+    // ------------------------------------------------------------------------
+    /** Returns the network simulator, which is NULL if no network condition
+     *  is simulated. */
+    static NetworkSimulator *get() { return m_network_simulator; }
+    // ------------------------------------------------------------------------
+    /** Destroys the network simulator, which must only be done once the
+     *  network thread is stopped. */
+    static void destroy()
+    {
+        delete m_network_simulator;
+        m_network_simulator = NULL;
+    }   // destroy
+};   // NetworkSimulator
+
+#endif
@@ -51,6 +51,7 @@ class NetworkString
         NetworkString(const uint8_t& value) { m_string.push_back(value); }
         NetworkString(NetworkString const& copy) { m_string = copy.m_string; }
         NetworkString(const std::string & value) { m_string = std::vector<uint8_t>(value.begin(), value.end()); }
+        NetworkString(const uint8_t* data, int size) : m_string(data, data+size) { }
 
         NetworkString& removeFront(int size)
         {
@@ -0,0 +1,120 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/prediction_buffer.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "utils/log.hpp"
+
+#include <math.h>
+
+PredictionBuffer::PredictionBuffer()
+{
+    m_max_age            = 2.0f;
+    m_max_position_error = 0.1f;
+    m_max_rotation_error = 0.05f;
+}   // PredictionBuffer
+
+// ----------------------------------------------------------------------------
+/** Removes all recorded states, e.g. when the kart is rescued or reset. */
+void PredictionBuffer::reset()
+{
+    m_states.clear();
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Records the predicted state of the local kart for the given time. This
+ *  should be called once per frame after the physics were updated.
+ *  \param time The world time.
+ *  \param kart The local kart.
+ */
+void PredictionBuffer::record(float time, const AbstractKart *kart)
+{
+    // After a restart the time can go backwards
+    if (!m_states.empty() && m_states.back().m_time >= time)
+        m_states.clear();
+
+    PredictedState s;
+    s.m_time             = time;
+    s.m_transform        = kart->getBody()->getCenterOfMassTransform();
+    s.m_velocity         = kart->getBody()->getLinearVelocity();
+    s.m_angular_velocity = kart->getBody()->getAngularVelocity();
+    m_states.push_back(s);
+
+    while (m_states.front().m_time < time - m_max_age)
+        m_states.pop_front();
+}   // record
+
+// ----------------------------------------------------------------------------
+/** Compares the state the server computed for a certain time with the
+ *  state predicted for that time, and corrects the kart if necessary.
+ *  All states up to this time are discarded, since the server will never
+ *  send older states.
+ *  \param time World time of the server state.
+ *  \param server_transform The authoritative transform of the kart.
+ *  \param kart The local kart.
+ *  \return True if the kart was corrected.
+ */
+bool PredictionBuffer::reconcile(float time,
+                                 const btTransform &server_transform,
+                                 AbstractKart *kart)
+{
+    while (!m_states.empty() && m_states.front().m_time < time)
+        m_states.pop_front();
+    // A state newer than anything predicted: nothing to compare with.
+    if (m_states.empty())
+        return false;
+
+    const PredictedState &predicted = m_states.front();
+    float position_error = (server_transform.getOrigin()
+                           - predicted.m_transform.getOrigin()).length();
+    // Angle between both rotations (q and -q are the same rotation)
+    float dot = fabsf(server_transform.getRotation()
+                      .dot(predicted.m_transform.getRotation()));
+    float rotation_error = 2.0f*acosf(dot < 1.0f ? dot : 1.0f);
+    if (position_error < m_max_position_error &&
+        rotation_error < m_max_rotation_error)
+        return false;
+
+    Log::verbose("PredictionBuffer",
+                 "Correcting prediction at %f by %f m, %f rad, replaying %d "
+                 "states.", time, position_error, rotation_error,
+                 (int)m_states.size()-1);
+
+    // The correction which maps the predicted state at 'time' to the server
+    // state. Applying it to all later states replays the unacknowledged
+    // motion starting from the server state.
+    btTransform correction = server_transform
+                           * predicted.m_transform.inverse();
+    btMatrix3x3 correction_rotation(correction.getRotation());
+    for (unsigned int i = 0; i < m_states.size(); i++)
+    {
+        PredictedState &s = m_states[i];
+        s.m_transform        = correction * s.m_transform;
+        s.m_velocity         = correction_rotation * s.m_velocity;
+        s.m_angular_velocity = correction_rotation * s.m_angular_velocity;
+    }
+
+    btRigidBody *body = kart->getBody();
+    body->setCenterOfMassTransform(correction
+                                   * body->getCenterOfMassTransform());
+    body->setLinearVelocity(correction_rotation * body->getLinearVelocity());
+    body->setAngularVelocity(correction_rotation
+                             * body->getAngularVelocity());
+    return true;
+}   // reconcile
@@ -0,0 +1,84 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file prediction_buffer.hpp
+ *  \brief Client side prediction and reconciliation of the local kart.
+ */
+
+#ifndef PREDICTION_BUFFER_HPP
+#define PREDICTION_BUFFER_HPP
+
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btTransform.h"
+
+#include <deque>
+
+class AbstractKart;
+
+/** \class PredictionBuffer
+ *  \brief Stores the predicted physics states of the local kart.
+ *  The client simulates its own kart immediately (prediction), and records
+ *  the kart state of each frame keyed by the world time. When the server
+ *  sends the authoritative state for a time t, the state predicted for t is
+ *  compared with it. If they differ, the kart is moved to the server state
+ *  and the motion predicted since t (i.e. the effect of all inputs the
+ *  server has not yet acknowledged) is re-applied on top of it, so the
+ *  kart does not snap back to an old position.
+ *  \ingroup network
+ */
+class PredictionBuffer
+{
+private:
+    struct PredictedState
+    {
+        float       m_time;
+        btTransform m_transform;
+        Vec3        m_velocity;
+        Vec3        m_angular_velocity;
+    };   // PredictedState
+
+    /** The recorded states, sorted by time. */
+    std::deque<PredictedState> m_states;
+
+    /** Maximum time states are kept if no server update arrives. */
+    float m_max_age;
+
+    /** Position differences below this are considered to be correct. */
+    float m_max_position_error;
+
+    /** Rotation differences (in radians) below this are considered to be
+     *  correct. */
+    float m_max_rotation_error;
+
+public:
+         PredictionBuffer();
+    void record(float time, const AbstractKart *kart);
+    bool reconcile(float time, const btTransform &server_transform,
+                   AbstractKart *kart);
+    void reset();
+    // ------------------------------------------------------------------------
+    /** Returns the number of predicted states that were not yet confirmed
+     *  by the server. */
+    unsigned int getNumberOfStates() const
+    {
+        return (unsigned int)m_states.size();
+    }   // getNumberOfStates
+};   // PredictionBuffer
+
+#endif // PREDICTION_BUFFER_HPP
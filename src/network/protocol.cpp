@@ -56,16 +56,18 @@ PROTOCOL_TYPE Protocol::getProtocolType()
 
 bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 {
-    NetworkString data = event->data();
-    if (data.size() < minimum_size || data[0] != 4)
+    const uint8_t *data = event->getPayload();
+    int size = event->getPayloadSize();
+    if (size < minimum_size || size < 5 || data[0] != 4)
     {
         Log::warn("Protocol", "Receiving a badly "
                   "formated message. Size is %d and first byte %d",
-                  data.size(), data[0]);
+                  size, size > 0 ? data[0] : -1);
         return false;
     }
     STKPeer* peer = *(event->peer);
-    uint32_t token = data.gui32(1);
+    uint32_t token = ((uint32_t)data[1] << 24) | ((uint32_t)data[2] << 16)
+                   | ((uint32_t)data[3] <<  8) |  (uint32_t)data[4];
     if (token != peer->getClientServerToken())
     {
         Log::warn("Protocol", "Peer sending bad token. Request "
@@ -77,7 +79,9 @@ bool Protocol::checkDataSizeAndToken(Event* event, int minimum_size)
 
 bool Protocol::isByteCorrect(Event* event, int byte_nb, int value)
 {
-    NetworkString data = event->data();
+    if (byte_nb >= event->getPayloadSize())
+        return false;
+    const uint8_t *data = event->getPayload();
     if (data[byte_nb] != value)
     {
         Log::info("Protocol", "Bad byte at pos %d. %d "
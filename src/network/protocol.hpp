@@ -43,6 +43,7 @@ enum PROTOCOL_TYPE
     PROTOCOL_KART_UPDATE = 5,   //!< Protocol to update karts position, rotation etc...
     PROTOCOL_GAME_EVENTS = 6,   //!< Protocol to communicate the game events.
     PROTOCOL_CONTROLLER_EVENTS = 7,//!< Protocol to transfer controller modifications
+    PROTOCOL_BALL_UPDATE = 8,   //!< Protocol to update the soccer balls.
     PROTOCOL_SILENT = 0xffff    //!< Used for protocols that do not subscribe to any network event.
 };
 
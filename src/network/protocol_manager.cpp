@@ -21,6 +21,8 @@
 #include "network/protocol.hpp"
 #include "network/network_manager.hpp"
 #include "utils/log.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
 #include <assert.h>
@@ -31,9 +33,13 @@
 void* protocolManagerUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
+    profiler.setThreadName("ProtocolManager");
+    MemoryTracker::setThreadTag(MemoryTracker::TAG_NETWORK);
     while(manager && !manager->exit())
     {
+        PROFILER_PUSH_CPU_MARKER("ProtocolManager update", 0x7F, 0x00, 0x7F);
         manager->update();
+        PROFILER_POP_CPU_MARKER();
         StkTime::sleep(2);
     }
     return NULL;
@@ -42,9 +48,14 @@ void* protocolManagerAsynchronousUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
     manager->m_asynchronous_thread_running = true;
+    profiler.setThreadName("ProtocolManager async");
+    MemoryTracker::setThreadTag(MemoryTracker::TAG_NETWORK);
     while(manager && !manager->exit())
     {
+        PROFILER_PUSH_CPU_MARKER("ProtocolManager asynchronous update",
+                                 0x7F, 0x00, 0x7F);
         manager->asynchronousUpdate();
+        PROFILER_POP_CPU_MARKER();
         StkTime::sleep(2);
     }
     manager->m_asynchronous_thread_running = false;
@@ -53,13 +64,13 @@ void* protocolManagerAsynchronousUpdate(void* data)
 
 ProtocolManager::ProtocolManager()
 {
-    pthread_mutex_init(&m_events_mutex, NULL);
     pthread_mutex_init(&m_protocols_mutex, NULL);
     pthread_mutex_init(&m_asynchronous_protocols_mutex, NULL);
     pthread_mutex_init(&m_requests_mutex, NULL);
     pthread_mutex_init(&m_id_mutex, NULL);
     pthread_mutex_init(&m_exit_mutex, NULL);
     m_next_protocol_id = 0;
+    m_queued_events = 0;
 
 
     pthread_mutex_lock(&m_exit_mutex); // will let the update function run
@@ -83,25 +94,26 @@ void ProtocolManager::abort()
 {
     pthread_mutex_unlock(&m_exit_mutex); // will stop the update function
     pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
-    pthread_mutex_lock(&m_events_mutex);
     pthread_mutex_lock(&m_protocols_mutex);
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
     pthread_mutex_lock(&m_requests_mutex);
     pthread_mutex_lock(&m_id_mutex);
     for (unsigned int i = 0; i < m_protocols.size() ; i++)
+    {
+        deleteEvents(m_protocols[i].inbox);
+        delete m_protocols[i].inbox;
         delete m_protocols[i].protocol;
-    for (unsigned int i = 0; i < m_events_to_process.size() ; i++)
-        delete m_events_to_process[i].event;
+    }
+    Event* event;
+    while (m_events_to_process.pop(&event))
+        delete event;
     m_protocols.clear();
     m_requests.clear();
-    m_events_to_process.clear();
-    pthread_mutex_unlock(&m_events_mutex);
     pthread_mutex_unlock(&m_protocols_mutex);
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
     pthread_mutex_unlock(&m_requests_mutex);
     pthread_mutex_unlock(&m_id_mutex);
 
-    pthread_mutex_destroy(&m_events_mutex);
     pthread_mutex_destroy(&m_protocols_mutex);
     pthread_mutex_destroy(&m_asynchronous_protocols_mutex);
     pthread_mutex_destroy(&m_requests_mutex);
@@ -111,76 +123,101 @@ void ProtocolManager::abort()
 
 void ProtocolManager::notifyEvent(Event* event)
 {
-    pthread_mutex_lock(&m_events_mutex);
-    Event* event2 = new Event(*event);
-    // register protocols that will receive this event
-    std::vector<unsigned int> protocols_ids;
-    PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
-    if (event2->type == EVENT_TYPE_MESSAGE)
+    // Copying an event only shares its packet, the data is not copied.
+    // The event is dispatched to the protocols in the asynchronous thread,
+    // so the network thread never waits for a lock here.
+    m_events_to_process.push(new Event(*event));
+    m_queued_events++;
+}
+
+/** Moves all newly received events into the inboxes of the protocols that
+ *  will receive them. Only called in the asynchronous update thread.
+ */
+void ProtocolManager::dispatchEvents()
+{
+    Event* event;
+    while (m_events_to_process.pop(&event))
     {
-        if (event2->data().size() > 0)
+        m_queued_events--;
+        PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
+        if (event->type == EVENT_TYPE_MESSAGE)
         {
-            searchedProtocol = (PROTOCOL_TYPE)(event2->data()[0]);
-            event2->removeFront(1);
+            if (event->getPayloadSize() > 0)
+            {
+                searchedProtocol = (PROTOCOL_TYPE)(event->getPayload()[0]);
+                event->removeFront(1);
+            }
+            else
+            {
+                Log::warn("ProtocolManager", "Not enough data.");
+            }
         }
-        else
+        if (event->type == EVENT_TYPE_CONNECTED)
         {
-            Log::warn("ProtocolManager", "Not enough data.");
+            searchedProtocol = PROTOCOL_CONNECTION;
         }
-    }
-    if (event2->type == EVENT_TYPE_CONNECTED)
-    {
-        searchedProtocol = PROTOCOL_CONNECTION;
-    }
-    Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
-    pthread_mutex_lock(&m_protocols_mutex);
-    for (unsigned int i = 0; i < m_protocols.size() ; i++)
-    {
-        if (m_protocols[i].protocol->getProtocolType() == searchedProtocol || event2->type == EVENT_TYPE_DISCONNECTED) // pass data to protocols even when paused
+        Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
+        if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
         {
-            protocols_ids.push_back(m_protocols[i].id);
+            Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event->data().std_string().c_str());
         }
-    }
-    pthread_mutex_unlock(&m_protocols_mutex);
-    if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
-    {
-        Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event2->data().std_string().c_str());
-    }
 
-    if (protocols_ids.size() != 0)
-    {
         EventProcessingInfo epi;
         epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
-        epi.event = event2;
-        epi.protocols_ids = protocols_ids;
-        m_events_to_process.push_back(epi); // add the event to the queue
+        bool delivered = false;
+        // m_protocols is only modified by this thread, and the main thread
+        // only reads it, so no lock is needed to read it here.
+        for (unsigned int i = 0; i < m_protocols.size() ; i++)
+        {
+            // pass data to protocols even when paused
+            if (m_protocols[i].protocol->getProtocolType() != searchedProtocol &&
+                event->type != EVENT_TYPE_DISCONNECTED)
+                continue;
+            // Each protocol gets one copy for the asynchronous and one copy
+            // for the synchronous notification.
+            epi.event = new Event(*event);
+            m_protocols[i].inbox->asynchronous_events.push_back(epi);
+            epi.event = new Event(*event);
+            m_protocols[i].inbox->synchronous_queue.push(epi);
+            delivered = true;
+        }
+        if (!delivered)
+            Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
+        delete event;
     }
-    else
-        Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
-    pthread_mutex_unlock(&m_events_mutex);
-}
+}   // dispatchEvents
 
+// The protocol type is written in front of the message directly in the
+// packet, which is shared by all recipients of the message. Each group of
+// protocols has its own channel, so that e.g. a lost lobby message does not
+// delay the game events.
 void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message, bool reliable)
 {
-    NetworkString newMessage;
-    newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
-    newMessage += message;
-    NetworkManager::getInstance()->sendPacket(newMessage, reliable);
+    NetworkManager::getInstance()->sendPacket(
+        STKHost::createPacket(message, reliable, sender->getProtocolType()),
+        STKHost::getChannel(sender->getProtocolType()));
 }
 
 void ProtocolManager::sendMessage(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
-    NetworkString newMessage;
-    newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
-    newMessage += message;
-    NetworkManager::getInstance()->sendPacket(peer, newMessage, reliable);
+    NetworkManager::getInstance()->sendPacket(peer,
+        STKHost::createPacket(message, reliable, sender->getProtocolType()),
+        STKHost::getChannel(sender->getProtocolType()));
 }
 void ProtocolManager::sendMessageExcept(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
-    NetworkString newMessage;
-    newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
-    newMessage += message;
-    NetworkManager::getInstance()->sendPacketExcept(peer, newMessage, reliable);
+    NetworkManager::getInstance()->sendPacketExcept(peer,
+        STKHost::createPacket(message, reliable, sender->getProtocolType()),
+        STKHost::getChannel(sender->getProtocolType()));
+}
+
+void ProtocolManager::sendMessage(Protocol* sender, const std::vector<STKPeer*>& peers, const NetworkString& message, bool reliable)
+{
+    if (peers.empty())
+        return;
+    NetworkManager::getInstance()->sendPacket(peers,
+        STKHost::createPacket(message, reliable, sender->getProtocolType()),
+        STKHost::getChannel(sender->getProtocolType()));
 }
 
 uint32_t ProtocolManager::requestStart(Protocol* protocol)
@@ -190,6 +227,7 @@ uint32_t ProtocolManager::requestStart(Protocol* protocol)
     ProtocolInfo info;
     info.protocol = protocol;
     info.state = PROTOCOL_STATE_RUNNING;
+    info.inbox = NULL;
     assignProtocolId(&info); // assign a unique id to the protocol.
     req.protocol_info = info;
     req.type = PROTOCOL_REQUEST_START;
@@ -272,6 +310,7 @@ void ProtocolManager::startProtocol(ProtocolInfo protocol)
     pthread_mutex_lock(&m_protocols_mutex);
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
     Log::info("ProtocolManager", "A %s protocol with id=%u has been started. There are %ld protocols running.", typeid(*protocol.protocol).name(), protocol.id, m_protocols.size()+1);
+    protocol.inbox = new ProtocolInbox();
     m_protocols.push_back(protocol);
     // setup the protocol and notify it that it's started
     protocol.protocol->setListener(this);
@@ -315,7 +354,9 @@ void ProtocolManager::protocolTerminated(ProtocolInfo protocol)
     {
         if (m_protocols[i-offset].protocol == protocol.protocol)
         {
-            delete m_protocols[i].protocol;
+            deleteEvents(m_protocols[i-offset].inbox);
+            delete m_protocols[i-offset].inbox;
+            delete m_protocols[i-offset].protocol;
             m_protocols.erase(m_protocols.begin()+(i-offset), m_protocols.begin()+(i-offset)+1);
             offset++;
         }
@@ -325,76 +366,111 @@ void ProtocolManager::protocolTerminated(ProtocolInfo protocol)
     pthread_mutex_unlock(&m_protocols_mutex);
 }
 
-bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronous)
+/** Passes events to a protocol. Events that the protocol did not consume
+ *  are kept for the next update, unless they are older than
+ *  TIME_TO_KEEP_EVENTS.
+ *  \param protocol The protocol to notify.
+ *  \param events The events for this protocol, consumed events are removed.
+ *  \param synchronous True if called from the main thread.
+ */
+void ProtocolManager::propagateEvents(Protocol* protocol,
+                                      std::vector<EventProcessingInfo>* events,
+                                      bool synchronous)
 {
-    int index = 0;
-    for (unsigned int i = 0; i < m_protocols.size(); i++)
-    {
-        if (event->protocols_ids[index] == m_protocols[i].id)
-        {
-            bool result = false;
-            if (synchronous)
-                result = m_protocols[i].protocol->notifyEvent(event->event);
-            else
-                result = m_protocols[i].protocol->notifyEventAsynchronous(event->event);
-            if (result)
-                event->protocols_ids.pop_back();
-            else
-                index++;
-        }
-    }
-    if (event->protocols_ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
+    double now = (double)StkTime::getTimeSinceEpoch();
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < events->size(); i++)
     {
-        // because we made a copy of the event
-        delete event->event->peer; // no more need of that
-        delete event->event;
-        return true;
+        EventProcessingInfo& epi = (*events)[i];
+        bool result;
+        if (synchronous)
+            result = protocol->notifyEvent(epi.event);
+        else
+            result = protocol->notifyEventAsynchronous(epi.event);
+        if (result || now - epi.arrival_time >= TIME_TO_KEEP_EVENTS)
+            delete epi.event;
+        else
+            (*events)[kept++] = epi;
     }
-    return false;
-}
+    // Compact in place instead of erasing each element
+    events->resize(kept);
+}   // propagateEvents
+
+/** Deletes all events still stored in an inbox. */
+void ProtocolManager::deleteEvents(ProtocolInbox* inbox)
+{
+    if (!inbox)
+        return;
+    EventProcessingInfo epi;
+    while (inbox->synchronous_queue.pop(&epi))
+        delete epi.event;
+    for (unsigned int i = 0; i < inbox->synchronous_events.size(); i++)
+        delete inbox->synchronous_events[i].event;
+    for (unsigned int i = 0; i < inbox->asynchronous_events.size(); i++)
+        delete inbox->asynchronous_events[i].event;
+    inbox->synchronous_events.clear();
+    inbox->asynchronous_events.clear();
+}   // deleteEvents
 
 void ProtocolManager::update()
 {
     // before updating, notice protocols that they have received events
-    pthread_mutex_lock(&m_events_mutex); // secure threads
-    int size = (int)m_events_to_process.size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
+    pthread_mutex_lock(&m_protocols_mutex);
+    for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
-        bool result = propagateEvent(&m_events_to_process[i+offset], true);
-        if (result)
-        {
-            m_events_to_process.erase(m_events_to_process.begin()+i+offset,m_events_to_process.begin()+i+offset+1);
-            offset --;
-        }
+        ProtocolInbox* inbox = m_protocols[i].inbox;
+        EventProcessingInfo epi;
+        while (inbox->synchronous_queue.pop(&epi))
+            inbox->synchronous_events.push_back(epi);
+        propagateEvents(m_protocols[i].protocol, &inbox->synchronous_events,
+                        true);
     }
-    pthread_mutex_unlock(&m_events_mutex); // release the mutex
+    pthread_mutex_unlock(&m_protocols_mutex);
     // now update all protocols
     pthread_mutex_lock(&m_protocols_mutex);
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
         if (m_protocols[i].state == PROTOCOL_STATE_RUNNING)
+        {
+            double start = getTimeMilliseconds();
             m_protocols[i].protocol->update();
+            m_update_times[m_protocols[i].protocol->getProtocolType()] +=
+                getTimeMilliseconds() - start;
+        }
     }
     pthread_mutex_unlock(&m_protocols_mutex);
+    flushPackets();
+}
+
+void ProtocolManager::getUpdateTimes(std::map<int, double>* times)
+{
+    pthread_mutex_lock(&m_protocols_mutex);
+    times->swap(m_update_times);
+    m_update_times.clear();
+    pthread_mutex_unlock(&m_protocols_mutex);
 }
 
+/** Sends the packets queued by the protocols now, instead of waiting until
+ *  the network thread services the host again.
+ */
+void ProtocolManager::flushPackets()
+{
+    NetworkManager *network_manager = NetworkManager::getInstance();
+    if (network_manager && network_manager->getHost())
+        network_manager->getHost()->flush();
+}   // flushPackets
+
 void ProtocolManager::asynchronousUpdate()
 {
     // before updating, notice protocols that they have received information
-    pthread_mutex_lock(&m_events_mutex); // secure threads
-    int size = (int)m_events_to_process.size();
-    int offset = 0;
-    for (int i = 0; i < size; i++)
+    dispatchEvents();
+    pthread_mutex_lock(&m_asynchronous_protocols_mutex);
+    for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
-        bool result = propagateEvent(&m_events_to_process[i+offset], false);
-        if (result)
-        {
-            m_events_to_process.erase(m_events_to_process.begin()+i+offset,m_events_to_process.begin()+i+offset+1);
-            offset --;
-        }
+        propagateEvents(m_protocols[i].protocol,
+                        &m_protocols[i].inbox->asynchronous_events, false);
     }
-    pthread_mutex_unlock(&m_events_mutex); // release the mutex
+    pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
 
     // now update all protocols that need to be updated in asynchronous mode
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
@@ -404,6 +480,7 @@ void ProtocolManager::asynchronousUpdate()
             m_protocols[i].protocol->asynchronousUpdate();
     }
     pthread_mutex_unlock(&m_asynchronous_protocols_mutex);
+    flushPackets();
 
     // process queued events for protocols
     // these requests are asynchronous
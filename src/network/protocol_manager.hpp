@@ -26,9 +26,12 @@
 #include "network/event.hpp"
 #include "network/network_string.hpp"
 #include "network/protocol.hpp"
+#include "utils/mpsc_queue.hpp"
 #include "utils/singleton.hpp"
 #include "utils/types.hpp"
 
+#include <atomic>
+#include <map>
 #include <vector>
 
 #define TIME_TO_KEEP_EVENTS 1.0
@@ -59,6 +62,33 @@ enum PROTOCOL_REQUEST_TYPE
     PROTOCOL_REQUEST_TERMINATE  //!< Terminate a protocol
 };
 
+/*! \struct EventProcessingInfo
+ *  \brief Used to pass the event to protocols that need it
+ */
+typedef struct EventProcessingInfo
+{
+    Event* event;
+    double arrival_time;
+} EventProcessingInfo;
+
+/*!
+* \struct ProtocolInbox
+* \brief The events waiting to be processed by one protocol.
+* Each protocol receives its own copy of an event (which only shares the
+* packet data), so no protocol has to wait for another one to consume it.
+*/
+struct ProtocolInbox
+{
+    /*! Events passed from the asynchronous thread to the main thread. */
+    MPSCQueue<EventProcessingInfo>   synchronous_queue;
+    /*! Events for notifyEvent that were not consumed yet. Only accessed by
+     *  the main thread. */
+    std::vector<EventProcessingInfo> synchronous_events;
+    /*! Events for notifyEventAsynchronous that were not consumed yet. Only
+     *  accessed by the asynchronous thread. */
+    std::vector<EventProcessingInfo> asynchronous_events;
+};
+
 /*!
 * \struct ProtocolInfo
 * \brief Stores the information needed to manage protocols
@@ -68,6 +98,7 @@ typedef struct ProtocolInfo
     PROTOCOL_STATE  state;      //!< The state of the protocol
     Protocol*       protocol;   //!< A pointer to the protocol
     uint32_t        id;         //!< The unique id of the protocol
+    ProtocolInbox*  inbox;      //!< Events to be processed by the protocol
 } ProtocolInfo;
 
 /*!
@@ -80,16 +111,6 @@ typedef struct ProtocolRequest
     ProtocolInfo protocol_info; //!< The concerned protocol information
 } ProtocolRequest;
 
-/*! \struct ProtocolRequest
- *  \brief Used to pass the event to protocols that need it
- */
-typedef struct EventProcessingInfo
-{
-    Event* event;
-    double arrival_time;
-    std::vector<unsigned int> protocols_ids;
-} EventProcessingInfo;
-
 /*!
  * \class ProtocolManager
  * \brief Manages the protocols at runtime.
@@ -128,6 +149,11 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          * \brief WILL BE COMMENTED LATER
          */
         virtual void            sendMessageExcept(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable = true);
+        /*!
+         * \brief Sends the same message to a group of peers. The packet is
+         * only created once and shared by all peers.
+         */
+        virtual void            sendMessage(Protocol* sender, const std::vector<STKPeer*>& peers, const NetworkString& message, bool reliable = true);
 
         /*!
          * \brief Asks the manager to start a protocol.
@@ -234,8 +260,22 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
         /*! \brief Tells if we need to stop the update thread. */
         int                     exit();
 
+        /*!
+         * \brief Returns the time spent in the update() function of each
+         * type of protocol since the last call, and resets it.
+         * \param times : Receives the time in ms for each PROTOCOL_TYPE.
+         */
+        void                    getUpdateTimes(std::map<int, double>* times);
+        /*! \brief Returns the number of events that were received but not
+         * yet given to the protocols. */
+        int getQueuedEventCount() const { return m_queued_events.load(); }
+
     protected:
         // protected functions
+        /*!
+         * \brief Sends the packets queued by the protocols immediately.
+         */
+        void                    flushPackets();
         /*!
          * \brief Constructor
          */
@@ -284,7 +324,11 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          */
         virtual void            protocolTerminated(ProtocolInfo protocol);
 
-        bool                    propagateEvent(EventProcessingInfo* event, bool synchronous);
+        void                    dispatchEvents();
+        void                    propagateEvents(Protocol* protocol,
+                                        std::vector<EventProcessingInfo>* events,
+                                        bool synchronous);
+        static void             deleteEvents(ProtocolInbox* inbox);
 
         // protected members
         /*!
@@ -294,9 +338,13 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          */
         std::vector<ProtocolInfo>       m_protocols;
         /*!
-         * \brief Contains the network events to pass to protocols.
+         * \brief Contains the network events that have not been passed to
+         * the inboxes of the protocols yet. Lock-free, so that the network
+         * thread never has to wait.
          */
-        std::vector<EventProcessingInfo>             m_events_to_process;
+        MPSCQueue<Event*>               m_events_to_process;
+        /*! \brief Number of events in m_events_to_process. */
+        std::atomic<int>                m_queued_events;
         /*!
          * \brief Contains the requests to start/stop etc... protocols.
          */
@@ -307,10 +355,11 @@ class ProtocolManager : public AbstractSingleton<ProtocolManager>
          * been formerly started.
          */
         uint32_t                        m_next_protocol_id;
+        /*! \brief Time (in ms) spent in update() per PROTOCOL_TYPE, guarded
+         * by m_protocols_mutex. */
+        std::map<int, double>           m_update_times;
 
         // mutexes:
-        /*! Used to ensure that the event queue is used thread-safely.       */
-        pthread_mutex_t                 m_events_mutex;
         /*! Used to ensure that the protocol vector is used thread-safely.   */
         pthread_mutex_t                 m_protocols_mutex;
         /*! Used to ensure that the protocol vector is used thread-safely.   */
@@ -0,0 +1,200 @@
+#include "network/protocols/ball_update_protocol.hpp"
+
+#include "config/stk_config.hpp"
+#include "modes/soccer_world.hpp"
+#include "network/kart_state_snapshot.hpp"
+#include "network/network_manager.hpp"
+#include "network/protocol_manager.hpp"
+#include "physics/physical_object.hpp"
+#include "tracks/track.hpp"
+#include "tracks/track_object.hpp"
+#include "tracks/track_object_manager.hpp"
+#include "utils/time.hpp"
+
+#include "LinearMath/btTransformUtil.h"
+
+#include <algorithm>
+
+/** A received state is extrapolated by at most this many seconds. */
+static const float MAX_EXTRAPOLATION = 0.5f;
+/** If the extrapolated position of a ball differs by more than this from
+ *  the local position, the ball is moved immediately. */
+static const float SNAP_DISTANCE     = 2.0f;
+/** Otherwise the ball is moved this fraction towards the server state. */
+static const float CORRECTION_FACTOR = 0.3f;
+
+BallUpdateProtocol::BallUpdateProtocol()
+    : Protocol(NULL, PROTOCOL_BALL_UPDATE)
+{
+    PtrVector<TrackObject> &objects =
+        World::getWorld()->getTrack()->getTrackObjectManager()->getObjects();
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        TrackObject *obj = objects.get(i);
+        if (obj->isSoccerBall() && obj->getPhysicalObject())
+            m_balls.push_back(obj->getPhysicalObject());
+    }
+    m_next_states.resize(m_balls.size());
+    m_next_time      = -1.0f;
+    m_has_next_state = false;
+    m_next_goals[0]  = m_next_goals[1] = 0;
+    m_next_last_hit  = -1;
+    m_last_send_time = 0;
+    pthread_mutex_init(&m_state_mutex, NULL);
+}   // BallUpdateProtocol
+
+BallUpdateProtocol::~BallUpdateProtocol()
+{
+    pthread_mutex_destroy(&m_state_mutex);
+}   // ~BallUpdateProtocol
+
+/** Client: stores the newest state received from the server. Older states
+ *  (unreliable packets can arrive out of order) are ignored. */
+bool BallUpdateProtocol::notifyEventAsynchronous(Event* event)
+{
+    if (event->type != EVENT_TYPE_MESSAGE || m_listener->isServer())
+        return true;
+    NetworkString ns = event->data();
+    // Message: time, the goals of both teams, the last kart that hit the
+    // ball, the number of balls followed by the state of each ball
+    if (ns.size() < 8 || ns.getUInt8(7) != m_balls.size() ||
+        ns.size() < 8 + 40 * (int)m_balls.size())
+    {
+        Log::info("BallUpdateProtocol", "Invalid message.");
+        return true;
+    }
+    float time = ns.getFloat(0);
+    pthread_mutex_lock(&m_state_mutex);
+    if (time > m_next_time)
+    {
+        m_next_time     = time;
+        m_next_goals[0] = ns.getUInt8(4);
+        m_next_goals[1] = ns.getUInt8(5);
+        m_next_last_hit = ns.getUInt8(6) == 0xff ? -1 : ns.getUInt8(6);
+        int pos = 8;
+        for (unsigned int i = 0; i < m_balls.size(); i++, pos += 40)
+        {
+            BallState &state = m_next_states[i];
+            state.m_xyz = Vec3(ns.getFloat(pos), ns.getFloat(pos + 4),
+                               ns.getFloat(pos + 8));
+            state.m_rotation =
+                KartStateSnapshot::decompressRotation(ns.getUInt32(pos + 12));
+            state.m_linear_velocity  = Vec3(ns.getFloat(pos + 16),
+                                            ns.getFloat(pos + 20),
+                                            ns.getFloat(pos + 24));
+            state.m_angular_velocity = Vec3(ns.getFloat(pos + 28),
+                                            ns.getFloat(pos + 32),
+                                            ns.getFloat(pos + 36));
+        }
+        m_has_next_state = true;
+    }
+    pthread_mutex_unlock(&m_state_mutex);
+    return true;
+}   // notifyEventAsynchronous
+
+/** Server: sends the state of all balls and the score to all peers. The
+ *  full state is sent each time, since it is small and a lost packet is
+ *  replaced by the next one soon. */
+void BallUpdateProtocol::sendState()
+{
+    SoccerWorld *world = dynamic_cast<SoccerWorld*>(World::getWorld());
+    NetworkString ns;
+    ns.af(World::getWorld()->getTime());
+    ns.ai8(world ? world->getScore(0) : 0);
+    ns.ai8(world ? world->getScore(1) : 0);
+    int last_hit = world ? world->getLastKartToHitBall() : -1;
+    ns.ai8(last_hit < 0 ? 0xff : last_hit);
+    ns.ai8((uint8_t)m_balls.size());
+    for (unsigned int i = 0; i < m_balls.size(); i++)
+    {
+        btRigidBody *body = m_balls[i]->getBody();
+        const btTransform &t = body->getCenterOfMassTransform();
+        ns.af(t.getOrigin().getX()).af(t.getOrigin().getY())
+          .af(t.getOrigin().getZ());
+        ns.ai32(KartStateSnapshot::compressRotation(t.getRotation()));
+        const btVector3 &v = body->getLinearVelocity();
+        ns.af(v.getX()).af(v.getY()).af(v.getZ());
+        const btVector3 &w = body->getAngularVelocity();
+        ns.af(w.getX()).af(w.getY()).af(w.getZ());
+    }
+    m_listener->sendMessage(this, ns, false);
+}   // sendState
+
+/** Client: corrects a ball towards a state received from the server.
+ *  \param state The received state.
+ *  \param dt Time by which the state is extrapolated, from the server time
+ *         of the state to the local world time.
+ *  \param ball The ball to correct. */
+void BallUpdateProtocol::applyState(const BallState &state, float dt,
+                                    PhysicalObject *ball)
+{
+    btRigidBody *body = ball->getBody();
+    btTransform predicted;
+    btTransformUtil::integrateTransform(btTransform(state.m_rotation,
+                                                    state.m_xyz),
+                                        state.m_linear_velocity,
+                                        state.m_angular_velocity,
+                                        dt, predicted);
+    const btTransform &current = body->getCenterOfMassTransform();
+    float error = (predicted.getOrigin() - current.getOrigin()).length();
+    if (error < SNAP_DISTANCE)
+    {
+        // Small errors (the local physics is mostly right) are corrected
+        // over a few updates, so that the ball does not jitter
+        predicted.setOrigin(current.getOrigin().lerp(predicted.getOrigin(),
+                                                     CORRECTION_FACTOR));
+        predicted.setRotation(current.getRotation()
+                             .slerp(predicted.getRotation(), CORRECTION_FACTOR));
+    }
+    body->setCenterOfMassTransform(predicted);
+    body->setLinearVelocity(state.m_linear_velocity);
+    body->setAngularVelocity(state.m_angular_velocity);
+    body->activate();
+}   // applyState
+
+void BallUpdateProtocol::update()
+{
+    if (!World::getWorld() || m_balls.empty())
+        return;
+
+    if (m_listener->isServer())
+    {
+        double current_time = StkTime::getRealTime();
+        if (current_time > m_last_send_time
+                         + 1.0/stk_config->m_network_ball_state_frequency)
+        {
+            m_last_send_time = current_time;
+            sendState();
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&m_state_mutex);
+    if (!m_has_next_state)
+    {
+        pthread_mutex_unlock(&m_state_mutex);
+        return;
+    }
+    std::vector<BallState> states = m_next_states;
+    float time    = m_next_time;
+    int goals[2]  = { m_next_goals[0], m_next_goals[1] };
+    int last_hit  = m_next_last_hit;
+    m_has_next_state = false;
+    pthread_mutex_unlock(&m_state_mutex);
+
+    // Apply the goals first, since a goal resets the balls
+    SoccerWorld *world = dynamic_cast<SoccerWorld*>(World::getWorld());
+    if (world)
+    {
+        for (unsigned int team = 0; team < 2; team++)
+        {
+            for (int n = world->getScore(team); n < goals[team]; n++)
+                world->onServerGoal(team == 0, last_hit);
+        }
+    }
+
+    float dt = World::getWorld()->getTime() - time;
+    dt = std::max(0.0f, std::min(dt, MAX_EXTRAPOLATION));
+    for (unsigned int i = 0; i < m_balls.size(); i++)
+        applyState(states[i], dt, m_balls[i]);
+}   // update
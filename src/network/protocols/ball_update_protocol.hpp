@@ -0,0 +1,75 @@
+#ifndef BALL_UPDATE_PROTOCOL_HPP
+#define BALL_UPDATE_PROTOCOL_HPP
+
+#include "network/protocol.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <pthread.h>
+#include <vector>
+
+class PhysicalObject;
+
+/** \brief Sends the state of the soccer balls from the server to all clients.
+ *  The server is authoritative for the balls and for goals: it sends the
+ *  full state of each ball (position, rotation and velocities), together
+ *  with the score, at a higher rate than the kart states (see
+ *  ball-state-frequency in stk_config.xml) on its own channel. Clients keep
+ *  simulating the balls with the local physics between the updates: a
+ *  received state is extrapolated to the local world time with bullet's
+ *  integration, small errors are smoothly corrected, large errors (e.g.
+ *  after a collision the client did not predict) snap the ball. Goals are
+ *  only detected by the server, clients apply a goal when the received
+ *  score is higher than their own.
+ */
+class BallUpdateProtocol : public Protocol
+{
+    protected:
+        /** The state of one ball as sent by the server. */
+        struct BallState
+        {
+            Vec3         m_xyz;
+            btQuaternion m_rotation;
+            Vec3         m_linear_velocity;
+            Vec3         m_angular_velocity;
+        };   // BallState
+
+        /** All soccer balls of the track. */
+        std::vector<PhysicalObject*> m_balls;
+
+        /** Client: the newest received states, applied in the next update. */
+        std::vector<BallState> m_next_states;
+
+        /** Client: server world time of the newest received state, or
+         *  a negative value if no state was received yet. */
+        float m_next_time;
+
+        /** Client: if m_next_states was not applied yet. */
+        bool m_has_next_state;
+
+        /** Client: the score and the last kart that hit the ball (or -1)
+         *  as received with the newest state. */
+        int m_next_goals[2];
+        int m_next_last_hit;
+
+        /** Server: time at which the last state was sent. */
+        double m_last_send_time;
+
+        pthread_mutex_t m_state_mutex;
+
+        void sendState();
+        void applyState(const BallState &state, float dt,
+                        PhysicalObject *ball);
+
+    public:
+        BallUpdateProtocol();
+        virtual ~BallUpdateProtocol();
+
+        virtual bool notifyEventAsynchronous(Event* event);
+        virtual void setup() {};
+        virtual void update();
+        virtual void asynchronousUpdate() {};
+};   // BallUpdateProtocol
+
+#endif // BALL_UPDATE_PROTOCOL_HPP
@@ -19,11 +19,14 @@
 #include "network/protocols/client_lobby_room_protocol.hpp"
 
 #include "config/player_manager.hpp"
+#include "config/user_config.hpp"
+#include "karts/kart_properties_manager.hpp"
 #include "modes/world_with_rank.hpp"
 #include "network/network_manager.hpp"
 #include "network/network_world.hpp"
 #include "network/protocols/start_game_protocol.hpp"
 #include "online/online_profile.hpp"
+#include "race/race_manager.hpp"
 #include "states_screens/network_kart_selection.hpp"
 #include "states_screens/state_manager.hpp"
 #include "utils/log.hpp"
@@ -60,6 +63,32 @@ void ClientLobbyRoomProtocol::requestKartSelection(std::string kart_name)
     m_listener->sendMessage(this, request, true);
 }
 
+//-----------------------------------------------------------------------------
+/** Bot clients: requests a random kart that is not taken by another player
+ *  yet. If the server refuses it (e.g. another player took it at the same
+ *  time), the next kart is requested.
+ */
+void ClientLobbyRoomProtocol::requestBotKart()
+{
+    std::vector<std::string> karts =
+        kart_properties_manager->getAllAvailableKarts();
+    if (karts.empty())
+        return;
+    const unsigned int start = rand() % karts.size();
+    for (unsigned int i = 0; i < karts.size(); i++)
+    {
+        const std::string &kart = karts[(start + i) % karts.size()];
+        if (m_setup->isKartAvailable(kart))
+        {
+            Log::info("ClientLobbyRoomProtocol", "Bot selects kart %s.",
+                      kart.c_str());
+            requestKartSelection(kart);
+            return;
+        }
+    }
+    Log::error("ClientLobbyRoomProtocol", "No kart available for the bot.");
+}   // requestBotKart
+
 //-----------------------------------------------------------------------------
 
 void ClientLobbyRoomProtocol::voteMajor(uint8_t major)
@@ -244,8 +273,20 @@ void ClientLobbyRoomProtocol::update()
         break;
     case KART_SELECTION:
     {
-        NetworkKartSelectionScreen* screen = NetworkKartSelectionScreen::getInstance();
-        screen->push();
+        if (UserConfigParams::m_bot_client)
+        {
+            // A bot has no screens, it votes and picks a kart at once
+            voteMajor(RaceManager::MAJOR_MODE_SINGLE);
+            voteRaceCount(1);
+            voteTrack(UserConfigParams::m_last_track);
+            voteLaps(UserConfigParams::m_num_laps);
+            requestBotKart();
+        }
+        else
+        {
+            NetworkKartSelectionScreen* screen = NetworkKartSelectionScreen::getInstance();
+            screen->push();
+        }
         m_state = SELECTING_KARTS;
     }
     break;
@@ -443,6 +484,9 @@ void ClientLobbyRoomProtocol::connectionRefused(Event* event)
     case 1:
         Log::info("ClientLobbyRoomProtocol", "Connection refused : banned.");
         break;
+    case 2:
+        Log::info("ClientLobbyRoomProtocol", "Connection refused : no spectators allowed.");
+        break;
     default:
         Log::info("ClientLobbyRoomProtocol", "Connection refused.");
         break;
@@ -474,6 +518,8 @@ void ClientLobbyRoomProtocol::kartSelectionRefused(Event* event)
     {
     case 0:
         Log::info("ClientLobbyRoomProtocol", "Kart selection refused : already taken.");
+        if (UserConfigParams::m_bot_client)
+            requestBotKart();
         break;
     case 1:
         Log::info("ClientLobbyRoomProtocol", "Kart selection refused : not available.");
@@ -517,7 +563,8 @@ void ClientLobbyRoomProtocol::kartSelectionUpdate(Event* event)
         Log::error("ClientLobbyRoomProtocol", "The updated kart is taken already.");
     }
     m_setup->setPlayerKart(player_id, kart_name);
-    NetworkKartSelectionScreen::getInstance()->playerSelected(player_id, kart_name);
+    if (!UserConfigParams::m_bot_client)
+        NetworkKartSelectionScreen::getInstance()->playerSelected(player_id, kart_name);
 }
 
 //-----------------------------------------------------------------------------
@@ -627,6 +674,11 @@ void ClientLobbyRoomProtocol::raceFinished(Event* event)
     else
         Log::error("ClientLobbyRoomProtocol", "No kart update protocol registered.");
 
+    // Only started in soccer mode
+    protocol = m_listener->getProtocol(PROTOCOL_BALL_UPDATE);
+    if (protocol)
+        m_listener->requestTerminate(protocol);
+
     protocol = m_listener->getProtocol(PROTOCOL_GAME_EVENTS);
     if (protocol)
         m_listener->requestTerminate(protocol);
@@ -17,6 +17,7 @@ class ClientLobbyRoomProtocol : public LobbyRoomProtocol
         void voteReversed(bool reversed, uint8_t track_nb = 0);
         void voteLaps(uint8_t laps, uint8_t track_nb = 0);
         void sendMessage(std::string message);
+        void requestBotKart();
         void leave();
 
         virtual bool notifyEvent(Event* event);
@@ -102,10 +102,11 @@ void ConnectToPeer::asynchronousUpdate()
                         host->sendRawPacket((uint8_t*)(data), 10, broadcast_address);
                         Log::info("ConnectToPeer", "Broadcast aloha to self.");
                     }
-                    else
-                    {
-                        m_current_protocol_id = m_listener->requestStart(new PingProtocol(m_peer_address, 2.0));
-                    }
+                    // Punch a hole to the public address in any case: if
+                    // the peer is not really in the same LAN (or the
+                    // broadcast is lost), the connection still succeeds
+                    // without waiting for the LAN attempt to time out.
+                    m_current_protocol_id = m_listener->requestStart(new PingProtocol(m_peer_address, 2.0));
                     m_state = CONNECTING;
                 }
                 else
@@ -119,9 +120,8 @@ void ConnectToPeer::asynchronousUpdate()
             break;
         case CONNECTED:
         {
-            // the ping protocol is there for NAT traversal (disabled when connecting to LAN peer)
-            if (m_peer_address != NetworkManager::getInstance()->getPublicAddress())
-                m_listener->requestTerminate( m_listener->getProtocol(m_current_protocol_id)); // kill the ping protocol because we're connected
+            // the ping protocol is there for NAT traversal
+            m_listener->requestTerminate( m_listener->getProtocol(m_current_protocol_id)); // kill the ping protocol because we're connected
             m_state = DONE;
             break;
         }
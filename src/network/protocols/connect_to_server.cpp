@@ -87,6 +87,7 @@ void ConnectToServer::setup()
     m_server_address.ip = 0;
     m_server_address.port = 0;
     m_current_protocol_id = 0;
+    m_server_address_protocol_id = 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -99,6 +100,11 @@ void ConnectToServer::asynchronousUpdate()
         {
             Log::info("ConnectToServer", "Protocol starting");
             m_current_protocol_id = m_listener->requestStart(new GetPublicAddress(&m_public_address));
+            // The server address does not depend on the own address, so
+            // ask the master server for it in the meantime
+            if (!m_quick_join)
+                m_server_address_protocol_id = m_listener->requestStart(
+                               new GetPeerAddress(m_host_id, &m_server_address));
             m_state = GETTING_SELF_ADDRESS;
             break;
         }
@@ -129,13 +135,12 @@ void ConnectToServer::asynchronousUpdate()
                 }
                 else
                 {
-                    m_current_protocol_id = m_listener->requestStart(new GetPeerAddress(m_host_id, &m_server_address));
                     m_state = GETTING_SERVER_ADDRESS;
                 }
             }
             break;
         case GETTING_SERVER_ADDRESS:
-            if (m_listener->getProtocolState(m_current_protocol_id)
+            if (m_listener->getProtocolState(m_server_address_protocol_id)
             == PROTOCOL_STATE_TERMINATED) // we know the server address
             {
                 Log::info("ConnectToServer", "Server's address known");
@@ -41,6 +41,9 @@ class ConnectToServer : public Protocol, public CallbackObject
         uint32_t m_server_id;
         uint32_t m_host_id;
         uint32_t m_current_protocol_id;
+        /** The protocol getting the address of the server, which runs at
+         *  the same time as the protocols for the own address. */
+        uint32_t m_server_address_protocol_id;
         bool m_quick_join;
 
         enum STATE
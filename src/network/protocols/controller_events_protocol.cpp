@@ -2,6 +2,7 @@
 
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
+#include "network/network_bit_stream.hpp"
 #include "network/network_manager.hpp"
 #include "network/network_world.hpp"
 #include "utils/log.hpp"
@@ -24,6 +25,9 @@ ControllerEventsProtocol::~ControllerEventsProtocol()
 void ControllerEventsProtocol::setup()
 {
     m_self_controller_index = 0;
+    m_next_sequence = 0;
+    m_pending_actions.clear();
+    m_sent_frames.clear();
     std::vector<AbstractKart*> karts = World::getWorld()->getKarts();
     std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
     for (unsigned int i = 0; i < karts.size(); i++)
@@ -57,72 +61,97 @@ void ControllerEventsProtocol::setup()
         }
         m_controllers.push_back(std::pair<Controller*, STKPeer*>(karts[i]->getController(), peer));
     }
+    m_last_sequences.clear();
+    m_last_sequences.resize(m_controllers.size(), -1);
 }
 
 //-----------------------------------------------------------------------------
 
+/*! \brief Receives input frames.
+ *  Format of the data :
+ *   - 4 bytes token
+ *   - followed by bit-packed data: 8 bits controller index, 2 bits number
+ *     N of frames, N frames (oldest first) each consisting of 16 bits
+ *     sequence number, 32 bits world time, varuint number M of actions and
+ *     M actions with 7 bits control state, 4 bits action and varint value.
+ *  The server relays the message to all other clients.
+ */
 bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
-    if (data.size() < 17)
+    if (event->type != EVENT_TYPE_MESSAGE)
+        return true;
+    const uint8_t *data = event->getPayload();
+    int size = event->getPayloadSize();
+    if (size < 5)
     {
-        Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", data.size());
+        Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", size);
         return true;
     }
-    uint32_t token = data.gui32();
-    NetworkString pure_message = data;
-    pure_message.removeFront(4);
+    uint32_t token = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+                   | ((uint32_t)data[2] <<  8) |  (uint32_t)data[3];
     if (token != (*event->peer)->getClientServerToken())
     {
         Log::error("ControllerEventsProtocol", "Bad token from peer.");
         return true;
     }
-    NetworkString ns = pure_message;
 
-    ns.removeFront(4);
-    uint8_t client_index = -1;
-    while (ns.size() >= 9)
+    NetworkBitReader reader(data + 4, size - 4);
+    unsigned int controller_index = reader.readBits(8);
+    unsigned int num_frames       = reader.readBits(2);
+    if (controller_index >= m_controllers.size())
     {
-        uint8_t controller_index = ns.gui8();
-        client_index = controller_index;
-        uint8_t serialized_1 = ns.gui8(1);
-        PlayerAction action  = (PlayerAction)(ns.gui8(4));
-        int action_value = ns.gui32(5);
-
-        KartControl* controls   = m_controllers[controller_index].first->getControls();
-        controls->m_brake       = (serialized_1 & 0x40)!=0;
-        controls->m_nitro       = (serialized_1 & 0x20)!=0;
-        controls->m_rescue      = (serialized_1 & 0x10)!=0;
-        controls->m_fire        = (serialized_1 & 0x08)!=0;
-        controls->m_look_back   = (serialized_1 & 0x04)!=0;
-        controls->m_skid        = KartControl::SkidControl(serialized_1 & 0x03);
-
-        m_controllers[controller_index].first->action(action, action_value);
-        ns.removeFront(9);
-        //Log::info("ControllerEventProtocol", "Registered one action.");
+        Log::warn("ControllerEventProtocol", "Invalid controller %d.",
+                  controller_index);
+        return true;
     }
-    if (ns.size() > 0 && ns.size() != 9)
+
+    // Read everything first, so that no actions of a corrupted message
+    // are applied.
+    std::vector<InputFrame> frames(num_frames);
+    for (unsigned int i = 0; i < num_frames; i++)
     {
-        Log::warn("ControllerEventProtocol", "The data seems corrupted. Remains %d", ns.size());
-        return true;
+        frames[i].m_sequence = reader.readBits(16);
+        frames[i].m_time     = reader.readFloat();
+        unsigned int num_actions = reader.readVarUInt();
+        if (reader.hasError() || num_actions > PA_COUNT*4)
+            break;
+        frames[i].m_actions.resize(num_actions);
+        for (unsigned int j = 0; j < num_actions; j++)
+        {
+            ControllerAction &a = frames[i].m_actions[j];
+            a.m_controls = reader.readBits(7);
+            a.m_action   = reader.readBits(4);
+            a.m_value    = reader.readVarInt();
+        }
     }
-    if (client_index < 0)
+    if (reader.hasError())
     {
-        Log::warn("ControllerEventProtocol", "Couldn't have a client id.");
+        Log::warn("ControllerEventProtocol", "The data seems corrupted.");
         return true;
     }
+
+    for (unsigned int i = 0; i < frames.size(); i++)
+    {
+        int last = m_last_sequences[controller_index];
+        if (last >= 0 && (int16_t)(frames[i].m_sequence - last) <= 0)
+            continue;   // already applied
+        for (unsigned int j = 0; j < frames[i].m_actions.size(); j++)
+            applyAction(controller_index, frames[i].m_actions[j]);
+        m_last_sequences[controller_index] = frames[i].m_sequence;
+    }
+
     if (m_listener->isServer())
     {
         // notify everybody of the event :
+        NetworkString pure_message(data + 4, size - 4);
         for (unsigned int i = 0; i < m_controllers.size(); i++)
         {
-            if (i == client_index) // don't send that message to the sender
+            if (i == controller_index) // don't send that message to the sender
                 continue;
             NetworkString ns2;
             ns2.ai32(m_controllers[i].second->getClientServerToken());
             ns2 += pure_message;
             m_listener->sendMessage(this, m_controllers[i].second, ns2, false);
-            //Log::info("ControllerEventsProtocol", "Sizes are %d and %d", ns2.size(), pure_message.size());
         }
     }
     return true;
@@ -130,12 +159,76 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 
 //-----------------------------------------------------------------------------
 
+/** Applies one received action to the given controller. */
+void ControllerEventsProtocol::applyAction(unsigned int controller_index,
+                                           const ControllerAction &action)
+{
+    if (action.m_action >= PA_COUNT)
+        return;
+    uint8_t serialized_1  = action.m_controls;
+    KartControl* controls = m_controllers[controller_index].first->getControls();
+    controls->m_brake     = (serialized_1 & 0x40)!=0;
+    controls->m_nitro     = (serialized_1 & 0x20)!=0;
+    controls->m_rescue    = (serialized_1 & 0x10)!=0;
+    controls->m_fire      = (serialized_1 & 0x08)!=0;
+    controls->m_look_back = (serialized_1 & 0x04)!=0;
+    controls->m_skid      = KartControl::SkidControl(serialized_1 & 0x03);
+
+    m_controllers[controller_index].first->action((PlayerAction)action.m_action,
+                                                  action.m_value);
+}   // applyAction
+
+//-----------------------------------------------------------------------------
+
+/** Sends all actions of this frame (if any) as one input frame. */
 void ControllerEventsProtocol::update()
 {
+    if (m_listener->isServer() || m_pending_actions.empty())
+        return;
+    sendInputFrames();
 }
 
 //-----------------------------------------------------------------------------
 
+/** Creates a new input frame from the pending actions and sends it,
+ *  together with the previous frames, unreliably to the server. */
+void ControllerEventsProtocol::sendInputFrames()
+{
+    InputFrame frame;
+    frame.m_sequence = m_next_sequence++;
+    frame.m_time     = World::getWorld()->getTime();
+    frame.m_actions.swap(m_pending_actions);
+    m_sent_frames.push_back(frame);
+    while (m_sent_frames.size() > INPUT_REDUNDANCY)
+        m_sent_frames.pop_front();
+
+    NetworkString ns;
+    ns.ai32(m_controllers[m_self_controller_index].second->getClientServerToken());
+    {
+        NetworkBitWriter writer(&ns);
+        writer.writeBits(m_self_controller_index, 8);
+        writer.writeBits((uint32_t)m_sent_frames.size(), 2);
+        for (unsigned int i = 0; i < m_sent_frames.size(); i++)
+        {
+            const InputFrame &f = m_sent_frames[i];
+            writer.writeBits(f.m_sequence, 16).writeFloat(f.m_time);
+            writer.writeVarUInt((uint32_t)f.m_actions.size());
+            for (unsigned int j = 0; j < f.m_actions.size(); j++)
+            {
+                const ControllerAction &a = f.m_actions[j];
+                writer.writeBits(a.m_controls, 7).writeBits(a.m_action, 4);
+                writer.writeVarInt(a.m_value);
+            }
+        }
+    }
+    m_listener->sendMessage(this, ns, false); // send message to server
+}   // sendInputFrames
+
+//-----------------------------------------------------------------------------
+
+/** Called on the client when the local player changes a control. The
+ *  action is only queued, all actions of one frame are sent together in
+ *  update(). */
 void ControllerEventsProtocol::controllerAction(Controller* controller,
         PlayerAction action, int value)
 {
@@ -154,18 +247,10 @@ void ControllerEventsProtocol::controllerAction(Controller* controller,
     serialized_1 |= (controls->m_look_back==true);
     serialized_1 <<= 2;
     serialized_1 += controls->m_skid;
-    uint8_t serialized_2 = (uint8_t)(controls->m_accel*255.0);
-    uint8_t serialized_3 = (uint8_t)(controls->m_steer*127.0);
-
-    NetworkString ns;
-    ns.ai32(m_controllers[m_self_controller_index].second->getClientServerToken());
-    ns.af(World::getWorld()->getTime());
-    ns.ai8(m_self_controller_index);
-    ns.ai8(serialized_1).ai8(serialized_2).ai8(serialized_3);
-    ns.ai8((uint8_t)(action)).ai32(value);
 
-    Log::info("ControllerEventsProtocol", "Action %d value %d", action, value);
-    m_listener->sendMessage(this, ns, false); // send message to server
+    ControllerAction a;
+    a.m_controls = serialized_1;
+    a.m_action   = (uint8_t)action;
+    a.m_value    = value;
+    m_pending_actions.push_back(a);
 }
-
-
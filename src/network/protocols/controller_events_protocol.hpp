@@ -6,12 +6,58 @@
 #include "input/input.hpp"
 #include "karts/controller/controller.hpp"
 
+#include <deque>
+
+/** \brief Sends the input of the local player to the server, which relays
+ *  it to all other clients.
+ *  All actions of one frame are batched into one input frame. Each message
+ *  contains the newest INPUT_REDUNDANCY frames, so that a lost (unreliable)
+ *  packet is covered by the next one. The receiver uses the sequence number
+ *  of each frame to ignore frames that were already applied.
+ */
 class ControllerEventsProtocol : public Protocol
 {
     protected:
+        /** Number of input frames sent in each message. */
+        enum { INPUT_REDUNDANCY = 3 };
+
+        /** One action of a player, together with the state of the digital
+         *  controls at that time. */
+        struct ControllerAction
+        {
+            uint8_t m_controls;
+            uint8_t m_action;
+            int32_t m_value;
+        };   // ControllerAction
+
+        /** All actions of a player during one frame. */
+        struct InputFrame
+        {
+            uint16_t m_sequence;
+            float    m_time;
+            std::vector<ControllerAction> m_actions;
+        };   // InputFrame
+
         std::vector<std::pair<Controller*, STKPeer*> > m_controllers;
         uint32_t m_self_controller_index;
 
+        /** Client: actions that have not been sent yet. */
+        std::vector<ControllerAction> m_pending_actions;
+
+        /** Client: the last sent frames, newest at the back. */
+        std::deque<InputFrame> m_sent_frames;
+
+        /** Client: sequence number of the next input frame. */
+        uint16_t m_next_sequence;
+
+        /** Sequence number of the last applied frame of each controller,
+         *  or -1 if no frame was received yet. */
+        std::vector<int> m_last_sequences;
+
+        void sendInputFrames();
+        void applyAction(unsigned int controller_index,
+                         const ControllerAction &action);
+
     public:
         ControllerEventsProtocol();
         virtual ~ControllerEventsProtocol();
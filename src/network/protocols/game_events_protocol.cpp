@@ -6,11 +6,34 @@
 #include "items/item_manager.hpp"
 #include "items/powerup.hpp"
 #include "modes/world.hpp"
+#include "network/network_bit_stream.hpp"
 #include "network/network_manager.hpp"
+#include "network/protocol_manager.hpp"
+#include "network/protocols/kart_update_protocol.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
 #include <stdint.h>
 
+/* The events (at this stage only collected items) are not sent one by one
+ * with reliable messages anymore. Instead all events of a server tick are
+ * sent together, tagged with the world time they happened at, with an
+ * unreliable message. Each message contains all events the peer has not
+ * acknowledged yet, so lost messages are repaired by the next one. The
+ * client acknowledges the events with a small unreliable message as well,
+ * and applies them when the remote karts are displayed at the time of the
+ * event (see KartUpdateProtocol::getDisplayTime()).
+ * Messages (after the token, bit-packed):
+ *   server -> client: 4 bits 0x02, var first serial, var count, then for
+ *                     each event: float time, 4 bits event type (0x01: item
+ *                     collected), var item id, 8 bits powerup, var kart id.
+ *   client -> server: 4 bits 0x03, var serial of the next expected event.
+ */
+
 GameEventsProtocol::GameEventsProtocol() : Protocol(NULL, PROTOCOL_GAME_EVENTS)
 {
+    m_next_serial = 0;
+    m_ack_needed  = false;
 }
 
 GameEventsProtocol::~GameEventsProtocol()
@@ -21,75 +44,225 @@ bool GameEventsProtocol::notifyEvent(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString data = event->data();
-    if (data.size() < 5) // for token and type
+    // Read directly from the packet, the data is not copied.
+    const uint8_t *data = event->getPayload();
+    if (event->getPayloadSize() < 5) // for token and type
     {
         Log::warn("GameEventsProtocol", "Too short message.");
         return true;
     }
-    if ( (*event->peer)->getClientServerToken() != data.gui32())
+    uint32_t token = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+                   | ((uint32_t)data[2] <<  8) |  (uint32_t)data[3];
+    if ( (*event->peer)->getClientServerToken() != token)
     {
         Log::warn("GameEventsProtocol", "Bad token.");
         return true;
     }
-    int8_t type = data.gui8(4);
-    data.removeFront(5);
-    switch (type)
+    receiveEvents(*event->peer, data + 4, event->getPayloadSize() - 4);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+/** Reads a message with events (on the client) or an acknowledgement (on the
+ *  server).
+ *  \param peer The peer that sent the message.
+ *  \param data The bit-packed data following the token.
+ *  \param size Size of the data in bytes.
+ */
+void GameEventsProtocol::receiveEvents(STKPeer* peer, const uint8_t* data,
+                                       int size)
+{
+    NetworkBitReader reader(data, size);
+    uint32_t type = reader.readBits(4);
+    if (type == 0x03 && m_listener->isServer())
     {
-        case 0x01: // item picked
+        uint32_t serial = reader.readVarUInt();
+        if (reader.hasError())
         {
-            if (data.size() < 6)
-            {
-                Log::warn("GameEventsProtocol", "Too short message.");
-                return true;
-            }
-            uint32_t item_id = data.gui32();
-            uint8_t powerup_type = data.gui8(4);
-            uint8_t kart_race_id = data.gui8(5);
-            // now set the kart powerup
-            AbstractKart* kart = World::getWorld()->getKart(
-                NetworkManager::getInstance()->getGameSetup()->getProfile(kart_race_id)->world_kart_id);
-            ItemManager::get()->collectedItem(
-                ItemManager::get()->getItem(item_id),
-                kart,
-                powerup_type);
-            Log::info("GameEventsProtocol", "Item %d picked by a player.", powerup_type);
-        }   break;
-        default:
-            Log::warn("GameEventsProtocol", "Unkown message type.");
-            break;
+            Log::warn("GameEventsProtocol", "Too short message.");
+            return;
+        }
+        // Acks are unreliable, so an old one might arrive late
+        uint32_t &acked = m_acked_serials[peer];
+        if (serial > acked && serial <= m_next_serial)
+            acked = serial;
+        return;
     }
-    return true;
-}
+    if (type != 0x02 || m_listener->isServer())
+    {
+        Log::warn("GameEventsProtocol", "Unkown message type.");
+        return;
+    }
+
+    uint32_t serial = reader.readVarUInt();
+    uint32_t count  = reader.readVarUInt();
+    for (uint32_t i = 0; i < count; i++, serial++)
+    {
+        ItemEvent event;
+        event.m_serial = serial;
+        event.m_time   = reader.readFloat();
+        uint32_t event_type  = reader.readBits(4);
+        event.m_item_id      = reader.readVarUInt();
+        event.m_powerup      = reader.readBits(8);
+        event.m_kart_race_id = reader.readVarUInt();
+        if (reader.hasError() || event_type != 0x01)
+        {
+            Log::warn("GameEventsProtocol", "Invalid events message.");
+            return;
+        }
+        // Each message repeats the events that might not have arrived, so
+        // only keep the ones not received before
+        if (serial != m_next_serial)
+            continue;
+        m_events.push_back(event);
+        m_next_serial++;
+    }
+    m_ack_needed = true;
+}   // receiveEvents
+
+// ----------------------------------------------------------------------------
 
 void GameEventsProtocol::setup()
 {
 }
 
+// ----------------------------------------------------------------------------
+/** Called once per frame (on the server once per tick): the server sends
+ *  the events of this tick, the client applies the events that are due and
+ *  acknowledges the received ones.
+ */
 void GameEventsProtocol::update()
 {
-}
+    if (m_listener->isServer())
+    {
+        sendEvents();
+        return;
+    }
+    applyEvents();
+    if (m_ack_needed)
+    {
+        std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+        if (peers.size() > 0)
+        {
+            NetworkString ns;
+            ns.ai32(peers[0]->getClientServerToken());
+            NetworkBitWriter writer(&ns);
+            writer.writeBits(0x03, 4).writeVarUInt(m_next_serial);
+            writer.flush();
+            m_listener->sendMessage(this, ns, false); // unreliable
+        }
+        m_ack_needed = false;
+    }
+}   // update
 
-void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
+// ----------------------------------------------------------------------------
+/** Server: sends every peer the events it has not acknowledged yet, and
+ *  forgets the events all peers have acknowledged.
+ */
+void GameEventsProtocol::sendEvents()
 {
-    GameSetup* setup = NetworkManager::getInstance()->getGameSetup();
-    assert(setup);
-    const NetworkPlayerProfile* player_profile = setup->getProfile(kart->getIdent()); // use kart name
-
     std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    uint32_t oldest_needed = m_next_serial;
+    // Rebuild the map so that peers that left are removed
+    std::map<STKPeer*, uint32_t> acked_serials;
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        std::map<STKPeer*, uint32_t>::iterator it =
+            m_acked_serials.find(peers[i]);
+        // A new peer only needs the events from now on
+        uint32_t acked = it == m_acked_serials.end() ? m_next_serial
+                                                     : it->second;
+        acked_serials[peers[i]] = acked;
+        oldest_needed = std::min(oldest_needed, acked);
+    }
+    m_acked_serials.swap(acked_serials);
+    while (!m_events.empty() && m_events.front().m_serial < oldest_needed)
+        m_events.pop_front();
+    if (m_events.empty())
+        return;
+
+    const uint32_t first_serial = m_events.front().m_serial;
     for (unsigned int i = 0; i < peers.size(); i++)
     {
+        const uint32_t acked = m_acked_serials[peers[i]];
+        if (acked >= m_next_serial)
+            continue;
+        const uint32_t count = std::min(m_next_serial - acked,
+                                        (uint32_t)MAX_EVENTS_PER_MESSAGE);
         NetworkString ns;
         ns.ai32(peers[i]->getClientServerToken());
-        // 0x01 : item picked : send item id, powerup type and kart race id
-        uint8_t powerup = 0;
-        if (item->getType() == Item::ITEM_BANANA)
-            powerup = (int)(kart->getAttachment()->getType());
-        else if (item->getType() == Item::ITEM_BONUS_BOX)
-            powerup = (((int)(kart->getPowerup()->getType()) << 4)&0xf0) + (kart->getPowerup()->getNum()&0x0f);
-
-        ns.ai8(0x01).ai32(item->getItemId()).ai8(powerup).ai8(player_profile->race_id); // send item,
-        m_listener->sendMessage(this, peers[i], ns, true); // reliable
-        Log::info("GameEventsProtocol", "Notified a peer that a kart collected item %d.", (int)(kart->getPowerup()->getType()));
+        NetworkBitWriter writer(&ns);
+        writer.writeBits(0x02, 4).writeVarUInt(acked).writeVarUInt(count);
+        for (uint32_t j = 0; j < count; j++)
+        {
+            const ItemEvent &event = m_events[acked - first_serial + j];
+            writer.writeFloat(event.m_time).writeBits(0x01, 4)
+                  .writeVarUInt(event.m_item_id).writeBits(event.m_powerup, 8)
+                  .writeVarUInt(event.m_kart_race_id);
+        }
+        writer.flush();
+        m_listener->sendMessage(this, peers[i], ns, false); // unreliable
     }
-}
+}   // sendEvents
+
+// ----------------------------------------------------------------------------
+/** Client: applies all received events whose time has come on the timeline
+ *  the remote karts are displayed on.
+ */
+void GameEventsProtocol::applyEvents()
+{
+    const KartUpdateProtocol *kart_update = static_cast<KartUpdateProtocol*>(
+        ProtocolManager::getInstance()->getProtocol(PROTOCOL_KART_UPDATE));
+    while (!m_events.empty())
+    {
+        if (kart_update &&
+            m_events.front().m_time > kart_update->getDisplayTime())
+            break;
+        applyEvent(m_events.front());
+        m_events.pop_front();
+    }
+}   // applyEvents
+
+// ----------------------------------------------------------------------------
+/** Client: applies one event.
+ *  \param event The event.
+ */
+void GameEventsProtocol::applyEvent(const ItemEvent& event)
+{
+    // now set the kart powerup
+    AbstractKart* kart = World::getWorld()->getKart(
+        NetworkManager::getInstance()->getGameSetup()
+                            ->getProfile(event.m_kart_race_id)->world_kart_id);
+    ItemManager::get()->collectedItem(
+        ItemManager::get()->getItem(event.m_item_id),
+        kart,
+        event.m_powerup);
+    Log::info("GameEventsProtocol", "Item %d picked by a player.", event.m_powerup);
+}   // applyEvent
+
+// ----------------------------------------------------------------------------
+/** Server: queues an item collected by a kart, it is sent to all peers in
+ *  the next update.
+ */
+void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
+{
+    GameSetup* setup = NetworkManager::getInstance()->getGameSetup();
+    assert(setup);
+    const NetworkPlayerProfile* player_profile = setup->getProfile(kart->getIdent()); // use kart name
+
+    // send item id, powerup type and kart race id
+    uint8_t powerup = 0;
+    if (item->getType() == Item::ITEM_BANANA)
+        powerup = (int)(kart->getAttachment()->getType());
+    else if (item->getType() == Item::ITEM_BONUS_BOX)
+        powerup = (((int)(kart->getPowerup()->getType()) << 4)&0xf0) + (kart->getPowerup()->getNum()&0x0f);
+
+    ItemEvent event;
+    event.m_serial       = m_next_serial++;
+    event.m_time         = World::getWorld()->getTime();
+    event.m_item_id      = item->getItemId();
+    event.m_powerup      = powerup;
+    event.m_kart_race_id = player_profile->race_id;
+    m_events.push_back(event);
+    Log::info("GameEventsProtocol", "A kart collected item %d.", (int)(kart->getPowerup()->getType()));
+}   // collectedItem
@@ -3,8 +3,12 @@
 
 #include "network/protocol.hpp"
 
+#include <deque>
+#include <map>
+
 class AbstractKart;
 class Item;
+class STKPeer;
 
 class GameEventsProtocol : public Protocol
 {
@@ -21,6 +25,39 @@ class GameEventsProtocol : public Protocol
         void collectedItem(Item* item, AbstractKart* kart);
 
     protected:
+        /** Maximum number of events sent in one message. */
+        static const unsigned int MAX_EVENTS_PER_MESSAGE = 16;
+
+        /** An item collected by a kart. */
+        struct ItemEvent
+        {
+            /** Number of the event, increased by one for each event. */
+            uint32_t m_serial;
+            /** Server world time at which the item was collected. */
+            float    m_time;
+            uint32_t m_item_id;
+            uint8_t  m_powerup;
+            uint32_t m_kart_race_id;
+        };   // ItemEvent
+
+        void sendEvents();
+        void receiveEvents(STKPeer* peer, const uint8_t* data, int size);
+        void applyEvents();
+        void applyEvent(const ItemEvent& event);
+
+        /** Server: all events not yet acknowledged by every peer, and
+         *  client: the received events that are not applied yet. Both are
+         *  sorted by serial number. */
+        std::deque<ItemEvent> m_events;
+        /** Server: serial number of the next event. Client: serial number
+         *  of the next event expected from the server. */
+        uint32_t m_next_serial;
+        /** Server: for each peer the serial number of the oldest event it
+         *  has not acknowledged yet. */
+        std::map<STKPeer*, uint32_t> m_acked_serials;
+        /** Client: true if events were received since the last
+         *  acknowledgement was sent. */
+        bool m_ack_needed;
 };
 
 #endif // GAME_EVENTS_PROTOCOL_HPP
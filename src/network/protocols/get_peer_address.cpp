@@ -51,7 +51,11 @@ void GetPeerAddress::asynchronousUpdate()
         Online::RequestManager::get()->addRequest(m_request);
         m_state = REQUEST_PENDING;
     }
-    else if (m_state == REQUEST_PENDING && m_request->isDone())
+    // The port to use depends on whether the peer has the same public
+    // address, so wait for that if this protocol was started while the own
+    // public address is still being determined
+    else if (m_state == REQUEST_PENDING && m_request->isDone() &&
+             NetworkManager::getInstance()->getPublicAddress().ip != 0)
     {
         const XMLNode * result = m_request->getXMLData();
         std::string rec_success;
@@ -26,7 +26,9 @@
 
 #include "utils/log.hpp"
 #include "utils/random_generator.hpp"
+#include "utils/time.hpp"
 
+#include <algorithm>
 #include <assert.h>
 
 #ifdef __MINGW32__
@@ -55,12 +57,19 @@ int stunRand()
     return rand();
 }
 
+/** Number of STUN servers that are asked at the same time. */
+static const unsigned int STUN_PARALLEL_QUERIES = 3;
+/** Time (in seconds) to wait for an answer before asking other servers. */
+static const double STUN_TIMEOUT = 1.0;
+
 GetPublicAddress::GetPublicAddress(CallbackObject* callback_object) : Protocol(callback_object, PROTOCOL_SILENT)
 {
+    m_transaction_host = NULL;
 }
 
 GetPublicAddress::~GetPublicAddress()
 {
+    delete m_transaction_host;
 }
 
 void GetPublicAddress::setup()
@@ -68,180 +77,203 @@ void GetPublicAddress::setup()
     m_state = NOTHING_DONE;
 }
 
-void GetPublicAddress::asynchronousUpdate()
+// ----------------------------------------------------------------------------
+/** Sends a binding request to several randomly chosen STUN servers at the
+ *  same time. The first valid answer is used, so one slow or unreachable
+ *  server does not delay the connection.
+ */
+void GetPublicAddress::sendStunRequests()
 {
-    if (m_state == NOTHING_DONE)
+    // format :               00MMMMMCMMMCMMMM (cf rfc 5389)
+    uint16_t message_type = 0x0001; // binding request
+    m_stun_tansaction_id[0] = stunRand();
+    m_stun_tansaction_id[1] = stunRand();
+    m_stun_tansaction_id[2] = stunRand();
+    uint16_t message_length = 0x0000;
+
+    uint8_t bytes[21]; // the message to be sent
+    // bytes 0-1 : the type of the message,
+    bytes[0] = (uint8_t)(message_type>>8);
+    bytes[1] = (uint8_t)(message_type);
+
+    // bytes 2-3 : message length added to header (attributes)
+    bytes[2] = (uint8_t)(message_length>>8);
+    bytes[3] = (uint8_t)(message_length);
+
+    // bytes 4-7 : magic cookie to recognize the stun protocol
+    bytes[4] = (uint8_t)(m_stun_magic_cookie>>24);
+    bytes[5] = (uint8_t)(m_stun_magic_cookie>>16);
+    bytes[6] = (uint8_t)(m_stun_magic_cookie>>8);
+    bytes[7] = (uint8_t)(m_stun_magic_cookie);
+
+    // bytes 8-19 : the transaction id
+    for (unsigned int i = 0; i < 3; i++)
     {
-        // format :               00MMMMMCMMMCMMMM (cf rfc 5389)
-        uint16_t message_type = 0x0001; // binding request
-        m_stun_tansaction_id[0] = stunRand();
-        m_stun_tansaction_id[1] = stunRand();
-        m_stun_tansaction_id[2] = stunRand();
-        uint16_t message_length = 0x0000;
-
-        uint8_t bytes[21]; // the message to be sent
-        // bytes 0-1 : the type of the message,
-        bytes[0] = (uint8_t)(message_type>>8);
-        bytes[1] = (uint8_t)(message_type);
-
-        // bytes 2-3 : message length added to header (attributes)
-        bytes[2] = (uint8_t)(message_length>>8);
-        bytes[3] = (uint8_t)(message_length);
-
-        // bytes 4-7 : magic cookie to recognize the stun protocol
-        bytes[4] = (uint8_t)(m_stun_magic_cookie>>24);
-        bytes[5] = (uint8_t)(m_stun_magic_cookie>>16);
-        bytes[6] = (uint8_t)(m_stun_magic_cookie>>8);
-        bytes[7] = (uint8_t)(m_stun_magic_cookie);
-
-        // bytes 8-19 : the transaction id
-        bytes[8] = (uint8_t)(m_stun_tansaction_id[0]>>24);
-        bytes[9] = (uint8_t)(m_stun_tansaction_id[0]>>16);
-        bytes[10] = (uint8_t)(m_stun_tansaction_id[0]>>8);
-        bytes[11] = (uint8_t)(m_stun_tansaction_id[0]);
-        bytes[12] = (uint8_t)(m_stun_tansaction_id[1]>>24);
-        bytes[13] = (uint8_t)(m_stun_tansaction_id[1]>>16);
-        bytes[14] = (uint8_t)(m_stun_tansaction_id[1]>>8);
-        bytes[15] = (uint8_t)(m_stun_tansaction_id[1]);
-        bytes[16] = (uint8_t)(m_stun_tansaction_id[2]>>24);
-        bytes[17] = (uint8_t)(m_stun_tansaction_id[2]>>16);
-        bytes[18] = (uint8_t)(m_stun_tansaction_id[2]>>8);
-        bytes[19] = (uint8_t)(m_stun_tansaction_id[2]);
-        bytes[20] = '\0';
-
-        // time to pick a random stun server
-        std::vector<std::string> stun_servers = UserConfigParams::m_stun_servers;
-
-        RandomGenerator random_gen;
-        int rand_result = random_gen.get((int)stun_servers.size());
-        Log::verbose("GetPublicAddress", "Using STUN server %s",
-                     stun_servers[rand_result].c_str());
+        bytes[ 8 + 4*i] = (uint8_t)(m_stun_tansaction_id[i]>>24);
+        bytes[ 9 + 4*i] = (uint8_t)(m_stun_tansaction_id[i]>>16);
+        bytes[10 + 4*i] = (uint8_t)(m_stun_tansaction_id[i]>>8);
+        bytes[11 + 4*i] = (uint8_t)(m_stun_tansaction_id[i]);
+    }
+    bytes[20] = '\0';
 
-        // resolve the name into an IP address
-        struct addrinfo hints, *res, *p;
-        int status;
+    // One host is used for all requests, so all answers arrive on the
+    // same socket
+    if (!m_transaction_host)
+    {
+        m_transaction_host = new STKHost();
+        m_transaction_host->setupClient(1,1,0,0);
+    }
 
+    // pick random stun servers
+    std::vector<std::string> stun_servers = UserConfigParams::m_stun_servers;
+    RandomGenerator random_gen;
+    m_stun_servers_ip.clear();
+    const unsigned int count = std::min((unsigned int)stun_servers.size(),
+                                        STUN_PARALLEL_QUERIES);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const int index = random_gen.get((int)stun_servers.size());
+        const std::string server = stun_servers[index];
+        stun_servers.erase(stun_servers.begin() + index);
+        Log::verbose("GetPublicAddress", "Using STUN server %s", server.c_str());
+
+        // resolve the name into an IP address
+        struct addrinfo hints, *res;
         memset(&hints, 0, sizeof hints);
-        hints.ai_family = AF_UNSPEC; // AF_INET or AF_INET6 to force version
+        hints.ai_family = AF_INET; // the answer is only parsed for IPv4
         hints.ai_socktype = SOCK_STREAM;
 
-        if ((status = getaddrinfo(stun_servers[rand_result].c_str(), NULL, &hints, &res)) != 0) {
+        int status = getaddrinfo(server.c_str(), NULL, &hints, &res);
+        if (status != 0)
+        {
             Log::error("getaddrinfo", gai_strerror(status));
-            return;
+            continue;
         }
-        for(p = res;p != NULL; p = p->ai_next)
+        if (res)
         {
-            struct sockaddr_in* current_interface = (struct sockaddr_in*)(p->ai_addr);
-
-            m_stun_server_ip = ntohl(current_interface->sin_addr.s_addr);
-            m_transaction_host = new STKHost();
-            m_transaction_host->setupClient(1,1,0,0);
-            m_transaction_host->sendRawPacket(bytes, 20, TransportAddress(m_stun_server_ip, 3478));
-            m_state = TEST_SENT;
-
-            freeaddrinfo(res); // free the linked list
-            return;
+            struct sockaddr_in* current_interface = (struct sockaddr_in*)(res->ai_addr);
+            const uint32_t ip = ntohl(current_interface->sin_addr.s_addr);
+            m_stun_servers_ip.push_back(ip);
+            m_transaction_host->sendRawPacket(bytes, 20, TransportAddress(ip, 3478));
         }
         freeaddrinfo(res); // free the linked list
+    }
+    m_request_time = StkTime::getRealTime();
+}   // sendStunRequests
+
+// ----------------------------------------------------------------------------
+/** Parses the answer of a STUN server.
+ *  \param data The packet received.
+ *  \return True if the answer was valid, the address is then stored in the
+ *          callback object.
+ */
+bool GetPublicAddress::parseStunResponse(const uint8_t* data)
+{
+    // check that the stun response is a response, contains the magic cookie and the transaction ID
+    if (    data[0] != 0x01 ||
+            data[1] != 0x01 ||
+            data[4] !=  (uint8_t)(m_stun_magic_cookie>>24)        ||
+            data[5] !=  (uint8_t)(m_stun_magic_cookie>>16)        ||
+            data[6] !=  (uint8_t)(m_stun_magic_cookie>>8)         ||
+            data[7] !=  (uint8_t)(m_stun_magic_cookie)               )
+        return false;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        if (data[ 8 + 4*i] != (uint8_t)(m_stun_tansaction_id[i]>>24) ||
+            data[ 9 + 4*i] != (uint8_t)(m_stun_tansaction_id[i]>>16) ||
+            data[10 + 4*i] != (uint8_t)(m_stun_tansaction_id[i]>>8 ) ||
+            data[11 + 4*i] != (uint8_t)(m_stun_tansaction_id[i]    )   )
+            return false;
+    }
+
+    Log::verbose("GetPublicAddress", "The STUN server responded with a valid answer");
+    int message_size = data[2]*256+data[3];
 
+    // parse the stun message now:
+    bool finish = false;
+    const uint8_t* attributes = data+20;
+    if (message_size == 0)
+    {
+        Log::error("GetPublicAddress", "STUN answer does not contain any information.");
+        finish = true;
     }
-    if (m_state == TEST_SENT)
+    if (message_size < 4) // cannot even read the size
     {
-        uint8_t* data = m_transaction_host->receiveRawPacket(TransportAddress(m_stun_server_ip, 3478), 2000);
-        if (!data)
+        Log::error("GetPublicAddress", "STUN message is not valid.");
+        finish = true;
+    }
+    uint16_t port;
+    uint32_t address;
+    bool valid = false;
+    while(!finish)
+    {
+        int type = attributes[0]*256+attributes[1];
+        int size = attributes[2]*256+attributes[3];
+        switch(type)
+        {
+            case 0:
+            case 1:
+                assert(size == 8);
+                assert(attributes[5] == 0x01); // IPv4 only
+                port = attributes[6]*256+attributes[7];
+                address = (attributes[8]<<24 & 0xFF000000)+(attributes[9]<<16 & 0x00FF0000)+(attributes[10]<<8 & 0x0000FF00)+(attributes[11] & 0x000000FF);
+                finish = true;
+                valid = true;
+                continue;
+                break;
+            default:
+                break;
+        }
+        attributes = attributes + 4 + size;
+        message_size -= 4 + size;
+        if (message_size == 0)
+            finish = true;
+        if (message_size < 4) // cannot even read the size
         {
-            m_state = NOTHING_DONE; // will send the test again to an other server
-            return;
+            Log::error("GetPublicAddress", "STUN message is not valid.");
+            finish = true;
         }
-        assert(data);
-
-        // check that the stun response is a response, contains the magic cookie and the transaction ID
-        if (    data[0] == 0x01 &&
-                data[1] == 0x01 &&
-                data[4] ==  (uint8_t)(m_stun_magic_cookie>>24)        &&
-                data[5] ==  (uint8_t)(m_stun_magic_cookie>>16)        &&
-                data[6] ==  (uint8_t)(m_stun_magic_cookie>>8)         &&
-                data[7] ==  (uint8_t)(m_stun_magic_cookie)               )
+    }
+    // finished parsing, we know our public transport address
+    if (!valid)
+        return false;
+
+    Log::debug("GetPublicAddress", "The public address has been found : %i.%i.%i.%i:%i", address>>24&0xff, address>>16&0xff, address>>8&0xff, address&0xff, port);
+    TransportAddress* addr = static_cast<TransportAddress*>(m_callback_object);
+    addr->ip = address;
+    addr->port = port;
+    return true;
+}   // parseStunResponse
+
+// ----------------------------------------------------------------------------
+
+void GetPublicAddress::asynchronousUpdate()
+{
+    if (m_state == NOTHING_DONE)
+    {
+        sendStunRequests();
+        if (!m_stun_servers_ip.empty())
+            m_state = TEST_SENT;
+        return;
+    }
+    if (m_state == TEST_SENT)
+    {
+        // Only wait shortly, so that the other protocols are not blocked
+        TransportAddress sender;
+        uint8_t* data = m_transaction_host->receiveRawPacket(&sender, 10);
+        if (data)
         {
-            if(
-                data[8] ==  (uint8_t)(m_stun_tansaction_id[0]>>24)   &&
-                data[9] ==  (uint8_t)(m_stun_tansaction_id[0]>>16)   &&
-                data[10] == (uint8_t)(m_stun_tansaction_id[0]>>8 )   &&
-                data[11] == (uint8_t)(m_stun_tansaction_id[0]    )   &&
-                data[12] == (uint8_t)(m_stun_tansaction_id[1]>>24)   &&
-                data[13] == (uint8_t)(m_stun_tansaction_id[1]>>16)   &&
-                data[14] == (uint8_t)(m_stun_tansaction_id[1]>>8 )   &&
-                data[15] == (uint8_t)(m_stun_tansaction_id[1]    )   &&
-                data[16] == (uint8_t)(m_stun_tansaction_id[2]>>24)   &&
-                data[17] == (uint8_t)(m_stun_tansaction_id[2]>>16)   &&
-                data[18] == (uint8_t)(m_stun_tansaction_id[2]>>8 )   &&
-                data[19] == (uint8_t)(m_stun_tansaction_id[2]    ))
-            {
-                Log::verbose("GetPublicAddress", "The STUN server responded with a valid answer");
-                int message_size = data[2]*256+data[3];
-
-                // parse the stun message now:
-                bool finish = false;
-                uint8_t* attributes = data+20;
-                if (message_size == 0)
-                {
-                    Log::error("GetPublicAddress", "STUN answer does not contain any information.");
-                    finish = true;
-                }
-                if (message_size < 4) // cannot even read the size
-                {
-                    Log::error("GetPublicAddress", "STUN message is not valid.");
-                    finish = true;
-                }
-                uint16_t port;
-                uint32_t address;
-                bool valid = false;
-                while(!finish)
-                {
-                    int type = attributes[0]*256+attributes[1];
-                    int size = attributes[2]*256+attributes[3];
-                    switch(type)
-                    {
-                        case 0:
-                        case 1:
-                            assert(size == 8);
-                            assert(attributes[5] == 0x01); // IPv4 only
-                            port = attributes[6]*256+attributes[7];
-                            address = (attributes[8]<<24 & 0xFF000000)+(attributes[9]<<16 & 0x00FF0000)+(attributes[10]<<8 & 0x0000FF00)+(attributes[11] & 0x000000FF);
-                            finish = true;
-                            valid = true;
-                            continue;
-                            break;
-                        default:
-                            break;
-                    }
-                    attributes = attributes + 4 + size;
-                    message_size -= 4 + size;
-                    if (message_size == 0)
-                        finish = true;
-                    if (message_size < 4) // cannot even read the size
-                    {
-                        Log::error("GetPublicAddress", "STUN message is not valid.");
-                        finish = true;
-                    }
-                }
-                // finished parsing, we know our public transport address
-                if (valid)
-                {
-                    Log::debug("GetPublicAddress", "The public address has been found : %i.%i.%i.%i:%i", address>>24&0xff, address>>16&0xff, address>>8&0xff, address&0xff, port);
-                    m_state = ADDRESS_KNOWN;
-                    TransportAddress* addr = static_cast<TransportAddress*>(m_callback_object);
-                    addr->ip = address;
-                    addr->port = port;
-                }
-                else
-                    m_state = NOTHING_DONE; // need to re-send the stun request
-            }
-            else
-            {
-                m_state = NOTHING_DONE; // need to re-send the stun request
-            }
+            bool from_server = false;
+            for (unsigned int i = 0; i < m_stun_servers_ip.size(); i++)
+                from_server |= m_stun_servers_ip[i] == sender.ip;
+            if (from_server && parseStunResponse(data))
+                m_state = ADDRESS_KNOWN;
+            free(data);
         }
+        // No (valid) answer in time: ask other servers
+        if (m_state == TEST_SENT &&
+            StkTime::getRealTime() > m_request_time + STUN_TIMEOUT)
+            m_state = NOTHING_DONE;
     }
     if (m_state == ADDRESS_KNOWN)
     {
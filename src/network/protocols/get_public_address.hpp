@@ -21,6 +21,8 @@
 
 #include "network/protocol.hpp"
 
+#include <vector>
+
 class GetPublicAddress : public Protocol
 {
     public:
@@ -34,6 +36,9 @@ class GetPublicAddress : public Protocol
         virtual void asynchronousUpdate();
 
     protected:
+        void sendStunRequests();
+        bool parseStunResponse(const uint8_t* data);
+
         enum STATE
         {
             NOTHING_DONE,
@@ -44,7 +49,10 @@ class GetPublicAddress : public Protocol
         STATE m_state;
         uint32_t m_stun_tansaction_id[3];
         static const uint32_t m_stun_magic_cookie = 0x2112A442;
-        uint32_t m_stun_server_ip;
+        /** The STUN servers the current requests were sent to. */
+        std::vector<uint32_t> m_stun_servers_ip;
+        /** Time at which the current requests were sent. */
+        double m_request_time;
         STKHost* m_transaction_host;
 };
 
@@ -1,11 +1,18 @@
 #include "network/protocols/kart_update_protocol.hpp"
 
+#include "config/stk_config.hpp"
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
+#include "modes/linear_world.hpp"
 #include "modes/world.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "tracks/track.hpp"
 #include "utils/time.hpp"
 
+#include <math.h>
+
 KartUpdateProtocol::KartUpdateProtocol()
     : Protocol(NULL, PROTOCOL_KART_UPDATE)
 {
@@ -22,6 +29,22 @@ KartUpdateProtocol::KartUpdateProtocol()
             m_self_kart_index = i;
         }
     }
+
+    // Karts can be slightly outside of the track (e.g. while jumping or
+    // being rescued), so add a margin to the quantisation box.
+    const Vec3 *min, *max;
+    World::getWorld()->getTrack()->getAABB(&min, &max);
+    m_quantize_min = *min - Vec3(10.0f, 10.0f, 10.0f);
+    m_quantize_max = *max + Vec3(10.0f, 50.0f, 10.0f);
+
+    m_snapshots.resize(SNAPSHOT_HISTORY);
+    m_interpolators.resize(m_karts.size());
+    m_next_snapshot_id       = 0;
+    m_last_received_snapshot = KartStateSnapshot::NO_BASELINE;
+    m_last_send_time         = 0;
+    m_start_real_time        = StkTime::getRealTime();
+    m_last_update_time       = m_start_real_time;
+    m_display_time           = 0.0f;
     pthread_mutex_init(&m_positions_updates_mutex, NULL);
 }
 
@@ -29,37 +52,212 @@ KartUpdateProtocol::~KartUpdateProtocol()
 {
 }
 
+/** Returns the stored snapshot with the given id, or NULL if it is not
+ *  (or not anymore) available.
+ *  \param history The ring buffer of snapshots to search.
+ *  \param id The id of the snapshot. */
+const KartStateSnapshot* KartUpdateProtocol::getSnapshot(
+                                const std::vector<KartStateSnapshot> &history,
+                                uint16_t id) const
+{
+    if (id == KartStateSnapshot::NO_BASELINE || history.empty())
+        return NULL;
+    const KartStateSnapshot &s = history[id % SNAPSHOT_HISTORY];
+    if (s.getId() != id || s.getNumberOfKarts() != m_karts.size())
+        return NULL;
+    return &s;
+}
+
+/** Area of interest filter: decides if the state of a kart is sent to the
+ *  peer controlling the viewer kart in the snapshot with the given id.
+ *  Karts close to the viewer (measured along the track in linear races, so
+ *  karts on a parallel part of the track are not considered close) or in
+ *  front of the viewer, i.e. likely to be visible, are sent every time.
+ *  Other karts are only sent every few snapshots, depending on distance.
+ */
+bool KartUpdateProtocol::isRelevant(const AbstractKart *viewer,
+                                    unsigned int kart_id,
+                                    uint16_t snapshot_id) const
+{
+    if (kart_id == viewer->getWorldKartId())
+        return true;
+    const AbstractKart *kart = m_karts[kart_id];
+    Vec3 to_kart  = kart->getXYZ() - viewer->getXYZ();
+    float distance = to_kart.length();
+
+    LinearWorld *lw = dynamic_cast<LinearWorld*>(World::getWorld());
+    if (lw)
+    {
+        float track_length = World::getWorld()->getTrack()->getTrackLength();
+        float d = fabsf(lw->getDistanceDownTrackForKart(kart_id) -
+                        lw->getDistanceDownTrackForKart(viewer->getWorldKartId()));
+        if (d > track_length*0.5f)
+            d = track_length - d;
+        if (d > distance)
+            distance = d;
+    }
+
+    if (distance < stk_config->m_network_aoi_near_distance)
+        return true;
+
+    // Karts in front of the viewer can be seen by the camera
+    Vec3 forward = viewer->getTrans().getBasis().getColumn(2);
+    bool visible = to_kart.dot(forward) > 0.5f * to_kart.length();
+    if (visible && distance < stk_config->m_network_aoi_far_distance)
+        return true;
+
+    int interval = distance < stk_config->m_network_aoi_far_distance
+                 ? stk_config->m_network_aoi_mid_interval
+                 : stk_config->m_network_aoi_far_interval;
+    // Spread the updates of different karts over different snapshots
+    return interval <= 1 || (snapshot_id + kart_id) % interval == 0;
+}
+
+/** Stores the quantised state of all karts in the given snapshot. */
+void KartUpdateProtocol::takeSnapshot(KartStateSnapshot *snapshot)
+{
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        QuantizedKartState state;
+        KartStateSnapshot::quantizePosition(m_karts[i]->getXYZ(),
+                                            m_quantize_min, m_quantize_max,
+                                            state.m_xyz);
+        state.m_rotation =
+            KartStateSnapshot::compressRotation(m_karts[i]->getRotation());
+        snapshot->setState(i, state);
+    }
+}
+
+/** Adds the dequantised states of all karts in a snapshot to the list of
+ *  positions to be applied in the next update. Must be called with
+ *  m_positions_updates_mutex locked.
+ *  \param snapshot The received snapshot.
+ *  \param karts The karts which were contained in the message.
+ *  \param time The server world time of the snapshot. */
+void KartUpdateProtocol::queueSnapshot(const KartStateSnapshot &snapshot,
+                                       const std::vector<unsigned int> &karts,
+                                       float time)
+{
+    for (unsigned int j = 0; j < karts.size(); j++)
+    {
+        unsigned int i = karts[j];
+        const QuantizedKartState &state = snapshot.getState(i);
+        m_next_positions.push_back(KartStateSnapshot::dequantizePosition(
+                                   state.m_xyz, m_quantize_min, m_quantize_max));
+        m_next_quaternions.push_back(
+                         KartStateSnapshot::decompressRotation(state.m_rotation));
+        m_karts_ids.push_back(i);
+        m_next_times.push_back(time);
+    }
+}
+
+/** Returns the local clock used for the clock synchronisation with the
+ *  server. It is relative to the creation of this protocol, so that it can
+ *  be sent as a float without losing precision. */
+double KartUpdateProtocol::getLocalTime() const
+{
+    return StkTime::getRealTime() - m_start_real_time;
+}   // getLocalTime
+
+/** Client: moves all remote karts to their interpolated position at a time
+ *  slightly in the past, so that two received states are usually available
+ *  around the displayed time.
+ *  \param time The (server) time at which the karts are displayed. */
+void KartUpdateProtocol::interpolateRemoteKarts(float time)
+{
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (i == m_self_kart_index)
+            continue;
+        Vec3 xyz;
+        btQuaternion rotation;
+        if (!m_interpolators[i].getState(time, &xyz, &rotation))
+            continue;
+        btTransform transform = m_karts[i]->getBody()->getInterpolationWorldTransform();
+        transform.setOrigin(xyz);
+        transform.setRotation(rotation);
+        m_karts[i]->getBody()->setCenterOfMassTransform(transform);
+    }
+}
+
 bool KartUpdateProtocol::notifyEventAsynchronous(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
     NetworkString ns = event->data();
-    if (ns.size() < 36)
+    if (m_listener->isServer())
     {
-        Log::info("KartUpdateProtocol", "Message too short.");
+        // Spectators have no kart to update
+        if ((*event->peer)->isSpectator())
+            return true;
+        // Client message: time, acknowledged snapshot, own kart state,
+        // local clock of the client
+        if (ns.size() < 21)
+        {
+            Log::info("KartUpdateProtocol", "Message too short.");
+            return true;
+        }
+        uint16_t ack     = ns.getUInt16(4);
+        uint32_t kart_id = ns.getUInt8(6);
+        if (kart_id >= m_karts.size())
+            return true;
+        uint16_t xyz[3] = { ns.getUInt16(7), ns.getUInt16(9),
+                            ns.getUInt16(11) };
+        uint32_t rotation = ns.getUInt32(13);
+
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        m_acked_snapshots[*(event->peer)] = ack;
+        ClientTime &client_time = m_client_times[*(event->peer)];
+        client_time.m_client_time   = ns.getFloat(17);
+        client_time.m_received_time = StkTime::getRealTime();
+        m_next_positions.push_back(KartStateSnapshot::dequantizePosition(
+                                   xyz, m_quantize_min, m_quantize_max));
+        m_next_quaternions.push_back(
+                                KartStateSnapshot::decompressRotation(rotation));
+        m_karts_ids.push_back(kart_id);
+        m_next_times.push_back(ns.getFloat(0));
+        pthread_mutex_unlock(&m_positions_updates_mutex);
         return true;
     }
-    ns.removeFront(4);
-    while(ns.size() >= 16)
+
+    // Server message: time, the last client time received by the server,
+    // how long the server held that time, followed by a (delta) snapshot
+    if (ns.size() < 17)
     {
-        uint32_t kart_id = ns.getUInt32(0);
-
-        float a,b,c;
-        a = ns.getFloat(4);
-        b = ns.getFloat(8);
-        c = ns.getFloat(12);
-        float d,e,f,g;
-        d = ns.getFloat(16);
-        e = ns.getFloat(20);
-        f = ns.getFloat(24);
-        g = ns.getFloat(28);
-        pthread_mutex_trylock(&m_positions_updates_mutex);
-        m_next_positions.push_back(Vec3(a,b,c));
-        m_next_quaternions.push_back(btQuaternion(d,e,f,g));
-        m_karts_ids.push_back(kart_id);
-        pthread_mutex_unlock(&m_positions_updates_mutex);
-        ns.removeFront(32);
+        Log::info("KartUpdateProtocol", "Message too short.");
+        return true;
     }
+    double local_time  = getLocalTime();
+    float  server_time = ns.getFloat(0);
+    float  echo_time   = ns.getFloat(4);
+    float  hold_time   = ns.getFloat(8);
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    if (hold_time >= 0)
+        m_clock.addSample(echo_time, server_time - hold_time, server_time,
+                          local_time);
+    m_clock.addArrival(server_time, local_time);
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+
+    uint16_t id = KartStateSnapshot::peekId(ns, 12);
+    // Ignore snapshots that are older than one already received (unreliable
+    // packets can arrive out of order).
+    if (m_last_received_snapshot != KartStateSnapshot::NO_BASELINE &&
+        (int16_t)(id - m_last_received_snapshot) <= 0)
+        return true;
+
+    const KartStateSnapshot *baseline =
+        getSnapshot(m_snapshots, KartStateSnapshot::peekBaselineId(ns, 12));
+    KartStateSnapshot snapshot(id, (unsigned int)m_karts.size());
+    int bytes_read;
+    std::vector<unsigned int> changed_karts;
+    if (!snapshot.decode(ns, 12, baseline, &bytes_read, &changed_karts))
+        return true;
+    m_snapshots[id % SNAPSHOT_HISTORY] = snapshot;
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    m_last_received_snapshot = id;
+    queueSnapshot(snapshot, changed_karts, server_time);
+    pthread_mutex_unlock(&m_positions_updates_mutex);
     return true;
 }
 
@@ -71,68 +269,177 @@ void KartUpdateProtocol::update()
 {
     if (!World::getWorld())
         return;
-    static double time = 0;
     double current_time = StkTime::getRealTime();
-    if (current_time > time + 0.1) // 10 updates per second
+    if (current_time > m_last_send_time
+                     + 1.0/stk_config->m_network_state_frequency)
     {
-        time = current_time;
+        m_last_send_time = current_time;
         if (m_listener->isServer())
         {
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            for (unsigned int i = 0; i < m_karts.size(); i++)
+            uint16_t id = m_next_snapshot_id++;
+            if (m_next_snapshot_id == KartStateSnapshot::NO_BASELINE)
+                m_next_snapshot_id = 0;
+            KartStateSnapshot snapshot(id, (unsigned int)m_karts.size());
+            takeSnapshot(&snapshot);
+
+            // Each peer gets the snapshot encoded against the newest
+            // snapshot it has acknowledged, and only containing the karts
+            // relevant to it.
+            std::vector<STKPeer*> peers =
+                                     NetworkManager::getInstance()->getPeers();
+            std::vector<STKPeer*> spectators;
+            for (unsigned int i = 0; i < peers.size(); i++)
             {
-                AbstractKart* kart = m_karts[i];
-                Vec3 v = kart->getXYZ();
-                btQuaternion quat = kart->getRotation();
-                ns.ai32( kart->getWorldKartId());
-                ns.af(v[0]).af(v[1]).af(v[2]); // add position
-                ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-                Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+                if (peers[i]->isSpectator())
+                {
+                    spectators.push_back(peers[i]);
+                    continue;
+                }
+                uint16_t ack = KartStateSnapshot::NO_BASELINE;
+                pthread_mutex_lock(&m_positions_updates_mutex);
+                std::map<STKPeer*, uint16_t>::iterator it =
+                                                m_acked_snapshots.find(peers[i]);
+                if (it != m_acked_snapshots.end())
+                    ack = it->second;
+                pthread_mutex_unlock(&m_positions_updates_mutex);
+
+                std::vector<KartStateSnapshot> &history =
+                                                   m_peer_snapshots[peers[i]];
+                if (history.empty())
+                    history.resize(SNAPSHOT_HISTORY);
+                const KartStateSnapshot *baseline =
+                    ack != id ? getSnapshot(history, ack) : NULL;
+
+                // Echo the newest client time, and for how long the server
+                // held it (a negative hold time means no time is known)
+                float echo_time = 0, hold_time = -1.0f;
+                pthread_mutex_lock(&m_positions_updates_mutex);
+                std::map<STKPeer*, ClientTime>::iterator ct =
+                                                 m_client_times.find(peers[i]);
+                if (ct != m_client_times.end())
+                {
+                    echo_time = ct->second.m_client_time;
+                    hold_time = (float)(current_time
+                                        - ct->second.m_received_time);
+                }
+                pthread_mutex_unlock(&m_positions_updates_mutex);
+
+                NetworkPlayerProfile *profile = peers[i]->getPlayerProfile();
+                const AbstractKart *viewer =
+                    profile && profile->world_kart_id < m_karts.size()
+                    ? m_karts[profile->world_kart_id] : NULL;
+
+                // Without a baseline the peer needs the state of all karts
+                KartStateSnapshot peer_snapshot = snapshot;
+                if (baseline && viewer)
+                {
+                    peer_snapshot = *baseline;
+                    peer_snapshot.setId(id);
+                    for (unsigned int k = 0; k < m_karts.size(); k++)
+                    {
+                        if (isRelevant(viewer, k, id))
+                            peer_snapshot.setState(k, snapshot.getState(k));
+                    }
+                }
+
+                NetworkString ns;
+                ns.af( World::getWorld()->getTime());
+                ns.af(echo_time).af(hold_time);
+                peer_snapshot.encode(baseline, &ns);
+                history[id % SNAPSHOT_HISTORY] = peer_snapshot;
+                m_listener->sendMessage(this, peers[i], ns, false);
+            }
+
+            // All spectators share one delayed stream, so they cost the
+            // same as a single peer.
+            if (UserConfigParams::m_server_max_spectators > 0)
+            {
+                m_spectator_stream.addSnapshot(World::getWorld()->getTime(),
+                                               snapshot);
+                NetworkString ns;
+                if (m_spectator_stream.getMessage(World::getWorld()->getTime(),
+                                                  &ns))
+                    m_listener->sendMessage(this, spectators, ns, false);
             }
-            m_listener->sendMessage(this, ns, false);
         }
         else
         {
             AbstractKart* kart = m_karts[m_self_kart_index];
-            Vec3 v = kart->getXYZ();
-            btQuaternion quat = kart->getRotation();
+            uint16_t xyz[3];
+            KartStateSnapshot::quantizePosition(kart->getXYZ(), m_quantize_min,
+                                                m_quantize_max, xyz);
+            pthread_mutex_lock(&m_positions_updates_mutex);
+            uint16_t ack = m_last_received_snapshot;
+            pthread_mutex_unlock(&m_positions_updates_mutex);
+
             NetworkString ns;
             ns.af( World::getWorld()->getTime());
-            ns.ai32( kart->getWorldKartId());
-            ns.af(v[0]).af(v[1]).af(v[2]); // add position
-            ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-            Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+            ns.ai16(ack);
+            ns.ai8(m_self_kart_index);
+            ns.ai16(xyz[0]).ai16(xyz[1]).ai16(xyz[2]); // add position
+            ns.ai32(KartStateSnapshot::compressRotation(kart->getRotation()));
+            ns.af((float)getLocalTime());
+            Log::verbose("KartUpdateProtocol", "Sending %d's position %d %d %d", kart->getWorldKartId(), xyz[0], xyz[1], xyz[2]);
             m_listener->sendMessage(this, ns, false);
         }
     }
     switch(pthread_mutex_trylock(&m_positions_updates_mutex))
     {
         case 0: /* if we got the lock */
+            // Apply the states in the order in which they were received
             while (!m_next_positions.empty())
             {
-                uint32_t id = m_karts_ids.back();
-                if (id != m_self_kart_index || m_listener->isServer()) // server takes all updates
+                uint32_t id = m_karts_ids.front();
+                Vec3 pos = m_next_positions.front();
+                btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
+                transform.setOrigin(pos);
+                transform.setRotation(m_next_quaternions.front());
+                if (m_listener->isServer()) // server takes all updates
                 {
-                    Vec3 pos = m_next_positions.back();
-                    btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
-                    transform.setOrigin(pos);
-                    transform.setRotation(m_next_quaternions.back());
                     m_karts[id]->getBody()->setCenterOfMassTransform(transform);
-                    //m_karts[id]->getBody()->setLinearVelocity(Vec3(0,0,0));
                     Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f", id, pos[0], pos[1], pos[2]);
                 }
-                m_next_positions.pop_back();
-                m_next_quaternions.pop_back();
-                m_karts_ids.pop_back();
+                else if (id == m_self_kart_index)
+                {
+                    // The local kart is predicted, only correct it if the
+                    // server disagrees with the prediction
+                    m_prediction.reconcile(m_next_times.front(), transform,
+                                           m_karts[id]);
+                }
+                else
+                {
+                    m_interpolators[id].add(m_next_times.front(), pos,
+                                            m_next_quaternions.front());
+                }
+                m_next_positions.pop_front();
+                m_next_quaternions.pop_front();
+                m_karts_ids.pop_front();
+                m_next_times.pop_front();
             }
             pthread_mutex_unlock(&m_positions_updates_mutex);
             break;
         default:
             break;
     }
-}
-
-
-
 
+    if (!m_listener->isServer())
+    {
+        // Display the remote karts at the estimated server time minus the
+        // playout delay, which adapts to the jitter of the snapshots.
+        float interval = 1.0f / stk_config->m_network_state_frequency;
+        float time;
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        double delay = m_clock.updatePlayoutDelay(interval,
+                                          current_time - m_last_update_time);
+        if (m_clock.isSynchronised())
+            time = (float)(m_clock.toRemoteTime(getLocalTime()) - delay);
+        else
+            time = World::getWorld()->getTime() - 2.0f*interval;
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        m_last_update_time = current_time;
+        m_display_time = time;
+        interpolateRemoteKarts(time);
+        m_prediction.record(World::getWorld()->getTime(),
+                            m_karts[m_self_kart_index]);
+    }
+}
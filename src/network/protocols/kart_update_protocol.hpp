@@ -2,11 +2,18 @@
 #define KART_UPDATE_PROTOCOL_HPP
 
 #include "network/protocol.hpp"
+#include "network/kart_interpolator.hpp"
+#include "network/kart_state_snapshot.hpp"
+#include "network/network_clock.hpp"
+#include "network/prediction_buffer.hpp"
+#include "network/spectator_stream.hpp"
 #include "utils/vec3.hpp"
 #include "LinearMath/btQuaternion.h"
 #include <list>
+#include <map>
 
 class AbstractKart;
+class STKPeer;
 
 class KartUpdateProtocol : public Protocol
 {
@@ -19,13 +26,84 @@ class KartUpdateProtocol : public Protocol
         virtual void update();
         virtual void asynchronousUpdate() {};
 
+        /** Client: returns the server world time the remote karts are
+         *  currently displayed at, so that other events can be shown on
+         *  the same timeline. */
+        float getDisplayTime() const { return m_display_time; }
+
     protected:
+        /** Number of snapshots kept to be used as baselines. */
+        static const unsigned int SNAPSHOT_HISTORY = 32;
+
+        void takeSnapshot(KartStateSnapshot *snapshot);
+        void queueSnapshot(const KartStateSnapshot &snapshot,
+                           const std::vector<unsigned int> &karts,
+                           float time);
+        void interpolateRemoteKarts(float time);
+        double getLocalTime() const;
+        const KartStateSnapshot* getSnapshot(
+                             const std::vector<KartStateSnapshot> &history,
+                             uint16_t id) const;
+        bool isRelevant(const AbstractKart *viewer, unsigned int kart_id,
+                        uint16_t snapshot_id) const;
+
         std::vector<AbstractKart*> m_karts;
         uint32_t m_self_kart_index;
 
         std::list<Vec3> m_next_positions;
         std::list<btQuaternion> m_next_quaternions;
         std::list<uint32_t> m_karts_ids;
+        /** Server world time of each of the queued states. */
+        std::list<float> m_next_times;
+
+        /** Client: predicted states of the local kart. */
+        PredictionBuffer m_prediction;
+        /** Client: buffered states for each remote kart. */
+        std::vector<KartInterpolator> m_interpolators;
+
+        /** Client: ring buffer of the last received snapshots, indexed by
+         *  snapshot id modulo SNAPSHOT_HISTORY. */
+        std::vector<KartStateSnapshot> m_snapshots;
+        /** Server: for each peer a ring buffer of the snapshots sent to it.
+         *  Since not all karts are sent to each peer every time, these
+         *  contain the states as known by the peer. */
+        std::map<STKPeer*, std::vector<KartStateSnapshot> > m_peer_snapshots;
+        /** Id of the next snapshot to be sent by the server. */
+        uint16_t m_next_snapshot_id;
+        /** Client: id of the newest snapshot received, which is
+         *  acknowledged to the server with each client message. */
+        uint16_t m_last_received_snapshot;
+        /** Server: the newest snapshot each peer has acknowledged. */
+        std::map<STKPeer*, uint16_t> m_acked_snapshots;
+
+        /** Server: the delayed stream sent to all spectators. */
+        SpectatorStream m_spectator_stream;
+
+        /** Bounding box used to quantise positions. */
+        Vec3 m_quantize_min, m_quantize_max;
+
+        /** Time at which the last snapshot was sent. */
+        double m_last_send_time;
+
+        /** Client: estimate of the server world time. */
+        NetworkClock m_clock;
+        /** Real time at which this protocol was created, the local clock
+         *  sent to the server is relative to this time. */
+        double m_start_real_time;
+        /** Time of the previous update, for the playout delay. */
+        double m_last_update_time;
+        /** Client: server world time the remote karts are displayed at. */
+        float m_display_time;
+
+        /** Server: the newest local time received from each client, and
+         *  the real time at which it was received. This is sent back so
+         *  that the client can measure round trip time and clock offset. */
+        struct ClientTime
+        {
+            float  m_client_time;
+            double m_received_time;
+        };   // ClientTime
+        std::map<STKPeer*, ClientTime> m_client_times;
 
         pthread_mutex_t m_positions_updates_mutex;
 };
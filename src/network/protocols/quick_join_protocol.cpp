@@ -22,6 +22,7 @@
 #include "config/user_config.hpp"
 #include "network/network_manager.hpp"
 #include "online/request_manager.hpp"
+#include "online/servers_manager.hpp"
 #include "utils/log.hpp"
 
 QuickJoinProtocol::QuickJoinProtocol(CallbackObject* callback_object, uint32_t* server_id) : Protocol(callback_object, PROTOCOL_SILENT)
@@ -42,6 +43,21 @@ void QuickJoinProtocol::asynchronousUpdate()
 {
     if (m_state == NONE)
     {
+        // If the round trip times to the servers are known, join the best
+        // server directly instead of letting the master server pick one
+        const Online::Server *server = Online::ServersManager::get()->getQuickPlay();
+        if (server && server->getPing() >= 0 && server->getIP() != 0)
+        {
+            TransportAddress* res = static_cast<TransportAddress*>(m_callback_object);
+            res->ip = server->getIP();
+            res->port = server->getPort();
+            *m_server_id = server->getHostId();
+            Log::info("QuickJoinProtocol", "Quick joining %d:%d (server#%d, %d ms).",
+                      res->ip, res->port, *m_server_id, server->getPing());
+            m_request = NULL;
+            m_state = DONE;
+            return;
+        }
         TransportAddress addr = NetworkManager::getInstance()->getPublicAddress();
         m_request = new Online::XMLRequest();
         PlayerManager::setUserDetails(m_request, "quick-join", Online::API::SERVER_PATH);
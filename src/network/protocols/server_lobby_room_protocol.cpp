@@ -22,6 +22,8 @@
 #include "config/user_config.hpp"
 #include "modes/world.hpp"
 #include "network/network_world.hpp"
+#include "network/room_manager.hpp"
+#include "network/server_room.hpp"
 #include "network/protocols/get_public_address.hpp"
 #include "network/protocols/show_public_address.hpp"
 #include "network/protocols/connect_to_peer.hpp"
@@ -30,19 +32,38 @@
 #include "network/server_network_manager.hpp"
 #include "online/online_profile.hpp"
 #include "online/request_manager.hpp"
+#include "online/xml_request.hpp"
 #include "utils/log.hpp"
 #include "utils/random_generator.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
+
+/** Time (in seconds) between two polls of the master server. */
+static const double POLL_INTERVAL = 2.0;
+/** Maximum time between two polls if the master server can't be reached. */
+static const double MAX_POLL_INTERVAL = 60.0;
 
 ServerLobbyRoomProtocol::ServerLobbyRoomProtocol() : LobbyRoomProtocol(NULL)
 {
+    m_poll_request   = NULL;
+    m_next_poll_time = 0;
+    m_poll_interval  = POLL_INTERVAL;
 }
 
 //-----------------------------------------------------------------------------
 
 ServerLobbyRoomProtocol::~ServerLobbyRoomProtocol()
 {
+    if (m_poll_request)
+    {
+        // The request manager still uses the request, let it free it
+        if (m_poll_request->isDone())
+            delete m_poll_request;
+        else
+            m_poll_request->setManageMemory(true);
+        m_poll_request = NULL;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -50,13 +71,14 @@ ServerLobbyRoomProtocol::~ServerLobbyRoomProtocol()
 void ServerLobbyRoomProtocol::setup()
 {
     m_setup = NetworkManager::getInstance()->setupNewGame(); // create a new setup
-    m_setup->getRaceConfig()->setPlayerCount(16); //FIXME : this has to be moved to when logging into the server
+    // The setup is used for the first room, others are created on demand
+    RoomManager::getInstance()->init(m_setup,
+                               ServerNetworkManager::getInstance()->getMaxPlayers(),
+                               UserConfigParams::m_server_max_rooms);
     m_next_id = 0;
     m_state = NONE;
     m_public_address.ip = 0;
     m_public_address.port = 0;
-    m_selection_enabled = false;
-    m_in_race = false;
     Log::info("ServerLobbyRoomProtocol", "Starting the protocol.");
 }
 
@@ -129,7 +151,8 @@ void ServerLobbyRoomProtocol::update()
     case WORKING:
     {
         checkIncomingConnectionRequests();
-        if (m_in_race && World::getWorld() && NetworkWorld::getInstance<NetworkWorld>()->isRunning())
+        if (RoomManager::getInstance()->getRaceRoom() && World::getWorld() &&
+            NetworkWorld::getInstance<NetworkWorld>()->isRunning())
             checkRaceFinished();
 
         break;
@@ -145,86 +168,183 @@ void ServerLobbyRoomProtocol::update()
 
 //-----------------------------------------------------------------------------
 
-void ServerLobbyRoomProtocol::startGame()
+/*! \brief Starts the race of a room.
+ *  Only one room can race at a time, since there is only one world.
+ *  \param room_id : Id of the room.
+ */
+void ServerLobbyRoomProtocol::startGame(uint8_t room_id)
 {
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    ServerRoom *room = RoomManager::getInstance()->getRoom(room_id);
+    if (!room)
+    {
+        Log::warn("ServerLobbyRoomProtocol", "Room %d does not exist.", room_id);
+        return;
+    }
+    if (!RoomManager::getInstance()->startRace(room))
+    {
+        Log::warn("ServerLobbyRoomProtocol",
+                  "Cannot start room %d, another room is still racing.", room_id);
+        return;
+    }
+    const std::vector<STKPeer*> &peers = room->getPeers();
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         NetworkString ns;
         ns.ai8(0x04).ai8(4).ai32(peers[i]->getClientServerToken()); // start game
         m_listener->sendMessage(this, peers[i], ns, true); // reliably
     }
-    m_listener->requestStart(new StartGameProtocol(m_setup));
-    m_in_race = true;
+    m_listener->requestStart(new StartGameProtocol(room->getGameSetup()));
 }
 
 //-----------------------------------------------------------------------------
 
-void ServerLobbyRoomProtocol::startSelection()
+void ServerLobbyRoomProtocol::startSelection(uint8_t room_id)
 {
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    ServerRoom *room = RoomManager::getInstance()->getRoom(room_id);
+    if (!room)
+    {
+        Log::warn("ServerLobbyRoomProtocol", "Room %d does not exist.", room_id);
+        return;
+    }
+    const std::vector<STKPeer*> &peers = room->getPeers();
     for (unsigned int i = 0; i < peers.size(); i++)
     {
         NetworkString ns;
         ns.ai8(0x05).ai8(4).ai32(peers[i]->getClientServerToken()); // start selection
         m_listener->sendMessage(this, peers[i], ns, true); // reliably
     }
-    m_selection_enabled = true;
+    room->setSelectionEnabled(true);
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Sends a message to all peers of a room.
+ *  \param room : The room.
+ *  \param message : The message to send.
+ *  \param except : If not NULL, this peer will not receive the message.
+ */
+void ServerLobbyRoomProtocol::sendMessageToRoom(ServerRoom *room,
+                                                const NetworkString &message,
+                                                STKPeer *except)
+{
+    const std::vector<STKPeer*> &peers = room->getPeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        if (except && peers[i]->isSamePeer(except))
+            continue;
+        m_listener->sendMessage(this, peers[i], message);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Sends a message to all peers of a room, inserting the token of
+ *  each peer between the prefix and the message.
+ */
+void ServerLobbyRoomProtocol::sendMessageToRoomChangingToken(ServerRoom *room,
+                                                 const NetworkString &prefix,
+                                                 const NetworkString &message)
+{
+    const std::vector<STKPeer*> &peers = room->getPeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        NetworkString ns = prefix;
+        ns.ai8(4).ai32(peers[i]->getClientServerToken());
+        ns += message;
+        m_listener->sendMessage(this, peers[i], ns);
+    }
 }
 
 //-----------------------------------------------------------------------------
 
+/*! \brief Polls the master server for peers that want to connect.
+ *  The poll is queued in the request manager, so the server never waits for
+ *  the master server. Each poll also tells the master server how many
+ *  players are on this server, so it serves as heartbeat as well. If the
+ *  master server can't be reached, the time between polls is doubled (up
+ *  to MAX_POLL_INTERVAL), so that a master server which is down is not
+ *  flooded with requests by all servers.
+ */
 void ServerLobbyRoomProtocol::checkIncomingConnectionRequests()
 {
-    // first poll every 5 seconds
-    static double last_poll_time = 0;
-    if (StkTime::getRealTime() > last_poll_time+10.0)
+    if (m_poll_request)
+    {
+        if (m_poll_request->isDone())
+            handleConnectionRequestsPoll();
+    }
+    else if (StkTime::getRealTime() > m_next_poll_time)
     {
-        last_poll_time = StkTime::getRealTime();
         TransportAddress addr = NetworkManager::getInstance()->getPublicAddress();
-        Online::XMLRequest* request = new Online::XMLRequest();
-        PlayerManager::setUserDetails(request, "poll-connection-requests", Online::API::SERVER_PATH);
+        RoomManager *room_manager = RoomManager::getInstance();
+        // Polls have a higher priority than other requests, since joining
+        // players wait for them
+        m_poll_request = new Online::XMLRequest(/*manage_memory*/false,
+                                                /*priority*/10);
+        PlayerManager::setUserDetails(m_poll_request, "poll-connection-requests",
+                                      Online::API::SERVER_PATH);
+
+        m_poll_request->addParameter("address", addr.ip);
+        m_poll_request->addParameter("port", addr.port);
+        m_poll_request->addParameter("players",
+                                NetworkManager::getInstance()->getPeerCount());
+        m_poll_request->addParameter("max_players",
+            ServerNetworkManager::getInstance()->getMaxPlayers()
+            * room_manager->getNumberOfRooms());
+        m_poll_request->addParameter("racing",
+                                     room_manager->getRaceRoom() ? 1 : 0);
+        m_poll_request->queue();
+    }
 
-        request->addParameter("address", addr.ip);
-        request->addParameter("port", addr.port);
+    // now
+    for (unsigned int i = 0; i < m_incoming_peers_ids.size(); i++)
+    {
+        m_listener->requestStart(new ConnectToPeer(m_incoming_peers_ids[i]));
+    }
+    m_incoming_peers_ids.clear();
+}
 
-        request->executeNow();
-        assert(request->isDone());
+//-----------------------------------------------------------------------------
 
-        const XMLNode * result = request->getXMLData();
-        std::string rec_success;
+/*! \brief Reads the result of a finished poll for connection requests, and
+ *  decides when to poll the next time.
+ */
+void ServerLobbyRoomProtocol::handleConnectionRequestsPoll()
+{
+    const XMLNode * result = m_poll_request->getXMLData();
+    std::string rec_success;
 
-        if(result->get("success", &rec_success))
+    bool success = false;
+    if(result && result->get("success", &rec_success))
+    {
+        if(rec_success == "yes")
         {
-            if(rec_success == "yes")
-            {
-                const XMLNode * users_xml = result->getNode("users");
-                uint32_t id = 0;
-                for (unsigned int i = 0; i < users_xml->getNumNodes(); i++)
-                {
-                    users_xml->getNode(i)->get("id", &id);
-                    Log::debug("ServerLobbyRoomProtocol", "User with id %d wants to connect.", id);
-                    m_incoming_peers_ids.push_back(id);
-                }
-            }
-            else
+            success = true;
+            const XMLNode * users_xml = result->getNode("users");
+            uint32_t id = 0;
+            for (unsigned int i = 0; users_xml && i < users_xml->getNumNodes(); i++)
             {
-                Log::error("ServerLobbyRoomProtocol", "Error while reading the list.");
+                users_xml->getNode(i)->get("id", &id);
+                Log::debug("ServerLobbyRoomProtocol", "User with id %d wants to connect.", id);
+                m_incoming_peers_ids.push_back(id);
             }
         }
         else
         {
-            Log::error("ServerLobbyRoomProtocol", "Cannot retrieve the list.");
+            Log::error("ServerLobbyRoomProtocol", "Error while reading the list.");
         }
-        delete request;
     }
-
-    // now
-    for (unsigned int i = 0; i < m_incoming_peers_ids.size(); i++)
+    else
     {
-        m_listener->requestStart(new ConnectToPeer(m_incoming_peers_ids[i]));
+        Log::error("ServerLobbyRoomProtocol", "Cannot retrieve the list.");
     }
-    m_incoming_peers_ids.clear();
+    delete m_poll_request;
+    m_poll_request = NULL;
+
+    if (success)
+        m_poll_interval = POLL_INTERVAL;
+    else
+        m_poll_interval = std::min(2.0 * m_poll_interval, MAX_POLL_INTERVAL);
+    m_next_poll_time = StkTime::getRealTime() + m_poll_interval;
 }
 
 //-----------------------------------------------------------------------------
@@ -233,6 +353,8 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
 {
     assert(NetworkWorld::getInstance()->isRunning());
     assert(World::getWorld());
+    ServerRoom *room = RoomManager::getInstance()->getRaceRoom();
+    assert(room);
     // if race is over, give the final score to everybody
     if (NetworkWorld::getInstance()->isRaceOver())
     {
@@ -254,7 +376,7 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
             }
         }
 
-        std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+        const std::vector<STKPeer*> &peers = room->getPeers();
 
         NetworkString queue;
         for (unsigned int i = 0; i < karts_results.size(); i++)
@@ -270,7 +392,7 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
             m_listener->sendMessage(this, peers[i], total, true);
         }
         Log::info("ServerLobbyRoomProtocol", "End of game message sent");
-        m_in_race = false;
+        RoomManager::getInstance()->finishRace(room);
 
         // stop race protocols
         Protocol* protocol = NULL;
@@ -286,6 +408,11 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
         else
             Log::error("ClientLobbyRoomProtocol", "No kart update protocol registered.");
 
+        // Only started in soccer mode
+        protocol = m_listener->getProtocol(PROTOCOL_BALL_UPDATE);
+        if (protocol)
+            m_listener->requestTerminate(protocol);
+
         protocol = m_listener->getProtocol(PROTOCOL_GAME_EVENTS);
         if (protocol)
             m_listener->requestTerminate(protocol);
@@ -309,18 +436,23 @@ void ServerLobbyRoomProtocol::checkRaceFinished()
 void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
 {
     STKPeer* peer = *(event->peer);
-    if (peer->getPlayerProfile() != NULL) // others knew him
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (room && peer->getPlayerProfile() != NULL) // others knew him
     {
+        RoomManager::getInstance()->leaveRoom(peer);
         NetworkString msg;
         msg.ai8(0x02).ai8(1).ai8(peer->getPlayerProfile()->race_id);
-        m_listener->sendMessage(this, msg);
-        Log::info("ServerLobbyRoomProtocol", "Player disconnected : id %d",
-                  peer->getPlayerProfile()->race_id);
-        m_setup->removePlayer(peer->getPlayerProfile()->race_id);
+        sendMessageToRoom(room, msg);
+        Log::info("ServerLobbyRoomProtocol", "Player disconnected : id %d, room %d",
+                  peer->getPlayerProfile()->race_id, room->getId());
+        room->getGameSetup()->removePlayer(peer->getPlayerProfile()->race_id);
         NetworkManager::getInstance()->removePeer(peer);
     }
     else
+    {
+        RoomManager::getInstance()->leaveRoom(peer);
         Log::info("ServerLobbyRoomProtocol", "The DC peer wasn't registered.");
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -329,34 +461,40 @@ void ServerLobbyRoomProtocol::kartDisconnected(Event* event)
  *  \param event : Event providing the information.
  *
  *  Format of the data :
- *  Byte 0   1                  5
- *       ------------------------
- *  Size | 1 |          4       |
- *  Data | 4 | global player id |
- *       ------------------------
+ *  Byte 0   1                  5                      6
+ *       -------------------------------------------------
+ *  Size | 1 |          4       |           1          |
+ *  Data | 4 | global player id | spectator (optional) |
+ *       -------------------------------------------------
  */
 void ServerLobbyRoomProtocol::connectionRequested(Event* event)
 {
     STKPeer* peer = *(event->peer);
     NetworkString data = event->data();
-    if (data.size() != 5 || data[0] != 4)
+    if ((data.size() != 5 && data.size() != 6) || data[0] != 4)
     {
         Log::warn("ServerLobbyRoomProtocol", "Receiving badly formated message. Size is %d and first byte %d", data.size(), data[0]);
         return;
     }
+    if (data.size() == 6 && data[5] != 0)
+    {
+        spectatorRequested(peer);
+        return;
+    }
     uint32_t player_id = 0;
     player_id = data.getUInt32(1);
-    // can we add the player ?
-    if (m_setup->getPlayerCount() <
-        ServerNetworkManager::getInstance()->getMaxPlayers()) //accept
+    // can we add the player ? Put it into a room with free slots.
+    ServerRoom *room = RoomManager::getInstance()->joinRoom(peer);
+    if (room) //accept
     {
+        GameSetup *setup = room->getGameSetup();
         // add the player to the game setup
-        m_next_id = m_setup->getPlayerCount();
+        m_next_id = setup->getPlayerCount();
         // notify everybody that there is a new player
         NetworkString message;
         // new player (1) -- size of id -- id -- size of local id -- local id;
         message.ai8(1).ai8(4).ai32(player_id).ai8(1).ai8(m_next_id);
-        m_listener->sendMessageExcept(this, peer, message);
+        sendMessageToRoom(room, message, peer);
 
         /// now answer to the peer that just connected
         RandomGenerator token_generator;
@@ -371,7 +509,7 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
         // connection success (129) -- size of token -- token
         message_ack.ai8(0x81).ai8(1).ai8(m_next_id).ai8(4).ai32(token).ai8(4).ai32(player_id);
         // add all players so that this user knows
-        std::vector<NetworkPlayerProfile*> players = m_setup->getPlayers();
+        std::vector<NetworkPlayerProfile*> players = setup->getPlayers();
         for (unsigned int i = 0; i < players.size(); i++)
         {
             // do not duplicate the player into the message
@@ -386,9 +524,10 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
         profile->race_id = m_next_id;
         profile->kart_name = "";
         profile->user_profile = new Online::OnlineProfile(player_id, "");
-        m_setup->addPlayer(profile);
+        setup->addPlayer(profile);
         peer->setPlayerProfile(profile);
-        Log::verbose("ServerLobbyRoomProtocol", "New player.");
+        Log::verbose("ServerLobbyRoomProtocol", "New player in room %d.",
+                     room->getId());
     } // accept player
     else  // refuse the connection with code 0 (too much players)
     {
@@ -404,6 +543,53 @@ void ServerLobbyRoomProtocol::connectionRequested(Event* event)
 
 //-----------------------------------------------------------------------------
 
+/*! \brief Called when a peer asks to watch the races as spectator, e.g. a
+ *  relay for a stream. Spectators don't join a room and have no kart, they
+ *  only get the delayed spectator stream of the race (see SpectatorStream).
+ *  \param peer : The peer that asked to connect.
+ *
+ *  Format of the answer :
+ *  Byte 0      1   2       6
+ *       -------------------
+ *  Size |  1   | 1 |   4   |
+ *  Data | 0x82 | 4 | token |
+ *       -------------------
+ */
+void ServerLobbyRoomProtocol::spectatorRequested(STKPeer* peer)
+{
+    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    int num_spectators = 0;
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        if (peers[i]->isSpectator())
+            num_spectators++;
+    }
+    if (num_spectators >= UserConfigParams::m_server_max_spectators)
+    {
+        NetworkString message;
+        // connection refused -- 1 byte error code -- 2 = no spectators
+        message.ai8(0x80).ai8(1).ai8(2);
+        m_listener->sendMessage(this, peer, message);
+        Log::verbose("ServerLobbyRoomProtocol", "Spectator refused");
+        return;
+    }
+
+    RandomGenerator token_generator;
+    uint32_t token = (uint32_t)((token_generator.get(256) << 24) |
+                                (token_generator.get(256) << 16) |
+                                (token_generator.get(256) <<  8) |
+                                 token_generator.get(256)        );
+    NetworkString message;
+    message.ai8(0x82).ai8(4).ai32(token);
+    m_listener->sendMessage(this, peer, message);
+    peer->setClientServerToken(token);
+    peer->setSpectator(true);
+    Log::info("ServerLobbyRoomProtocol", "New spectator, %d spectators now.",
+              num_spectators + 1);
+}   // spectatorRequested
+
+//-----------------------------------------------------------------------------
+
 /*! \brief Called when a player asks to select a kart.
  *  \param event : Event providing the information.
  *
@@ -420,6 +606,10 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
     STKPeer* peer = *(event->peer);
     if (!checkDataSizeAndToken(event, 6))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
+    GameSetup *setup = room->getGameSetup();
 
     uint8_t kart_name_size = data.gui8(5);
     std::string kart_name = data.gs(6, kart_name_size);
@@ -430,7 +620,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
         return;
     }
     // check if selection is possible
-    if (!m_selection_enabled)
+    if (!room->isSelectionEnabled())
     {
         NetworkString answer;
         answer.ai8(0x82).ai8(1).ai8(2); // selection still not started
@@ -438,7 +628,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
         return;
     }
     // check if somebody picked that kart
-    if (!m_setup->isKartAvailable(kart_name))
+    if (!setup->isKartAvailable(kart_name))
     {
         NetworkString answer;
         answer.ai8(0x82).ai8(1).ai8(0); // kart is already taken
@@ -446,7 +636,7 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
         return;
     }
     // check if this kart is authorized
-    if (!m_setup->isKartAllowed(kart_name))
+    if (!setup->isKartAllowed(kart_name))
     {
         NetworkString answer;
         answer.ai8(0x82).ai8(1).ai8(1); // kart is not authorized
@@ -459,8 +649,8 @@ void ServerLobbyRoomProtocol::kartSelectionRequested(Event* event)
     answer.ai8(0x03).ai8(1).ai8(peer->getPlayerProfile()->race_id);
     //  kart name size, kart name
     answer.ai8(kart_name.size()).as(kart_name);
-    m_listener->sendMessage(this, answer);
-    m_setup->setPlayerKart(peer->getPlayerProfile()->race_id, kart_name);
+    sendMessageToRoom(room, answer);
+    setup->setPlayerKart(peer->getPlayerProfile()->race_id, kart_name);
 }
 
 //-----------------------------------------------------------------------------
@@ -483,8 +673,11 @@ void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
         return;
     if (!isByteCorrect(event, 5, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerMajorVote(player_id, data[6]);
+    room->getGameSetup()->getRaceConfig()->setPlayerMajorVote(player_id, data[6]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -492,7 +685,7 @@ void ServerLobbyRoomProtocol::playerMajorVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc0); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -514,8 +707,11 @@ void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
         return;
     if (!isByteCorrect(event, 5, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerRaceCountVote(player_id, data[6]);
+    room->getGameSetup()->getRaceConfig()->setPlayerRaceCountVote(player_id, data[6]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -523,7 +719,7 @@ void ServerLobbyRoomProtocol::playerRaceCountVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc1); // prefix the token with the type
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -545,8 +741,11 @@ void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
         return;
     if (!isByteCorrect(event, 5, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerMinorVote(player_id, data[6]);
+    room->getGameSetup()->getRaceConfig()->setPlayerMinorVote(player_id, data[6]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -554,7 +753,7 @@ void ServerLobbyRoomProtocol::playerMinorVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc2); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -578,8 +777,11 @@ void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
     std::string track_name = data.gs(5, N);
     if (!isByteCorrect(event, N+6, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerTrackVote(player_id, track_name, data[N+7]);
+    room->getGameSetup()->getRaceConfig()->setPlayerTrackVote(player_id, track_name, data[N+7]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -587,7 +789,7 @@ void ServerLobbyRoomProtocol::playerTrackVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc3); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -611,8 +813,11 @@ void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
         return;
     if (!isByteCorrect(event, 7, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerReversedVote(player_id, data[6]!=0, data[8]);
+    room->getGameSetup()->getRaceConfig()->setPlayerReversedVote(player_id, data[6]!=0, data[8]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -620,7 +825,7 @@ void ServerLobbyRoomProtocol::playerReversedVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc4); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
 
@@ -644,8 +849,11 @@ void ServerLobbyRoomProtocol::playerLapsVote(Event* event)
         return;
     if (!isByteCorrect(event, 7, 1))
         return;
+    ServerRoom *room = RoomManager::getInstance()->getRoom(peer);
+    if (!room)
+        return;
     uint8_t player_id = peer->getPlayerProfile()->race_id;
-    m_setup->getRaceConfig()->setPlayerLapsVote(player_id, data[6], data[8]);
+    room->getGameSetup()->getRaceConfig()->setPlayerLapsVote(player_id, data[6], data[8]);
     // Send the vote to everybody (including the sender)
     NetworkString other;
     other.ai8(1).ai8(player_id); // add the player id
@@ -653,6 +861,6 @@ void ServerLobbyRoomProtocol::playerLapsVote(Event* event)
     other += data; // add the data
     NetworkString prefix;
     prefix.ai8(0xc5); // prefix the token with the ype
-    sendMessageToPeersChangingToken(prefix, other);
+    sendMessageToRoomChangingToken(room, prefix, other);
 }
 //-----------------------------------------------------------------------------
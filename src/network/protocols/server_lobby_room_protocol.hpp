@@ -3,6 +3,9 @@
 
 #include "network/protocols/lobby_room_protocol.hpp"
 
+class ServerRoom;
+namespace Online { class XMLRequest; }
+
 class ServerLobbyRoomProtocol : public LobbyRoomProtocol
 {
     public:
@@ -14,15 +17,17 @@ class ServerLobbyRoomProtocol : public LobbyRoomProtocol
         virtual void update();
         virtual void asynchronousUpdate() {};
 
-        void startGame();
-        void startSelection();
+        void startGame(uint8_t room_id = 0);
+        void startSelection(uint8_t room_id = 0);
         void checkIncomingConnectionRequests();
+        void handleConnectionRequestsPoll();
         void checkRaceFinished();
 
     protected:
         // connection management
         void kartDisconnected(Event* event);
         void connectionRequested(Event* event);
+        void spectatorRequested(STKPeer* peer);
         // kart selection
         void kartSelectionRequested(Event* event);
         // race votes
@@ -32,14 +37,24 @@ class ServerLobbyRoomProtocol : public LobbyRoomProtocol
         void playerTrackVote(Event* event);
         void playerReversedVote(Event* event);
         void playerLapsVote(Event* event);
+        // room messages
+        void sendMessageToRoom(ServerRoom *room, const NetworkString &message,
+                               STKPeer *except = NULL);
+        void sendMessageToRoomChangingToken(ServerRoom *room,
+                                            const NetworkString &prefix,
+                                            const NetworkString &message);
 
         uint8_t m_next_id; //!< Next id to assign to a peer.
         std::vector<TransportAddress> m_peers;
         std::vector<uint32_t> m_incoming_peers_ids;
         uint32_t m_current_protocol_id;
         TransportAddress m_public_address;
-        bool m_selection_enabled;
-        bool m_in_race;
+        /** The poll for connection requests that is being executed, or NULL. */
+        Online::XMLRequest *m_poll_request;
+        /** Time at which the master server is polled next. */
+        double m_next_poll_time;
+        /** Current time between polls, increased after errors. */
+        double m_poll_interval;
 
         enum STATE
         {
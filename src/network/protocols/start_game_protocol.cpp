@@ -187,7 +187,7 @@ void StartGameProtocol::update()
     else if (m_state == READY)
     {
         // set karts into the network game setup
-        NetworkManager::getInstance()->getGameSetup()->bindKartsToProfiles();
+        m_game_setup->bindKartsToProfiles();
         m_state = EXITING;
         m_listener->requestTerminate(this);
     }
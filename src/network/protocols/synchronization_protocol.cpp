@@ -1,9 +1,11 @@
 #include "network/protocols/synchronization_protocol.hpp"
 
 #include "network/network_manager.hpp"
+#include "network/protocols/ball_update_protocol.hpp"
 #include "network/protocols/kart_update_protocol.hpp"
 #include "network/protocols/controller_events_protocol.hpp"
 #include "network/protocols/game_events_protocol.hpp"
+#include "race/race_manager.hpp"
 #include "utils/time.hpp"
 
 //-----------------------------------------------------------------------------
@@ -133,6 +135,8 @@ void SynchronizationProtocol::asynchronousUpdate()
             m_has_quit = true;
             Log::info("SynchronizationProtocol", "Countdown finished. Starting now.");
             m_listener->requestStart(new KartUpdateProtocol());
+            if (race_manager->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
+                m_listener->requestStart(new BallUpdateProtocol());
             m_listener->requestStart(new ControllerEventsProtocol());
             m_listener->requestStart(new GameEventsProtocol());
             m_listener->requestTerminate(this);
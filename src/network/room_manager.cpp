@@ -0,0 +1,184 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/room_manager.hpp"
+
+#include "network/game_setup.hpp"
+#include "network/race_config.hpp"
+#include "network/server_room.hpp"
+#include "utils/log.hpp"
+
+RoomManager::RoomManager()
+{
+    m_race_room   = NULL;
+    m_max_players = 0;
+    m_max_rooms   = 1;
+    pthread_mutex_init(&m_rooms_mutex, NULL);
+}   // RoomManager
+
+// ----------------------------------------------------------------------------
+RoomManager::~RoomManager()
+{
+    for (unsigned int i = 0; i < m_rooms.size(); i++)
+        delete m_rooms[i];
+    m_rooms.clear();
+    pthread_mutex_destroy(&m_rooms_mutex);
+}   // ~RoomManager
+
+// ----------------------------------------------------------------------------
+/** Initialises the room manager with the first room.
+ *  \param default_setup The game setup of the first room, which is owned
+ *         by the network manager.
+ *  \param max_players Maximum number of players per room.
+ *  \param max_rooms Maximum number of rooms.
+ */
+void RoomManager::init(GameSetup *default_setup, unsigned int max_players,
+                       unsigned int max_rooms)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    for (unsigned int i = 0; i < m_rooms.size(); i++)
+        delete m_rooms[i];
+    m_rooms.clear();
+    m_race_room   = NULL;
+    m_max_players = max_players;
+    // Room ids are sent as one byte
+    m_max_rooms   = max_rooms < 1 ? 1 : (max_rooms > 255 ? 255 : max_rooms);
+    default_setup->getRaceConfig()->setPlayerCount(max_players);
+    m_rooms.push_back(new ServerRoom(0, default_setup, /*owns_setup*/false));
+    pthread_mutex_unlock(&m_rooms_mutex);
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Puts a peer into a room that is not racing and has free slots. If no
+ *  such room exists, a new room is created.
+ *  \return The room the peer was added to, or NULL if all rooms are full.
+ */
+ServerRoom* RoomManager::joinRoom(STKPeer *peer)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    ServerRoom *room = NULL;
+    for (unsigned int i = 0; i < m_rooms.size(); i++)
+    {
+        if (m_rooms[i]->hasPeer(peer))
+        {
+            pthread_mutex_unlock(&m_rooms_mutex);
+            return m_rooms[i];
+        }
+        if (!room && m_rooms[i] != m_race_room &&
+            m_rooms[i]->getNumberOfPeers() < m_max_players)
+            room = m_rooms[i];
+    }
+    if (!room && m_rooms.size() < m_max_rooms)
+    {
+        GameSetup *setup = new GameSetup();
+        setup->getRaceConfig()->setPlayerCount(m_max_players);
+        room = new ServerRoom((uint8_t)m_rooms.size(), setup,
+                              /*owns_setup*/true);
+        m_rooms.push_back(room);
+        Log::info("RoomManager", "Created room %d.", room->getId());
+    }
+    if (room)
+        room->addPeer(peer);
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room;
+}   // joinRoom
+
+// ----------------------------------------------------------------------------
+/** Removes a peer from its room. */
+void RoomManager::leaveRoom(const STKPeer *peer)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    for (unsigned int i = 0; i < m_rooms.size(); i++)
+    {
+        if (m_rooms[i]->removePeer(peer))
+        {
+            if (m_rooms[i]->getNumberOfPeers() == 0)
+                m_rooms[i]->reset();
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_rooms_mutex);
+}   // leaveRoom
+
+// ----------------------------------------------------------------------------
+/** Returns the room a peer is in, or NULL if it is not in any room. */
+ServerRoom* RoomManager::getRoom(const STKPeer *peer) const
+{
+    ServerRoom *room = NULL;
+    pthread_mutex_lock(&m_rooms_mutex);
+    for (unsigned int i = 0; i < m_rooms.size() && !room; i++)
+    {
+        if (m_rooms[i]->hasPeer(peer))
+            room = m_rooms[i];
+    }
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room;
+}   // getRoom(STKPeer)
+
+// ----------------------------------------------------------------------------
+/** Returns the room with the given id, or NULL if it does not exist. */
+ServerRoom* RoomManager::getRoom(uint8_t id) const
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    ServerRoom *room = id < m_rooms.size() ? m_rooms[id] : NULL;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room;
+}   // getRoom(id)
+
+// ----------------------------------------------------------------------------
+/** Tries to start a race in the given room.
+ *  \return False if another room is currently racing.
+ */
+bool RoomManager::startRace(ServerRoom *room)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    bool ok = m_race_room == NULL || m_race_room == room;
+    if (ok)
+        m_race_room = room;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return ok;
+}   // startRace
+
+// ----------------------------------------------------------------------------
+/** Called when the race of a room is finished. */
+void RoomManager::finishRace(ServerRoom *room)
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    if (m_race_room == room)
+        m_race_room = NULL;
+    pthread_mutex_unlock(&m_rooms_mutex);
+}   // finishRace
+
+// ----------------------------------------------------------------------------
+/** Returns the room that is currently racing, or NULL. */
+ServerRoom* RoomManager::getRaceRoom() const
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    ServerRoom *room = m_race_room;
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return room;
+}   // getRaceRoom
+
+// ----------------------------------------------------------------------------
+unsigned int RoomManager::getNumberOfRooms() const
+{
+    pthread_mutex_lock(&m_rooms_mutex);
+    unsigned int n = (unsigned int)m_rooms.size();
+    pthread_mutex_unlock(&m_rooms_mutex);
+    return n;
+}   // getNumberOfRooms
@@ -0,0 +1,84 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file room_manager.hpp
+ *  \brief Manages the lobbies of a server.
+ */
+
+#ifndef ROOM_MANAGER_HPP
+#define ROOM_MANAGER_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/singleton.hpp"
+#include "utils/types.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+class GameSetup;
+class ServerRoom;
+class STKPeer;
+
+/*! \class RoomManager
+ *  \brief Allows one server process to host several independent lobbies.
+ *  Each connecting peer is put into a room that has free slots (creating
+ *  a new room if necessary), and all lobby messages are only exchanged
+ *  between the peers of one room. Since World, the physics and the race
+ *  manager exist only once per process, only one room at a time can race;
+ *  the other rooms can meanwhile keep on voting and selecting karts.
+ *  Rooms are never deleted while the server is running, empty rooms are
+ *  reused instead, so pointers returned by this class stay valid.
+ *  \ingroup network
+ */
+class RoomManager : public Singleton<RoomManager>, public NoCopy
+{
+    friend class Singleton<RoomManager>;
+private:
+    /** All rooms, indexed by room id. */
+    std::vector<ServerRoom*> m_rooms;
+
+    /** The room that is currently racing, or NULL. */
+    ServerRoom *m_race_room;
+
+    /** Maximum number of players in a room. */
+    unsigned int m_max_players;
+
+    /** Maximum number of rooms. */
+    unsigned int m_max_rooms;
+
+    /** Protects the room data, which is accessed from the protocol threads
+     *  and the server console. */
+    mutable pthread_mutex_t m_rooms_mutex;
+
+             RoomManager();
+            ~RoomManager();
+
+public:
+    void        init(GameSetup *default_setup, unsigned int max_players,
+                     unsigned int max_rooms);
+    ServerRoom* joinRoom(STKPeer *peer);
+    void        leaveRoom(const STKPeer *peer);
+    ServerRoom* getRoom(const STKPeer *peer) const;
+    ServerRoom* getRoom(uint8_t id) const;
+    bool        startRace(ServerRoom *room);
+    void        finishRace(ServerRoom *room);
+    ServerRoom* getRaceRoom() const;
+    unsigned int getNumberOfRooms() const;
+};   // RoomManager
+
+#endif // ROOM_MANAGER_HPP
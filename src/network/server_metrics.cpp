@@ -0,0 +1,347 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/server_metrics.hpp"
+
+#include "network/network_manager.hpp"
+#include "network/protocol_manager.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/log.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+const float ServerMetrics::m_tick_buckets[] =
+    { 1.0f, 2.0f, 5.0f, 10.0f, 16.0f, 25.0f, 50.0f, 100.0f };
+
+bool       ServerMetrics::m_enabled = false;
+ENetSocket ServerMetrics::m_socket  = ENET_SOCKET_NULL;
+std::vector<std::pair<ENetSocket, double> > ServerMetrics::m_connections;
+std::atomic<long long> ServerMetrics::m_packets_in[NUM_PACKET_TYPES];
+std::atomic<long long> ServerMetrics::m_bytes_in[NUM_PACKET_TYPES];
+std::atomic<long long> ServerMetrics::m_packets_out[NUM_PACKET_TYPES];
+std::atomic<long long> ServerMetrics::m_bytes_out[NUM_PACKET_TYPES];
+std::atomic<long long> ServerMetrics::m_tick_counts[NUM_TICK_BUCKETS + 1];
+std::atomic<long long> ServerMetrics::m_late_ticks;
+std::atomic<long long> ServerMetrics::m_tick_time_sum;
+
+/** Names of the packet types, i.e. of the protocol types. */
+static const char *g_packet_type_names[ServerMetrics::NUM_PACKET_TYPES] =
+    { "none", "connection", "lobby_room", "start_game", "synchronization",
+      "kart_update", "game_events", "controller_events", "other" };
+
+/** Requests that were not completely received after this time (in seconds)
+ *  are dropped. */
+static const double CONNECTION_TIMEOUT = 2.0;
+
+// ----------------------------------------------------------------------------
+/** Starts to collect the metrics, and to listen for HTTP requests.
+ *  \param port The local TCP port the metrics can be requested on.
+ */
+void ServerMetrics::init(int port)
+{
+    for (unsigned int i = 0; i < NUM_PACKET_TYPES; i++)
+    {
+        m_packets_in[i] = m_bytes_in[i] = 0;
+        m_packets_out[i] = m_bytes_out[i] = 0;
+    }
+    for (unsigned int i = 0; i <= NUM_TICK_BUCKETS; i++)
+        m_tick_counts[i] = 0;
+    m_late_ticks    = 0;
+    m_tick_time_sum = 0;
+
+    m_socket = enet_socket_create(ENET_SOCKET_TYPE_STREAM);
+    if (m_socket == ENET_SOCKET_NULL)
+    {
+        Log::error("ServerMetrics", "Can't create the metrics socket.");
+        return;
+    }
+    ENetAddress address;
+    enet_address_set_host(&address, "127.0.0.1");
+    address.port = (enet_uint16)port;
+    enet_socket_set_option(m_socket, ENET_SOCKOPT_REUSEADDR, 1);
+    if (enet_socket_bind(m_socket, &address) < 0 ||
+        enet_socket_listen(m_socket, 4) < 0)
+    {
+        Log::error("ServerMetrics", "Can't listen on port %d for metrics.",
+                   port);
+        enet_socket_destroy(m_socket);
+        m_socket = ENET_SOCKET_NULL;
+        return;
+    }
+    enet_socket_set_option(m_socket, ENET_SOCKOPT_NONBLOCK, 1);
+    m_enabled = true;
+    Log::info("ServerMetrics", "Metrics available on "
+              "http://127.0.0.1:%d/metrics", port);
+}   // init
+
+// ----------------------------------------------------------------------------
+/** Stops collecting the metrics and closes all sockets. */
+void ServerMetrics::destroy()
+{
+    m_enabled = false;
+    for (unsigned int i = 0; i < m_connections.size(); i++)
+        enet_socket_destroy(m_connections[i].first);
+    m_connections.clear();
+    if (m_socket != ENET_SOCKET_NULL)
+        enet_socket_destroy(m_socket);
+    m_socket = ENET_SOCKET_NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Accepts new connections and answers all complete requests. This never
+ *  blocks, and is called once per server tick.
+ */
+void ServerMetrics::update()
+{
+    if (!m_enabled)
+        return;
+
+    ENetSocket connection = enet_socket_accept(m_socket, NULL);
+    if (connection != ENET_SOCKET_NULL)
+    {
+        enet_socket_set_option(connection, ENET_SOCKOPT_NONBLOCK, 1);
+        m_connections.push_back(std::make_pair(connection,
+                                               StkTime::getRealTime()));
+    }
+
+    for (unsigned int i = 0; i < m_connections.size();)
+    {
+        // The request itself does not matter, every request gets the
+        // metrics. So it is enough that the end of the headers arrived.
+        char buffer[1024];
+        ENetBuffer enet_buffer;
+        enet_buffer.data       = buffer;
+        enet_buffer.dataLength = sizeof(buffer) - 1;
+        int len = enet_socket_receive(m_connections[i].first, NULL,
+                                      &enet_buffer, 1);
+        bool done = len < 0;
+        if (len > 0)
+        {
+            buffer[len] = 0;
+            if (strstr(buffer, "\r\n\r\n") || strstr(buffer, "\n\n"))
+            {
+                sendMetrics(m_connections[i].first);
+                done = true;
+            }
+        }
+        if (!done && StkTime::getRealTime() >
+                     m_connections[i].second + CONNECTION_TIMEOUT)
+            done = true;
+
+        if (done)
+        {
+            enet_socket_destroy(m_connections[i].first);
+            m_connections.erase(m_connections.begin() + i);
+        }
+        else
+            i++;
+    }
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Sends the HTTP response with all metrics.
+ *  \param socket The connection to send the response to.
+ */
+void ServerMetrics::sendMetrics(ENetSocket socket)
+{
+    const std::string body = getMetrics();
+    std::string response = "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + StringUtils::toString(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+
+    // The response is small, so it should fit in the socket buffer. Wait
+    // until it was sent in any case, it is a local connection.
+    enet_socket_set_option(socket, ENET_SOCKOPT_NONBLOCK, 0);
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        ENetBuffer buffer;
+        buffer.data       = (void*)(response.c_str() + sent);
+        buffer.dataLength = response.size() - sent;
+        int len = enet_socket_send(socket, NULL, &buffer, 1);
+        if (len <= 0)
+            break;
+        sent += len;
+    }
+}   // sendMetrics
+
+// ----------------------------------------------------------------------------
+/** Counts a packet for the protocol it belongs to.
+ *  \param packets The packet counters.
+ *  \param bytes The byte counters.
+ *  \param packet The packet.
+ *  \param count Number of peers the packet was sent to or received from.
+ */
+void ServerMetrics::addPacket(std::atomic<long long> *packets,
+                              std::atomic<long long> *bytes,
+                              const ENetPacket *packet, unsigned int count)
+{
+    // The first byte of a packet is the protocol type, except for the few
+    // packets sent without protocol, which are counted as 'other'
+    unsigned int type = packet->dataLength > 0 ? packet->data[0]
+                                                : NUM_PACKET_TYPES - 1;
+    if (type >= NUM_PACKET_TYPES)
+        type = NUM_PACKET_TYPES - 1;
+    packets[type].fetch_add(count, std::memory_order_relaxed);
+    bytes[type].fetch_add((long long)packet->dataLength * count,
+                          std::memory_order_relaxed);
+}   // addPacket
+
+// ----------------------------------------------------------------------------
+/** Records the duration of one server tick.
+ *  \param ms Duration of the tick in ms.
+ */
+void ServerMetrics::addTickTime(float ms)
+{
+    if (!m_enabled)
+        return;
+    unsigned int bucket = 0;
+    while (bucket < NUM_TICK_BUCKETS && ms > m_tick_buckets[bucket])
+        bucket++;
+    m_tick_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_tick_time_sum.fetch_add((long long)(ms * 1000.0f),
+                              std::memory_order_relaxed);
+}   // addTickTime
+
+// ----------------------------------------------------------------------------
+/** Counts a tick that started too late. */
+void ServerMetrics::addLateTick()
+{
+    if (m_enabled)
+        m_late_ticks.fetch_add(1, std::memory_order_relaxed);
+}   // addLateTick
+
+// ----------------------------------------------------------------------------
+/** Appends the header of a metric in the Prometheus text format. */
+static void addHeader(std::string *out, const char *name, const char *type,
+                      const char *help)
+{
+    *out += std::string("# HELP ") + name + " " + help + "\n"
+          + "# TYPE " + name + " " + type + "\n";
+}   // addHeader
+
+// ----------------------------------------------------------------------------
+/** Appends the values of a counter for all packet types. */
+static void addPacketCounter(std::string *out, const char *name,
+                             const char *help,
+                             const std::atomic<long long> *values)
+{
+    addHeader(out, name, "counter", help);
+    char line[256];
+    for (unsigned int i = 0; i < ServerMetrics::NUM_PACKET_TYPES; i++)
+    {
+        snprintf(line, sizeof(line), "%s{protocol=\"%s\"} %lld\n", name,
+                 g_packet_type_names[i], values[i].load());
+        *out += line;
+    }
+}   // addPacketCounter
+
+// ----------------------------------------------------------------------------
+/** Returns all metrics in the Prometheus text format. */
+std::string ServerMetrics::getMetrics()
+{
+    std::string out;
+    char line[256];
+
+    addPacketCounter(&out, "stk_packets_received_total",
+                     "Packets received from all peers.", m_packets_in);
+    addPacketCounter(&out, "stk_bytes_received_total",
+                     "Bytes received from all peers.", m_bytes_in);
+    addPacketCounter(&out, "stk_packets_sent_total",
+                     "Packets sent, counted once per peer.", m_packets_out);
+    addPacketCounter(&out, "stk_bytes_sent_total",
+                     "Bytes sent, counted once per peer.", m_bytes_out);
+
+    addHeader(&out, "stk_tick_duration_ms", "histogram",
+              "Time needed to compute one server tick.");
+    long long count = 0;
+    for (unsigned int i = 0; i <= NUM_TICK_BUCKETS; i++)
+    {
+        count += m_tick_counts[i].load();
+        if (i < NUM_TICK_BUCKETS)
+            snprintf(line, sizeof(line),
+                     "stk_tick_duration_ms_bucket{le=\"%g\"} %lld\n",
+                     m_tick_buckets[i], count);
+        else
+            snprintf(line, sizeof(line),
+                     "stk_tick_duration_ms_bucket{le=\"+Inf\"} %lld\n", count);
+        out += line;
+    }
+    snprintf(line, sizeof(line), "stk_tick_duration_ms_sum %.3f\n"
+             "stk_tick_duration_ms_count %lld\n",
+             m_tick_time_sum.load() / 1000.0, count);
+    out += line;
+
+    addHeader(&out, "stk_late_ticks_total", "counter",
+              "Ticks that started more than one tick too late.");
+    snprintf(line, sizeof(line), "stk_late_ticks_total %lld\n",
+             m_late_ticks.load());
+    out += line;
+
+    NetworkManager *network_manager = NetworkManager::getInstance();
+    if (network_manager)
+    {
+        std::vector<STKPeer*> peers = network_manager->getPeers();
+        addHeader(&out, "stk_peers", "gauge", "Connected peers.");
+        snprintf(line, sizeof(line), "stk_peers %u\n",
+                 (unsigned int)peers.size());
+        out += line;
+
+        addHeader(&out, "stk_peer_round_trip_time_ms", "gauge",
+                  "Mean round trip time to each peer, measured by ENet.");
+        for (unsigned int i = 0; i < peers.size(); i++)
+        {
+            const uint32_t ip = peers[i]->getAddress();
+            snprintf(line, sizeof(line),
+                     "stk_peer_round_trip_time_ms{peer=\"%u.%u.%u.%u:%u\"} "
+                     "%u\n", (ip >> 24) & 0xff, (ip >> 16) & 0xff,
+                     (ip >> 8) & 0xff, ip & 0xff, peers[i]->getPort(),
+                     peers[i]->getRoundTripTime());
+            out += line;
+        }
+    }
+
+    ProtocolManager *protocol_manager = ProtocolManager::getInstance();
+    if (protocol_manager)
+    {
+        addHeader(&out, "stk_queued_events", "gauge",
+                  "Network events waiting to be given to the protocols.");
+        snprintf(line, sizeof(line), "stk_queued_events %d\n",
+                 protocol_manager->getQueuedEventCount());
+        out += line;
+    }
+
+#ifdef ENABLE_MEMORY_TRACKING
+    addHeader(&out, "stk_allocations_total", "counter",
+              "Memory allocations done with new.");
+    snprintf(line, sizeof(line), "stk_allocations_total %lld\n",
+             MemoryTracker::getAllocationCount());
+    out += line;
+    addHeader(&out, "stk_heap_bytes", "gauge",
+              "Memory allocated with new and not freed yet.");
+    snprintf(line, sizeof(line), "stk_heap_bytes %lld\n",
+             MemoryTracker::getHeapSize());
+    out += line;
+#endif
+
+    return out;
+}   // getMetrics
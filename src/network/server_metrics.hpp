@@ -0,0 +1,100 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SERVER_METRICS_HPP
+#define HEADER_SERVER_METRICS_HPP
+
+#include <enet/enet.h>
+
+#include <atomic>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Counters and histograms of a dedicated server, which can be read
+ *  by a monitoring system (e.g. Prometheus) over HTTP.
+ *  The metrics are only collected if the server_metrics_port is set. The
+ *  counters are atomic, so they can be updated by the network thread and by
+ *  the main thread without locking. The values that can be read at any time
+ *  (peers, round trip times, event queue, allocations) are only collected
+ *  when the metrics are requested. The HTTP socket only listens on the local
+ *  host, and is polled once per server tick, so nothing else has to be done
+ *  if nobody requests the metrics.
+ * \ingroup network
+ */
+class ServerMetrics
+{
+public:
+    /** Number of packet types counted: all protocol types, and one for
+     *  packets that do not belong to a protocol. */
+    enum { NUM_PACKET_TYPES = 9 };
+
+private:
+    /** Upper bounds (in ms) of the buckets of the tick time histogram. */
+    static const float m_tick_buckets[];
+    enum { NUM_TICK_BUCKETS = 8 };
+
+    static bool                    m_enabled;
+    static ENetSocket              m_socket;
+
+    /** Connections accepted whose request was not received yet, and the
+     *  time at which they were accepted. */
+    static std::vector<std::pair<ENetSocket, double> > m_connections;
+
+    static std::atomic<long long>  m_packets_in[NUM_PACKET_TYPES];
+    static std::atomic<long long>  m_bytes_in[NUM_PACKET_TYPES];
+    static std::atomic<long long>  m_packets_out[NUM_PACKET_TYPES];
+    static std::atomic<long long>  m_bytes_out[NUM_PACKET_TYPES];
+    static std::atomic<long long>  m_tick_counts[NUM_TICK_BUCKETS + 1];
+    static std::atomic<long long>  m_late_ticks;
+    /** Sum of all tick times in microseconds. */
+    static std::atomic<long long>  m_tick_time_sum;
+
+    static void        addPacket(std::atomic<long long> *packets,
+                                 std::atomic<long long> *bytes,
+                                 const ENetPacket *packet, unsigned int count);
+    static std::string getMetrics();
+    static void        sendMetrics(ENetSocket socket);
+
+public:
+    static void init(int port);
+    static void destroy();
+    static void update();
+    static void addTickTime(float ms);
+    static void addLateTick();
+
+    // ------------------------------------------------------------------------
+    /** Counts a packet received from a peer. */
+    static void addIncomingPacket(const ENetPacket *packet)
+    {
+        if (m_enabled)
+            addPacket(m_packets_in, m_bytes_in, packet, 1);
+    }   // addIncomingPacket
+    // ------------------------------------------------------------------------
+    /** Counts a packet sent to a number of peers. */
+    static void addOutgoingPacket(const ENetPacket *packet, unsigned int count)
+    {
+        if (m_enabled)
+            addPacket(m_packets_out, m_bytes_out, packet, count);
+    }   // addOutgoingPacket
+    // ------------------------------------------------------------------------
+    /** Returns if the metrics are collected. */
+    static bool isEnabled() { return m_enabled; }
+};   // ServerMetrics
+
+#endif
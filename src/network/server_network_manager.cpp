@@ -18,6 +18,7 @@
 
 #include "network/server_network_manager.hpp"
 
+#include "config/user_config.hpp"
 #include "main_loop.hpp"
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/get_peer_address.hpp"
@@ -26,11 +27,14 @@
 #include "network/protocols/server_lobby_room_protocol.hpp"
 #include "network/protocols/show_public_address.hpp"
 #include "network/protocols/stop_server.hpp"
+#include "network/room_manager.hpp"
+#include "network/server_room.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
 #include <enet/enet.h>
 #include <pthread.h>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <stdlib.h>
@@ -50,17 +54,18 @@ void* waitInput2(void* data)
         {
             ServerNetworkManager::getInstance()->kickAllPlayers();
         }
-        else if (str == "start")
+        else if (str == "start" || str.compare(0, 6, "start ") == 0)
         {
+            // "start n" starts the race in room n
             ServerLobbyRoomProtocol* protocol = static_cast<ServerLobbyRoomProtocol*>(ProtocolManager::getInstance()->getProtocol(PROTOCOL_LOBBY_ROOM));
             assert(protocol);
-            protocol->startGame();
+            protocol->startGame(str.size() > 6 ? atoi(str.c_str()+6) : 0);
         }
-        else if (str == "selection")
+        else if (str == "selection" || str.compare(0, 10, "selection ") == 0)
         {
             ServerLobbyRoomProtocol* protocol = static_cast<ServerLobbyRoomProtocol*>(ProtocolManager::getInstance()->getProtocol(PROTOCOL_LOBBY_ROOM));
             assert(protocol);
-            protocol->startSelection();
+            protocol->startSelection(str.size() > 10 ? atoi(str.c_str()+10) : 0);
         }
         else if (str == "compute_race")
         {
@@ -105,7 +110,12 @@ void ServerNetworkManager::run()
         return;
     }
     m_localhost = new STKHost();
-    m_localhost->setupServer(STKHost::HOST_ANY, 7321, 16, 2, 0, 0);
+    // All rooms share the same host
+    int peer_count = UserConfigParams::m_server_max_players *
+                     std::max(1, (int)UserConfigParams::m_server_max_rooms);
+    m_localhost->setupServer(STKHost::HOST_ANY, 7321,
+                             std::min(peer_count, (int)ENET_PROTOCOL_MAXIMUM_PEER_ID),
+                             STKHost::CHANNEL_COUNT, 0, 0);
     m_localhost->startListening();
 
     Log::info("ServerNetworkManager", "Host initialized.");
@@ -118,6 +128,15 @@ void ServerNetworkManager::run()
     Log::info("ServerNetworkManager", "Ready.");
 }
 
+/** Returns the game setup of the room that is racing, or of the first room
+ *  if no race is running. The race protocols use this to find the players
+ *  of the current race. */
+GameSetup* ServerNetworkManager::getGameSetup()
+{
+    ServerRoom *room = RoomManager::getInstance()->getRaceRoom();
+    return room ? room->getGameSetup() : m_game_setup;
+}
+
 void ServerNetworkManager::kickAllPlayers()
 {
     for (unsigned int i = 0; i < m_peers.size(); i++)
@@ -130,3 +149,8 @@ void ServerNetworkManager::sendPacket(const NetworkString& data, bool reliable)
 {
     m_localhost->broadcastPacket(data, reliable);
 }
+
+void ServerNetworkManager::sendPacket(ENetPacket* packet, uint8_t channel)
+{
+    m_localhost->broadcastPacket(packet, channel);
+}
@@ -42,8 +42,10 @@ class ServerNetworkManager : public NetworkManager
         void kickAllPlayers();
 
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
+        virtual void sendPacket(ENetPacket* packet, uint8_t channel);
 
         virtual bool isServer()         { return true; }
+        virtual GameSetup* getGameSetup();
 
     protected:
         ServerNetworkManager();
@@ -0,0 +1,87 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/server_room.hpp"
+
+#include "network/game_setup.hpp"
+#include "network/stk_peer.hpp"
+
+/** Creates a room.
+ *  \param id Id of the room.
+ *  \param setup The game setup to use for this room.
+ *  \param owns_setup If true, the setup will be deleted with this room.
+ */
+ServerRoom::ServerRoom(uint8_t id, GameSetup *setup, bool owns_setup)
+{
+    m_id                = id;
+    m_setup             = setup;
+    m_owns_setup        = owns_setup;
+    m_selection_enabled = false;
+}   // ServerRoom
+
+// ----------------------------------------------------------------------------
+ServerRoom::~ServerRoom()
+{
+    if (m_owns_setup)
+        delete m_setup;
+}   // ~ServerRoom
+
+// ----------------------------------------------------------------------------
+/** Adds a peer to this room. */
+void ServerRoom::addPeer(STKPeer *peer)
+{
+    m_peers.push_back(peer);
+}   // addPeer
+
+// ----------------------------------------------------------------------------
+/** Removes a peer from this room.
+ *  \return True if the peer was in this room.
+ */
+bool ServerRoom::removePeer(const STKPeer *peer)
+{
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+    {
+        if (m_peers[i]->isSamePeer(peer))
+        {
+            m_peers.erase(m_peers.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}   // removePeer
+
+// ----------------------------------------------------------------------------
+/** Returns true if the given peer is in this room. */
+bool ServerRoom::hasPeer(const STKPeer *peer) const
+{
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+    {
+        if (m_peers[i]->isSamePeer(peer))
+            return true;
+    }
+    return false;
+}   // hasPeer
+
+// ----------------------------------------------------------------------------
+/** Resets the room once the last peer has left, so that it can be reused
+ *  for a new lobby. */
+void ServerRoom::reset()
+{
+    m_peers.clear();
+    m_selection_enabled = false;
+}   // reset
@@ -0,0 +1,89 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file server_room.hpp
+ *  \brief A single lobby on a server hosting several lobbies.
+ */
+
+#ifndef SERVER_ROOM_HPP
+#define SERVER_ROOM_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <vector>
+
+class GameSetup;
+class STKPeer;
+
+/*! \class ServerRoom
+ *  \brief Stores the state of one lobby of a server: the peers that are in
+ *  this room and the game setup (players, karts and votes) of the room.
+ *  Rooms are managed by the RoomManager.
+ *  \ingroup network
+ */
+class ServerRoom : public NoCopy
+{
+private:
+    /** Id of this room. */
+    uint8_t m_id;
+
+    /** The game setup of this room. */
+    GameSetup *m_setup;
+
+    /** True if m_setup is owned (and must be freed) by this room. */
+    bool m_owns_setup;
+
+    /** The peers in this room. */
+    std::vector<STKPeer*> m_peers;
+
+    /** True once the kart selection has been started in this room. */
+    bool m_selection_enabled;
+
+public:
+               ServerRoom(uint8_t id, GameSetup *setup, bool owns_setup);
+              ~ServerRoom();
+    void       addPeer(STKPeer *peer);
+    bool       removePeer(const STKPeer *peer);
+    bool       hasPeer(const STKPeer *peer) const;
+    void       reset();
+
+    // ------------------------------------------------------------------------
+    /** Returns the id of this room. */
+    uint8_t getId() const { return m_id; }
+    // ------------------------------------------------------------------------
+    /** Returns the game setup of this room. */
+    GameSetup* getGameSetup() { return m_setup; }
+    // ------------------------------------------------------------------------
+    /** Returns the peers in this room. */
+    const std::vector<STKPeer*>& getPeers() const { return m_peers; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of peers in this room. */
+    unsigned int getNumberOfPeers() const
+    {
+        return (unsigned int)m_peers.size();
+    }   // getNumberOfPeers
+    // ------------------------------------------------------------------------
+    /** Returns true if the kart selection was started in this room. */
+    bool isSelectionEnabled() const { return m_selection_enabled; }
+    // ------------------------------------------------------------------------
+    /** Enables or disables the kart selection. */
+    void setSelectionEnabled(bool enabled) { m_selection_enabled = enabled; }
+};   // ServerRoom
+
+#endif // SERVER_ROOM_HPP
@@ -0,0 +1,145 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/server_tick_scheduler.hpp"
+
+#include "network/protocol_manager.hpp"
+#include "network/server_metrics.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <map>
+
+/** Creates the scheduler.
+ *  \param ticks_per_second Number of ticks per second, i.e. the number of
+ *         world time steps simulated per second.
+ */
+ServerTickScheduler::ServerTickScheduler(int ticks_per_second)
+{
+    m_step            = 1000.0 / ticks_per_second;
+    m_next_tick_time  = getTimeMilliseconds();
+    m_tick_start      = m_next_tick_time;
+    m_sleep_overshoot = 1.0;
+    m_late_ticks      = 0;
+    // Log the statistics once per minute
+    m_report_ticks    = 60 * ticks_per_second;
+    m_tick_durations.reserve(m_report_ticks);
+}   // ServerTickScheduler
+
+// ----------------------------------------------------------------------------
+/** Sleeps until the next tick should start.
+ */
+void ServerTickScheduler::waitForNextTick()
+{
+    m_next_tick_time += m_step;
+    double now = getTimeMilliseconds();
+    if (now > m_next_tick_time + m_step)
+    {
+        // More than one tick late: start again from now instead of running
+        // ticks back to back to catch up
+        m_late_ticks++;
+        ServerMetrics::addLateTick();
+        m_next_tick_time = now;
+    }
+
+    // Sleep a bit less than necessary and wait actively for the rest, but
+    // never more than 2 ms actively
+    const int sleep_time = (int)(m_next_tick_time - now
+                                 - std::min(m_sleep_overshoot, 2.0));
+    if (sleep_time > 0)
+    {
+        StkTime::sleep(sleep_time);
+        double after_sleep = getTimeMilliseconds();
+        double overshoot = after_sleep - now - sleep_time;
+        m_sleep_overshoot = 0.9 * m_sleep_overshoot
+                          + 0.1 * std::max(overshoot, 0.0);
+        now = after_sleep;
+    }
+    while (now < m_next_tick_time)
+    {
+        StkTime::sleep(0);
+        now = getTimeMilliseconds();
+    }
+    m_tick_start = now;
+}   // waitForNextTick
+
+// ----------------------------------------------------------------------------
+/** Records the duration of the tick that just ended, and logs the
+ *  statistics if enough ticks were recorded.
+ */
+void ServerTickScheduler::endTick()
+{
+    const float duration = (float)(getTimeMilliseconds() - m_tick_start);
+    m_tick_durations.push_back(duration);
+    ServerMetrics::addTickTime(duration);
+    if (m_tick_durations.size() >= m_report_ticks)
+        report();
+}   // endTick
+
+// ----------------------------------------------------------------------------
+/** Returns a percentile of sorted values.
+ *  \param sorted The values, sorted in increasing order.
+ *  \param percentile The percentile, between 0 and 1.
+ */
+float ServerTickScheduler::getPercentile(const std::vector<float> &sorted,
+                                         float percentile) const
+{
+    if (sorted.empty())
+        return 0.0f;
+    size_t index = (size_t)(percentile * (sorted.size() - 1) + 0.5f);
+    return sorted[index];
+}   // getPercentile
+
+// ----------------------------------------------------------------------------
+/** Logs the statistics of the ticks since the last report and resets them.
+ *  This is done once per minute and when the server stops.
+ */
+void ServerTickScheduler::report()
+{
+    if (m_tick_durations.empty())
+        return;
+
+    std::vector<float> sorted = m_tick_durations;
+    std::sort(sorted.begin(), sorted.end());
+    unsigned int overruns = 0;
+    for (unsigned int i = 0; i < sorted.size(); i++)
+    {
+        if (sorted[i] > m_step)
+            overruns++;
+    }
+    Log::info("ServerTickScheduler",
+              "%u ticks of %.2f ms: median %.2f ms, 95%% %.2f ms, "
+              "99%% %.2f ms, max %.2f ms, %u over budget, %u late.",
+              (unsigned int)sorted.size(), m_step,
+              getPercentile(sorted, 0.5f), getPercentile(sorted, 0.95f),
+              getPercentile(sorted, 0.99f), sorted.back(), overruns,
+              m_late_ticks);
+
+    std::map<int, double> protocol_times;
+    ProtocolManager::getInstance()->getUpdateTimes(&protocol_times);
+    for (std::map<int, double>::const_iterator it = protocol_times.begin();
+         it != protocol_times.end(); it++)
+    {
+        Log::info("ServerTickScheduler", "Protocol type %d: %.2f ms per tick.",
+                  it->first, it->second / sorted.size());
+    }
+
+    m_tick_durations.clear();
+    m_late_ticks = 0;
+}   // report
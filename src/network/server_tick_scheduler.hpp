@@ -0,0 +1,74 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SERVER_TICK_SCHEDULER_HPP
+#define HEADER_SERVER_TICK_SCHEDULER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+/**
+ * \brief Runs the simulation of a dedicated server at a fixed rate.
+ *  Each tick simulates exactly one world time step. The scheduler sleeps
+ *  until the start of the next tick (waiting actively for the last
+ *  millisecond, like the frame rate limiter of the client). A tick that
+ *  starts more than one step late is counted as late, and the schedule
+ *  restarts from the current time instead of running several ticks to catch
+ *  up. The duration of all ticks is recorded, and the percentiles, the number
+ *  of late ticks and the time spent in each protocol are logged regularly.
+ * \ingroup network
+ */
+class ServerTickScheduler : public NoCopy
+{
+private:
+    /** Duration of one tick in ms. */
+    double m_step;
+
+    /** Time (in ms) at which the next tick should start. */
+    double m_next_tick_time;
+
+    /** Time at which the current tick started. */
+    double m_tick_start;
+
+    /** Moving average of how much longer (in ms) a sleep takes than
+     *  requested. */
+    double m_sleep_overshoot;
+
+    /** Durations (in ms) of the ticks since the last report. */
+    std::vector<float> m_tick_durations;
+
+    /** Number of ticks that started late since the last report. */
+    unsigned int m_late_ticks;
+
+    /** Number of ticks after which the statistics are logged. */
+    unsigned int m_report_ticks;
+
+    float getPercentile(const std::vector<float> &sorted,
+                        float percentile) const;
+
+public:
+         ServerTickScheduler(int ticks_per_second);
+    void waitForNextTick();
+    void endTick();
+    void report();
+    // ------------------------------------------------------------------------
+    /** Returns the duration of a tick in seconds. */
+    float getStep() const { return (float)(m_step / 1000.0); }
+};   // ServerTickScheduler
+
+#endif
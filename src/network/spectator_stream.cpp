@@ -0,0 +1,83 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/spectator_stream.hpp"
+
+#include "config/stk_config.hpp"
+#include "network/network_string.hpp"
+
+SpectatorStream::SpectatorStream()
+{
+    m_messages_since_keyframe = 0;
+}   // SpectatorStream
+
+// ----------------------------------------------------------------------------
+/** Adds a snapshot taken by the server. Only every n-th snapshot (see
+ *  stk_config) is kept for the spectators.
+ *  \param time The world time of the snapshot.
+ *  \param snapshot The snapshot with the state of all karts.
+ */
+void SpectatorStream::addSnapshot(float time,
+                                  const KartStateSnapshot &snapshot)
+{
+    const int interval = stk_config->m_network_spectator_interval;
+    if (interval > 1 && snapshot.getId() % interval != 0)
+        return;
+    DelayedSnapshot delayed;
+    delayed.m_time     = time;
+    delayed.m_snapshot = snapshot;
+    m_snapshots.push_back(delayed);
+}   // addSnapshot
+
+// ----------------------------------------------------------------------------
+/** Creates the next message for the spectators, if a snapshot is due.
+ *  \param time The current world time.
+ *  \param ns The string to write the message to.
+ *  \return True if a message was written, false if no snapshot is due.
+ */
+bool SpectatorStream::getMessage(float time, NetworkString *ns)
+{
+    const float due_time = time - stk_config->m_network_spectator_delay;
+    if (m_snapshots.empty() || m_snapshots.front().m_time > due_time)
+        return false;
+    // Only send the newest due snapshot, in case several are due at once
+    while (m_snapshots.size() > 1 && m_snapshots[1].m_time <= due_time)
+        m_snapshots.pop_front();
+    const DelayedSnapshot &delayed = m_snapshots.front();
+    const KartStateSnapshot &snapshot = delayed.m_snapshot;
+
+    const KartStateSnapshot *baseline = &m_last_sent;
+    if (m_last_sent.getId() == KartStateSnapshot::NO_BASELINE ||
+        m_last_sent.getNumberOfKarts() != snapshot.getNumberOfKarts() ||
+        (uint16_t)(snapshot.getId() - m_last_sent.getId()) >= MAX_BASELINE_AGE ||
+        m_messages_since_keyframe + 1 >= KEYFRAME_INTERVAL)
+    {
+        baseline = NULL;
+        m_messages_since_keyframe = 0;
+    }
+    else
+        m_messages_since_keyframe++;
+
+    // Same header as the messages to the players, without a client time
+    // to echo (indicated by the negative hold time).
+    ns->af(delayed.m_time).af(0.0f).af(-1.0f);
+    snapshot.encode(baseline, ns);
+    m_last_sent = snapshot;
+    m_snapshots.pop_front();
+    return true;
+}   // getMessage
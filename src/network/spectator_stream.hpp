@@ -0,0 +1,76 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file spectator_stream.hpp
+ *  \brief The delayed snapshot stream sent to spectators.
+ */
+
+#ifndef SPECTATOR_STREAM_HPP
+#define SPECTATOR_STREAM_HPP
+
+#include "network/kart_state_snapshot.hpp"
+
+#include <deque>
+
+class NetworkString;
+
+/** \class SpectatorStream
+ *  \brief Builds the kart state stream for spectators of a race.
+ *  Unlike the players, which each get snapshots encoded against the
+ *  snapshot they acknowledged and filtered by their area of interest, all
+ *  spectators get the very same messages: every few snapshots, delayed by
+ *  a few seconds (so that the stream can't be used to help players), and
+ *  delta-encoded against the previous message of the stream. A full
+ *  snapshot is sent regularly so that spectators that joined late or lost
+ *  a message can catch up. So each message is only encoded once and sent
+ *  as one shared packet, independent of the number of spectators, and a
+ *  relay can forward the messages unchanged to its own viewers.
+ *  The messages use the same format as the ones sent to the players.
+ *  \ingroup network
+ */
+class SpectatorStream
+{
+private:
+    /** A full snapshot is sent every this many messages. */
+    static const unsigned int KEYFRAME_INTERVAL = 10;
+
+    /** The clients only keep this many snapshots as baselines. */
+    static const uint16_t MAX_BASELINE_AGE = 32;
+
+    struct DelayedSnapshot
+    {
+        float             m_time;
+        KartStateSnapshot m_snapshot;
+    };   // DelayedSnapshot
+
+    /** The snapshots not sent yet, sorted by time. */
+    std::deque<DelayedSnapshot> m_snapshots;
+
+    /** The last snapshot sent, the baseline of the next message. */
+    KartStateSnapshot m_last_sent;
+
+    /** Number of messages sent since the last full snapshot. */
+    unsigned int m_messages_since_keyframe;
+
+public:
+         SpectatorStream();
+    void addSnapshot(float time, const KartStateSnapshot &snapshot);
+    bool getMessage(float time, NetworkString *ns);
+};   // SpectatorStream
+
+#endif // SPECTATOR_STREAM_HPP
@@ -21,7 +21,12 @@
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "network/network_manager.hpp"
+#include "network/network_simulator.hpp"
+#include "network/protocol.hpp"
+#include "network/server_metrics.hpp"
 #include "utils/log.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
 #include <string.h>
@@ -56,6 +61,7 @@ const char* inet_ntop(int af, const void* src, char* dst, int cnt)
 
 
 FILE* STKHost::m_log_file = NULL;
+pthread_mutex_t STKHost::m_enet_mutex;
 pthread_mutex_t STKHost::m_log_mutex;
 
 void STKHost::logPacket(const NetworkString &ns, bool incoming)
@@ -75,6 +81,38 @@ void STKHost::logPacket(const NetworkString &ns, bool incoming)
     pthread_mutex_unlock(&m_log_mutex);
 }
 
+// ----------------------------------------------------------------------------
+/** Checks if an event belongs to a ping probe connection (see
+ *  PING_PROBE_DATA), which must not be given to the protocols. The
+ *  peers of probes are marked with their data pointer.
+ *  \param event The event received.
+ *  \return True if the event was handled here.
+ */
+bool STKHost::isPingProbe(ENetEvent *event)
+{
+    static uint32_t probe_marker = PING_PROBE_DATA;
+    switch (event->type)
+    {
+    case ENET_EVENT_TYPE_CONNECT:
+        if (event->data != PING_PROBE_DATA)
+            return false;
+        event->peer->data = &probe_marker;
+        return true;
+    case ENET_EVENT_TYPE_DISCONNECT:
+        if (event->peer->data != &probe_marker)
+            return false;
+        event->peer->data = NULL;
+        return true;
+    case ENET_EVENT_TYPE_RECEIVE:
+        if (event->peer->data != &probe_marker)
+            return false;
+        enet_packet_destroy(event->packet);
+        return true;
+    default:
+        return false;
+    }
+}   // isPingProbe
+
 // ----------------------------------------------------------------------------
 
 void* STKHost::receive_data(void* self)
@@ -82,16 +120,46 @@ void* STKHost::receive_data(void* self)
     ENetEvent event;
     STKHost* myself = (STKHost*)(self);
     ENetHost* host = myself->m_host;
+    profiler.setThreadName("STKHost");
+    MemoryTracker::setThreadTag(MemoryTracker::TAG_NETWORK);
     while (!myself->mustStopListening())
     {
-        while (enet_host_service(host, &event, 20) != 0) {
-            Event* evt = new Event(&event);
-            if (evt->type == EVENT_TYPE_MESSAGE)
-                logPacket(evt->data(), true);
-            if (event.type != ENET_EVENT_TYPE_NONE)
-                NetworkManager::getInstance()->notifyEvent(evt);
-            delete evt;
+        // Sleep until a packet arrives, or at most 20 ms for the timers of
+        // ENet (e.g. resending lost packets). The host is only locked while
+        // it is serviced, so that the game can send (and flush) packets
+        // without waiting for this thread.
+        // With the network simulator the delayed events must be delivered
+        // in time, so the thread wakes up at least every ms.
+        NetworkSimulator *simulator = NetworkSimulator::get();
+        enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+        enet_socket_wait(host->socket, &condition,
+                         simulator && simulator->hasEvents() ? 1 : 20);
+        while (true)
+        {
+            lockENet();
+            int result = enet_host_service(host, &event, 0);
+            unlockENet();
+            if (result <= 0)
+                break;
+            if (event.type == ENET_EVENT_TYPE_NONE)
+                continue;
+            if (isPingProbe(&event))
+                continue;
+            // The protocol manager copies the events it keeps, so this one
+            // does not need to be allocated on the heap.
+            if (event.type == ENET_EVENT_TYPE_RECEIVE && event.packet)
+                ServerMetrics::addIncomingPacket(event.packet);
+            Event evt(&event);
+            // Only create a copy of the data if it is actually logged
+            if (evt.type == EVENT_TYPE_MESSAGE && m_log_file)
+                logPacket(evt.data(), true);
+            if (simulator)
+                simulator->addEvent(evt, event);
+            else
+                NetworkManager::getInstance()->notifyEvent(&evt);
         }
+        if (simulator)
+            simulator->deliverEvents();
     }
     myself->m_listening = false;
     free(myself->m_listening_thread);
@@ -100,6 +168,20 @@ void* STKHost::receive_data(void* self)
     return NULL;
 }
 
+// ----------------------------------------------------------------------------
+/** Creates the ENet mutex. It is shared by all hosts (e.g. the temporary
+ *  host used for STUN), so it is only created once and never destroyed.
+ */
+static pthread_once_t g_enet_mutex_once = PTHREAD_ONCE_INIT;
+void STKHost::initENetMutex()
+{
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_enet_mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}   // initENetMutex
+
 // ----------------------------------------------------------------------------
 
 STKHost::STKHost()
@@ -109,6 +191,7 @@ STKHost::STKHost()
     m_log_file         = NULL;
     pthread_mutex_init(&m_exit_mutex, NULL);
     pthread_mutex_init(&m_log_mutex, NULL);
+    pthread_once(&g_enet_mutex_once, &STKHost::initENetMutex);
     if (UserConfigParams::m_packets_log_filename.toString() != "")
     {
         std::string s =
@@ -131,7 +214,9 @@ STKHost::~STKHost()
     }
     if (m_host)
     {
+        lockENet();
         enet_host_destroy(m_host);
+        unlockENet();
     }
 }
 
@@ -240,7 +325,7 @@ uint8_t* STKHost::receiveRawPacket()
 
 // ----------------------------------------------------------------------------
 
-uint8_t* STKHost::receiveRawPacket(TransportAddress* sender)
+uint8_t* STKHost::receiveRawPacket(TransportAddress* sender, int max_tries)
 {
     uint8_t* buffer; // max size needed normally (only used for stun)
     buffer = (uint8_t*)(malloc(sizeof(uint8_t)*2048));
@@ -256,6 +341,11 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress* sender)
      // wait to receive the message because enet sockets are non-blocking
     while(len == -1) // nothing received
     {
+        if (i >= max_tries && max_tries != -1)
+        {
+            free(buffer);
+            return NULL;
+        }
         i++;
         len = recvfrom(m_host->socket, (char*)buffer, 2048, 0, (struct sockaddr*)(&addr), &from_len);
         StkTime::sleep(1); // wait 1 millisecond between two checks
@@ -325,12 +415,84 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress sender, int max_tries)
 
 // ----------------------------------------------------------------------------
 
-void STKHost::broadcastPacket(const NetworkString& data, bool reliable)
+ENetPacket* STKHost::createPacket(const NetworkString &data, bool reliable,
+                                  int protocol_type)
 {
-    ENetPacket* packet = enet_packet_create(data.getBytes(), data.size() + 1,
+    // The packets always had one more byte than the data, keep that so
+    // that the packets sent don't change.
+    const size_t header = protocol_type < 0 ? 0 : 1;
+    ENetPacket* packet = enet_packet_create(NULL, header + data.size() + 1,
                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
-    enet_host_broadcast(m_host, 0, packet);
-    STKHost::logPacket(data, false);
+    if (header)
+        packet->data[0] = (uint8_t)protocol_type;
+    if (data.size() > 0)
+        memcpy(packet->data + header, data.getBytes(), data.size());
+    packet->data[packet->dataLength - 1] = 0;
+    return packet;
+}   // createPacket
+
+// ----------------------------------------------------------------------------
+
+void STKHost::broadcastPacket(const NetworkString& data, bool reliable)
+{
+    broadcastPacket(createPacket(data, reliable));
+}
+
+// ----------------------------------------------------------------------------
+
+uint8_t STKHost::getChannel(int protocol_type)
+{
+    switch (protocol_type)
+    {
+    case PROTOCOL_GAME_EVENTS:
+    case PROTOCOL_CONTROLLER_EVENTS:
+        return CHANNEL_EVENTS;
+    case PROTOCOL_KART_UPDATE:
+    case PROTOCOL_SYNCHRONIZATION:
+        return CHANNEL_UPDATES;
+    case PROTOCOL_BALL_UPDATE:
+        // A separate channel, so that ball updates are not sequenced (and
+        // possibly dropped) together with the kart updates
+        return CHANNEL_BALL;
+    default:
+        return CHANNEL_LOBBY;
+    }
+}   // getChannel
+
+// ----------------------------------------------------------------------------
+
+void STKHost::broadcastPacket(ENetPacket* packet, uint8_t channel)
+{
+    if (m_log_file)
+    {
+        STKHost::logPacket(NetworkString(packet->data,
+                                         (int)packet->dataLength - 1), false);
+    }
+    // This frees the packet if there is no peer
+    lockENet();
+    if (ServerMetrics::isEnabled())
+    {
+        unsigned int count = 0;
+        for (size_t i = 0; i < m_host->peerCount; i++)
+        {
+            if (m_host->peers[i].state == ENET_PEER_STATE_CONNECTED)
+                count++;
+        }
+        ServerMetrics::addOutgoingPacket(packet, count);
+    }
+    enet_host_broadcast(m_host, channel, packet);
+    unlockENet();
+}
+
+// ----------------------------------------------------------------------------
+
+void STKHost::flush()
+{
+    if (!m_host)
+        return;
+    lockENet();
+    enet_host_flush(m_host);
+    unlockENet();
 }
 
 // ----------------------------------------------------------------------------
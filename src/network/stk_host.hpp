@@ -59,6 +59,27 @@ class STKHost
             PORT_ANY       = 0              //!< Any port.
         };
 
+        /*! \enum NETWORK_CHANNEL
+         *  \brief The ENet channels messages are sent on.
+         *  ENet only delivers reliable packets in order within a channel, so
+         *  a lost packet only delays the packets of its own channel.
+         */
+        enum NETWORK_CHANNEL
+        {
+            CHANNEL_LOBBY   = 0,  //!< Connection, lobby and game start.
+            CHANNEL_EVENTS  = 1,  //!< Game and controller events.
+            CHANNEL_UPDATES = 2,  //!< Kart updates and clock synchronization.
+            CHANNEL_BALL    = 3,  //!< Soccer ball updates.
+            CHANNEL_COUNT   = 4   //!< Number of channels of each peer.
+        };
+
+        /*! \brief The data of a connection that is only done to measure the
+         *  round trip time to a server (from the server list). The server
+         *  accepts the connection, but does not tell the protocols about it,
+         *  and the client disconnects as soon as it is connected.
+         */
+        static const uint32_t PING_PROBE_DATA = 0x53544b50;
+
         /*! \brief Constructor                                              */
         STKHost();
         /*! \brief Destructor                                               */
@@ -71,6 +92,31 @@ class STKHost
          */
         static void logPacket(const NetworkString &ns, bool incoming);
 
+        /*! \brief Creates an ENet packet containing the data.
+         *  The packet can be sent to several peers, and ENet frees it once it
+         *  was sent to all of them. If it was sent to no peer at all, it must
+         *  be freed with releasePacket().
+         *  \param data : The data in the packet.
+         *  \param reliable : If set to true, ENet will ensure that the packet
+         *  is received.
+         *  \param protocol_type : If not negative, the type of the protocol
+         *  sending the data, written in front of the data.
+         */
+        static ENetPacket* createPacket(const NetworkString &data,
+                                        bool reliable,
+                                        int protocol_type = -1);
+        /*! \brief Frees a packet created with createPacket() if it was not
+         *  queued for any peer. */
+        static void releasePacket(ENetPacket *packet)
+        {
+            if (packet->referenceCount == 0)
+                enet_packet_destroy(packet);
+        }
+        /*! \brief Returns the channel the messages of a protocol are sent on.
+         *  \param protocol_type : The type of the protocol.
+         */
+        static uint8_t getChannel(int protocol_type);
+
         /*! \brief Thread function checking if data is received.
          *  This function tries to get data from network low-level functions as
          *  often as possible. When something is received, it generates an
@@ -124,7 +170,15 @@ class STKHost
          *  \return A string containing the data of the received packet.
          */
         uint8_t*    receiveRawPacket();
-        uint8_t*    receiveRawPacket(TransportAddress* sender);
+        /*! \brief Receives a packet directly from the network interface.
+         *  \param sender : Receives the address of the sender.
+         *  \param max_tries : Number of times we try to read data from the
+         *  socket, about the time we wait in milliseconds. -1 means
+         *  eternal tries.
+         *  \return The data of the packet (to be freed with free()), or NULL
+         *  if nothing was received.
+         */
+        uint8_t*    receiveRawPacket(TransportAddress* sender, int max_tries = -1);
         /*! \brief Receives a packet directly from the network interface and
          *  filter its address.
          *  Receive a packet whithout ENet processing it. Checks that the
@@ -143,6 +197,27 @@ class STKHost
          *  \param data : Data to send.
          */
         void        broadcastPacket(const NetworkString& data, bool reliable = true);
+        /*! \brief Broadcasts a packet created with createPacket() to all
+         *  peers, without copying it.
+         *  \param packet : The packet to send.
+         *  \param channel : The channel to send the packet on.
+         */
+        void        broadcastPacket(ENetPacket* packet,
+                                    uint8_t channel = CHANNEL_LOBBY);
+        /*! \brief Sends all queued packets now instead of waiting for the
+         *  next service of the network thread. Called after each update of
+         *  the protocols.
+         */
+        void        flush();
+
+        /*! \brief Locks the ENet host.
+         *  ENet is not thread safe, the network thread and the threads
+         *  sending packets must lock it. The lock is recursive, so a packet
+         *  can be sent to several peers while the host is locked.
+         */
+        static void lockENet()   { pthread_mutex_lock(&m_enet_mutex);   }
+        /*! \brief Unlocks the ENet host. */
+        static void unlockENet() { pthread_mutex_unlock(&m_enet_mutex); }
 
         /*! \brief Tells if a peer is known.
          *  \return True if the peer is known, false elseway.
@@ -161,11 +236,19 @@ class STKHost
         uint32_t    getAddress() const          { return m_host->address.host; }
         uint16_t    getPort() const;
     protected:
+        /*! \brief Handles the events of ping probe connections.
+         *  \param event : The event received.
+         *  \return True if the event belonged to a ping probe.
+         */
+        static bool isPingProbe(ENetEvent* event);
+        static void initENetMutex();
+
         ENetHost*   m_host;             //!< ENet host interfacing sockets.
         pthread_t*  m_listening_thread; //!< Thread listening network events.
         pthread_mutex_t m_exit_mutex;   //!< Mutex to kill properly the thread
         bool        m_listening;
         static FILE*       m_log_file;         //!< Where to log packets
+        static pthread_mutex_t m_enet_mutex;   //!< Protects the ENet host
         static pthread_mutex_t m_log_mutex;    //!< To write in the log only once at a time
 
 };
@@ -18,6 +18,7 @@
 
 #include "network/stk_peer.hpp"
 #include "network/network_manager.hpp"
+#include "network/server_metrics.hpp"
 #include "utils/log.hpp"
 
 #include <string.h>
@@ -31,6 +32,8 @@ STKPeer::STKPeer()
     *m_client_server_token = 0;
     m_token_set = new bool;
     *m_token_set = false;
+    m_is_spectator = new bool;
+    *m_is_spectator = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -41,6 +44,7 @@ STKPeer::STKPeer(const STKPeer& peer)
     m_player_profile = peer.m_player_profile;
     m_client_server_token = peer.m_client_server_token;
     m_token_set = peer.m_token_set;
+    m_is_spectator = peer.m_is_spectator;
 }
 
 //-----------------------------------------------------------------------------
@@ -58,6 +62,9 @@ STKPeer::~STKPeer()
     if (m_token_set)
         delete m_token_set;
     m_token_set = NULL;
+    if (m_is_spectator)
+        delete m_is_spectator;
+    m_is_spectator = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -73,7 +80,10 @@ bool STKPeer::connectToHost(STKHost* localhost, TransportAddress host,
        + ((host.ip & 0x000000ff) << 24); // because ENet wants little endian
     address.port = host.port;
 
-    ENetPeer* peer = enet_host_connect(localhost->m_host, &address, 2, 0);
+    STKHost::lockENet();
+    ENetPeer* peer = enet_host_connect(localhost->m_host, &address,
+                                       channel_count, data);
+    STKHost::unlockENet();
     if (peer == NULL)
     {
         Log::error("STKPeer", "Could not try to connect to server.\n");
@@ -90,7 +100,9 @@ bool STKPeer::connectToHost(STKHost* localhost, TransportAddress host,
 
 void STKPeer::disconnect()
 {
+    STKHost::lockENet();
     enet_peer_disconnect(m_peer, 0);
+    STKHost::unlockENet();
 }
 
 //-----------------------------------------------------------------------------
@@ -101,8 +113,6 @@ void STKPeer::sendPacket(NetworkString const& data, bool reliable)
                 data.size(), (m_peer->address.host>>0)&0xff,
                 (m_peer->address.host>>8)&0xff,(m_peer->address.host>>16)&0xff,
                 (m_peer->address.host>>24)&0xff,m_peer->address.port);
-    ENetPacket* packet = enet_packet_create(data.getBytes(), data.size() + 1,
-                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
     /* to debug the packet output
     printf("STKPeer: ");
     for (unsigned int i = 0; i < data.size(); i++)
@@ -111,7 +121,34 @@ void STKPeer::sendPacket(NetworkString const& data, bool reliable)
     }
     printf("\n");
     */
-    enet_peer_send(m_peer, 0, packet);
+    ENetPacket* packet = STKHost::createPacket(data, reliable);
+    STKHost::lockENet();
+    sendPacket(packet);
+    STKHost::releasePacket(packet);
+    STKHost::unlockENet();
+}
+
+//-----------------------------------------------------------------------------
+/** Queues a packet created with STKHost::createPacket for this peer. The
+ *  same packet can be sent to several peers without copying it, ENet frees
+ *  it once it was sent to all of them. The caller must call
+ *  STKHost::releasePacket once the packet was given to all peers, in case
+ *  no peer accepted it. The ENet host must stay locked until then, else the
+ *  network thread could send and free the packet in between.
+ *  \param packet The packet to send.
+ *  \param channel The channel to send the packet on. If the other side
+ *         has less channels (older version), the last one is used.
+ */
+void STKPeer::sendPacket(ENetPacket* packet, uint8_t channel)
+{
+    if (m_peer->channelCount == 0)
+        return;
+    if (channel >= m_peer->channelCount)
+        channel = (uint8_t)(m_peer->channelCount - 1);
+    STKHost::lockENet();
+    if (enet_peer_send(m_peer, channel, packet) == 0)
+        ServerMetrics::addOutgoingPacket(packet, 1);
+    STKHost::unlockENet();
 }
 
 //-----------------------------------------------------------------------------
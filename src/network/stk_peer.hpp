@@ -41,6 +41,8 @@ class STKPeer
         virtual ~STKPeer();
 
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
+        void sendPacket(ENetPacket* packet,
+                        uint8_t channel = STKHost::CHANNEL_LOBBY);
         static bool connectToHost(STKHost* localhost, TransportAddress host, uint32_t channel_count, uint32_t data);
         void disconnect();
 
@@ -48,14 +50,20 @@ class STKPeer
         void unsetClientServerToken() { *m_token_set = false; }
         void setPlayerProfile(NetworkPlayerProfile* profile) { *m_player_profile = profile; }
         void setPlayerProfilePtr(NetworkPlayerProfile** profile) { m_player_profile = profile; }
+        /** Marks this peer as a spectator, which has no kart and only gets
+         *  the (delayed) spectator stream of the race. */
+        void setSpectator(bool spectator) { *m_is_spectator = spectator; }
 
         bool isConnected() const;
         bool exists() const;
         uint32_t getAddress() const;
         uint16_t getPort() const;
+        /** Returns the mean round trip time to this peer in ms. */
+        uint32_t getRoundTripTime() const { return m_peer->roundTripTime; }
         NetworkPlayerProfile* getPlayerProfile() { return (m_player_profile)?(*m_player_profile):NULL; }
         uint32_t getClientServerToken() const   { return *m_client_server_token; }
         bool     isClientServerTokenSet() const { return *m_token_set; }
+        bool     isSpectator() const { return *m_is_spectator; }
 
         bool isSamePeer(const STKPeer* peer) const;
 
@@ -64,6 +72,7 @@ class STKPeer
         NetworkPlayerProfile** m_player_profile;
         uint32_t *m_client_server_token;
         bool *m_token_set;
+        bool *m_is_spectator;
 };
 
 #endif // STK_PEER_HPP
@@ -93,6 +93,11 @@ namespace Online
         m_filename      = "";
         m_parameters    = "";
         m_curl_code     = CURLE_OK;
+        m_resume_download = false;
+        m_conditional_download = false;
+        m_etag          = "";
+        m_not_modified  = false;
+        m_http_header   = NULL;
         m_progress.setAtomic(0);
     }   // init
 
@@ -161,6 +166,10 @@ namespace Online
             return;
         }
 
+        // Share DNS cache, SSL sessions and connections between all worker
+        // threads of the request manager.
+        curl_easy_setopt(m_curl_session, CURLOPT_SHARE,
+                         RequestManager::get()->getCurlShare());
         curl_easy_setopt(m_curl_session, CURLOPT_URL, m_url.c_str());
         curl_easy_setopt(m_curl_session, CURLOPT_FOLLOWLOCATION, 1);
         curl_easy_setopt(m_curl_session, CURLOPT_NOPROGRESS, 0);
@@ -174,9 +183,8 @@ namespace Online
         if (m_url.substr(0, 8) == "https://")
         {
             // https, load certificate info
-            struct curl_slist *chunk = NULL;
-            chunk = curl_slist_append(chunk, "Host: addons.supertuxkart.net");
-            curl_easy_setopt(m_curl_session, CURLOPT_HTTPHEADER, chunk);
+            m_http_header = curl_slist_append(m_http_header,
+                                              "Host: addons.supertuxkart.net");
             CURLcode error = curl_easy_setopt(m_curl_session, CURLOPT_CAINFO,
                        file_manager->getAsset("addons.supertuxkart.net.pem").c_str());
             if (error != CURLE_OK)
@@ -206,7 +214,8 @@ namespace Online
         FILE *fout = NULL;
         if (m_filename.size() > 0)
         {
-            fout = fopen((m_filename+".part").c_str(), "wb");
+            fout = fopen((m_filename+".part").c_str(),
+                         m_resume_download ? "ab" : "wb");
 
             if (!fout)
             {
@@ -215,8 +224,42 @@ namespace Online
                            (m_filename+".part").c_str());
                 return;
             }
+            if (m_resume_download)
+            {
+                fseek(fout, 0, SEEK_END);
+                const long size = ftell(fout);
+                if (size > 0)
+                {
+                    Log::info("HTTPRequest", "Resuming download of '%s' "
+                              "at %ld bytes.", m_filename.c_str(), size);
+                    curl_easy_setopt(m_curl_session,
+                                     CURLOPT_RESUME_FROM_LARGE,
+                                     (curl_off_t)size);
+                }
+                // Otherwise an error page would be appended to the file
+                curl_easy_setopt(m_curl_session, CURLOPT_FAILONERROR, 1L);
+            }
             curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     fout  );
             curl_easy_setopt(m_curl_session,  CURLOPT_WRITEFUNCTION, fwrite);
+
+            const int64_t mtime = file_manager->getModificationTime(m_filename);
+            if (m_conditional_download && mtime > 0)
+            {
+                if (m_etag.size() > 0)
+                {
+                    std::string header = "If-None-Match: " + m_etag;
+                    m_http_header = curl_slist_append(m_http_header,
+                                                      header.c_str());
+                }
+                curl_easy_setopt(m_curl_session, CURLOPT_TIMECONDITION,
+                                 CURL_TIMECOND_IFMODSINCE);
+                curl_easy_setopt(m_curl_session, CURLOPT_TIMEVALUE,
+                                 (long)mtime);
+            }
+            m_etag = "";
+            curl_easy_setopt(m_curl_session, CURLOPT_HEADERDATA, this);
+            curl_easy_setopt(m_curl_session, CURLOPT_HEADERFUNCTION,
+                             &HTTPRequest::headerCallback);
         }
         else
         {
@@ -279,6 +322,8 @@ namespace Online
                     // Unknown system type
             #endif
         curl_easy_setopt(m_curl_session, CURLOPT_USERAGENT, uagent.c_str());
+        if (m_http_header)
+            curl_easy_setopt(m_curl_session, CURLOPT_HTTPHEADER, m_http_header);
 
         m_curl_code = curl_easy_perform(m_curl_session);
         Request::operation();
@@ -286,7 +331,19 @@ namespace Online
         if (fout)
         {
             fclose(fout);
-            if (m_curl_code == CURLE_OK)
+            long response_code = 0;
+            curl_easy_getinfo(m_curl_session, CURLINFO_RESPONSE_CODE,
+                              &response_code);
+            if (m_curl_code == CURLE_OK && m_conditional_download &&
+                response_code == 304)
+            {
+                if (UserConfigParams::logAddons())
+                    Log::info("HTTPRequest", "'%s' was not modified.",
+                              m_filename.c_str());
+                m_not_modified = true;
+                file_manager->removeFile(m_filename+".part");
+            }
+            else if (m_curl_code == CURLE_OK)
             {
                 if(UserConfigParams::logAddons())
                     Log::info("HTTPRequest", "Download successful.");
@@ -311,6 +368,15 @@ namespace Online
                     m_curl_code = CURLE_WRITE_ERROR;
                 }
             }   // m_curl_code ==CURLE_OK
+            else if (m_resume_download &&
+                     (m_curl_code == CURLE_RANGE_ERROR         ||
+                      m_curl_code == CURLE_HTTP_RETURNED_ERROR ||
+                      m_curl_code == CURLE_BAD_DOWNLOAD_RESUME    ))
+            {
+                // The partial file can not be continued (e.g. the server
+                // does not support ranges), so start again next time.
+                file_manager->removeFile(m_filename+".part");
+            }
         }   // if fout
     }   // operation
 
@@ -328,6 +394,8 @@ namespace Online
 
         Request::afterOperation();
         curl_easy_cleanup(m_curl_session);
+        curl_slist_free_all(m_http_header);
+        m_http_header = NULL;
     }   // afterOperation
 
     // ------------------------------------------------------------------------
@@ -345,6 +413,30 @@ namespace Online
         return size * nmemb;
     }   // writeCallback
 
+    // ------------------------------------------------------------------------
+    /** Callback from curl for each received header line. This is used to
+     *  get the ETag of a downloaded file.
+     *  \param content Pointer to the header line (not 0 terminated).
+     *  \param size Size of one block.
+     *  \param nmemb Number of blocks received.
+     *  \param userp Pointer to the request.
+     */
+    size_t HTTPRequest::headerCallback(char *contents, size_t size,
+                                       size_t nmemb, void *userp)
+    {
+        HTTPRequest *request = (HTTPRequest*)userp;
+        std::string line(contents, size * nmemb);
+        if (StringUtils::toLowerCase(line.substr(0, 5)) == "etag:")
+        {
+            // Remove the leading space and trailing \r\n
+            std::size_t start = line.find_first_not_of(" \t", 5);
+            std::size_t end   = line.find_last_not_of(" \t\r\n");
+            if (start != std::string::npos && end >= start)
+                request->m_etag = line.substr(start, end - start + 1);
+        }
+        return size * nmemb;
+    }   // headerCallback
+
     // ----------------------------------------------------------------------------
     /** Callback function from curl: inform about progress. It makes sure that
      *  the value reported by getProgress () is <1 while the download is still
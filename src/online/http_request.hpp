@@ -71,6 +71,26 @@ namespace Online
         /** String to store the received data in. */
         std::string m_string_buffer;
 
+        /** If a partial download (.part file) of m_filename from a previous
+         *  attempt should be continued (using a HTTP range request) instead
+         *  of starting from the beginning. */
+        bool m_resume_download;
+
+        /** If set, the file is only downloaded if it was changed on the
+         *  server compared to the existing copy of m_filename. */
+        bool m_conditional_download;
+
+        /** The ETag of the existing file when sending a conditional request,
+         *  afterwards the ETag received from the server (or ""). */
+        std::string m_etag;
+
+        /** True if the server reported that the file was not modified
+         *  (http 304), in which case the existing file is kept. */
+        bool m_not_modified;
+
+        /** Additional http headers to send. */
+        struct curl_slist *m_http_header;
+
     protected:
         virtual void prepareOperation() OVERRIDE;
         virtual void operation() OVERRIDE;
@@ -82,6 +102,8 @@ namespace Online
 
         static size_t writeCallback(void *contents, size_t size,
                                     size_t nmemb,   void *userp);
+        static size_t headerCallback(char *contents, size_t size,
+                                     size_t nmemb,   void *userp);
         void init();
 
     public :
@@ -120,6 +142,16 @@ namespace Online
             return m_string_buffer;
         }   // getData
 
+        // --------------------------------------------------------------------
+        /** Returns the buffer of the downloaded data, so that it can be
+         *  taken over (e.g. parsed in place) without a copy.
+         *  \pre request has to be done */
+        std::string *getDataBuffer()
+        {
+            assert(hasBeenExecuted());
+            return &m_string_buffer;
+        }   // getDataBuffer
+
         // --------------------------------------------------------------------
         /** Sets a parameter to 'value' (std::string). */
         void addParameter(const std::string & name, const std::string &value)
@@ -165,6 +197,38 @@ namespace Online
         // --------------------------------------------------------------------
         const std::string & getURL() const { assert(isBusy()); return m_url;}
 
+        // --------------------------------------------------------------------
+        /** Continue a previous failed download of the file instead of
+         *  starting again. Only use this if the content for the URL does
+         *  not change (e.g. an addon zip file of a certain revision). */
+        void setResumeDownload(bool resume)
+        {
+            assert(isPreparing());
+            m_resume_download = resume;
+        }   // setResumeDownload
+
+        // --------------------------------------------------------------------
+        /** Only downloads the file if it was modified on the server since the
+         *  existing copy was downloaded. The server is asked with the ETag of
+         *  the existing copy (if known) and its modification time.
+         *  \param etag ETag received with the existing copy, or "".  */
+        void setConditionalDownload(const std::string &etag)
+        {
+            assert(isPreparing());
+            assert(m_filename.size() > 0);
+            m_conditional_download = true;
+            m_etag                 = etag;
+        }   // setConditionalDownload
+
+        // --------------------------------------------------------------------
+        /** Returns true if the file was not downloaded because the existing
+         *  copy is still up to date. */
+        bool wasNotModified() const { return m_not_modified; }
+
+        // --------------------------------------------------------------------
+        /** Returns the ETag the server sent with the file, or "". */
+        const std::string& getETag() const { return m_etag; }
+
         // --------------------------------------------------------------------
         /** Sets the URL for this request. */
         void setURL(const std::string & url)
@@ -23,6 +23,8 @@
 #include "config/player_manager.hpp"
 #include "config/user_config.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/memory_tracker.hpp"
+#include "utils/profiler.hpp"
 
 #include <iostream>
 #include <stdio.h>
@@ -70,24 +72,64 @@ namespace Online
         m_menu_polling_interval = 60;  // Default polling: every 60 seconds.
         m_game_polling_interval = 60;  // same for game polling
         m_time_since_poll       = m_menu_polling_interval;
+        m_num_running_threads   = 0;
         curl_global_init(CURL_GLOBAL_DEFAULT);
         pthread_cond_init(&m_cond_request, NULL);
         m_abort.setAtomic(false);
+
+        for (unsigned int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_init(&m_curl_share_locks[i], NULL);
+        m_curl_share = curl_share_init();
+        curl_share_setopt(m_curl_share, CURLSHOPT_LOCKFUNC,
+                          &RequestManager::lockCurlShare);
+        curl_share_setopt(m_curl_share, CURLSHOPT_UNLOCKFUNC,
+                          &RequestManager::unlockCurlShare);
+        curl_share_setopt(m_curl_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        // Sharing the connection cache (i.e. keep-alive between requests)
+        // is only supported since libcurl 7.57
+        curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_CONNECT);
+#endif
     }   // RequestManager
 
     // ------------------------------------------------------------------------
     RequestManager::~RequestManager()
     {
-        m_thread_id.lock();
-        pthread_join(*m_thread_id.getData(), NULL);
-        delete m_thread_id.getData();
-        m_thread_id.unlock();
+        for (unsigned int i = 0; i < m_threads.size(); i++)
+            pthread_join(m_threads[i], NULL);
+        m_threads.clear();
         pthread_cond_destroy(&m_cond_request);
+        curl_share_cleanup(m_curl_share);
+        for (unsigned int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_destroy(&m_curl_share_locks[i]);
         curl_global_cleanup();
     }   // ~RequestManager
 
     // ------------------------------------------------------------------------
-    /** Start the actual network thread. This can not be done as part of
+    /** Called by curl to lock the shared data, which can be accessed by
+     *  all worker threads. */
+    void RequestManager::lockCurlShare(CURL *handle, curl_lock_data data,
+                                       curl_lock_access access, void *obj)
+    {
+        RequestManager *me = (RequestManager*)obj;
+        pthread_mutex_lock(&me->m_curl_share_locks[data]);
+    }   // lockCurlShare
+
+    // ------------------------------------------------------------------------
+    /** Called by curl to unlock the shared data. */
+    void RequestManager::unlockCurlShare(CURL *handle, curl_lock_data data,
+                                         void *obj)
+    {
+        RequestManager *me = (RequestManager*)obj;
+        pthread_mutex_unlock(&me->m_curl_share_locks[data]);
+    }   // unlockCurlShare
+
+    // ------------------------------------------------------------------------
+    /** Start the actual network threads. This can not be done as part of
      *  the constructor, since the assignment to the global network_http
      *  variable has not been assigned at that stage, and the thread might
      *  use network_http - a very subtle race condition. So the thread can
@@ -106,17 +148,26 @@ namespace Online
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
         //pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
-        m_thread_id.setAtomic(new pthread_t());
-        int error = pthread_create(m_thread_id.getData(), &attr,
-                                   &RequestManager::mainLoop, this);
-        if (error)
+        // The counter must be set before any thread is started, otherwise
+        // a quickly finishing thread might think it is the last one.
+        m_request_queue.lock();
+        m_num_running_threads = NUM_WORKER_THREADS;
+        m_request_queue.unlock();
+        for (int i = 0; i < NUM_WORKER_THREADS; i++)
         {
-            m_thread_id.lock();
-            delete m_thread_id.getData();
-            m_thread_id.unlock();
-            m_thread_id.setAtomic(0);
-            Log::error("HTTP Manager", "Could not create thread, error=%d.",
-                       errno);
+            pthread_t thread;
+            int error = pthread_create(&thread, &attr,
+                                       &RequestManager::mainLoop, this);
+            if (error)
+            {
+                Log::error("HTTP Manager", "Could not create thread, error=%d.",
+                           errno);
+                m_request_queue.lock();
+                m_num_running_threads--;
+                m_request_queue.unlock();
+            }
+            else
+                m_threads.push_back(thread);
         }
         pthread_attr_destroy(&attr);
 
@@ -171,15 +222,22 @@ namespace Online
         m_request_queue.lock();
         m_request_queue.getData().push(request);
 
-        // Wake up the network http thread
-        pthread_cond_signal(&m_cond_request);
+        // Wake up a network http thread. A quit request must be seen by all
+        // threads, since they all have to exit.
+        if (request->getType() == Request::RT_QUIT)
+            pthread_cond_broadcast(&m_cond_request);
+        else
+            pthread_cond_signal(&m_cond_request);
         m_request_queue.unlock();
     }   // addRequest
 
     // ------------------------------------------------------------------------
-    /** The actual main loop, which is started as a separate thread from the
-     *  constructor. After testing for a new server, fetching news, the list
-     *  of packages to download, it will wait for commands to be issued.
+    /** The actual main loop of each worker thread, which is started from
+     *  startNetworkThread(). It waits for requests and executes the request
+     *  with the highest priority. When a quit request is at the top of the
+     *  queue, the thread exits (the quit request stays in the queue, so
+     *  that all other threads see it as well). The last thread to exit
+     *  frees all requests that are left.
      *  \param obj: A pointer to this object, passed on by pthread_create
      */
     void *RequestManager::mainLoop(void *obj)
@@ -187,45 +245,50 @@ namespace Online
         RequestManager *me = (RequestManager*) obj;
 
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        profiler.setThreadName("RequestManager");
+        MemoryTracker::setThreadTag(MemoryTracker::TAG_NETWORK);
 
-        me->m_current_request = NULL;
         me->m_request_queue.lock();
-        while (me->m_request_queue.getData().empty() ||
-               me->m_request_queue.getData().top()->getType() != Request::RT_QUIT)
+        while (true)
         {
-            bool empty = me->m_request_queue.getData().empty();
-
             // Wait in cond_wait for a request to arrive. The 'while' is necessary
             // since "spurious wakeups from the pthread_cond_wait ... may occur"
             // (pthread_cond_wait man page)!
-            while (empty)
+            while (me->m_request_queue.getData().empty())
             {
                 pthread_cond_wait(&me->m_cond_request, me->m_request_queue.getMutex());
-                empty = me->m_request_queue.getData().empty();
             }
-            me->m_current_request = me->m_request_queue.getData().top();
-            me->m_request_queue.getData().pop();
+            Online::Request *request = me->m_request_queue.getData().top();
 
-            if (me->m_current_request->getType() == Request::RT_QUIT)
-            {
-                delete me->m_current_request;
+            if (request->getType() == Request::RT_QUIT)
                 break;
-            }
+            me->m_request_queue.getData().pop();
 
             me->m_request_queue.unlock();
-            me->m_current_request->execute();
+            PROFILER_PUSH_CPU_MARKER("Request execute", 0x00, 0x7F, 0x7F);
+            request->execute();
+            PROFILER_POP_CPU_MARKER();
             // This test is necessary in case that execute() was aborted
             // (otherwise the assert in addResult will be triggered).
-            if (!me->getAbort()) me->addResult(me->m_current_request);
+            if (!me->getAbort()) me->addResult(request);
             me->m_request_queue.lock();
         } // while handle all requests
 
+        // At this stage we have the lock for m_request_queue
+        me->m_num_running_threads--;
+        if (me->m_num_running_threads > 0)
+        {
+            me->m_request_queue.unlock();
+            pthread_exit(NULL);
+            return 0;
+        }
+
         // Signal that the request manager can now be deleted.
         // We signal this even before cleaning up memory, since there's no
         // need to keep the user waiting for STK to exit.
         me->setCanBeDeleted();
 
-        // At this stage we have the lock for m_request_queue
+        // This also frees the quit request.
         while (!me->m_request_queue.getData().empty())
         {
             Online::Request *request = me->m_request_queue.getData().top();
@@ -38,17 +38,24 @@
 #include <curl/curl.h>
 #include <queue>
 #include <pthread.h>
+#include <vector>
 
 namespace Online
 {
-    /** A class to execute requests in a separate thread. Typically the
+    /** A class to execute requests in separate threads. Typically the
      *  requests involve a http(s) requests to be sent to the stk server, and
      *  receive an answer (e.g. to sign in; or to download an addon). The
      *  requests are sorted by priority (e.g. sign in and out have higher
      *  priority than downloading addon icons).
      *  A request is created and initialised from the main thread. When it
      *  is moved into the request queue, it must not be handled by the main
-     *  thread anymore, only the RequestManager thread can handle it.
+     *  thread anymore, only the RequestManager threads can handle it.
+     *  Several worker threads take requests from the queue (always the one
+     *  with the highest priority), so e.g. addon icons do not delay the
+     *  server list. Each request is only executed by one thread. The curl
+     *  DNS cache, SSL sessions and (if supported by libcurl) connections are
+     *  shared between all requests, so that connections to the server are
+     *  kept alive and reused.
      *  Once the request is finished, it is put in a separate ready queue.
      *  The main thread regularly checks the ready queue for any ready
      *  request, and executes a callback. So there is no need to protect
@@ -94,9 +101,6 @@ namespace Online
             /** Time passed since the last poll request. */
             float                     m_time_since_poll;
 
-            /** The current requested being worked on. */
-            Online::Request *         m_current_request;
-
             /** A conditional variable to wake up the main loop. */
             pthread_cond_t            m_cond_request;
 
@@ -109,8 +113,18 @@ namespace Online
             /** The polling interval while the menu is shown. */
             float m_menu_polling_interval;
 
-            /** Thread id of the thread running in this object. */
-            Synchronised<pthread_t *> m_thread_id;
+            /** Thread ids of the worker threads. */
+            std::vector<pthread_t>    m_threads;
+
+            /** Number of worker threads that have not yet finished. Protected
+             *  by the lock of m_request_queue. */
+            int                       m_num_running_threads;
+
+            /** The curl data shared between all requests. */
+            CURLSH                   *m_curl_share;
+
+            /** One lock for each type of data curl shares. */
+            pthread_mutex_t           m_curl_share_locks[CURL_LOCK_DATA_LAST];
 
             /** The list of pointers to all requests that still need to be
              *  handled. */
@@ -130,6 +144,10 @@ namespace Online
             void handleResultQueue();
 
             static void *mainLoop(void *obj);
+            static void  lockCurlShare(CURL *handle, curl_lock_data data,
+                                       curl_lock_access access, void *obj);
+            static void  unlockCurlShare(CURL *handle, curl_lock_data data,
+                                         void *obj);
 
             RequestManager(); //const std::string &url
             ~RequestManager();
@@ -139,6 +157,9 @@ namespace Online
         public:
             static const int HTTP_MAX_PRIORITY = 9999;
 
+            /** Number of threads executing requests. */
+            static const int NUM_WORKER_THREADS = 4;
+
             // ----------------------------------------------------------------
             /** Singleton access function. Creates the RequestManager if
              * necessary. */
@@ -160,6 +181,8 @@ namespace Online
             void stopNetworkThread();
 
             bool getAbort() { return m_abort.getAtomic(); }
+            /** Returns the curl share handle all requests should use. */
+            CURLSH *getCurlShare() { return m_curl_share; }
             void update(float dt);
 
             // ----------------------------------------------------------------
@@ -37,6 +37,9 @@ namespace Online
         m_server_id                 = 0;
         m_current_players           = 0;
         m_max_players               = 0;
+        m_ip                        = 0;
+        m_port                      = 0;
+        m_ping                      = -1;
 
         xml.get("name", &m_lower_case_name);
         m_name = StringUtils::xmlDecode(m_lower_case_name);
@@ -46,6 +49,8 @@ namespace Online
         xml.get("hostid",           &m_host_id);
         xml.get("max_players",      &m_max_players);
         xml.get("current_players",  &m_current_players);
+        xml.get("ip",               &m_ip);
+        xml.get("port",             &m_port);
 
     } // Server(const XML&)
 
@@ -45,7 +45,8 @@ namespace Online
         {
             SO_SCORE   = 1,    // Sorted on satisfaction score
             SO_NAME    = 2,    // Sorted alphabetically by name
-            SO_PLAYERS = 4
+            SO_PLAYERS = 4,
+            SO_PING    = 8     // Sorted on the measured round trip time
         };
 
     protected:
@@ -65,6 +66,15 @@ namespace Online
         /** The score/rating given */
         float m_satisfaction_score;
 
+        /** The public address of the server, if the server list contains
+         *  it (otherwise 0). */
+        uint32_t m_ip;
+        uint16_t m_port;
+
+        /** The round trip time to the server in ms, or -1 if it was not
+         *  measured (yet). */
+        int m_ping;
+
         /** The sort order to be used in the comparison. */
         static SortOrder m_sort_order;
 
@@ -94,6 +104,15 @@ namespace Online
         const uint32_t getHostId() const { return m_host_id; }
         const int getMaxPlayers() const { return m_max_players; }
         const int getCurrentPlayers() const { return m_current_players; }
+        const uint32_t getIP() const { return m_ip; }
+        const uint16_t getPort() const { return m_port; }
+        // ------------------------------------------------------------------------
+        /** Returns the round trip time in ms, or -1 if it is unknown. */
+        const int getPing() const { return m_ping; }
+        void setPing(int ping) { m_ping = ping; }
+        // ------------------------------------------------------------------------
+        /** Returns true if the server can be joined by one more player. */
+        bool isFull() const { return m_current_players >= m_max_players; }
 
         // ------------------------------------------------------------------------
         bool filterByWords(const irr::core::stringw words) const;
@@ -116,6 +135,10 @@ namespace Online
                 case SO_PLAYERS:
                     return m_current_players < server.getCurrentPlayers();
                     break;
+                case SO_PING:
+                    // Servers without ping are sorted after all others
+                    return (unsigned int)m_ping < (unsigned int)server.getPing();
+                    break;
             }   // switch
 
             return true;
@@ -22,10 +22,18 @@
 #include <irrString.h>
 #include <assert.h>
 #include "config/user_config.hpp"
+#include "network/stk_host.hpp"
+#include "utils/log.hpp"
 #include "utils/translation.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
+#include <enet/enet.h>
+#include <set>
+
 #define SERVER_REFRESH_INTERVAL 5.0f
+/** Time (in seconds) to wait for the answers to the ping probes. */
+#define SERVER_PING_TIMEOUT 1.0
 
 namespace Online
 {
@@ -50,10 +58,13 @@ namespace Online
     {
         m_last_load_time.setAtomic(0.0f);
         m_joined_server.setAtomic(NULL);
+        m_ping_thread = NULL;
+        m_pinging     = false;
     }
 
     ServersManager::~ServersManager()
     {
+        waitForPings();
         cleanUpServers();
         MutexLocker(m_joined_server);
         delete m_joined_server.getData();
@@ -94,27 +105,213 @@ namespace Online
             return;
         }
 
+        // Update the servers that are already known instead of recreating
+        // the list, so that their round trip time is kept, and remove the
+        // servers that are not listed anymore.
         const XMLNode * servers_xml = input->getNode("servers");
-        cleanUpServers();
+        std::set<uint32_t> listed;
         for (unsigned int i = 0; i < servers_xml->getNumNodes(); i++)
         {
-            addServer(new Server(*servers_xml->getNode(i)));
+            Server *server = new Server(*servers_xml->getNode(i));
+            listed.insert(server->getServerId());
+            m_mapped_servers.lock();
+            std::map<uint32_t, Server*>::iterator it =
+                m_mapped_servers.getData().find(server->getServerId());
+            Server *old = it == m_mapped_servers.getData().end() ? NULL
+                                                                : it->second;
+            if (old)
+            {
+                const int ping = old->getPing();
+                *old = *server;
+                old->setPing(ping);
+            }
+            m_mapped_servers.unlock();
+            if (old)
+                delete server;
+            else
+                addServer(server);
         }
+
+        m_sorted_servers.lock();
+        m_mapped_servers.lock();
+        PtrVector<Server> &servers = m_sorted_servers.getData();
+        for (int i = (int)servers.size() - 1; i >= 0; i--)
+        {
+            if (listed.find(servers[i].getServerId()) == listed.end())
+            {
+                m_mapped_servers.getData().erase(servers[i].getServerId());
+                servers.erase(i);
+            }
+        }
+        m_mapped_servers.unlock();
+        m_sorted_servers.unlock();
+
         m_last_load_time.setAtomic((float)StkTime::getRealTime());
+        startPings();
     }
 
+    // ============================================================================
+    /** Starts to measure the round trip time to all servers whose address is
+     *  known in a separate thread.
+     */
+    void ServersManager::startPings()
+    {
+        if (m_pinging)
+            return;
+        waitForPings();
+        m_pinging = true;
+        m_ping_thread = new pthread_t;
+        if (pthread_create(m_ping_thread, NULL, &ServersManager::pingServers,
+                           this) != 0)
+        {
+            Log::error("ServersManager", "Could not create the ping thread.");
+            delete m_ping_thread;
+            m_ping_thread = NULL;
+            m_pinging = false;
+        }
+    }   // startPings
+
+    // ============================================================================
+    /** Waits until all round trip times are measured. This takes at most
+     *  SERVER_PING_TIMEOUT seconds.
+     */
+    void ServersManager::waitForPings()
+    {
+        if (!m_ping_thread)
+            return;
+        pthread_join(*m_ping_thread, NULL);
+        delete m_ping_thread;
+        m_ping_thread = NULL;
+    }   // waitForPings
+
+    // ============================================================================
+    /** Thread function measuring the round trip time to the servers. All
+     *  servers are probed at the same time, by starting an ENet connection
+     *  to each of them and measuring the time until it is established. The
+     *  connections use STKHost::PING_PROBE_DATA, so the servers don't treat
+     *  them as players that want to join. The probe is disconnected as soon
+     *  as it is connected. Servers that don't answer in time keep their
+     *  previous round trip time.
+     *  \param data The servers manager.
+     */
+    void *ServersManager::pingServers(void *data)
+    {
+        ServersManager *manager = (ServersManager*)data;
+
+        std::vector<std::pair<uint32_t, ENetAddress> > servers;
+        manager->m_sorted_servers.lock();
+        const PtrVector<Server> &list = manager->m_sorted_servers.getData();
+        for (unsigned int i = 0; i < list.size(); i++)
+        {
+            if (list[i].getIP() == 0 || list[i].getPort() == 0)
+                continue;
+            ENetAddress address;
+            // ENet wants the address in network byte order
+            const uint32_t ip = list[i].getIP();
+            address.host = ((ip & 0xff000000) >> 24) + ((ip & 0x00ff0000) >> 8)
+                         + ((ip & 0x0000ff00) << 8)  + ((ip & 0x000000ff) << 24);
+            address.port = list[i].getPort();
+            servers.push_back(std::make_pair(list[i].getServerId(), address));
+        }
+        manager->m_sorted_servers.unlock();
+
+        ENetHost *host = NULL;
+        if (!servers.empty() && enet_initialize() == 0)
+            host = enet_host_create(NULL, servers.size(), 1, 0, 0);
+        if (!host)
+        {
+            manager->m_pinging = false;
+            return NULL;
+        }
+
+        const double start = StkTime::getRealTime();
+        std::vector<ENetPeer*> peers(servers.size());
+        for (unsigned int i = 0; i < servers.size(); i++)
+        {
+            peers[i] = enet_host_connect(host, &servers[i].second, 1,
+                                         STKHost::PING_PROBE_DATA);
+            if (peers[i])
+                peers[i]->data = (void*)(size_t)i;
+        }
+
+        unsigned int answers = 0;
+        std::vector<int> pings(servers.size(), -1);
+        while (answers < servers.size() &&
+               StkTime::getRealTime() < start + SERVER_PING_TIMEOUT)
+        {
+            ENetEvent event;
+            if (enet_host_service(host, &event, 10) <= 0)
+                continue;
+            if (event.type == ENET_EVENT_TYPE_CONNECT)
+            {
+                const size_t i = (size_t)event.peer->data;
+                pings[i] = (int)((StkTime::getRealTime() - start) * 1000.0);
+                answers++;
+                enet_peer_disconnect_now(event.peer, 0);
+            }
+            else if (event.type == ENET_EVENT_TYPE_RECEIVE)
+                enet_packet_destroy(event.packet);
+        }
+        enet_host_destroy(host);
+        enet_deinitialize();
+
+        manager->m_mapped_servers.lock();
+        std::map<uint32_t, Server*> &map = manager->m_mapped_servers.getData();
+        for (unsigned int i = 0; i < servers.size(); i++)
+        {
+            std::map<uint32_t, Server*>::iterator it = map.find(servers[i].first);
+            if (pings[i] >= 0 && it != map.end())
+                it->second->setPing(pings[i]);
+        }
+        manager->m_mapped_servers.unlock();
+        Log::info("ServersManager", "%u of %u servers answered the ping.",
+                  answers, (unsigned int)servers.size());
+        manager->m_pinging = false;
+        return NULL;
+    }   // pingServers
+
     void ServersManager::RefreshRequest::callback()
     {
         ServersManager::get()->refresh(isSuccess(), getXMLData());
     }
 
     // ============================================================================
+    /** Returns the best server to join. Servers that are full are skipped,
+     *  and servers with a measured round trip time are preferred. Of those,
+     *  the server with the lowest round trip time is taken, plus a penalty
+     *  of up to 50 ms for how full it is, so that empty servers that are
+     *  nearly as close are picked first. If no round trip time is known,
+     *  the first server of the list is used.
+     */
     const Server * ServersManager::getQuickPlay() const
     {
-        if(m_sorted_servers.getData().size() > 0)
-            return getServerBySort(0);
-
-        return NULL;
+        MutexLocker(m_sorted_servers);
+        const PtrVector<Server> &servers = m_sorted_servers.getData();
+        const Server *best = NULL;
+        float best_score = 0;
+        for (unsigned int i = 0; i < servers.size(); i++)
+        {
+            const Server &server = servers[i];
+            if (server.isFull())
+                continue;
+            if (server.getPing() < 0)
+            {
+                if (!best)
+                    best = &server;
+                continue;
+            }
+            const float score = server.getPing() + 50.0f
+                              * server.getCurrentPlayers()
+                              / std::max(server.getMaxPlayers(), 1);
+            if (!best || best->getPing() < 0 || score < best_score)
+            {
+                best       = &server;
+                best_score = score;
+            }
+        }
+        if (!best && servers.size() > 0)
+            best = servers.get(0);
+        return best;
     }
 
     // ============================================================================
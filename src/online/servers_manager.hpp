@@ -26,6 +26,9 @@
 #include "online/xml_request.hpp"
 #include "utils/synchronised.hpp"
 
+#include <atomic>
+#include <pthread.h>
+
 namespace Online
 {
     /**
@@ -56,8 +59,15 @@ namespace Online
         Synchronised<Server *>                          m_joined_server;
 
         Synchronised<float>                             m_last_load_time;
+
+        /** The thread measuring the round trip times, or NULL. */
+        pthread_t *                                     m_ping_thread;
+        /** True while the round trip times are measured. */
+        std::atomic<bool>                               m_pinging;
+
         void                                            refresh(bool success, const XMLNode * input);
         void                                            cleanUpServers();
+        static void *                                   pingServers(void *data);
 
     public:
         // Singleton
@@ -73,6 +83,10 @@ namespace Online
         const Server *                                  getServerBySort (int index) const;
         void                                            sort(bool sort_desc);
         Server *                                        getJoinedServer() const;
+        void                                            startPings();
+        void                                            waitForPings();
+        /** Returns true while the round trip times are measured. */
+        bool                                            isPinging() const { return m_pinging; }
 
         // Returns the best server to join
         const Server *                                  getQuickPlay() const;
@@ -53,11 +53,12 @@ namespace Online
     }   // ~XMLRequest
 
     // ------------------------------------------------------------------------
-    /** On a successful download converts the string into an XML tree.
+    /** On a successful download converts the string into an XML tree. The
+     *  received data is parsed in place, so it is not available afterwards.
      */
     void XMLRequest::afterOperation()
     {
-        m_xml_data = file_manager->createXMLTreeFromString(getData());
+        m_xml_data = file_manager->createXMLTreeFromBuffer(getDataBuffer());
         if (hadDownloadError())
         {
             Log::error("XMLRequest::afterOperation",
@@ -39,7 +39,7 @@ btRigidBody& btKart::getFixedBody()
 }
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster)
 {
@@ -215,12 +215,13 @@ void btKart::updateWheelTransformsWS(btWheelInfo& wheel,
 }   // updateWheelTransformsWS
 
 // ----------------------------------------------------------------------------
-/**
+/** Casts the suspension rays of all wheels, and the rays used to position
+ *  the visual wheels, with a single batched query. Since the rays of a kart
+ *  are close together, this shares the traversal of the broadphase and of
+ *  the track BVH between them.
  */
-btScalar btKart::rayCast(unsigned int index)
+void btKart::rayCastWheels()
 {
-    btWheelInfo &wheel = m_wheelInfo[index];
-
     // Work around a bullet problem: when using a convex hull the raycast
     // would sometimes hit the chassis (which does not happen when using a
     // box shape). Therefore set the collision mask in the chassis body so
@@ -233,29 +234,103 @@ btScalar btKart::rayCast(unsigned int index)
         m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
 
-    updateWheelTransformsWS( wheel,false);
+    const int num_wheels = getNumWheels();
+    btAssert(num_wheels <= 4);
+    // 4 wheel rays, plus 2 rays for the visual wheels
+    btVector3 from[6], to[6];
+    btScalar  raylen[4];
+    for(int i=0; i<num_wheels; i++)
+    {
+        btWheelInfo &wheel = m_wheelInfo[i];
+        updateWheelTransformsWS( wheel,false);
 
-    btScalar max_susp_len = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
-                          + wheel.m_maxSuspensionTravelCm*0.01f;
+        btScalar max_susp_len = wheel.getSuspensionRestLength()
+                              + wheel.m_wheelsRadius
+                              + wheel.m_maxSuspensionTravelCm*0.01f;
 
-    // Do a slightly longer raycast to see if the kart might soon hit the 
-    // ground and some 'cushioning' is needed to avoid that the chassis
-    // hits the ground.
-    btScalar raylen = max_susp_len + 0.5f;
+        // Do a slightly longer raycast to see if the kart might soon hit the
+        // ground and some 'cushioning' is needed to avoid that the chassis
+        // hits the ground.
+        raylen[i] = max_susp_len + 0.5f;
 
-    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+        from[i] = wheel.m_raycastInfo.m_hardPointWS;
+        to[i]   = from[i] + wheel.m_raycastInfo.m_wheelDirectionWS*raylen[i];
+        wheel.m_raycastInfo.m_contactPointWS = to[i];
+    }
+    int num_rays = num_wheels;
 
-    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
+#define USE_VISUAL
+#ifdef USE_VISUAL
+    if(num_wheels==4)
+    {
+        btTransform chassisTrans = getChassisWorldTransform();
+        if (getRigidBody()->getMotionState())
+        {
+            getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
+        }
+        btQuaternion q(m_visual_rotation, 0, 0);
+        btQuaternion rot_new = chassisTrans.getRotation() * q;
+        chassisTrans.setRotation(rot_new);
+        for(int index=2; index<4; index++)
+        {
+            btVector3 pos =
+                m_kart->getKartModel()->getWheelGraphicsPosition(index);
+            pos.setZ(pos.getZ()*0.9f);
+            from[num_rays] = chassisTrans( pos );
+            to[num_rays]   = from[num_rays] + (to[index] - from[index]);
+            num_rays++;
+        }
+    }
+#endif
 
     btAssert(m_vehicleRaycaster);
+    btVehicleRaycaster::btVehicleRaycasterResult results[6];
+    void* objects[6];
+    m_vehicleRaycaster->castRays(num_rays, from, to, results, objects);
 
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    for(int i=0; i<num_wheels; i++)
+    {
+        updateWheelContact(i, raylen[i], results[i], objects[i]);
+#ifndef USE_VISUAL
+        m_visual_contact_point[i] = results[i].m_hitPointInWorld;
+#endif
+    }
+
+#ifdef USE_VISUAL
+    for(int i=num_wheels; i<num_rays; i++)
+    {
+        int index = i - num_wheels + 2;
+        m_visual_contact_point[index]   = results[i].m_hitPointInWorld;
+        m_visual_contact_point[index-2] = from[i];
+        m_visual_wheels_touch_ground &= (objects[i]!=NULL);
+    }
+#endif
 
+    if(m_chassisBody->getBroadphaseHandle())
+    {
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
+            = old_group;
+    }
+}   // rayCastWheels
+
+// ----------------------------------------------------------------------------
+/** Updates the suspension and contact information of a wheel from the
+ *  result of its raycast.
+ *  \param index Index of the wheel.
+ *  \param raylen Length of the ray that was cast.
+ *  \param rayResults The result of the raycast.
+ *  \param object The body hit, or NULL if nothing was hit.
+ *  \return The distance to the ground, or -1 if the wheel is in the air.
+ */
+btScalar btKart::updateWheelContact(unsigned int index, btScalar raylen,
+                 const btVehicleRaycaster::btVehicleRaycasterResult &rayResults,
+                 void* object)
+{
+    btWheelInfo &wheel = m_wheelInfo[index];
     wheel.m_raycastInfo.m_groundObject = 0;
 
+    btScalar max_susp_len = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
+                          + wheel.m_maxSuspensionTravelCm*0.01f;
     btScalar depth =  raylen * rayResults.m_distFraction;
     if (object &&  depth < max_susp_len)
     {
@@ -320,43 +395,8 @@ btScalar btKart::rayCast(unsigned int index)
         wheel.m_clippedInvContactDotSuspension = btScalar(1.0);
     }
 
-#define USE_VISUAL
-#ifndef USE_VISUAL
-    m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
-#else
-    if(index==2 || index==3)
-    {
-        btTransform chassisTrans = getChassisWorldTransform();
-        if (getRigidBody()->getMotionState())
-        {
-            getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
-        }
-        btQuaternion q(m_visual_rotation, 0, 0);
-        btQuaternion rot_new = chassisTrans.getRotation() * q;
-        chassisTrans.setRotation(rot_new);
-        btVector3 pos = m_kart->getKartModel()->getWheelGraphicsPosition(index);
-        pos.setZ(pos.getZ()*0.9f);
-        btVector3 source = chassisTrans( pos );
-        btVector3 target = source + rayvector;
-        btVehicleRaycaster::btVehicleRaycasterResult rayResults;
-
-        void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
-        m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
-        m_visual_contact_point[index-2] = source;
-        m_visual_wheels_touch_ground &= (object!=NULL);
-    }
-#endif
-
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
-    }
-
-
     return depth;
-
-}   // rayCast
+}   // updateWheelContact
 
 // ----------------------------------------------------------------------------
 const btTransform& btKart::getChassisWorldTransform() const
@@ -383,9 +423,9 @@ void btKart::updateVehicle( btScalar step )
 
     m_num_wheels_on_ground       = 0;
     m_visual_wheels_touch_ground = true;
+    rayCastWheels();
     for (int i=0;i<m_wheelInfo.size();i++)
     {
-        rayCast( i);
         if(m_wheelInfo[i].m_raycastInfo.m_isInContact)
             m_num_wheels_on_ground++;
     }
@@ -13,6 +13,8 @@
 #include "btKartRaycast.hpp"
 
 #include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btConcaveShape.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletDynamics/Dynamics/btDynamicsWorld.h"
 
 #include "modes/world.hpp"
@@ -96,5 +98,176 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
         }
     }
     return 0;
-}
+}   // castRay
 
+namespace
+{
+    /** The closest hit of one ray. */
+    struct RayHit
+    {
+        const btCollisionObject *m_object;
+        btScalar                 m_fraction;
+        btVector3                m_normal;
+        int                      m_triangle_index;
+    };   // RayHit
+    // ========================================================================
+    /** Collects all objects overlapping the rays, using the same collision
+     *  filtering as a btCollisionWorld::rayTest. */
+    struct CollectObjects : public btBroadphaseAabbCallback
+    {
+        btAlignedObjectArray<btCollisionObject*> m_objects;
+        virtual bool process(const btBroadphaseProxy* proxy)
+        {
+            if ((proxy->m_collisionFilterGroup & btBroadphaseProxy::AllFilter) &&
+                (btBroadphaseProxy::DefaultFilter & proxy->m_collisionFilterMask))
+                m_objects.push_back((btCollisionObject*)proxy->m_clientObject);
+            return true;
+        }
+    };   // CollectObjects
+    // ========================================================================
+    /** Tests one ray against the triangles of a concave shape. */
+    class TriangleRay : public btTriangleRaycastCallback
+    {
+    private:
+        RayHit                  *m_hit;
+        const btCollisionObject *m_object;
+        btMatrix3x3              m_basis;
+    public:
+        TriangleRay(const btVector3 &from, const btVector3 &to, RayHit *hit,
+                    const btCollisionObject *object, const btMatrix3x3 &basis)
+            : btTriangleRaycastCallback(from, to), m_hit(hit),
+              m_object(object), m_basis(basis)
+        {
+            m_hitFraction = hit->m_fraction;
+        }
+        // --------------------------------------------------------------------
+        virtual btScalar reportHit(const btVector3 &normal, btScalar fraction,
+                                   int part, int triangle_index)
+        {
+            m_hit->m_object         = m_object;
+            m_hit->m_fraction       = fraction;
+            m_hit->m_normal         = m_basis * normal;
+            m_hit->m_triangle_index = part > -1 ? triangle_index : -1;
+            return fraction;
+        }
+    };   // TriangleRay
+    // ========================================================================
+    /** Forwards each triangle to the callbacks of all rays. */
+    class AllRays : public btTriangleCallback
+    {
+    public:
+        btAlignedObjectArray<TriangleRay> m_rays;
+        virtual void processTriangle(btVector3 *triangle, int part,
+                                     int triangle_index)
+        {
+            for (int i = 0; i < m_rays.size(); i++)
+                m_rays[i].processTriangle(triangle, part, triangle_index);
+        }
+    };   // AllRays
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Casts several rays which are close to each other (e.g. the wheel rays of
+ *  one kart) with a single traversal of the broadphase and of the BVH of
+ *  each triangle mesh hit: the broadphase and the meshes are queried once
+ *  with the bounding box of all rays, and each triangle found is then
+ *  tested against all rays. The results are identical to calling castRay
+ *  for each ray.
+ *  \param count Number of rays.
+ *  \param from, to Start and end point of each ray.
+ *  \param results Returns the result of each ray.
+ *  \param objects Returns the body hit by each ray, or NULL.
+ */
+void btKartRaycaster::castRays(int count, const btVector3* from,
+                               const btVector3* to,
+                               btVehicleRaycasterResult* results,
+                               void** objects)
+{
+    if (count == 0)
+        return;
+
+    btAlignedObjectArray<RayHit> hits;
+    hits.resize(count);
+
+    btVector3 aabb_min = from[0], aabb_max = from[0];
+    for (int i = 0; i < count; i++)
+    {
+        hits[i].m_object         = NULL;
+        hits[i].m_fraction       = btScalar(1.0);
+        hits[i].m_triangle_index = -1;
+        aabb_min.setMin(from[i]); aabb_min.setMin(to[i]);
+        aabb_max.setMax(from[i]); aabb_max.setMax(to[i]);
+    }
+
+    CollectObjects collect;
+    m_dynamicsWorld->getBroadphase()->aabbTest(aabb_min, aabb_max, collect);
+
+    for (int j = 0; j < collect.m_objects.size(); j++)
+    {
+        btCollisionObject *object = collect.m_objects[j];
+        const btCollisionShape *shape = object->getCollisionShape();
+        const btTransform &trans = object->getWorldTransform();
+        if (shape->isConcave())
+        {
+            // One BVH traversal for all rays
+            btTransform inv = trans.inverse();
+            AllRays all_rays;
+            btVector3 local_min = inv(from[0]), local_max = local_min;
+            for (int i = 0; i < count; i++)
+            {
+                btVector3 local_from = inv(from[i]), local_to = inv(to[i]);
+                local_min.setMin(local_from); local_min.setMin(local_to);
+                local_max.setMax(local_from); local_max.setMax(local_to);
+                all_rays.m_rays.push_back(TriangleRay(local_from, local_to,
+                                                      &hits[i], object,
+                                                      trans.getBasis()));
+            }
+            ((const btConcaveShape*)shape)->processAllTriangles(&all_rays,
+                                                                local_min,
+                                                                local_max);
+            continue;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            btTransform ray_from, ray_to;
+            ray_from.setIdentity(); ray_from.setOrigin(from[i]);
+            ray_to.setIdentity();   ray_to.setOrigin(to[i]);
+            btCollisionWorld::ClosestRayResultCallback callback(from[i], to[i]);
+            callback.m_closestHitFraction = hits[i].m_fraction;
+            btCollisionWorld::rayTestSingle(ray_from, ray_to, object, shape,
+                                            trans, callback);
+            if (callback.hasHit())
+            {
+                hits[i].m_object         = callback.m_collisionObject;
+                hits[i].m_fraction       = callback.m_closestHitFraction;
+                hits[i].m_normal         = callback.m_hitNormalWorld;
+                hits[i].m_triangle_index = -1;
+            }
+        }
+    }   // for j < collect.m_objects.size()
+
+    const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
+    for (int i = 0; i < count; i++)
+    {
+        objects[i] = NULL;
+        const btRigidBody *body = btRigidBody::upcast(hits[i].m_object);
+        if (!body || !body->hasContactResponse())
+            continue;
+        btVehicleRaycasterResult &result = results[i];
+        result.m_hitPointInWorld.setInterpolate3(from[i], to[i],
+                                                 hits[i].m_fraction);
+        result.m_hitNormalInWorld = hits[i].m_normal;
+        result.m_hitNormalInWorld.normalize();
+        result.m_distFraction     = hits[i].m_fraction;
+        result.m_triangle_index   = -1;
+        if (m_smooth_normals && hits[i].m_triangle_index > -1)
+        {
+            result.m_triangle_index = hits[i].m_triangle_index;
+            result.m_hitNormalInWorld =
+                tm.getInterpolatedNormal(hits[i].m_triangle_index,
+                                         result.m_hitPointInWorld);
+        }
+        objects[i] = (void*)body;
+    }
+}   // castRays
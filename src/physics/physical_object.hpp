@@ -164,6 +164,9 @@ public:
     void         move           (const Vec3& xyz, const core::vector3df& hpr);
     void         hit            (const Material *m, const Vec3 &normal);
     bool         isSoccerBall   () const;
+    // ------------------------------------------------------------------------
+    /** Returns true if this object is moved by the physics. */
+    bool         isDynamic      () const { return m_is_dynamic; }
     bool castRay(const btVector3 &from,
                  const btVector3 &to, btVector3 *hit_point,
                  const Material **material, btVector3 *normal,
@@ -177,6 +180,9 @@ public:
     /** Returns the rigid body of this physical object. */
     btRigidBody *getBody        ()          { return m_body; }
     // ------------------------------------------------------------------------
+    /** Returns the track object this physical object belongs to. */
+    TrackObject *getTrackObject () const    { return m_object; }
+    // ------------------------------------------------------------------------
     /** Returns true if this object should trigger a rescue in a kart that
      *  hits it. */
     bool isCrashReset() const { return m_crash_reset; }
@@ -22,6 +22,8 @@
 #include "animations/three_d_animation.hpp"
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
+#include "config/stk_config.hpp"
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stars.hpp"
@@ -40,8 +42,15 @@
 #include "race/race_manager.hpp"
 #include "scriptengine/script_engine.hpp"
 #include "tracks/track.hpp"
+#include "utils/job_system.hpp"
+#include "utils/memory_tracker.hpp"
 #include "utils/profiler.hpp"
 
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <map>
+
 // ----------------------------------------------------------------------------
 /** Initialise physics.
  *  Create the bullet dynamics world.
@@ -50,6 +59,7 @@ Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_num_threads         = 1;
 }   // Physics
 
 //-----------------------------------------------------------------------------
@@ -72,6 +82,15 @@ void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
                   0.0f));
     m_debug_drawer = new IrrDebugDrawer();
     m_dynamics_world->setDebugDrawer(m_debug_drawer);
+
+    m_num_threads = std::max((int)UserConfigParams::m_physics_threads, 1);
+    m_dynamics_world->setNumThreads(m_num_threads);
+    if(m_num_threads>1)
+    {
+        // Let bullet pass all islands to a single solveGroup call, which
+        // then solves them in parallel (see solveIslands).
+        m_dynamics_world->getSolverInfo().m_minimumSolverBatchSize = INT_MAX;
+    }
 }   // init
 
 //-----------------------------------------------------------------------------
@@ -82,6 +101,8 @@ Physics::~Physics()
     delete m_axis_sweep;
     delete m_dispatcher;
     delete m_collision_conf;
+    for(unsigned int i=0; i<m_island_solvers.size(); i++)
+        delete m_island_solvers[i];
 }   // ~Physics
 
 // ----------------------------------------------------------------------------
@@ -93,17 +114,56 @@ Physics::~Physics()
  */
 void Physics::addKart(const AbstractKart *kart)
 {
-    const btCollisionObjectArray &all_objs =
-        m_dynamics_world->getCollisionObjectArray();
-    for(unsigned int i=0; i<(unsigned int)all_objs.size(); i++)
-    {
-        if(btRigidBody::upcast(all_objs[i])== kart->getBody())
-            return;
-    }
-    m_dynamics_world->addRigidBody(kart->getBody());
+    // Bullet only sets the broadphase handle while a body is in the world
+    if(kart->getBody()->getBroadphaseHandle())
+        return;
+    addBody(kart->getBody());
     m_dynamics_world->addVehicle(kart->getVehicle());
 }   // addKart
 
+// ----------------------------------------------------------------------------
+/** Adds a rigid body to the physics world, with the collision group and
+ *  mask of its kind of object.
+ *  \param body The body to add, its user pointer must already be set.
+ */
+void Physics::addBody(btRigidBody *body)
+{
+    short group, mask;
+    getCollisionFilter(body, &group, &mask);
+    m_dynamics_world->addRigidBody(body, group, mask);
+}   // addBody
+
+// ----------------------------------------------------------------------------
+/** Determines the collision group and mask of a body. Static and kinematic
+ *  objects share one group and never collide with each other (as with
+ *  bullet's default filter). Each kind of dynamic object has its own
+ *  group, and its mask contains all kinds of objects it can interact
+ *  with; currently each of them interacts with all other objects.
+ *  \param body The rigid body.
+ *  \param group Returns the collision group.
+ *  \param mask Returns the collision mask.
+ */
+void Physics::getCollisionFilter(const btRigidBody *body, short *group,
+                                 short *mask)
+{
+    if(body->isStaticOrKinematicObject())
+    {
+        *group = CG_STATIC;
+        *mask  = CG_ALL & ~CG_STATIC;
+        return;
+    }
+    const UserPointer *up = (const UserPointer*)body->getUserPointer();
+    *mask = CG_ALL;
+    if(up && up->is(UserPointer::UP_KART))
+        *group = CG_KART;
+    else if(up && up->is(UserPointer::UP_FLYABLE))
+        *group = CG_FLYABLE;
+    else if(up && up->is(UserPointer::UP_PHYSICAL_OBJECT))
+        *group = CG_PHYSICAL_OBJECT;
+    else
+        *group = CG_DEFAULT;
+}   // getCollisionFilter
+
 //-----------------------------------------------------------------------------
 /** Removes a kart from the physics engine. This is used when rescuing a kart
  *  (and during cleanup).
@@ -139,6 +199,7 @@ void Physics::removeKart(const AbstractKart *kart)
 void Physics::update(float dt)
 {
     PROFILER_PUSH_CPU_MARKER("Physics", 0, 0, 0);
+    MemoryTracker::ScopedTag memory_tag(MemoryTracker::TAG_PHYSICS);
 
     m_physics_loop_active = true;
     // Bullet can report the same collision more than once (up to 4
@@ -148,10 +209,26 @@ void Physics::update(float dt)
     // are stored in a vector, but only one entry per collision pair
     // of objects.
     m_all_collisions.clear();
-
-    // Maximum of three substeps. This will work for framerate down to
-    // 20 FPS (bullet default frequency is 60 HZ).
-    m_dynamics_world->stepSimulation(dt, 3);
+    m_script_collisions.clear();
+
+    // The world is updated with a fixed time step (see MainLoop::updateRace),
+    // so the update is done in whole substeps. This keeps the simulation
+    // independent of the frame rate, and bullet doesn't need to interpolate
+    // the motion states. Fast objects are protected against tunneling by
+    // CCD (see Moveable::createBody), but the raycast wheels are not, so
+    // if anything moves too far in one step, the step is split.
+    int num_substeps = 1;
+    const float max_distance = dt * sqrtf(m_dynamics_world->getMaxSpeed2());
+    if (max_distance > stk_config->m_physics_substep_distance)
+    {
+        num_substeps = (int)ceilf(max_distance /
+                                  stk_config->m_physics_substep_distance);
+        num_substeps = std::min(num_substeps,
+                                stk_config->m_physics_max_substeps);
+    }
+    const float substep = dt / num_substeps;
+    for (int i = 0; i < num_substeps; i++)
+        m_dynamics_world->stepSimulation(substep, 1, substep);
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -168,12 +245,11 @@ void Physics::update(float dt)
                               p->getContactPointCS(0),
                               p->getUserPointer(1)->getPointerKart(),
                               p->getContactPointCS(1)                );
-            Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
-            int kartid1 = p->getUserPointer(0)->getPointerKart()->getWorldKartId();
-            int kartid2 = p->getUserPointer(1)->getPointerKart()->getWorldKartId();
-            Scripting::Physics::setCollision(kartid1,kartid2);
-            Scripting::Physics::setCollisionType("KartKart");
-            script_engine->runScript("collisions");
+            Scripting::Physics::CollisionEvent event;
+            event.m_type  = "KartKart";
+            event.m_kart1 = p->getUserPointer(0)->getPointerKart()->getWorldKartId();
+            event.m_kart2 = p->getUserPointer(1)->getPointerKart()->getWorldKartId();
+            m_script_collisions.push_back(event);
             continue;
         }  // if kart-kart collision
 
@@ -181,15 +257,13 @@ void Physics::update(float dt)
         {
             // Kart hits physical object
             // -------------------------
-            Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
-            Scripting::Physics::setCollision(0, 0);
-            Scripting::Physics::setCollisionType("KartObject"); //object as in physical object
-            Scripting::Physics::setCollision
-                (
-                p->getUserPointer(0)->getPointerPhysicalObject()->getID(),
-                "kart"
-                );
-            script_engine->runScript("collisions");
+            Scripting::Physics::CollisionEvent event;
+            event.m_type  = "KartObject"; //object as in physical object
+            event.m_kart1 = event.m_kart2 = 0;
+            event.m_collider1 =
+                p->getUserPointer(0)->getPointerPhysicalObject()->getID();
+            event.m_collider2 = "kart";
+            m_script_collisions.push_back(event);
             PhysicalObject *obj = p->getUserPointer(0)
                                    ->getPointerPhysicalObject();
             if(obj->isCrashReset())
@@ -255,15 +329,13 @@ void Physics::update(float dt)
         {
             // Projectile hits physical object
             // -------------------------------
-            Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
-            Scripting::Physics::setCollision(0,0); //TODO : support item types etc
-            Scripting::Physics::setCollisionType("ItemObject");
-            Scripting::Physics::setCollision
-                (
-                p->getUserPointer(1)->getPointerPhysicalObject()->getID(),
-                "item"
-                );
-            script_engine->runScript("collisions");
+            Scripting::Physics::CollisionEvent event;
+            event.m_type  = "ItemObject";
+            event.m_kart1 = event.m_kart2 = 0; //TODO : support item types etc
+            event.m_collider1 =
+                p->getUserPointer(1)->getPointerPhysicalObject()->getID();
+            event.m_collider2 = "item";
+            m_script_collisions.push_back(event);
             p->getUserPointer(0)->getPointerFlyable()
                 ->hit(NULL, p->getUserPointer(1)->getPointerPhysicalObject());
             PhysicalObject* obj = p->getUserPointer(1)->getPointerPhysicalObject();
@@ -324,6 +396,10 @@ void Physics::update(float dt)
         }
     }  // for all p in m_all_collisions
 
+    // Report all collisions of this step to the scripts at once
+    World::getWorld()->getScriptEngine()
+                     ->runCollisionScripts(m_script_collisions);
+
     m_physics_loop_active = false;
     // Now remove the karts that were removed while the above loop
     // was active. Now we can safely call removeKart, since the loop
@@ -489,8 +565,11 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
                              btStackAlloc* stackAlloc,
                              btDispatcher* dispatcher)
 {
-    btScalar returnValue=
-        btSequentialImpulseConstraintSolver::solveGroup(bodies, numBodies,
+    btScalar returnValue = m_num_threads>1
+        ? solveIslands(bodies, numBodies, manifold, numManifolds, constraints,
+                       numConstraints, info, debugDrawer, stackAlloc,
+                       dispatcher)
+        : btSequentialImpulseConstraintSolver::solveGroup(bodies, numBodies,
                                                         manifold, numManifolds,
                                                         constraints,
                                                         numConstraints, info,
@@ -643,6 +722,113 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
     return returnValue;
 }   // solveGroup
 
+// ----------------------------------------------------------------------------
+/** Solves the simulation islands passed to solveGroup in parallel. Objects
+ *  in different islands do not interact, so each island is solved with its
+ *  own solver, giving the same result as solving them one after another.
+ *  Bullet sorts the bodies, manifolds and constraints by island, so each
+ *  island is a range in each of these arrays. Static objects (e.g. the
+ *  track) are shared between islands, but the solver only adds impulses
+ *  scaled by their (zero) inverse mass to them.
+ */
+btScalar Physics::solveIslands(btCollisionObject** bodies, int numBodies,
+                               btPersistentManifold** manifold,
+                               int numManifolds,
+                               btTypedConstraint** constraints,
+                               int numConstraints,
+                               const btContactSolverInfo& info,
+                               btIDebugDraw* debugDrawer,
+                               btStackAlloc* stackAlloc,
+                               btDispatcher* dispatcher)
+{
+    m_islands.clear();
+    std::map<int, unsigned int> island_index;
+    for(int i=0; i<numBodies; i++)
+    {
+        int id = bodies[i]->getIslandTag();
+        if(m_islands.empty() || m_islands.back().m_id!=id)
+        {
+            Island island;
+            island.m_id             = id;
+            island.m_first_body     = i;
+            island.m_num_bodies     = 0;
+            island.m_first_manifold = island.m_num_manifolds   = 0;
+            island.m_first_constraint = island.m_num_constraints = 0;
+            island_index[id] = (unsigned int)m_islands.size();
+            m_islands.push_back(island);
+        }
+        m_islands.back().m_num_bodies++;
+    }
+
+    bool sorted = true;
+    for(int i=0; i<numManifolds && sorted; i++)
+    {
+        const btCollisionObject *a =
+            static_cast<const btCollisionObject*>(manifold[i]->getBody0());
+        const btCollisionObject *b =
+            static_cast<const btCollisionObject*>(manifold[i]->getBody1());
+        int id = a->getIslandTag()>=0 ? a->getIslandTag() : b->getIslandTag();
+        std::map<int, unsigned int>::iterator it = island_index.find(id);
+        if(it==island_index.end()) { sorted = false; break; }
+        Island &island = m_islands[it->second];
+        if(island.m_num_manifolds==0)
+            island.m_first_manifold = i;
+        else if(island.m_first_manifold+island.m_num_manifolds!=i)
+            sorted = false;
+        island.m_num_manifolds++;
+    }
+    for(int i=0; i<numConstraints && sorted; i++)
+    {
+        const btRigidBody &a = constraints[i]->getRigidBodyA();
+        const btRigidBody &b = constraints[i]->getRigidBodyB();
+        int id = a.getIslandTag()>=0 ? a.getIslandTag() : b.getIslandTag();
+        std::map<int, unsigned int>::iterator it = island_index.find(id);
+        if(it==island_index.end()) { sorted = false; break; }
+        Island &island = m_islands[it->second];
+        if(island.m_num_constraints==0)
+            island.m_first_constraint = i;
+        else if(island.m_first_constraint+island.m_num_constraints!=i)
+            sorted = false;
+        island.m_num_constraints++;
+    }
+
+    // Should not happen, but if the data is not sorted as expected
+    // just solve everything at once.
+    if(!sorted || m_islands.size()<2)
+    {
+        return btSequentialImpulseConstraintSolver::solveGroup(bodies,
+                                 numBodies, manifold, numManifolds,
+                                 constraints, numConstraints, info,
+                                 debugDrawer, stackAlloc, dispatcher);
+    }
+
+    while(m_island_solvers.size()<m_islands.size())
+        m_island_solvers.push_back(new btSequentialImpulseConstraintSolver());
+
+    const int num_islands = (int)m_islands.size();
+    JobSystem::get()->parallelFor(0, num_islands, 1, [&](int begin, int end)
+    {
+        for(int i=begin; i<end; i++)
+        {
+            const Island &island = m_islands[i];
+            if(island.m_num_manifolds+island.m_num_constraints==0)
+                continue;
+            m_island_solvers[i]->solveGroup(bodies+island.m_first_body,
+                                            island.m_num_bodies,
+                                            island.m_num_manifolds
+                                            ? manifold+island.m_first_manifold
+                                            : NULL,
+                                            island.m_num_manifolds,
+                                            island.m_num_constraints
+                                            ? constraints+island.m_first_constraint
+                                            : NULL,
+                                            island.m_num_constraints, info,
+                                            debugDrawer, stackAlloc, dispatcher);
+        }
+    }, m_num_threads);
+    return 0.0f;
+}   // solveIslands
+
 // ----------------------------------------------------------------------------
 /** A debug draw function to show the track and all karts.
  */
@@ -666,6 +852,107 @@ void Physics::draw()
     return;
 }   // draw
 
+// ----------------------------------------------------------------------------
+namespace
+{
+    /** Collects all objects of one type whose bounding box overlaps the box
+     *  of a broadphase query. */
+    struct CollectUserPointers : public btBroadphaseAabbCallback
+    {
+        UserPointer::UserPointerType m_type;
+        std::vector<UserPointer*>    m_objects;
+        CollectUserPointers(UserPointer::UserPointerType type) : m_type(type)
+        {}
+        virtual bool process(const btBroadphaseProxy* proxy)
+        {
+            const btCollisionObject *object =
+                (const btCollisionObject*)proxy->m_clientObject;
+            UserPointer *up = (UserPointer*)object->getUserPointer();
+            if(up && up->is(m_type))
+                m_objects.push_back(up);
+            return true;
+        }   // process
+    };   // CollectUserPointers
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+/** Compares karts by their world kart id. */
+static bool compareWorldKartId(const AbstractKart *a, const AbstractKart *b)
+{
+    return a->getWorldKartId() < b->getWorldKartId();
+}   // compareWorldKartId
+
+// ----------------------------------------------------------------------------
+/** Returns all karts whose position is within a certain distance of a point.
+ *  This uses the broadphase of the physics world (which is updated in each
+ *  time step anyway), so only the karts close to the point are tested.
+ *  \param center The center of the sphere.
+ *  \param radius Radius of the sphere.
+ *  \param karts Returns the karts, sorted by world kart id (i.e. in the
+ *         same order a loop over all karts would find them).
+ */
+void Physics::getKartsInSphere(const Vec3 &center, float radius,
+                               std::vector<AbstractKart*> *karts) const
+{
+    karts->clear();
+    // The chassis of a kart contains its position, so its bounding box
+    // overlaps the box around the sphere if the kart is inside of it.
+    const btVector3 extend(radius, radius, radius);
+    CollectUserPointers collect(UserPointer::UP_KART);
+    m_dynamics_world->getBroadphase()->aabbTest(center - extend,
+                                                center + extend, collect);
+    const float r2 = radius*radius;
+    for(unsigned int i=0; i<collect.m_objects.size(); i++)
+    {
+        AbstractKart *kart = collect.m_objects[i]->getPointerKart();
+        if(kart->getXYZ().distance2(center) < r2)
+            karts->push_back(kart);
+    }
+    std::sort(karts->begin(), karts->end(), compareWorldKartId);
+}   // getKartsInSphere
+
+// ----------------------------------------------------------------------------
+/** Returns all physical objects whose bounding box overlaps a sphere. Like
+ *  getKartsInSphere this uses the broadphase, so e.g. an explosion only
+ *  tests the objects close to it instead of all objects of the track.
+ *  \param center The center of the sphere.
+ *  \param radius Radius of the sphere.
+ *  \param objects Returns the objects.
+ */
+void Physics::getPhysicalObjectsInSphere(const Vec3 &center, float radius,
+                                 std::vector<PhysicalObject*> *objects) const
+{
+    objects->clear();
+    const btVector3 extend(radius, radius, radius);
+    CollectUserPointers collect(UserPointer::UP_PHYSICAL_OBJECT);
+    m_dynamics_world->getBroadphase()->aabbTest(center - extend,
+                                                center + extend, collect);
+    for(unsigned int i=0; i<collect.m_objects.size(); i++)
+        objects->push_back(collect.m_objects[i]->getPointerPhysicalObject());
+}   // getPhysicalObjectsInSphere
+
+// ----------------------------------------------------------------------------
+/** Returns true if the position of a flyable is within a certain distance of
+ *  a point. Like getKartsInSphere this uses the broadphase.
+ *  \param center The center of the sphere.
+ *  \param radius Radius of the sphere.
+ */
+bool Physics::hasFlyableInSphere(const Vec3 &center, float radius) const
+{
+    const btVector3 extend(radius, radius, radius);
+    CollectUserPointers collect(UserPointer::UP_FLYABLE);
+    m_dynamics_world->getBroadphase()->aabbTest(center - extend,
+                                                center + extend, collect);
+    const float r2 = radius*radius;
+    for(unsigned int i=0; i<collect.m_objects.size(); i++)
+    {
+        if(collect.m_objects[i]->getPointerFlyable()->getXYZ()
+                                                  .distance2(center) < r2)
+            return true;
+    }
+    return false;
+}   // hasFlyableInSphere
+
 // ----------------------------------------------------------------------------
 
 /* EOF */
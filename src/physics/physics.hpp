@@ -25,6 +25,8 @@
   */
 
 #include <set>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "btBulletDynamicsCommon.h"
@@ -32,8 +34,10 @@
 #include "physics/irr_debug_drawer.hpp"
 #include "physics/stk_dynamics_world.hpp"
 #include "physics/user_pointer.hpp"
+#include "scriptengine/script_engine.hpp"
 
 class AbstractKart;
+class PhysicalObject;
 class STKDynamicsWorld;
 class Vec3;
 
@@ -42,17 +46,33 @@ class Vec3;
   */
 class Physics : public btSequentialImpulseConstraintSolver
 {
+public:
+    /** The collision groups of the different kinds of objects. Bullet only
+     *  tests two objects for a collision if the group of each of them is
+     *  in the mask of the other one, see getCollisionFilter(). Ray tests
+     *  use bullet's default filter, so every mask contains CG_DEFAULT. */
+    enum CollisionGroup
+    {
+        CG_DEFAULT         = btBroadphaseProxy::DefaultFilter,
+        /** Static and kinematic objects (e.g. the track), which never
+         *  collide with each other. */
+        CG_STATIC          = btBroadphaseProxy::StaticFilter,
+        CG_KART            = 1 << 6,
+        CG_FLYABLE         = 1 << 7,
+        CG_PHYSICAL_OBJECT = 1 << 8,
+        CG_ALL             = btBroadphaseProxy::AllFilter
+    };   // CollisionGroup
+
 private:
     /** Bullet can report the same collision more than once (up to 4
      *  contact points per collision. Additionally, more than one internal
      *  substep might be taken, resulting in potentially even more
      *  duplicates. To handle this, all collisions (i.e. pair of objects)
      *  are stored in a vector, but only one entry per collision pair
-     *  of objects.
-     *  While this is a natural application of std::set, the set has some
-     *  overhead (since it will likely use a tree to sort the entries).
-     *  Considering that the number of collisions is usually rather small
-     *  a simple list and linear search is faster is is being used here. */
+     *  of objects. The vector keeps the order in which the collisions
+     *  were reported, and a hash set of the pairs finds duplicates in
+     *  constant time, since with many karts close to each other (e.g. at
+     *  the start) a linear search becomes too slow. */
     class CollisionPair {
     private:
         /** The user pointer of the objects involved in this collision. */
@@ -106,14 +126,35 @@ private:
     class CollisionList : public std::vector<CollisionPair>
     {
     private:
-        void push_back(CollisionPair p) {
+        typedef std::pair<const UserPointer*, const UserPointer*> Key;
+        /** Hash function for the user pointers of a pair. */
+        struct KeyHash
+        {
+            size_t operator()(const Key &k) const
+            {
+                const size_t h = std::hash<const UserPointer*>()(k.first);
+                return h ^ (std::hash<const UserPointer*>()(k.second)
+                            + 0x9e3779b9 + (h << 6) + (h >> 2));
+            }   // operator()
+        };   // KeyHash
+
+        /** All pairs in this list. */
+        std::unordered_set<Key, KeyHash> m_pairs;
+
+        void push_back(const CollisionPair &p) {
             // only add a pair if it's not already in there
-            for(iterator i=begin(); i!=end(); i++) {
-                if((*i)==p) return;
-            }
-            std::vector<CollisionPair>::push_back(p);
+            if(m_pairs.insert(Key(p.getUserPointer(0),
+                                  p.getUserPointer(1))).second)
+                std::vector<CollisionPair>::push_back(p);
         };  // push_back
     public:
+        /** Removes all collisions. */
+        void clear()
+        {
+            std::vector<CollisionPair>::clear();
+            m_pairs.clear();
+        }   // clear
+        // --------------------------------------------------------------------
         /** Adds information about a collision to this vector. */
         void push_back(const UserPointer *a, const btVector3 &contact_point_a,
                        const UserPointer *b, const btVector3 &contact_point_b)
@@ -122,6 +163,17 @@ private:
         }
     };  // CollisionList
     // ========================================================================
+    /** A simulation island, i.e. a group of objects that can be solved
+     *  independently of all other objects. It is stored as ranges in the
+     *  arrays passed to solveGroup. */
+    struct Island
+    {
+        int m_id;
+        int m_first_body,       m_num_bodies;
+        int m_first_manifold,   m_num_manifolds;
+        int m_first_constraint, m_num_constraints;
+    };   // Island
+    // ========================================================================
 
     /** This flag is set while bullets time step processing is taking
     *  place. It is used to avoid altering data structures that might
@@ -145,18 +197,46 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** The collisions of this time step that are reported to the
+     *  collisions script of the track. */
+    std::vector<Scripting::Physics::CollisionEvent> m_script_collisions;
+
+    /** Number of threads used to solve the simulation islands. */
+    int                              m_num_threads;
+
+    /** The islands of the current solveGroup call. */
+    std::vector<Island>              m_islands;
+
+    /** One solver for each island, so that islands can be solved in
+     *  parallel (the solvers keep temporary data while solving). */
+    std::vector<btSequentialImpulseConstraintSolver*> m_island_solvers;
+
+    static void getCollisionFilter(const btRigidBody *body, short *group,
+                                   short *mask);
+    btScalar solveIslands(btCollisionObject** bodies, int numBodies,
+                          btPersistentManifold** manifold, int numManifolds,
+                          btTypedConstraint** constraints, int numConstraints,
+                          const btContactSolverInfo& info,
+                          btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,
+                          btDispatcher* dispatcher);
+
 public:
           Physics          ();
          ~Physics          ();
     void  init             (const Vec3 &min_world, const Vec3 &max_world);
     void  addKart          (const AbstractKart *k);
-    void  addBody          (btRigidBody* b) {m_dynamics_world->addRigidBody(b);}
+    void  addBody          (btRigidBody* b);
     void  removeKart       (const AbstractKart *k);
     void  removeBody       (btRigidBody* b) {m_dynamics_world->removeRigidBody(b);}
     void  KartKartCollision(AbstractKart *ka, const Vec3 &contact_point_a,
                             AbstractKart *kb, const Vec3 &contact_point_b);
     void  update           (float dt);
     void  draw             ();
+    void  getKartsInSphere (const Vec3 &center, float radius,
+                            std::vector<AbstractKart*> *karts) const;
+    void  getPhysicalObjectsInSphere(const Vec3 &center, float radius,
+                            std::vector<PhysicalObject*> *objects) const;
+    bool  hasFlyableInSphere(const Vec3 &center, float radius) const;
     STKDynamicsWorld*
           getPhysicsWorld  () const {return m_dynamics_world;}
     /** Activates the next debug mode (or switches it off again).
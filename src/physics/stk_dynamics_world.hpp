@@ -19,10 +19,20 @@
 #ifndef HEADER_STK_DYNAMICS_WORLD_HPP
 #define HEADER_STK_DYNAMICS_WORLD_HPP
 
+#include "utils/job_system.hpp"
+
 #include "btBulletDynamicsCommon.h"
 
 class STKDynamicsWorld : public btDiscreteDynamicsWorld
 {
+private:
+    /** Number of threads used to compute the bounding boxes of the
+     *  objects. */
+    int m_num_threads;
+
+    /** The bounding boxes computed in updateAabbs. */
+    btAlignedObjectArray<btVector3> m_aabb_min, m_aabb_max;
+
 public:
     /** The standard constructor which just created a btDiscreteDynamicsWorld. */
     STKDynamicsWorld(btDispatcher*             dispatcher,
@@ -34,12 +44,98 @@ public:
                                              constraintSolver,
                                              collisionConfiguration)
     {
+        m_num_threads = 1;
     }
 
     /** Resets m_localTime to 0. This allows more precise replay of
      *  physics, which is important for replaying histories. */
     virtual void resetLocalTime() { m_localTime = 0; }
 
+    // ------------------------------------------------------------------------
+    /** Returns the square of the highest speed of all moving bodies. */
+    btScalar getMaxSpeed2() const
+    {
+        btScalar max_speed2 = 0;
+        for (int i = 0; i < m_nonStaticRigidBodies.size(); i++)
+        {
+            const btRigidBody *body = m_nonStaticRigidBodies[i];
+            if (!body->isActive() || body->isStaticOrKinematicObject())
+                continue;
+            max_speed2 = btMax(max_speed2, body->getLinearVelocity().length2());
+        }
+        return max_speed2;
+    }   // getMaxSpeed2
+
+    // ------------------------------------------------------------------------
+    /** Sets the number of threads used to update the bounding boxes. */
+    void setNumThreads(int num_threads) { m_num_threads = num_threads; }
+
+    // ------------------------------------------------------------------------
+    /** Updates the bounding boxes of all active objects in the broadphase.
+     *  The same as btCollisionWorld::updateAabbs, except that the boxes are
+     *  computed in parallel. Only the (not thread safe) update of the
+     *  broadphase is done serially. */
+    virtual void updateAabbs()
+    {
+        if (m_num_threads <= 1)
+        {
+            btDiscreteDynamicsWorld::updateAabbs();
+            return;
+        }
+
+        const int num_objects = m_collisionObjects.size();
+        m_aabb_min.resize(num_objects);
+        m_aabb_max.resize(num_objects);
+        const btVector3 threshold(gContactBreakingThreshold,
+                                  gContactBreakingThreshold,
+                                  gContactBreakingThreshold);
+        // Split into one chunk per thread, the work per object is similar
+        const int chunk = (num_objects + m_num_threads - 1) / m_num_threads;
+        JobSystem::get()->parallelFor(0, num_objects, chunk,
+                                      [&](int begin, int end)
+        {
+            for (int i = begin; i < end; i++)
+            {
+                btCollisionObject *object = m_collisionObjects[i];
+                if (!m_forceUpdateAllAabbs && !object->isActive())
+                    continue;
+                btVector3 &min = m_aabb_min[i], &max = m_aabb_max[i];
+                object->getCollisionShape()->getAabb(object->getWorldTransform(),
+                                                     min, max);
+                if (getDispatchInfo().m_useContinuous &&
+                    object->getInternalType() == btCollisionObject::CO_RIGID_BODY)
+                {
+                    btVector3 min2, max2;
+                    object->getCollisionShape()
+                          ->getAabb(object->getInterpolationWorldTransform(),
+                                    min2, max2);
+                    min.setMin(min2);
+                    max.setMax(max2);
+                }
+                min -= threshold;
+                max += threshold;
+            }
+        }, m_num_threads);
+
+        for (int i = 0; i < num_objects; i++)
+        {
+            btCollisionObject *object = m_collisionObjects[i];
+            if (!m_forceUpdateAllAabbs && !object->isActive())
+                continue;
+            // Moving objects with a huge box are removed from the simulation
+            // by bullet, so leave that case to updateSingleAabb.
+            if (!object->isStaticObject() &&
+                (m_aabb_max[i] - m_aabb_min[i]).length2() >= btScalar(1e12))
+            {
+                updateSingleAabb(object);
+                continue;
+            }
+            m_broadphasePairCache->setAabb(object->getBroadphaseHandle(),
+                                           m_aabb_min[i], m_aabb_max[i],
+                                           m_dispatcher1);
+        }
+    }   // updateAabbs
+
 };   // STKDynamicsWorld
 #endif
 /* EOF */
@@ -20,12 +20,47 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/load_profiler.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 
 #include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    /** Header of a shared mesh file, see TriangleMesh::shareMesh. It is
+     *  followed (at offset DATA_OFFSET, so that the vectors are aligned) by
+     *  the vertices, the normals, the indices and the smoothing values. */
+    struct SharedMeshHeader
+    {
+        char     m_magic[4];
+        uint32_t m_version;
+        /** Detects files written on a machine with a different byte
+         *  order, for which the file is not used. */
+        uint32_t m_byte_order;
+        uint32_t m_num_triangles;
+        /** The normals depend on the smooth angle limit, see addTriangle. */
+        float    m_smooth_angle_limit;
+    };   // SharedMeshHeader
+
+    const uint32_t SHARED_MESH_VERSION = 1;
+    const size_t   DATA_OFFSET         = 64;
+
+    /** Returns the size of a shared mesh file with n triangles. */
+    size_t getSharedMeshSize(size_t n)
+    {
+        return DATA_OFFSET + 6*n*sizeof(btVector3) + 3*n*sizeof(int)
+                           + n*sizeof(float);
+    }   // getSharedMeshSize
+}   // namespace
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -42,7 +77,22 @@ TriangleMesh::TriangleMesh() : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_file         = NULL;
+    m_mesh_file        = NULL;
+    m_normal_data      = NULL;
+    m_p1p2p3_data      = NULL;
     m_user_pointer.set(this);
+
+    btIndexedMesh mesh;
+    mesh.m_numTriangles        = 0;
+    mesh.m_triangleIndexBase   = NULL;
+    mesh.m_triangleIndexStride = 3*sizeof(int);
+    mesh.m_numVertices         = 0;
+    mesh.m_vertexBase          = NULL;
+    mesh.m_vertexStride        = sizeof(btVector3);
+    mesh.m_indexType           = PHY_INTEGER;
+    mesh.m_vertexType          = PHY_FLOAT;
+    m_mesh.addIndexedMesh(mesh, PHY_INTEGER);
 }   // TriangleMesh
 
 // -----------------------------------------------------------------------------
@@ -51,6 +101,7 @@ TriangleMesh::TriangleMesh() : m_mesh()
 TriangleMesh::~TriangleMesh()
 {
     removeAll();
+    delete m_mesh_file;
 }   // ~TriangleMesh
 
 // -----------------------------------------------------------------------------
@@ -66,6 +117,7 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
                                const btVector3 &n3,
                                const Material* m)
 {
+    unshareMesh();
     m_triangleIndex2Material.push_back(m);
 
     btVector3 normal = (t2-t1).cross(t3-t1);
@@ -76,22 +128,276 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
                          ? normal : n2                                     );
     m_normals.push_back( normal.angle(n3)>stk_config->m_smooth_angle_limit
                          ? normal : n3                                     );
-    m_mesh.addTriangle(t1, t2, t3);
+    const int first = (int)m_vertices.size();
+    m_vertices.push_back(t1);
+    m_vertices.push_back(t2);
+    m_vertices.push_back(t3);
+    m_indices.push_back(first);
+    m_indices.push_back(first+1);
+    m_indices.push_back(first+2);
 
     // Area of triangle ABC
     btVector3 edge1 = t2 - t1;
     btVector3 edge2 = t3 - t1;
     m_p1p2p3.push_back(edge1.cross(edge2).length2());
+
+    // The arrays might have been reallocated
+    setMeshData(&m_vertices[0], &m_indices[0], &m_normals[0], &m_p1p2p3[0]);
 }   // addTriangle
 
+// -----------------------------------------------------------------------------
+/** Sets the data used by the mesh, which contains all triangles added.
+ *  \param vertices The three vertices of each triangle.
+ *  \param indices The three vertex indices of each triangle.
+ *  \param normals The three normals of each triangle.
+ *  \param p1p2p3 The smoothing value of each triangle, see addTriangle.
+ */
+void TriangleMesh::setMeshData(const btVector3 *vertices, const int *indices,
+                               const btVector3 *normals, const float *p1p2p3)
+{
+    btIndexedMesh &mesh = m_mesh.getIndexedMeshArray()[0];
+    const int n = (int)m_triangleIndex2Material.size();
+    mesh.m_numTriangles      = n;
+    mesh.m_triangleIndexBase = (const unsigned char*)indices;
+    mesh.m_numVertices       = 3*n;
+    mesh.m_vertexBase        = (const unsigned char*)vertices;
+    m_normal_data            = normals;
+    m_p1p2p3_data            = p1p2p3;
+}   // setMeshData
+
+// -----------------------------------------------------------------------------
+/** Moves the vertices, normals and indices of this mesh into a file which is
+ *  mapped read only. Several STK processes on one host (e.g. a few servers)
+ *  which load the same track then share the physical memory of the mesh,
+ *  since the pages of a mapped file are shared. The file is written if it
+ *  does not exist or does not contain exactly the data of this mesh (so an
+ *  outdated file, or one written by another process at the same time, is
+ *  never used). The file only contains offsets but no pointers, so it can
+ *  be mapped at any address, and it is never modified once mapped.
+ *  \param file Name of the shared mesh file.
+ */
+void TriangleMesh::shareMesh(const std::string &file)
+{
+    if (m_mesh_file || m_triangleIndex2Material.empty())
+        return;
+    MappedFile *mapped = loadSharedMesh(file);
+    if (!mapped)
+    {
+        saveSharedMesh(file);
+        mapped = loadSharedMesh(file);
+        if (!mapped)
+            return;
+    }
+
+    const size_t n = m_triangleIndex2Material.size();
+    const char *data = mapped->getData() + DATA_OFFSET;
+    const btVector3 *vertices = (const btVector3*)data;
+    const btVector3 *normals  = vertices + 3*n;
+    const int       *indices  = (const int*)(normals + 3*n);
+    const float     *p1p2p3   = (const float*)(indices + 3*n);
+    setMeshData(vertices, indices, normals, p1p2p3);
+    m_mesh_file = mapped;
+
+    // Free the memory of the local copy
+    AlignedArray<btVector3>().swap(m_vertices);
+    AlignedArray<int>().swap(m_indices);
+    AlignedArray<btVector3>().swap(m_normals);
+    AlignedArray<float>().swap(m_p1p2p3);
+}   // shareMesh
+
+// -----------------------------------------------------------------------------
+/** Maps a shared mesh file, if it contains exactly the data of this mesh.
+ *  \param file Name of the shared mesh file.
+ *  \return The mapped file, or NULL if it can not be used.
+ */
+MappedFile *TriangleMesh::loadSharedMesh(const std::string &file) const
+{
+    const size_t n = m_triangleIndex2Material.size();
+    MappedFile *mapped = new MappedFile(file);
+    if (!mapped->isValid() || mapped->getSize() != getSharedMeshSize(n))
+    {
+        delete mapped;
+        return NULL;
+    }
+
+    const SharedMeshHeader *header =
+        (const SharedMeshHeader*)mapped->getData();
+    const char *data = mapped->getData() + DATA_OFFSET;
+    if (memcmp(header->m_magic, "STKM", 4) != 0                         ||
+        header->m_version != SHARED_MESH_VERSION                        ||
+        header->m_byte_order != 0x01020304                              ||
+        header->m_num_triangles != n                                    ||
+        header->m_smooth_angle_limit != stk_config->m_smooth_angle_limit ||
+        memcmp(data, &m_vertices[0], 3*n*sizeof(btVector3)) != 0        ||
+        memcmp(data + 3*n*sizeof(btVector3), &m_normals[0],
+               3*n*sizeof(btVector3)) != 0                                )
+    {
+        delete mapped;
+        return NULL;
+    }
+    // The indices and smoothing values only depend on the vertices
+    return mapped;
+}   // loadSharedMesh
+
+// -----------------------------------------------------------------------------
+/** Writes the data of this mesh to a shared mesh file.
+ *  \param file Name of the shared mesh file.
+ */
+void TriangleMesh::saveSharedMesh(const std::string &file) const
+{
+    const size_t n = m_triangleIndex2Material.size();
+    char header[DATA_OFFSET];
+    memset(header, 0, DATA_OFFSET);
+    SharedMeshHeader *h = (SharedMeshHeader*)header;
+    memcpy(h->m_magic, "STKM", 4);
+    h->m_version            = SHARED_MESH_VERSION;
+    h->m_byte_order         = 0x01020304;
+    h->m_num_triangles      = (uint32_t)n;
+    h->m_smooth_angle_limit = stk_config->m_smooth_angle_limit;
+
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+    out.write(header, DATA_OFFSET);
+    out.write((const char*)&m_vertices[0], 3*n*sizeof(btVector3));
+    out.write((const char*)&m_normals[0],  3*n*sizeof(btVector3));
+    out.write((const char*)&m_indices[0],  3*n*sizeof(int));
+    out.write((const char*)&m_p1p2p3[0],   n*sizeof(float));
+    if (out.fail())
+        Log::warn("TriangleMesh", "Could not save mesh to '%s'.",
+                  file.c_str());
+}   // saveSharedMesh
+
+// -----------------------------------------------------------------------------
+/** Copies the data of a shared mesh back into this object, which is
+ *  necessary before triangles can be added.
+ */
+void TriangleMesh::unshareMesh()
+{
+    if (!m_mesh_file)
+        return;
+    const btIndexedMesh &mesh = m_mesh.getIndexedMeshArray()[0];
+    const size_t n = m_triangleIndex2Material.size();
+    const btVector3 *vertices = (const btVector3*)mesh.m_vertexBase;
+    const int       *indices  = (const int*)mesh.m_triangleIndexBase;
+    m_vertices.assign(vertices,      vertices + 3*n);
+    m_normals.assign(m_normal_data,  m_normal_data + 3*n);
+    m_indices.assign(indices,        indices + 3*n);
+    m_p1p2p3.assign(m_p1p2p3_data,   m_p1p2p3_data + n);
+    setMeshData(&m_vertices[0], &m_indices[0], &m_normals[0], &m_p1p2p3[0]);
+    delete m_mesh_file;
+    m_mesh_file = NULL;
+}   // unshareMesh
+
+// -----------------------------------------------------------------------------
+/** Returns a hash of all triangles. It is used to name files cached for
+ *  this mesh, so that a modified track (e.g. an updated addon) will not use
+ *  outdated data.
+ */
+uint64_t TriangleMesh::getGeometryHash() const
+{
+    // FNV-1a hash of all vertex coordinates
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < m_triangleIndex2Material.size(); i++)
+    {
+        btVector3 *p[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            float xyz[3] = { p[j]->getX(), p[j]->getY(), p[j]->getZ() };
+            const unsigned char *data = (const unsigned char*)xyz;
+            for (unsigned int k = 0; k < sizeof(xyz); k++)
+            {
+                hash ^= data[k];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}   // getGeometryHash
+
+// -----------------------------------------------------------------------------
+/** Returns the name of the file in which the BVH of this mesh is cached. The
+ *  name contains the hash of all triangles.
+ */
+std::string TriangleMesh::getBvhCacheFile() const
+{
+    const uint64_t hash = getGeometryHash();
+    std::string dir = file_manager->getCachedTexturesDir() + "bvh/";
+    file_manager->checkAndCreateDirectoryP(dir);
+    char name[32];
+    sprintf(name, "%08x%08x.bvh", (unsigned)(hash >> 32), (unsigned)hash);
+    return dir + name;
+}   // getBvhCacheFile
+
+// -----------------------------------------------------------------------------
+/** Loads a BVH saved by saveBvh() and creates the collision shape with it.
+ *  \param file The file to load.
+ *  \return The collision shape, or NULL if the file could not be used.
+ */
+btBvhTriangleMeshShape *TriangleMesh::loadBvh(const char *file)
+{
+    // The BVH is deserialized in place, which modifies the data, so the
+    // file is mapped copy-on-write. Only the pages that are modified are
+    // copied, the rest (i.e. the nodes) are used directly from the file.
+    MappedFile *mapped = new MappedFile(file, /*copy_on_write*/true);
+    // Mapped files are page aligned, as required by deSerializeInPlace
+    btOptimizedBvh *bvh = mapped->isValid()
+                        ? btOptimizedBvh::deSerializeInPlace(mapped->getData(),
+                                               (unsigned int)mapped->getSize(),
+                                               !IS_LITTLE_ENDIAN)
+                        : NULL;
+    if (mapped->isValid())
+        LoadProfiler::addBytes(LoadProfiler::STAGE_BVH, mapped->getSize());
+    if (bvh == NULL || !bvh->isQuantized())
+    {
+        if (mapped->isValid())
+            Log::warn("TriangleMesh", "Failed to load serialized BVH '%s'.",
+                      file);
+        delete mapped;
+        return NULL;
+    }
+
+    btBvhTriangleMeshShape *shape =
+        new btBvhTriangleMeshShape(&m_mesh, true /* useQuantizedAabbCompression */,
+                                   false /* buildBvh */);
+    shape->setOptimizedBvh(bvh);
+    // Do *NOT* unmap the file now, 'deSerializeInPlace' makes the
+    // btOptimizedBvh object directly at this memory location
+    m_bvh_file = mapped;
+    return shape;
+}   // loadBvh
+
+// -----------------------------------------------------------------------------
+/** Saves the BVH of a collision shape, so that it does not need to be built
+ *  again the next time the same mesh is loaded.
+ *  \param shape The collision shape.
+ *  \param file The file to save the BVH in.
+ */
+void TriangleMesh::saveBvh(btBvhTriangleMeshShape *shape,
+                           const char *file) const
+{
+    const btOptimizedBvh *bvh = shape->getOptimizedBvh();
+    unsigned int size = bvh->calculateSerializeBufferSize();
+    void *buffer = btAlignedAlloc(size, 16);
+    if (bvh->serialize(buffer, size, !IS_LITTLE_ENDIAN))
+    {
+        std::ofstream out(file, std::ios::out | std::ios::binary);
+        out.write((const char*)buffer, size);
+        if (out.fail())
+            Log::warn("TriangleMesh", "Could not save BVH to '%s'.", file);
+    }
+    btAlignedFree(buffer);
+}   // saveBvh
+
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  @param serialized_bhv if non-null, the BVH is loaded from this file
+ *                        instead of being built. If the file can't be used,
+ *                        the BVH is built and saved to this file.
  */
 void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_BVH);
     if(m_triangleIndex2Material.size()==0)
     {
         m_collision_shape  = NULL;
@@ -101,55 +407,22 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
         return;
     }
     // Now convert the triangle mesh into a static rigid body
-    btBvhTriangleMeshShape* bhv_triangle_mesh;
+    btBvhTriangleMeshShape* bhv_triangle_mesh = NULL;
 
     if (serialized_bhv != NULL)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        assert(pos != -1L);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
-        {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-        }
-        else
-        {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
-        }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
+        // The mesh is shared next to its cached BVH. This must be done
+        // before the collision shape is created, which uses the mesh.
+        shareMesh(StringUtils::removeExtension(serialized_bhv)+".mesh");
+        bhv_triangle_mesh = loadBvh(serialized_bhv);
     }
-    else
+
+    if (bhv_triangle_mesh == NULL)
     {
-        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        // A quantized BVH uses less memory and is traversed faster
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, true /* useQuantizedAabbCompression */);
+        if (serialized_bhv != NULL)
+            saveBvh(bhv_triangle_mesh, serialized_bhv);
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -189,9 +462,9 @@ void TriangleMesh::createPhysicalBody(btCollisionObject::CollisionFlags flags,
     btRigidBody::btRigidBodyConstructionInfo info(0.0f, m_motion_state,
                                                   m_collision_shape);
     m_body=new btRigidBody(info);
-    World::getWorld()->getPhysics()->addBody(m_body);
-
+    // The user pointer determines the collision group, see Physics::addBody
     m_body->setUserPointer(&m_user_pointer);
+    World::getWorld()->getPhysics()->addBody(m_body);
     m_body->setCollisionFlags(m_body->getCollisionFlags()  |
                               flags                        |
                               btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
@@ -222,6 +495,8 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    delete m_bvh_file;
+    m_bvh_file = NULL;
 }   // removeAll
 
 // -----------------------------------------------------------------------------
@@ -273,29 +548,18 @@ btVector3 TriangleMesh::getInterpolatedNormal(unsigned int index,
 }   // getInterpolatedNormal
 
 // ----------------------------------------------------------------------------
-/** Casts a ray from 'from' to 'to'. If a triangle of this mesh was hit,
- *  xyz and material will be set.
+/** Casts a ray against the BVH of this mesh.
  *  \param from/to The from and to position for the raycast.
- *  \param xyz The position in world where the ray hit.
- *  \param material The material of the mesh that was hit.
- *  \param normal The intrapolated normal at that position.
- *  \param interpolate_normal If true, the returned normal is the interpolated
- *         based on the three normals of the triangle and the location of the
- *         hit point (which is more compute intensive, but results in much
- *         smoother results).
- *  \return True if a triangle was hit, false otherwise (and no output
- *          variable will be set.
+ *  \param world_trans The transform of this mesh.
+ *  \param index On return the index of the triangle hit.
+ *  \param hit_point On return the position in world where the ray hit.
+ *  \param hit_normal On return the normal of the triangle hit.
+ *  \return True if a triangle was hit.
  */
-bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
-                           btVector3 *xyz, const Material **material,
-                           btVector3 *normal, bool interpolate_normal) const
+bool TriangleMesh::rayTest(const btVector3 &from, const btVector3 &to,
+                           const btTransform &world_trans, int *index,
+                           btVector3 *hit_point, btVector3 *hit_normal) const
 {
-    if(!m_collision_shape)
-    {
-        *material=NULL;
-        return false;
-    }
-
     btTransform trans_from;
     trans_from.setIdentity();
     trans_from.setOrigin(from);
@@ -304,15 +568,6 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     trans_to.setIdentity();
     trans_to.setOrigin(to);
 
-    btTransform world_trans;
-    // If there is a body, take the current transform from the body.
-    if(m_body)
-        world_trans = m_body->getWorldTransform();
-    else
-        world_trans.setIdentity();
-
-    btCollisionWorld::ClosestRayResultCallback result(from, to);
-
     /** A special ray result class that stores the index of the triangle
      *  that was hit. */
     class MaterialRayResult : public btCollisionWorld::ClosestRayResultCallback
@@ -346,11 +601,137 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
                                     m_collision_object ? m_collision_object : m_body,
                                     m_collision_shape, world_trans,
                                     ray_callback);
-    // Get the index of the triangle hit
-    int index = ray_callback.m_index;
-    if(ray_callback.hasHit())
+    if(!ray_callback.hasHit())
+        return false;
+
+    *index      = ray_callback.m_index;
+    *hit_point  = ray_callback.m_hitPointWorld;
+    *hit_normal = ray_callback.m_hitNormalWorld;
+    return true;
+}   // rayTest
+
+// ----------------------------------------------------------------------------
+/** Tests if a ray (in the coordinate system of this mesh) hits a triangle.
+ *  Like bullet's raycast, both sides of the triangle are tested.
+ *  \param index Index of the triangle.
+ *  \param from/to The from and to position of the ray.
+ *  \param fraction On return the fraction of the ray up to the hit point.
+ *  \return True if the triangle was hit.
+ */
+bool TriangleMesh::intersectTriangle(unsigned int index, const btVector3 &from,
+                                     const btVector3 &to,
+                                     float *fraction) const
+{
+    btVector3 *p1, *p2, *p3;
+    getTriangle(index, &p1, &p2, &p3);
+    const btVector3 dir   = to - from;
+    const btVector3 edge1 = *p2 - *p1;
+    const btVector3 edge2 = *p3 - *p1;
+    const btVector3 p     = dir.cross(edge2);
+    const float det       = edge1.dot(p);
+    if(fabsf(det) < 1e-12f)
+        return false;
+    const float inv_det = 1.0f/det;
+    const btVector3 s   = from - *p1;
+    const float u       = s.dot(p)*inv_det;
+    if(u < 0.0f || u > 1.0f)
+        return false;
+    const btVector3 q = s.cross(edge1);
+    const float v     = dir.dot(q)*inv_det;
+    if(v < 0.0f || u + v > 1.0f)
+        return false;
+    *fraction = edge2.dot(q)*inv_det;
+    return *fraction >= 0.0f && *fraction <= 1.0f;
+}   // intersectTriangle
+
+// ----------------------------------------------------------------------------
+/** Casts a ray from 'from' to 'to'. If a triangle of this mesh was hit,
+ *  xyz and material will be set.
+ *  If a cache is given, the ray is first only tested up to shortly after the
+ *  point where it is expected to hit: the triangle hit in the previous call
+ *  if the ray still hits it, otherwise the same distance as in the previous
+ *  call. Since the closest hit on a part of the ray that starts at 'from'
+ *  is the closest hit of the whole ray, the result is the same as without
+ *  cache, but the short segment needs only a small part of the BVH to be
+ *  traversed. Only if the segment hits nothing is the rest of the ray
+ *  tested.
+ *  \param from/to The from and to position for the raycast.
+ *  \param xyz The position in world where the ray hit.
+ *  \param material The material of the mesh that was hit.
+ *  \param normal The intrapolated normal at that position.
+ *  \param interpolate_normal If true, the returned normal is the interpolated
+ *         based on the three normals of the triangle and the location of the
+ *         hit point (which is more compute intensive, but results in much
+ *         smoother results).
+ *  \param cache If not NULL, information about the previous raycast of the
+ *         same object, which is updated.
+ *  \return True if a triangle was hit, false otherwise (and no output
+ *          variable will be set.
+ */
+bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
+                           btVector3 *xyz, const Material **material,
+                           btVector3 *normal, bool interpolate_normal,
+                           RayCache *cache) const
+{
+    if(!m_collision_shape)
+    {
+        *material=NULL;
+        return false;
+    }
+
+    btTransform world_trans;
+    // If there is a body, take the current transform from the body.
+    if(m_body)
+        world_trans = m_body->getWorldTransform();
+    else
+        world_trans.setIdentity();
+
+    int index = -1;
+    btVector3 hit_point, hit_normal;
+    bool hit = false;
+    const float length = (to - from).length();
+    float segment = length;
+    if(cache && cache->m_distance >= 0 && length > 0)
+    {
+        // Distance after the expected hit point that is tested, too
+        const float margin = 0.5f;
+        segment = cache->m_distance + margin;
+        float fraction;
+        if(cache->m_triangle >= 0 &&
+           cache->m_triangle < (int)m_triangleIndex2Material.size())
+        {
+            btTransform inv = world_trans.inverse();
+            if(intersectTriangle(cache->m_triangle, inv(from), inv(to),
+                                 &fraction))
+                segment = fraction*length + 0.01f;
+        }
+    }
+
+    if(segment < length)
+    {
+        btVector3 mid = from + (to - from)*(segment/length);
+        hit = rayTest(from, mid, world_trans, &index, &hit_point, &hit_normal);
+        // Start the rest slightly before the end of the segment, so that
+        // a triangle exactly at its end can't be missed.
+        if(!hit)
+        {
+            btVector3 start = from + (to - from)*((segment - 0.01f)/length);
+            hit = rayTest(start, to, world_trans, &index, &hit_point,
+                          &hit_normal);
+        }
+    }
+    else
+        hit = rayTest(from, to, world_trans, &index, &hit_point, &hit_normal);
+
+    if(cache)
+    {
+        cache->m_triangle = hit ? index : -1;
+        cache->m_distance = hit ? (hit_point - from).length() : -1.0f;
+    }
+
+    if(hit)
     {
-        *xyz      = ray_callback.m_hitPointWorld;
+        *xyz      = hit_point;
         *material = m_triangleIndex2Material[index];
 
         if(normal)
@@ -359,10 +740,9 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
             // the normal of the triangle interpolate the normal at the
             // hit position based on the three normals of the triangle.
             if(interpolate_normal)
-                *normal = getInterpolatedNormal(ray_callback.m_index,
-                                                ray_callback.m_hitPointWorld);
+                *normal = getInterpolatedNormal(index, hit_point);
             else
-                *normal = ray_callback.m_hitNormalWorld;
+                *normal = hit_normal;
             normal->normalize();
         }
     }
@@ -372,6 +752,6 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
         if(normal)
             normal->setValue(0, 1, 0);
     }
-    return ray_callback.hasHit();
+    return hit;
 
 }   // castRay
@@ -19,12 +19,14 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
 #include "utils/aligned_array.hpp"
 
+class MappedFile;
 class Material;
 
 /**
@@ -33,6 +35,21 @@ class Material;
  */
 class TriangleMesh
 {
+public:
+    /** Information about the last raycast of one object (e.g. a kart), which
+     *  is used to speed up the next raycast of the same object: objects
+     *  usually hit the same triangle (or one close by) as in the previous
+     *  frame, so the next raycast first only tests a short segment of the
+     *  ray up to the expected hit point. */
+    struct RayCache
+    {
+        /** Index of the triangle hit by the last raycast, or -1. */
+        int   m_triangle;
+        /** Distance to the last hit point, or -1 if nothing was hit. */
+        float m_distance;
+        RayCache() : m_triangle(-1), m_distance(-1.0f) {}
+    };   // RayCache
+
 private:
     UserPointer                  m_user_pointer;
     std::vector<const Material*> m_triangleIndex2Material;
@@ -41,14 +58,44 @@ private:
     bool                         m_free_body;
 
     btCollisionObject           *m_collision_object;
-    btTriangleMesh               m_mesh;
+    /** The three vertices of each triangle, while the mesh is built. */
+    AlignedArray<btVector3>      m_vertices;
+    /** The vertex indices of each triangle, while the mesh is built. */
+    AlignedArray<int>            m_indices;
+    /** The bullet mesh, which uses either the arrays of this object or the
+     *  shared mesh file. */
+    btTriangleIndexVertexArray   m_mesh;
     btVector3 dummy1, dummy2;
     btDefaultMotionState        *m_motion_state;
     btCollisionShape            *m_collision_shape;
-    /** The three normals for each triangle. */
+    /** The three normals for each triangle, while the mesh is built. */
     AlignedArray<btVector3>      m_normals;
-    /** Pre-compute value used in smoothing. */
+    /** Pre-compute value used in smoothing, while the mesh is built. */
     AlignedArray<float>          m_p1p2p3;
+    /** The normals and smoothing values used, either m_normals and
+     *  m_p1p2p3 or the data in the shared mesh file. */
+    const btVector3             *m_normal_data;
+    const float                 *m_p1p2p3_data;
+    /** The mapped file of a deserialized BVH, which is used in place and
+     *  must only be unmapped together with the collision shape. */
+    MappedFile                  *m_bvh_file;
+    /** The mapped shared mesh file (see shareMesh), or NULL if the mesh
+     *  data is stored in this object. */
+    MappedFile                  *m_mesh_file;
+
+    btBvhTriangleMeshShape *loadBvh(const char *file);
+    void saveBvh(btBvhTriangleMeshShape *shape, const char *file) const;
+    void setMeshData(const btVector3 *vertices, const int *indices,
+                     const btVector3 *normals, const float *p1p2p3);
+    void shareMesh(const std::string &file);
+    MappedFile *loadSharedMesh(const std::string &file) const;
+    void saveSharedMesh(const std::string &file) const;
+    void unshareMesh();
+    bool rayTest(const btVector3 &from, const btVector3 &to,
+                 const btTransform &world_trans, int *index,
+                 btVector3 *hit_point, btVector3 *hit_normal) const;
+    bool intersectTriangle(unsigned int index, const btVector3 &from,
+                           const btVector3 &to, float *fraction) const;
 public:
          TriangleMesh();
         ~TriangleMesh();
@@ -61,6 +108,8 @@ public:
                                (btCollisionObject::CollisionFlags)0,
                             const char* serializedBhv = NULL);
     void removeAll();
+    uint64_t getGeometryHash() const;
+    std::string getBvhCacheFile() const;
     void removeCollisionObject();
     btVector3 getInterpolatedNormal(unsigned int index,
                                     const btVector3 &position) const;
@@ -89,7 +138,8 @@ public:
     // ------------------------------------------------------------------------
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
-                 btVector3 *normal=NULL, bool interpolate_normal=false) const;
+                 btVector3 *normal=NULL, bool interpolate_normal=false,
+                 RayCache *cache=NULL) const;
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
@@ -112,17 +162,17 @@ public:
     {
         assert(indx < m_triangleIndex2Material.size());
         unsigned int n = indx*3;
-        *n1 = &(m_normals[n  ]);
-        *n2 = &(m_normals[n+1]);
-        *n3 = &(m_normals[n+2]);
+        *n1 = &(m_normal_data[n  ]);
+        *n2 = &(m_normal_data[n+1]);
+        *n3 = &(m_normal_data[n+2]);
     }   // getNormals
     // ------------------------------------------------------------------------
     /** Returns basically the area of the triangle, which is needed when
      *  smoothing the normals. */
     float getP1P2P3(unsigned int indx) const
     {
-        assert(indx < m_p1p2p3.size());
-        return m_p1p2p3[indx];
+        assert(indx < m_triangleIndex2Material.size());
+        return m_p1p2p3_data[indx];
     }
 };
 #endif
@@ -19,6 +19,7 @@
 #include "race/grand_prix_manager.hpp"
 
 #include "config/user_config.hpp"
+#include "io/content_index.hpp"
 #include "io/file_manager.hpp"
 #include "utils/string_utils.hpp"
 
@@ -73,7 +74,8 @@ void GrandPrixManager::loadDir(const std::string& dir, enum GrandPrixData::GPGro
 
     // Find out which grand prix are available and load them
     std::set<std::string> result;
-    file_manager->listFiles(result, dir);
+    if(!ContentIndex::listFiles(&result, dir))
+        file_manager->listFiles(result, dir);
     for(std::set<std::string>::iterator i = result.begin(); i != result.end(); i++)
     {
         if (StringUtils::hasSuffix(*i, SUFFIX))
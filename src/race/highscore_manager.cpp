@@ -19,33 +19,104 @@
 #include "race/highscore_manager.hpp"
 
 #include <stdexcept>
-#include <fstream>
 
 #include "config/user_config.hpp"
+#include "io/background_writer.hpp"
 #include "io/file_manager.hpp"
-#include "io/utf_writer.hpp"
+#include "io/mapped_file.hpp"
 #include "race/race_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
+#include <string.h>
+
 HighscoreManager* highscore_manager=0;
 const unsigned int HighscoreManager::CURRENT_HSCORE_FILE_VERSION = 3;
+const unsigned int HighscoreManager::CURRENT_BINARY_FILE_VERSION = 1;
+
+namespace
+{
+    /** The first bytes of the binary highscore file. */
+    const char         MAGIC[4]     = { 'S', 'T', 'K', 'H' };
+    /** Size of the header (magic and version) of the binary file. */
+    const unsigned int HEADER_SIZE  = 8;
+    /** Each record starts with its size and a checksum of 4 bytes each. */
+    const unsigned int RECORD_HEADER_SIZE = 8;
+    /** The file is compacted once it contains this many outdated records
+     *  more than current ones. */
+    const unsigned int MAX_OUTDATED_RECORDS = 32;
 
+    // ------------------------------------------------------------------------
+    void writeUInt32(std::string *out, unsigned int n)
+    {
+        for (int i = 0; i < 4; i++)
+            out->push_back((char)((n >> (8*i)) & 0xff));
+    }   // writeUInt32
+    // ------------------------------------------------------------------------
+    unsigned int readUInt32(const char *data)
+    {
+        unsigned int n = 0;
+        for (int i = 0; i < 4; i++)
+            n |= (unsigned int)(unsigned char)data[i] << (8*i);
+        return n;
+    }   // readUInt32
+    // ------------------------------------------------------------------------
+    /** FNV-1a hash of a record, to detect a record that was only partly
+     *  written (e.g. because of a crash). */
+    unsigned int checksum(const char *data, unsigned int size)
+    {
+        unsigned int hash = 2166136261u;
+        for (unsigned int i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }   // checksum
+    // ------------------------------------------------------------------------
+    /** Appends a highscores object as one record of the binary file. */
+    void writeRecord(const Highscores *highscores, std::string *out)
+    {
+        std::string record;
+        highscores->writeRecord(&record);
+        writeUInt32(out, (unsigned int)record.size());
+        writeUInt32(out, checksum(record.data(),
+                                  (unsigned int)record.size()));
+        out->append(record);
+    }   // writeRecord
+}   // namespace
+
+// -----------------------------------------------------------------------------
 HighscoreManager::HighscoreManager()
 {
-    m_can_write=true;
+    m_num_records = 0;
     setFilename();
-    loadHighscores();
+    if (!loadBinaryHighscores())
+    {
+        // Convert the old highscore file (if any), and create a new file
+        loadXMLHighscores();
+        compact();
+    }
+    else if (m_num_records > 2 * m_all_scores.size() + MAX_OUTDATED_RECORDS)
+    {
+        // This is done after the binary file is closed, so that it can be
+        // replaced.
+        compact();
+    }
+    if(UserConfigParams::logMisc())
+        Log::info("Highscore Manager", "Highscores will be saved in '%s'.",
+                  m_filename.c_str());
 }   // HighscoreManager
 
 // -----------------------------------------------------------------------------
+/** All changes are written immediately by saveHighscores, so only the
+ *  memory is freed here. */
 HighscoreManager::~HighscoreManager()
 {
-    saveHighscores();
     for(type_all_scores::iterator i  = m_all_scores.begin();
                                   i != m_all_scores.end();  i++)
-        delete *i;
+        delete i->second;
 }   // ~HighscoreManager
 
 // -----------------------------------------------------------------------------
@@ -55,39 +126,105 @@ void HighscoreManager::setFilename()
 {
     if ( getenv("SUPERTUXKART_HIGHSCOREDIR") != NULL )
     {
-        m_filename = getenv("SUPERTUXKART_HIGHSCOREDIR")
-                   + std::string("/highscore.xml");
+        m_filename     = getenv("SUPERTUXKART_HIGHSCOREDIR")
+                       + std::string("/highscore.bin");
+        m_xml_filename = getenv("SUPERTUXKART_HIGHSCOREDIR")
+                       + std::string("/highscore.xml");
     }
     else
     {
-        m_filename=file_manager->getUserConfigFile("highscore.xml");
+        m_filename     = file_manager->getUserConfigFile("highscore.bin");
+        m_xml_filename = file_manager->getUserConfigFile("highscore.xml");
     }
 
     return;
 }   // SetFilename
 
 // -----------------------------------------------------------------------------
-void HighscoreManager::loadHighscores()
+/** Adds a highscores object to the index. It replaces an existing object
+ *  with the same key, since a later record in the binary file is newer.
+ *  \param highscores The highscores object, which is then owned by the
+ *         highscore manager.
+ */
+void HighscoreManager::addHighscores(Highscores *highscores)
 {
-    XMLNode *root = NULL;
-    root = file_manager->createXMLTree(m_filename);
-    if(!root)
+    Highscores *&entry = m_all_scores[highscores->getKey()];
+    delete entry;
+    entry = highscores;
+}   // addHighscores
+
+// -----------------------------------------------------------------------------
+/** Loads the binary highscore file.
+ *  \return False if the file does not exist or has an unsupported format,
+ *          in which case a new file must be created.
+ */
+bool HighscoreManager::loadBinaryHighscores()
+{
+    if (!file_manager->fileExists(m_filename))
+        return false;
+    MappedFile file(m_filename);
+    if (!file.isValid() || file.getSize() < HEADER_SIZE ||
+        memcmp(file.getData(), MAGIC, sizeof(MAGIC)) != 0 ||
+        readUInt32(file.getData() + 4) != CURRENT_BINARY_FILE_VERSION)
     {
-        saveHighscores();
-        if(m_can_write)
+        Log::error("Highscore Manager",
+                   "Invalid highscore file '%s', a new one will be created.",
+                   m_filename.c_str());
+        return false;
+    }
+
+    const char  *data = file.getData();
+    const size_t size = file.getSize();
+    size_t pos = HEADER_SIZE;
+    while (pos + RECORD_HEADER_SIZE <= size)
+    {
+        const unsigned int record_size = readUInt32(data + pos);
+        const char *record = data + pos + RECORD_HEADER_SIZE;
+        if (pos + RECORD_HEADER_SIZE + record_size > size ||
+            checksum(record, record_size) != readUInt32(data + pos + 4))
+            break;
+        pos += RECORD_HEADER_SIZE + record_size;
+        m_num_records++;
+        try
         {
-            Log::info("Highscore Manager", "New highscore file '%s' created.\n",
-                    m_filename.c_str());
+            addHighscores(new Highscores(record, record_size));
         }
-        delete root;
-        return;
+        catch (std::logic_error& e)
+        {
+            Log::error("Highscore Manager",
+                       "Invalid highscore entry will be skipped : %s",
+                       e.what());
+        }
+    }
+
+    if (pos != size)
+    {
+        // Appending after the damaged data would make all new records
+        // unreadable, so the file is rewritten.
+        Log::warn("Highscore Manager",
+                  "Highscore file '%s' is damaged, the last record is lost.",
+                  m_filename.c_str());
+        m_num_records = (unsigned int)-1;
     }
+    return true;
+}   // loadBinaryHighscores
+
+// -----------------------------------------------------------------------------
+/** Loads the highscores from the old XML file. */
+void HighscoreManager::loadXMLHighscores()
+{
+    if (!file_manager->fileExists(m_xml_filename))
+        return;
+    XMLNode *root = NULL;
+    root = file_manager->createXMLTree(m_xml_filename);
+    if(!root)
+        return;
 
     try
     {
-        if(!root || root->getName()!="highscores")
+        if(root->getName()!="highscores")
         {
-            if(root) delete root;
+            delete root;
             root = NULL;
             throw std::runtime_error("No 'highscore' node found.");
         }
@@ -100,10 +237,6 @@ void HighscoreManager::loadHighscores()
             irr::core::stringw warning =
                 _("The highscore file was too old,\nall highscores have been erased.");
             user_config->setWarning( warning );
-
-            // since we haven't had the chance to load the current scores yet,
-            // calling Save() now will generate an empty file with the right format.
-            saveHighscores();
             delete root;
             root = NULL;
             return;
@@ -123,51 +256,56 @@ void HighscoreManager::loadHighscores()
                 Log::error("Highscore Manager", "Invalid highscore entry will be skipped : %s\n", e.what());
                 continue;
             }
-            m_all_scores.push_back(highscores);
+            addHighscores(highscores);
         }   // next entry
-
-        if(UserConfigParams::logMisc())
-            Log::error("Highscore Manager", "Highscores will be saved in '%s'.\n",
-                    m_filename.c_str());
+        Log::info("Highscore Manager", "Converted highscore file '%s'.",
+                  m_xml_filename.c_str());
     }
     catch(std::exception& err)
     {
         Log::error("Highscore Manager", "Error while parsing highscore file '%s':\n",
-                m_filename.c_str());
+                m_xml_filename.c_str());
         Log::error("Highscore Manager", "%s", err.what());
         Log::error("Highscore Manager", "\n");
         Log::error("Highscore Manager", "No old highscores will be available.\n");
     }
     if(root)
         delete root;
-}   // loadHighscores
+}   // loadXMLHighscores
 
 // -----------------------------------------------------------------------------
-void HighscoreManager::saveHighscores()
+/** Rewrites the binary file with one record for each highscores object
+ *  that contains at least one entry.
+ */
+void HighscoreManager::compact()
 {
-    // Print error message only once
-    if(!m_can_write) return;
-
-    try
+    std::string content(MAGIC, sizeof(MAGIC));
+    writeUInt32(&content, CURRENT_BINARY_FILE_VERSION);
+    m_num_records = 0;
+    for(type_all_scores::const_iterator i  = m_all_scores.begin();
+                                        i != m_all_scores.end();  i++)
     {
-        UTFWriter highscore_file(m_filename.c_str());
-        highscore_file << L"<?xml version=\"1.0\"?>\n";
-        highscore_file << L"<highscores version=\"" << CURRENT_HSCORE_FILE_VERSION << "\">\n";
-
-        for(unsigned int i=0; i<m_all_scores.size(); i++)
-        {
-            m_all_scores[i]->writeEntry(highscore_file);
-        }
-        highscore_file << L"</highscores>\n";
-        highscore_file.close();
-    }
-    catch(std::exception &e)
-    {
-        Log::error("Highscore Manager","Problems saving highscores in '%s'\n", m_filename.c_str());
-        puts(e.what());
-        m_can_write=false;
+        if (i->second->getNumberEntries() == 0) continue;
+        writeRecord(i->second, &content);
+        m_num_records++;
     }
+    BackgroundWriter::get()->write(m_filename, content);
+}   // compact
 
+// -----------------------------------------------------------------------------
+/** Saves a changed highscores object by appending its record to the
+ *  highscore file in the background. The file is compacted once it
+ *  contains too many outdated records.
+ *  \param highscores The changed highscores object.
+ */
+void HighscoreManager::saveHighscores(const Highscores *highscores)
+{
+    std::string record;
+    writeRecord(highscores, &record);
+    BackgroundWriter::get()->append(m_filename, record);
+    m_num_records++;
+    if (m_num_records > 2 * m_all_scores.size() + MAX_OUTDATED_RECORDS)
+        compact();
 }   // saveHighscores
 
 // -----------------------------------------------------------------------------
@@ -182,23 +320,13 @@ Highscores* HighscoreManager::getHighscores(const Highscores::HighscoreType &hig
                                             const int number_of_laps,
                                             const bool reverse)
 {
-    Highscores *highscores = 0;
-
-    // See if we already have a record for this type
-    for(type_all_scores::iterator i  = m_all_scores.begin();
-                                  i != m_all_scores.end();  i++)
-    {
-        if((*i)->matches(highscore_type, num_karts, difficulty, trackName,
-                         number_of_laps, reverse) )
-        {
-            // we found one entry for this kind of race, return it
-            return (*i);
-        }
-    }   // for i in m_all_scores
-
+    Highscores *&highscores =
+        m_all_scores[Highscores::getKey(highscore_type, num_karts,
+                                        difficulty, trackName,
+                                        number_of_laps, reverse)];
     // we don't have an entry for such a race currently. Create one.
-    highscores = new Highscores(highscore_type, num_karts, difficulty,
-                                trackName, number_of_laps, reverse);
-    m_all_scores.push_back(highscores);
+    if (!highscores)
+        highscores = new Highscores(highscore_type, num_karts, difficulty,
+                                    trackName, number_of_laps, reverse);
     return highscores;
 }   // getHighscores
@@ -26,29 +26,47 @@
 #include "race/highscores.hpp"
 
 /**
-  * This class reads and writes the 'highscores.xml' file, and also takes
-  * care of dealing with new records. One 'HighscoreEntry' object is created
-  * for each highscore entry.
+  * This class reads and writes the highscores, and also takes care of
+  * dealing with new records. One 'Highscores' object is created for each
+  * kind of race (track, mode, number of karts and laps, difficulty and
+  * direction), and they are indexed by Highscores::getKey().
+  * The highscores are stored in a binary file 'highscore.bin', which starts
+  * with a header followed by one record per Highscores object. When a
+  * highscore changes only the record of that object is appended to the
+  * file by the BackgroundWriter, and a record replaces all earlier records
+  * with the same key when the file is loaded. Once the file contains too
+  * many outdated records it is compacted, i.e. rewritten with one record
+  * per Highscores object. The old 'highscore.xml' file is only read if no
+  * binary file exists yet.
   * \ingroup race
   */
 class HighscoreManager
 {
-public:
 private:
     static const unsigned int CURRENT_HSCORE_FILE_VERSION;
-    typedef std::vector<Highscores*> type_all_scores;
+    static const unsigned int CURRENT_BINARY_FILE_VERSION;
+    typedef std::map<std::string, Highscores*> type_all_scores;
     type_all_scores m_all_scores;
 
-    std::string m_filename;
-    bool        m_can_write;
+    /** Name of the binary highscore file. */
+    std::string  m_filename;
+
+    /** Name of the old XML highscore file. */
+    std::string  m_xml_filename;
+
+    /** Number of records in the binary file, including outdated records. */
+    unsigned int m_num_records;
 
-    void loadHighscores();
+    bool loadBinaryHighscores();
+    void loadXMLHighscores();
+    void addHighscores(Highscores *highscores);
+    void compact();
     void setFilename();
 
 public:
                 HighscoreManager();
                ~HighscoreManager();
-    void        saveHighscores();
+    void        saveHighscores(const Highscores *highscores);
     Highscores *getHighscores(const Highscores::HighscoreType &highscore_type,
                               int num_karts,
                               const RaceManager::Difficulty difficulty,
@@ -18,12 +18,90 @@
 
 #include "race/highscores.hpp"
 
-#include "io/utf_writer.hpp"
 #include "io/xml_node.hpp"
 #include "race/race_manager.hpp"
+#include "utils/string_utils.hpp"
 
 #include <stdexcept>
-#include <fstream>
+#include <string.h>
+
+namespace
+{
+    // Helper functions for the binary records, all values are stored in
+    // little endian byte order.
+    void writeUInt(std::string *out, unsigned int n, int num_bytes)
+    {
+        for (int i = 0; i < num_bytes; i++)
+            out->push_back((char)((n >> (8*i)) & 0xff));
+    }   // writeUInt
+    // ------------------------------------------------------------------------
+    void writeFloat(std::string *out, float f)
+    {
+        uint32_t n;
+        memcpy(&n, &f, sizeof(n));
+        writeUInt(out, n, 4);
+    }   // writeFloat
+    // ------------------------------------------------------------------------
+    void writeString(std::string *out, const std::string &str)
+    {
+        writeUInt(out, (unsigned int)str.size(), 2);
+        out->append(str, 0, std::min(str.size(), (size_t)0xffff));
+    }   // writeString
+    // ------------------------------------------------------------------------
+    /** Wide strings store each character with 4 bytes, since the size of
+     *  wchar_t depends on the platform. */
+    void writeWString(std::string *out, const irr::core::stringw &str)
+    {
+        const unsigned int len = std::min(str.size(), (irr::u32)0xffff);
+        writeUInt(out, len, 2);
+        for (unsigned int i = 0; i < len; i++)
+            writeUInt(out, (unsigned int)str[i], 4);
+    }   // writeWString
+    // ------------------------------------------------------------------------
+    /** Reads an unsigned integer and advances the read position.
+     *  \throws std::logic_error if the record is too short. */
+    unsigned int readUInt(const char *data, unsigned int size,
+                          unsigned int *pos, int num_bytes)
+    {
+        if (*pos + num_bytes > size)
+            throw std::logic_error("Invalid highscore record: too short");
+        unsigned int n = 0;
+        for (int i = 0; i < num_bytes; i++)
+            n |= (unsigned int)(unsigned char)data[*pos + i] << (8*i);
+        *pos += num_bytes;
+        return n;
+    }   // readUInt
+    // ------------------------------------------------------------------------
+    float readFloat(const char *data, unsigned int size, unsigned int *pos)
+    {
+        uint32_t n = readUInt(data, size, pos, 4);
+        float f;
+        memcpy(&f, &n, sizeof(f));
+        return f;
+    }   // readFloat
+    // ------------------------------------------------------------------------
+    std::string readString(const char *data, unsigned int size,
+                           unsigned int *pos)
+    {
+        const unsigned int len = readUInt(data, size, pos, 2);
+        if (*pos + len > size)
+            throw std::logic_error("Invalid highscore record: too short");
+        std::string str(data + *pos, len);
+        *pos += len;
+        return str;
+    }   // readString
+    // ------------------------------------------------------------------------
+    irr::core::stringw readWString(const char *data, unsigned int size,
+                                   unsigned int *pos)
+    {
+        const unsigned int len = readUInt(data, size, pos, 2);
+        irr::core::stringw str;
+        str.reserve(len + 1);
+        for (unsigned int i = 0; i < len; i++)
+            str.append((wchar_t)readUInt(data, size, pos, 4));
+        return str;
+    }   // readWString
+}   // namespace
 
 // -----------------------------------------------------------------------------
 Highscores::Highscores(const HighscoreType &highscore_type,
@@ -67,6 +145,59 @@ Highscores::Highscores(const XMLNode &node)
     readEntry(node);
 }   // Highscores
 
+// -----------------------------------------------------------------------------
+/** Creates an entry from a record of the binary highscore file, see
+ *  writeRecord() for the format.
+ *  \param data The record.
+ *  \param size Size of the record.
+ *  \throws std::logic_error if the record is invalid.
+ */
+Highscores::Highscores(const char *data, unsigned int size)
+{
+    for(int i=0; i<HIGHSCORE_LEN; i++)
+    {
+        m_name[i]      = "";
+        m_kart_name[i] = "";
+        m_time[i]      = -9.9f;
+    }
+
+    unsigned int pos  = 0;
+    m_highscore_type  = readString(data, size, &pos);
+    m_track           = readString(data, size, &pos);
+    m_number_of_karts = (int)readUInt(data, size, &pos, 4);
+    m_difficulty      = (int)readUInt(data, size, &pos, 4);
+    m_number_of_laps  = (int)readUInt(data, size, &pos, 4);
+    m_reverse         = readUInt(data, size, &pos, 1) != 0;
+    const unsigned int num_entries = readUInt(data, size, &pos, 1);
+    if (num_entries > HIGHSCORE_LEN)
+        throw std::logic_error("Invalid highscore record: too many entries");
+    for (unsigned int i = 0; i < num_entries; i++)
+    {
+        m_time[i]      = readFloat(data, size, &pos);
+        m_kart_name[i] = readString(data, size, &pos);
+        m_name[i]      = readWString(data, size, &pos);
+        if (m_time[i] <= 0.0f || m_kart_name[i].empty() || m_name[i].empty())
+            throw std::logic_error("Invalid highscore record: empty entry");
+    }
+}   // Highscores
+
+// -----------------------------------------------------------------------------
+/** Returns the key that identifies the highscores of one kind of race,
+ *  which is used by the HighscoreManager to find an entry.
+ */
+std::string Highscores::getKey(const HighscoreType &highscore_type,
+                               int num_karts,
+                               const RaceManager::Difficulty &difficulty,
+                               const std::string &track,
+                               const int number_of_laps, const bool reverse)
+{
+    return highscore_type + "\n" + track
+         + "\n" + StringUtils::toString(num_karts)
+         + "\n" + StringUtils::toString((int)difficulty)
+         + "\n" + StringUtils::toString(number_of_laps)
+         + (reverse ? "\nr" : "\nf");
+}   // getKey
+
 // -----------------------------------------------------------------------------
 void Highscores::readEntry(const XMLNode &node)
 {
@@ -99,40 +230,31 @@ void Highscores::readEntry(const XMLNode &node)
 }   // readEntry
 
 // -----------------------------------------------------------------------------
-/** Writes the highscores in this entry to the writer. It will only write
- *  anything if there is actually a highscore recored (i.e. time >=0). Empty
- *  entries are created e.g. when changing the number of laps in the GUI,
- *  resulting in empty entries here.
- *  \param writer The file stream to write the data to.
+/** Appends the binary record of this entry to a string: two strings with
+ *  the highscore type and track name, the number of karts, difficulty and
+ *  number of laps (4 bytes each), one byte reverse, and one byte number of
+ *  entries followed by the time, the kart name and the player name of each
+ *  entry. Strings are stored as 2 bytes length followed by the characters.
+ *  \param out The string to which the record is appended.
  */
-void Highscores::writeEntry(UTFWriter &writer)
+void Highscores::writeRecord(std::string *out) const
 {
-    // Only
-    bool one_is_set = false;
-    for(unsigned int i=0; i<HIGHSCORE_LEN; i++)
-        one_is_set |= m_time[i]>=0;
-    if(!one_is_set) return;
-
-    writer << L"  <highscore track-name    =\"" << m_track.c_str()           << "\"\n";
-    writer << L"             number-karts  =\"" << m_number_of_karts         << "\"\n";
-    writer << L"             difficulty    =\"" << m_difficulty              << "\"\n";
-    writer << L"             hscore-type   =\"" << m_highscore_type.c_str()  << "\"\n";
-    writer << L"             number-of-laps=\"" << m_number_of_laps          << "\"\n";
-    writer << L"             reverse       =\"" << m_reverse                 << "\">\n";
-
-    for(int i=0; i<HIGHSCORE_LEN; i++)
+    writeString(out, m_highscore_type);
+    writeString(out, m_track);
+    writeUInt(out, (unsigned int)m_number_of_karts, 4);
+    writeUInt(out, (unsigned int)m_difficulty,      4);
+    writeUInt(out, (unsigned int)m_number_of_laps,  4);
+    writeUInt(out, m_reverse ? 1 : 0,               1);
+    const int num_entries = getNumberEntries();
+    writeUInt(out, num_entries, 1);
+    for(int i=0; i<num_entries; i++)
     {
-        if (m_time[i] > 0.0f)
-        {
-            assert(m_kart_name[i].size() > 0);
-            writer << L"             <entry time    =\"" << m_time[i] << L"\"\n";
-            writer << L"                    name    =\"" << m_name[i] << L"\"\n";
-            writer << L"                    kartname=\"" << m_kart_name[i].c_str()
-                   << L"\"/>\n";
-        }
+        assert(m_kart_name[i].size() > 0);
+        writeFloat(out, m_time[i]);
+        writeString(out, m_kart_name[i]);
+        writeWString(out, m_name[i]);
     }   // for i
-    writer << L"  </highscore>\n";
-}   // writeEntry
+}   // writeRecord
 
 // -----------------------------------------------------------------------------
 int Highscores::matches(const HighscoreType &highscore_type,
@@ -27,7 +27,6 @@
 #include <irrString.h>
 
 class XMLNode;
-class UTFWriter;
 
 /**
  *  Represents one highscore entry, i.e. the (atm up to three) highscores
@@ -60,9 +59,17 @@ public:
     /** Creates an entry from a file
      */
     Highscores (const XMLNode &node);
+    /** Creates an entry from a record of the binary highscore file
+     */
+    Highscores (const char *data, unsigned int size);
 
+    static std::string getKey(const HighscoreType &highscore_type,
+                              int num_karts,
+                              const RaceManager::Difficulty &difficulty,
+                              const std::string &track,
+                              const int number_of_laps, const bool reverse);
     void readEntry (const XMLNode &node);
-    void writeEntry(UTFWriter &writer);
+    void writeRecord(std::string *out) const;
     int  matches   (const HighscoreType &highscore_type, int num_karts,
                     const RaceManager::Difficulty &difficulty,
                     const std::string &track, const int number_of_laps,
@@ -72,6 +79,14 @@ public:
     int  getNumberEntries() const;
     void getEntry  (int number, std::string &kart_name,
                     irr::core::stringw &name, float *const time) const;
+    // ------------------------------------------------------------------------
+    /** Returns the key of this entry, see getKey(). */
+    std::string getKey() const
+    {
+        return getKey(m_highscore_type, m_number_of_karts,
+                      (RaceManager::Difficulty)m_difficulty, m_track,
+                      m_number_of_laps, m_reverse);
+    }   // getKey
 };  // Highscores
 
 #endif
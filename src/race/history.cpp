@@ -18,24 +18,58 @@
 
 #include "race/history.hpp"
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "io/file_manager.hpp"
+#include "main_loop.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 #include "physics/physics.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
+#include "utils/profiler.hpp"
 
 History* history = 0;
 
+//-----------------------------------------------------------------------------
+/** Returns the binary representation of a float. */
+static unsigned int floatToBits(float f)
+{
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}   // floatToBits
+
+//-----------------------------------------------------------------------------
+/** Returns the float with the given binary representation. */
+static float bitsToFloat(unsigned int bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}   // bitsToFloat
+
 //-----------------------------------------------------------------------------
 /** Initialises the history object and sets the mode to none.
  */
 History::History()
 {
-    m_replay_mode = HISTORY_NONE;
+    m_replay_mode     = HISTORY_NONE;
+    m_current         = -1;
+    m_size            = 0;
+    m_dt              = 0;
+    m_desync_reported = false;
+    m_verify          = false;
+    m_verification_failed = false;
+    m_filename        = "history.dat";
+    m_file            = NULL;
+    m_thread_running  = false;
+    m_stop_writing    = false;
+    pthread_cond_init(&m_cond_request, NULL);
 }   // History
 
 //-----------------------------------------------------------------------------
@@ -47,32 +81,166 @@ void History::startReplay()
 }   // startReplay
 
 //-----------------------------------------------------------------------------
-/** Initialise the history for a new recording. It especially allocates memory
- *  to store the history.
+/** Frees all data and stops the thread writing the history file.
+ */
+History::~History()
+{
+    stopWriting();
+    pthread_cond_destroy(&m_cond_request);
+}   // ~History
+
+//-----------------------------------------------------------------------------
+/** Initialise the history for a new recording. The history is written to
+ *  history.dat while the race is running (by a separate thread, so the
+ *  main thread is not blocked by disk access), and nothing is kept in
+ *  memory except for the last controls of each kart. So any race can be
+ *  recorded, no matter how long it takes, and the history is not lost if
+ *  STK crashes.
  */
 void History::initRecording()
 {
-    unsigned int max_frames = (unsigned int)(  stk_config->m_replay_max_time
-                                             / stk_config->m_replay_dt      );
-    allocateMemory(max_frames);
+    stopWriting();
+    World *world = World::getWorld();
+    unsigned int num_karts = world->getNumKarts();
+    m_last_controls.clear();
+    m_last_controls.resize(num_karts);
     m_current = -1;
-    m_wrapped = false;
     m_size    = 0;
+    m_dt      = 0;
+
+    // Start a new history file, see Load for the format
+    m_chunk.clear();
+    addLine("Version:  %s",   STK_VERSION);
+    addLine("numkarts: %d",   num_karts);
+    addLine("numplayers: %d", race_manager->getNumPlayers());
+    addLine("difficulty: %d", race_manager->getDifficulty());
+    addLine("track: %s",      race_manager->getTrackName().c_str());
+    for(unsigned int k=0; k<num_karts; k++)
+        addLine("model %d: %s", k, world->getKart(k)->getIdent().c_str());
+    addLine("interval: %d", m_state_interval);
+    startWriting();
 }   // initRecording
 
 //-----------------------------------------------------------------------------
-/** Allocates memory for the history. This is used when recording as well
- *  as when replaying (since in replay the data is read into memory first).
- *  \param number_of_frames Maximum number of frames to store.
+/** Appends one formatted line to the part of the history that has not been
+ *  handed to the writing thread yet.
+ */
+void History::addLine(const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line)-1, format, args);
+    va_end(args);
+    line[sizeof(line)-1] = 0;
+    m_chunk.append(line);
+    m_chunk.push_back('\n');
+}   // addLine
+
+//-----------------------------------------------------------------------------
+/** Opens the history file and starts the thread that writes to it.
+ */
+void History::startWriting()
+{
+    m_filename = "history.dat";
+    m_file = fopen(m_filename.c_str(), "w");
+    if(!m_file)
+    {
+        m_filename = file_manager->getUserConfigFile("history.dat");
+        m_file = fopen(m_filename.c_str(), "w");
+    }
+    if(!m_file)
+    {
+        Log::info("History", "Can't open history.dat file for writing - can't save history.");
+        Log::info("History", "Make sure history.dat in the current directory "
+                             "or the config directory is writable.");
+        return;
+    }
+
+    m_pending_output.lock();
+    m_pending_output.getData().clear();
+    m_stop_writing = false;
+    m_pending_output.unlock();
+
+    pthread_attr_t  attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int error = pthread_create(&m_thread, &attr, &History::writeLoop, this);
+    pthread_attr_destroy(&attr);
+    if(error)
+    {
+        Log::error("History", "Could not create thread, error=%d.", errno);
+        fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+    m_thread_running = true;
+}   // startWriting
+
+//-----------------------------------------------------------------------------
+/** Hands all lines added since the last call to the writing thread.
  */
-void History::allocateMemory(int number_of_frames)
+void History::flushChunk()
 {
-    m_all_deltas.resize   (number_of_frames);
-    unsigned int num_karts = race_manager->getNumberOfKarts();
-    m_all_controls.resize (number_of_frames*num_karts);
-    m_all_xyz.resize      (number_of_frames*num_karts);
-    m_all_rotations.resize(number_of_frames*num_karts);
-}   // allocateMemory
+    if(!m_thread_running || m_chunk.empty())
+        return;
+    m_pending_output.lock();
+    m_pending_output.getData().append(m_chunk);
+    pthread_cond_signal(&m_cond_request);
+    m_pending_output.unlock();
+    m_chunk.clear();
+}   // flushChunk
+
+//-----------------------------------------------------------------------------
+/** Writes all remaining data, then stops the writing thread and closes the
+ *  history file.
+ */
+void History::stopWriting()
+{
+    if(!m_thread_running)
+        return;
+    flushChunk();
+    m_pending_output.lock();
+    m_stop_writing = true;
+    pthread_cond_signal(&m_cond_request);
+    m_pending_output.unlock();
+    pthread_join(m_thread, NULL);
+    m_thread_running = false;
+    fclose(m_file);
+    m_file = NULL;
+}   // stopWriting
+
+//-----------------------------------------------------------------------------
+/** The thread that writes the history file. Each chunk of data is flushed
+ *  immediately, so that it is on disk even if STK crashes.
+ *  \param obj Pointer to the history object.
+ */
+void* History::writeLoop(void *obj)
+{
+    History *me = (History*)obj;
+    profiler.setThreadName("History");
+
+    std::string data;
+    me->m_pending_output.lock();
+    while(true)
+    {
+        while(me->m_pending_output.getData().empty() && !me->m_stop_writing)
+            pthread_cond_wait(&me->m_cond_request,
+                              me->m_pending_output.getMutex());
+        if(me->m_pending_output.getData().empty())
+            break;  // m_stop_writing is set and all data is written
+        data.swap(me->m_pending_output.getData());
+        me->m_pending_output.unlock();
+
+        fwrite(data.data(), 1, data.size(), me->m_file);
+        fflush(me->m_file);
+        data.clear();
+
+        me->m_pending_output.lock();
+    }
+    me->m_pending_output.unlock();
+    return NULL;
+}   // writeLoop
 
 //-----------------------------------------------------------------------------
 /** Depending on mode either saves the data for the current time step, or
@@ -87,6 +255,35 @@ void History::update(float dt)
         updateReplay(dt);
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Computes a checksum of the physics state of a kart. Since the simulation
+ *  is deterministic, the checksums of a recording and its replay are
+ *  identical until the simulations start to differ.
+ *  \param kart The kart for which to compute the checksum.
+ */
+unsigned int History::getChecksum(const AbstractKart *kart)
+{
+    if(!kart->getBody())
+        return 0;
+    const btTransform &t = kart->getBody()->getWorldTransform();
+    const btQuaternion q = t.getRotation();
+    const btVector3   &v = kart->getBody()->getLinearVelocity();
+    const btVector3   &w = kart->getBody()->getAngularVelocity();
+    const btScalar values[] = { t.getOrigin().getX(), t.getOrigin().getY(),
+                                t.getOrigin().getZ(), q.getX(), q.getY(),
+                                q.getZ(), q.getW(), v.getX(), v.getY(),
+                                v.getZ(), w.getX(), w.getY(), w.getZ() };
+    // FNV-1a hash of the binary representation of all values
+    const unsigned char *p = (const unsigned char*)values;
+    unsigned int hash = 2166136261u;
+    for(unsigned int i=0; i<sizeof(values); i++)
+    {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}   // getChecksum
+
 //-----------------------------------------------------------------------------
 /** Saves the current history.
  *  \param dt Time step size.
@@ -94,31 +291,87 @@ void History::update(float dt)
 void History::updateSaving(float dt)
 {
     m_current++;
-    if(m_current>=(int)m_all_deltas.size())
-    {
-        m_wrapped = true;
-        m_current = 0;
-    }
-    else
-    {
-        // m_size must be m_all_deltas.size() or smaller
-        if(m_size<(int)m_all_deltas.size())
-            m_size ++;
-    }
-    m_all_deltas[m_current] = dt;
+    m_size = m_current+1;
+    // The world is updated with a fixed time step, so one dt is enough
+    if(m_dt==0)
+        m_dt = dt;
+    else if(m_dt!=dt)
+        Log::warn("History", "Time step changed from %f to %f, a replay "
+                  "will not be exact.", m_dt, dt);
+
+    if(m_current==0)
+        addLine("d %08x", floatToBits(dt));
 
     World *world = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    unsigned int index     = m_current*num_karts;
+    const bool save_state = m_current % m_state_interval == 0;
     for(unsigned int i=0; i<num_karts; i++)
     {
-        const AbstractKart *kart         = world->getKart(i);
-        m_all_controls[index+i]  = kart->getControls();
-        m_all_xyz[index+i]       = kart->getXYZ();
-        m_all_rotations[index+i] = kart->getVisualRotation();
+        const AbstractKart *kart = world->getKart(i);
+        const KartControl &c    = kart->getControls();
+        KartControl       &last = m_last_controls[i];
+        if(m_current==0                                           ||
+           last.m_steer != c.m_steer                              ||
+           last.m_accel != c.m_accel                              ||
+           last.getButtonsCompressed() != c.getButtonsCompressed()   )
+        {
+            addLine("c %d %d %08x %08x %d", m_current, i,
+                    floatToBits(c.m_steer), floatToBits(c.m_accel),
+                    c.getButtonsCompressed());
+            last = c;
+        }
+        if(save_state)
+        {
+            const Vec3         &xyz = kart->getXYZ();
+            const btQuaternion &q   = kart->getVisualRotation();
+            addLine("s %d %d %f %f %f  %f %f %f %f  %08x", m_current, i,
+                    xyz.getX(), xyz.getY(), xyz.getZ(),
+                    q.getX(), q.getY(), q.getZ(), q.getW(),
+                    getChecksum(kart));
+        }
     }   // for i
+
+    // Write the data about once a second, or earlier if there is a lot
+    if(m_current % (12*m_state_interval) == 0 || m_chunk.size() > 16*1024)
+        flushChunk();
 }   // updateSaving
 
+//-----------------------------------------------------------------------------
+/** Starts the replay again from the first frame.
+ */
+void History::resetReplay()
+{
+    m_current = -1;
+    m_next_control.clear();
+    m_next_control.resize(m_all_controls.size(), 0);
+}   // resetReplay
+
+//-----------------------------------------------------------------------------
+/** Sets the position of a kart by interpolating between the two saved
+ *  states around the current frame.
+ *  \param kart The kart to set the position of.
+ *  \param k Index of the kart.
+ */
+void History::replayPosition(AbstractKart *kart, unsigned int k)
+{
+    const unsigned int num_karts  = (unsigned int)m_all_controls.size();
+    const unsigned int num_states = (unsigned int)m_all_xyz.size()/num_karts;
+    unsigned int state = m_current / m_state_interval;
+    if(state>=num_states)
+        return;
+    unsigned int index = state*num_karts + k;
+    if(state+1>=num_states)
+    {
+        kart->setXYZ(m_all_xyz[index]);
+        kart->setRotation(m_all_rotations[index]);
+        return;
+    }
+    float f = (m_current % m_state_interval) / (float)m_state_interval;
+    kart->setXYZ((1-f)*m_all_xyz[index] + f*m_all_xyz[index+num_karts]);
+    kart->setRotation(m_all_rotations[index]
+                      .slerp(m_all_rotations[index+num_karts], f));
+}   // replayPosition
+
 //-----------------------------------------------------------------------------
 /** Sets the kart position and controls to the recorded history value.
  *  \param dt Time step size.
@@ -127,99 +380,115 @@ void History::updateReplay(float dt)
 {
     m_current++;
     World *world = World::getWorld();
-    if(m_current>=(int)m_all_deltas.size())
+    if(m_current>=m_size)
     {
+        if(m_verify)
+        {
+            verifyFinishTimes();
+            main_loop->abort();
+            return;
+        }
         Log::info("History", "Replay finished");
+        resetReplay();
         m_current = 0;
         // Note that for physics replay all physics parameters
         // need to be reset, e.g. velocity, ...
         world->reset();
     }
     unsigned int num_karts = world->getNumKarts();
+    const bool check_state = m_current % m_state_interval == 0;
     for(unsigned k=0; k<num_karts; k++)
     {
         AbstractKart *kart = world->getKart(k);
-        unsigned int index=m_current*num_karts+k;
         if(m_replay_mode==HISTORY_POSITION)
         {
-            kart->setXYZ(m_all_xyz[index]);
-            kart->setRotation(m_all_rotations[index]);
+            replayPosition(kart, k);
+            continue;
         }
-        else
+
+        const std::vector<ControlEvent> &controls = m_all_controls[k];
+        unsigned int &next = m_next_control[k];
+        while(next<controls.size() && controls[next].m_frame<=m_current)
+            next++;
+        if(next>0)
+            kart->setControls(controls[next-1].m_control);
+
+        // Report the first frame at which the simulation differs
+        unsigned int index = (m_current/m_state_interval)*num_karts + k;
+        if(check_state && !m_desync_reported &&
+           index<m_all_checksums.size()      &&
+           getChecksum(kart)!=m_all_checksums[index])
         {
-            kart->setControls(m_all_controls[index]);
+            Log::warn("History", "Replay differs from recording in frame "
+                      "%d (kart %d, '%s').", m_current, k,
+                      kart->getIdent().c_str());
+            m_desync_reported     = true;
+            m_verification_failed = true;
         }
     }
 }   // updateReplay
 
 //-----------------------------------------------------------------------------
-/** Saves the history stored in the internal data structures into a file called
- *  history.dat.
+/** Called at the end of a verification replay. Checks that all karts that
+ *  had finished when the history was saved finished at exactly the same
+ *  time in the replay. Since the simulation is deterministic, any
+ *  difference means that the history was not recorded by an unmodified
+ *  STK.
  */
-void History::Save()
+void History::verifyFinishTimes()
 {
-    FILE *fd = fopen("history.dat","w");
-    if(fd)
-        Log::info("History", "Saved in ./history.dat.");
-    else
+    World *world = World::getWorld();
+    if(m_finish_times.empty())
     {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
-        fd = fopen(fn.c_str(), "w");
-        if(fd)
-            Log::info("History", "Saved in '%s'.", fn.c_str());
+        Log::warn("History", "No finish times were saved.");
+        m_verification_failed = true;
     }
-    if(!fd)
+    for(unsigned int k=0; k<m_finish_times.size(); k++)
     {
-        Log::info("History", "Can't open history.dat file for writing - can't save history.");
-        Log::info("History", "Make sure history.dat in the current directory "
-                             "or the config directory is writable.");
-        return;
+        const AbstractKart *kart = world->getKart(k);
+        const float time = kart->hasFinishedRace() ? kart->getFinishTime()
+                                                   : -1.0f;
+        if(time!=m_finish_times[k])
+        {
+            Log::warn("History", "Kart %d ('%s') finished at %f, but the "
+                      "recorded time is %f.", k, kart->getIdent().c_str(),
+                      time, m_finish_times[k]);
+            m_verification_failed = true;
+        }
     }
+    if(m_verification_failed)
+        Log::error("History", "Verification of '%s' failed.",
+                   m_filename.c_str());
+    else
+        Log::info("History", "Verification of '%s' passed.",
+                  m_filename.c_str());
+}   // verifyFinishTimes
 
-    World *world   = World::getWorld();
-    const int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %s\n",   STK_VERSION);
-    fprintf(fd, "numkarts: %d\n",   num_karts);
-    fprintf(fd, "numplayers: %d\n", race_manager->getNumPlayers());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-
-    assert(num_karts > 0);
-
-    int k;
-    for(k=0; k<num_karts; k++)
+//-----------------------------------------------------------------------------
+/** Marks the current frame as end of the history and makes sure that all
+ *  data is written to the history file. The recording continues, so if the
+ *  history is saved more than once, a replay ends at the last save.
+ */
+void History::Save()
+{
+    if(!m_thread_running)
     {
-        fprintf(fd, "model %d: %s\n",k, world->getKart(k)->getIdent().c_str());
+        Log::info("History", "No history file is written - can't save history.");
+        return;
     }
-    fprintf(fd, "size:     %d\n", m_size);
 
-    int index = m_wrapped ? m_current : 0;
-    for(int i=0; i<m_size; i++)
+    World *world   = World::getWorld();
+    const int num_karts = world->getNumKarts();
+    for(int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "delta: %f\n",m_all_deltas[index]);
-        index=(index+1)%m_size;
+        const AbstractKart *kart = world->getKart(k);
+        const float time = kart->hasFinishedRace() ? kart->getFinishTime()
+                                                   : -1.0f;
+        addLine("f %d %08x", k, floatToBits(time));
     }
-
-    index = num_karts * (m_wrapped ? m_current : 0);
-    for(int i=0; i<m_size; i++)
-    {
-        for(int k=0; k<num_karts; k++)
-        {
-            fprintf(fd, "%f %f %d  %f %f %f  %f %f %f %f\n",
-                    m_all_controls[index+k].m_steer,
-                    m_all_controls[index+k].m_accel,
-                    m_all_controls[index+k].getButtonsCompressed(),
-                    m_all_xyz[index+k].getX(), m_all_xyz[index+k].getY(),
-                    m_all_xyz[index+k].getZ(),
-                    m_all_rotations[index+k].getX(),
-                    m_all_rotations[index+k].getY(),
-                    m_all_rotations[index+k].getZ(),
-                    m_all_rotations[index+k].getW()  );
-        }   // for i
-        index=(index+num_karts)%(num_karts*m_size);
-    }   // for k
-    fprintf(fd, "History file end.\n");
-    fclose(fd);
+    addLine("e %d", m_current);
+    flushChunk();
+    Log::info("History", "Saved in '%s'.", m_filename.c_str());
 }   // Save
 
 //-----------------------------------------------------------------------------
@@ -230,18 +499,18 @@ void History::Load()
     char s[1024], s1[1024];
     int  n;
 
-    FILE *fd = fopen("history.dat","r");
+    FILE *fd = fopen(m_filename.c_str(),"r");
     if(fd)
-        Log::info("History", "Reading ./history.dat");
+        Log::info("History", "Reading '%s'.", m_filename.c_str());
     else
     {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
+        std::string fn = file_manager->getUserConfigFile(m_filename);
         fd = fopen(fn.c_str(), "r");
         if(fd)
             Log::info("History", "Reading '%s'.", fn.c_str());
     }
     if(!fd)
-        Log::fatal("History", "Could not open history.dat");
+        Log::fatal("History", "Could not open '%s'.", m_filename.c_str());
 
     if (fgets(s, 1023, fd) == NULL)
         Log::fatal("History", "Could not read history.dat.");
@@ -289,40 +558,88 @@ void History::Load()
         }
     }   // for i<nKarts
     // FIXME: The model information is currently ignored
-    fgets(s, 1023, fd);
-    if(sscanf(s,"size: %d",&m_size)!=1)
-        Log::fatal("History", "Number of records not found in history file.");
-
-    allocateMemory(m_size);
-    m_current = -1;
-
-    for(int i=0; i<m_size; i++)
-    {
-        fgets(s, 1023, fd);
-        sscanf(s, "delta: %f\n",&m_all_deltas[i]);
-    }
 
-    for(int i=0; i<m_size; i++)
+    int interval;
+    fgets(s, 1023, fd);
+    if(sscanf(s, "interval: %d", &interval)!=1 || interval!=m_state_interval)
+        Log::fatal("History", "Unsupported state interval in history file.");
+
+    // The rest of the file are records, one per line, in the order in
+    // which they were recorded:
+    //   d dt                      time step
+    //   c frame kart steer accel buttons   controls changed
+    //   s frame kart x y z  rx ry rz rw  checksum   state of a kart
+    //   f kart time               finish time (when the history was saved)
+    //   e frame                   history was saved in this frame
+    // Floats needed for the simulation are stored as their bit pattern.
+    // A file can end with an incomplete line if STK crashed.
+    m_all_controls.clear();
+    m_all_controls.resize(num_karts);
+    m_all_xyz.clear();
+    m_all_rotations.clear();
+    m_all_checksums.clear();
+    m_finish_times.assign(num_karts, -1.0f);
+    bool finish_times_known = false;
+    int  last_frame = -1;
+    m_size = -1;
+    while(fgets(s, 1023, fd))
     {
-        for(unsigned int k=0; k<num_karts; k++)
+        int frame, k, buttons_compressed;
+        unsigned int bits, steer, accel, checksum;
+        float x,y,z,rx,ry,rz,rw;
+        if(sscanf(s, "d %x", &bits)==1)
+            m_dt = bitsToFloat(bits);
+        else if(sscanf(s, "c %d %d %x %x %d", &frame, &k, &steer, &accel,
+                       &buttons_compressed)==5 && k>=0 && k<(int)num_karts)
+        {
+            ControlEvent event;
+            event.m_frame           = frame;
+            event.m_control.m_steer = bitsToFloat(steer);
+            event.m_control.m_accel = bitsToFloat(accel);
+            event.m_control.setButtonsCompressed(char(buttons_compressed));
+            m_all_controls[k].push_back(event);
+            last_frame = frame;
+        }
+        else if(sscanf(s, "s %d %d %f %f %f  %f %f %f %f  %x", &frame, &k,
+                       &x, &y, &z, &rx, &ry, &rz, &rw, &checksum)==10)
+        {
+            m_all_xyz.push_back(Vec3(x,y,z));
+            m_all_rotations.push_back(btQuaternion(rx,ry,rz,rw));
+            m_all_checksums.push_back(checksum);
+            last_frame = frame;
+        }
+        else if(sscanf(s, "f %d %x", &k, &bits)==2 && k>=0 &&
+                k<(int)num_karts)
+            m_finish_times[k] = bitsToFloat(bits);
+        else if(sscanf(s, "e %d", &frame)==1)
         {
-            unsigned int index = num_karts * i+k;
-            fgets(s, 1023, fd);
-            int buttonsCompressed;
-            float x,y,z,rx,ry,rz,rw;
-            sscanf(s, "%f %f %d  %f %f %f  %f %f %f %f\n",
-                    &m_all_controls[index].m_steer,
-                    &m_all_controls[index].m_accel,
-                    &buttonsCompressed,
-                    &x, &y, &z,
-                    &rx, &ry, &rz, &rw
-                    );
-            m_all_xyz[index]       = Vec3(x,y,z);
-            m_all_rotations[index] = btQuaternion(rx,ry,rz,rw);
-            m_all_controls[index].setButtonsCompressed(char(buttonsCompressed));
-        }   // for i
-    }   // for k
-    fprintf(fd, "History file end.\n");
+            m_size = frame+1;
+            finish_times_known = true;
+        }
+        else
+        {
+            Log::warn("History", "Invalid line in history file, ignoring "
+                      "the rest: '%s'.", s);
+            break;
+        }
+    }   // while fgets
     fclose(fd);
-}   // Load
 
+    // If the history was never saved explicitly (e.g. STK crashed), replay
+    // everything that was recorded.
+    if(m_size<0)
+    {
+        Log::warn("History", "History was not saved, replaying all %d "
+                  "recorded frames.", last_frame+1);
+        m_size = last_frame+1;
+    }
+    // Only complete states can be used
+    m_all_xyz.resize(m_all_xyz.size() - m_all_xyz.size() % num_karts);
+    m_all_rotations.resize(m_all_xyz.size());
+    m_all_checksums.resize(m_all_xyz.size());
+    if(!finish_times_known)
+        m_finish_times.clear();
+
+    resetReplay();
+    m_desync_reported = false;
+}   // Load
@@ -19,6 +19,8 @@
 #ifndef HEADER_HISTORY_HPP
 #define HEADER_HISTORY_HPP
 
+#include <pthread.h>
+#include <stdio.h>
 #include <vector>
 #include <string>
 
@@ -26,11 +28,23 @@
 
 #include "karts/controller/kart_control.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
 
-class Kart;
+class AbstractKart;
 
 /**
+  * \brief Records the controls of all karts in a race, so that the race can
+  *  be simulated again.
+  *  Since the world is updated with a fixed time step, simulating the
+  *  recorded controls gives exactly the same race. Controls are only stored
+  *  when they change. Additionally the state of all karts (position,
+  *  rotation and a checksum of the physics state) is stored every
+  *  m_state_interval frames: positions are used in HISTORY_POSITION mode,
+  *  and the checksums are used in HISTORY_PHYSICS mode to detect the first
+  *  frame at which the simulation differs from the recording.
+  *  While recording, all data is written to history.dat by a separate
+  *  thread, so the memory needed does not depend on the length of the race.
   * \ingroup race
   */
 class History
@@ -47,40 +61,110 @@ public:
                              HISTORY_POSITION = 1,
                              HISTORY_PHYSICS  = 2 };
 private:
+    /** Stores a change of the controls of a kart. */
+    struct ControlEvent
+    {
+        /** The frame from which on the controls are used. */
+        int         m_frame;
+        /** The controls. */
+        KartControl m_control;
+    };   // ControlEvent
+
+    /** Number of frames between two saved kart states. */
+    static const int m_state_interval = 10;
+
     /** maximum number of history events to store. */
     HistoryReplayMode          m_replay_mode;
 
-    /** Points to the last used entry, and will wrap around. */
+    /** The current frame. */
     int                        m_current;
 
-    /** True if the buffer has wrapped around. */
-    bool                       m_wrapped;
-
-    /** Counts how many entries in the arrays are used.  So if
-     *  the buffer hasn't wrapped around, this will indicate
-     *  how many entries to save. */
+    /** Number of frames recorded. */
     int                        m_size;
 
-    /** Stores all time step sizes. */
-    std::vector<float>         m_all_deltas;
+    /** The time step size. */
+    float                      m_dt;
+
+    /** For each kart all changes of its controls (when replaying). */
+    std::vector< std::vector<ControlEvent> > m_all_controls;
 
-    /** Stores the kart controls being used (for physics replay). */
-    std::vector<KartControl>   m_all_controls;
+    /** During replay the index of the next control event of each kart. */
+    std::vector<unsigned int>  m_next_control;
 
-    /** Stores the coordinates (for simple replay). */
+    /** Stores the coordinates of all karts every m_state_interval frames. */
     AlignedArray<Vec3>         m_all_xyz;
 
-    /** Stores the rotations of the karts. */
+    /** Stores the rotations of the karts every m_state_interval frames. */
     AlignedArray<btQuaternion> m_all_rotations;
 
+    /** Stores a checksum of the physics state of all karts every
+     *  m_state_interval frames. */
+    std::vector<unsigned int>  m_all_checksums;
+
+    /** True once a difference between recording and replay was found,
+     *  only the first difference is reported. */
+    bool                       m_desync_reported;
+
+    /** The finish times of all karts at the time the history was saved,
+     *  or -1 if a kart had not finished. */
+    std::vector<float>         m_finish_times;
+
+    /** True if the replay should only verify that simulating the recorded
+     *  controls gives the recorded finish times, and then exit. */
+    bool                       m_verify;
+
+    /** True if the verification failed. */
+    bool                       m_verification_failed;
+
+    /** Name of the history file to read or write. */
+    std::string                m_filename;
+
+    /** While recording the last controls of each kart, only changes are
+     *  written to the history file. */
+    std::vector<KartControl>   m_last_controls;
+
+    /** While recording the lines that have not been handed to the writing
+     *  thread yet. Only used by the main thread. */
+    std::string                m_chunk;
+
+    /** Data that the writing thread has to write to the history file. */
+    Synchronised<std::string>  m_pending_output;
+
+    /** Signals the writing thread that data is available, and protected
+     *  by the mutex of m_pending_output. */
+    pthread_cond_t             m_cond_request;
+
+    /** Set (protected by the mutex of m_pending_output) to stop the
+     *  writing thread once all data is written. */
+    bool                       m_stop_writing;
+
+    /** True if the writing thread is running. */
+    bool                       m_thread_running;
+
+    /** The thread writing the history file. */
+    pthread_t                  m_thread;
+
+    /** The history file that is written, only used by the writing
+     *  thread. */
+    FILE                      *m_file;
+
     /** The identities of the karts to use. */
     std::vector<std::string>  m_kart_ident;
 
-    void  allocateMemory(int number_of_frames);
     void  updateSaving(float dt);
     void  updateReplay(float dt);
+    void  resetReplay();
+    void  replayPosition(AbstractKart *kart, unsigned int k);
+    void  verifyFinishTimes();
+    void  addLine(const char *format, ...);
+    void  startWriting();
+    void  flushChunk();
+    void  stopWriting();
+    static void *writeLoop(void *obj);
+    static unsigned int getChecksum(const AbstractKart *kart);
 public:
           History        ();
+         ~History        ();
     void  startReplay    ();
     void  initRecording  ();
     void  update         (float dt);
@@ -95,7 +179,7 @@ public:
     }
     // ------------------------------------------------------------------------
     /** Returns the size of the next timestep. */
-    float getNextDelta   () const { return m_all_deltas[m_current];         }
+    float getNextDelta   () const { return m_dt;                             }
 
     // ------------------------------------------------------------------------
     /** Returns if a history is replayed, i.e. the history mode is not none. */
@@ -104,6 +188,22 @@ public:
     /** Enable replaying a history, enabled from the command line. */
     void  doReplayHistory(HistoryReplayMode m) {m_replay_mode = m;           }
     // ------------------------------------------------------------------------
+    /** Replays the physics of a history file once, as fast as possible, and
+     *  checks that the karts finish with the recorded times.
+     *  \param filename The history file to verify. */
+    void  doVerify(const std::string &filename)
+    {
+        m_replay_mode = HISTORY_PHYSICS;
+        m_verify      = true;
+        m_filename    = filename;
+    }   // doVerify
+    // ------------------------------------------------------------------------
+    /** Returns true if a history file is verified. */
+    bool  isVerifying    () const { return m_verify;                         }
+    // ------------------------------------------------------------------------
+    /** Returns true if the verification of a history file failed. */
+    bool  hasVerificationFailed() const { return m_verification_failed;     }
+    // ------------------------------------------------------------------------
     /** Returns true if the physics should not be simulated in replay mode.
      *  I.e. either no replay mode, or physics replay mode. */
     bool dontDoPhysics   () const { return m_replay_mode == HISTORY_POSITION;}
@@ -27,6 +27,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/texture_prefetcher.hpp"
 #include "input/device_manager.hpp"
 #include "input/input_manager.hpp"
 #include "karts/abstract_kart.hpp"
@@ -43,6 +44,8 @@
 #include "modes/world.hpp"
 #include "modes/three_strikes_battle.hpp"
 #include "modes/soccer_world.hpp"
+#include "race/history.hpp"
+#include "replay/replay_play.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
 #include "network/protocols/start_game_protocol.hpp"
@@ -52,7 +55,9 @@
 #include "states_screens/kart_selection.hpp"
 #include "states_screens/main_menu_screen.hpp"
 #include "states_screens/state_manager.hpp"
+#include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/memory_tracker.hpp"
 #include "utils/ptr_vector.hpp"
 
 RaceManager* race_manager= NULL;
@@ -83,6 +88,7 @@ RaceManager::RaceManager()
  */
 RaceManager::~RaceManager()
 {
+    TexturePrefetcher::cancelPreload();
 }   // ~RaceManager
 
 //-----------------------------------------------------------------------------
@@ -415,6 +421,7 @@ void RaceManager::startNextRace()
 {
     // Uncomment to debug audio leaks
     // sfx_manager->dump();
+    MemoryTracker::setPhase(MemoryTracker::PHASE_LOADING);
 
     stk_config->getAllScores(&m_score_for_position, m_num_karts);
     IrrlichtDevice* device = irr_driver->getDevice();
@@ -430,29 +437,13 @@ void RaceManager::startNextRace()
     // ==============================================
     if (m_track_number > 0)
     {
-        // In follow the leader mode do not change the first kart,
-        // since it's always the leader.
-        int offset = (m_minor_mode==MINOR_MODE_FOLLOW_LEADER) ? 1 : 0;
-
-        // Keep players at the end if needed
-        int player_last_offset = 0;
-        if (UserConfigParams::m_gp_player_last)
-        {
-            // Doing this is enough to keep player karts at
-            // the end because of the simple reason that they
-            // are at the end when getting added. Keep them out
-            // of the later sorting and they will stay there.
-            player_last_offset = (int)m_player_karts.size();
-        }
-
-        std::sort(m_kart_status.begin()+offset,
-                  m_kart_status.end() - player_last_offset);
-        // reverse kart order if flagged in user's config
-        if (UserConfigParams::m_gp_most_points_first)
-        {
-            std::reverse(m_kart_status.begin()+offset,
-                         m_kart_status.end() - player_last_offset);
-        }
+        std::vector<int> order;
+        computeStartOrder(&order);
+        std::vector<KartStatus> sorted;
+        sorted.reserve(order.size());
+        for (unsigned int i = 0; i < order.size(); i++)
+            sorted.push_back(m_kart_status[order[i]]);
+        m_kart_status.swap(sorted);
     }   // not first race
 
     // the constructor assigns this object to the global
@@ -516,10 +507,120 @@ void RaceManager::startNextRace()
         protocol->ready();
 }   // startNextRace
 
+//-----------------------------------------------------------------------------
+/** Computes the start order for the next race of a GP: the karts are sorted
+ *  by their points.
+ *  \param order On return contains the indices in m_kart_status of the
+ *         karts in the order in which they start.
+ */
+void RaceManager::computeStartOrder(std::vector<int> *order) const
+{
+    order->resize(m_kart_status.size());
+    for (unsigned int i = 0; i < m_kart_status.size(); i++)
+        (*order)[i] = i;
+
+    // In follow the leader mode do not change the first kart,
+    // since it's always the leader.
+    int offset = (m_minor_mode==MINOR_MODE_FOLLOW_LEADER) ? 1 : 0;
+
+    // Keep players at the end if needed
+    int player_last_offset = 0;
+    if (UserConfigParams::m_gp_player_last)
+    {
+        // Doing this is enough to keep player karts at
+        // the end because of the simple reason that they
+        // are at the end when getting added. Keep them out
+        // of the later sorting and they will stay there.
+        player_last_offset = (int)m_player_karts.size();
+    }
+
+    const std::vector<KartStatus> &status = m_kart_status;
+    std::sort(order->begin() + offset, order->end() - player_last_offset,
+              [&status](int a, int b) { return status[a] < status[b]; });
+    // reverse kart order if flagged in user's config
+    if (UserConfigParams::m_gp_most_points_first)
+    {
+        std::reverse(order->begin() + offset,
+                     order->end() - player_last_offset);
+    }
+}   // computeStartOrder
+
+//-----------------------------------------------------------------------------
+/** Returns true if the next race of a GP can be started by resetting the
+ *  current world instead of deleting it and loading everything again. This
+ *  is the case if the next race is on the same track in the same direction.
+ *  The karts of a GP never change, and the number of laps is read from the
+ *  race manager during the race.
+ */
+bool RaceManager::canReuseWorld() const
+{
+    if (!World::getWorld() || m_track_number == 0 ||
+        m_track_number >= (int)m_tracks.size())
+        return false;
+    // These worlds depend on more than the track and the karts
+    if (DemoWorld::isDemoMode() || ProfileWorld::isProfileMode() ||
+        history->replayHistory() || ReplayPlay::get() ||
+        NetworkWorld::getInstance()->isRunning())
+        return false;
+    return m_tracks[m_track_number] == m_tracks[m_track_number - 1] &&
+           m_reverse_track[m_track_number]
+                                       == m_reverse_track[m_track_number - 1];
+}   // canReuseWorld
+
+//-----------------------------------------------------------------------------
+/** Starts the next race of a GP in the current world, see canReuseWorld().
+ *  The track (including its physics and textures) and the karts stay
+ *  loaded, only the dynamic state is reset by World::reset(). Since the
+ *  karts of the world must stay in the order of m_kart_status, the kart
+ *  status is not sorted; instead the karts get new start positions.
+ */
+void RaceManager::startNextRaceInWorld()
+{
+    stk_config->getAllScores(&m_score_for_position, m_num_karts);
+
+    World *world = World::getWorld();
+    std::vector<int> order;
+    computeStartOrder(&order);
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        world->getKart(order[i])->setStartPosition(i + 1,
+                                  world->getTrack()->getStartTransform(i));
+    }
+
+    world->reset();
+
+    // See startNextRace
+    for (int i = 0; i < m_num_karts; i++)
+    {
+        m_kart_status[i].m_last_score = m_kart_status[i].m_score;
+        m_kart_status[i].m_last_time  = 0;
+    }
+}   // startNextRaceInWorld
+
+//-----------------------------------------------------------------------------
+/** Called when the results of a race are shown. In a GP this starts to load
+ *  the textures of the next track in the background, so that less time is
+ *  spent on the loading screen. The preload is cancelled if the GP is
+ *  aborted.
+ */
+void RaceManager::preloadNextTrack()
+{
+    if (m_major_mode != MAJOR_MODE_GRAND_PRIX ||
+        NetworkWorld::getInstance()->isRunning())
+        return;
+    const int next = m_track_number + 1;
+    // The same track is not loaded again, see canReuseWorld()
+    if (next >= (int)m_tracks.size() ||
+        m_tracks[next] == m_tracks[m_track_number])
+        return;
+    Track *track = track_manager->getTrack(m_tracks[next]);
+    if (track)
+        track->preloadTextures();
+}   // preloadNextTrack
+
 //-----------------------------------------------------------------------------
 void RaceManager::next()
 {
-    World::deleteWorld();
     m_num_finished_karts   = 0;
     m_num_finished_players = 0;
     m_track_number++;
@@ -530,10 +631,19 @@ void RaceManager::next()
             // Saving GP state
             saveGP();
         }
-        startNextRace();
+        if (canReuseWorld())
+        {
+            startNextRaceInWorld();
+        }
+        else
+        {
+            World::deleteWorld();
+            startNextRace();
+        }
     }
     else
     {
+        World::deleteWorld();
         exitRace();
     }
 }   // next
@@ -653,6 +763,8 @@ void RaceManager::computeGPRanks()
 
 void RaceManager::exitRace(bool delete_world)
 {
+    TexturePrefetcher::cancelPreload();
+
     // Only display the grand prix result screen if all tracks
     // were finished, and not when a race is aborted.
     if (m_major_mode==MAJOR_MODE_GRAND_PRIX && m_track_number==(int)m_tracks.size())
@@ -340,6 +340,9 @@ private:
     int                              m_goal_target;
 
     void startNextRace();    // start a next race
+    void computeStartOrder(std::vector<int> *order) const;
+    bool canReuseWorld() const;
+    void startNextRaceInWorld();
 
     friend bool operator< (const KartStatus& left, const KartStatus& right)
     {
@@ -681,6 +684,11 @@ public:
       */
     void next();
 
+    /** \brief Starts to load the next track of a GP in the background
+      * while the results of a race are shown.
+      */
+    void preloadNextTrack();
+
     /** \brief Rerun the same race again
       * This is called after a race is finished, and it will adjust
       * the number of points and the overall time before restarting the race.
@@ -0,0 +1,392 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "race/telemetry.hpp"
+
+#include "io/file_manager.hpp"
+#include "items/powerup.hpp"
+#include "karts/abstract_kart.hpp"
+#include "karts/explosion_animation.hpp"
+#include "karts/rescue_animation.hpp"
+#include "modes/world.hpp"
+#include "race/race_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+Telemetry *Telemetry::m_telemetry = NULL;
+
+//-----------------------------------------------------------------------------
+/** Creates the telemetry recorder.
+ *  \param rate Number of samples per second.
+ */
+Telemetry::Telemetry(int rate)
+{
+    m_rate              = std::max(rate, 1);
+    m_time_since_sample = 0;
+    m_num_dropped       = 0;
+    m_thread_running    = false;
+    m_stop_writing      = false;
+    m_binary_file       = NULL;
+    m_csv_file          = NULL;
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond_request, NULL);
+}   // Telemetry
+
+//-----------------------------------------------------------------------------
+/** Writes all remaining data and frees all data.
+ */
+Telemetry::~Telemetry()
+{
+    stopWriting();
+    for(unsigned int i=0; i<m_karts.size(); i++)
+        delete m_karts[i];
+    pthread_cond_destroy(&m_cond_request);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~Telemetry
+
+//-----------------------------------------------------------------------------
+/** Called when a race is (re)started. Finishes the files of the previous
+ *  race, and starts writing new files for this race. The file names
+ *  contain the current time and the track name.
+ */
+void Telemetry::startRace()
+{
+    endRace();
+    World *world = World::getWorld();
+    for(unsigned int i=0; i<m_karts.size(); i++)
+        delete m_karts[i];
+    m_karts.clear();
+    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    {
+        KartData *data = new KartData();
+        const AbstractKart *kart = world->getKart(i);
+        data->m_events        = 0;
+        data->m_had_animation = kart->getKartAnimation() != NULL;
+        data->m_had_finished  = kart->hasFinishedRace();
+        data->m_powerup_count = kart->getPowerup()->getNum();
+        data->m_energy        = kart->getEnergy();
+        m_karts.push_back(data);
+    }
+    m_time_since_sample = 0;
+    m_num_dropped       = 0;
+
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+    std::string name = std::string("telemetry-") + date + "-"
+                     + race_manager->getTrackName();
+    name = m_directory.empty() ? file_manager->getUserConfigFile(name)
+                               : m_directory + "/" + name;
+
+    m_binary_file = fopen((name+".bin").c_str(), "wb");
+    m_csv_file    = fopen((name+".csv").c_str(), "w");
+    if(!m_binary_file || !m_csv_file)
+    {
+        Log::error("Telemetry", "Can't open '%s' for writing.", name.c_str());
+        if(m_binary_file) fclose(m_binary_file);
+        if(m_csv_file)    fclose(m_csv_file);
+        m_binary_file = m_csv_file = NULL;
+        return;
+    }
+    writeHeader();
+
+    m_stop_writing = false;
+    pthread_attr_t  attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int error = pthread_create(&m_thread, &attr, &Telemetry::writeLoop, this);
+    pthread_attr_destroy(&attr);
+    if(error)
+    {
+        Log::error("Telemetry", "Could not create thread, error=%d.", errno);
+        fclose(m_binary_file);
+        fclose(m_csv_file);
+        m_binary_file = m_csv_file = NULL;
+        return;
+    }
+    m_thread_running = true;
+    Log::info("Telemetry", "Writing telemetry to '%s'.", name.c_str());
+}   // startRace
+
+//-----------------------------------------------------------------------------
+/** Called at the end of a race, writes all remaining samples.
+ */
+void Telemetry::endRace()
+{
+    if(!m_thread_running)
+        return;
+    stopWriting();
+    if(m_num_dropped > 0)
+        Log::warn("Telemetry", "%d samples were dropped.", m_num_dropped);
+}   // endRace
+
+//-----------------------------------------------------------------------------
+/** Writes the header of both files: the binary file starts with "STKT",
+ *  followed by the version, the sample rate and the number of karts (all
+ *  32 bit unsigned), then the track name and the ident of each kart (each
+ *  as an 8 bit length followed by the characters). Each block of samples
+ *  then contains the kart id (8 bit), the number n of samples (16 bit),
+ *  and n values of each of: time, x, y, z, speed (floats), steering (8 bit
+ *  signed, -127 to 127), acceleration (8 bit, 0 to 255), the buttons (see
+ *  KartControl::getButtonsCompressed) and events (see EventType). All
+ *  values are stored in the byte order of the recording machine.
+ */
+void Telemetry::writeHeader()
+{
+    World *world = World::getWorld();
+    fwrite("STKT", 1, 4, m_binary_file);
+    const unsigned int header[3] = { 1, (unsigned int)m_rate,
+                                     world->getNumKarts() };
+    fwrite(header, sizeof(header[0]), 3, m_binary_file);
+
+    std::vector<std::string> names;
+    names.push_back(race_manager->getTrackName());
+    for(unsigned int i=0; i<world->getNumKarts(); i++)
+        names.push_back(world->getKart(i)->getIdent());
+    for(unsigned int i=0; i<names.size(); i++)
+    {
+        unsigned char len = (unsigned char)std::min(names[i].size(),
+                                                    (size_t)255);
+        fwrite(&len, 1, 1, m_binary_file);
+        fwrite(names[i].c_str(), 1, len, m_binary_file);
+    }
+
+    fprintf(m_csv_file, "# track: %s, rate: %d\n",
+            race_manager->getTrackName().c_str(), m_rate);
+    for(unsigned int i=0; i<world->getNumKarts(); i++)
+        fprintf(m_csv_file, "# kart %d: %s\n", i,
+                world->getKart(i)->getIdent().c_str());
+    fprintf(m_csv_file, "kart,time,x,y,z,speed,steer,accel,buttons,events\n");
+}   // writeHeader
+
+//-----------------------------------------------------------------------------
+/** Returns the events of a kart since the last frame, which are detected by
+ *  comparing its state with the state in the previous frame.
+ *  \param data The data of the kart, which stores the previous state.
+ *  \param kart The kart.
+ */
+unsigned char Telemetry::getEvents(KartData *data, const AbstractKart *kart)
+{
+    unsigned char events = 0;
+    const AbstractKartAnimation *animation = kart->getKartAnimation();
+    if(animation && !data->m_had_animation)
+    {
+        if(dynamic_cast<const ExplosionAnimation*>(animation))
+            events |= EVENT_EXPLOSION;
+        else if(dynamic_cast<const RescueAnimation*>(animation))
+            events |= EVENT_RESCUE;
+        else
+            events |= EVENT_ANIMATION;
+    }
+    data->m_had_animation = animation != NULL;
+
+    const int powerup_count = kart->getPowerup()->getNum();
+    if(powerup_count > data->m_powerup_count)
+        events |= EVENT_POWERUP;
+    data->m_powerup_count = powerup_count;
+
+    const float energy = kart->getEnergy();
+    if(energy > data->m_energy)
+        events |= EVENT_NITRO;
+    data->m_energy = energy;
+
+    if(kart->hasFinishedRace() && !data->m_had_finished)
+        events |= EVENT_FINISH;
+    data->m_had_finished = kart->hasFinishedRace();
+    return events;
+}   // getEvents
+
+//-----------------------------------------------------------------------------
+/** Adds a sample of a kart to its ring buffer. If the ring buffer is full
+ *  the sample is dropped (but its events are added to the next sample).
+ *  \param kart_id World id of the kart.
+ *  \param kart The kart.
+ */
+void Telemetry::addSample(unsigned int kart_id, const AbstractKart *kart)
+{
+    KartData *data = m_karts[kart_id];
+    const unsigned int write = data->m_write.load(std::memory_order_relaxed);
+    const unsigned int read  = data->m_read.load(std::memory_order_acquire);
+    if(write - read >= RING_SIZE)
+    {
+        m_num_dropped++;
+        return;
+    }
+
+    Sample &s = data->m_samples[write & (RING_SIZE-1)];
+    s.m_time   = World::getWorld()->getTime();
+    s.m_xyz[0] = kart->getXYZ().getX();
+    s.m_xyz[1] = kart->getXYZ().getY();
+    s.m_xyz[2] = kart->getXYZ().getZ();
+    s.m_speed  = kart->getSpeed();
+    const KartControl &controls = kart->getControls();
+    const float steer = std::max(-1.0f, std::min(controls.m_steer, 1.0f));
+    const float accel = std::max( 0.0f, std::min(controls.m_accel, 1.0f));
+    s.m_steer   = (signed char)(127.0f * steer);
+    s.m_accel   = (unsigned char)(255.0f * accel);
+    s.m_buttons = controls.getButtonsCompressed();
+    s.m_events  = data->m_events;
+    data->m_events = 0;
+    data->m_write.store(write + 1, std::memory_order_release);
+
+    if(write + 1 - read >= BLOCK_SIZE)
+    {
+        pthread_mutex_lock(&m_mutex);
+        pthread_cond_signal(&m_cond_request);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}   // addSample
+
+//-----------------------------------------------------------------------------
+/** Detects the events of all karts in each frame, and samples all karts at
+ *  the telemetry rate.
+ *  \param dt Time step size.
+ */
+void Telemetry::update(float dt)
+{
+    if(!m_thread_running)
+        return;
+    World *world = World::getWorld();
+    for(unsigned int i=0; i<m_karts.size(); i++)
+        m_karts[i]->m_events |= getEvents(m_karts[i], world->getKart(i));
+
+    const float interval = 1.0f / m_rate;
+    m_time_since_sample += dt;
+    if(m_time_since_sample < interval)
+        return;
+    // Don't try to catch up if a frame took longer than one interval
+    m_time_since_sample = fmodf(m_time_since_sample, interval);
+    for(unsigned int i=0; i<m_karts.size(); i++)
+        addSample(i, world->getKart(i));
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Writes samples of a kart from its ring buffer to the files, called from
+ *  the writing thread.
+ *  \param kart_id World id of the kart.
+ *  \param all If true all samples are written, otherwise only full blocks.
+ *  \return True if any samples were written.
+ */
+bool Telemetry::writeSamples(unsigned int kart_id, bool all)
+{
+    KartData *data = m_karts[kart_id];
+    unsigned int read  = data->m_read.load(std::memory_order_relaxed);
+    const unsigned int write = data->m_write.load(std::memory_order_acquire);
+    bool written = false;
+
+    float         floats[5][BLOCK_SIZE];
+    unsigned char bytes[4][BLOCK_SIZE];
+    while(write - read >= BLOCK_SIZE || (all && write != read))
+    {
+        const unsigned int n = std::min(write - read, BLOCK_SIZE);
+        for(unsigned int i=0; i<n; i++)
+        {
+            const Sample &s = data->m_samples[(read + i) & (RING_SIZE-1)];
+            floats[0][i] = s.m_time;
+            floats[1][i] = s.m_xyz[0];
+            floats[2][i] = s.m_xyz[1];
+            floats[3][i] = s.m_xyz[2];
+            floats[4][i] = s.m_speed;
+            bytes[0][i]  = (unsigned char)s.m_steer;
+            bytes[1][i]  = s.m_accel;
+            bytes[2][i]  = s.m_buttons;
+            bytes[3][i]  = s.m_events;
+            fprintf(m_csv_file, "%d,%.3f,%.2f,%.2f,%.2f,%.2f,%d,%d,%d,%d\n",
+                    kart_id, s.m_time, s.m_xyz[0], s.m_xyz[1], s.m_xyz[2],
+                    s.m_speed, s.m_steer, s.m_accel, s.m_buttons,
+                    s.m_events);
+        }
+        const unsigned char  id  = (unsigned char)kart_id;
+        const unsigned short num = (unsigned short)n;
+        fwrite(&id,  sizeof(id),  1, m_binary_file);
+        fwrite(&num, sizeof(num), 1, m_binary_file);
+        for(unsigned int c=0; c<5; c++)
+            fwrite(floats[c], sizeof(float), n, m_binary_file);
+        for(unsigned int c=0; c<4; c++)
+            fwrite(bytes[c], 1, n, m_binary_file);
+
+        read += n;
+        data->m_read.store(read, std::memory_order_release);
+        written = true;
+    }
+    return written;
+}   // writeSamples
+
+//-----------------------------------------------------------------------------
+/** Writes all remaining data, then stops the writing thread and closes the
+ *  files.
+ */
+void Telemetry::stopWriting()
+{
+    if(!m_thread_running)
+        return;
+    pthread_mutex_lock(&m_mutex);
+    m_stop_writing = true;
+    pthread_cond_signal(&m_cond_request);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+    m_thread_running = false;
+    fclose(m_binary_file);
+    fclose(m_csv_file);
+    m_binary_file = m_csv_file = NULL;
+}   // stopWriting
+
+//-----------------------------------------------------------------------------
+/** The thread that writes the telemetry files. It writes full blocks of
+ *  samples whenever the main thread signals that some are available, and
+ *  all remaining samples once it is stopped.
+ *  \param obj Pointer to the telemetry object.
+ */
+void* Telemetry::writeLoop(void *obj)
+{
+    Telemetry *me = (Telemetry*)obj;
+    profiler.setThreadName("Telemetry");
+
+    pthread_mutex_lock(&me->m_mutex);
+    while(true)
+    {
+        const bool stop = me->m_stop_writing;
+        pthread_mutex_unlock(&me->m_mutex);
+
+        bool written = false;
+        for(unsigned int i=0; i<me->m_karts.size(); i++)
+        {
+            if(me->writeSamples(i, stop))
+                written = true;
+        }
+        if(written)
+        {
+            fflush(me->m_binary_file);
+            fflush(me->m_csv_file);
+        }
+
+        pthread_mutex_lock(&me->m_mutex);
+        if(stop)
+            break;  // all data is written
+        // A signal from the main thread might have been missed while
+        // writing, so only wait if there was nothing to write.
+        if(!written && !me->m_stop_writing)
+            pthread_cond_wait(&me->m_cond_request, &me->m_mutex);
+    }
+    pthread_mutex_unlock(&me->m_mutex);
+    return NULL;
+}   // writeLoop
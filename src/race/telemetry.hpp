@@ -0,0 +1,175 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TELEMETRY_HPP
+#define HEADER_TELEMETRY_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+class AbstractKart;
+
+/**
+  * \brief Records the position, speed, controls and important events of all
+  *  karts during a race for later analysis (e.g. track balance, lag).
+  *  Enabled with --telemetry=n, which samples all karts n times per second.
+  *  Each kart has a ring buffer of samples, which is filled by the main
+  *  thread and emptied by a separate writing thread, so the overhead in the
+  *  main thread is only copying a few values per sample. Each race is
+  *  written to two files in the telemetry directory: a CSV file with one
+  *  line per sample, and a compact binary file. The binary file starts with
+  *  a header (see writeHeader), followed by blocks of samples of one kart,
+  *  which store each value for all samples of the block after each other
+  *  (i.e. columns), which compresses well.
+  * \ingroup race
+  */
+class Telemetry : public NoCopy
+{
+public:
+    /** Events that are recorded with the next sample of a kart. */
+    enum EventType { EVENT_EXPLOSION = 1,    // kart was hit by an explosion
+                     EVENT_RESCUE    = 2,    // kart is rescued
+                     EVENT_ANIMATION = 4,    // other animation, e.g. cannon
+                     EVENT_POWERUP   = 8,    // kart collected a powerup
+                     EVENT_NITRO     = 16,   // kart collected nitro
+                     EVENT_FINISH    = 32 }; // kart finished the race
+private:
+    /** One sample of a kart. */
+    struct Sample
+    {
+        float         m_time;
+        float         m_xyz[3];
+        float         m_speed;
+        signed char   m_steer;
+        unsigned char m_accel;
+        /** The buttons, see KartControl::getButtonsCompressed. */
+        unsigned char m_buttons;
+        /** All events since the previous sample, see EventType. */
+        unsigned char m_events;
+    };   // Sample
+
+    /** Number of samples in the ring buffer of a kart, must be a power
+     *  of two. */
+    static const unsigned int RING_SIZE  = 1024;
+
+    /** The writing thread is woken up once a kart has this many samples
+     *  in its ring buffer. This is also the maximum size of a block in the
+     *  binary file. */
+    static const unsigned int BLOCK_SIZE = 64;
+
+    /** The samples of one kart. The ring buffer is only written by the
+     *  main thread and only read by the writing thread, so no locking is
+     *  necessary. */
+    struct KartData
+    {
+        Sample                    m_samples[RING_SIZE];
+        /** Number of samples added, written by the main thread. */
+        std::atomic<unsigned int> m_write;
+        /** Number of samples written to disk, written by the writing
+         *  thread. */
+        std::atomic<unsigned int> m_read;
+        /** Events since the last sample, only used by the main thread. */
+        unsigned char             m_events;
+        /** State in the previous frame to detect events. */
+        bool                      m_had_animation;
+        bool                      m_had_finished;
+        int                       m_powerup_count;
+        float                     m_energy;
+        KartData() : m_write(0), m_read(0) {}
+    };   // KartData
+
+    /** Number of samples per second. */
+    int                    m_rate;
+
+    /** Directory in which the telemetry files are written. */
+    std::string            m_directory;
+
+    /** Time since the last sample. */
+    float                  m_time_since_sample;
+
+    /** The data of all karts. */
+    std::vector<KartData*> m_karts;
+
+    /** Number of samples dropped because the writing thread did not keep
+     *  up (e.g. a very slow disk). */
+    unsigned int           m_num_dropped;
+
+    /** True if the writing thread is running. */
+    bool                   m_thread_running;
+
+    /** Set to stop the writing thread, protected by m_mutex. */
+    bool                   m_stop_writing;
+
+    /** Protects m_stop_writing and m_cond_request. */
+    pthread_mutex_t        m_mutex;
+
+    /** Signals the writing thread that data is available. */
+    pthread_cond_t         m_cond_request;
+
+    /** The thread writing the telemetry files. */
+    pthread_t              m_thread;
+
+    /** The files that are written, only used by the writing thread. */
+    FILE                  *m_binary_file;
+    FILE                  *m_csv_file;
+
+    static Telemetry      *m_telemetry;
+
+         Telemetry(int rate);
+        ~Telemetry();
+    void addSample(unsigned int kart_id, const AbstractKart *kart);
+    unsigned char getEvents(KartData *data, const AbstractKart *kart);
+    void writeHeader();
+    bool writeSamples(unsigned int kart_id, bool all);
+    void stopWriting();
+    static void *writeLoop(void *obj);
+
+public:
+    void startRace();
+    void endRace();
+    void update(float dt);
+    // ------------------------------------------------------------------------
+    /** Sets the directory in which the telemetry files are written. */
+    void setDirectory(const std::string &dir) { m_directory = dir; }
+    // ------------------------------------------------------------------------
+    /** Creates the instance of the telemetry recorder.
+     *  \param rate Number of samples per second. */
+    static void create(int rate)
+    {
+        assert(!m_telemetry);
+        m_telemetry = new Telemetry(rate);
+    }   // create
+    // ------------------------------------------------------------------------
+    /** Returns the instance of the telemetry recorder, which is NULL if
+     *  telemetry is not enabled. */
+    static Telemetry *get() { return m_telemetry; }
+    // ------------------------------------------------------------------------
+    /** Writes all remaining data and destroys the telemetry recorder. */
+    static void destroy()
+    {
+        delete m_telemetry;
+        m_telemetry = NULL;
+    }   // destroy
+};   // Telemetry
+
+#endif
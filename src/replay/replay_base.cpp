@@ -20,6 +20,13 @@
 #include "io/file_manager.hpp"
 #include "race/race_manager.hpp"
 
+#include <math.h>
+
+const char *const ReplayBase::BINARY_MAGIC   = "STKR";
+const float       ReplayBase::TIME_SCALE     = 1000.0f;
+const float       ReplayBase::POSITION_SCALE = 1000.0f;
+const float       ReplayBase::ROTATION_SCALE = 32767.0f;
+
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
 {
@@ -35,12 +42,136 @@ FILE* ReplayBase::openReplayFile(bool writeable)
 {
     m_filename = file_manager->getUserConfigFile(
                                        race_manager->getTrackName()+".replay");
-    FILE *fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+    FILE *fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     if(!fd)
     {
         m_filename = race_manager->getTrackName()+".replay";
-        fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+        fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     }
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+/** Appends an unsigned integer to a binary replay. Small numbers need less
+ *  space: 7 bits are stored per byte, the highest bit indicates that more
+ *  bytes follow.
+ *  \param data The binary data to append to.
+ *  \param n The number to store.
+ */
+void ReplayBase::addUInt(std::string *data, unsigned int n)
+{
+    while(n >= 0x80)
+    {
+        data->push_back((char)((n & 0x7f) | 0x80));
+        n >>= 7;
+    }
+    data->push_back((char)n);
+}   // addUInt
+
+// -----------------------------------------------------------------------------
+/** Appends a signed integer to a binary replay. The sign is moved into the
+ *  lowest bit, so that numbers close to 0 (e.g. the difference between two
+ *  positions) need little space.
+ *  \param data The binary data to append to.
+ *  \param n The number to store.
+ */
+void ReplayBase::addInt(std::string *data, int n)
+{
+    addUInt(data, ((unsigned int)n << 1) ^ (unsigned int)(n >> 31));
+}   // addInt
+
+// -----------------------------------------------------------------------------
+/** Appends a string (length followed by the characters) to a binary replay.
+ */
+void ReplayBase::addString(std::string *data, const std::string &s)
+{
+    addUInt(data, (unsigned int)s.size());
+    data->append(s);
+}   // addString
+
+// -----------------------------------------------------------------------------
+/** Reads an unsigned integer stored with addUInt.
+ *  \param data The binary data.
+ *  \param offset Offset at which to read, will be moved behind the number.
+ *  \param n On return the number read.
+ *  \return False if the data ended before the number was complete.
+ */
+bool ReplayBase::getUInt(const std::string &data, unsigned int *offset,
+                         unsigned int *n)
+{
+    *n = 0;
+    for(unsigned int shift=0; shift<32; shift+=7)
+    {
+        if(*offset >= data.size())
+            return false;
+        unsigned char c = (unsigned char)data[(*offset)++];
+        *n |= (unsigned int)(c & 0x7f) << shift;
+        if(!(c & 0x80))
+            return true;
+    }
+    return false;
+}   // getUInt
+
+// -----------------------------------------------------------------------------
+/** Reads a signed integer stored with addInt.
+ */
+bool ReplayBase::getInt(const std::string &data, unsigned int *offset,
+                        int *n)
+{
+    unsigned int u;
+    if(!getUInt(data, offset, &u))
+        return false;
+    *n = (int)(u >> 1) ^ -(int)(u & 1);
+    return true;
+}   // getInt
+
+// -----------------------------------------------------------------------------
+/** Reads a string stored with addString.
+ */
+bool ReplayBase::getString(const std::string &data, unsigned int *offset,
+                           std::string *s)
+{
+    unsigned int len;
+    if(!getUInt(data, offset, &len) || *offset + len > data.size())
+        return false;
+    *s = data.substr(*offset, len);
+    *offset += len;
+    return true;
+}   // getString
+
+// -----------------------------------------------------------------------------
+/** Quantises a value and appends its difference to the previously stored
+ *  (quantised) value to a binary replay.
+ *  \param data The binary data to append to.
+ *  \param value The value to store.
+ *  \param scale Quantisation factor.
+ *  \param previous The previously stored quantised value, will be updated.
+ */
+void ReplayBase::addDelta(std::string *data, float value, float scale,
+                          int *previous)
+{
+    int n = (int)floorf(value*scale + 0.5f);
+    addInt(data, n - *previous);
+    *previous = n;
+}   // addDelta
+
+// -----------------------------------------------------------------------------
+/** Reads a value stored with addDelta.
+ *  \param data The binary data.
+ *  \param offset Offset at which to read, will be moved behind the value.
+ *  \param scale Quantisation factor used when storing the value.
+ *  \param previous The previously read quantised value, will be updated.
+ *  \param value On return the value read.
+ *  \return False if the data ended before the value was complete.
+ */
+bool ReplayBase::getDelta(const std::string &data, unsigned int *offset,
+                          float scale, int *previous, float *value)
+{
+    int delta;
+    if(!getInt(data, offset, &delta))
+        return false;
+    *previous += delta;
+    *value     = *previous / scale;
+    return true;
+}   // getDelta
@@ -61,9 +61,38 @@ protected:
         float       m_time;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** Replay files (since version 2) are binary files starting with this
+     *  magic string. Older text files start with 'Version:'. */
+    static const char *const BINARY_MAGIC;
+
+    /** Flags stored in the header of a binary replay file. */
+    enum BinaryFlags { BF_COMPRESSED = 1 };
+
+    /** Scale factors used to quantise the data in a binary replay file:
+     *  times are stored in ms, positions in mm, and quaternion components
+     *  as 16 bit fractions. */
+    static const float TIME_SCALE;
+    static const float POSITION_SCALE;
+    static const float ROTATION_SCALE;
+
     // ------------------------------------------------------------------------
           ReplayBase();
     FILE *openReplayFile(bool writeable);
+
+    static void addUInt(std::string *data, unsigned int n);
+    static void addInt(std::string *data, int n);
+    static void addString(std::string *data, const std::string &s);
+    static bool getUInt(const std::string &data, unsigned int *offset,
+                        unsigned int *n);
+    static bool getInt(const std::string &data, unsigned int *offset,
+                       int *n);
+    static bool getString(const std::string &data, unsigned int *offset,
+                          std::string *s);
+    static void addDelta(std::string *data, float value, float scale,
+                         int *previous);
+    static bool getDelta(const std::string &data, unsigned int *offset,
+                         float scale, int *previous, float *value);
     // ----------------------------------------------------------------------
     /** Returns the filename that was opened. */
     const std::string &getReplayFilename() const { return m_filename;}
@@ -71,7 +100,7 @@ protected:
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
      *  executable. */
-    unsigned int getReplayVersion() const { return 1; }
+    unsigned int getReplayVersion() const { return 2; }
 };   // ReplayBase
 
 #endif
@@ -26,7 +26,9 @@
 #include "tracks/track.hpp"
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
+#include <zlib.h>
 
 ReplayPlay *ReplayPlay::m_replay_play = NULL;
 
@@ -96,6 +98,16 @@ void ReplayPlay::Load()
 
     Log::info("Replay", "Reading replay file '%s'.", getReplayFilename().c_str());
 
+    char magic[4];
+    if(fread(magic, 1, 4, fd)==4 && memcmp(magic, BINARY_MAGIC, 4)==0)
+    {
+        readBinaryData(fd);
+        fclose(fd);
+        return;
+    }
+    // Otherwise it's an old text replay file
+    rewind(fd);
+
     if (fgets(s, 1023, fd) == NULL)
         Log::fatal("Replay", "Could not read '%s'.", getReplayFilename().c_str());
 
@@ -148,6 +160,141 @@ void ReplayPlay::Load()
     fclose(fd);
 }   // Load
 
+//-----------------------------------------------------------------------------
+/** Reads a binary replay file (see ReplayRecorder::Save). The magic string
+ *  at the beginning of the file has already been read.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readBinaryData(FILE *fd)
+{
+    std::string file_data;
+    char buffer[4096];
+    size_t n;
+    while((n=fread(buffer, 1, sizeof(buffer), fd)) > 0)
+        file_data.append(buffer, n);
+
+    unsigned int offset = 0;
+    unsigned int version, flags, size;
+    if(!getUInt(file_data, &offset, &version) ||
+       !getUInt(file_data, &offset, &flags)   ||
+       !getUInt(file_data, &offset, &size)       )
+    {
+        Log::error("Replay", "Invalid header in '%s', ghost replay disabled.",
+                   getReplayFilename().c_str());
+        return;
+    }
+    if (version != getReplayVersion())
+    {
+        Log::warn("Replay", "Replay is version '%d'",version);
+        Log::warn("Replay", "STK version is '%d'",getReplayVersion());
+        Log::warn("Replay", "We try to proceed, but it may fail.");
+    }
+
+    std::string data;
+    if(flags & BF_COMPRESSED)
+    {
+        data.resize(size);
+        uLongf uncompressed_size = size;
+        if(size==0 ||
+           uncompress((Bytef*)&data[0], &uncompressed_size,
+                      (const Bytef*)file_data.data()+offset,
+                      (uLong)(file_data.size()-offset)) != Z_OK ||
+           uncompressed_size != size                                 )
+        {
+            Log::error("Replay", "Can't uncompress '%s', ghost replay "
+                       "disabled.", getReplayFilename().c_str());
+            return;
+        }
+    }
+    else
+        data = file_data.substr(offset);
+
+    offset = 0;
+    unsigned int difficulty, num_laps, num_karts;
+    std::string track;
+    if(!getUInt(data, &offset, &difficulty) ||
+       !getString(data, &offset, &track)    ||
+       !getUInt(data, &offset, &num_laps)   ||
+       !getUInt(data, &offset, &num_karts)     )
+    {
+        Log::error("Replay", "Invalid data in '%s', ghost replay disabled.",
+                   getReplayFilename().c_str());
+        return;
+    }
+
+    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)difficulty)
+        Log::warn("Replay", "Difficulty of replay is '%d', "
+                  "while '%d' is selected.",
+                  difficulty, race_manager->getDifficulty());
+    assert(track==race_manager->getTrackName());
+    race_manager->setTrack(track);
+    race_manager->setNumLaps(num_laps);
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        std::string model;
+        unsigned int num_transforms;
+        if(!getString(data, &offset, &model) ||
+           !getUInt(data, &offset, &num_transforms))
+        {
+            Log::warn("Replay", "No data for kart %d found.", k);
+            return;
+        }
+
+        GhostKart *kart = new GhostKart(model);
+        m_ghost_karts.push_back(kart);
+        kart->init(RaceManager::KT_GHOST);
+
+        int previous[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for(unsigned int i=0; i<num_transforms; i++)
+        {
+            float v[8];
+            bool ok = getDelta(data, &offset, TIME_SCALE, &previous[0], &v[0]);
+            for(unsigned int j=1; j<4; j++)
+                ok = ok && getDelta(data, &offset, POSITION_SCALE,
+                                    &previous[j], &v[j]);
+            for(unsigned int j=4; j<8; j++)
+                ok = ok && getDelta(data, &offset, ROTATION_SCALE,
+                                    &previous[j], &v[j]);
+            if(!ok)
+            {
+                Log::warn("Replay", "Replay data of kart %d is truncated.",
+                          k);
+                return;
+            }
+            // Quantisation changes the length of the quaternion slightly
+            btQuaternion q(v[4], v[5], v[6], v[7]);
+            q.normalize();
+            kart->addTransform(v[0], btTransform(q, btVector3(v[1], v[2],
+                                                              v[3])));
+        }   // for i < num_transforms
+
+        unsigned int num_events;
+        if(!getUInt(data, &offset, &num_events))
+        {
+            Log::warn("Replay", "Number of events not found in replay file "
+                      "for kart %d.", k);
+            return;
+        }
+        int previous_time = 0;
+        for(unsigned int i=0; i<num_events; i++)
+        {
+            KartReplayEvent kre;
+            unsigned int type;
+            if(!getDelta(data, &offset, TIME_SCALE, &previous_time,
+                         &kre.m_time)                               ||
+               !getUInt(data, &offset, &type)                           )
+            {
+                Log::warn("Replay", "Replay events of kart %d are "
+                          "truncated.", k);
+                return;
+            }
+            kre.m_type = (KartReplayEvent::KartReplayEventType)type;
+            kart->addReplayEvent(kre);
+        }   // for i < num_events
+    }   // for k < num_karts
+}   // readBinaryData
+
 //-----------------------------------------------------------------------------
 /** Reads all data from a replay file for a specific kart.
  *  \param fd The file descriptor from which to read.
@@ -44,6 +44,7 @@ private:
           ReplayPlay();
          ~ReplayPlay();
     void  readKartData(FILE *fd, char *next_line);
+    void  readBinaryData(FILE *fd);
 public:
     void  init();
     void  update(float dt);
@@ -26,8 +26,10 @@
 #include "tracks/track.hpp"
 
 #include <algorithm>
+#include <math.h>
 #include <stdio.h>
 #include <string>
+#include <zlib.h>
 
 ReplayRecorder *ReplayRecorder::m_replay_recorder = NULL;
 
@@ -67,6 +69,8 @@ void ReplayRecorder::init()
     m_count_transforms.resize(race_manager->getNumberOfKarts(), 0);
     m_last_saved_time.clear();
     m_last_saved_time.resize(race_manager->getNumberOfKarts(), -1.0f);
+    m_pending_transforms.clear();
+    m_pending_transforms.resize(race_manager->getNumberOfKarts());
 
 #ifdef DEBUG
     m_count                       = 0;
@@ -127,34 +131,116 @@ void ReplayRecorder::update(float dt)
             continue;
         }
         m_last_saved_time[i] = time;
-        m_count_transforms[i]++;
-        if(m_count_transforms[i]>=m_transform_events[i].size())
+
+        TransformEvent te;
+        te.m_time = time;
+        te.m_transform.setOrigin(kart->getXYZ());
+        te.m_transform.setRotation(kart->getVisualRotation());
+
+        if(m_count_transforms[i]==0)
         {
-            // Only print this message once.
-            if(m_count_transforms[i]==m_transform_events[i].size())
-            {
-                char buffer[100];
-                sprintf(buffer, "Can't store more events for kart %s.",
-                        kart->getIdent().c_str());
-                Log::warn("ReplayRecorder", buffer);
-            }
+            saveTransform(i, te);
             continue;
         }
-        TransformEvent *p = &(m_transform_events[i][m_count_transforms[i]-1]);
-        p->m_time      = World::getWorld()->getTime();
-        p->m_transform.setOrigin(kart->getXYZ());
-        p->m_transform.setRotation(kart->getVisualRotation());
+        // If the ghost kart can't get from the last saved transform to
+        // this one by interpolation without deviating too much from the
+        // transforms in between, save the last good transform.
+        std::vector<TransformEvent> &pending = m_pending_transforms[i];
+        if(!pending.empty() && !isInterpolationValid(i, te))
+        {
+            saveTransform(i, pending.back());
+            pending.clear();
+        }
+#ifdef DEBUG
+        else if(!pending.empty())
+            m_count_skipped_interpolation++;
+#endif
+        pending.push_back(te);
     }   // for i
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Checks if interpolating (the same way GhostKart does) between the last
+ *  saved transform of a kart and a new transform approximates all
+ *  transforms sampled in between closely enough.
+ *  \param kart_index Index of the kart.
+ *  \param te The new transform.
+ */
+bool ReplayRecorder::isInterpolationValid(unsigned int kart_index,
+                                          const TransformEvent &te) const
+{
+    // The count is one too large if there was no space for more events
+    const std::vector<TransformEvent> &saved = m_transform_events[kart_index];
+    const unsigned int count =
+        std::min(m_count_transforms[kart_index], (unsigned int)saved.size());
+    const TransformEvent &last = saved[count-1];
+    const float dt = te.m_time - last.m_time;
+    if(dt<=0)
+        return false;
+
+    const btQuaternion q0 = last.m_transform.getRotation();
+    const btQuaternion q1 = te.m_transform.getRotation();
+    const std::vector<TransformEvent> &pending =
+                                             m_pending_transforms[kart_index];
+    for(unsigned int i=0; i<pending.size(); i++)
+    {
+        const float f = (pending[i].m_time - last.m_time) / dt;
+        const btVector3 xyz = (1-f) * last.m_transform.getOrigin()
+                            +   f   * te.m_transform.getOrigin();
+        if((xyz-pending[i].m_transform.getOrigin()).length2()
+            > stk_config->m_replay_delta_pos2)
+            return false;
+
+        const btQuaternion q = q0.slerp(q1, f);
+        const float d = fabsf(q.dot(pending[i].m_transform.getRotation()));
+        if(2.0f*acosf(std::min(d, 1.0f)) > stk_config->m_replay_delta_angle)
+            return false;
+    }
+    return true;
+}   // isInterpolationValid
+
+//-----------------------------------------------------------------------------
+/** Adds a transform to the transforms that will be saved for a kart.
+ *  \param kart_index Index of the kart.
+ *  \param te The transform to save.
+ */
+void ReplayRecorder::saveTransform(unsigned int kart_index,
+                                   const TransformEvent &te)
+{
+    unsigned int &count = m_count_transforms[kart_index];
+    if(count>=m_transform_events[kart_index].size())
+    {
+        // Only print this message once.
+        if(count==m_transform_events[kart_index].size())
+        {
+            Log::warn("ReplayRecorder", "Can't store more events for kart %s.",
+                      World::getWorld()->getKart(kart_index)
+                                       ->getIdent().c_str());
+            count++;
+        }
+        return;
+    }
+    m_transform_events[kart_index][count] = te;
+    count++;
+}   // saveTransform
+
 //-----------------------------------------------------------------------------
 /** Saves the replay data stored in the internal data structures.
  */
 void ReplayRecorder::Save()
 {
+    // The last sampled transform of each kart has not been saved yet.
+    for(unsigned int k=0; k<m_pending_transforms.size(); k++)
+    {
+        if(!m_pending_transforms[k].empty())
+            saveTransform(k, m_pending_transforms[k].back());
+        m_pending_transforms[k].clear();
+    }
+
 #ifdef DEBUG
-    printf("%d frames, %d removed because of frequency compression\n",
-           m_count, m_count_skipped_time);
+    printf("%d frames, %d removed because of frequency compression, "
+           "%d because of interpolation\n",
+           m_count, m_count_skipped_time, m_count_skipped_interpolation);
 #endif
     FILE *fd = openReplayFile(/*writeable*/true);
     if(!fd)
@@ -164,45 +250,81 @@ void ReplayRecorder::Save()
         return;
     }
 
-    Log::info("ReplayRecorder", "Replay saved in '%s'.\n", getReplayFilename().c_str());
-
+    // All data is first collected in memory, so that it can be compressed
+    // as a whole. Times, positions and rotations are quantised and stored
+    // as difference to the previous value, which are small numbers that
+    // need only one or two bytes each.
     World *world   = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %d\n",   getReplayVersion());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-    fprintf(fd, "Laps: %d\n",       race_manager->getNumLaps());
+    std::string data;
+    addUInt(&data, race_manager->getDifficulty());
+    addString(&data, world->getTrack()->getIdent());
+    addUInt(&data, race_manager->getNumLaps());
+    addUInt(&data, num_karts);
 
     unsigned int max_frames = (unsigned int)(  stk_config->m_replay_max_time 
                                              / stk_config->m_replay_dt      );
     for(unsigned int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model: %s\n", world->getKart(k)->getIdent().c_str());
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
+        addString(&data, world->getKart(k)->getIdent());
 
         unsigned int num_transforms = std::min(max_frames,
                                                m_count_transforms[k]);
+        addUInt(&data, num_transforms);
+        int previous[8] = {0, 0, 0, 0, 0, 0, 0, 0};
         for(unsigned int i=0; i<num_transforms; i++)
         {
             const TransformEvent *p=&(m_transform_events[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW()
-                );
+            const btVector3    &xyz = p->m_transform.getOrigin();
+            const btQuaternion  q   = p->m_transform.getRotation();
+            addDelta(&data, p->m_time, TIME_SCALE,     &previous[0]);
+            addDelta(&data, xyz.getX(), POSITION_SCALE, &previous[1]);
+            addDelta(&data, xyz.getY(), POSITION_SCALE, &previous[2]);
+            addDelta(&data, xyz.getZ(), POSITION_SCALE, &previous[3]);
+            addDelta(&data, q.getX(),   ROTATION_SCALE, &previous[4]);
+            addDelta(&data, q.getY(),   ROTATION_SCALE, &previous[5]);
+            addDelta(&data, q.getZ(),   ROTATION_SCALE, &previous[6]);
+            addDelta(&data, q.getW(),   ROTATION_SCALE, &previous[7]);
         }   // for i
-        fprintf(fd, "events: %d\n", (int)m_kart_replay_event[k].size());
+
+        addUInt(&data, (unsigned int)m_kart_replay_event[k].size());
+        int previous_time = 0;
         for(unsigned int i=0; i<m_kart_replay_event[k].size(); i++)
         {
             const KartReplayEvent *p=&(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
+            addDelta(&data, p->m_time, TIME_SCALE, &previous_time);
+            addUInt(&data, p->m_type);
         }
     }
+
+    // Only use the compressed data if it is actually smaller
+    unsigned int flags = 0;
+    uLongf compressed_size = compressBound((uLong)data.size());
+    std::string compressed(compressed_size, '\0');
+    if(compress2((Bytef*)&compressed[0], &compressed_size,
+                 (const Bytef*)data.data(), (uLong)data.size(),
+                 Z_BEST_COMPRESSION) == Z_OK                   &&
+       compressed_size < data.size()                                )
+    {
+        flags |= BF_COMPRESSED;
+        compressed.resize(compressed_size);
+    }
+
+    std::string header(BINARY_MAGIC);
+    addUInt(&header, getReplayVersion());
+    addUInt(&header, flags);
+    addUInt(&header, (unsigned int)data.size());
+    const std::string &payload = (flags & BF_COMPRESSED) ? compressed : data;
+    if(fwrite(header.data(),  1, header.size(),  fd) != header.size()  ||
+       fwrite(payload.data(), 1, payload.size(), fd) != payload.size()    )
+    {
+        Log::error("ReplayRecorder", "Error writing '%s'.",
+                   getReplayFilename().c_str());
+    }
+    else
+        Log::info("ReplayRecorder", "Replay saved in '%s' (%d bytes).",
+                  getReplayFilename().c_str(),
+                  (int)(header.size()+payload.size()));
     fclose(fd);
 }   // Save
 
@@ -34,9 +34,15 @@ private:
     /** A separate vector of Replay Events for all transforms. */
     std::vector< std::vector<TransformEvent> > m_transform_events;
 
-    /** Time at which a transform was saved for the last time. */
+    /** Time at which a transform was sampled for the last time. */
     std::vector<float> m_last_saved_time;
 
+    /** For each kart the transforms sampled since the last saved transform.
+     *  A new transform is only saved if interpolating between the last
+     *  saved transform and the current one would miss one of these by
+     *  more than the allowed tolerance. */
+    std::vector< std::vector<TransformEvent> > m_pending_transforms;
+
     /** Counts the number of transform events for each kart. */
     std::vector<unsigned int> m_count_transforms;
 
@@ -62,6 +68,9 @@ private:
 
           ReplayRecorder();
          ~ReplayRecorder();
+    bool  isInterpolationValid(unsigned int kart_index,
+                               const TransformEvent &te) const;
+    void  saveTransform(unsigned int kart_index, const TransformEvent &te);
 public:
     void  init();
     void  update(float dt);
@@ -29,6 +29,12 @@
 #include "states_screens/dialogs/tutorial_message_dialog.hpp"
 #include "tracks/track_object_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/constants.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 
 
 
@@ -68,29 +74,52 @@ ScriptEngine::ScriptEngine()
     // and variables that the script should be able to use.
     configureEngine(m_engine);
 
+    m_enabled = false; // Scripting disabled for now
 }
 ScriptEngine::~ScriptEngine()
 {
+    for (unsigned int i = 0; i < m_free_contexts.size(); i++)
+        m_free_contexts[i]->Release();
     // Release the engine
     m_engine->Release();
 }
 
 
 
+/** Returns the name of the file (without directory and extension) that
+*  contains a script. All triggers are in the same file. Each file is
+*  compiled into a module of the same name.
+*  \param scriptName Name of the script.
+*/
+std::string getScriptFileName(const std::string &scriptName)
+{
+    if (scriptName != "update" && scriptName != "collisions" && scriptName!="start")
+        return "triggers";
+    return scriptName;
+}
+//-----------------------------------------------------------------------------
+/** Returns the name of the file containing a script of the current track.
+*  \param scriptName Name of the script.
+*/
+std::string getScriptFile(const std::string &scriptName)
+{
+    std::string script_dir = file_manager->getAsset(FileManager::SCRIPT, "");
+    script_dir += World::getWorld()->getTrack()->getIdent() + "/";
+    return script_dir + getScriptFileName(scriptName) + ".as";
+}
+//-----------------------------------------------------------------------------
 /** Get Script By it's file name
 *  \param string scriptname = name of script to get
 *  \return      The corresponding script
 */
 std::string getScript(std::string scriptName)
 {
-    std::string script_dir = file_manager->getAsset(FileManager::SCRIPT, "");
-    script_dir += World::getWorld()->getTrack()->getIdent() + "/";
-    if (scriptName != "update" && scriptName != "collisions" && scriptName!="start") scriptName = "triggers";
-    script_dir += scriptName + ".as";
-    FILE *f = fopen(script_dir.c_str(), "rb");
+    std::string script_file = getScriptFile(scriptName);
+    FILE *f = fopen(script_file.c_str(), "rb");
     if( f == 0 )
     {
         std::cout << "Failed to open the script file " + scriptName + ".as" << std::endl;
+        return "";
     }
 
     // Determine the size of the file   
@@ -110,90 +139,113 @@ std::string getScript(std::string scriptName)
     return script;
 }
 //-----------------------------------------------------------------------------
-/** runs the specified script
-*  \param string scriptName = name of script to run
+/** Returns true if the current track has the given script. The result is
+*  cached, so this is cheap enough to be called every frame.
+*  \param script_name Name of the script.
 */
-void ScriptEngine::runScript(std::string scriptName)
+bool ScriptEngine::hasScript(const std::string &script_name)
 {
-    return; // Scripting disabled for now
-
-    // Create a context that will execute the script.
-    asIScriptContext *ctx = m_engine->CreateContext();
-    if (ctx == 0)
-    {
-        std::cout << "Failed to create the context." << std::endl;
-        //m_engine->Release();
-        return;
-    }
-    int r; //int for error checking
-
-
-    asIScriptFunction *func;
-    if (m_script_cache.find(scriptName) == m_script_cache.end())
+    std::map<std::string, bool>::iterator it = m_script_exists.find(script_name);
+    if (it != m_script_exists.end())
+        return it->second;
+    bool exists = file_manager->fileExists(getScriptFile(script_name));
+    m_script_exists[script_name] = exists;
+    return exists;
+}
+//-----------------------------------------------------------------------------
+/** Returns the function to call for a script, compiling the script if
+*  necessary. Also caches if the function does not exist, so that a missing
+*  function does not cause the script to be recompiled each time.
+*  \param script_name Name of the script.
+*  \param cache_name Name under which the function is cached (the collisions
+*         script has a different function for each type of collision).
+*/
+asIScriptFunction* ScriptEngine::getFunction(const std::string &script_name,
+                                             const std::string &cache_name)
+{
+    std::map<std::string, asIScriptFunction*>::iterator it =
+        m_script_cache.find(cache_name);
+    if (it != m_script_cache.end())
+        return it->second;
+
+    asIScriptFunction *func = NULL;
+    // Compile the script code, unless another function of the same file
+    // was already used (recompiling would invalidate its cached function).
+    std::string module_name = getScriptFileName(script_name);
+    asIScriptModule *module = m_engine->GetModule(module_name.c_str(),
+                                                  asGM_ONLY_IF_EXISTS);
+    if (!module && compileScript(m_engine, script_name) >= 0)
+        module = m_engine->GetModule(module_name.c_str(), asGM_ONLY_IF_EXISTS);
+    if (module)
     {
-        // Compile the script code
-        r = compileScript(m_engine, scriptName);
-        if (r < 0)
-        {
-            return;
-        }
-
-        //set line callback here soon
-        if (r < 0)
-        {
-            std::cout << "Failed to set the line callback function." << std::endl;
-            ctx->Release();
-            return;
-        }
-
         // Find the function for the function we want to execute.
         //This is how you call a normal function with arguments
-        //asIScriptFunction *func = engine->GetModule(0)->GetFunctionByDecl("void func(arg1Type, arg2Type)");
-        if (scriptName == "collisions")
+        //asIScriptFunction *func = module->GetFunctionByDecl("void func(arg1Type, arg2Type)");
+        if (script_name == "collisions")
         {
-            func = Scripting::Physics::registerScriptCallbacks(m_engine);
+            func = Scripting::Physics::registerScriptCallbacks(module);
         }
-        else if (scriptName == "update")
+        else if (script_name == "update")
         {
-            func = Scripting::Track::registerUpdateScriptCallbacks(m_engine);
+            func = Scripting::Track::registerUpdateScriptCallbacks(module);
         }
-        else if (scriptName == "start")
+        else if (script_name == "start")
         {
-            func = Scripting::Track::registerStartScriptCallbacks(m_engine);
+            func = Scripting::Track::registerStartScriptCallbacks(module);
         }
         else
         {
             //trigger type can have different names
-            func = Scripting::Track::registerScriptCallbacks(m_engine, scriptName);
+            func = Scripting::Track::registerScriptCallbacks(module, script_name);
         }
         if (func == 0)
         {
             std::cout << "The required function was not found." << std::endl;
-            ctx->Release();
-            //m_engine->Release();
-            return;
         }
-
-        //CACHE UPDATE
-        m_script_cache[scriptName] = func;
     }
-    else
+
+    //CACHE UPDATE
+    m_script_cache[cache_name] = func;
+    return func;
+}
+//-----------------------------------------------------------------------------
+/** Returns a context to execute a script with, reusing a previously
+*  created context if possible.
+*/
+asIScriptContext* ScriptEngine::getContext()
+{
+    if (!m_free_contexts.empty())
     {
-        //Script present in cache
-        func = m_script_cache[scriptName];
-        std::cout << "FOUND CACHED : " << scriptName << std::endl;
+        asIScriptContext *ctx = m_free_contexts.back();
+        m_free_contexts.pop_back();
+        return ctx;
     }
+    asIScriptContext *ctx = m_engine->CreateContext();
+    if (ctx == 0)
+        std::cout << "Failed to create the context." << std::endl;
+    return ctx;
+}
+//-----------------------------------------------------------------------------
+/** Returns a context obtained with getContext() to the pool. */
+void ScriptEngine::releaseContext(asIScriptContext *ctx)
+{
+    ctx->Unprepare();
+    m_free_contexts.push_back(ctx);
+}
+//-----------------------------------------------------------------------------
+/** Executes a script function and reports errors.
+*  \param ctx The context to use.
+*  \param func The function to call.
+*/
+void ScriptEngine::execute(asIScriptContext *ctx, asIScriptFunction *func)
+{
     // Prepare the script context with the function we wish to execute. Prepare()
     // must be called on the context before each new script function that will be
-    // executed. Note, that if because we intend to execute the same function 
-    // several times, we will store the function returned by 
-    // GetFunctionByDecl(), so that this relatively slow call can be skipped.
-    r = ctx->Prepare(func);
+    // executed.
+    int r = ctx->Prepare(func);
     if( r < 0 ) 
     {
         std::cout << "Failed to prepare the context." << std::endl;
-        ctx->Release();
-        //m_engine->Release();
         return;
     }
 
@@ -230,10 +282,53 @@ void ScriptEngine::runScript(std::string scriptName)
         // <type> returnValue = ctx->getReturnType(); for example
         //float returnValue = ctx->GetReturnFloat();
     }
+}
+//-----------------------------------------------------------------------------
+/** runs the specified script
+*  \param string scriptName = name of script to run
+*/
+void ScriptEngine::runScript(std::string scriptName)
+{
+    if (!m_enabled)
+        return;
 
-    // We must release the contexts when no longer using them
-    ctx->Release();
+    asIScriptFunction *func = getFunction(scriptName, scriptName);
+    if (func == 0)
+        return;
 
+    asIScriptContext *ctx = getContext();
+    if (ctx == 0)
+        return;
+    execute(ctx, func);
+    releaseContext(ctx);
+}
+//-----------------------------------------------------------------------------
+/** Reports all collisions of one physics step to the collisions script of
+*  the track. If the track has no collisions script, nothing is done.
+*  \param collisions The collisions of this physics step.
+*/
+void ScriptEngine::runCollisionScripts(
+                const std::vector<Physics::CollisionEvent> &collisions)
+{
+    if (!m_enabled || collisions.empty() || !hasScript("collisions"))
+        return;
+
+    asIScriptContext *ctx = getContext();
+    if (ctx == 0)
+        return;
+    for (unsigned int i = 0; i < collisions.size(); i++)
+    {
+        const Physics::CollisionEvent &c = collisions[i];
+        Scripting::Physics::setCollision(c.m_kart1, c.m_kart2);
+        Scripting::Physics::setCollision(c.m_collider1, c.m_collider2);
+        Scripting::Physics::setCollisionType(c.m_type);
+        // Each type of collision calls a different function
+        asIScriptFunction *func = getFunction("collisions",
+                                              std::string("collisions-") + c.m_type);
+        if (func)
+            execute(ctx, func);
+    }
+    releaseContext(ctx);
 }
 
 
@@ -266,23 +361,128 @@ void ScriptEngine::configureEngine(asIScriptEngine *engine)
 
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+namespace
+{
+    /** A memory stream used to save and load the byte code of a module. */
+    class ByteCodeStream : public asIBinaryStream
+    {
+    private:
+        std::vector<char> m_data;
+        size_t            m_pos;
+        bool              m_error;
+    public:
+        ByteCodeStream() { m_pos = 0; m_error = false; }
+        // --------------------------------------------------------------------
+        virtual void Write(const void *ptr, asUINT size)
+        {
+            m_data.insert(m_data.end(), (const char*)ptr,
+                          (const char*)ptr + size);
+        }   // Write
+        // --------------------------------------------------------------------
+        /** Reading past the end of a truncated file returns zeros, and is
+         *  reported by hasError(). */
+        virtual void Read(void *ptr, asUINT size)
+        {
+            size_t n = std::min<size_t>(size, m_data.size() - m_pos);
+            memcpy(ptr, &m_data[0] + m_pos, n);
+            memset((char*)ptr + n, 0, size - n);
+            m_pos += n;
+            if (n < size)
+                m_error = true;
+        }   // Read
+        // --------------------------------------------------------------------
+        bool hasError() const { return m_error; }
+        // --------------------------------------------------------------------
+        bool load(const std::string &file)
+        {
+            std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+            if (!in.is_open())
+                return false;
+            m_data.assign(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+            m_pos = 0;
+            return !m_data.empty();
+        }   // load
+        // --------------------------------------------------------------------
+        bool save(const std::string &file) const
+        {
+            std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+            if (!out.is_open())
+                return false;
+            out.write(&m_data[0], m_data.size());
+            return !out.fail();
+        }   // save
+    };   // ByteCodeStream
+}   // anonymous namespace
+
+//-----------------------------------------------------------------------------
+/** Returns the name of the file the byte code of a script is cached in. The
+*  name is a hash of the source code and of the versions of AngelScript and
+*  STK (which define the registered functions the byte code refers to), so
+*  a changed script is never loaded from an outdated cache file.
+*  \param script The source code of the script.
+*/
+std::string getByteCodeCacheFile(const std::string &script)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    std::string key = std::string(ANGELSCRIPT_VERSION_STRING) + "/"
+                    + STK_VERSION + "/" + script;
+    for (unsigned int i = 0; i < key.size(); i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }
 
+    std::string dir = file_manager->getCachedTexturesDir() + "scripts/";
+    file_manager->checkAndCreateDirectoryP(dir);
+    char name[32];
+    sprintf(name, "%08x%08x.asbc", (unsigned)(hash >> 32), (unsigned)hash);
+    return dir + name;
+}   // getByteCodeCacheFile
 
+//-----------------------------------------------------------------------------
+/** Compiles a script file into a module named like the file. The byte code
+*  is cached on disk, so a script is only compiled the first time it is
+*  used; afterwards the byte code is loaded, which is much faster.
+*  \param engine The script engine.
+*  \param scriptName Name of a script in the file to compile.
+*  \return 0 on success, a negative value otherwise.
+*/
 int ScriptEngine::compileScript(asIScriptEngine *engine, std::string scriptName)
 {
     int r;
 
     std::string script = getScript(scriptName);
+    if (script.empty())
+        return -1;
+    std::string cache_file = getByteCodeCacheFile(script);
+    asIScriptModule *mod = engine->GetModule(getScriptFileName(scriptName).c_str(),
+                                             asGM_ALWAYS_CREATE);
+    ByteCodeStream cached;
+    if (cached.load(cache_file))
+    {
+        r = mod->LoadByteCode(&cached);
+        if (r >= 0 && !cached.hasError())
+            return 0;
+        // The cache file is unusable, e.g. because the registered
+        // functions changed: compile the script in a fresh module.
+        Log::warn("ScriptEngine", "Ignoring invalid byte code cache '%s'.",
+                  cache_file.c_str());
+        mod = engine->GetModule(getScriptFileName(scriptName).c_str(),
+                                asGM_ALWAYS_CREATE);
+    }
+
     // Add the script sections that will be compiled into executable code.
     // If we want to combine more than one file into the same script, then 
     // we can call AddScriptSection() several times for the same module and
     // the script engine will treat them all as if they were one. The script
     // section name, will allow us to localize any errors in the script code.
-    asIScriptModule *mod = engine->GetModule(0, asGM_ALWAYS_CREATE);
     r = mod->AddScriptSection("script", &script[0], script.size());
     if( r < 0 ) 
     {
         std::cout << "AddScriptSection() failed" << std::endl;
+        engine->DiscardModule(mod->GetName());
         return -1;
     }
     
@@ -294,6 +494,7 @@ int ScriptEngine::compileScript(asIScriptEngine *engine, std::string scriptName)
     if( r < 0 )
     {
         std::cout << "Build() failed" << std::endl;
+        engine->DiscardModule(mod->GetName());
         return -1;
     }
 
@@ -307,8 +508,31 @@ int ScriptEngine::compileScript(asIScriptEngine *engine, std::string scriptName)
     // scope, so function names, and global variables will not conflict with
     // each other.
 
+    ByteCodeStream compiled;
+    if (mod->SaveByteCode(&compiled) < 0 || !compiled.save(cache_file))
+        Log::warn("ScriptEngine", "Could not cache byte code in '%s'.",
+                  cache_file.c_str());
     return 0;
-}
+}   // compileScript
+//-----------------------------------------------------------------------------
+/** Compiles all scripts of the current track, so that no script needs to
+*  be compiled (or loaded from the byte code cache) during the race.
+*  Called once the track is loaded.
+*/
+void ScriptEngine::compileTrackScripts()
+{
+    if (!m_enabled)
+        return;
+
+    const char *files[] = { "start", "update", "collisions", "triggers" };
+    for (unsigned int i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        if (!hasScript(files[i]) ||
+            m_engine->GetModule(files[i], asGM_ONLY_IF_EXISTS))
+            continue;
+        compileScript(m_engine, files[i]);
+    }
+}   // compileTrackScripts
 
 
 
@@ -19,7 +19,9 @@
 #ifndef HEADER_SCRIPT_ENGINE_HPP
 #define HEADER_SCRIPT_ENGINE_HPP
 
+#include <map>
 #include <string>
+#include <vector>
 #include <angelscript.h>
 
 class TrackObjectPresentation;
@@ -29,9 +31,21 @@ namespace Scripting
 
     namespace Physics
     {
+        /** A collision that is reported to the collisions script. */
+        struct CollisionEvent
+        {
+            /** Type of the collision, e.g. "KartKart", which is used to
+             *  find the script function to call. */
+            const char *m_type;
+            /** World ids of the karts involved, if any. */
+            int         m_kart1, m_kart2;
+            /** Names of the objects involved, if any. */
+            std::string m_collider1, m_collider2;
+        };   // CollisionEvent
+
         void registerScriptFunctions(asIScriptEngine *engine);
         asIScriptFunction*
-            registerScriptCallbacks(asIScriptEngine *engine);
+            registerScriptCallbacks(asIScriptModule *module);
         void setCollision(int collider1,int collider2);
         void setCollisionType(std::string collisionType);
         void setCollision(std::string collider1, std::string collider2);
@@ -49,13 +63,13 @@ namespace Scripting
         void registerScriptEnums(asIScriptEngine *engine);
 
         asIScriptFunction*
-            registerScriptCallbacks(asIScriptEngine *engine, std::string scriptName);
+            registerScriptCallbacks(asIScriptModule *module, std::string scriptName);
 
         asIScriptFunction*
-            registerUpdateScriptCallbacks(asIScriptEngine *engine);
+            registerUpdateScriptCallbacks(asIScriptModule *module);
 
         asIScriptFunction*
-            registerStartScriptCallbacks(asIScriptEngine *engine);
+            registerStartScriptCallbacks(asIScriptModule *module);
     }
         
     class ScriptEngine
@@ -65,13 +79,34 @@ namespace Scripting
         ~ScriptEngine();
         
         void runScript(std::string scriptName);
+        void runCollisionScripts(
+                   const std::vector<Physics::CollisionEvent> &collisions);
+        bool hasScript(const std::string &script_name);
+        void compileTrackScripts();
         
     private:
         asIScriptEngine *m_engine;
         std::map<std::string, asIScriptFunction*> m_script_cache;
 
+        /** Caches if the script files of the track exist. */
+        std::map<std::string, bool> m_script_exists;
+
+        /** Contexts that are not in use. Creating a context is expensive,
+         *  so they are reused. More than one context is needed if a script
+         *  runs another script. */
+        std::vector<asIScriptContext*> m_free_contexts;
+
+        /** False while scripting is disabled. */
+        bool m_enabled;
+
         void configureEngine(asIScriptEngine *engine);
         int  compileScript(asIScriptEngine *engine,std::string scriptName);
+        asIScriptFunction* getFunction(const std::string &script_name,
+                                       const std::string &cache_name);
+        asIScriptContext*  getContext();
+        void               releaseContext(asIScriptContext *ctx);
+        void               execute(asIScriptContext *ctx,
+                                   asIScriptFunction *func);
     };   // class ScriptEngine
 
 }
@@ -72,11 +72,11 @@ namespace Scripting
         {
             m_collisionType = collisionType;
         }
-        asIScriptFunction* registerScriptCallbacks(asIScriptEngine *engine)
+        asIScriptFunction* registerScriptCallbacks(asIScriptModule *module)
         {
             asIScriptFunction *func;
             std::string function_name = "void on" + m_collisionType + "Collision()";
-            func = engine->GetModule(0)->GetFunctionByDecl(function_name.c_str());
+            func = module->GetFunctionByDecl(function_name.c_str());
             return func;
         }
         void registerScriptFunctions(asIScriptEngine *engine)
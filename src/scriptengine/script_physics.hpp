@@ -40,7 +40,7 @@ namespace Scripting
         //script engine functions
         void registerScriptFunctions(asIScriptEngine *engine);
         asIScriptFunction* 
-            registerScriptCallbacks(asIScriptEngine *engine);
+            registerScriptCallbacks(asIScriptModule *module);
 
 
         //game engine functions
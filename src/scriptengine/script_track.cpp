@@ -39,23 +39,23 @@ namespace Scripting
     namespace Track
     {
         //register callbacks
-        asIScriptFunction* registerScriptCallbacks(asIScriptEngine *engine, std::string scriptName)
+        asIScriptFunction* registerScriptCallbacks(asIScriptModule *module, std::string scriptName)
         {
             asIScriptFunction *func;
             std::string function_name = "void " + scriptName + "()";
-            func = engine->GetModule(0)->GetFunctionByDecl(function_name.c_str());
+            func = module->GetFunctionByDecl(function_name.c_str());
             return func;
         }
-        asIScriptFunction* registerStartScriptCallbacks(asIScriptEngine *engine)
+        asIScriptFunction* registerStartScriptCallbacks(asIScriptModule *module)
         {
             asIScriptFunction *func;
-            func = engine->GetModule(0)->GetFunctionByDecl("void onStart()");
+            func = module->GetFunctionByDecl("void onStart()");
             return func;
         }
-        asIScriptFunction* registerUpdateScriptCallbacks(asIScriptEngine *engine)
+        asIScriptFunction* registerUpdateScriptCallbacks(asIScriptModule *module)
         {
             asIScriptFunction *func;
-            func = engine->GetModule(0)->GetFunctionByDecl("void onUpdate()");
+            func = module->GetFunctionByDecl("void onUpdate()");
             return func;
         }
         /*
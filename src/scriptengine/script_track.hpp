@@ -32,7 +32,7 @@ namespace Scripting
         //script engine functions
         void registerScriptFunctions(asIScriptEngine *engine);
         asIScriptFunction*
-            registerScriptCallbacks(asIScriptEngine *engine , std::string scriptName);
+            registerScriptCallbacks(asIScriptModule *module , std::string scriptName);
         void registerScriptEnums(asIScriptEngine *engine);
 
 
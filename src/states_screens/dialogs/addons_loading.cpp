@@ -28,11 +28,11 @@
 #include "guiengine/widgets.hpp"
 #include "input/input_manager.hpp"
 #include "io/file_manager.hpp"
+#include "online/http_request.hpp"
 #include "states_screens/addons_screen.hpp"
 #include "states_screens/dialogs/message_dialog.hpp"
 #include "states_screens/dialogs/vote_dialog.hpp"
 #include "states_screens/state_manager.hpp"
-#include "tracks/track_manager.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
@@ -40,6 +40,43 @@ using namespace GUIEngine;
 using namespace Online;
 using namespace irr::gui;
 
+// ----------------------------------------------------------------------------
+/** Downloads the zip file of an addon and then extracts it, still in the
+ *  request manager thread, so that the GUI does not freeze while a big
+ *  addon is unzipped. A failed download is continued on the next attempt.
+ */
+class AddonDownloadRequest : public Online::HTTPRequest
+{
+private:
+    /** The addon to download. */
+    Addon m_addon;
+
+    /** True if the addon was downloaded and extracted successfully. Only
+     *  read by the main thread after the request is done. */
+    bool  m_extracted;
+
+    // ------------------------------------------------------------------------
+    virtual void afterOperation() OVERRIDE
+    {
+        HTTPRequest::afterOperation();
+        m_extracted = !hadDownloadError() && !isCancelled() &&
+                      addons_manager->extract(m_addon);
+    }   // afterOperation
+
+public:
+    AddonDownloadRequest(const Addon &addon, const std::string &save)
+        : HTTPRequest(save, /*manage mem*/false, /*priority*/5)
+    {
+        m_addon     = addon;
+        m_extracted = false;
+        setURL(addon.getZipFileName());
+        setResumeDownload(true);
+    }   // AddonDownloadRequest
+    // ------------------------------------------------------------------------
+    /** Returns true if the addon was extracted after downloading it. */
+    bool isExtracted() const { return m_extracted; }
+};   // AddonDownloadRequest
+
 // ----------------------------------------------------------------------------
 /** Creates a modal dialog with given percentage of screen width and height
 */
@@ -314,9 +351,7 @@ void AddonsLoading::startDownload()
 {
     std::string save   = "tmp/"
                        + StringUtils::getBasename(m_addon.getZipFileName());
-    m_download_request = new Online::HTTPRequest(save, /*manage mem*/false,
-                                                 /*priority*/5);
-    m_download_request->setURL(m_addon.getZipFileName());
+    m_download_request = new AddonDownloadRequest(m_addon, save);
     m_download_request->queue();
 
 }   // startDownload
@@ -346,11 +381,14 @@ void AddonsLoading::stopDownload()
  */
 void AddonsLoading::doInstall()
 {
+    const bool is_extracted = m_download_request->isExtracted();
     delete m_download_request;
     m_download_request = NULL;
 
     assert(!m_addon.isInstalled() || m_addon.needsUpdate());
-    bool error = !addons_manager->install(m_addon);
+    // If the extraction failed in the download thread, try again here to
+    // get the same error handling.
+    bool error = !addons_manager->install(m_addon, is_extracted);
     if(error)
     {
         core::stringw msg = StringUtils::insertValues(
@@ -375,8 +413,6 @@ void AddonsLoading::doInstall()
         AddonsScreen::getInstance()->loadList();
         dismiss();
     }
-
-    track_manager->loadTrackList();
 }   // doInstall
 
 // ----------------------------------------------------------------------------
@@ -26,7 +26,7 @@
 #include "utils/cpp2011.hpp"
 #include "utils/synchronised.hpp"
 
-namespace Online { class HTTPRequest; }
+class AddonDownloadRequest;
 
 /**
   * \ingroup states_screens
@@ -53,7 +53,7 @@ private:
 
     /** A pointer to the download request, which gives access
      *  to the progress of a download. */
-    Online::HTTPRequest *m_download_request;
+    AddonDownloadRequest *m_download_request;
 
 public:
     AddonsLoading(const std::string &addon_name);
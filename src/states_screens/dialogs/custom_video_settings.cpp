@@ -95,7 +95,24 @@ void CustomVideoSettingsDialog::beforeAddingWidgets()
     getWidget<CheckBoxWidget>("ibl")->setState(!UserConfigParams::m_degraded_IBL);
     getWidget<CheckBoxWidget>("global_illumination")->setState(UserConfigParams::m_gi);
     getWidget<CheckBoxWidget>("motionblur")->setState(UserConfigParams::m_motionblur);
-    getWidget<CheckBoxWidget>("mlaa")->setState(UserConfigParams::m_mlaa);
+
+    // The labels are not in the order of AntiAliasingType
+    SpinnerWidget* antialiasing = getWidget<SpinnerWidget>("antialiasing");
+    antialiasing->addLabel(_("Disabled"));    // 0
+    //I18N: anti-aliasing setting, the fastest one
+    antialiasing->addLabel(_("Fast (FXAA)")); // 1
+    antialiasing->addLabel(_("MLAA"));        // 2
+    //I18N: anti-aliasing setting
+    antialiasing->addLabel(_("Temporal"));    // 3
+    if (!UserConfigParams::m_mlaa)
+        antialiasing->setValue(0);
+    else if (UserConfigParams::m_antialiasing_type == AA_FXAA)
+        antialiasing->setValue(1);
+    else if (UserConfigParams::m_antialiasing_type == AA_TEMPORAL)
+        antialiasing->setValue(3);
+    else
+        antialiasing->setValue(2);
+
     getWidget<CheckBoxWidget>("glow")->setState(UserConfigParams::m_glow);
     getWidget<CheckBoxWidget>("ssao")->setState(UserConfigParams::m_ssao);
     getWidget<CheckBoxWidget>("bloom")->setState(UserConfigParams::m_bloom);
@@ -142,8 +159,15 @@ GUIEngine::EventPropagation CustomVideoSettingsDialog::processEvent(const std::s
             UserConfigParams::m_shadows_resolution = 0;
         }
 
-        UserConfigParams::m_mlaa =
-            advanced_pipeline && getWidget<CheckBoxWidget>("mlaa")->getState();
+        const int antialiasing =
+            getWidget<SpinnerWidget>("antialiasing")->getValue();
+        UserConfigParams::m_mlaa = advanced_pipeline && antialiasing > 0;
+        if (antialiasing == 1)
+            UserConfigParams::m_antialiasing_type = AA_FXAA;
+        else if (antialiasing == 2)
+            UserConfigParams::m_antialiasing_type = AA_MLAA;
+        else if (antialiasing == 3)
+            UserConfigParams::m_antialiasing_type = AA_TEMPORAL;
 
         UserConfigParams::m_ssao =
             advanced_pipeline && getWidget<CheckBoxWidget>("ssao")->getState();
@@ -232,7 +256,7 @@ void CustomVideoSettingsDialog::updateActivation()
         getWidget<CheckBoxWidget>("motionblur")->setActivated();
         getWidget<CheckBoxWidget>("dof")->setActivated();
         getWidget<SpinnerWidget>("shadows")->setActivated();
-        getWidget<CheckBoxWidget>("mlaa")->setActivated();
+        getWidget<SpinnerWidget>("antialiasing")->setActivated();
         getWidget<CheckBoxWidget>("ssao")->setActivated();
         getWidget<CheckBoxWidget>("lightshaft")->setActivated();
         getWidget<CheckBoxWidget>("ibl")->setActivated();
@@ -245,7 +269,7 @@ void CustomVideoSettingsDialog::updateActivation()
         getWidget<CheckBoxWidget>("motionblur")->setDeactivated();
         getWidget<CheckBoxWidget>("dof")->setDeactivated();
         getWidget<SpinnerWidget>("shadows")->setDeactivated();
-        getWidget<CheckBoxWidget>("mlaa")->setDeactivated();
+        getWidget<SpinnerWidget>("antialiasing")->setDeactivated();
         getWidget<CheckBoxWidget>("ssao")->setDeactivated();
         getWidget<CheckBoxWidget>("lightshaft")->setDeactivated();
         getWidget<CheckBoxWidget>("ibl")->setDeactivated();
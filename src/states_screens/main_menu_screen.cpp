@@ -74,6 +74,8 @@ bool MainMenuScreen::m_enable_online = false;
 
 MainMenuScreen::MainMenuScreen() : Screen("main.stkgui")
 {
+    // The news are scrolling all the time
+    m_idle_throttle_FPS = false;
 }   // MainMenuScreen
 
 // ----------------------------------------------------------------------------
@@ -180,7 +180,8 @@ void OnlineScreen::doQuickPlay()
         return;
     }
 
-    // select first one
+    // select the closest server, this needs the round trip times
+    ServersManager::get()->waitForPings();
     const Server *server = ServersManager::get()->getQuickPlay();
 
     // do a join request
@@ -105,6 +105,39 @@ static GFXPreset GFX_PRESETS[] =
 
 static const int  GFX_LEVEL_AMOUNT = 5;
 
+// ----------------------------------------------------------------------------
+/** Returns the number of graphics presets. */
+int OptionsScreenVideo::getGfxLevelAmount()
+{
+    return GFX_LEVEL_AMOUNT;
+}   // getGfxLevelAmount
+
+// ----------------------------------------------------------------------------
+/** Changes all settings of a graphics preset.
+ *  \param level The preset, between 0 and GFX_LEVEL_AMOUNT-1.
+ */
+void OptionsScreenVideo::applyGfxPreset(int level)
+{
+    assert(level >= 0 && level < GFX_LEVEL_AMOUNT);
+    UserConfigParams::m_show_steering_animations = GFX_PRESETS[level].animatedCharacters;
+    UserConfigParams::m_graphical_effects = GFX_PRESETS[level].animatedScenery;
+    UserConfigParams::m_anisotropic = GFX_PRESETS[level].anisotropy;
+    UserConfigParams::m_bloom = GFX_PRESETS[level].bloom;
+    UserConfigParams::m_glow = GFX_PRESETS[level].glow;
+    UserConfigParams::m_dynamic_lights = GFX_PRESETS[level].lights;
+    UserConfigParams::m_light_shaft = GFX_PRESETS[level].lightshaft;
+    UserConfigParams::m_mlaa = GFX_PRESETS[level].mlaa;
+    UserConfigParams::m_motionblur = GFX_PRESETS[level].motionblur;
+    //UserConfigParams::m_pixel_shaders = GFX_PRESETS[level].shaders;
+    UserConfigParams::m_shadows_resolution = GFX_PRESETS[level].shadows;
+    UserConfigParams::m_ssao = GFX_PRESETS[level].ssao;
+    UserConfigParams::m_weather_effects = GFX_PRESETS[level].weather;
+    UserConfigParams::m_dof = GFX_PRESETS[level].dof;
+    UserConfigParams::m_gi = GFX_PRESETS[level].global_illumination;
+    UserConfigParams::m_degraded_IBL = GFX_PRESETS[level].degraded_ibl;
+    UserConfigParams::m_high_definition_textures = 0x02 | GFX_PRESETS[level].hd_textures;
+}   // applyGfxPreset
+
 struct Resolution
 {
     int width, height;
@@ -560,24 +593,7 @@ void OptionsScreenVideo::eventCallback(Widget* widget, const std::string& name,
 
         const int level = gfx_level->getValue() - 1;
 
-        UserConfigParams::m_show_steering_animations = GFX_PRESETS[level].animatedCharacters;
-        UserConfigParams::m_graphical_effects = GFX_PRESETS[level].animatedScenery;
-        UserConfigParams::m_anisotropic = GFX_PRESETS[level].anisotropy;
-        UserConfigParams::m_bloom = GFX_PRESETS[level].bloom;
-        UserConfigParams::m_glow = GFX_PRESETS[level].glow;
-        UserConfigParams::m_dynamic_lights = GFX_PRESETS[level].lights;
-        UserConfigParams::m_light_shaft = GFX_PRESETS[level].lightshaft;
-        UserConfigParams::m_mlaa = GFX_PRESETS[level].mlaa;
-        UserConfigParams::m_motionblur = GFX_PRESETS[level].motionblur;
-        //UserConfigParams::m_pixel_shaders = GFX_PRESETS[level].shaders;
-        UserConfigParams::m_shadows_resolution = GFX_PRESETS[level].shadows;
-        UserConfigParams::m_ssao = GFX_PRESETS[level].ssao;
-        UserConfigParams::m_weather_effects = GFX_PRESETS[level].weather;
-        UserConfigParams::m_dof = GFX_PRESETS[level].dof;
-        UserConfigParams::m_gi = GFX_PRESETS[level].global_illumination;
-        UserConfigParams::m_degraded_IBL = GFX_PRESETS[level].degraded_ibl;
-        UserConfigParams::m_high_definition_textures = 0x02 | GFX_PRESETS[level].hd_textures;
-
+        applyGfxPreset(level);
         updateGfxSlider();
     }
     else if (name == "vsync")
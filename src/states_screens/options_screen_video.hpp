@@ -58,6 +58,9 @@ public:
     virtual void unloaded() OVERRIDE;
 
     void         updateGfxSlider();
+
+    static int  getGfxLevelAmount();
+    static void applyGfxPreset(int level);
 };
 
 #endif
@@ -38,6 +38,7 @@ ServerSelection::ServerSelection() : Screen("online/server_selection.stkgui")
 {
     m_selected_index = -1;
     m_refresh_request = NULL;
+    m_waiting_for_pings = false;
 
 }   // ServerSelection
 
@@ -90,6 +91,7 @@ void ServerSelection::beforeAddingWidget()
     m_server_list_widget->clearColumns();
     m_server_list_widget->addColumn( _("Name"), 3 );
     m_server_list_widget->addColumn( _("Players"), 1);
+    m_server_list_widget->addColumn( _("Ping"), 1);
 }
 // ----------------------------------------------------------------------------
 
@@ -121,11 +123,17 @@ void ServerSelection::loadList()
         num_players.append(StringUtils::toWString(server->getCurrentPlayers()));
         num_players.append("/");
         num_players.append(StringUtils::toWString(server->getMaxPlayers()));
+        core::stringw ping = server->getPing() < 0
+                           ? core::stringw("-")
+                           : StringUtils::toWString(server->getPing());
         std::vector<GUIEngine::ListWidget::ListCell> row;
         row.push_back(GUIEngine::ListWidget::ListCell(server->getName(),-1,3));
         row.push_back(GUIEngine::ListWidget::ListCell(num_players,-1,1,true));
+        row.push_back(GUIEngine::ListWidget::ListCell(ping,-1,1,true));
         m_server_list_widget->addItem("server", row);
     }
+    // Show the round trip times once they are measured
+    m_waiting_for_pings = manager->isPinging();
 }   // loadList
 
 // ----------------------------------------------------------------------------
@@ -135,6 +143,7 @@ void ServerSelection::onColumnClicked(int column_id)
     {
         case 0: Server::setSortOrder(Server::SO_NAME); break;
         case 1: Server::setSortOrder(Server::SO_PLAYERS); break;
+        case 2: Server::setSortOrder(Server::SO_PING); break;
         default: assert(0); break;
     }   // switch
     /** \brief Toggle the sort order after column click **/
@@ -216,4 +225,8 @@ void ServerSelection::onUpdate(float dt)
         m_fake_refresh = false;
         m_reload_widget->setActivated();
     }
+    else if (m_waiting_for_pings && !ServersManager::get()->isPinging())
+    {
+        loadList();
+    }
 }   // onUpdate
@@ -53,6 +53,8 @@ private:
 
     const Online::ServersManager::RefreshRequest *    m_refresh_request;
     bool                                        m_fake_refresh;
+    /** True if the list was shown before all round trip times were known. */
+    bool                                        m_waiting_for_pings;
     void refresh();
 
 public:
@@ -155,6 +155,19 @@ bool StateManager::throttleFPS()
            GUIEngine::getCurrentScreen()->throttleFPS();
 }   // throttleFPS
 
+// ----------------------------------------------------------------------------
+/** Returns true if a menu is shown that does not animate anything, and no
+ *  player has done any input for a while. The frame rate is then reduced
+ *  even more than in other menus.
+ */
+bool StateManager::isMenuIdle()
+{
+    return throttleFPS() &&
+           GUIEngine::getCurrentScreen()->idleThrottleFPS() &&
+           GUIEngine::needsUpdate.size() == 0 &&
+           input_manager->getTimeSinceLastInput() > 2.0;
+}   // isMenuIdle
+
 // ----------------------------------------------------------------------------
 
 void StateManager::escapePressed()
@@ -195,6 +195,8 @@ public:
       */
     bool throttleFPS();
 
+    bool isMenuIdle();
+
     /** \brief implementing callback from base class AbstractStateManager */
     void escapePressed();
 
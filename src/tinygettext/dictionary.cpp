@@ -16,17 +16,32 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <assert.h>
+#include <string.h>
+#include <fstream>
+#include <iterator>
 #include "dictionary.hpp"
 
 #include "utils/log.hpp"
 
 namespace tinygettext {
 
+namespace {
+
+const uint32_t COMPILED_MAGIC   = 0x444b5453; // "STKD"
+const uint32_t COMPILED_VERSION = 1;
+
+/** Marks an empty bucket of the hash table. */
+const uint32_t NO_ENTRY         = 0xffffffff;
+
+} // namespace
+
 Dictionary::Dictionary(const std::string& charset_) :
   entries(),
   ctxt_entries(),
+  compiled(),
   charset(charset_),
-  plural_forms()
+  plural_forms(),
+  plural_forms_spec()
 {
     m_has_fallback = false;
 }
@@ -42,9 +57,11 @@ Dictionary::get_charset() const
 }
 
 void
-Dictionary::set_plural_forms(const PluralForms& plural_forms_)
+Dictionary::set_plural_forms(const PluralForms& plural_forms_,
+                             const std::string& spec)
 {
   plural_forms = plural_forms_;
+  plural_forms_spec = spec;
 }
 
 PluralForms
@@ -53,59 +70,268 @@ Dictionary::get_plural_forms() const
   return plural_forms;
 }
 
-std::string
-Dictionary::translate_plural(const std::string& msgid, const std::string& msgid_plural, int num)
+/** FNV-1a hash of the context and msgid, separated by \004 like in .mo
+    files. */
+uint32_t
+Dictionary::hash(const char* msgctxt, const char* msgid)
 {
-  return translate_plural(entries, msgid, msgid_plural, num);
+  uint32_t h = 2166136261u;
+  for (const unsigned char* c = (const unsigned char*)msgctxt; *c; c++)
+    h = (h ^ *c) * 16777619u;
+  h = (h ^ 4) * 16777619u;
+  for (const unsigned char* c = (const unsigned char*)msgid; *c; c++)
+    h = (h ^ *c) * 16777619u;
+  return h;
 }
 
-std::string
-Dictionary::translate_plural(const Entries& dict, const std::string& msgid, const std::string& msgid_plural, int count)
+void
+Dictionary::compile(const std::string& sources)
 {
-  Entries::const_iterator i = dict.find(msgid);
-  const std::vector<std::string>& msgstrs = i->second;
+  struct Item
+  {
+    const std::string* msgctxt;
+    const std::string* msgid;
+    const std::vector<std::string>* msgstrs;
+  };
+  const std::string no_context;
+  std::vector<Item> items;
+  for (Entries::const_iterator i = entries.begin(); i != entries.end(); ++i)
+  {
+    if (i->second.empty())
+      continue;
+    Item item = { &no_context, &i->first, &i->second };
+    items.push_back(item);
+  }
+  for (CtxtEntries::const_iterator c = ctxt_entries.begin(); c != ctxt_entries.end(); ++c)
+  {
+    for (Entries::const_iterator i = c->second.begin(); i != c->second.end(); ++i)
+    {
+      if (i->second.empty())
+        continue;
+      Item item = { &c->first, &i->first, &i->second };
+      items.push_back(item);
+    }
+  }
+
+  // Keep the hash table at most half full, so that probing stays short
+  uint32_t num_buckets = 16;
+  while (num_buckets < 2 * items.size())
+    num_buckets *= 2;
+
+  std::vector<CompiledEntry> buckets(num_buckets);
+  for (unsigned int i = 0; i < num_buckets; i++)
+    buckets[i].msgctxt = NO_ENTRY;
+  std::vector<uint32_t> msgstrs;
+
+  // String offsets are first relative to the start of the string area,
+  // and fixed once the size of the tables is known.
+  std::string strings;
+  const uint32_t plural_forms_offset = (uint32_t)strings.size();
+  strings.append(plural_forms_spec.c_str(), plural_forms_spec.size() + 1);
+  const uint32_t sources_offset = (uint32_t)strings.size();
+  strings.append(sources.c_str(), sources.size() + 1);
 
-  if (i != dict.end())
+  for (unsigned int i = 0; i < items.size(); i++)
   {
-    unsigned int n = 0;
-    n = plural_forms.get_plural(count);
-    assert(/*n >= 0 &&*/ n < msgstrs.size());
+    const Item& item = items[i];
+    uint32_t h = hash(item.msgctxt->c_str(), item.msgid->c_str());
+    uint32_t b = h & (num_buckets - 1);
+    while (buckets[b].msgctxt != NO_ENTRY)
+      b = (b + 1) & (num_buckets - 1);
 
-    if (!msgstrs[n].empty())
-      return msgstrs[n];
-    else
-      if (count == 1) // default to english rules
-        return msgid;
-      else
-        return msgid_plural;
+    CompiledEntry& entry = buckets[b];
+    entry.hash = h;
+    entry.msgctxt = (uint32_t)strings.size();
+    strings.append(item.msgctxt->c_str(), item.msgctxt->size() + 1);
+    entry.msgid = (uint32_t)strings.size();
+    strings.append(item.msgid->c_str(), item.msgid->size() + 1);
+    entry.first_msgstr = (uint32_t)msgstrs.size();
+    entry.num_msgstrs = (uint32_t)item.msgstrs->size();
+    for (unsigned int n = 0; n < item.msgstrs->size(); n++)
+    {
+      msgstrs.push_back((uint32_t)strings.size());
+      const std::string& msgstr = (*item.msgstrs)[n];
+      strings.append(msgstr.c_str(), msgstr.size() + 1);
+    }
+  }
+
+  CompiledHeader header;
+  header.magic        = COMPILED_MAGIC;
+  header.version      = COMPILED_VERSION;
+  header.num_buckets  = num_buckets;
+  header.msgstrs      = (uint32_t)(sizeof(CompiledHeader)
+                      + num_buckets * sizeof(CompiledEntry));
+  header.num_msgstrs  = (uint32_t)msgstrs.size();
+  const uint32_t strings_offset = header.msgstrs
+                                + header.num_msgstrs * sizeof(uint32_t);
+  header.plural_forms = plural_forms_offset + strings_offset;
+  header.sources      = sources_offset + strings_offset;
+
+  for (unsigned int b = 0; b < num_buckets; b++)
+  {
+    if (buckets[b].msgctxt == NO_ENTRY)
+      continue;
+    buckets[b].msgctxt += strings_offset;
+    buckets[b].msgid += strings_offset;
   }
+  for (unsigned int n = 0; n < msgstrs.size(); n++)
+    msgstrs[n] += strings_offset;
+
+  compiled.clear();
+  compiled.reserve(strings_offset + strings.size());
+  compiled.append((const char*)&header, sizeof(header));
+  compiled.append((const char*)&buckets[0], num_buckets * sizeof(CompiledEntry));
+  if (!msgstrs.empty())
+    compiled.append((const char*)&msgstrs[0], msgstrs.size() * sizeof(uint32_t));
+  compiled.append(strings);
+
+  // The maps are not needed anymore
+  entries.clear();
+  ctxt_entries.clear();
+}
+
+bool
+Dictionary::save_compiled(const std::string& filename) const
+{
+  if (compiled.empty())
+    return false;
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!out.is_open())
+    return false;
+  out.write(compiled.data(), compiled.size());
+  return out.good();
+}
+
+bool
+Dictionary::load_compiled(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!in.is_open())
+    return false;
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+
+  // Check that all offsets are inside of the image, so that a damaged file
+  // can not cause a crash
+  const size_t size = data.size();
+  if (size < sizeof(CompiledHeader) || data[size - 1] != '\0')
+    return false;
+  const CompiledHeader* header = (const CompiledHeader*)data.data();
+  if (header->magic != COMPILED_MAGIC || header->version != COMPILED_VERSION ||
+      header->num_buckets == 0 ||
+      (header->num_buckets & (header->num_buckets - 1)) != 0 ||
+      header->msgstrs != sizeof(CompiledHeader)
+                       + header->num_buckets * sizeof(CompiledEntry) ||
+      header->msgstrs + (size_t)header->num_msgstrs * sizeof(uint32_t) > size ||
+      header->plural_forms >= size || header->sources >= size)
+    return false;
+  const CompiledEntry* buckets = (const CompiledEntry*)(header + 1);
+  for (unsigned int b = 0; b < header->num_buckets; b++)
+  {
+    if (buckets[b].msgctxt == NO_ENTRY)
+      continue;
+    if (buckets[b].msgctxt >= size || buckets[b].msgid >= size ||
+        buckets[b].num_msgstrs == 0 ||
+        (size_t)buckets[b].first_msgstr + buckets[b].num_msgstrs > header->num_msgstrs)
+      return false;
+  }
+  const uint32_t* msgstrs = (const uint32_t*)(data.data() + header->msgstrs);
+  for (unsigned int n = 0; n < header->num_msgstrs; n++)
+  {
+    if (msgstrs[n] >= size)
+      return false;
+  }
+
+  compiled.swap(data);
+  entries.clear();
+  ctxt_entries.clear();
+  plural_forms_spec = get_string(header->plural_forms);
+  if (plural_forms_spec.empty())
+    plural_forms = PluralForms();
   else
+    plural_forms = PluralForms::from_string(plural_forms_spec);
+  return true;
+}
+
+bool
+Dictionary::is_compiled_from(const std::string& sources) const
+{
+  if (compiled.empty())
+    return false;
+  const CompiledHeader* header = (const CompiledHeader*)compiled.data();
+  return sources == get_string(header->sources);
+}
+
+const Dictionary::CompiledEntry*
+Dictionary::find(const char* msgctxt, const char* msgid) const
+{
+  if (compiled.empty())
+    return NULL;
+  const CompiledHeader* header = (const CompiledHeader*)compiled.data();
+  const CompiledEntry* buckets = (const CompiledEntry*)(header + 1);
+  const uint32_t h = hash(msgctxt, msgid);
+  const uint32_t mask = header->num_buckets - 1;
+  for (uint32_t b = h & mask; buckets[b].msgctxt != NO_ENTRY; b = (b + 1) & mask)
   {
-    //log_info << "Couldn't translate: " << msgid << std::endl;
-    //log_info << "Candidates: " << std::endl;
-    //for (i = dict.begin(); i != dict.end(); ++i)
-    //  log_info << "'" << i->first << "'" << std::endl;
+    const CompiledEntry* entry = &buckets[b];
+    if (entry->hash == h && strcmp(get_string(entry->msgid), msgid) == 0 &&
+        strcmp(get_string(entry->msgctxt), msgctxt) == 0)
+      return entry;
+  }
+  return NULL;
+}
 
-    if (count == 1) // default to english rules
-      return msgid;
-    else
-      return msgid_plural;
+const char*
+Dictionary::get_msgstr(const CompiledEntry* entry, unsigned int n) const
+{
+  const CompiledHeader* header = (const CompiledHeader*)compiled.data();
+  const uint32_t* msgstrs = (const uint32_t*)(compiled.data() + header->msgstrs);
+  return get_string(msgstrs[entry->first_msgstr + n]);
+}
+
+const char*
+Dictionary::translate_plural(const CompiledEntry* entry, const char* msgid,
+                             const char* msgid_plural, int count) const
+{
+  if (entry)
+  {
+    unsigned int n = plural_forms.get_plural(count);
+    assert(n < entry->num_msgstrs);
+
+    if (n < entry->num_msgstrs)
+    {
+      const char* msgstr = get_msgstr(entry, n);
+      if (msgstr[0] != '\0')
+        return msgstr;
+    }
   }
+  //log_info << "Couldn't translate: " << msgid << std::endl;
+
+  if (count == 1) // default to english rules
+    return msgid;
+  else
+    return msgid_plural;
 }
 
-std::string
-Dictionary::translate(const std::string& msgid)
+const char*
+Dictionary::translate_plural(const char* msgid, const char* msgid_plural, int num) const
 {
-  return translate(entries, msgid);
+  return translate_plural(find("", msgid), msgid, msgid_plural, num);
 }
 
 std::string
-Dictionary::translate(const Entries& dict, const std::string& msgid)
+Dictionary::translate_plural(const std::string& msgid, const std::string& msgid_plural, int num) const
 {
-  Entries::const_iterator i = dict.find(msgid);
-  if (i != dict.end() && !i->second.empty())
+  return translate_plural(msgid.c_str(), msgid_plural.c_str(), num);
+}
+
+const char*
+Dictionary::translate(const char* msgid) const
+{
+  const CompiledEntry* entry = find("", msgid);
+  if (entry)
   {
-    return i->second[0];
+    return get_msgstr(entry, 0);
   }
   else
   {
@@ -117,37 +343,46 @@ Dictionary::translate(const Entries& dict, const std::string& msgid)
 }
 
 std::string
-Dictionary::translate_ctxt(const std::string& msgctxt, const std::string& msgid)
+Dictionary::translate(const std::string& msgid) const
 {
-  CtxtEntries::iterator i = ctxt_entries.find(msgctxt);
-  if (i != ctxt_entries.end())
+  return translate(msgid.c_str());
+}
+
+const char*
+Dictionary::translate_ctxt(const char* msgctxt, const char* msgid) const
+{
+  const CompiledEntry* entry = find(msgctxt, msgid);
+  if (entry)
   {
-    return translate(i->second, msgid);
+    return get_msgstr(entry, 0);
   }
   else
   {
     //log_info << "Couldn't translate: " << msgid << std::endl;
-    return msgid;
+
+    if (m_has_fallback) return m_fallback->translate_ctxt(msgctxt, msgid);
+    else return msgid;
   }
 }
 
+std::string
+Dictionary::translate_ctxt(const std::string& msgctxt, const std::string& msgid) const
+{
+  return translate_ctxt(msgctxt.c_str(), msgid.c_str());
+}
+
+const char*
+Dictionary::translate_ctxt_plural(const char* msgctxt, const char* msgid,
+                                  const char* msgidplural, int num) const
+{
+  return translate_plural(find(msgctxt, msgid), msgid, msgidplural, num);
+}
+
 std::string
 Dictionary::translate_ctxt_plural(const std::string& msgctxt,
-                                  const std::string& msgid, const std::string& msgidplural, int num)
+                                  const std::string& msgid, const std::string& msgidplural, int num) const
 {
-  CtxtEntries::iterator i = ctxt_entries.find(msgctxt);
-  if (i != ctxt_entries.end())
-  {
-    return translate_plural(i->second, msgid, msgidplural, num);
-  }
-  else
-  {
-    //log_info << "Couldn't translate: " << msgid << std::endl;
-    if (num != 1) // default to english
-      return msgidplural;
-    else
-      return msgid;
-  }
+  return translate_ctxt_plural(msgctxt.c_str(), msgid.c_str(), msgidplural.c_str(), num);
 }
 
 void
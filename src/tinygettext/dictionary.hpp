@@ -22,12 +22,20 @@
 #include <vector>
 #include <string>
 #include "plural_forms.hpp"
+#include "utils/types.hpp"
 
 namespace tinygettext {
 
 /** A simple dictionary class that mimics gettext() behaviour. Each
     Dictionary only works for a single language, for managing multiple
-    languages and .po files at once use the DictionaryManager. */
+    languages and .po files at once use the DictionaryManager.
+
+    While a .po file is parsed the translations are collected in maps.
+    compile() then converts them into one binary image (similar to a .mo
+    file): a hash table indexed by context and msgid, followed by all
+    strings. All lookups are done in this image without allocating memory,
+    and the image can be written to and read from a file, so that the .po
+    file does not need to be parsed again at the next start. */
 class Dictionary
 {
 private:
@@ -37,11 +45,50 @@ private:
   typedef std::map<std::string, Entries> CtxtEntries;
   CtxtEntries ctxt_entries;
 
+  /** Header of the compiled image. All offsets are in bytes from the
+      start of the image. */
+  struct CompiledHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    /** Number of buckets of the hash table, a power of two. */
+    uint32_t num_buckets;
+    /** Offset and size of the msgstr offset array. */
+    uint32_t msgstrs;
+    uint32_t num_msgstrs;
+    /** Offset of the Plural-Forms header line. */
+    uint32_t plural_forms;
+    /** Offset of the list of source files, see is_compiled_from(). */
+    uint32_t sources;
+  };
+
+  /** One bucket of the hash table, directly following the header. */
+  struct CompiledEntry
+  {
+    uint32_t hash;
+    /** Offset of the context ("" if none), NO_ENTRY for an empty bucket. */
+    uint32_t msgctxt;
+    uint32_t msgid;
+    /** Index of the first msgstr in the msgstr offset array. */
+    uint32_t first_msgstr;
+    uint32_t num_msgstrs;
+  };
+
+  /** The compiled image. */
+  std::string compiled;
+
   std::string charset;
   PluralForms plural_forms;
 
-  std::string translate(const Entries& dict, const std::string& msgid);
-  std::string translate_plural(const Entries& dict, const std::string& msgid, const std::string& msgidplural, int num);
+  /** The Plural-Forms header the plural forms were created from. */
+  std::string plural_forms_spec;
+
+  static uint32_t hash(const char* msgctxt, const char* msgid);
+  const CompiledEntry* find(const char* msgctxt, const char* msgid) const;
+  const char* get_string(uint32_t offset) const { return compiled.data() + offset; }
+  const char* get_msgstr(const CompiledEntry* entry, unsigned int n) const;
+  const char* translate_plural(const CompiledEntry* entry, const char* msgid,
+                               const char* msgid_plural, int num) const;
 
   bool m_has_fallback;
   Dictionary* m_fallback;
@@ -54,32 +101,53 @@ public:
   /** Return the charset used for this dictionary */
   std::string get_charset() const;
 
-  void set_plural_forms(const PluralForms&);
+  void set_plural_forms(const PluralForms&, const std::string& spec = "");
   PluralForms get_plural_forms() const;
 
+  /** Converts all translations added so far into the compiled image. The
+      \a sources (e.g. the names of the .po files) are stored in the image,
+      so that an outdated compiled file can be detected. */
+  void compile(const std::string& sources);
+
+  /** Writes the compiled image to a file. */
+  bool save_compiled(const std::string& filename) const;
+
+  /** Replaces all translations with the compiled image read from a file.
+      Returns false if the file does not exist or is invalid. */
+  bool load_compiled(const std::string& filename);
+
+  /** Returns true if the compiled image was created from \a sources. */
+  bool is_compiled_from(const std::string& sources) const;
 
-  /** Translate the string \a msgid. */
-  std::string translate(const std::string& msgid);
+  /** Translate the string \a msgid. If there is no translation, \a msgid
+      itself is returned. */
+  const char* translate(const char* msgid) const;
+  std::string translate(const std::string& msgid) const;
 
   /** Translate the string \a msgid to its correct plural form, based
       on the number of items given by \a num. \a msgid_plural is \a msgid in
       plural form. */
-  std::string translate_plural(const std::string& msgid, const std::string& msgidplural, int num);
+  const char* translate_plural(const char* msgid, const char* msgidplural, int num) const;
+  std::string translate_plural(const std::string& msgid, const std::string& msgidplural, int num) const;
 
   /** Translate the string \a msgid that is in context \a msgctx. A
       context is a way to disambiguate msgids that contain the same
       letters, but different meaning. For example "exit" might mean to
       quit doing something or it might refer to a door that leads
       outside (i.e. 'Ausgang' vs 'Beenden' in german) */
-  std::string translate_ctxt(const std::string& msgctxt, const std::string& msgid);
+  const char* translate_ctxt(const char* msgctxt, const char* msgid) const;
+  std::string translate_ctxt(const std::string& msgctxt, const std::string& msgid) const;
 
-  std::string translate_ctxt_plural(const std::string& msgctxt, const std::string& msgid, const std::string& msgidplural, int num);
+  const char* translate_ctxt_plural(const char* msgctxt, const char* msgid,
+                                    const char* msgidplural, int num) const;
+  std::string translate_ctxt_plural(const std::string& msgctxt, const std::string& msgid,
+                                    const std::string& msgidplural, int num) const;
 
   /** Add a translation from \a msgid to \a msgstr to the dictionary,
       where \a msgid is the singular form of the message, msgid_plural the
       plural form and msgstrs a table of translations. The right
       translation will be calculated based on the \a num argument to
-      translate(). */
+      translate(). The translation can only be used after compile(). */
   void add_translation(const std::string& msgid, const std::string& msgid_plural,
                        const std::vector<std::string>& msgstrs);
   void add_translation(const std::string& msgctxt,
@@ -91,38 +159,11 @@ public:
   void add_translation(const std::string& msgid, const std::string& msgstr);
   void add_translation(const std::string& msgctxt, const std::string& msgid, const std::string& msgstr);
 
-  /** Iterate over all messages, Func is of type:
-      void func(const std::string& msgid, const std::vector<std::string>& msgstrs) */
-  template<class Func>
-  Func foreach(Func func)
-  {
-    for(Entries::iterator i = entries.begin(); i != entries.end(); ++i)
-    {
-      func(i->first, i->second);
-    }
-    return func;
-  }
-
   void addFallback(Dictionary* fallback)
   {
       m_has_fallback = true;
       m_fallback = fallback;
   }
-
-  /** Iterate over all messages with a context, Func is of type:
-      void func(const std::string& ctxt, const std::string& msgid, const std::vector<std::string>& msgstrs) */
-  template<class Func>
-  Func foreach_ctxt(Func func)
-  {
-    for(CtxtEntries::iterator i = ctxt_entries.begin(); i != ctxt_entries.end(); ++i)
-    {
-      for(Entries::iterator j = i->second.begin(); j != i->second.end(); ++j)
-      {
-        func(i->first, j->first, j->second);
-      }
-    }
-    return func;
-  }
 };
 
 } // namespace tinygettext
@@ -118,6 +118,7 @@ DictionaryManager::get_dictionary(const Language& language)
 
     dictionaries[language] = dict;
 
+    std::vector<std::string> pofiles;
     for (SearchPath::reverse_iterator p = search_path.rbegin(); p != search_path.rend(); ++p)
     {
       std::vector<std::string> files = filesystem->open_directory(*p);
@@ -152,8 +153,27 @@ DictionaryManager::get_dictionary(const Language& language)
       }
 
       if (!best_filename.empty())
+        pofiles.push_back(*p + "/" + best_filename);
+    }
+
+    // The names of the .po files are stored in the compiled dictionary, so
+    // that it is rebuilt if different files are used.
+    std::string sources;
+    for (unsigned int i = 0; i < pofiles.size(); i++)
+      sources += pofiles[i] + "\n";
+
+    std::string cache_file = filesystem->get_cache_file(language.str());
+    bool cache_valid = !cache_file.empty() && dict->load_compiled(cache_file) &&
+                       dict->is_compiled_from(sources);
+    for (unsigned int i = 0; cache_valid && i < pofiles.size(); i++)
+      cache_valid = !filesystem->is_newer(pofiles[i], cache_file);
+
+    if (!cache_valid)
+    {
+      *dict = Dictionary(charset);
+      for (unsigned int i = 0; i < pofiles.size(); i++)
       {
-        std::string pofile = *p + "/" + best_filename;
+        const std::string& pofile = pofiles[i];
         try
         {
           std::auto_ptr<std::istream> in = filesystem->open_file(pofile);
@@ -173,6 +193,13 @@ DictionaryManager::get_dictionary(const Language& language)
           Log::error("tinygettext", "%s", e.what());
         }
       }
+      dict->compile(sources);
+      if (!cache_file.empty() && !pofiles.empty() &&
+          !dict->save_compiled(cache_file))
+      {
+        Log::warn("tinygettext", "Can not write compiled dictionary '%s'.",
+                  cache_file.c_str());
+      }
     }
 
     if (language.get_country().size() > 0)
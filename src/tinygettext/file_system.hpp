@@ -32,6 +32,14 @@ public:
 
   virtual std::vector<std::string>    open_directory(const std::string& pathname) =0;
   virtual std::auto_ptr<std::istream> open_file(const std::string& filename)      =0;
+
+  /** Returns the file in which the compiled dictionary with the given
+      name is cached, or an empty string if compiled dictionaries are not
+      cached. */
+  virtual std::string get_cache_file(const std::string& name) { return ""; }
+
+  /** Returns true if \a filename was modified after \a cache_file. */
+  virtual bool is_newer(const std::string& filename, const std::string& cache_file) { return true; }
 };
 
 } // namespace tinygettext
@@ -271,7 +271,7 @@ POParser::parse_header(const std::string& header)
         {
           if (!dict.get_plural_forms())
           {
-            dict.set_plural_forms(plural_forms);
+            dict.set_plural_forms(plural_forms, line);
           }
           else
           {
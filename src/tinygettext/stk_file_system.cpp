@@ -50,6 +50,18 @@ StkFileSystem::open_file(const std::string& filename)
   return std::auto_ptr<std::istream>(new std::ifstream(filename.c_str()));
 }
 
+std::string
+StkFileSystem::get_cache_file(const std::string& name)
+{
+  return file_manager->getTranslationCacheLocation(name + ".stkd");
+}
+
+bool
+StkFileSystem::is_newer(const std::string& filename, const std::string& cache_file)
+{
+  return file_manager->fileIsNewer(filename, cache_file);
+}
+
 } // namespace tinygettext
 
 /* EOF */
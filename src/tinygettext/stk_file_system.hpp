@@ -29,6 +29,8 @@ public:
 
   std::vector<std::string>    open_directory(const std::string& pathname);
   std::auto_ptr<std::istream> open_file(const std::string& filename);
+  std::string                 get_cache_file(const std::string& name);
+  bool                        is_newer(const std::string& filename, const std::string& cache_file);
 };
 
 } // namespace tinygettext
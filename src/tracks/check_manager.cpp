@@ -22,6 +22,8 @@
 #include <algorithm>
 
 #include "io/xml_node.hpp"
+#include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
 #include "tracks/ambient_light_sphere.hpp"
 #include "tracks/check_cannon.hpp"
 #include "tracks/check_goal.hpp"
@@ -115,14 +117,78 @@ void CheckManager::reset(const Track &track)
     std::vector<CheckStructure*>::iterator i;
     for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
         (*i)->reset(track);
+
+    World *world = World::getWorld();
+    m_previous_position.clear();
+    m_active_checks.clear();
+    m_active_checks.resize(world->getNumKarts());
+    for(unsigned int k=0; k<world->getNumKarts(); k++)
+    {
+        m_previous_position.push_back(world->getKart(k)->getXYZ());
+        for(unsigned int n=0; n<m_all_checks.size(); n++)
+        {
+            if(m_all_checks[n]->isTriggeredByKarts() &&
+               m_all_checks[n]->isActive(k))
+                m_active_checks[k].push_back(n);
+        }
+    }   // for k<getNumKarts
 }   // reset
 
 // ----------------------------------------------------------------------------
-/** Updates all animations. Called one per time step.
+/** Called from a check structure when it is activated or deactivated for a
+ *  kart, to update the list of active check structures of that kart.
+ *  \param check_index Index of the check structure.
+ *  \param kart_index Index of the kart.
+ *  \param active True if the check structure was activated.
+ */
+void CheckManager::setActive(unsigned int check_index,
+                             unsigned int kart_index, bool active)
+{
+    if(kart_index>=m_active_checks.size())
+        return;
+    std::vector<int> &checks = m_active_checks[kart_index];
+    std::vector<int>::iterator it = std::lower_bound(checks.begin(),
+                                                     checks.end(),
+                                                     (int)check_index);
+    const bool found = it!=checks.end() && *it==(int)check_index;
+    if(active && !found)
+        checks.insert(it, check_index);
+    else if(!active && found)
+        checks.erase(it);
+}   // setActive
+
+// ----------------------------------------------------------------------------
+/** Updates all check structures. Called one per time step. Each kart is only
+ *  tested against the check structures that are active for it, which is
+ *  usually only a few of them.
  *  \param dt Time since last call.
  */
 void CheckManager::update(float dt)
 {
+    World *world = World::getWorld();
+    for(unsigned int k=0; k<m_active_checks.size(); k++)
+    {
+        const AbstractKart *kart = world->getKart(k);
+        if(kart->getKartAnimation()) continue;
+        const Vec3 &xyz = kart->getFrontXYZ();
+        // Triggering a check structure can change the list (e.g. activate
+        // the next check line), so search the next active structure after
+        // each test. This tests the structures in the same order as they
+        // are stored, so a structure activated by an earlier one is still
+        // tested in this time step.
+        const std::vector<int> &checks = m_active_checks[k];
+        int last = -1;
+        while(true)
+        {
+            std::vector<int>::const_iterator it =
+                std::upper_bound(checks.begin(), checks.end(), last);
+            if(it==checks.end()) break;
+            last = *it;
+            m_all_checks[last]->checkKart(k, m_previous_position[k], xyz);
+        }
+        m_previous_position[k] = xyz;
+    }   // for k<num karts
+
     std::vector<CheckStructure*>::iterator i;
     for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
         (*i)->update(dt);
@@ -19,7 +19,9 @@
 #ifndef HEADER_CHECK_MANAGER_HPP
 #define HEADER_CHECK_MANAGER_HPP
 
+#include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
 
 #include <assert.h>
 #include <string>
@@ -28,7 +30,6 @@
 class CheckStructure;
 class Track;
 class XMLNode;
-class Vec3;
 
 /**
   * \brief Controls all checks structures of a track.
@@ -38,6 +39,14 @@ class CheckManager : public NoCopy
 {
 private:
     std::vector<CheckStructure*> m_all_checks;
+
+    /** For each kart the sorted indices of all check structures that are
+     *  active for this kart. Only those are tested for the kart. */
+    std::vector< std::vector<int> > m_active_checks;
+
+    /** The position of each kart in the previous time step. */
+    AlignedArray<Vec3>           m_previous_position;
+
     static CheckManager         *m_check_manager;
            /** Private constructor, to make sure it is only called via
             *  the static create function. */
@@ -47,6 +56,8 @@ public:
     void   load(const XMLNode &node);
     void   update(float dt);
     void   reset(const Track &track);
+    void   setActive(unsigned int check_index, unsigned int kart_index,
+                     bool active);
     unsigned int getLapLineIndex() const;
     int    getChecklineTriggering(const Vec3 &from, const Vec3 &to) const;
     // ------------------------------------------------------------------------
@@ -92,27 +92,39 @@ void CheckStructure::reset(const Track &track)
 }   // reset
 
 // ----------------------------------------------------------------------------
-/** Updates all check structures. Called one per time step.
- *  \param dt Time since last call.
+/** Tests if a kart triggers this check structure, and if so triggers it.
+ *  This is called once per time step by the CheckManager, but only for
+ *  the karts for which this structure is active.
+ *  \param kart_index Index of the kart.
+ *  \param old_pos Position of the kart in the previous time step.
+ *  \param new_pos Position of the kart in this time step.
  */
-void CheckStructure::update(float dt)
+void CheckStructure::checkKart(unsigned int kart_index, const Vec3 &old_pos,
+                               const Vec3 &new_pos)
 {
-    World *world = World::getWorld();
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
-    {
-        const Vec3 &xyz = world->getKart(i)->getFrontXYZ();
-        if(world->getKart(i)->getKartAnimation()) continue;
-        // Only check active checklines.
-        if(m_is_active[i] && isTriggered(m_previous_position[i], xyz, i))
-        {
-            if(UserConfigParams::m_check_debug)
-                Log::info("CheckStructure", "Check structure %d triggered for kart %s.",
-                          m_index, world->getKart(i)->getIdent().c_str());
-            trigger(i);
-        }
-        m_previous_position[i] = xyz;
-    }   // for i<getNumKarts
-}   // update
+    if(!isTriggered(old_pos, new_pos, kart_index))
+        return;
+    if(UserConfigParams::m_check_debug)
+        Log::info("CheckStructure", "Check structure %d triggered for kart %s.",
+                  m_index,
+                  World::getWorld()->getKart(kart_index)->getIdent().c_str());
+    trigger(kart_index);
+}   // checkKart
+
+// ----------------------------------------------------------------------------
+/** Activates or deactivates this check structure for a kart, and updates the
+ *  list of active check structures of the kart in the CheckManager.
+ *  \param kart_index Index of the kart.
+ *  \param active The new state.
+ */
+void CheckStructure::setActive(unsigned int kart_index, bool active)
+{
+    if(m_is_active[kart_index]==active)
+        return;
+    m_is_active[kart_index] = active;
+    if(isTriggeredByKarts())
+        CheckManager::get()->setActive(m_index, kart_index, active);
+}   // setActive
 
 // ----------------------------------------------------------------------------
 /** Changes the status (active/inactive) of all check structures contained
@@ -139,7 +151,7 @@ void CheckStructure::changeStatus(const std::vector<int> &indices,
         switch(change_state)
         {
         case CS_DEACTIVATE:
-            cs->m_is_active[kart_index] = false;
+            cs->setActive(kart_index, false);
             if(UserConfigParams::m_check_debug)
             {
                 Log::info("CheckStructure", "Deactivating %d for %s.",
@@ -148,7 +160,7 @@ void CheckStructure::changeStatus(const std::vector<int> &indices,
             }
             break;
         case CS_ACTIVATE:
-            cs->m_is_active[kart_index] = true;
+            cs->setActive(kart_index, true);
             if(UserConfigParams::m_check_debug)
             {
                 Log::info("CheckStructure", "Activating %d for %s.",
@@ -169,7 +181,7 @@ void CheckStructure::changeStatus(const std::vector<int> &indices,
                           World::getWorld()->getKart(kart_index)->getIdent().c_str(),
                           cs->m_is_active[kart_index]==true);
             }
-            cs->m_is_active[kart_index] = !cs->m_is_active[kart_index];
+            cs->setActive(kart_index, !cs->m_is_active[kart_index]);
         }   // switch
         if(update_debug_colors)
         {
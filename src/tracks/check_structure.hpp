@@ -100,11 +100,18 @@ private:
 
     void changeStatus(const std::vector<int> &indices, int kart_index,
                       ChangeState change_state);
+    void setActive(unsigned int kart_index, bool active);
 
 public:
                 CheckStructure(const XMLNode &node, unsigned int index);
     virtual    ~CheckStructure() {};
-    virtual void update(float dt);
+    // ------------------------------------------------------------------------
+    /** Called once per time step. Testing the karts against this check
+     *  structure is done by the CheckManager (see checkKart), so only
+     *  structures that need additional updates have to implement this. */
+    virtual void update(float dt) {}
+    void         checkKart(unsigned int kart_index, const Vec3 &old_pos,
+                           const Vec3 &new_pos);
     virtual void changeDebugColor(bool is_active) {}
     /** True if going from old_pos to new_pos crosses this checkline. This function
      *  is called from update (of the checkline structure).
@@ -118,6 +125,16 @@ public:
     virtual void trigger(unsigned int kart_index);
     virtual void reset(const Track &track);
 
+    // ------------------------------------------------------------------------
+    /** Returns true if this check structure is triggered by karts. Only
+     *  those are tested for the karts for which they are active. */
+    virtual bool isTriggeredByKarts() const { return true; }
+    // ------------------------------------------------------------------------
+    /** Returns if this check structure is active for the given kart. */
+    bool isActive(unsigned int kart_index) const
+    {
+        return m_is_active[kart_index];
+    }   // isActive
     // ------------------------------------------------------------------------
     /** Returns the type of this check structure. */
     CheckType getType() const { return m_check_type; }
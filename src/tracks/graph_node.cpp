@@ -24,6 +24,8 @@
 #include "tracks/quad_set.hpp"
 #include "utils/log.hpp"
 
+#include <assert.h>
+
 // ----------------------------------------------------------------------------
 /** Constructor. Saves the quad index which belongs to this graph node.
  *  \param index Index of the quad to use for this node (in QuadSet).
@@ -36,6 +38,10 @@ GraphNode::GraphNode(unsigned int quad_index, unsigned int node_index)
     m_quad_index          = quad_index;
     m_node_index          = node_index;
     m_distance_from_start = -1.0f;
+    m_successors          = NULL;
+    m_num_successors      = 0;
+    m_predecessors        = NULL;
+    m_num_predecessors    = 0;
 
     const Quad &quad      = QuadSet::get()->getQuad(m_quad_index);
     // The following values should depend on the actual orientation
@@ -60,6 +66,8 @@ GraphNode::GraphNode(unsigned int quad_index, unsigned int node_index)
         m_lower_center = (quad[0]+quad[1]) * 0.5f;
         m_upper_center = (quad[2]+quad[3]) * 0.5f;
     }
+    m_center      = (m_upper_center + m_lower_center) * 0.5f;
+    m_node_length = (m_lower_center - m_upper_center).length();
     m_line     = core::line2df(m_upper_center.getX(), m_upper_center.getZ(),
                                m_lower_center.getX(), m_lower_center.getZ() );
     // Only this 2d point is needed later
@@ -69,32 +77,24 @@ GraphNode::GraphNode(unsigned int quad_index, unsigned int node_index)
 }   // GraphNode
 
 // ----------------------------------------------------------------------------
-/** Adds a successor to a node. This function will also pre-compute certain
- *  values (like distance from this node to the successor, angle (in world)
- *  between this node and the successor.
- *  \param to The index of the graph node of the successor.
+/** Sets the successor and predecessor data of this node. The data is
+ *  owned by the quad graph, which stores the edges of all nodes in two
+ *  arrays, and computes the distance and angle to each successor.
+ *  \param successors Pointer to the first successor of this node.
+ *  \param num_successors Number of successors.
+ *  \param predecessors Pointer to the first predecessor of this node.
+ *  \param num_predecessors Number of predecessors.
  */
-void GraphNode::addSuccessor(unsigned int to)
+void GraphNode::setEdges(SuccessorInfo *successors,
+                         unsigned int num_successors,
+                         const int *predecessors,
+                         unsigned int num_predecessors)
 {
-    m_successor_nodes.push_back(to);
-    // m_quad_index is the quad index
-    const Quad &this_quad = QuadSet::get()->getQuad(m_quad_index);
-    // to is the graph node
-    GraphNode &gn = QuadGraph::get()->getNode(to);
-    const Quad &next_quad = QuadGraph::get()->getQuadOfNode(to);
-
-    // Note that the first predecessor is (because of the way the quad graph
-    // is exported) the most 'natural' one, i.e. the one on the main
-    // driveline.
-    gn.m_predecessor_nodes.push_back(m_node_index);
-
-    Vec3 d = m_lower_center - QuadGraph::get()->getNode(to).m_lower_center;
-    m_distance_to_next.push_back(d.length());
-
-    Vec3 diff = next_quad.getCenter() - this_quad.getCenter();
-    m_angle_to_next.push_back(atan2(diff.getX(), diff.getZ()));
-
-}   // addSuccessor
+    m_successors       = successors;
+    m_num_successors   = num_successors;
+    m_predecessors     = predecessors;
+    m_num_predecessors = num_predecessors;
+}   // setEdges
 
 // ----------------------------------------------------------------------------
 /** If this node has more than one successor, it will set up a vector that
@@ -103,7 +103,7 @@ void GraphNode::addSuccessor(unsigned int to)
  */
 void GraphNode::setupPathsToNode()
 {
-    if(m_successor_nodes.size()<2) return;
+    if(m_num_successors<2) return;
 
     const unsigned int num_nodes = QuadGraph::get()->getNumNodes();
     m_path_to_node.resize(num_nodes);
@@ -165,13 +165,9 @@ void GraphNode::markAllSuccessorsToUse(unsigned int n,
 void GraphNode::setDirectionData(unsigned int successor, DirectionType dir,
                                  unsigned int last_node_index)
 {
-    if(m_direction.size()<successor+1)
-    {
-        m_direction.resize(successor+1);
-        m_last_index_same_direction.resize(successor+1);
-    }
-    m_direction[successor]                 = dir;
-    m_last_index_same_direction[successor] = last_node_index;
+    assert(successor < m_num_successors);
+    m_successors[successor].m_direction                 = dir;
+    m_successors[successor].m_last_index_same_direction = last_node_index;
 }   // setDirectionData
 
 // ----------------------------------------------------------------------------
@@ -183,7 +179,7 @@ void GraphNode::setDirectionData(unsigned int successor, DirectionType dir,
  *  \param result The X coordinate contains the sidewards distance, the
  *                Z coordinate the forward distance.
  */
-void GraphNode::getDistances(const Vec3 &xyz, Vec3 *result)
+void GraphNode::getDistances(const Vec3 &xyz, Vec3 *result) const
 {
     core::vector2df xyz2d(xyz.getX(), xyz.getZ());
     core::vector2df closest = m_line.getClosestPoint(xyz2d);
@@ -202,7 +198,7 @@ void GraphNode::getDistances(const Vec3 &xyz, Vec3 *result)
  *  quad which belongs to this graph node. The value is computed in 2d only!
  *  \param xyz The point for which the distance to the line is computed.
  */
-float GraphNode::getDistance2FromPoint(const Vec3 &xyz)
+float GraphNode::getDistance2FromPoint(const Vec3 &xyz) const
 {
     core::vector2df xyz2d(xyz.getX(), xyz.getZ());
     core::vector2df closest = m_line.getClosestPoint(xyz2d);
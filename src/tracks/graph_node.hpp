@@ -45,6 +45,23 @@ public:
     enum         DirectionType {DIR_STRAIGHT, DIR_LEFT, DIR_RIGHT,
                                 DIR_UNDEFINED};
 
+    /** All data about the edge from this node to one of its successors. */
+    struct SuccessorInfo
+    {
+        /** Index of the successor graph node. */
+        int           m_node;
+        /** The distance to the successor. */
+        float         m_distance;
+        /** The angle of the line from this node to the successor. */
+        float         m_angle;
+        /** The direction in which the successor is. */
+        DirectionType m_direction;
+        /** The index of the last graph node that has the same direction
+         *  (i.e. if this successor curves left, the index of the last graph
+         *  node that is still turning left). */
+        unsigned int  m_last_index_same_direction;
+    };   // SuccessorInfo
+
 private:
     /** Index of this node in the set of quads. Several graph nodes can use
      *  the same quad, meaning it is possible to use a quad more than once,
@@ -54,17 +71,19 @@ private:
     /** Index of this graph node. */
     unsigned int       m_node_index;
 
-    /** The list of successor graph nodes. */
-    std::vector<int>   m_successor_nodes;
+    /** The successors of this node. The data of all nodes is stored
+     *  contiguously in the quad graph (see QuadGraph::packEdges), so that
+     *  graph walks do not have to follow pointers to separate vectors. */
+    SuccessorInfo     *m_successors;
 
-    /** The list of predecessors of a node. */
-    std::vector<int>   m_predecessor_nodes;
+    /** Number of entries in m_successors. */
+    unsigned int       m_num_successors;
 
-    /** The distance to each of the successors. */
-    std::vector<float> m_distance_to_next;
+    /** The list of predecessors of a node, also stored in the quad graph. */
+    const int         *m_predecessors;
 
-    /** The angle of the line from this node to each neighbour. */
-    std::vector<float> m_angle_to_next;
+    /** Number of entries in m_predecessors. */
+    unsigned int       m_num_predecessors;
 
     /** Distance from the start to the beginning of this quad. */
     float m_distance_from_start;
@@ -90,6 +109,13 @@ private:
      /** A vector from the center of the quad to the right edge. */
      Vec3 m_center_to_right;
 
+     /** Center point of the graph node. */
+     Vec3 m_center;
+
+     /** Length of this node, i.e. the distance between the lower and
+      *  upper center. */
+     float m_node_length;
+
      /** Line between lower and upper center, saves computation in
       *  getDistanceFromLine() later. The line is 2d only since otherwise
       *  taller karts would have a larger distance from the center. It also
@@ -104,15 +130,6 @@ private:
       *  graph nodes.  */
      PathToNodeVector  m_path_to_node;
 
-     /** The direction for each of the successors. */
-     std::vector<DirectionType>  m_direction;
-
-     /** Stores for each successor the index of the last graph node that
-      *  has the same direction (i.e. if index 0 curves left, this vector
-      *  will store the index of the last graph node that is still turning
-      *  left. */
-     std::vector<unsigned int> m_last_index_same_direction;
-
      /** A unit vector pointing from the center to the right side, orthogonal
       *  to the driving direction. */
      Vec3 m_right_unit_vector;
@@ -129,9 +146,12 @@ private:
 
 public:
                  GraphNode(unsigned int quad_index, unsigned int node_index);
-    void         addSuccessor (unsigned int to);
-    void         getDistances(const Vec3 &xyz, Vec3 *result);
-    float        getDistance2FromPoint(const Vec3 &xyz);
+    void         setEdges(SuccessorInfo *successors,
+                          unsigned int num_successors,
+                          const int *predecessors,
+                          unsigned int num_predecessors);
+    void         getDistances(const Vec3 &xyz, Vec3 *result) const;
+    float        getDistance2FromPoint(const Vec3 &xyz) const;
     void         setupPathsToNode();
     void         setChecklineRequirements(int latest_checkline);
     void         setDirectionData(unsigned int successor, DirectionType dir,
@@ -139,20 +159,20 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the number of successors. */
     unsigned int getNumberOfSuccessors() const
-                             { return (unsigned int)m_successor_nodes.size(); }
+                             { return m_num_successors;                     }
     // ------------------------------------------------------------------------
     /** Returns the i-th successor node. */
     unsigned int getSuccessor(unsigned int i)  const
-                               { return m_successor_nodes[i];                 }
+                               { return m_successors[i].m_node;               }
     // ------------------------------------------------------------------------
     /** Returns the number of predecessors. */
     unsigned int getNumberOfPredecessors() const
-                           { return (unsigned int)m_predecessor_nodes.size(); }
+                           { return m_num_predecessors;                       }
     // ------------------------------------------------------------------------
     /** Returns a predecessor for this node. Note that the first predecessor
      *  is the most 'natural' one, i.e. the one on the main driveline.
      */
-    int getPredecessor(unsigned int i) const {return m_predecessor_nodes[i]; }
+    int getPredecessor(unsigned int i) const {return m_predecessors[i];      }
     // ------------------------------------------------------------------------
     /** Returns the quad_index in the quad_set of this node. */
     int          getQuadIndex() const { return m_quad_index;                }
@@ -169,12 +189,12 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the distance to the j-th. successor. */
     float        getDistanceToSuccessor(unsigned int j) const
-                               { return m_distance_to_next[j];           }
+                               { return m_successors[j].m_distance;      }
 
     // ------------------------------------------------------------------------
     /** Returns the angle from this node to the j-th. successor. */
     float        getAngleToSuccessor(unsigned int j) const
-                               { return m_angle_to_next[j];              }
+                               { return m_successors[j].m_angle;         }
     // ------------------------------------------------------------------------
     /** Returns the distance from start. */
     float        getDistanceFromStart() const
@@ -193,32 +213,42 @@ public:
     const Vec3& getUpperCenter() const {return m_upper_center;}
     // ------------------------------------------------------------------------
     /** Returns the center point of this graph node. */
-    const Vec3  getCenter()      const
-                            {return (m_upper_center + m_lower_center) / 2.0f;}
+    const Vec3& getCenter()      const {return m_center;      }
     // ------------------------------------------------------------------------
     /** Returns the length of the quad of this node. */
-    float       getNodeLength() const
-                {return (m_lower_center-m_upper_center).length();}
+    float       getNodeLength() const {return m_node_length;  }
     // ------------------------------------------------------------------------
     /** Returns true if the index-successor of this node is one that the AI
      *  is allowed to use.
      *  \param index Index of the successor. */
     bool        ignoreSuccessorForAI(unsigned int i) const
     {
-        return QuadSet::get()->getQuad(m_successor_nodes[i]).letAIIgnore();
+        return QuadSet::get()->getQuad(m_successors[i].m_node).letAIIgnore();
     };
     // ------------------------------------------------------------------------
     /** Returns which successor node to use in order to be able to reach the
      *  given node n.
      *  \param n Index of the graph node to reach.
      */
-    int getSuccessorToReach(unsigned int n)
+    int getSuccessorToReach(unsigned int n) const
     {
         // If we have a path to node vector, use its information, otherwise
         // (i.e. there is only one successor anyway) use this one successor.
         return m_path_to_node.size()>0 ? m_path_to_node[n] : 0;
     }   // getSuccesorToReach
     // ------------------------------------------------------------------------
+    /** Returns the successor to use to reach each graph node, which is
+     *  empty if this node has only one successor. */
+    const std::vector<int>& getPathsToNode() const { return m_path_to_node; }
+    // ------------------------------------------------------------------------
+    /** Sets the paths-to-node data, e.g. from a cached graph.
+     *  \param paths Successor to use for each graph node.
+     *  \param num_nodes Number of graph nodes. */
+    void setPathsToNode(const int *paths, unsigned int num_nodes)
+    {
+        m_path_to_node.assign(paths, paths + num_nodes);
+    }   // setPathsToNode
+    // ------------------------------------------------------------------------
     /** Returns the checkline requirements of this graph node. */
     const std::vector<int>& getChecklineRequirements() const
                                            { return m_checkline_requirements; }
@@ -227,7 +257,8 @@ public:
     void getDirectionData(unsigned int succ, DirectionType *dir,
                           unsigned int *last) const
     {
-        *dir = m_direction[succ];  *last = m_last_index_same_direction[succ];
+        *dir  = m_successors[succ].m_direction;
+        *last = m_successors[succ].m_last_index_same_direction;
     }
     // ------------------------------------------------------------------------
     /** Returns a unit vector pointing to the right side of the quad. */
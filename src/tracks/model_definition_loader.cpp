@@ -19,6 +19,9 @@
 #include "tracks/model_definition_loader.hpp"
 using namespace irr;
 
+#include "config/user_config.hpp"
+#include "graphics/central_settings.hpp"
+#include "graphics/imposter.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/mesh_tools.hpp"
@@ -54,6 +57,26 @@ void ModelDefinitionLoader::addModelDefinition(const XMLNode* xml)
     m_lod_groups[lodgroup].push_back(ModelDefinition(xml, (int)lod_distance, model_name, false, skeletal_animation));
 }
 
+// ----------------------------------------------------------------------------
+/** Returns if the last level of a LOD group can be drawn as an imposter when
+ *  it is far away. Objects with animated textures can not, and artists can
+ *  disable imposters with imposter="N".
+ *  \param xml The model definition of the level.
+ */
+bool ModelDefinitionLoader::canUseImposter(const XMLNode &xml) const
+{
+    bool imposter = true;
+    xml.get("imposter", &imposter);
+    if (!imposter)
+        return false;
+    for (unsigned int i = 0; i < xml.getNumNodes(); i++)
+    {
+        if (xml.getNode(i)->getName() == "animated-texture")
+            return false;
+    }
+    return true;
+}   // canUseImposter
+
 // ----------------------------------------------------------------------------
 
 LODNode* ModelDefinitionLoader::instanciateAsLOD(const XMLNode* node, scene::ISceneNode* parent)
@@ -70,6 +93,12 @@ LODNode* ModelDefinitionLoader::instanciateAsLOD(const XMLNode* node, scene::ISc
         scene::ISceneNode* actual_parent = (parent == NULL ? sm->getRootSceneNode() : parent);
         LODNode* lod_node = new LODNode(groupname, actual_parent, sm);
         lod_node->updateAbsolutePosition();
+        // Must stay below 0.9, otherwise the randomisation of the LOD
+        // distances could make the mesh level longer than the imposter one
+        const float imposter_ratio = CVS->isGLSL()
+            ? std::min<float>(UserConfigParams::m_imposter_ratio, 0.8f)
+            : 0.0f;
+        int previous_distance = 0;
         for (unsigned int m=0; m<group.size(); m++)
         {
             if (group[m].m_skeletal_animation)
@@ -115,8 +144,25 @@ LODNode* ModelDefinitionLoader::instanciateAsLOD(const XMLNode* node, scene::ISc
 
                 m_track->handleAnimatedTextures(scene_node, *group[m].m_xml);
 
-                lod_node->add(group[m].m_distance, scene_node, true);
+                // The last level is replaced by an imposter when it is far
+                // away, this does not work for animated textures
+                const int distance = group[m].m_distance;
+                const int mesh_distance = (int)(distance * imposter_ratio);
+                if (m + 1 == group.size() && imposter_ratio > 0.0f &&
+                    mesh_distance > previous_distance * 1.1f &&
+                    canUseImposter(*group[m].m_xml))
+                {
+                    ImposterNode *imposter = ImposterNode::create(a_mesh, lod_node);
+                    if (imposter)
+                    {
+                        lod_node->add(mesh_distance, scene_node, true);
+                        lod_node->add(distance, imposter, true);
+                        continue;
+                    }
+                }
+                lod_node->add(distance, scene_node, true);
             }
+            previous_distance = group[m].m_distance;
         }
 
 #ifdef DEBUG
@@ -84,6 +84,8 @@ private:
     std::map< std::string, STKInstancedSceneNode* > m_instancing_nodes;
     Track* m_track;
 
+    bool canUseImposter(const XMLNode &xml) const;
+
 public:
          ModelDefinitionLoader(Track* track);
 
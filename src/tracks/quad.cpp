@@ -18,6 +18,7 @@
 
 #include "tracks/quad.hpp"
 #include "utils/log.hpp"
+#include "utils/simd_math.hpp"
 
 #include <algorithm>
 #include <S3DVertex.h>
@@ -49,9 +50,24 @@ Quad::Quad(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3,
                                std::max(p2.getY(), p3.getY())  );
      m_invisible = invisible;
      m_ai_ignore = ai_ignore;
-
+     updateEdges();
 }   // Quad
 
+// ----------------------------------------------------------------------------
+/** Computes the edge data used by pointInQuad from the four points. */
+void Quad::updateEdges()
+{
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        const Vec3 &start = m_p[i];
+        const Vec3 &end   = m_p[(i+1) % 4];
+        m_edge_x[i]  = start.getX();
+        m_edge_z[i]  = start.getZ();
+        m_edge_dx[i] = end.getX() - start.getX();
+        m_edge_dz[i] = end.getZ() - start.getZ();
+    }
+}   // updateEdges
+
 // ----------------------------------------------------------------------------
 /** Sets the vertices in a irrlicht vertex array to the 4 points of this quad.
  *  \param v The vertex array in which to set the vertices.
@@ -105,6 +121,17 @@ bool Quad::pointInQuad(const Vec3& p) const
     // If a point is exactly on the line of two quads (e.g. between points
     // 0,1 on one quad, and 3,2 of the previous quad), assign this point
     // to be on the 'later' quad, i.e. on the line between points 0 and 1.
+#ifdef STK_SIMD
+    // The side of all four edges at once, computed as in sideOfLine2D
+    using namespace SIMDMath;
+    const Float4 side = load(m_edge_dx) * (splat(p.getZ()) - load(m_edge_z))
+                      - load(m_edge_dz) * (splat(p.getX()) - load(m_edge_x));
+    const int ge = greaterEqualMask(side, splat(0.0f));
+    if(p.sideOfLine2D(m_p[0], m_p[2])<0)
+        return (ge & 3) == 3;
+    const int gt = greaterMask(side, splat(0.0f));
+    return (gt & 4) && (ge & 8);
+#else
     if(p.sideOfLine2D(m_p[0], m_p[2])<0) {
         return p.sideOfLine2D(m_p[0], m_p[1]) >= 0.0 &&
                p.sideOfLine2D(m_p[1], m_p[2]) >= 0.0;
@@ -112,6 +139,7 @@ bool Quad::pointInQuad(const Vec3& p) const
         return p.sideOfLine2D(m_p[2], m_p[3]) >  0.0 &&
                p.sideOfLine2D(m_p[3], m_p[0]) >= 0.0;
     }
+#endif
 }   // pointInQuad
 
 // ----------------------------------------------------------------------------
@@ -133,5 +161,6 @@ void Quad::transform(const btTransform &t, Quad *result) const
                                                result->m_p[1].getY()),
                                       std::min(result->m_p[2].getY(),
                                                result->m_p[3].getY())  );
+    result->updateEdges();
 }   // transform
 
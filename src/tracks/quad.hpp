@@ -57,6 +57,13 @@ private:
     /** Set if this quad should not be used by the AI. */
     bool  m_ai_ignore;
 
+    /** The x and z coordinates of the start point and the direction of the
+     *  four edges 0-1, 1-2, 2-3 and 3-0, so that pointInQuad can test all
+     *  edges at once. */
+    float m_edge_x[4], m_edge_z[4], m_edge_dx[4], m_edge_dz[4];
+
+    void updateEdges();
+
 public:
          Quad(const Vec3 &p0, const Vec3 &p1, const Vec3 &p2, const Vec3 &p3,
               bool invis=false, bool ai_ignore=false);
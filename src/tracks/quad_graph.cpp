@@ -30,6 +30,7 @@
 #include "graphics/shaders.hpp"
 #include "graphics/rtts.hpp"
 #include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
 #include "io/xml_node.hpp"
 #include "modes/world.hpp"
 #include "tracks/check_lap.hpp"
@@ -38,6 +39,12 @@
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
 #include "graphics/glwrap.hpp"
+#include "utils/load_profiler.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <algorithm>
+#include <fstream>
 
 const int QuadGraph::UNKNOWN_SECTOR  = -1;
 QuadGraph *QuadGraph::m_quad_graph = NULL;
@@ -59,8 +66,16 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     QuadSet::create();
     QuadSet::get()->init(quad_file_name);
     m_quad_filename        = quad_file_name;
+    m_graph_filename       = graph_file_name;
     m_quad_graph           = this;
-    load(graph_file_name);
+    const std::string cache_file = getGraphCacheFile();
+    if(!loadGraphCache(cache_file))
+    {
+        load(graph_file_name);
+        setupPaths();
+        buildGrid();
+        saveGraphCache(cache_file);
+    }
 }   // QuadGraph
 
 // -----------------------------------------------------------------------------
@@ -68,9 +83,6 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
 QuadGraph::~QuadGraph()
 {
     QuadSet::destroy();
-    for(unsigned int i=0; i<m_all_nodes.size(); i++) {
-        delete m_all_nodes[i];
-    }
     if(UserConfigParams::m_track_debug)
         cleanupDebugMesh();
     if (m_new_rtt != NULL)
@@ -79,13 +91,245 @@ QuadGraph::~QuadGraph()
 
 // -----------------------------------------------------------------------------
 
-void QuadGraph::addSuccessor(unsigned int from, unsigned int to) {
+/** Adds an edge to the graph. The edges are only collected here, they are
+ *  stored in the graph nodes by packEdges() once all edges are known.
+ *  \param from Index of the graph node the edge starts at.
+ *  \param to Index of the graph node the edge ends at.
+ */
+void QuadGraph::addSuccessor(unsigned int from, unsigned int to)
+{
     if(m_reverse)
-        m_all_nodes[to]->addSuccessor(from);
+        m_edge_list.push_back(std::make_pair(to, from));
     else
-        m_all_nodes[from]->addSuccessor(to);
+        m_edge_list.push_back(std::make_pair(from, to));
 }   // addSuccessor
 
+// -----------------------------------------------------------------------------
+/** Stores all edges collected by addSuccessor in two arrays sorted by node:
+ *  the successors (together with the distance and angle to each successor)
+ *  and the predecessors. Each graph node then only points to its part of
+ *  these arrays. The order of the edges of a node is the order in which
+ *  they were added, so that successor and predecessor 0 are still the ones
+ *  on the main driveline.
+ */
+void QuadGraph::packEdges()
+{
+    const unsigned int num_nodes = (unsigned int)m_all_nodes.size();
+    std::vector<unsigned int> first_succ(num_nodes+1, 0);
+    std::vector<unsigned int> first_pred(num_nodes+1, 0);
+    for(unsigned int i=0; i<m_edge_list.size(); i++)
+    {
+        first_succ[m_edge_list[i].first +1]++;
+        first_pred[m_edge_list[i].second+1]++;
+    }
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        first_succ[i+1] += first_succ[i];
+        first_pred[i+1] += first_pred[i];
+    }
+
+    m_all_successors.resize(m_edge_list.size());
+    m_all_predecessors.resize(m_edge_list.size());
+    std::vector<unsigned int> num_succ(num_nodes, 0);
+    std::vector<unsigned int> num_pred(num_nodes, 0);
+    for(unsigned int i=0; i<m_edge_list.size(); i++)
+    {
+        const unsigned int from = m_edge_list[i].first;
+        const unsigned int to   = m_edge_list[i].second;
+        const GraphNode &from_node = m_all_nodes[from];
+        const GraphNode &to_node   = m_all_nodes[to];
+
+        GraphNode::SuccessorInfo &succ =
+            m_all_successors[first_succ[from] + num_succ[from]++];
+        succ.m_node     = to;
+        succ.m_distance = (from_node.getLowerCenter()
+                           - to_node.getLowerCenter()).length();
+        Vec3 diff = getQuadOfNode(to).getCenter()
+                  - getQuadOfNode(from).getCenter();
+        succ.m_angle    = atan2(diff.getX(), diff.getZ());
+        succ.m_direction                 = GraphNode::DIR_UNDEFINED;
+        succ.m_last_index_same_direction = to;
+
+        m_all_predecessors[first_pred[to] + num_pred[to]++] = from;
+    }
+
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        m_all_nodes[i].setEdges(
+            num_succ[i] ? &m_all_successors[first_succ[i]]   : NULL,
+            num_succ[i],
+            num_pred[i] ? &m_all_predecessors[first_pred[i]] : NULL,
+            num_pred[i]);
+    }
+    m_edge_list.clear();
+}   // packEdges
+
+// -----------------------------------------------------------------------------
+/** Creates the grid used to find the nodes close to a point. The cell size
+ *  is chosen so that there is roughly one cell per node.
+ */
+void QuadGraph::buildGrid()
+{
+    m_grid_start.clear();
+    m_grid_nodes.clear();
+    m_grid_min_x = m_grid_min_z = 0;
+    m_grid_cell_size = 1.0f;
+    m_grid_width = m_grid_height = 0;
+    if(m_all_nodes.empty())
+        return;
+
+    // Determine the 2d bounding box of all quads
+    std::vector<core::rectf> boxes;
+    core::rectf all;
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        core::rectf box(q[0].getX(), q[0].getZ(), q[0].getX(), q[0].getZ());
+        for(unsigned int j=1; j<4; j++)
+            box.addInternalPoint(q[j].getX(), q[j].getZ());
+        boxes.push_back(box);
+        if(i==0)
+            all = box;
+        else
+        {
+            all.addInternalPoint(box.UpperLeftCorner);
+            all.addInternalPoint(box.LowerRightCorner);
+        }
+    }
+
+    const float width  = all.getWidth();
+    const float height = all.getHeight();
+    m_grid_cell_size = sqrtf(width*height / m_all_nodes.size());
+    // Avoid tiny cells for graphs that are (nearly) a straight line, and
+    // limit the size of the grid.
+    m_grid_cell_size = std::max(m_grid_cell_size, 1.0f);
+    m_grid_cell_size = std::max(m_grid_cell_size,
+                                std::max(width, height) / 1024.0f);
+    m_grid_min_x  = all.UpperLeftCorner.X;
+    m_grid_min_z  = all.UpperLeftCorner.Y;
+    m_grid_width  = (int)(width  / m_grid_cell_size) + 1;
+    m_grid_height = (int)(height / m_grid_cell_size) + 1;
+    const unsigned int num_cells = m_grid_width * m_grid_height;
+
+    // First count the nodes in each cell, then store them
+    std::vector<unsigned int> count(num_cells, 0);
+    for(int pass=0; pass<2; pass++)
+    {
+        for(unsigned int i=0; i<boxes.size(); i++)
+        {
+            int x0, z0, x1, z1;
+            getGridCell(boxes[i].UpperLeftCorner.X,
+                        boxes[i].UpperLeftCorner.Y,  &x0, &z0);
+            getGridCell(boxes[i].LowerRightCorner.X,
+                        boxes[i].LowerRightCorner.Y, &x1, &z1);
+            for(int z=z0; z<=z1; z++)
+            {
+                for(int x=x0; x<=x1; x++)
+                {
+                    const unsigned int cell = z*m_grid_width + x;
+                    if(pass==0)
+                        count[cell]++;
+                    else
+                        m_grid_nodes[m_grid_start[cell] + count[cell]++] = i;
+                }
+            }
+        }
+        if(pass==0)
+        {
+            m_grid_start.resize(num_cells+1);
+            m_grid_start[0] = 0;
+            for(unsigned int c=0; c<num_cells; c++)
+            {
+                m_grid_start[c+1] = m_grid_start[c] + count[c];
+                count[c] = 0;
+            }
+            m_grid_nodes.resize(m_grid_start[num_cells]);
+        }
+    }
+}   // buildGrid
+
+// -----------------------------------------------------------------------------
+/** Returns the grid cell that contains a point. Points outside of the grid
+ *  are mapped to the closest cell at the border of the grid.
+ *  \param x, z The coordinates of the point.
+ *  \param cell_x, cell_z On return the cell.
+ */
+void QuadGraph::getGridCell(float x, float z, int *cell_x, int *cell_z) const
+{
+    *cell_x = (int)floorf((x - m_grid_min_x) / m_grid_cell_size);
+    *cell_z = (int)floorf((z - m_grid_min_z) / m_grid_cell_size);
+    *cell_x = core::clamp(*cell_x, 0, m_grid_width  - 1);
+    *cell_z = core::clamp(*cell_z, 0, m_grid_height - 1);
+}   // getGridCell
+
+// -----------------------------------------------------------------------------
+/** Returns the node whose center line is closest (in 2d) to a point, using
+ *  the grid: rings of cells around the point are searched until no unseen
+ *  cell can contain a closer node.
+ *  \param xyz The point.
+ *  \param test_height If true, only nodes at most 5 below and 1 above the
+ *         point are considered.
+ *  
+eturn The closest node, or UNKNOWN_SECTOR.
+ */
+int QuadGraph::findClosestNode(const Vec3 &xyz, bool test_height) const
+{
+    int min_sector   = UNKNOWN_SECTOR;
+    float min_dist_2 = 999999.0f*999999.0f;
+    if(m_grid_start.empty())
+        return min_sector;
+
+    int cx, cz;
+    getGridCell(xyz.getX(), xyz.getZ(), &cx, &cz);
+    for(int r=0; ; r++)
+    {
+        const int x0 = cx-r, x1 = cx+r, z0 = cz-r, z1 = cz+r;
+        for(int z=std::max(z0, 0); z<=std::min(z1, m_grid_height-1); z++)
+        {
+            for(int x=std::max(x0, 0); x<=std::min(x1, m_grid_width-1); x++)
+            {
+                // Only the cells on the border of the ring are new
+                if(z!=z0 && z!=z1 && x!=x0 && x!=x1) continue;
+                const unsigned int cell = z*m_grid_width + x;
+                for(unsigned int i=m_grid_start[cell];
+                    i<m_grid_start[cell+1]; i++)
+                {
+                    const int n = m_grid_nodes[i];
+                    float dist_2 = m_all_nodes[n].getDistance2FromPoint(xyz);
+                    if(dist_2>=min_dist_2) continue;
+                    // While negative distances are unlikely, we allow some
+                    // small negative numbers in case that the kart is partly
+                    // in the track.
+                    float dist = xyz.getY() - getQuadOfNode(n).getMinHeight();
+                    if(!test_height || (dist < 5.0f && dist>-1.0f) )
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = n;
+                    }
+                }   // for i in cell
+            }   // for x
+        }   // for z
+
+        // Any node not seen yet is outside of the square of cells tested
+        // so far. Determine the minimum distance to any such cell (sides
+        // of the square at the border of the grid have no more cells).
+        float bound = 999999.0f;
+        if(x0>0)
+            bound = std::min(bound, xyz.getX() - (m_grid_min_x + x0*m_grid_cell_size));
+        if(x1<m_grid_width-1)
+            bound = std::min(bound, m_grid_min_x + (x1+1)*m_grid_cell_size - xyz.getX());
+        if(z0>0)
+            bound = std::min(bound, xyz.getZ() - (m_grid_min_z + z0*m_grid_cell_size));
+        if(z1<m_grid_height-1)
+            bound = std::min(bound, m_grid_min_z + (z1+1)*m_grid_cell_size - xyz.getZ());
+        if(bound==999999.0f)
+            break;   // all cells tested
+        if(bound>0 && bound*bound > min_dist_2)
+            break;
+    }   // for r
+    return min_sector;
+}   // findClosestNode
+
 // -----------------------------------------------------------------------------
 /** Loads a quad graph from a file.
  *  \param filename Name of the file to load.
@@ -100,15 +344,16 @@ void QuadGraph::load(const std::string &filename)
         // i.e. each quad is part of the graph exactly once.
         // First create an empty graph node for each quad:
         for(unsigned int i=0; i<QuadSet::get()->getNumberOfQuads(); i++)
-            m_all_nodes.push_back(new GraphNode(i, (unsigned int) m_all_nodes.size()));
+            m_all_nodes.push_back(GraphNode(i, (unsigned int) m_all_nodes.size()));
         // Then set the default loop:
         setDefaultSuccessors();
+        packEdges();
         computeDirectionData();
 
         if (m_all_nodes.size() > 0)
         {
-            m_lap_length = m_all_nodes[m_all_nodes.size()-1]->getDistanceFromStart()
-                         + m_all_nodes[m_all_nodes.size()-1]->getDistanceToSuccessor(0);
+            m_lap_length = m_all_nodes[m_all_nodes.size()-1].getDistanceFromStart()
+                         + m_all_nodes[m_all_nodes.size()-1].getDistanceToSuccessor(0);
         }
         else
         {
@@ -134,7 +379,7 @@ void QuadGraph::load(const std::string &filename)
             xml_node->get("to-quad", &to);
             for(unsigned int i=from; i<=to; i++)
             {
-                m_all_nodes.push_back(new GraphNode(i, (unsigned int) m_all_nodes.size()));
+                m_all_nodes.push_back(GraphNode(i, (unsigned int) m_all_nodes.size()));
             }
         }
         else if(xml_node->getName()=="node")
@@ -142,7 +387,7 @@ void QuadGraph::load(const std::string &filename)
             // A single quad is connected to a single graph node.
             unsigned int id;
             xml_node->get("quad", &id);
-            m_all_nodes.push_back(new GraphNode(id, (unsigned int) m_all_nodes.size()));
+            m_all_nodes.push_back(GraphNode(id, (unsigned int) m_all_nodes.size()));
         }
 
         // Then the definition of edges between the graph nodes:
@@ -157,7 +402,7 @@ void QuadGraph::load(const std::string &filename)
             {
                 assert(i!=to ? i+1 : from <m_all_nodes.size());
                 addSuccessor(i,(i!=to ? i+1 : from));
-                //~ m_all_nodes[i]->addSuccessor(i!=to ? i+1 : from);
+                //~ m_all_nodes[i].addSuccessor(i!=to ? i+1 : from);
             }
         }
         else if(xml_node->getName()=="edge-line")
@@ -169,7 +414,7 @@ void QuadGraph::load(const std::string &filename)
             for(unsigned int i=from; i<to; i++)
             {
                 addSuccessor(i,i+1);
-                //~ m_all_nodes[i]->addSuccessor(i+1);
+                //~ m_all_nodes[i].addSuccessor(i+1);
             }
         }
         else if(xml_node->getName()=="edge")
@@ -180,7 +425,7 @@ void QuadGraph::load(const std::string &filename)
             xml_node->get("to", &to);
             assert(to<m_all_nodes.size());
             addSuccessor(from,to);
-            //~ m_all_nodes[from]->addSuccessor(to);
+            //~ m_all_nodes[from].addSuccessor(to);
         }   // edge
         else
         {
@@ -192,6 +437,7 @@ void QuadGraph::load(const std::string &filename)
     delete xml;
 
     setDefaultSuccessors();
+    packEdges();
     computeDistanceFromStart(getStartNode(), 0.0f);
     computeDirectionData();
 
@@ -200,13 +446,265 @@ void QuadGraph::load(const std::string &filename)
     m_lap_length = -1;
     for(unsigned int i=0; i<m_all_nodes.size(); i++)
     {
-        float l = m_all_nodes[i]->getDistanceFromStart()
-                + m_all_nodes[i]->getDistanceToSuccessor(0);
+        float l = m_all_nodes[i].getDistanceFromStart()
+                + m_all_nodes[i].getDistanceToSuccessor(0);
         if(l > m_lap_length)
             m_lap_length = l;
     }
 }   // load
 
+// ============================================================================
+namespace
+{
+    /** Must be increased whenever the layout of a cached graph (or the data
+     *  computed from the graph file) changes. */
+    const uint32_t GRAPH_CACHE_VERSION = 1;
+
+    /** The header of a cached graph. It is followed by the nodes, the
+     *  successors (as SuccessorInfo), the predecessors, the paths-to-node
+     *  of all nodes with more than one successor, the start index of each
+     *  grid cell and the nodes of all grid cells. */
+    struct GraphCacheHeader
+    {
+        /** Modification times of the quad and graph file the cache was
+         *  created from. */
+        int64_t  m_quad_time, m_graph_time;
+        uint32_t m_version;
+        uint32_t m_reverse;
+        uint32_t m_num_quads;
+        uint32_t m_num_nodes;
+        uint32_t m_num_edges;
+        uint32_t m_num_paths;
+        uint32_t m_grid_width, m_grid_height;
+        uint32_t m_num_grid_nodes;
+        float    m_lap_length;
+        float    m_grid_min_x, m_grid_min_z, m_grid_cell_size;
+    };   // GraphCacheHeader
+
+    struct GraphCacheNode
+    {
+        uint32_t m_quad_index;
+        uint32_t m_num_successors;
+        uint32_t m_num_predecessors;
+        float    m_distance_from_start;
+    };   // GraphCacheNode
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Returns the name of the cached graph for this track and direction. */
+std::string QuadGraph::getGraphCacheFile() const
+{
+    std::string track_dir = StringUtils::getPath(m_quad_filename);
+    if (StringUtils::hasSuffix(track_dir, "/"))
+        track_dir = track_dir.substr(0, track_dir.size() - 1);
+    // A track can use different quad and graph files in different modes
+    std::string name = StringUtils::getBasename(track_dir) + "-"
+       + StringUtils::removeExtension(StringUtils::getBasename(m_quad_filename))
+       + "-"
+       + StringUtils::removeExtension(StringUtils::getBasename(m_graph_filename))
+       + (m_reverse ? "-reverse.graph" : ".graph");
+    return file_manager->getGraphCacheLocation(name);
+}   // getGraphCacheFile
+
+// ----------------------------------------------------------------------------
+/** Loads the data computed from the graph file (the edges with distances
+ *  and directions, the distances from start, the paths-to-node and the
+ *  grid) from a file written by saveGraphCache. The file is mapped, and
+ *  it is only used if it was created from the current quad and graph file
+ *  with the same version of the cache format.
+ *  \param cache_file Name of the cached graph.
+ *  \return True if the graph was loaded.
+ */
+bool QuadGraph::loadGraphCache(const std::string &cache_file)
+{
+    MappedFile file(cache_file);
+    if(!file.isValid() || file.getSize() < sizeof(GraphCacheHeader))
+        return false;
+    LoadProfiler::addBytes(LoadProfiler::STAGE_QUAD_GRAPH, file.getSize());
+    const GraphCacheHeader *header = (const GraphCacheHeader*)file.getData();
+    const unsigned int num_nodes = header->m_num_nodes;
+    const unsigned int num_edges = header->m_num_edges;
+    const unsigned int num_cells = header->m_grid_width*header->m_grid_height;
+    if(header->m_version    != GRAPH_CACHE_VERSION                         ||
+       header->m_reverse    != (m_reverse ? 1u : 0u)                       ||
+       header->m_num_quads  != QuadSet::get()->getNumberOfQuads()          ||
+       header->m_quad_time  != file_manager->getModificationTime(m_quad_filename) ||
+       header->m_graph_time != file_manager->getModificationTime(m_graph_filename)||
+       num_nodes == 0 || header->m_num_paths > num_nodes                   ||
+       header->m_grid_width  == 0 || header->m_grid_width  > 1025          ||
+       header->m_grid_height == 0 || header->m_grid_height > 1025          ||
+       header->m_grid_cell_size <= 0)
+        return false;
+    const size_t size = sizeof(GraphCacheHeader)
+                      + num_nodes * sizeof(GraphCacheNode)
+                      + num_edges * sizeof(GraphNode::SuccessorInfo)
+                      + num_edges * sizeof(int)
+                      + (size_t)header->m_num_paths * num_nodes * sizeof(int)
+                      + (num_cells + 1) * sizeof(unsigned int)
+                      + header->m_num_grid_nodes * sizeof(int);
+    if(file.getSize() != size)
+        return false;
+
+    const GraphCacheNode *nodes = (const GraphCacheNode*)(header + 1);
+    const GraphNode::SuccessorInfo *successors =
+        (const GraphNode::SuccessorInfo*)(nodes + num_nodes);
+    const int *predecessors = (const int*)(successors + num_edges);
+    const int *paths        = predecessors + num_edges;
+    const unsigned int *grid_start =
+        (const unsigned int*)(paths + header->m_num_paths * num_nodes);
+    const int *grid_nodes   = (const int*)(grid_start + num_cells + 1);
+
+    // Check all indices, so that a damaged file can not cause a crash
+    unsigned int total_succ = 0, total_pred = 0, total_paths = 0;
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        if(nodes[i].m_quad_index >= header->m_num_quads ||
+           nodes[i].m_num_successors == 0)
+            return false;
+        total_succ += nodes[i].m_num_successors;
+        total_pred += nodes[i].m_num_predecessors;
+        if(nodes[i].m_num_successors > 1)
+            total_paths++;
+    }
+    if(total_succ != num_edges || total_pred != num_edges ||
+       total_paths != header->m_num_paths)
+        return false;
+    for(unsigned int i=0; i<num_edges; i++)
+    {
+        if(successors[i].m_node < 0 ||
+           (unsigned int)successors[i].m_node >= num_nodes ||
+           successors[i].m_last_index_same_direction >= num_nodes ||
+           (unsigned int)successors[i].m_direction >
+                                        (unsigned int)GraphNode::DIR_UNDEFINED ||
+           predecessors[i] < 0 || (unsigned int)predecessors[i] >= num_nodes)
+            return false;
+    }
+    const int *node_paths = paths;
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        if(nodes[i].m_num_successors < 2)
+            continue;
+        for(unsigned int j=0; j<num_nodes; j++)
+        {
+            // -1 is used for nodes that can not be reached
+            if(node_paths[j] < -1 ||
+               node_paths[j] >= (int)nodes[i].m_num_successors)
+                return false;
+        }
+        node_paths += num_nodes;
+    }
+    if(grid_start[0] != 0 || grid_start[num_cells] != header->m_num_grid_nodes)
+        return false;
+    for(unsigned int c=0; c<num_cells; c++)
+    {
+        if(grid_start[c] > grid_start[c+1])
+            return false;
+    }
+    for(unsigned int i=0; i<header->m_num_grid_nodes; i++)
+    {
+        if(grid_nodes[i] < 0 || (unsigned int)grid_nodes[i] >= num_nodes)
+            return false;
+    }
+
+    m_all_nodes.clear();
+    m_all_nodes.reserve(num_nodes);
+    for(unsigned int i=0; i<num_nodes; i++)
+        m_all_nodes.push_back(GraphNode(nodes[i].m_quad_index, i));
+    m_all_successors.assign(successors, successors + num_edges);
+    m_all_predecessors.assign(predecessors, predecessors + num_edges);
+    unsigned int first_succ = 0, first_pred = 0;
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        const GraphCacheNode &node = nodes[i];
+        m_all_nodes[i].setEdges(&m_all_successors[first_succ],
+                                node.m_num_successors,
+                                node.m_num_predecessors
+                                ? &m_all_predecessors[first_pred] : NULL,
+                                node.m_num_predecessors);
+        m_all_nodes[i].setDistanceFromStart(node.m_distance_from_start);
+        if(node.m_num_successors > 1)
+        {
+            m_all_nodes[i].setPathsToNode(paths, num_nodes);
+            paths += num_nodes;
+        }
+        first_succ += node.m_num_successors;
+        first_pred += node.m_num_predecessors;
+    }
+
+    m_lap_length     = header->m_lap_length;
+    m_grid_width     = header->m_grid_width;
+    m_grid_height    = header->m_grid_height;
+    m_grid_min_x     = header->m_grid_min_x;
+    m_grid_min_z     = header->m_grid_min_z;
+    m_grid_cell_size = header->m_grid_cell_size;
+    m_grid_start.assign(grid_start, grid_start + num_cells + 1);
+    m_grid_nodes.assign(grid_nodes, grid_nodes + header->m_num_grid_nodes);
+    return true;
+}   // loadGraphCache
+
+// ----------------------------------------------------------------------------
+/** Saves the data computed from the graph file, so that it does not need
+ *  to be computed again the next time the track is loaded.
+ *  \param cache_file Name of the cached graph.
+ */
+void QuadGraph::saveGraphCache(const std::string &cache_file) const
+{
+    const unsigned int num_nodes = (unsigned int)m_all_nodes.size();
+    if(num_nodes == 0 || m_grid_start.empty())
+        return;
+
+    GraphCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_quad_time      = file_manager->getModificationTime(m_quad_filename);
+    header.m_graph_time     = file_manager->getModificationTime(m_graph_filename);
+    header.m_version        = GRAPH_CACHE_VERSION;
+    header.m_reverse        = m_reverse ? 1 : 0;
+    header.m_num_quads      = QuadSet::get()->getNumberOfQuads();
+    header.m_num_nodes      = num_nodes;
+    header.m_num_edges      = (unsigned int)m_all_successors.size();
+    header.m_grid_width     = m_grid_width;
+    header.m_grid_height    = m_grid_height;
+    header.m_num_grid_nodes = (unsigned int)m_grid_nodes.size();
+    header.m_lap_length     = m_lap_length;
+    header.m_grid_min_x     = m_grid_min_x;
+    header.m_grid_min_z     = m_grid_min_z;
+    header.m_grid_cell_size = m_grid_cell_size;
+
+    std::vector<GraphCacheNode> nodes(num_nodes);
+    std::vector<int> paths;
+    for(unsigned int i=0; i<num_nodes; i++)
+    {
+        const GraphNode &gn = m_all_nodes[i];
+        nodes[i].m_quad_index          = gn.getQuadIndex();
+        nodes[i].m_num_successors      = gn.getNumberOfSuccessors();
+        nodes[i].m_num_predecessors    = gn.getNumberOfPredecessors();
+        nodes[i].m_distance_from_start = gn.getDistanceFromStart();
+        const std::vector<int> &p = gn.getPathsToNode();
+        if(gn.getNumberOfSuccessors() > 1)
+        {
+            assert(p.size() == num_nodes);
+            paths.insert(paths.end(), p.begin(), p.end());
+            header.m_num_paths++;
+        }
+    }
+
+    std::ofstream out(cache_file.c_str(), std::ios::out | std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)nodes.data(), nodes.size()*sizeof(GraphCacheNode));
+    out.write((const char*)m_all_successors.data(),
+              m_all_successors.size()*sizeof(GraphNode::SuccessorInfo));
+    out.write((const char*)m_all_predecessors.data(),
+              m_all_predecessors.size()*sizeof(int));
+    out.write((const char*)paths.data(), paths.size()*sizeof(int));
+    out.write((const char*)m_grid_start.data(),
+              m_grid_start.size()*sizeof(unsigned int));
+    out.write((const char*)m_grid_nodes.data(),
+              m_grid_nodes.size()*sizeof(int));
+    if(out.fail())
+        Log::warn("Quad Graph", "Could not cache graph in '%s'.",
+                  cache_file.c_str());
+}   // saveGraphCache
+
 // ----------------------------------------------------------------------------
 /** Returns the index of the first graph node (i.e. the graph node which
  *  will trigger a new lap when a kart first enters it). This is always
@@ -216,7 +714,7 @@ void QuadGraph::load(const std::string &filename)
  */
 unsigned int QuadGraph::getStartNode() const
 {
-    return m_reverse ? m_all_nodes[0]->getSuccessor(0)
+    return m_reverse ? m_all_nodes[0].getSuccessor(0)
                      : 0;
 }   // getStartNode
 
@@ -225,7 +723,7 @@ unsigned int QuadGraph::getStartNode() const
  */
 void QuadGraph::computeChecklineRequirements()
 {
-    computeChecklineRequirements(m_all_nodes[0],
+    computeChecklineRequirements(&m_all_nodes[0],
                                  CheckManager::get()->getLapLineIndex());
 }   // computeChecklineRequirements
 
@@ -233,7 +731,7 @@ void QuadGraph::computeChecklineRequirements()
 /** Finds which checklines must be visited before driving on this quad
  *  (useful for rescue)
  */
-void QuadGraph::computeChecklineRequirements(GraphNode* node,
+void QuadGraph::computeChecklineRequirements(const GraphNode* node,
                                              int latest_checkline)
 {
     for (unsigned int n=0; n<node->getNumberOfSuccessors(); n++)
@@ -243,7 +741,7 @@ void QuadGraph::computeChecklineRequirements(GraphNode* node,
         // warp-around
         if (succ_id == 0) break;
 
-        GraphNode* succ = m_all_nodes[succ_id];
+        GraphNode* succ = &m_all_nodes[succ_id];
         int new_latest_checkline =
             CheckManager::get()->getChecklineTriggering(node->getCenter(),
                                                         succ->getCenter() );
@@ -285,7 +783,7 @@ void QuadGraph::setupPaths()
 {
     for(unsigned int i=0; i<getNumNodes(); i++)
     {
-        m_all_nodes[i]->setupPathsToNode();
+        m_all_nodes[i].setupPathsToNode();
     }
 }   // setupPaths
 
@@ -295,10 +793,16 @@ void QuadGraph::setupPaths()
  */
 void QuadGraph::setDefaultSuccessors()
 {
+    // The edges are not packed yet, so count the successors of each node
+    // in the list of edges.
+    std::vector<unsigned int> num_succ(m_all_nodes.size(), 0);
+    for(unsigned int i=0; i<m_edge_list.size(); i++)
+        num_succ[m_edge_list[i].first]++;
+
     for(unsigned int i=0; i<m_all_nodes.size(); i++) {
-        if(m_all_nodes[i]->getNumberOfSuccessors()==0) {
+        if(num_succ[i]==0) {
             addSuccessor(i,i+1>=m_all_nodes.size() ? 0 : i+1);
-            //~ m_all_nodes[i]->addSuccessor(i+1>=m_all_nodes.size() ? 0 : i+1);
+            num_succ[m_edge_list.back().first]++;
         }   // if size==0
     }   // for i<m_allNodes.size()
 }   // setDefaultSuccessors
@@ -334,7 +838,7 @@ void QuadGraph::setDefaultStartPositions(AlignedArray<btTransform>
     // We start just before the start node (which will trigger lap
     // counting when reached). The first predecessor is the one on
     // the main driveline.
-    int current_node = m_all_nodes[getStartNode()]->getPredecessor(0);
+    int current_node = m_all_nodes[getStartNode()].getPredecessor(0);
 
     float distance_from_start = 0.1f+forwards_distance;
 
@@ -425,7 +929,7 @@ void QuadGraph::createMesh(bool show_invisible,
     unsigned int  n = 0;
     for(unsigned int i=0; i<m_all_nodes.size(); i++)
     {
-        if(show_invisible || !m_all_nodes[i]->getQuad().isInvisible())
+        if(show_invisible || !m_all_nodes[i].getQuad().isInvisible())
             n++;
     }
 
@@ -444,7 +948,7 @@ void QuadGraph::createMesh(bool show_invisible,
     for(unsigned int count=0; count<m_all_nodes.size(); count++)
     {
         // Ignore invisible quads
-        if(!show_invisible && m_all_nodes[count]->getQuad().isInvisible())
+        if(!show_invisible && m_all_nodes[count].getQuad().isInvisible())
             continue;
         // Swap the colours from red to blue and back
         if(!track_color)
@@ -453,7 +957,7 @@ void QuadGraph::createMesh(bool show_invisible,
             c.setBlue((i%2) ? 0 : 255);
         }
         // Transfer the 4 points of the current quad to the list of vertices
-        m_all_nodes[count]->getQuad().getVertices(new_v+4*i, c);
+        m_all_nodes[count].getQuad().getVertices(new_v+4*i, c);
 
         // Set up the indices for the triangles
         // (note, afaik with opengl we could use quads directly, but the code
@@ -474,7 +978,7 @@ void QuadGraph::createMesh(bool show_invisible,
         video::S3DVertex lap_v[4];
         irr::u16         lap_ind[6];
         video::SColor     c(128, 255, 0, 0);
-        m_all_nodes[0]->getQuad().getVertices(lap_v, *lap_color);
+        m_all_nodes[0].getQuad().getVertices(lap_v, *lap_color);
 
         // Now scale the length (distance between vertix 0 and 3
         // and between 1 and 2) to be 'length':
@@ -584,7 +1088,7 @@ void QuadGraph::getSuccessors(int node_number,
                               std::vector<unsigned int>& succ,
                               bool for_ai) const
 {
-    const GraphNode *gn=m_all_nodes[node_number];
+    const GraphNode *gn = &m_all_nodes[node_number];
     for(unsigned int i=0; i<gn->getNumberOfSuccessors(); i++)
     {
         // If getSuccessor is called for the AI, only add
@@ -602,7 +1106,7 @@ void QuadGraph::getSuccessors(int node_number,
  */
 void QuadGraph::computeDistanceFromStart(unsigned int node, float new_distance)
 {
-    GraphNode *gn = m_all_nodes[node];
+    GraphNode *gn = &m_all_nodes[node];
     float current_distance = gn->getDistanceFromStart();
 
     // If this node already has a distance defined, check if the new distance
@@ -628,7 +1132,7 @@ void QuadGraph::computeDistanceFromStart(unsigned int node, float new_distance)
 
     for(unsigned int i=0; i<gn->getNumberOfSuccessors(); i++)
     {
-        GraphNode *gn_next = m_all_nodes[gn->getSuccessor(i)];
+        GraphNode *gn_next = &m_all_nodes[gn->getSuccessor(i)];
         // The start node (only node with distance 0) is reached again,
         // recursion can stop now
         if(gn_next->getDistanceFromStart()==0)
@@ -703,7 +1207,7 @@ void QuadGraph::computeDirectionData()
     for(unsigned int i=0; i<m_all_nodes.size(); i++)
     {
         for(unsigned int succ_index=0;
-            succ_index<m_all_nodes[i]->getNumberOfSuccessors();
+            succ_index<m_all_nodes[i].getNumberOfSuccessors();
             succ_index++)
         {
             determineDirection(i, succ_index);
@@ -783,7 +1287,7 @@ void QuadGraph::determineDirection(unsigned int current,
         rel_angle==0 ? GraphNode::DIR_STRAIGHT
                      : (rel_angle>0) ? GraphNode::DIR_RIGHT
                                      : GraphNode::DIR_LEFT;
-    m_all_nodes[current]->setDirectionData(succ_index, dir, next);
+    m_all_nodes[current].setDirectionData(succ_index, dir, next);
 }   // determineDirection
 
 
@@ -845,6 +1349,36 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     // and the track is supposed to be driven: ABCDEBF, the AI might find
     // the node on F, and then keep on going straight ahead instead of
     // using the loop at all.
+    if(!all_sectors && !m_grid_start.empty())
+    {
+        // Only the quads overlapping the grid cell of the point can contain
+        // it. If the point is on several quads, the quad with the lowest
+        // minimum height above the point is used; ties are resolved in
+        // the order in which the quads follow the previous sector.
+        int cx, cz;
+        getGridCell(xyz.getX(), xyz.getZ(), &cx, &cz);
+        const unsigned int cell = cz*m_grid_width + cx;
+        const int n     = (int)m_all_nodes.size();
+        const int start = indx+1;
+        int min_order   = n;
+        *sector = UNKNOWN_SECTOR;
+        for(unsigned int i=m_grid_start[cell]; i<m_grid_start[cell+1]; i++)
+        {
+            const int node = m_grid_nodes[i];
+            const Quad &q  = getQuadOfNode(node);
+            float dist     = xyz.getY() - q.getMinHeight();
+            if(dist>min_dist || dist<=-1.0f || !q.pointInQuad(xyz))
+                continue;
+            int order = ((node-start) % n + n) % n;
+            if(dist==min_dist && order>min_order)
+                continue;
+            min_dist  = dist;
+            min_order = order;
+            *sector   = node;
+        }
+        return;
+    }   // if !all_sectors
+
     unsigned int max_count  = (*sector!=UNKNOWN_SECTOR && all_sectors!=NULL)
                             ? (unsigned int)all_sectors->size()
                             : (unsigned int)m_all_nodes.size();
@@ -901,6 +1435,18 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
                                    const int curr_sector,
                                    std::vector<int> *all_sectors) const
 {
+    // Without a list of sectors to test the closest node can be found with
+    // the grid; the same two phases as below are used.
+    if(!all_sectors && !m_grid_start.empty())
+    {
+        int min_sector = findClosestNode(xyz, /*test_height*/true);
+        if(min_sector==UNKNOWN_SECTOR)
+            min_sector = findClosestNode(xyz, /*test_height*/false);
+        if(min_sector==UNKNOWN_SECTOR)
+            Log::info("Quad Grap", "unknown sector found.");
+        return min_sector;
+    }
+
     int count = (all_sectors!=NULL) ? (int) all_sectors->size() : getNumNodes();
     int current_sector = 0;
     if(curr_sector != UNKNOWN_SECTOR && !all_sectors)
@@ -946,7 +1492,7 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
                 : current_sector+1;
 
             // A first simple test uses the 2d distance to the center of the quad.
-            float dist_2 = m_all_nodes[next_sector]->getDistance2FromPoint(xyz);
+            float dist_2 = m_all_nodes[next_sector].getDistance2FromPoint(xyz);
             if(dist_2<min_dist_2)
             {
                 const Quad &q = getQuadOfNode(next_sector);
@@ -984,6 +1530,17 @@ void QuadGraph::makeMiniMap(const core::dimension2du &dimension,
                             video::ITexture** oldRttMinimap,
                             FrameBuffer** newRttMinimap)
 {
+    // Rendering the mini map needs a full render pass, so with GLSL the
+    // result is cached on disk and only rendered again if the track changes
+    std::string cache_file;
+    if (CVS->isGLSL())
+    {
+        cache_file = getMiniMapCacheFile(dimension);
+        *newRttMinimap = NULL;
+        if (loadCachedMiniMap(cache_file, dimension, oldRttMinimap))
+            return;
+    }
+
     const SColor oldClearColor = World::getWorld()->getClearColor();
     World::getWorld()->setClearbackBufferColor(SColor(0, 255, 255, 255));
     World::getWorld()->forceFogDisabled(true);
@@ -1082,6 +1639,8 @@ void QuadGraph::makeMiniMap(const core::dimension2du &dimension,
     if (CVS->isGLSL())
     {
         frame_buffer = newRttProvider->render(camera, GUIEngine::getLatestDt());
+        if (frame_buffer)
+            saveMiniMap(frame_buffer, cache_file);
     }
     else
     {
@@ -1113,6 +1672,97 @@ void QuadGraph::makeMiniMap(const core::dimension2du &dimension,
     irr_driver->clearBackgroundNodes();
 }   // makeMiniMap
 
+//-----------------------------------------------------------------------------
+/** Returns the name of the file in which the mini map of this track is
+ *  cached. It depends on the track, the direction and the size of the map.
+ *  \param dimension Size of the mini map texture.
+ */
+std::string QuadGraph::getMiniMapCacheFile(const core::dimension2du &dimension)
+                                                                         const
+{
+    std::string track_dir = StringUtils::getPath(m_quad_filename);
+    if (StringUtils::hasSuffix(track_dir, "/"))
+        track_dir = track_dir.substr(0, track_dir.size() - 1);
+    std::string name = StringUtils::getBasename(track_dir)
+                     + (m_reverse ? "-reverse-" : "-")
+                     + StringUtils::toString(dimension.Width) + "x"
+                     + StringUtils::toString(dimension.Height) + ".png";
+    return file_manager->getMiniMapCacheLocation(name);
+}   // getMiniMapCacheFile
+
+//-----------------------------------------------------------------------------
+/** Loads the cached mini map if it exists and is newer than the quad and
+ *  graph files, and sets the scaling used by mapPoint2MiniMap.
+ *  \param cache_file Name of the cached mini map.
+ *  \param dimension Size of the mini map texture.
+ *  \param texture On return the loaded texture.
+ *  \return True if the cached mini map was loaded.
+ */
+bool QuadGraph::loadCachedMiniMap(const std::string &cache_file,
+                                  const core::dimension2du &dimension,
+                                  video::ITexture **texture)
+{
+    *texture = NULL;
+    if (!file_manager->fileExists(cache_file)                  ||
+        file_manager->fileIsNewer(m_quad_filename, cache_file) ||
+        file_manager->fileIsNewer(m_graph_filename, cache_file)   )
+        return false;
+
+    *texture = irr_driver->getVideoDriver()->getTexture(cache_file.c_str());
+    if (!*texture || (*texture)->getSize() != dimension)
+    {
+        if (*texture)
+            irr_driver->removeTexture(*texture);
+        *texture = NULL;
+        return false;
+    }
+
+    // Same scaling as used when rendering the mini map
+    Vec3 bb_min, bb_max;
+    QuadSet::get()->getBoundingBox(&bb_min, &bb_max);
+    float dx = bb_max.getX()-bb_min.getX();
+    float dz = bb_max.getZ()-bb_min.getZ();
+    m_scaling   = dimension.Width / std::max(dx, dz);
+    m_min_coord = bb_min;
+    return true;
+}   // loadCachedMiniMap
+
+//-----------------------------------------------------------------------------
+/** Reads the rendered mini map back and saves it as image. The rows are
+ *  flipped since OpenGL stores the bottom row first, and the alpha is
+ *  halved, since the rendered mini map is drawn semi transparent.
+ *  \param frame_buffer The frame buffer the mini map was rendered to.
+ *  \param cache_file Name of the image file.
+ */
+void QuadGraph::saveMiniMap(const FrameBuffer *frame_buffer,
+                            const std::string &cache_file) const
+{
+    const unsigned int width  = (unsigned int)frame_buffer->getWidth();
+    const unsigned int height = (unsigned int)frame_buffer->getHeight();
+    std::vector<uint8_t> pixels(width * height * 4);
+    glBindTexture(GL_TEXTURE_2D, frame_buffer->getRTT()[0]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    video::IImage *image = irr_driver->getVideoDriver()->createImage(
+        video::ECF_A8R8G8B8, core::dimension2du(width, height));
+    uint8_t *dest = (uint8_t*)image->lock();
+    for (unsigned int y = 0; y < height; y++)
+    {
+        memcpy(dest + y * width * 4, &pixels[(height - 1 - y) * width * 4],
+               width * 4);
+    }
+    for (unsigned int i = 0; i < width * height; i++)
+        dest[i * 4 + 3] = (uint8_t)(dest[i * 4 + 3] * 127 / 255);
+    image->unlock();
+
+    if (!irr_driver->getVideoDriver()->writeImageToFile(image,
+                                                        cache_file.c_str()))
+        Log::warn("Quad Graph", "Could not cache mini map in '%s'.",
+                  cache_file.c_str());
+    image->drop();
+}   // saveMiniMap
+
 //-----------------------------------------------------------------------------
     /** Returns the 2d coordinates of a point when drawn on the mini map
      *  texture.
@@ -22,6 +22,7 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <utility>
 
 #include "tracks/graph_node.hpp"
 #include "tracks/quad_set.hpp"
@@ -58,8 +59,20 @@ private:
 
     RTT* m_new_rtt;
 
-    /** The actual graph data structure. */
-    std::vector<GraphNode*>  m_all_nodes;
+    /** The actual graph data structure. The nodes are stored by value so
+     *  that graph walks (e.g. by the AI) access contiguous memory. */
+    std::vector<GraphNode>   m_all_nodes;
+
+    /** The successors of all nodes, sorted by node. Each node points to
+     *  its part of this array (compressed sparse row format). */
+    std::vector<GraphNode::SuccessorInfo> m_all_successors;
+
+    /** The predecessors of all nodes, sorted by node. */
+    std::vector<int>         m_all_predecessors;
+
+    /** The edges (from, to) read from the graph file, which are converted
+     *  into m_all_successors and m_all_predecessors by packEdges(). */
+    std::vector<std::pair<unsigned int, unsigned int> > m_edge_list;
     /** For debug mode only: the node of the debug mesh. */
     scene::ISceneNode       *m_node;
     /** For debug only: the mesh of the debug mesh. */
@@ -76,19 +89,58 @@ private:
     /** Scaling for mini map. */
     float                    m_scaling;
 
-    /** Stores the filename - just used for error messages. */
+    /** Stores the filename - used for error messages and to check if the
+     *  cached mini map is up to date. */
     std::string              m_quad_filename;
 
+    /** The name of the graph file, to check if the cached mini map is up
+     *  to date. */
+    std::string              m_graph_filename;
+
     /** Wether the graph should be reverted or not */
     bool                     m_reverse;
 
+    /** A 2d grid over the track used to quickly find the nodes close to a
+     *  point. Each cell contains all nodes whose quad overlaps the cell
+     *  (in x and z), so it contains all candidates for findRoadSector.
+     *  The nodes of cell c are m_grid_nodes[m_grid_start[c]] till (but
+     *  not including) m_grid_nodes[m_grid_start[c+1]]. */
+    std::vector<unsigned int> m_grid_start;
+
+    /** The nodes of all grid cells, sorted by cell. */
+    std::vector<int>         m_grid_nodes;
+
+    /** Minimum x and z coordinates of the grid. */
+    float                    m_grid_min_x, m_grid_min_z;
+
+    /** Size of a grid cell. */
+    float                    m_grid_cell_size;
+
+    /** Number of cells of the grid in x and z direction. */
+    int                      m_grid_width, m_grid_height;
+
+    void setupPaths();
     void setDefaultSuccessors();
-    void computeChecklineRequirements(GraphNode* node, int latest_checkline);
+    void computeChecklineRequirements(const GraphNode* node,
+                                      int latest_checkline);
     void computeDirectionData();
     void determineDirection(unsigned int current, unsigned int succ_index);
     float normalizeAngle(float f);
 
     void addSuccessor(unsigned int from, unsigned int to);
+    void packEdges();
+    void buildGrid();
+    std::string getMiniMapCacheFile(const core::dimension2du &dimension) const;
+    bool loadCachedMiniMap(const std::string &cache_file,
+                           const core::dimension2du &dimension,
+                           video::ITexture **texture);
+    void saveMiniMap(const FrameBuffer *frame_buffer,
+                     const std::string &cache_file) const;
+    std::string getGraphCacheFile() const;
+    bool loadGraphCache(const std::string &cache_file);
+    void saveGraphCache(const std::string &cache_file) const;
+    void getGridCell(float x, float z, int *cell_x, int *cell_z) const;
+    int  findClosestNode(const Vec3 &xyz, bool test_height) const;
     void load         (const std::string &filename);
     void computeDistanceFromStart(unsigned int start_node, float distance);
     void createMesh(bool show_invisible=true,
@@ -131,7 +183,6 @@ public:
     void         updateDistancesForAllSuccessors(unsigned int indx,
                                                  float delta,
                                                  unsigned int count);
-    void         setupPaths();
     void         computeChecklineRequirements();
 // ----------------------------------------------------------------------======
     /** Returns the one instance of this object. It is possible that there
@@ -168,27 +219,30 @@ public:
     // ------------------------------------------------------------------------
     /** Return the distance to the j-th successor of node n. */
     float        getDistanceToNext(int n, int j) const
-                         { return m_all_nodes[n]->getDistanceToSuccessor(j);}
+                         { return m_all_nodes[n].getDistanceToSuccessor(j);}
     // ------------------------------------------------------------------------
     /** Returns the angle of the line between node n and its j-th.
      *  successor. */
     float        getAngleToNext(int n, int j) const
-                         { return m_all_nodes[n]->getAngleToSuccessor(j);   }
+                         { return m_all_nodes[n].getAngleToSuccessor(j);   }
     // ------------------------------------------------------------------------
     /** Returns the number of successors of a node n. */
     int          getNumberOfSuccessors(int n) const
-                         { return m_all_nodes[n]->getNumberOfSuccessors();  }
+                         { return m_all_nodes[n].getNumberOfSuccessors();  }
     // ------------------------------------------------------------------------
     /** Returns the quad that belongs to a graph node. */
     const Quad&  getQuadOfNode(unsigned int j) const
-          { return QuadSet::get()->getQuad(m_all_nodes[j]->getQuadIndex()); }
+          { return QuadSet::get()->getQuad(m_all_nodes[j].getQuadIndex()); }
     // ------------------------------------------------------------------------
-    /** Returns the quad that belongs to a graph node. */
-    GraphNode&   getNode(unsigned int j) const{ return *m_all_nodes[j]; }
+    /** Returns the graph node with the given index. */
+    GraphNode&   getNode(unsigned int j)       { return m_all_nodes[j]; }
+    // ------------------------------------------------------------------------
+    /** Returns the graph node with the given index. */
+    const GraphNode& getNode(unsigned int j) const { return m_all_nodes[j]; }
     // ------------------------------------------------------------------------
     /** Returns the distance from the start to the beginning of a quad. */
     float        getDistanceFromStart(int j) const
-                           { return m_all_nodes[j]->getDistanceFromStart(); }
+                           { return m_all_nodes[j].getDistanceFromStart(); }
     // ------------------------------------------------------------------------
     /** Returns the length of the main driveline. */
     float        getLapLength() const {return m_lap_length; }
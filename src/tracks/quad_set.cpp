@@ -40,10 +40,6 @@ QuadSet::QuadSet()
  */
 QuadSet::~QuadSet()
 {
-    for(unsigned int i=0; i<m_all_quads.size(); i++)
-    {
-        delete m_all_quads[i];
-    }
     m_all_quads.clear();
     m_quad_set = NULL;
 }   // ~QuadSet
@@ -65,7 +61,7 @@ void QuadSet::getPoint(const XMLNode *xml, const std::string &attribute_name,
         std::vector<std::string> l = StringUtils::split(s, ':');
         int n=atoi(l[0].c_str());
         int p=atoi(l[1].c_str());
-        *result=(*m_all_quads[n])[p];
+        *result=m_all_quads[n][p];
     }
     else
     {
@@ -112,8 +108,7 @@ void QuadSet::init(const std::string &filename)
         xml_node->get("invisible", &invisible);
         bool ai_ignore=false;
         xml_node->get("ai-ignore", &ai_ignore);
-        Quad* q=new Quad(p0,p1,p2,p3, invisible, ai_ignore);
-        m_all_quads.push_back(q);
+        m_all_quads.push_back(Quad(p0,p1,p2,p3, invisible, ai_ignore));
         m_max.max(p0);m_max.max(p1);m_max.max(p2);m_max.max(p3);
         m_min.min(p0);m_min.min(p1);m_min.min(p2);m_min.min(p3);
 
@@ -37,8 +37,9 @@ private:
     Vec3                m_min;
     Vec3                m_max;
 
-    /** The list of all quads. */
-    std::vector<Quad*>  m_all_quads;
+    /** The list of all quads, stored by value so that they are contiguous
+     *  in memory. */
+    std::vector<Quad>   m_all_quads;
 
     /** Pointer to the one instance of a quad set. */
     static QuadSet     *m_quad_set;
@@ -70,7 +71,7 @@ public:
     static QuadSet *get() { return m_quad_set; }
     // ------------------------------------------------------------------------
     /** Returns the quad with a given index number. */
-    const Quad&  getQuad(int n) const {return *(m_all_quads[n]); }
+    const Quad&  getQuad(int n) const {return m_all_quads[n];    }
     // ------------------------------------------------------------------------
     /** Return the minimum and maximum coordinates of this quad set. */
     void         getBoundingBox(Vec3 *min, Vec3 *max)
@@ -82,9 +83,9 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the center of quad n. */
     const Vec3&  getCenterOfQuad(int n) const
-                                {return m_all_quads[n]->getCenter();      }
+                                {return m_all_quads[n].getCenter();       }
     // ------------------------------------------------------------------------
     /** Returns the n-th. quad. */
-    const Quad&  getQuad(int n)  {return *(m_all_quads[n]);                }
+    const Quad&  getQuad(int n)  {return m_all_quads[n];                   }
 };   // QuadSet
 #endif
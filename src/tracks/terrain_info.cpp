@@ -60,7 +60,7 @@ void TerrainInfo::update(const Vec3 &from)
 
     const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
     tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
-               /*interpolate*/false);
+               /*interpolate*/false, &m_ray_cache);
     // Now also raycast against all track objects (that are driveable).
     World::getWorld()->getTrack()->getTrackObjectManager()
                      ->castRay(from, to, &m_hit_point, &m_material,
@@ -79,7 +79,7 @@ void TerrainInfo::update(const btTransform &trans, const Vec3 &offset)
 
     const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
     tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
-               /*interpolate*/true);
+               /*interpolate*/true, &m_ray_cache);
 
     // Now also raycast against all track objects (that are driveable). If
     // there should be a closer result (than the one against the main track 
@@ -19,6 +19,7 @@
 #ifndef HEADER_TERRAIN_INFO_HPP
 #define HEADER_TERRAIN_INFO_HPP
 
+#include "physics/triangle_mesh.hpp"
 #include "utils/vec3.hpp"
 
 class btTransform;
@@ -39,6 +40,9 @@ private:
     const Material   *m_last_material;
     /** The point that was hit. */
     Vec3              m_hit_point;
+    /** Speeds up the raycast against the track, which usually hits the
+     *  same triangle as in the previous frame. */
+    TriangleMesh::RayCache m_ray_cache;
 
 public:
              TerrainInfo();
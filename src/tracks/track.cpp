@@ -30,6 +30,7 @@
 #include "graphics/CBatchingMesh.hpp"
 #include "graphics/central_settings.hpp"
 #include "graphics/glwrap.hpp"
+#include "graphics/imposter.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/material_manager.hpp"
@@ -38,9 +39,15 @@
 #include "graphics/particle_emitter.hpp"
 #include "graphics/particle_kind.hpp"
 #include "graphics/particle_kind_manager.hpp"
+#include "graphics/particle_pool.hpp"
 #include "graphics/stk_text_billboard.hpp"
+#include "graphics/stkmeshscenenode.hpp"
+#include "graphics/texture_prefetcher.hpp"
+#include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
+#include "io/utf_writer.hpp"
 #include "io/xml_node.hpp"
 #include "items/item.hpp"
 #include "items/item_manager.hpp"
@@ -48,6 +55,7 @@
 #include "karts/kart_properties.hpp"
 #include "modes/linear_world.hpp"
 #include "modes/easter_egg_hunt.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/world.hpp"
 #include "physics/physical_object.hpp"
 #include "physics/physics.hpp"
@@ -60,8 +68,12 @@
 #include "tracks/quad_graph.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track_object_manager.hpp"
+#include "tracks/trigger_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/job_system.hpp"
+#include "utils/load_profiler.hpp"
 #include "utils/log.hpp"
+#include "utils/memory_tracker.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
@@ -72,7 +84,11 @@
 #include <IMeshSceneNode.h>
 #include <ISceneManager.h>
 
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <math.h>
+#include <set>
 #include <stdexcept>
 #include <sstream>
 #include <wchar.h>
@@ -81,9 +97,17 @@ using namespace irr;
 
 
 const float Track::NOHIT           = -99999.9f;
+const float Track::STATIC_CHUNK_SIZE = 100.0f;
+std::vector<Track*> Track::m_warm_tracks;
 
 // ----------------------------------------------------------------------------
-Track::Track(const std::string &filename)
+/** Creates a track object and reads the information about the track.
+ *  \param filename Name of the track.xml file.
+ *  \param index_entry The entry of this track in the track index, if one
+ *         exists. If it is up to date, only the data needed for the menus
+ *         is taken from it, and track.xml is parsed when a race starts.
+ */
+Track::Track(const std::string &filename, const XMLNode *index_entry)
 {
 #ifdef DEBUG
     m_magic_number          = 0x17AC3802;
@@ -137,6 +161,7 @@ Track::Track(const std::string &filename)
     m_weather_sound         = "";
     m_cache_track           = UserConfigParams::m_cache_overworld &&
                               m_ident=="overworld";
+    m_warm_bytes            = 0;
     m_minimap_x_scale       = 1.0f;
     m_minimap_y_scale       = 1.0f;
     m_startup_run = false;
@@ -144,13 +169,19 @@ Track::Track(const std::string &filename)
     m_all_nodes.clear();
     m_static_physics_only_nodes.clear();
     m_all_cached_meshes.clear();
-    loadTrackInfo();
+    m_info_loaded = false;
+    if(!index_entry || !loadIndexEntry(*index_entry))
+    {
+        loadTrackInfo();
+        m_info_loaded = true;
+    }
 }   // Track
 
 //-----------------------------------------------------------------------------
 /** Destructor, removes quad data structures etc. */
 Track::~Track()
 {
+    releaseWarmMeshes();
     // Note that the music information in m_music is globally managed
     // by the music_manager, and is freed there. So no need to free it
     // here (esp. since various track might share the same music).
@@ -160,6 +191,111 @@ Track::~Track()
 #endif
 }   // ~Track
 
+//-----------------------------------------------------------------------------
+/** Releases the references to a mesh of m_all_cached_meshes (or
+ *  m_warm_meshes) and its textures. The m_all_cached_mesh contains each mesh
+ *  loaded from a file, which means that the mesh is stored in irrlichts mesh
+ *  cache. To clean everything loaded by this track, we drop the ref count for
+ *  each mesh here, till the ref count is 1, which means the mesh is only
+ *  contained in the mesh cache, and can therefore be removed. Meshes load
+ *  more than once are in m_all_cached_mesh more than once (which is easier
+ *  than storing the mesh only once, but then having to test for each mesh if
+ *  it is already contained in the list or not).
+ */
+static void dropCachedMesh(scene::IMesh *mesh)
+{
+    irr_driver->dropAllTextures(mesh);
+    // If a mesh is not in Irrlicht's texture cache, its refcount is
+    // 1 (since its scene node was removed, so the only other reference
+    // is in m_all_cached_meshes). In this case we only drop it once
+    // and don't try to remove it from the cache.
+    if (mesh->getReferenceCount() == 1)
+    {
+        mesh->drop();
+        return;
+    }
+    mesh->drop();
+    if (mesh->getReferenceCount() == 1)
+        irr_driver->removeMeshFromCache(mesh);
+}   // dropCachedMesh
+
+//-----------------------------------------------------------------------------
+/** Estimates the memory used by meshes, including their textures. */
+static size_t getMeshMemory(const std::vector<scene::IMesh*> &meshes)
+{
+    size_t bytes = 0;
+    std::set<const video::ITexture*> textures;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        for (unsigned int j = 0; j < meshes[i]->getMeshBufferCount(); j++)
+        {
+            const scene::IMeshBuffer *mb = meshes[i]->getMeshBuffer(j);
+            bytes += mb->getVertexCount()
+                   * video::getVertexPitchFromType(mb->getVertexType())
+                   + mb->getIndexCount() * sizeof(u16);
+            for (unsigned int k = 0; k < video::MATERIAL_MAX_TEXTURES; k++)
+            {
+                const video::ITexture *t = mb->getMaterial().getTexture(k);
+                // Count 4 bytes per pixel and a third for the mipmaps
+                if (t && textures.insert(t).second)
+                    bytes += t->getSize().getArea() * 4 * 4 / 3;
+            }
+        }
+    }
+    return bytes;
+}   // getMeshMemory
+
+//-----------------------------------------------------------------------------
+/** Releases the meshes kept after the last race on this track. This is done
+ *  once the track is loaded again (the meshes used again are then referenced
+ *  by m_all_cached_meshes), or to free memory.
+ */
+void Track::releaseWarmMeshes()
+{
+    for (unsigned int i = 0; i < m_warm_meshes.size(); i++)
+        dropCachedMesh(m_warm_meshes[i]);
+    m_warm_meshes.clear();
+    m_warm_bytes = 0;
+    std::vector<Track*>::iterator p = std::find(m_warm_tracks.begin(),
+                                                m_warm_tracks.end(), this);
+    if (p != m_warm_tracks.end())
+        m_warm_tracks.erase(p);
+}   // releaseWarmMeshes
+
+//-----------------------------------------------------------------------------
+/** Releases the warm meshes of the least recently used tracks till the
+ *  memory used by all warm meshes is within the budget.
+ */
+void Track::evictWarmTracks()
+{
+    const size_t budget =
+        (size_t)std::max((int)UserConfigParams::m_track_cache_memory, 0)
+        * 1024 * 1024;
+    size_t total = 0;
+    for (unsigned int i = 0; i < m_warm_tracks.size(); i++)
+        total += m_warm_tracks[i]->m_warm_bytes;
+    while (total > budget && !m_warm_tracks.empty())
+    {
+        Track *track = m_warm_tracks.front();
+        total -= track->m_warm_bytes;
+        Log::info("track", "Releasing the models of '%s' (%d MB).",
+                  track->getIdent().c_str(),
+                  (int)(track->m_warm_bytes / (1024 * 1024)));
+        track->releaseWarmMeshes();
+    }
+}   // evictWarmTracks
+
+//-----------------------------------------------------------------------------
+/** Starts to decode the textures of this track in the background, so that
+ *  loading it later is faster. Used for the next track of a GP.
+ */
+void Track::preloadTextures()
+{
+    if (ProfileWorld::isNoGraphics())
+        return;
+    TexturePrefetcher::preload(m_root, UserConfigParams::m_loading_threads);
+}   // preloadTextures
+
 //-----------------------------------------------------------------------------
 /** A < comparison of tracks. This is used to sort the tracks when displaying
  *  them in the gui.
@@ -261,6 +397,7 @@ void Track::reset()
 {
     m_ambient_color = m_default_ambient_color;
     CheckManager::get()->reset(*this);
+    TriggerManager::get()->reset();
     ItemManager::get()->reset();
     m_track_object_manager->reset();
     m_startup_run = false;
@@ -274,11 +411,16 @@ void Track::cleanup()
 {
     QuadGraph::destroy();
     ItemManager::destroy();
+    // Destroyed before the track objects, which remove their triggers
+    // otherwise
+    TriggerManager::destroy();
     VAOManager::kill();
+    ParticlePool::kill();
 
     ParticleKindManager::get()->cleanUpTrackSpecificGfx();
-    // Clear reminder of transformed textures
+    // Clear the cache of single colour textures
     resetTextureTable();
+    ImposterNode::clearCache();
     // Clear reminder of the link between textures and file names.
     irr_driver->clearTexturesFileName();
 
@@ -296,6 +438,7 @@ void Track::cleanup()
     m_static_physics_only_nodes.clear();
 
     m_all_emitters.clearAndDeleteAll();
+    m_height_map.clear();
 
     CheckManager::destroy();
 
@@ -320,31 +463,28 @@ void Track::cleanup()
         irr_driver->cleanSunInterposer();
 
 
-    // The m_all_cached_mesh contains each mesh loaded from a file, which
-    // means that the mesh is stored in irrlichts mesh cache. To clean
-    // everything loaded by this track, we drop the ref count for each mesh
-    // here, till the ref count is 1, which means the mesh is only contained
-    // in the mesh cache, and can therefore be removed. Meshes load more
-    // than once are in m_all_cached_mesh more than once (which is easier
-    // than storing the mesh only once, but then having to test for each
-    // mesh if it is already contained in the list or not).
+    // Meshes that are in irrlicht's mesh cache (i.e. loaded from a file)
+    // are kept, unless the track is cached anyway. All other meshes (e.g.
+    // merged meshes) are created again when the track is loaded.
+    releaseWarmMeshes();
+    const bool keep_warm = !m_cache_track &&
+                           UserConfigParams::m_track_cache_memory > 0;
+    scene::IMeshCache *mesh_cache =
+                              irr_driver->getSceneManager()->getMeshCache();
     for (unsigned int i = 0; i < m_all_cached_meshes.size(); i++)
     {
-        irr_driver->dropAllTextures(m_all_cached_meshes[i]);
-        // If a mesh is not in Irrlicht's texture cache, its refcount is
-        // 1 (since its scene node was removed, so the only other reference
-        // is in m_all_cached_meshes). In this case we only drop it once
-        // and don't try to remove it from the cache.
-        if (m_all_cached_meshes[i]->getReferenceCount() == 1)
-        {
-            m_all_cached_meshes[i]->drop();
-            continue;
-        }
-        m_all_cached_meshes[i]->drop();
-        if (m_all_cached_meshes[i]->getReferenceCount() == 1)
-            irr_driver->removeMeshFromCache(m_all_cached_meshes[i]);
+        if (keep_warm && mesh_cache->getMeshIndex(m_all_cached_meshes[i]) >= 0)
+            m_warm_meshes.push_back(m_all_cached_meshes[i]);
+        else
+            dropCachedMesh(m_all_cached_meshes[i]);
     }
     m_all_cached_meshes.clear();
+    if (!m_warm_meshes.empty())
+    {
+        m_warm_bytes = getMeshMemory(m_warm_meshes);
+        m_warm_tracks.push_back(this);
+        evictWarmTracks();
+    }
 
     // Now free meshes that are not associated to any scene node.
     for (unsigned int i = 0; i < m_detached_cached_meshes.size(); i++)
@@ -394,6 +534,11 @@ void Track::cleanup()
     irr_driver->clearForcedBloom();
     irr_driver->clearBackgroundNodes();
 
+    // Textures of this track that were not removed stay uploaded, reduce
+    // the ones not used recently if they are over the budget
+    if (CVS->isGLSL())
+        evictColdTextures();
+
     if(UserConfigParams::logMemory())
     {
         Log::debug("track",
@@ -572,6 +717,92 @@ void Track::loadTrackInfo()
     }
 }   // loadTrackInfo
 
+//-----------------------------------------------------------------------------
+/** Reads the data shown in the menus from the entry of this track in the
+ *  track index. Returns false (without changing the track) if the entry
+ *  is out of date, i.e. track.xml or easter_eggs.xml were modified since
+ *  the entry was written.
+ *  \param node The index entry of this track.
+ */
+bool Track::loadIndexEntry(const XMLNode &node)
+{
+    const std::string easter_name = m_root + "easter_eggs.xml";
+    int64_t track_time = -1, easter_time = -1;
+    node.get("track-time",  &track_time );
+    node.get("easter-time", &easter_time);
+    if(track_time  != file_manager->getModificationTime(m_filename) ||
+       easter_time != file_manager->getModificationTime(easter_name))
+        return false;
+
+    core::stringw name;
+    node.getAndDecode("name",           &name                    );
+    m_name = core::stringc(name).c_str();
+    node.getAndDecode("designer",       &m_designer              );
+    node.get("version",                 &m_version               );
+    node.get("screenshot",              &m_screenshot            );
+    node.get("groups",                  &m_groups                );
+    node.get("internal",                &m_internal              );
+    node.get("soccer",                  &m_is_soccer             );
+    node.get("arena",                   &m_is_arena              );
+    node.get("cutscene",                &m_is_cutscene           );
+    node.get("reverse",                 &m_reverse_available     );
+    node.get("easter-eggs",             &m_has_easter_eggs       );
+    node.get("default-number-of-laps",  &m_default_number_of_laps);
+    m_actual_number_of_laps = m_default_number_of_laps;
+    if(m_groups.size()==0) m_groups.push_back(DEFAULT_GROUP_NAME);
+    m_screenshot = m_root+m_screenshot;
+    return true;
+}   // loadIndexEntry
+
+//-----------------------------------------------------------------------------
+/** Writes the entry of this track to the track index, see loadIndexEntry().
+ *  \param out The writer for the index file.
+ */
+void Track::saveIndexEntry(UTFWriter &out) const
+{
+    const std::string easter_name = m_root + "easter_eggs.xml";
+    std::string groups;
+    for(unsigned int i=0; i<m_groups.size(); i++)
+        groups += (i==0 ? "" : " ") + m_groups[i];
+    out << L"  <track file=\"" << StringUtils::xmlEncode(m_filename.c_str())
+        << L"\" track-time=\""
+        << file_manager->getModificationTime(m_filename)
+        << L"\" easter-time=\""
+        << file_manager->getModificationTime(easter_name) << L"\"\n";
+    out << L"         name=\"" << StringUtils::xmlEncode(m_name.c_str())
+        << L"\" designer=\"" << StringUtils::xmlEncode(m_designer)
+        << L"\" version=\"" << m_version << L"\"\n";
+    out << L"         screenshot=\""
+        << StringUtils::xmlEncode(m_screenshot.substr(m_root.size()).c_str())
+        << L"\" groups=\""
+        << StringUtils::xmlEncode(groups.c_str())
+        << L"\"\n";
+    out << L"         internal=\"" << m_internal
+        << L"\" soccer=\"" << m_is_soccer
+        << L"\" arena=\"" << m_is_arena
+        << L"\" cutscene=\"" << m_is_cutscene
+        << L"\" reverse=\"" << m_reverse_available
+        << L"\" easter-eggs=\"" << m_has_easter_eggs
+        << L"\" default-number-of-laps=\"" << m_default_number_of_laps
+        << L"\"/>\n";
+}   // saveIndexEntry
+
+//-----------------------------------------------------------------------------
+/** Parses track.xml if the track was created from the track index, which
+ *  only contains the data needed in the menus. This must be called before
+ *  any other data of the track (e.g. gravity or music) is used.
+ */
+void Track::ensureInfoLoaded()
+{
+    if(m_info_loaded) return;
+    // Keep the number of laps selected in the menu
+    const int laps = m_actual_number_of_laps;
+    m_screenshot = "";
+    loadTrackInfo();
+    m_actual_number_of_laps = laps;
+    m_info_loaded = true;
+}   // ensureInfoLoaded
+
 //-----------------------------------------------------------------------------
 /** Loads all curves from the XML node.
  */
@@ -640,11 +871,13 @@ void Track::startMusic() const
  */
 void Track::loadQuadGraph(unsigned int mode_id, const bool reverse)
 {
-    QuadGraph::create(m_root+m_all_modes[mode_id].m_quad_name,
-                      m_root+m_all_modes[mode_id].m_graph_name,
-                      reverse);
+    {
+        LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_QUAD_GRAPH);
+        QuadGraph::create(m_root+m_all_modes[mode_id].m_quad_name,
+                          m_root+m_all_modes[mode_id].m_graph_name,
+                          reverse);
+    }
 
-    QuadGraph::get()->setupPaths();
 #ifdef DEBUG
     for(unsigned int i=0; i<QuadGraph::get()->getNumNodes(); i++)
     {
@@ -676,6 +909,7 @@ void Track::loadQuadGraph(unsigned int mode_id, const bool reverse)
         core::dimension2du size = m_mini_map_size
                                  .getOptimalSize(!nonpower,!nonsquare);
 
+        LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_MINIMAP);
         QuadGraph::get()->makeMiniMap(size, "minimap::" + m_ident, video::SColor(127, 255, 255, 255),
             &m_old_rtt_mini_map, &m_new_rtt_mini_map);
         if (m_old_rtt_mini_map)
@@ -750,7 +984,9 @@ void Track::createPhysicsModel(unsigned int main_track_count)
     {
         convertTrackToBullet(m_all_nodes[i]);
     }
-    m_track_mesh->createPhysicalBody();
+    // Building the BVH of the whole track takes a while, so it is cached
+    m_track_mesh->createPhysicalBody((btCollisionObject::CollisionFlags)0,
+                                     m_track_mesh->getBvhCacheFile().c_str());
     m_gfx_effect_mesh->createCollisionShape();
 }   // createPhysicsModel
 
@@ -763,6 +999,7 @@ void Track::createPhysicsModel(unsigned int main_track_count)
  */
 void Track::convertTrackToBullet(scene::ISceneNode *node)
 {
+    LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_PHYSICS);
     if (node->getType() == scene::ESNT_TEXT)
         return;
 
@@ -961,6 +1198,17 @@ void Track::convertTrackToBullet(scene::ISceneNode *node)
 
 }   // convertTrackToBullet
 
+// ----------------------------------------------------------------------------
+/** Marks a node which never moves as static shadow caster, so that its
+ *  shadows in the far cascades can be cached (see ShadowCache).
+ */
+static void setStaticShadowCaster(scene::ISceneNode *node)
+{
+    STKMeshSceneNode *stk_node = dynamic_cast<STKMeshSceneNode*>(node);
+    if (stk_node)
+        stk_node->setStaticShadowCaster(true);
+}   // setStaticShadowCaster
+
 // ----------------------------------------------------------------------------
 /** Loads the main track model (i.e. all other objects contained in the
  *  scene might use raycast on this track model to determine the actual
@@ -1035,6 +1283,7 @@ bool Track::loadMainTrack(const XMLNode &root)
     // The merged mesh is grabbed by the octtree, so we don't need
     // to keep a reference to it.
     scene::ISceneNode *scene_node = irr_driver->addMesh(tangent_mesh, "track_main");
+    setStaticShadowCaster(scene_node);
     //scene::IMeshSceneNode *scene_node = irr_driver->addOctTree(merged_mesh);
     // We should drop the merged mesh (since it's now referred to in the
     // scene node), but then we need to grab it since it's in the
@@ -1073,6 +1322,15 @@ bool Track::loadMainTrack(const XMLNode &root)
 
     ModelDefinitionLoader lodLoader(this);
 
+    // Static objects which are merged with the other static objects in the
+    // same square of the track after loading.
+    struct StaticObject
+    {
+        scene::IMesh   *m_mesh;
+        core::vector3df m_xyz, m_hpr, m_scale;
+    };
+    std::map<std::pair<int, int>, std::vector<StaticObject> > static_chunks;
+
     // Load LOD groups
     const XMLNode *lod_xml_node = root.getNode("lod");
     if (lod_xml_node != NULL)
@@ -1315,6 +1573,19 @@ bool Track::loadMainTrack(const XMLNode &root)
             m_all_cached_meshes.push_back(a_mesh);
             irr_driver->grabAllTextures(a_mesh);
             a_mesh->grab();
+
+            // Plain visible objects are merged with their neighbours below,
+            // objects with animated textures need their own materials
+            if (challenge.size() == 0 && interaction != "physics-only" &&
+                n->getNode("animated-texture") == NULL)
+            {
+                StaticObject object = { a_mesh, xyz, hpr, scale };
+                std::pair<int, int> chunk((int)floorf(xyz.X / STATIC_CHUNK_SIZE),
+                                          (int)floorf(xyz.Z / STATIC_CHUNK_SIZE));
+                static_chunks[chunk].push_back(object);
+                continue;
+            }
+
             scene_node = irr_driver->addMesh(a_mesh, model_name);
             scene_node->setPosition(xyz);
             scene_node->setRotation(hpr);
@@ -1409,6 +1680,48 @@ bool Track::loadMainTrack(const XMLNode &root)
 
     }   // for i
 
+    // Each static object would otherwise be a scene node of its own, which
+    // is culled and gets draw commands every frame. Merging all objects in
+    // a square into one mesh (whose buffers are then grouped by material)
+    // keeps the culling granularity while removing most of this overhead.
+    for (std::map<std::pair<int, int>, std::vector<StaticObject> >::iterator
+         it = static_chunks.begin(); it != static_chunks.end(); it++)
+    {
+        const std::vector<StaticObject> &objects = it->second;
+        if (objects.size() == 1)
+        {
+            scene::ISceneNode *node = irr_driver->addMesh(objects[0].m_mesh,
+                                                          "static_object");
+            node->setPosition(objects[0].m_xyz);
+            node->setRotation(objects[0].m_hpr);
+            node->setScale(objects[0].m_scale);
+            setStaticShadowCaster(node);
+            m_all_nodes.push_back(node);
+            continue;
+        }
+
+        scene::CBatchingMesh *merged_mesh = new scene::CBatchingMesh();
+        for (unsigned int j = 0; j < objects.size(); j++)
+        {
+            merged_mesh->addMesh(objects[j].m_mesh, objects[j].m_xyz,
+                                 objects[j].m_hpr, objects[j].m_scale);
+        }
+        merged_mesh->finalize();
+        scene::ISceneNode *node = irr_driver->addMesh(merged_mesh,
+                                                      "merged_static_objects");
+        setStaticShadowCaster(node);
+#ifdef DEBUG
+        std::string debug_name = StringUtils::toString(objects.size())
+                               + " merged static track-objects";
+        node->setName(debug_name.c_str());
+#endif
+        // Like the main track mesh, the only reference left after the node
+        // is removed is the one from creating the mesh.
+        m_all_cached_meshes.push_back(merged_mesh);
+        irr_driver->grabAllTextures(merged_mesh);
+        m_all_nodes.push_back(node);
+    }
+
     // This will (at this stage) only convert the main track model.
     for(unsigned int i=0; i<m_all_nodes.size(); i++)
     {
@@ -1492,6 +1805,7 @@ void Track::update(float dt)
         m_animated_textures[i]->update(dt);
     }
     CheckManager::get()->update(dt);
+    TriggerManager::get()->update(dt);
     ItemManager::get()->update(dt);
     Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
     script_engine->runScript("update");
@@ -1501,14 +1815,16 @@ void Track::update(float dt)
 /** Handles an explosion, i.e. it makes sure that all physical objects are
  *  affected accordingly.
  *  \param pos  Position of the explosion.
+ *  \param radius Radius in which objects are affected by the explosion.
  *  \param obj  If the hit was a physical object, this object will be affected
  *              more. Otherwise this is NULL.
  *  \param secondary_hits True if items that are not directly hit should
  *         also be affected. */
-void Track::handleExplosion(const Vec3 &pos, const PhysicalObject *obj,
+void Track::handleExplosion(const Vec3 &pos, float radius,
+                            const PhysicalObject *obj,
                             bool secondary_hits) const
 {
-    m_track_object_manager->handleExplosion(pos, obj, secondary_hits);
+    m_track_object_manager->handleExplosion(pos, radius, obj, secondary_hits);
 }   // handleExplosion
 
 // ----------------------------------------------------------------------------
@@ -1611,6 +1927,9 @@ void Track::createWater(const XMLNode &node)
  */
 void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 {
+    MemoryTracker::ScopedTag memory_tag(MemoryTracker::TAG_SCENE_LOADING);
+    LoadProfiler::start(m_ident);
+    ensureInfoLoaded();
     // Use m_filename to also get the path, not only the identifier
     irr_driver->setTextureErrorMessage("While loading track '%s'",
                                        m_filename                  );
@@ -1619,6 +1938,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         reverse_track = false;
     }
     CheckManager::create();
+    TriggerManager::create();
     assert(m_all_cached_meshes.size()==0);
     if(UserConfigParams::logMemory())
     {
@@ -1687,6 +2007,23 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         (void)e;
     }
 
+    // Decode the textures of the track on all cores, before the models
+    // that use them are loaded. Without graphics only dummy textures are
+    // created anyway.
+    if (!ProfileWorld::isNoGraphics())
+    {
+        // The textures might have been decoded while the results of the
+        // previous race were shown, see preloadTextures()
+        TexturePrefetcher *prefetcher =
+                                   TexturePrefetcher::takePreloaded(m_root);
+        LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_TEXTURES);
+        if (!prefetcher)
+            prefetcher = new TexturePrefetcher(m_root,
+                                           UserConfigParams::m_loading_threads);
+        prefetcher->run(0.0f, 0.5f);
+        delete prefetcher;
+    }
+
     // Load the graph only now: this function is called from world, after
     // the race gui was created. The race gui is needed since it stores
     // the information about the size of the texture to render the mini
@@ -1714,6 +2051,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         std::ostringstream msg;
         msg<< "No track model defined in '"<<path
            <<"', aborting.";
+        LoadProfiler::stop();
         throw std::runtime_error(msg.str());
     }
 
@@ -1737,9 +2075,11 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     }
 
     // we need to check for fog before loading the main track model
+    m_shadow_splits.clear();
     if (const XMLNode *node = root->getNode("sun"))
     {
         node->get("xyz",           &m_sun_position );
+        node->get("shadow-splits", &m_shadow_splits);
         node->get("ambient",       &m_default_ambient_color);
         node->get("sun-specular",  &m_sun_specular_color);
         node->get("sun-diffuse",   &m_sun_diffuse_color);
@@ -1762,6 +2102,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 
     loadMainTrack(*root);
     unsigned int main_track_count = (unsigned int)m_all_nodes.size();
+    GUIEngine::setLoadingProgress(0.7f);
 
     ModelDefinitionLoader model_def_loader(this);
 
@@ -1779,7 +2120,11 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         }
     }
 
-    loadObjects(root, path, model_def_loader, true, NULL);
+    {
+        LoadProfiler::ScopedStage stage(LoadProfiler::STAGE_OBJECTS);
+        loadObjects(root, path, model_def_loader, true, NULL);
+    }
+    GUIEngine::setLoadingProgress(0.85f);
 
     model_def_loader.cleanLibraryNodesAfterLoad();
 
@@ -1889,7 +2234,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 
 
     createPhysicsModel(main_track_count);
-
+    GUIEngine::setLoadingProgress(0.95f);
 
     for (unsigned int i=0; i<root->getNumNodes(); i++)
     {
@@ -1944,7 +2289,12 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         easter_world->readData(dir+"/easter_eggs.xml");
     }
 
+    // The meshes used again are referenced by m_all_cached_meshes now
+    releaseWarmMeshes();
+
+    GUIEngine::setLoadingProgress(-1.0f);
     irr_driver->unsetTextureErrorMessage();
+    LoadProfiler::stop();
 }   // loadTrackModel
 
 //-----------------------------------------------------------------------------
@@ -2338,43 +2688,135 @@ bool Track::setTerrainHeight(Vec3 *pos) const
 }   // setTerrainHeight
 
 // ----------------------------------------------------------------------------
+namespace
+{
+    /** Must be increased if the way the height map is computed changes. */
+    const uint32_t HEIGHT_MAP_CACHE_VERSION = 1;
+
+    /** Header of a cached height map, followed by the heights. */
+    struct HeightMapCacheHeader
+    {
+        uint32_t m_version;
+        uint32_t m_resolution;
+        float    m_min_x, m_min_z, m_max_x, m_max_z;
+    };   // HeightMapCacheHeader
+}   // namespace
 
-std::vector< std::vector<float> > Track::buildHeightMap()
+// ----------------------------------------------------------------------------
+/** Returns the name of the cached height map, which depends on the geometry
+ *  of the track (not its name), so that a modified track gets a new one.
+ */
+std::string Track::getHeightMapCacheFile() const
 {
-    std::vector< std::vector<float> > out(HEIGHT_MAP_RESOLUTION);
+    const uint64_t hash = m_track_mesh->getGeometryHash();
+    char name[32];
+    sprintf(name, "%08x%08x.hmap", (unsigned)(hash >> 32), (unsigned)hash);
+    return file_manager->getHeightMapCacheLocation(name);
+}   // getHeightMapCacheFile
+
+// ----------------------------------------------------------------------------
+/** Loads a height map saved by saveHeightMap.
+ *  \param cache_file Name of the cached height map.
+ *  \return True if the height map was loaded.
+ */
+bool Track::loadCachedHeightMap(const std::string &cache_file)
+{
+    const size_t num = HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION;
+    MappedFile file(cache_file);
+    if (!file.isValid() ||
+        file.getSize() != sizeof(HeightMapCacheHeader) + num*sizeof(float))
+        return false;
+    const HeightMapCacheHeader *header =
+        (const HeightMapCacheHeader*)file.getData();
+    if (header->m_version    != HEIGHT_MAP_CACHE_VERSION  ||
+        header->m_resolution != HEIGHT_MAP_RESOLUTION     ||
+        header->m_min_x      != m_aabb_min.getX()         ||
+        header->m_min_z      != m_aabb_min.getZ()         ||
+        header->m_max_x      != m_aabb_max.getX()         ||
+        header->m_max_z      != m_aabb_max.getZ()            )
+        return false;
+    const float *heights = (const float*)(header + 1);
+    m_height_map.assign(heights, heights + num);
+    return true;
+}   // loadCachedHeightMap
+
+// ----------------------------------------------------------------------------
+/** Saves the height map, so that it does not need to be computed the next
+ *  time this track is used.
+ *  \param cache_file Name of the cached height map.
+ */
+void Track::saveHeightMap(const std::string &cache_file) const
+{
+    HeightMapCacheHeader header;
+    header.m_version    = HEIGHT_MAP_CACHE_VERSION;
+    header.m_resolution = HEIGHT_MAP_RESOLUTION;
+    header.m_min_x      = m_aabb_min.getX();
+    header.m_min_z      = m_aabb_min.getZ();
+    header.m_max_x      = m_aabb_max.getX();
+    header.m_max_z      = m_aabb_max.getZ();
+    std::ofstream out(cache_file.c_str(), std::ios::out | std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)m_height_map.data(),
+              m_height_map.size()*sizeof(float));
+    if (out.fail())
+        Log::warn("track", "Could not cache height map in '%s'.",
+                  cache_file.c_str());
+}   // saveHeightMap
+
+// ----------------------------------------------------------------------------
+/** Returns the height of the track on a regular grid covering its bounding
+ *  box. The height map needs HEIGHT_MAP_RESOLUTION^2 raycasts, so it is
+ *  only computed once per race, even if several karts have sky particles.
+ *  The raycasts are done in parallel by the job system, and the result is
+ *  cached on disk.
+ */
+const std::vector<float>& Track::getHeightMap()
+{
+    if (!m_height_map.empty())
+        return m_height_map;
+
+    const std::string cache_file = getHeightMapCacheFile();
+    if (loadCachedHeightMap(cache_file))
+        return m_height_map;
+
+    std::vector<float> &out = m_height_map;
+    out.resize(HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION);
 
-    float x = m_aabb_min.getX();
     const float x_len = m_aabb_max.getX() - m_aabb_min.getX();
     const float z_len = m_aabb_max.getZ() - m_aabb_min.getZ();
 
     const float x_step = x_len/HEIGHT_MAP_RESOLUTION;
     const float z_step = z_len/HEIGHT_MAP_RESOLUTION;
 
-    btVector3 hitpoint;
-    const Material* material;
-    btVector3 normal;
-
-    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+    // Raycasts only read the collision shape, so each job does some rows
+    JobSystem::get()->parallelFor(0, HEIGHT_MAP_RESOLUTION, 8,
+                                  [&](int begin, int end)
     {
-        out[i].resize(HEIGHT_MAP_RESOLUTION);
-        float z = m_aabb_min.getZ();
-
-        for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
+        btVector3 hitpoint;
+        const Material* material;
+        btVector3 normal;
+        for (int i=begin; i<end; i++)
         {
-            btVector3 pos(x, 100.0f, z);
-            btVector3 to = pos;
-            to.setY(-100000.f);
-
-            m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
-            z += z_step;
-
-            out[i][j] = hitpoint.getY();
-        }   // j<HEIGHT_MAP_RESOLUTION
-        x += x_step;
-    }
-
+            const float x = m_aabb_min.getX() + i*x_step;
+            for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
+            {
+                btVector3 pos(x, 100.0f, m_aabb_min.getZ() + j*z_step);
+                btVector3 to = pos;
+                to.setY(-100000.f);
+
+                // Where no terrain is found, particles are only removed
+                // at the bottom of the track.
+                out[i*HEIGHT_MAP_RESOLUTION + j] =
+                    m_track_mesh->castRay(pos, to, &hitpoint, &material,
+                                          &normal)
+                    ? hitpoint.getY() : m_aabb_min.getY();
+            }   // j<HEIGHT_MAP_RESOLUTION
+        }   // for i
+    });
+
+    saveHeightMap(cache_file);
     return out;
-}   // buildHeightMap
+}   // getHeightMap
 
 // ----------------------------------------------------------------------------
 /** Returns the rotation of the sun. */
@@ -58,6 +58,7 @@ class ParticleKind;
 class PhysicalObject;
 class TrackObjectManager;
 class TriangleMesh;
+class UTFWriter;
 class World;
 class XMLNode;
 namespace Scripting
@@ -201,6 +202,19 @@ private:
       */
     std::vector<scene::IMesh*>      m_detached_cached_meshes;
 
+    /** Meshes loaded from a file which are kept loaded after a race, so
+     *  that loading this track again does not read them from disk. Each
+     *  entry keeps the references of an entry of m_all_cached_meshes, i.e.
+     *  of the mesh and its textures. They are released once the track is
+     *  loaded again, or if the memory used is over the budget. */
+    std::vector<scene::IMesh*>      m_warm_meshes;
+
+    /** Estimated memory used by m_warm_meshes. */
+    size_t                          m_warm_bytes;
+
+    /** All tracks with warm meshes, least recently used first. */
+    static std::vector<Track*>      m_warm_tracks;
+
     /** A list of all textures loaded by the track, so that they can
      *  be removed from the cache at cleanup time. */
     std::vector<video::ITexture*>   m_all_cached_textures;
@@ -209,6 +223,10 @@ private:
      * for the overworld to keep its textures loaded. */
     bool m_materials_loaded;
 
+    /** False if only the data shown in the menus was read from the track
+     *  index, in which case track.xml is parsed in ensureInfoLoaded(). */
+    bool m_info_loaded;
+
     /** True if this track (textures and track data) should be cached. Used
      *  for the overworld. */
     bool m_cache_track;
@@ -315,6 +333,12 @@ private:
     /** Particles emitted from the sky (wheather) */
     ParticleKind*            m_sky_particles;
 
+    /** Height of the track on a HEIGHT_MAP_RESOLUTION^2 grid, used by the
+     *  sky particles. The height at (i, j) (i in x direction) is stored at
+     *  i*HEIGHT_MAP_RESOLUTION+j. It is built the first time it is
+     *  requested and shared by the particle emitters of all local players. */
+    std::vector<float>       m_height_map;
+
     /** Use a special built-in wheather */
     bool                     m_weather_lightning;
     std::string              m_weather_sound;
@@ -396,6 +420,10 @@ private:
 
     bool m_shadows;
 
+    /** The distances at which the shadow cascades start, followed by the
+     *  end of the last cascade. Empty to use the default distances. */
+    std::vector<float> m_shadow_splits;
+
     float m_displacement_speed;
     float m_caustics_speed;
 
@@ -416,6 +444,7 @@ private:
     int m_actual_number_of_laps;
 
     void loadTrackInfo();
+    bool loadIndexEntry(const XMLNode &node);
     void loadQuadGraph(unsigned int mode_id, const bool reverse);
     void convertTrackToBullet(scene::ISceneNode *node);
     bool loadMainTrack(const XMLNode &node);
@@ -424,6 +453,14 @@ private:
                              std::vector<MusicInformation*>& m_music   );
     void loadCurves(const XMLNode &node);
     void handleSky(const XMLNode &root, const std::string &filename);
+    std::string getHeightMapCacheFile() const;
+    bool loadCachedHeightMap(const std::string &cache_file);
+    void saveHeightMap(const std::string &cache_file) const;
+    void releaseWarmMeshes();
+    static void evictWarmTracks();
+
+    /** Size of the squares in which static objects are merged. */
+    static const float STATIC_CHUNK_SIZE;
 
 public:
 
@@ -432,10 +469,14 @@ public:
 
     static const float NOHIT;
 
-                       Track             (const std::string &filename);
+                       Track             (const std::string &filename,
+                                          const XMLNode *index_entry=NULL);
                       ~Track             ();
     void               cleanup           ();
+    void               ensureInfoLoaded  ();
+    void               saveIndexEntry    (UTFWriter &out) const;
     void               removeCachedData  ();
+    void               preloadTextures   ();
     void               startMusic        () const;
 
     bool               setTerrainHeight(Vec3 *pos) const;
@@ -453,14 +494,14 @@ public:
     /** Sets the current ambient color for a kart with index k. */
     void               setAmbientColor(const video::SColor &color,
                                        unsigned int k);
-    void               handleExplosion(const Vec3 &pos,
+    void               handleExplosion(const Vec3 &pos, float radius,
                                        const PhysicalObject *mp,
                                        bool secondary_hits=true) const;
     void               loadTrackModel  (bool reverse_track = false,
                                         unsigned int mode_id=0);
     bool findGround(AbstractKart *kart);
 
-    std::vector< std::vector<float> > buildHeightMap();
+    const std::vector<float>& getHeightMap();
     // ------------------------------------------------------------------------
     /** Returns the texture with the mini map for this track. */
     const video::ITexture*    getOldRttMiniMap() const { return m_old_rtt_mini_map; }
@@ -654,6 +695,13 @@ public:
     // ------------------------------------------------------------------------
     bool hasShadows() const { return m_shadows; }
     // ------------------------------------------------------------------------
+    /** Returns the split distances of the shadow cascades, see
+     *  ShadowCascades. Empty if the default distances are used. */
+    const std::vector<float> &getShadowSplits() const
+    {
+        return m_shadow_splits;
+    }   // getShadowSplits
+    // ------------------------------------------------------------------------
     void addNode(scene::ISceneNode* node) { m_all_nodes.push_back(node); }
     // ------------------------------------------------------------------------
     void addPhysicsOnlyNode(scene::ISceneNode* node)
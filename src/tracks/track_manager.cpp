@@ -20,8 +20,11 @@
 
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
+#include "io/content_index.hpp"
 #include "io/file_manager.hpp"
+#include "io/utf_writer.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -32,6 +35,9 @@
 TrackManager* track_manager = 0;
 std::vector<std::string>  TrackManager::m_track_search_path;
 
+/** Version of the track index file. Increase it if the format changes. */
+static const int TRACK_INDEX_VERSION = 1;
+
 /** Constructor (currently empty). The real work happens in loadTrackList.
  */
 TrackManager::TrackManager()
@@ -132,7 +138,11 @@ std::vector<std::string> TrackManager::getAllTrackIdentifiers()
 }   // getAllTrackNames
 
 //-----------------------------------------------------------------------------
-/** Loads all tracks from the track directory (data/track).
+/** Loads all tracks from the track directory (data/track). To avoid parsing
+ *  all track.xml files at startup, the data needed in the menus is taken
+ *  from the track index (track_index.xml in the config directory) for all
+ *  tracks that were not modified since the index was written. The index is
+ *  updated afterwards.
  */
 void TrackManager::loadTrackList()
 {
@@ -146,6 +156,24 @@ void TrackManager::loadTrackList()
     m_track_avail.clear();
     m_tracks.clear();
 
+    const std::string index_file =
+        file_manager->getUserConfigFile("track_index.xml");
+    XMLNode *index = NULL;
+    if(file_manager->fileExists(index_file))
+        index = file_manager->createXMLTree(index_file);
+    int version = 0;
+    if(index && index->getName()=="track-index" &&
+       index->get("version", &version) && version==TRACK_INDEX_VERSION)
+    {
+        for(unsigned int i=0; i<index->getNumNodes(); i++)
+        {
+            const XMLNode *entry = index->getNode(i);
+            core::stringw file;
+            if(entry->getAndDecode("file", &file))
+                m_index_entries[core::stringc(file).c_str()] = entry;
+        }
+    }
+
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
@@ -157,7 +185,8 @@ void TrackManager::loadTrackList()
         // Then see if a subdir of this dir contains tracks
         // ------------------------------------------------
         std::set<std::string> dirs;
-        file_manager->listFiles(dirs, dir);
+        if(!ContentIndex::listFiles(&dirs, dir))
+            file_manager->listFiles(dirs, dir);
         for(std::set<std::string>::iterator subdir = dirs.begin();
             subdir != dirs.end(); subdir++)
         {
@@ -165,8 +194,41 @@ void TrackManager::loadTrackList()
             loadTrack(dir+*subdir+"/");
         }   // for dir in dirs
     }   // for i <m_track_search_path.size()
+
+    m_index_entries.clear();
+    delete index;
+    saveTrackIndex();
 }  // loadTrackList
 
+// ----------------------------------------------------------------------------
+/** Writes the track index with the menu data of all loaded tracks.
+ */
+void TrackManager::saveTrackIndex() const
+{
+    const std::string filename =
+        file_manager->getUserConfigFile("track_index.xml");
+    try
+    {
+        UTFWriter index_file(filename.c_str());
+        index_file << L"<?xml version=\"1.0\"?>\n";
+        index_file << L"<track-index version=\"" << TRACK_INDEX_VERSION
+                   << L"\">\n";
+        for(Tracks::const_iterator i = m_tracks.begin();
+            i != m_tracks.end(); ++i)
+        {
+            (*i)->saveIndexEntry(index_file);
+        }
+        index_file << L"</track-index>\n";
+        index_file.close();
+    }
+    catch (std::runtime_error& e)
+    {
+        Log::error("TrackManager", "Failed to write track index to %s.",
+                   filename.c_str());
+        Log::error("TrackManager", "Error: %s", e.what());
+    }
+}   // saveTrackIndex
+
 // ----------------------------------------------------------------------------
 /** Tries to load a track from a single directory. Returns true if a track was
  *  successfully loaded.
@@ -180,9 +242,12 @@ bool TrackManager::loadTrack(const std::string& dirname)
 
     Track *track;
 
+    std::map<std::string, const XMLNode*>::const_iterator entry =
+        m_index_entries.find(config_file);
     try
     {
-        track = new Track(config_file);
+        track = new Track(config_file, entry==m_index_entries.end()
+                                       ? NULL : entry->second);
     }
     catch (std::exception& e)
     {
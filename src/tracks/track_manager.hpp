@@ -24,6 +24,7 @@
 #include <map>
 
 class Track;
+class XMLNode;
 
 /**
   * \brief Simple class to load and manage track data, track names and such
@@ -67,13 +68,25 @@ private:
      */
     std::vector<bool>                        m_track_avail;
 
+    /** The entries of the track index, indexed by the name of the track.xml
+     *  file. Only used while loadTrackList() is running. */
+    std::map<std::string, const XMLNode*>    m_index_entries;
+
     void          updateGroups(const Track* track);
+    void          saveTrackIndex() const;
 
 public:
                 TrackManager();
                ~TrackManager();
 
     static void addTrackSearchDir(const std::string &dir);
+    // ------------------------------------------------------------------------
+    /** Returns all directories in which tracks are searched. */
+    static const std::vector<std::string> &getTrackSearchDirs()
+    {
+        return m_track_search_path;
+    }   // getTrackSearchDirs
+    // ------------------------------------------------------------------------
     /** Returns a list of all track identifiers. */
     std::vector<std::string> getAllTrackIdentifiers();
 
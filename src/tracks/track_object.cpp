@@ -307,6 +307,19 @@ void TrackObject::update(float dt)
     if (m_animator) m_animator->update(dt);
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Returns true if update() has any effect on this object, i.e. if it is
+ *  animated, moved by the physics, or has a presentation that changes each
+ *  frame. Most objects of a track are static, so the track object manager
+ *  only updates the ones for which this returns true.
+ */
+bool TrackObject::needsUpdate() const
+{
+    if (m_animator) return true;
+    if (m_physical_object && m_physical_object->isDynamic()) return true;
+    return m_presentation && m_presentation->needsUpdate();
+}   // needsUpdate
+
 
 // ----------------------------------------------------------------------------
 /** Does a raycast against the track object. The object must have a physical
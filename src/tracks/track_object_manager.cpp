@@ -23,7 +23,9 @@
 #include "graphics/lod_node.hpp"
 #include "graphics/material_manager.hpp"
 #include "io/xml_node.hpp"
+#include "modes/world.hpp"
 #include "physics/physical_object.hpp"
+#include "physics/physics.hpp"
 #include "tracks/track_object.hpp"
 #include "utils/log.hpp"
 
@@ -52,6 +54,8 @@ void TrackObjectManager::add(const XMLNode &xml_node, scene::ISceneNode* parent,
         m_all_objects.push_back(obj);
         if(obj->isDriveable())
             m_driveable_objects.push_back(obj);
+        if(obj->needsUpdate())
+            m_updated_objects.push_back(obj);
     }
     catch (std::exception& e)
     {
@@ -172,33 +176,45 @@ TrackObject* TrackObjectManager::getTrackObject(std::string name)
     return NULL;
 }
 /** Handles an explosion, i.e. it makes sure that all physical objects are
- *  affected accordingly.
+ *  affected accordingly. Only the objects close to the explosion are found
+ *  using the broadphase of the physics, instead of testing all objects.
  *  \param pos  Position of the explosion.
+ *  \param radius Objects further away than this are not affected (unless
+ *         directly hit).
  *  \param obj  If the hit was a physical object, this object will be affected
  *              more. Otherwise this is NULL.
  *  \param secondary_hits True if items that are not directly hit should
  *         also be affected.
  */
 
-void TrackObjectManager::handleExplosion(const Vec3 &pos, const PhysicalObject *mp,
+void TrackObjectManager::handleExplosion(const Vec3 &pos, float radius,
+                                         const PhysicalObject *mp,
                                          bool secondary_hits)
 {
-    TrackObject* curr;
-    for_in (curr, m_all_objects)
+    if(mp)
+        mp->getTrackObject()->handleExplosion(pos, /*direct_hit*/true);
+    if(!secondary_hits)
+        return;
+
+    std::vector<PhysicalObject*> objects;
+    World::getWorld()->getPhysics()->getPhysicalObjectsInSphere(pos, radius,
+                                                                &objects);
+    for(unsigned int i=0; i<objects.size(); i++)
     {
-        if(secondary_hits || mp == curr->getPhysicalObject())
-            curr->handleExplosion(pos, mp == curr->getPhysicalObject());
+        if(objects[i] != mp)
+            objects[i]->getTrackObject()->handleExplosion(pos, false);
     }
 }   // handleExplosion
 
 // ----------------------------------------------------------------------------
-/** Updates all track objects.
+/** Updates all track objects that can change (see
+ *  TrackObject::needsUpdate).
  *  \param dt Time step size.
  */
 void TrackObjectManager::update(float dt)
 {
     TrackObject* curr;
-    for_in (curr, m_all_objects)
+    for_in (curr, m_updated_objects)
     {
         curr->update(dt);
     }
@@ -329,7 +345,9 @@ void TrackObjectManager::enableFog(bool enable)
 void TrackObjectManager::insertObject(TrackObject* object)
 {
     m_all_objects.push_back(object);
-}
+    if (object->needsUpdate())
+        m_updated_objects.push_back(object);
+}   // insertObject
 
 // ----------------------------------------------------------------------------
 /** Removes the object from the scene graph, bullet, and the list of
@@ -339,6 +357,8 @@ void TrackObjectManager::insertObject(TrackObject* object)
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
     m_all_objects.remove(obj);
+    m_updated_objects.remove(obj);
+    m_driveable_objects.remove(obj);
     delete obj;
 }   // removeObject
 
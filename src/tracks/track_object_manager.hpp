@@ -51,6 +51,11 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** The objects that need to be updated each frame. Most objects are
+     *  static, so this keeps the cost of update() independent of the size
+     *  of the track. */
+    PtrVector<TrackObject, REF> m_updated_objects;
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
@@ -59,8 +64,8 @@ public:
     void add(const XMLNode &xml_node, scene::ISceneNode* parent,
              ModelDefinitionLoader& model_def_loader);
     void update(float dt);
-    void handleExplosion(const Vec3 &pos, const PhysicalObject *mp,
-                         bool secondary_hits=true);
+    void handleExplosion(const Vec3 &pos, float radius,
+                         const PhysicalObject *mp, bool secondary_hits=true);
 	void disable(std::string name);
 	void enable (std::string name);
 	bool getStatus(std::string name);
@@ -33,7 +33,6 @@
 #include "input/device_manager.hpp"
 #include "input/input_device.hpp"
 #include "input/input_manager.hpp"
-#include "items/item_manager.hpp"
 #include "modes/world.hpp"
 #include "scriptengine/script_engine.hpp"
 #include "states_screens/dialogs/race_paused_dialog.hpp"
@@ -42,6 +41,7 @@
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "tracks/track_object_manager.hpp"
+#include "tracks/trigger_manager.hpp"
 
 #include <IBillboardSceneNode.h>
 #include <ICameraSceneNode.h>
@@ -602,30 +602,18 @@ TrackObjectPresentationSound::TrackObjectPresentationSound(
 
     if (trigger_when_near)
     {
-        ItemManager::get()->newItem(m_init_xyz, trigger_distance, this);
+        TriggerManager::get()->addTrigger(m_init_xyz, trigger_distance, this);
     }
 }   // TrackObjectPresentationSound
 
 // ----------------------------------------------------------------------------
-void TrackObjectPresentationSound::update(float dt)
-{
-    if (m_sound != NULL)
-    {
-        // muting when too far is implemented manually since not supported by
-        // OpenAL so need to call this every frame to update the muting state
-        // if listener moved
-        m_sound->setPosition(m_xyz);
-    }
-}   // update
-
-// ----------------------------------------------------------------------------
-void TrackObjectPresentationSound::onTriggerItemApproached(Item* who)
+void TrackObjectPresentationSound::onTriggerEnter(AbstractKart *kart)
 {
     if (m_sound != NULL && m_sound->getStatus() != SFXBase::SFX_PLAYING)
     {
         m_sound->play();
     }
-}   // onTriggerItemApproached
+}   // onTriggerEnter
 
 // ----------------------------------------------------------------------------
 void TrackObjectPresentationSound::triggerSound(bool loop)
@@ -646,6 +634,10 @@ void TrackObjectPresentationSound::stopSound()
 // ----------------------------------------------------------------------------
 TrackObjectPresentationSound::~TrackObjectPresentationSound()
 {
+    // The trigger manager is destroyed before the track objects at the end
+    // of a race
+    if (TriggerManager::get())
+        TriggerManager::get()->removeTriggers(this);
     if (m_sound)
     {
         m_sound->deleteSFX();
@@ -871,7 +863,7 @@ TrackObjectPresentationActionTrigger::TrackObjectPresentationActionTrigger(
     if (m_action.size() == 0)
         Log::warn("TrackObject", "Action-trigger has no action defined.");
 
-    ItemManager::get()->newItem(m_init_xyz, trigger_distance, this);
+    TriggerManager::get()->addTrigger(m_init_xyz, trigger_distance, this);
 }   // TrackObjectPresentationActionTrigger
 
 // ----------------------------------------------------------------------------
@@ -887,11 +879,18 @@ TrackObjectPresentationActionTrigger::TrackObjectPresentationActionTrigger(
     float trigger_distance = distance;
     m_action               = script_name;
     m_action_active        = true;
-    ItemManager::get()->newItem(m_init_xyz, trigger_distance, this);
+    TriggerManager::get()->addTrigger(m_init_xyz, trigger_distance, this);
 }   // TrackObjectPresentationActionTrigger
 
 // ----------------------------------------------------------------------------
-void TrackObjectPresentationActionTrigger::onTriggerItemApproached(Item* who)
+TrackObjectPresentationActionTrigger::~TrackObjectPresentationActionTrigger()
+{
+    if (TriggerManager::get())
+        TriggerManager::get()->removeTriggers(this);
+}   // ~TrackObjectPresentationActionTrigger
+
+// ----------------------------------------------------------------------------
+void TrackObjectPresentationActionTrigger::onTriggerEnter(AbstractKart *kart)
 {
     if (!m_action_active) return;
 
@@ -1057,4 +1056,4 @@ void TrackObjectPresentationActionTrigger::onTriggerItemApproached(Item* who)
         
          */
     }
-}   // onTriggerItemApproached
+}   // onTriggerEnter
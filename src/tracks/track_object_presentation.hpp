@@ -21,8 +21,9 @@
 #define HEADER_TRACK_OBJECT_PRESENTATION_HPP
 
 #include "graphics/lod_node.hpp"
-#include "items/item.hpp"
+#include "tracks/trigger_manager.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/vec3.hpp"
 
@@ -81,6 +82,10 @@ public:
     virtual void reset() {}
     virtual void setEnable(bool enabled) {}
     virtual void update(float dt) {}
+    // ------------------------------------------------------------------------
+    /** Returns true if update() must be called each frame. */
+    virtual bool needsUpdate() const { return false; }
+    // ------------------------------------------------------------------------
     virtual void move(const core::vector3df& xyz, const core::vector3df& hpr,
         const core::vector3df& scale, bool isAbsoluteCoord) {}
 
@@ -243,7 +248,7 @@ public:
  *  A track object representation that consists of a sound emitter
  */
 class TrackObjectPresentationSound : public TrackObjectPresentation,
-                                     public TriggerItemListener
+                                     public TriggerListener
 {
 private:
 
@@ -261,8 +266,7 @@ public:
     TrackObjectPresentationSound(const XMLNode& xml_node,
                                  scene::ISceneNode* parent);
     virtual ~TrackObjectPresentationSound();
-    virtual void onTriggerItemApproached(Item* who) OVERRIDE;
-    virtual void update(float dt) OVERRIDE;
+    virtual void onTriggerEnter(AbstractKart *kart) OVERRIDE;
     virtual void move(const core::vector3df& xyz, const core::vector3df& hpr,
         const core::vector3df& scale, bool isAbsoluteCoord) OVERRIDE;
     void triggerSound(bool loop);
@@ -291,6 +295,7 @@ public:
                                      scene::ISceneNode* parent);
     virtual ~TrackObjectPresentationBillboard();
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE { return true; }
 };   // TrackObjectPresentationBillboard
 
 
@@ -311,6 +316,7 @@ public:
     virtual ~TrackObjectPresentationParticles();
 
     virtual void update(float dt) OVERRIDE;
+    virtual bool needsUpdate() const OVERRIDE { return true; }
     void triggerParticles();
     // ------------------------------------------------------------------------
     /** Returns the trigger condition for this object. */
@@ -339,7 +345,7 @@ public:
  *  A track object representation that consists of an action trigger
  */
 class TrackObjectPresentationActionTrigger : public TrackObjectPresentation,
-                                             public TriggerItemListener
+                                             public TriggerListener
 {
 private:
     /** For action trigger objects */
@@ -353,9 +359,9 @@ public:
                                          const std::string& scriptname,
                                          float distance);
 
-    virtual ~TrackObjectPresentationActionTrigger() {}
+    virtual ~TrackObjectPresentationActionTrigger();
 
-    virtual void onTriggerItemApproached(Item* who) OVERRIDE;
+    virtual void onTriggerEnter(AbstractKart *kart) OVERRIDE;
     // ------------------------------------------------------------------------
     /** Reset the trigger (i.e. sets it to active again). */
     virtual void reset() OVERRIDE { m_action_active = true; }
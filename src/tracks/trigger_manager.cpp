@@ -0,0 +1,273 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "tracks/trigger_manager.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
+#include "network/network_manager.hpp"
+#include "network/network_world.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <math.h>
+#include <rect.h>
+
+TriggerManager *TriggerManager::m_trigger_manager = NULL;
+
+// ----------------------------------------------------------------------------
+TriggerManager::TriggerManager()
+{
+    m_grid_min_x = m_grid_min_z = 0;
+    m_grid_cell_size = 1.0f;
+    m_grid_width = m_grid_height = 0;
+    m_grid_dirty = false;
+}   // TriggerManager
+
+// ----------------------------------------------------------------------------
+/** Adds a trigger volume.
+ *  \param center Center of the trigger.
+ *  \param radius A kart closer than this to the center is inside.
+ *  \param listener The listener which is notified when a kart enters or
+ *         leaves the trigger.
+ *  \return Index of the trigger.
+ */
+unsigned int TriggerManager::addTrigger(const Vec3 &center, float radius,
+                                        TriggerListener *listener)
+{
+    assert(listener);
+    Trigger t;
+    t.m_center   = center;
+    t.m_radius   = radius;
+    t.m_listener = listener;
+    m_all_triggers.push_back(t);
+    m_grid_dirty = true;
+    return (unsigned int)m_all_triggers.size() - 1;
+}   // addTrigger
+
+// ----------------------------------------------------------------------------
+/** Removes all triggers of a listener, which must be done before the
+ *  listener is deleted. The indices of the other triggers do not change.
+ *  \param listener The listener whose triggers are removed.
+ */
+void TriggerManager::removeTriggers(const TriggerListener *listener)
+{
+    for (unsigned int i = 0; i < m_all_triggers.size(); i++)
+    {
+        if (m_all_triggers[i].m_listener == listener)
+        {
+            m_all_triggers[i].m_listener = NULL;
+            m_grid_dirty = true;
+        }
+    }
+}   // removeTriggers
+
+// ----------------------------------------------------------------------------
+/** Called when a race is (re)started. All karts are considered to be
+ *  outside of all triggers, without notifying the listeners.
+ */
+void TriggerManager::reset()
+{
+    m_inside.clear();
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Creates the grid of all triggers. The cell size is chosen so that there
+ *  is roughly one cell per trigger.
+ */
+void TriggerManager::buildGrid()
+{
+    m_grid_dirty = false;
+    m_grid_start.clear();
+    m_grid_triggers.clear();
+    m_grid_width = m_grid_height = 0;
+
+    std::vector<core::rectf> boxes(m_all_triggers.size());
+    core::rectf all;
+    unsigned int num_active = 0;
+    for (unsigned int i = 0; i < m_all_triggers.size(); i++)
+    {
+        const Trigger &t = m_all_triggers[i];
+        if (!t.m_listener) continue;
+        boxes[i] = core::rectf(t.m_center.getX() - t.m_radius,
+                               t.m_center.getZ() - t.m_radius,
+                               t.m_center.getX() + t.m_radius,
+                               t.m_center.getZ() + t.m_radius);
+        if (num_active == 0)
+            all = boxes[i];
+        else
+        {
+            all.addInternalPoint(boxes[i].UpperLeftCorner);
+            all.addInternalPoint(boxes[i].LowerRightCorner);
+        }
+        num_active++;
+    }
+    if (num_active == 0)
+        return;
+
+    const float width  = all.getWidth();
+    const float height = all.getHeight();
+    m_grid_cell_size = sqrtf(width*height / num_active);
+    // Avoid tiny cells, and limit the size of the grid.
+    m_grid_cell_size = std::max(m_grid_cell_size, 4.0f);
+    m_grid_cell_size = std::max(m_grid_cell_size,
+                                std::max(width, height) / 256.0f);
+    m_grid_min_x  = all.UpperLeftCorner.X;
+    m_grid_min_z  = all.UpperLeftCorner.Y;
+    m_grid_width  = (int)(width  / m_grid_cell_size) + 1;
+    m_grid_height = (int)(height / m_grid_cell_size) + 1;
+    const unsigned int num_cells = m_grid_width * m_grid_height;
+
+    // First count the triggers in each cell, then store them
+    std::vector<unsigned int> count(num_cells, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (unsigned int i = 0; i < m_all_triggers.size(); i++)
+        {
+            if (!m_all_triggers[i].m_listener) continue;
+            int x0, z0, x1, z1;
+            getGridCell(boxes[i].UpperLeftCorner.X,
+                        boxes[i].UpperLeftCorner.Y,  &x0, &z0);
+            getGridCell(boxes[i].LowerRightCorner.X,
+                        boxes[i].LowerRightCorner.Y, &x1, &z1);
+            for (int z = z0; z <= z1; z++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    const unsigned int cell = z*m_grid_width + x;
+                    if (pass == 0)
+                        count[cell]++;
+                    else
+                        m_grid_triggers[m_grid_start[cell]+count[cell]++] = i;
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            m_grid_start.resize(num_cells + 1);
+            m_grid_start[0] = 0;
+            for (unsigned int c = 0; c < num_cells; c++)
+            {
+                m_grid_start[c + 1] = m_grid_start[c] + count[c];
+                count[c] = 0;
+            }
+            m_grid_triggers.resize(m_grid_start[num_cells]);
+        }
+    }
+}   // buildGrid
+
+// ----------------------------------------------------------------------------
+/** Returns the grid cell that contains a point. Points outside of the grid
+ *  are mapped to the closest cell at the border of the grid.
+ */
+void TriggerManager::getGridCell(float x, float z,
+                                 int *cell_x, int *cell_z) const
+{
+    *cell_x = (int)floorf((x - m_grid_min_x) / m_grid_cell_size);
+    *cell_z = (int)floorf((z - m_grid_min_z) / m_grid_cell_size);
+    *cell_x = core::clamp(*cell_x, 0, m_grid_width  - 1);
+    *cell_z = core::clamp(*cell_z, 0, m_grid_height - 1);
+}   // getGridCell
+
+// ----------------------------------------------------------------------------
+/** Determines which triggers each kart is inside, and notifies the
+ *  listeners of the triggers a kart entered or left. The listeners are only
+ *  called once all karts are tested, since they can add or remove triggers
+ *  (e.g. a script creating a new trigger).
+ *  \param dt Time step size.
+ */
+void TriggerManager::update(float dt)
+{
+    // Same as items: in network races triggers are only tested on the server
+    if (NetworkWorld::getInstance()->isRunning() &&
+        !NetworkManager::getInstance()->isServer())
+        return;
+
+    if (m_grid_dirty)
+        buildGrid();
+
+    struct Event
+    {
+        AbstractKart *m_kart;
+        unsigned int  m_trigger;
+        bool          m_enter;
+    };   // Event
+    std::vector<Event> events;
+
+    World *world = World::getWorld();
+    m_inside.resize(world->getNumKarts());
+    std::vector<unsigned int> inside, changed;
+    for (unsigned int k = 0; k < world->getNumKarts(); k++)
+    {
+        AbstractKart *kart = world->getKart(k);
+        inside.clear();
+        if (!kart->isEliminated() && !m_grid_start.empty())
+        {
+            const Vec3 &xyz = kart->getXYZ();
+            int cx, cz;
+            getGridCell(xyz.getX(), xyz.getZ(), &cx, &cz);
+            const unsigned int cell = cz*m_grid_width + cx;
+            for (unsigned int i = m_grid_start[cell];
+                 i < m_grid_start[cell + 1]; i++)
+            {
+                const Trigger &t = m_all_triggers[m_grid_triggers[i]];
+                if ((xyz - t.m_center).length2() < t.m_radius*t.m_radius)
+                    inside.push_back(m_grid_triggers[i]);
+            }
+            // The triggers of a cell are sorted by index
+        }
+
+        std::vector<unsigned int> &previous = m_inside[k];
+        Event e;
+        e.m_kart = kart;
+
+        changed.clear();
+        std::set_difference(inside.begin(), inside.end(),
+                            previous.begin(), previous.end(),
+                            std::back_inserter(changed));
+        e.m_enter = true;
+        for (unsigned int i = 0; i < changed.size(); i++)
+        {
+            e.m_trigger = changed[i];
+            events.push_back(e);
+        }
+
+        changed.clear();
+        std::set_difference(previous.begin(), previous.end(),
+                            inside.begin(), inside.end(),
+                            std::back_inserter(changed));
+        e.m_enter = false;
+        for (unsigned int i = 0; i < changed.size(); i++)
+        {
+            e.m_trigger = changed[i];
+            events.push_back(e);
+        }
+        previous.swap(inside);
+    }   // for k < num karts
+
+    for (unsigned int i = 0; i < events.size(); i++)
+    {
+        // A previous listener might have removed this trigger
+        TriggerListener *listener = m_all_triggers[events[i].m_trigger]
+                                                  .m_listener;
+        if (!listener) continue;
+        if (events[i].m_enter)
+            listener->onTriggerEnter(events[i].m_kart);
+        else
+            listener->onTriggerExit(events[i].m_kart);
+    }
+}   // update
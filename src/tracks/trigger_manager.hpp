@@ -0,0 +1,125 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TRIGGER_MANAGER_HPP
+#define HEADER_TRIGGER_MANAGER_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <assert.h>
+#include <vector>
+
+class AbstractKart;
+
+/**
+ * \brief Listener which is notified when a kart enters or leaves a trigger
+ *  volume (see TriggerManager).
+ * \ingroup tracks
+ */
+class TriggerListener
+{
+public:
+    virtual ~TriggerListener() {}
+    /** Called when a kart enters the trigger volume. */
+    virtual void onTriggerEnter(AbstractKart *kart) = 0;
+    /** Called when a kart leaves the trigger volume. */
+    virtual void onTriggerExit(AbstractKart *kart) {}
+};   // TriggerListener
+
+// ============================================================================
+/**
+ * \brief Manages all trigger volumes of a track, e.g. sound emitters that
+ *  are triggered when a kart gets close, or the action triggers used in the
+ *  overworld and the tutorial.
+ *  Each trigger is a sphere. Since triggers do not move, they are stored in
+ *  a 2d grid over the track: each cell contains all triggers whose sphere
+ *  overlaps the cell (in x and z), so each kart only tests the triggers in
+ *  its cell. For each kart the triggers it is inside of are remembered, so
+ *  that the listeners are only notified when a kart enters or leaves.
+ * \ingroup tracks
+ */
+class TriggerManager : public NoCopy
+{
+private:
+    struct Trigger
+    {
+        Vec3             m_center;
+        float            m_radius;
+        TriggerListener *m_listener;
+    };   // Trigger
+
+    /** All triggers. Removed triggers have a NULL listener. */
+    std::vector<Trigger>            m_all_triggers;
+
+    /** The triggers of grid cell c are m_grid_triggers[m_grid_start[c]]
+     *  till (but not including) m_grid_triggers[m_grid_start[c+1]]. */
+    std::vector<unsigned int>       m_grid_start;
+
+    /** The triggers of all grid cells, sorted by cell. */
+    std::vector<unsigned int>       m_grid_triggers;
+
+    /** Minimum x and z coordinates of the grid. */
+    float                           m_grid_min_x, m_grid_min_z;
+
+    /** Size of a grid cell. */
+    float                           m_grid_cell_size;
+
+    /** Number of cells of the grid in x and z direction. */
+    int                             m_grid_width, m_grid_height;
+
+    /** Set when a trigger is added or removed, the grid is then rebuilt
+     *  in the next update. */
+    bool                            m_grid_dirty;
+
+    /** For each kart the sorted indices of all triggers it is inside. */
+    std::vector< std::vector<unsigned int> > m_inside;
+
+    static TriggerManager          *m_trigger_manager;
+
+         TriggerManager();
+        ~TriggerManager() {}
+    void buildGrid();
+    void getGridCell(float x, float z, int *cell_x, int *cell_z) const;
+
+public:
+    unsigned int addTrigger(const Vec3 &center, float radius,
+                            TriggerListener *listener);
+    void         removeTriggers(const TriggerListener *listener);
+    void         reset();
+    void         update(float dt);
+    // ------------------------------------------------------------------------
+    /** Creates the instance of the trigger manager. */
+    static void create()
+    {
+        assert(!m_trigger_manager);
+        m_trigger_manager = new TriggerManager();
+    }   // create
+    // ------------------------------------------------------------------------
+    /** Returns the instance of the trigger manager, which is NULL if no
+     *  track is loaded. */
+    static TriggerManager *get() { return m_trigger_manager; }
+    // ------------------------------------------------------------------------
+    /** Destroys the trigger manager. */
+    static void destroy()
+    {
+        delete m_trigger_manager;
+        m_trigger_manager = NULL;
+    }   // destroy
+};   // TriggerManager
+
+#endif
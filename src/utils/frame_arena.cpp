@@ -0,0 +1,103 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/frame_arena.hpp"
+
+#include <assert.h>
+#include <stdlib.h>
+
+FrameArena *FrameArena::m_frame_arena = NULL;
+
+/** All allocations are aligned to this size. */
+static const size_t ARENA_ALIGNMENT = 16;
+
+// ----------------------------------------------------------------------------
+/** Creates the arena with a first block of the given size. */
+FrameArena::FrameArena(size_t size)
+{
+    m_block_size   = size;
+    m_block        = (char*)allocateBlock(m_block_size);
+    m_used         = 0;
+    m_frame_bytes  = 0;
+    m_owner_thread = pthread_self();
+}   // FrameArena
+
+// ----------------------------------------------------------------------------
+FrameArena::~FrameArena()
+{
+    reset();
+    free(m_block);
+}   // ~FrameArena
+
+// ----------------------------------------------------------------------------
+/** Allocates a block from the heap, aborting if there is no memory left
+ *  (like new does). */
+void *FrameArena::allocateBlock(size_t size)
+{
+    void *p = malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}   // allocateBlock
+
+// ----------------------------------------------------------------------------
+/** Returns memory that is valid till the next call of reset().
+ *  \param size Number of bytes to allocate.
+ */
+void *FrameArena::allocate(size_t size)
+{
+    assert(pthread_equal(pthread_self(), m_owner_thread));
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (m_used + size > m_block_size)
+    {
+        // The current block is full, keep it till the end of the frame
+        // and continue in a new block
+        m_full_blocks.push_back(m_block);
+        if (size > m_block_size)
+            m_block_size = size;
+        m_block = (char*)allocateBlock(m_block_size);
+        m_used  = 0;
+    }
+    void *p = m_block + m_used;
+    m_used        += size;
+    m_frame_bytes += size;
+    return p;
+}   // allocate
+
+// ----------------------------------------------------------------------------
+/** Releases all memory allocated in this frame. If more than one block was
+ *  needed, all blocks are replaced by one block that can hold all
+ *  allocations of this frame.
+ */
+void FrameArena::reset()
+{
+    assert(pthread_equal(pthread_self(), m_owner_thread));
+
+    if (!m_full_blocks.empty())
+    {
+        for (unsigned int i = 0; i < m_full_blocks.size(); i++)
+            free(m_full_blocks[i]);
+        m_full_blocks.clear();
+        free(m_block);
+        m_block_size = (m_frame_bytes + ARENA_ALIGNMENT - 1)
+                     & ~(ARENA_ALIGNMENT - 1);
+        m_block      = (char*)allocateBlock(m_block_size);
+    }
+    m_used        = 0;
+    m_frame_bytes = 0;
+}   // reset
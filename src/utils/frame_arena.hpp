@@ -0,0 +1,142 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_FRAME_ARENA_HPP
+#define HEADER_FRAME_ARENA_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <new>
+#include <pthread.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * \brief A linear allocator for data that only lives during one frame.
+ *  Allocations just advance a pointer in a memory block, freeing memory
+ *  does nothing. All memory is released at once by reset(), which the main
+ *  loop calls at the end of each frame. If a frame needs more memory than
+ *  the current block has, additional blocks are allocated, and the next
+ *  reset() replaces all blocks with one block big enough for the whole
+ *  frame. So after a few frames no heap allocations are done at all.
+ *  The arena is not thread safe, it must only be used by the main thread,
+ *  and no object allocated from it must be used after the end of the frame.
+ * \ingroup utils
+ */
+class FrameArena : public NoCopy
+{
+private:
+    /** The block allocations are done from. */
+    char  *m_block;
+
+    /** Size of m_block. */
+    size_t m_block_size;
+
+    /** Number of bytes of m_block that are used. */
+    size_t m_used;
+
+    /** Blocks that were filled in this frame, freed in reset(). */
+    std::vector<char*> m_full_blocks;
+
+    /** Total number of bytes allocated in this frame. */
+    size_t m_frame_bytes;
+
+    /** The thread that created the arena, the only one allowed to use it. */
+    pthread_t m_owner_thread;
+
+    static FrameArena *m_frame_arena;
+
+    void *allocateBlock(size_t size);
+
+public:
+         FrameArena(size_t size);
+        ~FrameArena();
+    void *allocate(size_t size);
+    void  reset();
+
+    // ------------------------------------------------------------------------
+    static FrameArena *get()
+    {
+        if (!m_frame_arena)
+            m_frame_arena = new FrameArena(64 * 1024);
+        return m_frame_arena;
+    }   // get
+    // ------------------------------------------------------------------------
+    static void destroy()
+    {
+        delete m_frame_arena;
+        m_frame_arena = NULL;
+    }   // destroy
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes allocated in the current frame. */
+    size_t getFrameBytes() const { return m_frame_bytes; }
+};   // FrameArena
+
+// ============================================================================
+/** An STL allocator using the frame arena, so that containers that are only
+ *  used during one frame (e.g. local lists in the render code) do not use
+ *  the heap, e.g. std::vector<LightNode*, FrameAllocator<LightNode*> >.
+ */
+template<typename T>
+class FrameAllocator
+{
+public:
+    typedef T              value_type;
+    typedef T             *pointer;
+    typedef const T       *const_pointer;
+    typedef T             &reference;
+    typedef const T       &const_reference;
+    typedef size_t         size_type;
+    typedef ptrdiff_t      difference_type;
+
+    template<typename U> struct rebind { typedef FrameAllocator<U> other; };
+
+    FrameAllocator() {}
+    template<typename U> FrameAllocator(const FrameAllocator<U> &) {}
+
+    // ------------------------------------------------------------------------
+    pointer allocate(size_type n, const void *hint = 0)
+    {
+        return (pointer)FrameArena::get()->allocate(n * sizeof(T));
+    }   // allocate
+    // ------------------------------------------------------------------------
+    /** Memory is only freed at the end of the frame. */
+    void deallocate(pointer p, size_type n) {}
+    // ------------------------------------------------------------------------
+    void construct(pointer p, const T &value) { new((void*)p) T(value); }
+    // ------------------------------------------------------------------------
+    void destroy(pointer p) { p->~T(); }
+    // ------------------------------------------------------------------------
+    pointer       address(reference x) const       { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    size_type     max_size() const { return size_t(-1) / sizeof(T); }
+};   // FrameAllocator
+
+// ----------------------------------------------------------------------------
+template<typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return true;
+}
+// ----------------------------------------------------------------------------
+template<typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return false;
+}
+
+#endif
@@ -27,18 +27,41 @@
  *  Those values are then used to linearly interpolate the y value for a
  *  given x. If x is less than the minimum x_0, y_0 is returned, if x is
  *  more than the maximum x_n, y_n is returned.
+ *  The values are used by the physics of each kart in each frame, so all
+ *  data of one point (including the pre-computed slope to the next point)
+ *  is stored together in one contiguous array, which means a lookup only
+ *  touches one or two cache lines.
  */
 class InterpolationArray
 {
 private:
-    /** The sorted x values. */
-    std::vector<float> m_x;
+    /** All data of one point. */
+    struct Point
+    {
+        /** The x value, sorted. */
+        float m_x;
+        /** The y value. */
+        float m_y;
+        /** Pre-computed (y[i+1]-y[i])/(x[i+1]-x[i]), 0 for the last point. */
+        float m_delta;
+    };   // Point
 
-    /** The y values. */
-    std::vector<float> m_y;
+    /** All points, sorted by x. */
+    std::vector<Point> m_points;
 
-    /* Pre-computed (x[i+1]-x[i])/(y[i+1]/-y[i]) . */
-    std::vector<float> m_delta;
+    // ------------------------------------------------------------------------
+    /** Computes the slope from point i to the next point. To avoid a
+     *  division by zero m_delta is set to a large value with the right sign
+     *  if both x values are identical. */
+    void updateDelta(unsigned int i)
+    {
+        Point &p          = m_points[i];
+        const Point &next = m_points[i+1];
+        if(next.m_x==p.m_x)
+            p.m_delta = (next.m_y-p.m_y) / 0.001f;
+        else
+            p.m_delta = (next.m_y-p.m_y) / (next.m_x-p.m_x);
+    }   // updateDelta
 
 public:
     InterpolationArray() {};
@@ -49,64 +72,54 @@ public:
      *  \returns 0 If the x values are not sorted, 1 otherwise. */
     int push_back(float x, float y)
     {
-        if(m_x.size()>0 && x < m_x[m_x.size()-1])
+        if(m_points.size()>0 && x < m_points.back().m_x)
             return 0;
-        m_x.push_back(x);
-        m_y.push_back(y);
-        if(m_y.size()>1)
-        {
-            const unsigned int last=(unsigned int) m_x.size()-1;
-            // Avoid division by zero, just set m_delta to a large
-            // value with the right sign
-            if(m_x[last]==m_x[last-1])
-                m_delta.push_back( (m_y[last]-m_y[last-1])
-                                  / 0.001f                 );
-            else
-                m_delta.push_back( (m_y[last]-m_y[last-1])
-                                 /(m_x[last]-m_x[last-1])  );
-        }
+        Point p;
+        p.m_x     = x;
+        p.m_y     = y;
+        p.m_delta = 0;
+        m_points.push_back(p);
+        if(m_points.size()>1)
+            updateDelta((unsigned int)m_points.size()-2);
         return 1;
     }   // push_back
     // ------------------------------------------------------------------------
     /** Returns the number of X/Y points. */
-    unsigned int size() const { return (unsigned int) m_x.size(); }
+    unsigned int size() const { return (unsigned int) m_points.size(); }
     // ------------------------------------------------------------------------
     /** Returns the X value for a specified point. */
-    float getX(unsigned int i) const { return m_x[i]; }
+    float getX(unsigned int i) const { return m_points[i].m_x; }
     // ------------------------------------------------------------------------
     /** Returns the Y value for a specified point. */
-    float getY(unsigned int i) const { return m_y[i]; }
+    float getY(unsigned int i) const { return m_points[i].m_y; }
     // ------------------------------------------------------------------------
     /** Sets the Y value for a specified point. */
     void setY(unsigned int i, float y)
     {
-        m_y[i] = y;
+        m_points[i].m_y = y;
         if(i>0)
-            m_delta[i-1] = (m_y[i]-m_y[i-1])
-                          /(m_x[i]-m_x[i-1]);
-        if(i<m_y.size()-1)
-            m_delta[i] = (m_y[i+1]-m_y[i])
-                        /(m_x[i+1]-m_x[i]);
+            updateDelta(i-1);
+        if(i+1<m_points.size())
+            updateDelta(i);
     }
     // ------------------------------------------------------------------------
     /** Returns the interpolated Y value for a given x. */
     float get(float x) const
     {
-        if(m_x.size()==1 || x<m_x[0])
-            return m_y[0];
-
-        if(x>m_x[m_x.size()-1])
-            return m_y[m_y.size()-1];
-
-        // Now x must be between two points in m_x
-        // The array size in STK are pretty small (typically 3 or 4),
-        // so not worth the effort to do a binary search
-        for(unsigned int i=1; i<m_x.size(); i++)
-        {
-            if(x >m_x[i]) continue;
-            return m_y[i-1] + m_delta[i-1] * (x - m_x[i-1]);
-        }
-        assert(false); return 0;  // keep compiler happy
+        const Point *p    = &m_points[0];
+        const Point *last = p + m_points.size()-1;
+        if(x<=p->m_x)
+            return p->m_y;
+
+        if(x>last->m_x)
+            return last->m_y;
+
+        // Now x must be between two points. The array size in STK are
+        // pretty small (typically 3 or 4), so not worth the effort to do
+        // a binary search
+        while(x > p[1].m_x)
+            p++;
+        return p->m_y + p->m_delta * (x - p->m_x);
     }   // get
 
     // ------------------------------------------------------------------------
@@ -115,33 +128,32 @@ public:
      *  x_min or x_max is returned. */
     float getReverse(float y) const
     {
-        if(m_y.size()==1) return m_x[0];
+        if(m_points.size()==1) return m_points[0].m_x;
 
-        if(m_y[1]<m_y[0])   // if decreasing values
+        const unsigned int last = (unsigned int) m_points.size();
+        if(m_points[1].m_y<m_points[0].m_y)   // if decreasing values
         {
-            if(y > m_y[0]) return m_x[0];
-
-            const unsigned int last = (unsigned int) m_x.size();
+            if(y > m_points[0].m_y) return m_points[0].m_x;
 
             for(unsigned int i=1; i<last; i++)
             {
-                if(y < m_y[i]) continue;
-                return m_x[i-1] + (y-m_y[i-1])/ m_delta[i-1];
+                if(y < m_points[i].m_y) continue;
+                const Point &p = m_points[i-1];
+                return p.m_x + (y-p.m_y) / p.m_delta;
             }   // for i < last
-            return m_x[last-1];
+            return m_points[last-1].m_x;
         }
         else   // increasing
         {
-            if(y < m_y[0]) return m_x[0];
-
-            const unsigned int last = (unsigned int) m_x.size();
+            if(y < m_points[0].m_y) return m_points[0].m_x;
 
             for(unsigned int i=1; i<last; i++)
             {
-                if(y > m_y[i]) continue;
-                return m_x[i-1] + (y-m_y[i-1]) / m_delta[i-1];
+                if(y > m_points[i].m_y) continue;
+                const Point &p = m_points[i-1];
+                return p.m_x + (y-p.m_y) / p.m_delta;
             }   // for i < last
-            return m_x[last-1];
+            return m_points[last-1].m_x;
         }   // increasing
     }   // getReverse
 };    // InterpolationArray
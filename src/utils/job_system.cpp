@@ -0,0 +1,374 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/job_system.hpp"
+
+#include "config/user_config.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _MSC_VER
+#  define THREAD_LOCAL __declspec(thread)
+#else
+#  define THREAD_LOCAL __thread
+#endif
+
+JobSystem *JobSystem::m_job_system = NULL;
+
+// ----------------------------------------------------------------------------
+/** Returns the worker of the current thread, NULL if it is not a worker
+ *  thread. */
+JobSystem::Worker *&JobSystem::currentWorker()
+{
+    static THREAD_LOCAL Worker *worker = NULL;
+    return worker;
+}   // currentWorker
+
+// ----------------------------------------------------------------------------
+/** Creates the job system. The number of workers is taken from the user
+ *  config, by default one thread less than the number of cores is used
+ *  (the main thread runs jobs while it waits for them).
+ */
+void JobSystem::create()
+{
+    assert(!m_job_system);
+    int num_workers = UserConfigParams::m_job_threads;
+    if (num_workers < 0)
+    {
+        num_workers = (int)std::thread::hardware_concurrency() - 1;
+        num_workers = std::max(0, std::min(num_workers, 15));
+    }
+    m_job_system = new JobSystem(num_workers);
+}   // create
+
+// ----------------------------------------------------------------------------
+void JobSystem::destroy()
+{
+    delete m_job_system;
+    m_job_system = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+JobSystem::JobSystem(unsigned int num_workers)
+         : m_num_queued(0), m_abort(false)
+{
+    pthread_mutex_init(&m_shared_mutex, NULL);
+    pthread_mutex_init(&m_sleep_mutex, NULL);
+    pthread_cond_init(&m_wake_up, NULL);
+
+    // All workers must exist before any of them can steal jobs
+    for (unsigned int i = 0; i < num_workers; i++)
+    {
+        Worker *worker = new Worker();
+        worker->m_job_system = this;
+        worker->m_index      = i;
+        pthread_mutex_init(&worker->m_mutex, NULL);
+        m_workers.push_back(worker);
+    }
+    for (unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        if (pthread_create(&m_workers[i]->m_thread, NULL, &mainLoop,
+                           m_workers[i]))
+        {
+            Log::error("JobSystem", "Could not create worker thread.");
+            // Jobs are still run by the threads that wait for them
+            for (unsigned int j = i; j < m_workers.size(); j++)
+            {
+                pthread_mutex_destroy(&m_workers[j]->m_mutex);
+                delete m_workers[j];
+            }
+            m_workers.resize(i);
+            break;
+        }
+    }
+    Log::info("JobSystem", "Using %d worker threads.", (int)m_workers.size());
+}   // JobSystem
+
+// ----------------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+    pthread_mutex_lock(&m_sleep_mutex);
+    m_abort = true;
+    pthread_cond_broadcast(&m_wake_up);
+    pthread_mutex_unlock(&m_sleep_mutex);
+    for (unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        pthread_join(m_workers[i]->m_thread, NULL);
+        pthread_mutex_destroy(&m_workers[i]->m_mutex);
+        delete m_workers[i];
+    }
+    pthread_cond_destroy(&m_wake_up);
+    pthread_mutex_destroy(&m_sleep_mutex);
+    pthread_mutex_destroy(&m_shared_mutex);
+}   // ~JobSystem
+
+// ----------------------------------------------------------------------------
+/** The main loop of a worker thread: runs jobs, and sleeps if there are
+ *  none.
+ */
+void *JobSystem::mainLoop(void *data)
+{
+    currentWorker() = (Worker*)data;
+    JobSystem *js = currentWorker()->m_job_system;
+    while (!js->m_abort)
+    {
+        if (js->runOneJob())
+            continue;
+        pthread_mutex_lock(&js->m_sleep_mutex);
+        while (js->m_num_queued == 0 && !js->m_abort)
+            pthread_cond_wait(&js->m_wake_up, &js->m_sleep_mutex);
+        pthread_mutex_unlock(&js->m_sleep_mutex);
+    }
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Adds a job to the queue of the current worker, or to the shared queue
+ *  if this is not a worker thread, and wakes up a sleeping worker.
+ */
+void JobSystem::push(const QueuedJob &job)
+{
+    if (m_workers.empty())
+    {
+        // No workers: run the job right away
+        job.m_job();
+        finished(job.m_counter);
+        return;
+    }
+    Worker *self = currentWorker();
+    if (self && self->m_job_system == this)
+    {
+        pthread_mutex_lock(&self->m_mutex);
+        self->m_jobs.push_back(job);
+        pthread_mutex_unlock(&self->m_mutex);
+    }
+    else
+    {
+        pthread_mutex_lock(&m_shared_mutex);
+        m_shared_jobs.push_back(job);
+        pthread_mutex_unlock(&m_shared_mutex);
+    }
+    // Increased before locking, so a worker going to sleep either sees the
+    // job or gets the signal.
+    m_num_queued++;
+    pthread_mutex_lock(&m_sleep_mutex);
+    pthread_cond_signal(&m_wake_up);
+    pthread_mutex_unlock(&m_sleep_mutex);
+}   // push
+
+// ----------------------------------------------------------------------------
+/** Takes the next job to run: the newest one of the own queue, else the
+ *  oldest shared job, else the oldest job of another worker.
+ *  \return False if there is no job at all.
+ */
+bool JobSystem::pop(QueuedJob *job)
+{
+    if (m_num_queued == 0)
+        return false;
+
+    Worker *self = currentWorker();
+    if (self && self->m_job_system != this)
+        self = NULL;
+    if (self)
+    {
+        pthread_mutex_lock(&self->m_mutex);
+        bool found = !self->m_jobs.empty();
+        if (found)
+        {
+            *job = self->m_jobs.back();
+            self->m_jobs.pop_back();
+        }
+        pthread_mutex_unlock(&self->m_mutex);
+        if (found)
+        {
+            m_num_queued--;
+            return true;
+        }
+    }
+
+    pthread_mutex_lock(&m_shared_mutex);
+    bool found = !m_shared_jobs.empty();
+    if (found)
+    {
+        *job = m_shared_jobs.front();
+        m_shared_jobs.pop_front();
+    }
+    pthread_mutex_unlock(&m_shared_mutex);
+    if (found)
+    {
+        m_num_queued--;
+        return true;
+    }
+
+    // Steal, starting with the next worker so that not all thieves try
+    // the same queue first
+    const unsigned int n     = (unsigned int)m_workers.size();
+    const unsigned int start = self ? self->m_index + 1 : 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        Worker *victim = m_workers[(start + i) % n];
+        if (victim == self)
+            continue;
+        pthread_mutex_lock(&victim->m_mutex);
+        found = !victim->m_jobs.empty();
+        if (found)
+        {
+            *job = victim->m_jobs.front();
+            victim->m_jobs.pop_front();
+        }
+        pthread_mutex_unlock(&victim->m_mutex);
+        if (found)
+        {
+            m_num_queued--;
+            return true;
+        }
+    }
+    return false;
+}   // pop
+
+// ----------------------------------------------------------------------------
+/** Runs one job if there is any.
+ *  \return True if a job was run.
+ */
+bool JobSystem::runOneJob()
+{
+    QueuedJob job;
+    if (!pop(&job))
+        return false;
+    job.m_job();
+    finished(job.m_counter);
+    return true;
+}   // runOneJob
+
+// ----------------------------------------------------------------------------
+/** Called when a job is finished. If it was the last job of its counter,
+ *  the jobs waiting for the counter are started.
+ */
+void JobSystem::finished(JobCounter *counter)
+{
+    if (!counter)
+        return;
+    std::vector<JobCounter::Continuation> continuations;
+    pthread_mutex_lock(&counter->m_mutex);
+    if (--counter->m_count == 0)
+        continuations.swap(counter->m_continuations);
+    pthread_mutex_unlock(&counter->m_mutex);
+    // The counter might be deleted from here on
+    for (unsigned int i = 0; i < continuations.size(); i++)
+    {
+        QueuedJob job;
+        job.m_job     = continuations[i].m_job;
+        job.m_counter = continuations[i].m_counter;
+        push(job);
+    }
+}   // finished
+
+// ----------------------------------------------------------------------------
+/** Starts a job.
+ *  \param job The function to run.
+ *  \param counter If not NULL, the counter is increased until the job is
+ *         finished.
+ *  \param after If not NULL, the job is only started once all jobs of this
+ *         counter are finished.
+ */
+void JobSystem::run(const Job &job, JobCounter *counter, JobCounter *after)
+{
+    if (counter)
+        counter->m_count++;
+    if (after)
+    {
+        pthread_mutex_lock(&after->m_mutex);
+        if (after->m_count > 0)
+        {
+            JobCounter::Continuation c;
+            c.m_job     = job;
+            c.m_counter = counter;
+            after->m_continuations.push_back(c);
+            pthread_mutex_unlock(&after->m_mutex);
+            return;
+        }
+        pthread_mutex_unlock(&after->m_mutex);
+    }
+    QueuedJob queued;
+    queued.m_job     = job;
+    queued.m_counter = counter;
+    push(queued);
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Waits until all jobs of a counter are finished. Other jobs are run
+ *  while waiting.
+ */
+void JobSystem::wait(JobCounter *counter)
+{
+    while (!counter->isDone())
+    {
+        if (!runOneJob())
+            std::this_thread::yield();
+    }
+    // Make sure that finished() does not use the counter anymore
+    pthread_mutex_lock(&counter->m_mutex);
+    pthread_mutex_unlock(&counter->m_mutex);
+}   // wait
+
+// ----------------------------------------------------------------------------
+/** Calls a function for all chunks of a range in parallel, and returns when
+ *  all are done. The chunks are handed out dynamically, so chunks that take
+ *  longer than others are balanced. The calling thread takes part.
+ *  \param begin, end The range [begin, end).
+ *  \param grain_size The size of each chunk (except maybe the last one).
+ *  \param f The function called for each chunk with its begin and end.
+ *  \param max_jobs If > 0 at most that many chunks run at the same time.
+ */
+void JobSystem::parallelFor(int begin, int end, int grain_size,
+                            const std::function<void(int, int)> &f,
+                            int max_jobs)
+{
+    if (end <= begin)
+        return;
+    grain_size = std::max(grain_size, 1);
+    const int num_chunks = (end - begin + grain_size - 1) / grain_size;
+    int num_jobs = std::min(num_chunks, (int)m_workers.size() + 1);
+    if (max_jobs > 0)
+        num_jobs = std::min(num_jobs, max_jobs);
+    if (num_jobs <= 1)
+    {
+        f(begin, end);
+        return;
+    }
+
+    std::atomic<int> next_chunk(0);
+    Job job = [&]()
+    {
+        while (true)
+        {
+            const int chunk = next_chunk++;
+            if (chunk >= num_chunks)
+                break;
+            const int chunk_begin = begin + chunk * grain_size;
+            f(chunk_begin, std::min(chunk_begin + grain_size, end));
+        }
+    };
+    JobCounter counter;
+    for (int i = 1; i < num_jobs; i++)
+        run(job, &counter);
+    job();
+    wait(&counter);
+}   // parallelFor
@@ -0,0 +1,200 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_JOB_SYSTEM_HPP
+#define HEADER_JOB_SYSTEM_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <pthread.h>
+#include <vector>
+
+/**
+ * \brief Counts the unfinished jobs of a group of jobs.
+ *  A counter can be waited for (see JobSystem::wait), and jobs can be
+ *  started once all jobs of a counter are finished, which allows to build
+ *  simple task graphs. A counter must not be destroyed while it has jobs
+ *  (which is guaranteed after waiting for it).
+ * \ingroup utils
+ */
+class JobCounter : public NoCopy
+{
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        std::function<void()> m_job;
+        JobCounter           *m_counter;
+    };   // Continuation
+
+    /** Number of unfinished jobs. */
+    std::atomic<int> m_count;
+
+    /** Protects m_continuations and the change of m_count to 0. */
+    pthread_mutex_t m_mutex;
+
+    /** Jobs that are started once all jobs of this counter are done. */
+    std::vector<Continuation> m_continuations;
+
+public:
+    JobCounter() : m_count(0) { pthread_mutex_init(&m_mutex, NULL); }
+    // ------------------------------------------------------------------------
+    ~JobCounter()
+    {
+        assert(m_count == 0);
+        pthread_mutex_destroy(&m_mutex);
+    }   // ~JobCounter
+    // ------------------------------------------------------------------------
+    /** Returns true if all jobs of this counter are finished. */
+    bool isDone() const { return m_count == 0; }
+};   // JobCounter
+
+// ============================================================================
+/**
+ * \brief The result of a job started with JobSystem::async.
+ * \ingroup utils
+ */
+template<typename T>
+class JobFuture : public NoCopy
+{
+private:
+    friend class JobSystem;
+    T          m_result;
+    JobCounter m_counter;
+public:
+    // ------------------------------------------------------------------------
+    /** Returns true if the result is available. */
+    bool isReady() const { return m_counter.isDone(); }
+    // ------------------------------------------------------------------------
+    /** Waits for the job (running other jobs meanwhile) and returns its
+     *  result. */
+    const T &get();
+};   // JobFuture
+
+// ============================================================================
+/**
+ * \brief A pool of worker threads shared by all parallel work of the game
+ *  (AI, physics, culling, filling draw commands, ...), so that the number
+ *  of threads used does not depend on how many subsystems run in parallel.
+ *  Each worker has its own queue of jobs. Jobs started by a worker are
+ *  added to its own queue and taken from the back (so the most recent,
+ *  cache-hot job runs next), idle workers steal from the front of the
+ *  other queues. Jobs started by other threads (e.g. the main thread) go
+ *  to a shared queue. A thread waiting for jobs runs other jobs meanwhile,
+ *  so jobs can start and wait for jobs themselves without deadlocks.
+ *  Threads that mostly wait for I/O (sound, network, http requests) keep
+ *  their own threads and are not handled here.
+ * \ingroup utils
+ */
+class JobSystem : public NoCopy
+{
+public:
+    typedef std::function<void()> Job;
+
+private:
+    struct QueuedJob
+    {
+        Job         m_job;
+        JobCounter *m_counter;
+    };   // QueuedJob
+
+    struct Worker
+    {
+        JobSystem            *m_job_system;
+        unsigned int          m_index;
+        pthread_t             m_thread;
+        pthread_mutex_t       m_mutex;
+        std::deque<QueuedJob> m_jobs;
+    };   // Worker
+
+    /** The worker threads. */
+    std::vector<Worker*> m_workers;
+
+    /** Jobs started by threads that are not workers. */
+    std::deque<QueuedJob> m_shared_jobs;
+    pthread_mutex_t       m_shared_mutex;
+
+    /** Number of jobs in all queues, so that idle workers can sleep. */
+    std::atomic<int> m_num_queued;
+
+    /** Used to wake up sleeping workers. */
+    pthread_mutex_t m_sleep_mutex;
+    pthread_cond_t  m_wake_up;
+
+    /** Set to stop the workers. */
+    std::atomic<bool> m_abort;
+
+    static JobSystem *m_job_system;
+
+         JobSystem(unsigned int num_workers);
+        ~JobSystem();
+    void push(const QueuedJob &job);
+    bool pop(QueuedJob *job);
+    bool runOneJob();
+    void finished(JobCounter *counter);
+    static void *mainLoop(void *data);
+    static Worker *&currentWorker();
+
+public:
+    void run(const Job &job, JobCounter *counter = NULL,
+             JobCounter *after = NULL);
+    void wait(JobCounter *counter);
+    void parallelFor(int begin, int end, int grain_size,
+                     const std::function<void(int, int)> &f,
+                     int max_jobs = 0);
+    static void create();
+    static void destroy();
+
+    // ------------------------------------------------------------------------
+    static JobSystem *get()
+    {
+        assert(m_job_system);
+        return m_job_system;
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Returns the number of worker threads, the maximum number of jobs
+     *  that can run in parallel is one more (the waiting thread). */
+    unsigned int getNumWorkers() const
+    {
+        return (unsigned int)m_workers.size();
+    }   // getNumWorkers
+    // ------------------------------------------------------------------------
+    /** Runs a function as job, its result can be read from the future.
+     *  \param f The function (or lambda) returning the result.
+     *  \param future The future to store the result in. */
+    template<typename T, typename F>
+    void async(F f, JobFuture<T> *future)
+    {
+        run([f, future]() { future->m_result = f(); }, &future->m_counter);
+    }   // async
+};   // JobSystem
+
+// ----------------------------------------------------------------------------
+template<typename T>
+const T &JobFuture<T>::get()
+{
+    JobSystem::get()->wait(&m_counter);
+    return m_result;
+}   // get
+
+#endif
@@ -0,0 +1,205 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/load_profiler.hpp"
+
+#include "config/hardware_stats.hpp"
+#include "utils/log.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <vector>
+
+namespace LoadProfiler
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /** File the json summaries are appended to, empty if none is written. */
+    static std::string                     g_json_file;
+    static bool                            g_enabled = false;
+    /** True while a load is profiled. */
+    static std::atomic<bool>               g_running(false);
+    /** The thread which started the load, only it records stages. */
+    static pthread_t                       g_thread;
+    /** Name of the profiled load, e.g. the track ident. */
+    static std::string                     g_name;
+
+    /** The current stage and when it was entered (or resumed). */
+    static Stage                           g_stage = STAGE_OTHER;
+    static Clock::time_point               g_stage_start;
+    static Clock::time_point               g_start;
+
+    static double                          g_time[STAGE_COUNT];
+    static unsigned int                    g_calls[STAGE_COUNT];
+    static std::atomic<unsigned long long> g_bytes[STAGE_COUNT];
+
+    static const char *g_stage_names[STAGE_COUNT] =
+        { "other", "xml", "meshes", "textures", "shaders", "physics",
+          "bvh", "quad_graph", "objects", "minimap" };
+
+    // ------------------------------------------------------------------------
+    /** Enables the profiling of all loads.
+     *  \param json_file If not empty, a json summary of each load is
+     *         appended to this file. */
+    void enable(const std::string &json_file)
+    {
+        g_enabled   = true;
+        g_json_file = json_file;
+    }   // enable
+
+    // ------------------------------------------------------------------------
+    /** Starts to profile a load, if profiling is enabled.
+     *  \param name Name of the load in the report. */
+    void start(const std::string &name)
+    {
+        if (!g_enabled)
+            return;
+        g_name   = name;
+        g_thread = pthread_self();
+        g_stage  = STAGE_OTHER;
+        for (unsigned int i = 0; i < STAGE_COUNT; i++)
+        {
+            g_time[i]  = 0;
+            g_calls[i] = 0;
+            g_bytes[i] = 0;
+        }
+        g_start = g_stage_start = Clock::now();
+        g_running = true;
+    }   // start
+
+    // ------------------------------------------------------------------------
+    /** True if a load is profiled. */
+    bool isRunning() { return g_running; }
+
+    // ------------------------------------------------------------------------
+    /** True if a load is profiled and this is the loading thread. */
+    bool isActive()
+    {
+        return g_running && pthread_equal(pthread_self(), g_thread);
+    }   // isActive
+
+    // ------------------------------------------------------------------------
+    /** Returns the current stage of the loading thread. */
+    Stage getStage() { return g_stage; }
+
+    // ------------------------------------------------------------------------
+    /** Adds the time since the last stage change to the current stage. */
+    static void updateTime()
+    {
+        const Clock::time_point now = Clock::now();
+        g_time[g_stage] +=
+            std::chrono::duration<double, std::milli>(now - g_stage_start)
+            .count();
+        g_stage_start = now;
+    }   // updateTime
+
+    // ------------------------------------------------------------------------
+    /** Switches to a new stage, must only be called by the loading thread
+     *  (see isActive()). Use ScopedStage instead of calling this directly.
+     *  \return The previous stage, which must be passed to leaveStage. */
+    Stage enterStage(Stage stage)
+    {
+        updateTime();
+        g_calls[stage]++;
+        const Stage previous = g_stage;
+        g_stage = stage;
+        return previous;
+    }   // enterStage
+
+    // ------------------------------------------------------------------------
+    /** Returns to the stage that was active before enterStage. */
+    void leaveStage(Stage previous)
+    {
+        updateTime();
+        g_stage = previous;
+    }   // leaveStage
+
+    // ------------------------------------------------------------------------
+    /** Counts bytes read from disk for a stage, can be called by any
+     *  thread. */
+    void addBytes(Stage stage, unsigned long long bytes)
+    {
+        if (g_running)
+            g_bytes[stage] += bytes;
+    }   // addBytes
+
+    // ------------------------------------------------------------------------
+    /** Counts the size of a file as read for a stage. */
+    void addFileBytes(Stage stage, const std::string &filename)
+    {
+        if (!g_running)
+            return;
+        struct stat file_stat;
+        if (stat(filename.c_str(), &file_stat) == 0)
+            g_bytes[stage] += file_stat.st_size;
+    }   // addFileBytes
+
+    // ------------------------------------------------------------------------
+    /** Stops profiling the current load, prints the time and the bytes read
+     *  of each stage and appends the json summary. */
+    void stop()
+    {
+        if (!isActive())
+            return;
+        updateTime();
+        g_running = false;
+        const double total = std::chrono::duration<double, std::milli>
+                             (Clock::now() - g_start).count();
+
+        Log::info("LoadProfiler", "Loading '%s' took %.1f ms:",
+                  g_name.c_str(), total);
+        std::vector<std::string> stages;
+        for (unsigned int i = 0; i < STAGE_COUNT; i++)
+        {
+            const unsigned long long bytes = g_bytes[i];
+            Log::info("LoadProfiler", "  %-10s %9.1f ms %5.1f%% %9llu kB "
+                      "%6u calls", g_stage_names[i], g_time[i],
+                      total > 0 ? 100.0 * g_time[i] / total : 0.0,
+                      bytes / 1024, g_calls[i]);
+            HardwareStats::Json json;
+            json.add("name", g_stage_names[i]);
+            json.add("ms", g_time[i]);
+            json.add("bytes", bytes);
+            json.add("calls", g_calls[i]);
+            json.finish();
+            stages.push_back(json.toString());
+        }
+
+        if (g_json_file.empty())
+            return;
+        HardwareStats::Json json;
+        json.add("name", g_name);
+        json.add("total_ms", total);
+        json.addArray("stages", stages);
+        json.finish();
+        // One line for each load, so that all loads of a session (e.g. a
+        // grand prix) can be compared
+        std::ofstream out(g_json_file.c_str(), std::ios::app);
+        if (!out.is_open())
+        {
+            Log::warn("LoadProfiler", "Can't write results to '%s'.",
+                      g_json_file.c_str());
+            return;
+        }
+        out << json.toString() << "\n";
+    }   // stop
+
+}   // namespace LoadProfiler
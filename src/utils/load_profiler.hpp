@@ -0,0 +1,77 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_LOAD_PROFILER_HPP
+#define HEADER_LOAD_PROFILER_HPP
+
+#include <string>
+
+/**
+ * \brief Measures where the time is spent while a track is loaded.
+ *  Enabled with --profile-loading (which reports in the log) or
+ *  --profile-loading=FILE (which additionally appends a json summary of
+ *  each load to FILE). The loading code marks the stage it is in with a
+ *  ScopedStage. Stages can be nested (e.g. loading a mesh loads its
+ *  textures), the time is always attributed to the innermost stage only, so
+ *  the times of all stages add up to the total loading time. Stages are
+ *  only recorded in the thread that started the load, but the bytes read
+ *  can be added from any thread (e.g. the texture decoding threads).
+ * \ingroup utils
+ */
+namespace LoadProfiler
+{
+    /** The stages of loading a track. */
+    enum Stage { STAGE_OTHER, STAGE_XML, STAGE_MESHES, STAGE_TEXTURES,
+                 STAGE_SHADERS, STAGE_PHYSICS, STAGE_BVH, STAGE_QUAD_GRAPH,
+                 STAGE_OBJECTS, STAGE_MINIMAP, STAGE_COUNT };
+
+    void  enable(const std::string &json_file);
+    void  start(const std::string &name);
+    void  stop();
+    bool  isRunning();
+    bool  isActive();
+    Stage getStage();
+    Stage enterStage(Stage stage);
+    void  leaveStage(Stage previous);
+    void  addBytes(Stage stage, unsigned long long bytes);
+    void  addFileBytes(Stage stage, const std::string &filename);
+
+    // ------------------------------------------------------------------------
+    /** Attributes the time while this object exists to a stage, if a load
+     *  is profiled and this is the loading thread. */
+    class ScopedStage
+    {
+    private:
+        Stage m_previous;
+        bool  m_active;
+    public:
+        ScopedStage(Stage stage)
+        {
+            m_active = isActive();
+            if (m_active)
+                m_previous = enterStage(stage);
+        }
+        ~ScopedStage()
+        {
+            if (m_active)
+                leaveStage(m_previous);
+        }
+    };   // ScopedStage
+}   // namespace LoadProfiler
+
+#endif
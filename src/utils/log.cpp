@@ -19,9 +19,14 @@
 #include "utils/log.hpp"
 
 #include "config/user_config.hpp"
+#include "utils/mpsc_queue.hpp"
+#include "utils/time.hpp"
 
+#include <atomic>
 #include <cstdio>
+#include <pthread.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -34,6 +39,41 @@
 Log::LogLevel Log::m_min_log_level = Log::LL_VERBOSE;
 bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
+int           Log::m_rate_limit    = 0;
+
+namespace
+{
+    /** A formatted message waiting to be written by the writer thread. */
+    struct LogRecord
+    {
+        int         m_level;
+        std::string m_text;
+    };   // LogRecord
+
+    /** Maximum number of records waiting to be written. If the writer
+     *  thread can not keep up, further messages are dropped (and counted)
+     *  instead of using more and more memory. */
+    const int MAX_PENDING_RECORDS = 4096;
+
+    /** Number of buckets used for rate limiting. Components are hashed into
+     *  the buckets, so two components might share the same limit. */
+    const unsigned int NUM_RATE_BUCKETS = 64;
+
+    struct RateBucket
+    {
+        std::atomic<int> m_second;
+        std::atomic<int> m_count;
+    };   // RateBucket
+
+    MPSCQueue<LogRecord*> g_records;
+    std::atomic<int>      g_num_pending(0);
+    std::atomic<int>      g_num_dropped(0);
+    std::atomic<int>      g_num_rate_limited(0);
+    std::atomic<bool>     g_writer_running(false);
+    std::atomic<bool>     g_stop_writer(false);
+    pthread_t             g_writer_thread;
+    RateBucket            g_rate_buckets[NUM_RATE_BUCKETS];
+}   // namespace
 
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
@@ -122,8 +162,38 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually prints the log message. If log messages are not redirected
- *  to a file, it tries to select a terminal colour.
+/** Checks if a message of a component exceeds the rate limit, and counts the
+ *  message if it doesn't. This is done before the message is formatted, so
+ *  messages that are dropped cost next to nothing.
+ *  \param component The component that prints the message.
+ *  \return True if the message must be dropped.
+ */
+bool Log::isRateLimited(const char *component)
+{
+    unsigned int hash = 5381;
+    for (const char *c = component; *c; c++)
+        hash = hash * 33 + *c;
+    RateBucket &bucket = g_rate_buckets[hash % NUM_RATE_BUCKETS];
+
+    const int now = (int)time(NULL);
+    int second = bucket.m_second.load(std::memory_order_relaxed);
+    if (second != now &&
+        bucket.m_second.compare_exchange_strong(second, now))
+    {
+        bucket.m_count.store(0, std::memory_order_relaxed);
+    }
+    if (bucket.m_count.fetch_add(1, std::memory_order_relaxed) < m_rate_limit)
+        return false;
+    g_num_rate_limited.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}   // isRateLimited
+
+// ----------------------------------------------------------------------------
+/** This actually prints the log message. If the writer thread is running,
+ *  the message is only formatted and handed to the writer thread, so that
+ *  the calling thread never has to wait for the console or the log file.
+ *  Fatal messages are always written immediately, after all pending
+ *  messages.
  *  \param level Log level of the message to print.
  *  \param format A printf-like format string.
  *  \param va_list The values to be printed for the format.
@@ -135,6 +205,9 @@ void Log::printMessage(int level, const char *component, const char *format,
 
     if(level<m_min_log_level) return;
 
+    if(m_rate_limit > 0 && level < LL_WARN && isRateLimited(component))
+        return;
+
 #ifdef ANDROID
     android_LogPriority alp;
     switch (level)
@@ -157,58 +230,185 @@ void Log::printMessage(int level, const char *component, const char *format,
     static const char *names[] = {"debug", "verbose  ", "info   ",
                                   "warn   ", "error  ", "fatal  "};
 
-    // Using a va_list twice produces undefined results, ie crash.
-    // So make a copy if we're going to use it twice.
+    // Format the message once, it is then written to all outputs.
+    // Using a va_list twice produces undefined results, so make a copy
+    // in case the message does not fit into the buffer.
+    char buffer[1024];
+    int prefix = snprintf(buffer, sizeof(buffer), "[%s] %s: ",
+                          names[level], component);
+    if (prefix < 0 || prefix >= (int)sizeof(buffer))
+        prefix = 0;
     VALIST copy;
-    if (m_file_stdout)
+    va_copy(copy, args);
+    int length = vsnprintf(buffer + prefix, sizeof(buffer) - prefix, format,
+                           copy);
+    va_end(copy);
+    std::string text;
+    if (length >= (int)sizeof(buffer) - prefix)
     {
+        text.assign(buffer, prefix);
+        text.resize(prefix + length + 1);
         va_copy(copy, args);
+        vsnprintf(&text[prefix], length + 1, format, copy);
+        va_end(copy);
+        text.resize(prefix + length);
     }
-#if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    VALIST copy2;
-    va_copy(copy2, args);
+    else
+        text = buffer;
+
+    if (level == LL_FATAL)
+        stopWriterThread();
+
+    if (!g_writer_running.load(std::memory_order_acquire))
+    {
+        writeMessage(level, text.c_str());
+        return;
+    }
+
+    if (g_num_pending.fetch_add(1, std::memory_order_relaxed)
+                                                    >= MAX_PENDING_RECORDS)
+    {
+        g_num_pending.fetch_sub(1, std::memory_order_relaxed);
+        g_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    LogRecord *record = new LogRecord();
+    record->m_level   = level;
+    record->m_text.swap(text);
+    g_records.push(record);
 #endif
+}   // printMessage
 
+// ----------------------------------------------------------------------------
+/** Writes a formatted message to the console and/or the log file. If log
+ *  messages are not redirected to a file, it tries to select a terminal
+ *  colour.
+ *  \param level Log level of the message.
+ *  \param text The formatted message, including level and component.
+ */
+void Log::writeMessage(int level, const char *text)
+{
     // If we don't have a console file, write to stdout and hope for the best
     if(!m_file_stdout || level >= LL_WARN ||
         UserConfigParams::m_log_errors_to_console) // log to console & file
     {
-        VALIST out;
-        va_copy(out, args);
-
         setTerminalColor((LogLevel)level);
-        printf("[%s] %s: ", names[level], component);
-        vprintf(format, out);
+        printf("%s", text);
         resetTerminalColor();  // this prints a \n
-
-        va_end(out);
     }
 
 #if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    static char szBuff[2048];
-    vsnprintf(szBuff, sizeof(szBuff), format, copy2);
-
-    OutputDebugString("[");
-    OutputDebugString(names[level]);
-    OutputDebugString("] ");
-    OutputDebugString(component);
-    OutputDebugString(": ");
-    OutputDebugString(szBuff);
+    OutputDebugString(text);
     OutputDebugString("\r\n");
 #endif
-    
 
     if(m_file_stdout)
+        fprintf(m_file_stdout, "%s\n", text);
+}   // writeMessage
+
+// ----------------------------------------------------------------------------
+/** Starts the thread that writes all log messages. After this is called,
+ *  threads that log messages only format them, and never wait for the
+ *  console or log file. The thread is stopped by closeOutputFiles, or at
+ *  the latest when STK exits.
+ */
+void Log::startWriterThread()
+{
+#ifndef ANDROID
+    if(g_writer_running.load())
+        return;
+    g_stop_writer.store(false);
+
+    pthread_attr_t  attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int error = pthread_create(&g_writer_thread, &attr, &Log::writeLoop,
+                               NULL);
+    pthread_attr_destroy(&attr);
+    if(error)
     {
-        fprintf (m_file_stdout, "[%s] %s: ", names[level], component);
-        vfprintf(m_file_stdout, format, copy);
-        fprintf (m_file_stdout, "\n");
-        va_end(copy);
+        warn("Log", "Could not create writer thread, error=%d.", error);
+        return;
     }
+    g_writer_running.store(true, std::memory_order_release);
 
+    // Make sure that no messages are lost if exit() is called.
+    static bool at_exit_registered = false;
+    if(!at_exit_registered)
+    {
+        atexit(&Log::stopWriterThread);
+        at_exit_registered = true;
+    }
 #endif
-}   // printMessage
+}   // startWriterThread
 
+// ----------------------------------------------------------------------------
+/** Writes all pending messages and stops the writer thread. All following
+ *  messages are written immediately by the thread that logs them.
+ */
+void Log::stopWriterThread()
+{
+    if(!g_writer_running.exchange(false))
+        return;
+    g_stop_writer.store(true);
+    pthread_join(g_writer_thread, NULL);
+
+    // Write messages from threads that pushed their message after the
+    // writer thread had finished.
+    LogRecord *record;
+    while(g_records.pop(&record))
+    {
+        writeMessage(record->m_level, record->m_text.c_str());
+        delete record;
+    }
+    g_num_pending.store(0);
+}   // stopWriterThread
+
+// ----------------------------------------------------------------------------
+/** The thread that writes all messages. If messages had to be dropped, the
+ *  number of dropped messages is printed as a warning once per second.
+ */
+void* Log::writeLoop(void *obj)
+{
+    int last_report = 0;
+    while(true)
+    {
+        bool stop = g_stop_writer.load();
+        LogRecord *record;
+        bool written = false;
+        while(g_records.pop(&record))
+        {
+            writeMessage(record->m_level, record->m_text.c_str());
+            delete record;
+            g_num_pending.fetch_sub(1, std::memory_order_relaxed);
+            written = true;
+        }
+
+        // Report dropped messages at most once per second (and when
+        // stopping), otherwise the report itself would flood the log.
+        const int now = (int)time(NULL);
+        if((now != last_report || stop) &&
+           (g_num_dropped.load() > 0 || g_num_rate_limited.load() > 0))
+        {
+            last_report      = now;
+            int dropped      = g_num_dropped.exchange(0);
+            int rate_limited = g_num_rate_limited.exchange(0);
+            char text[128];
+            snprintf(text, sizeof(text), "[warn   ] Log: %d messages "
+                     "dropped, %d because of the rate limit.",
+                     dropped + rate_limited, rate_limited);
+            writeMessage(LL_WARN, text);
+        }
+
+        // Only stop after all messages logged before the stop request
+        // have been written.
+        if(stop)
+            break;
+        if(!written)
+            StkTime::sleep(5);
+    }
+    return NULL;
+}   // writeLoop
 
 // ----------------------------------------------------------------------------
 /** This function opens the files that will contain the output.
@@ -234,6 +434,8 @@ void Log::openOutputFiles(const std::string &logout)
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
+    stopWriterThread();
     fclose(m_file_stdout);
+    m_file_stdout = NULL;
 } // closeOutputFiles
 
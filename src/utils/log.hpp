@@ -59,8 +59,15 @@ private:
     /** The file where stdout output will be written */
     static FILE* m_file_stdout;
 
+    /** Maximum number of messages below LL_WARN per second and component,
+     *  0 if messages are not rate limited. */
+    static int      m_rate_limit;
+
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
+    static bool isRateLimited(const char *component);
+    static void writeMessage(int level, const char *text);
+    static void *writeLoop(void *obj);
 
 public:
 
@@ -96,6 +103,10 @@ public:
 
     static void closeOutputFiles();
 
+    static void startWriterThread();
+
+    static void stopWriterThread();
+
     // ------------------------------------------------------------------------
     /** Defines the minimum log level to be displayed. */
     static void setLogLevel(int n)
@@ -115,6 +126,10 @@ public:
      *  replacing the cleartext password in an http request). */
     static LogLevel getLogLevel() { return m_min_log_level;  }
     // ------------------------------------------------------------------------
+    /** Limits the number of messages below LL_WARN each component can print
+     *  per second, 0 disables the limit. */
+    static void setRateLimit(int n) { m_rate_limit = n < 0 ? 0 : n; }
+    // ------------------------------------------------------------------------
     /** Disable coloring of log messages. */
     static void disableColor()
     {
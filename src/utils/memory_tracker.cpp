@@ -0,0 +1,248 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/memory_tracker.hpp"
+
+#ifdef ENABLE_MEMORY_TRACKING
+
+#include "utils/log.hpp"
+
+#include <new>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+#  include <windows.h>
+#  define THREAD_LOCAL __declspec(thread)
+#  define ATOMIC_ADD(x, v) InterlockedExchangeAdd64(&(x), (v))
+#  define ATOMIC_EXCHANGE(x, v) InterlockedExchange64(&(x), (v))
+#else
+#  define THREAD_LOCAL __thread
+#  define ATOMIC_ADD(x, v) __sync_fetch_and_add(&(x), (v))
+#  define ATOMIC_EXCHANGE(x, v) __sync_lock_test_and_set(&(x), (v))
+#endif
+
+namespace MemoryTracker
+{
+    /** Each allocation is preceded by this header. Its size keeps the
+     *  alignment of the memory returned by malloc. */
+    union AllocationHeader
+    {
+        struct
+        {
+            size_t m_size;
+            int    m_tag;
+        } m_info;
+        char m_padding[16];
+    };   // AllocationHeader
+
+    /** The tag of the current thread. */
+    static THREAD_LOCAL int g_thread_tag = TAG_OTHER;
+
+    /** The current phase. */
+    static volatile int g_phase = PHASE_MENU;
+
+    /** All counters are plain integers so that they are initialised before
+     *  any constructor (which might allocate memory) is called. */
+    static volatile long long g_allocations[TAG_COUNT];
+    static volatile long long g_live_bytes[TAG_COUNT];
+    static volatile long long g_frame_allocations[TAG_COUNT];
+    static volatile long long g_heap_size;
+    static long long          g_peak_heap_size[PHASE_COUNT];
+
+    /** Per frame statistics, only accessed by the main thread. */
+    static long long          g_max_frame_allocations[TAG_COUNT];
+    static long long          g_frame_allocations_sum[TAG_COUNT];
+    static long long          g_num_frames;
+
+    static const char *g_tag_names[TAG_COUNT] =
+        { "other", "scene loading", "gui", "physics", "network", "audio" };
+    static const char *g_phase_names[PHASE_COUNT] =
+        { "menu", "loading", "race" };
+
+    // ------------------------------------------------------------------------
+    /** Allocates memory and counts it for the tag of the current thread. */
+    static void *allocate(size_t size)
+    {
+        AllocationHeader *header =
+            (AllocationHeader*)malloc(size + sizeof(AllocationHeader));
+        if (!header)
+            return NULL;
+        const int tag = g_thread_tag;
+        header->m_info.m_size = size;
+        header->m_info.m_tag  = tag;
+        ATOMIC_ADD(g_allocations[tag], 1);
+        ATOMIC_ADD(g_frame_allocations[tag], 1);
+        ATOMIC_ADD(g_live_bytes[tag], (long long)size);
+        const long long heap = ATOMIC_ADD(g_heap_size, (long long)size)
+                             + (long long)size;
+        // This can miss a peak if two threads allocate at the same time,
+        // which is good enough for statistics.
+        if (heap > g_peak_heap_size[g_phase])
+            g_peak_heap_size[g_phase] = heap;
+        return header + 1;
+    }   // allocate
+
+    // ------------------------------------------------------------------------
+    /** Frees memory allocated with allocate(). */
+    static void deallocate(void *p)
+    {
+        if (!p)
+            return;
+        AllocationHeader *header = (AllocationHeader*)p - 1;
+        const long long size = (long long)header->m_info.m_size;
+        ATOMIC_ADD(g_live_bytes[header->m_info.m_tag], -size);
+        ATOMIC_ADD(g_heap_size, -size);
+        free(header);
+    }   // deallocate
+
+    // ------------------------------------------------------------------------
+    Tag getThreadTag()
+    {
+        return (Tag)g_thread_tag;
+    }   // getThreadTag
+
+    // ------------------------------------------------------------------------
+    /** Sets the tag all following allocations of this thread are counted
+     *  for. */
+    void setThreadTag(Tag tag)
+    {
+        g_thread_tag = tag;
+    }   // setThreadTag
+
+    // ------------------------------------------------------------------------
+    /** Sets the current phase of the game. The peak heap size of the new
+     *  phase starts with the current heap size. */
+    void setPhase(Phase phase)
+    {
+        if (g_phase == phase)
+            return;
+        g_phase = phase;
+        if (g_heap_size > g_peak_heap_size[phase])
+            g_peak_heap_size[phase] = g_heap_size;
+    }   // setPhase
+
+    // ------------------------------------------------------------------------
+    /** Called once per frame by the main thread to collect the number of
+     *  allocations done in the frame. */
+    void endFrame()
+    {
+        for (unsigned int i = 0; i < TAG_COUNT; i++)
+        {
+            long long n = ATOMIC_EXCHANGE(g_frame_allocations[i], 0);
+            g_frame_allocations_sum[i] += n;
+            if (n > g_max_frame_allocations[i])
+                g_max_frame_allocations[i] = n;
+        }
+        g_num_frames++;
+    }   // endFrame
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of allocations done so far by all tags. */
+    long long getAllocationCount()
+    {
+        long long count = 0;
+        for (unsigned int i = 0; i < TAG_COUNT; i++)
+            count += g_allocations[i];
+        return count;
+    }   // getAllocationCount
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes currently allocated. */
+    long long getHeapSize()
+    {
+        return g_heap_size;
+    }   // getHeapSize
+
+    // ------------------------------------------------------------------------
+    /** Prints the statistics of all tags and phases. */
+    void report()
+    {
+        Log::info("MemoryTracker", "%-14s %12s %12s %10s %10s", "tag",
+                  "allocations", "live kB", "av/frame", "max/frame");
+        for (unsigned int i = 0; i < TAG_COUNT; i++)
+        {
+            Log::info("MemoryTracker", "%-14s %12lld %12lld %10.1f %10lld",
+                      g_tag_names[i], g_allocations[i], g_live_bytes[i] / 1024,
+                      g_num_frames ? (float)g_frame_allocations_sum[i]
+                                     / g_num_frames
+                                   : 0.0f,
+                      g_max_frame_allocations[i]);
+        }
+        for (unsigned int i = 0; i < PHASE_COUNT; i++)
+        {
+            Log::info("MemoryTracker", "Peak heap during %s: %lld kB.",
+                      g_phase_names[i], g_peak_heap_size[i] / 1024);
+        }
+    }   // report
+
+}   // namespace MemoryTracker
+
+// ----------------------------------------------------------------------------
+void *operator new(size_t size)
+{
+    void *p = MemoryTracker::allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}   // operator new
+
+// ----------------------------------------------------------------------------
+void *operator new[](size_t size)
+{
+    void *p = MemoryTracker::allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}   // operator new[]
+
+// ----------------------------------------------------------------------------
+void *operator new(size_t size, const std::nothrow_t&) throw()
+{
+    return MemoryTracker::allocate(size);
+}   // operator new(nothrow)
+
+// ----------------------------------------------------------------------------
+void *operator new[](size_t size, const std::nothrow_t&) throw()
+{
+    return MemoryTracker::allocate(size);
+}   // operator new[](nothrow)
+
+// ----------------------------------------------------------------------------
+void operator delete(void *p) throw()
+{
+    MemoryTracker::deallocate(p);
+}   // operator delete
+
+// ----------------------------------------------------------------------------
+void operator delete[](void *p) throw()
+{
+    MemoryTracker::deallocate(p);
+}   // operator delete[]
+
+// ----------------------------------------------------------------------------
+void operator delete(void *p, const std::nothrow_t&) throw()
+{
+    MemoryTracker::deallocate(p);
+}   // operator delete(nothrow)
+
+// ----------------------------------------------------------------------------
+void operator delete[](void *p, const std::nothrow_t&) throw()
+{
+    MemoryTracker::deallocate(p);
+}   // operator delete[](nothrow)
+
+#endif
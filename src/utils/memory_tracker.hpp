@@ -0,0 +1,80 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MEMORY_TRACKER_HPP
+#define HEADER_MEMORY_TRACKER_HPP
+
+/**
+ * \brief Counts all allocations done with new, per subsystem and per phase
+ *  of the game.
+ *  If STK is compiled with USE_MEMORY_TRACKING (which works in release
+ *  builds as well), the global operator new and delete are replaced to count
+ *  allocations and the heap size. Each allocation is attributed to the tag
+ *  of the current thread, which is set with a ScopedTag (or setThreadTag for
+ *  a whole thread). Without USE_MEMORY_TRACKING all functions are empty.
+ * \ingroup utils
+ */
+namespace MemoryTracker
+{
+    /** The subsystems allocations are counted for. */
+    enum Tag { TAG_OTHER, TAG_SCENE_LOADING, TAG_GUI, TAG_PHYSICS,
+               TAG_NETWORK, TAG_AUDIO, TAG_COUNT };
+
+    /** The phases of the game for which the peak heap size is recorded. */
+    enum Phase { PHASE_MENU, PHASE_LOADING, PHASE_RACE, PHASE_COUNT };
+
+#ifdef ENABLE_MEMORY_TRACKING
+    Tag  getThreadTag();
+    void setThreadTag(Tag tag);
+    void setPhase(Phase phase);
+    void endFrame();
+    void report();
+    long long getAllocationCount();
+    long long getHeapSize();
+
+    // ------------------------------------------------------------------------
+    /** Attributes all allocations of the current thread to a tag while this
+     *  object exists. */
+    class ScopedTag
+    {
+    private:
+        Tag m_previous_tag;
+    public:
+        ScopedTag(Tag tag)
+        {
+            m_previous_tag = getThreadTag();
+            setThreadTag(tag);
+        }
+        ~ScopedTag() { setThreadTag(m_previous_tag); }
+    };   // ScopedTag
+
+#else
+    inline Tag  getThreadTag() { return TAG_OTHER; }
+    inline void setThreadTag(Tag tag) {}
+    inline void setPhase(Phase phase) {}
+    inline void endFrame() {}
+    inline void report() {}
+
+    class ScopedTag
+    {
+    public:
+        ScopedTag(Tag tag) {}
+    };   // ScopedTag
+#endif
+}   // namespace MemoryTracker
+
+#endif
@@ -0,0 +1,374 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/micro_benchmark.hpp"
+
+#include "config/hardware_stats.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/material_manager.hpp"
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "network/network_string.hpp"
+#include "physics/triangle_mesh.hpp"
+#include "tracks/quad_graph.hpp"
+#include "utils/constants.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace MicroBenchmark
+{
+    /** Each benchmark is run this many times, the best and the median time
+     *  of all runs are reported. */
+    const unsigned int REPETITIONS = 7;
+
+    /** The results of all benchmarks as finished json objects. */
+    std::vector<std::string> m_results;
+
+    /** Results of the benchmarks are added to this, so that the compiler
+     *  can not remove the measured code. */
+    volatile float m_sink = 0;
+
+    // ------------------------------------------------------------------------
+    /** Returns a random number between min and max. The generator is seeded
+     *  in run(), so that each run uses the same data. */
+    float randomFloat(float min, float max)
+    {
+        return min + (max - min) * (float)rand() / (float)RAND_MAX;
+    }   // randomFloat
+
+    // ------------------------------------------------------------------------
+    /** Runs a benchmark several times and stores the time per operation.
+     *  \param name Name of the benchmark in the results.
+     *  \param ops Number of operations done by one call of f.
+     *  \param f The code to measure.
+     */
+    template<typename F>
+    void measure(const std::string &name, unsigned int ops, F f)
+    {
+        std::vector<double> times;
+        for (unsigned int i = 0; i < REPETITIONS; i++)
+        {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double, std::nano> ns =
+                std::chrono::steady_clock::now() - start;
+            times.push_back(ns.count() / std::max(ops, 1u));
+        }
+        std::sort(times.begin(), times.end());
+        Log::info("MicroBenchmark", "%-28s %8u ops  best %10.1f ns/op  "
+                  "median %10.1f ns/op", name.c_str(), ops, times[0],
+                  times[REPETITIONS / 2]);
+
+        HardwareStats::Json json;
+        json.add("name", name);
+        json.add("ops", ops);
+        json.add("best_ns_per_op", times[0]);
+        json.add("median_ns_per_op", times[REPETITIONS / 2]);
+        json.finish();
+        m_results.push_back(json.toString());
+    }   // measure
+
+    // ------------------------------------------------------------------------
+    /** Encodes and decodes size messages similar to a kart state update. */
+    void benchmarkNetworkString(unsigned int size)
+    {
+        std::vector<NetworkString> messages(size);
+        measure("network_string_encode", size, [&]()
+        {
+            for (unsigned int i = 0; i < size; i++)
+            {
+                NetworkString ns;
+                ns.ai8((uint8_t)i).af((float)i).af(1.0f).af(2.0f)
+                  .ai32(i).af(3.0f).af(4.0f).af(5.0f);
+                messages[i] = ns;
+            }
+        });
+        measure("network_string_decode", size, [&]()
+        {
+            float sum = 0;
+            for (unsigned int i = 0; i < size; i++)
+            {
+                NetworkString &ns = messages[i];
+                sum += ns.getUInt8(0) + ns.getFloat(1) + ns.getFloat(5)
+                     + ns.getFloat(9) + ns.getUInt32(13) + ns.getFloat(17)
+                     + ns.getFloat(21) + ns.getFloat(25);
+            }
+            m_sink = sum;
+        });
+    }   // benchmarkNetworkString
+
+    // ------------------------------------------------------------------------
+    /** Returns a quad file of a circular track with num_quads quads, which
+     *  is used to test xml parsing and the quad graph.
+     *  \param radius On return the radius of the center of the track.
+     *  \param width On return the half width of the track. */
+    std::string createQuadXML(unsigned int num_quads, float *radius,
+                              float *width)
+    {
+        // Each quad is about 2m long
+        *radius = std::max(num_quads / (float)M_PI, 10.0f);
+        *width  = 5.0f;
+        std::string xml = "<?xml version=\"1.0\"?>\n<quads>\n";
+        for (unsigned int i = 0; i < num_quads; i++)
+        {
+            const float a0 = 2.0f * (float)M_PI * i       / num_quads;
+            const float a1 = 2.0f * (float)M_PI * (i + 1) / num_quads;
+            const float r0 = *radius - *width, r1 = *radius + *width;
+            // The points must be counter-clockwise in the x/z plane
+            xml += "  <quad p0=\""
+                +  StringUtils::toString(r0*cosf(a0)) + " 0 "
+                +  StringUtils::toString(r0*sinf(a0)) + "\" p1=\""
+                +  StringUtils::toString(r1*cosf(a0)) + " 0 "
+                +  StringUtils::toString(r1*sinf(a0)) + "\" p2=\""
+                +  StringUtils::toString(r1*cosf(a1)) + " 0 "
+                +  StringUtils::toString(r1*sinf(a1)) + "\" p3=\""
+                +  StringUtils::toString(r0*cosf(a1)) + " 0 "
+                +  StringUtils::toString(r0*sinf(a1)) + "\"/>\n";
+        }
+        xml += "</quads>\n";
+        return xml;
+    }   // createQuadXML
+
+    // ------------------------------------------------------------------------
+    /** Parses a quad file with size quads. */
+    void benchmarkXML(unsigned int size)
+    {
+        float radius, width;
+        const std::string content = createQuadXML(size, &radius, &width);
+        measure("xml_parse", size, [&]()
+        {
+            XMLNode *root = file_manager->createXMLTreeFromString(content);
+            m_sink = root ? (float)root->getNumNodes() : 0.0f;
+            delete root;
+        });
+    }   // benchmarkXML
+
+    // ------------------------------------------------------------------------
+    /** Finds the road sector of random points on a circular track with size
+     *  quads, once without a previous sector (e.g. after a rescue), once for
+     *  a kart driving along the track. */
+    void benchmarkQuadGraph(unsigned int size)
+    {
+        float radius, width;
+        const std::string quad_file =
+            file_manager->getUserConfigFile("micro-benchmark-quads.xml");
+        {
+            std::ofstream out(quad_file.c_str());
+            out << createQuadXML(size, &radius, &width);
+        }
+        // No graph file exists, so the default loop is used
+        QuadGraph::create(quad_file,
+                 file_manager->getUserConfigFile("micro-benchmark-graph.xml"),
+                 false);
+
+        std::vector<Vec3> random_points(size), driving_points(size);
+        for (unsigned int i = 0; i < size; i++)
+        {
+            float a = randomFloat(0.0f, 2.0f * (float)M_PI);
+            float r = radius + randomFloat(-0.9f, 0.9f) * width;
+            random_points[i] = Vec3(r*cosf(a), 0.5f, r*sinf(a));
+            // A kart moving about 0.5m per frame along the track
+            a = 2.0f * (float)M_PI * i / size;
+            driving_points[i] = Vec3(radius*cosf(a), 0.5f, radius*sinf(a));
+        }
+        measure("find_road_sector_random", size, [&]()
+        {
+            int found = 0;
+            for (unsigned int i = 0; i < size; i++)
+            {
+                int sector = QuadGraph::UNKNOWN_SECTOR;
+                QuadGraph::get()->findRoadSector(random_points[i], &sector);
+                found += sector;
+            }
+            m_sink = (float)found;
+        });
+        measure("find_road_sector_driving", 4 * size, [&]()
+        {
+            int sector = QuadGraph::UNKNOWN_SECTOR;
+            for (unsigned int lap = 0; lap < 4; lap++)
+            {
+                for (unsigned int i = 0; i < size; i++)
+                    QuadGraph::get()->findRoadSector(driving_points[i],
+                                                     &sector);
+            }
+            m_sink = (float)sector;
+        });
+        QuadGraph::destroy();
+        file_manager->removeFile(quad_file);
+    }   // benchmarkQuadGraph
+
+    // ------------------------------------------------------------------------
+    /** Casts rays down onto a slightly uneven terrain with about size
+     *  triangles, once for random points, once for a kart driving over the
+     *  terrain (which can use the ray cache). */
+    void benchmarkTriangleMesh(unsigned int size)
+    {
+        const unsigned int n = std::max((unsigned int)sqrtf(size / 2.0f), 2u);
+        const float cell = 2.0f;
+        TriangleMesh mesh;
+        const btVector3 up(0, 1, 0);
+        for (unsigned int z = 0; z < n; z++)
+        {
+            for (unsigned int x = 0; x < n; x++)
+            {
+                btVector3 p[4];
+                for (unsigned int i = 0; i < 4; i++)
+                {
+                    const float px = (x + (i & 1)) * cell;
+                    const float pz = (z + (i >> 1)) * cell;
+                    p[i] = btVector3(px, 0.3f*sinf(px) * cosf(pz), pz);
+                }
+                mesh.addTriangle(p[0], p[2], p[1], up, up, up, NULL);
+                mesh.addTriangle(p[1], p[2], p[3], up, up, up, NULL);
+            }
+        }
+        mesh.createCollisionShape(/*create_collision_object*/false);
+
+        const float extent = n * cell;
+        std::vector<btVector3> random_points(size), driving_points(size);
+        for (unsigned int i = 0; i < size; i++)
+        {
+            random_points[i] = btVector3(randomFloat(0, extent), 2.0f,
+                                         randomFloat(0, extent));
+            // Diagonally over the terrain
+            const float t = extent * i / size;
+            driving_points[i] = btVector3(t, 2.0f, t);
+        }
+        const btVector3 down(0, -4.0f, 0);
+        measure("cast_ray_random", size, [&]()
+        {
+            btVector3 xyz;
+            const Material *material;
+            float sum = 0;
+            for (unsigned int i = 0; i < size; i++)
+            {
+                mesh.castRay(random_points[i], random_points[i] + down, &xyz,
+                             &material);
+                sum += xyz.getY();
+            }
+            m_sink = sum;
+        });
+        measure("cast_ray_driving", size, [&]()
+        {
+            btVector3 xyz, normal;
+            const Material *material;
+            TriangleMesh::RayCache cache;
+            float sum = 0;
+            for (unsigned int i = 0; i < size; i++)
+            {
+                mesh.castRay(driving_points[i], driving_points[i] + down,
+                             &xyz, &material, &normal,
+                             /*interpolate*/true, &cache);
+                sum += xyz.getY();
+            }
+            m_sink = sum;
+        });
+    }   // benchmarkTriangleMesh
+
+    // ------------------------------------------------------------------------
+    /** Looks up the materials of textures with size additional materials. */
+    void benchmarkMaterials(unsigned int size)
+    {
+        std::string content = "<materials>\n";
+        for (unsigned int i = 0; i < size; i++)
+            content += "  <material name=\"micro-benchmark-"
+                    +  StringUtils::toString(i) + ".png\" lazy-load=\"Y\"/>\n";
+        content += "</materials>\n";
+
+        // The textures do not exist, avoid one warning for each material
+        const int log_level = Log::getLogLevel();
+        Log::setLogLevel(Log::LL_ERROR);
+        XMLNode *root = file_manager->createXMLTreeFromString(content);
+        material_manager->pushTempMaterial(root, "micro-benchmark");
+        delete root;
+        Log::setLogLevel(log_level);
+
+        // A material lookup only uses the name of the texture
+        video::IVideoDriver *driver = irr_driver->getVideoDriver();
+        std::vector<video::ITexture*> textures;
+        const unsigned int num_textures = std::min(size, 256u);
+        for (unsigned int i = 0; i < num_textures; i++)
+        {
+            const unsigned int indx = (unsigned int)rand() % size;
+            textures.push_back(driver->addTexture(core::dimension2du(1, 1),
+                 ("micro-benchmark-" + StringUtils::toString(indx) + ".png")
+                 .c_str()));
+        }
+        measure("get_material_for", 4 * size, [&]()
+        {
+            unsigned int found = 0;
+            for (unsigned int i = 0; i < 4 * size; i++)
+            {
+                if (material_manager->getMaterialFor(
+                                         textures[i % num_textures], NULL))
+                    found++;
+            }
+            m_sink = (float)found;
+        });
+        for (unsigned int i = 0; i < textures.size(); i++)
+            driver->removeTexture(textures[i]);
+        material_manager->popTempMaterial();
+    }   // benchmarkMaterials
+
+    // ------------------------------------------------------------------------
+    /** Runs all benchmarks and writes the results.
+     *  \param json_file Name of the file the results are written to.
+     *  \param size Size of the synthetic data, e.g. the number of quads of
+     *         the track or the number of triangles of the terrain.
+     */
+    void run(const std::string &json_file, unsigned int size)
+    {
+        size = std::max(size, 16u);
+        Log::info("MicroBenchmark", "Running micro benchmarks with size %u.",
+                  size);
+        m_results.clear();
+        srand(1);
+        benchmarkNetworkString(size);
+        benchmarkXML(size);
+        benchmarkQuadGraph(size);
+        benchmarkTriangleMesh(size);
+        benchmarkMaterials(size);
+
+        HardwareStats::Json json;
+        json.add("version", STK_VERSION);
+        json.add("size", size);
+        json.add("repetitions", REPETITIONS);
+        json.addArray("benchmarks", m_results);
+        json.finish();
+
+        std::ofstream out(json_file.c_str());
+        if (!out.is_open())
+        {
+            Log::error("MicroBenchmark", "Can't write results to '%s'.",
+                       json_file.c_str());
+            return;
+        }
+        out << json.toString() << "\n";
+        Log::info("MicroBenchmark", "Results written to '%s'.",
+                  json_file.c_str());
+    }   // run
+
+}   // namespace MicroBenchmark
@@ -0,0 +1,37 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_MICRO_BENCHMARK_HPP
+#define HEADER_MICRO_BENCHMARK_HPP
+
+#include <string>
+
+/** \brief Measures the time of a few core engine primitives (network
+ *  strings, xml parsing, the quad graph, raycasts against a triangle mesh
+ *  and the material lookup) on synthetic data of a configurable size, so
+ *  that performance regressions are noticed before a release. Started with
+ *  --micro-benchmark=FILE (or 'make benchmark'), the results are written as
+ *  json to FILE, which makes it easy to compare them across commits.
+ *  \ingroup utils
+ */
+namespace MicroBenchmark
+{
+    void run(const std::string &json_file, unsigned int size);
+};   // MicroBenchmark
+
+#endif
@@ -0,0 +1,107 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MPSC_QUEUE_HPP
+#define HEADER_MPSC_QUEUE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+/** A lock-free, unbounded multi-producer single-consumer queue.
+ *  Any number of threads can push() concurrently without ever blocking,
+ *  but only one thread at a time may call pop(). This is the node based
+ *  queue by Dmitry Vyukov: producers only need one atomic exchange, the
+ *  consumer never needs an atomic read-modify-write operation.
+ *  The queue does not take ownership of pointer values, any values still
+ *  in the queue when it is destroyed must be freed by the owner (e.g. by
+ *  popping all elements first).
+ */
+template<typename TYPE>
+class MPSCQueue : public NoCopy
+{
+private:
+    struct Node
+    {
+        std::atomic<Node*> m_next;
+        TYPE               m_value;
+        Node() : m_next(NULL), m_value() {}
+        Node(const TYPE &v) : m_next(NULL), m_value(v) {}
+    };   // Node
+
+    /** Most recently pushed node, modified by producers. */
+    std::atomic<Node*> m_head;
+
+    /** The consumer side: a dummy node whose successor is the next node to
+     *  be popped. Only accessed by the consumer. */
+    Node *m_tail;
+
+public:
+    MPSCQueue()
+    {
+        m_tail = new Node();
+        m_head.store(m_tail);
+    }   // MPSCQueue
+
+    // ------------------------------------------------------------------------
+    ~MPSCQueue()
+    {
+        TYPE v;
+        while (pop(&v)) {}
+        delete m_tail;
+    }   // ~MPSCQueue
+
+    // ------------------------------------------------------------------------
+    /** Adds an element to the queue. Can be called from any thread. */
+    void push(const TYPE &v)
+    {
+        Node *n    = new Node(v);
+        Node *prev = m_head.exchange(n, std::memory_order_acq_rel);
+        prev->m_next.store(n, std::memory_order_release);
+    }   // push
+
+    // ------------------------------------------------------------------------
+    /** Removes the oldest element from the queue. Must only be called by one
+     *  thread at a time (the consumer).
+     *  \param v Pointer where to store the popped element.
+     *  \return True if an element was popped, false if the queue was empty
+     *          (or a producer has not finished its push() yet).
+     */
+    bool pop(TYPE *v)
+    {
+        Node *next = m_tail->m_next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        *v = next->m_value;
+        next->m_value = TYPE();
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }   // pop
+
+    // ------------------------------------------------------------------------
+    /** Returns true if the queue appears empty. Only meaningful for the
+     *  consumer. */
+    bool empty() const
+    {
+        return m_tail->m_next.load(std::memory_order_acquire) == NULL;
+    }   // empty
+};   // MPSCQueue
+
+#endif
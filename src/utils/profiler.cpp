@@ -24,11 +24,50 @@
 #include "utils/vs.hpp"
 
 #include <assert.h>
+#include <string.h>
 #include <stack>
 #include <sstream>
 #include <algorithm>
 #include <fstream>
 
+#ifdef _MSC_VER
+#  include <intrin.h>
+#  define THREAD_LOCAL __declspec(thread)
+#  define TRACE_WRITE_BARRIER() _ReadWriteBarrier()
+#else
+#  define THREAD_LOCAL __thread
+#  define TRACE_WRITE_BARRIER() __sync_synchronize()
+#endif
+
+/** The markers of one thread recorded for the trace capture. Only the
+ *  thread itself writes to its buffer, and a marker is only counted after
+ *  it is completely written, so no lock is needed to record markers. */
+struct ProfilerTraceThread
+{
+    /** Number of markers kept per thread, older markers are overwritten. */
+    static const unsigned int CAPACITY = 1 << 16;
+    /** Maximum nesting depth of markers. */
+    static const unsigned int MAX_DEPTH = 32;
+
+    struct Event
+    {
+        char   m_name[32];
+        double m_start, m_end;
+    };
+
+    std::string           m_name;
+    unsigned int          m_id;
+    std::vector<Event>    m_events;
+    /** Number of markers written so far (not limited to CAPACITY). */
+    volatile unsigned int m_count;
+    /** The currently open markers. */
+    Event                 m_stack[MAX_DEPTH];
+    unsigned int          m_depth;
+};   // ProfilerTraceThread
+
+/** The trace buffer of the current thread, or NULL if not created yet. */
+static THREAD_LOCAL ProfilerTraceThread *g_trace_thread = NULL;
+
 static const char* GPU_Phase[Q_LAST] =
 {
     "Shadows Cascade 0",
@@ -36,6 +75,7 @@ static const char* GPU_Phase[Q_LAST] =
     "Shadows Cascade 2",
     "Shadows Cascade 3",
     "Shadows Postprocess",
+    "Depth Pre-Pass",
     "Solid Pass 1",
     "RSM",
     "RH",
@@ -110,13 +150,97 @@ Profiler::Profiler()
     m_first_capture_sweep = true;
     m_first_gpu_capture_sweep = true;
     m_capture_report_buffer = NULL;
+    m_main_thread = pthread_self();
+    m_trace_enabled = false;
+    m_trace_start_time = 0.0;
+    pthread_mutex_init(&m_trace_mutex, NULL);
+    setThreadName("Main");
 }
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    for (unsigned int i = 0; i < m_trace_threads.size(); i++)
+        delete m_trace_threads[i];
+    pthread_mutex_destroy(&m_trace_mutex);
 }
 
+//-----------------------------------------------------------------------------
+/** Returns the trace buffer of the calling thread, creating it if this
+ *  thread did not use a marker before.
+ */
+ProfilerTraceThread *Profiler::getTraceThread()
+{
+    if (!g_trace_thread)
+    {
+        ProfilerTraceThread *t = new ProfilerTraceThread();
+        t->m_events.resize(ProfilerTraceThread::CAPACITY);
+        t->m_count = 0;
+        t->m_depth = 0;
+        pthread_mutex_lock(&m_trace_mutex);
+        t->m_id = (unsigned int)m_trace_threads.size();
+        m_trace_threads.push_back(t);
+        pthread_mutex_unlock(&m_trace_mutex);
+        std::ostringstream name;
+        name << "Thread " << t->m_id;
+        t->m_name = name.str();
+        g_trace_thread = t;
+    }
+    return g_trace_thread;
+}   // getTraceThread
+
+//-----------------------------------------------------------------------------
+/** Sets the name under which the markers of the calling thread appear in
+ *  the trace capture. Should be called at the start of each thread.
+ *  \param name Name of the thread.
+ */
+void Profiler::setThreadName(const char *name)
+{
+    ProfilerTraceThread *t = getTraceThread();
+    pthread_mutex_lock(&m_trace_mutex);
+    t->m_name = name;
+    pthread_mutex_unlock(&m_trace_mutex);
+}   // setThreadName
+
+//-----------------------------------------------------------------------------
+/** Writes the traced markers of all threads in the Chrome trace event format,
+ *  which can be loaded with chrome://tracing or other trace viewers. Markers
+ *  still being recorded by other threads at this time might be missing.
+ *  \param filename Name of the file to write.
+ */
+void Profiler::writeTrace(const std::string &filename)
+{
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    pthread_mutex_lock(&m_trace_mutex);
+    for (unsigned int i = 0; i < m_trace_threads.size(); i++)
+    {
+        const ProfilerTraceThread *t = m_trace_threads[i];
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << t->m_id << ",\"args\":{\"name\":\"" << t->m_name << "\"}}";
+        first = false;
+
+        const unsigned int count = t->m_count;
+        const unsigned int n = std::min(count, ProfilerTraceThread::CAPACITY);
+        for (unsigned int j = count - n; j < count; j++)
+        {
+            const ProfilerTraceThread::Event &e =
+                t->m_events[j % ProfilerTraceThread::CAPACITY];
+            if (e.m_start < m_trace_start_time)
+                continue;
+            out << ",\n{\"name\":\"" << e.m_name
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->m_id
+                << ",\"ts\":" << (long long)(e.m_start * 1000.0)
+                << ",\"dur\":" << (long long)((e.m_end - e.m_start) * 1000.0)
+                << "}";
+        }
+    }
+    pthread_mutex_unlock(&m_trace_mutex);
+    out << "\n]}\n";
+}   // writeTrace
+
 //-----------------------------------------------------------------------------
 
 void Profiler::setCaptureReport(bool captureReport)
@@ -130,9 +254,14 @@ void Profiler::setCaptureReport(bool captureReport)
         // all reasonable purposes. But it's not too clean to hardcode
         m_capture_report_buffer = new StringBuffer(20 * 1024 * 1024);
         m_gpu_capture_report_buffer = new StringBuffer(20 * 1024 * 1024);
+        m_trace_start_time = getTimeMilliseconds();
+        m_trace_enabled = true;
     }
     else if (m_capture_report && !captureReport)
     {
+        m_trace_enabled = false;
+        writeTrace(file_manager->getUserConfigFile("profiling_trace.json"));
+
         // when disabling capture to file, flush captured data to a file
         {
             std::ofstream filewriter(file_manager->getUserConfigFile("profiling.csv").c_str(), std::ios::out | std::ios::binary);
@@ -155,10 +284,58 @@ void Profiler::setCaptureReport(bool captureReport)
     }
 }
 
+//-----------------------------------------------------------------------------
+/** Returns the time of all markers of the last completed frame, e.g. for
+ *  benchmarks. Markers with the same name are summed up.
+ *  \param times Returns the time in ms for each marker name.
+ *  \param max_layer Only markers with at most this nesting depth are used.
+ */
+void Profiler::getLastFrameCpuTimes(std::map<std::string, double> *times,
+                                    size_t max_layer) const
+{
+    const MarkerList &markers = m_thread_infos[0].markers_done[!m_write_id];
+    for (MarkerList::const_iterator it = markers.begin(); it != markers.end();
+         it++)
+    {
+        if (it->layer <= max_layer)
+            (*times)[it->name] += it->end - it->start;
+    }
+}   // getLastFrameCpuTimes
+
+//-----------------------------------------------------------------------------
+/** Returns the name of a GPU timer.
+ *  \param phase One of the QueryPerf values.
+ */
+const char *Profiler::getGPUPhaseName(unsigned int phase)
+{
+    assert(phase < Q_LAST);
+    return GPU_Phase[phase];
+}   // getGPUPhaseName
+
 //-----------------------------------------------------------------------------
 /// Push a new marker that starts now
 void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 {
+    // Threads that have a trace buffer always keep track of their open
+    // markers, so that enabling the trace does not mix up markers
+    ProfilerTraceThread *t = m_trace_enabled ? getTraceThread()
+                                             : g_trace_thread;
+    if (t)
+    {
+        if (t->m_depth < ProfilerTraceThread::MAX_DEPTH)
+        {
+            ProfilerTraceThread::Event &e = t->m_stack[t->m_depth];
+            strncpy(e.m_name, name, sizeof(e.m_name) - 1);
+            e.m_name[sizeof(e.m_name) - 1] = 0;
+            e.m_start = getTimeMilliseconds();
+        }
+        t->m_depth++;
+    }
+
+    // Only the main thread is shown in the GUI
+    if (!pthread_equal(pthread_self(), m_main_thread))
+        return;
+
     // Don't do anything when frozen
     if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
         return;
@@ -176,6 +353,26 @@ void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 /// Stop the last pushed marker
 void Profiler::popCpuMarker()
 {
+    // The marker was only traced if tracing was enabled when it started
+    ProfilerTraceThread *t = g_trace_thread;
+    if (t && t->m_depth > 0)
+    {
+        t->m_depth--;
+        if (m_trace_enabled && t->m_depth < ProfilerTraceThread::MAX_DEPTH)
+        {
+            ProfilerTraceThread::Event &e =
+                t->m_events[t->m_count % ProfilerTraceThread::CAPACITY];
+            e = t->m_stack[t->m_depth];
+            e.m_end = getTimeMilliseconds();
+            // Make sure the event is written before it is counted
+            TRACE_WRITE_BARRIER();
+            t->m_count++;
+        }
+    }
+
+    if (!pthread_equal(pthread_self(), m_main_thread))
+        return;
+
     // Don't do anything when frozen
     if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
         return;
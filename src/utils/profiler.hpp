@@ -19,8 +19,10 @@
 #define PROFILER_HPP
 
 #include <irrlicht.h>
+#include <pthread.h>
 #include <list>
 #include <vector>
+#include <map>
 #include <stack>
 #include <string>
 #include <streambuf>
@@ -35,6 +37,7 @@ enum QueryPerf
     Q_SHADOWS_CASCADE2,
     Q_SHADOWS_CASCADE3,
     Q_SHADOW_POSTPROCESS,
+    Q_DEPTH_PREPASS,
     Q_SOLID_PASS1,
     Q_RSM,
     Q_RH,
@@ -62,6 +65,7 @@ enum QueryPerf
 
 class Profiler;
 extern Profiler profiler;
+struct ProfilerTraceThread;
 
 double getTimeMilliseconds();
 
@@ -184,6 +188,27 @@ private:
     StringBuffer* m_capture_report_buffer;
     StringBuffer* m_gpu_capture_report_buffer;
 
+    /** The thread the profiler was created in. Only this thread shows up in
+     *  the profiler GUI, markers of other threads are only traced. */
+    pthread_t     m_main_thread;
+
+    /** True while markers of all threads are recorded for the trace
+     *  capture (which is done together with the capture report). */
+    volatile bool m_trace_enabled;
+
+    /** Markers that started before this time are not written to the
+     *  trace file. */
+    double        m_trace_start_time;
+
+    /** The trace buffers of all threads that used markers. Protected by
+     *  m_trace_mutex, which is only locked when a new thread is added or
+     *  when the trace is written. */
+    std::vector<ProfilerTraceThread*> m_trace_threads;
+    pthread_mutex_t                   m_trace_mutex;
+
+    ProfilerTraceThread *getTraceThread();
+    void    writeTrace(const std::string &filename);
+
 public:
     Profiler();
     virtual ~Profiler();
@@ -191,6 +216,7 @@ public:
     void    pushCpuMarker(const char* name="N/A", const video::SColor& color=video::SColor());
     void    popCpuMarker();
     void    synchronizeFrame();
+    void    setThreadName(const char *name);
 
     void    draw();
 
@@ -199,6 +225,10 @@ public:
     bool getCaptureReport() const { return m_capture_report; }
     void setCaptureReport(bool captureReport);
 
+    void getLastFrameCpuTimes(std::map<std::string, double> *times,
+                              size_t max_layer) const;
+    static const char *getGPUPhaseName(unsigned int phase);
+
     bool isFrozen() const { return m_freeze_state == FROZEN; }
 
 protected:
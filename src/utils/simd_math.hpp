@@ -0,0 +1,189 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_SIMD_MATH_HPP
+#define HEADER_SIMD_MATH_HPP
+
+/** \file simd_math.hpp
+ *  Small math kernels used in hot loops (culling, skinning, sector
+ *  detection), implemented with SSE2 or NEON if the compiler targets them,
+ *  else with plain C++. The implementation is selected at compile time,
+ *  defining STK_NO_SIMD forces the scalar version. All functions use the
+ *  memory layout of irrlicht's matrix4, i.e. m[0..3] is the image of the
+ *  x axis and m[12..14] the translation.
+ */
+
+#if !defined(STK_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+                              (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define STK_SIMD_SSE2
+#  include <emmintrin.h>
+#elif !defined(STK_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#  define STK_SIMD_NEON
+#  include <arm_neon.h>
+#endif
+
+#include <math.h>
+
+namespace SIMDMath
+{
+#if defined(STK_SIMD_SSE2) || defined(STK_SIMD_NEON)
+#  define STK_SIMD
+
+    /** Four floats in one register. */
+    struct Float4
+    {
+#ifdef STK_SIMD_SSE2
+        __m128 m_v;
+#else
+        float32x4_t m_v;
+#endif
+    };   // Float4
+
+#ifdef STK_SIMD_SSE2
+    inline Float4 make(__m128 v) { Float4 f; f.m_v = v; return f; }
+    /** Loads 4 floats, the address does not need to be aligned. */
+    inline Float4 load(const float *p) { return make(_mm_loadu_ps(p)); }
+    inline void   store(float *p, Float4 a) { _mm_storeu_ps(p, a.m_v); }
+    inline Float4 splat(float f) { return make(_mm_set1_ps(f)); }
+    inline Float4 operator+(Float4 a, Float4 b) { return make(_mm_add_ps(a.m_v, b.m_v)); }
+    inline Float4 operator-(Float4 a, Float4 b) { return make(_mm_sub_ps(a.m_v, b.m_v)); }
+    inline Float4 operator*(Float4 a, Float4 b) { return make(_mm_mul_ps(a.m_v, b.m_v)); }
+    inline Float4 abs(Float4 a)
+    {
+        return make(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.m_v));
+    }   // abs
+    /** Returns a bit mask with bit i set if a[i] > b[i]. */
+    inline int greaterMask(Float4 a, Float4 b)
+    {
+        return _mm_movemask_ps(_mm_cmpgt_ps(a.m_v, b.m_v));
+    }   // greaterMask
+    /** Returns a bit mask with bit i set if a[i] >= b[i]. */
+    inline int greaterEqualMask(Float4 a, Float4 b)
+    {
+        return _mm_movemask_ps(_mm_cmpge_ps(a.m_v, b.m_v));
+    }   // greaterEqualMask
+#else
+    inline Float4 make(float32x4_t v) { Float4 f; f.m_v = v; return f; }
+    inline Float4 load(const float *p) { return make(vld1q_f32(p)); }
+    inline void   store(float *p, Float4 a) { vst1q_f32(p, a.m_v); }
+    inline Float4 splat(float f) { return make(vdupq_n_f32(f)); }
+    inline Float4 operator+(Float4 a, Float4 b) { return make(vaddq_f32(a.m_v, b.m_v)); }
+    inline Float4 operator-(Float4 a, Float4 b) { return make(vsubq_f32(a.m_v, b.m_v)); }
+    inline Float4 operator*(Float4 a, Float4 b) { return make(vmulq_f32(a.m_v, b.m_v)); }
+    inline Float4 abs(Float4 a) { return make(vabsq_f32(a.m_v)); }
+    /** Converts the result of a comparison into a bit mask. */
+    inline int toMask(uint32x4_t m)
+    {
+        static const uint32_t bits[4] = { 1, 2, 4, 8 };
+        const uint32x4_t b = vandq_u32(m, vld1q_u32(bits));
+        const uint32x2_t t = vorr_u32(vget_low_u32(b), vget_high_u32(b));
+        return (int)(vget_lane_u32(t, 0) | vget_lane_u32(t, 1));
+    }   // toMask
+    inline int greaterMask(Float4 a, Float4 b)
+    {
+        return toMask(vcgtq_f32(a.m_v, b.m_v));
+    }   // greaterMask
+    inline int greaterEqualMask(Float4 a, Float4 b)
+    {
+        return toMask(vcgeq_f32(a.m_v, b.m_v));
+    }   // greaterEqualMask
+#endif
+#endif
+
+    // ------------------------------------------------------------------------
+    /** Computes out = a * b, the same as irrlicht's matrix4::setbyproduct.
+     *  out may be the same as a or b. */
+    inline void multiplyMatrix(const float *a, const float *b, float *out)
+    {
+#ifdef STK_SIMD
+        const Float4 c0 = load(a), c1 = load(a + 4), c2 = load(a + 8),
+                     c3 = load(a + 12);
+        Float4 result[4];
+        for (unsigned j = 0; j < 4; j++)
+        {
+            const float *bj = b + 4 * j;
+            result[j] = c0 * splat(bj[0]) + c1 * splat(bj[1]) +
+                        c2 * splat(bj[2]) + c3 * splat(bj[3]);
+        }
+        for (unsigned j = 0; j < 4; j++)
+            store(out + 4 * j, result[j]);
+#else
+        float result[16];
+        for (unsigned j = 0; j < 4; j++)
+        {
+            for (unsigned i = 0; i < 4; i++)
+            {
+                result[4 * j + i] = a[i]     * b[4 * j]     +
+                                    a[4 + i] * b[4 * j + 1] +
+                                    a[8 + i] * b[4 * j + 2] +
+                                    a[12 + i]* b[4 * j + 3];
+            }
+        }
+        for (unsigned i = 0; i < 16; i++)
+            out[i] = result[i];
+#endif
+    }   // multiplyMatrix
+
+    // ------------------------------------------------------------------------
+    /** Transforms an axis aligned box and returns the axis aligned box
+     *  containing the result, the same as irrlicht's transformBoxEx. The
+     *  center is transformed, and the new half extent is the sum of the
+     *  absolute axes of the matrix scaled by the old half extent.
+     *  \param m The matrix (16 floats).
+     *  \param min, max The box (3 floats each), overwritten with the result.
+     */
+    inline void transformBox(const float *m, float *min, float *max)
+    {
+        const float c[3] = { (min[0] + max[0]) * 0.5f,
+                             (min[1] + max[1]) * 0.5f,
+                             (min[2] + max[2]) * 0.5f };
+        const float e[3] = { (max[0] - min[0]) * 0.5f,
+                             (max[1] - min[1]) * 0.5f,
+                             (max[2] - min[2]) * 0.5f };
+#ifdef STK_SIMD
+        // The 4th component is not used, but loaded with the columns
+        const Float4 a0 = load(m), a1 = load(m + 4), a2 = load(m + 8),
+                     t  = load(m + 12);
+        const Float4 center = a0 * splat(c[0]) + a1 * splat(c[1]) +
+                              a2 * splat(c[2]) + t;
+        const Float4 extent = abs(a0) * splat(e[0]) + abs(a1) * splat(e[1]) +
+                              abs(a2) * splat(e[2]);
+        float lo[4], hi[4];
+        store(lo, center - extent);
+        store(hi, center + extent);
+        for (unsigned i = 0; i < 3; i++)
+        {
+            min[i] = lo[i];
+            max[i] = hi[i];
+        }
+#else
+        for (unsigned i = 0; i < 3; i++)
+        {
+            const float center = m[i] * c[0] + m[4 + i] * c[1] +
+                                 m[8 + i] * c[2] + m[12 + i];
+            const float extent = fabsf(m[i]) * e[0] + fabsf(m[4 + i]) * e[1] +
+                                 fabsf(m[8 + i]) * e[2];
+            min[i] = center - extent;
+            max[i] = center + extent;
+        }
+#endif
+    }   // transformBox
+
+}   // namespace SIMDMath
+
+#endif
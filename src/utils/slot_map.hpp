@@ -0,0 +1,203 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SLOT_MAP_HPP
+#define HEADER_SLOT_MAP_HPP
+
+#include <assert.h>
+#include <stddef.h>
+#include <vector>
+
+/** A handle to an element of a SlotMap. A handle stays valid until its
+ *  element is removed; after that it is detected as invalid, even if the
+ *  slot is reused by a new element.
+ * \ingroup utils
+ */
+struct SlotHandle
+{
+    /** Index of the slot. */
+    unsigned int m_index;
+    /** Generation of the slot when the handle was created. */
+    unsigned int m_generation;
+
+    SlotHandle() : m_index(INVALID_INDEX), m_generation(0) {}
+    // ------------------------------------------------------------------------
+    /** Returns false if this handle was never assigned an element. */
+    bool isSet() const { return m_index != INVALID_INDEX; }
+    // ------------------------------------------------------------------------
+    bool operator==(const SlotHandle &h) const
+    {
+        return m_index == h.m_index && m_generation == h.m_generation;
+    }
+    // ------------------------------------------------------------------------
+    bool operator!=(const SlotHandle &h) const { return !(*this == h); }
+
+    static const unsigned int INVALID_INDEX = 0xffffffff;
+};   // SlotHandle
+
+// ============================================================================
+/**
+ * \brief A container with O(1) insert and remove and stable handles.
+ *  The elements are stored densely in a vector (so iterating over them is
+ *  as fast as for a std::vector), and removing an element moves the last
+ *  element into its place. Each element is addressed by a SlotHandle, which
+ *  refers to a slot that knows where the element currently is in the dense
+ *  array. Each slot has a generation counter that is increased when its
+ *  element is removed, so stale handles are detected. Note that the order
+ *  of the elements changes when an element is removed, so this container
+ *  must not be used where the order matters.
+ * \ingroup utils
+ */
+template<typename TYPE>
+class SlotMap
+{
+private:
+    struct Slot
+    {
+        /** Index of the element in m_data, or the next free slot if this
+         *  slot is not used. */
+        unsigned int m_dense;
+        /** Increased each time the element of this slot is removed. */
+        unsigned int m_generation;
+    };   // Slot
+
+    /** The elements. */
+    std::vector<TYPE>         m_data;
+
+    /** For each element in m_data the index of its slot. */
+    std::vector<unsigned int> m_data_slot;
+
+    /** All slots, used ones point into m_data. */
+    std::vector<Slot>         m_slots;
+
+    /** First slot of the list of free slots. */
+    unsigned int              m_free_slot;
+
+public:
+    typedef typename std::vector<TYPE>::iterator       iterator;
+    typedef typename std::vector<TYPE>::const_iterator const_iterator;
+
+    SlotMap() : m_free_slot(SlotHandle::INVALID_INDEX) {}
+    // ------------------------------------------------------------------------
+    /** Adds an element and returns its handle. */
+    SlotHandle insert(const TYPE &t)
+    {
+        SlotHandle handle;
+        if (m_free_slot != SlotHandle::INVALID_INDEX)
+        {
+            handle.m_index = m_free_slot;
+            m_free_slot    = m_slots[m_free_slot].m_dense;
+        }
+        else
+        {
+            handle.m_index = (unsigned int)m_slots.size();
+            Slot slot;
+            slot.m_generation = 0;
+            m_slots.push_back(slot);
+        }
+        Slot &slot          = m_slots[handle.m_index];
+        slot.m_dense        = (unsigned int)m_data.size();
+        handle.m_generation = slot.m_generation;
+        m_data.push_back(t);
+        m_data_slot.push_back(handle.m_index);
+        return handle;
+    }   // insert
+    // ------------------------------------------------------------------------
+    /** Returns true if the handle refers to an element of this container. */
+    bool contains(const SlotHandle &handle) const
+    {
+        // The generation of a slot is increased when its element is
+        // removed, so a free slot never matches any handle.
+        return handle.m_index < m_slots.size() &&
+               m_slots[handle.m_index].m_generation == handle.m_generation;
+    }   // contains
+    // ------------------------------------------------------------------------
+    /** Removes the element of the given handle.
+     *  \return False if the handle was not valid (anymore). */
+    bool remove(const SlotHandle &handle)
+    {
+        if (!contains(handle))
+            return false;
+        Slot &slot = m_slots[handle.m_index];
+        const unsigned int dense = slot.m_dense;
+        const unsigned int last  = (unsigned int)m_data.size() - 1;
+        if (dense != last)
+        {
+            m_data[dense]      = m_data[last];
+            m_data_slot[dense] = m_data_slot[last];
+            m_slots[m_data_slot[dense]].m_dense = dense;
+        }
+        m_data.pop_back();
+        m_data_slot.pop_back();
+        slot.m_generation++;
+        slot.m_dense = m_free_slot;
+        m_free_slot  = handle.m_index;
+        return true;
+    }   // remove
+    // ------------------------------------------------------------------------
+    /** Returns the element of a handle, or NULL if the handle is invalid. */
+    TYPE *get(const SlotHandle &handle)
+    {
+        return contains(handle) ? &m_data[m_slots[handle.m_index].m_dense]
+                                : NULL;
+    }   // get
+    // ------------------------------------------------------------------------
+    const TYPE *get(const SlotHandle &handle) const
+    {
+        return contains(handle) ? &m_data[m_slots[handle.m_index].m_dense]
+                                : NULL;
+    }   // get
+    // ------------------------------------------------------------------------
+    /** Removes all elements. All handles become invalid. */
+    void clear()
+    {
+        for (unsigned int i = 0; i < m_data_slot.size(); i++)
+        {
+            Slot &slot = m_slots[m_data_slot[i]];
+            slot.m_generation++;
+            slot.m_dense = m_free_slot;
+            m_free_slot  = m_data_slot[i];
+        }
+        m_data.clear();
+        m_data_slot.clear();
+    }   // clear
+    // ------------------------------------------------------------------------
+    /** Returns the number of elements. */
+    unsigned int size() const { return (unsigned int)m_data.size(); }
+    // ------------------------------------------------------------------------
+    bool empty() const { return m_data.empty(); }
+    // ------------------------------------------------------------------------
+    /** Returns the i-th element in the (unordered) dense array. */
+    TYPE &operator[](unsigned int i)
+    {
+        assert(i < m_data.size());
+        return m_data[i];
+    }   // operator[]
+    // ------------------------------------------------------------------------
+    const TYPE &operator[](unsigned int i) const
+    {
+        assert(i < m_data.size());
+        return m_data[i];
+    }   // operator[]
+    // ------------------------------------------------------------------------
+    iterator       begin()       { return m_data.begin(); }
+    iterator       end()         { return m_data.end();   }
+    const_iterator begin() const { return m_data.begin(); }
+    const_iterator end()   const { return m_data.end();   }
+};   // SlotMap
+
+#endif
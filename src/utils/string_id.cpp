@@ -0,0 +1,74 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/string_id.hpp"
+
+#include "utils/log.hpp"
+#include "utils/synchronised.hpp"
+
+#include <unordered_map>
+
+namespace
+{
+    typedef std::unordered_map<StringId, std::string> InternTable;
+
+    /** All interned strings, created on first use so that intern() can be
+     *  called from static initialisers. */
+    Synchronised<InternTable> &getInternTable()
+    {
+        static Synchronised<InternTable> table;
+        return table;
+    }   // getInternTable
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Returns the id of a string and records the string in the table of all
+ *  interned strings. A warning is printed if another string with the same
+ *  id was interned before.
+ *  \param s The string to intern.
+ */
+StringId StringId::intern(const std::string &s)
+{
+    StringId id(s);
+    Synchronised<InternTable> &table = getInternTable();
+    table.lock();
+    std::pair<InternTable::iterator, bool> result =
+        table.getData().insert(std::make_pair(id, s));
+    if (!result.second && result.first->second != s)
+    {
+        Log::warn("StringId", "Hash collision between '%s' and '%s'.",
+                  result.first->second.c_str(), s.c_str());
+    }
+    table.unlock();
+    return id;
+}   // intern
+
+// ----------------------------------------------------------------------------
+/** Returns the string an id was interned with, or an empty string if the id
+ *  was never interned.
+ */
+const std::string &StringId::getString(StringId id)
+{
+    static const std::string empty;
+    Synchronised<InternTable> &table = getInternTable();
+    table.lock();
+    InternTable::const_iterator i = table.getData().find(id);
+    // Entries are never removed, so the reference stays valid.
+    const std::string &s = i == table.getData().end() ? empty : i->second;
+    table.unlock();
+    return s;
+}   // getString
@@ -0,0 +1,77 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2015 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_STRING_ID_HPP
+#define HEADER_STRING_ID_HPP
+
+#include "utils/types.hpp"
+
+#include <functional>
+#include <string>
+
+/**
+ * \brief A 32 bit hash of a string, used to look up assets by name with
+ *  integer comparisons instead of string comparisons.
+ *  The hash is FNV-1a, which is computed at compile time for literals, e.g.
+ *  StringId("materials.xml"). Different strings can have the same id, so
+ *  containers indexed by a StringId must still compare the strings of the
+ *  entries they find. intern() additionally records the string of an id in
+ *  a global table, which is used to get the string back (for debugging) and
+ *  to warn about hash collisions.
+ * \ingroup utils
+ */
+class StringId
+{
+private:
+    uint32_t m_id;
+
+    // ------------------------------------------------------------------------
+    static constexpr uint32_t hash(const char *s, uint32_t h)
+    {
+        return *s ? hash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+    }   // hash
+
+public:
+    // ------------------------------------------------------------------------
+    /** Computes the id of a string, at compile time for literals. */
+    constexpr StringId(const char *s) : m_id(hash(s, 2166136261u)) {}
+    // ------------------------------------------------------------------------
+    StringId(const std::string &s) : m_id(hash(s.c_str(), 2166136261u)) {}
+    // ------------------------------------------------------------------------
+    constexpr StringId() : m_id(0) {}
+    // ------------------------------------------------------------------------
+    /** Returns the numerical value of this id. */
+    constexpr uint32_t getId() const { return m_id; }
+    // ------------------------------------------------------------------------
+    constexpr bool operator==(const StringId &o) const { return m_id==o.m_id; }
+    constexpr bool operator!=(const StringId &o) const { return m_id!=o.m_id; }
+    constexpr bool operator< (const StringId &o) const { return m_id< o.m_id; }
+
+    static StringId           intern(const std::string &s);
+    static const std::string &getString(StringId id);
+};   // StringId
+
+namespace std
+{
+    /** Allows StringId to be used as key of unordered containers. */
+    template<> struct hash<StringId>
+    {
+        size_t operator()(const StringId &id) const { return id.getId(); }
+    };   // hash<StringId>
+}
+
+#endif
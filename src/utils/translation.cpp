@@ -465,11 +465,11 @@ const wchar_t* Translations::w_gettext(const char* original, const char* context
     Log::info("Translations", "Translating %s", original);
 #endif
 
-    const std::string& original_t = (context == NULL ?
-                                     m_dictionary.translate(original) :
-                                     m_dictionary.translate_ctxt(context, original));
+    const char* original_t = (context == NULL ?
+                              m_dictionary.translate(original) :
+                              m_dictionary.translate_ctxt(context, original));
 
-    if (original_t == original)
+    if (original_t == original || strcmp(original_t, original) == 0)
     {
         m_converted_string = utf8_to_wide(original);
 
@@ -482,7 +482,7 @@ const wchar_t* Translations::w_gettext(const char* original, const char* context
     // print
     //for (int n=0;; n+=4)
 
-    wchar_t* original_tw = utf8_to_wide(original_t.c_str());
+    wchar_t* original_tw = utf8_to_wide(original_t);
 
     wchar_t* out_ptr = original_tw;
     if (REMOVE_BOM) out_ptr++;
@@ -515,11 +515,11 @@ const wchar_t* Translations::w_ngettext(const wchar_t* singular, const wchar_t*
  */
 const wchar_t* Translations::w_ngettext(const char* singular, const char* plural, int num, const char* context)
 {
-    const std::string& res = (context == NULL ?
-                              m_dictionary.translate_plural(singular, plural, num) :
-                              m_dictionary.translate_ctxt_plural(context, singular, plural, num));
+    const char* res = (context == NULL ?
+                       m_dictionary.translate_plural(singular, plural, num) :
+                       m_dictionary.translate_ctxt_plural(context, singular, plural, num));
 
-    wchar_t* out_ptr = utf8_to_wide(res.c_str());
+    wchar_t* out_ptr = utf8_to_wide(res);
     if (REMOVE_BOM) out_ptr++;
 
 #if TRANSLATE_VERBOSE
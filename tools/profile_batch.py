@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+#
+#  SuperTuxKart - a fun racing game with go-kart
+#  Copyright (C) 2015 SuperTuxKart-Team
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+# Runs a list of profile races without graphics (several at the same time)
+# and collects the results of all races in one json file. Each line of the
+# batch file describes one race:
+#
+#     track num_karts laps [kart1,kart2,...] [repeat]
+#
+# e.g. 'snowmountain 4 3 gnu,sara,tux,elephpant 10'. Empty lines and lines
+# starting with '#' are ignored. Usage:
+#
+#     profile_batch.py [-j jobs] [-o results.json] path/to/supertuxkart batch.txt
+#
+# The races are always simulated with a fixed time step, so they run as fast
+# as the CPU allows and the results do not depend on the machine (except for
+# the performance counters).
+
+import json
+import multiprocessing
+import optparse
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def read_batch(filename):
+    races = []
+    for line in open(filename):
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        fields = line.split()
+        if len(fields) < 3:
+            sys.exit("Invalid line in '%s': %s" % (filename, line))
+        race = {'track': fields[0], 'num_karts': int(fields[1]),
+                'laps': int(fields[2])}
+        if len(fields) > 3:
+            race['karts'] = fields[3]
+        repeat = int(fields[4]) if len(fields) > 4 else 1
+        for run in range(repeat):
+            r = dict(race)
+            r['run'] = run
+            races.append(r)
+    return races
+
+
+def run_race(args):
+    executable, race = args
+    handle, json_file = tempfile.mkstemp(suffix='.json')
+    os.close(handle)
+    command = [executable, '--no-graphics', '-R',
+               '--track=%s' % race['track'],
+               '--numkarts=%d' % race['num_karts'],
+               '--profile-laps=%d' % race['laps'],
+               '--profile-json=%s' % json_file]
+    if 'karts' in race:
+        command.append('--ai=%s' % race['karts'])
+    devnull = open(os.devnull, 'w')
+    status = subprocess.call(command, stdout=devnull, stderr=devnull)
+    result = dict(race)
+    try:
+        result['result'] = json.load(open(json_file))
+    except ValueError:
+        result['error'] = 'No results, exit status %d' % status
+    os.remove(json_file)
+    return result
+
+
+def main():
+    parser = optparse.OptionParser(
+        usage='%prog [options] path/to/supertuxkart batch.txt')
+    parser.add_option('-j', '--jobs', type='int',
+                      default=multiprocessing.cpu_count(),
+                      help='number of races to run at the same time')
+    parser.add_option('-o', '--output', default='profile_results.json',
+                      help='file to write the results to')
+    options, args = parser.parse_args()
+    if len(args) != 2:
+        parser.error('Executable and batch file are required.')
+
+    races = read_batch(args[1])
+    pool = multiprocessing.Pool(options.jobs)
+    results = pool.map(run_race, [(args[0], race) for race in races])
+    pool.close()
+
+    json.dump(results, open(options.output, 'w'), indent=2)
+    failed = [r for r in results if 'error' in r]
+    print('%d races done, %d failed, results written to %s'
+          % (len(results), len(failed), options.output))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
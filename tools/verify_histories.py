@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+#
+#  SuperTuxKart - a fun racing game with go-kart
+#  Copyright (C) 2015 SuperTuxKart-Team
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+# Verifies history files (e.g. submitted time trial races) by simulating
+# them again without graphics (several at the same time). Since the world is
+# updated with a fixed time step, an unmodified history gives exactly the
+# recorded finish times. Usage:
+#
+#     verify_histories.py [-j jobs] [-o results.json] path/to/supertuxkart \
+#                         history1.dat [history2.dat ...]
+#
+# The exit status is 1 if any history could not be verified.
+
+import json
+import multiprocessing
+import optparse
+import os
+import subprocess
+import sys
+
+
+def verify(args):
+    executable, history = args
+    command = [executable, '--no-graphics',
+               '--verify-history=%s' % os.path.abspath(history)]
+    devnull = open(os.devnull, 'w')
+    status = subprocess.call(command, stdout=devnull, stderr=devnull)
+    return {'history': history, 'verified': status == 0, 'status': status}
+
+
+def main():
+    parser = optparse.OptionParser(
+        usage='%prog [options] path/to/supertuxkart history.dat...')
+    parser.add_option('-j', '--jobs', type='int',
+                      default=multiprocessing.cpu_count(),
+                      help='number of histories to verify at the same time')
+    parser.add_option('-o', '--output', default='verify_results.json',
+                      help='file to write the results to')
+    options, args = parser.parse_args()
+    if len(args) < 2:
+        parser.error('Executable and at least one history file are required.')
+
+    pool = multiprocessing.Pool(options.jobs)
+    results = pool.map(verify, [(args[0], history) for history in args[1:]])
+    pool.close()
+
+    json.dump(results, open(options.output, 'w'), indent=2)
+    failed = [r for r in results if not r['verified']]
+    for r in failed:
+        print('%s: verification failed (exit status %d)'
+              % (r['history'], r['status']))
+    print('%d histories verified, %d failed, results written to %s'
+          % (len(results), len(failed), options.output))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())